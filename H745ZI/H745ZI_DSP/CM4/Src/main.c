@@ -0,0 +1,174 @@
+// main.c (CM4), Michael Haselberger
+// Description: Cortex-M4 application. Computes the reverb tail for the M7 (DUAL_CORE, see dual_core.h) and, with
+// CONTROL_M4, runs the menu: encoder, button, LCD and presets belong to this core then (see control_link.h).
+// The M7 configures the clocks and starts this core (HAL_RCCEx_EnableBootCore), the audio peripherals are owned by the M7.
+// Build settings differing from the M7 project: CORE_CM4, ARM_MATH_CM4, libarm_cortexM4lf_math.a and
+// STM32H745ZITx_FLASH_CM4.ld (flash bank 2, RAM_D3 behind the inter-core mailbox). With CONTROL_M4, user_interface.c,
+// control_link.c, preset.c, tempo.c, timer.c, i2c.c and i2c_lcd.c are compiled into this project as well, with
+// DISPLAY_TFT also tft.c, stm32h7xx_hal_dma2d.c and the font24.c of the BSP utilities (fonts.h).
+
+#include "stm32h7xx_hal.h"
+#include <arm_math.h>
+#include "dual_core.h"
+#if defined(CONTROL_M4)
+#include "main.h"
+#endif
+
+#if defined(CONTROL_M4)
+// time of the last button press, for the debouncing and the tap tempo
+volatile uint32_t btn_tick = 0;
+// effect selected in the menu, as sent to the M7
+static uint8_t mode = FXNONE;
+// core clock the SysTick was set up for. the M7 changes the clock profile (power.h), the tick has to stay 1 ms
+static uint32_t tick_clock = 0;
+
+// the controls and the LCD, as the M7 sets them up without CONTROL_M4
+static void control_init(void)
+{
+	__HAL_RCC_GPIOA_CLK_ENABLE();
+	__HAL_RCC_GPIOB_CLK_ENABLE();
+
+	// push button of the encoder on PA9, closes to ground
+	GPIO_InitTypeDef gpio_button = {0};
+	gpio_button.Pin = GPIO_PIN_9;
+	gpio_button.Mode = GPIO_MODE_IT_FALLING;
+	gpio_button.Pull = GPIO_PULLUP;
+	gpio_button.Speed = GPIO_SPEED_FREQ_LOW;
+	HAL_GPIO_Init(GPIOA, &gpio_button);
+	// the controls (button, encoder in timer.c) share one priority below the reverb tail (see ui_post)
+	HAL_NVIC_SetPriority(EXTI9_5_IRQn, 3, 0);
+	HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+
+	MX_TIM2_Init();
+#if !defined(DISPLAY_TFT)
+	MX_I2C1_Init();
+#endif
+	// the init commands follow with the menu passes (lcd_update), the M4 serves the reverb tail in between
+	lcd_init();
+	lcd_fb_write(0, 0, "Initializing");
+}
+
+// keep the SysTick at 1 ms when the M7 switched the clock profile
+static void follow_core_clock(void)
+{
+	SystemCoreClockUpdate();
+	if (SystemCoreClock != tick_clock)
+	{
+		tick_clock = SystemCoreClock;
+		HAL_InitTick(TICK_INT_PRIORITY);
+	}
+}
+#endif
+
+int main(void)
+{
+	// clock tree is already configured by the M7. HAL_Init only sets up the SysTick of this core
+	HAL_Init();
+	dual_core_init();
+	// the M7 waits for this before it relies on the M4 (the menu comes up by itself)
+	dual_core_announce();
+
+#if defined(CONTROL_M4)
+	tick_clock = SystemCoreClock;
+	control_init();
+	// the preset saved last replaces the init values of the M7, its values go out as the first commands
+	preset_init();
+	uint8_t slot;
+	if (preset_latest(&slot) == 0)
+	{
+		apply_preset(slot, &mode);
+	}
+
+	// the reverb tail comes first, the menu runs between two blocks. sleeps until the next interrupt: a block of the
+	// M7, a control, the LCD transfer or the 1 ms SysTick
+	while (1)
+	{
+#if defined(DUAL_CORE)
+		dual_core_poll();
+#endif
+		follow_core_clock();
+		display_menu(ui_take_events(), &mode);
+		__WFI();
+	}
+#else
+	// never returns
+	dual_core_run();
+#endif
+}
+
+#if defined(CONTROL_M4)
+// the M4 has nothing to fall back to, it stops where the debugger can see it
+void Error_Handler(void)
+{
+	__disable_irq();
+	while (1)
+	{
+	}
+}
+
+// EXTI line 9: the encoder push button
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	if (GPIO_Pin == GPIO_PIN_9)
+	{
+		const uint32_t now = HAL_GetTick();
+		if ((now - btn_tick) >= UI_DEBOUNCE_MS)
+		{
+			btn_tick = now;
+			ui_post(UI_EVENT_BUTTON);
+		}
+	}
+}
+
+// TIM2 capture: an edge of the rotary encoder, the counter moved
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+	if (htim->Instance == TIM2)
+	{
+		ui_post(UI_EVENT_ENCODER);
+	}
+}
+
+void EXTI9_5_IRQHandler(void)
+{
+	HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_9);
+}
+
+void TIM2_IRQHandler(void)
+{
+	HAL_TIM_IRQHandler(&htim2);
+}
+
+void I2C1_EV_IRQHandler(void)
+{
+	HAL_I2C_EV_IRQHandler(&hi2c1);
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+	HAL_I2C_ER_IRQHandler(&hi2c1);
+}
+
+#if defined(DISPLAY_TFT)
+// the transfer of a TFT strip: the DMA ends, the SPI reports the end of the transmission
+void DMA2_Stream0_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_tft_tx);
+}
+
+void SPI5_IRQHandler(void)
+{
+	HAL_SPI_IRQHandler(&hspi_tft);
+}
+#endif
+#endif
+
+void SysTick_Handler(void)
+{
+	HAL_IncTick();
+}
+
+void HSEM2_IRQHandler(void)
+{
+	HAL_HSEM_IRQHandler();
+}
@@ -0,0 +1,75 @@
+// FreeRTOSConfig.h, Michael Haselberger
+// Description: FreeRTOS kernel configuration of the RTOS build (see rtos.h). Only read by the kernel sources and rtos.c
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdint.h>
+#include "defines_and_constants.h"
+
+extern uint32_t SystemCoreClock;
+uint32_t rtos_run_time(void);
+
+// scheduler. the core clock changes at runtime (power.h), HAL_InitTick keeps the 1 ms SysTick on the new clock
+#define configUSE_PREEMPTION						1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION		1
+#define configUSE_TICKLESS_IDLE						0
+#define configUSE_TIME_SLICING						0
+#define configCPU_CLOCK_HZ							(SystemCoreClock)
+#define configTICK_RATE_HZ							((TickType_t)1000)
+// idle, UI, control, audio
+#define configMAX_PRIORITIES						(4)
+#define configMINIMAL_STACK_SIZE					((uint16_t)128)
+#define configMAX_TASK_NAME_LEN						(8)
+#define configUSE_16_BIT_TICKS						0
+#define configIDLE_SHOULD_YIELD						1
+
+// everything is allocated statically, like the arenas of the effects: no heap file
+#define configSUPPORT_STATIC_ALLOCATION				1
+#define configSUPPORT_DYNAMIC_ALLOCATION			0
+
+#define configUSE_TASK_NOTIFICATIONS				1
+#define configUSE_MUTEXES							1
+#define configUSE_RECURSIVE_MUTEXES					0
+#define configUSE_COUNTING_SEMAPHORES				0
+#define configQUEUE_REGISTRY_SIZE					0
+#define configUSE_TIMERS							0
+#define configUSE_CO_ROUTINES						0
+
+// the idle task sleeps (__WFI), stack overflows stop in Error_Handler
+#define configUSE_IDLE_HOOK							1
+#define configUSE_TICK_HOOK							0
+#define configUSE_MALLOC_FAILED_HOOK				0
+#define configCHECK_FOR_STACK_OVERFLOW				2
+
+// run time of every task in microseconds, derived from the DWT cycle counter (rtos_run_time)
+#define configUSE_TRACE_FACILITY					1
+#define configUSE_STATS_FORMATTING_FUNCTIONS		0
+#define configGENERATE_RUN_TIME_STATS				1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()			rtos_run_time()
+
+#define INCLUDE_vTaskDelay							1
+#define INCLUDE_vTaskDelayUntil						1
+#define INCLUDE_uxTaskGetStackHighWaterMark			1
+#define INCLUDE_xTaskGetSchedulerState				1
+#define INCLUDE_xTaskGetIdleTaskHandle				1
+#define INCLUDE_vTaskSuspend						0
+#define INCLUDE_vTaskDelete							0
+
+// interrupt priorities, 4 bits on the H7. the kernel (PendSV, SysTick) runs at the lowest one. interrupts up to
+// AUDIO_IRQ_PRIORITY may call the FromISR functions, the MIDI UART (priority 0) stays above the kernel: its time
+// stamps aren't delayed by critical sections
+#define configPRIO_BITS								4
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY		15
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY	AUDIO_IRQ_PRIORITY
+#define configKERNEL_INTERRUPT_PRIORITY				(configLIBRARY_LOWEST_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY		(configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+
+#define configASSERT(x)								if ((x) == 0) { taskDISABLE_INTERRUPTS(); for (;;); }
+
+// the kernel takes over SVC and PendSV (stm32h7xx_it.c leaves them out), SysTick_Handler calls rtos_tick
+#define vPortSVCHandler								SVC_Handler
+#define xPortPendSVHandler							PendSV_Handler
+
+#endif // FREERTOS_CONFIG_H
@@ -14,6 +14,11 @@ extern DMA_HandleTypeDef hdma_i2s2_rx;
 extern DMA_HandleTypeDef hdma_i2s2_tx;
 void MX_I2S2_Init(void);
 void MX_DMA_Init(void);
+#if defined(MDMA_TRANSFER)
+extern MDMA_HandleTypeDef hmdma_rx;
+extern MDMA_HandleTypeDef hmdma_tx;
+void MX_MDMA_Init(uint16_t block_size);
+#endif
 
 #ifdef __cplusplus
 }
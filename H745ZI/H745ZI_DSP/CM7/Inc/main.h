@@ -19,13 +19,95 @@ extern "C" {
 #include "defines_and_constants.h"
 #include "rcc.h"
 #include "i2s.h"
+#include "sai.h"
 #include "timer.h"
 #include "i2c.h"
 #include "i2c_lcd.h"
+#include "tft.h"
 #include "fx_lib.h"
+#include "fx_chain.h"
+#include "cost_model.h"
+#include "looper.h"
 #include "user_interface.h"
+#include "profiler.h"
+#include "governor.h"
+#include "power.h"
+#include "tuner.h"
+#include "telemetry.h"
+#include "latency_probe.h"
+#include "usb_audio.h"
+#include "midi.h"
+#include "host_link.h"
+#include "capture.h"
+#include "trace.h"
+#include "stack_monitor.h"
+#include "mod_matrix.h"
+#include "expression.h"
+#include "benchmark.h"
+#include "rtos.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Health of the audio stream. Counted instead of halting the CPU, so a dropout on a pedal without debugger can be told
+*   apart: processing too slow (overruns) or the DMA/I2S losing the stream (errors, followed by a restart).
+*
+*   Members:
+*   overruns:           DMA blocks that arrived while DMA_BLOCKS - 1 blocks were still pending or being processed.
+*   dma_errors:         DMA transfer errors (bus error, FIFO error). The HAL stops the stream.
+*   i2s_errors:         I2S underruns and overruns: the DMA didn't serve the peripheral in time. With SAI_TDM those of
+*                       the SAI blocks and the frame sync errors of the receiver.
+*   restarts:           Restarts of the DMA and the I2S after an error.
+*   last_error:         HAL_I2S_ERROR_* bits of the last error (HAL_SAI_ERROR_* with SAI_TDM).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile uint32_t overruns;
+	volatile uint32_t dma_errors;
+	volatile uint32_t i2s_errors;
+	volatile uint32_t restarts;
+	volatile uint32_t last_error;
+} audio_stats_t;
+
+// quality of an audio_admission_t for an effect that wasn't switched on
+#define ADMISSION_REFUSED (0xFF)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Last decision of the admission check (admit in main.c) the menu reports: an effect that wasn't switched on, or a
+*   distortion that was switched on below the quality set in the menu.
+*
+*   Members:
+*   count:              Incremented with every report.
+*   fx:                 Effect (fx_designator) the check was made for.
+*   quality:            distortion_quality it runs at, ADMISSION_REFUSED if it wasn't switched on.
+*   mode:               Effect selected after the check: fx, or the one that stays on.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile uint32_t count;
+	volatile uint8_t fx;
+	volatile uint8_t quality;
+	volatile uint8_t mode;
+} audio_admission_t;
 
 void Error_Handler(void);
+void audio_process(void);
+const audio_stats_t* audio_get_stats(void);
+const audio_admission_t* audio_get_admission(void);
+uint8_t audio_set_block_size(uint16_t size);
+uint16_t audio_get_block_size(void);
+uint8_t audio_set_sample_rate(uint32_t rate);
+uint32_t audio_get_sample_rate(void);
+uint32_t audio_get_latency(void);
+void audio_select_amp(uint8_t n);
+#if defined(LATENCY_PROBE)
+void audio_latency_start(void);
+void audio_latency_stop(void);
+bool audio_latency_running(void);
+#endif
+#if defined(HOST_LINK)
+uint8_t audio_load_cab(const float32_t *ir, uint32_t length);
+#endif
 
 #ifdef __cplusplus
 }
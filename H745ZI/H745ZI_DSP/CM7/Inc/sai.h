@@ -0,0 +1,28 @@
+// header guard
+#ifndef __SAI_H__
+#define __SAI_H__
+
+// prevent C++ name mangling
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+#if defined(SAI_TDM)
+extern SAI_HandleTypeDef hsai_tx;
+extern SAI_HandleTypeDef hsai_rx;
+extern DMA_HandleTypeDef hdma_sai_tx;
+extern DMA_HandleTypeDef hdma_sai_rx;
+void MX_SAI1_Init(void);
+uint8_t sai_start(uint32_t *tx, uint32_t *rx, uint16_t block_size);
+void sai_stop(void);
+uint8_t sai_set_sample_rate(uint32_t rate);
+uint32_t sai_take_errors(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SAI_H__
@@ -11,6 +11,10 @@ I2S_HandleTypeDef hi2s2;
 DMA_HandleTypeDef hdma_i2s2_rx;
 DMA_HandleTypeDef hdma_i2s2_tx;
 #endif
+#if defined(MDMA_TRANSFER)
+MDMA_HandleTypeDef hmdma_rx;
+MDMA_HandleTypeDef hmdma_tx;
+#endif
 
 // I2S2 init function
 void MX_I2S2_Init(void)
@@ -23,8 +27,8 @@ void MX_I2S2_Init(void)
 	hi2s2.Init.DataFormat = I2S_DATAFORMAT_24B;
 	// enable master clock output
 	hi2s2.Init.MCLKOutput = I2S_MCLKOUTPUT_ENABLE;
-	// sampling frequency of 48 KHz
-	hi2s2.Init.AudioFreq = I2S_AUDIOFREQ_48K;
+	// sampling frequency after start-up (48 KHz), see audio_set_sample_rate in main.c for the others
+	hi2s2.Init.AudioFreq = AUDIO_SAMPLE_RATE;
 	// clock polarity = low
 	hi2s2.Init.CPOL = I2S_CPOL_LOW;
 	// big endian
@@ -79,6 +83,8 @@ void HAL_I2S_MspInit(I2S_HandleTypeDef *i2sHandle)
 		HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 #if defined(DMA)
 		/* I2S2 DMA Init */
+		// DMA_FIFO: 4 words per memory burst, the full FIFO is the only threshold INC4 of words allows. the bursts stay
+		// within a block half (16 byte aligned, 128 bytes at least), so they never cross a 1 KB boundary
 		/* SPI2_RX Init */
 		hdma_i2s2_rx.Instance = DMA1_Stream0;
 		hdma_i2s2_rx.Init.Request = DMA_REQUEST_SPI2_RX;
@@ -89,7 +95,14 @@ void HAL_I2S_MspInit(I2S_HandleTypeDef *i2sHandle)
 		hdma_i2s2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
 		hdma_i2s2_rx.Init.Mode = DMA_CIRCULAR;
 		hdma_i2s2_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+#if defined(DMA_FIFO)
+		hdma_i2s2_rx.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+		hdma_i2s2_rx.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+		hdma_i2s2_rx.Init.MemBurst = DMA_MBURST_INC4;
+		hdma_i2s2_rx.Init.PeriphBurst = DMA_PBURST_SINGLE;
+#else
 		hdma_i2s2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+#endif
 		if (HAL_DMA_Init(&hdma_i2s2_rx) != HAL_OK)
 		{
 			Error_Handler();
@@ -107,7 +120,14 @@ void HAL_I2S_MspInit(I2S_HandleTypeDef *i2sHandle)
 		hdma_i2s2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
 		hdma_i2s2_tx.Init.Mode = DMA_CIRCULAR;
 		hdma_i2s2_tx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+#if defined(DMA_FIFO)
+		hdma_i2s2_tx.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+		hdma_i2s2_tx.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+		hdma_i2s2_tx.Init.MemBurst = DMA_MBURST_INC4;
+		hdma_i2s2_tx.Init.PeriphBurst = DMA_PBURST_SINGLE;
+#else
 		hdma_i2s2_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+#endif
 		if (HAL_DMA_Init(&hdma_i2s2_tx) != HAL_OK)
 		{
 			Error_Handler();
@@ -123,15 +143,76 @@ void MX_DMA_Init(void)
 {
 	/* DMA interrupt init */
 	/* DMA1_Stream0_IRQn interrupt configuration */
-	HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 0, 0);
+	HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, AUDIO_IRQ_PRIORITY, 0);
 	HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
 	/* DMA1_Stream1_IRQn interrupt configuration */
-	HAL_NVIC_SetPriority(DMA1_Stream1_IRQn, 0, 0);
+	HAL_NVIC_SetPriority(DMA1_Stream1_IRQn, AUDIO_IRQ_PRIORITY, 0);
 	HAL_NVIC_EnableIRQ(DMA1_Stream1_IRQn);
 
 }
 #endif
 
+#if defined(MDMA_TRANSFER)
+// one channel of the interleaved DMA buffer <-> one row of a DTCM staging buffer, word by word. ch 0 first, the
+// block repeat then jumps back to the other channel (4 bytes behind the start) and to the next row of the staging buffer
+static void mdma_config(MDMA_HandleTypeDef *hmdma, MDMA_Channel_TypeDef *channel, bool to_stage, uint16_t block_size)
+{
+	// after a block the interleaved side has advanced by 2 words per sample, the staging side by 1
+	const int32_t interleaved_offset = 4 - 8 * (int32_t)block_size;
+	const int32_t stage_offset = 4 * (MAX_BLOCK_SIZE - (int32_t)block_size);
+
+	hmdma->Instance = channel;
+	hmdma->Init.Request = MDMA_REQUEST_SW;
+	hmdma->Init.TransferTriggerMode = MDMA_REPEAT_BLOCK_TRANSFER;
+	hmdma->Init.Priority = MDMA_PRIORITY_VERY_HIGH;
+	hmdma->Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+	// every second word of the DMA buffer belongs to the channel
+	hmdma->Init.SourceInc = (to_stage) ? MDMA_SRC_INC_DOUBLEWORD : MDMA_SRC_INC_WORD;
+	hmdma->Init.DestinationInc = (to_stage) ? MDMA_DEST_INC_WORD : MDMA_DEST_INC_DOUBLEWORD;
+	hmdma->Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+	hmdma->Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+	hmdma->Init.DataAlignment = MDMA_DATAALIGN_RIGHT;
+	// MIN_BLOCK_SIZE words
+	hmdma->Init.BufferTransferLength = 64;
+	hmdma->Init.SourceBurst = MDMA_SOURCE_BURST_SINGLE;
+	hmdma->Init.DestBurst = MDMA_DEST_BURST_SINGLE;
+	hmdma->Init.SourceBlockAddressOffset = (to_stage) ? interleaved_offset : stage_offset;
+	hmdma->Init.DestBlockAddressOffset = (to_stage) ? stage_offset : interleaved_offset;
+	if (HAL_MDMA_Init(hmdma) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+/******************************************************************************
+* Function Name: MX_MDMA_Init
+*******************************************************************************
+* Summary:
+*  Configure MDMA channel 0 (rx: DMA buffer -> DTCM) and channel 1 (tx: DTCM -> DMA buffer)
+*  for a block size. The channels are started by software from the DMA half/complete
+*  callbacks (rx) and after the block was processed (tx), see main.c. The block offsets
+*  depend on the block size, so this has to be called again after the block size changed
+*  (with both channels idle).
+*
+* Parameters:
+*  1. uint16_t block_size			- Samples per channel and DMA half.
+* Return:
+*  None.
+*
+******************************************************************************/
+void MX_MDMA_Init(uint16_t block_size)
+{
+	__HAL_RCC_MDMA_CLK_ENABLE();
+
+	mdma_config(&hmdma_rx, MDMA_Channel0, true, block_size);
+	mdma_config(&hmdma_tx, MDMA_Channel1, false, block_size);
+
+	// same priority as the I2S DMA, the rx transfer completes the DMA event
+	HAL_NVIC_SetPriority(MDMA_IRQn, AUDIO_IRQ_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(MDMA_IRQn);
+}
+#endif
+
 void HAL_I2S_MspDeInit(I2S_HandleTypeDef *i2sHandle)
 {
 	if (i2sHandle->Instance == SPI2)
@@ -1,30 +1,93 @@
 // main.c: Michael Haselberger
 // Description: Cortex M7 main entry point
 #include "main.h"
+#include "fx_setup.h"
+#include "library.h"
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 // ------------ CONSTANTS --------------------
-const uint32_t MAX24BIT = (1 << 24);
-const float32_t DOWNSCALE24BIT = 1.0f / MAX24BIT;
-const float32_t UPSCALE24BIT = (float32_t) MAX24BIT;
-
-// ------------ ENUMERATIONS ----------------- 
-enum callback_state
-{
-	NONE = 0,
-	HALFCPLT,
-	CPLT
-};
+// the codec words are 24 bit two's complement, right aligned in 32 bit. shifting them to the top of the word
+// makes them q31 values, which the CMSIS converters scale to [-1, 1) and back (with saturation)
+#define CODEC_SHIFT (8)
+// data cache maintenance of one DMA block (CACHED_DMA). a block is n frames of AUDIO_FRAME_WORDS words, a multiple of
+// the 32 byte cache line for every block size from MIN_BLOCK_SIZE, and the buffers are line aligned: no line is shared
+#if defined(CACHED_DMA)
+#define DMA_HALF_BYTES(n) ((n) * AUDIO_FRAME_WORDS * sizeof(uint32_t))
+#define DMA_INVALIDATE(addr, size) SCB_InvalidateDCache_by_Addr((uint32_t *)(addr), (size))
+#define DMA_CLEAN(addr, size) SCB_CleanDCache_by_Addr((uint32_t *)(addr), (size))
+#else
+#define DMA_INVALIDATE(addr, size)
+#define DMA_CLEAN(addr, size)
+#endif
+// the menu and the control pass set the effect parameters, which have one writer at a time. with RTOS they run in
+// tasks of their own (see rtos_lock)
+#if defined(RTOS)
+#define PARAMS_LOCK() rtos_lock()
+#define PARAMS_UNLOCK() rtos_unlock()
+#else
+#define PARAMS_LOCK()
+#define PARAMS_UNLOCK()
+#endif
 
 // ------------ FUNCTION PROTOTYPES -----------------
 void Error_Handler(void);
 static void MPU_conf(void);
+static void memory_init(void);
 void peripheral_init(void);
-static void rx_samples(enum ping_pong);
-static void tx_samples(enum ping_pong);
-static void pass_through(void);
-static void run_fx(uint8_t mode);
+#if !defined(CONTROL_M4)
+static void ui_init(void);
+#endif
+static void rx_samples(uint8_t b, uint32_t n);
+static void tx_samples(uint8_t b, uint32_t n);
+static void run_fx(uint8_t mode, uint32_t n);
+static void follow_input(uint32_t n);
+#if defined(TRUE_BYPASS)
+static bool bypass_active(void);
+#endif
+static void bypass_samples(uint8_t b, uint32_t n);
+static void init_effects(void);
+static void build_chain(void);
+static void reset_effects(void);
+static bool crossfade_fits(uint8_t from, uint8_t to);
+static bool admit(uint8_t fx);
+static void amp_library_pass(void);
+#if defined(REVERB_FDN)
+static void check_shimmer(void);
+#endif
+static void audio_stop(void);
+static uint8_t audio_start(void);
+static void audio_check_stream(void);
+static uint8_t audio_set_clock(uint32_t rate);
+#if defined(GOVERNOR)
+static void apply_governor_level(governor_level level);
+#endif
+#if defined(POWER_SAVING)
+static void apply_core_clock(void);
+#endif
 static void update_menu(uint16_t count, uint8_t menu_depth);
+static void ui_pass(void);
+static void control_pass(void);
+static void schedule_audio(uint8_t b);
+static void fxloop_block(uint8_t p, uint32_t n);
+#if defined(LATENCY_PROBE)
+static void latency_next(void);
+static void latency_pass(void);
+#endif
+#if defined(MIDI)
+static void apply_midi_events(uint32_t captured, uint32_t n);
+#endif
+#if (DMA_BLOCKS > 2)
+static uint8_t dma_ring_start(void);
+static void dma_ring_m0_complete(DMA_HandleTypeDef *hdma);
+static void dma_ring_m1_complete(DMA_HandleTypeDef *hdma);
+static void dma_ring_error(DMA_HandleTypeDef *hdma);
+#endif
+#if defined(MDMA_TRANSFER)
+static void rx_transfer(uint8_t b);
+static void rx_transfer_complete(MDMA_HandleTypeDef *hmdma);
+#endif
 // ------------ STATIC VARIABLES -----------------
 
 
@@ -49,36 +112,169 @@ static uint32_t tx_buffer[SAMPLE_BLOCK] = {0};
  * Even after taking all this into account, cache-coherency operations (clean and invalidate) are required before and every CPU buffer access.
 */
 
-// DMA buffers in non-TCM RAM region. 32-byte aligned (cache width)
-uint32_t rx_buffer[DMA_BUFFER_SIZE] __attribute__((aligned(32))) __attribute__((section(".dma_buffer")));
-uint32_t tx_buffer[DMA_BUFFER_SIZE] __attribute__((aligned(32))) __attribute__((section(".dma_buffer")));
+// DMA buffers in non-TCM RAM region. 32-byte aligned (cache width). the section and the base of the MPU region follow
+// DMA_PLACEMENT
+#if (DMA_PLACEMENT == DMA_PLACEMENT_D2)
+#define DMA_SECTION ".dma_buffer_d2"
+#define DMA_REGION_BASE D2_AHBSRAM_BASE
+#elif (DMA_PLACEMENT == DMA_PLACEMENT_D3)
+#define DMA_SECTION ".dma_buffer_d3"
+#define DMA_REGION_BASE (D3_SRAM_BASE + 0xE000UL)
+#else
+#define DMA_SECTION ".dma_buffer"
+#define DMA_REGION_BASE D1_AXISRAM_BASE
+#endif
+uint32_t rx_buffer[DMA_BUFFER_SIZE] __attribute__((aligned(32))) __attribute__((section(DMA_SECTION)));
+uint32_t tx_buffer[DMA_BUFFER_SIZE] __attribute__((aligned(32))) __attribute__((section(DMA_SECTION)));
 
 // in/out buffers
-// codec samples in stereo, but pedal is going to be used in mono exclusively (audio jacks and instrument cables are mono)
-// so every second sample isn't needed -> half the buffer size will suffice for calculations
-// guitar signal is mono - right channel will be ignored for now. since I'm using double buffering,
-// buffer size can effectively be a quarter of rx/tx buffers
-float32_t left_in[PING_PONG_BUFFER_SIZE] __attribute__((aligned(32)));
-float32_t left_out[PING_PONG_BUFFER_SIZE] __attribute__((aligned(32)));
+// codec samples in stereo, but the pedal is mostly used in mono (audio jacks and instrument cables are mono)
+// so with AUDIO_CHANNELS 1 every second sample isn't needed -> half the buffer size will suffice for calculations.
+// since I'm using double buffering, buffer size can effectively be a quarter of rx/tx buffers.
+// with AUDIO_CHANNELS 2 the right channel gets its own buffers (planar, not interleaved), so all
+// block functions work on contiguous samples of one channel
+// every effect reads and writes them, so they are in DTCM (TCM_PLACEMENT)
+// sample_t: q31 with SAMPLE_Q31, float otherwise
+sample_t left_in[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+sample_t left_out[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+#if (AUDIO_CHANNELS == 2)
+sample_t right_in[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+sample_t right_out[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+static sample_t *const channel_in[AUDIO_CHANNELS] = { left_in, right_in };
+static sample_t *const channel_out[AUDIO_CHANNELS] = { left_out, right_out };
+#else
+static sample_t *const channel_in[AUDIO_CHANNELS] = { left_in };
+static sample_t *const channel_out[AUDIO_CHANNELS] = { left_out };
+#endif
+// buffers passed to the *_init functions of fx_lib. the chain adapters point the handles to the node buffers with
+// every block, so with SAMPLE_Q31 the init buffers are only placeholders and never read as float
+#define FX_BUFFER(b) ((float32_t *)(b))
 
 float32_t volume = 0.5f;
 
+#if defined(SIDECHAIN)
+// the right input as float, the key of gate and compressor. converted with the left input in rx_samples
+static float32_t sidechain_in[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+#define RX_CHANNELS (AUDIO_CHANNELS + 1)
+#else
+#define RX_CHANNELS (AUDIO_CHANNELS)
+#endif
+
+#if defined(MDMA_TRANSFER)
+// the MDMA copies the channels of a DMA half into (rx) and out of (tx) these rows, the CPU never reads the DMA buffers.
+// SIDECHAIN: the row behind the processed channel is the right input
+static q31_t rx_stage[RX_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+static q31_t tx_stage[AUDIO_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+// block the running rx transfer belongs to
+static volatile uint8_t rx_block = 0;
+#else
+#if !defined(SAMPLE_Q31)
+// q31 copy of one channel between the DMA buffers and the float in/out buffers
+static q31_t conversion_buffer[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+#endif
+#if defined(SIDECHAIN)
+static q31_t sidechain_words[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+#endif
+#endif
+
 #endif
 
-// flags for DMA callback
-static volatile uint8_t callback_state = NONE;
+// queue of the completed DMA blocks. the DMA callbacks count the received blocks and note the block index in the slot
+// of the count, audio_process counts the processed ones. both only grow, the difference is the backlog
+static volatile uint32_t blocks_received = 0;
+static volatile uint32_t blocks_processed = 0;
+static volatile uint8_t block_index[DMA_BLOCKS];
+#if (DMA_BLOCKS > 2)
+// block the DMA fills next, the one after it is already in the other memory register
+static uint8_t ring_block = 0;
+#endif
+// overruns and stream errors, see audio_stats_t
+static audio_stats_t audio_stats;
+static audio_admission_t admission;
+// set by the error callback (DMA interrupt), the stream is restarted by the main loop (audio_check_stream)
+static volatile uint8_t restart_pending = 0;
 static volatile uint8_t mode = FXNONE;
+// samples per channel and DMA block, see audio_set_block_size
+static volatile uint16_t block_size = PING_PONG_BUFFER_SIZE;
+// see defines_and_constants.h and audio_set_sample_rate
+uint32_t sample_rate = AUDIO_SAMPLE_RATE;
+
+// time of the last press. the tap tempo needs the time of the tap, not of the menu pass that handles it
+volatile uint32_t btn_tick = 0;
+#if defined(MIDI)
+// last program change seen by the audio processing, -1 if none. the preset is recalled by the main loop (flash, LCD)
+static volatile int16_t midi_program = -1;
+// value of the last MIDI_CC_RING_MOD_DEPTH, -1 if none. its parameter block has the main loop as the one writer, which
+// publishes the blend as the menu does (control_pass)
+static volatile int16_t midi_ring_mod_blend = -1;
+// DWT cycle count when each queued block was complete, the time base of the MIDI events
+static volatile uint32_t block_time[DMA_BLOCKS];
+#endif
 
-// flag for GPIO menu button callback
-static volatile uint8_t btn_pressed = 0;
 
+#if defined(FXLOOP_SLOT)
+// the send channels of the transmit blocks are all zero (no loop wrote them since they were cleared)
+static bool fxloop_silent = true;
+#endif
+#if defined(MOD_MATRIX)
+// sources routed to the effect parameters (the handles of fx_setup.c), evaluated before the chain
+mod_matrix_t mod_matrix DTCM_BSS;
+#endif
+// block envelope of the unprocessed input, the one detector pass per block for every user: the envelope source of the
+// mod matrix and the ducking of the delay read input_level
+#define INPUT_ENVELOPE_ATTACK_MS (5.0f)
+#define INPUT_ENVELOPE_RELEASE_MS (150.0f)
+static envelope_t input_envelope DTCM_BSS;
+static volatile float32_t input_level = 0.0f;
+#if defined(LOOPER)
+// behind the chain, on in every mode. the MDMA stages the loop blocks into the handles, so they are in DTCM
+// (LOOPER_ADPCM: the loops are in the arenas, the handles are read every block)
+looper_handle_t looper_handle[AUDIO_CHANNELS] DTCM_BSS;
+#endif
 
-// effect handles
-delay_handle_t delay_handle;
-tremolo_handle_t tremolo_handle;
-overdrive_handle_t overdrive_handle;
-fuzz_handle_t fuzz_handle;
-ring_mod_handle_t ring_mod_handle;
+// all effects in processing order (see build_chain) and the switch between the effects selected in the menu
+static fx_chain_t chain;
+static fx_transition_t transition;
+// the audio runs from the first DMA block on, the input passes through (bypass_samples) until main has initialized
+// the effects and built the chain
+static volatile bool booting DTCM_INIT = true;
+// highest load with two effects running in parallel during a crossfade, in 0.1 % of the block budget
+#define TRANSITION_MAX_LOAD (900)
+// highest predicted load of an effect before it is switched on (admit), in 0.1 % of the block budget
+#define ADMISSION_MAX_LOAD (900)
+#if defined(REVERB_FDN)
+// highest load of the reverb with the octave shifter of the shimmer in its feedback, in 0.1 % of the block budget, and
+// the cycles per sample of the shifter assumed until the pitch shifter was measured
+#define SHIMMER_MAX_LOAD (900)
+#define SHIMMER_CYCLES_PER_SAMPLE (48)
+#endif
+// library image in flash (library.h), opened by the first amp model request
+static library_t library;
+static bool library_ready = false;
+// amp model selected in the menu (audio_select_amp, 0: none) and whether it still has to be loaded. the load in progress
+// writes amp_target (NULL while none runs): the model of the audio path, or a copy from the D1 arena while the amp runs,
+// which is amp_staged until every channel took it
+static uint8_t amp_selected = 0;
+static bool amp_requested = false;
+static library_loader_t amp_loader;
+static amp_model_t *amp_target = NULL;
+static amp_model_t *amp_staged = NULL;
+#if defined(GOVERNOR)
+static governor_t governor;
+#endif
+#if defined(POWER_SAVING)
+static power_t power;
+#endif
+#if defined(PROFILER)
+// tick of the last profiler report
+static uint32_t last_report;
+#endif
+#if defined(LATENCY_PROBE)
+// block size sweep of the latency page (audio_latency_start): two measurements per block size, impulse first. -1 while
+// no sweep runs. the block size the sweep started with is set again at the end
+static int8_t latency_step = -1;
+static uint16_t latency_restore = PING_PONG_BUFFER_SIZE;
+#endif
 
 // Sample filter taps located in fx_lib.c
 extern float32_t filter_taps[NUM_TAPS];
@@ -89,9 +285,22 @@ extern float32_t filter_taps[NUM_TAPS];
 
 int main(void)
 {	
+	// code and data of the tightly coupled memories, before anything uses them
+	memory_init();
+#if defined(STACK_MONITOR)
+	// paint the main stack while nothing else uses it
+	stack_monitor_init();
+#endif
+
 	// Enable the CPU Cache
 	SCB_EnableICache();
 	SCB_EnableDCache();
+#if defined(DENORMAL_FLUSH)
+	// flush-to-zero and default NaN. FPDSCR is the FPSCR every exception handler (PendSV, DMA callbacks) and every new
+	// FPU context (RTOS tasks) starts with, the main loop gets it here
+	FPU->FPDSCR |= FPU_FPDSCR_FZ_Msk | FPU_FPDSCR_DN_Msk;
+	__set_FPSCR(__get_FPSCR() | FPU_FPDSCR_FZ_Msk | FPU_FPDSCR_DN_Msk);
+#endif
 
 	/*  HAL_Init description from STM32 example code:
      
@@ -106,11 +315,15 @@ int main(void)
     */
 	HAL_Init();
 
-	// configure the system clock for 480 MHz
+	// configure the system clock for 240 MHz (CORE_CLOCK_DEFAULT), power.h switches between the profiles of rcc.c
 	SystemClock_Config();
 	// configure SPI1 and SPI2 clocks for 48 KHz I2S
 	// (real clock frequency is 0.01% below target 48KHz with this configuration)
 	PeriphCommonClock_Config();
+#if defined(USB_AUDIO)
+	// 48 MHz USB clock from the HSI48, trimmed to the SOFs of the host
+	USBClock_Config();
+#endif
 
 #if defined(CHECK_CLK)
 	// Check clock frequencies
@@ -120,19 +333,44 @@ int main(void)
 #endif
 	
 #if defined(BOOTCM4)
-	// Enables Cortex M4 (disabled via option bytes). 
-	HAL_RCCEx_EnableBootCore(RCC_BOOT_C2);
+	// mailbox has to be ready before the M4 starts
+	dual_core_init();
 #endif	
 	
-	// Initialize peripherals
+	// Initialize the audio peripherals. the controls and the LCD follow once the audio runs (ui_init)
 	peripheral_init();
-	HAL_Delay(50);
+
+#if defined(BENCHMARK)
+	// benchmark firmware: the kernels are measured once instead of processing audio, the table is repeated for late listeners
+	benchmark_run();
+	while (1)
+	{
+		benchmark_report();
+		HAL_Delay(5000);
+	}
+#endif
 
 	//volatile int fpu_check = __FPU_USED;
 	
 #if defined(DMA)
-	
-	HAL_I2SEx_TransmitReceive_DMA(&hi2s2, (uint16_t *)tx_buffer, (uint16_t *)rx_buffer, DMA_BUFFER_SIZE);
+#if defined(MDMA_TRANSFER)
+	MX_MDMA_Init(block_size);
+	hmdma_rx.XferCpltCallback = rx_transfer_complete;
+#endif
+#if defined(SAI_TDM)
+	sai_start(tx_buffer, rx_buffer, block_size);
+#else
+	HAL_I2SEx_TransmitReceive_DMA(&hi2s2, (uint16_t *)tx_buffer, (uint16_t *)rx_buffer, block_size << 2);
+#endif
+#endif
+	// from here on the input passes through (booting) while everything else comes up between the blocks
+#if defined(BOOTCM4)
+	// Enables Cortex M4 (disabled via option bytes) and waits for its handshake. without one, the M7 computes the
+	// reverb tail and the amp post-filter itself
+	dual_core_boot();
+#endif
+#if !defined(CONTROL_M4)
+	ui_init();
 #endif
 	/*
 	 *https://community.st.com/s/question/0D50X0000C0yPO3/when-do-we-need-to-call-clean-and-invalidate-d-cache
@@ -143,46 +381,92 @@ int main(void)
 
 		-- pa
 	 **/
-	delay_init(&delay_handle, left_in, left_out, 400, 0.4, 0.4);
-	tremolo_init(&tremolo_handle, left_in, left_out, 0.7f, 0.8f);
+	init_effects();
 	init_fir_filter(filter_taps);
+	build_chain();
+#if defined(LOOPER)
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		looper_init(&looper_handle[ch], ch, 1.0f);
+	}
+#endif
+#if defined(TUNER)
+	tuner_init();
+#endif
+#if defined(TELEMETRY)
+	telemetry_init();
+#endif
+#if defined(CAPTURE)
+	capture_init(sample_rate);
+#endif
+#if defined(LATENCY_PROBE)
+	latency_probe_init();
+#endif
+#if defined(USB_AUDIO)
+	// connects to the host: the ring is only filled once the host starts streaming
+	usb_audio_init();
+#endif
+#if defined(MIDI)
+	midi_init();
+#endif
+#if defined(HOST_LINK)
+	host_link_init();
+#endif
+#if defined(MOD_MATRIX)
+	mod_matrix_init(&mod_matrix);
+#endif
+#if defined(EXPRESSION_PEDAL)
+	expression_init();
+#endif
 
 	mode = FXNONE;
+#if !defined(CONTROL_M4)
+	// the preset saved last replaces the init values above. with CONTROL_M4 the M4 recalls it, its values arrive as
+	// commands with the first passes of the loop
+	preset_init();
+	uint8_t slot;
+	if (preset_latest(&slot) == 0)
+	{
+		apply_preset(slot, (uint8_t *)&mode);
+	}
+#endif
+	// effects and chain are complete: the next block goes through the chain
+	__DMB();
+	booting = false;
+
+#if defined(PROFILER)
+	// one block lasts block_size sample periods
+	profiler_init(block_size * (SystemCoreClock / sample_rate));
+	last_report = HAL_GetTick();
+#endif
+#if defined(TRACE)
+	trace_init();
+#endif
+#if defined(GOVERNOR)
+	governor_init(&governor, audio_stats.overruns, HAL_GetTick());
+#endif
+#if defined(POWER_SAVING)
+	power_init(&power, audio_stats.overruns, HAL_GetTick());
+#endif
 
 
 	
+	// the main loop sleeps between interrupts (__WFI below). a debugger would lose the core while it sleeps, the clocks
+	// of the D1 domain stay on only while one is attached
+	if (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk)
+		DBGMCU->CR |= DBGMCU_CR_DBG_SLEEPD1;
+
+#if defined(RTOS)
+	// audio, control and UI tasks (rtos.h) instead of PendSV and the loop below
+	rtos_start(audio_process, control_pass, ui_pass);
+#endif
+
+	// audio processing runs in PendSV, triggered by the DMA callbacks (see audio_process).
+	// the menu is a background task: blocking LCD/I2C transfers can't delay the audio deadline anymore
 	while (1)
     {		
-		switch (callback_state)
-		{
-			case NONE:
-				display_menu(btn_pressed, &mode);
-				break;
-			case HALFCPLT:
-				//SCB_InvalidateDCache_by_Addr((uint32_t *)rx_buffer, PING_PONG_BUFFER_SIZE);
-				rx_samples(PING);
-				run_fx(mode);
-				tx_samples(PING);
-				//SCB_CleanDCache_by_Addr((uint32_t *)tx_buffer, PING_PONG_BUFFER_SIZE);
-				callback_state = NONE;
-#if defined(CHECK_TIMELINESS)
-				GPIOB->ODR &= ~GPIO_PIN_8;
-#endif
-				break;
-			case CPLT:
-				//SCB_CleanDCache_by_Addr((uint32_t *)(rx_buffer + PING_PONG_BUFFER_SIZE * sizeof(tx_buffer[0])), PING_PONG_BUFFER_SIZE);
-				rx_samples(PONG);
-				run_fx(mode);
-				tx_samples(PONG);
-				//SCB_CleanDCache_by_Addr((uint32_t *)(tx_buffer + PING_PONG_BUFFER_SIZE * sizeof(tx_buffer[0])), PING_PONG_BUFFER_SIZE);
-				callback_state = NONE;
-#if defined(CHECK_TIMELINESS)
-				GPIOB->ODR &= ~GPIO_PIN_9;
-#endif
-				break;
-			default:
-				Error_Handler();
-		}
+		ui_pass();
+		control_pass();
 
 #if defined(DMA_DEBUG)
  		
@@ -190,157 +474,2061 @@ int main(void)
 		uint32_t err_rx_dma = HAL_DMA_GetError(&hdma_i2s2_rx);
 		uint32_t err_tx_dma = HAL_DMA_GetError(&hdma_i2s2_tx);
 
-		if (err_i2s | err_tx_dma | err_rx_dma)
+		// only with a debugger attached, without one the breakpoint would fault the CPU
+		if ((err_i2s | err_tx_dma | err_rx_dma) && (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk))
 			__asm("bkpt 255");
 		#endif // DMA_DEBUG
 	#if defined(POLLING_MODE) 
 		
 			HAL_I2S_Receive(&hi2s2, (uint16_t*)rx_buffer, SAMPLE_BLOCK, 1000);
 			HAL_I2S_Transmit(&hi2s2, (uint16_t *)rx_buffer, SAMPLE_BLOCK, 1000);
+	#else
+		// sleep until the next interrupt: a DMA block (and its processing in PendSV), a control, the LCD transfer or
+		// the 1 ms SysTick, which bounds the time to the next pass for everything polled above
+		__WFI();
 	#endif // POLLING_MODE
 	}
 }
 
-void HAL_I2SEx_TxRxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
+/******************************************************************************
+* Function Name: ui_pass
+*******************************************************************************
+* Summary:
+*  User interface part of the main loop: the menu with the control events since the last pass
+*  (with CONTROL_M4 the commands of the menu on the M4), the tuner and telemetry analysis and
+*  the profiler report. With RTOS one pass of the UI task,
+*  the menu holds the parameter lock against the control task (see rtos_lock).
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void ui_pass(void)
 {
-	callback_state = HALFCPLT;
-#if defined(CHECK_TIMELINESS)
-	GPIOB->ODR |= GPIO_PIN_8;
+	PARAMS_LOCK();
+#if defined(CONTROL_M4)
+	// the menu runs on the M4: its commands, then the status for its pages
+	ui_serve((uint8_t *)&mode);
+#else
+	// encoder and button events of the interrupts since the last pass
+	display_menu(ui_take_events(), (uint8_t *)&mode);
+#endif
+	PARAMS_UNLOCK();
+#if defined(TUNER)
+	// pitch of the last input frame, while the tuner page is shown
+	tuner_process();
+#endif
+#if defined(TELEMETRY)
+	// levels of the last block copied from the output
+	telemetry_set_latency(audio_get_latency());
+	if (telemetry_process())
+		telemetry_report();
+#endif
+#if defined(LATENCY_PROBE)
+	// the next measurement of the latency page, after the last one is analyzed
+	latency_pass();
+#endif
+
+#if defined(PROFILER)
+	// load report over SWO once per second
+	if ((HAL_GetTick() - last_report) >= 1000)
+	{
+		last_report = HAL_GetTick();
+		profiler_report();
+	}
+#endif
+#if defined(STACK_MONITOR)
+	// high water marks of the stacks once per second
+	if (stack_monitor_process(HAL_GetTick()))
+		stack_monitor_report();
 #endif
 }
-void HAL_I2SEx_TxRxCpltCallback(I2S_HandleTypeDef *hi2s)
+
+/******************************************************************************
+* Function Name: control_pass
+*******************************************************************************
+* Summary:
+*  Control part of the main loop: MIDI program changes, the transition to the selected mode,
+*  the stream restart after an error and the core clock and governor decisions. With RTOS one
+*  pass of the control task, under the parameter lock as a whole.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void control_pass(void)
 {
-	callback_state = CPLT;
-#if defined(CHECK_TIMELINESS)
-	GPIOB->ODR |= GPIO_PIN_9;
+	TRACE_EVENT(TRACE_CONTROL_START);
+	PARAMS_LOCK();
+#if defined(MIDI)
+	// program change: recall the preset as the menu does, before the mode it stores is requested below
+	__disable_irq();
+	const int16_t program = midi_program;
+	const int16_t ring_mod_blend = midi_ring_mod_blend;
+	midi_program = -1;
+	midi_ring_mod_blend = -1;
+	__enable_irq();
+	// the ring modulator parameters are only written through their parameter block (see apply_midi_events)
+	if (ring_mod_blend >= 0)
+	{
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			ring_mod_update(&ring_mod_handle[ch], DEPTH, NO_CHANGE, (float32_t)ring_mod_blend / 127.0f);
+		}
+	}
+	if (program >= 0)
+	{
+		apply_preset((uint8_t)(program % PRESET_SLOTS), (uint8_t *)&mode);
+	}
 #endif
-//	memcpy((tx_buffer + (SAMPLE_BLOCK >> 1) * sizeof(uint32_t)), (rx_buffer + (SAMPLE_BLOCK >> 1) * sizeof(uint32_t)), (SAMPLE_BLOCK >> 1));
+#if defined(HOST_LINK)
+	// requests of the host: values, commands and the mode as the menu sets them, the mode is requested below
+	host_link_process((uint8_t *)&mode);
+#endif
+#if defined(POWER_SAVING)
+	// a crossfade runs two effects at once: fastest profile before crossfade_fits checks the load
+	if ((mode != transition.request) && power_boost(&power, HAL_GetTick()))
+	{
+		apply_core_clock();
+	}
+#endif
+	// the amp model of the menu or a preset, chunk by chunk
+	amp_library_pass();
+	// an effect predicted over the deadline or without room in the arenas isn't switched on
+	if ((mode != transition.request) && !admit(mode))
+	{
+		mode = transition.request;
+	}
+	// the audio interrupt switches over with a crossfade (see fx_transition_process)
+	if ((mode != transition.request) && fx_transition_request(&transition, &chain, mode, crossfade_fits(transition.to, mode)))
+	{
+		// no memory for the effect: stay with the current one
+		mode = transition.request;
+	}
+	// give the buffers of effects that are neither selected nor fading back to the arenas
+	fx_transition_reclaim(&transition, &chain);
+	// keep the two stages of a pipelined chain balanced as effects come and go
+	fx_chain_balance(&chain);
+#if defined(REVERB_FDN)
+	// the shimmer joins the reverb once the shifter fits into the budget next to the network
+	check_shimmer();
+#endif
+	// restart the stream after a DMA or I2S error
+	audio_check_stream();
+#if defined(POWER_SAVING)
+	// slowest core clock profile that fits the chain. a faster clock answers an overload before the governor does
+#if defined(GOVERNOR)
+	if (power_update(&power, audio_stats.overruns, HAL_GetTick(), (governor.level == GOVERNOR_FULL) ? true : false))
+#else
+	if (power_update(&power, audio_stats.overruns, HAL_GetTick(), true))
+#endif
+	{
+		apply_core_clock();
+	}
+#endif
+#if defined(GOVERNOR)
+	// degrade the effects before the audio misses its deadline, restore them once there's room again
+	if (governor_update(&governor, audio_stats.overruns, HAL_GetTick()))
+	{
+		apply_governor_level(governor.level);
+	}
+#endif
+	PARAMS_UNLOCK();
+	TRACE_EVENT(TRACE_CONTROL_END);
 }
 
-// EXTI Line9 External Interrupt ISR Handler CallBack
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+/******************************************************************************
+* Function Name: schedule_audio
+*******************************************************************************
+* Summary:
+*  Queue a block of the DMA buffers and pend the PendSV exception (with RTOS: wake the audio
+*  task), which processes it as soon as the DMA interrupt returns. If DMA_BLOCKS - 1 blocks are still waiting or in process,
+*  the deadline of the oldest was missed (the DMA is already overwriting it) and the overrun
+*  is counted.
+*
+* Parameters:
+*  1. uint8_t b						- Block of the DMA buffers that was just completed (PING/PONG
+*									  with DMA_BLOCKS 2).
+* Return:
+*  None.
+*
+******************************************************************************/
+static void schedule_audio(uint8_t b)
 {
-	if (GPIO_Pin == GPIO_PIN_9) // If The INT Source Is EXTI Line9 (A9 Pin)
+	const uint32_t received = blocks_received;
+	if ((received - blocks_processed) >= (DMA_BLOCKS - 1))
 	{
-		btn_pressed = 1;
+		audio_stats.overruns++;
 	}
+	block_index[received % DMA_BLOCKS] = b;
+	TRACE_EVENT(TRACE_BLOCK_READY);
+#if defined(MIDI)
+	block_time[received % DMA_BLOCKS] = DWT->CYCCNT;
+#endif
+	blocks_received = received + 1;
+#if defined(RTOS)
+	rtos_audio_from_isr();
+#else
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#endif
 }
 
-// since the audio jacks are mono, but the codec samples for stereo, both left and right channels will have identical information.
-// every second sample can be skipped to reduce computational load
-static void rx_samples(enum ping_pong p)
+/******************************************************************************
+* Function Name: fxloop_block
+*******************************************************************************
+* Summary:
+*  Point the effects loop to its channel of a DMA block before the block is processed. If the
+*  loop didn't send during the block before (another effect, the bypass), the send channel of
+*  every transmit block is cleared once: the DMA would repeat the last send forever.
+*
+* Parameters:
+*  1. uint8_t p						- Block of the DMA buffers.
+*  2. uint32_t n					- Samples per channel (block size).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void fxloop_block(uint8_t p, uint32_t n)
 {
-	// offset is either 0 or half the buffer size (= amount of samples)
-	uint16_t offset = p * SAMPLES;
-	uint16_t end = SAMPLES + offset;
-
-	for (int i = 0, j = offset; j < end; ++i, j=j+2)
+#if defined(FXLOOP_SLOT)
+	bool sent = false;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		sent |= fxloop_take_sent(&fxloop_handle[ch]);
+		fxloop_set_block(&fxloop_handle[ch], &tx_buffer[p * n * AUDIO_FRAME_WORDS + FXLOOP_SLOT + ch],
+			&rx_buffer[p * n * AUDIO_FRAME_WORDS + FXLOOP_SLOT + ch]);
+	}
+	if (sent)
+	{
+		fxloop_silent = false;
+	}
+	else if (!fxloop_silent)
 	{
-		left_in[i] = (float32_t)rx_buffer[j];
+		for (uint32_t i = 0; i < DMA_BUFFER_SIZE; i += AUDIO_FRAME_WORDS)
+		{
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				tx_buffer[i + FXLOOP_SLOT + ch] = 0;
+			}
+		}
+		DMA_CLEAN(tx_buffer, sizeof(tx_buffer));
+		fxloop_silent = true;
 	}
-	//__asm("nop");
+#else
+	(void)p;
+	(void)n;
+#endif
 }
-static void tx_samples(enum ping_pong p)
+
+/******************************************************************************
+* Function Name: audio_process
+*******************************************************************************
+* Summary:
+*  Process the queued DMA blocks in order. Blocks the DMA has overwritten already (overrun) are
+*  skipped, processing continues with the oldest block that is still intact. Called from
+*  PendSV_Handler, which has a lower priority than the DMA interrupts and a higher priority
+*  than everything the user interface uses. With RTOS called by the audio task, the highest
+*  priority task (interrupts still preempt it).
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void audio_process(void)
 {
-	// offset is either 0 or half the buffer size (= amount of samples)
-	uint16_t offset = p * SAMPLES;
-	uint16_t end = SAMPLES + offset;
+	const uint32_t n = block_size;
+	uint32_t received;
 
-	for (int i = 0, j = offset; j < end; ++i, j = j + 2)
-	{		
-		tx_buffer[j] = (uint32_t)left_out[i];
-//		// check if any bits above the 24th bit are set (= overflow) if so, throw breakpoint trap
-//		if (tx_buffer[i] & 0xFF00000000)
-//			__asm("bkpt 255");
-		
-//		__asm("nop");
+#if defined(DENORMAL_FLUSH)
+	// the default of PendSV already (FPDSCR), the audio task of RTOS may have been created with another FPSCR. same bit
+	// positions in FPSCR and FPDSCR
+	__set_FPSCR(__get_FPSCR() | FPU_FPDSCR_FZ_Msk | FPU_FPDSCR_DN_Msk);
+#endif
+#if defined(STACK_MONITOR)
+	stack_monitor_enter();
+#endif
+	while ((received = blocks_received) != blocks_processed)
+	{
+		if ((received - blocks_processed) > (DMA_BLOCKS - 1))
+		{
+			// the older blocks were overwritten while this one waited
+			blocks_processed = received - (DMA_BLOCKS - 1);
+			TRACE_EVENT(TRACE_BLOCK_SKIP);
+		}
+		const uint8_t p = block_index[blocks_processed % DMA_BLOCKS];
+		if (booting)
+		{
+			// nothing is initialized yet, the input is copied to the output
+			bypass_samples(p, n);
+			blocks_processed++;
+			continue;
+		}
+		TRACE_EVENT(TRACE_BLOCK_START);
+		fxloop_block(p, n);
+#if defined(MIDI)
+		// events received while the block was captured land at their sample of the block
+		apply_midi_events(block_time[blocks_processed % DMA_BLOCKS], n);
+#endif
+
+#if defined(LATENCY_PROBE)
+		if (latency_probe_active())
+		{
+			// the probe replaces the chain on the left channel, the others stay silent. the number of the block tells
+			// the probe about blocks skipped above
+			rx_samples(p, n);
+			latency_probe_feed(left_in, left_out, blocks_processed, n);
+#if (AUDIO_CHANNELS == 2)
+			memset(right_out, 0, n * sizeof(sample_t));
+#endif
+			tx_samples(p, n);
+			TRACE_EVENT(TRACE_BLOCK_END);
+			blocks_processed++;
+			continue;
+		}
+#endif
+
+#if defined(TRUE_BYPASS)
+		if (bypass_active())
+		{
+#if defined(PROFILER)
+			const uint32_t t0 = profiler_now();
+			bypass_samples(p, n);
+			profiler_record(FXNONE, PROFILE_TOTAL, profiler_now() - t0);
+#else
+			bypass_samples(p, n);
+#endif
+			TRACE_EVENT(TRACE_BLOCK_END);
+			blocks_processed++;
+			continue;
+		}
+#endif
+
+#if defined(PROFILER)
+		// mode can be changed by the menu in between, the block is accounted to the mode it was processed with
+		const uint8_t m = mode;
+		const uint32_t t0 = profiler_now();
+		rx_samples(p, n);
+		const uint32_t t1 = profiler_now();
+		run_fx(m, n);
+		const uint32_t t2 = profiler_now();
+		tx_samples(p, n);
+		const uint32_t t3 = profiler_now();
+		profiler_count_subnormals(m);
+
+		profiler_record(m, PROFILE_RX, t1 - t0);
+		profiler_record(m, PROFILE_FX, t2 - t1);
+		profiler_record(m, PROFILE_TX, t3 - t2);
+		profiler_record(m, PROFILE_TOTAL, t3 - t0);
+#if defined(CAPTURE)
+		const uint32_t cycles[3] = { t1 - t0, t2 - t1, t3 - t2 };
+		capture_commit(blocks_processed, m, t0, cycles, audio_stats.overruns + audio_stats.dma_errors + audio_stats.i2s_errors);
+#endif
+#else
+		rx_samples(p, n);
+		run_fx(mode, n);
+		tx_samples(p, n);
+#endif
+
+#if defined(CHECK_TIMELINESS)
+		GPIOB->ODR &= (p & 1) ? ~GPIO_PIN_9 : ~GPIO_PIN_8;
+#endif
+		TRACE_EVENT(TRACE_BLOCK_END);
+		blocks_processed++;
 	}
+#if defined(STACK_MONITOR)
+	stack_monitor_leave();
+#endif
 }
 
-static void run_fx(uint8_t mode)
+#if defined(MIDI)
+/******************************************************************************
+* Function Name: apply_midi_events
+*******************************************************************************
+* Summary:
+*  Take the MIDI events of a block out of the queue. The block was captured during the n sample
+*  periods before it was complete, an event from that time is placed at the same sample of the
+*  block: the smoother of its parameter is given the new target from that sample on
+*  (smooth_param_schedule), so the audio lags the controller by a constant time instead of up to
+*  a block. The *_update function of the parameter stores the same target (see the MIDI_CC_*
+*  assignments in midi.h). Events from before the block (received late) apply at its first
+*  sample, events after it stay queued for the next block. The cost is a few scalar operations
+*  per event. Program changes and the ring modulator blend (a parameter block, written by the
+*  main loop only) are handed to the main loop. Called by audio_process only, the
+*  consumer side of the queue.
+*
+* Parameters:
+*  1. uint32_t captured				- DWT cycle count when the block was complete (schedule_audio).
+*  2. uint32_t n					- Samples per channel of the block.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void apply_midi_events(uint32_t captured, uint32_t n)
 {
-	switch (mode)
+	const uint32_t cycles_per_sample = SystemCoreClock / sample_rate;
+	const uint32_t start = captured - n * cycles_per_sample;
+	midi_event_t event;
+	while (midi_peek(&event))
 	{
-		case FXDELAY:
-			run_delay(&delay_handle);
-			break;
-		case FXFILTER:
-			run_fir_filter(left_in, left_out);
-			break;
-		case FXTREMOLO:
-			run_tremolo(&tremolo_handle);
-		case FXFUZZ:
-			run_fuzz(&fuzz_handle);
-			break;
-		case FXOVERDRIVE:
-			run_overdrive(&overdrive_handle);
-			break;
-		case FXRINGMOD:
-			run_ring_mod(&ring_mod_handle);
+		// signed: the counter wraps every few seconds
+		const int32_t since_start = (int32_t)(event.time - start);
+		if (since_start >= (int32_t)(n * cycles_per_sample))
+		{
 			break;
-		default:
-			pass_through();
+		}
+		midi_release();
+		const uint32_t offset = (since_start > 0) ? (uint32_t)since_start / cycles_per_sample : 0;
+
+		if (event.type == MIDI_PROGRAM_CHANGE)
+		{
+			midi_program = event.number;
+			continue;
+		}
+
+		const float32_t value = (float32_t)event.value / 127.0f;
+		switch (event.number)
+		{
+		case MIDI_CC_REVERB_BLEND:
+			reverb_update(&reverb_handle, REVERB_BLEND, value);
+			smooth_param_schedule(&reverb_handle.blend_smooth, value, offset);
+			continue;
+		case MIDI_CC_CAB_MIX:
+			cab_update(&cab_handle, CAB_MIX, value);
+			smooth_param_schedule(&cab_handle.mix_smooth, value, offset);
+			continue;
+#if defined(MOD_MATRIX)
+		// one value per block, the matrix is evaluated at control rate
+		case MIDI_CC_MOD_WHEEL:
+			mod_matrix_set_source(&mod_matrix, MOD_CC, value);
+			continue;
+		case MIDI_CC_EXPRESSION:
+			mod_matrix_set_source(&mod_matrix, MOD_EXPRESSION, value);
+			continue;
+#endif
+		}
+
+		// every channel has its own effect handles, they share the same parameters (see confirm_value)
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			float32_t target = value;
+			smooth_param_t *smoother = NULL;
+			switch (event.number)
+			{
+			case MIDI_CC_DELAY_FEEDBACK:
+				delay_update(&delay_handle[ch], FEEDBACK, target);
+				smoother = &delay_handle[ch].feedback_smooth;
+				break;
+			case MIDI_CC_DELAY_BLEND:
+				delay_update(&delay_handle[ch], BLEND, target);
+				smoother = &delay_handle[ch].blend_smooth;
+				break;
+			case MIDI_CC_FUZZ_MIX:
+				// the mix has to stay below 1
+				target = (float32_t)event.value / 128.0f;
+				fuzz_update(&fuzz_handle[ch], MIX, target);
+				smoother = &fuzz_handle[ch].mix_smooth;
+				break;
+			case MIDI_CC_TREMOLO_DEPTH:
+				tremolo_update(&tremolo_handle[ch], DEPTH, target);
+				smoother = &tremolo_handle[ch].depth_smooth;
+				break;
+			case MIDI_CC_RING_MOD_DEPTH:
+				// the main loop publishes it into the parameter block (ring_mod_update, the writer side), so the next
+				// edit of the menu carries it. until then the snapshot of the audio processing holds it
+				ring_mod_handle[ch].params.blend = target;
+				midi_ring_mod_blend = event.value;
+				smoother = &ring_mod_handle[ch].blend_smooth;
+				break;
+			case MIDI_CC_CHORUS_RATE:
+				chorus_update(&chorus_handle[ch], CHORUS_RATE, target);
+				smoother = &chorus_handle[ch].rate_smooth;
+				break;
+			case MIDI_CC_CHORUS_DEPTH:
+				chorus_update(&chorus_handle[ch], CHORUS_DEPTH, target);
+				smoother = &chorus_handle[ch].depth_smooth;
+				break;
+			case MIDI_CC_CHORUS_BLEND:
+				chorus_update(&chorus_handle[ch], CHORUS_BLEND, target);
+				smoother = &chorus_handle[ch].blend_smooth;
+				break;
+			case MIDI_CC_FLANGER_RATE:
+				flanger_update(&flanger_handle[ch], FLANGER_RATE, target);
+				smoother = &flanger_handle[ch].rate_smooth;
+				break;
+			case MIDI_CC_FLANGER_DEPTH:
+				flanger_update(&flanger_handle[ch], FLANGER_DEPTH, target);
+				smoother = &flanger_handle[ch].depth_smooth;
+				break;
+			case MIDI_CC_FLANGER_FEEDBACK:
+				// as in the menu: the comb filter has to stay stable
+				target = 0.95f * value;
+				flanger_update(&flanger_handle[ch], FLANGER_FEEDBACK, target);
+				smoother = &flanger_handle[ch].feedback_smooth;
+				break;
+			case MIDI_CC_PITCH_BLEND:
+				pitch_update(&pitch_handle[ch], PITCH_BLEND, target);
+				smoother = &pitch_handle[ch].blend_smooth;
+				break;
+			}
+			if (smoother != NULL)
+			{
+				smooth_param_schedule(smoother, target, offset);
+			}
+		}
 	}
 }
+#endif
 
-static void pass_through() 
+/******************************************************************************
+* Function Name: audio_set_block_size
+*******************************************************************************
+* Summary:
+*  Change the number of samples per channel that are processed at once. Small blocks have a
+*  low latency (input to output = DMA_BLOCKS blocks), big blocks spread the per-call overhead over more
+*  samples, e.g. for the convolution reverb. The DMA is stopped, all effect states are
+*  silenced (a block size change always results in a short dropout) and the DMA is restarted
+*  with the new block size. Has to be called from the main loop, not from an interrupt.
+*
+* Parameters:
+*  1. uint16_t size					- New block size. Power of two from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE.
+* Return:
+*  254:								- Size is out of range, not a power of two or changing the
+*									  block size isn't supported (DUAL_CORE, the M4 works with
+*									  fixed PING_PONG_BUFFER_SIZE blocks).
+*  253:								- The DMA couldn't be restarted.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t audio_set_block_size(uint16_t size)
 {
-	const uint16_t size = DMA_BUFFER_SIZE >> 2;
-	for (int i = 0; i < size; ++i)
+	if ((size < MIN_BLOCK_SIZE) || (size > MAX_BLOCK_SIZE) || (((size - 1) & size) != 0))
+	{
+		return 254;
+	}
+#if defined(DUAL_CORE)
+	if (size != PING_PONG_BUFFER_SIZE)
+	{
+		return 254;
+	}
+#endif
+	if (size == block_size)
 	{
-		left_out[i] = left_in[i];
+		return 0;
 	}
+
+	audio_stop();
+	block_size = size;
+	reset_effects();
+#if defined(POWER_SAVING)
+	// the load of the new size isn't known yet
+	power_boost(&power, HAL_GetTick());
+#endif
+#if defined(PROFILER)
+	// the budget per block changed, old statistics aren't comparable anymore
+	profiler_init(block_size * (SystemCoreClock / sample_rate));
+#endif
+
+	return audio_start();
 }
 
-void HAL_I2S_ErrorCallback(I2S_HandleTypeDef *hi2s)
+uint16_t audio_get_block_size(void)
 {
-	// breakpoint trap. if this callback interrupt function is called, debugger will break/ stop here.
-	__asm("bkpt 255");
-	__asm("nop");
+	return block_size;
 }
 
-void peripheral_init(void)
+#if defined(LATENCY_PROBE)
+/******************************************************************************
+* Function Name: audio_latency_start
+*******************************************************************************
+* Summary:
+*  Measure the round trip latency of every block size through a loopback cable from the left
+*  output to the left input: for each size from MIN_BLOCK_SIZE on, an impulse and a maximum
+*  length sequence (latency_probe.h). The effects are silenced with every change of the block
+*  size, the output only carries the probe. One SWO line per measurement, the block size the
+*  sweep started with is set again at the end. Call from the main loop.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void audio_latency_start(void)
 {
-	// Configure MPU
-	MPU_conf();
+	if (latency_step >= 0)
+	{
+		return;
+	}
+	latency_restore = block_size;
+	latency_step = 0;
+	latency_next();
+}
 
-	// GPIO
-	// Enable the GPIO perihperals in RCC AHB4-enable-register
-	RCC->AHB4ENR |= RCC_AHB4ENR_GPIOCEN;
-	RCC->AHB4ENR |= RCC_AHB4ENR_GPIOBEN;
-	RCC->AHB4ENR |= RCC_AHB4ENR_GPIOAEN;
-	// DMA Controller clock enable
-	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
-	
-	// enable gpio PB8 and PB9 for logic analyzer debugging
-	GPIO_InitTypeDef gpio_debug;
-	gpio_debug.Pin = GPIO_PIN_8 | GPIO_PIN_9;
-	gpio_debug.Mode = GPIO_MODE_OUTPUT_PP;
-	gpio_debug.Pull = GPIO_PULLUP;
-	gpio_debug.Speed = GPIO_SPEED_FREQ_HIGH;
-	HAL_GPIO_Init(GPIOB, &gpio_debug);
-	
-	/* EXTI interrupt init*/
-	HAL_NVIC_SetPriority(EXTI9_5_IRQn, 3, 0);
-	HAL_NVIC_EnableIRQ(EXTI9_5_IRQn); 
+// end a sweep early, e.g. when the page is left. the block size it started with is set again
+void audio_latency_stop(void)
+{
+	if (latency_step < 0)
+	{
+		return;
+	}
+	latency_probe_stop();
+	latency_step = -1;
+	audio_set_block_size(latency_restore);
+}
 
+// true while the sweep of audio_latency_start runs
+bool audio_latency_running(void)
+{
+	return (latency_step >= 0) ? true : false;
+}
 
-	MX_DMA_Init();
-	MX_I2S2_Init();
-	MX_TIM2_Init();
-	MX_I2C1_Init();
+// start the measurement of the current step. block sizes that can't be set (DUAL_CORE) are skipped, after the
+// last step the sweep is over
+static void latency_next(void)
+{
+	while (latency_step < (2 * LATENCY_SIZES))
+	{
+		const uint16_t size = MIN_BLOCK_SIZE << (latency_step >> 1);
+		if ((audio_set_block_size(size) == 0)
+			&& (latency_probe_start((latency_step & 1) ? LATENCY_MLS : LATENCY_IMPULSE, size, sample_rate) == 0))
+		{
+			return;
+		}
+		latency_step = (latency_step | 1) + 1;
+	}
+	latency_step = -1;
+	audio_set_block_size(latency_restore);
+}
 
-	//volatile HAL_StatusTypeDef result = HAL_I2C_IsDeviceReady(&hi2c1, 0x4E, 200, 200);
-	lcd_init();
-	lcd_send_string("Initializing");
-	HAL_Delay(100);
+// analyze a complete capture of the sweep, report it and go on with the next step
+static void latency_pass(void)
+{
+	if (latency_probe_process())
+	{
+		latency_probe_report();
+		if (latency_step >= 0)
+		{
+			latency_step++;
+			latency_next();
+		}
+	}
 }
+#endif
 
-// Set up MPU for DMA buffer region. Make not cacheable.
-// see AN4838
-void MPU_conf()
+/******************************************************************************
+* Function Name: audio_set_sample_rate
+*******************************************************************************
+* Summary:
+*  Switch the I2S (or the SAI) to another sample rate. The DMA is stopped, PLL2 and the divider
+*  of the interface are reprogrammed (audio_set_clock) and every effect is initialized again, so coefficients,
+*  delay lengths and generated responses follow the new rate (the memory of the effects
+*  stays where it is). The parameters set in the menu have to be replayed by the caller.
+*  A failed switch restarts with the old rate. Has to be called from the main loop.
+*
+* Parameters:
+*  1. uint32_t rate					- New sample rate in Hz: 44100, 48000 or 96000.
+* Return:
+*  254:								- Rate isn't supported, or changing the rate isn't supported
+*									  (DUAL_CORE: the M4 tail runs with the start-up responses,
+*									  USB_AUDIO: the host streams AUDIO_SAMPLE_RATE).
+*  253:								- The clock or the DMA couldn't be restarted.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t audio_set_sample_rate(uint32_t rate)
 {
-	MPU_Region_InitTypeDef MPU_Init_DMA_buffer;
+	if ((rate != 44100) && (rate != 48000) && (rate != 96000))
+	{
+		return 254;
+	}
+#if defined(DUAL_CORE) || defined(USB_AUDIO)
+	if (rate != AUDIO_SAMPLE_RATE)
+	{
+		return 254;
+	}
+#endif
+	if (rate == sample_rate)
+	{
+		return 0;
+	}
+
+	audio_stop();
+	if (audio_set_clock(rate))
+	{
+		// back to the rate the effects are set up for
+		if (audio_set_clock(sample_rate))
+		{
+			return 253;
+		}
+		audio_start();
+		return 253;
+	}
+
+	sample_rate = rate;
+#if defined(CAPTURE)
+	capture_set_sample_rate(rate);
+#endif
+#if defined(POWER_SAVING)
+	// the load of the new rate isn't known yet
+	power_boost(&power, HAL_GetTick());
+#endif
+	init_effects();
+	reset_effects();
+	// init_effects cleared the amp model: the one selected for the new rate
+	amp_requested = true;
+	// the sleep holds are times
+	fx_setup_tails(&chain);
+	// the generated reverb response (or the FDN) of an active reverb
+	reverb_rebuild(&reverb_handle);
+#if defined(PROFILER)
+	// a block lasts longer or shorter now
+	profiler_init(block_size * (SystemCoreClock / sample_rate));
+#endif
+#if defined(GOVERNOR)
+	// the effects are back at full quality, the load has to be measured again
+	governor_init(&governor, audio_stats.overruns, HAL_GetTick());
+	apply_governor_level(GOVERNOR_FULL);
+#endif
+
+	return audio_start();
+}
+
+uint32_t audio_get_sample_rate(void)
+{
+	return sample_rate;
+}
+
+// latency from the input to the output jack without the converters: the DMA ring, the nodes of the chain processed
+// with the last block and the lookahead of the limiter
+uint32_t audio_get_latency(void)
+{
+	return DMA_BLOCKS * block_size + transition.latency + LIMITER_LOOKAHEAD;
+}
+
+const audio_stats_t* audio_get_stats(void)
+{
+	return &audio_stats;
+}
+
+const audio_admission_t* audio_get_admission(void)
+{
+	return &admission;
+}
+
+/******************************************************************************
+* Function Name: audio_select_amp
+*******************************************************************************
+* Summary:
+*  Select an amp model of the library image (LIBRARY_IMAGE_BASE): the n-th one captured at the
+*  running sample rate. The control passes load it (amp_library_pass), a new sample rate loads
+*  the model of the same number for it. Main loop only.
+*
+* Parameters:
+*  1. uint8_t n						- Number of the model from 1. 0, or more than the library holds:
+*									  no model, the amp passes the input through.
+* Return:
+*  None.
+*
+******************************************************************************/
+void audio_select_amp(uint8_t n)
+{
+	amp_selected = n;
+	amp_requested = true;
+}
+
+/******************************************************************************
+* Function Name: amp_library_pass
+*******************************************************************************
+* Summary:
+*  Load the amp model selected last, one chunk per control pass. While the amp is neither
+*  selected nor fading the model of the audio path is written directly (a load that isn't
+*  complete when the amp is selected completes at once), otherwise a copy in the D1 arena is
+*  handed over with amp_load and given back once every channel took it. A copy without room in
+*  the arena yet (a reverb fading out) is tried again with the next pass. Without a library
+*  image every number is no model.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void amp_library_pass(void)
+{
+	const bool running = (mode == FXAMP) || (transition.request == FXAMP) || (transition.from == FXAMP) || (transition.to == FXAMP);
+
+	if (amp_target != NULL)
+	{
+		uint8_t result = library_loader_step(&amp_loader);
+		while ((result == 1) && running && (amp_target == &amp_model))
+		{
+			result = library_loader_step(&amp_loader);
+		}
+		if (result == 1)
+		{
+			return;
+		}
+		if (amp_target != &amp_model)
+		{
+			// a read error cleared the copy: it's given back without being handed over
+			if (result == 0)
+			{
+				for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+				{
+					amp_load(&amp_handle[ch], amp_target);
+				}
+			}
+			amp_staged = amp_target;
+		}
+		amp_target = NULL;
+		return;
+	}
+
+	if (amp_staged != NULL)
+	{
+		bool taken = true;
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			taken = taken && (amp_handle[ch].pending == NULL);
+		}
+		// the amp stopped before it took the copy: copied here, nothing reads the model now
+		if (!taken && !running)
+		{
+			memcpy(&amp_model, amp_staged, amp_model_size(amp_staged));
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				amp_handle[ch].pending = NULL;
+			}
+			taken = true;
+		}
+		if (!taken)
+		{
+			return;
+		}
+		arena_free(amp_staged);
+		amp_staged = NULL;
+	}
+
+	if (!amp_requested)
+	{
+		return;
+	}
+	amp_requested = false;
+	if (!library_ready)
+	{
+		library_ready = (library_open_memory(&library, (const uint8_t *)LIBRARY_IMAGE_BASE, LIBRARY_IMAGE_SIZE) == 0);
+	}
+	// the n-th model for the running rate
+	int16_t index = -1;
+	uint8_t n = amp_selected;
+	for (uint8_t k = 0; library_ready && (n > 0) && ((index = library_find(&library, LIBRARY_AMP, k)) >= 0); ++k)
+	{
+		if ((library.entries[index].rate == sample_rate) && (--n == 0))
+		{
+			break;
+		}
+	}
+
+	amp_model_t *target = &amp_model;
+	if (running)
+	{
+		// a cleared model only needs its header
+		target = arena_alloc(ARENA_AXI, (index < 0) ? offsetof(amp_model_t, weights) : sizeof(amp_model_t));
+		if (target == NULL)
+		{
+			amp_requested = true;
+			return;
+		}
+	}
+	if (index < 0)
+	{
+		amp_model_clear(target);
+		if (running)
+		{
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				amp_load(&amp_handle[ch], target);
+			}
+			amp_staged = target;
+		}
+		return;
+	}
+	if (library_load_amp(&amp_loader, &library, (uint8_t)index, target))
+	{
+		if (running)
+		{
+			arena_free(target);
+		}
+		return;
+	}
+	amp_target = target;
+}
+
+#if defined(HOST_LINK)
+/******************************************************************************
+* Function Name: audio_load_cab
+*******************************************************************************
+* Summary:
+*  Replace the cabinet response with one sampled at the current sample rate (uploaded by the
+*  host). The response is copied, the cabinet keeps reading it for every new block size. Only
+*  while the cabinet is neither selected nor fading, its filter is rebuilt in the main loop. A
+*  new sample rate brings the generated response back (init_effects). Main loop only.
+*
+* Parameters:
+*  1. const float32_t *ir			- Cabinet response.
+*  2. uint32_t length				- Number of samples. Range: 0 < length <= CAB_MAX_TAPS.
+* Return:
+*  255:								- The cabinet is selected or fading, nothing changed.
+*  254:								- length is out of range.
+*  Otherwise see cab_init.
+*
+******************************************************************************/
+uint8_t audio_load_cab(const float32_t *ir, uint32_t length)
+{
+	// in AXI SRAM, read by cab_set_block_size only
+	static float32_t cab_ir[CAB_MAX_TAPS];
+
+	if ((mode == FXCAB) || (transition.request == FXCAB) || (transition.from == FXCAB) || (transition.to == FXCAB))
+	{
+		return 255;
+	}
+	if ((length == 0) || (length > CAB_MAX_TAPS))
+	{
+		return 254;
+	}
+	memcpy(cab_ir, ir, length * sizeof(float32_t));
+	return cab_init(&cab_handle, FX_BUFFER(left_in), FX_BUFFER(left_out), cab_ir, length, cab_handle.mix, block_size);
+}
+#endif
+
+// PLL2 and the divider of the stopped interface for a sample rate. 253 if either failed
+static uint8_t audio_set_clock(uint32_t rate)
+{
+	if (AudioClock_Config(rate))
+	{
+		return 253;
+	}
+#if defined(SAI_TDM)
+	return sai_set_sample_rate(rate);
+#else
+	hi2s2.Init.AudioFreq = rate;
+	return (HAL_I2S_Init(&hi2s2) != HAL_OK) ? 253 : 0;
+#endif
+}
+
+// stop the DMA streams (and the MDMA staging). nothing is processed afterwards
+static void audio_stop(void)
+{
+#if defined(SAI_TDM)
+	sai_stop();
+#else
+	HAL_I2S_DMAStop(&hi2s2);
+#endif
+#if defined(MDMA_TRANSFER)
+	HAL_MDMA_Abort(&hmdma_rx);
+	HAL_MDMA_Abort(&hmdma_tx);
+#endif
+#if defined(RTOS)
+	// the audio task preempts every caller: a block scheduled right before the DMA stopped is processed already.
+	// PendSV belongs to the kernel
+#else
+	// a block that was scheduled right before the DMA stopped belongs to the old stream
+	SCB->ICSR = SCB_ICSR_PENDSVCLR_Msk;
+#endif
+}
+
+// start the DMA streams with the current block size from silent buffers. 253 if the DMA couldn't be started
+static uint8_t audio_start(void)
+{
+#if defined(MDMA_TRANSFER)
+	// the block offsets of the (de)interleaving depend on the block size
+	MX_MDMA_Init(block_size);
+	hmdma_rx.XferCpltCallback = rx_transfer_complete;
+#endif
+	memset(rx_buffer, 0, sizeof(rx_buffer));
+	memset(tx_buffer, 0, sizeof(tx_buffer));
+#if defined(CACHED_DMA)
+	// the zeros must not stay in the cache: dirty rx lines could be written back over received samples later
+	SCB_CleanInvalidateDCache_by_Addr(rx_buffer, sizeof(rx_buffer));
+	SCB_CleanDCache_by_Addr(tx_buffer, sizeof(tx_buffer));
+#endif
+	// PendSV was cleared by audio_stop, nothing of the old stream is queued
+	blocks_received = 0;
+	blocks_processed = 0;
+
+#if defined(SAI_TDM)
+	return sai_start(tx_buffer, rx_buffer, block_size);
+#elif (DMA_BLOCKS > 2)
+	return dma_ring_start();
+#else
+	if (HAL_I2SEx_TransmitReceive_DMA(&hi2s2, (uint16_t *)tx_buffer, (uint16_t *)rx_buffer, block_size << 2) != HAL_OK)
+	{
+		return 253;
+	}
+	return 0;
+#endif
+}
+
+#if (DMA_BLOCKS > 2)
+/******************************************************************************
+* Function Name: dma_ring_start
+*******************************************************************************
+* Summary:
+*  Start the I2S full duplex transfer like HAL_I2SEx_TransmitReceive_DMA, but with both DMA
+*  streams in double buffer mode: memory 0 is block 0, memory 1 is block 1 of the ring. Every
+*  completed block moves its memory register to the block after the next one (the DMA fills
+*  the next one meanwhile), so the DMA walks through all DMA_BLOCKS blocks. The tx stream
+*  runs a few words ahead of the rx stream, its register is free when the rx callback comes.
+*
+* Parameters:
+*  None.
+* Return:
+*  253:								- A DMA stream couldn't be started.
+*    0:								- Success.
+*
+******************************************************************************/
+static uint8_t dma_ring_start(void)
+{
+	// words per block: both channels
+	const uint32_t words = (uint32_t)block_size << 1;
+
+	if (hi2s2.State != HAL_I2S_STATE_READY)
+	{
+		return 253;
+	}
+	hi2s2.ErrorCode = HAL_I2S_ERROR_NONE;
+	hi2s2.State = HAL_I2S_STATE_BUSY_TX_RX;
+	CLEAR_BIT(hi2s2.Instance->CFG1, SPI_CFG1_TXDMAEN | SPI_CFG1_RXDMAEN);
+
+	// the block callbacks come from the rx stream, the tx stream follows the same frame clock
+	hdma_i2s2_rx.XferHalfCpltCallback = NULL;
+	hdma_i2s2_rx.XferCpltCallback = dma_ring_m0_complete;
+	hdma_i2s2_rx.XferM1CpltCallback = dma_ring_m1_complete;
+	hdma_i2s2_rx.XferErrorCallback = dma_ring_error;
+	hdma_i2s2_tx.XferHalfCpltCallback = NULL;
+	hdma_i2s2_tx.XferErrorCallback = dma_ring_error;
+	ring_block = 0;
+
+	if ((HAL_DMAEx_MultiBufferStart_IT(&hdma_i2s2_tx, (uint32_t)&tx_buffer[0], (uint32_t)&hi2s2.Instance->TXDR,
+			(uint32_t)&tx_buffer[words], words) != HAL_OK)
+		|| (HAL_DMAEx_MultiBufferStart_IT(&hdma_i2s2_rx, (uint32_t)&hi2s2.Instance->RXDR, (uint32_t)&rx_buffer[0],
+			(uint32_t)&rx_buffer[words], words) != HAL_OK))
+	{
+		HAL_DMA_Abort(&hdma_i2s2_tx);
+		hi2s2.State = HAL_I2S_STATE_READY;
+		return 253;
+	}
+
+	SET_BIT(hi2s2.Instance->CFG1, SPI_CFG1_TXDMAEN | SPI_CFG1_RXDMAEN);
+	__HAL_I2S_ENABLE(&hi2s2);
+	SET_BIT(hi2s2.Instance->CR1, SPI_CR1_CSTART);
+	return 0;
+}
+
+// the block in memory register m is complete: point m to the block after the one the DMA works on now
+static void dma_ring_advance(HAL_DMA_MemoryTypeDef m)
+{
+	const uint32_t words = (uint32_t)block_size << 1;
+	const uint8_t b = ring_block;
+	const uint8_t next = (b + 2) % DMA_BLOCKS;
+
+#if defined(CHECK_TIMELINESS)
+	GPIOB->ODR |= (b & 1) ? GPIO_PIN_9 : GPIO_PIN_8;
+#endif
+	TRACE_EVENT(TRACE_DMA + b);
+	HAL_DMAEx_ChangeMemory(&hdma_i2s2_tx, (uint32_t)&tx_buffer[next * words], m);
+	HAL_DMAEx_ChangeMemory(&hdma_i2s2_rx, (uint32_t)&rx_buffer[next * words], m);
+	ring_block = (b + 1) % DMA_BLOCKS;
+	schedule_audio(b);
+}
+
+static void dma_ring_m0_complete(DMA_HandleTypeDef *hdma)
+{
+	(void)hdma;
+	dma_ring_advance(MEMORY0);
+}
+
+static void dma_ring_m1_complete(DMA_HandleTypeDef *hdma)
+{
+	(void)hdma;
+	dma_ring_advance(MEMORY1);
+}
+
+// same as the HAL does for the ping-pong transfer: the stream stops, the main loop restarts it (audio_check_stream)
+static void dma_ring_error(DMA_HandleTypeDef *hdma)
+{
+	(void)hdma;
+	CLEAR_BIT(hi2s2.Instance->CFG1, SPI_CFG1_TXDMAEN | SPI_CFG1_RXDMAEN);
+	hi2s2.State = HAL_I2S_STATE_READY;
+	SET_BIT(hi2s2.ErrorCode, HAL_I2S_ERROR_DMA);
+	HAL_I2S_ErrorCallback(&hi2s2);
+}
+#endif
+
+/******************************************************************************
+* Function Name: audio_check_stream
+*******************************************************************************
+* Summary:
+*  Count I2S underruns and overruns (the DMA didn't serve the peripheral in time, e.g. bus
+*  contention) and restart the stream after them or after a DMA error. The codec frame can
+*  slip by a slot after such an error (left and right swapped), so the DMA and the I2S are
+*  restarted from silent buffers. With SAI_TDM the flags of both SAI blocks are counted the
+*  same way, a frame sync error of the receiver included (sai_take_errors). The effects keep their state, the dropout is as short as
+*  the restart. A failed restart is tried again with the next call. Call from the main loop.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void audio_check_stream(void)
+{
+#if defined(SAI_TDM)
+	const uint32_t errors = sai_take_errors();
+	if (errors)
+	{
+		audio_stats.i2s_errors++;
+		audio_stats.last_error = errors;
+		restart_pending = 1;
+	}
+#else
+	const uint32_t flags = hi2s2.Instance->SR & (I2S_FLAG_UDR | I2S_FLAG_OVR);
+	if (flags)
+	{
+		__HAL_I2S_CLEAR_UDRFLAG(&hi2s2);
+		__HAL_I2S_CLEAR_OVRFLAG(&hi2s2);
+		audio_stats.i2s_errors++;
+		audio_stats.last_error = ((flags & I2S_FLAG_UDR) ? HAL_I2S_ERROR_UDR : 0) | ((flags & I2S_FLAG_OVR) ? HAL_I2S_ERROR_OVR : 0);
+		restart_pending = 1;
+	}
+#endif
+	if (!restart_pending)
+	{
+		return;
+	}
+
+	restart_pending = 0;
+	audio_stop();
+	if (audio_start())
+	{
+		restart_pending = 1;
+		return;
+	}
+	audio_stats.restarts++;
+}
+
+/******************************************************************************
+* Function Name: crossfade_fits
+*******************************************************************************
+* Summary:
+*  Check if two effects can run in parallel for a crossfade: the longest measured run_fx of
+*  both plus rx/tx must stay below TRANSITION_MAX_LOAD. Without measurements of both modes
+*  (or without PROFILER) the switch falls back to the dip, which never needs more than
+*  one effect per block.
+*
+* Parameters:
+*  1. uint8_t from					- Outgoing effect (fx_designator).
+*  2. uint8_t to					- Incoming effect.
+* Return:
+*  true if the crossfade fits into the block budget.
+*
+******************************************************************************/
+static bool crossfade_fits(uint8_t from, uint8_t to)
+{
+#if defined(PROFILER)
+	const profile_mode_t *a = profiler_get(from);
+	const profile_mode_t *b = profiler_get(to);
+	if ((a == NULL) || (b == NULL) || (a->section[PROFILE_TOTAL].count == 0) || (b->section[PROFILE_TOTAL].count == 0))
+	{
+		return false;
+	}
+	const uint32_t io = a->section[PROFILE_RX].max + a->section[PROFILE_TX].max;
+	return (profiler_load(io + a->section[PROFILE_FX].max + b->section[PROFILE_FX].max) < TRANSITION_MAX_LOAD) ? true : false;
+#else
+	(void)from;
+	(void)to;
+	return false;
+#endif
+}
+
+// report a decision of admit to the menu. a refused effect leaves the one requested last on (see control_pass)
+static void report_admission(uint8_t fx, uint8_t quality)
+{
+	admission.fx = fx;
+	admission.quality = quality;
+	admission.mode = (quality == ADMISSION_REFUSED) ? transition.request : fx;
+	admission.count++;
+}
+
+// set the quality of the distortion on every channel
+static void set_distortion_quality(uint8_t fx, distortion_quality quality)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		if (fx == FXOVERDRIVE)
+			overdrive_set_quality(&overdrive_handle[ch], quality);
+		else
+			fuzz_set_quality(&fuzz_handle[ch], quality);
+	}
+}
+
+// variant of the cost model (cost_entry_t) for the settings of an effect. the distortion effects try their qualities in admit
+static uint8_t cost_variant(uint8_t fx)
+{
+	switch (fx)
+	{
+	case FXAMP:
+		return COST_AMP(amp_model.cell, amp_model.hidden);
+	case FXCAB:
+		return cost_cab_variant(cab_handle.ir_length);
+	case FXREVERB:
+#if defined(REVERB_FDN)
+		return COST_REVERB_FDN;
+#else
+		return COST_REVERB(reverb_handle.short_tail ? 1 : NU_CONVOLVER_TAIL_STAGES);
+#endif
+	default:
+		return COST_ANY;
+	}
+}
+
+/******************************************************************************
+* Function Name: admit
+*******************************************************************************
+* Summary:
+*  Check an effect before it is switched on, with the cost model of the benchmark (cost_model.h):
+*  its buffers have to fit into the arenas, and its predicted cycles at the block size plus the
+*  measured rx/tx of the current effect must stay below ADMISSION_MAX_LOAD of the block budget
+*  at the current core clock. A distortion that doesn't fit goes down in quality (oversampled,
+*  ADAA, LUT) until it does, the menu keeps its setting. Effects and settings the model has no
+*  entry or no cycles for are refused, their load can't be predicted. A refusal and a lower
+*  quality are reported to the menu (audio_get_admission). An effect that is still running or
+*  fading holds its buffers already, its memory isn't checked again, nor the one of a reverb
+*  that kept its spectra. Bypass (FXNONE) is always admitted.
+*
+* Parameters:
+*  1. uint8_t fx					- Requested effect (fx_designator).
+* Return:
+*  true if the effect may be switched on.
+*
+******************************************************************************/
+static bool admit(uint8_t fx)
+{
+	if (fx == FXNONE)
+	{
+		return true;
+	}
+	const uint8_t variant = cost_variant(fx);
+	// with DUAL_CORE the reverb keeps its spectra when it leaves the chain (reverb_deinit), the M4 holds the convolver
+	const bool holds = (fx == transition.to) || (fx == transition.from) || ((fx == FXREVERB) && (reverb_handle.memory != NULL));
+	if (!holds && !cost_memory_fits(fx, variant))
+	{
+		report_admission(fx, ADMISSION_REFUSED);
+		return false;
+	}
+
+	uint32_t io = 0;
+#if defined(PROFILER)
+	const profile_mode_t *current = profiler_get(transition.to);
+	if ((current != NULL) && (current->section[PROFILE_TOTAL].count != 0))
+	{
+		io = current->section[PROFILE_RX].max + current->section[PROFILE_TX].max;
+	}
+#endif
+	const uint32_t budget = block_size * (SystemCoreClock / sample_rate);
+	const uint32_t limit = (uint32_t)(((uint64_t)budget * ADMISSION_MAX_LOAD) / 1000);
+
+	if ((fx == FXOVERDRIVE) || (fx == FXFUZZ))
+	{
+		const uint8_t chosen = (fx == FXOVERDRIVE) ? overdrive_handle[0].quality : fuzz_handle[0].quality;
+		for (int8_t quality = chosen; quality >= DISTORTION_LUT; --quality)
+		{
+			const uint32_t cycles = cost_cycles(fx, (uint8_t)quality, COST_PLACEMENT, block_size);
+			if ((cycles != 0) && ((io + cycles) < limit))
+			{
+				if (quality != chosen)
+				{
+					set_distortion_quality(fx, (distortion_quality)quality);
+					report_admission(fx, (uint8_t)quality);
+				}
+				return true;
+			}
+		}
+		report_admission(fx, ADMISSION_REFUSED);
+		return false;
+	}
+
+	const uint32_t cycles = cost_cycles(fx, variant, COST_PLACEMENT, block_size);
+	if ((cycles == 0) || ((io + cycles) >= limit))
+	{
+		report_admission(fx, ADMISSION_REFUSED);
+		return false;
+	}
+	return true;
+}
+
+#if defined(REVERB_FDN)
+/******************************************************************************
+* Function Name: check_shimmer
+*******************************************************************************
+* Summary:
+*  Allow the shimmer of the reverb once the network and the octave shifter in its feedback fit
+*  into the block budget together: the longest measured run_fx of the reverb plus rx/tx plus
+*  the shifter must stay below SHIMMER_MAX_LOAD. The shifter costs one channel's share of the
+*  measured pitch shifter (one head pair on the mono network), SHIMMER_CYCLES_PER_SAMPLE until
+*  that was measured. The reverb has to be measured first, until then the shimmer waits.
+*  Both run on the M7, also with DUAL_CORE: the M4 only takes the tail of the convolution
+*  reverb, so the budget is the one of the M7 in both builds. An allowed shimmer stays allowed
+*  until its level goes back to 0 (the measured reverb then includes it), the load governor
+*  answers an overload from there. Without PROFILER there's nothing to check against.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void check_shimmer(void)
+{
+	if (reverb_handle.shimmer == 0.0f)
+	{
+		reverb_allow_shimmer(&reverb_handle, false);
+		return;
+	}
+	if (reverb_handle.shimmer_allowed)
+	{
+		return;
+	}
+#if defined(PROFILER)
+	const profile_mode_t *reverb = profiler_get(FXREVERB);
+	const profile_mode_t *pitch = profiler_get(FXPITCH);
+	if ((reverb == NULL) || (reverb->section[PROFILE_TOTAL].count == 0))
+	{
+		return;
+	}
+	const uint32_t shifter = ((pitch != NULL) && (pitch->section[PROFILE_TOTAL].count != 0))
+		? pitch->section[PROFILE_FX].max / AUDIO_CHANNELS : SHIMMER_CYCLES_PER_SAMPLE * block_size;
+	const uint32_t io = reverb->section[PROFILE_RX].max + reverb->section[PROFILE_TX].max;
+	if (profiler_load(io + reverb->section[PROFILE_FX].max + shifter) < SHIMMER_MAX_LOAD)
+	{
+		reverb_allow_shimmer(&reverb_handle, true);
+	}
+#else
+	reverb_allow_shimmer(&reverb_handle, true);
+#endif
+}
+#endif
+
+// silence all effects that keep a history of the signal
+static void reset_effects(void)
+{
+	fx_setup_reset(block_size);
+#if defined(LOOPER)
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		looper_reset(&looper_handle[ch]);
+	}
+#endif
+}
+
+void HAL_I2SEx_TxRxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
+{
+#if defined(CHECK_TIMELINESS)
+	GPIOB->ODR |= GPIO_PIN_8;
+#endif
+	TRACE_EVENT(TRACE_DMA + PING);
+#if defined(MDMA_TRANSFER)
+	rx_transfer(PING);
+#else
+	schedule_audio(PING);
+#endif
+}
+void HAL_I2SEx_TxRxCpltCallback(I2S_HandleTypeDef *hi2s)
+{
+#if defined(CHECK_TIMELINESS)
+	GPIOB->ODR |= GPIO_PIN_9;
+#endif
+	TRACE_EVENT(TRACE_DMA + PONG);
+#if defined(MDMA_TRANSFER)
+	rx_transfer(PONG);
+#else
+	schedule_audio(PONG);
+#endif
+//	memcpy((tx_buffer + (SAMPLE_BLOCK >> 1) * sizeof(uint32_t)), (rx_buffer + (SAMPLE_BLOCK >> 1) * sizeof(uint32_t)), (SAMPLE_BLOCK >> 1));
+}
+
+#if defined(SAI_TDM)
+// the receive stream of the SAI marks the blocks, the transmit stream runs on the same frame clock
+void HAL_SAI_RxHalfCpltCallback(SAI_HandleTypeDef *hsai)
+{
+	(void)hsai;
+#if defined(CHECK_TIMELINESS)
+	GPIOB->ODR |= GPIO_PIN_8;
+#endif
+	TRACE_EVENT(TRACE_DMA + PING);
+	schedule_audio(PING);
+}
+void HAL_SAI_RxCpltCallback(SAI_HandleTypeDef *hsai)
+{
+	(void)hsai;
+#if defined(CHECK_TIMELINESS)
+	GPIOB->ODR |= GPIO_PIN_9;
+#endif
+	TRACE_EVENT(TRACE_DMA + PONG);
+	schedule_audio(PONG);
+}
+#endif
+
+#if !defined(CONTROL_M4)
+// EXTI Line9 External Interrupt ISR Handler CallBack
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	if (GPIO_Pin == GPIO_PIN_9) // If The INT Source Is EXTI Line9 (A9 Pin)
+	{
+		const uint32_t now = HAL_GetTick();
+		if ((now - btn_tick) >= UI_DEBOUNCE_MS)
+		{
+			btn_tick = now;
+			ui_post(UI_EVENT_BUTTON);
+		}
+	}
+}
+
+// TIM2 capture: an edge of the rotary encoder, the counter moved
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+	if (htim->Instance == TIM2)
+	{
+		ui_post(UI_EVENT_ENCODER);
+	}
+}
+#endif
+
+#if defined(MDMA_TRANSFER)
+/******************************************************************************
+* Function Name: rx_transfer
+*******************************************************************************
+* Summary:
+*  Start the MDMA transfer of a completed DMA half into rx_stage (one channel per row). The
+*  block is scheduled for processing when the transfer is complete (rx_transfer_complete).
+*  If the previous transfer is still running, the deadline was missed.
+*
+* Parameters:
+*  1. uint8_t p						- Block of the DMA buffers that was just completed.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void rx_transfer(uint8_t p)
+{
+	const uint32_t n = block_size;
+	rx_block = p;
+	if (HAL_MDMA_Start_IT(&hmdma_rx, (uint32_t)&rx_buffer[p * (n << 1)], (uint32_t)rx_stage, n * sizeof(q31_t), RX_CHANNELS) != HAL_OK)
+	{
+		audio_stats.overruns++;
+	}
+}
+
+static void rx_transfer_complete(MDMA_HandleTypeDef *hmdma)
+{
+	(void)hmdma;
+	schedule_audio(rx_block);
+}
+
+// sign extend staged 24 bit codec words into q31: the shift wraps, so the sign bit 23 lands in bit 31. arm_shift_q31
+// saturates instead and turns every negative word into -1
+#pragma optimize_for_speed
+ITCM_CODE static void codec_to_q31(const q31_t *src, q31_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		dst[i] = (q31_t)((uint32_t)src[i] << CODEC_SHIFT);
+	}
+}
+
+/******************************************************************************
+* Function Name: rx_samples
+*******************************************************************************
+* Summary:
+*  Convert the staged channels to float. The MDMA already deinterleaved them into DTCM, so
+*  sign extending the 24 bit samples (shift into the top of the word) and normalizing to
+*  [-1, 1) are two vectorized passes per channel without uncached loads. With SIDECHAIN the
+*  MDMA stages the right input as well, it's converted into sidechain_in.
+*
+* Parameters:
+*  1. uint8_t p						- Block of the DMA buffers (already copied by the MDMA).
+*  2. uint32_t n					- Samples per channel (block size).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void rx_samples(uint8_t p, uint32_t n)
+{
+	// the MDMA copied the block already, the staging buffers are the same for every block
+	(void)p;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		// the q31 chain takes the shifted words as they are
+		codec_to_q31(rx_stage[ch], channel_in[ch], n);
+#else
+		codec_to_q31(rx_stage[ch], rx_stage[ch], n);
+		arm_q31_to_float(rx_stage[ch], channel_in[ch], n);
+#endif
+	}
+#if defined(SIDECHAIN)
+	// the detectors take float in both sample formats
+	codec_to_q31(rx_stage[AUDIO_CHANNELS], rx_stage[AUDIO_CHANNELS], n);
+	arm_q31_to_float(rx_stage[AUDIO_CHANNELS], sidechain_in, n);
+#endif
+}
+
+/******************************************************************************
+* Function Name: tx_samples
+*******************************************************************************
+* Summary:
+*  Convert the processed blocks to 24 bit codec words in tx_stage and let the MDMA interleave
+*  them into one DMA half. The DMA sends this half after the other one, long after the
+*  transfer is done. Saturation and sign handling as without MDMA_TRANSFER.
+*
+* Parameters:
+*  1. uint8_t p						- Block of the DMA buffers to write.
+*  2. uint32_t n					- Samples per channel (block size).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void tx_samples(uint8_t p, uint32_t n)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		arm_shift_q31(channel_out[ch], -CODEC_SHIFT, tx_stage[ch], n);
+#else
+		arm_float_to_q31(channel_out[ch], tx_stage[ch], n);
+		arm_shift_q31(tx_stage[ch], -CODEC_SHIFT, tx_stage[ch], n);
+#endif
+	}
+	if (HAL_MDMA_Start_IT(&hmdma_tx, (uint32_t)tx_stage, (uint32_t)&tx_buffer[p * (n << 1)], n * sizeof(q31_t), AUDIO_CHANNELS) != HAL_OK)
+	{
+		audio_stats.overruns++;
+	}
+}
+#else
+/******************************************************************************
+* Function Name: rx_samples
+*******************************************************************************
+* Summary:
+*  Convert one DMA block to float. With AUDIO_CHANNELS 1 only the left channel is used (the audio jacks
+*  are mono, but the codec samples for stereo), with AUDIO_CHANNELS 2 both channels are split into their
+*  own buffers. With SAI_TDM they are the slots from AUDIO_FRAME_SLOT of every TDM frame. The 24 bit
+*  samples are sign extended by shifting them into the top of the word while deinterleaving,
+*  arm_q31_to_float then normalizes each channel to [-1, 1) in one vectorized pass. With SIDECHAIN
+*  the right input is deinterleaved in the same pass into sidechain_in.
+*
+* Parameters:
+*  1. uint8_t p						- Block of the DMA buffers to read.
+*  2. uint32_t n					- Samples per channel (block size).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void rx_samples(uint8_t p, uint32_t n)
+{
+	// blocks are n frames apart
+	const uint32_t *src = &rx_buffer[p * n * AUDIO_FRAME_WORDS + AUDIO_FRAME_SLOT];
+	// the DMA wrote this block behind the cache's back
+	DMA_INVALIDATE(&rx_buffer[p * n * AUDIO_FRAME_WORDS], DMA_HALF_BYTES(n));
+
+#if defined(SIDECHAIN)
+	// mono: the key is the word behind the signal in every frame, both are picked up in the same pass
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		const uint32_t *frame = &src[i * AUDIO_FRAME_WORDS];
+#if defined(SAMPLE_Q31)
+		channel_in[0][i] = (q31_t)(frame[0] << CODEC_SHIFT);
+#else
+		conversion_buffer[i] = (q31_t)(frame[0] << CODEC_SHIFT);
+#endif
+		sidechain_words[i] = (q31_t)(frame[1] << CODEC_SHIFT);
+	}
+#if !defined(SAMPLE_Q31)
+	arm_q31_to_float(conversion_buffer, channel_in[0], n);
+#endif
+	// the detectors take float in both sample formats
+	arm_q31_to_float(sidechain_words, sidechain_in, n);
+#else
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		// interleaved: one frame of AUDIO_FRAME_WORDS words per sample, left before right
+#if defined(SAMPLE_Q31)
+		// the q31 chain takes the shifted words as they are
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			channel_in[ch][i] = (q31_t)(src[i * AUDIO_FRAME_WORDS + ch] << CODEC_SHIFT);
+		}
+#else
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			conversion_buffer[i] = (q31_t)(src[i * AUDIO_FRAME_WORDS + ch] << CODEC_SHIFT);
+		}
+		arm_q31_to_float(conversion_buffer, channel_in[ch], n);
+#endif
+	}
+#endif
+}
+
+/******************************************************************************
+* Function Name: tx_samples
+*******************************************************************************
+* Summary:
+*  Convert the processed blocks back to 24 bit codec words of one DMA block (left channel only with
+*  AUDIO_CHANNELS 1).
+*  arm_float_to_q31 saturates values outside of [-1, 1), so an effect that overshoots clips
+*  instead of wrapping around. The arithmetic shift keeps the sign in the discarded top byte.
+*
+* Parameters:
+*  1. uint8_t p						- Block of the DMA buffers to write.
+*  2. uint32_t n					- Samples per channel (block size).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void tx_samples(uint8_t p, uint32_t n)
+{
+	uint32_t *dst = &tx_buffer[p * n * AUDIO_FRAME_WORDS + AUDIO_FRAME_SLOT];
+
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			dst[i * AUDIO_FRAME_WORDS + ch] = (uint32_t)(channel_out[ch][i] >> CODEC_SHIFT);
+		}
+#else
+		arm_float_to_q31(channel_out[ch], conversion_buffer, n);
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			dst[i * AUDIO_FRAME_WORDS + ch] = (uint32_t)(conversion_buffer[i] >> CODEC_SHIFT);
+		}
+#endif
+	}
+	// the DMA reads the memory, not the cache
+	DMA_CLEAN(&tx_buffer[p * n * AUDIO_FRAME_WORDS], DMA_HALF_BYTES(n));
+}
+
+#endif
+
+#if defined(TRUE_BYPASS)
+/******************************************************************************
+* Function Name: bypass_active
+*******************************************************************************
+* Summary:
+*  Whether the next block needs no processing: no node is selected, requested or fading out
+*  (a transition into an effect starts from the unprocessed input, as the bypass did), the
+*  tuner doesn't analyze the input and no loop plays on top. With USB_AUDIO the host records
+*  the converted blocks, there is no bypass.
+*
+* Parameters:
+*  None.
+* Return:
+*  true:							- The block can be copied by bypass_samples.
+*  false:							- The block goes through the chain.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static bool bypass_active(void)
+{
+#if defined(USB_AUDIO)
+	return false;
+#else
+	if ((transition.request != FXNONE) || (transition.to != FXNONE) || (transition.length != 0))
+	{
+		return false;
+	}
+#if defined(TUNER)
+	if (tuner_enabled())
+	{
+		return false;
+	}
+#endif
+#if defined(LOOPER)
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		if ((looper_handle[ch].state != LOOPER_STOP) || (looper_handle[ch].request != LOOPER_STOP))
+		{
+			return false;
+		}
+	}
+#endif
+	return true;
+#endif
+}
+#endif
+
+/******************************************************************************
+* Function Name: bypass_samples
+*******************************************************************************
+* Summary:
+*  Copy the codec words of a received DMA block into the transmit block of the same index,
+*  which the DMA sends in its turn like a processed block. Nothing is converted, so the output
+*  is the input bit for bit. Both channels are copied in one pass with AUDIO_CHANNELS 2, the
+*  left channel only with AUDIO_CHANNELS 1 (as tx_samples writes it). With SAI_TDM only the slots
+*  of the processed channels are copied, the others stay silent. With MDMA_TRANSFER the rx
+*  transfer into the staging buffers has run already, its result is not used. The output of
+*  every build while booting, with TRUE_BYPASS also of the idle chain (bypass_active).
+*
+* Parameters:
+*  1. uint8_t p						- Block of the DMA buffers.
+*  2. uint32_t n					- Samples per channel (block size).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void bypass_samples(uint8_t p, uint32_t n)
+{
+	const uint32_t *src = &rx_buffer[p * n * AUDIO_FRAME_WORDS];
+	uint32_t *dst = &tx_buffer[p * n * AUDIO_FRAME_WORDS];
+
+	DMA_INVALIDATE(src, DMA_HALF_BYTES(n));
+#if (AUDIO_CHANNELS == 2) && (AUDIO_FRAME_WORDS == 2)
+	arm_copy_q31((const q31_t *)src, (q31_t *)dst, n << 1);
+#else
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		for (uint8_t ch = AUDIO_FRAME_SLOT; ch < (AUDIO_FRAME_SLOT + AUDIO_CHANNELS); ++ch)
+		{
+			dst[i * AUDIO_FRAME_WORDS + ch] = src[i * AUDIO_FRAME_WORDS + ch];
+		}
+	}
+#endif
+	DMA_CLEAN(dst, DMA_HALF_BYTES(n));
+}
+
+/******************************************************************************
+* Function Name: init_effects
+*******************************************************************************
+* Summary:
+*  Initialize every effect with its start-up parameters. The init functions keep the memory
+*  an effect already took, so this is also how the coefficients are recomputed for a new
+*  sample rate (audio_set_sample_rate), the menu values are replayed afterwards. The start-up
+*  parameters are in fx_setup.c, shared with the desktop build (fx_host.c).
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void init_effects(void)
+{
+	envelope_init(&input_envelope, ENVELOPE_PEAK, INPUT_ENVELOPE_ATTACK_MS, INPUT_ENVELOPE_RELEASE_MS);
+	fx_setup_effects(channel_in, channel_out, block_size, &input_level);
+#if defined(SIDECHAIN)
+	// keyed by the right input once their Key item is set
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		gate_set_key(&gate_handle[ch], sidechain_in);
+		comp_set_key(&comp_handle[ch], sidechain_in);
+	}
+#endif
+}
+
+/******************************************************************************
+* Function Name: build_chain
+*******************************************************************************
+* Summary:
+*  Build the chain of all effects (fx_setup_chain, the desktop build in fx_host.c shares it).
+*  A node the chain has no room for (FX_CHAIN_MAX_NODES) would never run and its effect
+*  would stay silent.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void build_chain(void)
+{
+	if (fx_setup_chain(&chain, &transition) != 0)
+	{
+		Error_Handler();
+	}
+}
+
+#if defined(POWER_SAVING)
+// the core clock changed (power.h): the block budget in cycles follows it. the governor's interval was measured at the
+// old clock, it starts over
+static void apply_core_clock(void)
+{
+	profiler_set_budget(block_size * (SystemCoreClock / sample_rate));
+#if defined(GOVERNOR)
+	profiler_take_peak(PROFILE_WINDOW_GOVERNOR);
+#endif
+#if defined(TRACE)
+	trace_clock();
+#endif
+}
+#endif
+
+#if defined(GOVERNOR)
+/******************************************************************************
+* Function Name: apply_governor_level
+*******************************************************************************
+* Summary:
+*  Set the effects to the quality of a load governor level (see governor_level). Every level
+*  includes the ones below, so going back one level undoes exactly one step.
+*
+* Parameters:
+*  1. governor_level level			- Level decided by governor_update.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void apply_governor_level(governor_level level)
+{
+	const uint8_t limit = (level >= GOVERNOR_OVERSAMPLING_OFF) ? 1
+		: (level >= GOVERNOR_OVERSAMPLING_2X) ? 2 : OVERSAMPLER_MAX_FACTOR;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		oversampler_set_limit(&overdrive_handle[ch].oversampler, limit);
+		oversampler_set_limit(&fuzz_handle[ch].oversampler, limit);
+	}
+	reverb_shorten(&reverb_handle, (level >= GOVERNOR_SHORT_REVERB) ? true : false);
+	fx_chain_shed(&chain, (level >= GOVERNOR_SHED) ? true : false);
+}
+#endif
+
+// envelope of the unprocessed input block into input_level, 0 to 1
+#pragma optimize_for_speed
+ITCM_CODE static void follow_input(uint32_t n)
+{
+#if defined(SAMPLE_Q31)
+	float32_t block[MAX_BLOCK_SIZE];
+	arm_q31_to_float(left_in, block, n);
+	input_level = fminf(envelope_block(&input_envelope, block, n), 1.0f);
+#else
+	input_level = fminf(envelope_block(&input_envelope, left_in, n), 1.0f);
+#endif
+}
+
+/******************************************************************************
+* Function Name: run_fx
+*******************************************************************************
+* Summary:
+*  Run the effect chain on every channel. The menu selects one effect at a time, a new mode
+*  is crossfaded in by the transition (see main loop). Bypassed nodes cost nothing, with
+*  everything bypassed (FXNONE) the input is passed through.
+*
+* Parameters:
+*  1. uint8_t mode					- Selected effect (fx_designator), only for the statistics.
+*  2. uint32_t n					- Samples per channel (block size).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void run_fx(uint8_t mode, uint32_t n)
+{
+#if defined(TUNER)
+	// the unprocessed guitar signal, decimated for the tuner (returns at once if the tuner page isn't shown)
+	tuner_feed(left_in, n);
+#endif
+#if defined(MOD_MATRIX)
+	// the parameters of this block, the smoothers of the effects ramp to them
+	follow_input(n);
+#if defined(EXPRESSION_PEDAL)
+	mod_matrix_set_source(&mod_matrix, MOD_PEDAL, expression_poll());
+#endif
+	mod_matrix_process(&mod_matrix, input_level, n);
+#else
+	if (delay_handle[0].duck > 0.0f)
+		follow_input(n);
+#endif
+	fx_transition_process(&transition, &chain, channel_in, channel_out, n);
+#if defined(LOOPER)
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		run_looper(&looper_handle[ch], channel_out[ch], channel_out[ch], n);
+	}
+#endif
+	// the limiter keeps hot chains out of the saturation in tx_samples
+	uint32_t clips = 0;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		clips += run_limiter_q31(&limiter_handle[ch], channel_out[ch], channel_out[ch], n);
+#else
+		clips += run_limiter(&limiter_handle[ch], channel_out[ch], channel_out[ch], n);
+#endif
+	}
+#if defined(PROFILER)
+	profiler_count_clips(mode, clips);
+#else
+	(void)clips;
+#endif
+#if defined(TELEMETRY)
+	// what leaves the pedal (left channel)
+	telemetry_tap(left_out, n);
+#endif
+#if defined(USB_AUDIO)
+	// output and unprocessed input to the host (left channel)
+	usb_audio_tap(left_out, left_in, n);
+#endif
+#if defined(CAPTURE)
+	// into the post-mortem ring, the record is completed with the timestamps once the block is sent
+	capture_tap(left_in, left_out, clips, n);
+#endif
+}
+
+// DMA transfer error: the HAL has already stopped the DMA requests. counted, the main loop restarts the stream
+void HAL_I2S_ErrorCallback(I2S_HandleTypeDef *hi2s)
+{
+	audio_stats.dma_errors++;
+	audio_stats.last_error = hi2s->ErrorCode;
+	restart_pending = 1;
+}
+
+#if defined(SAI_TDM)
+// DMA transfer error of a block, as HAL_I2S_ErrorCallback. the flags of the SAI are polled (audio_check_stream)
+void HAL_SAI_ErrorCallback(SAI_HandleTypeDef *hsai)
+{
+	audio_stats.dma_errors++;
+	audio_stats.last_error = hsai->ErrorCode;
+	restart_pending = 1;
+}
+#endif
+
+void peripheral_init(void)
+{
+	// Configure MPU
+	MPU_conf();
+
+	// GPIO
+	// Enable the GPIO perihperals in RCC AHB4-enable-register
+	RCC->AHB4ENR |= RCC_AHB4ENR_GPIOCEN;
+	RCC->AHB4ENR |= RCC_AHB4ENR_GPIOBEN;
+	RCC->AHB4ENR |= RCC_AHB4ENR_GPIOAEN;
+	// DMA Controller clock enable
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	
+	// enable gpio PB8 and PB9 for logic analyzer debugging
+	GPIO_InitTypeDef gpio_debug;
+	gpio_debug.Pin = GPIO_PIN_8 | GPIO_PIN_9;
+	gpio_debug.Mode = GPIO_MODE_OUTPUT_PP;
+	gpio_debug.Pull = GPIO_PULLUP;
+	gpio_debug.Speed = GPIO_SPEED_FREQ_HIGH;
+	HAL_GPIO_Init(GPIOB, &gpio_debug);
+	
+#if !defined(RTOS)
+	// audio processing (PendSV) preempts everything but the DMA interrupts (priority 0)
+	HAL_NVIC_SetPriority(PendSV_IRQn, 1, 0);
+#endif
+
+	MX_DMA_Init();
+#if defined(SAI_TDM)
+	MX_SAI1_Init();
+#else
+	MX_I2S2_Init();
+#endif
+}
+
+#if !defined(CONTROL_M4)
+/******************************************************************************
+* Function Name: ui_init
+*******************************************************************************
+* Summary:
+*  Set up the controls and the LCD, after the audio started. Nothing here waits: the LCD takes
+*  about 80 ms to initialize, its commands are sent by the menu passes (lcd_update) while the
+*  audio passes through and the effects are initialized. With CONTROL_M4 the controls and the
+*  LCD belong to the M4.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void ui_init(void)
+{
+	// push button of the encoder on PA9, closes to ground
+	GPIO_InitTypeDef gpio_button = {0};
+	gpio_button.Pin = GPIO_PIN_9;
+	gpio_button.Mode = GPIO_MODE_IT_FALLING;
+	gpio_button.Pull = GPIO_PULLUP;
+	gpio_button.Speed = GPIO_SPEED_FREQ_LOW;
+	HAL_GPIO_Init(GPIOA, &gpio_button);
+
+	/* EXTI interrupt init*/
+	// the controls (button, encoder in timer.c) share one priority below the audio (see ui_post)
+	HAL_NVIC_SetPriority(EXTI9_5_IRQn, 3, 0);
+	HAL_NVIC_EnableIRQ(EXTI9_5_IRQn); 
+
+	MX_TIM2_Init();
+	MX_I2C1_Init();
+
+	//volatile HAL_StatusTypeDef result = HAL_I2C_IsDeviceReady(&hi2c1, 0x4E, 200, 200);
+	lcd_init();
+	lcd_fb_write(0, 0, "Initializing");
+}
+#endif
+
+/******************************************************************************
+* Function Name: memory_init
+*******************************************************************************
+* Summary:
+*  Copy the ITCM code (.itcm_text) and the initialized DTCM data (.dtcm_init) from FLASH and
+*  clear .dtcm_bss. The startup code only knows .data and .bss. Has to run first in main, the
+*  audio path calls into ITCM from then on. Nothing to do without TCM_PLACEMENT (empty sections).
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void memory_init(void)
+{
+	// linker script symbols (STM32H745ZITx_FLASH_CM7.ld)
+	extern uint32_t _siitcm, _sitcm, _eitcm;
+	extern uint32_t _sidtcm_init, _sdtcm_init, _edtcm_init;
+	extern uint32_t _sdtcm_bss, _edtcm_bss;
+
+	const uint32_t *src = &_siitcm;
+	for (uint32_t *dst = &_sitcm; dst < &_eitcm; )
+		*dst++ = *src++;
+	src = &_sidtcm_init;
+	for (uint32_t *dst = &_sdtcm_init; dst < &_edtcm_init; )
+		*dst++ = *src++;
+	for (uint32_t *dst = &_sdtcm_bss; dst < &_edtcm_bss; )
+		*dst++ = 0;
+
+	// the code was written as data, it has to be complete before the first instruction is fetched from ITCM
+	__DSB();
+	__ISB();
+}
+
+// Set up MPU for DMA buffer region. Make not cacheable.
+// see AN4838. with CACHED_DMA the region keeps the default (cacheable) attributes, rx_samples and tx_samples maintain the cache
+void MPU_conf()
+{
+#if !defined(CACHED_DMA)
+	MPU_Region_InitTypeDef MPU_Init_DMA_buffer;
 
 	// disable MPU while setting parameters
 	HAL_MPU_Disable();
@@ -348,9 +2536,17 @@ void MPU_conf()
 	// Enable the following settings.
 	MPU_Init_DMA_buffer.Enable = MPU_REGION_ENABLE;
 
-	// Target buffer size from the SRAM 1 (AXI) area (0x2400 0000) of D1 Domain
-	MPU_Init_DMA_buffer.BaseAddress = 0x24000000;
+	// Target buffer size from the start of the memory DMA_PLACEMENT puts them in: AXI SRAM (0x2400 0000) of D1 Domain,
+	// SRAM1 (0x3000 0000) of D2 or the end of SRAM4 (0x3800 E000) of D3
+	MPU_Init_DMA_buffer.BaseAddress = DMA_REGION_BASE;
+#if (DMA_REGION_SIZE == 32768)
+	// SAI_TDM with 8 slots
+	MPU_Init_DMA_buffer.Size = ARM_MPU_REGION_SIZE_32KB;
+#elif (DMA_REGION_SIZE == 8192)
+	MPU_Init_DMA_buffer.Size = ARM_MPU_REGION_SIZE_8KB;
+#else
 	MPU_Init_DMA_buffer.Size = ARM_MPU_REGION_SIZE_16KB;
+#endif
 
 	// Set access restrictionss
 	MPU_Init_DMA_buffer.AccessPermission = MPU_REGION_FULL_ACCESS;
@@ -371,6 +2567,7 @@ void MPU_conf()
 
 	// reenable MPU
 	HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+#endif
 }
 
 /**
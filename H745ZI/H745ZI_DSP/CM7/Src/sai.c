@@ -0,0 +1,236 @@
+// sai.c, Michael Haselberger
+// Description: Initialization code for the SAI1 TDM interface (SAI_TDM), the alternative to I2S2 for codecs with more
+// than two channels. Block A sends as master (MCLK, bit clock and frame sync), block B receives synchronously to it,
+// both with SAI_TDM_SLOTS slots of 32 bit per frame. The DMA streams and their interrupts are those of the I2S
+// (MX_DMA_Init in i2s.c), the receive callbacks in main.c schedule the same blocks
+
+#include "sai.h"
+
+#if defined(SAI_TDM)
+
+SAI_HandleTypeDef hsai_tx;
+SAI_HandleTypeDef hsai_rx;
+DMA_HandleTypeDef hdma_sai_tx;
+DMA_HandleTypeDef hdma_sai_rx;
+
+// one block in TDM: frame sync one bit clock long before the first slot (DSP mode of the codecs), 24 bit data in
+// every 32 bit slot, all slots active. right aligned in the data register like the I2S words
+static void block_init(SAI_HandleTypeDef *hsai, SAI_Block_TypeDef *block, uint32_t mode, uint32_t synchro, uint32_t rate)
+{
+	hsai->Instance = block;
+	hsai->Init.AudioMode = mode;
+	hsai->Init.Synchro = synchro;
+	hsai->Init.SynchroExt = SAI_SYNCEXT_DISABLE;
+	hsai->Init.OutputDrive = SAI_OUTPUTDRIVE_ENABLE;
+	// master clock of 256 * fs, the bit clock is derived from it (frame of 128 or 256 bit)
+	hsai->Init.NoDivider = SAI_MASTERDIVIDER_ENABLE;
+	hsai->Init.MckOverSampling = SAI_MCK_OVERSAMPLING_DISABLE;
+	hsai->Init.FIFOThreshold = SAI_FIFOTHRESHOLD_1QF;
+	// the master block computes MCKDIV from the kernel clock (PLL2P, see AudioClock_Config in rcc.c)
+	hsai->Init.AudioFrequency = rate;
+	hsai->Init.MonoStereoMode = SAI_STEREOMODE;
+	hsai->Init.CompandingMode = SAI_NOCOMPANDING;
+	hsai->Init.TriState = SAI_OUTPUT_NOTRELEASED;
+	hsai->Init.PdmInit.Activation = DISABLE;
+
+	if (HAL_SAI_InitProtocol(hsai, SAI_PCM_SHORT, SAI_PROTOCOL_DATASIZE_24BIT, SAI_TDM_SLOTS) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+// SAI1 init function
+void MX_SAI1_Init(void)
+{
+	// the receiving block has no clock of its own, it's configured first and follows block A
+	block_init(&hsai_rx, SAI1_Block_B, SAI_MODESLAVE_RX, SAI_SYNCHRONOUS, AUDIO_SAMPLE_RATE);
+	block_init(&hsai_tx, SAI1_Block_A, SAI_MODEMASTER_TX, SAI_ASYNCHRONOUS, AUDIO_SAMPLE_RATE);
+}
+
+// one DMA stream of a block: words between the data register and the circular DMA buffer
+static void dma_init(DMA_HandleTypeDef *hdma, DMA_Stream_TypeDef *stream, uint32_t request, uint32_t direction)
+{
+	hdma->Instance = stream;
+	hdma->Init.Request = request;
+	hdma->Init.Direction = direction;
+	hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma->Init.MemInc = DMA_MINC_ENABLE;
+	hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	hdma->Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	hdma->Init.Mode = DMA_CIRCULAR;
+	hdma->Init.Priority = DMA_PRIORITY_VERY_HIGH;
+#if defined(DMA_FIFO)
+	// 4 words per memory burst, as the I2S streams (i2s.c)
+	hdma->Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+	hdma->Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+	hdma->Init.MemBurst = DMA_MBURST_INC4;
+	hdma->Init.PeriphBurst = DMA_PBURST_SINGLE;
+#else
+	hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+#endif
+	if (HAL_DMA_Init(hdma) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+// microcontroller support package - specific SAI init function
+void HAL_SAI_MspInit(SAI_HandleTypeDef *saiHandle)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	__HAL_RCC_SAI1_CLK_ENABLE();
+	__HAL_RCC_GPIOE_CLK_ENABLE();
+
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF6_SAI1;
+
+	if (saiHandle->Instance == SAI1_Block_A)
+	{
+		/*  SAI1 block A GPIO Configuration
+			PE2     ------> SAI1_MCLK_A
+			PE4     ------> SAI1_FS_A
+			PE5     ------> SAI1_SCK_A
+			PE6     ------> SAI1_SD_A
+		*/
+		GPIO_InitStruct.Pin = GPIO_PIN_2 | GPIO_PIN_4 | GPIO_PIN_5 | GPIO_PIN_6;
+		HAL_GPIO_Init(GPIOE, &GPIO_InitStruct);
+
+		// the streams of the I2S, which doesn't run with SAI_TDM
+		dma_init(&hdma_sai_tx, DMA1_Stream1, DMA_REQUEST_SAI1_A, DMA_MEMORY_TO_PERIPH);
+		__HAL_LINKDMA(saiHandle, hdmatx, hdma_sai_tx);
+	}
+	else if (saiHandle->Instance == SAI1_Block_B)
+	{
+		/*  SAI1 block B GPIO Configuration
+			PE3     ------> SAI1_SD_B
+		*/
+		GPIO_InitStruct.Pin = GPIO_PIN_3;
+		HAL_GPIO_Init(GPIOE, &GPIO_InitStruct);
+
+		dma_init(&hdma_sai_rx, DMA1_Stream0, DMA_REQUEST_SAI1_B, DMA_PERIPH_TO_MEMORY);
+		__HAL_LINKDMA(saiHandle, hdmarx, hdma_sai_rx);
+	}
+}
+
+void HAL_SAI_MspDeInit(SAI_HandleTypeDef *saiHandle)
+{
+	if (saiHandle->Instance == SAI1_Block_A)
+	{
+		HAL_GPIO_DeInit(GPIOE, GPIO_PIN_2 | GPIO_PIN_4 | GPIO_PIN_5 | GPIO_PIN_6);
+		HAL_DMA_DeInit(saiHandle->hdmatx);
+	}
+	else if (saiHandle->Instance == SAI1_Block_B)
+	{
+		HAL_GPIO_DeInit(GPIOE, GPIO_PIN_3);
+		HAL_DMA_DeInit(saiHandle->hdmarx);
+	}
+}
+
+/******************************************************************************
+* Function Name: sai_start
+*******************************************************************************
+* Summary:
+*  Start the circular transfers of both blocks, each buffer holding two blocks (ping and
+*  pong) of SAI_TDM_SLOTS words per frame. The synchronous receiver is enabled first and waits
+*  for the clocks, the transmitter then starts them: both blocks begin with the same frame.
+*  The half and complete callbacks of the receive stream mark the blocks (main.c).
+*
+* Parameters:
+*  1. uint32_t *tx					- Transmit DMA buffer.
+*  2. uint32_t *rx					- Receive DMA buffer.
+*  3. uint16_t block_size			- Samples per channel and block.
+* Return:
+*  253:								- A transfer couldn't be started.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t sai_start(uint32_t *tx, uint32_t *rx, uint16_t block_size)
+{
+	const uint16_t words = (uint16_t)(block_size * SAI_TDM_SLOTS * 2);
+
+	if (HAL_SAI_Receive_DMA(&hsai_rx, (uint8_t *)rx, words) != HAL_OK)
+	{
+		return 253;
+	}
+	if (HAL_SAI_Transmit_DMA(&hsai_tx, (uint8_t *)tx, words) != HAL_OK)
+	{
+		HAL_SAI_DMAStop(&hsai_rx);
+		return 253;
+	}
+	return 0;
+}
+
+// stop both transfers. the receiver first: a synchronous block is only disabled at the end of a frame, which needs
+// the clocks of the transmitter
+void sai_stop(void)
+{
+	HAL_SAI_DMAStop(&hsai_rx);
+	HAL_SAI_DMAStop(&hsai_tx);
+}
+
+/******************************************************************************
+* Function Name: sai_set_sample_rate
+*******************************************************************************
+* Summary:
+*  Initialize the master block again for a sample rate, after AudioClock_Config changed the
+*  kernel clock: HAL_SAI_Init derives MCKDIV from both. The receiver follows the clocks of the
+*  master. Both blocks have to be stopped (sai_stop).
+*
+* Parameters:
+*  1. uint32_t rate					- Sample rate in Hz.
+* Return:
+*  253:								- The block couldn't be initialized.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t sai_set_sample_rate(uint32_t rate)
+{
+	hsai_tx.Init.AudioFrequency = rate;
+	return (HAL_SAI_Init(&hsai_tx) != HAL_OK) ? 253 : 0;
+}
+
+/******************************************************************************
+* Function Name: sai_take_errors
+*******************************************************************************
+* Summary:
+*  Take and clear the error flags of both blocks: transmit underrun, receive overrun and the
+*  frame sync errors of the receiver (a sync pulse early or late: the slots have slipped).
+*  The interrupts of the SAI stay disabled, the main loop polls the flags like those of the
+*  I2S (audio_check_stream).
+*
+* Parameters:
+*  None.
+* Return:
+*  HAL_SAI_ERROR_* bits, 0 without errors.
+*
+******************************************************************************/
+uint32_t sai_take_errors(void)
+{
+	uint32_t errors = 0;
+
+	if (__HAL_SAI_GET_FLAG(&hsai_tx, SAI_FLAG_OVRUDR))
+	{
+		__HAL_SAI_CLEAR_FLAG(&hsai_tx, SAI_FLAG_OVRUDR);
+		errors |= HAL_SAI_ERROR_UDR;
+	}
+	if (__HAL_SAI_GET_FLAG(&hsai_rx, SAI_FLAG_OVRUDR))
+	{
+		__HAL_SAI_CLEAR_FLAG(&hsai_rx, SAI_FLAG_OVRUDR);
+		errors |= HAL_SAI_ERROR_OVR;
+	}
+	if (__HAL_SAI_GET_FLAG(&hsai_rx, SAI_FLAG_AFSDET))
+	{
+		__HAL_SAI_CLEAR_FLAG(&hsai_rx, SAI_FLAG_AFSDET);
+		errors |= HAL_SAI_ERROR_AFSDET;
+	}
+	if (__HAL_SAI_GET_FLAG(&hsai_rx, SAI_FLAG_LFSDET))
+	{
+		__HAL_SAI_CLEAR_FLAG(&hsai_rx, SAI_FLAG_LFSDET);
+		errors |= HAL_SAI_ERROR_LFSDET;
+	}
+	return errors;
+}
+#endif
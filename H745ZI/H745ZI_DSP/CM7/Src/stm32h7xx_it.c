@@ -3,12 +3,18 @@
 
 extern DMA_HandleTypeDef hdma_i2s2_rx;
 extern DMA_HandleTypeDef hdma_i2s2_tx;
+extern I2C_HandleTypeDef hi2c1;
 
 
 /* Private functions ---------------------------------------------------------*/
+// the receive and transmit streams of the audio interface: I2S2, or SAI1 with SAI_TDM (sai.c)
 void DMA1_Stream0_IRQHandler(void)
 {
+#if defined(SAI_TDM)
+	HAL_DMA_IRQHandler(&hdma_sai_rx);
+#else
 	HAL_DMA_IRQHandler(&hdma_i2s2_rx);
+#endif
 }
 
 /**
@@ -16,9 +22,109 @@ void DMA1_Stream0_IRQHandler(void)
   */
 void DMA1_Stream1_IRQHandler(void)
 {
+#if defined(SAI_TDM)
+	HAL_DMA_IRQHandler(&hdma_sai_tx);
+#else
 	HAL_DMA_IRQHandler(&hdma_i2s2_tx);
+#endif
 }
 
+#if defined(LOOPER) && !defined(LOOPER_ADPCM)
+extern looper_handle_t looper_handle[AUDIO_CHANNELS];
+#endif
+
+#if defined(MDMA_TRANSFER) || (defined(LOOPER) && !defined(LOOPER_ADPCM))
+/**
+  * @brief This function handles the MDMA interrupt (all channels): rx and tx staging transfers, looper transfers.
+  */
+void MDMA_IRQHandler(void)
+{
+#if defined(MDMA_TRANSFER)
+	HAL_MDMA_IRQHandler(&hmdma_rx);
+	HAL_MDMA_IRQHandler(&hmdma_tx);
+#endif
+#if defined(LOOPER) && !defined(LOOPER_ADPCM)
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		looper_irq_handler(&looper_handle[ch]);
+	}
+#endif
+}
+#endif
+
+#if !defined(CONTROL_M4)
+/**
+  * @brief This function handles the controls: the encoder push button (EXTI line 9) and the encoder edges (TIM2 capture).
+  */
+void EXTI9_5_IRQHandler(void)
+{
+	HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_9);
+}
+
+void TIM2_IRQHandler(void)
+{
+	HAL_TIM_IRQHandler(&htim2);
+}
+
+/**
+  * @brief This function handles I2C1 event and error interrupts (LCD framebuffer transfers).
+  */
+void I2C1_EV_IRQHandler(void)
+{
+	HAL_I2C_EV_IRQHandler(&hi2c1);
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+	HAL_I2C_ER_IRQHandler(&hi2c1);
+}
+#endif
+
+#if defined(MIDI)
+/**
+  * @brief This function handles the MIDI receive DMA and the USART2 (idle line, errors) interrupts.
+  */
+void DMA1_Stream2_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_midi_rx);
+}
+
+void USART2_IRQHandler(void)
+{
+	HAL_UART_IRQHandler(&huart_midi);
+}
+#endif
+
+#if defined(HOST_LINK)
+/**
+  * @brief This function handles the host link DMA streams and the USART3 (idle line, transfer complete, errors) interrupts.
+  */
+void DMA1_Stream3_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_host_rx);
+}
+
+void DMA1_Stream4_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_host_tx);
+}
+
+void USART3_IRQHandler(void)
+{
+	HAL_UART_IRQHandler(&huart_host);
+}
+#endif
+
+#if defined(USB_AUDIO)
+/**
+  * @brief This function handles the USB OTG FS interrupt (audio streaming to the host).
+  */
+void OTG_FS_IRQHandler(void)
+{
+	HAL_PCD_IRQHandler(&hpcd_usb);
+}
+#endif
+
 /******************************************************************************/
 /*            Cortex-M7 Processor Exceptions Handlers                         */
 /******************************************************************************/
@@ -89,9 +195,12 @@ void UsageFault_Handler(void)
   * @param  None
   * @retval None
   */
+// with RTOS the kernel port is the SVC and PendSV handler (FreeRTOSConfig.h)
+#if !defined(RTOS)
 void SVC_Handler(void)
 {
 }
+#endif
 
 /**
   * @brief  This function handles Debug Monitor exception.
@@ -107,9 +216,13 @@ void DebugMon_Handler(void)
   * @param  None
   * @retval None
   */
+#if !defined(RTOS)
 void PendSV_Handler(void)
 {
+	// pended by the I2S DMA callbacks
+	audio_process();
 }
+#endif
 
 /**
   * @brief  This function handles SysTick Handler.
@@ -120,6 +233,9 @@ void SysTick_Handler(void)
 {
 	HAL_IncTick();
 	HAL_SYSTICK_IRQHandler();
+#if defined(RTOS)
+	rtos_tick();
+#endif
 }
 
 /******************************************************************************/
@@ -0,0 +1,164 @@
+// adpcm.c, Michael Haselberger
+// Description: IMA-ADPCM codec for sample blocks stored in internal memory (the looper, looper.h). 4 bits per sample
+// instead of 16 for q15: a quarter of the memory for the same time, at a signal to noise ratio of about 38 dB for
+// tonal signals (q15: 90 dB).
+// The prediction makes the coding a serial recursion per sample, the conversion from and to the audio format around it
+// is done with one CMSIS vector call per block by the caller.
+
+#include <stdlib.h>
+#include "adpcm.h"
+
+// step sizes of the IMA standard, read for every sample
+static const int16_t adpcm_steps[ADPCM_MAX_INDEX + 1] DTCM_INIT =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+	1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+	7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+// change of the step index by the magnitude of a code
+static const int8_t adpcm_index_change[8] DTCM_INIT = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// the state before the first sample, the step size adapts within a few samples
+void adpcm_reset(adpcm_state_t *state)
+{
+	state->predictor = 0;
+	state->index = 0;
+}
+
+// start the encoder at a block instead of at silence: the prediction at its first sample, the step size at the
+// difference to the second. without it the smallest step takes a few samples to reach a loud signal
+void adpcm_prime(adpcm_state_t *state, const q15_t *src)
+{
+	const int32_t diff = abs((int32_t)src[1] - (int32_t)src[0]);
+	uint8_t index = 0;
+	while ((index < ADPCM_MAX_INDEX) && (adpcm_steps[index] < diff))
+	{
+		index++;
+	}
+	state->predictor = src[0];
+	state->index = index;
+}
+
+// the state a frame was coded from, from its header
+static inline void frame_state(const uint8_t *frame, adpcm_state_t *state)
+{
+	state->predictor = (int16_t)((uint16_t)frame[0] | ((uint16_t)frame[1] << 8));
+	state->index = (frame[2] > ADPCM_MAX_INDEX) ? ADPCM_MAX_INDEX : frame[2];
+}
+
+// next prediction and step index after a code, the same in encoder and decoder
+static inline void adpcm_step(int32_t *predictor, int32_t *index, uint32_t code)
+{
+	const int32_t step = adpcm_steps[*index];
+	int32_t delta = step >> 3;
+	if (code & 4)
+		delta += step;
+	if (code & 2)
+		delta += step >> 1;
+	if (code & 1)
+		delta += step >> 2;
+	const int32_t p = (code & 8) ? (*predictor - delta) : (*predictor + delta);
+	*predictor = (p > 32767) ? 32767 : (p < -32768) ? -32768 : p;
+	const int32_t i = *index + adpcm_index_change[code & 7];
+	*index = (i < 0) ? 0 : (i > ADPCM_MAX_INDEX) ? ADPCM_MAX_INDEX : i;
+}
+
+/******************************************************************************
+* Function Name: adpcm_encode
+*******************************************************************************
+* Summary:
+*  Encode a block into one frame: the header with the state of the encoder, then a code per
+*  sample, two per byte (the earlier sample in the low nibble). The state carries on to
+*  the next frame.
+*
+* Parameters:
+*  1. adpcm_state_t *state			- Encoder state.
+*  2. const q15_t *src				- Input block.
+*  3. uint8_t *frame				- ADPCM_FRAME_BYTES(block_size) bytes.
+*  4. uint32_t block_size			- Number of samples, even.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void adpcm_encode(adpcm_state_t *state, const q15_t *src, uint8_t *frame, uint32_t block_size)
+{
+	int32_t predictor = state->predictor;
+	int32_t index = state->index;
+	frame[0] = (uint8_t)(predictor & 0xFF);
+	frame[1] = (uint8_t)((uint32_t)predictor >> 8);
+	frame[2] = (uint8_t)index;
+	frame[3] = 0;
+	uint8_t *codes = &frame[ADPCM_HEADER_BYTES];
+
+	for (uint32_t i = 0; i < block_size; i += 2)
+	{
+		uint32_t pair = 0;
+		for (uint32_t k = 0; k < 2; ++k)
+		{
+			// the magnitude of the difference in steps, quantized the way the decoder adds it up
+			const int32_t step = adpcm_steps[index];
+			int32_t diff = (int32_t)src[i + k] - predictor;
+			uint32_t code = 0;
+			if (diff < 0)
+			{
+				code = 8;
+				diff = -diff;
+			}
+			if (diff >= step)
+			{
+				code |= 4;
+				diff -= step;
+			}
+			if (diff >= (step >> 1))
+			{
+				code |= 2;
+				diff -= step >> 1;
+			}
+			if (diff >= (step >> 2))
+			{
+				code |= 1;
+			}
+			adpcm_step(&predictor, &index, code);
+			pair |= code << (4 * k);
+		}
+		codes[i >> 1] = (uint8_t)pair;
+	}
+
+	state->predictor = (int16_t)predictor;
+	state->index = (uint8_t)index;
+}
+
+/******************************************************************************
+* Function Name: adpcm_decode
+*******************************************************************************
+* Summary:
+*  Decode a frame written by adpcm_encode. Needs nothing but the frame.
+*
+* Parameters:
+*  1. const uint8_t *frame			- ADPCM_FRAME_BYTES(block_size) bytes.
+*  2. q15_t *dst					- Output block.
+*  3. uint32_t block_size			- Number of samples, even.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void adpcm_decode(const uint8_t *frame, q15_t *dst, uint32_t block_size)
+{
+	adpcm_state_t state;
+	frame_state(frame, &state);
+	int32_t predictor = state.predictor;
+	int32_t index = state.index;
+	const uint8_t *codes = &frame[ADPCM_HEADER_BYTES];
+
+	for (uint32_t i = 0; i < block_size; i += 2)
+	{
+		const uint32_t pair = codes[i >> 1];
+		adpcm_step(&predictor, &index, pair & 0x0F);
+		dst[i] = (q15_t)predictor;
+		adpcm_step(&predictor, &index, pair >> 4);
+		dst[i + 1] = (q15_t)predictor;
+	}
+}
@@ -0,0 +1,47 @@
+// adpcm.h, Michael Haselberger
+// Description: This file contains declarations for the IMA-ADPCM codec implemented in adpcm.c
+
+#ifndef __ADPCM_H__
+#define __ADPCM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// header of a frame: predictor (int16) and step index (uint8) before the first sample, one byte padding
+#define ADPCM_HEADER_BYTES (4)
+// bytes of a frame of n samples (n even, at least 2): the header and 4 bits per sample
+#define ADPCM_FRAME_BYTES(n) (ADPCM_HEADER_BYTES + (n) / 2)
+// highest step index of the IMA step table
+#define ADPCM_MAX_INDEX (88)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   IMA-ADPCM coder state. Every sample is coded as 4 bits: the difference to the prediction (the last decoded sample) in
+*   steps of an adaptive step size, which grows with large differences and shrinks with small ones. A frame starts with
+*   the state it was coded from, so every frame decodes on its own (random access by frame, e.g. the blocks of a loop),
+*   while the encoder carries its state from frame to frame.
+*
+*   Members:
+*   predictor:          Last decoded sample.
+*   index:              Index of the step size in the IMA table (0 to ADPCM_MAX_INDEX).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	int16_t predictor;
+	uint8_t index;
+} adpcm_state_t;
+
+void adpcm_reset(adpcm_state_t *state);
+void adpcm_prime(adpcm_state_t *state, const q15_t *src);
+void adpcm_encode(adpcm_state_t *state, const q15_t *src, uint8_t *frame, uint32_t block_size);
+void adpcm_decode(const uint8_t *frame, q15_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __ADPCM_H__
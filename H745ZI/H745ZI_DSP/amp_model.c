@@ -0,0 +1,362 @@
+// amp_model.c, Michael Haselberger
+// Description: Inference engine for small captured amp models (one LSTM or GRU layer, a dense output and a post-filter),
+// in place of the fixed overdrive and fuzz curves. The recurrent layer runs sample by sample: a matrix-vector product of
+// the recurrent weights with the hidden state, four gate rows per pass, and the gate activations from a tanh table.
+// The weights and the table are in AXI SRAM (through the data cache), DTCM has no room left for them. The cost grows with
+// the square of the hidden units, the benchmark (benchmark.c) reports it per model size next to the cycles a sample may take.
+
+#include <stddef.h>
+#include <string.h>
+#include "amp_model.h"
+
+// tanh is tabulated over [-AMP_TANH_RANGE, AMP_TANH_RANGE] and linearly interpolated, the error stays below 3e-5.
+// it is +-1 within 1e-6 outside the range
+#define AMP_TANH_RANGE (8.0f)
+#define AMP_TANH_TABLE_SIZE (1024)
+
+// last point repeated, so the interpolation at the upper end of the range stays in the table
+static float32_t __attribute__((aligned(32))) tanh_table[AMP_TANH_TABLE_SIZE + 2];
+static bool table_ready = false;
+// serial of the next prepared or cleared model
+static uint32_t next_serial = 1;
+
+// weights of a model by their part, see amp_model_t
+typedef struct
+{
+	const float32_t *w_in;
+	const float32_t *w_rec;
+	const float32_t *b_in;
+	const float32_t *b_rec;
+	const float32_t *w_out;
+	const float32_t *b_out;
+	const float32_t *post;
+} amp_layout_t;
+
+static inline uint32_t gates_of(uint32_t cell, uint32_t hidden)
+{
+	return ((cell == AMP_LSTM) ? 4 : 3) * hidden;
+}
+
+static inline void layout_of(const amp_model_t *model, amp_layout_t *layout)
+{
+	const uint32_t gates = gates_of(model->cell, model->hidden);
+	layout->w_in = model->weights;
+	layout->w_rec = layout->w_in + gates;
+	layout->b_in = layout->w_rec + gates * model->hidden;
+	layout->b_rec = layout->b_in + gates;
+	layout->w_out = layout->b_rec + gates;
+	layout->b_out = layout->w_out + model->hidden;
+	layout->post = layout->b_out + 1;
+}
+
+// tanh of the gate activations, from the table
+static inline float32_t table_tanh(float32_t x)
+{
+	const float32_t position = (fminf(fmaxf(x, -AMP_TANH_RANGE), AMP_TANH_RANGE) + AMP_TANH_RANGE)
+		* (AMP_TANH_TABLE_SIZE / (2.0f * AMP_TANH_RANGE));
+	const uint32_t index = (uint32_t)position;
+	const float32_t frac = position - (float32_t)index;
+	const float32_t y0 = tanh_table[index];
+	return y0 + frac * (tanh_table[index + 1] - y0);
+}
+
+// logistic sigmoid of the gates, 1 / (1 + e^-x) = (1 + tanh(x / 2)) / 2
+static inline float32_t table_sigmoid(float32_t x)
+{
+	return 0.5f + 0.5f * table_tanh(0.5f * x);
+}
+
+/******************************************************************************
+* Function Name: matvec_add
+*******************************************************************************
+* Summary:
+*  acc += w * h for a row-major matrix of rows x hidden. Four rows share every load of the
+*  hidden state and accumulate in four independent registers, so the FPU pipeline stays busy
+*  instead of waiting for one chain of multiply-adds. rows has to be a multiple of four.
+*
+******************************************************************************/
+static inline void matvec_add(const float32_t *w, const float32_t *h, float32_t *acc, uint32_t rows, uint32_t hidden)
+{
+	for (uint32_t r = 0; r < rows; r += 4)
+	{
+		const float32_t *w0 = &w[r * hidden];
+		const float32_t *w1 = w0 + hidden;
+		const float32_t *w2 = w1 + hidden;
+		const float32_t *w3 = w2 + hidden;
+		float32_t a0 = acc[r];
+		float32_t a1 = acc[r + 1];
+		float32_t a2 = acc[r + 2];
+		float32_t a3 = acc[r + 3];
+		for (uint32_t j = 0; j < hidden; ++j)
+		{
+			const float32_t x = h[j];
+			a0 += w0[j] * x;
+			a1 += w1[j] * x;
+			a2 += w2[j] * x;
+			a3 += w3[j] * x;
+		}
+		acc[r] = a0;
+		acc[r + 1] = a1;
+		acc[r + 2] = a2;
+		acc[r + 3] = a3;
+	}
+}
+
+/******************************************************************************
+* Function Name: amp_model_check
+*******************************************************************************
+* Summary:
+*  Check the header of a model (image or library entry).
+*
+* Parameters:
+*  1. uint32_t cell					- amp_cell.
+*  2. uint32_t hidden				- Hidden units.
+*  3. uint32_t skip					- 0 or 1.
+*  4. uint32_t post_stages			- Biquads of the post-filter.
+* Return:
+*  254:								- Unknown cell, hidden units not 4 to AMP_MODEL_MAX_HIDDEN in steps of 4,
+*									  or too many post-filter stages.
+*    0:								- The engine runs the model.
+*
+******************************************************************************/
+uint8_t amp_model_check(uint32_t cell, uint32_t hidden, uint32_t skip, uint32_t post_stages)
+{
+	if ((cell > AMP_GRU) || (hidden == 0) || (hidden > AMP_MODEL_MAX_HIDDEN) || (hidden % AMP_MODEL_HIDDEN_STEP)
+		|| (skip > 1) || (post_stages > AMP_MODEL_MAX_POST))
+	{
+		return 254;
+	}
+	return 0;
+}
+
+// floats of a model of this size (see amp_model_t)
+uint32_t amp_model_weights(uint32_t cell, uint32_t hidden, uint32_t post_stages)
+{
+	return gates_of(cell, hidden) * (hidden + 3) + hidden + 1 + 5 * post_stages;
+}
+
+/******************************************************************************
+* Function Name: amp_model_load
+*******************************************************************************
+* Summary:
+*  Load a model image that is memory-mapped (internal flash, QSPI) and prepare it. The image
+*  is the payload of a library entry of kind LIBRARY_AMP: AMP_MODEL_HEADER uint32_t, then the
+*  floats. Main loop, into a model the audio path doesn't run (see amp_load in fx_lib.h).
+*
+* Parameters:
+*  1. amp_model_t *model			- Address pointer of the model struct.
+*  2. const void *image				- Start of the image, 4-byte aligned.
+*  3. uint32_t size					- Bytes of the image.
+* Return:
+*  255:								- Model or image point to NULL.
+*  254:								- See amp_model_check, or the size doesn't match the header.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t amp_model_load(amp_model_t *model, const void *image, uint32_t size)
+{
+	if ((model == NULL) || (image == NULL))
+	{
+		return 255;
+	}
+	const uint32_t *header = image;
+	if ((size < AMP_MODEL_HEADER * sizeof(uint32_t)) || amp_model_check(header[0], header[1], header[2], header[3]))
+	{
+		return 254;
+	}
+	const uint32_t floats = amp_model_weights(header[0], header[1], header[3]);
+	if (size != (AMP_MODEL_HEADER + floats) * sizeof(uint32_t))
+	{
+		return 254;
+	}
+	model->cell = header[0];
+	model->hidden = header[1];
+	model->skip = header[2];
+	model->post_stages = header[3];
+	memcpy(model->weights, &header[AMP_MODEL_HEADER], floats * sizeof(float32_t));
+	return amp_model_prepare(model);
+}
+
+/******************************************************************************
+* Function Name: amp_model_prepare
+*******************************************************************************
+* Summary:
+*  Make a loaded model ready to run: the recurrent biases of the LSTM are added to the input
+*  biases (they are always summed), and the model gets a new serial. The tanh table is
+*  computed by the first call.
+*
+* Parameters:
+*  1. amp_model_t *model			- Model with header and weights written.
+* Return:
+*  254:								- See amp_model_check.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t amp_model_prepare(amp_model_t *model)
+{
+	if (amp_model_check(model->cell, model->hidden, model->skip, model->post_stages))
+	{
+		return 254;
+	}
+	if (!table_ready)
+	{
+		for (uint32_t i = 0; i <= AMP_TANH_TABLE_SIZE; ++i)
+		{
+			tanh_table[i] = tanhf(-AMP_TANH_RANGE + (2.0f * AMP_TANH_RANGE) * i / AMP_TANH_TABLE_SIZE);
+		}
+		tanh_table[AMP_TANH_TABLE_SIZE + 1] = tanh_table[AMP_TANH_TABLE_SIZE];
+		table_ready = true;
+	}
+	if (model->cell == AMP_LSTM)
+	{
+		amp_layout_t layout;
+		layout_of(model, &layout);
+		// zeroed, so preparing the same model again doesn't add them twice
+		float32_t *b_in = (float32_t *)layout.b_in;
+		float32_t *b_rec = (float32_t *)layout.b_rec;
+		const uint32_t gates = gates_of(model->cell, model->hidden);
+		arm_add_f32(b_in, b_rec, b_in, gates);
+		memset(b_rec, 0, gates * sizeof(float32_t));
+	}
+	model->serial = next_serial++;
+	return 0;
+}
+
+// no model: the engine passes the input through
+void amp_model_clear(amp_model_t *model)
+{
+	model->hidden = 0;
+	model->post_stages = 0;
+	model->serial = next_serial++;
+}
+
+// bytes of the model struct in use, what has to be copied to hand it over
+uint32_t amp_model_size(const amp_model_t *model)
+{
+	const uint32_t floats = (model->hidden > 0) ? amp_model_weights(model->cell, model->hidden, model->post_stages) : 0;
+	return offsetof(amp_model_t, weights) + floats * sizeof(float32_t);
+}
+
+// post-filter coefficients (5 per stage), e.g. for the M4 (AMP_POST_M4)
+const float32_t* amp_model_post(const amp_model_t *model)
+{
+	amp_layout_t layout;
+	layout_of(model, &layout);
+	return layout.post;
+}
+
+/******************************************************************************
+* Function Name: amp_state_reset
+*******************************************************************************
+* Summary:
+*  Clear the hidden, cell and filter states and set the post-filter up for a model. Call
+*  whenever the model changes.
+*
+* Parameters:
+*  1. amp_state_t *state			- Address pointer of the state struct.
+*  2. const amp_model_t *model		- Model the state is used with. Its coefficients are used in place.
+* Return:
+*  None.
+*
+******************************************************************************/
+void amp_state_reset(amp_state_t *state, const amp_model_t *model)
+{
+	memset(state->h, 0, sizeof(state->h));
+	memset(state->c, 0, sizeof(state->c));
+	memset(state->post_state, 0, sizeof(state->post_state));
+	if ((model->hidden > 0) && (model->post_stages > 0))
+	{
+		arm_biquad_cascade_df2T_init_f32(&state->post, model->post_stages, (float32_t *)amp_model_post(model), state->post_state);
+	}
+}
+
+/******************************************************************************
+* Function Name: amp_model_process
+*******************************************************************************
+* Summary:
+*  Run the recurrent layer and the dense output on a block, without the post-filter. Per
+*  sample, the LSTM computes its four gates as input weight * x + bias + recurrent weights *
+*  h (the matrix-vector product is the bulk of the cost: 4 * hidden^2 multiply-adds), then c
+*  and h. The GRU keeps the recurrent part of its new-gate apart, the reset gate scales it.
+*  Without a model, the input passes through.
+*
+* Parameters:
+*  1. const amp_model_t *model		- Prepared model.
+*  2. amp_state_t *state			- State of the channel.
+*  3. const float32_t *src			- Input block.
+*  4. float32_t *dst				- Output block. May be src.
+*  5. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void amp_model_process(const amp_model_t *model, amp_state_t *state, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	float32_t acc[AMP_MODEL_MAX_GATES];
+	const uint32_t hidden = model->hidden;
+	const uint32_t gates = gates_of(model->cell, hidden);
+	const float32_t skip = (float32_t)model->skip;
+	float32_t *h = state->h;
+	float32_t *c = state->c;
+	amp_layout_t l;
+
+	if (hidden == 0)
+	{
+		if (dst != src)
+			arm_copy_f32(src, dst, block_size);
+		return;
+	}
+	layout_of(model, &l);
+
+	for (uint32_t n = 0; n < block_size; ++n)
+	{
+		const float32_t x = src[n];
+		if (model->cell == AMP_LSTM)
+		{
+			for (uint32_t k = 0; k < gates; ++k)
+			{
+				acc[k] = l.b_in[k] + l.w_in[k] * x;
+			}
+			matvec_add(l.w_rec, h, acc, gates, hidden);
+			for (uint32_t u = 0; u < hidden; ++u)
+			{
+				const float32_t i = table_sigmoid(acc[u]);
+				const float32_t f = table_sigmoid(acc[hidden + u]);
+				const float32_t g = table_tanh(acc[2 * hidden + u]);
+				const float32_t o = table_sigmoid(acc[3 * hidden + u]);
+				c[u] = f * c[u] + i * g;
+				h[u] = o * table_tanh(c[u]);
+			}
+		}
+		else
+		{
+			arm_copy_f32(l.b_rec, acc, gates);
+			matvec_add(l.w_rec, h, acc, gates, hidden);
+			for (uint32_t u = 0; u < hidden; ++u)
+			{
+				const float32_t r = table_sigmoid(l.b_in[u] + l.w_in[u] * x + acc[u]);
+				const float32_t z = table_sigmoid(l.b_in[hidden + u] + l.w_in[hidden + u] * x + acc[hidden + u]);
+				const float32_t g = table_tanh(l.b_in[2 * hidden + u] + l.w_in[2 * hidden + u] * x + r * acc[2 * hidden + u]);
+				h[u] = g + z * (h[u] - g);
+			}
+		}
+		float32_t y;
+		arm_dot_prod_f32(l.w_out, h, hidden, &y);
+		dst[n] = y + *l.b_out + skip * x;
+	}
+}
+
+// post-filter of the model on a block. may run in place
+#pragma optimize_for_speed
+ITCM_CODE void amp_model_filter(const amp_model_t *model, amp_state_t *state, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	if ((model->hidden > 0) && (model->post_stages > 0))
+	{
+		arm_biquad_cascade_df2T_f32(&state->post, src, dst, block_size);
+	}
+	else if (dst != src)
+	{
+		arm_copy_f32(src, dst, block_size);
+	}
+}
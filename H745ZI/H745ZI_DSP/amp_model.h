@@ -0,0 +1,100 @@
+// amp_model.h, Michael Haselberger
+// Description: This file contains declarations for the recurrent amp model inference engine implemented in amp_model.c
+
+#ifndef __AMP_MODEL_H__
+#define __AMP_MODEL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// hidden units of the recurrent layer: 4 to 32 in steps of 4 (the matrix-vector kernel computes four gate rows per pass)
+#define AMP_MODEL_MAX_HIDDEN (32)
+#define AMP_MODEL_HIDDEN_STEP (4)
+// biquads of the post-filter behind the dense output (tone stack or cabinet fitted with the capture)
+#define AMP_MODEL_MAX_POST (4)
+// gate rows of the largest cell (LSTM: input, forget, cell, output)
+#define AMP_MODEL_MAX_GATES (4 * AMP_MODEL_MAX_HIDDEN)
+// floats of the largest model: input weights, recurrent weights, input and recurrent biases, dense weights and bias,
+// post-filter coefficients (b0, b1, b2, a1, a2 per biquad as arm_biquad_cascade_df2T_f32 takes them)
+#define AMP_MODEL_MAX_WEIGHTS (AMP_MODEL_MAX_GATES * (AMP_MODEL_MAX_HIDDEN + 3) + AMP_MODEL_MAX_HIDDEN + 1 + 5 * AMP_MODEL_MAX_POST)
+// header of a model image (dsp_helpers.export_library, kind "amp"): cell, hidden, skip, post_stages as uint32_t
+#define AMP_MODEL_HEADER (4)
+
+typedef enum
+{
+	// gates in the order of PyTorch: input, forget, cell, output
+	AMP_LSTM = 0,
+	// gates in the order of PyTorch: reset, update, new
+	AMP_GRU
+} amp_cell;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Captured amp model: one recurrent layer (LSTM or GRU) on the input sample, a dense layer from the hidden state to the
+*   output sample, optionally the input added to it (skip: the model learns the difference to the dry signal), and a
+*   post-filter. The weights are stored packed for the model's size, in the order of the image:
+*
+*   w_in:               Input weights, one per gate row (gates * hidden).
+*   w_rec:              Recurrent weights, row-major: the row of a gate unit holds its weights of all hidden units
+*                       (gates * hidden * hidden).
+*   b_in, b_rec:        Input and recurrent biases (gates * hidden each). amp_model_prepare adds b_rec to b_in for the LSTM.
+*   w_out, b_out:       Dense output layer (hidden + 1).
+*   post:               Post-filter coefficients (5 * post_stages).
+*
+*   The model the audio path runs is kept in AXI SRAM: the recurrent weights are read once per sample, 16 KB for 32 LSTM
+*   units, as much as the data cache holds. DTCM has no room for them next to the buffers of the chain.
+*
+*   Members:
+*   cell:               amp_cell.
+*   hidden:             Hidden units. 0: no model, the input passes through.
+*   skip:               1: the input is added to the dense output.
+*   post_stages:        Biquads of the post-filter, 0 to AMP_MODEL_MAX_POST.
+*   serial:             Set by amp_model_prepare, tells a prepared model from the one it replaces.
+*   weights:            Weights and coefficients, see above.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t cell;
+	uint32_t hidden;
+	uint32_t skip;
+	uint32_t post_stages;
+	uint32_t serial;
+	float32_t weights[AMP_MODEL_MAX_WEIGHTS];
+} amp_model_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   State of one channel running a model.
+*
+*   Members:
+*   h, c:               Hidden state and (LSTM) cell state.
+*   post:               CMSIS biquad cascade of the post-filter and its state.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t h[AMP_MODEL_MAX_HIDDEN];
+	float32_t c[AMP_MODEL_MAX_HIDDEN];
+	arm_biquad_cascade_df2T_instance_f32 post;
+	float32_t post_state[2 * AMP_MODEL_MAX_POST];
+} amp_state_t;
+
+uint8_t amp_model_check(uint32_t cell, uint32_t hidden, uint32_t skip, uint32_t post_stages);
+uint32_t amp_model_weights(uint32_t cell, uint32_t hidden, uint32_t post_stages);
+uint8_t amp_model_load(amp_model_t *model, const void *image, uint32_t size);
+uint8_t amp_model_prepare(amp_model_t *model);
+void amp_model_clear(amp_model_t *model);
+uint32_t amp_model_size(const amp_model_t *model);
+const float32_t* amp_model_post(const amp_model_t *model);
+void amp_state_reset(amp_state_t *state, const amp_model_t *model);
+void amp_model_process(const amp_model_t *model, amp_state_t *state, const float32_t *src, float32_t *dst, uint32_t block_size);
+void amp_model_filter(const amp_model_t *model, amp_state_t *state, const float32_t *src, float32_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __AMP_MODEL_H__
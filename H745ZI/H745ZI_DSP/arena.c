@@ -0,0 +1,273 @@
+// arena.c, Michael Haselberger
+// Description: Memory arenas over DTCM, RAM_D1, RAM_D2 and RAM_D3 for the effect buffers. Instead of one hand-placed static
+// array per effect, an effect asks for memory of an access speed class. Buffers it always needs are taken at init, the
+// large ones when it enters the chain and given back when it leaves, so effects that are never active at the same time
+// share the memory. Grown out of the ring buffer pool (ring_buffer.c).
+
+#include <string.h>
+#include "arena.h"
+#include "scratch_pool.h"
+
+#if ((ARENA_TCM_SIZE + SCRATCH_POOL_SIZE + DTCM_FIXED_SIZE) > DTCM_SIZE)
+#error "DTCM budget exceeded: ARENA_TCM_SIZE + SCRATCH_POOL_SIZE + DTCM_FIXED_SIZE > DTCM_SIZE (see arena.h)"
+#endif
+
+static uint8_t __attribute__((aligned(ARENA_ALIGN))) DTCM_BSS arena_tcm_memory[ARENA_TCM_SIZE];
+static uint8_t __attribute__((aligned(ARENA_ALIGN))) RAM_SECTION(".arena_d1") arena_d1_memory[ARENA_D1_SIZE];
+static uint8_t __attribute__((aligned(ARENA_ALIGN))) RAM_SECTION(".delay_buffer") arena_d2_memory[ARENA_D2_SIZE];
+static uint8_t __attribute__((aligned(ARENA_ALIGN))) RAM_SECTION(".arena_d3") arena_d3_memory[ARENA_D3_SIZE];
+
+// all start as one free block over the whole memory, no init call needed
+static arena_t arenas[ARENA_CLASSES] = {
+	[ARENA_TCM] = { arena_tcm_memory, ARENA_TCM_SIZE, { { 0, ARENA_TCM_SIZE, 0 } }, 1, 1, 0, 0 },
+	[ARENA_AXI] = { arena_d1_memory, ARENA_D1_SIZE, { { 0, ARENA_D1_SIZE, 0 } }, 1, 1, 0, 0 },
+	[ARENA_AHB] = { arena_d2_memory, ARENA_D2_SIZE, { { 0, ARENA_D2_SIZE, 0 } }, 1, 1, 0, 0 },
+	[ARENA_SHARED] = { arena_d3_memory, ARENA_D3_SIZE, { { 0, ARENA_D3_SIZE, 0 } }, 1, 1, 0, 0 },
+};
+
+// split block i into a block of size bytes and a free block with the rest. 0 if no descriptor is left
+static uint8_t split(arena_t *arena, size_t i, size_t size)
+{
+	if (arena->count >= ARENA_MAX_BLOCKS)
+	{
+		return 0;
+	}
+	arena_block_t *blocks = arena->blocks;
+	memmove(&blocks[i + 2], &blocks[i + 1], (arena->count - i - 1) * sizeof(blocks[0]));
+	blocks[i + 1].offset = blocks[i].offset + size;
+	blocks[i + 1].size = blocks[i].size - size;
+	blocks[i + 1].sequence = 0;
+	blocks[i].size = size;
+	arena->count++;
+	return 1;
+}
+
+// free block i and merge it with free neighbours. returns the index of the resulting free block
+static size_t free_block(arena_t *arena, size_t i)
+{
+	arena_block_t *blocks = arena->blocks;
+	arena->used -= blocks[i].size;
+	blocks[i].sequence = 0;
+	// merge with the following block
+	if ((i + 1 < arena->count) && (blocks[i + 1].sequence == 0))
+	{
+		blocks[i].size += blocks[i + 1].size;
+		memmove(&blocks[i + 1], &blocks[i + 2], (arena->count - i - 2) * sizeof(blocks[0]));
+		arena->count--;
+	}
+	// merge with the preceding block
+	if ((i > 0) && (blocks[i - 1].sequence == 0))
+	{
+		blocks[i - 1].size += blocks[i].size;
+		memmove(&blocks[i], &blocks[i + 1], (arena->count - i - 1) * sizeof(blocks[0]));
+		arena->count--;
+		--i;
+	}
+	return i;
+}
+
+/******************************************************************************
+* Function Name: arena_alloc_aligned
+*******************************************************************************
+* Summary:
+*  Take a buffer of the requested size and alignment from an arena (first-fit). The size is
+*  rounded up to ARENA_ALIGN. A larger alignment leaves the gap in front of the buffer free
+*  for later, smaller requests.
+*
+* Parameters:
+*  1. arena_class cls				- Access speed class of the buffer.
+*  2. size_t size					- The amount of bytes required.
+*  3. size_t align					- Alignment in bytes, a power of two. Below ARENA_ALIGN, ARENA_ALIGN is used.
+* Return:
+*  Address of the buffer, or NULL if the arena cannot satisfy the request.
+*
+******************************************************************************/
+void *arena_alloc_aligned(arena_class cls, size_t size, size_t align)
+{
+	if ((cls >= ARENA_CLASSES) || (align & (align - 1)))
+	{
+		return NULL;
+	}
+	if (align < ARENA_ALIGN)
+	{
+		align = ARENA_ALIGN;
+	}
+	size = (size + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1);
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	arena_t *arena = &arenas[cls];
+	arena_block_t *blocks = arena->blocks;
+	for (size_t i = 0; i < arena->count; ++i)
+	{
+		if (blocks[i].sequence != 0)
+			continue;
+		const uintptr_t start = (uintptr_t)&arena->memory[blocks[i].offset];
+		const size_t pad = ((start + align - 1) & ~((uintptr_t)align - 1)) - start;
+		if (blocks[i].size < pad + size)
+			continue;
+		// the gap in front stays a free block of its own
+		if (pad)
+		{
+			if (!split(arena, i, pad))
+				continue;
+			++i;
+		}
+		// if no descriptor is left for the remainder, the whole block is handed out, which wastes it, but stays correct
+		if (blocks[i].size > size)
+		{
+			split(arena, i, size);
+		}
+		blocks[i].sequence = arena->sequence++;
+		arena->used += blocks[i].size;
+		if (arena->used > arena->high_water)
+		{
+			arena->high_water = arena->used;
+		}
+		return &arena->memory[blocks[i].offset];
+	}
+
+	return NULL;
+}
+
+/******************************************************************************
+* Function Name: arena_alloc
+*******************************************************************************
+* Summary:
+*  Take a cache line aligned buffer from an arena (see arena_alloc_aligned).
+*
+* Parameters:
+*  1. arena_class cls				- Access speed class of the buffer.
+*  2. size_t size					- The amount of bytes required.
+* Return:
+*  Address of the buffer, or NULL if the arena cannot satisfy the request.
+*
+******************************************************************************/
+void *arena_alloc(arena_class cls, size_t size)
+{
+	return arena_alloc_aligned(cls, size, ARENA_ALIGN);
+}
+
+/******************************************************************************
+* Function Name: arena_free
+*******************************************************************************
+* Summary:
+*  Return a buffer to the arena it was taken from and merge it with free neighbouring blocks.
+*
+* Parameters:
+*  1. void *buffer					- Address previously returned by arena_alloc. NULL is ignored.
+* Return:
+*  None.
+*
+******************************************************************************/
+void arena_free(void *buffer)
+{
+	for (uint8_t c = 0; (buffer != NULL) && (c < ARENA_CLASSES); ++c)
+	{
+		arena_t *arena = &arenas[c];
+		if (((uint8_t *)buffer < arena->memory) || ((uint8_t *)buffer >= &arena->memory[arena->size]))
+			continue;
+
+		const size_t offset = (uint8_t *)buffer - arena->memory;
+		for (size_t i = 0; i < arena->count; ++i)
+		{
+			if ((arena->blocks[i].offset == offset) && (arena->blocks[i].sequence != 0))
+			{
+				free_block(arena, i);
+				return;
+			}
+		}
+		return;
+	}
+}
+
+/******************************************************************************
+* Function Name: arena_mark
+*******************************************************************************
+* Summary:
+*  Open a scope: everything allocated from now on can be freed at once with arena_release.
+*
+* Parameters:
+*  1. arena_class cls				- Access speed class.
+* Return:
+*  Mark to pass to arena_release.
+*
+******************************************************************************/
+arena_mark_t arena_mark(arena_class cls)
+{
+	return (cls < ARENA_CLASSES) ? arenas[cls].sequence : 0;
+}
+
+/******************************************************************************
+* Function Name: arena_release
+*******************************************************************************
+* Summary:
+*  Free every buffer allocated after the mark was taken, buffers from before stay. A mark of 0
+*  resets the whole arena.
+*
+* Parameters:
+*  1. arena_class cls				- Access speed class.
+*  2. arena_mark_t mark				- Mark returned by arena_mark.
+* Return:
+*  None.
+*
+******************************************************************************/
+void arena_release(arena_class cls, arena_mark_t mark)
+{
+	if (cls >= ARENA_CLASSES)
+	{
+		return;
+	}
+	arena_t *arena = &arenas[cls];
+	for (size_t i = 0; i < arena->count; ++i)
+	{
+		if ((arena->blocks[i].sequence != 0) && (arena->blocks[i].sequence >= mark))
+		{
+			i = free_block(arena, i);
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: arena_available
+*******************************************************************************
+* Summary:
+*  Get the size of the largest free block of an arena.
+*
+* Parameters:
+*  1. arena_class cls				- Access speed class.
+* Return:
+*  The largest amount of bytes a single arena_alloc call can currently return.
+*
+******************************************************************************/
+size_t arena_available(arena_class cls)
+{
+	size_t largest = 0;
+	for (size_t i = 0; (cls < ARENA_CLASSES) && (i < arenas[cls].count); ++i)
+	{
+		if ((arenas[cls].blocks[i].sequence == 0) && (arenas[cls].blocks[i].size > largest))
+		{
+			largest = arenas[cls].blocks[i].size;
+		}
+	}
+	return largest;
+}
+
+/******************************************************************************
+* Function Name: arena_get
+*******************************************************************************
+* Summary:
+*  Get an arena for reporting (size, used, high_water).
+*
+* Parameters:
+*  1. arena_class cls				- Access speed class.
+* Return:
+*  The arena, or NULL for an unknown class.
+*
+******************************************************************************/
+const arena_t *arena_get(arena_class cls)
+{
+	return (cls < ARENA_CLASSES) ? &arenas[cls] : NULL;
+}
@@ -0,0 +1,120 @@
+// arena.h, Michael Haselberger
+// Description: This file contains declarations for the effect memory arenas implemented in arena.c
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "defines_and_constants.h"
+
+// DTCM arena (DTCM_BSS). state read every block: cabinet filter memory 32 KB, limiter lookahead lines 2 KB per channel,
+// REVERB_FDN work chunk 2 KB (checked in fx_lib.c)
+#ifndef ARENA_TCM_SIZE
+#if (AUDIO_CHANNELS == 2)
+#define ARENA_TCM_SIZE (40 * 1024)
+#else
+#define ARENA_TCM_SIZE (36 * 1024)
+#endif
+#endif
+// DTCM budget (DTCMRAM, STM32H745ZITx_FLASH_CM7.ld). the arena and the scratch pool (scratch_pool.h) are sized against
+// what the fixed DTCM data leaves: the waveshaper tables, the oversampler and FIR states, the wavetables, the staging
+// and fade buffers of the path (about 72 KB with one channel). two channels double the waveshaper and oversampler
+// pools, the oversampler runs in shorter chunks then (OVERSAMPLER_CHUNK_SIZE) and the total stays at about 74 KB.
+// arena.c stops the build if the sum doesn't fit, the linker script checks the exact sizes
+#define DTCM_SIZE (128 * 1024)
+#ifndef DTCM_FIXED_SIZE
+#define DTCM_FIXED_SIZE (76 * 1024)
+#endif
+// RAM_D1 arena (.arena_d1 section, behind the DMA region). sized for the reverb spectra: NU_CONVOLVER_MEMORY(REVERB_MAX_IR_LENGTH)
+// floats = 449 KB (checked in fx_lib.c). REVERB_FDN: the delay lines of the network, FDN_MEMORY_SIZE = 128 KB
+#ifndef ARENA_D1_SIZE
+#if defined(REVERB_FDN)
+#define ARENA_D1_SIZE (128 * 1024)
+#else
+#define ARENA_D1_SIZE (450 * 1024)
+#endif
+#endif
+// RAM_D2 arena (.delay_buffer section, 288 KB): the delay, chorus, flanger and pitch shifter lines and pool ring buffers (ring_buffer.h)
+#ifndef ARENA_D2_SIZE
+#if (AUDIO_CHANNELS == 2)
+// dual mono needs the delay, chorus and flanger lines twice: 2 * (128 + 8 + 4) KB. the lines are only held while their
+// effect is selected or fading, the pitch shifter (2 * 8 KB) comes at most together with the delay: 2 * (128 + 8) KB
+#define ARENA_D2_SIZE (280 * 1024)
+#else
+#define ARENA_D2_SIZE (256 * 1024)
+#endif
+#endif
+// RAM_D3 arena (.arena_d3 section, between the inter-core mailbox and the M4 memory, see both linker scripts)
+#ifndef ARENA_D3_SIZE
+#define ARENA_D3_SIZE (4 * 1024)
+#endif
+// Default alignment (and allocation granularity) of the buffers. 32 bytes = cache line width
+#define ARENA_ALIGN (32)
+// Maximum amount of blocks (used and free) one arena can be split into
+#define ARENA_MAX_BLOCKS (16)
+
+// the arenas by access speed, fastest first. a module asks for the class its buffer needs, not for a section
+typedef enum
+{
+	ARENA_TCM = 0,		// DTCM: no wait states, not cached, CPU and MDMA only. state touched every sample
+	ARENA_AXI,			// AXI SRAM (D1): largest, cached. spectra and tables read every block
+	ARENA_AHB,			// D2 SRAM: cached, reachable by DMA1/2. delay lines
+	ARENA_SHARED,		// D3 SRAM: reachable by the M4 and the BDMA, survives D1/D2 standby
+	ARENA_CLASSES
+} arena_class;
+
+// allocation sequence number: arena_release frees everything allocated after a mark (scoped reset)
+typedef uint32_t arena_mark_t;
+
+// block of an arena. the blocks always cover the whole arena, sorted by offset. sequence 0 = free
+typedef struct
+{
+	size_t offset;
+	size_t size;
+	arena_mark_t sequence;
+} arena_block_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Memory arena the effect buffers are taken from: at init for buffers an effect always needs, when an effect is activated
+*   (enters the chain) for the large ones, which are given back when it is deactivated. First-fit over a bounded block list,
+*   free neighbours are merged again: no hidden heap, every allocation takes at most ARENA_MAX_BLOCKS steps.
+*   Only used from the main loop, never from the audio interrupt.
+*
+*   Members:
+*   memory:             Start of the arena, ARENA_ALIGN aligned.
+*   size:               Size in bytes.
+*   blocks:             Used and free blocks.
+*   count:              Number of blocks.
+*   sequence:           Sequence number of the next allocation.
+*   used:               Bytes currently taken (alignment padding included).
+*   high_water:         Most bytes ever taken at the same time.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t *memory;
+	size_t size;
+	arena_block_t blocks[ARENA_MAX_BLOCKS];
+	size_t count;
+	arena_mark_t sequence;
+	size_t used;
+	size_t high_water;
+} arena_t;
+
+void *arena_alloc(arena_class cls, size_t size);
+void *arena_alloc_aligned(arena_class cls, size_t size, size_t align);
+void arena_free(void *buffer);
+arena_mark_t arena_mark(arena_class cls);
+void arena_release(arena_class cls, arena_mark_t mark);
+size_t arena_available(arena_class cls);
+const arena_t *arena_get(arena_class cls);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __ARENA_H__
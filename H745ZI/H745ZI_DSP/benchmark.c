@@ -0,0 +1,954 @@
+// benchmark.c, Michael Haselberger
+// Description: Cycle counts of the effect kernels, built by the Benchmark configuration (BENCHMARK). Every kernel runs on
+// blocks of MIN_BLOCK_SIZE to MAX_BLOCK_SIZE samples with its in- and output buffers in DTCM, AXI SRAM (RAM_D1) and
+// AHB SRAM (RAM_D2), taken from the effect arenas. The memory of the kernels themselves (delay lines, filter states)
+// stays where the effect puts it. The result table goes out over SWO as CSV, for a baseline to judge optimizations by and
+// for the cost model of the chain (cost_model.h), with the memory every effect takes when it's activated.
+// A second table measures every kernel once more at MAX_BLOCK_SIZE while other masters use the bus matrix: the audio
+// DMA on the buffers of DMA_PLACEMENT (with the bursts of DMA_FIFO), the MDMA streaming reverb spectra through AXI SRAM,
+// and both. The slowdown against the quiet bus tells the layouts apart, build by build.
+// The reverb and the cabinet come last: the reverb spectra fill the D1 arena, so the ping-pong delay and the spectral
+// effects give their memory back first, and nothing else can run with them.
+
+#include <stdio.h>
+#include <string.h>
+#include "main.h"
+#include "arena.h"
+#include "benchmark.h"
+
+#if defined(BENCHMARK)
+
+// block sizes MIN_BLOCK_SIZE, 2 * MIN_BLOCK_SIZE ... MAX_BLOCK_SIZE
+#define BLOCK_SIZES (5)
+#define PLACEMENTS (3)
+
+_Static_assert((MIN_BLOCK_SIZE << (BLOCK_SIZES - 1)) == MAX_BLOCK_SIZE, "BLOCK_SIZES doesn't match MIN_BLOCK_SIZE and MAX_BLOCK_SIZE");
+
+extern float32_t filter_taps[NUM_TAPS];
+// the audio DMA buffers (main.c), in the memory of DMA_PLACEMENT
+extern uint32_t rx_buffer[DMA_BUFFER_SIZE];
+extern uint32_t tx_buffer[DMA_BUFFER_SIZE];
+// the model the amp of the chain runs, filled with synthetic models of every measured size
+extern amp_model_t amp_model;
+
+static delay_handle_t delay;
+static overdrive_handle_t overdrive;
+static fuzz_handle_t fuzz;
+static tremolo_handle_t tremolo;
+static ring_mod_handle_t ring_mod;
+static eq_handle_t eq;
+static chorus_handle_t chorus;
+static flanger_handle_t flanger;
+static gate_handle_t gate;
+static comp_handle_t comp;
+static pitch_handle_t pitch;
+static wah_handle_t wah;
+static phaser_handle_t phaser;
+static amp_handle_t amp;
+static fxloop_handle_t fxloop;
+static denoise_handle_t denoise;
+static freeze_handle_t freeze;
+static pingpong_handle_t pingpong;
+static reverb_handle_t reverb;
+static cab_handle_t cab;
+// right channel of the stereo kernels, its placement isn't varied
+static float32_t right_src[MAX_BLOCK_SIZE];
+static float32_t right_dst[MAX_BLOCK_SIZE];
+
+// every kernel in the same form: the buffers are set before every block, which costs a few cycles against thousands
+#define HANDLE_KERNEL(name, handle) \
+static void bench_##name(float32_t *src, float32_t *dst, uint32_t n) \
+{ \
+	handle.src = src; \
+	handle.dst = dst; \
+	run_##name(&handle, n); \
+}
+
+// the distortion effects in every shaping mode. the mode is set before every block, a change of the oversampling
+// factor takes effect in the warmup blocks
+#define QUALITY_KERNEL(name, effect, quality) \
+static void bench_##name(float32_t *src, float32_t *dst, uint32_t n) \
+{ \
+	effect##_set_quality(&effect, quality); \
+	effect.src = src; \
+	effect.dst = dst; \
+	run_##effect(&effect, n); \
+}
+
+HANDLE_KERNEL(delay, delay)
+QUALITY_KERNEL(overdrive, overdrive, DISTORTION_OVERSAMPLED)
+QUALITY_KERNEL(overdrive_lut, overdrive, DISTORTION_LUT)
+QUALITY_KERNEL(overdrive_adaa, overdrive, DISTORTION_ADAA)
+QUALITY_KERNEL(fuzz, fuzz, DISTORTION_OVERSAMPLED)
+QUALITY_KERNEL(fuzz_lut, fuzz, DISTORTION_LUT)
+QUALITY_KERNEL(fuzz_adaa, fuzz, DISTORTION_ADAA)
+HANDLE_KERNEL(tremolo, tremolo)
+HANDLE_KERNEL(ring_mod, ring_mod)
+HANDLE_KERNEL(eq, eq)
+HANDLE_KERNEL(chorus, chorus)
+HANDLE_KERNEL(flanger, flanger)
+HANDLE_KERNEL(gate, gate)
+HANDLE_KERNEL(comp, comp)
+HANDLE_KERNEL(pitch, pitch)
+HANDLE_KERNEL(wah, wah)
+HANDLE_KERNEL(phaser, phaser)
+// one STFT frame every hop: the average over the repeats includes the frames of the blocks in between
+HANDLE_KERNEL(denoise, denoise)
+HANDLE_KERNEL(freeze, freeze)
+
+// the stereo ping-pong delay: both lines in one interleaved pass, against the delay run for both channels (two
+// delay_handle_t with their outputs crossed would cost the same and a mix on top)
+static void bench_pingpong(float32_t *src, float32_t *dst, uint32_t n)
+{
+	pingpong.src[0] = src;
+	pingpong.src[1] = right_src;
+	pingpong.dst[0] = dst;
+	pingpong.dst[1] = right_dst;
+	run_pingpong(&pingpong, n);
+}
+
+static void bench_delay_pair(float32_t *src, float32_t *dst, uint32_t n)
+{
+	bench_delay(src, dst, n);
+	bench_delay(right_src, right_dst, n);
+}
+
+// ring modulator and tremolo in a row, as two passes over the block and fused into one (fx_chain_set_factor)
+static void bench_ring_tremolo(float32_t *src, float32_t *dst, uint32_t n)
+{
+	ring_mod.src = src;
+	ring_mod.dst = dst;
+	run_ring_mod(&ring_mod, n);
+	tremolo.src = dst;
+	tremolo.dst = dst;
+	run_tremolo(&tremolo, n);
+}
+
+static void bench_ring_tremolo_fused(float32_t *src, float32_t *dst, uint32_t n)
+{
+	float32_t factor[MAX_BLOCK_SIZE];
+	float32_t next[MAX_BLOCK_SIZE];
+	ring_mod_factor(&ring_mod, factor, n);
+	tremolo_factor(&tremolo, next, n);
+	arm_mult_f32(factor, next, factor, n);
+	arm_mult_f32(src, factor, dst, n);
+}
+
+// the same fused stage in q15 (fx_chain_set_q15), with the packing and unpacking of the signal
+static void bench_ring_tremolo_q15(float32_t *src, float32_t *dst, uint32_t n)
+{
+	float32_t factor[MAX_BLOCK_SIZE];
+	q15_t gain[MAX_BLOCK_SIZE] __attribute__((aligned(4)));
+	q15_t next[MAX_BLOCK_SIZE] __attribute__((aligned(4)));
+	ring_mod_factor(&ring_mod, factor, n);
+	arm_float_to_q15(factor, gain, n);
+	tremolo_factor(&tremolo, factor, n);
+	arm_float_to_q15(factor, next, n);
+	arm_mult_q15(gain, next, gain, n);
+	arm_float_to_q15(src, next, n);
+	arm_mult_q15(next, gain, next, n);
+	arm_q15_to_float(next, dst, n);
+}
+
+// a 5 Hz LFO per sample with arm_sin_f32 against the same LFO at control rate (control_rate.h), from the wavetable
+// oscillator once per CONTROL_RATE_SIZE samples and ramped in between
+static float32_t lfo_phase = 0.0f;
+static oscillator_t lfo;
+static control_param_t lfo_control;
+static control_param_t gain_control;
+
+static void bench_lfo_sin(float32_t *src, float32_t *dst, uint32_t n)
+{
+	const float32_t step = 2.0f * PI * 5.0f / AUDIO_SAMPLE_RATE;
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		dst[i] = src[i] * arm_sin_f32(lfo_phase);
+		lfo_phase += step;
+		if (lfo_phase >= 2.0f * PI)
+			lfo_phase -= 2.0f * PI;
+	}
+}
+
+static float32_t lfo_point(void *ctx, uint32_t offset)
+{
+	float32_t value;
+	(void)offset;
+	oscillator_generate(ctx, &value, 5.0f * CONTROL_RATE_SIZE, 1);
+	return value;
+}
+
+static void bench_lfo_control(float32_t *src, float32_t *dst, uint32_t n)
+{
+	control_rate_run(&lfo_control, lfo_point, &lfo, dst, n);
+	arm_mult_f32(src, dst, dst, n);
+}
+
+// a dB envelope (the input as the level in dB, -48 to 0) to gain per sample with expf, against control rate
+static void bench_gain_expf(float32_t *src, float32_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		dst[i] = src[i] * expf(0.11512925f * 48.0f * (src[i] - 1.0f));
+	}
+}
+
+static float32_t gain_point(void *ctx, uint32_t offset)
+{
+	const float32_t *src = ctx;
+	return expf(0.11512925f * 48.0f * (src[offset] - 1.0f));
+}
+
+static void bench_gain_control(float32_t *src, float32_t *dst, uint32_t n)
+{
+	control_rate_run(&gain_control, gain_point, src, dst, n);
+	arm_mult_f32(src, dst, dst, n);
+}
+
+// a 1 kHz square carrier from the band-limited table against PolyBLEP, and the PolyBLAMP triangle
+static oscillator_t carrier_table;
+static oscillator_t carrier_blep;
+static oscillator_t carrier_triangle;
+
+static void bench_square_table(float32_t *src, float32_t *dst, uint32_t n)
+{
+	oscillator_generate(&carrier_table, dst, 1000.0f, n);
+	arm_mult_f32(src, dst, dst, n);
+}
+
+static void bench_square_blep(float32_t *src, float32_t *dst, uint32_t n)
+{
+	oscillator_generate(&carrier_blep, dst, 1000.0f, n);
+	arm_mult_f32(src, dst, dst, n);
+}
+
+static void bench_triangle_blep(float32_t *src, float32_t *dst, uint32_t n)
+{
+	oscillator_generate(&carrier_triangle, dst, 1000.0f, n);
+	arm_mult_f32(src, dst, dst, n);
+}
+
+// libm against fast_math.h on the input (-1 to 1): e^x, tanh of an overdriven sample, log2 of the level and the dB
+// round trip of a gain computer
+static void bench_exp_libm(float32_t *src, float32_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		dst[i] = expf(4.0f * src[i]);
+	}
+}
+
+static void bench_exp_fast(float32_t *src, float32_t *dst, uint32_t n)
+{
+	arm_scale_f32(src, 4.0f, dst, n);
+	fast_exp_f32(dst, dst, n);
+}
+
+static void bench_tanh_libm(float32_t *src, float32_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		dst[i] = tanhf(4.0f * src[i]);
+	}
+}
+
+static void bench_tanh_fast(float32_t *src, float32_t *dst, uint32_t n)
+{
+	arm_scale_f32(src, 4.0f, dst, n);
+	fast_tanh_f32(dst, dst, n);
+}
+
+static void bench_log2_libm(float32_t *src, float32_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		dst[i] = log2f(fabsf(src[i]));
+	}
+}
+
+static void bench_log2_fast(float32_t *src, float32_t *dst, uint32_t n)
+{
+	arm_abs_f32(src, dst, n);
+	fast_log2_f32(dst, dst, n);
+}
+
+static void bench_db_gain_libm(float32_t *src, float32_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		const float32_t db = 20.0f * log10f(fmaxf(fabsf(src[i]), 1e-5f));
+		dst[i] = powf(10.0f, 0.5f * db / 20.0f);
+	}
+}
+
+static void bench_db_gain_fast(float32_t *src, float32_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		const float32_t db = fast_gain_to_db(fmaxf(fabsf(src[i]), 1e-5f));
+		dst[i] = fast_db_to_gain(0.5f * db);
+	}
+}
+
+// synthetic model of a cell and size: weights of a trained model's magnitude from a fixed LCG, no post-filter.
+// the cost doesn't depend on the values, only denormals would change it and the tanh table never produces them
+static void amp_build(amp_cell cell, uint32_t hidden)
+{
+	uint32_t seed = 12345;
+	const uint32_t floats = amp_model_weights(cell, hidden, 0);
+	const float32_t scale = 1.0f / (float32_t)hidden;
+
+	amp_model.cell = cell;
+	amp_model.hidden = hidden;
+	amp_model.skip = 1;
+	amp_model.post_stages = 0;
+	for (uint32_t i = 0; i < floats; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		amp_model.weights[i] = scale * ((float32_t)(seed >> 8) / (float32_t)(1u << 24) - 0.5f);
+	}
+	amp_model_prepare(&amp_model);
+}
+
+// the model is rebuilt when the kernel changes, during the warmup blocks. run_amp starts an empty state on the new serial
+#define AMP_KERNEL(name, model_cell, model_hidden) \
+static void bench_##name(float32_t *src, float32_t *dst, uint32_t n) \
+{ \
+	if ((amp_model.cell != (model_cell)) || (amp_model.hidden != (model_hidden))) \
+		amp_build((model_cell), (model_hidden)); \
+	amp.src = src; \
+	amp.dst = dst; \
+	run_amp(&amp, n); \
+}
+
+AMP_KERNEL(amp_lstm16, AMP_LSTM, 16)
+AMP_KERNEL(amp_lstm32, AMP_LSTM, 32)
+AMP_KERNEL(amp_gru16, AMP_GRU, 16)
+AMP_KERNEL(amp_gru32, AMP_GRU, 32)
+
+// send and return in frames of the codec layout, as in the DMA blocks
+static uint32_t fxloop_frames[MAX_BLOCK_SIZE * AUDIO_FRAME_WORDS];
+
+static void bench_fxloop(float32_t *src, float32_t *dst, uint32_t n)
+{
+	fxloop_set_block(&fxloop, &fxloop_frames[1], &fxloop_frames[1]);
+	fxloop.src = src;
+	fxloop.dst = dst;
+	run_fxloop(&fxloop, n);
+}
+
+static void bench_fir_filter(float32_t *src, float32_t *dst, uint32_t n)
+{
+	run_fir_filter(0, src, dst, n);
+}
+
+// the reverb with the generated response of REVERB_MAX_IR_LENGTH, the longest one: shorter recorded responses cost
+// less. blocks shorter than a partition are collected, and the tail stages spread their partitions over the blocks,
+// so the average over the repeats is the cost per block. the tail stages are set before every block
+static void bench_reverb(float32_t *src, float32_t *dst, uint32_t n)
+{
+#if !defined(REVERB_FDN) && !defined(DUAL_CORE)
+	reverb_shorten(&reverb, false);
+#endif
+	reverb.src = src;
+	reverb.dst = dst;
+	run_reverb(&reverb, n);
+}
+
+#if !defined(REVERB_FDN) && !defined(DUAL_CORE)
+static void bench_reverb_short(float32_t *src, float32_t *dst, uint32_t n)
+{
+	reverb_shorten(&reverb, true);
+	reverb.src = src;
+	reverb.dst = dst;
+	run_reverb(&reverb, n);
+}
+#endif
+
+// the cabinet responses of the table (COST_CAB), from 64 taps to the longest one
+#define CAB_KERNEL_TAPS (2048)
+_Static_assert(CAB_KERNEL_TAPS <= CAB_MAX_TAPS, "the cabinet kernels need CAB_MAX_TAPS of at least 2048");
+// synthetic response: noise from a fixed LCG under an exponential decay, in the D2 arena. the cost doesn't depend on the values
+static float32_t *cab_ir = NULL;
+static uint32_t cab_block = 0;
+
+// the cabinet with the first taps of the response. cab_init runs again when the length, the block size or the buffers
+// change (in the warmup blocks): it chooses the path for them and transforms the response like a block size change
+#define CAB_KERNEL(taps) \
+static void bench_cab_##taps(float32_t *src, float32_t *dst, uint32_t n) \
+{ \
+	if ((cab.ir_length != (taps)) || (cab_block != n) || (cab.src != src) || (cab.dst != dst)) \
+	{ \
+		cab_block = n; \
+		cab_init(&cab, src, dst, cab_ir, (taps), 1.0f, n); \
+	} \
+	run_cab(&cab, n); \
+}
+
+CAB_KERNEL(64)
+CAB_KERNEL(128)
+CAB_KERNEL(256)
+CAB_KERNEL(512)
+CAB_KERNEL(1024)
+CAB_KERNEL(2048)
+
+typedef struct
+{
+	const char *name;
+	void (*run)(float32_t *src, float32_t *dst, uint32_t n);
+	// measured after the others by measure_convolution, with the reverb spectra in the D1 arena
+	bool convolution;
+} kernel_t;
+
+static const kernel_t kernels[] =
+{
+	{ "delay", bench_delay, false },
+	{ "overdrive", bench_overdrive, false },
+	{ "overdrive_lut", bench_overdrive_lut, false },
+	{ "overdrive_adaa", bench_overdrive_adaa, false },
+	{ "fuzz", bench_fuzz, false },
+	{ "fuzz_lut", bench_fuzz_lut, false },
+	{ "fuzz_adaa", bench_fuzz_adaa, false },
+	{ "tremolo", bench_tremolo, false },
+	{ "ring_mod", bench_ring_mod, false },
+	{ "ring_tremolo", bench_ring_tremolo, false },
+	{ "ring_tremolo_fused", bench_ring_tremolo_fused, false },
+	{ "ring_tremolo_q15", bench_ring_tremolo_q15, false },
+	{ "lfo_sin", bench_lfo_sin, false },
+	{ "lfo_control", bench_lfo_control, false },
+	{ "gain_expf", bench_gain_expf, false },
+	{ "gain_control", bench_gain_control, false },
+	{ "square_table", bench_square_table, false },
+	{ "square_blep", bench_square_blep, false },
+	{ "triangle_blep", bench_triangle_blep, false },
+	{ "exp_libm", bench_exp_libm, false },
+	{ "exp_fast", bench_exp_fast, false },
+	{ "tanh_libm", bench_tanh_libm, false },
+	{ "tanh_fast", bench_tanh_fast, false },
+	{ "log2_libm", bench_log2_libm, false },
+	{ "log2_fast", bench_log2_fast, false },
+	{ "db_gain_libm", bench_db_gain_libm, false },
+	{ "db_gain_fast", bench_db_gain_fast, false },
+	{ "phaser", bench_phaser, false },
+	{ "fir_filter", bench_fir_filter, false },
+	{ "eq", bench_eq, false },
+	{ "chorus", bench_chorus, false },
+	{ "flanger", bench_flanger, false },
+	{ "gate", bench_gate, false },
+	{ "comp", bench_comp, false },
+	{ "pitch", bench_pitch, false },
+	{ "wah", bench_wah, false },
+	{ "amp_lstm16", bench_amp_lstm16, false },
+	{ "amp_lstm32", bench_amp_lstm32, false },
+	{ "amp_gru16", bench_amp_gru16, false },
+	{ "amp_gru32", bench_amp_gru32, false },
+	{ "fxloop", bench_fxloop, false },
+	{ "denoise", bench_denoise, false },
+	{ "freeze", bench_freeze, false },
+	{ "pingpong", bench_pingpong, false },
+	{ "delay_pair", bench_delay_pair, false },
+#if defined(REVERB_FDN)
+	{ "reverb_fdn", bench_reverb, true },
+#else
+	{ "reverb", bench_reverb, true },
+#if !defined(DUAL_CORE)
+	{ "reverb_short", bench_reverb_short, true },
+#endif
+#endif
+	{ "cab_64", bench_cab_64, true },
+	{ "cab_128", bench_cab_128, true },
+	{ "cab_256", bench_cab_256, true },
+	{ "cab_512", bench_cab_512, true },
+	{ "cab_1024", bench_cab_1024, true },
+	{ "cab_2048", bench_cab_2048, true }
+};
+#define KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static const arena_class placements[PLACEMENTS] = { ARENA_TCM, ARENA_AXI, ARENA_AHB };
+static const char *const placement_names[PLACEMENTS] = { "dtcm", "axi", "d2" };
+
+// average cycles per block, 0 if the placement had no room for the buffers
+static uint32_t results[KERNELS][PLACEMENTS][BLOCK_SIZES];
+
+// masters on the bus while the kernels are measured again
+typedef enum
+{
+	TRAFFIC_IO = 0,		// the audio DMA streams both buffers at the sample rate, its interrupts masked
+	TRAFFIC_STREAM,		// the MDMA copies reverb spectra from AXI SRAM to AXI SRAM back to back
+	TRAFFIC_BOTH,
+	TRAFFICS
+} traffic_source;
+static const char *const traffic_names[TRAFFICS] = { "io", "stream", "io_stream" };
+
+// average cycles per block of MAX_BLOCK_SIZE under the traffic, 0 if not measured
+static uint32_t contention[KERNELS][PLACEMENTS][TRAFFICS];
+
+// MDMA channel of the stream traffic, looping over a single node (channels 0 to 5: codec staging and looper)
+static MDMA_HandleTypeDef stream_mdma;
+static MDMA_LinkNodeTypeDef __attribute__((aligned(32))) stream_node;
+
+// effects with buffers taken at activation (fx_activate_t), by the kernel name of the cost table
+typedef enum
+{
+	FOOTPRINT_DELAY = 0,
+	FOOTPRINT_CHORUS,
+	FOOTPRINT_FLANGER,
+	FOOTPRINT_PITCH,
+	FOOTPRINT_DENOISE,
+	FOOTPRINT_FREEZE,
+	FOOTPRINT_PINGPONG,
+	FOOTPRINT_REVERB,
+	FOOTPRINTS
+} footprint_effect;
+#if defined(REVERB_FDN)
+static const char *const footprint_names[FOOTPRINTS] = { "delay", "chorus", "flanger", "pitch", "denoise", "freeze", "pingpong", "reverb_fdn" };
+#else
+static const char *const footprint_names[FOOTPRINTS] = { "delay", "chorus", "flanger", "pitch", "denoise", "freeze", "pingpong", "reverb" };
+#endif
+// bytes every activation took from every arena, and the arenas before it
+static uint32_t footprints[FOOTPRINTS][ARENA_CLASSES];
+static size_t arena_before[ARENA_CLASSES];
+
+static void footprint_start(void)
+{
+	for (uint8_t c = 0; c < ARENA_CLASSES; ++c)
+	{
+		arena_before[c] = arena_get(c)->used;
+	}
+}
+
+// the activation took what the arenas hold more now. error passes the result of the activation through
+static uint8_t footprint_end(footprint_effect effect, uint8_t error)
+{
+	for (uint8_t c = 0; c < ARENA_CLASSES; ++c)
+	{
+		footprints[effect][c] = (uint32_t)(arena_get(c)->used - arena_before[c]);
+	}
+	return error;
+}
+
+// activate an effect and note its footprint
+#define ACTIVATE(effect, call) (footprint_start(), footprint_end((effect), (call)))
+
+// the effects with the init values of main.c. the buffers are replaced by every block
+static uint8_t init_kernels(float32_t *src, float32_t *dst)
+{
+	uint8_t error = 0;
+	error |= delay_init(&delay, src, dst, 400, 0.4, 0.4) || ACTIVATE(FOOTPRINT_DELAY, delay_activate(&delay));
+	error |= overdrive_init(&overdrive, src, dst, 0.3f);
+	error |= fuzz_init(&fuzz, src, dst, 10.0f, 0.5f);
+	error |= tremolo_init(&tremolo, src, dst, 0.7f, 0.8f);
+	error |= ring_mod_init(&ring_mod, src, dst, 0.5f, 0.5f, SINE);
+	error |= eq_init(&eq, src, dst, 3.0f, -2.0f, 1.0f);
+	error |= chorus_init(&chorus, src, dst, 0.3f, 0.5f, 0.5f) || ACTIVATE(FOOTPRINT_CHORUS, chorus_activate(&chorus));
+	error |= flanger_init(&flanger, src, dst, 0.2f, 0.7f, 0.6f) || ACTIVATE(FOOTPRINT_FLANGER, flanger_activate(&flanger));
+	error |= gate_init(&gate, src, dst, -60.0f, 100.0f);
+	error |= comp_init(&comp, src, dst, -20.0f, 4.0f, 6.0f);
+	error |= pitch_init(&pitch, src, dst, 12.0f, 0.5f) || ACTIVATE(FOOTPRINT_PITCH, pitch_activate(&pitch));
+	error |= wah_init(&wah, src, dst, 0.5f, 0.5f, 0.0f, 1.0f);
+	// all twelve stages: the worst case
+	error |= phaser_init(&phaser, src, dst, 0.1f, 0.8f, 1.0f, 0.5f);
+	amp_model_clear(&amp_model);
+	error |= amp_init(&amp, src, dst, &amp_model, 0.5f, 0.5f, 1.0f);
+	// parallel: the delayed dry signal is mixed in
+	error |= fxloop_init(&fxloop, src, dst, 0.5f, 0.0f);
+	error |= denoise_init(&denoise, src, dst, 0, 0.7f, 0.5f) || ACTIVATE(FOOTPRINT_DENOISE, denoise_activate(&denoise));
+	// held: every frame is synthesized with new phases
+	error |= freeze_init(&freeze, src, dst, 0, 1.0f, 1.0f) || ACTIVATE(FOOTPRINT_FREEZE, freeze_activate(&freeze));
+	{
+		float32_t *const in[PINGPONG_LINES] = { src, right_src };
+		float32_t *const out[PINGPONG_LINES] = { dst, right_dst };
+		error |= pingpong_init(&pingpong, in, out, 187.5f, 0.4f, 0.5f, 0.4f) || ACTIVATE(FOOTPRINT_PINGPONG, pingpong_activate(&pingpong));
+	}
+	init_fir_filter(filter_taps);
+	error |= oscillator_init(&lfo, OSC_SINE);
+	error |= oscillator_init(&carrier_table, OSC_SQUARE);
+	error |= oscillator_init(&carrier_blep, OSC_SQUARE_BLEP);
+	error |= oscillator_init(&carrier_triangle, OSC_TRIANGLE_BLEP);
+	control_rate_init(&lfo_control, 0.0f);
+	control_rate_init(&gain_control, 1.0f);
+	return error ? 255 : 0;
+}
+
+// 440 Hz at -6 dBFS: the gate is open and the compressor works
+static void sine_input(float32_t *src)
+{
+	for (uint32_t i = 0; i < MAX_BLOCK_SIZE; ++i)
+	{
+		src[i] = 0.5f * arm_sin_f32(2.0f * PI * 440.0f * i / AUDIO_SAMPLE_RATE);
+	}
+}
+
+static uint32_t measure(const kernel_t *kernel, float32_t *src, float32_t *dst, uint32_t n)
+{
+	for (uint32_t r = 0; r < BENCHMARK_WARMUP; ++r)
+	{
+		kernel->run(src, dst, n);
+	}
+
+	// nothing else runs while the blocks are measured (SysTick included)
+	__disable_irq();
+	const uint32_t start = profiler_now();
+	for (uint32_t r = 0; r < BENCHMARK_REPEAT; ++r)
+	{
+		kernel->run(src, dst, n);
+	}
+	const uint32_t cycles = profiler_now() - start;
+	__enable_irq();
+
+	return cycles / BENCHMARK_REPEAT;
+}
+
+// the MDMA copies BENCHMARK_STREAM_BYTES from src to dst over and over: one node linked to itself, started once by
+// software. 8 beat bursts like the looper, below the codec staging
+static uint8_t stream_config(const float32_t *src, float32_t *dst)
+{
+	MDMA_LinkNodeConfTypeDef node;
+
+	__HAL_RCC_MDMA_CLK_ENABLE();
+	stream_mdma.Instance = MDMA_Channel6;
+	stream_mdma.Init.Request = MDMA_REQUEST_SW;
+	stream_mdma.Init.TransferTriggerMode = MDMA_FULL_TRANSFER;
+	stream_mdma.Init.Priority = MDMA_PRIORITY_LOW;
+	stream_mdma.Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+	stream_mdma.Init.SourceInc = MDMA_SRC_INC_WORD;
+	stream_mdma.Init.DestinationInc = MDMA_DEST_INC_WORD;
+	stream_mdma.Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+	stream_mdma.Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+	stream_mdma.Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+	stream_mdma.Init.BufferTransferLength = 128;
+	stream_mdma.Init.SourceBurst = MDMA_SOURCE_BURST_8BEATS;
+	stream_mdma.Init.DestBurst = MDMA_DEST_BURST_8BEATS;
+	stream_mdma.Init.SourceBlockAddressOffset = 0;
+	stream_mdma.Init.DestBlockAddressOffset = 0;
+	if (HAL_MDMA_Init(&stream_mdma) != HAL_OK)
+	{
+		return 253;
+	}
+
+	node.Init = stream_mdma.Init;
+	node.SrcAddress = (uint32_t)src;
+	node.DstAddress = (uint32_t)dst;
+	node.BlockDataLength = BENCHMARK_STREAM_BYTES;
+	node.BlockCount = 1;
+	node.PostRequestMaskAddress = 0;
+	node.PostRequestMaskData = 0;
+	if ((HAL_MDMA_LinkedList_CreateNode(&stream_node, &node) != HAL_OK) || (HAL_MDMA_LinkedList_AddNode(&stream_mdma, &stream_node, 0) != HAL_OK)
+		|| (HAL_MDMA_LinkedList_EnableCircularMode(&stream_mdma) != HAL_OK))
+	{
+		return 253;
+	}
+	// the MDMA reads the node from memory, not from the data cache
+	SCB_CleanDCache_by_Addr((uint32_t *)&stream_node, sizeof(stream_node));
+	return 0;
+}
+
+// start the masters of a traffic source. the audio DMA runs from the silent buffers without its interrupts, the
+// callbacks would run the audio path
+static uint8_t traffic_start(traffic_source traffic, const float32_t *src, float32_t *dst)
+{
+	if (traffic != TRAFFIC_STREAM)
+	{
+		memset(rx_buffer, 0, sizeof(rx_buffer));
+		memset(tx_buffer, 0, sizeof(tx_buffer));
+		SCB_CleanDCache_by_Addr(tx_buffer, sizeof(tx_buffer));
+		HAL_NVIC_DisableIRQ(DMA1_Stream0_IRQn);
+		HAL_NVIC_DisableIRQ(DMA1_Stream1_IRQn);
+#if defined(SAI_TDM)
+		if (sai_start(tx_buffer, rx_buffer, MAX_BLOCK_SIZE))
+#else
+		if (HAL_I2SEx_TransmitReceive_DMA(&hi2s2, (uint16_t *)tx_buffer, (uint16_t *)rx_buffer, MAX_BLOCK_SIZE << 2) != HAL_OK)
+#endif
+		{
+			return 253;
+		}
+	}
+	if (traffic != TRAFFIC_IO)
+	{
+		if ((src == NULL) || (HAL_MDMA_Start(&stream_mdma, (uint32_t)src, (uint32_t)dst, BENCHMARK_STREAM_BYTES, 1) != HAL_OK))
+		{
+			return 253;
+		}
+	}
+	return 0;
+}
+
+// stop what traffic_start started, the DMA interrupts are enabled again with nothing pending
+static void traffic_stop(traffic_source traffic)
+{
+	if (traffic != TRAFFIC_IO)
+	{
+		HAL_MDMA_Abort(&stream_mdma);
+	}
+	if (traffic != TRAFFIC_STREAM)
+	{
+#if defined(SAI_TDM)
+		sai_stop();
+#else
+		HAL_I2S_DMAStop(&hi2s2);
+#endif
+		HAL_NVIC_ClearPendingIRQ(DMA1_Stream0_IRQn);
+		HAL_NVIC_ClearPendingIRQ(DMA1_Stream1_IRQn);
+		HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+		HAL_NVIC_EnableIRQ(DMA1_Stream1_IRQn);
+	}
+}
+
+// every kernel at MAX_BLOCK_SIZE and every placement under every traffic source. a source that can't be started is
+// left out (0), the stream without room for its buffers in the D1 arena
+static void measure_contention(void)
+{
+	float32_t *stream_src = arena_alloc(ARENA_AXI, BENCHMARK_STREAM_BYTES);
+	float32_t *stream_dst = arena_alloc(ARENA_AXI, BENCHMARK_STREAM_BYTES);
+	if ((stream_src == NULL) || (stream_dst == NULL) || stream_config(stream_src, stream_dst))
+	{
+		arena_free(stream_src);
+		arena_free(stream_dst);
+		stream_src = NULL;
+		stream_dst = NULL;
+	}
+
+	for (uint8_t p = 0; p < PLACEMENTS; ++p)
+	{
+		float32_t *src = arena_alloc(placements[p], MAX_BLOCK_SIZE * sizeof(float32_t));
+		float32_t *dst = arena_alloc(placements[p], MAX_BLOCK_SIZE * sizeof(float32_t));
+		if ((src != NULL) && (dst != NULL))
+		{
+			sine_input(src);
+			for (uint8_t t = 0; t < TRAFFICS; ++t)
+			{
+				if (traffic_start(t, stream_src, stream_dst))
+				{
+					traffic_stop(t);
+					continue;
+				}
+				for (uint8_t k = 0; k < KERNELS; ++k)
+				{
+					if (!kernels[k].convolution)
+						contention[k][p][t] = measure(&kernels[k], src, dst, MAX_BLOCK_SIZE);
+				}
+				traffic_stop(t);
+			}
+		}
+		arena_free(src);
+		arena_free(dst);
+	}
+
+	arena_free(stream_src);
+	arena_free(stream_dst);
+}
+
+// the reverb and the cabinet. the ping-pong delay (AXI SRAM, D2 is taken by the delay) and the spectral effects (DTCM)
+// give their memory back for the reverb spectra and the cabinet filter memory. a placement without room for the
+// buffers is left out (0): in AXI SRAM, the spectra leave only 1 KB
+static void measure_convolution(void)
+{
+	pingpong_deinit(&pingpong);
+	denoise_deinit(&denoise);
+	freeze_deinit(&freeze);
+
+	cab_ir = arena_alloc(ARENA_AHB, CAB_KERNEL_TAPS * sizeof(float32_t));
+	float32_t *src = arena_alloc(ARENA_TCM, MAX_BLOCK_SIZE * sizeof(float32_t));
+	float32_t *dst = arena_alloc(ARENA_TCM, MAX_BLOCK_SIZE * sizeof(float32_t));
+	if ((cab_ir == NULL) || (src == NULL) || (dst == NULL))
+	{
+		arena_free(src);
+		arena_free(dst);
+		return;
+	}
+	uint32_t seed = 12345;
+	for (uint32_t k = 0; k < CAB_KERNEL_TAPS; ++k)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		cab_ir[k] = expf(-8.0f * k / CAB_KERNEL_TAPS) * ((float32_t)(seed >> 8) / (float32_t)(1u << 24) - 0.5f);
+	}
+	// takes the filter memory from the DTCM arena and reverb_activate the spectra, before the other placements
+	const uint8_t error = cab_init(&cab, src, dst, cab_ir, CAB_KERNEL_TAPS, 1.0f, MAX_BLOCK_SIZE)
+		|| reverb_init(&reverb, src, dst, NULL, 0, 0, 0.3f) || ACTIVATE(FOOTPRINT_REVERB, reverb_activate(&reverb));
+	arena_free(src);
+	arena_free(dst);
+	if (error)
+	{
+		return;
+	}
+
+	for (uint8_t p = 0; p < PLACEMENTS; ++p)
+	{
+		src = arena_alloc(placements[p], MAX_BLOCK_SIZE * sizeof(float32_t));
+		dst = arena_alloc(placements[p], MAX_BLOCK_SIZE * sizeof(float32_t));
+		if ((src != NULL) && (dst != NULL))
+		{
+			sine_input(src);
+			for (uint8_t k = 0; k < KERNELS; ++k)
+			{
+				for (uint8_t b = 0; (b < BLOCK_SIZES) && kernels[k].convolution; ++b)
+				{
+					results[k][p][b] = measure(&kernels[k], src, dst, MIN_BLOCK_SIZE << b);
+				}
+			}
+		}
+		arena_free(src);
+		arena_free(dst);
+	}
+}
+
+/******************************************************************************
+* Function Name: benchmark_run
+*******************************************************************************
+* Summary:
+*  Measure every kernel at every block size and buffer placement. The input is a 440 Hz sine
+*  at -6 dBFS, so the gate is open and the compressor works. Then every kernel once more at
+*  MAX_BLOCK_SIZE under every traffic source on the bus. The reverb and the cabinet are measured
+*  last, without the traffic (measure_convolution). Takes a few seconds. Call once before the
+*  audio DMA is started, the kernels keep their memory afterwards.
+*
+* Parameters:
+*  None.
+* Return:
+*  255:								- An effect couldn't be initialized (arena exhausted).
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t benchmark_run(void)
+{
+	// starts the DWT cycle counter
+	profiler_init(PING_PONG_BUFFER_SIZE * (SystemCoreClock / AUDIO_SAMPLE_RATE));
+
+	for (uint8_t p = 0; p < PLACEMENTS; ++p)
+	{
+		float32_t *src = arena_alloc(placements[p], MAX_BLOCK_SIZE * sizeof(float32_t));
+		float32_t *dst = arena_alloc(placements[p], MAX_BLOCK_SIZE * sizeof(float32_t));
+		if ((src == NULL) || (dst == NULL))
+		{
+			arena_free(src);
+			arena_free(dst);
+			continue;
+		}
+		if ((p == 0) && init_kernels(src, dst))
+		{
+			arena_free(src);
+			arena_free(dst);
+			return 255;
+		}
+
+		sine_input(src);
+		for (uint8_t k = 0; k < KERNELS; ++k)
+		{
+			for (uint8_t b = 0; (b < BLOCK_SIZES) && !kernels[k].convolution; ++b)
+			{
+				results[k][p][b] = measure(&kernels[k], src, dst, MIN_BLOCK_SIZE << b);
+			}
+		}
+
+		arena_free(src);
+		arena_free(dst);
+	}
+	measure_contention();
+	measure_convolution();
+	return 0;
+}
+
+// write a string to ITM stimulus port 0 (SWO). returns immediately if no debugger enabled the ITM
+static void swo_write(const char *str)
+{
+	while (*str)
+	{
+		ITM_SendChar(*str++);
+	}
+}
+
+/******************************************************************************
+* Function Name: benchmark_report
+*******************************************************************************
+* Summary:
+*  Print the results of benchmark_run over SWO: a comment line with the build (placement of
+*  the code, sample format, core clock) and the deadline in cycles per sample at the sample
+*  rate, which tells e.g. which amp model sizes fit, a CSV header, then one line per kernel, placement
+*  and block size with the cycles per block and per sample (two decimals), and a second table
+*  with the bytes the activation of an effect took from every arena. The third table gives the
+*  cycles of every kernel at MAX_BLOCK_SIZE under every traffic source and the slowdown against
+*  the quiet bus in percent (two decimals), behind a comment line with DMA_PLACEMENT and
+*  DMA_FIFO of the build. Every CSV line starts with "bench", "bench_memory" or
+*  "bench_contention", so the tables can be picked out of a log that also holds other output
+*  (Python/analysis_helpers.py, the cost model in cost_table.h).
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void benchmark_report(void)
+{
+	char line[96];
+
+#if defined(TCM_PLACEMENT)
+	static const char code[] = "tcm";
+#else
+	static const char code[] = "flash";
+#endif
+	snprintf(line, sizeof(line), "# benchmark %s, f32, %lu MHz, %u blocks, deadline %lu cycles per sample\r\n", code,
+		(unsigned long)(SystemCoreClock / 1000000), BENCHMARK_REPEAT, (unsigned long)(SystemCoreClock / AUDIO_SAMPLE_RATE));
+	swo_write(line);
+	swo_write("bench,kernel,memory,block,cycles_per_block,cycles_per_sample\r\n");
+
+	for (uint8_t k = 0; k < KERNELS; ++k)
+	{
+		for (uint8_t p = 0; p < PLACEMENTS; ++p)
+		{
+			for (uint8_t b = 0; b < BLOCK_SIZES; ++b)
+			{
+				const uint32_t n = MIN_BLOCK_SIZE << b;
+				const uint32_t cycles = results[k][p][b];
+				if (cycles == 0)
+					continue;
+				// hundredths of a cycle, integer so printing doesn't need float support in printf
+				const uint32_t per_sample = (uint32_t)(((uint64_t)cycles * 100 + n / 2) / n);
+				snprintf(line, sizeof(line), "bench,%s,%s,%lu,%lu,%lu.%02lu\r\n", kernels[k].name, placement_names[p],
+					(unsigned long)n, (unsigned long)cycles, (unsigned long)(per_sample / 100), (unsigned long)(per_sample % 100));
+				swo_write(line);
+			}
+		}
+	}
+
+	swo_write("bench_memory,kernel,dtcm,axi,d2,d3\r\n");
+	for (uint8_t e = 0; e < FOOTPRINTS; ++e)
+	{
+		snprintf(line, sizeof(line), "bench_memory,%s,%lu,%lu,%lu,%lu\r\n", footprint_names[e],
+			(unsigned long)footprints[e][ARENA_TCM], (unsigned long)footprints[e][ARENA_AXI],
+			(unsigned long)footprints[e][ARENA_AHB], (unsigned long)footprints[e][ARENA_SHARED]);
+		swo_write(line);
+	}
+
+	static const char *const dma_names[] = { "d1", "d2", "d3" };
+#if defined(DMA_FIFO)
+	static const char fifo[] = "fifo";
+#else
+	static const char fifo[] = "direct";
+#endif
+	snprintf(line, sizeof(line), "# contention, dma buffers %s, %s, block %u\r\n", dma_names[DMA_PLACEMENT - DMA_PLACEMENT_D1],
+		fifo, MAX_BLOCK_SIZE);
+	swo_write(line);
+	swo_write("bench_contention,kernel,memory,traffic,cycles_per_block,slowdown_percent\r\n");
+	for (uint8_t k = 0; k < KERNELS; ++k)
+	{
+		for (uint8_t p = 0; p < PLACEMENTS; ++p)
+		{
+			const uint32_t quiet = results[k][p][BLOCK_SIZES - 1];
+			for (uint8_t t = 0; t < TRAFFICS; ++t)
+			{
+				const uint32_t cycles = contention[k][p][t];
+				if ((cycles == 0) || (quiet == 0))
+					continue;
+				// hundredths of a percent of the cycles on the quiet bus. the spread of the measurement can make it negative
+				const int32_t slowdown = (int32_t)(((int64_t)cycles - (int64_t)quiet) * 10000 / (int64_t)quiet);
+				const uint32_t magnitude = (uint32_t)((slowdown < 0) ? -slowdown : slowdown);
+				snprintf(line, sizeof(line), "bench_contention,%s,%s,%s,%lu,%s%lu.%02lu\r\n", kernels[k].name,
+					placement_names[p], traffic_names[t], (unsigned long)cycles, (slowdown < 0) ? "-" : "",
+					(unsigned long)(magnitude / 100), (unsigned long)(magnitude % 100));
+				swo_write(line);
+			}
+		}
+	}
+}
+
+#endif // BENCHMARK
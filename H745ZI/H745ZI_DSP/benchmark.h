@@ -0,0 +1,27 @@
+// benchmark.h, Michael Haselberger
+// Description: This file contains declarations for the effect kernel benchmark implemented in benchmark.c
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "defines_and_constants.h"
+
+// measured blocks per kernel, block size and placement, after BENCHMARK_WARMUP blocks that aren't measured
+#define BENCHMARK_REPEAT (64)
+#define BENCHMARK_WARMUP (4)
+// bytes of reverb spectra the MDMA copies per pass of the stream traffic (benchmark_run): 32 partitions of the body
+// stage, 128 floats each
+#define BENCHMARK_STREAM_BYTES (16 * 1024)
+
+uint8_t benchmark_run(void);
+void benchmark_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __BENCHMARK_H__
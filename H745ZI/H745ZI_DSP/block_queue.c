@@ -0,0 +1,210 @@
+// block_queue.c, Michael Haselberger
+// Description: Lock-free single-producer/single-consumer block queue for the inter-core audio transport.
+// Compiled into both core projects.
+
+#include <string.h>
+#include "block_queue.h"
+
+// data cache maintenance. only the M7 has a data cache
+#if defined(CORE_CM7)
+#define QUEUE_CLEAN(addr, size) SCB_CleanDCache_by_Addr((uint32_t *)(addr), (size))
+#define QUEUE_INVALIDATE(addr, size) SCB_InvalidateDCache_by_Addr((uint32_t *)(addr), (size))
+#else
+#define QUEUE_CLEAN(addr, size)
+#define QUEUE_INVALIDATE(addr, size)
+#endif
+
+/******************************************************************************
+* Function Name: block_queue_init
+*******************************************************************************
+* Summary:
+*  Reset the queue to empty. Has to be called by one core before the other core uses the queue.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue (shared memory).
+* Return:
+*  None.
+*
+******************************************************************************/
+void block_queue_init(block_queue_t *queue)
+{
+	memset(queue, 0, sizeof(block_queue_t));
+	QUEUE_CLEAN(queue, sizeof(block_queue_t));
+	__DSB();
+}
+
+/******************************************************************************
+* Function Name: block_queue_count
+*******************************************************************************
+* Summary:
+*  Number of published blocks that have not been released yet. May already be outdated when it
+*  is returned, since the other core keeps running.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue.
+* Return:
+*  The number of blocks in the queue.
+*
+******************************************************************************/
+uint32_t block_queue_count(block_queue_t *queue)
+{
+	QUEUE_INVALIDATE(&queue->head, sizeof(block_queue_index_t));
+	QUEUE_INVALIDATE(&queue->tail, sizeof(block_queue_index_t));
+	return queue->head.value - queue->tail.value;
+}
+
+/******************************************************************************
+* Function Name: block_queue_acquire
+*******************************************************************************
+* Summary:
+*  Producer: get the next free slot. The slot can be written in place and is handed to the consumer
+*  with block_queue_publish.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue.
+* Return:
+*  Address of the free slot, NULL if the queue is full.
+*
+******************************************************************************/
+block_queue_slot_t* block_queue_acquire(block_queue_t *queue)
+{
+	// tail is written by the other core
+	QUEUE_INVALIDATE(&queue->tail, sizeof(block_queue_index_t));
+	const uint32_t head = queue->head.value;
+	if (head - queue->tail.value >= BLOCK_QUEUE_SLOTS)
+	{
+		return NULL;
+	}
+	return &queue->slots[head & (BLOCK_QUEUE_SLOTS - 1)];
+}
+
+/******************************************************************************
+* Function Name: block_queue_publish
+*******************************************************************************
+* Summary:
+*  Producer: hand the slot returned by block_queue_acquire to the consumer.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue.
+* Return:
+*  None.
+*
+******************************************************************************/
+void block_queue_publish(block_queue_t *queue)
+{
+	const uint32_t head = queue->head.value;
+	QUEUE_CLEAN(&queue->slots[head & (BLOCK_QUEUE_SLOTS - 1)], sizeof(block_queue_slot_t));
+	// the slot has to be visible before the new head
+	__DMB();
+	queue->head.value = head + 1;
+	QUEUE_CLEAN(&queue->head, sizeof(block_queue_index_t));
+	__DSB();
+}
+
+/******************************************************************************
+* Function Name: block_queue_push
+*******************************************************************************
+* Summary:
+*  Producer: copy a block into the queue.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue.
+*  2. uint32_t sequence				- Stored in the slot together with the samples.
+*  3. const float32_t *samples		- BLOCK_QUEUE_BLOCK_SIZE samples.
+* Return:
+*  1:								- Queue is full, the block was dropped.
+*  0:								- Success.
+*
+******************************************************************************/
+uint8_t block_queue_push(block_queue_t *queue, uint32_t sequence, const float32_t *samples)
+{
+	block_queue_slot_t *slot = block_queue_acquire(queue);
+	if (slot == NULL)
+	{
+		return 1;
+	}
+	slot->sequence = sequence;
+	arm_copy_f32(samples, slot->samples, BLOCK_QUEUE_BLOCK_SIZE);
+	block_queue_publish(queue);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: block_queue_peek
+*******************************************************************************
+* Summary:
+*  Consumer: get the oldest published slot. The slot can be read in place and is given back to the
+*  producer with block_queue_release.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue.
+* Return:
+*  Address of the oldest slot, NULL if the queue is empty.
+*
+******************************************************************************/
+block_queue_slot_t* block_queue_peek(block_queue_t *queue)
+{
+	// head is written by the other core
+	QUEUE_INVALIDATE(&queue->head, sizeof(block_queue_index_t));
+	const uint32_t tail = queue->tail.value;
+	if (queue->head.value == tail)
+	{
+		return NULL;
+	}
+	// head was read before the slot
+	__DMB();
+	block_queue_slot_t *slot = &queue->slots[tail & (BLOCK_QUEUE_SLOTS - 1)];
+	QUEUE_INVALIDATE(slot, sizeof(block_queue_slot_t));
+	return slot;
+}
+
+/******************************************************************************
+* Function Name: block_queue_release
+*******************************************************************************
+* Summary:
+*  Consumer: give the slot returned by block_queue_peek back to the producer.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue.
+* Return:
+*  None.
+*
+******************************************************************************/
+void block_queue_release(block_queue_t *queue)
+{
+	// all reads of the slot have to be done before the producer may overwrite it
+	__DMB();
+	queue->tail.value++;
+	QUEUE_CLEAN(&queue->tail, sizeof(block_queue_index_t));
+	__DSB();
+}
+
+/******************************************************************************
+* Function Name: block_queue_pop
+*******************************************************************************
+* Summary:
+*  Consumer: copy the oldest block out of the queue.
+*
+* Parameters:
+*  1. block_queue_t *queue			- Address pointer of the queue.
+*  2. uint32_t *sequence			- Sequence number stored with the block.
+*  3. float32_t *samples			- BLOCK_QUEUE_BLOCK_SIZE samples.
+* Return:
+*  1:								- Queue is empty.
+*  0:								- Success.
+*
+******************************************************************************/
+uint8_t block_queue_pop(block_queue_t *queue, uint32_t *sequence, float32_t *samples)
+{
+	block_queue_slot_t *slot = block_queue_peek(queue);
+	if (slot == NULL)
+	{
+		return 1;
+	}
+	*sequence = slot->sequence;
+	arm_copy_f32(slot->samples, samples, BLOCK_QUEUE_BLOCK_SIZE);
+	block_queue_release(queue);
+
+	return 0;
+}
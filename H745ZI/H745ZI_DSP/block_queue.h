@@ -0,0 +1,77 @@
+// block_queue.h, Michael Haselberger
+// Description: This file contains declarations for the inter-core audio block queue implemented in block_queue.c
+
+#ifndef __BLOCK_QUEUE_H__
+#define __BLOCK_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// number of slots. has to be a power of two (same head/tail trick as in ring_buffer.c)
+#ifndef BLOCK_QUEUE_SLOTS
+#define BLOCK_QUEUE_SLOTS (4)
+#endif
+#if (BLOCK_QUEUE_SLOTS & (BLOCK_QUEUE_SLOTS - 1))
+#error "BLOCK_QUEUE_SLOTS has to be a power of two"
+#endif
+#define BLOCK_QUEUE_BLOCK_SIZE (PING_PONG_BUFFER_SIZE)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Lock-free single-producer/single-consumer queue of fixed-size audio blocks, shared between the two cores.
+*   Producer and consumer only ever write their own index, so no lock is needed. Head and tail are free running and
+*   masked with BLOCK_QUEUE_SLOTS - 1, the queue is full when head - tail == BLOCK_QUEUE_SLOTS.
+*
+*   Cross-core visibility: head, tail and every slot are in their own 32-byte cache lines. The M7 cleans what it has
+*   written and invalidates what the other core has written before reading it (the M4 has no data cache, the cache
+*   operations are empty there). A slot is always made visible before the index that publishes it (DMB/DSB).
+*
+*   Slots can be used in place (acquire/publish, peek/release) or with a copy (push/pop).
+*
+*   Members:
+*   sequence:           Free to use by the application, e.g. the number of the block the samples belong to.
+*   samples:            One block of samples.
+*   head:               Number of published blocks. Written by the producer only.
+*   tail:               Number of released blocks. Written by the consumer only.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t sequence;
+	float32_t samples[BLOCK_QUEUE_BLOCK_SIZE];
+} __attribute__((aligned(32))) block_queue_slot_t;
+
+typedef struct
+{
+	volatile uint32_t value;
+} __attribute__((aligned(32))) block_queue_index_t;
+
+typedef struct
+{
+	block_queue_index_t head;
+	block_queue_index_t tail;
+	block_queue_slot_t slots[BLOCK_QUEUE_SLOTS];
+} block_queue_t;
+
+void block_queue_init(block_queue_t *queue);
+uint32_t block_queue_count(block_queue_t *queue);
+
+// producer
+block_queue_slot_t* block_queue_acquire(block_queue_t *queue);
+void block_queue_publish(block_queue_t *queue);
+uint8_t block_queue_push(block_queue_t *queue, uint32_t sequence, const float32_t *samples);
+
+// consumer
+block_queue_slot_t* block_queue_peek(block_queue_t *queue);
+void block_queue_release(block_queue_t *queue);
+uint8_t block_queue_pop(block_queue_t *queue, uint32_t *sequence, float32_t *samples);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __BLOCK_QUEUE_H__
@@ -0,0 +1,286 @@
+// capture.c, Michael Haselberger
+// Description: Post-mortem capture of the audio path. A ring in the spare RAM_D2 is overwritten block by block with
+// the left input, the left output (IMA-ADPCM, a quarter of q15) and the profiler timestamps of every block. A dropout,
+// a clip or a missed deadline freezes it a little later, so the ring holds what led to the event and what followed,
+// until the host has read it (HOST_CAPTURE in host_link.h, analysis_helpers.ReadCapture for the plots).
+// The audio interrupt writes the ring, the main loop only requests and reads it once it's frozen.
+
+#include <string.h>
+#include "capture.h"
+#include "profiler.h"
+
+#if defined(CAPTURE)
+
+// NOLOAD section behind the D2 arena (STM32H745ZITx_FLASH_CM7.ld). CPU only, cached
+static uint8_t __attribute__((aligned(32))) RAM_SECTION(".capture_buffer") ring[CAPTURE_BYTES];
+
+static capture_info_t info DTCM_BSS;
+// records the ring holds at the current block size and the next one to write
+static uint32_t slots DTCM_BSS;
+static uint32_t head DTCM_BSS;
+// records still to fill after the trigger (CAPTURE_STOPPING)
+static uint32_t remaining DTCM_BSS;
+// sum of the dropout counters at the last record. fresh: no record yet, the sum is taken as it is
+static uint32_t last_dropouts DTCM_BSS;
+static bool fresh DTCM_BSS;
+// clips of the block tapped, the record is written by capture_commit. tapped: capture_tap filled the frames
+static uint32_t tap_clips DTCM_BSS;
+static bool tapped DTCM_BSS;
+// encoders of the input and the output, they carry on from record to record
+static adpcm_state_t coder[2] DTCM_BSS;
+// sample rate the next start of the ring records at
+static uint32_t rate DTCM_BSS;
+// set by the main loop, executed by the audio interrupt with the next block
+static volatile bool arm_pending DTCM_BSS;
+static volatile bool freeze_pending DTCM_BSS;
+
+// empty ring laid out for a block size. audio interrupt only, or while the audio is stopped
+static void restart(uint32_t block_size)
+{
+	info.state = CAPTURE_RECORDING;
+	info.reason = 0;
+	info.block_size = (uint16_t)block_size;
+	info.sample_rate = rate;
+	info.record_bytes = sizeof(capture_record_t) + 2 * ADPCM_FRAME_BYTES(block_size);
+	info.records = 0;
+	info.trigger = 0;
+	info.budget = profiler_budget();
+	slots = CAPTURE_BYTES / info.record_bytes;
+	head = 0;
+	remaining = 0;
+	fresh = true;
+	tapped = false;
+	adpcm_reset(&coder[0]);
+	adpcm_reset(&coder[1]);
+}
+
+/******************************************************************************
+* Function Name: capture_init
+*******************************************************************************
+* Summary:
+*  Start the ring empty, it's laid out with the first block.
+*
+* Parameters:
+*  1. uint32_t sample_rate			- Current sample rate.
+* Return:
+*  None.
+*
+******************************************************************************/
+void capture_init(uint32_t sample_rate)
+{
+	rate = sample_rate;
+	arm_pending = false;
+	freeze_pending = false;
+	restart(MAX_BLOCK_SIZE);
+	// the first block lays the ring out for its size
+	info.block_size = 0;
+}
+
+/******************************************************************************
+* Function Name: capture_tap
+*******************************************************************************
+* Summary:
+*  Code the input and the output of a block into the oldest record of the ring. A new block
+*  size starts the ring over. Nothing happens while it's frozen. Called from the audio
+*  interrupt only, after the limiter.
+*
+* Parameters:
+*  1. const sample_t *in			- Unprocessed input of the block (left channel).
+*  2. const sample_t *out			- Output of the chain (left channel).
+*  3. uint32_t clips				- Segments caught by the output limiter in this block.
+*  4. uint32_t block_size			- Samples per channel.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void capture_tap(const sample_t *in, const sample_t *out, uint32_t clips, uint32_t block_size)
+{
+	if (arm_pending)
+	{
+		restart(block_size);
+		arm_pending = false;
+		freeze_pending = false;
+	}
+	if (info.state == CAPTURE_FROZEN)
+	{
+		return;
+	}
+	if (block_size != info.block_size)
+	{
+		restart(block_size);
+	}
+
+	uint8_t *frames = &ring[head * info.record_bytes + sizeof(capture_record_t)];
+	const sample_t *signal[2] = { in, out };
+	q15_t block[MAX_BLOCK_SIZE];
+	for (uint8_t s = 0; s < 2; ++s)
+	{
+#if defined(SAMPLE_Q31)
+		arm_q31_to_q15((q31_t *)signal[s], block, block_size);
+#else
+		arm_float_to_q15((float32_t *)signal[s], block, block_size);
+#endif
+		if (fresh)
+			adpcm_prime(&coder[s], block);
+		adpcm_encode(&coder[s], block, &frames[s * ADPCM_FRAME_BYTES(block_size)], block_size);
+	}
+	tap_clips = clips;
+	tapped = true;
+}
+
+/******************************************************************************
+* Function Name: capture_commit
+*******************************************************************************
+* Summary:
+*  Complete the record of the block tapped and check it for the events: a dropout counter
+*  that moved, a clip, a block over the budget or a capture_freeze request. An event in
+*  CAPTURE_TRIGGERS stops the ring 1 / CAPTURE_POST_DIVIDER of its length later. Called from
+*  the audio interrupt only, once the block is sent.
+*
+* Parameters:
+*  1. uint32_t sequence				- Number of the block.
+*  2. uint8_t mode					- Effect mode the block was processed with.
+*  3. uint32_t start				- Cycle counter when the block started.
+*  4. const uint32_t cycles[3]		- Cycles of rx_samples, run_fx and tx_samples.
+*  5. uint32_t dropouts				- Sum of the DMA overruns, DMA and I2S errors so far.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void capture_commit(uint32_t sequence, uint8_t mode, uint32_t start, const uint32_t cycles[3], uint32_t dropouts)
+{
+	if (!tapped)
+	{
+		return;
+	}
+	tapped = false;
+
+	uint8_t events = 0;
+	if (!fresh && (dropouts != last_dropouts))
+		events |= CAPTURE_DROPOUT;
+	if (tap_clips)
+		events |= CAPTURE_CLIP;
+	if ((cycles[0] + cycles[1] + cycles[2]) > profiler_budget())
+		events |= CAPTURE_DEADLINE;
+	if (freeze_pending)
+	{
+		events |= CAPTURE_MANUAL;
+		freeze_pending = false;
+	}
+	last_dropouts = dropouts;
+	fresh = false;
+
+	capture_record_t *record = (capture_record_t *)&ring[head * info.record_bytes];
+	record->sequence = sequence;
+	record->start = start;
+	record->cycles[0] = cycles[0];
+	record->cycles[1] = cycles[1];
+	record->cycles[2] = cycles[2];
+	record->clips = (uint16_t)((tap_clips > UINT16_MAX) ? UINT16_MAX : tap_clips);
+	record->mode = mode;
+	record->events = events;
+	head = (head + 1 < slots) ? head + 1 : 0;
+	if (info.records < slots)
+		info.records++;
+
+	if (info.state == CAPTURE_RECORDING)
+	{
+		if (events & CAPTURE_TRIGGERS)
+		{
+			info.state = CAPTURE_STOPPING;
+			info.reason = events;
+			info.trigger = sequence;
+			info.budget = profiler_budget();
+			remaining = slots / CAPTURE_POST_DIVIDER;
+		}
+	}
+	else if (remaining)
+	{
+		remaining--;
+	}
+	if ((info.state == CAPTURE_STOPPING) && (remaining == 0))
+	{
+		info.state = CAPTURE_FROZEN;
+	}
+}
+
+// empty the ring and record again, with the next block. call from the main loop
+void capture_arm(void)
+{
+	arm_pending = true;
+}
+
+// freeze the ring as if an event had triggered, with the next block. call from the main loop
+void capture_freeze(void)
+{
+	freeze_pending = true;
+}
+
+// the sample rate changed, call while the audio is stopped. the ring starts over, unless it's frozen: then the records
+// keep their rate until capture_arm
+void capture_set_sample_rate(uint32_t sample_rate)
+{
+	rate = sample_rate;
+	if (info.state != CAPTURE_FROZEN)
+	{
+		info.block_size = 0;
+	}
+}
+
+// state and layout of the ring. reliable once it's frozen, a snapshot while recording
+void capture_get_info(capture_info_t *info_out)
+{
+	*info_out = info;
+}
+
+/******************************************************************************
+* Function Name: capture_read
+*******************************************************************************
+* Summary:
+*  Copy bytes of the frozen ring, the records in order from the oldest one: record r starts
+*  at r * record_bytes. Call from the main loop.
+*
+* Parameters:
+*  1. uint32_t offset				- Start in the records, in bytes.
+*  2. uint8_t *dst					- Destination.
+*  3. uint32_t length				- Bytes to copy at most.
+* Return:
+*  Bytes copied. 0 while the ring isn't frozen or behind the last record.
+*
+******************************************************************************/
+uint32_t capture_read(uint32_t offset, uint8_t *dst, uint32_t length)
+{
+	if (info.state != CAPTURE_FROZEN)
+	{
+		return 0;
+	}
+	const uint32_t total = info.records * info.record_bytes;
+	if (offset >= total)
+	{
+		return 0;
+	}
+	if (length > (total - offset))
+	{
+		length = total - offset;
+	}
+
+	// with a full ring the oldest record is the next one to be written
+	const uint32_t oldest = (info.records < slots) ? 0 : head;
+	uint32_t copied = 0;
+	while (copied < length)
+	{
+		const uint32_t r = (offset + copied) / info.record_bytes;
+		const uint32_t within = (offset + copied) % info.record_bytes;
+		const uint32_t slot = (oldest + r) % slots;
+		uint32_t chunk = info.record_bytes - within;
+		if (chunk > (length - copied))
+			chunk = length - copied;
+		memcpy(&dst[copied], &ring[slot * info.record_bytes + within], chunk);
+		copied += chunk;
+	}
+	return copied;
+}
+
+#endif // CAPTURE
@@ -0,0 +1,112 @@
+// capture.h, Michael Haselberger
+// Description: This file contains declarations for the post-mortem capture ring implemented in capture.c
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+#include "arena.h"
+#include "adpcm.h"
+
+// bytes of the ring: the part of RAM_D2 the D2 arena leaves (.capture_buffer, see STM32H745ZITx_FLASH_CM7.ld). the
+// mono build has 32 KB: about 0.4 s of input and output at 48 kHz with 64 samples per block, 0.3 s with 16. the DMA
+// buffers in D2 (DMA_PLACEMENT_D2) take their MPU region off it
+#ifndef CAPTURE_BYTES
+#if (DMA_PLACEMENT == DMA_PLACEMENT_D2)
+#define CAPTURE_BYTES (288 * 1024 - ARENA_D2_SIZE - DMA_REGION_SIZE)
+#else
+#define CAPTURE_BYTES (288 * 1024 - ARENA_D2_SIZE)
+#endif
+#endif
+#if defined(CAPTURE) && (CAPTURE_BYTES <= 0)
+#error "the D2 arena and the DMA buffers leave no room for the capture ring. Undefine CAPTURE or DMA_PLACEMENT_D2"
+#endif
+// after the trigger the ring records another 1 / CAPTURE_POST_DIVIDER of its length, the rest shows what led to it
+#define CAPTURE_POST_DIVIDER (4)
+// events that freeze the ring, the others are only marked in the records
+#define CAPTURE_TRIGGERS (CAPTURE_DROPOUT | CAPTURE_CLIP | CAPTURE_DEADLINE | CAPTURE_MANUAL)
+
+// events of a block (capture_record_t.events, capture_info_t.reason)
+typedef enum
+{
+	CAPTURE_DROPOUT = 0x01,			// DMA overrun, DMA or I2S error (audio_stats_t): the stream lost samples
+	CAPTURE_CLIP = 0x02,			// the output limiter caught a segment over full scale
+	CAPTURE_DEADLINE = 0x04,		// the block took longer than the budget of the profiler
+	CAPTURE_MANUAL = 0x08			// capture_freeze
+} capture_event;
+
+typedef enum
+{
+	CAPTURE_RECORDING = 0,			// every block overwrites the oldest record
+	CAPTURE_STOPPING,				// triggered, the records after the event are being filled
+	CAPTURE_FROZEN					// nothing is overwritten until capture_arm
+} capture_state;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Record of one block. Followed in the ring by the left input and the left output of the chain as ADPCM frames
+*   (ADPCM_FRAME_BYTES(block size) each, see adpcm.h), which decode on their own.
+*
+*   Members:
+*   sequence:           Number of the block. Gaps are blocks lost to overruns or passed by the bypass.
+*   start:              Cycle counter when the block started (profiler_now).
+*   cycles:             Cycles of rx_samples, run_fx and tx_samples.
+*   clips:              Segments caught by the output limiter.
+*   mode:               Effect mode the block was processed with.
+*   events:             capture_event bits of the block.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t sequence;
+	uint32_t start;
+	uint32_t cycles[3];
+	uint16_t clips;
+	uint8_t mode;
+	uint8_t events;
+} capture_record_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   What the ring holds, for the host to cut the bytes of capture_read into records.
+*
+*   Members:
+*   state:              capture_state.
+*   reason:             Events of the block that triggered, 0 before.
+*   block_size:         Samples per channel of every record.
+*   sample_rate:        Sample rate of the records.
+*   record_bytes:       Bytes of a record and its frames.
+*   records:            Records in the ring.
+*   trigger:            Sequence of the block that triggered.
+*   budget:             Cycles of the block budget (profiler_budget) of the records.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t state;
+	uint8_t reason;
+	uint16_t block_size;
+	uint32_t sample_rate;
+	uint32_t record_bytes;
+	uint32_t records;
+	uint32_t trigger;
+	uint32_t budget;
+} capture_info_t;
+
+void capture_init(uint32_t sample_rate);
+void capture_tap(const sample_t *in, const sample_t *out, uint32_t clips, uint32_t block_size);
+void capture_commit(uint32_t sequence, uint8_t mode, uint32_t start, const uint32_t cycles[3], uint32_t dropouts);
+void capture_arm(void);
+void capture_freeze(void);
+void capture_set_sample_rate(uint32_t sample_rate);
+void capture_get_info(capture_info_t *info);
+uint32_t capture_read(uint32_t offset, uint8_t *dst, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CAPTURE_H__
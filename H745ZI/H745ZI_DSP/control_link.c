@@ -0,0 +1,181 @@
+// control_link.c, Michael Haselberger
+// Description: Control link between the menu on the Cortex-M4 and the audio processing on the Cortex-M7 (CONTROL_M4).
+// The M7 part is compiled into the M7 project (CORE_CM7), the M4 part into the M4 project (CORE_CM4).
+
+#include <string.h>
+#include "control_link.h"
+#include "trace.h"
+
+// data cache maintenance. only the M7 has a data cache
+#if defined(CORE_CM7)
+#define LINK_CLEAN(addr, size) SCB_CleanDCache_by_Addr((uint32_t *)(addr), (size))
+#define LINK_INVALIDATE(addr, size) SCB_InvalidateDCache_by_Addr((uint32_t *)(addr), (size))
+#else
+#define LINK_CLEAN(addr, size)
+#define LINK_INVALIDATE(addr, size)
+#endif
+
+#if defined(CORE_CM7)
+
+/******************************************************************************
+* Function Name: control_link_init
+*******************************************************************************
+* Summary:
+*  Empty the command queue and clear the status. Has to be called before the M4 is started.
+*
+* Parameters:
+*  1. control_link_t *link			- Address pointer of the link (shared memory).
+* Return:
+*  None.
+*
+******************************************************************************/
+void control_link_init(control_link_t *link)
+{
+	memset(link, 0, sizeof(control_link_t));
+	LINK_CLEAN(link, sizeof(control_link_t));
+	__DSB();
+}
+
+/******************************************************************************
+* Function Name: control_link_receive
+*******************************************************************************
+* Summary:
+*  Take the oldest command the M4 sent.
+*
+* Parameters:
+*  1. control_link_t *link			- Address pointer of the link.
+*  2. control_command_t *command	- The command.
+* Return:
+*  true:							- A command was taken.
+*  false:							- The queue is empty.
+*
+******************************************************************************/
+bool control_link_receive(control_link_t *link, control_command_t *command)
+{
+	LINK_INVALIDATE(&link->head, sizeof(block_queue_index_t));
+	const uint32_t tail = link->tail.value;
+	if (link->head.value == tail)
+	{
+		return false;
+	}
+	// the command was written before the head that announced it
+	__DMB();
+	control_command_t *slot = &link->command[tail & (CONTROL_QUEUE_SLOTS - 1)];
+	LINK_INVALIDATE(slot, sizeof(control_command_t));
+	*command = *slot;
+	TRACE_EVENT(TRACE_IPC_COMMAND + command->type);
+	__DMB();
+	link->tail.value = tail + 1;
+	LINK_CLEAN(&link->tail, sizeof(block_queue_index_t));
+	__DSB();
+	return true;
+}
+
+/******************************************************************************
+* Function Name: control_link_publish
+*******************************************************************************
+* Summary:
+*  Write a new status snapshot for the menu. The counter is odd while the snapshot is written, a
+*  copy the M4 takes meanwhile is discarded.
+*
+* Parameters:
+*  1. control_link_t *link			- Address pointer of the link.
+*  2. const control_status_t *status - New status.
+* Return:
+*  None.
+*
+******************************************************************************/
+void control_link_publish(control_link_t *link, const control_status_t *status)
+{
+	const uint32_t sequence = link->sequence.value;
+	link->sequence.value = sequence + 1;
+	LINK_CLEAN(&link->sequence, sizeof(block_queue_index_t));
+	__DSB();
+	link->status = *status;
+	LINK_CLEAN(&link->status, sizeof(control_status_t));
+	__DSB();
+	link->sequence.value = sequence + 2;
+	LINK_CLEAN(&link->sequence, sizeof(block_queue_index_t));
+	__DSB();
+	TRACE_EVENT(TRACE_IPC_STATUS);
+}
+
+#endif // CORE_CM7
+
+#if defined(CORE_CM4)
+
+// the last consistent copy of the status
+static control_status_t status;
+
+/******************************************************************************
+* Function Name: control_link_send
+*******************************************************************************
+* Summary:
+*  Queue a command for the M7. Waits up to CONTROL_SEND_TIMEOUT ms while the queue is full.
+*
+* Parameters:
+*  1. control_link_t *link			- Address pointer of the link.
+*  2. control_type type				- Command.
+*  3. uint8_t fx					- Effect (menu index) of a CONTROL_VALUE.
+*  4. uint8_t item					- Menu item of a CONTROL_VALUE.
+*  5. uint32_t value				- Argument, see control_type.
+* Return:
+*  1:								- The queue stayed full, the command was dropped.
+*  0:								- Success.
+*
+******************************************************************************/
+uint8_t control_link_send(control_link_t *link, control_type type, uint8_t fx, uint8_t item, uint32_t value)
+{
+	const uint32_t head = link->head.value;
+	const uint32_t start = HAL_GetTick();
+	while ((head - link->tail.value) >= CONTROL_QUEUE_SLOTS)
+	{
+		if ((HAL_GetTick() - start) >= CONTROL_SEND_TIMEOUT)
+		{
+			return 1;
+		}
+	}
+
+	control_command_t *slot = &link->command[head & (CONTROL_QUEUE_SLOTS - 1)];
+	slot->type = (uint8_t)type;
+	slot->fx = fx;
+	slot->item = item;
+	slot->reserved = 0;
+	slot->value = value;
+	// the command has to be visible before the new head
+	__DMB();
+	link->head.value = head + 1;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: control_link_status
+*******************************************************************************
+* Summary:
+*  Latest status snapshot of the M7. A snapshot being written is skipped, the copy taken before
+*  is returned then.
+*
+* Parameters:
+*  1. control_link_t *link			- Address pointer of the link.
+* Return:
+*  Address of the copy.
+*
+******************************************************************************/
+const control_status_t* control_link_status(control_link_t *link)
+{
+	static control_status_t copy;
+	const uint32_t before = link->sequence.value;
+	if ((before & 1) == 0)
+	{
+		__DMB();
+		copy = link->status;
+		__DMB();
+		if (link->sequence.value == before)
+		{
+			status = copy;
+		}
+	}
+	return &status;
+}
+
+#endif // CORE_CM4
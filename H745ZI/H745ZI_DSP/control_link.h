@@ -0,0 +1,152 @@
+// control_link.h, Michael Haselberger
+// Description: This file contains declarations for the control link between the menu core and the audio core
+// implemented in control_link.c. The file is shared by both core projects (CORE_CM7 / CORE_CM4).
+
+#ifndef __CONTROL_LINK_H__
+#define __CONTROL_LINK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include <arm_math.h>
+#include "defines_and_constants.h"
+#include "block_queue.h"
+#include "preset.h"
+#include "tuner.h"
+#include "telemetry.h"
+#include "latency_probe.h"
+
+// commands in the queue. a full preset (a value per parameter and the mode) fits at once. power of two
+#define CONTROL_QUEUE_SLOTS (128)
+// a full queue is waited for this long (the M7 empties it with every pass of its main loop), then the command is dropped
+#define CONTROL_SEND_TIMEOUT (50)
+// the M7 publishes its status at least this often in ms, and after every command
+#define CONTROL_STATUS_PERIOD (20)
+
+_Static_assert((CONTROL_QUEUE_SLOTS & (CONTROL_QUEUE_SLOTS - 1)) == 0, "CONTROL_QUEUE_SLOTS has to be a power of two");
+_Static_assert(CONTROL_QUEUE_SLOTS > (PRESET_EFFECTS * PRESET_PARAMETERS + PRESET_MOD_ITEMS + 1), "a preset recall has to fit into the queue");
+
+// what the menu asks the audio side for
+typedef enum
+{
+	CONTROL_VALUE = 0,			// confirmed parameter: fx (menu index), item, value 0 to 100
+	CONTROL_MODE,				// start the effect value (fx_designator)
+	CONTROL_BLOCK_SIZE,			// samples per channel and block
+	CONTROL_SAMPLE_RATE,		// Hz. the values confirmed so far are applied again
+	CONTROL_TAP,				// tap tempo, value: time of the press in ms
+	CONTROL_TUNER,				// value 1: tuner on, 0: off
+	CONTROL_LATENCY,			// value 1: start the latency sweep, 0: stop it
+	CONTROL_PROFILER_RESET		// fresh min/max values of the load page
+} control_type;
+
+typedef struct
+{
+	uint8_t type;
+	uint8_t fx;
+	uint8_t item;
+	uint8_t reserved;
+	uint32_t value;
+} control_command_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Everything the pages of the menu show, collected on the M7.
+*
+*   Members:
+*   block_size:         Samples per channel and block.
+*   sample_rate:        Sample rate in Hz.
+*   latency:            Input to output latency in samples (audio_get_latency).
+*   bpm:                Tempo (tap or MIDI clock).
+*   tempo_version:      Changes with every new tempo.
+*   program:            Preset slot of the last MIDI program change.
+*   program_count:      Incremented with every MIDI program change. The core with the menu recalls the preset.
+*   load_valid:         The profiler has blocks of the active effect.
+*   load_avg:           Average share of the block budget in 0.1 %.
+*   load_max:           Maximum share of the block budget in 0.1 %.
+*   deadline_misses:    Blocks over budget.
+*   clips:              Output segments caught by the limiter.
+*   overruns:           DMA overruns.
+*   errors:             DMA and I2S errors.
+*   admission_count:    Reports of the admission check (audio_get_admission), fx, quality and mode those of the last one.
+*   tuner:              Last tuner result, note_name the name of its note.
+*   meter:              Last output levels.
+*   latency_running:    The latency sweep is running.
+*   latency:            Round trip measured for block_size.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint16_t block_size;
+	uint32_t sample_rate;
+	uint32_t latency;
+	float32_t bpm;
+	uint32_t tempo_version;
+	uint8_t program;
+	uint32_t program_count;
+	bool load_valid;
+	uint32_t load_avg;
+	uint32_t load_max;
+	uint32_t deadline_misses;
+	uint32_t clips;
+	uint32_t overruns;
+	uint32_t errors;
+	uint32_t admission_count;
+	uint8_t admission_fx;
+	uint8_t admission_quality;
+	uint8_t admission_mode;
+#if defined(TUNER)
+	tuner_result_t tuner;
+	char note_name[4];
+#endif
+#if defined(TELEMETRY)
+	telemetry_t meter;
+#endif
+#if defined(LATENCY_PROBE)
+	bool latency_running;
+	latency_result_t round_trip;
+#endif
+} control_status_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Control link, in the inter-core mailbox (dual_core.h) with CONTROL_M4.
+*   The M4 owns the controls, the LCD and the presets and runs the menu. What the menu changes goes to the M7 as commands
+*   through a single-producer/single-consumer queue, the M7 applies them in its main loop as its own menu would. The
+*   other way, the M7 publishes a status snapshot for the pages of the menu: a sequence counter that is odd while the
+*   snapshot is written (seqlock), the M4 copies the snapshot and takes the copy only if the counter was even and didn't
+*   change meanwhile. Cache discipline as in block_queue.h: indices, counter and snapshot are in their own cache lines,
+*   the M7 cleans what it has written and invalidates what the M4 has written.
+*
+*   Members:
+*   head:               Commands sent. Written by the M4 only.
+*   tail:               Commands applied. Written by the M7 only.
+*   command:            Command queue.
+*   sequence:           Seqlock counter of the status.
+*   status:             Status snapshot.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	block_queue_index_t head;
+	block_queue_index_t tail;
+	control_command_t command[CONTROL_QUEUE_SLOTS] __attribute__((aligned(32)));
+	block_queue_index_t sequence;
+	control_status_t status __attribute__((aligned(32)));
+} __attribute__((aligned(32))) control_link_t;
+
+#if defined(CORE_CM7)
+	void control_link_init(control_link_t *link);
+	bool control_link_receive(control_link_t *link, control_command_t *command);
+	void control_link_publish(control_link_t *link, const control_status_t *status);
+#endif
+
+#if defined(CORE_CM4)
+	uint8_t control_link_send(control_link_t *link, control_type type, uint8_t fx, uint8_t item, uint32_t value);
+	const control_status_t* control_link_status(control_link_t *link);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CONTROL_LINK_H__
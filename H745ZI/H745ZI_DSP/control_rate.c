@@ -0,0 +1,70 @@
+// control_rate.c, Michael Haselberger
+// Description: Control rate evaluation of parameters that change slowly compared to the sample rate. The parameter
+// function runs once per CONTROL_RATE_SIZE samples instead of per sample, the block gets a linear ramp between its values.
+
+#include "control_rate.h"
+
+// (i + 1) / CONTROL_RATE_SIZE: the ramp of one step, ends exactly at the value of the step
+static const float32_t ramp[CONTROL_RATE_SIZE] DTCM_INIT =
+{
+#if (CONTROL_RATE_SIZE == 8)
+	0.125f, 0.25f, 0.375f, 0.5f, 0.625f, 0.75f, 0.875f, 1.0f
+#else
+#define R(i) ((float32_t)(i) / CONTROL_RATE_SIZE)
+	R(1), R(2), R(3), R(4), R(5), R(6), R(7), R(8), R(9), R(10), R(11), R(12), R(13), R(14), R(15), R(16)
+#if (CONTROL_RATE_SIZE == 32)
+	, R(17), R(18), R(19), R(20), R(21), R(22), R(23), R(24), R(25), R(26), R(27), R(28), R(29), R(30), R(31), R(32)
+#endif
+#undef R
+#endif
+};
+
+// constant value until the first step, no ramp from 0
+void control_rate_init(control_param_t *cp, float32_t value)
+{
+	cp->start = value;
+	cp->end = value;
+	cp->position = 0;
+}
+
+/******************************************************************************
+* Function Name: control_rate_run
+*******************************************************************************
+* Summary:
+*  Write one block of a control rate parameter. At the start of every step fn computes the
+*  value at its end, the samples of the step ramp linearly from the previous value to it (two
+*  CMSIS calls per step). A step that doesn't end with the block is continued by the next call.
+*
+* Parameters:
+*  1. control_param_t *cp			- Address pointer of an initialized control parameter.
+*  2. control_fn fn					- Computes the value at the end of a step.
+*  3. void *ctx						- Passed to fn.
+*  4. float32_t *dst				- Output block.
+*  5. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void control_rate_run(control_param_t *cp, control_fn fn, void *ctx, float32_t *dst, uint32_t block_size)
+{
+	uint32_t position = cp->position;
+	uint32_t offset = 0;
+
+	while (offset < block_size)
+	{
+		if (position == 0)
+		{
+			cp->start = cp->end;
+			cp->end = fn(ctx, offset);
+		}
+		const uint32_t remaining = block_size - offset;
+		const uint32_t length = ((CONTROL_RATE_SIZE - position) < remaining) ? (CONTROL_RATE_SIZE - position) : remaining;
+		// start + (end - start) * (i + 1) / CONTROL_RATE_SIZE
+		arm_scale_f32(&ramp[position], cp->end - cp->start, &dst[offset], length);
+		arm_offset_f32(&dst[offset], cp->start, &dst[offset], length);
+		position = (position + length) & (CONTROL_RATE_SIZE - 1);
+		offset += length;
+	}
+	cp->position = position;
+}
@@ -0,0 +1,48 @@
+// control_rate.h, Michael Haselberger
+// Description: This file contains declarations for the control rate evaluation implemented in control_rate.c
+
+#ifndef __CONTROL_RATE_H__
+#define __CONTROL_RATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// samples per control step: 8, 16 or 32. the wah and the phaser compute their cutoff once per step as well (as long as
+// the step divides MIN_BLOCK_SIZE)
+#define CONTROL_RATE_SIZE (8)
+
+_Static_assert((CONTROL_RATE_SIZE == 8) || (CONTROL_RATE_SIZE == 16) || (CONTROL_RATE_SIZE == 32), "CONTROL_RATE_SIZE has to be 8, 16 or 32");
+
+// value at the end of the control step that starts at sample offset of the block. ctx is the effect handle
+typedef float32_t (*control_fn)(void *ctx, uint32_t offset);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Control rate parameter: a value that is computed once per CONTROL_RATE_SIZE samples (LFO, envelope, cutoff or dB
+*   mapping) and linearly interpolated in between, by scaling and offsetting a constant ramp with CMSIS vector functions.
+*   Steps run across block boundaries, so any block size works and the values don't depend on it.
+*
+*   Members:
+*   start:              Value at the start of the current step.
+*   end:                Value at the end of the current step.
+*   position:           Samples of the current step already written, 0 = the next sample starts a new step.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t start;
+	float32_t end;
+	uint32_t position;
+} control_param_t;
+
+void control_rate_init(control_param_t *cp, float32_t value);
+void control_rate_run(control_param_t *cp, control_fn fn, void *ctx, float32_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CONTROL_RATE_H__
@@ -0,0 +1,1119 @@
+// convolver.c, Michael Haselberger
+// Description: Uniformly partitioned overlap-save FFT convolution. Long impulse responses (reverb) can't be
+// processed with arm_fir_f32 inside one block, since the cost of a direct FIR grows with every tap per sample.
+
+#include <string.h>
+#include "platform.h"
+#include "convolver.h"
+
+/******************************************************************************
+* Function Name: convolver_init
+*******************************************************************************
+* Summary:
+*  Initialize the convolution engine with caller provided spectrum memory. No impulse
+*  response is loaded afterwards, so convolver_process outputs silence until
+*  convolver_load_ir or convolver_set_partition is called.
+*
+* Parameters:
+*  1. convolver_t *conv				- Address pointer of the convolver struct.
+*  2. float32_t *ir_spectra			- Memory for max_partitions * CONVOLVER_FFT_SIZE floats.
+*  3. float32_t *fdl				- Memory for max_partitions * CONVOLVER_FFT_SIZE floats.
+*  4. uint32_t max_partitions		- Maximum number of impulse response partitions.
+* Return:
+*  255:								- Convolver or spectrum memory point to NULL, or max_partitions is 0.
+*  254:								- FFT length is not supported by CMSIS.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t convolver_init(convolver_t *conv, float32_t *ir_spectra, float32_t *fdl, uint32_t max_partitions)
+{
+	if ((conv == NULL) || (ir_spectra == NULL) || (fdl == NULL) || (max_partitions == 0))
+	{
+		return 255;
+	}
+	if (arm_rfft_fast_init_f32(&conv->fft, CONVOLVER_FFT_SIZE) != ARM_MATH_SUCCESS)
+	{
+		return 254;
+	}
+
+	conv->ir_spectra = ir_spectra;
+	conv->fdl = fdl;
+	conv->max_partitions = max_partitions;
+	conv->partitions = 0;
+	convolver_reset(conv);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: convolver_reset
+*******************************************************************************
+* Summary:
+*  Clear the input history and the frequency-domain delay line. The loaded impulse response is kept.
+*
+* Parameters:
+*  1. convolver_t *conv				- Address pointer of the convolver struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void convolver_reset(convolver_t *conv)
+{
+	memset(conv->history, 0, sizeof(conv->history));
+	memset(conv->fdl, 0, conv->max_partitions * CONVOLVER_FFT_SIZE * sizeof(float32_t));
+	conv->fdl_index = 0;
+}
+
+/******************************************************************************
+* Function Name: convolver_set_partition
+*******************************************************************************
+* Summary:
+*  Transform one partition of the impulse response and store its spectrum. Allows loading (or generating)
+*  an impulse response piece by piece, so the whole time-domain response never has to be in memory at once.
+*  The number of active partitions grows to index + 1 if necessary.
+*
+* Parameters:
+*  1. convolver_t *conv				- Address pointer of the convolver struct.
+*  2. uint32_t index				- Partition index. Partition n holds impulse response samples [n * CONVOLVER_PARTITION_SIZE, (n + 1) * CONVOLVER_PARTITION_SIZE).
+*  3. const float32_t *segment		- CONVOLVER_PARTITION_SIZE samples of the impulse response.
+* Return:
+*  254:								- Index exceeds the maximum number of partitions.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t convolver_set_partition(convolver_t *conv, uint32_t index, const float32_t *segment)
+{
+	if (index >= conv->max_partitions)
+	{
+		return 254;
+	}
+
+	// zero pad the partition to the FFT length
+	arm_copy_f32(segment, conv->scratch, CONVOLVER_PARTITION_SIZE);
+	memset(&conv->scratch[CONVOLVER_PARTITION_SIZE], 0, CONVOLVER_PARTITION_SIZE * sizeof(float32_t));
+	arm_rfft_fast_f32(&conv->fft, conv->scratch, &conv->ir_spectra[index * CONVOLVER_FFT_SIZE], 0);
+
+	if (index >= conv->partitions)
+	{
+		conv->partitions = index + 1;
+		// the FDL length changed, old entries would end up at the wrong partitions
+		convolver_reset(conv);
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: convolver_load_ir
+*******************************************************************************
+* Summary:
+*  Load a whole impulse response. The last partition is zero padded if the length is not a multiple
+*  of CONVOLVER_PARTITION_SIZE.
+*
+* Parameters:
+*  1. convolver_t *conv				- Address pointer of the convolver struct.
+*  2. const float32_t *ir			- Impulse response samples.
+*  3. uint32_t ir_length			- Number of samples in ir.
+* Return:
+*  255:								- Impulse response points to NULL or is empty.
+*  254:								- Impulse response is longer than max_partitions * CONVOLVER_PARTITION_SIZE.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t convolver_load_ir(convolver_t *conv, const float32_t *ir, uint32_t ir_length)
+{
+	if ((ir == NULL) || (ir_length == 0))
+	{
+		return 255;
+	}
+	const uint32_t partitions = (ir_length + CONVOLVER_PARTITION_SIZE - 1) / CONVOLVER_PARTITION_SIZE;
+	if (partitions > conv->max_partitions)
+	{
+		return 254;
+	}
+
+	conv->partitions = partitions;
+	for (uint32_t p = 0; p < partitions; ++p)
+	{
+		const uint32_t offset = p * CONVOLVER_PARTITION_SIZE;
+		if (ir_length - offset >= CONVOLVER_PARTITION_SIZE)
+		{
+			convolver_set_partition(conv, p, &ir[offset]);
+		}
+		else
+		{
+			// last, incomplete partition. accumulator is free at this point and used as zero padded copy
+			memset(conv->accumulator, 0, CONVOLVER_PARTITION_SIZE * sizeof(float32_t));
+			arm_copy_f32(&ir[offset], conv->accumulator, ir_length - offset);
+			convolver_set_partition(conv, p, conv->accumulator);
+		}
+	}
+	convolver_reset(conv);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: spectral_mac
+*******************************************************************************
+* Summary:
+*  Fused complex multiply-accumulate of the frequency-domain delay line: adds the FDL entry of
+*  age p times the spectrum of partition p, for p from first to last - 1, to the accumulator.
+*  Four bins are summed over all partitions in registers (8 sums, 16 operands of the 32 single
+*  precision registers), so the accumulator is read and written once instead of once per
+*  partition and no product is stored in between. The 8 floats of x and h of a partition are
+*  one cache line each, read in ascending order. The loads are grouped in front of the FMAs, so
+*  the M7 issues them next to the arithmetic of the bin before. The first complex value of the
+*  packed format holds the real DC and Nyquist bins, multiplied separately.
+*
+* Parameters:
+*  1. float32_t *acc				- Accumulated spectrum, fft_size floats.
+*  2. const float32_t *fdl			- Frequency-domain delay line, partitions entries of fft_size floats.
+*  3. const float32_t *spectra		- Impulse response spectra, fft_size floats each.
+*  4. uint32_t newest				- FDL entry of the newest input spectrum (age 0).
+*  5. uint32_t partitions			- Number of FDL entries.
+*  6. uint32_t first				- First partition.
+*  7. uint32_t last					- Partition behind the last one.
+*  8. uint32_t fft_size				- Floats per spectrum, multiple of 8.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void spectral_mac(float32_t *acc, const float32_t *fdl, const float32_t *spectra, uint32_t newest,
+	uint32_t partitions, uint32_t first, uint32_t last, uint32_t fft_size)
+{
+	if (first >= last)
+	{
+		return;
+	}
+	// FDL entry of the first partition, the entries get older towards lower indices
+	const uint32_t start = (newest >= first) ? newest - first : newest + partitions - first;
+
+	for (uint32_t bin = 0; bin < fft_size; bin += 8)
+	{
+		float32_t r0 = acc[bin], i0 = acc[bin + 1], r1 = acc[bin + 2], i1 = acc[bin + 3];
+		float32_t r2 = acc[bin + 4], i2 = acc[bin + 5], r3 = acc[bin + 6], i3 = acc[bin + 7];
+		uint32_t index = start;
+		for (uint32_t p = first; p < last; ++p)
+		{
+			const float32_t *x = &fdl[index * fft_size + bin];
+			const float32_t *h = &spectra[p * fft_size + bin];
+			const float32_t xr0 = x[0], xi0 = x[1], xr1 = x[2], xi1 = x[3];
+			const float32_t hr0 = h[0], hi0 = h[1], hr1 = h[2], hi1 = h[3];
+			const float32_t xr2 = x[4], xi2 = x[5], xr3 = x[6], xi3 = x[7];
+			const float32_t hr2 = h[4], hi2 = h[5], hr3 = h[6], hi3 = h[7];
+			if (bin == 0)
+			{
+				r0 += xr0 * hr0;
+				i0 += xi0 * hi0;
+			}
+			else
+			{
+				r0 += xr0 * hr0;
+				i0 += xr0 * hi0;
+				r0 -= xi0 * hi0;
+				i0 += xi0 * hr0;
+			}
+			r1 += xr1 * hr1;
+			i1 += xr1 * hi1;
+			r2 += xr2 * hr2;
+			i2 += xr2 * hi2;
+			r3 += xr3 * hr3;
+			i3 += xr3 * hi3;
+			r1 -= xi1 * hi1;
+			i1 += xi1 * hr1;
+			r2 -= xi2 * hi2;
+			i2 += xi2 * hr2;
+			r3 -= xi3 * hi3;
+			i3 += xi3 * hr3;
+			index = (index == 0) ? partitions - 1 : index - 1;
+		}
+		acc[bin] = r0;
+		acc[bin + 1] = i0;
+		acc[bin + 2] = r1;
+		acc[bin + 3] = i1;
+		acc[bin + 4] = r2;
+		acc[bin + 5] = i2;
+		acc[bin + 6] = r3;
+		acc[bin + 7] = i3;
+	}
+}
+
+/******************************************************************************
+* Function Name: convolver_process
+*******************************************************************************
+* Summary:
+*  Convolve one block of CONVOLVER_PARTITION_SIZE samples with the loaded impulse response.
+*  src and dst may point to the same buffer.
+*
+* Parameters:
+*  1. convolver_t *conv				- Address pointer of the convolver struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void convolver_process(convolver_t *conv, const float32_t *src, float32_t *dst)
+{
+	const uint32_t partitions = conv->partitions;
+	if (partitions == 0)
+	{
+		memset(dst, 0, CONVOLVER_PARTITION_SIZE * sizeof(float32_t));
+		return;
+	}
+
+	// overlap-save input: previous block followed by the current block
+	arm_copy_f32(&conv->history[CONVOLVER_PARTITION_SIZE], conv->history, CONVOLVER_PARTITION_SIZE);
+	arm_copy_f32(src, &conv->history[CONVOLVER_PARTITION_SIZE], CONVOLVER_PARTITION_SIZE);
+	arm_copy_f32(conv->history, conv->scratch, CONVOLVER_FFT_SIZE);
+	arm_rfft_fast_f32(&conv->fft, conv->scratch, &conv->fdl[conv->fdl_index * CONVOLVER_FFT_SIZE], 0);
+
+	// multiply-accumulate: the newest input spectrum with partition 0, the one before with partition 1 and so on
+	memset(conv->accumulator, 0, sizeof(conv->accumulator));
+	spectral_mac(conv->accumulator, conv->fdl, conv->ir_spectra, conv->fdl_index, partitions, 0, partitions, CONVOLVER_FFT_SIZE);
+	conv->fdl_index = (conv->fdl_index + 1 >= partitions) ? 0 : conv->fdl_index + 1;
+
+	// only the second half of the circular convolution is free of time-domain aliasing
+	arm_rfft_fast_f32(&conv->fft, conv->accumulator, conv->scratch, 1);
+	arm_copy_f32(&conv->scratch[CONVOLVER_PARTITION_SIZE], dst, CONVOLVER_PARTITION_SIZE);
+}
+
+// ---- Non-uniform partitioned convolution ----
+
+/******************************************************************************
+* Function Name: stage_init
+*******************************************************************************
+* Summary:
+*  Initialize one FFT tail stage and take its buffers from memory.
+*
+* Parameters:
+*  1. convolver_stage_t *stage		- Address pointer of the stage struct.
+*  2. uint32_t partition_size		- Partition size. Multiple of CONVOLVER_PARTITION_SIZE, at least 3 blocks.
+*  3. uint32_t max_partitions		- Number of partitions the stage can hold.
+*  4. float32_t *memory				- CONVOLVER_STAGE_MEMORY(partition_size, max_partitions) floats.
+* Return:
+*  254:								- FFT length is not supported by CMSIS.
+*    0:								- Success.
+*
+******************************************************************************/
+static uint8_t stage_init(convolver_stage_t *stage, uint32_t partition_size, uint32_t max_partitions, float32_t *memory)
+{
+	const uint32_t fft_size = partition_size << 1;
+	if (arm_rfft_fast_init_f32(&stage->fft, fft_size) != ARM_MATH_SUCCESS)
+	{
+		return 254;
+	}
+
+	stage->partition_size = partition_size;
+	stage->steps = partition_size / CONVOLVER_PARTITION_SIZE;
+	stage->max_partitions = max_partitions;
+	stage->partitions = 0;
+	stage->ir_spectra = memory;
+	stage->fdl = &stage->ir_spectra[max_partitions * fft_size];
+	stage->history = &stage->fdl[max_partitions * fft_size];
+	stage->accumulator = &stage->history[fft_size];
+	stage->output = &stage->accumulator[fft_size];
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: stage_reset
+*******************************************************************************
+* Summary:
+*  Clear all signal buffers of a stage. The impulse response spectra are kept.
+*
+* Parameters:
+*  1. convolver_stage_t *stage		- Address pointer of the stage struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void stage_reset(convolver_stage_t *stage)
+{
+	const uint32_t fft_size = stage->partition_size << 1;
+	memset(stage->fdl, 0, stage->max_partitions * fft_size * sizeof(float32_t));
+	// history, accumulator and output are contiguous
+	memset(stage->history, 0, ((fft_size << 1) + stage->partition_size) * sizeof(float32_t));
+	stage->fdl_index = 0;
+	stage->step = 0;
+}
+
+/******************************************************************************
+* Function Name: stage_load
+*******************************************************************************
+* Summary:
+*  Transform the part of the impulse response starting at offset into the partitions of a stage.
+*
+* Parameters:
+*  1. convolver_stage_t *stage		- Address pointer of the stage struct.
+*  2. convolver_ir_source source	- Impulse response provider.
+*  3. void *context					- Passed on to source.
+*  4. uint32_t offset				- First impulse response sample handled by this stage.
+*  5. uint32_t ir_length			- Length of the whole impulse response.
+*  6. float32_t *scratch			- At least 2 * partition_size floats.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void stage_load(convolver_stage_t *stage, convolver_ir_source source, void *context, uint32_t offset, uint32_t ir_length, float32_t *scratch)
+{
+	const uint32_t size = stage->partition_size;
+	const uint32_t fft_size = size << 1;
+
+	stage->partitions = 0;
+	while ((offset < ir_length) && (stage->partitions < stage->max_partitions))
+	{
+		const uint32_t length = ((ir_length - offset) < size) ? (ir_length - offset) : size;
+		memset(scratch, 0, fft_size * sizeof(float32_t));
+		source(scratch, offset, length, context);
+		arm_rfft_fast_f32(&stage->fft, scratch, &stage->ir_spectra[stage->partitions * fft_size], 0);
+		stage->partitions++;
+		offset += size;
+	}
+	stage_reset(stage);
+}
+
+/******************************************************************************
+* Function Name: stage_emit
+*******************************************************************************
+* Summary:
+*  Add the block of the stage output that belongs to the current step to dst.
+*
+* Parameters:
+*  1. convolver_stage_t *stage		- Address pointer of the stage struct.
+*  2. float32_t *dst				- Output block the stage output is added to.
+* Return:
+*  None.
+*
+******************************************************************************/
+static inline void stage_emit(const convolver_stage_t *stage, float32_t *dst)
+{
+	arm_add_f32(&stage->output[stage->step * CONVOLVER_PARTITION_SIZE], dst, dst, CONVOLVER_PARTITION_SIZE);
+}
+
+/******************************************************************************
+* Function Name: stage_step
+*******************************************************************************
+* Summary:
+*  Execute the work of the current step and append the input block to the current segment.
+*  Step 0 transforms the completed segment, the following steps share the MACs and the last
+*  step transforms the result back. The output of a segment is emitted during the following
+*  segment, so the output of the next block never depends on the current input block.
+*
+* Parameters:
+*  1. convolver_stage_t *stage		- Address pointer of the stage struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *scratch			- At least 2 * partition_size floats.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void stage_step(convolver_stage_t *stage, const float32_t *src, float32_t *scratch)
+{
+	const uint32_t size = stage->partition_size;
+	const uint32_t fft_size = size << 1;
+	const uint32_t partitions = stage->partitions;
+	const uint32_t step = stage->step;
+
+	if (step == 0)
+	{
+		stage->fdl_index = (stage->fdl_index + 1 >= partitions) ? 0 : stage->fdl_index + 1;
+		arm_copy_f32(stage->history, scratch, fft_size);
+		arm_rfft_fast_f32(&stage->fft, scratch, &stage->fdl[stage->fdl_index * fft_size], 0);
+		// the completed segment becomes the overlap of the next frame
+		arm_copy_f32(&stage->history[size], stage->history, size);
+		memset(stage->accumulator, 0, fft_size * sizeof(float32_t));
+	}
+	else if (step < stage->steps - 1)
+	{
+		// distribute the partitions evenly over the steps in between
+		const uint32_t first = (step - 1) * partitions / (stage->steps - 2);
+		const uint32_t last = step * partitions / (stage->steps - 2);
+		spectral_mac(stage->accumulator, stage->fdl, stage->ir_spectra, stage->fdl_index, partitions, first, last, fft_size);
+	}
+	else
+	{
+		arm_rfft_fast_f32(&stage->fft, stage->accumulator, scratch, 1);
+		arm_copy_f32(&scratch[size], stage->output, size);
+	}
+
+	arm_copy_f32(src, &stage->history[size + step * CONVOLVER_PARTITION_SIZE], CONVOLVER_PARTITION_SIZE);
+	stage->step = (step + 1 >= stage->steps) ? 0 : step + 1;
+}
+
+// partition sizes of the tail stages of every schedule in blocks, see NU_CONVOLVER_SCHEDULES. ascending, so the last
+// stage has the largest FFT and sizes the scratch buffer
+static const uint8_t schedules[NU_CONVOLVER_SCHEDULES][NU_CONVOLVER_TAIL_STAGES] = { { 8, 32 }, { 8, 16 }, { 4, 16 } };
+_Static_assert((NU_CONVOLVER_TAIL0_SIZE == 8 * CONVOLVER_PARTITION_SIZE) && (NU_CONVOLVER_TAIL1_SIZE == 32 * CONVOLVER_PARTITION_SIZE),
+	"schedule 0 doesn't match the tail constants");
+
+// partition size of a tail stage. the stage starts at twice its size
+static inline uint32_t stage_size(uint8_t schedule, uint32_t stage)
+{
+	return schedules[schedule][stage] * CONVOLVER_PARTITION_SIZE;
+}
+
+// partitions a tail stage needs for a response of length samples: up to the start of the next stage, the last stage
+// takes the rest
+static uint32_t stage_partitions(uint8_t schedule, uint32_t stage, uint32_t length)
+{
+	const uint32_t size = stage_size(schedule, stage);
+	const uint32_t offset = size << 1;
+	if ((stage + 1 < NU_CONVOLVER_TAIL_STAGES) && (length > (stage_size(schedule, stage + 1) << 1)))
+	{
+		length = stage_size(schedule, stage + 1) << 1;
+	}
+	return (length > offset) ? (length - offset + size - 1) / size : 0;
+}
+
+// floats the tail stages of a schedule and the scratch buffer take for responses of up to max_ir_length samples, and
+// the partitions every stage holds. schedule 0 takes what NU_CONVOLVER_MEMORY has behind the body
+static uint32_t schedule_floats(uint8_t schedule, uint32_t max_ir_length, uint32_t capacity[NU_CONVOLVER_TAIL_STAGES])
+{
+	uint32_t floats = 0;
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		const bool last = (i + 1 == NU_CONVOLVER_TAIL_STAGES);
+		const uint32_t partitions = stage_partitions(schedule, i, last ? max_ir_length : UINT32_MAX);
+		capacity[i] = (partitions > 0) ? partitions : 1;
+		floats += CONVOLVER_STAGE_MEMORY(stage_size(schedule, i), capacity[i]);
+	}
+	return floats + (stage_size(schedule, NU_CONVOLVER_TAIL_STAGES - 1) << 1);
+}
+
+/******************************************************************************
+* Function Name: apply_schedule
+*******************************************************************************
+* Summary:
+*  Lay the tail stages and the scratch buffer of a schedule out in the tail memory. The loaded
+*  impulse response is dropped, the partitions don't match anymore.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. uint8_t schedule				- Schedule, below NU_CONVOLVER_SCHEDULES.
+* Return:
+*  254:								- The schedule doesn't fit into the memory of nu_convolver_init.
+*    0:								- Success.
+*
+******************************************************************************/
+static uint8_t apply_schedule(nu_convolver_t *conv, uint8_t schedule)
+{
+	uint32_t capacity[NU_CONVOLVER_TAIL_STAGES];
+	if (schedule_floats(schedule, conv->max_ir_length, capacity) > conv->tail_floats)
+	{
+		return 254;
+	}
+
+	float32_t *memory = conv->tail_memory;
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		const uint32_t size = stage_size(schedule, i);
+		if (stage_init(&conv->tail[i], size, capacity[i], memory))
+		{
+			return 254;
+		}
+		memory += CONVOLVER_STAGE_MEMORY(size, capacity[i]);
+	}
+	conv->scratch = memory;
+	conv->schedule = schedule;
+	memset(conv->head_coeffs, 0, sizeof(conv->head_coeffs));
+	conv->body.partitions = 0;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_init
+*******************************************************************************
+* Summary:
+*  Initialize the non-uniform convolver and take all spectrum and stage buffers from memory.
+*  No impulse response is loaded afterwards.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. float32_t *memory				- NU_CONVOLVER_MEMORY(max_ir_length) floats.
+*  3. uint32_t max_ir_length		- Maximum impulse response length that will be loaded.
+* Return:
+*  255:								- Convolver or memory point to NULL.
+*  254:								- FFT length is not supported by CMSIS.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t nu_convolver_init(nu_convolver_t *conv, float32_t *memory, uint32_t max_ir_length)
+{
+	if ((conv == NULL) || (memory == NULL))
+	{
+		return 255;
+	}
+
+	// the body has a fixed place, the tail stages are laid out by the schedule behind it
+	float32_t *body_fdl = &memory[NU_CONVOLVER_BODY_PARTITIONS * CONVOLVER_FFT_SIZE];
+	conv->tail_memory = &body_fdl[NU_CONVOLVER_BODY_PARTITIONS * CONVOLVER_FFT_SIZE];
+	conv->tail_floats = NU_CONVOLVER_MEMORY(max_ir_length) - (2 * NU_CONVOLVER_BODY_PARTITIONS * CONVOLVER_FFT_SIZE);
+	conv->max_ir_length = max_ir_length;
+
+	if (convolver_init(&conv->body, memory, body_fdl, NU_CONVOLVER_BODY_PARTITIONS) || apply_schedule(conv, 0))
+	{
+		return 254;
+	}
+
+	arm_fir_init_f32(&conv->head, CONVOLVER_PARTITION_SIZE, conv->head_coeffs, conv->head_state, CONVOLVER_PARTITION_SIZE);
+	conv->tail_stages = NU_CONVOLVER_TAIL_STAGES;
+	nu_convolver_reset(conv);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_reset
+*******************************************************************************
+* Summary:
+*  Clear all signal buffers (FIR state, FDLs, stage outputs). The impulse response is kept.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void nu_convolver_reset(nu_convolver_t *conv)
+{
+	memset(conv->head_state, 0, sizeof(conv->head_state));
+	memset(conv->body_input, 0, sizeof(conv->body_input));
+	memset(conv->tail_output, 0, sizeof(conv->tail_output));
+	convolver_reset(&conv->body);
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		stage_reset(&conv->tail[i]);
+	}
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_set_tail_stages
+*******************************************************************************
+* Summary:
+*  Limit the tail stages that are processed, e.g. when the CPU load is too high: with one
+*  stage the impulse response ends at NU_CONVOLVER_TAIL1_OFFSET, with none at
+*  NU_CONVOLVER_TAIL0_OFFSET. A skipped stage costs nothing. A stage that is switched on
+*  again starts from silence, it never replays the signal from before it was skipped.
+*  Call from the main loop. Not for a tail that runs on the other core (DUAL_CORE).
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. uint32_t stages				- Stages processed, 0 to NU_CONVOLVER_TAIL_STAGES.
+* Return:
+*  254:								- More stages than NU_CONVOLVER_TAIL_STAGES.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t nu_convolver_set_tail_stages(nu_convolver_t *conv, uint32_t stages)
+{
+	if (stages > NU_CONVOLVER_TAIL_STAGES)
+	{
+		return 254;
+	}
+	// the stages that are added aren't touched by the audio path until tail_stages is raised
+	for (uint32_t i = conv->tail_stages; i < stages; ++i)
+	{
+		stage_reset(&conv->tail[i]);
+	}
+	__DMB();
+	conv->tail_stages = stages;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_set_schedule
+*******************************************************************************
+* Summary:
+*  Lay the tail stages out for another schedule (NU_CONVOLVER_SCHEDULES). The impulse response
+*  has to be loaded again afterwards, unless the schedule was set already. Call from the main
+*  loop while the convolver isn't processed.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of an initialized convolver struct.
+*  2. uint8_t schedule				- Schedule, below NU_CONVOLVER_SCHEDULES.
+* Return:
+*  254:								- Unknown schedule, or it doesn't fit into the memory of nu_convolver_init.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t nu_convolver_set_schedule(nu_convolver_t *conv, uint8_t schedule)
+{
+	if (schedule >= NU_CONVOLVER_SCHEDULES)
+	{
+		return 254;
+	}
+	if (schedule == conv->schedule)
+	{
+		return 0;
+	}
+	const uint8_t status = apply_schedule(conv, schedule);
+	nu_convolver_reset(conv);
+	return status;
+}
+
+// fastest of PROBE_RUNS runs in cycles: the audio interrupt may preempt any single run
+#define PROBE_RUNS (4)
+// FFT lengths probed: 2 << k blocks, from the body (k = 0) to the largest tail stage of any schedule
+#define PROBE_SIZES (6)
+_Static_assert((CONVOLVER_FFT_SIZE << (PROBE_SIZES - 1)) == (NU_CONVOLVER_TAIL1_SIZE << 1), "PROBE_SIZES doesn't cover the largest stage");
+
+// cycles of the kernels on the convolver memory
+typedef struct
+{
+	uint32_t head;
+	uint32_t fft[PROBE_SIZES];
+	uint32_t mac[PROBE_SIZES];
+} convolver_probe_t;
+
+/******************************************************************************
+* Function Name: probe_kernels
+*******************************************************************************
+* Summary:
+*  Time the head FIR, a real FFT and the MAC of one partition (spectral_mac) of every FFT
+*  length on buffers at the start of the tail memory, so the placement of the spectra is
+*  part of the result. The buffers are cleared first, the kernels don't depend on the
+*  values.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of an initialized convolver struct.
+*  2. convolver_probe_t *probe		- Returns the cycles of the kernels.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void probe_kernels(nu_convolver_t *conv, convolver_probe_t *probe)
+{
+	const uint32_t largest = CONVOLVER_FFT_SIZE << (PROBE_SIZES - 1);
+	float32_t *x = conv->tail_memory;
+	float32_t *h = &x[largest];
+	float32_t *y = &h[largest];
+	memset(x, 0, 3 * largest * sizeof(float32_t));
+	platform_cycles_init();
+
+	probe->head = UINT32_MAX;
+	for (uint32_t r = 0; r < PROBE_RUNS; ++r)
+	{
+		const uint32_t start = platform_cycles();
+		arm_fir_f32(&conv->head, x, y, CONVOLVER_PARTITION_SIZE);
+		const uint32_t cycles = platform_cycles() - start;
+		probe->head = (cycles < probe->head) ? cycles : probe->head;
+	}
+	for (uint32_t k = 0; k < PROBE_SIZES; ++k)
+	{
+		const uint32_t n = CONVOLVER_FFT_SIZE << k;
+		arm_rfft_fast_instance_f32 fft;
+		arm_rfft_fast_init_f32(&fft, n);
+		probe->fft[k] = UINT32_MAX;
+		probe->mac[k] = UINT32_MAX;
+		for (uint32_t r = 0; r < PROBE_RUNS; ++r)
+		{
+			uint32_t start = platform_cycles();
+			arm_rfft_fast_f32(&fft, x, y, 0);
+			uint32_t cycles = platform_cycles() - start;
+			probe->fft[k] = (cycles < probe->fft[k]) ? cycles : probe->fft[k];
+
+			// two partitions, x and h are contiguous: the accumulator is read once for both, as in the stages
+			start = platform_cycles();
+			spectral_mac(y, x, x, 1, 2, 0, 2, n);
+			cycles = (platform_cycles() - start) >> 1;
+			probe->mac[k] = (cycles < probe->mac[k]) ? cycles : probe->mac[k];
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: schedule_peak
+*******************************************************************************
+* Summary:
+*  Worst case cycles per block of a schedule for a response of length samples. The stages step
+*  in lockstep from the reset, their step counts are powers of two, so the blocks of the
+*  largest stage cover every combination of steps. With the tail on the other core the peak is
+*  the slower of the two cores, otherwise their sum.
+*
+* Parameters:
+*  1. const convolver_probe_t *probe - Cycles of the kernels.
+*  2. uint8_t schedule				- Schedule, below NU_CONVOLVER_SCHEDULES.
+*  3. uint32_t length				- Number of impulse response samples.
+*  4. bool remote_tail				- The tail runs on the M4 (NU_CONVOLVER_REMOTE_WEIGHT).
+* Return:
+*  Cycles of the most expensive block.
+*
+******************************************************************************/
+static uint32_t schedule_peak(const convolver_probe_t *probe, uint8_t schedule, uint32_t length, bool remote_tail)
+{
+	// head and body, every block: the FIR, the two FFTs and a MAC per body partition
+	const uint32_t body_max = 2 * schedules[schedule][0] - 1;
+	const uint32_t body_needed = (length > CONVOLVER_PARTITION_SIZE) ? (length - 1) / CONVOLVER_PARTITION_SIZE : 0;
+	const uint32_t body = (body_needed < body_max) ? body_needed : body_max;
+	const uint32_t head = probe->head + ((body > 0) ? 2 * probe->fft[0] + body * probe->mac[0] : 0);
+
+	// tail: forward FFT in the first step, the MACs shared by the steps in between, inverse FFT in the last step
+	uint32_t tail = 0;
+	for (uint32_t block = 0; block < schedules[schedule][NU_CONVOLVER_TAIL_STAGES - 1]; ++block)
+	{
+		uint32_t cycles = 0;
+		for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+		{
+			const uint32_t partitions = stage_partitions(schedule, i, length);
+			const uint32_t steps = schedules[schedule][i];
+			const uint32_t step = block % steps;
+			const uint32_t k = (uint32_t)__builtin_ctz(steps);
+			if (partitions == 0)
+				continue;
+			if ((step == 0) || (step == steps - 1))
+				cycles += probe->fft[k];
+			else
+				cycles += (step * partitions / (steps - 2) - (step - 1) * partitions / (steps - 2)) * probe->mac[k];
+		}
+		tail = (cycles > tail) ? cycles : tail;
+	}
+
+	if (remote_tail)
+	{
+		tail *= NU_CONVOLVER_REMOTE_WEIGHT;
+		return (head > tail) ? head : tail;
+	}
+	return head + tail;
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_autotune
+*******************************************************************************
+* Summary:
+*  Pick the tail schedule with the lowest worst case load per block for an impulse response of
+*  ir_length samples and lay the stages out for it. The head FIR, the FFTs and the partition
+*  MAC are timed on the convolver memory (a few ms at most), the load of every block of every
+*  schedule that fits the memory is estimated from them. The probes overwrite the tail memory:
+*  call before the impulse response is loaded, from the main loop while the convolver isn't
+*  processed. The result depends on the block size, the memory and the core of the tail, so
+*  keep it with the spectra (reverb_load) rather than tuning again on every load.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of an initialized convolver struct.
+*  2. uint32_t ir_length			- Number of samples of the response that will be loaded.
+*  3. bool remote_tail				- The tail is processed by the other core (dual_core_attach).
+* Return:
+*  The schedule, set with nu_convolver_set_schedule.
+*
+******************************************************************************/
+uint8_t nu_convolver_autotune(nu_convolver_t *conv, uint32_t ir_length, bool remote_tail)
+{
+	convolver_probe_t probe;
+	probe_kernels(conv, &probe);
+
+	uint8_t best = 0;
+	uint32_t lowest = UINT32_MAX;
+	for (uint8_t schedule = 0; schedule < NU_CONVOLVER_SCHEDULES; ++schedule)
+	{
+		uint32_t capacity[NU_CONVOLVER_TAIL_STAGES];
+		if (schedule_floats(schedule, conv->max_ir_length, capacity) > conv->tail_floats)
+			continue;
+		const uint32_t peak = schedule_peak(&probe, schedule, ir_length, remote_tail);
+		if (peak < lowest)
+		{
+			lowest = peak;
+			best = schedule;
+		}
+	}
+
+	// the probes overwrote whatever the stages held
+	apply_schedule(conv, best);
+	nu_convolver_reset(conv);
+	return best;
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_load
+*******************************************************************************
+* Summary:
+*  Load an impulse response segment by segment from source and distribute it over head, body
+*  and tail stages.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. convolver_ir_source source	- Impulse response provider.
+*  3. void *context					- Passed on to source.
+*  4. uint32_t ir_length			- Number of impulse response samples.
+* Return:
+*  255:								- Source is NULL or the impulse response is empty.
+*  254:								- Impulse response is longer than the memory passed to nu_convolver_init allows.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t nu_convolver_load(nu_convolver_t *conv, convolver_ir_source source, void *context, uint32_t ir_length)
+{
+	if ((source == NULL) || (ir_length == 0))
+	{
+		return 255;
+	}
+	const convolver_stage_t *last = &conv->tail[NU_CONVOLVER_TAIL_STAGES - 1];
+	if (ir_length > (last->partition_size << 1) + last->max_partitions * last->partition_size)
+	{
+		return 254;
+	}
+
+	// head: CMSIS expects FIR coefficients in time reversed order
+	const uint32_t head_length = (ir_length < CONVOLVER_PARTITION_SIZE) ? ir_length : CONVOLVER_PARTITION_SIZE;
+	memset(conv->scratch, 0, CONVOLVER_PARTITION_SIZE * sizeof(float32_t));
+	source(conv->scratch, 0, head_length, context);
+	for (uint32_t i = 0; i < CONVOLVER_PARTITION_SIZE; ++i)
+	{
+		conv->head_coeffs[i] = conv->scratch[CONVOLVER_PARTITION_SIZE - 1 - i];
+	}
+
+	// body, up to the first tail stage of the schedule
+	const uint32_t body_end = conv->tail[0].partition_size << 1;
+	conv->body.partitions = 0;
+	for (uint32_t offset = CONVOLVER_PARTITION_SIZE; (offset < ir_length) && (offset < body_end); offset += CONVOLVER_PARTITION_SIZE)
+	{
+		const uint32_t length = ((ir_length - offset) < CONVOLVER_PARTITION_SIZE) ? (ir_length - offset) : CONVOLVER_PARTITION_SIZE;
+		memset(conv->scratch, 0, CONVOLVER_PARTITION_SIZE * sizeof(float32_t));
+		source(conv->scratch, offset, length, context);
+		convolver_set_partition(&conv->body, offset / CONVOLVER_PARTITION_SIZE - 1, conv->scratch);
+	}
+
+	// tails, every stage starts at twice its partition size
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		stage_load(&conv->tail[i], source, context, conv->tail[i].partition_size << 1, ir_length, conv->scratch);
+	}
+	nu_convolver_reset(conv);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: array_source
+*******************************************************************************
+* Summary:
+*  convolver_ir_source for impulse responses stored as array (context).
+*
+******************************************************************************/
+static void array_source(float32_t *dst, uint32_t offset, uint32_t length, void *context)
+{
+	arm_copy_f32(&((const float32_t *)context)[offset], dst, length);
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_load_ir
+*******************************************************************************
+* Summary:
+*  Load an impulse response stored as array. See nu_convolver_load.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. const float32_t *ir			- Impulse response samples.
+*  3. uint32_t ir_length			- Number of samples in ir.
+* Return:
+*  See nu_convolver_load.
+*
+******************************************************************************/
+uint8_t nu_convolver_load_ir(nu_convolver_t *conv, const float32_t *ir, uint32_t ir_length)
+{
+	if (ir == NULL)
+	{
+		return 255;
+	}
+	return nu_convolver_load(conv, array_source, (void *)ir, ir_length);
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_load_image
+*******************************************************************************
+* Summary:
+*  Load an impulse response transformed ahead of time. The head coefficients and the spectra
+*  are copied into the convolver memory, nothing is transformed. Takes well under a millisecond
+*  even for the longest responses, against hundreds for nu_convolver_load.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. const nu_convolver_image_t *image	- Transformed impulse response (dsp_helpers.export_ir_spectra).
+* Return:
+*  255:								- Image or its head points to NULL, or a stage with partitions has no spectra.
+*  254:								- Image was computed for another partition size, or has more partitions than
+*									  the convolver was initialized for.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t nu_convolver_load_image(nu_convolver_t *conv, const nu_convolver_image_t *image)
+{
+	if ((image == NULL) || (image->head == NULL) || (image->body_partitions && (image->body == NULL)))
+	{
+		return 255;
+	}
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		if (image->tail_partitions[i] && (image->tail[i] == NULL))
+		{
+			return 255;
+		}
+	}
+
+	float32_t *regions[NU_CONVOLVER_IMAGE_REGIONS];
+	uint32_t sizes[NU_CONVOLVER_IMAGE_REGIONS];
+	const uint8_t status = nu_convolver_prepare_image(conv, image, regions, sizes);
+	if (status)
+	{
+		return status;
+	}
+	arm_copy_f32(image->head, regions[0], sizes[0]);
+	arm_copy_f32(image->body, regions[1], sizes[1]);
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		arm_copy_f32(image->tail[i], regions[2 + i], sizes[2 + i]);
+	}
+	nu_convolver_reset(conv);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_prepare_image
+*******************************************************************************
+* Summary:
+*  Get the convolver ready for an image that is filled in by the caller, e.g. streamed from a
+*  file in chunks (library.h): checks the partition counts against the convolver, takes them
+*  over and returns where the head coefficients and the spectra of every stage go. The caller
+*  writes sizes[r] floats to regions[r], then calls nu_convolver_reset. Only the counts, the
+*  partition size and the schedule of shape are read, the tail stages are laid out for the
+*  schedule. The convolver must not be processed until the regions are
+*  filled.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of an initialized convolver struct.
+*  2. const nu_convolver_image_t *shape	- Partition size and partition counts of the image.
+*  3. float32_t *regions[]			- Returns the destination of head, body and tail stages (NU_CONVOLVER_IMAGE_REGIONS).
+*  4. uint32_t sizes[]				- Returns the number of floats of every region.
+* Return:
+*  255:								- Shape points to NULL.
+*  254:								- Image was computed for another partition size, or has more partitions than
+*									  the convolver was initialized for.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t nu_convolver_prepare_image(nu_convolver_t *conv, const nu_convolver_image_t *shape, float32_t *regions[NU_CONVOLVER_IMAGE_REGIONS], uint32_t sizes[NU_CONVOLVER_IMAGE_REGIONS])
+{
+	if (shape == NULL)
+	{
+		return 255;
+	}
+	if ((shape->partition_size != CONVOLVER_PARTITION_SIZE) || (shape->schedule >= NU_CONVOLVER_SCHEDULES)
+		|| nu_convolver_set_schedule(conv, (uint8_t)shape->schedule)
+		|| (shape->body_partitions > (2u * schedules[shape->schedule][0] - 1u)))
+	{
+		return 254;
+	}
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		if (shape->tail_partitions[i] > conv->tail[i].max_partitions)
+		{
+			return 254;
+		}
+	}
+
+	regions[0] = conv->head_coeffs;
+	sizes[0] = CONVOLVER_PARTITION_SIZE;
+	conv->body.partitions = shape->body_partitions;
+	regions[1] = conv->body.ir_spectra;
+	sizes[1] = shape->body_partitions * CONVOLVER_FFT_SIZE;
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		convolver_stage_t *stage = &conv->tail[i];
+		stage->partitions = shape->tail_partitions[i];
+		regions[2 + i] = stage->ir_spectra;
+		sizes[2 + i] = stage->partitions * (stage->partition_size << 1);
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_process_head
+*******************************************************************************
+* Summary:
+*  Convolve one block with the head and body of the impulse response (the first NU_CONVOLVER_TAIL0_OFFSET samples).
+*  src and dst must not overlap, since the input is still needed after the head has written dst.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void nu_convolver_process_head(nu_convolver_t *conv, const float32_t *src, float32_t *dst)
+{
+	arm_fir_f32(&conv->head, (float32_t *)src, dst, CONVOLVER_PARTITION_SIZE);
+
+	// the body starts one block into the impulse response, so the previous input block is convolved.
+	// the scratch buffer belongs to the tail (possibly running on the other core), so the body uses the stack
+	if (conv->body.partitions)
+	{
+		float32_t body[CONVOLVER_PARTITION_SIZE];
+		convolver_process(&conv->body, conv->body_input, body);
+		arm_add_f32(body, dst, dst, CONVOLVER_PARTITION_SIZE);
+	}
+	arm_copy_f32(src, conv->body_input, CONVOLVER_PARTITION_SIZE);
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_process_tail
+*******************************************************************************
+* Summary:
+*  Feed one block into the tail stages and get the tail output of the NEXT block. The output is added
+*  to the output of nu_convolver_process_head one block later, which allows processing the tail on the
+*  other core without additional latency.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Tail output of the next block.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void nu_convolver_process_tail(nu_convolver_t *conv, const float32_t *src, float32_t *dst)
+{
+	memset(dst, 0, CONVOLVER_PARTITION_SIZE * sizeof(float32_t));
+	const uint32_t stages = conv->tail_stages;
+	for (uint32_t i = 0; i < stages; ++i)
+	{
+		if (conv->tail[i].partitions)
+		{
+			stage_step(&conv->tail[i], src, conv->scratch);
+			stage_emit(&conv->tail[i], dst);
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: nu_convolver_process
+*******************************************************************************
+* Summary:
+*  Convolve one block of CONVOLVER_PARTITION_SIZE samples with the loaded impulse response on the calling core.
+*  src and dst must not overlap, since the input is still needed after the head has written dst.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void nu_convolver_process(nu_convolver_t *conv, const float32_t *src, float32_t *dst)
+{
+	nu_convolver_process_head(conv, src, dst);
+	arm_add_f32(conv->tail_output, dst, dst, CONVOLVER_PARTITION_SIZE);
+	nu_convolver_process_tail(conv, src, conv->tail_output);
+}
@@ -0,0 +1,206 @@
+// convolver.h, Michael Haselberger
+// Description: This file contains declarations for the uniformly partitioned FFT convolution engine implemented in convolver.c
+
+#ifndef __CONVOLVER_H__
+#define __CONVOLVER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// every partition of the impulse response has the length of one processing block.
+// the FFT has to be twice as long, so the circular convolution of one partition contains a full block of valid output samples
+#define CONVOLVER_PARTITION_SIZE (PING_PONG_BUFFER_SIZE)
+#define CONVOLVER_FFT_SIZE (CONVOLVER_PARTITION_SIZE << 1)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Uniformly partitioned overlap-save convolution.
+*   The impulse response is split into partitions of CONVOLVER_PARTITION_SIZE samples, each one is transformed once
+*   (zero padded to CONVOLVER_FFT_SIZE) when the impulse response is loaded. Every block, the last two input blocks are
+*   transformed and stored in a frequency-domain delay line (FDL). The output spectrum is the sum of all FDL entries,
+*   each multiplied with the spectrum of the partition matching its age. This costs one forward FFT, one inverse FFT and
+*   one complex multiply-accumulate per partition, independent of where the energy of the impulse response is.
+*
+*   Spectra are stored in the packed format of arm_rfft_fast_f32 (CONVOLVER_FFT_SIZE floats per spectrum).
+*
+*   Members:
+*   fft:                CMSIS real FFT instance.
+*   ir_spectra:         Spectra of the impulse response partitions (max_partitions * CONVOLVER_FFT_SIZE floats). Caller provided.
+*   fdl:                Frequency-domain delay line (max_partitions * CONVOLVER_FFT_SIZE floats). Caller provided.
+*   max_partitions:     Number of partitions ir_spectra and fdl can hold.
+*   partitions:         Number of partitions of the currently loaded impulse response. 0 if none is loaded.
+*   fdl_index:          FDL entry the next input spectrum is written to.
+*   history:            The previous and the current input block (overlap-save input).
+*   scratch:            Temporary buffer. arm_rfft_fast_f32 overwrites its input, so transforms are done on copies.
+*   accumulator:        Sum of all partition products of the current block.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	arm_rfft_fast_instance_f32 fft;
+	float32_t *ir_spectra;
+	float32_t *fdl;
+	uint32_t max_partitions;
+	uint32_t partitions;
+	uint32_t fdl_index;
+	float32_t history[CONVOLVER_FFT_SIZE];
+	float32_t scratch[CONVOLVER_FFT_SIZE];
+	float32_t accumulator[CONVOLVER_FFT_SIZE];
+} convolver_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Non-uniformly partitioned convolution.
+*   A uniform partition size of one block keeps the latency at zero, but every partition costs one spectral MAC per block,
+*   so long impulse responses need hundreds of MACs per block. Here, the impulse response is split into:
+*
+*   head:   [0, P)              direct form FIR (arm_fir_f32). No added latency.
+*   body:   [P, 16P)            uniform convolver_t with partitions of P, fed with the previous block.
+*   tail 0: [16P, 64P)          FFT partitions of 8P.
+*   tail 1: [64P, ...)          FFT partitions of 32P.
+*
+*   (P = CONVOLVER_PARTITION_SIZE.) Head and body (nu_convolver_process_head) are cheap and computed for the current block.
+*   The tail (nu_convolver_process_tail) returns its output one block ahead, so it can run on another core one block behind
+*   without adding latency. A tail stage with partition size B starts at an offset of 2B: while one segment of B
+*   input samples is collected, the previous segment is processed in small steps, one per block (forward FFT, a share of the
+*   MACs, inverse FFT). The result is ready before it is needed, so the load per block stays flat instead of peaking
+*   every time a big partition is complete. This is schedule 0, the others (NU_CONVOLVER_SCHEDULES) move the stage
+*   boundaries within the same memory. Which one has the lowest peak load depends on the block size, the length of the
+*   response, the memory and the core the tail runs on: nu_convolver_autotune times the kernels and picks it.
+*
+*   Members (stage):
+*   steps:              Blocks per partition (partition_size / CONVOLVER_PARTITION_SIZE). At least 3.
+*   step:               Step executed in the current block.
+*   fdl_index:          FDL entry of the newest input segment spectrum.
+*   history:            The previous and the current input segment (2 * partition_size).
+*   accumulator:        Output spectrum, accumulated over several steps.
+*   output:             Time-domain result, emitted one block per step.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+#define NU_CONVOLVER_BODY_PARTITIONS (15)
+#define NU_CONVOLVER_TAIL_STAGES (2)
+#define NU_CONVOLVER_TAIL0_SIZE (CONVOLVER_PARTITION_SIZE << 3)
+#define NU_CONVOLVER_TAIL0_OFFSET (CONVOLVER_PARTITION_SIZE << 4)
+#define NU_CONVOLVER_TAIL0_PARTITIONS (6)
+#define NU_CONVOLVER_TAIL1_SIZE (CONVOLVER_PARTITION_SIZE << 5)
+#define NU_CONVOLVER_TAIL1_OFFSET (CONVOLVER_PARTITION_SIZE << 6)
+// number of tail 1 partitions needed for an impulse response of length samples
+#define NU_CONVOLVER_TAIL1_PARTITIONS(length) (((length) > NU_CONVOLVER_TAIL1_OFFSET) ? (((length) - NU_CONVOLVER_TAIL1_OFFSET + NU_CONVOLVER_TAIL1_SIZE - 1) / NU_CONVOLVER_TAIL1_SIZE) : 1)
+// tail schedules of nu_convolver_set_schedule: the partition sizes of the stages in blocks. a stage of size B starts at
+// 2B, the body fills the blocks in front of the first stage. 0 is the layout of the constants above, the others fit
+// into the same memory: 8P/16P (smaller FFTs, more MACs), 4P/16P (shorter body, tail 0 starts at 8P)
+#define NU_CONVOLVER_SCHEDULES (3)
+// nu_convolver_autotune with the tail on the M4: it runs at half the clock of the M7, its cycles count twice
+#define NU_CONVOLVER_REMOTE_WEIGHT (2)
+// floats needed by one stage: IR spectra and FDL (2 * fft size each), history, accumulator and output
+#define CONVOLVER_STAGE_MEMORY(size, partitions) ((4 * (size) * (partitions)) + (5 * (size)))
+// floats needed by nu_convolver_init for impulse responses of up to length samples
+#define NU_CONVOLVER_MEMORY(length) ((2 * NU_CONVOLVER_BODY_PARTITIONS * CONVOLVER_FFT_SIZE) \
+	+ CONVOLVER_STAGE_MEMORY(NU_CONVOLVER_TAIL0_SIZE, NU_CONVOLVER_TAIL0_PARTITIONS) \
+	+ CONVOLVER_STAGE_MEMORY(NU_CONVOLVER_TAIL1_SIZE, NU_CONVOLVER_TAIL1_PARTITIONS(length)) \
+	+ (2 * NU_CONVOLVER_TAIL1_SIZE))
+
+typedef struct
+{
+	arm_rfft_fast_instance_f32 fft;
+	uint32_t partition_size;
+	uint32_t steps;
+	uint32_t step;
+	uint32_t max_partitions;
+	uint32_t partitions;
+	uint32_t fdl_index;
+	float32_t *ir_spectra;
+	float32_t *fdl;
+	float32_t *history;
+	float32_t *accumulator;
+	float32_t *output;
+} convolver_stage_t;
+
+typedef struct
+{
+	arm_fir_instance_f32 head;
+	float32_t head_coeffs[CONVOLVER_PARTITION_SIZE];
+	float32_t head_state[(CONVOLVER_PARTITION_SIZE << 1) - 1];
+	convolver_t body;
+	float32_t body_input[CONVOLVER_PARTITION_SIZE];
+	// tail output for the next block (single core processing)
+	float32_t tail_output[CONVOLVER_PARTITION_SIZE];
+	float32_t *scratch;
+	// tail stages processed, the later ones are skipped (shorter reverb, see nu_convolver_set_tail_stages)
+	volatile uint32_t tail_stages;
+	// schedule the tail stages are laid out for (nu_convolver_set_schedule), in the floats behind the body memory
+	uint8_t schedule;
+	float32_t *tail_memory;
+	uint32_t tail_floats;
+	uint32_t max_ir_length;
+	// the tail can be processed by the other core. the stages start at a cache line, so writing the members
+	// above never evicts (and overwrites) tail state updated by the other core
+	convolver_stage_t tail[NU_CONVOLVER_TAIL_STAGES] __attribute__((aligned(32)));
+} nu_convolver_t;
+
+// Provides length samples of the impulse response starting at offset. Segments are requested in ascending,
+// contiguous order, so generators don't have to be able to seek.
+typedef void (*convolver_ir_source)(float32_t *dst, uint32_t offset, uint32_t length, void *context);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Impulse response transformed ahead of time (dsp_helpers.export_ir_spectra), stored as const data in flash. Holds
+*   exactly what nu_convolver_load computes: the time reversed head coefficients and the spectra of the body and tail
+*   partitions in the packed format of arm_rfft_fast_f32. nu_convolver_load_image copies them into the convolver memory,
+*   so switching to the response costs no FFT. The spectra are copied rather than read from flash, so the load per
+*   block doesn't depend on flash wait states.
+*
+*   Members:
+*   partition_size:     CONVOLVER_PARTITION_SIZE the spectra were computed for.
+*   rate:               Sample rate of the response in Hz.
+*   ir_length:          Number of samples of the response.
+*   body_partitions:    Number of body spectra (CONVOLVER_FFT_SIZE floats each).
+*   tail_partitions:    Number of spectra per tail stage (2 * stage partition size floats each).
+*   head:               CONVOLVER_PARTITION_SIZE head coefficients, time reversed.
+*   body:               Body spectra. NULL if body_partitions is 0.
+*   tail:               Tail stage spectra. NULL if the stage has no partitions.
+*   schedule:           Tail schedule the spectra were computed for (nu_convolver_set_schedule). 0, the default, for
+*                       the images of dsp_helpers.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t partition_size;
+	uint32_t rate;
+	uint32_t ir_length;
+	uint32_t body_partitions;
+	uint32_t tail_partitions[NU_CONVOLVER_TAIL_STAGES];
+	const float32_t *head;
+	const float32_t *body;
+	const float32_t *tail[NU_CONVOLVER_TAIL_STAGES];
+	uint32_t schedule;
+} nu_convolver_image_t;
+
+// parts of an image in their stored order: head, body, tail stages (see nu_convolver_prepare_image)
+#define NU_CONVOLVER_IMAGE_REGIONS (2 + NU_CONVOLVER_TAIL_STAGES)
+
+uint8_t convolver_init(convolver_t *conv, float32_t *ir_spectra, float32_t *fdl, uint32_t max_partitions);
+uint8_t convolver_load_ir(convolver_t *conv, const float32_t *ir, uint32_t ir_length);
+uint8_t convolver_set_partition(convolver_t *conv, uint32_t index, const float32_t *segment);
+void convolver_reset(convolver_t *conv);
+void convolver_process(convolver_t *conv, const float32_t *src, float32_t *dst);
+
+uint8_t nu_convolver_init(nu_convolver_t *conv, float32_t *memory, uint32_t max_ir_length);
+uint8_t nu_convolver_load(nu_convolver_t *conv, convolver_ir_source source, void *context, uint32_t ir_length);
+uint8_t nu_convolver_load_ir(nu_convolver_t *conv, const float32_t *ir, uint32_t ir_length);
+uint8_t nu_convolver_load_image(nu_convolver_t *conv, const nu_convolver_image_t *image);
+uint8_t nu_convolver_prepare_image(nu_convolver_t *conv, const nu_convolver_image_t *shape, float32_t *regions[NU_CONVOLVER_IMAGE_REGIONS], uint32_t sizes[NU_CONVOLVER_IMAGE_REGIONS]);
+uint8_t nu_convolver_set_schedule(nu_convolver_t *conv, uint8_t schedule);
+uint8_t nu_convolver_autotune(nu_convolver_t *conv, uint32_t ir_length, bool remote_tail);
+void nu_convolver_reset(nu_convolver_t *conv);
+uint8_t nu_convolver_set_tail_stages(nu_convolver_t *conv, uint32_t stages);
+void nu_convolver_process(nu_convolver_t *conv, const float32_t *src, float32_t *dst);
+void nu_convolver_process_head(nu_convolver_t *conv, const float32_t *src, float32_t *dst);
+void nu_convolver_process_tail(nu_convolver_t *conv, const float32_t *src, float32_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CONVOLVER_H__
@@ -0,0 +1,120 @@
+// cost_model.c, Michael Haselberger
+// Description: Per-node cost model. Predicts the cycles and the memory a node needs from the table of the on-target
+// benchmark (cost_table.h), so an effect can be checked against the block deadline before it is switched on, instead
+// of discovering the overload once it runs.
+
+#include "cost_model.h"
+#include "fx_lib.h"
+#include "cost_table.h"
+
+// entry of a node type and variant. COST_ANY takes the first entry of the node. NULL if the table doesn't know it
+static const cost_entry_t* find(uint8_t fx, uint8_t variant)
+{
+	for (const cost_entry_t *entry = cost_table; entry->fx != FXNONE; ++entry)
+	{
+		if ((entry->fx == fx) && ((variant == COST_ANY) || (entry->variant == COST_ANY) || (entry->variant == variant)))
+		{
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/******************************************************************************
+* Function Name: cost_cycles
+*******************************************************************************
+* Summary:
+*  Predict the cycles a node takes per block, all channels together. Between two block sizes
+*  of the table the cost is interpolated linearly.
+*
+* Parameters:
+*  1. uint8_t fx					- fx_designator of the node.
+*  2. uint8_t variant				- Setting the cost depends on, see cost_entry_t.
+*  3. arena_class placement			- Placement of the node buffers, COST_PLACEMENT for the chain.
+*  4. uint32_t n					- Samples per channel. Range: MIN_BLOCK_SIZE <= n <= MAX_BLOCK_SIZE.
+* Return:
+*  0:								- The table doesn't know the node or variant, or it wasn't measured in
+*									  this placement.
+*  Cycles per block otherwise.
+*
+******************************************************************************/
+uint32_t cost_cycles(uint8_t fx, uint8_t variant, arena_class placement, uint32_t n)
+{
+	const cost_entry_t *entry = find(fx, variant);
+	if ((entry == NULL) || (placement >= COST_PLACEMENTS) || (n < MIN_BLOCK_SIZE) || (n > MAX_BLOCK_SIZE))
+	{
+		return 0;
+	}
+
+	const uint32_t *cycles = entry->cycles[placement];
+	uint8_t b = 0;
+	while ((b < (COST_BLOCK_SIZES - 1)) && (((uint32_t)MIN_BLOCK_SIZE << (b + 1)) <= n))
+		b++;
+	uint32_t block = cycles[b];
+	const uint32_t low = (uint32_t)MIN_BLOCK_SIZE << b;
+	if ((n > low) && (b < (COST_BLOCK_SIZES - 1)))
+	{
+		if ((block == 0) || (cycles[b + 1] == 0))
+		{
+			return 0;
+		}
+		// on the line between the two measured sizes (the upper one is 2 * low)
+		const int64_t step = (int64_t)cycles[b + 1] - (int64_t)block;
+		block = (uint32_t)((int64_t)block + (step * (int64_t)(n - low)) / (int64_t)low);
+	}
+	return entry->stereo ? block : block * AUDIO_CHANNELS;
+}
+
+// bytes a node takes from an arena when it's activated, in the arena it tries first. 0 for nodes the table doesn't know
+uint32_t cost_memory(uint8_t fx, uint8_t variant, arena_class cls)
+{
+	const cost_entry_t *entry = find(fx, variant);
+	return ((entry == NULL) || (cls >= ARENA_CLASSES)) ? 0 : entry->memory[cls];
+}
+
+/******************************************************************************
+* Function Name: cost_memory_fits
+*******************************************************************************
+* Summary:
+*  Check if the arenas have room for the buffers of a node. Bytes the first arena lacks room for
+*  are checked against the fallback arena of the node, on top of what the node takes from there
+*  anyway. The free bytes of an arena may be split into several blocks, so a fit isn't a
+*  guarantee, the activation still checks.
+*
+* Parameters:
+*  1. uint8_t fx					- fx_designator of the node.
+*  2. uint8_t variant				- Setting the cost depends on, see cost_entry_t.
+* Return:
+*  true if no arena lacks the bytes the node takes. false for nodes the table doesn't know.
+*
+******************************************************************************/
+bool cost_memory_fits(uint8_t fx, uint8_t variant)
+{
+	const cost_entry_t *entry = find(fx, variant);
+	if (entry == NULL)
+	{
+		return false;
+	}
+
+	const uint8_t fallback = entry->fallback;
+	for (uint8_t cls = 0; cls < ARENA_CLASSES; ++cls)
+	{
+		const uint32_t bytes = entry->memory[cls];
+		if (bytes <= arena_available(cls))
+			continue;
+		if ((fallback < ARENA_CLASSES) && (fallback != cls) && ((bytes + entry->memory[fallback]) <= arena_available(fallback)))
+			continue;
+		return false;
+	}
+	return true;
+}
+
+// variant of the cabinet for a response length (COST_CAB): log2 of the length rounded up to a power of 2, at least
+// COST_CAB_MIN_LOG2
+uint8_t cost_cab_variant(uint32_t taps)
+{
+	uint8_t log2_taps = COST_CAB_MIN_LOG2;
+	while ((log2_taps < 31) && ((1u << log2_taps) < taps))
+		log2_taps++;
+	return COST_CAB(log2_taps);
+}
@@ -0,0 +1,78 @@
+// cost_model.h, Michael Haselberger
+// Description: This file contains declarations for the per-node cost model implemented in cost_model.c
+
+#ifndef __COST_MODEL_H__
+#define __COST_MODEL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "defines_and_constants.h"
+#include "arena.h"
+
+// block sizes of the table: MIN_BLOCK_SIZE, 2 * MIN_BLOCK_SIZE ... MAX_BLOCK_SIZE, as benchmark.c measures them
+#define COST_BLOCK_SIZES (5)
+// buffer placements of the table, the first arena classes: ARENA_TCM, ARENA_AXI, ARENA_AHB (as in benchmark.c)
+#define COST_PLACEMENTS (3)
+// variant of a node whose cost doesn't depend on its settings
+#define COST_ANY (255)
+// variant of the amp: cell (amp_cell) and hidden units of its model
+#define COST_AMP(cell, hidden) ((uint8_t)(((cell) << 6) | (hidden)))
+// variant of the cabinet: log2 of its response length rounded up to a power of 2 (cost_cab_variant), e.g. 9 for 512 taps
+#define COST_CAB(log2_taps) ((uint8_t)(log2_taps))
+// shortest cabinet response of the table, shorter ones cost about the same
+#define COST_CAB_MIN_LOG2 (6)
+// variant of the convolution reverb: tail stages of its convolver (reverb_shorten leaves 1 of NU_CONVOLVER_TAIL_STAGES).
+// REVERB_FDN: the network, whatever the settings
+#define COST_REVERB(stages) ((uint8_t)(stages))
+#define COST_REVERB_FDN (254)
+// placement of the node buffers in this build: with TCM_PLACEMENT the chain adapters work on DTCM buffers
+#if defined(TCM_PLACEMENT)
+#define COST_PLACEMENT (ARENA_TCM)
+#else
+#define COST_PLACEMENT (ARENA_AXI)
+#endif
+
+_Static_assert((MIN_BLOCK_SIZE << (COST_BLOCK_SIZES - 1)) == MAX_BLOCK_SIZE, "COST_BLOCK_SIZES doesn't match MIN_BLOCK_SIZE and MAX_BLOCK_SIZE");
+_Static_assert(COST_PLACEMENTS <= ARENA_CLASSES, "COST_PLACEMENTS exceeds the arena classes");
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Cost of one node type, from the on-target benchmark (benchmark.c). The table (cost_table.h) is generated from the SWO log
+*   of the Benchmark configuration by Python/generate_tables.py --costs, it ends with an entry of fx FXNONE. The cycles are
+*   valid for the build the benchmark ran in (code placement, sample format), the generator writes it into the table.
+*
+*   Members:
+*   fx:                 fx_designator of the node.
+*   variant:            Setting the cost depends on: distortion_quality of overdrive and fuzz, COST_AMP of the amp,
+*                       COST_CAB of the cabinet, COST_REVERB of the reverb, COST_ANY for the others.
+*   stereo:             The kernel processes both channels in one call (ping-pong delay) or is a shared mono node that
+*                       runs once (cabinet, reverb). Otherwise the cost is the one of a channel, the chain runs it
+*                       AUDIO_CHANNELS times.
+*   cycles:             Average cycles per block of every placement of the buffers and every block size. 0: not measured.
+*   memory:             Bytes the node takes from every arena when it is activated (fx_activate_t), in the arena its
+*                       activation tries first. The cabinet takes its filter memory once by cab_init, it counts 0 here.
+*   fallback:           Arena the activation takes the buffers from when the first one has no room (ping-pong delay:
+*                       AXI SRAM, the spectral effects: D2 SRAM). ARENA_CLASSES if it doesn't try another one.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t fx;
+	uint8_t variant;
+	bool stereo;
+	uint32_t cycles[COST_PLACEMENTS][COST_BLOCK_SIZES];
+	uint32_t memory[ARENA_CLASSES];
+	uint8_t fallback;
+} cost_entry_t;
+
+uint32_t cost_cycles(uint8_t fx, uint8_t variant, arena_class placement, uint32_t n);
+uint32_t cost_memory(uint8_t fx, uint8_t variant, arena_class cls);
+bool cost_memory_fits(uint8_t fx, uint8_t variant);
+uint8_t cost_cab_variant(uint32_t taps);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __COST_MODEL_H__
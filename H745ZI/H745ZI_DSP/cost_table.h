@@ -0,0 +1,41 @@
+// generated by analysis_helpers.ExportCostEstimates: estimates, no benchmark log yet
+// replace with the measured table of the benchmark firmware (generate_tables.py --costs)
+static const cost_entry_t cost_table[] =
+{
+	{ FXDELAY, COST_ANY, false, { { 560, 720, 1040, 1680, 2960 }, { 584, 768, 1136, 1872, 3344 }, { 600, 800, 1200, 2000, 3600 } }, { 0, 0, 131072 * AUDIO_CHANNELS, 0 }, ARENA_CLASSES },
+	{ FXOVERDRIVE, DISTORTION_OVERSAMPLED, false, { { 1720, 2840, 5080, 9560, 18520 }, { 1888, 3176, 5752, 10904, 21208 }, { 2000, 3400, 6200, 11800, 23000 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXOVERDRIVE, DISTORTION_LUT, false, { { 428, 556, 812, 1324, 2348 }, { 447, 594, 888, 1477, 2655 }, { 460, 620, 940, 1580, 2860 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXOVERDRIVE, DISTORTION_ADAA, false, { { 652, 1004, 1708, 3116, 5932 }, { 704, 1109, 1919, 3538, 6776 }, { 740, 1180, 2060, 3820, 7340 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXFUZZ, DISTORTION_OVERSAMPLED, false, { { 1800, 3000, 5400, 10200, 19800 }, { 1980, 3360, 6120, 11640, 22680 }, { 2100, 3600, 6600, 12600, 24600 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXFUZZ, DISTORTION_LUT, false, { { 460, 620, 940, 1580, 2860 }, { 484, 668, 1036, 1772, 3244 }, { 500, 700, 1100, 1900, 3500 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXFUZZ, DISTORTION_ADAA, false, { { 716, 1132, 1964, 3628, 6956 }, { 778, 1256, 2213, 4127, 7954 }, { 820, 1340, 2380, 4460, 8620 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXTREMOLO, COST_ANY, false, { { 428, 556, 812, 1324, 2348 }, { 447, 594, 888, 1477, 2655 }, { 460, 620, 940, 1580, 2860 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXRINGMOD, COST_ANY, false, { { 428, 556, 812, 1324, 2348 }, { 447, 594, 888, 1477, 2655 }, { 460, 620, 940, 1580, 2860 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXPHASER, COST_ANY, false, { { 1120, 1840, 3280, 6160, 11920 }, { 1228, 2056, 3711, 7023, 13647 }, { 1300, 2200, 4000, 7600, 14800 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXFILTER, COST_ANY, false, { { 1068, 1836, 3372, 6444, 12588 }, { 1183, 2066, 3832, 7365, 14431 }, { 1260, 2220, 4140, 7980, 15660 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXEQ, COST_ANY, false, { { 620, 940, 1580, 2860, 5420 }, { 668, 1036, 1772, 3244, 6188 }, { 700, 1100, 1900, 3500, 6700 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXCHORUS, COST_ANY, false, { { 848, 1296, 2192, 3984, 7568 }, { 915, 1430, 2460, 4521, 8643 }, { 960, 1520, 2640, 4880, 9360 } }, { 0, 0, 16384 * AUDIO_CHANNELS, 0 }, ARENA_CLASSES },
+	{ FXFLANGER, COST_ANY, false, { { 816, 1232, 2064, 3728, 7056 }, { 878, 1356, 2313, 4227, 8054 }, { 920, 1440, 2480, 4560, 8720 } }, { 0, 0, 4096 * AUDIO_CHANNELS, 0 }, ARENA_CLASSES },
+	{ FXGATE, COST_ANY, false, { { 492, 684, 1068, 1836, 3372 }, { 520, 741, 1183, 2066, 3832 }, { 540, 780, 1260, 2220, 4140 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXCOMP, COST_ANY, false, { { 588, 876, 1452, 2604, 4908 }, { 631, 962, 1624, 2949, 5599 }, { 660, 1020, 1740, 3180, 6060 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXPITCH, COST_ANY, false, { { 1040, 1680, 2960, 5520, 10640 }, { 1136, 1872, 3344, 6288, 12176 }, { 1200, 2000, 3600, 6800, 13200 } }, { 0, 0, 8192 * AUDIO_CHANNELS, 0 }, ARENA_CLASSES },
+	{ FXWAH, COST_ANY, false, { { 684, 1068, 1836, 3372, 6444 }, { 741, 1183, 2066, 3832, 7365 }, { 780, 1260, 2220, 4140, 7980 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXAMP, COST_AMP(AMP_LSTM, 16), false, { { 23000, 45400, 90200, 179800, 359000 }, { 26359, 52119, 103639, 206679, 412759 }, { 28600, 56600, 112600, 224600, 448600 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXAMP, COST_AMP(AMP_LSTM, 32), false, { { 80600, 160600, 320600, 640600, 1280600 }, { 92600, 184600, 368600, 736600, 1472600 }, { 100600, 200600, 400600, 800600, 1600600 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXAMP, COST_AMP(AMP_GRU, 16), false, { { 18200, 35800, 71000, 141400, 282200 }, { 20840, 41080, 81560, 162520, 324440 }, { 22600, 44600, 88600, 176600, 352600 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXAMP, COST_AMP(AMP_GRU, 32), false, { { 63000, 125400, 250200, 499800, 999000 }, { 72360, 144120, 287640, 574680, 1148760 }, { 78600, 156600, 312600, 624600, 1248600 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXLOOP, COST_ANY, false, { { 396, 492, 684, 1068, 1836 }, { 410, 520, 741, 1183, 2066 }, { 420, 540, 780, 1260, 2220 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXDENOISE, COST_ANY, false, { { 2940, 4380, 7260, 13020, 24540 }, { 3156, 4812, 8123, 14747, 27995 }, { 3300, 5100, 8700, 15900, 30300 } }, { 5120 * AUDIO_CHANNELS, 0, 0, 0 }, ARENA_AHB },
+	{ FXFREEZE, COST_ANY, false, { { 2460, 3420, 5340, 9180, 16860 }, { 2604, 3708, 5916, 10332, 19164 }, { 2700, 3900, 6300, 11100, 20700 } }, { 5120 * AUDIO_CHANNELS, 0, 0, 0 }, ARENA_AHB },
+	{ FXPINGPONG, COST_ANY, true, { { 1080, 1560, 2520, 4440, 8280 }, { 1152, 1704, 2808, 5016, 9432 }, { 1200, 1800, 3000, 5400, 10200 } }, { 0, 0, 262144, 0 }, ARENA_AXI },
+	{ FXREVERB, COST_REVERB(NU_CONVOLVER_TAIL_STAGES), true, { { 9680, 17360, 32720, 63440, 124880 }, { 10832, 19664, 37328, 72656, 143312 }, { 11600, 21200, 40400, 78800, 155600 } }, { 0, 459776, 0, 0 }, ARENA_CLASSES },
+	{ FXREVERB, COST_REVERB(1), true, { { 7920, 13840, 25680, 49360, 96720 }, { 8808, 15615, 29231, 56463, 110927 }, { 9400, 16800, 31600, 61200, 120400 } }, { 0, 459776, 0, 0 }, ARENA_CLASSES },
+	{ FXREVERB, COST_REVERB_FDN, true, { { 1760, 2720, 4640, 8480, 16160 }, { 1904, 3008, 5216, 9632, 18464 }, { 2000, 3200, 5600, 10400, 20000 } }, { 2048, 131072, 0, 0 }, ARENA_CLASSES },
+	{ FXCAB, COST_CAB(6), true, { { 1430, 2710, 5270, 10390, 20630 }, { 1622, 3094, 6038, 11926, 23702 }, { 1750, 3350, 6550, 12950, 25750 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXCAB, COST_CAB(7), true, { { 1878, 3606, 7062, 13974, 27798 }, { 2137, 4124, 8098, 16047, 31945 }, { 2310, 4470, 8790, 17430, 34710 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXCAB, COST_CAB(8), true, { { 2102, 4054, 7958, 15766, 31382 }, { 2394, 4639, 9129, 18108, 36066 }, { 2590, 5030, 9910, 19670, 39190 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXCAB, COST_CAB(9), true, { { 2550, 4950, 9750, 19350, 38550 }, { 2910, 5670, 11190, 22230, 44310 }, { 3150, 6150, 12150, 24150, 48150 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXCAB, COST_CAB(10), true, { { 3446, 6742, 13334, 26518, 52886 }, { 3940, 7730, 15311, 30473, 60796 }, { 4270, 8390, 16630, 33110, 66070 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXCAB, COST_CAB(11), true, { { 5254, 10358, 20566, 40982, 81814 }, { 6019, 11889, 23628, 47106, 94063 }, { 6530, 12910, 25670, 51190, 102230 } }, { 0, 0, 0, 0 }, ARENA_CLASSES },
+	{ FXNONE, COST_ANY, false, { { 0 } }, { 0 }, ARENA_CLASSES },
+};
@@ -0,0 +1,74 @@
+// dc_blocker.c, Michael Haselberger
+// Description: One-pole DC blocking high pass in the feedback loops of the flanger and the feedback delay network.
+
+#include "dc_blocker.h"
+
+/******************************************************************************
+* Function Name: dc_blocker_init
+*******************************************************************************
+* Summary:
+*  Initialize a DC blocker for the current sample rate with an empty state.
+*
+* Parameters:
+*  1. dc_blocker_t *db				- Address pointer of the DC blocker struct.
+*  2. float32_t cutoff_hz			- -3 dB frequency. Range: 0 < cutoff_hz < sample_rate / 8.
+* Return:
+*  255:								- DC blocker points to NULL.
+*  254:								- Cutoff out of range.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t dc_blocker_init(dc_blocker_t *db, float32_t cutoff_hz)
+{
+	if (db == NULL)
+	{
+		return 255;
+	}
+	if ((cutoff_hz <= 0.0f) || (cutoff_hz >= sample_rate / 8.0f))
+	{
+		return 254;
+	}
+	db->r = 1.0f - 2.0f * PI * cutoff_hz / sample_rate;
+	dc_blocker_reset(db);
+	return 0;
+}
+
+// clear the state, e.g. together with the delay line of the loop
+void dc_blocker_reset(dc_blocker_t *db)
+{
+	db->x1 = 0.0f;
+	db->y1 = 0.0f;
+}
+
+/******************************************************************************
+* Function Name: dc_blocker_process
+*******************************************************************************
+* Summary:
+*  Filter one block. The recursion runs per sample, the state carries on to the next block.
+*
+* Parameters:
+*  1. dc_blocker_t *db				- Address pointer of an initialized DC blocker struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block, may be src.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void dc_blocker_process(dc_blocker_t *db, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	const float32_t r = db->r;
+	float32_t x1 = db->x1;
+	float32_t y1 = db->y1;
+
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		const float32_t x = src[i];
+		y1 = x - x1 + r * y1;
+		x1 = x;
+		dst[i] = y1;
+	}
+	db->x1 = x1;
+	db->y1 = y1;
+}
@@ -0,0 +1,43 @@
+// dc_blocker.h, Michael Haselberger
+// Description: This file contains declarations for the DC blocker implemented in dc_blocker.c
+
+#ifndef __DC_BLOCKER_H__
+#define __DC_BLOCKER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// cutoff of the feedback paths, far below the lowest note of a bass (41 Hz)
+#define DC_BLOCKER_CUTOFF_HZ (5.0f)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   DC blocker of a feedback loop: the one-pole high pass y[n] = x[n] - x[n-1] + r * y[n-1]. An offset in the loop (the DC
+*   of the converter, the asymmetry of a modulated delay) is removed instead of circulating with the tail, and the loop
+*   can't hold a constant value that only decays towards the subnormal range. Two adds and a multiply per sample.
+*
+*   Members:
+*   r:                  Pole radius, 1 - 2 * pi * cutoff / sample_rate.
+*   x1:                 Last input sample.
+*   y1:                 Last output sample.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t r;
+	float32_t x1;
+	float32_t y1;
+} dc_blocker_t;
+
+uint8_t dc_blocker_init(dc_blocker_t *db, float32_t cutoff_hz);
+void dc_blocker_reset(dc_blocker_t *db);
+void dc_blocker_process(dc_blocker_t *db, const float32_t *src, float32_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __DC_BLOCKER_H__
@@ -1,5 +1,6 @@
 #ifndef __DEFINES_AND_CONSTANTS_H__
 #define __DEFINES_AND_CONSTANTS_H__
+#include <stdint.h>
 #ifdef __cplusplus
 {
 	extern "C" {
@@ -7,22 +8,299 @@
 		
 // ------------ DEFINES -----------------
 #define DMA
-// amount of samples processed at once (left + right) (block-processing. bigger blocks allow for more efficient processing, but increase latency)
+// audio interface: SAI1 in TDM mode (sai.h) instead of I2S2, for codecs with more than two channels. block A sends,
+// block B receives SAI_TDM_SLOTS slots of 32 bit per frame, the processed channels are the slots from SAI_TDM_SLOT on
+//#define SAI_TDM
+// the MDMA moves every completed DMA half between the non-cacheable DMA buffers and DTCM staging buffers and
+// (de)interleaves the channels on the way, the CPU only converts in DTCM (see MX_MDMA_Init in i2s.c). its increment
+// skips one word at most (2 word frames), so the CPU copies the TDM frames of SAI_TDM
+#if !defined(SAI_TDM)
+#define MDMA_TRANSFER
+#endif
+// without MDMA_TRANSFER the CPU copies the DMA halves itself. CACHED_DMA keeps the DMA buffers cacheable and maintains
+// the cache per half (invalidate before rx, clean after tx), otherwise the MPU makes them non-cacheable (MPU_conf).
+// all three layouts are told apart in the profiler report, so the rx/tx cycles can be compared build by build
+//#define CACHED_DMA
+#if defined(CACHED_DMA) && defined(MDMA_TRANSFER)
+#error "CACHED_DMA is for the CPU copy path, the MDMA doesn't go through the data cache. Undefine MDMA_TRANSFER"
+#endif
+// measure the cycles of every audio block with the DWT cycle counter (see profiler.h). LCD "Load" page and SWO report
+#define PROFILER
+// load governor (governor.h): lowers oversampling, shortens the reverb and skips the effects that aren't essential before
+// the audio misses its deadline, every step is logged over SWO. needs PROFILER
+#define GOVERNOR
+// ITM event trace (trace.h): DMA interrupts, blocks, chain stages, the control pass, control inputs and inter-core
+// messages with cycle counter stamps on stimulus port 1 of the SWO, decoded into a timeline by Python/itm_trace.py.
+// a register read per event while no debugger enabled the port
+//#define TRACE
+// stack high water marks (stack_monitor.h): the main stack is painted at boot and scanned once per second, the audio
+// interrupt measures its own part every STACK_PROBE_BLOCKS blocks. SWO line and host link status, with RTOS also the
+// task stacks
+#define STACK_MONITOR
+// power saving (power.h): the cores run on the slowest clock profile (rcc.c) that fits the effect chain, clocks nothing
+// uses while the core sleeps are gated. needs PROFILER
+#define POWER_SAVING
+// tuner page: pitch detection of the input while the signal passes through the effects (tuner.h). the audio path only
+// decimates the input while the page is shown, the analysis is a background task of the main loop
+#define TUNER
+// round trip latency page (latency_probe.h): with a cable from the left output to the left input, every block size is
+// measured with an impulse and a maximum length sequence. costs the audio path one comparison per block otherwise
+#define LATENCY_PROBE
+// true bypass: while no effect is selected or fading, the received codec words are copied into the transmit block as they
+// are (see bypass_samples in main.c). no float conversion, no limiter, bit exact. the level meter holds meanwhile
+#define TRUE_BYPASS
+// level meter and 32 band spectrum of the chain output (telemetry.h): one block every 100 ms is copied aside and analyzed
+// in the main loop. LCD "Meter" page and one SWO line per analysis
+#define TELEMETRY
+// USB audio class 2.0 device on the user USB port (usb_audio.h): chain output and dry input as a 24 bit stereo input
+// of the host, for recording and re-amping without an audio interface
+//#define USB_AUDIO
+// MIDI input on USART2 (midi.h): control changes set the effect parameters at the next block boundary, program changes
+// recall presets, MIDI clock sets the tempo
+#define MIDI
+// binary host protocol on USART3, the ST-LINK virtual COM port (host_link.h): parameter get/set, menu commands, preset
+// and cabinet response upload and a profiler/meter status stream, handled in the control pass. Python/host_link.py
+#define HOST_LINK
+// post-mortem capture (capture.h): the last blocks of the left input and output (ADPCM) and their profiler timestamps in
+// a ring in the spare RAM_D2, frozen by a dropout, a clip or a missed deadline and read with HOST_CAPTURE. needs PROFILER
+#define CAPTURE
+#if defined(CAPTURE) && !defined(PROFILER)
+#error "the capture records the cycles of the profiler and checks the blocks against its budget. Define PROFILER"
+#endif
+// modulation matrix (mod_matrix.h): LFOs, the input envelope, the modulation wheel and the expression controller routed
+// to the smoothed effect parameters, evaluated once per block before the chain. costs one comparison per block without
+// routes
+#define MOD_MATRIX
+// analog expression pedal on PA3 (expression.h): ADC1 with hardware oversampling and a circular DMA, averaged once per
+// block and published as the MOD_PEDAL source of the modulation matrix
+//#define EXPRESSION_PEDAL
+#if defined(EXPRESSION_PEDAL) && !defined(MOD_MATRIX)
+#error "the expression pedal is a source of the modulation matrix. Define MOD_MATRIX"
+#endif
+// flush-to-zero and default NaN in the audio path (FPSCR FZ and DN, see main and audio_process): the subnormal values
+// of decaying tails (filter states, feedback loops) become 0. the profiler counts the blocks that produced subnormals
+// either way, so the builds with and without can be compared
+#define DENORMAL_FLUSH
+// run the effect chain in two pipeline stages one block apart (fx_chain_set_pipeline): the cut follows the measured
+// costs of the nodes (fx_chain_balance), stage 2 runs one block late. one block more latency, and the nodes are only
+// measured with it
+//#define FX_CHAIN_PIPELINE
+// compute the reverb tail on the Cortex-M4 (needs the CM4 application, see dual_core.h)
+//#define DUAL_CORE
+#if defined(DUAL_CORE) && !defined(BOOTCM4)
+#define BOOTCM4
+#endif
+// the Cortex-M4 runs the menu: encoder, button, LCD and the presets in flash bank 2 belong to it, the M7 gets the changes
+// as commands and sends back what the pages show (control_link.h). the M7 is left with the audio interrupts, MIDI (its
+// events take effect sample-accurately in the audio path) and applying the commands. needs the CM4 application
+//#define CONTROL_M4
+#if defined(CONTROL_M4) && !defined(BOOTCM4)
+#define BOOTCM4
+#endif
+// graphical SPI TFT instead of the 16x2 LCD (tft.h): the menu rows in a large font plus the spectrum and the tuner
+// needle, drawn by the DMA2D into a frame in external RAM and sent region by region. rendered by the menu core, so it
+// needs CONTROL_M4 to keep the graphics off the M7
+//#define DISPLAY_TFT
+#if defined(DISPLAY_TFT) && !defined(CONTROL_M4)
+#error "the TFT is drawn by the core that runs the menu, the M7 only runs the audio with CONTROL_M4. Define CONTROL_M4"
+#endif
+// run the post-filter of the amp model (amp_model.h) on the Cortex-M4 while the M7 runs the recurrent layer. the
+// filtered signal comes back one PING_PONG_BUFFER_SIZE chunk later, the amp adds that much latency. needs DUAL_CORE
+//#define AMP_POST_M4
+#if defined(AMP_POST_M4) && (!defined(DUAL_CORE) || (AUDIO_CHANNELS == 2))
+#error "AMP_POST_M4 needs DUAL_CORE and runs the left channel only (AUDIO_CHANNELS 1)"
+#endif
+// the reverb is a feedback delay network (fdn.h) instead of the convolution with an impulse response: 128 KB of delay
+// lines instead of ~450 KB of spectra, the RAM_D1 arena shrinks accordingly. runs on the M7, with DUAL_CORE the M4
+// gets no reverb tail to compute
+//#define REVERB_FDN
+// FreeRTOS task model (rtos.h) instead of PendSV and the main loop: the audio task woken by the DMA interrupts, a control
+// task (MIDI program changes, presets, transitions, governor) and a UI task (menu, LCD, tuner, reports) with stack and
+// timing statistics over SWO. needs the FreeRTOS kernel (GCC/ARM_CM4F port, no heap file), which this project doesn't
+// include, and CM7/Inc/FreeRTOSConfig.h
+//#define RTOS
+// priority of the I2S DMA and MDMA interrupts. with RTOS their callbacks wake the audio task, which only interrupts at or
+// below configMAX_SYSCALL_INTERRUPT_PRIORITY (FreeRTOSConfig.h) may do
+#if defined(RTOS)
+#define AUDIO_IRQ_PRIORITY (1)
+#else
+#define AUDIO_IRQ_PRIORITY (0)
+#endif
+// amount of samples processed at once (left + right) after start-up (block-processing. bigger blocks allow for more efficient processing, but increase latency)
 // Buffer needs to be 4-byte (DMA) or 32-byte (cache) aligned
 #define SAMPLES 128
-// 2 channels: buffer size needs to be twice the sample count
-#define DMA_BUFFER_SIZE (SAMPLES << 1)
+// samples per channel and block after start-up. also the partition size of the convolver and the inter-core block size
 #define PING_PONG_BUFFER_SIZE (SAMPLES >> 1)
+// range of the block size (samples per channel and DMA half) selectable at runtime, see audio_set_block_size in main.c.
+// powers of two only
+#define MIN_BLOCK_SIZE 16
+#define MAX_BLOCK_SIZE 256
+// blocks in the DMA ring. 2: ping-pong (the halves of one circular transfer), input to output is 2 blocks.
+// 3 or 4: the DMA runs in double buffer mode and is pointed to the next free block with every completed block
+// (audio_start in main.c). each block adds one block of latency, and the processing of a block may be delayed by
+// DMA_BLOCKS - 2 blocks (e.g. by a long interrupt or a slow block) before it's an overrun
+#ifndef DMA_BLOCKS
+#define DMA_BLOCKS 2
+#endif
+#if (DMA_BLOCKS < 2) || (DMA_BLOCKS > 4)
+#error "DMA_BLOCKS has to be 2, 3 or 4 (the MPU region of the I2S DMA buffers is 16 KB, see MPU_conf)"
+#endif
+#if (DMA_BLOCKS > 2) && defined(MDMA_TRANSFER)
+#error "the MDMA stages only the newest block, a delayed block would be lost. Undefine MDMA_TRANSFER for DMA_BLOCKS > 2"
+#endif
+#if defined(SAI_TDM)
+// 4 slots: e.g. stereo plus the send and return of an effects loop. 8: the TDM8 mode of multi-channel codecs
+#ifndef SAI_TDM_SLOTS
+#define SAI_TDM_SLOTS 8
+#endif
+// slot of the left channel, the right channel follows. the other slots are sent silent, their input isn't read
+#ifndef SAI_TDM_SLOT
+#define SAI_TDM_SLOT 0
+#endif
+#if (SAI_TDM_SLOTS != 4) && (SAI_TDM_SLOTS != 8)
+#error "SAI_TDM_SLOTS has to be 4 or 8 (with the master clock divider, the SAI frame has to be 128 or 256 bit long)"
+#endif
+#if (SAI_TDM_SLOT < 0) || ((SAI_TDM_SLOT + 2) > SAI_TDM_SLOTS)
+#error "SAI_TDM_SLOT has to leave a slot for the right channel"
+#endif
+#if (DMA_BLOCKS > 2)
+#error "the SAI runs the ping-pong transfer only (HAL_SAI_Receive_DMA), DMA_BLOCKS has to be 2 with SAI_TDM"
+#endif
+// words per frame of the codec and index of the left channel in the frame
+#define AUDIO_FRAME_WORDS SAI_TDM_SLOTS
+#define AUDIO_FRAME_SLOT SAI_TDM_SLOT
+#else
+#define AUDIO_FRAME_WORDS 2
+#define AUDIO_FRAME_SLOT 0
+#endif
+// DMA buffers are sized for the largest block: DMA_BLOCKS blocks of AUDIO_FRAME_WORDS channels. up to 16 KB of both
+// buffers fill the MPU region of 16 KB, SAI_TDM with 8 slots needs the 32 KB region (see MPU_conf)
+#define DMA_BUFFER_SIZE (MAX_BLOCK_SIZE * AUDIO_FRAME_WORDS * DMA_BLOCKS)
+// memory the DMA buffers (rx_buffer, tx_buffer in main.c) are placed in. DMA1 sits in D2, D1 costs the way through the
+// bus matrix and the AXI, D2 is next to it, D3 behind the D2-D3 bridge. the benchmark (benchmark.c) measures how much
+// the kernels are slowed down by the DMA in every layout
+#define DMA_PLACEMENT_D1 1		// AXI SRAM (.dma_buffer), in front of the D1 arena. the CPU shares it with the reverb spectra
+#define DMA_PLACEMENT_D2 2		// SRAM1 (.dma_buffer_d2), in front of the D2 arena. the capture ring gets the MPU region less
+#define DMA_PLACEMENT_D3 3		// SRAM4 (.dma_buffer_d3), the last 8 KB behind the M4 memory (see dual_core.h)
+#ifndef DMA_PLACEMENT
+#define DMA_PLACEMENT DMA_PLACEMENT_D1
+#endif
+// bytes of the non-cacheable MPU region over both buffers (MPU_conf). in D1 and D2 the linker script aligns the
+// arena behind them to 16 KB, a 32 KB region fills that itself
+#if (DMA_PLACEMENT == DMA_PLACEMENT_D3)
+#define DMA_REGION_SIZE (8 * 1024)
+#elif ((2 * DMA_BUFFER_SIZE * 4) > 16384)
+#define DMA_REGION_SIZE (32 * 1024)
+#else
+#define DMA_REGION_SIZE (16 * 1024)
+#endif
+#if (DMA_PLACEMENT == DMA_PLACEMENT_D3) && ((2 * DMA_BUFFER_SIZE * 4) > DMA_REGION_SIZE)
+#error "DMA_PLACEMENT_D3 has 8 KB for the DMA buffers: 2 words per frame and DMA_BLOCKS 2 only"
+#endif
+// the I2S (SAI) DMA streams collect 4 words in their FIFO and write or read them as one burst (INC4) instead of a
+// single word transfer per sample: a quarter of the transactions on the bus to the DMA buffers
+//#define DMA_FIFO
+// processed channels. 1: left channel only (mono guitar signal, right output stays silent).
+// 2: both codec channels in separate (planar) buffers, every effect runs as dual mono
+#ifndef AUDIO_CHANNELS
+#define AUDIO_CHANNELS 1
+#endif
+#if (AUDIO_CHANNELS != 1) && (AUDIO_CHANNELS != 2)
+#error "AUDIO_CHANNELS has to be 1 or 2"
+#endif
+// effects loop (FXLOOP in fx_lib.h): send and return of an external pedal on the codec channels behind the processed
+// ones, the right channel of the I2S with AUDIO_CHANNELS 1 or the slots from SAI_TDM_SLOT + 2 with SAI_TDM. without a
+// free channel (I2S and AUDIO_CHANNELS 2), FXLOOP_SLOT stays undefined and the loop passes its input through
+#if defined(SAI_TDM)
+#if ((SAI_TDM_SLOT + 2 + AUDIO_CHANNELS) <= SAI_TDM_SLOTS)
+#define FXLOOP_SLOT (SAI_TDM_SLOT + 2)
+#endif
+#elif (AUDIO_CHANNELS == 1)
+#define FXLOOP_SLOT (1)
+#endif
+// sidechain of the noise gate and the compressor (GATE_KEY, COMP_KEY in fx_lib.h): the mono build has the right input
+// (SAI_TDM: the slot behind SAI_TDM_SLOT) to spare, it's converted with the left one and keys the detectors instead of
+// the signal they process. with I2S the return of the effects loop is the same input
+//#define SIDECHAIN
+#if defined(SIDECHAIN)
+#if (AUDIO_CHANNELS != 1)
+#error "the sidechain is the right input, AUDIO_CHANNELS 2 processes it. Undefine SIDECHAIN"
+#endif
+#endif
 #define NUM_TAPS 37
+// looper behind the effect chain with 30 s (20 s per channel in stereo) in external memory (looper.h). needs a memory-mapped FMC SDRAM
+// or OctoSPI PSRAM at the .loop_buffer region of the linker script, which this board doesn't have
+//#define LOOPER
+// the looper in internal memory instead: loops stored as IMA-ADPCM in the free RAM_D1 and RAM_D2 arena memory, about
+// 28 s mono at 48 kHz while no effect holds arena memory (looper.h). no external memory needed
+//#define LOOPER_ADPCM
+#if defined(LOOPER_ADPCM) && !defined(LOOPER)
+#define LOOPER
+#endif
+// the delay effect stores its line packed as q15 (see delay_line.h): the same pool memory holds 1.3 s instead of 500 ms
+//#define PACKED_DELAY
+// the wet path of the delay runs at the sample rate divided by 2 or 4 (multirate.h): a darker echo (cut at 10.8 kHz
+// at 48 kHz with 2), the line holds the same time in half or a quarter of the memory, the taps cost as much less
+//#define DELAY_DECIMATION 2
+// I2S sample rate after start-up (see PeriphCommonClock_Config). audio_set_sample_rate (main.c) switches between
+// 44.1, 48 and 96 kHz at runtime. the memory of the effects (delay lines, tuner, looper) is sized in samples for
+// AUDIO_SAMPLE_RATE, the lines of the modulation effects for AUDIO_MAX_SAMPLE_RATE
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_MAX_SAMPLE_RATE 96000
+// desktop build of the effects and the chain (fx_host.h), set on the command line of the host compiler. the TCM sections
+// and the M4 don't exist there
+#if defined(HOST_BUILD) && (defined(CORE_CM7) || defined(CORE_CM4) || defined(BOOTCM4))
+#error "HOST_BUILD builds the DSP modules for a desktop CPU: without CORE_CM7/CORE_CM4, DUAL_CORE and CONTROL_M4"
+#endif
+// run the audio path from the tightly coupled memories of the M7 (zero wait states, no cache misses or evictions).
+// comment out to run everything from FLASH / AXI SRAM again and compare the cycles in the profiler report.
+// ITCM_CODE: function copied to ITCM at start-up. DTCM_INIT: initialized data in DTCM. DTCM_BSS: zeroed data in DTCM.
+// DTCM_DATA: data in DTCM that's built at runtime, neither copied nor zeroed.
+// the DMA can't access the TCMs, DMA buffers stay in their section (DMA_PLACEMENT). sections see STM32H745ZITx_FLASH_CM7.ld
+#define TCM_PLACEMENT
+#if defined(TCM_PLACEMENT) && defined(CORE_CM7)
+#define ITCM_CODE __attribute__((section(".itcm_text")))
+#define DTCM_INIT __attribute__((section(".dtcm_init")))
+#define DTCM_BSS __attribute__((section(".dtcm_bss")))
+#define DTCM_DATA __attribute__((section(".dtcm_data")))
+#else
+#define ITCM_CODE
+#define DTCM_INIT
+#define DTCM_BSS
+#define DTCM_DATA
+#endif
+// buffers in a memory region of the linker script (the arenas, the loop and capture memory). the desktop build has
+// no such regions (and Mach-O section names need a segment), they are ordinary data there
+#if defined(HOST_BUILD)
+#define RAM_SECTION(name)
+#else
+#define RAM_SECTION(name) __attribute__((section(name)))
+#endif
 		
-// allows using boolean type without including bool.h
+// allows using boolean type without including bool.h. C++ has its own (the plugin wrapper of fx_host.h, whose API has
+// no bool)
+#if !defined(__cplusplus)
 typedef enum { false, true } bool;
+#endif
+
+// numeric type of the effect chain (see fx_chain.h). SAMPLE_Q31: the chain passes q31 blocks, the codec words only
+// need a shift. delay, FIR filter and overdrive have q31 kernels, the other effects convert around their float kernels
+//#define SAMPLE_Q31
+#if defined(SAMPLE_Q31)
+typedef int32_t sample_t;	// q31_t
+#else
+typedef float sample_t;		// float32_t
+#endif
 	
 enum ping_pong
 {
 	PING = 0,
 	PONG
 };
+
+// sample rate the audio path runs with in Hz (defined in main.c). every coefficient and delay length that depends on
+// time or frequency is computed from it, not from AUDIO_SAMPLE_RATE. only changed while the audio is stopped
+extern uint32_t sample_rate;
 		
 #ifdef __cpluplus
 }
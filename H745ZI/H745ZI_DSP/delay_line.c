@@ -0,0 +1,479 @@
+// delay_line.c, Michael Haselberger
+// Description: Block based float32 delay line. Replaces per-sample ring_buffer_put/ring_buffer_get calls with
+// at most two contiguous CMSIS vector copies per block. Optionally stores the samples packed as q15 (half the memory).
+
+#include <string.h>
+#include "delay_line.h"
+#include "scratch_pool.h"
+#include "defines_and_constants.h"
+
+/******************************************************************************
+* Function Name: delay_line_init_format
+*******************************************************************************
+* Summary:
+*  Initialize a delay line with caller provided memory in the given storage format.
+*  The memory is cleared, so reading any delay right after initialization returns silence.
+*  This makes pre-filling the line with zeros sample by sample unnecessary.
+*
+* Parameters:
+*  1. delay_line_t *dl				- Address pointer of the delay line struct.
+*  2. void *buffer					- Sample memory for the delay line, size * delay_line_sample_size(format) bytes.
+*  3. uint32_t size					- Number of samples in buffer. Must be a power of two.
+*  4. delay_line_format format		- DELAY_LINE_F32 or DELAY_LINE_Q15.
+* Return:
+*  255:								- Delay line or buffer point to NULL.
+*  254:								- Size is 0 or not a power of two, or unknown format.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t delay_line_init_format(delay_line_t *dl, void *buffer, uint32_t size, delay_line_format format)
+{
+	if ((dl == NULL) || (buffer == NULL))
+	{
+		return 255;
+	}
+	// same power of two check as in ring_buffer_init
+	if ((size == 0) || (((size - 1) & size) != 0) || (format > DELAY_LINE_Q15))
+	{
+		return 254;
+	}
+
+	dl->buffer = buffer;
+	dl->size = size;
+	dl->mask = size - 1;
+	dl->format = format;
+	delay_line_clear(dl);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: delay_line_init
+*******************************************************************************
+* Summary:
+*  Initialize a float32 delay line (see delay_line_init_format).
+*
+* Parameters:
+*  1. delay_line_t *dl			- Address pointer of the delay line struct.
+*  2. float32_t *buffer			- Sample memory for the delay line.
+*  3. uint32_t size				- Number of samples in buffer. Must be a power of two.
+* Return:
+*  255:							- Delay line or buffer point to NULL.
+*  254:							- Size is 0 or not a power of two.
+*    0:							- Success.
+*
+******************************************************************************/
+uint8_t delay_line_init(delay_line_t *dl, float32_t *buffer, uint32_t size)
+{
+	return delay_line_init_format(dl, buffer, size, DELAY_LINE_F32);
+}
+
+/******************************************************************************
+* Function Name: delay_line_clear
+*******************************************************************************
+* Summary:
+*  Overwrite the whole delay line with 0 and reset the write position.
+*
+* Parameters:
+*  1. delay_line_t *dl			- Address pointer of the delay line struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void delay_line_clear(delay_line_t *dl)
+{
+	memset(dl->buffer, 0, dl->size * delay_line_sample_size(dl->format));
+	dl->write_index = 0;
+}
+
+// ---- packed storage (DELAY_LINE_Q15) ----
+// the CMSIS converters move two q15 samples per 32 bit access, so packing costs about as much as the float copy.
+// the converters saturate, a sample outside of [-1, 1) clips in the line instead of wrapping around
+
+// write a (scaled) float block into the q15 memory
+#pragma optimize_for_speed
+ITCM_CODE static void pack(delay_line_t *dl, const float32_t *src, float32_t gain, uint32_t block_size)
+{
+	q15_t *buf = (q15_t *)dl->buffer;
+	const uint32_t start = dl->write_index & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+	const scratch_mark_t mark = scratch_pool_mark();
+	const float32_t *block = src;
+
+	if (gain != 1.0f)
+	{
+		float32_t *scaled = scratch_pool_alloc(block_size * sizeof(float32_t));
+		arm_scale_f32(src, gain, scaled, block_size);
+		block = scaled;
+	}
+	arm_float_to_q15(block, &buf[start], first);
+	if (first < block_size)
+	{
+		arm_float_to_q15(&block[first], &buf[0], block_size - first);
+	}
+	scratch_pool_release(mark);
+
+	dl->write_index += block_size;
+}
+
+// read a float block from the q15 memory, scaled afterwards if gain isn't 1
+#pragma optimize_for_speed
+ITCM_CODE static void unpack(const delay_line_t *dl, float32_t *dst, uint32_t delay, float32_t gain, uint32_t block_size)
+{
+	const q15_t *buf = (const q15_t *)dl->buffer;
+	const uint32_t start = (dl->write_index - block_size - delay) & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	arm_q15_to_float(&buf[start], dst, first);
+	if (first < block_size)
+	{
+		arm_q15_to_float(&buf[0], &dst[first], block_size - first);
+	}
+	if (gain != 1.0f)
+	{
+		arm_scale_f32(dst, gain, dst, block_size);
+	}
+}
+
+/******************************************************************************
+* Function Name: delay_line_write_scaled
+*******************************************************************************
+* Summary:
+*  Write a block of samples multiplied by gain into the delay line and advance the write position.
+*  The block is split into at most two segments: one up to the end of the buffer and the
+*  remainder from the start of the buffer.
+*
+* Parameters:
+*  1. delay_line_t *dl			- Address pointer of the delay line struct.
+*  2. const float32_t *src		- Block of samples to write.
+*  3. float32_t gain			- Factor every sample is multiplied with before it is stored.
+*  4. uint32_t block_size		- Number of samples in src. Must not exceed the delay line size
+*								  (packed lines: MAX_BLOCK_SIZE).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_write_scaled(delay_line_t *dl, const float32_t *src, float32_t gain, uint32_t block_size)
+{
+	if (dl->format == DELAY_LINE_Q15)
+	{
+		pack(dl, src, gain, block_size);
+		return;
+	}
+
+	const uint32_t start = dl->write_index & dl->mask;
+	// samples that fit in before the end of the buffer is reached
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	arm_scale_f32(src, gain, &dl->buffer[start], first);
+	if (first < block_size)
+	{
+		arm_scale_f32(&src[first], gain, &dl->buffer[0], block_size - first);
+	}
+
+	dl->write_index += block_size;
+}
+
+/******************************************************************************
+* Function Name: delay_line_write
+*******************************************************************************
+* Summary:
+*  Write a block of samples into the delay line and advance the write position.
+*
+* Parameters:
+*  1. delay_line_t *dl			- Address pointer of the delay line struct.
+*  2. const float32_t *src		- Block of samples to write.
+*  3. uint32_t block_size		- Number of samples in src. Must not exceed the delay line size.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_write(delay_line_t *dl, const float32_t *src, uint32_t block_size)
+{
+	if (dl->format == DELAY_LINE_Q15)
+	{
+		pack(dl, src, 1.0f, block_size);
+		return;
+	}
+
+	const uint32_t start = dl->write_index & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	arm_copy_f32(src, &dl->buffer[start], first);
+	if (first < block_size)
+	{
+		arm_copy_f32(&src[first], &dl->buffer[0], block_size - first);
+	}
+
+	dl->write_index += block_size;
+}
+
+/******************************************************************************
+* Function Name: delay_line_read_scaled
+*******************************************************************************
+* Summary:
+*  Read a block of delayed samples multiplied by gain. The block returned is the one that
+*  was written delay samples before the most recently written block, i.e. when called
+*  after delay_line_write for the current block, dst[i] = gain * src[i - delay].
+*  This ordering also allows delays shorter than one block.
+*
+* Parameters:
+*  1. const delay_line_t *dl	- Address pointer of the delay line struct.
+*  2. float32_t *dst			- Output block.
+*  3. uint32_t delay			- Delay in samples. delay + block_size must not exceed the delay line size.
+*  4. float32_t gain			- Factor every delayed sample is multiplied with.
+*  5. uint32_t block_size		- Number of samples to read.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_read_scaled(const delay_line_t *dl, float32_t *dst, uint32_t delay, float32_t gain, uint32_t block_size)
+{
+	if (dl->format == DELAY_LINE_Q15)
+	{
+		unpack(dl, dst, delay, gain, block_size);
+		return;
+	}
+
+	const uint32_t start = (dl->write_index - block_size - delay) & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	arm_scale_f32(&dl->buffer[start], gain, dst, first);
+	if (first < block_size)
+	{
+		arm_scale_f32(&dl->buffer[0], gain, &dst[first], block_size - first);
+	}
+}
+
+/******************************************************************************
+* Function Name: delay_line_read
+*******************************************************************************
+* Summary:
+*  Read a block of delayed samples. See delay_line_read_scaled for the timing of the returned block.
+*
+* Parameters:
+*  1. const delay_line_t *dl	- Address pointer of the delay line struct.
+*  2. float32_t *dst			- Output block.
+*  3. uint32_t delay			- Delay in samples. delay + block_size must not exceed the delay line size.
+*  4. uint32_t block_size		- Number of samples to read.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_read(const delay_line_t *dl, float32_t *dst, uint32_t delay, uint32_t block_size)
+{
+	if (dl->format == DELAY_LINE_Q15)
+	{
+		unpack(dl, dst, delay, 1.0f, block_size);
+		return;
+	}
+
+	const uint32_t start = (dl->write_index - block_size - delay) & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	arm_copy_f32(&dl->buffer[start], dst, first);
+	if (first < block_size)
+	{
+		arm_copy_f32(&dl->buffer[0], &dst[first], block_size - first);
+	}
+}
+
+/******************************************************************************
+* Function Name: delay_line_read_fractional
+*******************************************************************************
+* Summary:
+*  Read a block of samples with an individual, fractional delay per sample (modulated tap).
+*  Timing is the same as for delay_line_read: dst[i] = src[i - delay[i]] relative to the most
+*  recently written block. float32 lines only (random access). Intermediate values are interpolated linearly or with a 4-point
+*  Hermite polynomial. The loops don't branch per sample, so a tap only costs the index
+*  wrapping, the loads and a few multiply-adds per sample.
+*
+* Parameters:
+*  1. const delay_line_t *dl						- Address pointer of the delay line struct.
+*  2. float32_t *dst								- Output block.
+*  3. const float32_t *delay						- Delay in samples for every output sample. Has to be positive and
+*													  at least 1 for cubic interpolation. delay + block_size + 2 must
+*													  not exceed the delay line size.
+*  4. delay_line_interpolation interpolation		- DELAY_LINE_LINEAR or DELAY_LINE_CUBIC.
+*  5. uint32_t block_size							- Number of samples to read.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_read_fractional(const delay_line_t *dl, float32_t *dst, const float32_t *delay, delay_line_interpolation interpolation, uint32_t block_size)
+{
+	const float32_t *buf = dl->buffer;
+	const uint32_t mask = dl->mask;
+	// position of the first sample of the most recently written block
+	const uint32_t block_start = dl->write_index - block_size;
+
+	if (interpolation == DELAY_LINE_CUBIC)
+	{
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			// delay is positive, so the cast truncates towards the integer part
+			const uint32_t whole = (uint32_t)delay[i];
+			const float32_t frac = delay[i] - (float32_t)whole;
+			const uint32_t n = block_start + i - whole;
+			// x0 is the sample at the integer delay, frac moves from x0 towards x1 (older sample)
+			const float32_t xm1 = buf[(n + 1) & mask];
+			const float32_t x0 = buf[n & mask];
+			const float32_t x1 = buf[(n - 1) & mask];
+			const float32_t x2 = buf[(n - 2) & mask];
+			const float32_t c1 = 0.5f * (x1 - xm1);
+			const float32_t c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+			const float32_t c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+			dst[i] = ((c3 * frac + c2) * frac + c1) * frac + x0;
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			const uint32_t whole = (uint32_t)delay[i];
+			const float32_t frac = delay[i] - (float32_t)whole;
+			const uint32_t n = block_start + i - whole;
+			const float32_t x0 = buf[n & mask];
+			const float32_t x1 = buf[(n - 1) & mask];
+			dst[i] = x0 + frac * (x1 - x0);
+		}
+	}
+}
+
+// ---- q31 (SAMPLE_Q31 chain) ----
+// same timing as the float functions. a float32 line holds q31 words then, a delay line must only be used with one
+// sample type. packed lines store the top 16 bits, as with float samples
+
+/******************************************************************************
+* Function Name: delay_line_write_scaled_q31
+*******************************************************************************
+* Summary:
+*  q31 version of delay_line_write_scaled.
+*
+* Parameters:
+*  1. delay_line_t *dl			- Address pointer of the delay line struct.
+*  2. const q31_t *src			- Block of samples to write.
+*  3. q31_t gain				- Factor every sample is multiplied with before it is stored.
+*  4. uint32_t block_size		- Number of samples in src. Must not exceed the delay line size.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_write_scaled_q31(delay_line_t *dl, const q31_t *src, q31_t gain, uint32_t block_size)
+{
+	const uint32_t start = dl->write_index & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	if (dl->format == DELAY_LINE_Q15)
+	{
+		q15_t *buf = (q15_t *)dl->buffer;
+		const scratch_mark_t mark = scratch_pool_mark();
+		q31_t *scaled = scratch_pool_alloc(block_size * sizeof(q31_t));
+		arm_scale_q31(src, gain, 0, scaled, block_size);
+		arm_q31_to_q15(scaled, &buf[start], first);
+		if (first < block_size)
+		{
+			arm_q31_to_q15(&scaled[first], &buf[0], block_size - first);
+		}
+		scratch_pool_release(mark);
+	}
+	else
+	{
+		q31_t *buf = (q31_t *)dl->buffer;
+		arm_scale_q31(src, gain, 0, &buf[start], first);
+		if (first < block_size)
+		{
+			arm_scale_q31(&src[first], gain, 0, &buf[0], block_size - first);
+		}
+	}
+
+	dl->write_index += block_size;
+}
+
+/******************************************************************************
+* Function Name: delay_line_write_q31
+*******************************************************************************
+* Summary:
+*  q31 version of delay_line_write.
+*
+* Parameters:
+*  1. delay_line_t *dl			- Address pointer of the delay line struct.
+*  2. const q31_t *src			- Block of samples to write.
+*  3. uint32_t block_size		- Number of samples in src. Must not exceed the delay line size.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_write_q31(delay_line_t *dl, const q31_t *src, uint32_t block_size)
+{
+	const uint32_t start = dl->write_index & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	if (dl->format == DELAY_LINE_Q15)
+	{
+		q15_t *buf = (q15_t *)dl->buffer;
+		arm_q31_to_q15(src, &buf[start], first);
+		if (first < block_size)
+		{
+			arm_q31_to_q15(&src[first], &buf[0], block_size - first);
+		}
+	}
+	else
+	{
+		q31_t *buf = (q31_t *)dl->buffer;
+		arm_copy_q31(src, &buf[start], first);
+		if (first < block_size)
+		{
+			arm_copy_q31(&src[first], &buf[0], block_size - first);
+		}
+	}
+
+	dl->write_index += block_size;
+}
+
+/******************************************************************************
+* Function Name: delay_line_read_q31
+*******************************************************************************
+* Summary:
+*  q31 version of delay_line_read.
+*
+* Parameters:
+*  1. const delay_line_t *dl	- Address pointer of the delay line struct.
+*  2. q31_t *dst				- Output block.
+*  3. uint32_t delay			- Delay in samples. delay + block_size must not exceed the delay line size.
+*  4. uint32_t block_size		- Number of samples to read.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void delay_line_read_q31(const delay_line_t *dl, q31_t *dst, uint32_t delay, uint32_t block_size)
+{
+	const uint32_t start = (dl->write_index - block_size - delay) & dl->mask;
+	const uint32_t first = ((dl->size - start) < block_size) ? (dl->size - start) : block_size;
+
+	if (dl->format == DELAY_LINE_Q15)
+	{
+		const q15_t *buf = (const q15_t *)dl->buffer;
+		arm_q15_to_q31(&buf[start], dst, first);
+		if (first < block_size)
+		{
+			arm_q15_to_q31(&buf[0], &dst[first], block_size - first);
+		}
+		return;
+	}
+
+	const q31_t *buf = (const q31_t *)dl->buffer;
+	arm_copy_q31(&buf[start], dst, first);
+	if (first < block_size)
+	{
+		arm_copy_q31(&buf[0], &dst[first], block_size - first);
+	}
+}
@@ -0,0 +1,78 @@
+// delay_line.h, Michael Haselberger
+// Description: This file contains declarations for the float32 block delay line implemented in delay_line.c
+
+#ifndef __DELAY_LINE_H__
+#define __DELAY_LINE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+
+// storage format of the samples in the delay line memory
+typedef enum
+{
+	DELAY_LINE_F32 = 0,
+	DELAY_LINE_Q15
+} delay_line_format;
+
+// bytes per sample in the delay line memory. buffers for delay_line_init_format need size * delay_line_sample_size(format) bytes
+static inline uint32_t delay_line_sample_size(delay_line_format format)
+{
+	return (format == DELAY_LINE_Q15) ? sizeof(q15_t) : sizeof(float32_t);
+}
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Float32 specialized delay line.
+*   Unlike the generic ring buffer (ring_buffer.c), this structure never moves single elements through a void pointer.
+*   Samples are written and read in whole blocks, which results in at most two contiguous segment copies per block
+*   (one up to the end of the buffer, one from the start of the buffer after the wrap-around).
+*   The size of the buffer has to be a power of two, so the wrap-around can be done by masking the free-running write index.
+*   A DELAY_LINE_Q15 line stores the samples packed as q15: twice the delay time in the same memory and half the memory
+*   traffic per block, at 16 bit resolution (about 96 dB dynamic range, below the noise of a guitar signal chain).
+*   The block functions convert on the fly, only delay_line_read_fractional needs a float32 line.
+*
+*   Members:
+*   buffer:             Pointer to the sample memory. Has to be provided by the caller (no dynamic memory allocation).
+*                       Holds q15 samples for DELAY_LINE_Q15, despite the type.
+*   size:               The number of samples the buffer can hold. Must be a power of two.
+*   mask:               size - 1. Used instead of a modulo operation to wrap indices into the buffer.
+*   write_index:        Free-running write position. Wraps around automatically when it overflows (unsigned).
+*   format:             Storage format of the samples.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t *buffer;
+	uint32_t size;
+	uint32_t mask;
+	uint32_t write_index;
+	delay_line_format format;
+} delay_line_t;
+
+// Interpolation used when reading fractional delays.
+// LINEAR needs a delay of at least 0 samples, CUBIC (4-point Hermite) needs a delay of at least 1 sample.
+typedef enum
+{
+	DELAY_LINE_LINEAR = 0,
+	DELAY_LINE_CUBIC
+} delay_line_interpolation;
+
+uint8_t delay_line_init(delay_line_t *dl, float32_t *buffer, uint32_t size);
+uint8_t delay_line_init_format(delay_line_t *dl, void *buffer, uint32_t size, delay_line_format format);
+void delay_line_clear(delay_line_t *dl);
+void delay_line_write(delay_line_t *dl, const float32_t *src, uint32_t block_size);
+void delay_line_write_scaled(delay_line_t *dl, const float32_t *src, float32_t gain, uint32_t block_size);
+void delay_line_read(const delay_line_t *dl, float32_t *dst, uint32_t delay, uint32_t block_size);
+void delay_line_read_scaled(const delay_line_t *dl, float32_t *dst, uint32_t delay, float32_t gain, uint32_t block_size);
+void delay_line_read_fractional(const delay_line_t *dl, float32_t *dst, const float32_t *delay, delay_line_interpolation interpolation, uint32_t block_size);
+void delay_line_write_q31(delay_line_t *dl, const q31_t *src, uint32_t block_size);
+void delay_line_write_scaled_q31(delay_line_t *dl, const q31_t *src, q31_t gain, uint32_t block_size);
+void delay_line_read_q31(const delay_line_t *dl, q31_t *dst, uint32_t delay, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __DELAY_LINE_H__
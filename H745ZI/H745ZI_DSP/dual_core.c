@@ -0,0 +1,438 @@
+// dual_core.c, Michael Haselberger
+// Description: Cortex-M7/Cortex-M4 processing split. The M7 part is compiled into the M7 project (CORE_CM7),
+// the M4 part into the M4 project (CORE_CM4, see CM4/Src/main.c).
+
+#include <string.h>
+#include "dual_core.h"
+#include "trace.h"
+
+_Static_assert(sizeof(dual_core_mailbox_t) <= DUAL_CORE_SHARED_SIZE, "mailbox exceeds the reserved RAM_D3 region");
+
+#if defined(CORE_CM7)
+
+// number of the current block
+static uint32_t block_count = 0;
+// input blocks that didn't fit into the queue
+static uint32_t dropped = 0;
+// the M4 answered the boot handshake
+static bool ready = false;
+#if defined(AMP_POST_M4)
+// number of the current post-filter chunk
+static uint32_t post_count = 0;
+#endif
+
+// the M4 signals a new block by taking and releasing the semaphore, which triggers its HSEM interrupt
+static inline void notify(void)
+{
+	if (HAL_HSEM_FastTake(DUAL_CORE_HSEM_BLOCK) == HAL_OK)
+	{
+		HAL_HSEM_Release(DUAL_CORE_HSEM_BLOCK, 0);
+	}
+}
+
+// copy the block of sequence count from an output queue to dst, release the blocks before it (delivered too late).
+// 1 and silence if the block isn't there
+#pragma optimize_for_speed
+ITCM_CODE static uint8_t collect(block_queue_t *queue, uint32_t count, float32_t *dst)
+{
+	uint8_t missed = 1;
+	block_queue_slot_t *slot;
+
+	while ((slot = block_queue_peek(queue)) != NULL)
+	{
+		// signed difference, works across the wrap-around of the block counter
+		const int32_t age = (int32_t)(count - slot->sequence);
+		if (age < 0)
+		{
+			// belongs to a later block, leave it in the queue
+			break;
+		}
+		if (age == 0)
+		{
+			arm_copy_f32(slot->samples, dst, BLOCK_QUEUE_BLOCK_SIZE);
+			missed = 0;
+		}
+		block_queue_release(queue);
+		if (age == 0)
+		{
+			break;
+		}
+	}
+	if (missed)
+	{
+		memset(dst, 0, BLOCK_QUEUE_BLOCK_SIZE * sizeof(float32_t));
+	}
+	return missed;
+}
+
+/******************************************************************************
+* Function Name: dual_core_init
+*******************************************************************************
+* Summary:
+*  Enable the hardware semaphore clock and initialize the mailbox. Has to be called before the M4
+*  is started (HAL_RCCEx_EnableBootCore).
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void dual_core_init(void)
+{
+	__HAL_RCC_HSEM_CLK_ENABLE();
+	DUAL_CORE_MAILBOX->config.convolver = NULL;
+	SCB_CleanDCache_by_Addr((uint32_t *)&DUAL_CORE_MAILBOX->config, sizeof(dual_core_config_t));
+	block_queue_init(&DUAL_CORE_MAILBOX->input);
+	block_queue_init(&DUAL_CORE_MAILBOX->tail);
+#if defined(AMP_POST_M4)
+	DUAL_CORE_MAILBOX->config.post_serial = 0;
+	DUAL_CORE_MAILBOX->config.post_stages = 0;
+	SCB_CleanDCache_by_Addr((uint32_t *)&DUAL_CORE_MAILBOX->config, sizeof(dual_core_config_t));
+	block_queue_init(&DUAL_CORE_MAILBOX->post_input);
+	block_queue_init(&DUAL_CORE_MAILBOX->post_output);
+#endif
+#if defined(CONTROL_M4)
+	control_link_init(&DUAL_CORE_MAILBOX->control);
+#endif
+}
+
+/******************************************************************************
+* Function Name: dual_core_boot
+*******************************************************************************
+* Summary:
+*  Start the M4 (disabled via option bytes) and wait for its boot handshake: the M4 takes and
+*  releases DUAL_CORE_HSEM_READY once the mailbox side of its init is done. The release sets
+*  the status flag of the M7 even with the interrupt disabled, it's polled here. Call after
+*  dual_core_init, with the SysTick running.
+*
+* Parameters:
+*  None.
+* Return:
+*  1:								- No answer within DUAL_CORE_BOOT_TIMEOUT ms, the M7 carries on alone.
+*  0:								- Success.
+*
+******************************************************************************/
+uint8_t dual_core_boot(void)
+{
+	const uint32_t mask = __HAL_HSEM_SEMID_TO_MASK(DUAL_CORE_HSEM_READY);
+
+	// a release from before a reset of the M7 alone doesn't count
+	__HAL_HSEM_CLEAR_FLAG(mask);
+	HAL_RCCEx_EnableBootCore(RCC_BOOT_C2);
+
+	const uint32_t start = HAL_GetTick();
+	while (!__HAL_HSEM_GET_FLAG(mask))
+	{
+		if ((HAL_GetTick() - start) >= DUAL_CORE_BOOT_TIMEOUT)
+		{
+			return 1;
+		}
+	}
+	__HAL_HSEM_CLEAR_FLAG(mask);
+	ready = true;
+	return 0;
+}
+
+// the M4 is up and serves the queues. false: the M7 computes what it would (see dual_core.h)
+bool dual_core_ready(void)
+{
+	return ready;
+}
+
+/******************************************************************************
+* Function Name: dual_core_attach
+*******************************************************************************
+* Summary:
+*  Hand the tail of a loaded convolver over to the M4. The impulse response spectra and the tail
+*  stages were written through the M7 data cache, so the whole cache is cleaned first. After this
+*  call, the M7 must only use nu_convolver_process_head on conv.
+*
+* Parameters:
+*  1. nu_convolver_t *conv			- Address pointer of the convolver struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void dual_core_attach(nu_convolver_t *conv)
+{
+	SCB_CleanDCache();
+	DUAL_CORE_MAILBOX->config.convolver = conv;
+	SCB_CleanDCache_by_Addr((uint32_t *)&DUAL_CORE_MAILBOX->config, sizeof(dual_core_config_t));
+	__DSB();
+}
+
+/******************************************************************************
+* Function Name: dual_core_exchange
+*******************************************************************************
+* Summary:
+*  Collect the tail output the M4 computed for the current block and pass the current input block on.
+*  Tail blocks of earlier blocks (delivered too late) are dropped. The M4 processes every input block
+*  in order, even if it falls behind, so the tail state stays consistent and catches up again.
+*
+* Parameters:
+*  1. const float32_t *src			- Current input block.
+*  2. float32_t *tail				- Tail output for the current block. Silence, if it is not available.
+* Return:
+*  1:								- The M4 missed its deadline.
+*  0:								- Success.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE uint8_t dual_core_exchange(const float32_t *src, float32_t *tail)
+{
+	dual_core_mailbox_t *mailbox = DUAL_CORE_MAILBOX;
+	const uint8_t missed = collect(&mailbox->tail, block_count, tail);
+	TRACE_EVENT(missed ? TRACE_IPC_TAIL_MISSED : TRACE_IPC_TAIL);
+
+	dropped += block_queue_push(&mailbox->input, block_count, src);
+	block_count++;
+	notify();
+	TRACE_EVENT(TRACE_IPC_BLOCK);
+
+	return missed;
+}
+
+/******************************************************************************
+* Function Name: dual_core_dropped
+*******************************************************************************
+* Summary:
+*  Number of input blocks that were dropped because the input queue was full.
+*
+******************************************************************************/
+uint32_t dual_core_dropped(void)
+{
+	return dropped;
+}
+
+#if defined(AMP_POST_M4)
+/******************************************************************************
+* Function Name: dual_core_set_post
+*******************************************************************************
+* Summary:
+*  Pass the post-filter of a new amp model to the M4. It sets its filter up with empty
+*  states before the next chunk. Audio path, when the model changes.
+*
+* Parameters:
+*  1. const float32_t *coeffs		- 5 coefficients per biquad (arm_biquad_cascade_df2T_f32).
+*  2. uint32_t stages				- Biquads, 0 to AMP_MODEL_MAX_POST. 0: the M4 copies the chunks.
+* Return:
+*  None.
+*
+******************************************************************************/
+void dual_core_set_post(const float32_t *coeffs, uint32_t stages)
+{
+	dual_core_config_t *config = &DUAL_CORE_MAILBOX->config;
+
+	config->post_stages = stages;
+	memcpy(config->post, coeffs, 5 * stages * sizeof(float32_t));
+	// the coefficients reach the memory before the serial that announces them
+	SCB_CleanDCache_by_Addr((uint32_t *)config, sizeof(dual_core_config_t));
+	__DSB();
+	config->post_serial++;
+	SCB_CleanDCache_by_Addr((uint32_t *)config, sizeof(dual_core_config_t));
+	__DSB();
+}
+
+/******************************************************************************
+* Function Name: dual_core_post
+*******************************************************************************
+* Summary:
+*  Collect the post-filtered previous chunk of the amp model and pass the current one on, as
+*  dual_core_exchange does for the reverb tail.
+*
+* Parameters:
+*  1. const float32_t *src			- Current chunk of the model output, BLOCK_QUEUE_BLOCK_SIZE samples.
+*  2. float32_t *dst				- Filtered previous chunk. Silence, if it is not available. Not src.
+* Return:
+*  1:								- The M4 missed its deadline.
+*  0:								- Success.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE uint8_t dual_core_post(const float32_t *src, float32_t *dst)
+{
+	dual_core_mailbox_t *mailbox = DUAL_CORE_MAILBOX;
+	const uint8_t missed = collect(&mailbox->post_output, post_count, dst);
+
+	dropped += block_queue_push(&mailbox->post_input, post_count, src);
+	post_count++;
+	notify();
+
+	return missed;
+}
+#endif
+
+#endif // CORE_CM7
+
+#if defined(CORE_CM4)
+
+// set by the HSEM interrupt
+static volatile uint8_t block_pending = 0;
+
+#if defined(AMP_POST_M4)
+// post-filter of the amp model, set up from the mailbox whenever its serial changes
+static arm_biquad_cascade_df2T_instance_f32 post_filter;
+static float32_t post_coeffs[5 * AMP_MODEL_MAX_POST];
+static float32_t post_state[2 * AMP_MODEL_MAX_POST];
+static uint32_t post_stages = 0;
+static uint32_t post_serial = 0;
+
+// filter one chunk of the amp model in place. the M4 has no data cache, the mailbox is read as it is
+static void post_process(const dual_core_config_t *config, float32_t *samples)
+{
+	if (config->post_serial != post_serial)
+	{
+		post_serial = config->post_serial;
+		post_stages = config->post_stages;
+		memcpy(post_coeffs, config->post, sizeof(post_coeffs));
+		memset(post_state, 0, sizeof(post_state));
+		if (post_stages > 0)
+		{
+			arm_biquad_cascade_df2T_init_f32(&post_filter, post_stages, post_coeffs, post_state);
+		}
+	}
+	if (post_stages > 0)
+	{
+		arm_biquad_cascade_df2T_f32(&post_filter, samples, samples, BLOCK_QUEUE_BLOCK_SIZE);
+	}
+}
+#endif
+
+/******************************************************************************
+* Function Name: dual_core_init
+*******************************************************************************
+* Summary:
+*  Enable the hardware semaphore clock and the notification for new blocks.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void dual_core_init(void)
+{
+	__HAL_RCC_HSEM_CLK_ENABLE();
+	HAL_HSEM_ActivateNotification(__HAL_HSEM_SEMID_TO_MASK(DUAL_CORE_HSEM_BLOCK));
+	HAL_NVIC_SetPriority(HSEM2_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(HSEM2_IRQn);
+}
+
+// boot handshake: the queues are served from now on (see dual_core_boot)
+void dual_core_announce(void)
+{
+	if (HAL_HSEM_FastTake(DUAL_CORE_HSEM_READY) == HAL_OK)
+	{
+		HAL_HSEM_Release(DUAL_CORE_HSEM_READY, 0);
+	}
+}
+
+/******************************************************************************
+* Function Name: HAL_HSEM_FreeCallback
+*******************************************************************************
+* Summary:
+*  Called from HAL_HSEM_IRQHandler when the M7 released the block semaphore. The HAL disables
+*  the notification in the interrupt handler, so it has to be activated again.
+*
+******************************************************************************/
+void HAL_HSEM_FreeCallback(uint32_t SemMask)
+{
+	if (SemMask & __HAL_HSEM_SEMID_TO_MASK(DUAL_CORE_HSEM_BLOCK))
+	{
+		block_pending = 1;
+		HAL_HSEM_ActivateNotification(__HAL_HSEM_SEMID_TO_MASK(DUAL_CORE_HSEM_BLOCK));
+	}
+}
+
+/******************************************************************************
+* Function Name: dual_core_poll
+*******************************************************************************
+* Summary:
+*  Process all queued input blocks in place: input block n yields the tail output of block n + 1.
+*  With AMP_POST_M4, the queued chunks of the amp model are post-filtered the same way. Returns
+*  when the queues are empty, or the M7 hasn't collected the outputs yet.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void dual_core_poll(void)
+{
+	dual_core_mailbox_t *mailbox = DUAL_CORE_MAILBOX;
+	block_pending = 0;
+
+	block_queue_slot_t *in;
+	while ((in = block_queue_peek(&mailbox->input)) != NULL)
+	{
+		block_queue_slot_t *out = block_queue_acquire(&mailbox->tail);
+		if (out == NULL)
+		{
+			// the M7 hasn't collected the tail yet. it does so every block, wait for the next notification
+			break;
+		}
+		nu_convolver_t *conv = mailbox->config.convolver;
+		if (conv != NULL)
+		{
+			nu_convolver_process_tail(conv, in->samples, out->samples);
+		}
+		else
+		{
+			memset(out->samples, 0, sizeof(out->samples));
+		}
+		out->sequence = in->sequence + 1;
+		block_queue_release(&mailbox->input);
+		block_queue_publish(&mailbox->tail);
+	}
+#if defined(AMP_POST_M4)
+	while ((in = block_queue_peek(&mailbox->post_input)) != NULL)
+	{
+		block_queue_slot_t *out = block_queue_acquire(&mailbox->post_output);
+		if (out == NULL)
+		{
+			break;
+		}
+		arm_copy_f32(in->samples, out->samples, BLOCK_QUEUE_BLOCK_SIZE);
+		post_process(&mailbox->config, out->samples);
+		out->sequence = in->sequence + 1;
+		block_queue_release(&mailbox->post_input);
+		block_queue_publish(&mailbox->post_output);
+	}
+#endif
+}
+
+/******************************************************************************
+* Function Name: dual_core_run
+*******************************************************************************
+* Summary:
+*  M4 processing loop. Sleeps until the M7 submits a block, then processes the queued blocks
+*  (dual_core_poll). The queue is checked as well, so a notification that arrived before the M4
+*  was ready is not lost.
+*
+* Parameters:
+*  None.
+* Return:
+*  None (never returns).
+*
+******************************************************************************/
+void dual_core_run(void)
+{
+	dual_core_mailbox_t *mailbox = DUAL_CORE_MAILBOX;
+
+	while (1)
+	{
+		while (!block_pending && (block_queue_count(&mailbox->input) == 0)
+#if defined(AMP_POST_M4)
+			&& (block_queue_count(&mailbox->post_input) == 0)
+#endif
+			)
+		{
+			__WFI();
+		}
+		dual_core_poll();
+	}
+}
+
+#endif // CORE_CM4
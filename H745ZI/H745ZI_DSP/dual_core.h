@@ -0,0 +1,114 @@
+// dual_core.h, Michael Haselberger
+// Description: This file contains declarations for the Cortex-M7/Cortex-M4 processing split implemented in dual_core.c.
+// The file is shared by both core projects (CORE_CM7 / CORE_CM4).
+
+#ifndef __DUAL_CORE_H__
+#define __DUAL_CORE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "platform.h"
+#include "convolver.h"
+#include "block_queue.h"
+#include "amp_model.h"
+#include "control_link.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Dual-core processing.
+*   The M7 keeps the I2S DMA callback, the cheap effects and the low latency head of the reverb. Every block, it hands the
+*   input block to the M4, which computes the long reverb tail (nu_convolver_process_tail) one block behind. The tail output
+*   of a block is always known one block in advance, so this doesn't add latency.
+*
+*   Blocks are exchanged through two block queues (block_queue.h) in a mailbox at the start of RAM_D3 (reserved in both
+*   linker scripts): input blocks from the M7 to the M4 and tail blocks back. Every block carries its block number, so a
+*   tail block the M4 delivered too late is recognized and dropped instead of shifting the tail by one block.
+*   After pushing a block, the M7 notifies the M4 by taking and releasing a hardware semaphore, which triggers the HSEM
+*   interrupt of the M4.
+*
+*   AMP_POST_M4: the M7 runs the recurrent layer of the amp model, the M4 its post-filter. The model output goes to the M4
+*   through a second pair of queues and comes back filtered one block later, the M4 takes the filter coefficients from the
+*   mailbox whenever their serial changes.
+*
+*   Boot handshake: the M7 initializes the mailbox, starts the M4 and waits up to DUAL_CORE_BOOT_TIMEOUT ms for it to
+*   take and release DUAL_CORE_HSEM_READY (dual_core_boot, dual_core_announce). Without an answer (e.g. no CM4 image
+*   in flash bank 2) the M7 computes the reverb tail and the amp post-filter itself (dual_core_ready).
+*
+*   RAM_D3 map, the same in both linker scripts:
+*   0x38000000  8K   inter-core mailbox (dual_core_mailbox_t), not used by either linker script
+*   0x38002000  4K   M7: D3 effect arena (arena.h)
+*   0x38003000 44K   M4: data, bss and stack
+*   0x3800E000  8K   M7: DMA buffers with DMA_PLACEMENT_D3, empty otherwise
+*
+*   CONTROL_M4: the mailbox also holds the control link of the menu on the M4 (control_link.h). The M4 serves the queued
+*   blocks between two passes of its menu (dual_core_poll) instead of in dual_core_run.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+#define DUAL_CORE_SHARED_BASE (0x38000000UL)
+#define DUAL_CORE_SHARED_SIZE (0x2000UL)
+// hardware semaphore released by the M7 when a new block is available
+#define DUAL_CORE_HSEM_BLOCK (0U)
+// hardware semaphore released by the M4 once it's up
+#define DUAL_CORE_HSEM_READY (1U)
+// time the M7 waits for the M4 at start-up in ms
+#define DUAL_CORE_BOOT_TIMEOUT (100)
+
+// written by the M7 only
+typedef struct
+{
+	nu_convolver_t * volatile convolver;
+#if defined(AMP_POST_M4)
+	// post-filter of the amp model: biquads and their coefficients (amp_model.h), changed when serial changes
+	volatile uint32_t post_serial;
+	uint32_t post_stages;
+	float32_t post[5 * AMP_MODEL_MAX_POST];
+#endif
+} __attribute__((aligned(32))) dual_core_config_t;
+
+typedef struct
+{
+	dual_core_config_t config;
+	// M7 -> M4: input block n, sequence = n
+	block_queue_t input;
+	// M4 -> M7: tail output of block n, sequence = n
+	block_queue_t tail;
+#if defined(AMP_POST_M4)
+	// M7 -> M4: amp model output of chunk n, sequence = n
+	block_queue_t post_input;
+	// M4 -> M7: post-filtered chunk n, sequence = n + 1
+	block_queue_t post_output;
+#endif
+#if defined(CONTROL_M4)
+	// M4 -> M7: menu commands, M7 -> M4: status of the pages
+	control_link_t control;
+#endif
+} dual_core_mailbox_t;
+
+#define DUAL_CORE_MAILBOX ((dual_core_mailbox_t *)DUAL_CORE_SHARED_BASE)
+
+void dual_core_init(void);
+
+#if defined(CORE_CM7)
+	uint8_t dual_core_boot(void);
+	bool dual_core_ready(void);
+	void dual_core_attach(nu_convolver_t *conv);
+	uint8_t dual_core_exchange(const float32_t *src, float32_t *tail);
+	uint32_t dual_core_dropped(void);
+#if defined(AMP_POST_M4)
+	void dual_core_set_post(const float32_t *coeffs, uint32_t stages);
+	uint8_t dual_core_post(const float32_t *src, float32_t *dst);
+#endif
+#endif
+
+#if defined(CORE_CM4)
+	void dual_core_announce(void);
+	void dual_core_poll(void);
+	void dual_core_run(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __DUAL_CORE_H__
@@ -0,0 +1,176 @@
+// envelope.c, Michael Haselberger
+// Description: Envelope follower with attack and release shared by the dynamics effects. The rectification is done
+// for the whole block with CMSIS vector functions, only the one-pole recursion runs per sample.
+
+#include "envelope.h"
+
+// per sample coefficient of a time constant. 0 ms = the level follows the signal right away
+static float32_t coefficient(float32_t time_ms)
+{
+	return (time_ms > 0) ? expf(-1000.0f / (time_ms * sample_rate)) : 0.0f;
+}
+
+/******************************************************************************
+* Function Name: envelope_init
+*******************************************************************************
+* Summary:
+*  Initialize an envelope follower at level 0.
+*
+* Parameters:
+*  1. envelope_t *env				- Address pointer of the envelope struct.
+*  2. envelope_mode mode			- ENVELOPE_PEAK or ENVELOPE_RMS.
+*  3. float32_t attack_ms			- Time constant of a rising level in ms. 0 = instant.
+*  4. float32_t release_ms			- Time constant of a falling level in ms.
+* Return:
+*  255:								- Envelope points to NULL.
+*  254:								- Negative time constant.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t envelope_init(envelope_t *env, envelope_mode mode, float32_t attack_ms, float32_t release_ms)
+{
+	if (env == NULL)
+	{
+		return 255;
+	}
+	env->mode = mode;
+	env->level = 0;
+	return envelope_set_times(env, attack_ms, release_ms);
+}
+
+/******************************************************************************
+* Function Name: envelope_set_times
+*******************************************************************************
+* Summary:
+*  Change attack and release. The level continues.
+*
+* Parameters:
+*  1. envelope_t *env				- Address pointer of the envelope struct.
+*  2. float32_t attack_ms			- Time constant of a rising level in ms. 0 = instant.
+*  3. float32_t release_ms			- Time constant of a falling level in ms.
+* Return:
+*  254:								- Negative time constant.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t envelope_set_times(envelope_t *env, float32_t attack_ms, float32_t release_ms)
+{
+	if ((attack_ms < 0) || (release_ms < 0))
+	{
+		return 254;
+	}
+	env->attack = coefficient(attack_ms);
+	env->release = coefficient(release_ms);
+	env->coeff_size = 0;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: envelope_reset
+*******************************************************************************
+* Summary:
+*  Set the level back to 0 (silence), e.g. after the block size changed.
+*
+* Parameters:
+*  1. envelope_t *env				- Address pointer of the envelope struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void envelope_reset(envelope_t *env)
+{
+	env->level = 0;
+}
+
+/******************************************************************************
+* Function Name: envelope_process
+*******************************************************************************
+* Summary:
+*  Envelope of every sample of a block. The block is rectified (arm_abs_f32) or squared
+*  (arm_mult_f32) in one call, then the one-pole recursion runs over it. RMS levels are
+*  returned as root, the state stays the mean square.
+*
+* Parameters:
+*  1. envelope_t *env				- Address pointer of an initialized envelope struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Envelope, one value per input sample. Must not be the same as src.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void envelope_process(envelope_t *env, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	if (env->mode == ENVELOPE_RMS)
+		arm_mult_f32((float32_t *)src, (float32_t *)src, dst, block_size);
+	else
+		arm_abs_f32((float32_t *)src, dst, block_size);
+
+	const float32_t attack = env->attack;
+	const float32_t release = env->release;
+	float32_t level = env->level;
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		const float32_t x = dst[i];
+		// compiles to a compare and vsel
+		const float32_t coeff = (x > level) ? attack : release;
+		level = x + coeff * (level - x);
+		dst[i] = level;
+	}
+	env->level = level;
+
+	if (env->mode == ENVELOPE_RMS)
+	{
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			dst[i] = sqrtf(dst[i]);
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: envelope_block
+*******************************************************************************
+* Summary:
+*  Block rate envelope for effects that need one level per block: the block peak (or mean
+*  square) is the input of one step of the recursion, with the coefficients raised to the
+*  block size. Cheaper than envelope_process, the attack is only resolved per block.
+*
+* Parameters:
+*  1. envelope_t *env				- Address pointer of an initialized envelope struct.
+*  2. const float32_t *src			- Input block.
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  Level after the block (see envelope_value).
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE float32_t envelope_block(envelope_t *env, const float32_t *src, uint32_t block_size)
+{
+	if (env->coeff_size != block_size)
+	{
+		env->attack_block = powf(env->attack, (float32_t)block_size);
+		env->release_block = powf(env->release, (float32_t)block_size);
+		env->coeff_size = block_size;
+	}
+
+	float32_t x;
+	if (env->mode == ENVELOPE_RMS)
+	{
+		arm_power_f32((float32_t *)src, block_size, &x);
+		x /= block_size;
+	}
+	else
+	{
+		float32_t max_z, min_z;
+		uint32_t index;
+		arm_max_f32((float32_t *)src, block_size, &max_z, &index);
+		arm_min_f32((float32_t *)src, block_size, &min_z, &index);
+		x = fmaxf(max_z, -min_z);
+	}
+
+	const float32_t coeff = (x > env->level) ? env->attack_block : env->release_block;
+	env->level = x + coeff * (env->level - x);
+	return envelope_value(env);
+}
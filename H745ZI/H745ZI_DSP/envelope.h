@@ -0,0 +1,64 @@
+// envelope.h, Michael Haselberger
+// Description: This file contains declarations for the envelope follower implemented in envelope.c
+
+#ifndef __ENVELOPE_H__
+#define __ENVELOPE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// PEAK: follows the magnitude of the signal. RMS: follows the mean square and returns its root (loudness)
+typedef enum
+{
+	ENVELOPE_PEAK = 0,
+	ENVELOPE_RMS
+} envelope_mode;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Envelope follower (detector) of the dynamics effects: noise gate, compressor, fuzz makeup gain.
+*   The magnitude (or square) of the block is formed with one CMSIS vector call, the one-pole recursion then rises with
+*   the attack and falls with the release time constant. Only the coefficient select differs per sample, no branch.
+*   Effects that only need one value per block use envelope_block, which works on the block peak (or mean square).
+*
+*   Members:
+*   attack:             Share of the previous level kept per sample while the signal rises. 0 = instant attack.
+*   release:            Share of the previous level kept per sample while the signal falls.
+*   attack_block:       attack and release to the power of the block size (envelope_block), cached for coeff_size samples.
+*   release_block:
+*   coeff_size:         Block size attack_block and release_block were computed for. 0 = not computed yet.
+*   level:              Current level (mean square for ENVELOPE_RMS).
+*   mode:               ENVELOPE_PEAK or ENVELOPE_RMS.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t attack;
+	float32_t release;
+	float32_t attack_block;
+	float32_t release_block;
+	uint32_t coeff_size;
+	float32_t level;
+	envelope_mode mode;
+} envelope_t;
+
+uint8_t envelope_init(envelope_t *env, envelope_mode mode, float32_t attack_ms, float32_t release_ms);
+uint8_t envelope_set_times(envelope_t *env, float32_t attack_ms, float32_t release_ms);
+void envelope_reset(envelope_t *env);
+void envelope_process(envelope_t *env, const float32_t *src, float32_t *dst, uint32_t block_size);
+float32_t envelope_block(envelope_t *env, const float32_t *src, uint32_t block_size);
+
+// level after the last block, in the unit of the signal (RMS: the root is taken here)
+static inline float32_t envelope_value(const envelope_t *env)
+{
+	return (env->mode == ENVELOPE_RMS) ? sqrtf(env->level) : env->level;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __ENVELOPE_H__
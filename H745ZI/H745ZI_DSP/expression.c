@@ -0,0 +1,178 @@
+// expression.c, Michael Haselberger
+// Description: Analog expression pedal on ADC1. The ADC converts continuously and averages 64 conversions in hardware
+// (regular oversampling), the DMA writes the results into a circular buffer of one cache line without an interrupt. Once
+// per block the audio processing averages the buffer as a second boxcar (together a second order CIC decimator of the
+// conversion rate), passes the result through a hysteresis and publishes it as the MOD_PEDAL source of the modulation
+// matrix. The M7 spends a cache line invalidation and 16 additions per block on it. Where the encoder moves a
+// parameter in 1 % steps, the pedal resolves about 11 bits of its travel.
+
+#include "main.h"
+
+#if defined(EXPRESSION_PEDAL)
+
+ADC_HandleTypeDef hadc_expression;
+DMA_HandleTypeDef hdma_expression;
+
+// in AXI SRAM (.bss): the DMA can't reach the DTCM. cacheable, so it's invalidated before the words are read
+static uint16_t samples[EXPRESSION_DMA_WORDS] __attribute__((aligned(32)));
+// filtered value the hysteresis holds, in counts. negative until the first poll
+static float32_t held DTCM_BSS;
+
+/******************************************************************************
+* Function Name: expression_init
+*******************************************************************************
+* Summary:
+*  Set up ADC1 on PA3 with 16 bit resolution, continuous conversion and 64 times hardware
+*  oversampling, calibrate its offset and start the circular DMA into the sample buffer.
+*  Call from main after peripheral_init, before the first block polls the pedal.
+*
+* Parameters:
+*  None.
+* Return:
+*  253:								- ADC, calibration or DMA couldn't be started.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t expression_init(void)
+{
+	ADC_ChannelConfTypeDef channel = {0};
+
+	held = -1.0f;
+	hadc_expression.Instance = EXPRESSION_ADC;
+	hadc_expression.Init.ClockPrescaler = ADC_CLOCK_ASYNC_DIV16;
+	hadc_expression.Init.Resolution = ADC_RESOLUTION_16B;
+	hadc_expression.Init.ScanConvMode = ADC_SCAN_DISABLE;
+	hadc_expression.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+	hadc_expression.Init.LowPowerAutoWait = DISABLE;
+	hadc_expression.Init.ContinuousConvMode = ENABLE;
+	hadc_expression.Init.NbrOfConversion = 1;
+	hadc_expression.Init.DiscontinuousConvMode = DISABLE;
+	hadc_expression.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+	hadc_expression.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+	hadc_expression.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DMA_CIRCULAR;
+	// the buffer is a moving window, a word the DMA was late for is simply replaced
+	hadc_expression.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+	hadc_expression.Init.LeftBitShift = ADC_LEFTBITSHIFT_NONE;
+	hadc_expression.Init.OversamplingMode = ENABLE;
+	hadc_expression.Init.Oversampling.Ratio = EXPRESSION_OVERSAMPLING;
+	hadc_expression.Init.Oversampling.RightBitShift = EXPRESSION_SHIFT;
+	hadc_expression.Init.Oversampling.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+	hadc_expression.Init.Oversampling.OversamplingStopReset = ADC_REGOVERSAMPLING_CONTINUED_MODE;
+	if (HAL_ADC_Init(&hadc_expression) != HAL_OK)
+	{
+		return 253;
+	}
+
+	channel.Channel = EXPRESSION_CHANNEL;
+	channel.Rank = ADC_REGULAR_RANK_1;
+	// 16 us of sampling: enough for the wiper of a 50k pedal
+	channel.SamplingTime = ADC_SAMPLETIME_64CYCLES_5;
+	channel.SingleDiff = ADC_SINGLE_ENDED;
+	channel.OffsetNumber = ADC_OFFSET_NONE;
+	channel.Offset = 0;
+	if ((HAL_ADC_ConfigChannel(&hadc_expression, &channel) != HAL_OK)
+		|| (HAL_ADCEx_Calibration_Start(&hadc_expression, ADC_CALIB_OFFSET, ADC_SINGLE_ENDED) != HAL_OK))
+	{
+		return 253;
+	}
+	// the stream interrupts stay disabled in the NVIC: nobody waits for a word, the buffer is polled
+	return (HAL_ADC_Start_DMA(&hadc_expression, (uint32_t *)samples, EXPRESSION_DMA_WORDS) == HAL_OK) ? 0 : 253;
+}
+
+/******************************************************************************
+* Function Name: expression_poll
+*******************************************************************************
+* Summary:
+*  Average the DMA buffer (the last 16 oversampled words), let the held value follow it
+*  outside the hysteresis band and map the pedal travel to 0 to 1. Called by the audio
+*  processing once per block, before the modulation matrix is evaluated. The first call takes
+*  the average as it is.
+*
+* Parameters:
+*  None.
+* Return:
+*  Position of the pedal from 0 (heel) to 1 (toe).
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE float32_t expression_poll(void)
+{
+	SCB_InvalidateDCache_by_Addr((uint32_t *)samples, sizeof(samples));
+	uint32_t sum = 0;
+	for (uint32_t i = 0; i < EXPRESSION_DMA_WORDS; ++i)
+	{
+		sum += samples[i];
+	}
+	const float32_t mean = (float32_t)sum * (1.0f / EXPRESSION_DMA_WORDS);
+
+	if (held < 0.0f)
+	{
+		held = mean;
+	}
+	else if (mean > (held + EXPRESSION_HYSTERESIS))
+	{
+		held = mean - EXPRESSION_HYSTERESIS;
+	}
+	else if (mean < (held - EXPRESSION_HYSTERESIS))
+	{
+		held = mean + EXPRESSION_HYSTERESIS;
+	}
+
+	const float32_t position = (held - EXPRESSION_HEEL) * (1.0f / (EXPRESSION_TOE - EXPRESSION_HEEL));
+	return fminf(fmaxf(position, 0.0f), 1.0f);
+}
+
+void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	RCC_PeriphCLKInitTypeDef PeriphClkInitStruct = {0};
+	if (hadc->Instance == EXPRESSION_ADC)
+	{
+		// the kernel clock comes from per_ck (HSI, 64 MHz), independent of the core clock profile (see rcc.c)
+		PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_ADC;
+		PeriphClkInitStruct.AdcClockSelection = RCC_ADCCLKSOURCE_CLKP;
+		if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK)
+		{
+			Error_Handler();
+		}
+		__HAL_RCC_ADC12_CLK_ENABLE();
+		__HAL_RCC_GPIOA_CLK_ENABLE();
+		__HAL_RCC_DMA1_CLK_ENABLE();
+
+		/* ADC1 GPIO Configuration
+			PA3     ------> ADC1_INP15
+		*/
+		GPIO_InitStruct.Pin = GPIO_PIN_3;
+		GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+		hdma_expression.Instance = DMA1_Stream5;
+		hdma_expression.Init.Request = DMA_REQUEST_ADC1;
+		hdma_expression.Init.Direction = DMA_PERIPH_TO_MEMORY;
+		hdma_expression.Init.PeriphInc = DMA_PINC_DISABLE;
+		hdma_expression.Init.MemInc = DMA_MINC_ENABLE;
+		hdma_expression.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+		hdma_expression.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+		hdma_expression.Init.Mode = DMA_CIRCULAR;
+		hdma_expression.Init.Priority = DMA_PRIORITY_LOW;
+		hdma_expression.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+		if (HAL_DMA_Init(&hdma_expression) != HAL_OK)
+		{
+			Error_Handler();
+		}
+		__HAL_LINKDMA(hadc, DMA_Handle, hdma_expression);
+	}
+}
+
+void HAL_ADC_MspDeInit(ADC_HandleTypeDef *hadc)
+{
+	if (hadc->Instance == EXPRESSION_ADC)
+	{
+		__HAL_RCC_ADC12_CLK_DISABLE();
+		HAL_GPIO_DeInit(GPIOA, GPIO_PIN_3);
+		HAL_DMA_DeInit(hadc->DMA_Handle);
+	}
+}
+
+#endif // EXPRESSION_PEDAL
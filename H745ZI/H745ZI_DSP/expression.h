@@ -0,0 +1,40 @@
+// expression.h, Michael Haselberger
+// Description: This file contains declarations for the analog expression pedal input implemented in expression.c
+
+#ifndef __EXPRESSION_H__
+#define __EXPRESSION_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+
+// ADC1 input 15 on PA3 (A0 of the Arduino header, CN9): the wiper of an expression pedal (TRS jack: tip wiper, ring
+// 3.3 V, sleeve ground) or of a potentiometer between 3.3 V and ground
+#define EXPRESSION_ADC (ADC1)
+#define EXPRESSION_CHANNEL (ADC_CHANNEL_15)
+// first comb stage in the ADC: 64 conversions of 16 bit are summed and shifted back to 16 bit per DMA word. with the
+// kernel clock of 4 MHz (HSI / 16) and 73 cycles per conversion, about 860 words per second
+#define EXPRESSION_OVERSAMPLING (64)
+#define EXPRESSION_SHIFT (ADC_RIGHTBITSHIFT_6)
+// second comb stage: the audio processing averages the whole circular DMA buffer once per block (19 ms, 9 ms of delay).
+// 16 half words fill one cache line
+#define EXPRESSION_DMA_WORDS (16)
+// hysteresis in counts of the filtered value (0 to 65535): the published value only follows once the filtered value is
+// further away, so the noise left after both stages doesn't move the parameter while the foot rests. 1/2048 of the range
+#define EXPRESSION_HYSTERESIS (32.0f)
+// travel of the pedal in counts: heel down and below is 0, toe down and above is 1. pedals rarely reach the rails
+#define EXPRESSION_HEEL (1024.0f)
+#define EXPRESSION_TOE (64512.0f)
+
+uint8_t expression_init(void);
+float32_t expression_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __EXPRESSION_H__
@@ -0,0 +1,167 @@
+// fast_math.c, Michael Haselberger
+// Description: Block versions of the approximations in fast_math.h, in ITCM. One loop per function over the inline
+// scalar version, the compiler keeps the coefficients in registers and interleaves consecutive samples.
+
+#include "fast_math.h"
+
+/******************************************************************************
+* Function Name: fast_exp2_f32
+*******************************************************************************
+* Summary:
+*  2^x of every sample.
+*
+* Parameters:
+*  1. const float32_t *src			- Input block.
+*  2. float32_t *dst				- Output block, may be src.
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fast_exp2_f32(const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = fast_exp2f(src[i]);
+	}
+}
+
+/******************************************************************************
+* Function Name: fast_exp_f32
+*******************************************************************************
+* Summary:
+*  e^x of every sample.
+*
+* Parameters:
+*  1. const float32_t *src			- Input block.
+*  2. float32_t *dst				- Output block, may be src.
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fast_exp_f32(const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = fast_expf(src[i]);
+	}
+}
+
+/******************************************************************************
+* Function Name: fast_log2_f32
+*******************************************************************************
+* Summary:
+*  log2(x) of every sample. Samples <= 0 are treated as FLT_MIN.
+*
+* Parameters:
+*  1. const float32_t *src			- Input block.
+*  2. float32_t *dst				- Output block, may be src.
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fast_log2_f32(const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = fast_log2f(src[i]);
+	}
+}
+
+/******************************************************************************
+* Function Name: fast_pow_f32
+*******************************************************************************
+* Summary:
+*  x^y of every sample with the same exponent. Samples <= 0 are treated as FLT_MIN.
+*
+* Parameters:
+*  1. const float32_t *src			- Input block.
+*  2. float32_t y					- Exponent.
+*  3. float32_t *dst				- Output block, may be src.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fast_pow_f32(const float32_t *src, float32_t y, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = fast_exp2f(y * fast_log2f(src[i]));
+	}
+}
+
+/******************************************************************************
+* Function Name: fast_tanh_f32
+*******************************************************************************
+* Summary:
+*  tanh(x) of every sample.
+*
+* Parameters:
+*  1. const float32_t *src			- Input block.
+*  2. float32_t *dst				- Output block, may be src.
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fast_tanh_f32(const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = fast_tanhf(src[i]);
+	}
+}
+
+/******************************************************************************
+* Function Name: fast_db_to_gain_f32
+*******************************************************************************
+* Summary:
+*  Factor of every level in dB.
+*
+* Parameters:
+*  1. const float32_t *src			- Input block.
+*  2. float32_t *dst				- Output block, may be src.
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fast_db_to_gain_f32(const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = fast_db_to_gain(src[i]);
+	}
+}
+
+/******************************************************************************
+* Function Name: fast_gain_to_db_f32
+*******************************************************************************
+* Summary:
+*  Level in dB of every factor. Factors <= 0 are treated as FLT_MIN.
+*
+* Parameters:
+*  1. const float32_t *src			- Input block.
+*  2. float32_t *dst				- Output block, may be src.
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fast_gain_to_db_f32(const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = fast_gain_to_db(src[i]);
+	}
+}
@@ -0,0 +1,139 @@
+// fast_math.h, Michael Haselberger
+// Description: This file contains the scalar approximations of exp2, log2, exp, pow, tanh and the dB conversions, and
+// declarations for their block versions implemented in fast_math.c
+
+#ifndef __FAST_MATH_H__
+#define __FAST_MATH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Single precision approximations for the audio path, a handful of FPU operations each instead of the libm functions.
+*   exp2 splits the argument into integer and fraction: the fraction goes through a polynomial, the integer is added to
+*   the exponent field. log2 takes the exponent field and the atanh series of the mantissa. Everything else is built from
+*   these two. The coefficients and error bounds are checked against numpy by Python/fast_math_check.py:
+*
+*   fast_exp2f          relative error < 2.5e-7 (x from -126 to 127, clamped outside)
+*   fast_expf           relative error < 2e-7 * (1 + |x|), the rounding of x * log2(e) grows with x
+*   fast_log2f          absolute error < 2e-7 * (1 + |log2(x)|) (x > 0, treated as FLT_MIN below)
+*   fast_powf           relative error of fast_expf with x = y * ln(base)
+*   fast_tanhf          absolute error < 2e-7
+*   fast_db_to_gain     relative error < 2e-7 * (1 + |dB|)
+*   fast_gain_to_db     absolute error < 1.2e-6 dB * (1 + |log2(gain)|)
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+#define FAST_LOG2E (1.44269504f)
+#define FAST_LN2 (0.693147181f)
+// dB of a factor 2: 20 * log10(2)
+#define FAST_DB_PER_OCTAVE (6.02059991f)
+
+// minimax fit of 2^f for 0 <= f < 1 (Chebyshev nodes)
+#define FAST_EXP2_C0 (0.99999990f)
+#define FAST_EXP2_C1 (0.69315449f)
+#define FAST_EXP2_C2 (0.24014182f)
+#define FAST_EXP2_C3 (0.05586034f)
+#define FAST_EXP2_C4 (0.00894959f)
+#define FAST_EXP2_C5 (0.00189375f)
+// log2(m) = 2 / ln(2) * (t + t^3 / 3 + t^5 / 5 + t^7 / 7), t = (m - 1) / (m + 1), sqrt(1/2) <= m < sqrt(2)
+#define FAST_LOG2_C1 (2.88539008f)
+#define FAST_LOG2_C3 (0.96179669f)
+#define FAST_LOG2_C5 (0.57707801f)
+#define FAST_LOG2_C7 (0.41219858f)
+
+typedef union
+{
+	float32_t f;
+	int32_t i;
+} fast_bits_t;
+
+// 2^x
+static inline float32_t fast_exp2f(float32_t x)
+{
+	// the exponent of the result stays in the normal range
+	x = fminf(fmaxf(x, -126.0f), 127.0f);
+	const float32_t whole = floorf(x);
+	const float32_t f = x - whole;
+	fast_bits_t p;
+	p.f = FAST_EXP2_C0 + f * (FAST_EXP2_C1 + f * (FAST_EXP2_C2 + f * (FAST_EXP2_C3 + f * (FAST_EXP2_C4 + f * FAST_EXP2_C5))));
+	p.i += (int32_t)whole << 23;
+	return p.f;
+}
+
+// log2(x), x > 0
+static inline float32_t fast_log2f(float32_t x)
+{
+	fast_bits_t b;
+	b.f = fmaxf(x, 1.17549435e-38f);
+	int32_t e = ((b.i >> 23) & 0xFF) - 127;
+	// mantissa from 1 to 2, then folded to sqrt(1/2) to sqrt(2), so t stays below 0.172
+	b.i = (b.i & 0x007FFFFF) | 0x3F800000;
+	float32_t m = b.f;
+	if (m > 1.41421356f)
+	{
+		m *= 0.5f;
+		e += 1;
+	}
+	const float32_t t = (m - 1.0f) / (m + 1.0f);
+	const float32_t t2 = t * t;
+	return (float32_t)e + t * (FAST_LOG2_C1 + t2 * (FAST_LOG2_C3 + t2 * (FAST_LOG2_C5 + t2 * FAST_LOG2_C7)));
+}
+
+// e^x
+static inline float32_t fast_expf(float32_t x)
+{
+	return fast_exp2f(x * FAST_LOG2E);
+}
+
+// base^y, base > 0
+static inline float32_t fast_powf(float32_t base, float32_t y)
+{
+	return fast_exp2f(y * fast_log2f(base));
+}
+
+// tanh(x). 1 - 2 / (e^2x + 1) loses the relative accuracy near 0, the series takes over there
+static inline float32_t fast_tanhf(float32_t x)
+{
+	const float32_t a = fabsf(x);
+	float32_t y;
+	if (a < 0.0625f)
+	{
+		const float32_t a2 = a * a;
+		y = a * (1.0f + a2 * (-0.333333333f + a2 * 0.133333333f));
+	}
+	else
+	{
+		y = 1.0f - 2.0f / (fast_exp2f(2.0f * FAST_LOG2E * a) + 1.0f);
+	}
+	return (x < 0.0f) ? -y : y;
+}
+
+// factor of a level in dB
+static inline float32_t fast_db_to_gain(float32_t db)
+{
+	return fast_exp2f(db * (1.0f / FAST_DB_PER_OCTAVE));
+}
+
+// level in dB of a factor, gain > 0
+static inline float32_t fast_gain_to_db(float32_t gain)
+{
+	return FAST_DB_PER_OCTAVE * fast_log2f(gain);
+}
+
+void fast_exp2_f32(const float32_t *src, float32_t *dst, uint32_t block_size);
+void fast_exp_f32(const float32_t *src, float32_t *dst, uint32_t block_size);
+void fast_log2_f32(const float32_t *src, float32_t *dst, uint32_t block_size);
+void fast_pow_f32(const float32_t *src, float32_t y, float32_t *dst, uint32_t block_size);
+void fast_tanh_f32(const float32_t *src, float32_t *dst, uint32_t block_size);
+void fast_db_to_gain_f32(const float32_t *src, float32_t *dst, uint32_t block_size);
+void fast_gain_to_db_f32(const float32_t *src, float32_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __FAST_MATH_H__
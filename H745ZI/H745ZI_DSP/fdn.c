@@ -0,0 +1,291 @@
+// fdn.c, Michael Haselberger
+// Description: Feedback delay network reverb. Eight modulated delay lines with damping, mixed through a Hadamard matrix.
+// An octave shifter in one of the lines makes it a shimmer reverb.
+// A low memory alternative to the convolution reverb (convolver.c), see REVERB_FDN in defines_and_constants.h.
+
+#include <string.h>
+#include "fdn.h"
+
+// loop delays in samples: primes between 31 and 80 ms at 48 kHz, so the echoes of the lines never coincide
+static const uint32_t line_lengths[FDN_LINES] = { 1499, 1801, 2129, 2459, 2803, 3121, 3469, 3851 };
+// modulation rates in Hz, different for every line
+static const float32_t mod_rates[FDN_LINES] = { 0.31f, 0.37f, 0.43f, 0.53f, 0.59f, 0.67f, 0.73f, 0.83f };
+
+// longest read: length + 2 * FDN_MOD_DEPTH + 2 interpolation samples. the shortest line has to be longer than one chunk
+#if ((3851 + 2 * 6 + 2) > FDN_LINE_SIZE) || (1499 <= FDN_CHUNK_SIZE)
+#error "FDN_LINE_SIZE or FDN_CHUNK_SIZE don't fit the line lengths"
+#endif
+// the heads of the shimmer read up to one window behind the loop delay of their line
+#if ((1499 + FDN_SHIMMER_WINDOW + 2) > FDN_LINE_SIZE) || (FDN_SHIMMER_LINE != 0)
+#error "FDN_SHIMMER_WINDOW doesn't fit behind the shimmer line"
+#endif
+
+/******************************************************************************
+* Function Name: fdn_init
+*******************************************************************************
+* Summary:
+*  Initialize the network with caller provided memory and a decay time of 1 s, without
+*  shimmer. The lines are cleared.
+*
+* Parameters:
+*  1. fdn_t *fdn					- Address pointer of the network struct.
+*  2. float32_t *memory				- Line memory, FDN_MEMORY_SIZE bytes.
+*  3. float32_t *work				- Work memory for one chunk, FDN_WORK_SIZE bytes.
+* Return:
+*  255:								- Memory points to NULL.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fdn_init(fdn_t *fdn, float32_t *memory, float32_t *work)
+{
+	if ((memory == NULL) || (work == NULL))
+	{
+		return 255;
+	}
+
+	fdn->work = work;
+	for (uint8_t l = 0; l < FDN_LINES; ++l)
+	{
+		delay_line_init(&fdn->lines[l], &memory[l * FDN_LINE_SIZE], FDN_LINE_SIZE);
+		fdn->length[l] = line_lengths[l];
+		fdn->increment[l] = 2.0f * PI * mod_rates[l] / sample_rate;
+		dc_blocker_init(&fdn->dc_block[l], DC_BLOCKER_CUTOFF_HZ);
+	}
+	oscillator_init(&fdn->shimmer_head[0], OSC_HANN);
+	oscillator_init(&fdn->shimmer_head[1], OSC_HANN);
+	fdn->shimmer = 0.0f;
+	fdn->shimmer_mix = 0.0f;
+	fdn_set_decay(fdn, 1.0f, 0.3f);
+	fdn_reset(fdn);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fdn_set_decay
+*******************************************************************************
+* Summary:
+*  Set the decay time. The gain of every line is chosen so that a sample has lost 60 dB after
+*  rt60 seconds, however often it passed the (shorter or longer) lines.
+*
+* Parameters:
+*  1. fdn_t *fdn					- Address pointer of the network struct.
+*  2. float32_t rt60				- Decay time in s. Range: 0.1 <= rt60 <= 10.
+*  3. float32_t damping				- Low pass coefficient. Range: 0 <= damping <= 0.95.
+* Return:
+*  254:								- Parameter values are out of range.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fdn_set_decay(fdn_t *fdn, float32_t rt60, float32_t damping)
+{
+	if ((rt60 < 0.1f) || (rt60 > 10.0f) || (damping < 0.0f) || (damping > 0.95f))
+	{
+		return 254;
+	}
+
+	// the unnormalized Walsh-Hadamard transform amplifies by sqrt(FDN_LINES), the gains take that back
+	const float32_t normalization = 1.0f / sqrtf((float32_t)FDN_LINES);
+	for (uint8_t l = 0; l < FDN_LINES; ++l)
+	{
+		fdn->gain[l] = normalization * powf(10.0f, -3.0f * fdn->length[l] / (sample_rate * rt60));
+	}
+	fdn->damping = damping;
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fdn_reset
+*******************************************************************************
+* Summary:
+*  Silence the network: clear the lines, the filter states and the shimmer heads.
+*
+* Parameters:
+*  1. fdn_t *fdn					- Address pointer of the network struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fdn_reset(fdn_t *fdn)
+{
+	for (uint8_t l = 0; l < FDN_LINES; ++l)
+	{
+		delay_line_clear(&fdn->lines[l]);
+		fdn->state[l] = 0.0f;
+		fdn->phase[l] = 0.0f;
+		dc_blocker_reset(&fdn->dc_block[l]);
+	}
+	fdn->shimmer_head[0].phase = 0;
+	fdn->shimmer_head[1].phase = 0x80000000u;
+}
+
+/******************************************************************************
+* Function Name: fdn_shimmer
+*******************************************************************************
+* Summary:
+*  Octave up in the shimmer line. Two heads sweep the window behind the loop delay at one
+*  sample per sample, so they play the line back twice as fast (see pitch_process in fx_lib.c).
+*  out holds the plain line output of the chunk, the shifted signal is crossfaded into it with
+*  the shimmer level, ramped over the chunk.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void fdn_shimmer(fdn_t *fdn, float32_t *out, uint32_t n)
+{
+	float32_t position[FDN_CHUNK_SIZE];
+	float32_t head[FDN_CHUNK_SIZE];
+	float32_t window[FDN_CHUNK_SIZE];
+	float32_t wet[FDN_CHUNK_SIZE];
+	const delay_line_t *line = &fdn->lines[FDN_SHIMMER_LINE];
+	// ratio 2: a head runs through the window once per window length. it starts one window behind the plain read
+	// position and catches up with it
+	const float32_t frequency = (float32_t)sample_rate / FDN_SHIMMER_WINDOW;
+	const float32_t offset = (float32_t)(fdn->length[FDN_SHIMMER_LINE] - n + FDN_SHIMMER_WINDOW);
+
+	for (uint8_t h = 0; h < 2; ++h)
+	{
+		oscillator_ramp(&fdn->shimmer_head[h], position, frequency, n);
+		arm_scale_f32(position, -(float32_t)FDN_SHIMMER_WINDOW, position, n);
+		arm_offset_f32(position, offset, position, n);
+		delay_line_read_fractional(line, head, position, DELAY_LINE_LINEAR, n);
+		oscillator_generate(&fdn->shimmer_head[h], window, frequency, n);
+		if (h == 0)
+		{
+			arm_mult_f32(head, window, wet, n);
+		}
+		else
+		{
+			arm_mult_f32(head, window, head, n);
+			arm_add_f32(wet, head, wet, n);
+		}
+	}
+
+	// out + level * (wet - out), the level ramps linearly from the last chunk
+	const float32_t target = fdn->shimmer;
+	const float32_t start = fdn->shimmer_mix;
+	const float32_t step = (target - start) / n;
+	arm_sub_f32(wet, out, wet, n);
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		out[i] += (start + step * (i + 1)) * wet[i];
+	}
+	fdn->shimmer_mix = target;
+}
+
+/******************************************************************************
+* Function Name: fdn_process_chunk
+*******************************************************************************
+* Summary:
+*  Run the network for up to FDN_CHUNK_SIZE samples. All lines are longer than a chunk, so the
+*  line outputs of the whole chunk are read first, then mixed as blocks and written back. The
+*  shimmer only costs while it is on or fading out.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void fdn_process_chunk(fdn_t *fdn, const float32_t *src, float32_t *dst, uint32_t n)
+{
+	float32_t delay[FDN_CHUNK_SIZE];
+	float32_t scratch[FDN_CHUNK_SIZE];
+	float32_t *const work = fdn->work;
+	const float32_t a = fdn->damping;
+	const float32_t b = 1.0f - a;
+
+	// line outputs: modulated fractional read (the line is read before the chunk is written: loop delay = length),
+	// then the damping low pass and the DC blocker
+	for (uint8_t l = 0; l < FDN_LINES; ++l)
+	{
+		float32_t *out = &work[l * FDN_CHUNK_SIZE];
+		const float32_t base = (float32_t)(fdn->length[l] - n) + FDN_MOD_DEPTH;
+		const float32_t start = base + FDN_MOD_DEPTH * arm_sin_f32(fdn->phase[l]);
+		fdn->phase[l] += fdn->increment[l] * n;
+		if (fdn->phase[l] > 2 * PI)
+			fdn->phase[l] -= 2 * PI;
+		const float32_t step = (base + FDN_MOD_DEPTH * arm_sin_f32(fdn->phase[l]) - start) / n;
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			delay[i] = start + step * i;
+		}
+		delay_line_read_fractional(&fdn->lines[l], out, delay, DELAY_LINE_LINEAR, n);
+		if ((l == FDN_SHIMMER_LINE) && ((fdn->shimmer > 0.0f) || (fdn->shimmer_mix > 0.0f)))
+		{
+			fdn_shimmer(fdn, out, n);
+		}
+
+		float32_t y = fdn->state[l];
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			y = b * out[i] + a * y;
+			out[i] = y;
+		}
+		fdn->state[l] = y;
+		dc_blocker_process(&fdn->dc_block[l], out, out, n);
+	}
+
+	// output: all lines with alternating signs. with the input split over the lines, the tail has about the energy of
+	// the input (1 s decay), like the normalized impulse response of the convolution reverb
+	arm_sub_f32(&work[0], &work[FDN_CHUNK_SIZE], dst, n);
+	for (uint8_t l = 2; l < FDN_LINES; l += 2)
+	{
+		arm_add_f32(dst, &work[l * FDN_CHUNK_SIZE], dst, n);
+		arm_sub_f32(dst, &work[(l + 1) * FDN_CHUNK_SIZE], dst, n);
+	}
+
+	// decay gains, then the Hadamard matrix as fast Walsh-Hadamard transform: butterflies of whole chunks
+	for (uint8_t l = 0; l < FDN_LINES; ++l)
+	{
+		arm_scale_f32(&work[l * FDN_CHUNK_SIZE], fdn->gain[l], &work[l * FDN_CHUNK_SIZE], n);
+	}
+	for (uint8_t half = 1; half < FDN_LINES; half <<= 1)
+	{
+		for (uint8_t l = 0; l < FDN_LINES; l += (half << 1))
+		{
+			for (uint8_t k = l; k < l + half; ++k)
+			{
+				float32_t *x = &work[k * FDN_CHUNK_SIZE];
+				float32_t *y = &work[(k + half) * FDN_CHUNK_SIZE];
+				arm_add_f32(x, y, scratch, n);
+				arm_sub_f32(x, y, y, n);
+				arm_copy_f32(scratch, x, n);
+			}
+		}
+	}
+
+	// feed the input in with alternating signs and write the chunk into the lines
+	arm_scale_f32(src, 1.0f / sqrtf((float32_t)FDN_LINES), scratch, n);
+	for (uint8_t l = 0; l < FDN_LINES; ++l)
+	{
+		float32_t *in = &work[l * FDN_CHUNK_SIZE];
+		if (l & 1)
+			arm_sub_f32(in, scratch, in, n);
+		else
+			arm_add_f32(in, scratch, in, n);
+		delay_line_write(&fdn->lines[l], in, n);
+	}
+}
+
+/******************************************************************************
+* Function Name: fdn_process
+*******************************************************************************
+* Summary:
+*  Run the network on a block (wet signal only). Works with any block size, blocks longer than
+*  FDN_CHUNK_SIZE are split. No block latency, the first echo arrives after the shortest line.
+*
+* Parameters:
+*  1. fdn_t *fdn					- Address pointer of the network struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block. Must not be src.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fdn_process(fdn_t *fdn, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t offset = 0; offset < block_size; offset += FDN_CHUNK_SIZE)
+	{
+		const uint32_t n = ((block_size - offset) < FDN_CHUNK_SIZE) ? (block_size - offset) : FDN_CHUNK_SIZE;
+		fdn_process_chunk(fdn, &src[offset], &dst[offset], n);
+	}
+}
@@ -0,0 +1,86 @@
+// fdn.h, Michael Haselberger
+// Description: This file contains declarations for the feedback delay network reverb engine implemented in fdn.c
+
+#ifndef __FDN_H__
+#define __FDN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+#include "delay_line.h"
+#include "dc_blocker.h"
+#include "oscillator.h"
+
+// number of delay lines. the mixing matrix is a Hadamard matrix, so it has to be a power of two
+#define FDN_LINES (8)
+// samples per delay line (power of two). holds the longest line plus the modulation and one chunk
+#define FDN_LINE_SIZE (4096)
+// the network is computed in chunks of this size: longer blocks are split, the work memory only holds one chunk.
+// the shortest line has to be longer than one chunk, otherwise the feedback would need samples not computed yet
+#define FDN_CHUNK_SIZE (64)
+// peak delay modulation in samples (slow chorus on every line, smears the modal resonances)
+#define FDN_MOD_DEPTH (6.0f)
+// memory for the delay lines (taken from the caller, e.g. the RAM_D1 arena) and for the work chunk (e.g. DTCM)
+#define FDN_MEMORY_SIZE (FDN_LINES * FDN_LINE_SIZE * sizeof(float32_t))
+#define FDN_WORK_SIZE (FDN_LINES * FDN_CHUNK_SIZE * sizeof(float32_t))
+// line with the octave shifter of the shimmer: the shortest one, its memory has room for the read window behind the loop
+// delay. the window is the one of the pitch shifter (PITCH_WINDOW in fx_lib.c, 30 ms at 48 kHz)
+#define FDN_SHIMMER_LINE (0)
+#define FDN_SHIMMER_WINDOW (1440)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Feedback delay network (algorithmic reverb).
+*   FDN_LINES delay lines of mutually prime lengths are fed back into each other through an orthogonal Hadamard matrix,
+*   which is computed as a fast Walsh-Hadamard transform (log2(FDN_LINES) stages of block additions and subtractions
+*   instead of a full matrix multiplication). Every line has a one-pole low pass (high frequencies decay faster, like in
+*   a real room), a DC blocker and a gain that sets the decay time. The read taps are modulated slowly with fractional delays.
+*   The input is fed into all lines with alternating signs, the output is the sum of all lines with alternating signs.
+*   Shimmer: the output of FDN_SHIMMER_LINE is crossfaded with an octave up, read by two windowed heads from the same
+*   line (granular pitch shift as in run_pitch). Every pass through the line adds another octave, the matrix spreads it
+*   over the network. The heads need no memory of their own, the line is long enough for the window behind its delay.
+*   Memory: FDN_MEMORY_SIZE for the lines instead of the ~450 KB spectra of the convolution reverb.
+*
+*   Members:
+*   lines:              Delay lines of the network.
+*   work:               FDN_LINES x FDN_CHUNK_SIZE samples: the line outputs of the current chunk. Caller provided.
+*   length:             Loop delay of every line in samples.
+*   gain:               Feedback gain of every line (decay time, matrix normalization included).
+*   damping:            One-pole low pass coefficient (0 = no damping, towards 1 = darker).
+*   state:              Last output of the low pass of every line.
+*   dc_block:           DC blocker of every line, keeps an offset of the input from circulating for the whole decay.
+*   phase:              Phase of the modulation of every line [0, 2 PI].
+*   increment:          Phase increment per sample of every line.
+*   shimmer:            Level of the octave in the shimmer line (0 = plain network, 1 = shifted only). Set by the caller.
+*   shimmer_mix:        Level reached at the end of the last chunk, the level ramps to shimmer over a chunk.
+*   shimmer_head:       Hann windows of the two read heads, half a cycle apart. Their phase is also the head position.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	delay_line_t lines[FDN_LINES];
+	float32_t *work;
+	uint32_t length[FDN_LINES];
+	volatile float32_t gain[FDN_LINES];
+	volatile float32_t damping;
+	float32_t state[FDN_LINES];
+	dc_blocker_t dc_block[FDN_LINES];
+	float32_t phase[FDN_LINES];
+	float32_t increment[FDN_LINES];
+	volatile float32_t shimmer;
+	float32_t shimmer_mix;
+	oscillator_t shimmer_head[2];
+} fdn_t;
+
+uint8_t fdn_init(fdn_t *fdn, float32_t *memory, float32_t *work);
+uint8_t fdn_set_decay(fdn_t *fdn, float32_t rt60, float32_t damping);
+void fdn_reset(fdn_t *fdn);
+void fdn_process(fdn_t *fdn, const float32_t *src, float32_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __FDN_H__
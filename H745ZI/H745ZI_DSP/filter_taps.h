@@ -0,0 +1,10 @@
+// generated by dsp_helpers.export_fir_header: windowed_sinc(37, 2725, 48000, 'hamming')
+#define FILTER_TAPS_LENGTH (37)
+const float32_t __attribute__((aligned(32))) filter_taps[FILTER_TAPS_LENGTH] DTCM_INIT = 
+{
+	1.930367398e-04f, -3.528121695e-04f, -1.162610330e-03f, -2.404082695e-03f, -4.081141977e-03f, -5.940774152e-03f, -7.436996448e-03f, -7.772388194e-03f,
+	-6.019736980e-03f, -1.306080934e-03f, 6.976232683e-03f, 1.897738157e-02f, 3.426308014e-02f, 5.178856467e-02f, 6.998985504e-02f, 8.698417960e-02f,
+	1.008475054e-01f, 1.099191130e-01f, 1.130753501e-01f, 1.099191130e-01f, 1.008475054e-01f, 8.698417960e-02f, 6.998985504e-02f, 5.178856467e-02f,
+	3.426308014e-02f, 1.897738157e-02f, 6.976232683e-03f, -1.306080934e-03f, -6.019736980e-03f, -7.772388194e-03f, -7.436996448e-03f, -5.940774152e-03f,
+	-4.081141977e-03f, -2.404082695e-03f, -1.162610330e-03f, -3.528121695e-04f, 1.930367398e-04f,
+};
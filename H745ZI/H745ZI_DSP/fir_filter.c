@@ -0,0 +1,159 @@
+// fir_filter.c, Michael Haselberger
+// Description: FIR filter with a bank of coefficient sets. The set is switched at a block boundary with a crossfade over
+// one block, so responses (e.g. speaker cabinets) can be changed while the audio path is running.
+
+#include <string.h>
+#include "fir_filter.h"
+#include "smooth_param.h"
+
+static float32_t __attribute__((aligned(32))) DTCM_BSS state_pool[FIR_FILTER_POOL_SIZE];
+static uint32_t pool_used = 0;
+
+// filter history and output of the old set during a switch. all filters run in the audio interrupt, so they can share them
+static float32_t DTCM_BSS history[FIR_FILTER_MAX_TAPS - 1];
+static float32_t DTCM_BSS faded_out[MAX_BLOCK_SIZE];
+
+/******************************************************************************
+* Function Name: fir_filter_init
+*******************************************************************************
+* Summary:
+*  Initialize a filter with a coefficient bank, starting with set 0. The filter state is taken
+*  from a pool in DTCM the first time and sized for the tap count and MAX_BLOCK_SIZE, later
+*  calls reuse it (and clear it). A later bank may not have more taps than the first one.
+*
+* Parameters:
+*  1. fir_filter_t *f					- Address pointer of the filter struct.
+*  2. const float32_t *const *bank		- Coefficient sets, taps each, time reversed (CMSIS order).
+*  3. uint8_t sets						- Number of sets in the bank.
+*  4. uint16_t taps						- Taps of every set. Range: 1 to FIR_FILTER_MAX_TAPS.
+* Return:
+*  255:									- Filter or bank point to NULL.
+*  254:									- No set or tap count out of range.
+*  253:									- State pool exhausted (see FIR_FILTER_POOL_SIZE).
+*    0:									- Success.
+*
+******************************************************************************/
+uint8_t fir_filter_init(fir_filter_t *f, const float32_t *const *bank, uint8_t sets, uint16_t taps)
+{
+	if ((f == NULL) || (bank == NULL))
+	{
+		return 255;
+	}
+	if ((sets == 0) || (taps == 0) || (taps > FIR_FILTER_MAX_TAPS))
+	{
+		return 254;
+	}
+	if (f->state == NULL)
+	{
+		const uint32_t size = taps + MAX_BLOCK_SIZE - 1;
+		if ((pool_used + size) > FIR_FILTER_POOL_SIZE)
+		{
+			return 253;
+		}
+		f->state = &state_pool[pool_used];
+		f->capacity = taps;
+		pool_used += size;
+	}
+	else if (taps > f->capacity)
+	{
+		return 254;
+	}
+
+	f->bank = bank;
+	f->sets = sets;
+	f->active = 0;
+	f->used = 0;
+	// clears the state
+	arm_fir_init_f32(&f->fir, taps, (float32_t *)bank[0], f->state, MAX_BLOCK_SIZE);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fir_filter_select
+*******************************************************************************
+* Summary:
+*  Request another coefficient set. Only an index is written, the audio path switches with its
+*  next block, so this can be called from the main loop at any time.
+*
+* Parameters:
+*  1. fir_filter_t *f					- Address pointer of an initialized filter struct.
+*  2. uint8_t set						- Set of the bank. Range: 0 to sets - 1.
+* Return:
+*  255:									- Filter not initialized.
+*  254:									- Set out of range.
+*    0:									- Success.
+*
+******************************************************************************/
+uint8_t fir_filter_select(fir_filter_t *f, uint8_t set)
+{
+	if (f->bank == NULL)
+	{
+		return 255;
+	}
+	if (set >= f->sets)
+	{
+		return 254;
+	}
+	f->active = set;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fir_filter_reset
+*******************************************************************************
+* Summary:
+*  Clear the filter history. The selected set stays.
+*
+* Parameters:
+*  1. fir_filter_t *f					- Address pointer of an initialized filter struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fir_filter_reset(fir_filter_t *f)
+{
+	memset(f->state, 0, (f->fir.numTaps + MAX_BLOCK_SIZE - 1) * sizeof(float32_t));
+}
+
+/******************************************************************************
+* Function Name: fir_filter_process
+*******************************************************************************
+* Summary:
+*  Filter a block. If another set was selected since the last block, the block is filtered with
+*  both sets from the same history and faded linearly from the old to the new one. That block
+*  costs twice the cycles. Called from the audio interrupt only.
+*
+* Parameters:
+*  1. fir_filter_t *f					- Address pointer of an initialized filter struct.
+*  2. const float32_t *src				- Input block.
+*  3. float32_t *dst					- Output block. May be the same as src.
+*  4. uint32_t block_size				- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fir_filter_process(fir_filter_t *f, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	const uint8_t active = f->active;
+
+	if (active == f->used)
+	{
+		arm_fir_f32(&f->fir, (float32_t *)src, dst, block_size);
+		return;
+	}
+
+	// arm_fir_f32 keeps the last numTaps - 1 input samples at the start of the state
+	const uint32_t size = (f->fir.numTaps - 1) * sizeof(float32_t);
+	memcpy(history, f->state, size);
+	arm_fir_f32(&f->fir, (float32_t *)src, faded_out, block_size);
+	memcpy(f->state, history, size);
+
+	f->fir.pCoeffs = (float32_t *)f->bank[active];
+	arm_fir_f32(&f->fir, (float32_t *)src, dst, block_size);
+
+	const smooth_param_t fade = { .start = 0.0f, .end = 1.0f };
+	smooth_param_mix(&fade, faded_out, dst, dst, block_size);
+	f->used = active;
+}
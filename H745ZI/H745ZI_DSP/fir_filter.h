@@ -0,0 +1,59 @@
+// fir_filter.h, Michael Haselberger
+// Description: This file contains declarations for the FIR filter with switchable coefficient sets implemented in fir_filter.c
+
+#ifndef __FIR_FILTER_H__
+#define __FIR_FILTER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// longest coefficient set of a filter (direct form, longer impulse responses go to the FFT convolver)
+#ifndef FIR_FILTER_MAX_TAPS
+#define FIR_FILTER_MAX_TAPS (256)
+#endif
+// filter state memory of all filters in samples. every filter takes taps + MAX_BLOCK_SIZE - 1 of it
+#ifndef FIR_FILTER_POOL_SIZE
+#define FIR_FILTER_POOL_SIZE (2 * AUDIO_CHANNELS * (FIR_FILTER_MAX_TAPS + MAX_BLOCK_SIZE))
+#endif
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Direct form FIR filter (arm_fir_f32) running one set of a preloaded coefficient bank, e.g. a filter response per
+*   cabinet. fir_filter_select only requests another set, the audio path takes it over at the next block start and fades
+*   from the old to the new set over that block. Both sets start from the same filter history, so a switch never
+*   blocks and doesn't click. All sets of a bank have the same number of taps (zero padded if necessary).
+*
+*   Members:
+*   fir:                CMSIS instance. pCoeffs points to the set in use.
+*   bank:               Coefficient sets in the order arm_fir_f32 expects (time reversed). Not copied, has to stay valid.
+*   sets:               Number of sets in the bank.
+*   capacity:           Longest set the filter state was sized for.
+*   state:              Filter state in DTCM, capacity + MAX_BLOCK_SIZE - 1 samples. Taken from a pool by the first init.
+*   active:             Set the next block is filtered with. Written by fir_filter_select only.
+*   used:               Set the last block was filtered with. Written by fir_filter_process only.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	arm_fir_instance_f32 fir;
+	const float32_t *const *bank;
+	uint8_t sets;
+	uint16_t capacity;
+	float32_t *state;
+	volatile uint8_t active;
+	volatile uint8_t used;
+} fir_filter_t;
+
+uint8_t fir_filter_init(fir_filter_t *f, const float32_t *const *bank, uint8_t sets, uint16_t taps);
+uint8_t fir_filter_select(fir_filter_t *f, uint8_t set);
+void fir_filter_reset(fir_filter_t *f);
+void fir_filter_process(fir_filter_t *f, const float32_t *src, float32_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __FIR_FILTER_H__
@@ -0,0 +1,2290 @@
+// fx_chain.c, Michael Haselberger
+// Description: Serial effect chain scheduler. Replaces running exactly one effect selected by a switch with an
+// ordered list of processing nodes, so effects can be combined (e.g. overdrive -> delay -> reverb) in one pass per block.
+
+#include <string.h>
+#include "fx_chain.h"
+#include "arena.h"
+#include "scratch_pool.h"
+#include "profiler.h"
+#include "trace.h"
+
+// fx_setup_chain (fx_setup.c) adds one node per effect, FXDENOISE ... FXPINGPONG
+_Static_assert(FX_CHAIN_MAX_NODES >= FXPINGPONG, "FX_CHAIN_MAX_NODES too small for a node per effect");
+
+// intermediate blocks between the nodes. all chains are processed from the audio interrupt, so they can share them
+static sample_t scratch[AUDIO_CHANNELS][2][MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+// output of the outgoing node during a crossfade
+static sample_t faded_out[AUDIO_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+// signal at a split, the input of every branch, and the sum of the branches mixed so far
+static sample_t split_in[AUDIO_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+static sample_t mix_sum[AUDIO_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+// input of the nodes that ring on after they were switched off
+static sample_t silence[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+
+/******************************************************************************
+* Function Name: fx_chain_init
+*******************************************************************************
+* Summary:
+*  Initialize an empty chain.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_chain_init(fx_chain_t *chain)
+{
+	chain->count = 0;
+	chain->shed = false;
+	chain->latency = 0;
+	chain->routed = false;
+	chain->open = NULL;
+	chain->q15 = false;
+	chain->pipelined = false;
+	chain->stage = FX_CHAIN_NO_STAGE;
+	chain->host = NULL;
+	chain->host_ctx = NULL;
+	chain->stage_misses = 0;
+#if defined(FX_CHAIN_PIPELINE)
+	memset(chain->pipe, 0, sizeof(chain->pipe));
+	chain->pipe_index = 0;
+#endif
+}
+
+/******************************************************************************
+* Function Name: fx_chain_add
+*******************************************************************************
+* Summary:
+*  Append a node to the end of the chain. New nodes are bypassed, so building a chain
+*  doesn't change the sound until a node is switched on.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node (e.g. fx_designator).
+*  3. fx_process_t process			- Processing function.
+*  4. void *const ctx[]				- Context of every channel. ctx[1] == NULL marks a shared mono node.
+* Return:
+*  255:								- Chain is full or process is NULL.
+*  Index of the node otherwise.
+*
+******************************************************************************/
+uint8_t fx_chain_add(fx_chain_t *chain, uint8_t id, fx_process_t process, void *const ctx[AUDIO_CHANNELS])
+{
+	if ((process == NULL) || (chain->count >= FX_CHAIN_MAX_NODES))
+	{
+		return 255;
+	}
+
+	fx_node_t *node = &chain->nodes[chain->count];
+	node->process = process;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		node->ctx[ch] = ctx[ch];
+	}
+	node->id = id;
+	node->bypass = true;
+	node->activate = NULL;
+	node->deactivate = NULL;
+	node->active = false;
+	node->essential = true;
+	node->latency = NULL;
+	node->kind = FX_NODE_EFFECT;
+	node->factor = NULL;
+	node->stereo = NULL;
+	node->cycles = 0;
+	node->hold = 0;
+	node->spill = false;
+	node->asleep = false;
+	node->ringing = false;
+	node->quiet = 0;
+	node->chunk = 0;
+
+	return chain->count++;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_bypass
+*******************************************************************************
+* Summary:
+*  Switch the nodes with the given id on or off.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. bool bypass					- true: skip the node, false: process it.
+* Return:
+*  255:								- No node has this id.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_bypass(fx_chain_t *chain, uint8_t id, bool bypass)
+{
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if (chain->nodes[i].id == id)
+		{
+			chain->nodes[i].bypass = bypass;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_solo
+*******************************************************************************
+* Summary:
+*  Switch on the nodes with the given id and bypass all others (single effect operation).
+*  An id no node has bypasses the whole chain.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_chain_solo(fx_chain_t *chain, uint8_t id)
+{
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		chain->nodes[i].bypass = (chain->nodes[i].id != id);
+	}
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_essential
+*******************************************************************************
+* Summary:
+*  Mark the nodes with the given id as essential or not. Nodes that aren't essential are the
+*  first to go when the CPU load gets too high (fx_chain_shed).
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. bool essential				- false: the node may be skipped to keep the block deadline.
+* Return:
+*  255:								- No node has this id.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_essential(fx_chain_t *chain, uint8_t id, bool essential)
+{
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if (chain->nodes[i].id == id)
+		{
+			chain->nodes[i].essential = essential;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_shed
+*******************************************************************************
+* Summary:
+*  Skip all nodes that aren't essential, or process them again. The bypass states are kept,
+*  so switching effects (fx_chain_solo, transitions) works the same while load is shed.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. bool shed						- true: skip the nodes that aren't essential.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_chain_shed(fx_chain_t *chain, bool shed)
+{
+	chain->shed = shed;
+}
+
+// run one node on n samples of every channel
+#pragma optimize_for_speed
+ITCM_CODE static inline void run_node_block(const fx_node_t *node, const sample_t *const src[AUDIO_CHANNELS], sample_t *const dst[AUDIO_CHANNELS], uint32_t n)
+{
+#if (AUDIO_CHANNELS == 2)
+	if (node->stereo != NULL)
+	{
+		node->stereo(node->ctx[0], src, dst, n);
+		return;
+	}
+	if (node->ctx[1] == NULL)
+	{
+		// shared mono node: the right output buffer holds the mono sum until it receives the result
+#if defined(SAMPLE_Q31)
+		// halve before adding, so the sum can't saturate
+		arm_shift_q31(src[0], -1, dst[1], n);
+		arm_shift_q31(src[1], -1, dst[0], n);
+		arm_add_q31(dst[0], dst[1], dst[1], n);
+		node->process(node->ctx[0], dst[1], dst[0], n);
+		arm_copy_q31(dst[0], dst[1], n);
+#else
+		arm_add_f32(src[0], src[1], dst[1], n);
+		arm_scale_f32(dst[1], 0.5f, dst[1], n);
+		node->process(node->ctx[0], dst[1], dst[0], n);
+		arm_copy_f32(dst[0], dst[1], n);
+#endif
+		return;
+	}
+#endif
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		node->process(node->ctx[ch], src[ch], dst[ch], n);
+	}
+}
+
+// run one node on a block of every channel, in chunks of its chunk length (fx_chain_set_chunk). every chunk gets the
+// scratch pool the node got, so what its kernels take from it follows the chunk, not the block
+#pragma optimize_for_speed
+ITCM_CODE static void run_node(const fx_node_t *node, const sample_t *const src[AUDIO_CHANNELS], sample_t *const dst[AUDIO_CHANNELS], uint32_t n)
+{
+	if ((node->chunk == 0) || (n <= node->chunk))
+	{
+		run_node_block(node, src, dst, n);
+		return;
+	}
+	const sample_t *chunk_src[AUDIO_CHANNELS];
+	sample_t *chunk_dst[AUDIO_CHANNELS];
+	for (uint32_t offset = 0; offset < n; offset += node->chunk)
+	{
+		const uint32_t length = ((n - offset) < node->chunk) ? (n - offset) : node->chunk;
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			chunk_src[ch] = &src[ch][offset];
+			chunk_dst[ch] = &dst[ch][offset];
+		}
+		const scratch_mark_t mark = scratch_pool_mark();
+		run_node_block(node, chunk_src, chunk_dst, length);
+		scratch_pool_release(mark);
+	}
+}
+
+// samples per call of the process function of a node at block size n
+static inline uint32_t node_length(const fx_node_t *node, uint32_t n)
+{
+	return ((node->chunk == 0) || (n <= node->chunk)) ? n : node->chunk;
+}
+
+// loudest sample of a block of every channel, full scale 1. the CMSIS-DSP version has no absmax, the peak is the
+// larger of max and -min as in envelope_block
+#pragma optimize_for_speed
+ITCM_CODE static float32_t block_peak(const sample_t *const block[AUDIO_CHANNELS], uint32_t n)
+{
+	float32_t peak = 0.0f;
+	uint32_t index;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		q31_t max, min;
+		arm_max_q31(block[ch], n, &max, &index);
+		arm_min_q31(block[ch], n, &min, &index);
+		peak = fmaxf(peak, fmaxf((float32_t)max, -(float32_t)min) * (1.0f / 2147483648.0f));
+#else
+		float32_t max, min;
+		arm_max_f32((float32_t *)block[ch], n, &max, &index);
+		arm_min_f32((float32_t *)block[ch], n, &min, &index);
+		peak = fmaxf(peak, fmaxf(max, -min));
+#endif
+	}
+	return peak;
+}
+
+// count a silent block of a node. true once the node was silent for its hold
+static inline bool quiet_block(fx_node_t *node, const sample_t *const block[AUDIO_CHANNELS], uint32_t n)
+{
+	if (block_peak(block, n) >= FX_SILENCE_LEVEL)
+	{
+		node->quiet = 0;
+		return false;
+	}
+	node->quiet += n;
+	return (node->quiet >= node->hold) ? true : false;
+}
+
+// run a node that may sleep (fx_chain_set_tail). a sleeping node is skipped while its input is silent, it falls asleep
+// once input and output were silent for its hold. false if it was skipped, dst isn't written then
+#pragma optimize_for_speed
+ITCM_CODE static bool run_awake(fx_node_t *node, const sample_t *const src[AUDIO_CHANNELS], sample_t *const dst[AUDIO_CHANNELS], uint32_t n)
+{
+	if (node->hold == 0)
+	{
+		run_node(node, src, dst, n);
+		return true;
+	}
+	const bool silent = (block_peak(src, n) < FX_SILENCE_LEVEL);
+	if (!silent)
+	{
+		node->asleep = false;
+		node->quiet = 0;
+	}
+	else if (node->asleep)
+	{
+		return false;
+	}
+	run_node(node, src, dst, n);
+	if (silent)
+		node->asleep = quiet_block(node, (const sample_t *const *)dst, n);
+	return true;
+}
+
+// copy a block of every channel
+static inline void copy_block(const sample_t *const src[AUDIO_CHANNELS], sample_t *const dst[AUDIO_CHANNELS], uint32_t n)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		arm_copy_q31(src[ch], dst[ch], n);
+#else
+		arm_copy_f32(src[ch], dst[ch], n);
+#endif
+	}
+}
+
+// element-wise node that can be fused: shared mono nodes mix the channels first and run alone
+static inline bool fusable(const fx_node_t *node)
+{
+#if (AUDIO_CHANNELS == 2)
+	return ((node->kind == FX_NODE_EFFECT) && (node->factor != NULL) && (node->ctx[1] != NULL)) ? true : false;
+#else
+	return ((node->kind == FX_NODE_EFFECT) && (node->factor != NULL)) ? true : false;
+#endif
+}
+
+// number of active nodes from active[k] on that run as one stage: a run of fusable nodes, otherwise the node alone
+static inline uint8_t stage_length(const fx_chain_t *chain, const uint8_t active[], uint8_t k, uint8_t count)
+{
+	uint8_t j = k;
+	while ((j < count) && fusable(&chain->nodes[active[j]]))
+		j++;
+	return (j - k >= 2) ? j - k : 1;
+}
+
+// the stage of length nodes from active[0] on runs fused: a run of element-wise nodes, in q15 also a single one
+static inline bool fused_stage(const fx_chain_t *chain, const uint8_t active[], uint8_t length)
+{
+	return ((length > 1) || (chain->q15 && fusable(&chain->nodes[active[0]]))) ? true : false;
+}
+
+// run consecutive element-wise nodes as one stage: their gains are multiplied, the signal is read and written once
+#pragma optimize_for_speed
+ITCM_CODE static void run_fused(const fx_chain_t *chain, const uint8_t active[], uint8_t length, const sample_t *const src[AUDIO_CHANNELS], sample_t *const dst[AUDIO_CHANNELS], uint32_t n)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *factor = scratch_pool_alloc(n * sizeof(float32_t));
+	float32_t *next = scratch_pool_alloc(n * sizeof(float32_t));
+#if defined(SAMPLE_Q31)
+	q31_t *gain = scratch_pool_alloc(n * sizeof(q31_t));
+#endif
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		const fx_node_t *node = &chain->nodes[active[0]];
+		node->factor(node->ctx[ch], factor, n);
+		for (uint8_t i = 1; i < length; ++i)
+		{
+			node = &chain->nodes[active[i]];
+			node->factor(node->ctx[ch], next, n);
+			arm_mult_f32(factor, next, factor, n);
+		}
+#if defined(SAMPLE_Q31)
+		// the product stays in [-1, 1], 1 saturates to the largest q31 value
+		arm_float_to_q31(factor, gain, n);
+		arm_mult_q31(src[ch], gain, dst[ch], n);
+#else
+		arm_mult_f32(src[ch], factor, dst[ch], n);
+#endif
+	}
+	scratch_pool_release(mark);
+}
+
+// the same stage in q15 (fx_chain_set_q15): the gains are converted once, multiplied and applied two samples per word
+// (arm_mult_q15 reads and writes the samples in pairs, saturated with __SSAT and packed with __PKHBT). the signal is
+// packed into q15 for the product and unpacked into dst, the gain and signal buffers take half the memory
+#pragma optimize_for_speed
+ITCM_CODE static void run_fused_q15(const fx_chain_t *chain, const uint8_t active[], uint8_t length, const sample_t *const src[AUDIO_CHANNELS], sample_t *const dst[AUDIO_CHANNELS], uint32_t n)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *factor = scratch_pool_alloc(n * sizeof(float32_t));
+	q15_t *gain = scratch_pool_alloc(n * sizeof(q15_t));
+	q15_t *next = scratch_pool_alloc(n * sizeof(q15_t));
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		const fx_node_t *node = &chain->nodes[active[0]];
+		node->factor(node->ctx[ch], factor, n);
+		arm_float_to_q15(factor, gain, n);
+		for (uint8_t i = 1; i < length; ++i)
+		{
+			node = &chain->nodes[active[i]];
+			node->factor(node->ctx[ch], factor, n);
+			arm_float_to_q15(factor, next, n);
+			arm_mult_q15(gain, next, gain, n);
+		}
+		// next holds the packed signal
+#if defined(SAMPLE_Q31)
+		arm_q31_to_q15(src[ch], next, n);
+		arm_mult_q15(next, gain, next, n);
+		arm_q15_to_q31(next, dst[ch], n);
+#else
+		arm_float_to_q15(src[ch], next, n);
+		arm_mult_q15(next, gain, next, n);
+		arm_q15_to_float(next, dst[ch], n);
+#endif
+	}
+	scratch_pool_release(mark);
+}
+
+// run a fused stage in the precision of the chain
+static inline void run_stage(const fx_chain_t *chain, const uint8_t active[], uint8_t length, const sample_t *const src[AUDIO_CHANNELS], sample_t *const dst[AUDIO_CHANNELS], uint32_t n)
+{
+	if (chain->q15)
+		run_fused_q15(chain, active, length, src, dst, n);
+	else
+		run_fused(chain, active, length, src, dst, n);
+}
+
+// add the output of a branch to the sum of the mixer: scaled by the ramp of its gain into tmp, then added. the first
+// branch is scaled straight into the sum
+#pragma optimize_for_speed
+ITCM_CODE static void mix_branch(const fx_mixer_t *mixer, uint8_t input, const sample_t *const src[AUDIO_CHANNELS], sample_t *const tmp[AUDIO_CHANNELS], sample_t *const sum[AUDIO_CHANNELS], uint32_t n)
+{
+	const smooth_param_t *gain = &mixer->gain_smooth[input];
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		if (input == 0)
+		{
+			smooth_param_scale_q31(gain, src[ch], sum[ch], n);
+			continue;
+		}
+		smooth_param_scale_q31(gain, src[ch], tmp[ch], n);
+		arm_add_q31(mix_sum[ch], tmp[ch], sum[ch], n);
+#else
+		if (input == 0)
+		{
+			smooth_param_scale(gain, src[ch], sum[ch], n);
+			continue;
+		}
+		smooth_param_scale(gain, src[ch], tmp[ch], n);
+		arm_add_f32(mix_sum[ch], tmp[ch], sum[ch], n);
+#endif
+	}
+}
+
+// run the active nodes of a chain with a split. the branches read the copy of the signal at the split, every branch
+// output is added to mix_sum. the last active node writes the output, unless that's a branch
+#pragma optimize_for_speed
+ITCM_CODE static void process_routed(fx_chain_t *chain, const uint8_t active[], uint8_t count, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	const sample_t *src[AUDIO_CHANNELS];
+	const sample_t *split[AUDIO_CHANNELS];
+	sample_t *dst[AUDIO_CHANNELS];
+	sample_t *tmp[AUDIO_CHANNELS];
+	sample_t *sum[AUDIO_CHANNELS];
+	fx_mixer_t *mixer = NULL;
+	uint8_t input = 0;
+	uint8_t p = 0;
+	bool written = false;
+
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		src[ch] = in[ch];
+		split[ch] = in[ch];
+	}
+
+	for (uint8_t k = 0; k < count; ++k)
+	{
+		fx_node_t *node = &chain->nodes[active[k]];
+		const bool last = (k == count - 1);
+		switch (node->kind)
+		{
+		case FX_NODE_SPLIT:
+			mixer = node->ctx[0];
+			input = 0;
+			// the input block is never written, everything else is kept in a buffer of its own
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				if (src[ch] != in[ch])
+				{
+#if defined(SAMPLE_Q31)
+					arm_copy_q31(src[ch], split_in[ch], n);
+#else
+					arm_copy_f32(src[ch], split_in[ch], n);
+#endif
+					split[ch] = split_in[ch];
+				}
+				else
+				{
+					split[ch] = in[ch];
+				}
+			}
+			// the gains of all branches move once per block
+			for (uint8_t i = 0; i < mixer->inputs; ++i)
+			{
+				smooth_param_next(&mixer->gain_smooth[i], mixer->gain[i], n);
+			}
+			break;
+
+		case FX_NODE_BRANCH:
+		case FX_NODE_MIX:
+			// the scratch buffer not holding src is free for the scaled branch
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				tmp[ch] = scratch[ch][p];
+				sum[ch] = (last && (node->kind == FX_NODE_MIX)) ? out[ch] : mix_sum[ch];
+			}
+			mix_branch(mixer, input++, src, tmp, sum, n);
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				src[ch] = (node->kind == FX_NODE_MIX) ? sum[ch] : split[ch];
+			}
+			written = last && (node->kind == FX_NODE_MIX);
+			break;
+
+		default:
+		{
+			const uint8_t length = stage_length(chain, active, k, count);
+			const bool final = (k + length == count);
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				dst[ch] = final ? out[ch] : scratch[ch][p];
+			}
+			p ^= 1;
+			TRACE_EVENT(TRACE_NODE_START + node->id);
+			// a node gets the whole scratch pool, whatever it leaves behind ends with it
+			const scratch_mark_t mark = scratch_pool_mark();
+			bool processed = true;
+			if (fused_stage(chain, &active[k], length))
+				run_stage(chain, &active[k], length, src, dst, n);
+			else
+				processed = run_awake(node, src, dst, n);
+			scratch_pool_release(mark);
+			TRACE_EVENT(TRACE_NODE_END + node->id);
+			if (processed)
+			{
+				for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+				{
+					src[ch] = dst[ch];
+				}
+			}
+			else
+			{
+				// a sleeping node passes its silent input on, the scratch buffer stays free
+				p ^= 1;
+			}
+			written = final && processed;
+			k += length - 1;
+			break;
+		}
+		}
+	}
+
+	if (!written)
+	{
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+#if defined(SAMPLE_Q31)
+			arm_copy_q31(src[ch], out[ch], n);
+#else
+			arm_copy_f32(src[ch], out[ch], n);
+#endif
+		}
+	}
+}
+
+#if defined(FX_CHAIN_PIPELINE)
+// add a measured stage to the costs of its nodes, shared evenly. the costs only place the cut of the pipeline
+static inline void account(fx_chain_t *chain, const uint8_t active[], uint8_t length, uint32_t cycles)
+{
+	const uint32_t share = cycles / length;
+	for (uint8_t k = 0; k < length; ++k)
+	{
+		fx_node_t *node = &chain->nodes[active[k]];
+		node->cycles = (node->cycles == 0) ? share : node->cycles - (node->cycles >> FX_COST_SHIFT) + (share >> FX_COST_SHIFT);
+	}
+}
+#endif
+
+// run count active nodes of a chain without a split one after the other, from in to out. the first node reads the
+// input, the last one writes the output, everything in between alternates between the two scratch buffers
+#pragma optimize_for_speed
+ITCM_CODE static void run_serial(fx_chain_t *chain, const uint8_t active[], uint8_t count, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	if (count == 0)
+	{
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+#if defined(SAMPLE_Q31)
+			arm_copy_q31(in[ch], out[ch], n);
+#else
+			arm_copy_f32(in[ch], out[ch], n);
+#endif
+		}
+		return;
+	}
+
+	const sample_t *src[AUDIO_CHANNELS];
+	sample_t *dst[AUDIO_CHANNELS];
+	uint8_t length = 1;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		src[ch] = in[ch];
+	}
+
+	uint8_t p = 0;
+	for (uint8_t k = 0; k < count; k += length)
+	{
+		length = stage_length(chain, active, k, count);
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			dst[ch] = (k + length == count) ? out[ch] : scratch[ch][p];
+		}
+		p ^= 1;
+#if defined(FX_CHAIN_PIPELINE)
+		const uint32_t start = profiler_now();
+#endif
+		TRACE_EVENT(TRACE_NODE_START + chain->nodes[active[k]].id);
+		// a node gets the whole scratch pool, whatever it leaves behind ends with it
+		const scratch_mark_t mark = scratch_pool_mark();
+		bool processed = true;
+		if (fused_stage(chain, &active[k], length))
+			run_stage(chain, &active[k], length, src, dst, n);
+		else
+			processed = run_awake(&chain->nodes[active[k]], src, dst, n);
+		scratch_pool_release(mark);
+		TRACE_EVENT(TRACE_NODE_END + chain->nodes[active[k]].id);
+		if (!processed)
+		{
+			// a sleeping node passes its silent input on and keeps its measured cost. the last one copies it out
+			p ^= 1;
+			if (k + length == count)
+				copy_block(src, out, n);
+			continue;
+		}
+#if defined(FX_CHAIN_PIPELINE)
+		account(chain, &active[k], length, profiler_now() - start);
+#endif
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			src[ch] = dst[ch];
+		}
+	}
+}
+
+#if defined(FX_CHAIN_PIPELINE)
+// run the chain in its two stages: stage 1 on the current block, stage 2 (nodes head to count - 1) on the stage 1
+// output of the previous block, by the host or by the chain itself
+#pragma optimize_for_speed
+ITCM_CODE static void process_pipelined(fx_chain_t *chain, const uint8_t active[], uint8_t head, uint8_t count, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	sample_t *current[AUDIO_CHANNELS];
+	sample_t *previous[AUDIO_CHANNELS];
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		current[ch] = chain->pipe[chain->pipe_index][ch];
+		previous[ch] = chain->pipe[chain->pipe_index ^ 1][ch];
+	}
+
+	run_serial(chain, active, head, in, current, n);
+	if (chain->host != NULL)
+	{
+		chain->stage_misses += chain->host(chain->host_ctx, (const sample_t *const *)current, out, n);
+	}
+	else
+	{
+		run_serial(chain, &active[head], count - head, previous, out, n);
+	}
+	chain->pipe_index ^= 1;
+	chain->latency += n;
+}
+#endif
+
+/******************************************************************************
+* Function Name: fx_chain_process
+*******************************************************************************
+* Summary:
+*  Run all active nodes on one block. The first active node reads the input, the last active
+*  node writes the output, everything in between alternates between the two scratch buffers.
+*  Consecutive element-wise nodes run as one stage (fx_chain_set_factor), in q15 with
+*  fx_chain_set_q15.
+*  If all nodes are bypassed (or shed), the input is copied to the output. Nodes that sleep
+*  (fx_chain_set_tail) are skipped while their input stays silent, a silent input through a
+*  sleeping chain costs the block peaks and one copy. The latencies the
+*  processed nodes declare add up to chain->latency, of a split the longest branch counts.
+*  A pipelined chain with active nodes on both sides of the cut runs them in two stages one
+*  block apart (fx_chain_set_pipeline), which adds one block to chain->latency.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. sample_t *const in[]			- Input block of every channel.
+*  3. sample_t *const out[]			- Output block of every channel. Must not overlap with in.
+*  4. uint32_t n					- Samples per channel. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fx_chain_process(fx_chain_t *chain, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	// collect the active nodes first, so the last one can write straight into the output
+	uint8_t active[FX_CHAIN_MAX_NODES];
+	uint8_t count = 0;
+	// latency in front of the split, of the running branch and of the longest branch so far
+	uint32_t latency = 0;
+	uint32_t branch = 0;
+	uint32_t longest = 0;
+	const bool shed = chain->shed;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		const fx_node_t *node = &chain->nodes[i];
+		switch (node->kind)
+		{
+		case FX_NODE_SPLIT:
+			latency += branch;
+			branch = 0;
+			longest = 0;
+			break;
+		case FX_NODE_BRANCH:
+			longest = (branch > longest) ? branch : longest;
+			branch = 0;
+			break;
+		case FX_NODE_MIX:
+			latency += (branch > longest) ? branch : longest;
+			branch = 0;
+			break;
+		default:
+			if (node->bypass || (!node->essential && shed))
+				continue;
+			if (node->latency != NULL)
+				branch += node->latency(node->ctx[0], node_length(node, n));
+			break;
+		}
+		active[count++] = i;
+	}
+	chain->latency = latency + branch;
+
+	if (chain->routed)
+	{
+		process_routed(chain, active, count, in, out, n);
+		return;
+	}
+
+#if defined(FX_CHAIN_PIPELINE)
+	if (chain->pipelined && (chain->stage != FX_CHAIN_NO_STAGE))
+	{
+		// active nodes in front of the cut
+		const uint8_t first = chain->stage;
+		uint8_t head = 0;
+		while ((head < count) && (active[head] < first))
+			head++;
+		if ((head > 0) && (head < count))
+		{
+			process_pipelined(chain, active, head, count, in, out, n);
+			return;
+		}
+	}
+#endif
+	run_serial(chain, active, count, in, out, n);
+}
+
+// ---- fx_lib adapters ----
+#if defined(SAMPLE_Q31)
+// delay, filter and overdrive process the q31 blocks directly. the float kernels work on the buffers stored in their
+// handle: the adapter converts the block into float_in, points the handle to float_in/out and converts the result back
+
+// all adapters run in the audio interrupt, so they can share the conversion buffers
+static float32_t float_in[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+static float32_t float_out[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+
+#define FLOAT_ADAPTER(name, handle_type, run) \
+ITCM_CODE void name(void *ctx, const sample_t *in, sample_t *out, uint32_t n) \
+{ \
+	handle_type *handle = ctx; \
+	arm_q31_to_float(in, float_in, n); \
+	handle->src = float_in; \
+	handle->dst = float_out; \
+	run(handle, n); \
+	arm_float_to_q31(float_out, out, n); \
+}
+
+ITCM_CODE void fx_process_delay(void *ctx, const sample_t *in, sample_t *out, uint32_t n)
+{
+	run_delay_q31(ctx, in, out, n);
+}
+
+ITCM_CODE void fx_process_overdrive(void *ctx, const sample_t *in, sample_t *out, uint32_t n)
+{
+	run_overdrive_q31(ctx, in, out, n);
+}
+
+// the FIR filter has no handle, ctx is the channel index
+ITCM_CODE void fx_process_filter(void *ctx, const sample_t *in, sample_t *out, uint32_t n)
+{
+	run_fir_filter_q31((uint8_t)(uintptr_t)ctx, in, out, n);
+}
+
+FLOAT_ADAPTER(fx_process_fuzz, fuzz_handle_t, run_fuzz)
+FLOAT_ADAPTER(fx_process_tremolo, tremolo_handle_t, run_tremolo)
+FLOAT_ADAPTER(fx_process_ring_mod, ring_mod_handle_t, run_ring_mod)
+FLOAT_ADAPTER(fx_process_eq, eq_handle_t, run_eq)
+FLOAT_ADAPTER(fx_process_cab, cab_handle_t, run_cab)
+FLOAT_ADAPTER(fx_process_gate, gate_handle_t, run_gate)
+FLOAT_ADAPTER(fx_process_comp, comp_handle_t, run_comp)
+FLOAT_ADAPTER(fx_process_pitch, pitch_handle_t, run_pitch)
+FLOAT_ADAPTER(fx_process_wah, wah_handle_t, run_wah)
+FLOAT_ADAPTER(fx_process_phaser, phaser_handle_t, run_phaser)
+FLOAT_ADAPTER(fx_process_amp, amp_handle_t, run_amp)
+FLOAT_ADAPTER(fx_process_fxloop, fxloop_handle_t, run_fxloop)
+FLOAT_ADAPTER(fx_process_denoise, denoise_handle_t, run_denoise)
+FLOAT_ADAPTER(fx_process_freeze, freeze_handle_t, run_freeze)
+FLOAT_ADAPTER(fx_process_chorus, chorus_handle_t, run_chorus)
+FLOAT_ADAPTER(fx_process_flanger, flanger_handle_t, run_flanger)
+FLOAT_ADAPTER(fx_process_reverb, reverb_handle_t, run_reverb)
+
+// the ping-pong delay reads and writes both channels in one call
+ITCM_CODE void fx_process_pingpong(void *ctx, const sample_t *in, sample_t *out, uint32_t n)
+{
+	pingpong_handle_t *handle = ctx;
+	arm_q31_to_float(in, float_in, n);
+	handle->src[0] = float_in;
+	handle->src[1] = float_in;
+	handle->dst[0] = float_out;
+	handle->dst[1] = NULL;
+	run_pingpong(handle, n);
+	arm_float_to_q31(float_out, out, n);
+}
+
+#if (AUDIO_CHANNELS == 2)
+// conversion buffers of the right channel for the nodes that process both channels in one call
+static float32_t float_in_right[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+static float32_t float_out_right[MAX_BLOCK_SIZE] __attribute__((aligned(32))) DTCM_BSS;
+
+ITCM_CODE void fx_stereo_pingpong(void *ctx, const sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	pingpong_handle_t *handle = ctx;
+	arm_q31_to_float(in[0], float_in, n);
+	arm_q31_to_float(in[1], float_in_right, n);
+	handle->src[0] = float_in;
+	handle->src[1] = float_in_right;
+	handle->dst[0] = float_out;
+	handle->dst[1] = float_out_right;
+	run_pingpong(handle, n);
+	arm_float_to_q31(float_out, out[0], n);
+	arm_float_to_q31(float_out_right, out[1], n);
+}
+#else
+ITCM_CODE void fx_stereo_pingpong(void *ctx, const sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	fx_process_pingpong(ctx, in[0], out[0], n);
+}
+#endif
+
+#else
+// the kernels work on the buffers stored in their handle, so the adapters only point them to the node buffers
+
+ITCM_CODE void fx_process_delay(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	delay_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_delay(handle, n);
+}
+
+ITCM_CODE void fx_process_overdrive(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	overdrive_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_overdrive(handle, n);
+}
+
+ITCM_CODE void fx_process_fuzz(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	fuzz_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_fuzz(handle, n);
+}
+
+ITCM_CODE void fx_process_tremolo(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	tremolo_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_tremolo(handle, n);
+}
+
+ITCM_CODE void fx_process_ring_mod(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	ring_mod_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_ring_mod(handle, n);
+}
+
+// the FIR filter has no handle, ctx is the channel index
+ITCM_CODE void fx_process_filter(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	run_fir_filter((uint8_t)(uintptr_t)ctx, (float32_t *)in, out, n);
+}
+
+ITCM_CODE void fx_process_eq(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	eq_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_eq(handle, n);
+}
+
+ITCM_CODE void fx_process_cab(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	cab_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_cab(handle, n);
+}
+
+ITCM_CODE void fx_process_gate(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	gate_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_gate(handle, n);
+}
+
+ITCM_CODE void fx_process_comp(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	comp_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_comp(handle, n);
+}
+
+ITCM_CODE void fx_process_pitch(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	pitch_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_pitch(handle, n);
+}
+
+ITCM_CODE void fx_process_wah(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	wah_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_wah(handle, n);
+}
+
+ITCM_CODE void fx_process_phaser(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	phaser_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_phaser(handle, n);
+}
+
+ITCM_CODE void fx_process_amp(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	amp_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_amp(handle, n);
+}
+
+ITCM_CODE void fx_process_fxloop(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	fxloop_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_fxloop(handle, n);
+}
+
+ITCM_CODE void fx_process_denoise(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	denoise_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_denoise(handle, n);
+}
+
+ITCM_CODE void fx_process_freeze(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	freeze_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_freeze(handle, n);
+}
+
+ITCM_CODE void fx_process_chorus(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	chorus_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_chorus(handle, n);
+}
+
+ITCM_CODE void fx_process_flanger(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	flanger_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_flanger(handle, n);
+}
+
+ITCM_CODE void fx_process_reverb(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	reverb_handle_t *handle = ctx;
+	handle->src = (float32_t *)in;
+	handle->dst = out;
+	run_reverb(handle, n);
+}
+
+// the ping-pong delay reads and writes both channels in one call
+ITCM_CODE void fx_process_pingpong(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	pingpong_handle_t *handle = ctx;
+	handle->src[0] = (float32_t *)in;
+	handle->src[1] = (float32_t *)in;
+	handle->dst[0] = out;
+	handle->dst[1] = NULL;
+	run_pingpong(handle, n);
+}
+
+#if (AUDIO_CHANNELS == 2)
+ITCM_CODE void fx_stereo_pingpong(void *ctx, const float32_t *const in[AUDIO_CHANNELS], float32_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	pingpong_handle_t *handle = ctx;
+	handle->src[0] = (float32_t *)in[0];
+	handle->src[1] = (float32_t *)in[1];
+	handle->dst[0] = out[0];
+	handle->dst[1] = out[1];
+	run_pingpong(handle, n);
+}
+#else
+ITCM_CODE void fx_stereo_pingpong(void *ctx, const float32_t *const in[AUDIO_CHANNELS], float32_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	fx_process_pingpong(ctx, in[0], out[0], n);
+}
+#endif
+#endif
+
+/******************************************************************************
+* Function Name: fx_chain_set_lifecycle
+*******************************************************************************
+* Summary:
+*  Set the lifecycle functions of the nodes with the given id.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. fx_activate_t activate		- Takes the buffers and clears the history, called with the context of every channel.
+*  4. fx_deactivate_t deactivate	- Gives the buffers back, called with the context of every channel.
+* Return:
+*  255:								- No node has this id.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_lifecycle(fx_chain_t *chain, uint8_t id, fx_activate_t activate, fx_deactivate_t deactivate)
+{
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if (chain->nodes[i].id == id)
+		{
+			chain->nodes[i].activate = activate;
+			chain->nodes[i].deactivate = deactivate;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_latency
+*******************************************************************************
+* Summary:
+*  Set the function the nodes with the given id declare their latency with.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. fx_latency_t latency			- Samples the output lags the input, NULL for none.
+* Return:
+*  255:								- No node has this id.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_latency(fx_chain_t *chain, uint8_t id, fx_latency_t latency)
+{
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if (chain->nodes[i].id == id)
+		{
+			chain->nodes[i].latency = latency;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_factor
+*******************************************************************************
+* Summary:
+*  Mark the nodes with the given id as element-wise: next to another active element-wise node,
+*  factor is called instead of process and the gains of both are applied in one pass.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. fx_factor_t factor			- Gain of every sample, NULL to always run process.
+* Return:
+*  255:								- No node has this id.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_factor(fx_chain_t *chain, uint8_t id, fx_factor_t factor)
+{
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id == id) && (chain->nodes[i].kind == FX_NODE_EFFECT))
+		{
+			chain->nodes[i].factor = factor;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_stereo
+*******************************************************************************
+* Summary:
+*  Let the nodes with the given id process both channels in one call: with AUDIO_CHANNELS 2
+*  stereo is called with the blocks of both channels instead of process per channel. The
+*  lifecycle functions are still called with the context of every channel.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. fx_stereo_t stereo			- Processing function of both channels, NULL to run process per channel.
+* Return:
+*  255:								- No node has this id.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_stereo(fx_chain_t *chain, uint8_t id, fx_stereo_t stereo)
+{
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id == id) && (chain->nodes[i].kind == FX_NODE_EFFECT))
+		{
+			chain->nodes[i].stereo = stereo;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_chunk
+*******************************************************************************
+* Summary:
+*  Let the nodes with the given id process every block in chunks of a fixed length, whatever
+*  the block size of the audio path: a kernel keeps the length its working set fits (scratch
+*  pool, DTCM, the unrolled loops of CMSIS) while the block size is chosen for the latency.
+*  Only for streaming nodes (filters, waveshapers, modulation): what they compute once per call
+*  (the block peak of the fuzz makeup, the parameter targets) then follows the chunk, as at that
+*  block size. Not for nodes that work in whole blocks: the STFT effects (one frame per block),
+*  the effects loop and the convolvers (cabinet, reverb), whose partitions follow the block
+*  size. The latency function is asked with the chunk length. Element-wise stages that run
+*  fused process the whole block.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. uint16_t chunk				- Samples per call, a power of 2 from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE.
+*									  0: the whole block. Blocks up to chunk run in one call.
+* Return:
+*  255:								- No node has this id.
+*  254:								- Chunk length not supported.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_chunk(fx_chain_t *chain, uint8_t id, uint16_t chunk)
+{
+	if ((chunk != 0) && ((chunk < MIN_BLOCK_SIZE) || (chunk > MAX_BLOCK_SIZE) || (((chunk - 1) & chunk) != 0)))
+	{
+		return 254;
+	}
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id == id) && (chain->nodes[i].kind == FX_NODE_EFFECT))
+		{
+			chain->nodes[i].chunk = chunk;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_tail
+*******************************************************************************
+* Summary:
+*  Let the nodes with the given id sleep: once their input and their output were silent
+*  (FX_SILENCE_LEVEL) for hold samples, they are skipped until the input isn't silent anymore.
+*  hold has to cover the longest silence inside the tail of the node, e.g. the delay time of an
+*  echo. With spill, a transition that switches the node off lets its tail ring on until it
+*  decayed (fx_transition_process). Element-wise stages that run fused don't sleep.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+*  3. uint32_t hold					- Samples of silence before the node sleeps, 0: never.
+*  4. bool spill					- true: the tail rings on after the node was switched off.
+* Return:
+*  255:								- No node has this id.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_tail(fx_chain_t *chain, uint8_t id, uint32_t hold, bool spill)
+{
+	uint8_t found = 255;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		fx_node_t *node = &chain->nodes[i];
+		if ((node->id == id) && (node->kind == FX_NODE_EFFECT))
+		{
+			node->hold = hold;
+			node->spill = spill;
+			node->asleep = false;
+			node->quiet = 0;
+			found = 0;
+		}
+	}
+	return found;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_q15
+*******************************************************************************
+* Summary:
+*  Run the element-wise stages (fx_chain_set_factor) of the chain in q15: gains and signal are
+*  multiplied with 16 bit precision (96 dB), two samples per word, a single element-wise node
+*  included. The nodes in between keep the precision of sample_t. The signal is saturated to
+*  [-1, 1) there, a float signal with headroom above full scale is clipped. For chains whose
+*  element-wise effects don't need more than 16 bits, e.g. a tremolo behind a distortion.
+*  Takes effect with the next block.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. bool q15						- true for q15, false for the precision of sample_t.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_chain_set_q15(fx_chain_t *chain, bool q15)
+{
+	chain->q15 = q15;
+}
+
+// active effect nodes from node first on, as fx_chain_process would run them
+static uint8_t serial_nodes(const fx_chain_t *chain, uint8_t first, uint8_t active[])
+{
+	uint8_t count = 0;
+	const bool shed = chain->shed;
+	for (uint8_t i = first; i < chain->count; ++i)
+	{
+		const fx_node_t *node = &chain->nodes[i];
+		if (node->bypass || (!node->essential && shed))
+			continue;
+		active[count++] = i;
+	}
+	return count;
+}
+
+// measured cost of the longer stage with the cut in front of node first. all nodes in one stage: the whole chain
+static uint32_t longer_stage(const fx_chain_t *chain, uint8_t first)
+{
+	uint32_t head = 0;
+	uint32_t tail = 0;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		const fx_node_t *node = &chain->nodes[i];
+		if (node->bypass || (!node->essential && chain->shed))
+			continue;
+		if (i < first)
+			head += node->cycles;
+		else
+			tail += node->cycles;
+	}
+	return (head > tail) ? head : tail;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_set_pipeline
+*******************************************************************************
+* Summary:
+*  Run the chain in two pipeline stages: stage 2 processes the stage 1 output of the previous
+*  block while stage 1 processes the current one. The cut is placed by fx_chain_balance once the
+*  active nodes have been measured, until then the chain runs in one stage. The host runs stage 2,
+*  e.g. on the other core. It has to take its copy of the block it is given before it returns and
+*  answer with the block it is given one call later, processed by the nodes from chain->stage on
+*  (fx_chain_process_stage on a chain of its own with the same nodes). Without a host, the chain
+*  runs stage 2 itself one block late.
+*  Takes effect with the next block. The first block after the switch is silence. Needs
+*  FX_CHAIN_PIPELINE, which also measures the costs of the nodes the cut is placed by.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. bool pipelined				- true: two stages, false: one stage.
+*  3. fx_stage_host_t host			- Host of the second stage, NULL: the chain itself.
+*  4. void *ctx						- Passed to the host.
+* Return:
+*  255:								- The chain has a split.
+*  254:								- Two stages without FX_CHAIN_PIPELINE.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_set_pipeline(fx_chain_t *chain, bool pipelined, fx_stage_host_t host, void *ctx)
+{
+	if (pipelined && chain->routed)
+	{
+		return 255;
+	}
+#if !defined(FX_CHAIN_PIPELINE)
+	if (pipelined)
+	{
+		return 254;
+	}
+#endif
+	chain->pipelined = false;
+	__DMB();
+	chain->host = host;
+	chain->host_ctx = ctx;
+	chain->stage = FX_CHAIN_NO_STAGE;
+#if defined(FX_CHAIN_PIPELINE)
+	// no stage 1 output of an earlier switch reaches stage 2
+	memset(chain->pipe, 0, sizeof(chain->pipe));
+	chain->pipe_index = 0;
+#endif
+	__DMB();
+	chain->pipelined = pipelined;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_partition
+*******************************************************************************
+* Summary:
+*  Cut of the active nodes into two stages that balances their measured costs: the cut that
+*  makes the longer stage the shortest, each stage with at least one node.
+*
+* Parameters:
+*  1. const fx_chain_t *chain		- Address pointer of the chain struct.
+* Return:
+*  FX_CHAIN_NO_STAGE:				- Less than two active nodes, or one of them not measured yet.
+*  Index of the first node of stage 2 otherwise.
+*
+******************************************************************************/
+uint8_t fx_chain_partition(const fx_chain_t *chain)
+{
+	uint8_t active[FX_CHAIN_MAX_NODES];
+	const uint8_t count = serial_nodes(chain, 0, active);
+	if (count < 2)
+	{
+		return FX_CHAIN_NO_STAGE;
+	}
+
+	uint32_t total = 0;
+	for (uint8_t k = 0; k < count; ++k)
+	{
+		const uint32_t cycles = chain->nodes[active[k]].cycles;
+		if (cycles == 0)
+		{
+			return FX_CHAIN_NO_STAGE;
+		}
+		total += cycles;
+	}
+
+	// the longer stage only gets shorter while the head is the shorter one
+	uint8_t best = 1;
+	uint32_t best_cost = total;
+	uint32_t head = 0;
+	for (uint8_t k = 1; k < count; ++k)
+	{
+		head += chain->nodes[active[k - 1]].cycles;
+		const uint32_t cost = (head > total - head) ? head : total - head;
+		if (cost < best_cost)
+		{
+			best = k;
+			best_cost = cost;
+		}
+	}
+	return active[best];
+}
+
+/******************************************************************************
+* Function Name: fx_chain_balance
+*******************************************************************************
+* Summary:
+*  Move the cut of a pipelined chain to the balanced one (fx_chain_partition). A node that
+*  changes its stage skips or repeats one block, so the cut is only moved when that shortens the
+*  longer stage by more than 1/FX_BALANCE_MARGIN, or when a stage ran out of active nodes. Call
+*  from the main loop.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+* Return:
+*  true:							- The cut moved.
+*  false:							- Otherwise.
+*
+******************************************************************************/
+bool fx_chain_balance(fx_chain_t *chain)
+{
+	if (!chain->pipelined)
+	{
+		return false;
+	}
+	const uint8_t best = fx_chain_partition(chain);
+	const uint8_t stage = chain->stage;
+	if ((best == FX_CHAIN_NO_STAGE) || (best == stage))
+	{
+		return false;
+	}
+	// without a cut (FX_CHAIN_NO_STAGE) this is the whole chain
+	const uint32_t current = longer_stage(chain, stage);
+	const uint32_t balanced = longer_stage(chain, best);
+	if ((balanced + (balanced / FX_BALANCE_MARGIN)) >= current)
+	{
+		return false;
+	}
+	chain->stage = best;
+	return true;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_process_stage
+*******************************************************************************
+* Summary:
+*  Run the active nodes from node first on, one after the other: the second stage of a
+*  pipelined chain, for its host. The costs of the nodes are measured as in fx_chain_process.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct. No split.
+*  2. uint8_t first					- First node of the stage (chain->stage of the pipelined chain).
+*  3. sample_t *const in[]			- Input block of every channel.
+*  4. sample_t *const out[]			- Output block of every channel. Must not overlap with in.
+*  5. uint32_t n					- Samples per channel. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fx_chain_process_stage(fx_chain_t *chain, uint8_t first, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	uint8_t active[FX_CHAIN_MAX_NODES];
+	const uint8_t count = serial_nodes(chain, first, active);
+	run_serial(chain, active, count, in, out, n);
+}
+
+// append a node of a split, processed whatever its bypass state
+static uint8_t add_route(fx_chain_t *chain, uint8_t id, fx_node_kind kind, fx_mixer_t *mixer)
+{
+	if (chain->count >= FX_CHAIN_MAX_NODES)
+	{
+		return 255;
+	}
+
+	fx_node_t *node = &chain->nodes[chain->count];
+	node->process = NULL;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		node->ctx[ch] = (ch == 0) ? mixer : NULL;
+	}
+	node->id = id;
+	node->bypass = false;
+	node->activate = NULL;
+	node->deactivate = NULL;
+	node->active = true;
+	node->essential = true;
+	node->latency = NULL;
+	node->kind = kind;
+	node->factor = NULL;
+	node->stereo = NULL;
+	node->cycles = 0;
+	node->hold = 0;
+	node->spill = false;
+	node->asleep = false;
+	node->ringing = false;
+	node->quiet = 0;
+	chain->routed = true;
+
+	return chain->count++;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_add_split
+*******************************************************************************
+* Summary:
+*  Start parallel branches: the nodes added from here on run on the signal at the split, up to
+*  the next branch node (fx_chain_add_branch), the nodes after that on the same signal again.
+*  fx_chain_add_mix ends the last branch and sums all of them with the gains of the mixer.
+*  Bypassing every node of a branch makes it the dry signal.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node, e.g. the split's place in the chain.
+*  3. fx_mixer_t *mixer				- Initialized mixer (fx_mixer_init) of the branches.
+* Return:
+*  255:								- Chain is full, another split isn't mixed yet or mixer is NULL.
+*  Index of the node otherwise.
+*
+******************************************************************************/
+uint8_t fx_chain_add_split(fx_chain_t *chain, uint8_t id, fx_mixer_t *mixer)
+{
+	if ((mixer == NULL) || (chain->open != NULL))
+	{
+		return 255;
+	}
+	const uint8_t index = add_route(chain, id, FX_NODE_SPLIT, mixer);
+	if (index != 255)
+	{
+		chain->open = mixer;
+		mixer->inputs = 1;
+	}
+	return index;
+}
+
+// end a branch of the open split and start the next one. 255 without a split or with FX_MIXER_INPUTS branches already
+uint8_t fx_chain_add_branch(fx_chain_t *chain, uint8_t id)
+{
+	fx_mixer_t *mixer = chain->open;
+	if ((mixer == NULL) || (mixer->inputs >= FX_MIXER_INPUTS))
+	{
+		return 255;
+	}
+	const uint8_t index = add_route(chain, id, FX_NODE_BRANCH, mixer);
+	if (index != 255)
+	{
+		mixer->inputs++;
+	}
+	return index;
+}
+
+// end the last branch of the open split and continue with the sum. 255 without a split
+uint8_t fx_chain_add_mix(fx_chain_t *chain, uint8_t id)
+{
+	fx_mixer_t *mixer = chain->open;
+	if (mixer == NULL)
+	{
+		return 255;
+	}
+	const uint8_t index = add_route(chain, id, FX_NODE_MIX, mixer);
+	if (index != 255)
+	{
+		chain->open = NULL;
+	}
+	return index;
+}
+
+// all inputs start at the same gain, e.g. 1 / inputs for an equal sum
+void fx_mixer_init(fx_mixer_t *mixer, float32_t gain)
+{
+	for (uint8_t i = 0; i < FX_MIXER_INPUTS; ++i)
+	{
+		mixer->gain[i] = gain;
+		smooth_param_init(&mixer->gain_smooth[i], gain, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	}
+	mixer->inputs = 0;
+}
+
+// gain of a branch, the first one added at the split is input 0. 255 for an input the mixer doesn't have
+uint8_t fx_mixer_set_gain(fx_mixer_t *mixer, uint8_t input, float32_t gain)
+{
+	if (input >= FX_MIXER_INPUTS)
+	{
+		return 255;
+	}
+#if defined(SAMPLE_Q31)
+	// the q31 ramps are factors
+	gain = fminf(fmaxf(gain, 0.0f), 1.0f);
+#endif
+	mixer->gain[input] = gain;
+	return 0;
+}
+
+// call a lifecycle function with the context of every channel. shared mono nodes have one context
+static void deactivate_node(fx_node_t *node)
+{
+	if (node->deactivate != NULL)
+	{
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			if (node->ctx[ch] != NULL)
+				node->deactivate(node->ctx[ch]);
+		}
+	}
+	node->active = false;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_activate
+*******************************************************************************
+* Summary:
+*  Take the buffers of the nodes with the given id and clear their history. Nodes that are
+*  already active only clear their history. Only call while the nodes aren't processed
+*  (bypassed), clearing a delay line takes longer than a block.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+* Return:
+*  253:								- A node didn't get its buffers (arena exhausted). It stays inactive.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_chain_activate(fx_chain_t *chain, uint8_t id)
+{
+	uint8_t status = 0;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		fx_node_t *node = &chain->nodes[i];
+		if (node->id != id)
+			continue;
+		if (node->activate != NULL)
+		{
+			uint8_t failed = 0;
+			for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+			{
+				if ((node->ctx[ch] != NULL) && node->activate(node->ctx[ch]))
+					failed = 1;
+			}
+			if (failed)
+			{
+				// the channels that got their buffers give them back
+				deactivate_node(node);
+				status = 253;
+				continue;
+			}
+		}
+		node->active = true;
+	}
+	return status;
+}
+
+/******************************************************************************
+* Function Name: fx_chain_deactivate
+*******************************************************************************
+* Summary:
+*  Give the buffers of the nodes with the given id back. Only call while the nodes aren't
+*  processed (bypassed).
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Address pointer of the chain struct.
+*  2. uint8_t id					- Identifier of the node.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_chain_deactivate(fx_chain_t *chain, uint8_t id)
+{
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id == id) && chain->nodes[i].active)
+			deactivate_node(&chain->nodes[i]);
+	}
+}
+
+uint8_t fx_activate_delay(void *ctx)
+{
+	return delay_activate(ctx);
+}
+
+uint8_t fx_activate_chorus(void *ctx)
+{
+	return chorus_activate(ctx);
+}
+
+uint8_t fx_activate_flanger(void *ctx)
+{
+	return flanger_activate(ctx);
+}
+
+uint8_t fx_activate_pitch(void *ctx)
+{
+	return pitch_activate(ctx);
+}
+
+uint8_t fx_activate_reverb(void *ctx)
+{
+	return reverb_activate(ctx);
+}
+
+uint8_t fx_activate_denoise(void *ctx)
+{
+	return denoise_activate(ctx);
+}
+
+uint8_t fx_activate_freeze(void *ctx)
+{
+	return freeze_activate(ctx);
+}
+
+uint8_t fx_activate_pingpong(void *ctx)
+{
+	return pingpong_activate(ctx);
+}
+
+void fx_deactivate_delay(void *ctx)
+{
+	delay_deinit(ctx);
+}
+
+void fx_deactivate_chorus(void *ctx)
+{
+	chorus_deinit(ctx);
+}
+
+void fx_deactivate_flanger(void *ctx)
+{
+	flanger_deinit(ctx);
+}
+
+void fx_deactivate_pitch(void *ctx)
+{
+	pitch_deinit(ctx);
+}
+
+void fx_deactivate_reverb(void *ctx)
+{
+	reverb_deinit(ctx);
+}
+
+void fx_deactivate_denoise(void *ctx)
+{
+	denoise_deinit(ctx);
+}
+
+void fx_deactivate_freeze(void *ctx)
+{
+	freeze_deinit(ctx);
+}
+
+void fx_deactivate_pingpong(void *ctx)
+{
+	pingpong_deinit(ctx);
+}
+
+uint32_t fx_latency_filter(void *ctx, uint32_t n)
+{
+	(void)ctx;
+	(void)n;
+	return fir_filter_latency();
+}
+
+uint32_t fx_latency_overdrive(void *ctx, uint32_t n)
+{
+	(void)n;
+	return oversampler_latency(&((overdrive_handle_t *)ctx)->oversampler);
+}
+
+uint32_t fx_latency_fuzz(void *ctx, uint32_t n)
+{
+	(void)n;
+	return oversampler_latency(&((fuzz_handle_t *)ctx)->oversampler);
+}
+
+uint32_t fx_latency_fxloop(void *ctx, uint32_t n)
+{
+	return fxloop_latency(ctx, n);
+}
+
+uint32_t fx_latency_cab(void *ctx, uint32_t n)
+{
+	return cab_latency(ctx, n);
+}
+
+uint32_t fx_latency_amp(void *ctx, uint32_t n)
+{
+	(void)n;
+	return amp_latency(ctx);
+}
+
+uint32_t fx_latency_denoise(void *ctx, uint32_t n)
+{
+	(void)n;
+	return denoise_latency(ctx);
+}
+
+uint32_t fx_latency_freeze(void *ctx, uint32_t n)
+{
+	(void)n;
+	return freeze_latency(ctx);
+}
+
+ITCM_CODE void fx_factor_tremolo(void *ctx, float32_t *factor, uint32_t n)
+{
+	tremolo_factor(ctx, factor, n);
+}
+
+ITCM_CODE void fx_factor_ring_mod(void *ctx, float32_t *factor, uint32_t n)
+{
+	ring_mod_factor(ctx, factor, n);
+}
+
+// ---- transitions ----
+
+/******************************************************************************
+* Function Name: fx_transition_init
+*******************************************************************************
+* Summary:
+*  Start with the given node solo, no transition running.
+*
+* Parameters:
+*  1. fx_transition_t *t			- Address pointer of the transition struct.
+*  2. fx_chain_t *chain				- Chain the transitions switch.
+*  3. uint8_t id					- Identifier of the solo node.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_transition_init(fx_transition_t *t, fx_chain_t *chain, uint8_t id)
+{
+	t->request = id;
+	t->crossfade = false;
+	t->from = id;
+	t->to = id;
+	t->parallel = false;
+	t->solo = id;
+	t->position = 0;
+	t->length = 0;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		t->compensation[ch].buffer = NULL;
+	}
+	t->hold = 0;
+	t->latency = 0;
+	fx_chain_solo(chain, id);
+}
+
+// true if the tail of a node with the given id spills over a transition
+static bool spills(const fx_chain_t *chain, uint8_t id)
+{
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id == id) && chain->nodes[i].spill)
+			return true;
+	}
+	return false;
+}
+
+// true if a node with the given id still rings after it was switched off
+static bool ringing(const fx_chain_t *chain, uint8_t id)
+{
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id == id) && chain->nodes[i].ringing)
+			return true;
+	}
+	return false;
+}
+
+// let the tails of the nodes with the given id ring on (true) or process them as the solo node again (false)
+static void set_ringing(fx_chain_t *chain, uint8_t id, bool ring)
+{
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		fx_node_t *node = &chain->nodes[i];
+		if ((node->id == id) && node->spill && node->active)
+		{
+			node->quiet = 0;
+			node->ringing = ring;
+		}
+	}
+}
+
+// true if a node with the given id declares a latency
+static bool declares_latency(const fx_chain_t *chain, uint8_t id)
+{
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id == id) && (chain->nodes[i].latency != NULL))
+			return true;
+	}
+	return false;
+}
+
+// give the compensation lines back
+static void give_compensation(fx_transition_t *t)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		if (t->compensation[ch].buffer != NULL)
+		{
+			arena_free(t->compensation[ch].buffer);
+			t->compensation[ch].buffer = NULL;
+		}
+	}
+}
+
+// take and clear a compensation line per channel, with the delay lines or in the AXI SRAM. 253 if neither has room
+static uint8_t take_compensation(fx_transition_t *t)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		if (t->compensation[ch].buffer != NULL)
+			continue;
+		float32_t *buffer = arena_alloc(ARENA_AHB, FX_COMPENSATION_SIZE * sizeof(float32_t));
+		if (buffer == NULL)
+			buffer = arena_alloc(ARENA_AXI, FX_COMPENSATION_SIZE * sizeof(float32_t));
+		if ((buffer == NULL) || delay_line_init(&t->compensation[ch], buffer, FX_COMPENSATION_SIZE))
+		{
+			if (buffer != NULL)
+				arena_free(buffer);
+			t->compensation[ch].buffer = NULL;
+			give_compensation(t);
+			return 253;
+		}
+	}
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fx_transition_request
+*******************************************************************************
+* Summary:
+*  Request a switch to another solo node. The node is activated here, unless the running
+*  transition still processes it (e.g. switching back halfway through) or its tail still
+*  rings. A crossfade with a
+*  node that declares a latency takes the compensation lines, without them it runs as a dip.
+*  Call from the main loop only, taking and clearing the buffers isn't real time safe.
+*
+* Parameters:
+*  1. fx_transition_t *t			- Address pointer of an initialized transition struct.
+*  2. fx_chain_t *chain				- Chain the transitions switch.
+*  3. uint8_t id					- Identifier of the new solo node.
+*  4. bool crossfade				- true: run both nodes in parallel and crossfade, false: fade out, then in.
+* Return:
+*  253:								- The node didn't get its buffers, the request is dropped.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t fx_transition_request(fx_transition_t *t, fx_chain_t *chain, uint8_t id, bool crossfade)
+{
+	// the audio interrupt only switches on the requested node, it can't start processing this one in the meantime. a
+	// node still ringing holds its buffers and continues its tail
+	if ((id != t->from) && (id != t->to) && !ringing(chain, id) && fx_chain_activate(chain, id))
+	{
+		return 253;
+	}
+	if (crossfade && (declares_latency(chain, id) || declares_latency(chain, t->to)) && take_compensation(t))
+	{
+		crossfade = false;
+	}
+	t->crossfade = crossfade;
+	// the buffers have to be complete before the interrupt can see the request
+	__DMB();
+	t->request = id;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fx_transition_reclaim
+*******************************************************************************
+* Summary:
+*  Deactivate every node except the solo node, once no transition runs or is pending, so
+*  their buffers can be taken by the next node, and give the compensation lines back unless the
+*  solo node holds its delay through them. Nodes whose tail still rings are deactivated by a
+*  later call, once it decayed. Call from the main loop only.
+*
+* Parameters:
+*  1. fx_transition_t *t			- Address pointer of an initialized transition struct.
+*  2. fx_chain_t *chain				- Chain the transitions switch.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_transition_reclaim(fx_transition_t *t, fx_chain_t *chain)
+{
+	// request is only written by the main loop: with the request taken over and the transition
+	// finished, the audio interrupt keeps processing the solo node alone
+	const uint8_t id = t->request;
+	if ((t->to != id) || (t->length != 0))
+	{
+		return;
+	}
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		if ((chain->nodes[i].id != id) && chain->nodes[i].active && !chain->nodes[i].ringing)
+			deactivate_node(&chain->nodes[i]);
+	}
+	// the hold only changes in a transition, which needs a new request first
+	if (t->hold == 0)
+		give_compensation(t);
+}
+
+// run the chain with one node solo. switching the bypass states only costs a pass over the nodes
+#pragma optimize_for_speed
+ITCM_CODE static void process_solo(fx_transition_t *t, fx_chain_t *chain, uint8_t id, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	if (t->solo != id)
+	{
+		fx_chain_solo(chain, id);
+		t->solo = id;
+	}
+	fx_chain_process(chain, in, out, n);
+}
+
+// latency of one node solo, as fx_chain_process adds it up
+#pragma optimize_for_speed
+ITCM_CODE static uint32_t solo_latency(const fx_chain_t *chain, uint8_t id, uint32_t n)
+{
+	uint32_t latency = 0;
+	const bool shed = chain->shed;
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		const fx_node_t *node = &chain->nodes[i];
+		if ((node->id == id) && (node->latency != NULL) && (node->essential || !shed))
+			latency += node->latency(node->ctx[0], n);
+	}
+	return latency;
+}
+
+// delay a block of every channel through the compensation lines, by at most FX_COMPENSATION_MAX samples
+#pragma optimize_for_speed
+ITCM_CODE static void compensate(fx_transition_t *t, sample_t *const block[AUDIO_CHANNELS], uint32_t delay, uint32_t n)
+{
+	if ((delay == 0) || (t->compensation[0].buffer == NULL))
+	{
+		return;
+	}
+	delay = (delay < FX_COMPENSATION_MAX) ? delay : FX_COMPENSATION_MAX;
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		delay_line_write_q31(&t->compensation[ch], block[ch], n);
+		delay_line_read_q31(&t->compensation[ch], block[ch], delay, n);
+#else
+		delay_line_write(&t->compensation[ch], block[ch], n);
+		delay_line_read(&t->compensation[ch], block[ch], delay, n);
+#endif
+	}
+}
+
+// apply a gain ramp to a block of every channel
+#pragma optimize_for_speed
+ITCM_CODE static void scale(const smooth_param_t *gain, sample_t *const block[AUDIO_CHANNELS], uint32_t n)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+#if defined(SAMPLE_Q31)
+		smooth_param_scale_q31(gain, block[ch], block[ch], n);
+#else
+		smooth_param_scale(gain, block[ch], block[ch], n);
+#endif
+	}
+}
+
+// run one node of a transition solo with a gain ramp. the incoming branch of a crossfade is delayed to line up with
+// the outgoing one, that lags by lag, the outgoing node of a dip keeps its hold. a node whose tail spills gets the ramp
+// on its input, so the tail it holds isn't faded with the signal
+#pragma optimize_for_speed
+ITCM_CODE static void process_faded(fx_transition_t *t, fx_chain_t *chain, uint8_t id, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], const smooth_param_t *gain, uint32_t lag, uint32_t hold, uint32_t n)
+{
+	if (!spills(chain, id))
+	{
+		process_solo(t, chain, id, in, out, n);
+		compensate(t, out, hold + ((lag > chain->latency) ? lag - chain->latency : 0), n);
+		scale(gain, out, n);
+		return;
+	}
+	const scratch_mark_t mark = scratch_pool_mark();
+	sample_t *faded[AUDIO_CHANNELS];
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		faded[ch] = scratch_pool_alloc(n * sizeof(sample_t));
+#if defined(SAMPLE_Q31)
+		smooth_param_scale_q31(gain, in[ch], faded[ch], n);
+#else
+		smooth_param_scale(gain, in[ch], faded[ch], n);
+#endif
+	}
+	process_solo(t, chain, id, faded, out, n);
+	compensate(t, out, hold + ((lag > chain->latency) ? lag - chain->latency : 0), n);
+	scratch_pool_release(mark);
+}
+
+// add the tails of the nodes a transition switched off to the output. each runs on silence until its output was
+// silent for its hold, then reclaim gives its buffers back
+#pragma optimize_for_speed
+ITCM_CODE static void ring_tails(fx_chain_t *chain, sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	const sample_t *const silent[AUDIO_CHANNELS] = {
+		silence,
+#if (AUDIO_CHANNELS == 2)
+		silence
+#endif
+	};
+	for (uint8_t i = 0; i < chain->count; ++i)
+	{
+		fx_node_t *node = &chain->nodes[i];
+		if (!node->ringing)
+			continue;
+		if (!node->essential && chain->shed)
+		{
+			node->ringing = false;
+			continue;
+		}
+		const scratch_mark_t mark = scratch_pool_mark();
+		sample_t *tail[AUDIO_CHANNELS];
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			tail[ch] = scratch_pool_alloc(n * sizeof(sample_t));
+		}
+		TRACE_EVENT(TRACE_NODE_START + node->id);
+		run_node(node, silent, tail, n);
+		TRACE_EVENT(TRACE_NODE_END + node->id);
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+#if defined(SAMPLE_Q31)
+			arm_add_q31(out[ch], tail[ch], out[ch], n);
+#else
+			arm_add_f32(out[ch], tail[ch], out[ch], n);
+#endif
+		}
+		if (quiet_block(node, (const sample_t *const *)tail, n))
+			node->ringing = false;
+		scratch_pool_release(mark);
+	}
+}
+
+/******************************************************************************
+* Function Name: fx_transition_process
+*******************************************************************************
+* Summary:
+*  Process one block of the chain. Without a transition, this is fx_chain_process with the solo
+*  node. A requested node starts a transition:
+*  - crossfade: both nodes run, the outgoing one is faded with cos, the incoming one with sin
+*    (equal power). The curves are linear in between the block boundaries, one ramp per block.
+*    An incoming node that lags less is delayed to line up with the outgoing one and keeps that
+*    delay until the next switch, a crossfade to one that lags more or away from a delayed one
+*    runs as a dip.
+*  - dip: the outgoing node fades out over the first half, the incoming node fades in over the
+*    second half, without the delay of the outgoing one. Only one node runs per block, same
+*    load as without a transition.
+*  A node whose tail spills (fx_chain_set_tail) is faded at its input. Switched off, its tail
+*  rings on in parallel to the solo node and is added to the output until it decayed.
+*
+* Parameters:
+*  1. fx_transition_t *t			- Address pointer of an initialized transition struct.
+*  2. fx_chain_t *chain				- Chain the transitions switch.
+*  3. sample_t *const in[]			- Input block of every channel.
+*  4. sample_t *const out[]			- Output block of every channel. Must not overlap with in.
+*  5. uint32_t n					- Samples per channel. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void fx_transition_process(fx_transition_t *t, fx_chain_t *chain, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n)
+{
+	if (t->length == 0)
+	{
+		const uint8_t request = t->request;
+		if (request == t->to)
+		{
+			process_solo(t, chain, request, in, out, n);
+			compensate(t, out, t->hold, n);
+			t->latency = chain->latency + t->hold;
+			ring_tails(chain, out, n);
+			return;
+		}
+		// a node switched on again while it rings continues its tail as the incoming node
+		set_ringing(chain, request, false);
+		// the first block of a transition: whole blocks, and an even number of them for a dip. a held node shares the
+		// compensation lines with no other branch
+		t->parallel = t->crossfade && (t->hold == 0) && (solo_latency(chain, request, n) <= solo_latency(chain, t->to, n));
+		const uint32_t unit = t->parallel ? n : 2 * n;
+		t->from = t->to;
+		t->to = request;
+		t->position = 0;
+		t->length = ((((sample_rate * FX_TRANSITION_MS) / 1000) + unit - 1) / unit) * unit;
+	}
+
+	const float32_t start = (float32_t)t->position / t->length;
+	const float32_t end = fminf((float32_t)(t->position + n) / t->length, 1.0f);
+	smooth_param_t gain = { 0 };
+
+	if (t->parallel)
+	{
+		sample_t *const faded[AUDIO_CHANNELS] = {
+			faded_out[0],
+#if (AUDIO_CHANNELS == 2)
+			faded_out[1]
+#endif
+		};
+		gain.start = arm_cos_f32(0.5f * PI * start);
+		gain.end = arm_cos_f32(0.5f * PI * end);
+		process_faded(t, chain, t->from, in, faded, &gain, 0, 0, n);
+		const uint32_t latency = chain->latency;
+		// the incoming branch starts at zero gain while the line fills
+		gain.start = arm_sin_f32(0.5f * PI * start);
+		gain.end = arm_sin_f32(0.5f * PI * end);
+		process_faded(t, chain, t->to, in, out, &gain, latency, 0, n);
+		t->latency = latency;
+		// the incoming node stays lined up after the crossfade, as compensate delayed it
+		if ((t->position + n >= t->length) && (t->compensation[0].buffer != NULL) && (latency > chain->latency))
+			t->hold = ((latency - chain->latency) < FX_COMPENSATION_MAX) ? latency - chain->latency : FX_COMPENSATION_MAX;
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+#if defined(SAMPLE_Q31)
+			arm_add_q31(out[ch], faded[ch], out[ch], n);
+#else
+			arm_add_f32(out[ch], faded[ch], out[ch], n);
+#endif
+		}
+	}
+	else if (start < 0.5f)
+	{
+		gain.start = 1.0f - 2.0f * start;
+		gain.end = fmaxf(1.0f - 2.0f * end, 0.0f);
+		process_faded(t, chain, t->from, in, out, &gain, 0, t->hold, n);
+		t->latency = chain->latency + t->hold;
+	}
+	else
+	{
+		// the outgoing node faded out, its tail rings on from the first block of the second half. its delay is
+		// dropped in the silence
+		if (t->position == t->length / 2)
+		{
+			set_ringing(chain, t->from, true);
+			t->hold = 0;
+		}
+		gain.start = 2.0f * start - 1.0f;
+		gain.end = 2.0f * end - 1.0f;
+		process_faded(t, chain, t->to, in, out, &gain, 0, 0, n);
+		t->latency = chain->latency;
+	}
+	ring_tails(chain, out, n);
+
+	t->position += n;
+	if (t->position >= t->length)
+	{
+		// ringing before the transition ends: reclaim must not see the outgoing node without it
+		if (t->parallel)
+			set_ringing(chain, t->from, true);
+		t->length = 0;
+		t->from = t->to;
+	}
+}
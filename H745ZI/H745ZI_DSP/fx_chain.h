@@ -0,0 +1,344 @@
+// fx_chain.h, Michael Haselberger
+// Description: This file contains declarations for the serial effect chain scheduler implemented in fx_chain.c
+
+#ifndef __FX_CHAIN_H__
+#define __FX_CHAIN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+#include "fx_lib.h"
+#include "delay_line.h"
+#include "smooth_param.h"
+
+// maximum number of nodes in one chain. build_chain (main.c) adds one per effect
+#ifndef FX_CHAIN_MAX_NODES
+#define FX_CHAIN_MAX_NODES (24)
+#endif
+// element-wise stages of the chain built by build_chain (main.c) in q15 (fx_chain_set_q15)
+#ifndef FX_CHAIN_Q15
+#define FX_CHAIN_Q15 (false)
+#endif
+// chunk lengths of the nodes built by build_chain (main.c) that may split a block (fx_chain_set_chunk), 0: the whole
+// block. e.g. 32 keeps the FIR filter at one length from 16 to 256 sample blocks
+#ifndef FX_CHUNK_FILTER
+#define FX_CHUNK_FILTER (0)
+#endif
+#ifndef FX_CHUNK_DISTORTION
+#define FX_CHUNK_DISTORTION (0)
+#endif
+// fx_chain_t.stage of a chain that runs in one stage
+#define FX_CHAIN_NO_STAGE (255)
+// weight of the newest block in the measured node costs: 2^-FX_COST_SHIFT
+#define FX_COST_SHIFT (4)
+// fx_chain_balance moves the stage boundary when that shortens the longer stage by more than 1/FX_BALANCE_MARGIN
+#define FX_BALANCE_MARGIN (8)
+
+// uniform processing interface of a chain node. in and out never point to the same buffer.
+// sample_t is q31_t with SAMPLE_Q31, float32_t otherwise (defines_and_constants.h)
+typedef void (*fx_process_t)(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+// lifecycle of a node with large buffers. activate takes the buffers (arena.h) and clears the history (delay lines, reverb
+// tail), so the node doesn't replay old signal when it is switched on. 0 on success. deactivate gives the buffers back
+typedef uint8_t (*fx_activate_t)(void *ctx);
+typedef void (*fx_deactivate_t)(void *ctx);
+// latency a node declares: samples its output lags its input at block size n (linear phase filters, oversampling, the
+// round trip of the effects loop). may follow the parameters, it's asked with every block. nodes without are 0
+typedef uint32_t (*fx_latency_t)(void *ctx, uint32_t n);
+// element-wise node: writes the gain every sample of the next block is multiplied by, in [-1, 1], and advances the node
+// as process would. consecutive element-wise nodes are fused into one pass over the signal (fx_chain_process)
+typedef void (*fx_factor_t)(void *ctx, float32_t *factor, uint32_t n);
+// node that processes both channels in one call (fx_chain_set_stereo), e.g. effects whose channels feed into each other.
+// ctx is the context of the first channel
+typedef void (*fx_stereo_t)(void *ctx, const sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n);
+// host of the second pipeline stage (fx_chain_set_pipeline): takes the stage 1 output of the current block and returns
+// the stage 2 output of the previous block in out. 0 on success, 1 if the stage missed its deadline (out is silence)
+typedef uint8_t (*fx_stage_host_t)(void *ctx, const sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n);
+
+// length of a transition between two solo nodes (fx_transition_process) at the running sample rate, rounded up to
+// whole blocks
+#ifndef FX_TRANSITION_MS
+#define FX_TRANSITION_MS (20)
+#endif
+// compensation line of a crossfade per channel, power of two. holds the longest latency difference (the effects loop
+// with DMA_BLOCKS blocks of MAX_BLOCK_SIZE and FXLOOP_MAX_LATENCY) plus one block
+#define FX_COMPENSATION_SIZE (2048)
+#define FX_COMPENSATION_MAX (FX_COMPENSATION_SIZE - MAX_BLOCK_SIZE)
+// inputs of a mixer node: parallel branches of one split
+#define FX_MIXER_INPUTS (4)
+// block peak below which a block counts as silent for the nodes that sleep (fx_chain_set_tail): -80 dBFS, under the
+// noise floor of the codec input
+#ifndef FX_SILENCE_LEVEL
+#define FX_SILENCE_LEVEL (1.0e-4f)
+#endif
+
+// what a node does. a split, its branches and its mix are processed whatever their bypass state
+typedef enum
+{
+	// runs process on the signal
+	FX_NODE_EFFECT = 0,
+	// keeps the signal as the input of every branch, the first branch starts
+	FX_NODE_SPLIT,
+	// ends a branch (its output goes into the mixer) and starts the next one on the kept signal
+	FX_NODE_BRANCH,
+	// ends the last branch and continues with the weighted sum of all branches
+	FX_NODE_MIX
+} fx_node_kind;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Mixer of parallel branches (fx_chain_add_split). Every branch output is scaled by the ramp of its gain and added to the
+*   sum, one vector scale and one vector add per input and channel. An empty branch is the dry signal, so an effect in a
+*   branch can run at full wet (mix 1) and skip its own dry path.
+*
+*   Members:
+*   gain:               Target gain of every input, written by fx_mixer_set_gain. [0, 1] with SAMPLE_Q31.
+*   gain_smooth:        The gains as heard, one ramp per block.
+*   inputs:             Number of branches, counted while the chain is built.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile float32_t gain[FX_MIXER_INPUTS];
+	smooth_param_t gain_smooth[FX_MIXER_INPUTS];
+	uint8_t inputs;
+} fx_mixer_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Serial effect chain (pedalboard). The nodes are processed in the order they were added, every node reads the output of
+*   the previous active node. Intermediate results alternate between two scratch buffers per channel, so no block is ever
+*   copied between effects, and a bypassed node is skipped completely (no processing, no copy).
+*   A split (fx_chain_add_split) runs the nodes up to each branch node in parallel on the same signal, the mix node sums
+*   them (fx_mixer_t). Splits don't nest. The signal at the split is copied once, the rest stays in the scratch buffers.
+*   Pipeline (fx_chain_set_pipeline): a serial chain is cut into two stages at node stage. While stage 1 processes block n,
+*   stage 2 processes its output of block n - 1, so a host on the other core (fx_stage_host_t) can run stage 2 in
+*   parallel, at the cost of exactly one block of latency. fx_chain_balance picks the cut from the measured node costs,
+*   so both stages take about the same time. Without a host, the chain runs stage 2 itself one block late, the latency
+*   is the same whichever core runs it.
+*
+*   Members:
+*   process:            Processing function of the node.
+*   ctx:                Context passed to process, one per channel (e.g. the effect handle of that channel).
+*                       A node with ctx[1] == NULL is a shared mono node: with AUDIO_CHANNELS 2 it gets the sum of
+*                       both channels and its output is sent to both channels (used for the reverb).
+*   id:                 Free to use by the application, e.g. the fx_designator of the effect.
+*   bypass:             When true, the node is skipped.
+*   activate:           Takes the buffers of the node and clears its history (fx_chain_activate). NULL for nodes
+*                       without buffers.
+*   deactivate:         Gives the buffers of the node back (fx_chain_deactivate). NULL for nodes without buffers.
+*   active:             The node holds its buffers and may be switched on.
+*   essential:          The node is processed while the chain sheds load (fx_chain_shed). true by default.
+*   latency:            Latency the node declares (fx_chain_set_latency), NULL for none. Asked with the context of the
+*                       first channel, the channels share their parameters.
+*   kind:               fx_node_kind. ctx[0] of a split, branch and mix node is the fx_mixer_t.
+*   factor:             Gain function of an element-wise node (fx_chain_set_factor), NULL for others. Runs of
+*                       consecutive active element-wise nodes multiply their gains and touch the signal once.
+*   stereo:             Called instead of process with the blocks of both channels (fx_chain_set_stereo), NULL for
+*                       nodes that process each channel on its own. Not used with AUDIO_CHANNELS 1.
+*   cycles:             Measured cost of the node in CPU cycles per block, smoothed over the blocks it ran
+*                       (FX_COST_SHIFT). A fused stage is shared evenly by its nodes. 0 until the node ran once.
+*   hold:               Samples the input and the output of the node have to stay silent (FX_SILENCE_LEVEL) before
+*                       it sleeps, the longest gap in its tail (fx_chain_set_tail). 0: the node never sleeps.
+*   spill:              The tail of the node rings on when a transition switches it off, until it was silent for
+*                       hold samples (fx_transition_process).
+*   asleep:             The node is skipped while its input stays silent. Woken by the first block that isn't.
+*   ringing:            Switched off by a transition, the node runs on silence and its tail is added to the output.
+*   quiet:              Samples the node has been silent so far.
+*   chunk:              Samples per call of process (fx_chain_set_chunk), 0: the whole block.
+*   count:              Number of nodes in the chain.
+*   shed:               Nodes that aren't essential are skipped like bypassed ones, their bypass states are kept.
+*   latency:            Sum of the latencies of the nodes processed with the last block, the longest branch of a split.
+*   routed:             The chain has a split: processed with the branch buffers.
+*   open:               Mixer of the split being built, NULL once it is mixed.
+*   q15:                Element-wise stages run in q15 (fx_chain_set_q15), a single element-wise node as well.
+*   pipelined:          The chain runs in two stages (fx_chain_set_pipeline).
+*   stage:              First node of the second stage, FX_CHAIN_NO_STAGE until fx_chain_balance picked one.
+*   host:               Host of the second stage, NULL: the chain runs it itself. host_ctx is passed to it.
+*   stage_misses:       Blocks the host of the second stage didn't deliver in time.
+*   pipe:               Stage 1 output of the current and of the previous block, alternating (FX_CHAIN_PIPELINE only).
+*   pipe_index:         Half of pipe stage 1 writes next.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	fx_process_t process;
+	void *ctx[AUDIO_CHANNELS];
+	uint8_t id;
+	volatile bool bypass;
+	fx_activate_t activate;
+	fx_deactivate_t deactivate;
+	bool active;
+	bool essential;
+	fx_latency_t latency;
+	uint8_t kind;
+	fx_factor_t factor;
+	fx_stereo_t stereo;
+	uint32_t cycles;
+	uint32_t hold;
+	bool spill;
+	volatile bool asleep;
+	volatile bool ringing;
+	uint32_t quiet;
+	uint16_t chunk;
+} fx_node_t;
+
+typedef struct
+{
+	fx_node_t nodes[FX_CHAIN_MAX_NODES];
+	uint8_t count;
+	volatile bool shed;
+	volatile uint32_t latency;
+	bool routed;
+	fx_mixer_t *open;
+	bool q15;
+	bool pipelined;
+	volatile uint8_t stage;
+	fx_stage_host_t host;
+	void *host_ctx;
+	uint32_t stage_misses;
+#if defined(FX_CHAIN_PIPELINE)
+	sample_t pipe[2][AUDIO_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+	uint8_t pipe_index;
+#endif
+} fx_chain_t;
+
+void fx_chain_init(fx_chain_t *chain);
+uint8_t fx_chain_add(fx_chain_t *chain, uint8_t id, fx_process_t process, void *const ctx[AUDIO_CHANNELS]);
+uint8_t fx_chain_set_bypass(fx_chain_t *chain, uint8_t id, bool bypass);
+void fx_chain_solo(fx_chain_t *chain, uint8_t id);
+uint8_t fx_chain_set_essential(fx_chain_t *chain, uint8_t id, bool essential);
+void fx_chain_shed(fx_chain_t *chain, bool shed);
+void fx_chain_process(fx_chain_t *chain, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n);
+uint8_t fx_chain_set_lifecycle(fx_chain_t *chain, uint8_t id, fx_activate_t activate, fx_deactivate_t deactivate);
+uint8_t fx_chain_set_latency(fx_chain_t *chain, uint8_t id, fx_latency_t latency);
+uint8_t fx_chain_set_factor(fx_chain_t *chain, uint8_t id, fx_factor_t factor);
+uint8_t fx_chain_set_stereo(fx_chain_t *chain, uint8_t id, fx_stereo_t stereo);
+uint8_t fx_chain_set_tail(fx_chain_t *chain, uint8_t id, uint32_t hold, bool spill);
+uint8_t fx_chain_set_chunk(fx_chain_t *chain, uint8_t id, uint16_t chunk);
+void fx_chain_set_q15(fx_chain_t *chain, bool q15);
+uint8_t fx_chain_set_pipeline(fx_chain_t *chain, bool pipelined, fx_stage_host_t host, void *ctx);
+uint8_t fx_chain_partition(const fx_chain_t *chain);
+bool fx_chain_balance(fx_chain_t *chain);
+void fx_chain_process_stage(fx_chain_t *chain, uint8_t first, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n);
+uint8_t fx_chain_add_split(fx_chain_t *chain, uint8_t id, fx_mixer_t *mixer);
+uint8_t fx_chain_add_branch(fx_chain_t *chain, uint8_t id);
+uint8_t fx_chain_add_mix(fx_chain_t *chain, uint8_t id);
+void fx_mixer_init(fx_mixer_t *mixer, float32_t gain);
+uint8_t fx_mixer_set_gain(fx_mixer_t *mixer, uint8_t input, float32_t gain);
+uint8_t fx_chain_activate(fx_chain_t *chain, uint8_t id);
+void fx_chain_deactivate(fx_chain_t *chain, uint8_t id);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Transition between two solo nodes (effect switch). Instead of switching the bypass states from one block to the next,
+*   the outgoing and the incoming node run in parallel and are crossfaded with equal power over FX_TRANSITION_MS.
+*   When both nodes together don't fit into the block budget, the outgoing node is faded out and the incoming node faded
+*   in afterwards (dip), so only one of them runs per block. The incoming node is activated before it is switched on,
+*   nodes that aren't part of a transition anymore are deactivated by fx_transition_reclaim.
+*   The two branches of a crossfade are summed: if the incoming node lags less than the outgoing one (a linear phase
+*   filter, oversampling), the incoming branch is delayed by the difference of their latencies, otherwise they would
+*   comb. It starts at zero gain, so the empty line isn't heard. The incoming node keeps that delay after the crossfade
+*   (hold), dropping it would jump the output back by the difference. The next switch away from it runs as a dip, the
+*   delay is dropped at its silent middle. A crossfade to a node that lags more runs as a dip as well: delaying the
+*   outgoing branch would cut a gap into what is playing. The compensation lines are taken from the arenas for
+*   crossfades with a node that declares a latency and given back with the nodes, once no node is held.
+*   A node with a tail that spills (fx_chain_set_tail, the delays and the reverb) is faded at its input instead, the
+*   tail it already holds sounds on. Switched off, it keeps running on silence with its tail added to the output until
+*   the tail decayed, and only then is given back. Switched on again while it rings, it continues the tail.
+*
+*   Members:
+*   request:            Node requested by the main loop (fx_transition_request). Taken over when no transition runs.
+*   crossfade:          Crossfade (true) or dip (false) for the requested node, decided by the main loop.
+*   from:               Outgoing node of the running transition.
+*   to:                 Incoming node of the running transition, the solo node when no transition runs.
+*   parallel:           Crossfade of the running transition.
+*   solo:               Node the bypass states of the chain are set for.
+*   position:           Samples of the running transition processed.
+*   length:             Samples of the running transition, 0 = none running. Read by fx_transition_reclaim.
+*   compensation:       Compensation line of every channel, its memory is NULL while none is held.
+*   hold:               Delay through the compensation lines the solo node keeps after a crossfade, 0 = none. Read by
+*                       fx_transition_reclaim.
+*   latency:            Latency of the chain output with the last block: the solo node with its hold, the later branch
+*                       of a crossfade or the node a dip runs. Read by the main loop for the reports.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile uint8_t request;
+	volatile bool crossfade;
+	volatile uint8_t from;
+	volatile uint8_t to;
+	bool parallel;
+	uint8_t solo;
+	uint32_t position;
+	volatile uint32_t length;
+	delay_line_t compensation[AUDIO_CHANNELS];
+	volatile uint32_t hold;
+	volatile uint32_t latency;
+} fx_transition_t;
+
+void fx_transition_init(fx_transition_t *t, fx_chain_t *chain, uint8_t id);
+uint8_t fx_transition_request(fx_transition_t *t, fx_chain_t *chain, uint8_t id, bool crossfade);
+void fx_transition_reclaim(fx_transition_t *t, fx_chain_t *chain);
+void fx_transition_process(fx_transition_t *t, fx_chain_t *chain, sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n);
+
+// adapters from the fx_lib handles to the node interface. ctx is the effect handle (filter: channel index).
+// with SAMPLE_Q31 delay, filter and overdrive run q31 kernels, the other effects are converted around their float kernel
+void fx_process_delay(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_overdrive(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_fuzz(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_tremolo(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_ring_mod(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_filter(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_eq(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_cab(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_gate(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_comp(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_pitch(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_wah(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_phaser(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_amp(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_fxloop(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_denoise(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_freeze(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_chorus(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_flanger(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_reverb(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+void fx_process_pingpong(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+// adapters of the nodes that process both channels in one call, ctx is the effect handle
+void fx_stereo_pingpong(void *ctx, const sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint32_t n);
+// lifecycle adapters, ctx is the effect handle
+uint8_t fx_activate_delay(void *ctx);
+uint8_t fx_activate_chorus(void *ctx);
+uint8_t fx_activate_flanger(void *ctx);
+uint8_t fx_activate_pitch(void *ctx);
+uint8_t fx_activate_reverb(void *ctx);
+uint8_t fx_activate_denoise(void *ctx);
+uint8_t fx_activate_freeze(void *ctx);
+uint8_t fx_activate_pingpong(void *ctx);
+void fx_deactivate_delay(void *ctx);
+void fx_deactivate_chorus(void *ctx);
+void fx_deactivate_flanger(void *ctx);
+void fx_deactivate_pitch(void *ctx);
+void fx_deactivate_reverb(void *ctx);
+void fx_deactivate_denoise(void *ctx);
+void fx_deactivate_freeze(void *ctx);
+void fx_deactivate_pingpong(void *ctx);
+// latency adapters, ctx is the effect handle (filter: channel index)
+uint32_t fx_latency_filter(void *ctx, uint32_t n);
+uint32_t fx_latency_overdrive(void *ctx, uint32_t n);
+uint32_t fx_latency_fuzz(void *ctx, uint32_t n);
+uint32_t fx_latency_fxloop(void *ctx, uint32_t n);
+uint32_t fx_latency_cab(void *ctx, uint32_t n);
+uint32_t fx_latency_amp(void *ctx, uint32_t n);
+uint32_t fx_latency_denoise(void *ctx, uint32_t n);
+uint32_t fx_latency_freeze(void *ctx, uint32_t n);
+// factor adapters of the element-wise effects, ctx is the effect handle
+void fx_factor_tremolo(void *ctx, float32_t *factor, uint32_t n);
+void fx_factor_ring_mod(void *ctx, float32_t *factor, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __FX_CHAIN_H__
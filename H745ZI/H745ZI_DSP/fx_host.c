@@ -0,0 +1,257 @@
+// fx_host.c, Michael Haselberger
+// Description: Desktop build of the effect chain (HOST_BUILD, see fx_host.h). Builds the chain of the pedal with its
+// start-up parameters (fx_setup.c) and runs it on blocks cut from the buffers of a plugin host.
+
+#include "fx_host.h"
+
+#if defined(HOST_BUILD)
+
+#include <string.h>
+#include "fx_setup.h"
+#include "envelope.h"
+
+// see main.c: the time computations of the DSP modules read the rate the effects were initialized for
+uint32_t sample_rate = AUDIO_SAMPLE_RATE;
+
+// input envelope of the ducking delay, as on the pedal
+#define INPUT_ENVELOPE_ATTACK_MS (5.0f)
+#define INPUT_ENVELOPE_RELEASE_MS (150.0f)
+static envelope_t input_envelope;
+static volatile float32_t input_level = 0.0f;
+
+static fx_chain_t chain;
+static fx_transition_t transition;
+
+// one block of the chain: the input collected from the host buffers, and the output of the previous block handed out
+// while the next one is collected. fill: frames of the block collected so far
+static sample_t block_in[AUDIO_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+static sample_t block_out[AUDIO_CHANNELS][MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+static sample_t *const channel_in[AUDIO_CHANNELS] = { block_in[0],
+#if (AUDIO_CHANNELS == 2)
+	block_in[1]
+#endif
+};
+static sample_t *const channel_out[AUDIO_CHANNELS] = { block_out[0],
+#if (AUDIO_CHANNELS == 2)
+	block_out[1]
+#endif
+};
+static uint16_t block_size = PING_PONG_BUFFER_SIZE;
+static uint16_t fill = 0;
+static bool initialized = false;
+
+// Sample filter taps located in fx_lib.c
+extern float32_t filter_taps[NUM_TAPS];
+
+/******************************************************************************
+* Function Name: fx_host_init
+*******************************************************************************
+* Summary:
+*  Initialize the effects for a sample rate and a block size and build the chain, everything
+*  bypassed (FXNONE). Called again with another rate or block size (the host prepares the
+*  plugin again), the effects are initialized for it and start from silence, the chain and
+*  the selected effect are kept. Not while fx_host_process runs.
+*
+* Parameters:
+*  1. uint32_t rate					- Sample rate of the host: 44100, 48000 or 96000 Hz, as on the pedal
+*									  (audio_set_sample_rate).
+*  2. uint16_t size					- Samples per block of the chain, a power of 2 from MIN_BLOCK_SIZE to
+*									  MAX_BLOCK_SIZE. Independent of the buffer size of the host.
+* Return:
+*  0:								- Success.
+*  254:								- Rate or block size not supported.
+*  255:								- The chain has no room for every effect (FX_CHAIN_MAX_NODES).
+*
+******************************************************************************/
+uint8_t fx_host_init(uint32_t rate, uint16_t size)
+{
+	if ((rate != 44100) && (rate != 48000) && (rate != 96000))
+	{
+		return 254;
+	}
+	if ((size < MIN_BLOCK_SIZE) || (size > MAX_BLOCK_SIZE) || (((size - 1) & size) != 0))
+	{
+		return 254;
+	}
+
+	sample_rate = rate;
+	block_size = size;
+	memset(block_in, 0, sizeof(block_in));
+	memset(block_out, 0, sizeof(block_out));
+	fill = 0;
+	envelope_init(&input_envelope, ENVELOPE_PEAK, INPUT_ENVELOPE_ATTACK_MS, INPUT_ENVELOPE_RELEASE_MS);
+	fx_setup_effects(channel_in, channel_out, block_size, &input_level);
+	if (!initialized)
+	{
+		// the taps and the chain once, as main does
+		init_fir_filter(filter_taps);
+		if (fx_setup_chain(&chain, &transition) != 0)
+		{
+			return 255;
+		}
+		initialized = true;
+	}
+	else
+	{
+		// audio_set_sample_rate and audio_set_block_size of main.c
+		fx_setup_reset(block_size);
+		fx_setup_tails(&chain);
+		reverb_rebuild(&reverb_handle);
+	}
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fx_host_select
+*******************************************************************************
+* Summary:
+*  Switch to another effect, as the menu of the pedal does. A desktop CPU runs both effects of
+*  a crossfade easily, so the switch always crossfades. Call fx_host_idle afterwards (also
+*  when 253 was returned, the outgoing effect gives its buffers back there).
+*
+* Parameters:
+*  1. uint8_t fx					- Effect (fx_designator), FXNONE bypasses the chain.
+* Return:
+*  0:								- Requested, the crossfade starts with the next block.
+*  255:								- No such effect.
+*  253:								- Its buffers don't fit into the arenas yet.
+*
+******************************************************************************/
+uint8_t fx_host_select(uint8_t fx)
+{
+	if (fx > FXPINGPONG)
+	{
+		return 255;
+	}
+	return fx_transition_request(&transition, &chain, fx, true);
+}
+
+// control part of the main loop: gives the buffers of the effects that stopped back and moves the pipeline stage
+// boundary. from the thread of fx_host_select, every few blocks
+void fx_host_idle(void)
+{
+	fx_transition_reclaim(&transition, &chain);
+	fx_chain_balance(&chain);
+}
+
+/******************************************************************************
+* Function Name: fx_host_process
+*******************************************************************************
+* Summary:
+*  Run the chain on the buffers of the host: the frames are collected into blocks of the
+*  block size, every complete block goes through the chain (run_fx of main.c: the input
+*  envelope of the ducking delay, the transition, the limiter), the output of a block is
+*  handed out while the next one is collected. Any number of frames per call.
+*
+* Parameters:
+*  1. const float *const in[]		- Input of every channel, frames samples each, -1 to 1.
+*  2. float *const out[]			- Output of every channel, may be the input buffers.
+*  3. uint32_t frames				- Samples per channel.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_host_process(const float *const in[AUDIO_CHANNELS], float *const out[AUDIO_CHANNELS], uint32_t frames)
+{
+	uint32_t done = 0;
+	while (done < frames)
+	{
+		const uint32_t n = ((frames - done) < (uint32_t)(block_size - fill)) ? (frames - done) : (uint32_t)(block_size - fill);
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+			// the output of this segment first: in and out may be the same buffer
+			float32_t segment[MAX_BLOCK_SIZE];
+			memcpy(segment, &in[ch][done], n * sizeof(float32_t));
+#if defined(SAMPLE_Q31)
+			arm_q31_to_float(&block_out[ch][fill], &out[ch][done], n);
+			arm_float_to_q31(segment, &block_in[ch][fill], n);
+#else
+			memcpy(&out[ch][done], &block_out[ch][fill], n * sizeof(float32_t));
+			memcpy(&block_in[ch][fill], segment, n * sizeof(float32_t));
+#endif
+		}
+		done += n;
+		fill += n;
+		if (fill < block_size)
+		{
+			break;
+		}
+		fill = 0;
+
+		if (delay_handle[0].duck > 0.0f)
+		{
+#if defined(SAMPLE_Q31)
+			float32_t level[MAX_BLOCK_SIZE];
+			arm_q31_to_float(block_in[0], level, block_size);
+			input_level = fminf(envelope_block(&input_envelope, level, block_size), 1.0f);
+#else
+			input_level = fminf(envelope_block(&input_envelope, block_in[0], block_size), 1.0f);
+#endif
+		}
+		fx_transition_process(&transition, &chain, channel_in, channel_out, block_size);
+		for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+		{
+#if defined(SAMPLE_Q31)
+			run_limiter_q31(&limiter_handle[ch], block_out[ch], block_out[ch], block_size);
+#else
+			run_limiter(&limiter_handle[ch], block_out[ch], block_out[ch], block_size);
+#endif
+		}
+	}
+}
+
+// latency reported to the host in samples: the block collected before it's processed, the effect (or the later
+// branch of a crossfade) and the lookahead of the limiter
+uint32_t fx_host_latency(void)
+{
+	return block_size + transition.latency + LIMITER_LOOKAHEAD;
+}
+
+/******************************************************************************
+* Function Name: fx_host_handle
+*******************************************************************************
+* Summary:
+*  Handle of an effect, for its functions in fx_lib.h (parameter updates, presets). Cabinet,
+*  reverb and ping-pong delay have one handle for all channels.
+*
+* Parameters:
+*  1. uint8_t fx					- Effect (fx_designator).
+*  2. uint8_t channel				- Channel, below AUDIO_CHANNELS.
+* Return:
+*  Pointer to the handle (e.g. delay_handle_t), NULL for FXNONE, FXFILTER (no handle, see
+*  init_fir_filter) and invalid arguments.
+*
+******************************************************************************/
+void *fx_host_handle(uint8_t fx, uint8_t channel)
+{
+	if (channel >= AUDIO_CHANNELS)
+	{
+		return NULL;
+	}
+	switch (fx)
+	{
+		case FXDELAY: return &delay_handle[channel];
+		case FXOVERDRIVE: return &overdrive_handle[channel];
+		case FXFUZZ: return &fuzz_handle[channel];
+		case FXTREMOLO: return &tremolo_handle[channel];
+		case FXRINGMOD: return &ring_mod_handle[channel];
+		case FXCHORUS: return &chorus_handle[channel];
+		case FXFLANGER: return &flanger_handle[channel];
+		case FXREVERB: return &reverb_handle;
+		case FXEQ: return &eq_handle[channel];
+		case FXCAB: return &cab_handle;
+		case FXGATE: return &gate_handle[channel];
+		case FXCOMP: return &comp_handle[channel];
+		case FXPITCH: return &pitch_handle[channel];
+		case FXWAH: return &wah_handle[channel];
+		case FXPHASER: return &phaser_handle[channel];
+		case FXAMP: return &amp_handle[channel];
+		case FXLOOP: return &fxloop_handle[channel];
+		case FXDENOISE: return &denoise_handle[channel];
+		case FXFREEZE: return &freeze_handle[channel];
+		case FXPINGPONG: return &pingpong_handle;
+		default: return NULL;
+	}
+}
+
+#endif // HOST_BUILD
@@ -0,0 +1,54 @@
+// fx_host.h, Michael Haselberger
+// Description: This file contains declarations for the desktop build of the effect chain implemented in fx_host.c
+
+#ifndef __FX_HOST_H__
+#define __FX_HOST_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "defines_and_constants.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Desktop build (HOST_BUILD). The effects of fx_lib.c, the chain and the transition of fx_chain.c and the DSP modules
+*   below them build for a desktop CPU (x86-64, or AArch64 with NEON), so a plugin wrapper or a regression and fuzz
+*   test farm runs the same code as the pedal. fx_host.c builds the chain as main.c does (fx_setup.c) and
+*   runs it behind a small block processing API: any number of frames per call, cut into blocks of the block
+*   size of the chain (one block of latency, fx_host_latency).
+*
+*   Sources: fx_host.c fx_setup.c fx_lib.c fx_chain.c arena.c scratch_pool.c resampler.c ring_buffer.c delay_line.c
+*   smooth_param.c waveshaper.c oversampler.c oscillator.c convolver.c fdn.c control_rate.c fast_math.c amp_model.c
+*   fir_filter.c envelope.c dc_blocker.c stft.c multirate.c profiler.c
+*   Defines: -DHOST_BUILD, without CORE_CM7/CORE_CM4 (no TCM sections), DUAL_CORE and CONTROL_M4. AArch64 adds
+*   -DARM_MATH_NEON for the NEON kernels of CMSIS-DSP. The features of defines_and_constants.h that only exist on the
+*   board (MIDI, TUNER, LOOPER and the like) don't matter, none of these sources reads them. SAMPLE_Q31,
+*   AUDIO_CHANNELS, PACKED_DELAY, DELAY_DECIMATION and REVERB_FDN change the chain as on the pedal.
+*   Includes: this directory, Common/Drivers/CMSIS/Include (cmsis_gcc.h has the C versions of the intrinsics) and
+*   Common/Drivers/CMSIS_DSP/DSP/Include. The CMSIS-DSP library of the tree is built for the M7, the host links
+*   its own build of the CMSIS-DSP sources (the generic C kernels, or NEON). GCC or Clang, C11.
+*   Runner: fx_host_run.c adds a main that streams a WAV file through one effect and reports the throughput, its
+*   output compares with the Python references (analysis_helpers.CompareRecording).
+*
+*   Threads: fx_host_process runs on the audio thread, as the audio interrupt on the pedal. fx_host_select,
+*   fx_host_idle and the parameter updates (the *_update functions of fx_lib.h on fx_host_handle) run on one other
+*   thread, as the main loop on the pedal: the handovers between them (parameter blocks, waveshaper tables, the
+*   transition) are the same. fx_host_init runs before the audio thread starts.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+#if defined(HOST_BUILD)
+
+uint8_t fx_host_init(uint32_t rate, uint16_t size);
+uint8_t fx_host_select(uint8_t fx);
+void fx_host_idle(void);
+void fx_host_process(const float *const in[AUDIO_CHANNELS], float *const out[AUDIO_CHANNELS], uint32_t frames);
+uint32_t fx_host_latency(void);
+void *fx_host_handle(uint8_t fx, uint8_t channel);
+
+#endif // HOST_BUILD
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __FX_HOST_H__
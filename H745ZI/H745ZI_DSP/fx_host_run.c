@@ -0,0 +1,449 @@
+// fx_host_run.c, Michael Haselberger
+// Description: Command line runner of the desktop build (HOST_BUILD, see fx_host.h). Streams a WAV file through one
+// effect of the chain, block by block as the pedal processes it, and reports the throughput. The output is written
+// as a recording of the USB audio device is (chain output in channel 0, the input in channel 1), so
+// Python/analysis_helpers.CompareRecording compares it with the reference of dsp_helpers.
+//
+// Usage: fx_host_run <input.wav> <output.wav> <effect> [block=64] [parameter=value ...]
+//  input.wav: 16 bit PCM or 32 bit float at 44100, 48000 or 96000 Hz, its first channel feeds every channel of the
+//             chain (e.g. ffmpeg -i Python/synth_mix.mp3 -ar 48000 synth_mix.wav)
+//  effect:    name of the effect (effect_names) or its number (fx_designator)
+//  parameter: delay, feedback, blend (delay), threshold, quality (overdrive), gain, mix, quality (fuzz), rate, depth
+//             (tremolo), rate, blend, modulator (ring modulator), as in the menu. quality: lut, adaa or oversampled.
+//             The other effects run with their start-up parameters (fx_setup.c)
+// Built from the sources of fx_host.h and this file, e.g.
+//  gcc -O2 -std=c11 -DHOST_BUILD -I. -ICommon/Drivers/CMSIS/Include -ICommon/Drivers/CMSIS_DSP/DSP/Include
+//  fx_host_run.c <sources of fx_host.h> <CMSIS-DSP sources> -lm -o fx_host_run
+
+#include "fx_host.h"
+
+#if defined(HOST_BUILD)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fx_lib.h"
+#include "fx_chain.h"
+
+// silence run ahead of the input: the crossfade of fx_host_select and the reclaim after it
+#define WARMUP_MS (4 * FX_TRANSITION_MS)
+
+#define WAVE_FORMAT_PCM (1)
+#define WAVE_FORMAT_IEEE_FLOAT (3)
+#define WAVE_FORMAT_EXTENSIBLE (0xFFFE)
+
+// effect names on the command line, by fx_designator
+static const char *const effect_names[] = { "none", "delay", "overdrive", "fuzz", "tremolo", "ringmod", "filter",
+	"chorus", "flanger", "reverb", "eq", "cab", "gate", "comp", "pitch", "wah", "phaser", "amp", "loop", "denoise",
+	"freeze", "pingpong" };
+
+static const char *const quality_names[] = { "lut", "adaa", "oversampled" };
+
+// the first channel of a WAV file, -1 to 1
+typedef struct
+{
+	uint32_t rate;
+	uint32_t frames;
+	float *samples;
+} wav_t;
+
+static uint32_t le16(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+	return le16(p) | (le16(p + 2) << 16);
+}
+
+static void put16(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+/******************************************************************************
+* Function Name: wav_read
+*******************************************************************************
+* Summary:
+*  Read the first channel of a WAV file: 16 bit PCM or 32 bit float, also in the extensible
+*  format ffmpeg writes for more than two channels.
+*
+* Parameters:
+*  1. const char *path				- WAV file.
+*  2. wav_t *wav					- Rate, frames and samples (malloc, the caller frees them).
+* Return:
+*  0:								- Success.
+*  255:								- Not readable, no RIFF/WAVE file or no fmt or data chunk.
+*  254:								- Sample format not supported.
+*  253:								- Out of memory.
+*
+******************************************************************************/
+static uint8_t wav_read(const char *path, wav_t *wav)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL)
+	{
+		return 255;
+	}
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *file = (size > 12) ? malloc((size_t)size) : NULL;
+	const bool read = (file != NULL) && (fread(file, 1, (size_t)size, f) == (size_t)size);
+	fclose(f);
+	if (!read)
+	{
+		free(file);
+		return (size > 12) ? 253 : 255;
+	}
+
+	uint8_t result = 255;
+	const uint8_t *fmt = NULL;
+	const uint8_t *data = NULL;
+	uint32_t data_size = 0;
+	if ((memcmp(file, "RIFF", 4) == 0) && (memcmp(file + 8, "WAVE", 4) == 0))
+	{
+		// chunks in any order, padded to even sizes
+		for (long at = 12; (at + 8) <= size; )
+		{
+			const uint32_t chunk = le32(file + at + 4);
+			const uint32_t avail = (uint32_t)(size - at - 8);
+			if ((memcmp(file + at, "fmt ", 4) == 0) && (chunk >= 16))
+			{
+				fmt = file + at + 8;
+			}
+			else if (memcmp(file + at, "data", 4) == 0)
+			{
+				data = file + at + 8;
+				// streamed files leave the size open
+				data_size = (chunk < avail) ? chunk : avail;
+			}
+			at += 8 + (long)chunk + (long)(chunk & 1);
+		}
+	}
+	if ((fmt != NULL) && (data != NULL))
+	{
+		uint32_t format = le16(fmt);
+		const uint32_t channels = le16(fmt + 2);
+		const uint32_t bits = le16(fmt + 14);
+		if ((format == WAVE_FORMAT_EXTENSIBLE) && (le16(fmt + 16) >= 22))
+		{
+			// sub format GUID, its first two bytes are the format
+			format = le16(fmt + 32);
+		}
+		const bool pcm16 = (format == WAVE_FORMAT_PCM) && (bits == 16);
+		const bool float32 = (format == WAVE_FORMAT_IEEE_FLOAT) && (bits == 32);
+		result = 254;
+		if ((channels > 0) && (pcm16 || float32))
+		{
+			const uint32_t stride = channels * (bits / 8);
+			wav->rate = le32(fmt + 4);
+			wav->frames = data_size / stride;
+			wav->samples = malloc(((size_t)wav->frames + 1) * sizeof(float));
+			result = (wav->samples == NULL) ? 253 : 0;
+			for (uint32_t i = 0; (result == 0) && (i < wav->frames); ++i)
+			{
+				const uint8_t *p = data + (size_t)i * stride;
+				if (pcm16)
+				{
+					wav->samples[i] = (float)(int16_t)le16(p) / 32768.0f;
+				}
+				else
+				{
+					const uint32_t word = le32(p);
+					memcpy(&wav->samples[i], &word, sizeof(float));
+				}
+			}
+		}
+	}
+	free(file);
+	return result;
+}
+
+/******************************************************************************
+* Function Name: wav_write
+*******************************************************************************
+* Summary:
+*  Write a stereo 32 bit float WAV file, the layout of a recording of the USB audio device.
+*
+* Parameters:
+*  1. const char *path				- WAV file, replaced.
+*  2. uint32_t rate					- Sample rate in Hz.
+*  3. const float *left				- Channel 0, frames samples.
+*  4. const float *right			- Channel 1, frames samples.
+*  5. uint32_t frames				- Samples per channel.
+* Return:
+*  0:								- Success.
+*  255:								- Not writable.
+*
+******************************************************************************/
+static uint8_t wav_write(const char *path, uint32_t rate, const float *left, const float *right, uint32_t frames)
+{
+	FILE *f = fopen(path, "wb");
+	if (f == NULL)
+	{
+		return 255;
+	}
+	uint8_t header[44];
+	const uint32_t data_size = frames * 2 * sizeof(float);
+	memcpy(header, "RIFF", 4);
+	put32(header + 4, 36 + data_size);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	put32(header + 16, 16);
+	put16(header + 20, WAVE_FORMAT_IEEE_FLOAT);
+	put16(header + 22, 2);
+	put32(header + 24, rate);
+	put32(header + 28, rate * 2 * sizeof(float));
+	put16(header + 32, 2 * sizeof(float));
+	put16(header + 34, 32);
+	memcpy(header + 36, "data", 4);
+	put32(header + 40, data_size);
+	bool written = (fwrite(header, 1, sizeof(header), f) == sizeof(header));
+	for (uint32_t i = 0; written && (i < frames); ++i)
+	{
+		uint8_t frame[2 * sizeof(float)];
+		uint32_t word;
+		memcpy(&word, &left[i], sizeof(float));
+		put32(frame, word);
+		memcpy(&word, &right[i], sizeof(float));
+		put32(frame + 4, word);
+		written = (fwrite(frame, 1, sizeof(frame), f) == sizeof(frame));
+	}
+	written &= (fclose(f) == 0);
+	return written ? 0 : 255;
+}
+
+static int find_name(const char *const names[], uint8_t count, const char *name)
+{
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		if (strcmp(names[i], name) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/******************************************************************************
+* Function Name: set_parameter
+*******************************************************************************
+* Summary:
+*  Set a parameter of the effect on every channel, by the functions the menu uses. The values
+*  are those of the functions (e.g. fuzz gain 0 to 18, delay in ms), not the menu counts.
+*
+* Parameters:
+*  1. uint8_t fx					- Effect (fx_designator).
+*  2. const char *name				- Parameter name.
+*  3. const char *text				- Value.
+* Return:
+*  0:								- Success.
+*  255:								- No such parameter of the effect.
+*  254:								- Value out of range.
+*  253:								- Its tables don't fit (waveshaper_build).
+*
+******************************************************************************/
+static uint8_t set_parameter(uint8_t fx, const char *name, const char *text)
+{
+	const float value = strtof(text, NULL);
+	const int quality = find_name(quality_names, sizeof(quality_names) / sizeof(quality_names[0]), text);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		void *handle = fx_host_handle(fx, ch);
+		// the updates answer a refused value with 255 or 254, 253 is memory
+		uint8_t result = 254;
+		bool known = true;
+		if ((fx == FXDELAY) && (strcmp(name, "delay") == 0)) result = delay_update(handle, DELAY, value);
+		else if ((fx == FXDELAY) && (strcmp(name, "feedback") == 0)) result = delay_update(handle, FEEDBACK, value);
+		else if ((fx == FXDELAY) && (strcmp(name, "blend") == 0)) result = delay_update(handle, BLEND, value);
+		else if ((fx == FXOVERDRIVE) && (strcmp(name, "threshold") == 0)) result = overdrive_update(handle, value);
+		else if ((fx == FXOVERDRIVE) && (strcmp(name, "quality") == 0))
+		{
+			if (quality >= 0) result = overdrive_set_quality(handle, (distortion_quality)quality);
+		}
+		else if ((fx == FXFUZZ) && (strcmp(name, "gain") == 0)) result = fuzz_update(handle, GAIN, value);
+		else if ((fx == FXFUZZ) && (strcmp(name, "mix") == 0)) result = fuzz_update(handle, MIX, value);
+		else if ((fx == FXFUZZ) && (strcmp(name, "quality") == 0))
+		{
+			if (quality >= 0) result = fuzz_set_quality(handle, (distortion_quality)quality);
+		}
+		else if ((fx == FXTREMOLO) && (strcmp(name, "rate") == 0)) result = tremolo_update(handle, RATE, value);
+		else if ((fx == FXTREMOLO) && (strcmp(name, "depth") == 0)) result = tremolo_update(handle, DEPTH, value);
+		else if ((fx == FXRINGMOD) && (strcmp(name, "rate") == 0)) result = ring_mod_update(handle, RATE, NO_CHANGE, value);
+		else if ((fx == FXRINGMOD) && (strcmp(name, "blend") == 0)) result = ring_mod_update(handle, DEPTH, NO_CHANGE, value);
+		else if ((fx == FXRINGMOD) && (strcmp(name, "modulator") == 0))
+		{
+			// 0 sine, 1 triangle, 2 square, as dsp_helpers.ring_modulator. the rate stays the published one
+			ring_mod_handle_t *ring_mod = handle;
+			if ((value == 0.0f) || (value == 1.0f) || (value == 2.0f)) result = ring_mod_update(ring_mod, RATE,
+				(modulator_type)value, ring_mod->shared.copy[ring_mod->shared.published].rate);
+		}
+		else known = false;
+
+		if (!known)
+		{
+			return 255;
+		}
+		if (result != 0)
+		{
+			return (result == 253) ? 253 : 254;
+		}
+	}
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+// fx_host_process on a buffer of n frames, the same samples in every channel. out: channel 0 of the output
+static void process(const float *in, float *out, uint32_t n)
+{
+	static float buffer[AUDIO_CHANNELS][MAX_BLOCK_SIZE];
+	float *io[AUDIO_CHANNELS];
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		memcpy(buffer[ch], in, n * sizeof(float));
+		io[ch] = buffer[ch];
+	}
+	fx_host_process((const float *const *)io, io, n);
+	memcpy(out, buffer[0], n * sizeof(float));
+	fx_host_idle();
+}
+
+static int usage(void)
+{
+	fprintf(stderr, "usage: fx_host_run <input.wav> <output.wav> <effect> [block=64] [parameter=value ...]\neffects:");
+	for (uint8_t fx = 0; fx <= FXPINGPONG; ++fx)
+	{
+		fprintf(stderr, " %s", effect_names[fx]);
+	}
+	fprintf(stderr, "\n");
+	return 2;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 4)
+	{
+		return usage();
+	}
+	int fx = find_name(effect_names, FXPINGPONG + 1, argv[3]);
+	if (fx < 0)
+	{
+		char *end;
+		const long number = strtol(argv[3], &end, 10);
+		fx = ((*end == '\0') && (number >= 0) && (number <= FXPINGPONG)) ? (int)number : -1;
+	}
+	if (fx < 0)
+	{
+		return usage();
+	}
+	uint16_t block_size = 64;
+	int arg = 4;
+	if ((arg < argc) && (strchr(argv[arg], '=') == NULL))
+	{
+		block_size = (uint16_t)strtoul(argv[arg++], NULL, 10);
+	}
+
+	wav_t wav;
+	uint8_t result = wav_read(argv[1], &wav);
+	if (result != 0)
+	{
+		fprintf(stderr, "%s: %s\n", argv[1], (result == 254) ? "16 bit PCM or 32 bit float only" : "no WAV file");
+		return 1;
+	}
+	if (fx_host_init(wav.rate, block_size) != 0)
+	{
+		fprintf(stderr, "%u Hz, block size %u: not supported\n", (unsigned)wav.rate, (unsigned)block_size);
+		free(wav.samples);
+		return 1;
+	}
+
+	// crossfade into the effect on silence, then start the effects from silence again: the input meets the effect
+	// as dsp_helpers starts its references (LFO phase 0, empty delay lines)
+	if (fx_host_select((uint8_t)fx) != 0)
+	{
+		fprintf(stderr, "%s: its buffers don't fit into the arenas\n", effect_names[fx]);
+		free(wav.samples);
+		return 1;
+	}
+	static float silence[MAX_BLOCK_SIZE];
+	float scratch[MAX_BLOCK_SIZE];
+	for (uint32_t n = 0; n < (wav.rate * WARMUP_MS) / 1000; n += block_size)
+	{
+		process(silence, scratch, block_size);
+	}
+	fx_host_init(wav.rate, block_size);
+	for (; arg < argc; ++arg)
+	{
+		char *value = strchr(argv[arg], '=');
+		if (value == NULL)
+		{
+			free(wav.samples);
+			return usage();
+		}
+		*value++ = '\0';
+		result = set_parameter((uint8_t)fx, argv[arg], value);
+		if (result != 0)
+		{
+			fprintf(stderr, "%s %s=%s: %s\n", effect_names[fx], argv[arg], value,
+				(result == 255) ? "no such parameter" : ((result == 254) ? "out of range" : "no memory"));
+			free(wav.samples);
+			return 1;
+		}
+	}
+
+	// the output lags by the latency: the input is followed by that much silence, so nothing is cut
+	const uint32_t latency = fx_host_latency();
+	const uint32_t frames = wav.frames + latency;
+	float *dry = calloc((size_t)frames + block_size, sizeof(float));
+	float *wet = calloc((size_t)frames + block_size, sizeof(float));
+	if ((dry == NULL) || (wet == NULL))
+	{
+		fprintf(stderr, "out of memory\n");
+		free(wav.samples);
+		free(dry);
+		free(wet);
+		return 1;
+	}
+	memcpy(dry, wav.samples, wav.frames * sizeof(float));
+	const double start = now();
+	for (uint32_t n = 0; n < frames; n += block_size)
+	{
+		process(&dry[n], &wet[n], block_size);
+	}
+	const double seconds = now() - start;
+
+	const bool written = (wav_write(argv[2], wav.rate, wet, dry, frames) == 0);
+	if (!written)
+	{
+		fprintf(stderr, "%s: not writable\n", argv[2]);
+	}
+	else
+	{
+		const double audio = (double)frames / (double)wav.rate;
+		printf("%s: %u frames at %u Hz, block size %u, latency %u\n", effect_names[fx], (unsigned)frames,
+			(unsigned)wav.rate, (unsigned)block_size, (unsigned)latency);
+		printf("%.3f s for %.3f s of audio: %.1f times real time, %.1f ns per frame\n", seconds, audio,
+			(seconds > 0.0) ? (audio / seconds) : 0.0, 1e9 * seconds / (double)frames);
+	}
+	free(wav.samples);
+	free(dry);
+	free(wet);
+	return written ? 0 : 1;
+}
+
+#endif // HOST_BUILD
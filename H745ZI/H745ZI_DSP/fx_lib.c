@@ -1,82 +1,131 @@
 // fx_lib.c: Michael Haselberger
 // Description: Algorithm library for audio signal processing effects
+#include <string.h>
 #include "fx_lib.h"
+#include "arena.h"
+#include "scratch_pool.h"
+#include "resampler.h"
 
 // ---- Constants and Helpers ----
 
-// sample frequency/sample rate Fs
-static const uint16_t Fs = 48000;
+// sample frequency/sample rate Fs. follows audio_set_sample_rate, every coefficient is computed from it when it's set
+#define Fs ((float32_t)sample_rate)
 
 /******************************************************************************
-* Function Name: triangle_wave
+* Function Name: lfo_advance
 *******************************************************************************
 * Summary:
-*  Calculate the amplitude of a non-phase-shifted triangle wave as a funtion of time.
+*  Advance the phase of a low frequency oscillator and wrap it into [0, 2 PI].
+*  Used by the effects which evaluate their LFO only at the block boundaries (chorus, flanger).
 *
 * Parameters:
-*  1. float32_t time - the x value/time at which to calculate the value.
+*  1. float32_t *time			- Phase (x value/time) of the oscillator.
+*  2. float32_t increment		- Phase increment. May span multiple samples (e.g. one block).
 * Return:
-*  The value of the amplitude.
+*  None.
 *
 ******************************************************************************/
-static inline float32_t triangle_wave(float32_t time)
-{	
-	return asin(arm_cos_f32(time)) / 1.57079633;
+static inline void lfo_advance(float32_t *time, float32_t increment)
+{
+	*time += increment;
+	while (*time > 2 * PI)
+		*time -= 2 * PI;
 }
 
-
 /******************************************************************************
-* Function Name: square_wave
+* Function Name: fill_ramp
 *******************************************************************************
 * Summary:
-*  Calculate the amplitude of a non-phase-shifted square wave as a funtion of time.
+*  Fill a block with a linear ramp. Used to interpolate control values, which are only
+*  computed once per block, over the whole block.
 *
 * Parameters:
-*  1. float32_t time - truct which contains information about the size of the buffer, 
-*  its address in memory and which data it will hold.
+*  1. float32_t *dst			- Output block.
+*  2. float32_t start			- Value of the first sample.
+*  3. float32_t end				- Value the ramp would reach one sample after the block.
+*  4. uint32_t block_size		- Number of samples.
 * Return:
-*  The value of the amplitude.
+*  None.
 *
 ******************************************************************************/
-static inline int8_t square_wave(float32_t time)
+static inline void fill_ramp(float32_t *dst, float32_t start, float32_t end, uint32_t block_size)
 {
-	return (arm_sin_f32(time) >= 0) ? 1 : -1;
+	const float32_t step = (end - start) / block_size;
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = start + step * i;
+	}
 }
 
 // ---- Delay Section ----
 
-// ring buffer handle for delay effect
-static rb_handle_t _delay_rb = { 0 };
-// 2^16 * 4 bytes = 262 144 B buffer size. this is pretty much an entire RAM region just delay buffer.	
-// delay ring buffer needs to be > Fs. ring buffer implementation calls for buffers to be 2^X, so buffer needs to be 2^16 elements.
-// this results in a ~27% memory inefficiency vs. a slight performance gain due to eliminating modulo calculations. if memory is tight,
-// consider taking the performance hit (delay buffer for 48k samples would be around 192KB: (48000+1) * 4 bytes )
-// might also be worth considering to dynamically assign this memory only when required. requires de-init function to avoid memory leaks
-static volatile float32_t __attribute__((aligned(32))) __attribute__((section(".delay_buffer"))) delay_buffer[(1 << 16)] = { 0 };
+// delay line length in samples. needs to hold MAX_DELAY_TIME plus one block: 500 ms * 48 samples/ms + 64 = 24064 samples.
+// the delay line implementation calls for buffers to be 2^X, so the line is 2^15 elements (2^15 * 4 bytes = 131 072 B).
+// the memory is taken from the RAM_D2 arena (.delay_buffer section) only when the delay is activated (enters the chain)
+// and given back with delay_deinit when it leaves, so other time-based effects can use the region in the meantime.
+// PACKED_DELAY: 2^16 q15 elements in the same 131 072 B, 1300 ms * 48 samples/ms + 256 = 62656 samples.
+#if defined(PACKED_DELAY)
+#define DELAY_LINE_SIZE (1 << 16)
+#define DELAY_LINE_FORMAT DELAY_LINE_Q15
+#else
+#define DELAY_LINE_SIZE (1 << 15)
+#define DELAY_LINE_FORMAT DELAY_LINE_F32
+#endif
+// the line holds MAX_DELAY_TIME at AUDIO_SAMPLE_RATE. at 96 kHz longer delays are cut to the line: 338 ms (PACKED_DELAY: 680 ms)
+// DELAY_DECIMATION: a line of DELAY_LINE_SIZE / divider holds the same time at the lower rate, the rest of the pool
+// memory stays free for the other effects
+#define DELAY_MAX_SAMPLES(divider) (DELAY_LINE_SIZE / (divider) - MAX_BLOCK_SIZE)
+
+// rate divider of the wet path, 1 for a handle that was never decimated
+static inline uint32_t delay_divider(const delay_handle_t *handle)
+{
+	return (handle->decimation > 1) ? handle->decimation : 1;
+}
+
+// samples of the wet rate the filters of the decimated path add to the echo, 0 at the full rate. the taps read that
+// much closer to the write position, so the echo comes on time and the undelayed dry path needs no compensation
+static inline uint32_t delay_lag(const delay_handle_t *handle)
+{
+	const uint32_t divider = delay_divider(handle);
+	return (divider > 1) ? (multirate_latency(&handle->multirate) + divider / 2) / divider : 0;
+}
 
-// designator used by the ring buffer functions to identify the correct buffer
-static rb_designator_t delay_rbd =  FXDELAY;
+// delay time in samples of the wet path at the current sample rate, less the filter lag, at most what the line holds
+static uint32_t delay_samples(const delay_handle_t *handle, float32_t delay_ms)
+{
+	const uint32_t divider = delay_divider(handle);
+	const uint32_t max = DELAY_MAX_SAMPLES(divider);
+	const uint32_t lag = delay_lag(handle);
+	uint32_t samples = (uint32_t)(delay_ms * (Fs / (1000.0f * divider)));
+	samples = (samples > lag) ? samples - lag : 0;
+	return (samples < max) ? samples : max;
+}
+// a new delay time is reached by moving the tap over this time instead of jumping (tape style pitch bend while it moves)
+#define DELAY_GLIDE_MS 100.0f
+// DELAY_TIME_JUMP: the old tap is faded out while the new one is faded in over this time
+#define DELAY_CROSSFADE_MS 20.0f
+// ducking: input level (peak) that attenuates the wet signal by the whole duck amount, -12 dBFS
+#define DELAY_DUCK_FULL_LEVEL 0.25f
 
 /******************************************************************************
 * Function Name: delay_init
 *******************************************************************************
 * Summary:
-*  Initialize delay handle struct with its parameters. This includes initialization of 
-*  a circular buffer, which acts as the delay-line.
+*  Initialize delay handle struct with its parameters. The circular buffer, which acts as the
+*  delay-line, is only taken by delay_activate.
 *
 * Parameters:
 *  1. delay_handle_t *handle	- Address pointer of delay handle struct.
 *  2. float32_t *in_buffer		- Address pointer of the input buffer, which holds the blocked sample data.
 *  3. float32_t *out_buffer		- Address pointer of the output buffer. This is where the modified samples are written to.
-*  4. float32_t delay_ms		- The amount of time the delay line will delay the incoming samples. Delay-line buffer
-*								  will be filled with the corresponding amount of samples. Maximum time depends on memory constraints.
+*  4. float32_t delay_ms		- The amount of time the delay line will delay the incoming samples. The read position
+*								  trails the write position by the corresponding amount of samples. Maximum time depends on memory constraints.
 *  5. float32_t blend			- Determines the ratio of dry and wet mix. Must be between 0 and 1
 *  6. float32_t feedback		- Determines the amplitude of the wet sample which is fed back to the delay line.
 * 
 * Return:
 *	255:						- Input or output buffers are NULL
 *	254:						- Parameters out of range
-*	253:						- Ring buffer error
 *	  0:						- Successful initialization
 *
 ******************************************************************************/
@@ -92,50 +141,116 @@ uint8_t delay_init(delay_handle_t *handle, float32_t *in_buffer, float32_t *out_
 		return 254;
 	}
 		
-	_delay_rb.element_size = sizeof(delay_buffer[0]);
-	_delay_rb.max_elements = ARRAY_SIZE(delay_buffer);
-	_delay_rb.buffer = delay_buffer;	
-	
-	// rb init function increments designator. if designator is still FXDELAY, rb needs to be initialized.
-	// otherwise, it's enough to clear the buffer
-	// TODO: re-write check here. as it is, delay_rbd will always be 0
-	if (delay_rbd == FXDELAY)
-	{
-		int8_t err = ring_buffer_init(&delay_rbd, &_delay_rb);
-		if (err)
-		{
-			return 253;
-		}
-	}
-	else
-	{
-		ring_buffer_clear(FXDELAY);
-	}
-	
+	// the read position simply trails the write position by the amount of samples to delay
 	handle->src = in_buffer;
 	handle->dst = out_buffer;
 	handle->delay_ms = delay_ms;
 	handle->blend = blend;	
 	handle->feedback = feedback;
-	// this struct member might be unnecessary. only useful if rb struct needs to be accessed outside of this file, which probably isn't the case
-	handle->delay_rb = &_delay_rb;		
+	smooth_param_init(&handle->blend_smooth, blend, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->feedback_smooth, feedback, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	handle->delay_in_samples = delay_samples(handle, handle->delay_ms);
+	smooth_param_init(&handle->time_smooth, (float32_t)handle->delay_in_samples, SMOOTH_LINEAR, DELAY_GLIDE_MS);
+	handle->time_mode = DELAY_TIME_GLIDE;
+	handle->tap_from = handle->delay_in_samples;
+	handle->tap_to = handle->delay_in_samples;
+	smooth_param_init(&handle->tap_fade, 1.0f, SMOOTH_LINEAR, DELAY_CROSSFADE_MS);
+	handle->tap_count = 0;
+	handle->duck = 0.0f;
+	smooth_param_init(&handle->duck_smooth, 1.0f, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	if (handle->delay_line.buffer != NULL)
+		delay_reset(handle);
 	
-	// fill circular buffer with 0/increment head-pointer by amount of samples to delay
-	uint16_t delay_in_samples = (uint16_t)(handle->delay_ms * (Fs / 1000.0f));
-	for (int i = 0 ; i < delay_in_samples ; ++i)
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: delay_activate
+*******************************************************************************
+* Summary:
+*  Take the delay line memory from the RAM_D2 arena, when the delay enters the chain. If the
+*  handle still holds its delay line, it is cleared, so the delay never replays old signal.
+*  Not real time safe, call from the main loop while the delay isn't processed.
+*
+* Parameters:
+*  1. delay_handle_t *handle	- Address pointer of an initialized delay handle struct.
+* 
+* Return:
+*	253:						- Arena exhausted
+*	  0:						- Success
+******************************************************************************/
+uint8_t delay_activate(delay_handle_t *handle)
+{
+	if (handle->delay_line.buffer == NULL)
 	{
-		static float32_t zero = 0.0f;
-		ring_buffer_put(FXDELAY, &zero);
+		const uint32_t size = DELAY_LINE_SIZE / delay_divider(handle);
+		void *buffer = arena_alloc(ARENA_AHB, size * delay_line_sample_size(DELAY_LINE_FORMAT));
+		if ((buffer == NULL) || delay_line_init_format(&handle->delay_line, buffer, size, DELAY_LINE_FORMAT))
+		{
+			arena_free(buffer);
+			return 253;
+		}
 	}
-	
+	delay_reset(handle);
 	return 0;
 }
 
+/******************************************************************************
+* Function Name: delay_deinit
+*******************************************************************************
+* Summary:
+*  Give the delay line memory back to the RAM_D2 arena (the delay left the chain).
+*
+* Parameters:
+*  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+* 
+* Return:
+*  None.
+******************************************************************************/
+void delay_deinit(delay_handle_t *handle)
+{
+	arena_free(handle->delay_line.buffer);
+	handle->delay_line.buffer = NULL;
+}
+
+/******************************************************************************
+* Function Name: delay_reset
+*******************************************************************************
+* Summary:
+*  Silence the delay line without giving the memory back, e.g. after the block size changed.
+*
+* Parameters:
+*  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+* 
+* Return:
+*  None.
+******************************************************************************/
+void delay_reset(delay_handle_t *handle)
+{
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+	smooth_param_reset(&handle->blend_smooth, handle->blend);
+	smooth_param_reset(&handle->feedback_smooth, handle->feedback);
+	smooth_param_reset(&handle->time_smooth, (float32_t)handle->delay_in_samples);
+	handle->tap_from = handle->delay_in_samples;
+	handle->tap_to = handle->delay_in_samples;
+	smooth_param_reset(&handle->tap_fade, 1.0f);
+	smooth_param_reset(&handle->duck_smooth, 1.0f);
+	for (uint8_t t = 0; t < DELAY_MAX_TAPS; ++t)
+	{
+		handle->taps[t].state = 0.0f;
+		handle->taps[t].state_q31 = 0;
+	}
+	multirate_reset(&handle->multirate);
+}
+
 /******************************************************************************
 * Function Name: delay_update
 *******************************************************************************
 * Summary:
-*  Allows updating of delay parameters during runtime.
+*  Allows updating of delay parameters during runtime. A new delay time only moves the read
+*  tap, the content of the line stays: the tap glides there or jumps with a crossfade, see
+*  delay_set_time_mode.
 *
 * Parameters:
 *  1. delay_handle_t *handle	- Address pointer of delay handle struct.
@@ -151,577 +266,5183 @@ uint8_t delay_update(delay_handle_t *handle, delay_parameter pm, float32_t value
 	switch (pm)
 	{
 	case DELAY:
-		if (value > MAX_DELAY_TIME)
+		if ((value < 0.0f) || (value > MAX_DELAY_TIME))
 			return 255;
 		handle->delay_ms = value;
+		handle->delay_in_samples = delay_samples(handle, value);
 		break;
 	case FEEDBACK:
 		if ((value < 0.0f) || (value > 1.0f))
 			return 255;
 		handle->feedback = value;
+		break;
 	case BLEND:
 		if ((value < 0.0f) || (value > 1.0f))
 			return 255;
 		handle->blend = value;
+		break;
+	case DUCK:
+		if ((value < 0.0f) || (value > 1.0f))
+			return 255;
+		handle->duck = value;
 	}
 		
 	return 0;
 }
 
 /******************************************************************************
-* Function Name: run_delay
+* Function Name: delay_set_duck_source
 *******************************************************************************
 * Summary:
-*  Processes a sample block. Writes the current sample with adjusted feedback amplitude into a buffer.
-*  
+*  Set the level the ducking follows: the block envelope of an input detector that runs anyway
+*  (e.g. the one of the unprocessed input in main.c), so the delay needs no detector of its own.
+*  The wet signal is attenuated by DUCK times the level, whole at DELAY_DUCK_FULL_LEVEL. The
+*  level is only read, once per block. The duck_level member is not touched by delay_init, so
+*  the source stays set when the effects are initialized again.
 *
 * Parameters:
 *  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+*  2. const volatile float32_t *level - Level of the detector after the last block, NULL: no ducking.
 * 
 * Return:
 *  None.
-*
 ******************************************************************************/
-#pragma optimize_for_speed
-void run_delay(delay_handle_t *delay)
-{	
-	for (int i = 0; i < PING_PONG_BUFFER_SIZE; ++i)
-	{
-		float32_t delayed = 0.0f;
-		float32_t current = delay->src[i] * delay->feedback;
-		// save input sample to delay buffer
-		ring_buffer_put(FXDELAY, &current);	
-		// get sample at max delay depth
-		ring_buffer_get(FXDELAY, &delayed);
-		// sum input with delay
-		delay->dst[i] = (1.0f - delay->blend) * delay->src[i] + delay->blend * delayed;
-	}
+void delay_set_duck_source(delay_handle_t *handle, const volatile float32_t *level)
+{
+	handle->duck_level = level;
 }
 
-// ---- Filter ----
-static arm_fir_instance_f32 fir_filter;
-
-// filter taps/coeffs
-// Filter designed with http://t-filter.engineerjs.com/
-const float32_t filter_taps[NUM_TAPS] = 
-{
-	-0.00038320543575594507f,
-	-0.001377178701148151f,
-	-0.0025366259116399122f,
-	-0.004432549591717381f,
-	-0.006494295696777184f,
-	-0.008515660530043372f,
-	-0.009767438023472977f,
-	-0.009526244099262525f,
-	-0.006932364763420581f,
-	-0.0012788243688729513f,
-	0.007887516146031764f,
-	0.020575396949645768f,
-	0.036269525391131f,
-	0.05390782359810524f,
-	0.07197526362835165f,
-	0.08868444305715538f,
-	0.10222851805387685f,
-	0.11105647594211442f,
-	0.11412216765453903f,
-	0.11105647594211442f,
-	0.10222851805387685f,
-	0.08868444305715538f,
-	0.07197526362835165f,
-	0.05390782359810524f,
-	0.036269525391131f,
-	0.020575396949645768f,
-	0.007887516146031764f,
-	-0.0012788243688729513f,
-	-0.006932364763420581f,
-	-0.009526244099262525f,
-	-0.009767438023472977f,
-	-0.008515660530043372f,
-	-0.006494295696777184f,
-	-0.004432549591717381f,
-	-0.0025366259116399122f,
-	-0.001377178701148151f,
-	-0.00038320543575594507f
- };
-// fir state size is (number of samples + number of fir tabs - 1)
-
-// filter state
-static float32_t fir_state[SAMPLES + NUM_TAPS - 1];
-
 /******************************************************************************
-* Function Name: init_fir_filter
+* Function Name: delay_set_time_mode
 *******************************************************************************
 * Summary:
-*  Initialize arm-CMSIS filter struct.
+*  Select how the delay reaches a new delay time. A glide or crossfade in progress is finished
+*  at once, the tap sits on the current delay time in both modes.
 *
 * Parameters:
-*  1. float32_t *filter_taps		- Filter coefficients. More taps make the filter more accurate, but introduce
-*									  more delay into the system.
+*  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+*  2. delay_time_mode mode		- DELAY_TIME_GLIDE or DELAY_TIME_JUMP.
 * 
 * Return:
-*  None.
-*
+*  255:							- Unknown mode.
+*	 0:							- Success.
 ******************************************************************************/
-void init_fir_filter(float32_t  *filter_taps)
+uint8_t delay_set_time_mode(delay_handle_t *handle, delay_time_mode mode)
 {
-	arm_fir_init_f32(&fir_filter, NUM_TAPS, (float32_t *)&filter_taps[0], &fir_state[0], SAMPLES);
+	if (mode > DELAY_TIME_JUMP)
+		return 255;
+
+	handle->time_mode = mode;
+	smooth_param_reset(&handle->time_smooth, (float32_t)handle->delay_in_samples);
+	handle->tap_from = handle->delay_in_samples;
+	handle->tap_to = handle->delay_in_samples;
+	smooth_param_reset(&handle->tap_fade, 1.0f);
+	return 0;
 }
 
 /******************************************************************************
-* Function Name: run_fir_filter
+* Function Name: delay_set_tap
 *******************************************************************************
 * Summary:
-*  Run filter function on sample block.
+*  Set up an additional read tap (multi-tap delay). All taps read the one delay line of the
+*  handle, so a pattern of echoes costs no memory beyond the main delay. With AUDIO_CHANNELS 2
+*  each channel has its own handle: the pan sets the share of the tap in the given channel
+*  (constant power), with AUDIO_CHANNELS 1 it is ignored.
 *
 * Parameters:
-*  1. float32_t *src		- Sample in-buffer
-*  2. float32_t *dst		- Sample out-buffer
+*  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+*  2. uint8_t channel			- Channel the handle processes (0 = left, 1 = right).
+*  3. uint8_t tap				- Tap index, 0 to DELAY_MAX_TAPS - 1.
+*  4. float32_t delay_ms			- Delay of the tap in ms, 0 to MAX_DELAY_TIME.
+*  5. float32_t gain				- Gain of the tap, 0 to 1.
+*  6. float32_t pan				- 0 = left, 0.5 = center, 1 = right.
+*  7. float32_t damping			- One-pole low pass on the tap, 0 (off) to 0.99 (darkest).
+* 
 * Return:
-*  None.
-*
+*  255:							- Tap or channel out of range.
+*  254:							- Parameter out of range.
+*	 0:							- Success.
 ******************************************************************************/
-void run_fir_filter(float32_t *src, float32_t *dst)
+uint8_t delay_set_tap(delay_handle_t *handle, uint8_t channel, uint8_t tap, float32_t delay_ms, float32_t gain, float32_t pan, float32_t damping)
 {
-	arm_fir_f32(&fir_filter, &src[0], &dst[0], SAMPLES);
-}
+	if ((tap >= DELAY_MAX_TAPS) || (channel >= AUDIO_CHANNELS))
+		return 255;
+	if ((delay_ms < 0.0f) || (delay_ms > MAX_DELAY_TIME) || (gain < 0.0f) || (gain > 1.0f) || (pan < 0.0f) || (pan > 1.0f)
+		|| (damping < 0.0f) || (damping > 0.99f))
+		return 254;
 
-// ---- Overdrive ----
+	delay_tap_t *t = &handle->taps[tap];
+#if (AUDIO_CHANNELS == 2)
+	const float32_t angle = 0.5f * PI * pan;
+	t->level = gain * ((channel == 0) ? arm_cos_f32(angle) : arm_sin_f32(angle));
+#else
+	t->level = gain;
+#endif
+	t->damping = damping;
+	t->delay_in_samples = delay_samples(handle, delay_ms);
+	return 0;
+}
 
 /******************************************************************************
-* Function Name: overdrive_init
+* Function Name: delay_set_tap_count
 *******************************************************************************
 * Summary:
-*  Initializes the overdrive struct.
+*  Set the number of additional taps that are read (the first count taps set with
+*  delay_set_tap). A tap switched on starts with a cleared low pass.
 *
 * Parameters:
-*  1. overdrive_handle_t *handle		- Address pointer of overdrive handle struct.
-*  2. float32_t *in_buffer				- Address pointer of the sample in-buffer.
-*  3. float32_t *out_buffer				- Address pointer of the sample out-buffer.
-*  4. float32_t threshold				- Threshold value for the overdrive algorithm. Must be between 0 and 0.4
+*  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+*  2. uint8_t count				- 0 (main tap only) to DELAY_MAX_TAPS.
+* 
 * Return:
-*  255:									- Sample buffers point to NULL
-*  254:									- Threshold value out of range.
-*    0:									- Success.
-*
+*  255:							- Count out of range.
+*	 0:							- Success.
 ******************************************************************************/
-uint8_t overdrive_init(overdrive_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t threshold)
+uint8_t delay_set_tap_count(delay_handle_t *handle, uint8_t count)
 {
-	if ((in_buffer == NULL) || (out_buffer == NULL)) 
-	{
+	if (count > DELAY_MAX_TAPS)
 		return 255;
-	}
-	if ((threshold <= 0) || (threshold > 0.4f))
+
+	for (uint8_t t = handle->tap_count; t < count; ++t)
 	{
-		return 254;
+		handle->taps[t].state = 0.0f;
+		handle->taps[t].state_q31 = 0;
 	}
-	
-	handle->src = in_buffer;
-	handle->dst = out_buffer;
-	handle->threshold = threshold;
+	handle->tap_count = count;
 	return 0;
 }
 
 /******************************************************************************
-* Function Name: overdrive_update
+* Function Name: delay_set_decimation
 *******************************************************************************
 * Summary:
-*  Updates overdrive threshold parameter.
+*  Run the wet path (line, taps) at the sample rate divided by factor between the filters of
+*  multirate.h. A dark delay loses nothing above the lowered Nyquist frequency, the line holds
+*  the same time in a factor times smaller part of the pool and the taps process a factor
+*  times shorter block. The dry signal stays at the full rate and undelayed. The delay times
+*  (main and taps) are converted to the new rate and shortened by the lag of the filters, so
+*  the echoes come on time. Set before the delay takes its line.
 *
 * Parameters:
-*  1. overdrive_handle_t *handle				- Address pointer of overdrive handle struct.
-*  2. float32_t threshold						- The new threshold value. Needs to be between 0 and 0.4.
+*  1. delay_handle_t *handle	- Address pointer of an initialized delay handle struct.
+*  2. uint8_t factor				- 1 (off), 2 or 4.
+* 
 * Return:
-*  255:											- Threshold value out of range.
-*    0:											- Success.
-*
+*  254:							- Factor not supported.
+*  253:							- The delay holds its line, or the filter memory pool is exhausted.
+*	 0:							- Success.
 ******************************************************************************/
-uint8_t overdrive_update(overdrive_handle_t *handle, float32_t threshold)
+uint8_t delay_set_decimation(delay_handle_t *handle, uint8_t factor)
 {
-	if ((threshold <= 0) || (threshold > 0.4f))
-	{		
-		return 255;
+	const uint32_t divider = delay_divider(handle);
+	if (factor == divider)
+		return 0;
+	if (handle->delay_line.buffer != NULL)
+		return 253;
+	const uint32_t old_lag = delay_lag(handle);
+	const uint8_t result = multirate_init(&handle->multirate, factor);
+	if (result != 0)
+		return (result == 254) ? 254 : 253;
+
+	handle->decimation = factor;
+	handle->delay_in_samples = delay_samples(handle, handle->delay_ms);
+	const uint32_t lag = delay_lag(handle);
+	for (uint8_t t = 0; t < DELAY_MAX_TAPS; ++t)
+	{
+		const uint32_t samples = (handle->taps[t].delay_in_samples + old_lag) * divider / factor;
+		handle->taps[t].delay_in_samples = (samples > lag) ? samples - lag : 0;
 	}
-	handle->threshold = threshold;
+	delay_reset(handle);
 	return 0;
 }
 
 /******************************************************************************
-* Function Name: run_delay
+* Function Name: delay_read_moving
 *******************************************************************************
 * Summary:
-*  Add delay to the sample block.
+*  Read the delayed block while the delay time glides. A float32 line is read with a
+*  fractional tap that moves along the ramp of the time, which is smooth at any speed. A
+*  packed line can't be read at fractional positions: the block is crossfaded from the tap at
+*  the start to the tap at the end of the ramp instead.
 *
 * Parameters:
-*  1. overdrive_handle_t *handle			- Address pointer of overdrive handle struct.
+*  1. const delay_line_t *dl			- Delay line of the delay.
+*  2. float32_t *dst					- Output block.
+*  3. const smooth_param_t *time		- Delay time in samples, ramping.
+*  4. uint32_t block_size				- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* 
 * Return:
 *  None.
 *
 ******************************************************************************/
 #pragma optimize_for_speed
-void run_overdrive(overdrive_handle_t *handle)
+ITCM_CODE static void delay_read_moving(const delay_line_t *dl, float32_t *dst, const smooth_param_t *time, uint32_t block_size)
 {
-	float32_t abs[PING_PONG_BUFFER_SIZE];
-	for (int i = 0; i < PING_PONG_BUFFER_SIZE; ++i)
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *scratch = scratch_pool_alloc(block_size * sizeof(float32_t));
+	if (dl->format == DELAY_LINE_F32)
 	{
-		if (abs[i] == 0)
-			handle->dst[i] = 0;
-		else if (abs[i] < handle->threshold)
-			handle->dst[i] = 2 * handle->src[i];		
-		else if (abs[i] > 2 * handle->threshold)
-		{
-			if (handle->src[i] > 0)
-				handle->dst[i] = 1;
-			else
-				handle->dst[i] = -1;	
-		}
-		else if (abs[i] >= handle->threshold)
-		{
-			if (handle->src[i] > 0)
-				handle->dst[i] = (3 - ((2 - abs[i] * 3) * (2 - abs[i] * 3)) / 3);
-			else
-				handle->dst[i] = - (3 - ((2 - abs[i] * 3) * (2 - abs[i] * 3)) / 3);	
-		}		
+		smooth_param_ramp(time, scratch, block_size);
+		delay_line_read_fractional(dl, dst, scratch, DELAY_LINE_LINEAR, block_size);
+	}
+	else
+	{
+		const smooth_param_t fade = { .start = 0.0f, .end = 1.0f };
+		delay_line_read(dl, dst, (uint32_t)time->start, block_size);
+		delay_line_read(dl, scratch, (uint32_t)time->end, block_size);
+		smooth_param_mix(&fade, dst, scratch, dst, block_size);
 	}
+	scratch_pool_release(mark);
 }
 
-// ---- Fuzz ----
-
 /******************************************************************************
-* Function Name: fuzz_init
+* Function Name: delay_jump_start
 *******************************************************************************
 * Summary:
-*  Initizalize the fuzz struct.
+*  DELAY_TIME_JUMP: start the crossfade to a new delay time. A time set during a running
+*  crossfade waits for its end, so at most two taps are read per block.
 *
 * Parameters:
-*  1. fuzz_handle_t *handle				- Address pointer of fuzz handle struct.
-*  2. float32_t *in_buffer				- Address pointer of sample in-buffer.
-*  3. float32_t *out_buffer				- Address pointer of sample out-buffer.
-*  4. float32_t gain					- Amplitification gain value of the fuzz algorithm. Range: 0 < gain <= 18.
-*  5. float32_t mix						- Relative ratio of distorted (wet) signal to dry signal. Range: 0 < mix < 1.
+*  1. delay_handle_t *delay		- Address pointer of delay handle struct.
+*  2. uint32_t block_size		- Number of samples.
+* 
 * Return:
-*  255:									- Sample buffers point to NULL.
-*  254:									- Gain or mix values are out of range.
-*    0:									- Success.
+*  true while the crossfade runs (read tap_from and tap_to), false if only tap_to is read.
 *
 ******************************************************************************/
-uint8_t fuzz_init(fuzz_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t gain, float32_t mix)
+#pragma optimize_for_speed
+ITCM_CODE static bool delay_jump_start(delay_handle_t *delay, uint32_t block_size)
 {
-	if ((in_buffer == NULL) || (out_buffer == NULL)) 
-	{
-		return 255;
-	}
-	if ((gain < 0) || (gain > 18) || (mix < 0) || (mix >= 1))
+	const uint32_t target = delay->delay_in_samples;
+	if ((target != delay->tap_to) && (smooth_param_value(&delay->tap_fade) >= 1.0f))
 	{
-		return 254;
+		delay->tap_from = delay->tap_to;
+		delay->tap_to = target;
+		smooth_param_reset(&delay->tap_fade, 0.0f);
 	}
-	
-	handle->src = in_buffer;
-	handle->dst = out_buffer;
-	handle->gain = gain;
-	handle->mix = gain;
-	
-	return 0;
+	return smooth_param_next(&delay->tap_fade, 1.0f, block_size);
 }
 
 /******************************************************************************
-* Function Name: fuzz_update
+* Function Name: delay_add_taps
 *******************************************************************************
 * Summary:
-*  Update fuzz parameters.
+*  Add the additional taps to the wet block in one pass per tap: read the block, low pass it
+*  and accumulate it with the tap level. The taps are read at whole sample positions.
 *
 * Parameters:
-*  1. fuzz_handle_t *handle				- Address pointer of fuzz handle struct.
-*  2. fuzz_parameter pm					- Enum of fuzz parameters.
-*  3. float32_t value					- The new value of the parameter.
+*  1. delay_handle_t *delay		- Address pointer of delay handle struct.
+*  2. float32_t *wet				- Wet block of the main tap, the taps are added to it.
+*  3. uint32_t block_size		- Number of samples. Must not exceed MAX_BLOCK_SIZE.
 * 
 * Return:
-*  255:									- Parameter value are out of range.
-*    0:									- Success.
+*  None.
 *
 ******************************************************************************/
-uint8_t fuzz_update(fuzz_handle_t *handle, fuzz_parameter pm, float32_t value)
+#pragma optimize_for_speed
+ITCM_CODE static void delay_add_taps(delay_handle_t *delay, float32_t *wet, uint32_t block_size)
 {
-	switch (pm)
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *tapped = scratch_pool_alloc(block_size * sizeof(float32_t));
+	const uint8_t count = delay->tap_count;
+	for (uint8_t t = 0; t < count; ++t)
 	{
-		case GAIN:
-			if ((value < 0) || (value > 18))
-				return 255;
-			handle->gain = value;
-			break;
-		case MIX:
-			if ((value < 0) || (value >= 1))
-				return 255;
-			handle->mix = value;
-			break;		
+		delay_tap_t *tap = &delay->taps[t];
+		const float32_t level = tap->level;
+		const float32_t a = tap->damping;
+		const float32_t b = 1.0f - a;
+		float32_t y = tap->state;
+
+		delay_line_read(&delay->delay_line, tapped, tap->delay_in_samples, block_size);
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			y = b * tapped[i] + a * y;
+			wet[i] += level * y;
+		}
+		tap->state = y;
 	}
-	
-	return 0;
+	scratch_pool_release(mark);
 }
 
-
 /******************************************************************************
-* Function Name: run_fuzz
+* Function Name: delay_add_taps_q31
 *******************************************************************************
 * Summary:
-*  Run fuzz algorithm on sample block.
+*  q31 version of delay_add_taps. The sum saturates.
 *
 * Parameters:
-*  1. fuzz_handle_t *handle				- Address pointer of fuzz handle struct.
+*  1. delay_handle_t *delay		- Address pointer of delay handle struct.
+*  2. q31_t *wet					- Wet block of the main tap, the taps are added to it.
+*  3. uint32_t block_size		- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* 
 * Return:
 *  None.
 *
 ******************************************************************************/
 #pragma optimize_for_speed
-void run_fuzz(fuzz_handle_t *handle)
+ITCM_CODE static void delay_add_taps_q31(delay_handle_t *delay, q31_t *wet, uint32_t block_size)
 {
-	float32_t z[PING_PONG_BUFFER_SIZE];
-	float32_t max_z = 0;
-	for (int i = 0; i < PING_PONG_BUFFER_SIZE; ++i)
+	const scratch_mark_t mark = scratch_pool_mark();
+	q31_t *tapped = scratch_pool_alloc(block_size * sizeof(q31_t));
+	const uint8_t count = delay->tap_count;
+	for (uint8_t t = 0; t < count; ++t)
 	{
-		// multiply sample with gain and then normalize by dividing by positive max-value
-		float32_t q = handle->src[i] * handle->gain / (1 << 24);
-		if (q != 0)
-		{
-			z[i] = -q / fabs(q) * (1 - expf(-q / fabs(q) * q));
+		delay_tap_t *tap = &delay->taps[t];
+		const q31_t level = clip_q63_to_q31((q63_t)(tap->level * 2147483648.0f));
+		const q31_t a = (q31_t)(tap->damping * 2147483647.0f);
+		const q31_t b = 0x7FFFFFFF - a;
+		q31_t y = tap->state_q31;
 
-			if (z[i] > max_z)
-				max_z = z[i];
+		delay_line_read_q31(&delay->delay_line, tapped, tap->delay_in_samples, block_size);
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			y = (q31_t)((((q63_t)b * tapped[i]) + ((q63_t)a * y)) >> 31);
+			wet[i] = clip_q63_to_q31((q63_t)wet[i] + (((q63_t)level * y) >> 31));
 		}
-		else 
-			z[i] = 0;
-	}
-	for (int i = 0; i < PING_PONG_BUFFER_SIZE; ++i)
-	{
-		handle->dst[i] = handle->mix * z[i] * (1 << 24) / max_z + (1 - handle->mix) * handle->src[i];
+		tap->state_q31 = y;
 	}
+	scratch_pool_release(mark);
 }
 
-// ---- Tremolo ----
+// gain of the wet signal for the next block: 1 minus the duck amount times the detector level. true if the wet signal
+// has to be scaled (one multiply per sample), false while the delay doesn't duck
+#pragma optimize_for_speed
+ITCM_CODE static inline bool delay_duck_next(delay_handle_t *delay, uint32_t block_size)
+{
+	const volatile float32_t *level = delay->duck_level;
+	const float32_t depth = (level != NULL) ? delay->duck * fminf(*level * (1.0f / DELAY_DUCK_FULL_LEVEL), 1.0f) : 0.0f;
+	return (smooth_param_next(&delay->duck_smooth, 1.0f - depth, block_size) || (smooth_param_value(&delay->duck_smooth) < 1.0f)) ? true : false;
+}
 
 /******************************************************************************
-* Function Name: tremolo_init
+* Function Name: delay_read_wet
 *******************************************************************************
 * Summary:
-*  Initialize tremolo handle struct.
+*  Read the wet block: the main tap (jumping, gliding or still) and the additional taps. The
+*  delay time moves on by step samples of the full rate, so the glide and the crossfade take
+*  the same time with a decimated wet path.
 *
 * Parameters:
-*  1. tremolo_handle_t *handle				- Address pointer of tremolo handle struct.
-*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
-*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
-*  4. float32_t rate						- Allows modifying the LFO frequency. Range: 0 < rate < 1.
-*  5. float32_t depth						- Modulation depth. Range: 0 <= depth <= 1.
+*  1. delay_handle_t *delay		- Address pointer of delay handle struct.
+*  2. float32_t *wet				- Output block.
+*  3. uint32_t block_size		- Number of samples at the rate of the line. Must not exceed MAX_BLOCK_SIZE.
+*  4. uint32_t step				- Number of samples of the full rate block.
+* 
 * Return:
-*  255:										- Sample buffers point to NULL.
-*  254:										- Rate or depth values are out of range.
-*    0:										- Success.
+*  None.
 *
 ******************************************************************************/
-uint8_t tremolo_init(tremolo_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth)
+#pragma optimize_for_speed
+ITCM_CODE static void delay_read_wet(delay_handle_t *delay, float32_t *wet, uint32_t block_size, uint32_t step)
 {
-	if ((in_buffer == NULL) || (out_buffer == NULL)) 
-	{
-		return 255;
-	}
-	if ((rate < 0) || (rate > 1) || (depth < 0) || (depth > 1))
+	const scratch_mark_t mark = scratch_pool_mark();
+	if (delay->time_mode == DELAY_TIME_JUMP)
 	{
-		return 254;
+		if (delay_jump_start(delay, step))
+		{
+			float32_t *faded_in = scratch_pool_alloc(block_size * sizeof(float32_t));
+			delay_line_read(&delay->delay_line, wet, delay->tap_from, block_size);
+			delay_line_read(&delay->delay_line, faded_in, delay->tap_to, block_size);
+			smooth_param_mix(&delay->tap_fade, wet, faded_in, wet, block_size);
+		}
+		else
+			delay_line_read(&delay->delay_line, wet, delay->tap_to, block_size);
 	}
-
-	handle->src = in_buffer;
-	handle->dst = out_buffer;
-	handle->rate = rate;
-	handle->depth = depth;
-	handle->time = 0;
-
-	return 0;
+	else if (smooth_param_next(&delay->time_smooth, (float32_t)delay->delay_in_samples, step))
+		delay_read_moving(&delay->delay_line, wet, &delay->time_smooth, block_size);
+	else
+		delay_line_read(&delay->delay_line, wet, (uint32_t)smooth_param_value(&delay->time_smooth), block_size);
+	delay_add_taps(delay, wet, block_size);
+	scratch_pool_release(mark);
 }
 
 /******************************************************************************
-* Function Name: tremolo_update
+* Function Name: delay_read_wet_q31
 *******************************************************************************
 * Summary:
-*  Update tremolo parameters.
+*  q31 version of delay_read_wet. A gliding delay time crossfades between the taps.
 *
 * Parameters:
-*  1. tremolo_handle_t *handle				- Address pointer of tremolo handle struct.
-*  2. modulation_parameter pm				- Enum of modulation parameters.
+*  1. delay_handle_t *delay		- Address pointer of delay handle struct.
+*  2. q31_t *wet					- Output block.
+*  3. uint32_t block_size		- Number of samples at the rate of the line. Must not exceed MAX_BLOCK_SIZE.
+*  4. uint32_t step				- Number of samples of the full rate block.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void delay_read_wet_q31(delay_handle_t *delay, q31_t *wet, uint32_t block_size, uint32_t step)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	if (delay->time_mode == DELAY_TIME_JUMP)
+	{
+		if (delay_jump_start(delay, step))
+		{
+			q31_t *faded_in = scratch_pool_alloc(block_size * sizeof(q31_t));
+			delay_line_read_q31(&delay->delay_line, wet, delay->tap_from, block_size);
+			delay_line_read_q31(&delay->delay_line, faded_in, delay->tap_to, block_size);
+			smooth_param_mix_q31(&delay->tap_fade, wet, faded_in, wet, block_size);
+		}
+		else
+			delay_line_read_q31(&delay->delay_line, wet, delay->tap_to, block_size);
+	}
+	else if (smooth_param_next(&delay->time_smooth, (float32_t)delay->delay_in_samples, step))
+	{
+		const smooth_param_t fade = { .start = 0.0f, .end = 1.0f };
+		q31_t *moved = scratch_pool_alloc(block_size * sizeof(q31_t));
+		delay_line_read_q31(&delay->delay_line, wet, (uint32_t)delay->time_smooth.start, block_size);
+		delay_line_read_q31(&delay->delay_line, moved, (uint32_t)delay->time_smooth.end, block_size);
+		smooth_param_mix_q31(&fade, wet, moved, wet, block_size);
+	}
+	else
+	{
+		delay_line_read_q31(&delay->delay_line, wet, (uint32_t)smooth_param_value(&delay->time_smooth), block_size);
+	}
+	delay_add_taps_q31(delay, wet, block_size);
+	scratch_pool_release(mark);
+}
+
+// DELAY_DECIMATION: the wet path as a multirate_node, run on the decimated block. the input is already scaled by the
+// feedback. the filters of multirate.h are in sample_t, the chain this build runs
+#pragma optimize_for_speed
+ITCM_CODE static void delay_wet_node(void *ctx, const sample_t *in, sample_t *out, uint32_t n)
+{
+	delay_handle_t *delay = ctx;
+#if defined(SAMPLE_Q31)
+	delay_line_write_q31(&delay->delay_line, in, n);
+	delay_read_wet_q31(delay, out, n, n * delay_divider(delay));
+#else
+	delay_line_write(&delay->delay_line, in, n);
+	delay_read_wet(delay, out, n, n * delay_divider(delay));
+#endif
+}
+
+/******************************************************************************
+* Function Name: run_delay
+*******************************************************************************
+* Summary:
+*  Processes a sample block. Writes the current sample with adjusted feedback amplitude into a buffer.
+*  With delay_set_decimation the wet path runs at the lower rate (not with SAMPLE_Q31, the q31
+*  chain calls run_delay_q31), feedback, ducking and blend stay at the full rate.
+*
+* Parameters:
+*  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+*  2. uint32_t block_size		- Number of samples in the in/out buffers.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_delay(delay_handle_t *delay, uint32_t block_size)
+{	
+	const scratch_mark_t mark = scratch_pool_mark();
+	// read parameters once per block
+	smooth_param_next(&delay->blend_smooth, delay->blend, block_size);
+	
+#if !defined(SAMPLE_Q31)
+	if (delay_divider(delay) > 1)
+	{
+		// the feedback scales the input at the full rate, so a scheduled value lands on its sample
+		float32_t *fed = scratch_pool_alloc(block_size * sizeof(float32_t));
+		if (smooth_param_next(&delay->feedback_smooth, delay->feedback, block_size))
+			smooth_param_scale(&delay->feedback_smooth, delay->src, fed, block_size);
+		else
+			arm_scale_f32(delay->src, smooth_param_value(&delay->feedback_smooth), fed, block_size);
+		multirate_process(&delay->multirate, fed, delay->dst, block_size, delay_wet_node, delay);
+	}
+	else
+#endif
+	{
+		// save input block with adjusted feedback amplitude to delay line
+		if (smooth_param_next(&delay->feedback_smooth, delay->feedback, block_size))
+		{
+			float32_t *scaled = scratch_pool_alloc(block_size * sizeof(float32_t));
+			smooth_param_scale(&delay->feedback_smooth, delay->src, scaled, block_size);
+			delay_line_write(&delay->delay_line, scaled, block_size);
+		}
+		else
+		{
+			delay_line_write_scaled(&delay->delay_line, delay->src, smooth_param_value(&delay->feedback_smooth), block_size);
+		}
+		// get the block at max delay depth and sum it with the input
+		delay_read_wet(delay, delay->dst, block_size, block_size);
+	}
+	if (delay_duck_next(delay, block_size))
+		smooth_param_scale(&delay->duck_smooth, delay->dst, delay->dst, block_size);
+	smooth_param_mix(&delay->blend_smooth, delay->src, delay->dst, delay->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+/******************************************************************************
+* Function Name: run_delay_q31
+*******************************************************************************
+* Summary:
+*  q31 version of run_delay for the SAMPLE_Q31 chain. The delay line stores the q31 samples,
+*  feedback and blend are applied with the q31 smoothing functions. The line can't be read at
+*  fractional positions, a gliding delay time crossfades between the taps (see delay_read_moving).
+*
+* Parameters:
+*  1. delay_handle_t *handle	- Address pointer of delay handle struct.
+*  2. const q31_t *src			- Input block.
+*  3. q31_t *dst				- Output block.
+*  4. uint32_t block_size		- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_delay_q31(delay_handle_t *delay, const q31_t *src, q31_t *dst, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	smooth_param_next(&delay->blend_smooth, delay->blend, block_size);
+
+#if defined(SAMPLE_Q31)
+	if (delay_divider(delay) > 1)
+	{
+		q31_t *fed = scratch_pool_alloc(block_size * sizeof(q31_t));
+		if (smooth_param_next(&delay->feedback_smooth, delay->feedback, block_size))
+			smooth_param_scale_q31(&delay->feedback_smooth, src, fed, block_size);
+		else
+			arm_scale_q31(src, smooth_param_value_q31(&delay->feedback_smooth), 0, fed, block_size);
+		multirate_process(&delay->multirate, fed, dst, block_size, delay_wet_node, delay);
+	}
+	else
+#endif
+	{
+		if (smooth_param_next(&delay->feedback_smooth, delay->feedback, block_size))
+		{
+			q31_t *scaled = scratch_pool_alloc(block_size * sizeof(q31_t));
+			smooth_param_scale_q31(&delay->feedback_smooth, src, scaled, block_size);
+			delay_line_write_q31(&delay->delay_line, scaled, block_size);
+		}
+		else
+		{
+			delay_line_write_scaled_q31(&delay->delay_line, src, smooth_param_value_q31(&delay->feedback_smooth), block_size);
+		}
+		delay_read_wet_q31(delay, dst, block_size, block_size);
+	}
+	if (delay_duck_next(delay, block_size))
+		smooth_param_scale_q31(&delay->duck_smooth, dst, dst, block_size);
+	smooth_param_mix_q31(&delay->blend_smooth, src, dst, dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Filter ----
+// one filter per channel, the state is taken from the fir_filter.c pool (sized for the taps and MAX_BLOCK_SIZE)
+static fir_filter_t fir_filter[AUDIO_CHANNELS];
+// bank of the lowpass only (see init_fir_filter), replaced by load_fir_filter_bank
+static const float32_t *fir_default_bank[1];
+
+// filter taps/coeffs: Hamming windowed sinc lowpass at 2725 Hz (48 kHz), generated with dsp_helpers.export_fir_header.
+// change the design in the header line and export it again, nothing is computed at startup
+#include "filter_taps.h"
+_Static_assert(FILTER_TAPS_LENGTH == NUM_TAPS, "filter_taps.h has to be exported with NUM_TAPS taps");
+// fir state size is (number of samples + number of fir tabs - 1)
+#if defined(SAMPLE_Q31)
+static arm_fir_instance_q31 fir_filter_q31[AUDIO_CHANNELS];
+static q31_t fir_taps_q31[NUM_TAPS] DTCM_BSS;
+static q31_t fir_state_q31[AUDIO_CHANNELS][MAX_BLOCK_SIZE + NUM_TAPS - 1] DTCM_BSS;
+#endif
+
+/******************************************************************************
+* Function Name: init_fir_filter
+*******************************************************************************
+* Summary:
+*  Initialize the filters of all channels with a single coefficient set. Also clears the
+*  filter states. The states are sized for MAX_BLOCK_SIZE, so every block size can be filtered.
+*
+* Parameters:
+*  1. float32_t *filter_taps		- Filter coefficients. More taps make the filter more accurate, but introduce
+*									  more delay into the system.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+void init_fir_filter(float32_t  *filter_taps)
+{
+	fir_default_bank[0] = filter_taps;
+	load_fir_filter_bank(fir_default_bank, 1, NUM_TAPS);
+#if defined(SAMPLE_Q31)
+	arm_float_to_q31(filter_taps, fir_taps_q31, NUM_TAPS);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		arm_fir_init_q31(&fir_filter_q31[ch], NUM_TAPS, fir_taps_q31, &fir_state_q31[ch][0], MAX_BLOCK_SIZE);
+	}
+#endif
+}
+
+/******************************************************************************
+* Function Name: run_fir_filter
+*******************************************************************************
+* Summary:
+*  Run filter function on sample block. Every channel has its own filter state.
+*
+* Parameters:
+*  1. uint8_t channel		- Channel index (0 = left, 1 = right)
+*  2. float32_t *src		- Sample in-buffer
+*  3. float32_t *dst		- Sample out-buffer
+*  4. uint32_t block_size	- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+ITCM_CODE void run_fir_filter(uint8_t channel, float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	fir_filter_process(&fir_filter[channel], src, dst, block_size);
+}
+
+/******************************************************************************
+* Function Name: load_fir_filter_bank
+*******************************************************************************
+* Summary:
+*  Give the filters of all channels a bank of coefficient sets (e.g. cabinet responses), starting
+*  with set 0. Clears the filter states. The SAMPLE_Q31 chain keeps the lowpass of init_fir_filter.
+*
+* Parameters:
+*  1. const float32_t *const *bank	- Coefficient sets, taps each, time reversed (CMSIS order).
+*  2. uint8_t sets					- Number of sets in the bank.
+*  3. uint16_t taps					- Taps of every set. Range: 1 to FIR_FILTER_MAX_TAPS.
+* Return:
+*  Error code of fir_filter_init (0 = success).
+*
+******************************************************************************/
+uint8_t load_fir_filter_bank(const float32_t *const *bank, uint8_t sets, uint16_t taps)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		const uint8_t status = fir_filter_init(&fir_filter[ch], bank, sets, taps);
+		if (status != 0)
+			return status;
+	}
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: select_fir_filter
+*******************************************************************************
+* Summary:
+*  Switch all channels to another set of the bank. Takes effect with the next block, which is
+*  faded from the old to the new set (see fir_filter_process).
+*
+* Parameters:
+*  1. uint8_t set					- Set of the bank loaded last.
+* Return:
+*  Error code of fir_filter_select (0 = success).
+*
+******************************************************************************/
+uint8_t select_fir_filter(uint8_t set)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		const uint8_t status = fir_filter_select(&fir_filter[ch], set);
+		if (status != 0)
+			return status;
+	}
+	return 0;
+}
+
+// group delay of the filters in samples: (taps - 1) / 2, 18 for the lowpass of NUM_TAPS = 37. a loaded bank is taken
+// as linear phase like the lowpass
+uint32_t fir_filter_latency(void)
+{
+#if defined(SAMPLE_Q31)
+	return (NUM_TAPS - 1) / 2;
+#else
+	return (fir_filter[0].fir.numTaps - 1) / 2;
+#endif
+}
+
+#if defined(SAMPLE_Q31)
+/******************************************************************************
+* Function Name: run_fir_filter_q31
+*******************************************************************************
+* Summary:
+*  q31 version of run_fir_filter (SAMPLE_Q31 chain). Uses the fast CMSIS FIR with a 32 bit
+*  accumulator in 2.30 format: one guard bit, enough for this lowpass (sum of the absolute
+*  tap values is about 1.2).
+*
+* Parameters:
+*  1. uint8_t channel		- Channel index (0 = left, 1 = right)
+*  2. const q31_t *src		- Sample in-buffer
+*  3. q31_t *dst			- Sample out-buffer
+*  4. uint32_t block_size	- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+ITCM_CODE void run_fir_filter_q31(uint8_t channel, const q31_t *src, q31_t *dst, uint32_t block_size)
+{
+	arm_fir_fast_q31(&fir_filter_q31[channel], (q31_t *)src, dst, block_size);
+}
+#endif
+
+// ---- Equalizer ----
+
+// band frequencies of the tone stack. the mid band is adjustable (eq_update EQ_MID_FREQUENCY)
+#define EQ_BASS_HZ 120.0f
+#define EQ_TREBLE_HZ 3200.0f
+#define EQ_MID_Q 0.7f
+// gain range of every band in dB
+#define EQ_MAX_GAIN_DB 12.0f
+
+// filter states of all equalizers (2 per band for the transposed direct form II), taken from the pool by eq_init
+static float32_t eq_state[EQ_MAX_INSTANCES][2 * EQ_BANDS] DTCM_BSS;
+static uint8_t eq_state_used = 0;
+
+typedef enum
+{
+	LOW_SHELF = 0,
+	PEAKING,
+	HIGH_SHELF
+} band_type;
+
+/******************************************************************************
+* Function Name: band_coeffs
+*******************************************************************************
+* Summary:
+*  Biquad coefficients of one band (Audio EQ Cookbook, R. Bristow-Johnson). Shelves with
+*  slope 1. Written in the CMSIS order {b0, b1, b2, a1, a2}, normalized to a0 = 1 and with
+*  the feedback coefficients negated (arm_biquad_cascade_df2T_f32 adds them).
+*
+* Parameters:
+*  1. float32_t *c					- Output: the 5 coefficients of the stage.
+*  2. band_type type				- LOW_SHELF, PEAKING or HIGH_SHELF.
+*  3. float32_t frequency			- Corner (shelf) or center (peaking) frequency in Hz.
+*  4. float32_t q					- Quality factor of the peaking band.
+*  5. float32_t gain_db				- Gain of the band in dB.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void band_coeffs(float32_t *c, band_type type, float32_t frequency, float32_t q, float32_t gain_db)
+{
+	const float32_t A = powf(10.0f, gain_db / 40.0f);
+	const float32_t w0 = 2.0f * PI * frequency / Fs;
+	const float32_t cs = cosf(w0);
+	const float32_t sn = sinf(w0);
+	float32_t b0, b1, b2, a0, a1, a2;
+
+	if (type == PEAKING)
+	{
+		const float32_t alpha = sn / (2.0f * q);
+		b0 = 1.0f + alpha * A;
+		b1 = -2.0f * cs;
+		b2 = 1.0f - alpha * A;
+		a0 = 1.0f + alpha / A;
+		a1 = -2.0f * cs;
+		a2 = 1.0f - alpha / A;
+	}
+	else
+	{
+		// slope 1: alpha = sin(w0) / 2 * sqrt(2)
+		const float32_t beta = 2.0f * sqrtf(A) * (sn / 2.0f * 1.41421356f);
+		const float32_t sign = (type == LOW_SHELF) ? 1.0f : -1.0f;
+		b0 = A * ((A + 1.0f) - sign * (A - 1.0f) * cs + beta);
+		b1 = sign * 2.0f * A * ((A - 1.0f) - sign * (A + 1.0f) * cs);
+		b2 = A * ((A + 1.0f) - sign * (A - 1.0f) * cs - beta);
+		a0 = (A + 1.0f) + sign * (A - 1.0f) * cs + beta;
+		a1 = -sign * 2.0f * ((A - 1.0f) + sign * (A + 1.0f) * cs);
+		a2 = (A + 1.0f) + sign * (A - 1.0f) * cs - beta;
+	}
+
+	c[0] = b0 / a0;
+	c[1] = b1 / a0;
+	c[2] = b2 / a0;
+	c[3] = -a1 / a0;
+	c[4] = -a2 / a0;
+}
+
+// all bands of the current parameters into one coefficient set
+static void eq_design(const eq_handle_t *handle, float32_t *coeffs)
+{
+	band_coeffs(&coeffs[0], LOW_SHELF, EQ_BASS_HZ, 0.0f, handle->gain_db[EQ_BASS]);
+	band_coeffs(&coeffs[5], PEAKING, handle->mid_frequency, EQ_MID_Q, handle->gain_db[EQ_MID]);
+	band_coeffs(&coeffs[10], HIGH_SHELF, EQ_TREBLE_HZ, 0.0f, handle->gain_db[EQ_TREBLE]);
+}
+
+/******************************************************************************
+* Function Name: eq_init
+*******************************************************************************
+* Summary:
+*  Initialize an equalizer (tone stack): low shelf at EQ_BASS_HZ, peaking band at 800 Hz
+*  (adjustable) and high shelf at EQ_TREBLE_HZ, cascaded in one transposed direct form II
+*  biquad cascade. The filter state is taken from a pool in DTCM the first time, later
+*  calls reuse it.
+*
+* Parameters:
+*  1. eq_handle_t *handle				- Address pointer of the equalizer handle struct.
+*  2. float32_t *in_buffer				- Address pointer of the sample in-buffer.
+*  3. float32_t *out_buffer				- Address pointer of the sample out-buffer.
+*  4. float32_t bass_db					- Gains of the bands in dB. Range: -EQ_MAX_GAIN_DB to EQ_MAX_GAIN_DB.
+*  5. float32_t mid_db
+*  6. float32_t treble_db
+* Return:
+*  255:									- Sample buffers point to NULL.
+*  254:									- Gain out of range.
+*  253:									- State pool exhausted (see EQ_MAX_INSTANCES).
+*    0:									- Success.
+*
+******************************************************************************/
+uint8_t eq_init(eq_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t bass_db, float32_t mid_db, float32_t treble_db)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	if ((fabsf(bass_db) > EQ_MAX_GAIN_DB) || (fabsf(mid_db) > EQ_MAX_GAIN_DB) || (fabsf(treble_db) > EQ_MAX_GAIN_DB))
+	{
+		return 254;
+	}
+	float32_t *state = handle->biquad.pState;
+	if (state == NULL)
+	{
+		if (eq_state_used >= EQ_MAX_INSTANCES)
+		{
+			return 253;
+		}
+		state = eq_state[eq_state_used++];
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->gain_db[EQ_BASS] = bass_db;
+	handle->gain_db[EQ_MID] = mid_db;
+	handle->gain_db[EQ_TREBLE] = treble_db;
+	handle->mid_frequency = 800.0f;
+	eq_design(handle, handle->coeffs[0]);
+	handle->active = 0;
+	handle->used = 0;
+	// clears the state
+	arm_biquad_cascade_df2T_init_f32(&handle->biquad, EQ_BANDS, handle->coeffs[0], state);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: eq_update
+*******************************************************************************
+* Summary:
+*  Change a band and recompute the coefficients. The new set is written into a set the audio
+*  interrupt doesn't read and then published (same scheme as waveshaper_build), so this is
+*  called from the main loop, never from the audio path.
+*
+* Parameters:
+*  1. eq_handle_t *handle				- Address pointer of an initialized equalizer handle struct.
+*  2. eq_parameter pm					- EQ_BASS, EQ_MID, EQ_TREBLE (gain in dB) or EQ_MID_FREQUENCY (Hz).
+*  3. float32_t value					- Gain: -EQ_MAX_GAIN_DB to EQ_MAX_GAIN_DB. Mid frequency: 200 to 5000 Hz.
+* Return:
+*  255:									- Value out of range.
+*    0:									- Success.
+*
+******************************************************************************/
+uint8_t eq_update(eq_handle_t *handle, eq_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+	case EQ_BASS:
+	case EQ_MID:
+	case EQ_TREBLE:
+		if (fabsf(value) > EQ_MAX_GAIN_DB)
+			return 255;
+		handle->gain_db[pm] = value;
+		break;
+	case EQ_MID_FREQUENCY:
+		if ((value < 200.0f) || (value > 5000.0f))
+			return 255;
+		handle->mid_frequency = value;
+		break;
+	default:
+		return 255;
+	}
+
+	// the audio interrupt reads at most active and used, the third set is free
+	const uint8_t active = handle->active;
+	const uint8_t used = handle->used;
+	uint8_t next = 0;
+	while ((next == active) || (next == used))
+		++next;
+
+	eq_design(handle, handle->coeffs[next]);
+	// the set has to be complete before the interrupt can see the new index
+	__DMB();
+	handle->active = next;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: run_eq
+*******************************************************************************
+* Summary:
+*  Filter a block with the equalizer. A coefficient set published by eq_update is taken over
+*  at the block start, the transposed direct form II keeps its state across the switch.
+*
+* Parameters:
+*  1. eq_handle_t *handle				- Address pointer of equalizer handle struct.
+*  2. uint32_t block_size				- Number of samples in the in/out buffers.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_eq(eq_handle_t *handle, uint32_t block_size)
+{
+	const uint8_t active = handle->active;
+	if (active != handle->used)
+	{
+		handle->biquad.pCoeffs = handle->coeffs[active];
+		handle->used = active;
+	}
+	arm_biquad_cascade_df2T_f32(&handle->biquad, handle->src, handle->dst, block_size);
+}
+
+// ---- Overdrive ----
+
+// oversampling factor of the distortion effects after init. the clipping harmonics reach far above Fs / 2,
+// at 4x almost nothing audible aliases back. can be changed per effect with oversampler_set_factor
+#define DISTORTION_OVERSAMPLING 4
+// the q31 overdrive shapes without oversampling by default, the oversampling filters would need conversions
+#if defined(SAMPLE_Q31)
+#define OVERDRIVE_OVERSAMPLING 1
+#else
+#define OVERDRIVE_OVERSAMPLING DISTORTION_OVERSAMPLING
+#endif
+
+// oversampler node of the distortion effects, ctx is the waveshaper
+ITCM_CODE static void shape_block(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	waveshaper_process(ctx, in, out, n);
+}
+
+// the same with antiderivative anti-aliasing (DISTORTION_ADAA, the oversampler runs at factor 1)
+ITCM_CODE static void shape_block_adaa(void *ctx, const float32_t *in, float32_t *out, uint32_t n)
+{
+	waveshaper_process_adaa(ctx, in, out, n);
+}
+
+/******************************************************************************
+* Function Name: set_quality
+*******************************************************************************
+* Summary:
+*  Switch the shaping of a distortion effect (see distortion_quality). Only the oversampled
+*  mode runs the oversampler above factor 1, the load governor may still limit it. The shaping
+*  kernel is bound here as well, so the audio interrupt calls it without looking at the quality
+*  and changes with the next block.
+*
+* Parameters:
+*  1. oversampler_t *os						- Oversampler of the effect.
+*  2. volatile uint8_t *current				- Quality member of the handle.
+*  3. volatile oversampler_node *shape		- Shape member of the handle.
+*  4. distortion_quality quality			- New quality.
+*  5. uint8_t factor						- Oversampling factor of DISTORTION_OVERSAMPLED.
+* Return:
+*  255:										- Unknown quality.
+*  253:										- Effect not initialized.
+*    0:										- Success.
+*
+******************************************************************************/
+static uint8_t set_quality(oversampler_t *os, volatile uint8_t *current, volatile oversampler_node *shape, distortion_quality quality, uint8_t factor)
+{
+	if (quality > DISTORTION_OVERSAMPLED)
+	{
+		return 255;
+	}
+	if (oversampler_set_factor(os, (quality == DISTORTION_OVERSAMPLED) ? factor : 1))
+	{
+		return 253;
+	}
+	*shape = (quality == DISTORTION_ADAA) ? shape_block_adaa : shape_block;
+	*current = quality;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: overdrive_curve
+*******************************************************************************
+* Summary:
+*  Symmetrical soft clipping (Schetzen) transfer curve for the overdrive waveshaper table.
+*  Linear below the threshold, quadratic soft clipping up to twice the threshold and hard
+*  clipping above. The curve is stretched with the threshold, so it stays continuous
+*  (threshold 1/3 is the textbook curve).
+*
+* Parameters:
+*  1. float32_t x			- Input sample. Range: -1 <= x <= 1.
+*  2. float32_t threshold	- Start of the soft clipping.
+* Return:
+*  The shaped sample.
+*
+******************************************************************************/
+static float32_t overdrive_curve(float32_t x, float32_t threshold)
+{
+	const float32_t u = fabsf(x) / (3.0f * threshold);
+	float32_t y;
+	if (u < 1.0f / 3.0f)
+		y = 2.0f * u;
+	else if (u < 2.0f / 3.0f)
+		y = (3.0f - (2.0f - 3.0f * u) * (2.0f - 3.0f * u)) / 3.0f;
+	else
+		y = 1.0f;
+	return (x < 0) ? -y : y;
+}
+
+/******************************************************************************
+* Function Name: overdrive_init
+*******************************************************************************
+* Summary:
+*  Initializes the overdrive struct.
+*
+* Parameters:
+*  1. overdrive_handle_t *handle		- Address pointer of overdrive handle struct.
+*  2. float32_t *in_buffer				- Address pointer of the sample in-buffer.
+*  3. float32_t *out_buffer				- Address pointer of the sample out-buffer.
+*  4. float32_t threshold				- Threshold value for the overdrive algorithm. Must be between 0 and 0.4
+* Return:
+*  255:									- Sample buffers point to NULL
+*  254:									- Threshold value out of range.
+*  253:									- Waveshaper or oversampler error (memory pool exhausted).
+*    0:									- Success.
+*
+******************************************************************************/
+uint8_t overdrive_init(overdrive_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t threshold)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL)) 
+	{
+		return 255;
+	}
+	if ((threshold <= 0) || (threshold > 0.4f))
+	{
+		return 254;
+	}
+	
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->threshold = threshold;
+	if (waveshaper_init(&handle->shaper, overdrive_curve, threshold) || oversampler_init(&handle->oversampler, OVERDRIVE_OVERSAMPLING))
+	{
+		return 253;
+	}
+	handle->quality = (OVERDRIVE_OVERSAMPLING > 1) ? DISTORTION_OVERSAMPLED : DISTORTION_LUT;
+	handle->shape = shape_block;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: overdrive_update
+*******************************************************************************
+* Summary:
+*  Updates overdrive threshold parameter. Rebuilds the transfer curve, don't call from the audio interrupt.
+*
+* Parameters:
+*  1. overdrive_handle_t *handle				- Address pointer of overdrive handle struct.
+*  2. float32_t threshold						- The new threshold value. Needs to be between 0 and 0.4.
+* Return:
+*  255:											- Threshold value out of range.
+*  253:											- Overdrive not initialized.
+*    0:											- Success.
+*
+******************************************************************************/
+uint8_t overdrive_update(overdrive_handle_t *handle, float32_t threshold)
+{
+	if ((threshold <= 0) || (threshold > 0.4f))
+	{		
+		return 255;
+	}
+	handle->threshold = threshold;
+	if (waveshaper_build(&handle->shaper, overdrive_curve, threshold))
+	{
+		return 253;
+	}
+	return 0;
+}
+
+// LUT, ADAA or oversampled shaping, see set_quality. the q31 chain oversamples at DISTORTION_OVERSAMPLING as well
+uint8_t overdrive_set_quality(overdrive_handle_t *handle, distortion_quality quality)
+{
+	return set_quality(&handle->oversampler, &handle->quality, &handle->shape, quality, DISTORTION_OVERSAMPLING);
+}
+
+/******************************************************************************
+* Function Name: run_delay
+*******************************************************************************
+* Summary:
+*  Add delay to the sample block.
+*
+* Parameters:
+*  1. overdrive_handle_t *handle			- Address pointer of overdrive handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_overdrive(overdrive_handle_t *handle, uint32_t block_size)
+{
+	oversampler_process(&handle->oversampler, handle->src, handle->dst, block_size, handle->shape, &handle->shaper);
+}
+
+/******************************************************************************
+* Function Name: run_overdrive_q31
+*******************************************************************************
+* Summary:
+*  q31 version of run_overdrive (SAMPLE_Q31 chain). Without oversampling the block is shaped
+*  as q31. The oversampling filters and the ADAA shaper are float only, for them the block is
+*  converted.
+*
+* Parameters:
+*  1. overdrive_handle_t *handle			- Address pointer of overdrive handle struct.
+*  2. const q31_t *src						- Input block.
+*  3. q31_t *dst							- Output block.
+*  4. uint32_t block_size					- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_overdrive_q31(overdrive_handle_t *handle, const q31_t *src, q31_t *dst, uint32_t block_size)
+{
+	const oversampler_node shape = handle->shape;
+	if ((oversampler_factor(&handle->oversampler) == 1) && (shape == shape_block))
+	{
+		waveshaper_process_q31(&handle->shaper, src, dst, block_size);
+		return;
+	}
+
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *block = scratch_pool_alloc(block_size * sizeof(float32_t));
+	arm_q31_to_float(src, block, block_size);
+	oversampler_process(&handle->oversampler, block, block, block_size, shape, &handle->shaper);
+	arm_float_to_q31(block, dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Fuzz ----
+
+// the makeup gain follows the peak envelope of the shaped signal: rises with the block peak right away,
+// falls with this time constant. the floor limits the gain, so noise in pauses isn't pulled up to full scale
+#define FUZZ_RELEASE_MS 300.0f
+#define FUZZ_ENVELOPE_FLOOR 0.05f
+
+/******************************************************************************
+* Function Name: fuzz_curve
+*******************************************************************************
+* Summary:
+*  Exponential distortion transfer curve for the fuzz waveshaper table.
+*
+* Parameters:
+*  1. float32_t x			- Input sample. Range: -1 <= x <= 1.
+*  2. float32_t gain		- Amplification before the distortion.
+* Return:
+*  The shaped sample. The peak is 1 - e^-gain, run_fuzz makes up the level.
+*
+******************************************************************************/
+static float32_t fuzz_curve(float32_t x, float32_t gain)
+{
+	// multiply sample with gain
+	const float32_t q = x * gain;
+	if (q == 0)
+		return 0;
+	return -q / fabsf(q) * (1 - expf(-q / fabsf(q) * q));
+}
+
+/******************************************************************************
+* Function Name: fuzz_init
+*******************************************************************************
+* Summary:
+*  Initizalize the fuzz struct.
+*
+* Parameters:
+*  1. fuzz_handle_t *handle				- Address pointer of fuzz handle struct.
+*  2. float32_t *in_buffer				- Address pointer of sample in-buffer.
+*  3. float32_t *out_buffer				- Address pointer of sample out-buffer.
+*  4. float32_t gain					- Amplitification gain value of the fuzz algorithm. Range: 0 < gain <= 18.
+*  5. float32_t mix						- Relative ratio of distorted (wet) signal to dry signal. Range: 0 < mix < 1.
+* Return:
+*  255:									- Sample buffers point to NULL.
+*  254:									- Gain or mix values are out of range.
+*  253:									- Waveshaper or oversampler error (memory pool exhausted).
+*    0:									- Success.
+*
+******************************************************************************/
+uint8_t fuzz_init(fuzz_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t gain, float32_t mix)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL)) 
+	{
+		return 255;
+	}
+	if ((gain < 0) || (gain > 18) || (mix < 0) || (mix >= 1))
+	{
+		return 254;
+	}
+	
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->gain = gain;
+	handle->mix = mix;
+	envelope_init(&handle->envelope, ENVELOPE_PEAK, 0.0f, FUZZ_RELEASE_MS);
+	smooth_param_init(&handle->mix_smooth, mix, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->makeup_smooth, 1.0f, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	if (waveshaper_init(&handle->shaper, fuzz_curve, gain) || oversampler_init(&handle->oversampler, DISTORTION_OVERSAMPLING))
+	{
+		return 253;
+	}
+	handle->quality = DISTORTION_OVERSAMPLED;
+	handle->shape = shape_block;
+	
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: fuzz_update
+*******************************************************************************
+* Summary:
+*  Update fuzz parameters. A gain change rebuilds the transfer curve, don't call from the audio interrupt.
+*
+* Parameters:
+*  1. fuzz_handle_t *handle				- Address pointer of fuzz handle struct.
+*  2. fuzz_parameter pm					- Enum of fuzz parameters.
+*  3. float32_t value					- The new value of the parameter.
+* 
+* Return:
+*  255:									- Parameter value are out of range.
+*  253:									- Fuzz not initialized.
+*    0:									- Success.
+*
+******************************************************************************/
+uint8_t fuzz_update(fuzz_handle_t *handle, fuzz_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+		case GAIN:
+			if ((value < 0) || (value > 18))
+				return 255;
+			handle->gain = value;
+			if (waveshaper_build(&handle->shaper, fuzz_curve, value))
+				return 253;
+			break;
+		case MIX:
+			if ((value < 0) || (value >= 1))
+				return 255;
+			handle->mix = value;
+			break;		
+	}
+	
+	return 0;
+}
+
+// LUT, ADAA or oversampled shaping, see set_quality
+uint8_t fuzz_set_quality(fuzz_handle_t *handle, distortion_quality quality)
+{
+	return set_quality(&handle->oversampler, &handle->quality, &handle->shape, quality, DISTORTION_OVERSAMPLING);
+}
+
+
+/******************************************************************************
+* Function Name: run_fuzz
+*******************************************************************************
+* Summary:
+*  Run fuzz algorithm on sample block. The shaped block is brought back to full scale with the
+*  makeup gain, which only changes with the envelope from block to block, so there is no pumping
+*  between blocks. One reciprocal per block, the block is multiplied with arm_scale_f32 (or the
+*  ramp while the gain rises).
+*
+* Parameters:
+*  1. fuzz_handle_t *handle				- Address pointer of fuzz handle struct.
+*  2. uint32_t block_size				- Number of samples in the in/out buffers.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_fuzz(fuzz_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *wet = scratch_pool_alloc(block_size * sizeof(float32_t));
+	smooth_param_next(&handle->mix_smooth, handle->mix, block_size);
+
+	oversampler_process(&handle->oversampler, handle->src, wet, block_size, handle->shape, &handle->shaper);
+
+	// block peak envelope: instant attack, exponential release
+	const float32_t peak = envelope_block(&handle->envelope, wet, block_size);
+
+	// a falling gain (louder input) applies to this block already, otherwise the peak would clip
+	const float32_t makeup = 1.0f / fmaxf(peak, FUZZ_ENVELOPE_FLOOR);
+	if (makeup < smooth_param_value(&handle->makeup_smooth))
+		smooth_param_reset(&handle->makeup_smooth, makeup);
+	else
+		smooth_param_next(&handle->makeup_smooth, makeup, block_size);
+	smooth_param_scale(&handle->makeup_smooth, wet, wet, block_size);
+	smooth_param_mix(&handle->mix_smooth, handle->src, wet, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Noise gate ----
+
+// detector: fast attack, so the first transient of a note opens the gate, short release against ripple
+#define GATE_DETECTOR_ATTACK_MS 0.5f
+#define GATE_DETECTOR_RELEASE_MS 20.0f
+// the gate opens within this time constant, the close time is the release parameter
+#define GATE_OPEN_MS 1.0f
+// the gate closes once the level falls below threshold * GATE_HYSTERESIS (-6 dB), so it doesn't chatter
+#define GATE_HYSTERESIS 0.5f
+
+/******************************************************************************
+* Function Name: gate_init
+*******************************************************************************
+* Summary:
+*  Initialize noise gate handle struct. The gate starts closed.
+*
+* Parameters:
+*  1. gate_handle_t *handle					- Address pointer of noise gate handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t threshold_db				- Level that opens the gate in dBFS. Range: -96 <= threshold_db <= 0.
+*  5. float32_t release_ms					- Time constant of the closing gate. Range: 1 <= release_ms <= 2000.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t gate_init(gate_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t threshold_db, float32_t release_ms)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->key = NULL;
+	handle->external = false;
+	handle->gain = 0;
+	handle->open = false;
+	handle->open_coeff = expf(-1000.0f / (GATE_OPEN_MS * Fs));
+	envelope_init(&handle->detector, ENVELOPE_PEAK, GATE_DETECTOR_ATTACK_MS, GATE_DETECTOR_RELEASE_MS);
+	if (gate_update(handle, GATE_THRESHOLD, threshold_db) || gate_update(handle, GATE_RELEASE, release_ms))
+	{
+		return 254;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: gate_update
+*******************************************************************************
+* Summary:
+*  Update noise gate parameters. The threshold is converted to a linear level and the release
+*  to a coefficient here, so the audio path doesn't evaluate powf or expf.
+*
+* Parameters:
+*  1. gate_handle_t *handle					- Address pointer of noise gate handle struct.
+*  2. gate_parameter pm						- Enum of noise gate parameters.
+*  3. float32_t value						- GATE_THRESHOLD: dBFS, -96 to 0. GATE_RELEASE: ms, 1 to 2000.
+*											  GATE_KEY: 0 = input, 1 = sidechain (gate_set_key).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t gate_update(gate_handle_t *handle, gate_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+	case GATE_THRESHOLD:
+		if ((value < -96.0f) || (value > 0))
+			return 255;
+		handle->threshold = powf(10.0f, value / 20.0f);
+		break;
+	case GATE_RELEASE:
+		if ((value < 1.0f) || (value > 2000.0f))
+			return 255;
+		handle->close_coeff = expf(-1000.0f / (value * Fs));
+		break;
+	case GATE_KEY:
+		if ((value < 0) || (value > 1.0f))
+			return 255;
+		handle->external = (value >= 0.5f) ? true : false;
+		break;
+	}
+
+	return 0;
+}
+
+// sidechain block the detector follows with GATE_KEY, filled before every block (e.g. the second input). NULL: none
+void gate_set_key(gate_handle_t *handle, const float32_t *key)
+{
+	handle->key = key;
+}
+
+/******************************************************************************
+* Function Name: run_gate
+*******************************************************************************
+* Summary:
+*  Run noise gate on sample block. The envelope of every sample (of the input or the sidechain
+*  block) decides if the gate is open, the gain follows with the open and close time constants
+*  and is applied with arm_mult_f32.
+*
+* Parameters:
+*  1. gate_handle_t *handle					- Address pointer of noise gate handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_gate(gate_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *gain = scratch_pool_alloc(block_size * sizeof(float32_t));
+	const float32_t *key = (handle->external && (handle->key != NULL)) ? handle->key : handle->src;
+	envelope_process(&handle->detector, key, gain, block_size);
+
+	const float32_t open_level = handle->threshold;
+	const float32_t close_level = open_level * GATE_HYSTERESIS;
+	const float32_t open_coeff = handle->open_coeff;
+	const float32_t close_coeff = handle->close_coeff;
+	bool open = handle->open;
+	float32_t g = handle->gain;
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		const float32_t level = gain[i];
+		open = (level > open_level) || (open && (level > close_level));
+		const float32_t target = open ? 1.0f : 0.0f;
+		g = target + (open ? open_coeff : close_coeff) * (g - target);
+		gain[i] = g;
+	}
+	handle->open = open;
+	handle->gain = g;
+
+	arm_mult_f32(handle->src, gain, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Compressor ----
+
+// RMS detector time constants
+#define COMP_ATTACK_MS 5.0f
+#define COMP_RELEASE_MS 100.0f
+// the gain is computed once per segment and ramped linearly in between (the dB conversions per sample are too expensive)
+#define COMP_SEGMENT_SIZE (MIN_BLOCK_SIZE)
+// lowest level the gain computer sees, avoids log10(0)
+#define COMP_LEVEL_FLOOR 1e-5f
+
+/******************************************************************************
+* Function Name: comp_init
+*******************************************************************************
+* Summary:
+*  Initialize compressor handle struct (feed forward, RMS detector, hard knee).
+*
+* Parameters:
+*  1. comp_handle_t *handle					- Address pointer of compressor handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t threshold_db				- Level above which the signal is compressed in dBFS. Range: -60 to 0.
+*  5. float32_t ratio						- Input to output level ratio above the threshold. Range: 1 to 20.
+*  6. float32_t makeup_db					- Gain after the compression in dB. Range: 0 to 24.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t comp_init(comp_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t threshold_db, float32_t ratio, float32_t makeup_db)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	if (comp_update(handle, COMP_THRESHOLD, threshold_db) || comp_update(handle, COMP_RATIO, ratio) || comp_update(handle, COMP_MAKEUP, makeup_db))
+	{
+		return 254;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->key = NULL;
+	handle->external = false;
+	handle->gain = powf(10.0f, makeup_db / 20.0f);
+	envelope_init(&handle->detector, ENVELOPE_RMS, COMP_ATTACK_MS, COMP_RELEASE_MS);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: comp_update
+*******************************************************************************
+* Summary:
+*  Update compressor parameters.
+*
+* Parameters:
+*  1. comp_handle_t *handle					- Address pointer of compressor handle struct.
+*  2. comp_parameter pm						- Enum of compressor parameters.
+*  3. float32_t value						- COMP_THRESHOLD: dBFS, -60 to 0. COMP_RATIO: 1 to 20.
+*											  COMP_MAKEUP: dB, 0 to 24. COMP_KEY: 0 = input,
+*											  1 = sidechain (comp_set_key).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t comp_update(comp_handle_t *handle, comp_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+	case COMP_THRESHOLD:
+		if ((value < -60.0f) || (value > 0))
+			return 255;
+		handle->threshold_db = value;
+		break;
+	case COMP_RATIO:
+		if ((value < 1.0f) || (value > 20.0f))
+			return 255;
+		handle->ratio = value;
+		break;
+	case COMP_MAKEUP:
+		if ((value < 0) || (value > 24.0f))
+			return 255;
+		handle->makeup_db = value;
+		break;
+	case COMP_KEY:
+		if ((value < 0) || (value > 1.0f))
+			return 255;
+		handle->external = (value >= 0.5f) ? true : false;
+		break;
+	}
+
+	return 0;
+}
+
+// sidechain block the detector follows with COMP_KEY, filled before every block (e.g. the second input). NULL: none
+void comp_set_key(comp_handle_t *handle, const float32_t *key)
+{
+	handle->key = key;
+}
+
+/******************************************************************************
+* Function Name: run_comp
+*******************************************************************************
+* Summary:
+*  Run compressor on sample block. The RMS envelope (of the input or the sidechain block) is
+*  computed for every sample, the gain from the envelope at the end of every COMP_SEGMENT_SIZE
+*  segment. Within a segment the gain is ramped linearly from the last to the new value.
+*
+* Parameters:
+*  1. comp_handle_t *handle					- Address pointer of compressor handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers. A multiple of COMP_SEGMENT_SIZE.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_comp(comp_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *level = scratch_pool_alloc(block_size * sizeof(float32_t));
+	const float32_t *key = (handle->external && (handle->key != NULL)) ? handle->key : handle->src;
+	envelope_process(&handle->detector, key, level, block_size);
+
+	const float32_t threshold_db = handle->threshold_db;
+	const float32_t slope = 1.0f - 1.0f / handle->ratio;
+	const float32_t makeup_db = handle->makeup_db;
+	smooth_param_t gain = { .end = handle->gain };
+	for (uint32_t offset = 0; offset < block_size; offset += COMP_SEGMENT_SIZE)
+	{
+		const float32_t level_db = fast_gain_to_db(fmaxf(level[offset + COMP_SEGMENT_SIZE - 1], COMP_LEVEL_FLOOR));
+		const float32_t over = fmaxf(level_db - threshold_db, 0.0f);
+		gain.start = gain.end;
+		gain.end = fast_db_to_gain(makeup_db - slope * over);
+		smooth_param_scale(&gain, &handle->src[offset], &handle->dst[offset], COMP_SEGMENT_SIZE);
+	}
+	handle->gain = gain.end;
+	scratch_pool_release(mark);
+}
+
+// ---- Limiter ----
+
+// lookahead memory of every channel. holds the lookahead plus one block
+#define LIMITER_LINE_SIZE (512)
+#if ((LIMITER_LOOKAHEAD + MAX_BLOCK_SIZE) > LIMITER_LINE_SIZE)
+#error "LIMITER_LINE_SIZE too small for LIMITER_LOOKAHEAD + MAX_BLOCK_SIZE"
+#endif
+
+#define LIMITER_MEMORY_SIZE (LIMITER_LINE_SIZE * sizeof(float32_t))
+
+/******************************************************************************
+* Function Name: limiter_init
+*******************************************************************************
+* Summary:
+*  Initialize an output limiter. The lookahead line is taken from the DTCM arena the first
+*  time, later calls reuse it and clear it.
+*
+* Parameters:
+*  1. limiter_handle_t *handle				- Address pointer of limiter handle struct.
+*  2. float32_t ceiling_db					- Highest output level in dBFS. Range: -12 <= ceiling_db <= 0.
+*  3. float32_t release_ms					- Time constant of the gain recovery. Range: 1 <= release_ms <= 2000.
+* Return:
+*  254:										- Parameter values are out of range.
+*  253:										- DTCM arena exhausted.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t limiter_init(limiter_handle_t *handle, float32_t ceiling_db, float32_t release_ms)
+{
+	if ((ceiling_db < -12.0f) || (ceiling_db > 0) || (release_ms < 1.0f) || (release_ms > 2000.0f))
+	{
+		return 254;
+	}
+	if (handle->lookahead.buffer == NULL)
+	{
+		float32_t *buffer = arena_alloc(ARENA_TCM, LIMITER_MEMORY_SIZE);
+		if ((buffer == NULL) || delay_line_init(&handle->lookahead, buffer, LIMITER_LINE_SIZE))
+		{
+			arena_free(buffer);
+			return 253;
+		}
+	}
+
+	handle->ceiling = powf(10.0f, ceiling_db / 20.0f);
+	// the gain recovers once per segment
+	handle->release = expf(-1000.0f * LIMITER_SEGMENT_SIZE / (release_ms * Fs));
+	handle->clips = 0;
+	limiter_reset(handle);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: limiter_reset
+*******************************************************************************
+* Summary:
+*  Clear the lookahead line and open the gain fully, e.g. after the block size changed.
+*
+* Parameters:
+*  1. limiter_handle_t *handle				- Address pointer of an initialized limiter handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void limiter_reset(limiter_handle_t *handle)
+{
+	delay_line_clear(&handle->lookahead);
+	handle->gain = 1.0f;
+	handle->target[0] = 1.0f;
+	handle->target[1] = 1.0f;
+}
+
+/******************************************************************************
+* Function Name: run_limiter
+*******************************************************************************
+* Summary:
+*  Limit a block to the ceiling. The output is delayed by LIMITER_LOOKAHEAD samples (two
+*  segments), the gain curve is computed from the undelayed segment peaks: one gain per
+*  LIMITER_SEGMENT_SIZE, ramped linearly in between. The gain starts falling two segments before
+*  a peak leaves the lookahead line and is fully down when it does, so the output never exceeds
+*  the ceiling and no sample is clipped. Segments over full scale are counted in clips.
+*
+* Parameters:
+*  1. limiter_handle_t *handle				- Address pointer of an initialized limiter handle struct.
+*  2. const float32_t *src					- Input block.
+*  3. float32_t *dst						- Output block. May be the same as src.
+*  4. uint32_t block_size					- Number of samples. A multiple of LIMITER_SEGMENT_SIZE.
+* Return:
+*  Number of segments of this block over full scale (would have clipped without the limiter).
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE uint32_t run_limiter(limiter_handle_t *handle, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	const float32_t ceiling = handle->ceiling;
+	const float32_t release = handle->release;
+	float32_t target_1 = handle->target[0];
+	float32_t target_2 = handle->target[1];
+	smooth_param_t gain = { .end = handle->gain };
+	float32_t targets[MAX_BLOCK_SIZE / LIMITER_SEGMENT_SIZE];
+	const uint32_t segments = block_size / LIMITER_SEGMENT_SIZE;
+	uint32_t clips = 0;
+
+	// the segment peaks are taken before dst (possibly src) is overwritten with the delayed block
+	for (uint32_t s = 0; s < segments; ++s)
+	{
+		float32_t max_z, min_z;
+		uint32_t index;
+		arm_max_f32((float32_t *)&src[s * LIMITER_SEGMENT_SIZE], LIMITER_SEGMENT_SIZE, &max_z, &index);
+		arm_min_f32((float32_t *)&src[s * LIMITER_SEGMENT_SIZE], LIMITER_SEGMENT_SIZE, &min_z, &index);
+		const float32_t peak = fmaxf(max_z, -min_z);
+		clips += (peak >= 1.0f) ? 1 : 0;
+		targets[s] = (peak > ceiling) ? (ceiling / peak) : 1.0f;
+	}
+
+	delay_line_write(&handle->lookahead, src, block_size);
+	delay_line_read(&handle->lookahead, dst, LIMITER_LOOKAHEAD, block_size);
+
+	for (uint32_t s = 0; s < segments; ++s)
+	{
+		const uint32_t offset = s * LIMITER_SEGMENT_SIZE;
+		const float32_t target = targets[s];
+
+		// this output segment carries the input segment two segments back: its gain has to be down
+		// at both ends. halfway towards the newest target, so a big step is spread over two segments
+		const float32_t recovered = 1.0f - release * (1.0f - gain.end);
+		gain.start = gain.end;
+		gain.end = fminf(fminf(recovered, 0.5f * (gain.start + target)), fminf(target_1, target_2));
+		smooth_param_scale(&gain, &dst[offset], &dst[offset], LIMITER_SEGMENT_SIZE);
+
+		target_2 = target_1;
+		target_1 = target;
+	}
+
+	handle->gain = gain.end;
+	handle->target[0] = target_1;
+	handle->target[1] = target_2;
+	handle->clips += clips;
+	return clips;
+}
+
+/******************************************************************************
+* Function Name: run_limiter_q31
+*******************************************************************************
+* Summary:
+*  run_limiter for the SAMPLE_Q31 chain. The q31 stages saturate at full scale themselves,
+*  the limiter keeps the output below the ceiling and without hard clipping edges.
+*
+* Parameters:
+*  1. limiter_handle_t *handle				- Address pointer of an initialized limiter handle struct.
+*  2. const q31_t *src						- Input block.
+*  3. q31_t *dst							- Output block. May be the same as src.
+*  4. uint32_t block_size					- Number of samples. A multiple of LIMITER_SEGMENT_SIZE.
+* Return:
+*  See run_limiter.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE uint32_t run_limiter_q31(limiter_handle_t *handle, const q31_t *src, q31_t *dst, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *block = scratch_pool_alloc(block_size * sizeof(float32_t));
+	arm_q31_to_float((q31_t *)src, block, block_size);
+	const uint32_t clips = run_limiter(handle, block, block, block_size);
+	arm_float_to_q31(block, dst, block_size);
+	scratch_pool_release(mark);
+	return clips;
+}
+
+// ---- Tremolo ----
+
+/******************************************************************************
+* Function Name: tremolo_init
+*******************************************************************************
+* Summary:
+*  Initialize tremolo handle struct.
+*
+* Parameters:
+*  1. tremolo_handle_t *handle				- Address pointer of tremolo handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t rate						- Allows modifying the LFO frequency. Range: 0 < rate < 1.
+*  5. float32_t depth						- Modulation depth. Range: 0 <= depth <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Rate or depth values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t tremolo_init(tremolo_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL)) 
+	{
+		return 255;
+	}
+	if ((rate < 0) || (rate > 1) || (depth < 0) || (depth > 1))
+	{
+		return 254;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->rate = rate;
+	handle->depth = depth;
+	oscillator_init(&handle->lfo, OSC_SINE);
+	control_rate_init(&handle->lfo_control, 0.0f);
+	// LFO rates and delay sweeps glide linearly, gains and mixes settle exponentially
+	smooth_param_init(&handle->rate_smooth, rate, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->depth_smooth, depth, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: tremolo_update
+*******************************************************************************
+* Summary:
+*  Update tremolo parameters.
+*
+* Parameters:
+*  1. tremolo_handle_t *handle				- Address pointer of tremolo handle struct.
+*  2. modulation_parameter pm				- Enum of modulation parameters.
+*  3. float32_t value						- The new value of the parameter.
+* 
+* Return:
+*  255:										- Parameter value are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t tremolo_update(tremolo_handle_t *handle, modulation_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+	case RATE:
+		if ((value < 0) || (value > 1.0f))
+			return 255;
+		handle->rate = value;
+		break;
+	case DEPTH:
+		if ((value < 0) || (value > 1.0f))
+			return 254;
+		handle->depth = value;
+		break;		
+	}
+	
+	return 0;
+}
+	
+
+/******************************************************************************
+* Function Name: run_tremolo
+*******************************************************************************
+* Summary:
+*  Run tremolo algorithm on sample block.
+*
+* Parameters:
+*  1. tremolo_handle_t *handle				- Address pointer of tremolo handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+
+// https://wiki.analog.com/resources/tools-software/sharc-audio-module/baremetal/tremelo-effect-tutorial
+ITCM_CODE void run_tremolo(tremolo_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *factor = scratch_pool_alloc(block_size * sizeof(float32_t));
+	tremolo_factor(handle, factor, block_size);
+	arm_mult_f32(factor, handle->src, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// one LFO value per control step: the oscillator advances by a whole step
+ITCM_CODE static float32_t tremolo_lfo(void *ctx, uint32_t offset)
+{
+	tremolo_handle_t *handle = ctx;
+	float32_t value;
+	(void)offset;
+	oscillator_generate(&handle->lfo, &value, smooth_param_value(&handle->rate_smooth) * (TREMOLO_MAX_RATE_HZ * CONTROL_RATE_SIZE), 1);
+	return value;
+}
+
+// the tremolo is element-wise: the gain every sample of the next block is multiplied by, in [0, 1]. advances the LFO,
+// so a fused chain stage (fx_chain_set_factor) calls it instead of run_tremolo. the LFO is a control rate parameter
+// (at most 15 Hz), interpolated between the steps
+#pragma optimize_for_speed
+ITCM_CODE void tremolo_factor(tremolo_handle_t *handle, float32_t *factor, uint32_t block_size)
+{
+	smooth_param_next(&handle->rate_smooth, handle->rate, block_size);
+	smooth_param_next(&handle->depth_smooth, handle->depth, block_size);
+
+	control_rate_run(&handle->lfo_control, tremolo_lfo, handle, factor, block_size);
+	// get modulation factor for every sample: 1 - (depth * 0.5 * sin + 0.5)
+	smooth_param_scale(&handle->depth_smooth, factor, factor, block_size);
+	arm_scale_f32(factor, -0.5f, factor, block_size);
+	arm_offset_f32(factor, 0.5f, factor, block_size);
+}
+// ---- Ring Modulator ----
+
+// carrier of every modulator_type. audio rate carriers: the edges and corners are band-limited up to half the sample rate
+static const oscillator_waveform ring_mod_waveform[NO_CHANGE] = { OSC_SINE, OSC_TRIANGLE_BLEP, OSC_SQUARE_BLEP, OSC_SAW_BLEP };
+
+/******************************************************************************
+* Function Name: ring_mod_init
+*******************************************************************************
+* Summary:
+*  Initialize ring modulator struct.
+*
+* Parameters:
+*  1. ring_mod_handle_t *handle				- Address pointer of ring modulator handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t rate						- Rate of change of the modulator; frequency. Range: 0 < rate <= 1.
+*  5. float32_t blend						- Ratio of mix between dry signal and wet signal. Range: 0 < blend < 1.
+*  6. modulator_type type					- The modulating signal wave form. Sine, Triangle, Square or Saw wave.
+* 
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Rate or blend values are out of range or unknown modulator type.
+*    0:										- Success. 
+*
+******************************************************************************/
+uint8_t ring_mod_init(ring_mod_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t blend, modulator_type type)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL)) 
+	{
+		return 255;
+	}
+	if ((rate <= 0) || (rate > 1) || (blend < 0) || (blend > 0.99) || (type >= NO_CHANGE))
+	{
+		return 254;
+	}
+	
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	const ring_mod_params_t params = { rate, blend, type };
+	ring_mod_block_init(&handle->shared, &params);
+	handle->params = params;
+	handle->params_seen = handle->shared.sequence;
+	if (oscillator_init(&handle->lfo, ring_mod_waveform[type]))
+	{
+		return 254;
+	}
+	smooth_param_init(&handle->rate_smooth, rate, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->blend_smooth, blend, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: ring_mod_update
+*******************************************************************************
+* Summary:
+*  Update ring modulation parameters. The parameter and the waveform are published together,
+*  the audio processing takes them over with its next block. Call from the menu (the writer of
+*  the parameter block), not from the audio processing.
+*
+* Parameters:
+*  1. ring_mod_handle_t *handle				- Address pointer of ring modulator handle struct.
+*  2. modulation_parameter pm				- Enum of modulation parameters.
+*  3. modulator_type type					- Enum of modulating signal wave form.
+*  4. float32_t value						- The new value of the parameter.
+* 
+* Return:
+*  255:										- Parameter value are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t ring_mod_update(ring_mod_handle_t *handle, modulation_parameter pm, modulator_type type, float32_t value)
+{
+	if (((pm == RATE) || (pm == DEPTH)) && ((value < 0) || (value > 1.0f)))
+	{
+		return (pm == RATE) ? 255 : 254;
+	}
+
+	ring_mod_params_t *params = ring_mod_block_edit(&handle->shared);
+	switch (pm)
+	{
+	case RATE:
+		params->rate = value;
+		break;
+	case DEPTH:
+		params->blend = value;
+		break;		
+	default:
+		break;
+	}
+	
+	// only the modulator waveforms, the grain window of the oscillator isn't one
+	if (type < NO_CHANGE)
+		params->type = type;
+	ring_mod_block_publish(&handle->shared);
+	
+	return 0;
+}
+
+
+/******************************************************************************
+* Function Name: run_ring_mod
+*******************************************************************************
+* Summary:
+*  Run ring modulation algorithm on sample block.
+*
+* Parameters:
+*  1. ring_mod_handle_t *handle				- Address pointer of tremolo handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_ring_mod(ring_mod_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *factor = scratch_pool_alloc(block_size * sizeof(float32_t));
+	ring_mod_factor(handle, factor, block_size);
+	arm_mult_f32(factor, handle->src, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// the blend of the modulated and the dry signal is one gain per sample: x + blend * (lfo * x - x) = x * (1 + blend *
+// (lfo - 1)), in [-1, 1]. advances the LFO like run_ring_mod. a new snapshot of the parameters binds its waveform
+#pragma optimize_for_speed
+ITCM_CODE void ring_mod_factor(ring_mod_handle_t *handle, float32_t *factor, uint32_t block_size)
+{
+	if (ring_mod_block_snapshot(&handle->shared, &handle->params, &handle->params_seen))
+	{
+		oscillator_set_waveform(&handle->lfo, ring_mod_waveform[handle->params.type]);
+	}
+	const ring_mod_params_t *params = &handle->params;
+	smooth_param_next(&handle->rate_smooth, params->rate, block_size);
+	smooth_param_next(&handle->blend_smooth, params->blend, block_size);
+
+	oscillator_generate(&handle->lfo, factor, smooth_param_value(&handle->rate_smooth) * RING_MOD_MAX_RATE_HZ, block_size);
+	arm_offset_f32(factor, -1.0f, factor, block_size);
+	smooth_param_scale(&handle->blend_smooth, factor, factor, block_size);
+	arm_offset_f32(factor, 1.0f, factor, block_size);
+}
+
+// ---- Chorus ----
+
+// chorus delay times. the modulated tap sweeps between the base delay and base delay + depth
+#define CHORUS_BASE_DELAY_MS 10.0f
+#define CHORUS_MAX_DEPTH_MS 15.0f
+// LFO frequency at rate = 1
+#define CHORUS_MAX_RATE_HZ 5.0f
+// 25 ms at AUDIO_MAX_SAMPLE_RATE = 2400 samples, plus one block and the interpolation margin -> 2^12
+#define CHORUS_LINE_SIZE (1 << 12)
+
+/******************************************************************************
+* Function Name: chorus_init
+*******************************************************************************
+* Summary:
+*  Initialize chorus handle struct. The delay line memory is only taken by chorus_activate.
+*
+* Parameters:
+*  1. chorus_handle_t *handle				- Address pointer of chorus handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t rate						- LFO frequency. Range: 0 <= rate <= 1.
+*  5. float32_t depth						- Modulation depth (sweep width of the delay). Range: 0 <= depth <= 1.
+*  6. float32_t blend						- Ratio of dry and wet mix. Range: 0 <= blend <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t chorus_init(chorus_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth, float32_t blend)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL)) 
+	{
+		return 255;
+	}
+	if ((rate < 0) || (rate > 1) || (depth < 0) || (depth > 1) || (blend < 0) || (blend > 1))
+	{
+		return 254;
+	}
+	
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->rate = rate;
+	handle->depth = depth;
+	handle->blend = blend;
+	handle->time = 0;
+	smooth_param_init(&handle->rate_smooth, rate, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->depth_smooth, depth, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->blend_smooth, blend, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: chorus_activate
+*******************************************************************************
+* Summary:
+*  Take the delay line memory from the RAM_D2 arena, when the chorus enters the chain. If the
+*  handle still holds its delay line, it is cleared. Call from the main loop only.
+*
+* Parameters:
+*  1. chorus_handle_t *handle				- Address pointer of an initialized chorus handle struct.
+* Return:
+*  253:										- Arena exhausted.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t chorus_activate(chorus_handle_t *handle)
+{
+	if (handle->delay_line.buffer == NULL)
+	{
+		float32_t *buffer = arena_alloc(ARENA_AHB, CHORUS_LINE_SIZE * sizeof(float32_t));
+		if ((buffer == NULL) || delay_line_init(&handle->delay_line, buffer, CHORUS_LINE_SIZE))
+		{
+			arena_free(buffer);
+			return 253;
+		}
+	}
+	chorus_reset(handle);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: chorus_deinit
+*******************************************************************************
+* Summary:
+*  Give the chorus delay line memory back to the RAM_D2 arena (the chorus left the chain).
+*
+* Parameters:
+*  1. chorus_handle_t *handle				- Address pointer of chorus handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void chorus_deinit(chorus_handle_t *handle)
+{
+	arena_free(handle->delay_line.buffer);
+	handle->delay_line.buffer = NULL;
+}
+
+/******************************************************************************
+* Function Name: chorus_reset
+*******************************************************************************
+* Summary:
+*  Silence the delay line without giving the memory back, e.g. after the block size changed.
+*
+* Parameters:
+*  1. chorus_handle_t *handle				- Address pointer of chorus handle struct.
+* 
+* Return:
+*  None.
+******************************************************************************/
+void chorus_reset(chorus_handle_t *handle)
+{
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+	handle->time = 0;
+	smooth_param_reset(&handle->rate_smooth, handle->rate);
+	smooth_param_reset(&handle->depth_smooth, handle->depth);
+	smooth_param_reset(&handle->blend_smooth, handle->blend);
+}
+
+/******************************************************************************
+* Function Name: chorus_update
+*******************************************************************************
+* Summary:
+*  Update chorus parameters.
+*
+* Parameters:
+*  1. chorus_handle_t *handle				- Address pointer of chorus handle struct.
+*  2. chorus_parameter pm					- Enum of chorus parameters.
+*  3. float32_t value						- The new value of the parameter. Range: 0 <= value <= 1.
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t chorus_update(chorus_handle_t *handle, chorus_parameter pm, float32_t value)
+{
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
+	switch (pm)
+	{
+	case CHORUS_RATE:
+		handle->rate = value;
+		break;
+	case CHORUS_DEPTH:
+		handle->depth = value;
+		break;
+	case CHORUS_BLEND:
+		handle->blend = value;
+		break;
+	}
+	
+	return 0;
+}
+
+// delays of a swept tap (chorus, flanger): base plus depth * sweep * LFO, the LFO (0 to 1) moving linearly from
+// lfo_start to lfo_end. a ramping depth follows its smoother sample by sample, also through the changes scheduled inside
+// the block (MIDI, smooth_param_schedule). scratch: n samples
+#pragma optimize_for_speed
+ITCM_CODE static void sweep_delays(float32_t *delay, float32_t *scratch, const smooth_param_t *depth, float32_t base, float32_t sweep, float32_t lfo_start, float32_t lfo_end, uint32_t n)
+{
+	if (!smooth_param_is_ramping(depth))
+	{
+		const float32_t width = smooth_param_value(depth) * sweep;
+		fill_ramp(delay, base + width * lfo_start, base + width * lfo_end, n);
+		return;
+	}
+	fill_ramp(delay, lfo_start, lfo_end, n);
+	smooth_param_ramp(depth, scratch, n);
+	arm_mult_f32(delay, scratch, delay, n);
+	arm_scale_f32(delay, sweep, delay, n);
+	arm_offset_f32(delay, base, delay, n);
+}
+
+/******************************************************************************
+* Function Name: run_chorus
+*******************************************************************************
+* Summary:
+*  Run chorus algorithm on sample block. The LFO is only evaluated at the start and the end
+*  of the block, the delay of every sample in between is interpolated linearly (the LFO
+*  runs at a few Hz, so the error is far below audibility). The modulated tap is then read
+*  in a single pass with cubic interpolation.
+*
+* Parameters:
+*  1. chorus_handle_t *handle				- Address pointer of chorus handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_chorus(chorus_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *delay = scratch_pool_alloc(block_size * sizeof(float32_t));
+	float32_t *depth = scratch_pool_alloc(block_size * sizeof(float32_t));
+	// read parameters once per block
+	smooth_param_next(&handle->rate_smooth, handle->rate, block_size);
+	smooth_param_next(&handle->depth_smooth, handle->depth, block_size);
+	smooth_param_next(&handle->blend_smooth, handle->blend, block_size);
+	const float32_t base = CHORUS_BASE_DELAY_MS * (Fs / 1000.0f);
+	const float32_t increment = 2 * PI * smooth_param_value(&handle->rate_smooth) * CHORUS_MAX_RATE_HZ / Fs;
+
+	// LFO at block start and block end, the delay sweeps between base and base + sweep. a depth change ramps along
+	const float32_t start = 0.5f + 0.5f * arm_sin_f32(handle->time);
+	lfo_advance(&handle->time, increment * block_size);
+	const float32_t end = 0.5f + 0.5f * arm_sin_f32(handle->time);
+	sweep_delays(delay, depth, &handle->depth_smooth, base, CHORUS_MAX_DEPTH_MS * (Fs / 1000.0f), start, end, block_size);
+
+	delay_line_write(&handle->delay_line, handle->src, block_size);
+	delay_line_read_fractional(&handle->delay_line, handle->dst, delay, DELAY_LINE_CUBIC, block_size);
+
+	// blend dry and wet signal
+	smooth_param_mix(&handle->blend_smooth, handle->src, handle->dst, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Flanger ----
+
+// the feedback path needs the delayed chunk before the current chunk can be written into the
+// delay line, so the minimum delay is one chunk plus the interpolation margin (64 + 2 samples = 1.4 ms).
+// longer blocks are processed in chunks (see run_flanger)
+#define FLANGER_CHUNK (64)
+#define FLANGER_MIN_DELAY (FLANGER_CHUNK + 2)
+#define FLANGER_MAX_DEPTH_MS 5.0f
+#define FLANGER_MAX_RATE_HZ 2.0f
+// 5 ms at AUDIO_MAX_SAMPLE_RATE = 480 samples plus the minimum delay and one block -> 2^10
+#define FLANGER_LINE_SIZE (1 << 10)
+
+/******************************************************************************
+* Function Name: flanger_init
+*******************************************************************************
+* Summary:
+*  Initialize flanger handle struct. The delay line memory is only taken by flanger_activate.
+*
+* Parameters:
+*  1. flanger_handle_t *handle				- Address pointer of flanger handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t rate						- LFO frequency. Range: 0 <= rate <= 1.
+*  5. float32_t depth						- Modulation depth (sweep width of the delay). Range: 0 <= depth <= 1.
+*  6. float32_t feedback					- Amount of the delayed signal fed back into the delay line. Range: 0 <= feedback < 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t flanger_init(flanger_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth, float32_t feedback)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL)) 
+	{
+		return 255;
+	}
+	if ((rate < 0) || (rate > 1) || (depth < 0) || (depth > 1) || (feedback < 0) || (feedback >= 1))
+	{
+		return 254;
+	}
+	
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->rate = rate;
+	handle->depth = depth;
+	handle->feedback = feedback;
+	handle->time = 0;
+	smooth_param_init(&handle->rate_smooth, rate, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->depth_smooth, depth, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->feedback_smooth, feedback, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	dc_blocker_init(&handle->dc_block, DC_BLOCKER_CUTOFF_HZ);
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: flanger_activate
+*******************************************************************************
+* Summary:
+*  Take the delay line memory from the RAM_D2 arena, when the flanger enters the chain. If the
+*  handle still holds its delay line, it is cleared. Call from the main loop only.
+*
+* Parameters:
+*  1. flanger_handle_t *handle				- Address pointer of an initialized flanger handle struct.
+* Return:
+*  253:										- Arena exhausted.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t flanger_activate(flanger_handle_t *handle)
+{
+	if (handle->delay_line.buffer == NULL)
+	{
+		float32_t *buffer = arena_alloc(ARENA_AHB, FLANGER_LINE_SIZE * sizeof(float32_t));
+		if ((buffer == NULL) || delay_line_init(&handle->delay_line, buffer, FLANGER_LINE_SIZE))
+		{
+			arena_free(buffer);
+			return 253;
+		}
+	}
+	flanger_reset(handle);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: flanger_deinit
+*******************************************************************************
+* Summary:
+*  Give the flanger delay line memory back to the RAM_D2 arena (the flanger left the chain).
+*
+* Parameters:
+*  1. flanger_handle_t *handle				- Address pointer of flanger handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void flanger_deinit(flanger_handle_t *handle)
+{
+	arena_free(handle->delay_line.buffer);
+	handle->delay_line.buffer = NULL;
+}
+
+/******************************************************************************
+* Function Name: flanger_reset
+*******************************************************************************
+* Summary:
+*  Silence the delay line without giving the memory back, e.g. after the block size changed.
+*
+* Parameters:
+*  1. flanger_handle_t *handle				- Address pointer of flanger handle struct.
+* 
+* Return:
+*  None.
+******************************************************************************/
+void flanger_reset(flanger_handle_t *handle)
+{
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+	dc_blocker_reset(&handle->dc_block);
+	handle->time = 0;
+	smooth_param_reset(&handle->rate_smooth, handle->rate);
+	smooth_param_reset(&handle->depth_smooth, handle->depth);
+	smooth_param_reset(&handle->feedback_smooth, handle->feedback);
+}
+
+/******************************************************************************
+* Function Name: flanger_update
+*******************************************************************************
+* Summary:
+*  Update flanger parameters.
+*
+* Parameters:
+*  1. flanger_handle_t *handle				- Address pointer of flanger handle struct.
+*  2. flanger_parameter pm					- Enum of flanger parameters.
 *  3. float32_t value						- The new value of the parameter.
 * 
 * Return:
-*  255:										- Parameter value are out of range.
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t flanger_update(flanger_handle_t *handle, flanger_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+	case FLANGER_RATE:
+		if ((value < 0) || (value > 1.0f))
+			return 255;
+		handle->rate = value;
+		break;
+	case FLANGER_DEPTH:
+		if ((value < 0) || (value > 1.0f))
+			return 255;
+		handle->depth = value;
+		break;
+	case FLANGER_FEEDBACK:
+		if ((value < 0) || (value >= 1.0f))
+			return 255;
+		handle->feedback = value;
+		break;
+	}
+	
+	return 0;
+}
+
+// one chunk of the flanger, see run_flanger
+#pragma optimize_for_speed
+ITCM_CODE static void flanger_process(flanger_handle_t *handle, const float32_t *src, float32_t *dst, uint32_t n)
+{
+	float32_t delay[FLANGER_CHUNK];
+	float32_t wet[FLANGER_CHUNK];
+	// parameters are smoothed per chunk
+	smooth_param_next(&handle->rate_smooth, handle->rate, n);
+	smooth_param_next(&handle->depth_smooth, handle->depth, n);
+	smooth_param_next(&handle->feedback_smooth, handle->feedback, n);
+	const float32_t sweep = FLANGER_MAX_DEPTH_MS * (Fs / 1000.0f);
+	const float32_t increment = 2 * PI * smooth_param_value(&handle->rate_smooth) * FLANGER_MAX_RATE_HZ / Fs;
+
+	// the delay line is read before the current chunk is written, so the delays are
+	// reduced by one chunk (see delay_line_read_fractional timing)
+	const float32_t base = FLANGER_MIN_DELAY - n;
+	const float32_t start = 0.5f - 0.5f * arm_cos_f32(handle->time);
+	lfo_advance(&handle->time, increment * n);
+	const float32_t end = 0.5f - 0.5f * arm_cos_f32(handle->time);
+	// wet is the scratch buffer of the depth until the delay line is read into it
+	sweep_delays(delay, wet, &handle->depth_smooth, base, sweep, start, end, n);
+
+	delay_line_read_fractional(&handle->delay_line, wet, delay, DELAY_LINE_CUBIC, n);
+
+	// write input + DC blocked feedback into the delay line. dst is used as scratch buffer
+	smooth_param_scale(&handle->feedback_smooth, wet, dst, n);
+	dc_blocker_process(&handle->dc_block, dst, dst, n);
+	arm_add_f32(dst, src, dst, n);
+	delay_line_write(&handle->delay_line, dst, n);
+
+	// equal mix of dry and wet signal
+	arm_add_f32(src, wet, dst, n);
+	arm_scale_f32(dst, 0.5f, dst, n);
+}
+
+/******************************************************************************
+* Function Name: run_flanger
+*******************************************************************************
+* Summary:
+*  Run flanger algorithm on sample block. Works like the chorus, but with a shorter delay,
+*  feedback and a fixed 50/50 mix, which results in the typical comb filter sweep.
+*  Since the minimum delay is longer than one chunk, the whole delayed chunk can be read
+*  before the current chunk is written, so the feedback doesn't need a per-sample loop.
+*  Blocks longer than FLANGER_CHUNK are split, so the minimum delay doesn't depend on the block size.
+*
+* Parameters:
+*  1. flanger_handle_t *handle				- Address pointer of flanger handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_flanger(flanger_handle_t *handle, uint32_t block_size)
+{
+	for (uint32_t offset = 0; offset < block_size; offset += FLANGER_CHUNK)
+	{
+		const uint32_t n = ((block_size - offset) < FLANGER_CHUNK) ? (block_size - offset) : FLANGER_CHUNK;
+		flanger_process(handle, &handle->src[offset], &handle->dst[offset], n);
+	}
+}
+
+// ---- Pitch shifter ----
+
+// two read heads sweep through a window of the delay line, each faded in and out with a Hann window, half a window
+// apart: while one head jumps back to the start of the window, the other one is at full level. the heads move at the
+// speed of the pitch difference, so the read signal is played back faster (up) or slower (down).
+// 30 ms: short enough for a tight octave, long enough for the lowest guitar notes (82 Hz = 12 ms period)
+#define PITCH_WINDOW (1440.0f)
+// the line is written before it is read, linear interpolation needs no margin in front
+#define PITCH_MIN_DELAY (2.0f)
+// processed in chunks, so the scratch buffers on the stack stay small
+#define PITCH_CHUNK (64)
+// window + minimum delay + one chunk + interpolation -> 2^11
+#define PITCH_LINE_SIZE (1 << 11)
+
+/******************************************************************************
+* Function Name: pitch_init
+*******************************************************************************
+* Summary:
+*  Initialize pitch shifter handle struct. The delay line memory is only taken by pitch_activate.
+*
+* Parameters:
+*  1. pitch_handle_t *handle				- Address pointer of pitch shifter handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t semitones					- Pitch shift. Range: -PITCH_MAX_SEMITONES <= semitones <= PITCH_MAX_SEMITONES.
+*  5. float32_t blend						- Ratio of dry and shifted signal. Range: 0 <= blend <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t pitch_init(pitch_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t semitones, float32_t blend)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	if ((semitones < -PITCH_MAX_SEMITONES) || (semitones > PITCH_MAX_SEMITONES) || (blend < 0) || (blend > 1))
+	{
+		return 254;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->ratio = powf(2.0f, semitones / 12.0f);
+	handle->blend = blend;
+	smooth_param_init(&handle->blend_smooth, blend, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	oscillator_init(&handle->window[0], OSC_HANN);
+	oscillator_init(&handle->window[1], OSC_HANN);
+	handle->window[1].phase = 0x80000000u;
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: pitch_activate
+*******************************************************************************
+* Summary:
+*  Take the delay line memory from the RAM_D2 arena, when the pitch shifter enters the chain.
+*  If the handle still holds its delay line, it is cleared. Call from the main loop only.
+*
+* Parameters:
+*  1. pitch_handle_t *handle				- Address pointer of an initialized pitch shifter handle struct.
+* Return:
+*  253:										- Arena exhausted.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t pitch_activate(pitch_handle_t *handle)
+{
+	if (handle->delay_line.buffer == NULL)
+	{
+		float32_t *buffer = arena_alloc(ARENA_AHB, PITCH_LINE_SIZE * sizeof(float32_t));
+		if ((buffer == NULL) || delay_line_init(&handle->delay_line, buffer, PITCH_LINE_SIZE))
+		{
+			arena_free(buffer);
+			return 253;
+		}
+	}
+	pitch_reset(handle);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: pitch_deinit
+*******************************************************************************
+* Summary:
+*  Give the delay line memory back to the RAM_D2 arena (the pitch shifter left the chain).
+*
+* Parameters:
+*  1. pitch_handle_t *handle				- Address pointer of pitch shifter handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void pitch_deinit(pitch_handle_t *handle)
+{
+	arena_free(handle->delay_line.buffer);
+	handle->delay_line.buffer = NULL;
+}
+
+/******************************************************************************
+* Function Name: pitch_reset
+*******************************************************************************
+* Summary:
+*  Silence the delay line without giving the memory back, e.g. after the block size changed.
+*
+* Parameters:
+*  1. pitch_handle_t *handle				- Address pointer of pitch shifter handle struct.
+* 
+* Return:
+*  None.
+******************************************************************************/
+void pitch_reset(pitch_handle_t *handle)
+{
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+	handle->window[0].phase = 0;
+	handle->window[1].phase = 0x80000000u;
+	smooth_param_reset(&handle->blend_smooth, handle->blend);
+}
+
+/******************************************************************************
+* Function Name: pitch_update
+*******************************************************************************
+* Summary:
+*  Update pitch shifter parameters.
+*
+* Parameters:
+*  1. pitch_handle_t *handle				- Address pointer of pitch shifter handle struct.
+*  2. pitch_parameter pm					- Enum of pitch shifter parameters.
+*  3. float32_t value						- The new value of the parameter. PITCH_SHIFT in semitones
+*											  (-PITCH_MAX_SEMITONES to PITCH_MAX_SEMITONES), PITCH_BLEND 0 to 1.
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t pitch_update(pitch_handle_t *handle, pitch_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+	case PITCH_SHIFT:
+		if ((value < -PITCH_MAX_SEMITONES) || (value > PITCH_MAX_SEMITONES))
+			return 255;
+		handle->ratio = powf(2.0f, value / 12.0f);
+		break;
+	case PITCH_BLEND:
+		if ((value < 0) || (value > 1.0f))
+			return 255;
+		handle->blend = value;
+		break;
+	}
+
+	return 0;
+}
+
+// one chunk of the pitch shifter, see run_pitch
+#pragma optimize_for_speed
+ITCM_CODE static void pitch_process(pitch_handle_t *handle, const float32_t *src, float32_t *dst, uint32_t n)
+{
+	float32_t position[PITCH_CHUNK];
+	float32_t head[PITCH_CHUNK];
+	float32_t window[PITCH_CHUNK];
+	float32_t wet[PITCH_CHUNK];
+	smooth_param_next(&handle->blend_smooth, handle->blend, n);
+
+	// a head runs through the window once per (window / pitch difference) samples. shifted up, it reads faster than
+	// the line is written: it starts at the far end of the window and approaches the write position
+	const float32_t ratio = handle->ratio;
+	const float32_t frequency = fabsf(ratio - 1.0f) * (Fs / PITCH_WINDOW);
+	const float32_t sweep = (ratio > 1.0f) ? -PITCH_WINDOW : PITCH_WINDOW;
+	const float32_t offset = (ratio > 1.0f) ? (PITCH_MIN_DELAY + PITCH_WINDOW) : PITCH_MIN_DELAY;
+
+	delay_line_write(&handle->delay_line, src, n);
+	for (uint8_t h = 0; h < 2; ++h)
+	{
+		// read positions of the head, then its window: both from the same phase
+		oscillator_ramp(&handle->window[h], position, frequency, n);
+		arm_scale_f32(position, sweep, position, n);
+		arm_offset_f32(position, offset, position, n);
+		delay_line_read_fractional(&handle->delay_line, head, position, DELAY_LINE_LINEAR, n);
+		oscillator_generate(&handle->window[h], window, frequency, n);
+		if (h == 0)
+		{
+			arm_mult_f32(head, window, wet, n);
+		}
+		else
+		{
+			arm_mult_f32(head, window, head, n);
+			arm_add_f32(wet, head, wet, n);
+		}
+	}
+	smooth_param_mix(&handle->blend_smooth, src, wet, dst, n);
+}
+
+/******************************************************************************
+* Function Name: run_pitch
+*******************************************************************************
+* Summary:
+*  Run the pitch shifter on a sample block: two crossfaded read heads over a fractional delay
+*  line (granular delay). The windows of the heads always add up to 1, so the level stays
+*  constant. Every step is a vector function over the chunk, per sample only the fractional
+*  reads and the window lookups remain. The shifted signal lags by half a window on average.
+*
+* Parameters:
+*  1. pitch_handle_t *handle				- Address pointer of pitch shifter handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_pitch(pitch_handle_t *handle, uint32_t block_size)
+{
+	for (uint32_t offset = 0; offset < block_size; offset += PITCH_CHUNK)
+	{
+		const uint32_t n = ((block_size - offset) < PITCH_CHUNK) ? (block_size - offset) : PITCH_CHUNK;
+		pitch_process(handle, &handle->src[offset], &handle->dst[offset], n);
+	}
+}
+
+// ---- Wah ----
+
+// envelope follower of the auto-wah: fast enough for the pick attack, the filter closes with the decay of the note
+#define WAH_ATTACK_MS 5.0f
+#define WAH_RELEASE_MS 80.0f
+// Q at resonance 0 and 1
+#define WAH_MIN_Q 0.7f
+#define WAH_MAX_Q 10.0f
+// envelope gain at sensitivity 0 and 1: the envelope level that sweeps the filter all the way up is 1 / gain
+#define WAH_MIN_SENSITIVITY 1.0f
+#define WAH_MAX_SENSITIVITY 50.0f
+#if (MIN_BLOCK_SIZE % WAH_CONTROL_SIZE)
+#error "MIN_BLOCK_SIZE has to be a multiple of WAH_CONTROL_SIZE"
+#endif
+
+// prewarped cutoff tan(pi * cutoff / Fs) of the bilinear transform for the swept filters. tan is replaced by its series
+// up to the fifth power: the argument stays below 0.18 (WAH_MAX_HZ at 44.1 kHz), where the error is far below 0.01 %
+static inline float32_t prewarp(float32_t cutoff)
+{
+	const float32_t x = PI * cutoff / Fs;
+	const float32_t x2 = x * x;
+	return x * (1.0f + x2 * (1.0f / 3.0f + x2 * (2.0f / 15.0f)));
+}
+
+// coefficients of the TPT state variable filter (Zavalishin) at a cutoff
+static inline void wah_coefficients(float32_t cutoff, float32_t damping, float32_t *a1, float32_t *a2, float32_t *a3)
+{
+	const float32_t g = prewarp(cutoff);
+	*a1 = 1.0f / (1.0f + g * (g + damping));
+	*a2 = g * *a1;
+	*a3 = g * *a2;
+}
+
+/******************************************************************************
+* Function Name: wah_init
+*******************************************************************************
+* Summary:
+*  Initialize wah handle struct. The filter starts at the bottom of the sweep.
+*
+* Parameters:
+*  1. wah_handle_t *handle					- Address pointer of wah handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t sensitivity					- How far the envelope sweeps the filter. Range: 0 <= sensitivity <= 1.
+*  5. float32_t resonance					- Peak of the band pass, Q from WAH_MIN_Q to WAH_MAX_Q. Range: 0 to 1.
+*  6. float32_t rate						- LFO rate, 1 = WAH_MAX_RATE_HZ. 0: the envelope sweeps. Range: 0 to 1.
+*  7. float32_t mix							- Ratio of dry and filtered signal. Range: 0 <= mix <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t wah_init(wah_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t sensitivity, float32_t resonance, float32_t rate, float32_t mix)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	if (wah_update(handle, WAH_SENSITIVITY, sensitivity) || wah_update(handle, WAH_RESONANCE, resonance)
+		|| wah_update(handle, WAH_RATE, rate) || wah_update(handle, WAH_MIX, mix))
+	{
+		return 254;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	smooth_param_init(&handle->mix_smooth, mix, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	envelope_init(&handle->detector, ENVELOPE_PEAK, WAH_ATTACK_MS, WAH_RELEASE_MS);
+	wah_reset(handle);
+
+	return 0;
+}
+
+// filter at the bottom of the sweep with empty integrators, LFO and envelope from the start
+void wah_reset(wah_handle_t *handle)
+{
+	wah_coefficients(WAH_MIN_HZ, handle->damping, &handle->a1, &handle->a2, &handle->a3);
+	handle->ic1 = 0;
+	handle->ic2 = 0;
+	handle->phase = 0;
+	envelope_reset(&handle->detector);
+}
+
+/******************************************************************************
+* Function Name: wah_update
+*******************************************************************************
+* Summary:
+*  Update wah parameters. Sensitivity and resonance are converted to the envelope gain and the
+*  filter damping here, the audio path only evaluates the sweep.
+*
+* Parameters:
+*  1. wah_handle_t *handle					- Address pointer of wah handle struct.
+*  2. wah_parameter pm						- Enum of wah parameters.
+*  3. float32_t value						- 0 to 1 for every parameter (see wah_init).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t wah_update(wah_handle_t *handle, wah_parameter pm, float32_t value)
+{
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
+	switch (pm)
+	{
+	case WAH_SENSITIVITY:
+		// square law: fine steps for hot pickups at the low end
+		handle->sensitivity = WAH_MIN_SENSITIVITY + (WAH_MAX_SENSITIVITY - WAH_MIN_SENSITIVITY) * value * value;
+		break;
+	case WAH_RESONANCE:
+		handle->damping = 1.0f / (WAH_MIN_Q + (WAH_MAX_Q - WAH_MIN_Q) * value);
+		break;
+	case WAH_RATE:
+		handle->rate = WAH_MAX_RATE_HZ * value;
+		break;
+	case WAH_MIX:
+		handle->mix = value;
+		break;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: run_wah
+*******************************************************************************
+* Summary:
+*  Run the wah on a sample block: a band pass state variable filter (topology preserving
+*  transform, stable under fast modulation) swept between WAH_MIN_HZ and WAH_MAX_HZ. The sweep
+*  position comes from the envelope of the input or from the LFO and is evaluated once per
+*  WAH_CONTROL_SIZE samples, the coefficients ramp linearly to the new cutoff within the step.
+*  The square law sweep is close to the exponential one of a pedal, without powf. The band
+*  pass is scaled to unity gain at the cutoff and mixed with the dry signal.
+*
+* Parameters:
+*  1. wah_handle_t *handle					- Address pointer of wah handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers. A multiple of WAH_CONTROL_SIZE.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_wah(wah_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *wet = scratch_pool_alloc(block_size * sizeof(float32_t));
+	const float32_t *src = handle->src;
+	const float32_t damping = handle->damping;
+	const float32_t sensitivity = handle->sensitivity;
+	const float32_t rate = handle->rate;
+	// LFO cycles per control step
+	const float32_t step = rate * WAH_CONTROL_SIZE / Fs;
+	float32_t a1 = handle->a1;
+	float32_t a2 = handle->a2;
+	float32_t a3 = handle->a3;
+	float32_t ic1 = handle->ic1;
+	float32_t ic2 = handle->ic2;
+	float32_t phase = handle->phase;
+
+	for (uint32_t offset = 0; offset < block_size; offset += WAH_CONTROL_SIZE)
+	{
+		// sweep position at the end of the step, 0 to 1
+		float32_t sweep;
+		if (rate > 0)
+		{
+			phase += step;
+			if (phase >= 1.0f)
+				phase -= 1.0f;
+			sweep = 0.5f - 0.5f * arm_cos_f32(2.0f * PI * phase);
+		}
+		else
+		{
+			sweep = fminf(sensitivity * envelope_block(&handle->detector, &src[offset], WAH_CONTROL_SIZE), 1.0f);
+		}
+		float32_t b1, b2, b3;
+		wah_coefficients(WAH_MIN_HZ + (WAH_MAX_HZ - WAH_MIN_HZ) * sweep * sweep, damping, &b1, &b2, &b3);
+		const float32_t d1 = (b1 - a1) * (1.0f / WAH_CONTROL_SIZE);
+		const float32_t d2 = (b2 - a2) * (1.0f / WAH_CONTROL_SIZE);
+		const float32_t d3 = (b3 - a3) * (1.0f / WAH_CONTROL_SIZE);
+
+		for (uint32_t i = offset; i < offset + WAH_CONTROL_SIZE; ++i)
+		{
+			a1 += d1;
+			a2 += d2;
+			a3 += d3;
+			const float32_t v3 = src[i] - ic2;
+			const float32_t v1 = a1 * ic1 + a2 * v3;
+			const float32_t v2 = ic2 + a2 * ic1 + a3 * v3;
+			ic1 = 2.0f * v1 - ic1;
+			ic2 = 2.0f * v2 - ic2;
+			wet[i] = damping * v1;
+		}
+		// the end of the ramp, without the rounding of the additions
+		a1 = b1;
+		a2 = b2;
+		a3 = b3;
+	}
+	handle->a1 = a1;
+	handle->a2 = a2;
+	handle->a3 = a3;
+	handle->ic1 = ic1;
+	handle->ic2 = ic2;
+	handle->phase = phase;
+
+	smooth_param_next(&handle->mix_smooth, handle->mix, block_size);
+	smooth_param_mix(&handle->mix_smooth, src, wet, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Phaser ----
+
+#if (MIN_BLOCK_SIZE % PHASER_CONTROL_SIZE)
+#error "MIN_BLOCK_SIZE has to be a multiple of PHASER_CONTROL_SIZE"
+#endif
+#if (PHASER_MAX_STAGES % PHASER_STAGE_GROUP)
+#error "PHASER_MAX_STAGES has to be a multiple of PHASER_STAGE_GROUP"
+#endif
+
+// coefficient of the first order allpass (a + z^-1) / (1 + a * z^-1) with 90 degrees phase shift at the break frequency
+static inline float32_t phaser_coefficient(float32_t frequency)
+{
+	const float32_t t = prewarp(frequency);
+	return (t - 1.0f) / (t + 1.0f);
+}
+
+/******************************************************************************
+* Function Name: phaser_init
+*******************************************************************************
+* Summary:
+*  Initialize phaser handle struct. The stages start at the middle of the sweep.
+*
+* Parameters:
+*  1. phaser_handle_t *handle				- Address pointer of phaser handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t rate						- LFO rate, 1 = PHASER_MAX_RATE_HZ. 0 holds the sweep. Range: 0 to 1.
+*  5. float32_t depth						- Width of the sweep around its middle. Range: 0 <= depth <= 1.
+*  6. float32_t stages						- 4 (below 1/3), 8 (below 2/3) or 12 allpass stages. Range: 0 to 1.
+*  7. float32_t mix							- Ratio of dry and phase shifted signal, deepest notches at 0.5. Range: 0 to 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t phaser_init(phaser_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth, float32_t stages, float32_t mix)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	if (phaser_update(handle, PHASER_RATE, rate) || phaser_update(handle, PHASER_DEPTH, depth)
+		|| phaser_update(handle, PHASER_STAGES, stages) || phaser_update(handle, PHASER_MIX, mix))
+	{
+		return 254;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	smooth_param_init(&handle->mix_smooth, mix, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	phaser_reset(handle);
+
+	return 0;
+}
+
+// empty stages at the middle of the sweep, LFO from the start
+void phaser_reset(phaser_handle_t *handle)
+{
+	const float32_t middle = 0.5f;
+	handle->coefficient = phaser_coefficient(PHASER_MIN_HZ + (PHASER_MAX_HZ - PHASER_MIN_HZ) * middle * middle);
+	handle->active_stages = handle->stages;
+	for (uint8_t s = 0; s < PHASER_MAX_STAGES; ++s)
+	{
+		handle->state[s] = 0;
+	}
+	oscillator_init(&handle->lfo, OSC_SINE);
+}
+
+/******************************************************************************
+* Function Name: phaser_update
+*******************************************************************************
+* Summary:
+*  Update phaser parameters. The rate is converted to Hz and the stage value to the number of
+*  stages here.
+*
+* Parameters:
+*  1. phaser_handle_t *handle				- Address pointer of phaser handle struct.
+*  2. phaser_parameter pm					- Enum of phaser parameters.
+*  3. float32_t value						- 0 to 1 for every parameter (see phaser_init).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t phaser_update(phaser_handle_t *handle, phaser_parameter pm, float32_t value)
+{
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
+	switch (pm)
+	{
+	case PHASER_RATE:
+		handle->rate = PHASER_MAX_RATE_HZ * value;
+		break;
+	case PHASER_DEPTH:
+		handle->depth = value;
+		break;
+	case PHASER_STAGES:
+	{
+		const uint8_t groups = PHASER_MAX_STAGES / PHASER_STAGE_GROUP;
+		uint8_t group = 1 + (uint8_t)(value * groups);
+		if (group > groups)
+			group = groups;
+		handle->stages = group * PHASER_STAGE_GROUP;
+		break;
+	}
+	case PHASER_MIX:
+		handle->mix = value;
+		break;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: run_phaser
+*******************************************************************************
+* Summary:
+*  Run the phaser on a sample block: 4, 8 or 12 first order allpass stages, all with the same
+*  break frequency, swept by the LFO (square law, as the wah) between PHASER_MIN_HZ and
+*  PHASER_MAX_HZ. Mixed with the dry signal, every two stages give one notch. The coefficient
+*  is evaluated once per PHASER_CONTROL_SIZE samples and ramps linearly within the step. A step
+*  is loaded once and runs through a group of PHASER_STAGE_GROUP stages sample by sample, the
+*  samples, the ramp and the group's states stay in registers: per stage no block buffer is
+*  written and read again, and the unrolled group leaves the compiler independent stages to
+*  interleave.
+*
+* Parameters:
+*  1. phaser_handle_t *handle				- Address pointer of phaser handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers. A multiple of PHASER_CONTROL_SIZE.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_phaser(phaser_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *wet = scratch_pool_alloc(block_size * sizeof(float32_t));
+	float32_t lfo[MAX_BLOCK_SIZE / PHASER_CONTROL_SIZE];
+	const float32_t *src = handle->src;
+	const float32_t depth = handle->depth;
+	const uint8_t stages = handle->stages;
+	float32_t *state = handle->state;
+	float32_t a = handle->coefficient;
+
+	// stages added since the last block start empty
+	for (uint8_t s = handle->active_stages; s < stages; ++s)
+	{
+		state[s] = 0;
+	}
+	handle->active_stages = stages;
+
+	// one LFO value per control step
+	oscillator_generate(&handle->lfo, lfo, handle->rate * PHASER_CONTROL_SIZE, block_size / PHASER_CONTROL_SIZE);
+
+	for (uint32_t offset = 0, k = 0; offset < block_size; offset += PHASER_CONTROL_SIZE, ++k)
+	{
+		// sweep position at the end of the step, 0 to 1
+		const float32_t sweep = 0.5f + 0.5f * depth * lfo[k];
+		const float32_t b = phaser_coefficient(PHASER_MIN_HZ + (PHASER_MAX_HZ - PHASER_MIN_HZ) * sweep * sweep);
+		const float32_t d = (b - a) * (1.0f / PHASER_CONTROL_SIZE);
+		float32_t c[PHASER_CONTROL_SIZE];
+		float32_t v[PHASER_CONTROL_SIZE];
+		for (uint32_t i = 0; i < PHASER_CONTROL_SIZE; ++i)
+		{
+			a += d;
+			c[i] = a;
+			v[i] = src[offset + i];
+		}
+		// the end of the ramp, without the rounding of the additions
+		a = b;
+
+		for (uint8_t s = 0; s < stages; s += PHASER_STAGE_GROUP)
+		{
+			float32_t z0 = state[s];
+			float32_t z1 = state[s + 1];
+			float32_t z2 = state[s + 2];
+			float32_t z3 = state[s + 3];
+			for (uint32_t i = 0; i < PHASER_CONTROL_SIZE; ++i)
+			{
+				// transposed direct form: y = a * x + z, z = x - a * y
+				const float32_t y0 = c[i] * v[i] + z0;
+				z0 = v[i] - c[i] * y0;
+				const float32_t y1 = c[i] * y0 + z1;
+				z1 = y0 - c[i] * y1;
+				const float32_t y2 = c[i] * y1 + z2;
+				z2 = y1 - c[i] * y2;
+				const float32_t y3 = c[i] * y2 + z3;
+				z3 = y2 - c[i] * y3;
+				v[i] = y3;
+			}
+			state[s] = z0;
+			state[s + 1] = z1;
+			state[s + 2] = z2;
+			state[s + 3] = z3;
+		}
+
+		for (uint32_t i = 0; i < PHASER_CONTROL_SIZE; ++i)
+		{
+			wet[offset + i] = v[i];
+		}
+	}
+	handle->coefficient = a;
+
+	smooth_param_next(&handle->mix_smooth, handle->mix, block_size);
+	smooth_param_mix(&handle->mix_smooth, src, wet, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Amp model ----
+
+// gain range of input and level around 0 dB at 0.5
+#define AMP_GAIN_RANGE_DB 12.0f
+
+static inline float32_t amp_gain(float32_t value)
+{
+	return powf(10.0f, AMP_GAIN_RANGE_DB * (2.0f * value - 1.0f) / 20.0f);
+}
+
+/******************************************************************************
+* Function Name: amp_init
+*******************************************************************************
+* Summary:
+*  Initialize amp handle struct. The channels of a stereo build share the model, every channel
+*  has its own state.
+*
+* Parameters:
+*  1. amp_handle_t *handle					- Address pointer of amp handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. amp_model_t *model					- Model the audio path runs. Empty (amp_model_clear) until a
+*											  model is loaded, the input passes through then.
+*  5. float32_t input						- Gain in front of the model, -12 to +12 dB. Range: 0 <= input <= 1.
+*  6. float32_t level						- Gain behind the model, -12 to +12 dB. Range: 0 <= level <= 1.
+*  7. float32_t mix							- Ratio of dry and modeled signal. Range: 0 <= mix <= 1.
+* Return:
+*  255:										- Sample buffers or model point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t amp_init(amp_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, amp_model_t *model, float32_t input, float32_t level, float32_t mix)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL) || (model == NULL))
+	{
+		return 255;
+	}
+	if (amp_update(handle, AMP_INPUT, input) || amp_update(handle, AMP_LEVEL, level) || amp_update(handle, AMP_MIX, mix))
+	{
+		return 254;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->model = model;
+	handle->pending = NULL;
+	smooth_param_init(&handle->input_smooth, handle->input, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->level_smooth, handle->level, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->mix_smooth, mix, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+#if defined(AMP_POST_M4)
+	handle->overruns = 0;
+#endif
+	amp_reset(handle);
+
+	return 0;
+}
+
+// empty recurrent and filter states, e.g. after the block size changed
+void amp_reset(amp_handle_t *handle)
+{
+	amp_state_reset(&handle->state, handle->model);
+	handle->serial = handle->model->serial;
+#if defined(AMP_POST_M4)
+	memset(handle->fifo_in, 0, sizeof(handle->fifo_in));
+	memset(handle->fifo_out, 0, sizeof(handle->fifo_out));
+	handle->fifo_fill = 0;
+#endif
+}
+
+/******************************************************************************
+* Function Name: amp_update
+*******************************************************************************
+* Summary:
+*  Update amp parameters. Input and level are converted to linear gains here.
+*
+* Parameters:
+*  1. amp_handle_t *handle					- Address pointer of amp handle struct.
+*  2. amp_parameter pm						- Enum of amp parameters.
+*  3. float32_t value						- 0 to 1 for every parameter (see amp_init).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t amp_update(amp_handle_t *handle, amp_parameter pm, float32_t value)
+{
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
+	switch (pm)
+	{
+	case AMP_INPUT:
+		handle->input = amp_gain(value);
+		break;
+	case AMP_LEVEL:
+		handle->level = amp_gain(value);
+		break;
+	case AMP_MIX:
+		handle->mix = value;
+		break;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: amp_load
+*******************************************************************************
+* Summary:
+*  Hand a prepared model (amp_model_load, or library_load_amp and amp_model_prepare) over to
+*  the audio path. The next block copies it into the model of the audio path, about 18 KB for 32 LSTM
+*  units, and every channel starts from an empty state. Call for every channel. The model
+*  must not change until the blocks took it (pending is NULL again). Main loop.
+*
+* Parameters:
+*  1. amp_handle_t *handle					- Address pointer of amp handle struct.
+*  2. const amp_model_t *model				- Prepared model, anywhere in memory.
+* 
+* Return:
+*  255:										- Model points to NULL.
+*  254:										- The model wasn't prepared (see amp_model_check).
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t amp_load(amp_handle_t *handle, const amp_model_t *model)
+{
+	if (model == NULL)
+	{
+		return 255;
+	}
+	if ((model->hidden > 0) && amp_model_check(model->cell, model->hidden, model->skip, model->post_stages))
+	{
+		return 254;
+	}
+	handle->pending = model;
+	return 0;
+}
+
+#if defined(AMP_POST_M4)
+// post-filter on the M4, one chunk behind. longer blocks are exchanged chunk by chunk, shorter blocks are collected
+// until one chunk is complete, as in run_reverb
+#pragma optimize_for_speed
+ITCM_CODE static void amp_post_m4(amp_handle_t *handle, float32_t *wet, uint32_t block_size)
+{
+	float32_t chunk[BLOCK_QUEUE_BLOCK_SIZE];
+
+	if (block_size >= BLOCK_QUEUE_BLOCK_SIZE)
+	{
+		for (uint32_t offset = 0; offset < block_size; offset += BLOCK_QUEUE_BLOCK_SIZE)
+		{
+			handle->overruns += dual_core_post(&wet[offset], chunk);
+			arm_copy_f32(chunk, &wet[offset], BLOCK_QUEUE_BLOCK_SIZE);
+		}
+	}
+	else
+	{
+		arm_copy_f32(wet, &handle->fifo_in[handle->fifo_fill], block_size);
+		arm_copy_f32(&handle->fifo_out[handle->fifo_fill], wet, block_size);
+		handle->fifo_fill += block_size;
+		if (handle->fifo_fill >= BLOCK_QUEUE_BLOCK_SIZE)
+		{
+			handle->overruns += dual_core_post(handle->fifo_in, handle->fifo_out);
+			handle->fifo_fill = 0;
+		}
+	}
+}
+#endif
+
+/******************************************************************************
+* Function Name: run_amp
+*******************************************************************************
+* Summary:
+*  Run the amp model on a sample block: input gain, recurrent layer and dense output
+*  (amp_model_process), post-filter, level and mix with the dry signal. A model handed over
+*  by amp_load is taken at the start of the block. With AMP_POST_M4 the M4 runs the
+*  post-filter of the left channel and the modeled signal is one chunk late.
+*
+* Parameters:
+*  1. amp_handle_t *handle					- Address pointer of amp handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers. With AMP_POST_M4 a divisor or
+*											  a multiple of BLOCK_QUEUE_BLOCK_SIZE.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_amp(amp_handle_t *handle, uint32_t block_size)
+{
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *wet = scratch_pool_alloc(block_size * sizeof(float32_t));
+	amp_model_t *model = handle->model;
+	const amp_model_t *pending = handle->pending;
+
+	// the first channel copies the new model, every channel starts from an empty state
+	if (pending != NULL)
+	{
+		if (pending->serial != model->serial)
+			memcpy(model, pending, amp_model_size(pending));
+		handle->pending = NULL;
+	}
+	if (handle->serial != model->serial)
+	{
+		amp_reset(handle);
+#if defined(AMP_POST_M4)
+		dual_core_set_post(amp_model_post(model), (model->hidden > 0) ? model->post_stages : 0);
+#endif
+	}
+
+	smooth_param_next(&handle->input_smooth, handle->input, block_size);
+	smooth_param_next(&handle->level_smooth, handle->level, block_size);
+	smooth_param_next(&handle->mix_smooth, handle->mix, block_size);
+
+	smooth_param_scale(&handle->input_smooth, handle->src, wet, block_size);
+	amp_model_process(model, &handle->state, wet, wet, block_size);
+#if defined(AMP_POST_M4)
+	if (dual_core_ready())
+		amp_post_m4(handle, wet, block_size);
+	else
+		amp_model_filter(model, &handle->state, wet, wet, block_size);
+#else
+	amp_model_filter(model, &handle->state, wet, wet, block_size);
+#endif
+	smooth_param_scale(&handle->level_smooth, wet, wet, block_size);
+	smooth_param_mix(&handle->mix_smooth, handle->src, wet, handle->dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// samples the wet signal lags: the post-filter on the M4 returns every chunk with the next one
+uint32_t amp_latency(const amp_handle_t *handle)
+{
+	// the same for every handle
+	(void)handle;
+#if defined(AMP_POST_M4)
+	return dual_core_ready() ? BLOCK_QUEUE_BLOCK_SIZE : 0;
+#else
+	return 0;
+#endif
+}
+
+// ---- Effects loop ----
+
+/******************************************************************************
+* Function Name: fxloop_init
+*******************************************************************************
+* Summary:
+*  Initialize effects loop handle struct. The loop sends its input to an external pedal on the
+*  free codec channel FXLOOP_SLOT and returns what comes back from it. The return of a block
+*  belongs to the send DMA_BLOCKS blocks (input to output of the pedal) plus the latency
+*  before, the dry signal of the mix is delayed by the same round trip, so a parallel loop
+*  doesn't comb filter.
+*
+* Parameters:
+*  1. fxloop_handle_t *handle				- Address pointer of effects loop handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. float32_t mix							- Ratio of dry and returned signal. Range: 0 <= mix <= 1.
+*  5. float32_t latency						- Round trip beyond the DMA blocks, 0 to FXLOOP_MAX_LATENCY
+*											  samples. Range: 0 <= latency <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t fxloop_init(fxloop_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t mix, float32_t latency)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	if (fxloop_update(handle, FXLOOP_MIX, mix) || fxloop_update(handle, FXLOOP_LATENCY, latency))
+	{
+		return 254;
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->send = NULL;
+	handle->ret = NULL;
+	handle->sent = false;
+	smooth_param_init(&handle->mix_smooth, mix, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	fxloop_reset(handle);
+
+	return 0;
+}
+
+// empty dry delay line, e.g. after the block size changed
+void fxloop_reset(fxloop_handle_t *handle)
+{
+	memset(handle->dry, 0, sizeof(handle->dry));
+	handle->write = 0;
+}
+
+/******************************************************************************
+* Function Name: fxloop_update
+*******************************************************************************
+* Summary:
+*  Update effects loop parameters. The latency is converted to samples here.
+*
+* Parameters:
+*  1. fxloop_handle_t *handle				- Address pointer of effects loop handle struct.
+*  2. fxloop_parameter pm					- Enum of effects loop parameters.
+*  3. float32_t value						- 0 to 1 for every parameter (see fxloop_init).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t fxloop_update(fxloop_handle_t *handle, fxloop_parameter pm, float32_t value)
+{
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
+	switch (pm)
+	{
+	case FXLOOP_MIX:
+		handle->mix = value;
+		break;
+	case FXLOOP_LATENCY:
+		handle->latency = (uint32_t)(value * FXLOOP_MAX_LATENCY + 0.5f);
+		break;
+	}
+
+	return 0;
+}
+
+// round trip beyond the DMA blocks in samples, e.g. as measured through a loopback cable. 255 above FXLOOP_MAX_LATENCY
+uint8_t fxloop_set_latency(fxloop_handle_t *handle, uint32_t samples)
+{
+	if (samples > FXLOOP_MAX_LATENCY)
+	{
+		return 255;
+	}
+	handle->latency = samples;
+	return 0;
+}
+
+// samples the output of run_fxloop lags its input at a block size: the round trip its dry signal is delayed by, 0 while
+// it passes the input through (no send, see fxloop_set_block)
+uint32_t fxloop_latency(const fxloop_handle_t *handle, uint32_t block_size)
+{
+	return (handle->send != NULL) ? (DMA_BLOCKS * block_size + handle->latency) : 0;
+}
+
+// first codec word of the channel in the DMA blocks the next run_fxloop sends to and returns from. audio path
+ITCM_CODE void fxloop_set_block(fxloop_handle_t *handle, uint32_t *send, const uint32_t *ret)
+{
+	handle->send = send;
+	handle->ret = ret;
+}
+
+// whether run_fxloop wrote the send since the last call. a send that isn't written anymore has to be silenced
+ITCM_CODE bool fxloop_take_sent(fxloop_handle_t *handle)
+{
+	const bool sent = handle->sent;
+	handle->sent = false;
+	return sent;
+}
+
+/******************************************************************************
+* Function Name: run_fxloop
+*******************************************************************************
+* Summary:
+*  Write the input block as codec words into the send channel of the transmit block and take
+*  the return channel of the received block as the wet signal. Both are converted on the way
+*  between the DMA block and the node buffers, nothing else is copied: the out-buffer is the
+*  scratch of the conversions. The dry signal is read back from the delay line DMA_BLOCKS
+*  blocks plus the latency late, in line with the return. Without a free codec channel the
+*  input passes through.
+*
+* Parameters:
+*  1. fxloop_handle_t *handle				- Address pointer of effects loop handle struct.
+*  2. uint32_t block_size					- Number of samples the effect processes per call.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_fxloop(fxloop_handle_t *handle, uint32_t block_size)
+{
+	const float32_t *src = handle->src;
+	float32_t *dst = handle->dst;
+	q31_t *words = (q31_t *)dst;
+	const uint32_t mask = FXLOOP_DELAY_SIZE - 1;
+
+	smooth_param_next(&handle->mix_smooth, handle->mix, block_size);
+	if (handle->send == NULL)
+	{
+		arm_copy_f32(src, dst, block_size);
+		return;
+	}
+
+	// the round trip is longer than a block: the samples read are older than those written
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *dry = scratch_pool_alloc(block_size * sizeof(float32_t));
+	const uint32_t w = handle->write;
+	const uint32_t r = (w - (DMA_BLOCKS * block_size + handle->latency)) & mask;
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dry[i] = handle->dry[(r + i) & mask];
+		handle->dry[(w + i) & mask] = src[i];
+	}
+	handle->write = (w + block_size) & mask;
+
+	// saturated and right aligned as tx_samples does it
+	arm_float_to_q31(src, words, block_size);
+	uint32_t *send = handle->send;
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		send[i * AUDIO_FRAME_WORDS] = (uint32_t)(words[i] >> FXLOOP_CODEC_SHIFT);
+	}
+	handle->sent = true;
+
+	const uint32_t *ret = handle->ret;
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		words[i] = (q31_t)(ret[i * AUDIO_FRAME_WORDS] << FXLOOP_CODEC_SHIFT);
+	}
+	arm_q31_to_float(words, dst, block_size);
+	smooth_param_mix(&handle->mix_smooth, dry, dst, dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- Spectral effects ----
+
+// buffers of the STFT of a spectral effect: DTCM while the cabinet and the limiters leave room, D2 SRAM otherwise (the
+// reverb spectra fill RAM_D1). memory already held is cleared
+static uint8_t spectral_activate(stft_t *stft)
+{
+	if (stft->input != NULL)
+	{
+		stft_reset(stft);
+		return 0;
+	}
+	float32_t *memory = arena_alloc(ARENA_TCM, STFT_MEMORY_SIZE);
+	if (memory == NULL)
+	{
+		memory = arena_alloc(ARENA_AHB, STFT_MEMORY_SIZE);
+	}
+	return stft_attach(stft, memory) ? 253 : 0;
+}
+
+// ---- Noise reduction ----
+
+// lowest power seen by the noise tracking and the gain computer, avoids the division by 0
+#define DENOISE_MIN_POWER (1e-12f)
+// the lowest smoothed power of a window lies this far below the mean power of the noise (DENOISE_SMOOTHING and
+// DENOISE_WINDOW_MS, white noise)
+#define DENOISE_BIAS (3.5f)
+
+/******************************************************************************
+* Function Name: denoise_spectrum
+*******************************************************************************
+* Summary:
+*  Spectral subtraction of one STFT frame. The power of every bin is smoothed over the frames,
+*  the noise estimate is its lowest value over the last one to two windows of
+*  DENOISE_WINDOW_MS (minimum statistics: the pauses between the notes). The gain of a bin is
+*  1 - over * noise / power, not below the floor, it rises at once and falls by DENOISE_RELEASE
+*  per frame (less musical noise). Bin 0 carries DC and Nyquist, both get the gain of their sum.
+*
+* Parameters:
+*  1. void *ctx						- Address pointer of the noise reduction handle struct.
+*  2. float32_t *spectrum			- STFT_BINS complex bins, changed in place.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void denoise_spectrum(void *ctx, float32_t *spectrum)
+{
+	denoise_handle_t *handle = ctx;
+	float32_t power[STFT_BINS];
+	const float32_t floor = handle->floor;
+	const float32_t over = handle->over;
+
+	arm_cmplx_mag_squared_f32(spectrum, power, STFT_BINS);
+	for (uint32_t k = 0; k < STFT_BINS; ++k)
+	{
+		const float32_t smoothed = fmaxf(handle->power[k] + DENOISE_SMOOTHING * (power[k] - handle->power[k]), DENOISE_MIN_POWER);
+		handle->power[k] = smoothed;
+		handle->minimum[k] = fminf(handle->minimum[k], smoothed);
+		const float32_t noise = DENOISE_BIAS * fminf(handle->minimum[k], handle->previous[k]);
+		const float32_t gain = fmaxf(1.0f - over * noise / smoothed, floor);
+		handle->gain[k] = (gain > handle->gain[k]) ? gain : (handle->gain[k] + DENOISE_RELEASE * (gain - handle->gain[k]));
+	}
+	arm_cmplx_mult_real_f32(spectrum, handle->gain, spectrum, STFT_BINS);
+
+	// the window is over: its minimum becomes the previous one, the next window starts with the current power
+	handle->window_fill += handle->stft.hop;
+	if (handle->window_fill >= (uint32_t)(DENOISE_WINDOW_MS * (Fs / 1000.0f)))
+	{
+		arm_copy_f32(handle->minimum, handle->previous, STFT_BINS);
+		arm_copy_f32(handle->power, handle->minimum, STFT_BINS);
+		handle->window_fill = 0;
+	}
+}
+
+/******************************************************************************
+* Function Name: denoise_init
+*******************************************************************************
+* Summary:
+*  Initialize noise reduction handle struct. The STFT memory is only taken by
+*  denoise_activate, a handle that holds it already keeps it.
+*
+* Parameters:
+*  1. denoise_handle_t *handle				- Address pointer of noise reduction handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. uint8_t slot							- STFT frame slot (see stft.h). Range: 0 <= slot < STFT_SLOTS.
+*  5. float32_t amount						- Deepest attenuation, 0 to DENOISE_MAX_REDUCTION_DB. Range: 0 <= amount <= 1.
+*  6. float32_t sensitivity					- Noise estimate subtracted 1 to 3 times. Range: 0 <= sensitivity <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values or slot are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t denoise_init(denoise_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, uint8_t slot, float32_t amount, float32_t sensitivity)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	float32_t *memory = handle->stft.input;
+	if (denoise_update(handle, DENOISE_AMOUNT, amount) || denoise_update(handle, DENOISE_SENSITIVITY, sensitivity) ||
+		stft_init(&handle->stft, STFT_WINDOW_SQRT_HANN, STFT_HOP_HALF, slot, denoise_spectrum, handle))
+	{
+		return 254;
+	}
+	if (memory != NULL)
+	{
+		stft_attach(&handle->stft, memory);
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	denoise_reset(handle);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: denoise_activate
+*******************************************************************************
+* Summary:
+*  Take the STFT memory from an arena, when the noise reduction enters the chain. If the handle
+*  still holds it, it is cleared. Call from the main loop only.
+*
+* Parameters:
+*  1. denoise_handle_t *handle				- Address pointer of an initialized noise reduction handle struct.
+* Return:
+*  253:										- Arenas exhausted.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t denoise_activate(denoise_handle_t *handle)
+{
+	if (spectral_activate(&handle->stft))
+	{
+		return 253;
+	}
+	denoise_reset(handle);
+	return 0;
+}
+
+// give the STFT memory back (the noise reduction left the chain)
+void denoise_deinit(denoise_handle_t *handle)
+{
+	arena_free(stft_detach(&handle->stft));
+}
+
+// silence the frames and start the noise tracking over, e.g. after the block size changed. no reduction until the
+// first windows are through
+void denoise_reset(denoise_handle_t *handle)
+{
+	stft_reset(&handle->stft);
+	arm_fill_f32(0.0f, handle->power, STFT_BINS);
+	arm_fill_f32(0.0f, handle->minimum, STFT_BINS);
+	arm_fill_f32(0.0f, handle->previous, STFT_BINS);
+	arm_fill_f32(1.0f, handle->gain, STFT_BINS);
+	handle->window_fill = 0;
+}
+
+/******************************************************************************
+* Function Name: denoise_update
+*******************************************************************************
+* Summary:
+*  Update noise reduction parameters. The floor gain and the over-subtraction are computed here.
+*
+* Parameters:
+*  1. denoise_handle_t *handle				- Address pointer of noise reduction handle struct.
+*  2. denoise_parameter pm					- Enum of noise reduction parameters.
+*  3. float32_t value						- 0 to 1 for every parameter (see denoise_init).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t denoise_update(denoise_handle_t *handle, denoise_parameter pm, float32_t value)
+{
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
+	switch (pm)
+	{
+	case DENOISE_AMOUNT:
+		handle->floor = fast_db_to_gain(-DENOISE_MAX_REDUCTION_DB * value);
+		break;
+	case DENOISE_SENSITIVITY:
+		handle->over = 1.0f + 2.0f * value;
+		break;
+	}
+
+	return 0;
+}
+
+// spectral subtraction of one block, see denoise_spectrum. outputs silence without STFT memory
+#pragma optimize_for_speed
+ITCM_CODE void run_denoise(denoise_handle_t *handle, uint32_t block_size)
+{
+	stft_process(&handle->stft, handle->src, handle->dst, block_size);
+}
+
+// samples the output lags the input: one STFT frame
+uint32_t denoise_latency(const denoise_handle_t *handle)
+{
+	return stft_latency(&handle->stft);
+}
+
+// ---- Freeze ----
+
+/******************************************************************************
+* Function Name: freeze_spectrum
+*******************************************************************************
+* Summary:
+*  Mix the held spectrum into one STFT frame. The first frame after hold is set is captured:
+*  its magnitudes are kept, every frame gets them with new random phases, so the overlapping
+*  frames sustain the sound without repeating a period. The held part fades in and out over
+*  FREEZE_FADE_FRAMES frames, the live spectrum is scaled down by the same amount.
+*
+* Parameters:
+*  1. void *ctx						- Address pointer of the freeze handle struct.
+*  2. float32_t *spectrum			- STFT_BINS complex bins, changed in place.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void freeze_spectrum(void *ctx, float32_t *spectrum)
+{
+	freeze_handle_t *handle = ctx;
+	const bool hold = handle->hold;
+
+	if (hold && !handle->captured)
+	{
+		arm_cmplx_mag_f32(spectrum, handle->magnitude, STFT_BINS);
+		// DC and Nyquist share bin 0, the held sound leaves them out
+		handle->magnitude[0] = 0.0f;
+	}
+	handle->captured = hold;
+	const float32_t target = hold ? 1.0f : 0.0f;
+	handle->level += fminf(fmaxf(target - handle->level, -1.0f / FREEZE_FADE_FRAMES), 1.0f / FREEZE_FADE_FRAMES);
+	if (handle->level <= 0.0f)
+	{
+		handle->level = 0.0f;
+		return;
+	}
+
+	const float32_t wet = handle->blend * handle->level;
+	// the frames of random phase add up in power, not in amplitude: N / hop frames overlap, each carries hop / N of the
+	// power of the captured frame
+	const float32_t level = wet * sqrtf((float32_t)STFT_FFT_SIZE / handle->stft.hop);
+	arm_scale_f32(spectrum, 1.0f - wet, spectrum, STFT_FFT_SIZE);
+	uint32_t seed = handle->seed;
+	for (uint32_t k = 1; k < STFT_BINS; ++k)
+	{
+		// linear congruential generator, the upper 24 bits are the phase
+		seed = seed * 1664525u + 1013904223u;
+		const float32_t phase = (float32_t)(seed >> 8) * (2.0f * PI / 16777216.0f);
+		const float32_t m = level * handle->magnitude[k];
+		spectrum[2 * k] += m * arm_cos_f32(phase);
+		spectrum[2 * k + 1] += m * arm_sin_f32(phase);
+	}
+	handle->seed = seed;
+}
+
+/******************************************************************************
+* Function Name: freeze_init
+*******************************************************************************
+* Summary:
+*  Initialize freeze handle struct. The STFT memory is only taken by freeze_activate, a handle
+*  that holds it already keeps it.
+*
+* Parameters:
+*  1. freeze_handle_t *handle				- Address pointer of freeze handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. uint8_t slot							- STFT frame slot (see stft.h). Range: 0 <= slot < STFT_SLOTS.
+*  5. float32_t hold						- Capture and sustain the spectrum from 0.5 on. Range: 0 <= hold <= 1.
+*  6. float32_t blend						- Ratio of live and held spectrum. Range: 0 <= blend <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values or slot are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t freeze_init(freeze_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, uint8_t slot, float32_t hold, float32_t blend)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	float32_t *memory = handle->stft.input;
+	// a quarter hop: the random phases of four frames overlap, the held sound doesn't flutter
+	if (freeze_update(handle, FREEZE_HOLD, hold) || freeze_update(handle, FREEZE_BLEND, blend) ||
+		stft_init(&handle->stft, STFT_WINDOW_SQRT_HANN, STFT_HOP_QUARTER, slot, freeze_spectrum, handle))
+	{
+		return 254;
+	}
+	if (memory != NULL)
+	{
+		stft_attach(&handle->stft, memory);
+	}
+
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->seed = 1;
+	freeze_reset(handle);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: freeze_activate
+*******************************************************************************
+* Summary:
+*  Take the STFT memory from an arena, when the freeze enters the chain. If the handle still
+*  holds it, it is cleared. Call from the main loop only.
+*
+* Parameters:
+*  1. freeze_handle_t *handle				- Address pointer of an initialized freeze handle struct.
+* Return:
+*  253:										- Arenas exhausted.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t freeze_activate(freeze_handle_t *handle)
+{
+	if (spectral_activate(&handle->stft))
+	{
+		return 253;
+	}
+	freeze_reset(handle);
+	return 0;
+}
+
+// give the STFT memory back (the freeze left the chain)
+void freeze_deinit(freeze_handle_t *handle)
+{
+	arena_free(stft_detach(&handle->stft));
+}
+
+// silence the frames and drop the held spectrum, e.g. after the block size changed. a hold that is still set
+// captures again
+void freeze_reset(freeze_handle_t *handle)
+{
+	stft_reset(&handle->stft);
+	arm_fill_f32(0.0f, handle->magnitude, STFT_BINS);
+	handle->level = 0.0f;
+	handle->captured = false;
+}
+
+/******************************************************************************
+* Function Name: freeze_update
+*******************************************************************************
+* Summary:
+*  Update freeze parameters.
+*
+* Parameters:
+*  1. freeze_handle_t *handle				- Address pointer of freeze handle struct.
+*  2. freeze_parameter pm					- Enum of freeze parameters.
+*  3. float32_t value						- 0 to 1 for every parameter (see freeze_init).
+* 
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t freeze_update(freeze_handle_t *handle, freeze_parameter pm, float32_t value)
+{
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
+	switch (pm)
+	{
+	case FREEZE_HOLD:
+		handle->hold = (value >= 0.5f);
+		break;
+	case FREEZE_BLEND:
+		handle->blend = value;
+		break;
+	}
+
+	return 0;
+}
+
+// live and held spectrum of one block, see freeze_spectrum. outputs silence without STFT memory
+#pragma optimize_for_speed
+ITCM_CODE void run_freeze(freeze_handle_t *handle, uint32_t block_size)
+{
+	stft_process(&handle->stft, handle->src, handle->dst, block_size);
+}
+
+// samples the output lags the input: one STFT frame
+uint32_t freeze_latency(const freeze_handle_t *handle)
+{
+	return stft_latency(&handle->stft);
+}
+
+// ---- Ping-pong delay ----
+
+// frames per line: the ping-pong holds PINGPONG_MAX_TIME per side plus one chunk at AUDIO_MAX_SAMPLE_RATE
+// (340 ms * 96 frames/ms + 64 < 32768). both lines interleaved: 2^16 floats, 256 KB
+#define PINGPONG_LINE_FRAMES (1 << 15)
+// the lines are computed in chunks: the feedback of a chunk is read before the chunk is written, so the time can't be
+// shorter than a chunk. the scratch buffers on the stack stay small
+#define PINGPONG_CHUNK (64)
+#define PINGPONG_MAX_FRAMES (PINGPONG_LINE_FRAMES - PINGPONG_CHUNK)
+// the loop has to decay: 1 would repeat forever
+#define PINGPONG_MAX_FEEDBACK (0.95f)
+// PINGPONG_MAX_TIME at every sample rate
+#define PINGPONG_TIME_FRAMES (PINGPONG_MAX_TIME * (AUDIO_MAX_SAMPLE_RATE / 1000))
+#if (PINGPONG_TIME_FRAMES > PINGPONG_MAX_FRAMES)
+#error "PINGPONG_LINE_FRAMES too short for PINGPONG_MAX_TIME at AUDIO_MAX_SAMPLE_RATE"
+#endif
+
+// time per side in frames at the current sample rate, from one chunk up to PINGPONG_MAX_TIME at the highest rate
+static uint32_t pingpong_frames(float32_t delay_ms)
+{
+	const uint32_t frames = (uint32_t)(delay_ms * (Fs / 1000.0f));
+	return (frames < PINGPONG_CHUNK) ? PINGPONG_CHUNK : (frames > PINGPONG_TIME_FRAMES) ? PINGPONG_TIME_FRAMES : frames;
+}
+
+/******************************************************************************
+* Function Name: pingpong_init
+*******************************************************************************
+* Summary:
+*  Initialize the ping-pong delay handle struct. One handle serves both channels, the line
+*  memory is only taken by pingpong_activate.
+*
+* Parameters:
+*  1. pingpong_handle_t *handle				- Address pointer of ping-pong handle struct.
+*  2. float32_t *const in_buffer[]			- Input block of every channel.
+*  3. float32_t *const out_buffer[]			- Output block of every channel.
+*  4. float32_t delay_ms					- Time between two repeats (one side). Range: 0 <= delay_ms <= PINGPONG_MAX_TIME,
+*											  at least one chunk.
+*  5. float32_t feedback					- Level of every repeat. Range: 0 <= feedback <= PINGPONG_MAX_FEEDBACK.
+*  6. float32_t cross						- Share of the repeats that change sides. Range: 0 <= cross <= 1.
+*  7. float32_t blend						- Ratio of dry and wet mix. Range: 0 <= blend <= 1.
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t pingpong_init(pingpong_handle_t *handle, float32_t *const in_buffer[AUDIO_CHANNELS], float32_t *const out_buffer[AUDIO_CHANNELS], float32_t delay_ms, float32_t feedback, float32_t cross, float32_t blend)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		if ((in_buffer[ch] == NULL) || (out_buffer[ch] == NULL))
+		{
+			return 255;
+		}
+	}
+	if ((delay_ms < 0.0f) || (delay_ms > PINGPONG_MAX_TIME) || (feedback < 0.0f) || (feedback > PINGPONG_MAX_FEEDBACK)
+		|| (cross < 0.0f) || (cross > 1.0f) || (blend < 0.0f) || (blend > 1.0f))
+	{
+		return 254;
+	}
+
+#if (AUDIO_CHANNELS == 2)
+	handle->src[0] = in_buffer[0];
+	handle->src[1] = in_buffer[1];
+	handle->dst[0] = out_buffer[0];
+	handle->dst[1] = out_buffer[1];
+#else
+	handle->src[0] = in_buffer[0];
+	handle->src[1] = in_buffer[0];
+	handle->dst[0] = out_buffer[0];
+	handle->dst[1] = NULL;
+#endif
+	handle->delay_ms = delay_ms;
+	handle->feedback = feedback;
+	handle->cross = cross;
+	handle->blend = blend;
+	smooth_param_init(&handle->feedback_smooth, feedback, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->cross_smooth, cross, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	smooth_param_init(&handle->blend_smooth, blend, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	handle->delay_in_frames = pingpong_frames(delay_ms);
+	handle->tap_from = handle->delay_in_frames;
+	handle->tap_to = handle->delay_in_frames;
+	smooth_param_init(&handle->tap_fade, 1.0f, SMOOTH_LINEAR, DELAY_CROSSFADE_MS);
+	if (handle->delay_line.buffer != NULL)
+		pingpong_reset(handle);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: pingpong_activate
+*******************************************************************************
+* Summary:
+*  Take the line memory when the ping-pong delay enters the chain: from the RAM_D2 arena like
+*  the other delay lines, from the RAM_D1 arena if the delay lines of both channels are still
+*  held there (dual mono during a crossfade from the delay). If the handle still holds its
+*  line, it is cleared. Call from the main loop only.
+*
+* Parameters:
+*  1. pingpong_handle_t *handle				- Address pointer of an initialized ping-pong handle struct.
+* Return:
+*  253:										- Arenas exhausted.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t pingpong_activate(pingpong_handle_t *handle)
+{
+	if (handle->delay_line.buffer == NULL)
+	{
+		const size_t size = PINGPONG_LINES * PINGPONG_LINE_FRAMES * sizeof(float32_t);
+		float32_t *buffer = arena_alloc(ARENA_AHB, size);
+		if (buffer == NULL)
+		{
+			buffer = arena_alloc(ARENA_AXI, size);
+		}
+		if ((buffer == NULL) || delay_line_init(&handle->delay_line, buffer, PINGPONG_LINES * PINGPONG_LINE_FRAMES))
+		{
+			arena_free(buffer);
+			return 253;
+		}
+	}
+	pingpong_reset(handle);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: pingpong_deinit
+*******************************************************************************
+* Summary:
+*  Give the line memory back to its arena (the ping-pong delay left the chain).
+*
+* Parameters:
+*  1. pingpong_handle_t *handle				- Address pointer of ping-pong handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void pingpong_deinit(pingpong_handle_t *handle)
+{
+	arena_free(handle->delay_line.buffer);
+	handle->delay_line.buffer = NULL;
+}
+
+/******************************************************************************
+* Function Name: pingpong_reset
+*******************************************************************************
+* Summary:
+*  Silence both lines without giving the memory back, e.g. after the block size changed.
+*
+* Parameters:
+*  1. pingpong_handle_t *handle				- Address pointer of ping-pong handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void pingpong_reset(pingpong_handle_t *handle)
+{
+	if (handle->delay_line.buffer != NULL)
+		delay_line_clear(&handle->delay_line);
+	smooth_param_reset(&handle->feedback_smooth, handle->feedback);
+	smooth_param_reset(&handle->cross_smooth, handle->cross);
+	smooth_param_reset(&handle->blend_smooth, handle->blend);
+	handle->tap_from = handle->delay_in_frames;
+	handle->tap_to = handle->delay_in_frames;
+	smooth_param_reset(&handle->tap_fade, 1.0f);
+}
+
+/******************************************************************************
+* Function Name: pingpong_update
+*******************************************************************************
+* Summary:
+*  Update ping-pong delay parameters. A new time is crossfaded in, the content of the lines
+*  stays.
+*
+* Parameters:
+*  1. pingpong_handle_t *handle				- Address pointer of ping-pong handle struct.
+*  2. pingpong_parameter pm					- Enum of ping-pong parameters.
+*  3. float32_t value						- The new value: PINGPONG_TIME in ms (0 to PINGPONG_MAX_TIME),
+*											  PINGPONG_FEEDBACK 0 to PINGPONG_MAX_FEEDBACK, the others 0 to 1.
+* Return:
+*  255:										- Parameter value is out of range.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t pingpong_update(pingpong_handle_t *handle, pingpong_parameter pm, float32_t value)
+{
+	switch (pm)
+	{
+	case PINGPONG_TIME:
+		if ((value < 0.0f) || (value > PINGPONG_MAX_TIME))
+			return 255;
+		handle->delay_ms = value;
+		handle->delay_in_frames = pingpong_frames(value);
+		break;
+	case PINGPONG_FEEDBACK:
+		if ((value < 0.0f) || (value > PINGPONG_MAX_FEEDBACK))
+			return 255;
+		handle->feedback = value;
+		break;
+	case PINGPONG_CROSS:
+		if ((value < 0.0f) || (value > 1.0f))
+			return 255;
+		handle->cross = value;
+		break;
+	case PINGPONG_BLEND:
+		if ((value < 0.0f) || (value > 1.0f))
+			return 255;
+		handle->blend = value;
+		break;
+	}
+
+	return 0;
+}
+
+// start the crossfade to a new time as delay_jump_start does. true while the crossfade runs
+#pragma optimize_for_speed
+ITCM_CODE static bool pingpong_jump_start(pingpong_handle_t *handle, uint32_t n)
+{
+	const uint32_t target = handle->delay_in_frames;
+	if ((target != handle->tap_to) && (smooth_param_value(&handle->tap_fade) >= 1.0f))
+	{
+		handle->tap_from = handle->tap_to;
+		handle->tap_to = target;
+		smooth_param_reset(&handle->tap_fade, 0.0f);
+	}
+	return smooth_param_next(&handle->tap_fade, 1.0f, n);
+}
+
+/******************************************************************************
+* Function Name: pingpong_process
+*******************************************************************************
+* Summary:
+*  One chunk of both lines. The frames (left, right) one time back are read from the
+*  interleaved line in one pass, the feedback matrix is applied to each frame and the input
+*  is added to the left line. The new frames are written back in one pass. The frames were
+*  read before the chunk is written, so the read delay is the time minus the chunk.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void pingpong_process(pingpong_handle_t *handle, uint32_t offset, uint32_t n)
+{
+	float32_t frames[PINGPONG_LINES * PINGPONG_CHUNK];
+	float32_t feed[PINGPONG_LINES * PINGPONG_CHUNK];
+	float32_t wet[PINGPONG_LINES][PINGPONG_CHUNK];
+	const float32_t *left = &handle->src[0][offset];
+	const float32_t *right = &handle->src[1][offset];
+
+	smooth_param_next(&handle->blend_smooth, handle->blend, n);
+	smooth_param_next(&handle->feedback_smooth, handle->feedback, n);
+	smooth_param_next(&handle->cross_smooth, handle->cross, n);
+
+	if (pingpong_jump_start(handle, n))
+	{
+		delay_line_read(&handle->delay_line, frames, PINGPONG_LINES * (handle->tap_from - n), PINGPONG_LINES * n);
+		delay_line_read(&handle->delay_line, feed, PINGPONG_LINES * (handle->tap_to - n), PINGPONG_LINES * n);
+		smooth_param_mix(&handle->tap_fade, frames, feed, frames, PINGPONG_LINES * n);
+	}
+	else
+	{
+		delay_line_read(&handle->delay_line, frames, PINGPONG_LINES * (handle->tap_to - n), PINGPONG_LINES * n);
+	}
+
+	// feedback matrix feedback * [[1 - cross, cross], [cross, 1 - cross]]: the line outputs of a frame go back into
+	// both lines. with AUDIO_CHANNELS 1 both inputs are the mono block, the left line gets it once
+	const float32_t feedback = smooth_param_value(&handle->feedback_smooth);
+	const float32_t cross = feedback * smooth_param_value(&handle->cross_smooth);
+	const float32_t straight = feedback - cross;
+	const float32_t input = (handle->dst[1] != NULL) ? 0.5f : 1.0f;
+	const float32_t side = (handle->dst[1] != NULL) ? 0.5f : 0.0f;
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		const float32_t l = frames[2 * i];
+		const float32_t r = frames[2 * i + 1];
+		feed[2 * i] = straight * l + cross * r + input * left[i] + side * right[i];
+		feed[2 * i + 1] = cross * l + straight * r;
+		wet[0][i] = l;
+		wet[1][i] = r;
+	}
+	delay_line_write(&handle->delay_line, feed, PINGPONG_LINES * n);
+
+	if (handle->dst[1] != NULL)
+	{
+		smooth_param_mix(&handle->blend_smooth, left, wet[0], &handle->dst[0][offset], n);
+		smooth_param_mix(&handle->blend_smooth, right, wet[1], &handle->dst[1][offset], n);
+	}
+	else
+	{
+		arm_add_f32(wet[0], wet[1], wet[0], n);
+		smooth_param_mix(&handle->blend_smooth, left, wet[0], &handle->dst[0][offset], n);
+	}
+}
+
+/******************************************************************************
+* Function Name: run_pingpong
+*******************************************************************************
+* Summary:
+*  Run the ping-pong delay on the blocks of both channels: two lines that feed into each other,
+*  so the repeats bounce between left and right. Instead of two delays whose outputs are
+*  summed, both lines share one interleaved delay line: per chunk one read, one pass of the 2x2
+*  feedback matrix over the frames and one write. The mono sum of the input enters the left
+*  line, the first repeat is heard on the left. With AUDIO_CHANNELS 1 the lines are summed.
+*
+* Parameters:
+*  1. pingpong_handle_t *handle				- Address pointer of ping-pong handle struct.
+*  2. uint32_t block_size					- Number of samples per channel.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_pingpong(pingpong_handle_t *handle, uint32_t block_size)
+{
+	for (uint32_t offset = 0; offset < block_size; offset += PINGPONG_CHUNK)
+	{
+		const uint32_t n = ((block_size - offset) < PINGPONG_CHUNK) ? (block_size - offset) : PINGPONG_CHUNK;
+		pingpong_process(handle, offset, n);
+	}
+}
+
+// ---- Cabinet ----
+
+// partitions of the longest cabinet response on the FFT path
+#define CAB_MAX_PARTITIONS ((CAB_MAX_TAPS + CONVOLVER_PARTITION_SIZE - 1) / CONVOLVER_PARTITION_SIZE)
+// built-in response, used when no recorded response is passed to cab_init: band pass of a closed 12" speaker
+#define CAB_DEFAULT_TAPS (512)
+#define CAB_DEFAULT_LOW_HZ 90.0f
+#define CAB_DEFAULT_HIGH_HZ 4500.0f
+
+// cycles of the two paths on the CM7 (code in ITCM, data in DTCM). estimates of the CMSIS 1.6.0 kernels,
+// compare with the load page of FXCAB when the kernels or the memory placement change
+// direct: arm_fir_f32 per tap and sample, call overhead per block
+#define CAB_DIRECT_CYCLES_PER_TAP (1.25f)
+#define CAB_DIRECT_CYCLES_PER_BLOCK (150.0f)
+// FFT: forward and inverse arm_rfft_fast_f32 of CONVOLVER_FFT_SIZE per chunk, spectral MAC per partition and chunk
+#define CAB_FFT_CYCLES_PER_CHUNK (6000.0f)
+#define CAB_FFT_CYCLES_PER_PARTITION (450.0f)
+
+// filter memory of the path in use: spectra and FDL (FFT path) or coefficients and state (direct path).
+// read every block, so it is taken from the DTCM arena. the FFT path needs more, the direct path fits into the same memory
+#define CAB_MEMORY_SIZE (2 * CAB_MAX_PARTITIONS * CONVOLVER_FFT_SIZE * sizeof(float32_t))
+#if ((2 * CAB_MAX_PARTITIONS * CONVOLVER_FFT_SIZE * 4) + (AUDIO_CHANNELS * LIMITER_LINE_SIZE * 4) > ARENA_TCM_SIZE)
+#error "ARENA_TCM_SIZE too small for the cabinet and the limiters"
+#endif
+static float32_t cab_default_ir[CAB_DEFAULT_TAPS];
+
+/******************************************************************************
+* Function Name: cab_generate_ir
+*******************************************************************************
+* Summary:
+*  Blackman windowed sinc band pass from CAB_DEFAULT_LOW_HZ to CAB_DEFAULT_HIGH_HZ: the difference
+*  of two low passes with unity DC gain, so the pass band has unity gain.
+*
+******************************************************************************/
+static void cab_generate_ir(float32_t *ir)
+{
+	for (uint32_t k = 0; k < CAB_DEFAULT_TAPS; ++k)
+	{
+		const float32_t t = (float32_t)k - 0.5f * (CAB_DEFAULT_TAPS - 1);
+		const float32_t phase = 2.0f * PI * k / (CAB_DEFAULT_TAPS - 1);
+		const float32_t window = 0.42f - 0.5f * arm_cos_f32(phase) + 0.08f * arm_cos_f32(2.0f * phase);
+		const float32_t high = 2.0f * PI * (CAB_DEFAULT_HIGH_HZ / Fs) * t;
+		const float32_t low = 2.0f * PI * (CAB_DEFAULT_LOW_HZ / Fs) * t;
+		// t is never 0 for an even number of taps
+		ir[k] = window * (arm_sin_f32(high) - arm_sin_f32(low)) / (PI * t);
+	}
+}
+
+/******************************************************************************
+* Function Name: cab_choose_path
+*******************************************************************************
+* Summary:
+*  Pick the cheaper of the direct form FIR and the FFT convolution for a response length and
+*  block size. The FFT path always works on CONVOLVER_PARTITION_SIZE chunks. The peak cost of a
+*  block counts, not the average: blocks shorter than a partition are collected, and the block
+*  that completes the chunk pays for the whole chunk.
+*
+* Parameters:
+*  1. uint32_t taps					- Length of the response in samples.
+*  2. uint32_t block_size			- Samples per block.
+* Return:
+*  CAB_DIRECT or CAB_FFT.
+*
+******************************************************************************/
+cab_path cab_choose_path(uint32_t taps, uint32_t block_size)
+{
+	const uint32_t partitions = (taps + CONVOLVER_PARTITION_SIZE - 1) / CONVOLVER_PARTITION_SIZE;
+	const float32_t direct = CAB_DIRECT_CYCLES_PER_TAP * taps * block_size + CAB_DIRECT_CYCLES_PER_BLOCK;
+	const uint32_t chunks = (block_size + CONVOLVER_PARTITION_SIZE - 1) / CONVOLVER_PARTITION_SIZE;
+	const float32_t fft = (CAB_FFT_CYCLES_PER_CHUNK + CAB_FFT_CYCLES_PER_PARTITION * partitions) * chunks;
+	return (fft < direct) ? CAB_FFT : CAB_DIRECT;
+}
+
+// direct path: the FIR filter with the time reversed response
+#pragma optimize_for_speed
+ITCM_CODE static void cab_convolve_direct(void *ctx, uint32_t block_size)
+{
+	cab_handle_t *handle = ctx;
+	arm_fir_f32(&handle->fir, handle->src, handle->dst, block_size);
+}
+
+// FFT path, blocks of whole partitions: convolved chunk by chunk without delay
+#pragma optimize_for_speed
+ITCM_CODE static void cab_convolve_partitions(void *ctx, uint32_t block_size)
+{
+	cab_handle_t *handle = ctx;
+	for (uint32_t offset = 0; offset < block_size; offset += CONVOLVER_PARTITION_SIZE)
+	{
+		convolver_process(&handle->convolver, &handle->src[offset], &handle->dst[offset]);
+	}
+}
+
+// FFT path, blocks shorter than a partition: collected into one chunk like the reverb, the cabinet signal
+// is one chunk late. the dry signal of the mix is taken from the previous chunk, so it's just as late
+#pragma optimize_for_speed
+ITCM_CODE static void cab_convolve_collected(void *ctx, uint32_t block_size)
+{
+	cab_handle_t *handle = ctx;
+	arm_copy_f32(&handle->fifo_in[handle->fifo_fill], handle->fifo_dry, block_size);
+	arm_copy_f32(&handle->fifo_out[handle->fifo_fill], handle->dst, block_size);
+	arm_copy_f32(handle->src, &handle->fifo_in[handle->fifo_fill], block_size);
+	handle->fifo_fill += block_size;
+	if (handle->fifo_fill >= CONVOLVER_PARTITION_SIZE)
+	{
+		convolver_process(&handle->convolver, handle->fifo_in, handle->fifo_out);
+		handle->fifo_fill = 0;
+	}
+}
+
+/******************************************************************************
+* Function Name: cab_set_block_size
+*******************************************************************************
+* Summary:
+*  Choose the path for a block size and load the response into it. The FFT path transforms the
+*  whole response, so this is called with the audio stopped (init, block size change), never
+*  from the audio callback. Binds the kernel run_cab calls and clears the filter history.
+*
+* Parameters:
+*  1. cab_handle_t *handle					- Address pointer of an initialized cabinet handle struct.
+*  2. uint32_t block_size					- Samples per block from now on.
+* Return:
+*  253:										- Convolver error.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t cab_set_block_size(cab_handle_t *handle, uint32_t block_size)
+{
+	handle->path = cab_choose_path(handle->ir_length, block_size);
+
+	if (handle->path == CAB_FFT)
+	{
+		if (convolver_init(&handle->convolver, handle->memory, &handle->memory[CAB_MAX_PARTITIONS * CONVOLVER_FFT_SIZE], CAB_MAX_PARTITIONS)
+			|| convolver_load_ir(&handle->convolver, handle->ir, handle->ir_length))
+		{
+			return 253;
+		}
+		handle->convolve = (block_size >= CONVOLVER_PARTITION_SIZE) ? cab_convolve_partitions : cab_convolve_collected;
+	}
+	else
+	{
+		// arm_fir_f32 expects the coefficients time reversed. the state follows the coefficients
+		float32_t *coeffs = handle->memory;
+		for (uint32_t k = 0; k < handle->ir_length; ++k)
+		{
+			coeffs[k] = handle->ir[handle->ir_length - 1 - k];
+		}
+		arm_fir_init_f32(&handle->fir, handle->ir_length, coeffs, &handle->memory[handle->ir_length], MAX_BLOCK_SIZE);
+		handle->convolve = cab_convolve_direct;
+	}
+
+	memset(handle->fifo_in, 0, sizeof(handle->fifo_in));
+	memset(handle->fifo_out, 0, sizeof(handle->fifo_out));
+	memset(handle->fifo_dry, 0, sizeof(handle->fifo_dry));
+	handle->fifo_fill = 0;
+	handle->dry = (handle->convolve == cab_convolve_collected) ? handle->fifo_dry : handle->src;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: cab_init
+*******************************************************************************
+* Summary:
+*  Initialize cabinet simulation handle struct for a speaker cabinet response (e.g. exported with
+*  dsp_helpers.export_cab_header, minimum phase). There is only one cabinet, in stereo it is a
+*  shared mono node like the reverb.
+*
+* Parameters:
+*  1. cab_handle_t *handle					- Address pointer of cabinet handle struct.
+*  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
+*  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
+*  4. const float32_t *ir					- Cabinet response sampled at Fs. Not copied, has to stay valid.
+*											  If NULL, a generated band pass is used.
+*  5. uint32_t ir_length					- Number of samples in ir. Range: 0 < ir_length <= CAB_MAX_TAPS.
+*  6. float32_t mix							- Ratio of dry and cabinet signal. Range: 0 <= mix <= 1.
+*  7. uint32_t block_size					- Samples per block the path is chosen for (see cab_set_block_size).
+* Return:
+*  255:										- Sample buffers point to NULL.
+*  254:										- Parameter values are out of range.
+*  253:										- DTCM arena exhausted or convolver error.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t cab_init(cab_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, const float32_t *ir, uint32_t ir_length, float32_t mix, uint32_t block_size)
+{
+	if ((in_buffer == NULL) || (out_buffer == NULL))
+	{
+		return 255;
+	}
+	if ((mix < 0) || (mix > 1) || ((ir != NULL) && ((ir_length == 0) || (ir_length > CAB_MAX_TAPS))))
+	{
+		return 254;
+	}
+	if (handle->memory == NULL)
+	{
+		handle->memory = arena_alloc(ARENA_TCM, CAB_MEMORY_SIZE);
+		if (handle->memory == NULL)
+		{
+			return 253;
+		}
+	}
+
+	if (ir == NULL)
+	{
+		cab_generate_ir(cab_default_ir);
+		ir = cab_default_ir;
+		ir_length = CAB_DEFAULT_TAPS;
+	}
+	handle->ir = ir;
+	handle->ir_length = ir_length;
+	handle->src = in_buffer;
+	handle->dst = out_buffer;
+	handle->mix = mix;
+	smooth_param_init(&handle->mix_smooth, mix, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+
+	return cab_set_block_size(handle, block_size);
+}
+
+/******************************************************************************
+* Function Name: cab_update
+*******************************************************************************
+* Summary:
+*  Update cabinet parameters.
+*
+* Parameters:
+*  1. cab_handle_t *handle					- Address pointer of cabinet handle struct.
+*  2. cab_parameter pm						- Enum of cabinet parameters.
+*  3. float32_t value						- The new value of the parameter. Range: 0 <= value <= 1.
+* 
+* Return:
+*  255:										- Parameter value is out of range.
 *    0:										- Success.
 *
 ******************************************************************************/
-uint8_t tremolo_update(tremolo_handle_t *handle, modulation_parameter pm, float32_t value)
+uint8_t cab_update(cab_handle_t *handle, cab_parameter pm, float32_t value)
 {
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
 	switch (pm)
 	{
-	case RATE:
-		if ((value < 0) || (value > 1.0f))
-			return 255;
-		handle->rate = value;
+	case CAB_MIX:
+		handle->mix = value;
 		break;
-	case DEPTH:
-		if ((value < 0) || (value > 1.0f))
-			return 254;
-		handle->depth = value;
-		break;		
 	}
-	
+
 	return 0;
 }
-	
 
 /******************************************************************************
-* Function Name: run_tremolo
+* Function Name: run_cab
 *******************************************************************************
 * Summary:
-*  Run tremolo algorithm on sample block.
+*  Run the cabinet simulation on a sample block, with the kernel cab_set_block_size bound for
+*  the path and the block size.
 *
 * Parameters:
-*  1. tremolo_handle_t *handle				- Address pointer of tremolo handle struct.
+*  1. cab_handle_t *handle					- Address pointer of cabinet handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers. The size passed
+*											  to cab_set_block_size last.
 * 
 * Return:
 *  None.
 *
 ******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_cab(cab_handle_t *handle, uint32_t block_size)
+{
+	smooth_param_next(&handle->mix_smooth, handle->mix, block_size);
 
-// https://wiki.analog.com/resources/tools-software/sharc-audio-module/baremetal/tremelo-effect-tutorial
-void run_tremolo(tremolo_handle_t *handle)
+	handle->convolve(handle, block_size);
+	// the chain never passes the same buffer as src and dst, so the dry signal is still there. while blocks are
+	// collected it's the delayed copy of the kernel, aligned with the cabinet signal
+	smooth_param_mix(&handle->mix_smooth, handle->dry, handle->dst, handle->dst, block_size);
+}
+
+// samples the output (cabinet and dry signal) lags at a block size: one partition while shorter blocks are collected
+// for the FFT path
+uint32_t cab_latency(const cab_handle_t *handle, uint32_t block_size)
+{
+	return ((handle->path == CAB_FFT) && (block_size < CONVOLVER_PARTITION_SIZE)) ? CONVOLVER_PARTITION_SIZE : 0;
+}
+
+// ---- Reverb ----
+
+#if defined(REVERB_FDN)
+// decay time (-60 dB) and damping of the feedback delay network
+#define REVERB_FDN_RT60 (1.2f)
+#define REVERB_FDN_DAMPING (0.3f)
+// the delay lines are taken from the RAM_D1 arena, the work chunk (read and written every block) from the DTCM arena
+#if ((FDN_LINES * FDN_LINE_SIZE * 4) > ARENA_D1_SIZE)
+#error "ARENA_D1_SIZE too small for the FDN delay lines"
+#endif
+#if ((2 * CAB_MAX_PARTITIONS * CONVOLVER_FFT_SIZE * 4) + (AUDIO_CHANNELS * LIMITER_LINE_SIZE * 4) + (FDN_LINES * FDN_CHUNK_SIZE * 4) > ARENA_TCM_SIZE)
+#error "ARENA_TCM_SIZE too small for the cabinet, the limiters and the FDN work chunk"
+#endif
+#endif
+// maximum impulse response length. the spectra need about 4 floats per impulse response sample (IR spectra + FDL),
+// so 0.5 s at 48 kHz already take ~450 KB. RAM_D1 is the only region that is big enough
+#ifndef REVERB_MAX_IR_LENGTH
+#define REVERB_MAX_IR_LENGTH (24000)
+#endif
+// decay time (-60 dB) of the built-in impulse response, used when no recorded impulse response is passed to reverb_init
+#define REVERB_DEFAULT_RT60 (0.4f)
+
+// the spectra are taken from the RAM_D1 arena by reverb_activate. ARENA_D1_SIZE is sized for them
+#if !defined(REVERB_FDN)
+#define REVERB_MEMORY_SIZE (NU_CONVOLVER_MEMORY(REVERB_MAX_IR_LENGTH) * sizeof(float32_t))
+#if ((NU_CONVOLVER_MEMORY(REVERB_MAX_IR_LENGTH) * 4) > ARENA_D1_SIZE)
+#error "ARENA_D1_SIZE too small for REVERB_MAX_IR_LENGTH"
+#endif
+
+// state of the generated impulse response
+struct reverb_noise
+{
+	uint32_t seed;
+	float32_t envelope;
+	float32_t decay;
+};
+
+/******************************************************************************
+* Function Name: reverb_noise_source
+*******************************************************************************
+* Summary:
+*  convolver_ir_source generating an exponentially decaying white noise impulse response.
+*  The segments are requested in order, so the noise generator and the envelope simply continue.
+*
+******************************************************************************/
+static void reverb_noise_source(float32_t *dst, uint32_t offset, uint32_t length, void *context)
 {
-	for (int i = 0; i < PING_PONG_BUFFER_SIZE; ++i)
+	struct reverb_noise *noise = context;
+	(void)offset;
+	for (uint32_t i = 0; i < length; ++i)
 	{
-		// get moculation factor for this sample
-		float32_t factor = 1 - (handle->depth * 0.5f * arm_sin_f32(handle->time) + 0.5f);
-		handle->time += handle->rate * 0.002;
-		if (handle->time > 2 * PI)
-			handle->time -= 2 * PI;
-		handle->dst[i] = factor * handle->src[i];	
+		// linear congruential generator (numerical recipes)
+		noise->seed = noise->seed * 1664525u + 1013904223u;
+		dst[i] = noise->envelope * ((float32_t)(noise->seed >> 8) / 8388608.0f - 1.0f);
+		noise->envelope *= noise->decay;
 	}
 }
-// ---- Ring Modulator ----
 
 /******************************************************************************
-* Function Name: ring_mod_init
+* Function Name: reverb_generate_ir
 *******************************************************************************
 * Summary:
-*  Initialize ring modulator struct.
+*  Load an exponentially decaying white noise impulse response into the convolver. The noise is
+*  normalized to unit energy, so the wet signal has roughly the same loudness as the dry signal.
 *
 * Parameters:
-*  1. ring_mod_handle_t *handle				- Address pointer of ring modulator handle struct.
+*  1. nu_convolver_t *conv					- Address pointer of the convolver struct.
+*  2. float32_t rt60						- Time in seconds until the impulse response has decayed by 60 dB.
+* Return:
+*  See nu_convolver_load.
+*
+******************************************************************************/
+static uint8_t reverb_generate_ir(nu_convolver_t *conv, float32_t rt60)
+{
+	// envelope time constant: e^(-rt60 / tau) = 10^(-3)
+	const float32_t tau = rt60 / 6.9078f;
+	// uniform noise in [-1, 1] has a variance of 1/3. sum of the squared envelope is tau * Fs / 2
+	struct reverb_noise noise = { 22222, sqrtf(6.0f / (tau * Fs)), expf(-1.0f / (tau * Fs)) };
+
+	return nu_convolver_load(conv, reverb_noise_source, &noise, REVERB_MAX_IR_LENGTH);
+}
+
+// tail schedule of the convolver for a response of length samples: tuned when the reverb takes its memory for a
+// response of another length, then it comes with the spectra. a reload while the reverb holds its memory keeps the
+// schedule, the tail may run on the M4 meanwhile
+static void reverb_schedule(reverb_handle_t *handle, uint32_t length)
+{
+	if ((handle->memory == NULL) && (handle->schedule_length != length))
+	{
+#if defined(DUAL_CORE)
+		handle->schedule = nu_convolver_autotune(&handle->convolver, length, true);
+#else
+		handle->schedule = nu_convolver_autotune(&handle->convolver, length, false);
+#endif
+		handle->schedule_length = length;
+	}
+	else
+	{
+		nu_convolver_set_schedule(&handle->convolver, handle->schedule);
+	}
+}
+
+/******************************************************************************
+* Function Name: reverb_load
+*******************************************************************************
+* Summary:
+*  Load the impulse response of the handle into its convolver at the running sample rate: the
+*  image transformed ahead of time if it has this rate (no FFT), the generated one, the
+*  recorded one as it is, or converted by ir_resampler_source while it is transformed if it was
+*  recorded at another rate. A converted response longer than
+*  REVERB_MAX_IR_LENGTH is truncated. The rate is kept in loaded_rate, so the spectra are only
+*  calculated again when the rate changes. The responses transformed here get the tail schedule
+*  of reverb_schedule, an image brings its own.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of a reverb handle struct with initialized convolver.
+* Return:
+*  See nu_convolver_load.
+*
+******************************************************************************/
+static uint8_t reverb_load(reverb_handle_t *handle)
+{
+	uint8_t status;
+	if ((handle->image != NULL) && (handle->image->rate == sample_rate))
+	{
+		status = nu_convolver_load_image(&handle->convolver, handle->image);
+	}
+	else if (handle->ir == NULL)
+	{
+		reverb_schedule(handle, REVERB_MAX_IR_LENGTH);
+		status = reverb_generate_ir(&handle->convolver, REVERB_DEFAULT_RT60);
+	}
+	else if (handle->ir_rate == sample_rate)
+	{
+		reverb_schedule(handle, handle->ir_length);
+		status = nu_convolver_load_ir(&handle->convolver, handle->ir, handle->ir_length);
+	}
+	else
+	{
+		ir_resampler_t resampler;
+		status = ir_resampler_init(&resampler, handle->ir, handle->ir_length, handle->ir_rate, sample_rate);
+		if (status == 0)
+		{
+			const uint32_t length = (resampler.length < REVERB_MAX_IR_LENGTH) ? resampler.length : REVERB_MAX_IR_LENGTH;
+			reverb_schedule(handle, length);
+			status = nu_convolver_load(&handle->convolver, ir_resampler_source, &resampler, length);
+		}
+	}
+	handle->loaded_rate = (status == 0) ? sample_rate : 0;
+	return status;
+}
+#endif
+
+/******************************************************************************
+* Function Name: reverb_init
+*******************************************************************************
+* Summary:
+*  Initialize reverb handle struct. The convolution engine and its impulse response are only set
+*  up by reverb_activate, the impulse response has to stay valid until then. With REVERB_FDN the
+*  impulse response is ignored.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of reverb handle struct.
 *  2. float32_t *in_buffer					- Address pointer of sample block in-buffer.
 *  3. float32_t *out_buffer					- Address pointer of sample block out-buffer.
-*  4. float32_t rate						- Rate of change of the modulator; frequency. Range: 0 < rate <= 1.
-*  5. float32_t blend						- Ratio of mix between dry signal and wet signal. Range: 0 < blend < 1.
-*  6. modulator_type type					- The modulating signal wave form. Sine, Triangle or Square wave.
-* 
+*  4. const float32_t *ir					- Impulse response (e.g. exported with dsp_helpers.export_ir_header).
+*											  If NULL, a generated impulse response is used.
+*  5. uint32_t ir_length					- Number of samples in ir. Range: 0 < ir_length <= REVERB_MAX_IR_LENGTH.
+*  6. uint32_t ir_rate						- Sample rate of ir in Hz. If it isn't the running rate, ir is converted
+*											  when it is loaded (reverb_activate).
+*  7. float32_t blend						- Ratio of dry and wet mix. Range: 0 <= blend <= 1.
 * Return:
 *  255:										- Sample buffers point to NULL.
-*  254:										- Rate or depth values are out of range.
-*    0:										- Success. 
+*  254:										- Parameter values are out of range.
+*    0:										- Success.
 *
 ******************************************************************************/
-uint8_t ring_mod_init(ring_mod_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t blend, modulator_type type)
+uint8_t reverb_init(reverb_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, const float32_t *ir, uint32_t ir_length, uint32_t ir_rate, float32_t blend)
 {
 	if ((in_buffer == NULL) || (out_buffer == NULL)) 
 	{
 		return 255;
 	}
-	if ((rate >= 0) || (rate <= 1) || (blend < 0) || (blend > 0.99))
+	if ((blend < 0) || (blend > 1) || ((ir != NULL) && ((ir_length == 0) || (ir_length > REVERB_MAX_IR_LENGTH) || (ir_rate == 0))))
 	{
 		return 254;
 	}
-	
+
 	handle->src = in_buffer;
 	handle->dst = out_buffer;
-	handle->rate = rate;
+	handle->ir = ir;
+	handle->ir_length = ir_length;
+	handle->ir_rate = ir_rate;
 	handle->blend = blend;
-	handle->type = type;
-	handle->time = 0;
-	
+	smooth_param_init(&handle->blend_smooth, blend, SMOOTH_EXPONENTIAL, SMOOTH_PARAM_DEFAULT_MS);
+	handle->overruns = 0;
+	handle->short_tail = false;
+#if defined(REVERB_FDN)
+	handle->shimmer = 0.0f;
+	handle->shimmer_allowed = false;
+#else
+	handle->loaded_rate = 0;
+	handle->schedule = 0;
+	handle->schedule_length = 0;
+	memset(handle->fifo_in, 0, sizeof(handle->fifo_in));
+	memset(handle->fifo_out, 0, sizeof(handle->fifo_out));
+	handle->fifo_fill = 0;
+#endif
+
 	return 0;
 }
 
 /******************************************************************************
-* Function Name: ring_mod_update
+* Function Name: reverb_activate
 *******************************************************************************
 * Summary:
-*  Update ring modulation parameters.
+*  Take the spectra memory from the RAM_D1 arena and load the impulse response into the
+*  non-uniform convolution engine, when the reverb enters the chain. The impulse response is
+*  transformed once, which takes a while for long responses. If the handle still holds its
+*  memory, the loaded response is kept and only the history is cleared. With REVERB_FDN, the
+*  delay lines are taken from the RAM_D1 arena and the work chunk from the DTCM arena instead.
+*  Call from the main loop while the reverb isn't processed.
 *
 * Parameters:
-*  1. ring_mod_handle_t *handle				- Address pointer of ring modulator handle struct.
-*  2. modulation_parameter pm				- Enum of modulation parameters.
-*  3. modulator_type type					- Enum of modulating signal wave form.
-*  4. float32_t value						- The new value of the parameter.
+*  1. reverb_handle_t *handle				- Address pointer of an initialized reverb handle struct.
+* Return:
+*  253:										- Arena exhausted or convolver error (FFT initialization).
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t reverb_activate(reverb_handle_t *handle)
+{
+	if (handle->memory != NULL)
+	{
+#if !defined(REVERB_FDN) && !defined(DUAL_CORE)
+		// the spectra are kept, unless reverb_init passed an impulse response since or the rate changed
+		if (handle->loaded_rate != sample_rate)
+		{
+			return reverb_load(handle) ? 253 : 0;
+		}
+#endif
+		reverb_reset(handle);
+		return 0;
+	}
+
+#if defined(REVERB_FDN)
+	float32_t *memory = arena_alloc(ARENA_AXI, FDN_MEMORY_SIZE);
+	float32_t *work = arena_alloc(ARENA_TCM, FDN_WORK_SIZE);
+	if (fdn_init(&handle->fdn, memory, work) || fdn_set_decay(&handle->fdn, REVERB_FDN_RT60, REVERB_FDN_DAMPING))
+	{
+		arena_free(work);
+		arena_free(memory);
+		return 253;
+	}
+	handle->memory = memory;
+	handle->work = work;
+	smooth_param_reset(&handle->blend_smooth, handle->blend);
+#else
+	float32_t *memory = arena_alloc(ARENA_AXI, REVERB_MEMORY_SIZE);
+	if ((memory == NULL) || nu_convolver_init(&handle->convolver, memory, REVERB_MAX_IR_LENGTH))
+	{
+		arena_free(memory);
+		return 253;
+	}
+	if (reverb_load(handle))
+	{
+		arena_free(memory);
+		return 253;
+	}
+	handle->memory = memory;
+	memset(handle->fifo_in, 0, sizeof(handle->fifo_in));
+	memset(handle->fifo_out, 0, sizeof(handle->fifo_out));
+	handle->fifo_fill = 0;
+	smooth_param_reset(&handle->blend_smooth, handle->blend);
+	if (handle->short_tail)
+	{
+		nu_convolver_set_tail_stages(&handle->convolver, 1);
+	}
+
+#if defined(DUAL_CORE)
+	// from now on, the tail is processed by the M4
+	dual_core_attach(&handle->convolver);
+#endif
+#endif
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: reverb_deinit
+*******************************************************************************
+* Summary:
+*  Give the spectra memory back to the RAM_D1 arena (the reverb left the chain). With DUAL_CORE
+*  the M4 keeps the attached convolver, the memory stays taken. REVERB_FDN: the delay lines and
+*  the work chunk.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of reverb handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void reverb_deinit(reverb_handle_t *handle)
+{
+#if defined(REVERB_FDN)
+	arena_free(handle->work);
+	handle->work = NULL;
+	arena_free(handle->memory);
+	handle->memory = NULL;
+#elif defined(DUAL_CORE)
+	(void)handle;
+#else
+	arena_free(handle->memory);
+	handle->memory = NULL;
+#endif
+}
+
+/******************************************************************************
+* Function Name: reverb_update
+*******************************************************************************
+* Summary:
+*  Update reverb parameters. REVERB_SHIMMER is the level of the octave in the feedback of the
+*  network, it is heard once reverb_allow_shimmer allowed it.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of reverb handle struct.
+*  2. reverb_parameter pm					- Enum of reverb parameters.
+*  3. float32_t value						- The new value of the parameter. Range: 0 <= value <= 1.
 * 
 * Return:
-*  255:										- Parameter value are out of range.
+*  255:										- Parameter value is out of range.
+*  254:										- REVERB_SHIMMER without REVERB_FDN (the convolution has no feedback).
 *    0:										- Success.
 *
 ******************************************************************************/
-uint8_t ring_mod_update(ring_mod_handle_t *handle, modulation_parameter pm, modulator_type type, float32_t value)
+uint8_t reverb_update(reverb_handle_t *handle, reverb_parameter pm, float32_t value)
 {
+	if ((value < 0) || (value > 1.0f))
+		return 255;
+
 	switch (pm)
 	{
-	case RATE:
-		if ((value < 0) || (value > 1.0f))
-			return 255;
-		handle->rate = value;
-		break;
-	case DEPTH:
-		if ((value < 0) || (value > 1.0f))
-			return 254;
+	case REVERB_BLEND:
 		handle->blend = value;
-		break;		
-	default:
 		break;
+	case REVERB_SHIMMER:
+#if defined(REVERB_FDN)
+		handle->shimmer = value;
+		break;
+#else
+		return 254;
+#endif
 	}
 	
-	if (type != NO_CHANGE)
-		handle->type = type;
-	
 	return 0;
 }
 
+/******************************************************************************
+* Function Name: reverb_shorten
+*******************************************************************************
+* Summary:
+*  Convolve only the first NU_CONVOLVER_TAIL1_OFFSET samples of the impulse response (about
+*  85 ms with 64 sample blocks), which skips the longest and most expensive tail stage. For
+*  the load governor, the reverb then ends early instead of the audio dropping out. Taken over
+*  by reverb_activate if the reverb isn't in the chain. Call from the main loop.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of an initialized reverb handle struct.
+*  2. bool shorten							- true: short tail, false: whole impulse response.
+* 
+* Return:
+*  254:										- Not supported: the M4 processes the tail (DUAL_CORE),
+*											  the cost of REVERB_FDN doesn't depend on the decay.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t reverb_shorten(reverb_handle_t *handle, bool shorten)
+{
+#if defined(REVERB_FDN) || defined(DUAL_CORE)
+	(void)handle;
+	(void)shorten;
+	return 254;
+#else
+	handle->short_tail = shorten;
+	if (handle->memory != NULL)
+	{
+		nu_convolver_set_tail_stages(&handle->convolver, shorten ? 1 : NU_CONVOLVER_TAIL_STAGES);
+	}
+	return 0;
+#endif
+}
+
+// let the shimmer level reach the network or keep it out (REVERB_FDN only). the caller decides whether the shifter fits
+// into the block budget, the level fades over one chunk. any context
+void reverb_allow_shimmer(reverb_handle_t *handle, bool allow)
+{
+#if defined(REVERB_FDN)
+	handle->shimmer_allowed = allow;
+#else
+	(void)handle;
+	(void)allow;
+#endif
+}
 
 /******************************************************************************
-* Function Name: run_ring_mod
+* Function Name: reverb_rebuild
 *******************************************************************************
 * Summary:
-*  Run ring modulation algorithm on sample block.
+*  Recalculate what depends on the sample rate after it changed (audio_set_sample_rate): the
+*  FDN delay lengths and decay, or the spectra of the impulse response (generated again or
+*  converted from the rate it was recorded at, see reverb_load). Without memory (reverb not
+*  activated yet), reverb_activate calculates everything anyway. Call from the main loop while
+*  the reverb isn't processed.
 *
 * Parameters:
-*  1. ring_mod_handle_t *handle				- Address pointer of tremolo handle struct.
+*  1. reverb_handle_t *handle				- Address pointer of an initialized reverb handle struct.
+* 
+* Return:
+*  253:										- Convolver or FDN error.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t reverb_rebuild(reverb_handle_t *handle)
+{
+	if (handle->memory == NULL)
+	{
+		return 0;
+	}
+#if defined(REVERB_FDN)
+	if (fdn_init(&handle->fdn, handle->memory, handle->work) || fdn_set_decay(&handle->fdn, REVERB_FDN_RT60, REVERB_FDN_DAMPING))
+	{
+		return 253;
+	}
+#elif !defined(DUAL_CORE)
+	if ((handle->loaded_rate != sample_rate) && reverb_load(handle))
+	{
+		return 253;
+	}
+#endif
+	reverb_reset(handle);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: reverb_set_image
+*******************************************************************************
+* Summary:
+*  Use an impulse response transformed ahead of time (dsp_helpers.export_ir_spectra) instead of
+*  the one passed to reverb_init, whenever it has the running sample rate. Loading it is a copy
+*  from flash, so switching between responses is instant. If the reverb holds its memory, the
+*  image is loaded right away, otherwise by reverb_activate. reverb_init keeps the image.
+*  Call from the main loop while the reverb isn't processed.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of an initialized reverb handle struct.
+*  2. const nu_convolver_image_t *image		- Transformed impulse response, NULL to go back to the one of reverb_init.
+* 
+* Return:
+*  254:										- Image computed for another partition size, or not supported: REVERB_FDN
+*											  has no impulse response, with DUAL_CORE the M4 processes the attached
+*											  convolver.
+*  253:										- Convolver error.
+*    0:										- Success.
+*
+******************************************************************************/
+uint8_t reverb_set_image(reverb_handle_t *handle, const nu_convolver_image_t *image)
+{
+#if defined(REVERB_FDN)
+	(void)handle;
+	(void)image;
+	return 254;
+#else
+	if ((image != NULL) && (image->partition_size != CONVOLVER_PARTITION_SIZE))
+	{
+		return 254;
+	}
+#if defined(DUAL_CORE)
+	if (handle->memory != NULL)
+	{
+		return 254;
+	}
+#endif
+	handle->image = image;
+	handle->loaded_rate = 0;
+	if (handle->memory == NULL)
+	{
+		return 0;
+	}
+	if (reverb_load(handle))
+	{
+		return 253;
+	}
+	reverb_reset(handle);
+	return 0;
+#endif
+}
+
+#if !defined(REVERB_FDN)
+// convolve one CONVOLVER_PARTITION_SIZE chunk (wet signal only)
+#pragma optimize_for_speed
+ITCM_CODE static void reverb_convolve(reverb_handle_t *handle, const float32_t *src, float32_t *dst)
+{
+#if defined(DUAL_CORE)
+	// the M4 didn't answer the boot handshake: the whole convolution stays here
+	if (!dual_core_ready())
+	{
+		nu_convolver_process(&handle->convolver, src, dst);
+		return;
+	}
+	float32_t tail[CONVOLVER_PARTITION_SIZE];
+	nu_convolver_process_head(&handle->convolver, src, dst);
+	handle->overruns += dual_core_exchange(src, tail);
+	arm_add_f32(dst, tail, dst, CONVOLVER_PARTITION_SIZE);
+#else
+	nu_convolver_process(&handle->convolver, src, dst);
+#endif
+}
+#endif
+
+/******************************************************************************
+* Function Name: run_reverb
+*******************************************************************************
+* Summary:
+*  Run convolution reverb on sample block. The first block of the impulse response is applied as
+*  direct form FIR, so the reverb adds no latency. The long FFT partitions of the tail are spread
+*  over several blocks, which keeps the cost per block flat. With DUAL_CORE, the tail is computed
+*  by the M4 one block behind and collected here.
+*  The convolver works on CONVOLVER_PARTITION_SIZE chunks: longer blocks are split, shorter blocks
+*  are collected until one chunk is complete. In that case the wet signal is one chunk late,
+*  the dry signal is never delayed.
+*  REVERB_FDN: the feedback delay network runs on blocks of any size, nothing is collected. The
+*  shimmer level is passed on while it is allowed.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of reverb handle struct.
+*  2. uint32_t block_size					- Number of samples in the in/out buffers. Has to be a
+*											  divisor or a multiple of CONVOLVER_PARTITION_SIZE.
 * 
 * Return:
 *  None.
 *
 ******************************************************************************/
 #pragma optimize_for_speed
-void run_ring_mod(ring_mod_handle_t *handle)
+ITCM_CODE void run_reverb(reverb_handle_t *handle, uint32_t block_size)
 {
-	for (int i = 0; i < PING_PONG_BUFFER_SIZE; ++i)
+	smooth_param_next(&handle->blend_smooth, handle->blend, block_size);
+
+#if defined(REVERB_FDN)
+	handle->fdn.shimmer = handle->shimmer_allowed ? handle->shimmer : 0.0f;
+	fdn_process(&handle->fdn, handle->src, handle->dst, block_size);
+#else
+	if (block_size >= CONVOLVER_PARTITION_SIZE)
 	{
-		float32_t factor;
-		switch (handle->type)
+		for (uint32_t offset = 0; offset < block_size; offset += CONVOLVER_PARTITION_SIZE)
 		{
-			case SINE:
-				factor = arm_sin_f32(handle->time);
-				break;
-			case TRIANGLE:
-				factor = triangle_wave(handle->time);
-				break;
-			case SQUARE:
-				factor = square_wave(handle->time);
-				break;
-			default:
-				return;
+			reverb_convolve(handle, &handle->src[offset], &handle->dst[offset]);
+		}
+	}
+	else
+	{
+		// output the wet samples of the previous chunk while collecting the next one
+		arm_copy_f32(&handle->fifo_out[handle->fifo_fill], handle->dst, block_size);
+		arm_copy_f32(handle->src, &handle->fifo_in[handle->fifo_fill], block_size);
+		handle->fifo_fill += block_size;
+		if (handle->fifo_fill >= CONVOLVER_PARTITION_SIZE)
+		{
+			reverb_convolve(handle, handle->fifo_in, handle->fifo_out);
+			handle->fifo_fill = 0;
 		}
-		
-		handle->time += handle->rate * 0.02;
-		if (handle->time > 2 * PI)
-			handle->time -= 2 * PI;
-		
-		handle->dst[i] = (1 - handle->blend) * handle->src[i] + handle->blend * factor * handle->src[i];
 	}
-}
\ No newline at end of file
+#endif
+	// the chain never passes the same buffer as src and dst, so the dry signal is still there
+	smooth_param_mix(&handle->blend_smooth, handle->src, handle->dst, handle->dst, block_size);
+}
+
+/******************************************************************************
+* Function Name: reverb_reset
+*******************************************************************************
+* Summary:
+*  Silence the reverb (convolver history and chunk buffers), e.g. after the block size changed.
+*  Not available with DUAL_CORE, the M4 owns the tail state.
+*
+* Parameters:
+*  1. reverb_handle_t *handle				- Address pointer of reverb handle struct.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+void reverb_reset(reverb_handle_t *handle)
+{
+#if defined(REVERB_FDN)
+	if (handle->memory != NULL)
+		fdn_reset(&handle->fdn);
+#else
+#if !defined(DUAL_CORE)
+	if (handle->memory != NULL)
+		nu_convolver_reset(&handle->convolver);
+#endif
+	memset(handle->fifo_in, 0, sizeof(handle->fifo_in));
+	memset(handle->fifo_out, 0, sizeof(handle->fifo_out));
+	handle->fifo_fill = 0;
+#endif
+	smooth_param_reset(&handle->blend_smooth, handle->blend);
+}
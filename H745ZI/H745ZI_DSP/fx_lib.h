@@ -8,11 +8,44 @@
 extern "C" {
 #endif
 
+#if defined(HOST_BUILD)
+// the desktop build has no board around the effects, only the DSP modules below (see fx_host.h)
+#include "platform.h"
+#else
 #include "main.h"
+#endif
 #include "defines_and_constants.h"
 #include "ring_buffer.h"
+#include "delay_line.h"
+#include "smooth_param.h"
+#include "waveshaper.h"
+#include "oversampler.h"
+#include "oscillator.h"
+#include "convolver.h"
+#include "fdn.h"
+#include "param_block.h"
+#include "control_rate.h"
+#include "fast_math.h"
+#include "amp_model.h"
+#include "fir_filter.h"
+#include "envelope.h"
+#include "dc_blocker.h"
+#include "stft.h"
+#include "multirate.h"
+#if defined(DUAL_CORE)
+#include "dual_core.h"
+#endif
 	
+// maximum delay time in milliseconds, limited by the delay line (DELAY_LINE_SIZE in fx_lib.c)
+#if defined(PACKED_DELAY)
+#define MAX_DELAY_TIME 1300
+#else
 #define MAX_DELAY_TIME 500
+#endif
+// the wet path of the delay runs at the sample rate divided by DELAY_DECIMATION (defines_and_constants.h), 1: off
+#ifndef DELAY_DECIMATION
+#define DELAY_DECIMATION 1
+#endif
 	
 	
 	enum fx_designator
@@ -23,7 +56,22 @@ extern "C" {
 		FXFUZZ,
 		FXTREMOLO,
 		FXRINGMOD,
-		FXFILTER
+		FXFILTER,
+		FXCHORUS,
+		FXFLANGER,
+		FXREVERB,
+		FXEQ,
+		FXCAB,
+		FXGATE,
+		FXCOMP,
+		FXPITCH,
+		FXWAH,
+		FXPHASER,
+		FXAMP,
+		FXLOOP,
+		FXDENOISE,
+		FXFREEZE,
+		FXPINGPONG
 	};
 	
 // DELAY
@@ -31,9 +79,43 @@ extern "C" {
 	{
 		DELAY = 0,
 		FEEDBACK,
-		BLEND
+		BLEND,
+		// how far the wet signal is attenuated while the guitar plays (see delay_set_duck_source)
+		DUCK
 	} delay_parameter;
 
+	// how a new delay time is reached. GLIDE: the tap moves there within DELAY_GLIDE_MS, the echo bends in pitch while it
+	// moves (tape delay). JUMP: the tap jumps and the old tap is crossfaded into the new one within DELAY_CROSSFADE_MS,
+	// no pitch change (digital delay)
+	typedef enum
+	{
+		DELAY_TIME_GLIDE = 0,
+		DELAY_TIME_JUMP
+	} delay_time_mode;
+
+	// additional taps read from the delay line next to the main tap (multi-tap delay)
+#define DELAY_MAX_TAPS 8
+
+	/*  -----------------------------------------------------------------------------------------------------------------------------
+	*   Additional read tap of a delay (see delay_set_tap). The tap is summed into the wet signal of the main tap, it doesn't
+	*   feed back.
+	*
+	*   Members:
+	*   delay_in_samples:   Distance of the tap behind the write position.
+	*   level:              Gain of the tap with the pan law of the channel of the handle applied.
+	*   damping:            Coefficient of the one-pole low pass (0 = no damping, towards 1 = darker).
+	*   state:              Last output of the low pass (float32 and q31 chain).
+	*   -----------------------------------------------------------------------------------------------------------------------------
+	*/
+	typedef struct
+	{
+		volatile uint32_t delay_in_samples;
+		volatile float32_t level;
+		volatile float32_t damping;
+		float32_t state;
+		q31_t state_q31;
+	} delay_tap_t;
+
 	typedef struct
 	{
 		volatile float32_t delay_ms;
@@ -43,16 +125,95 @@ extern "C" {
 		float32_t level;
 		float32_t *src;
 		float32_t *dst;
-		rb_handle_t *delay_rb;
+		// parameters as heard. they follow the volatile fields written by *_update within a few blocks (see smooth_param.h)
+		smooth_param_t blend_smooth;
+		smooth_param_t feedback_smooth;
+		// delay time set by delay_update, and the time as heard: it glides towards the new time (see run_delay)
+		volatile uint32_t delay_in_samples;
+		smooth_param_t time_smooth;
+		// DELAY_TIME_JUMP: the tap faded out, the tap faded in and the fade between them (0 -> 1, 1 = idle)
+		delay_time_mode time_mode;
+		uint32_t tap_from;
+		uint32_t tap_to;
+		smooth_param_t tap_fade;
+		// additional taps, the first tap_count are read
+		delay_tap_t taps[DELAY_MAX_TAPS];
+		volatile uint8_t tap_count;
+		// ducking: amount (0 = off), level of the input detector it follows (NULL = none) and the gain of the wet
+		// signal as heard
+		volatile float32_t duck;
+		const volatile float32_t *duck_level;
+		smooth_param_t duck_smooth;
+		delay_line_t delay_line;
+		// wet path at the sample rate divided by decimation (delay_set_decimation), 0 or 1: full rate. the line and
+		// the taps count samples of the lower rate. not touched by delay_init, like duck_level
+		uint8_t decimation;
+		multirate_t multirate;
 	
 	} delay_handle_t;
 
 	uint8_t delay_init(delay_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t delay_ms, float32_t blend, float32_t feedback);
+	uint8_t delay_activate(delay_handle_t *handle);
+	void delay_deinit(delay_handle_t *handle);
+	void delay_reset(delay_handle_t *handle);
 	uint8_t delay_update(delay_handle_t *handle, delay_parameter pm, float32_t value);
-	void run_delay(delay_handle_t *handle);
+	uint8_t delay_set_time_mode(delay_handle_t *handle, delay_time_mode mode);
+	void delay_set_duck_source(delay_handle_t *handle, const volatile float32_t *level);
+	uint8_t delay_set_tap(delay_handle_t *handle, uint8_t channel, uint8_t tap, float32_t delay_ms, float32_t gain, float32_t pan, float32_t damping);
+	uint8_t delay_set_tap_count(delay_handle_t *handle, uint8_t count);
+	uint8_t delay_set_decimation(delay_handle_t *handle, uint8_t factor);
+	void run_delay(delay_handle_t *handle, uint32_t block_size);
 	void init_fir_filter(float32_t *filter_taps);
-	void run_fir_filter(float32_t *src, float32_t *dst);	
+	void run_fir_filter(uint8_t channel, float32_t *src, float32_t *dst, uint32_t block_size);	
+	uint8_t load_fir_filter_bank(const float32_t *const *bank, uint8_t sets, uint16_t taps);
+	uint8_t select_fir_filter(uint8_t set);
+	uint32_t fir_filter_latency(void);
+	// q31 kernels of the SAMPLE_Q31 chain
+	void run_delay_q31(delay_handle_t *handle, const q31_t *src, q31_t *dst, uint32_t block_size);
+	void run_fir_filter_q31(uint8_t channel, const q31_t *src, q31_t *dst, uint32_t block_size);
 	
+	// EQUALIZER
+	// bands: low shelf, peaking mid, high shelf (see eq_init)
+	#define EQ_BANDS 3
+	// equalizers that can be initialized (one per channel)
+	#ifndef EQ_MAX_INSTANCES
+	#define EQ_MAX_INSTANCES (AUDIO_CHANNELS)
+	#endif
+	typedef enum
+	{
+		EQ_BASS = 0,
+		EQ_MID,
+		EQ_TREBLE,
+		EQ_MID_FREQUENCY
+	} eq_parameter;
+	typedef struct
+	{
+		volatile float32_t gain_db[EQ_BANDS];
+		volatile float32_t mid_frequency;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		arm_biquad_cascade_df2T_instance_f32 biquad;
+		// coefficient sets: the one in use, the one published last and the one being computed (see eq_update)
+		float32_t coeffs[3][5 * EQ_BANDS];
+		volatile uint8_t active;
+		uint8_t used;
+		
+	} eq_handle_t;
+	
+	uint8_t eq_init(eq_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t bass_db, float32_t mid_db, float32_t treble_db);
+	uint8_t eq_update(eq_handle_t *handle, eq_parameter pm, float32_t value);
+	void run_eq(eq_handle_t *handle, uint32_t block_size);
+	
+	// shaping of the overdrive and the fuzz, by cost: table lookup, lookup with antiderivative anti-aliasing
+	// (about twice the lookup), lookup at DISTORTION_OVERSAMPLING times the sample rate
+	typedef enum
+	{
+		DISTORTION_LUT = 0,
+		DISTORTION_ADAA,
+		DISTORTION_OVERSAMPLED
+	} distortion_quality;
+
 	// OVERDRIVE	
 	typedef struct 
 	{
@@ -60,12 +221,19 @@ extern "C" {
 		volatile bool is_running;			
 		float32_t *src;
 		float32_t *dst;
+		waveshaper_t shaper;
+		oversampler_t oversampler;
+		volatile uint8_t quality;
+		// shaping kernel of the quality, bound by set_quality
+		volatile oversampler_node shape;
 		
 	} overdrive_handle_t;
 	
 	uint8_t overdrive_init(overdrive_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t threshold);
 	uint8_t overdrive_update(overdrive_handle_t *handle, float32_t threshold);
-	void run_overdrive(overdrive_handle_t *handle);
+	uint8_t overdrive_set_quality(overdrive_handle_t *handle, distortion_quality quality);
+	void run_overdrive(overdrive_handle_t *handle, uint32_t block_size);
+	void run_overdrive_q31(overdrive_handle_t *handle, const q31_t *src, q31_t *dst, uint32_t block_size);
 	
 	// FUZZ
 	typedef enum
@@ -80,14 +248,107 @@ extern "C" {
 		volatile bool is_running;
 		float32_t *src;
 		float32_t *dst;
+		waveshaper_t shaper;
+		oversampler_t oversampler;
+		volatile uint8_t quality;
+		volatile oversampler_node shape;
+		envelope_t envelope;
+		smooth_param_t mix_smooth;
+		smooth_param_t makeup_smooth;
 		
 	} fuzz_handle_t;
 	
 	uint8_t fuzz_init(fuzz_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t gain, float32_t mix);
 	uint8_t fuzz_update(fuzz_handle_t *handle, fuzz_parameter pm, float32_t value);
-	void run_fuzz(fuzz_handle_t *handle);
+	uint8_t fuzz_set_quality(fuzz_handle_t *handle, distortion_quality quality);
+	void run_fuzz(fuzz_handle_t *handle, uint32_t block_size);
+	
+	// NOISE GATE
+	typedef enum
+	{
+		GATE_THRESHOLD = 0,
+		GATE_RELEASE,
+		GATE_KEY
+	} gate_parameter;
+	typedef struct 
+	{
+		// linear level and coefficient, converted by gate_update
+		volatile float32_t threshold;
+		volatile float32_t close_coeff;
+		// the detector follows the sidechain block instead of the input (GATE_KEY), if there is one
+		volatile bool external;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		const float32_t *key;
+		envelope_t detector;
+		float32_t open_coeff;
+		float32_t gain;
+		bool open;
+		
+	} gate_handle_t;
+	
+	uint8_t gate_init(gate_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t threshold_db, float32_t release_ms);
+	uint8_t gate_update(gate_handle_t *handle, gate_parameter pm, float32_t value);
+	void gate_set_key(gate_handle_t *handle, const float32_t *key);
+	void run_gate(gate_handle_t *handle, uint32_t block_size);
+	
+	// COMPRESSOR
+	typedef enum
+	{
+		COMP_THRESHOLD = 0,
+		COMP_RATIO,
+		COMP_MAKEUP,
+		COMP_KEY
+	} comp_parameter;
+	typedef struct 
+	{
+		volatile float32_t threshold_db;
+		volatile float32_t ratio;
+		volatile float32_t makeup_db;
+		// the detector follows the sidechain block instead of the input (COMP_KEY), if there is one
+		volatile bool external;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		const float32_t *key;
+		envelope_t detector;
+		// gain at the end of the last block
+		float32_t gain;
+		
+	} comp_handle_t;
+	
+	uint8_t comp_init(comp_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t threshold_db, float32_t ratio, float32_t makeup_db);
+	uint8_t comp_update(comp_handle_t *handle, comp_parameter pm, float32_t value);
+	void comp_set_key(comp_handle_t *handle, const float32_t *key);
+	void run_comp(comp_handle_t *handle, uint32_t block_size);
+	
+	// LIMITER (output stage behind the chain, see run_fx in main.c)
+	// the gain is computed once per segment, the output is delayed by two segments (0.67 ms)
+	#define LIMITER_SEGMENT_SIZE (MIN_BLOCK_SIZE)
+	#define LIMITER_LOOKAHEAD (2 * LIMITER_SEGMENT_SIZE)
+	typedef struct 
+	{
+		// linear level and per segment coefficient, converted by limiter_init
+		float32_t ceiling;
+		float32_t release;
+		// gain at the end of the last segment, targets of the last two input segments
+		float32_t gain;
+		float32_t target[2];
+		// segments over full scale since init
+		uint32_t clips;
+		delay_line_t lookahead;
+		
+	} limiter_handle_t;
+	
+	uint8_t limiter_init(limiter_handle_t *handle, float32_t ceiling_db, float32_t release_ms);
+	void limiter_reset(limiter_handle_t *handle);
+	uint32_t run_limiter(limiter_handle_t *handle, const float32_t *src, float32_t *dst, uint32_t block_size);
+	uint32_t run_limiter_q31(limiter_handle_t *handle, const q31_t *src, q31_t *dst, uint32_t block_size);
 	
 	// TREMOLO
+	// LFO frequency at rate = 1 (0.002 rad per sample at 48 kHz)
+	#define TREMOLO_MAX_RATE_HZ 15.28f
 	typedef enum
 	{
 		RATE = 0,
@@ -98,39 +359,547 @@ extern "C" {
 		volatile float32_t rate;
 		volatile float32_t depth;
 		volatile bool is_running;		
-		float32_t time;
+		oscillator_t lfo;
+		// the LFO runs at control rate
+		control_param_t lfo_control;
 		float32_t *src;
 		float32_t *dst;
+		smooth_param_t rate_smooth;
+		smooth_param_t depth_smooth;
 		
 	} tremolo_handle_t;
 	
 	uint8_t tremolo_init(tremolo_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth);
 	uint8_t tremolo_update(tremolo_handle_t *handle, modulation_parameter pm, float32_t value);
-	void run_tremolo(tremolo_handle_t *handle);
+	void run_tremolo(tremolo_handle_t *handle, uint32_t block_size);
+	void tremolo_factor(tremolo_handle_t *handle, float32_t *factor, uint32_t block_size);
 	
 	// RING MODULATOR
+	// modulator frequency at rate = 1 (0.02 rad per sample at 48 kHz)
+	#define RING_MOD_MAX_RATE_HZ 152.8f
 	typedef enum
 	{
 		SINE = 0,
 		TRIANGLE,
 		SQUARE,
+		SAW,
 		NO_CHANGE
 	} modulator_type;
+	// the parameters change together (see param_block.h): the menu publishes them, the audio processing takes a snapshot
+	typedef struct
+	{
+		float32_t rate;
+		float32_t blend;
+		modulator_type type;
+	} ring_mod_params_t;
+	PARAM_BLOCK(ring_mod_block, ring_mod_params_t)
 	typedef struct 
 	{
-		volatile float32_t rate;
-		volatile float32_t blend;
-		volatile modulator_type type;
+		ring_mod_block_t shared;
+		// snapshot of shared, owned by the audio processing
+		ring_mod_params_t params;
+		uint32_t params_seen;
 		volatile bool is_running;			
 		float32_t *src;
 		float32_t *dst;
-		float32_t time;
+		smooth_param_t rate_smooth;
+		smooth_param_t blend_smooth;
+		oscillator_t lfo;
 		
 	} ring_mod_handle_t;
 	
 	uint8_t ring_mod_init(ring_mod_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t blend, modulator_type type);
 	uint8_t ring_mod_update(ring_mod_handle_t *handle, modulation_parameter pm, modulator_type type, float32_t value);
-	void run_ring_mod(ring_mod_handle_t *handle);
+	void run_ring_mod(ring_mod_handle_t *handle, uint32_t block_size);
+	void ring_mod_factor(ring_mod_handle_t *handle, float32_t *factor, uint32_t block_size);
+	
+	// CHORUS
+	typedef enum
+	{
+		CHORUS_RATE = 0,
+		CHORUS_DEPTH,
+		CHORUS_BLEND
+	} chorus_parameter;
+	typedef struct 
+	{
+		volatile float32_t rate;
+		volatile float32_t depth;
+		volatile float32_t blend;
+		volatile bool is_running;
+		float32_t time;
+		float32_t *src;
+		float32_t *dst;
+		smooth_param_t rate_smooth;
+		smooth_param_t depth_smooth;
+		smooth_param_t blend_smooth;
+		delay_line_t delay_line;
+		
+	} chorus_handle_t;
+	
+	uint8_t chorus_init(chorus_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth, float32_t blend);
+	uint8_t chorus_activate(chorus_handle_t *handle);
+	void chorus_deinit(chorus_handle_t *handle);
+	void chorus_reset(chorus_handle_t *handle);
+	uint8_t chorus_update(chorus_handle_t *handle, chorus_parameter pm, float32_t value);
+	void run_chorus(chorus_handle_t *handle, uint32_t block_size);
+	
+	// FLANGER
+	typedef enum
+	{
+		FLANGER_RATE = 0,
+		FLANGER_DEPTH,
+		FLANGER_FEEDBACK
+	} flanger_parameter;
+	typedef struct 
+	{
+		volatile float32_t rate;
+		volatile float32_t depth;
+		volatile float32_t feedback;
+		volatile bool is_running;
+		float32_t time;
+		float32_t *src;
+		float32_t *dst;
+		smooth_param_t rate_smooth;
+		smooth_param_t depth_smooth;
+		smooth_param_t feedback_smooth;
+		delay_line_t delay_line;
+		// DC blocker of the feedback path
+		dc_blocker_t dc_block;
+		
+	} flanger_handle_t;
+	
+	uint8_t flanger_init(flanger_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth, float32_t feedback);
+	uint8_t flanger_activate(flanger_handle_t *handle);
+	void flanger_deinit(flanger_handle_t *handle);
+	void flanger_reset(flanger_handle_t *handle);
+	uint8_t flanger_update(flanger_handle_t *handle, flanger_parameter pm, float32_t value);
+	void run_flanger(flanger_handle_t *handle, uint32_t block_size);
+	
+	// CABINET
+	// longest cabinet response in samples. the filter memory (2 * 4 bytes per sample) is in DTCM
+	#ifndef CAB_MAX_TAPS
+	#define CAB_MAX_TAPS (2048)
+	#endif
+	typedef enum
+	{
+		CAB_MIX = 0
+	} cab_parameter;
+	// direct form FIR or uniformly partitioned FFT convolution (see cab_choose_path)
+	typedef enum
+	{
+		CAB_DIRECT = 0,
+		CAB_FFT
+	} cab_path;
+	// convolution of one block on the chosen path, bound by cab_set_block_size. handle is the cab_handle_t
+	typedef void (*cab_kernel)(void *handle, uint32_t block_size);
+	typedef struct 
+	{
+		volatile float32_t mix;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		smooth_param_t mix_smooth;
+		const float32_t *ir;
+		uint32_t ir_length;
+		cab_path path;
+		cab_kernel convolve;
+		// filter memory from the DTCM arena, taken by the first cab_init
+		float32_t *memory;
+		arm_fir_instance_f32 fir;
+		convolver_t convolver;
+		// blocks shorter than one convolver partition are collected here (FFT path, see run_cab). fifo_dry: the dry
+		// signal of the block, delayed by the chunk like the cabinet signal
+		uint32_t fifo_fill;
+		float32_t fifo_in[CONVOLVER_PARTITION_SIZE];
+		float32_t fifo_out[CONVOLVER_PARTITION_SIZE];
+		float32_t fifo_dry[CONVOLVER_PARTITION_SIZE];
+		// dry signal of the mix: src, or fifo_dry while blocks are collected
+		const float32_t *dry;
+		
+	} cab_handle_t;
+	
+	uint8_t cab_init(cab_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, const float32_t *ir, uint32_t ir_length, float32_t mix, uint32_t block_size);
+	uint8_t cab_update(cab_handle_t *handle, cab_parameter pm, float32_t value);
+	uint8_t cab_set_block_size(cab_handle_t *handle, uint32_t block_size);
+	cab_path cab_choose_path(uint32_t taps, uint32_t block_size);
+	void run_cab(cab_handle_t *handle, uint32_t block_size);
+	uint32_t cab_latency(const cab_handle_t *handle, uint32_t block_size);
+	
+	// REVERB
+	typedef enum
+	{
+		REVERB_BLEND = 0,
+		REVERB_SHIMMER
+	} reverb_parameter;
+	typedef struct 
+	{
+		volatile float32_t blend;
+		volatile bool is_running;
+		// blocks in which the M4 didn't deliver the tail in time (DUAL_CORE only)
+		uint32_t overruns;
+		float32_t *src;
+		float32_t *dst;
+		// impulse response loaded by reverb_activate (NULL: generated) and its rate, spectra memory from the RAM_D1 arena (NULL: inactive)
+		const float32_t *ir;
+		uint32_t ir_length;
+		uint32_t ir_rate;
+		float32_t *memory;
+		smooth_param_t blend_smooth;
+		// only the early part of the impulse response is convolved (reverb_shorten)
+		bool short_tail;
+#if defined(REVERB_FDN)
+		// REVERB_FDN: the impulse response is ignored, memory holds the delay lines, work the chunk in DTCM
+		float32_t *work;
+		fdn_t fdn;
+		// level of the octave in the feedback (REVERB_SHIMMER). it only reaches the network while the caller allows it
+		// (reverb_allow_shimmer), after checking that the shifter fits into the block budget next to the network
+		volatile float32_t shimmer;
+		volatile bool shimmer_allowed;
+#else
+		// sample rate the spectra in memory were calculated for, 0: none loaded since reverb_init
+		uint32_t loaded_rate;
+		// tail schedule nu_convolver_autotune picked and the response length it was tuned for (0: not tuned yet)
+		uint8_t schedule;
+		uint32_t schedule_length;
+		// impulse response transformed ahead of time (reverb_set_image), replaces ir at its rate. NULL: none
+		const nu_convolver_image_t *image;
+		// blocks shorter than one convolver partition are collected here (see run_reverb)
+		uint32_t fifo_fill;
+		float32_t fifo_in[CONVOLVER_PARTITION_SIZE];
+		float32_t fifo_out[CONVOLVER_PARTITION_SIZE];
+		nu_convolver_t convolver;
+#endif
+		
+	} reverb_handle_t;
+	
+	uint8_t reverb_init(reverb_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, const float32_t *ir, uint32_t ir_length, uint32_t ir_rate, float32_t blend);
+	uint8_t reverb_activate(reverb_handle_t *handle);
+	void reverb_deinit(reverb_handle_t *handle);
+	uint8_t reverb_update(reverb_handle_t *handle, reverb_parameter pm, float32_t value);
+	uint8_t reverb_shorten(reverb_handle_t *handle, bool shorten);
+	void reverb_allow_shimmer(reverb_handle_t *handle, bool allow);
+	uint8_t reverb_rebuild(reverb_handle_t *handle);
+	uint8_t reverb_set_image(reverb_handle_t *handle, const nu_convolver_image_t *image);
+	void run_reverb(reverb_handle_t *handle, uint32_t block_size);
+	void reverb_reset(reverb_handle_t *handle);
+	
+	// PITCH SHIFTER
+	#define PITCH_MAX_SEMITONES 12
+	typedef enum
+	{
+		PITCH_SHIFT = 0,
+		PITCH_BLEND
+	} pitch_parameter;
+	typedef struct
+	{
+		volatile float32_t ratio;
+		volatile float32_t blend;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		smooth_param_t blend_smooth;
+		// Hann windows of the two read heads, half a cycle apart. their phase is also the position of the head (see run_pitch)
+		oscillator_t window[2];
+		delay_line_t delay_line;
+		
+	} pitch_handle_t;
+	
+	uint8_t pitch_init(pitch_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t semitones, float32_t blend);
+	uint8_t pitch_activate(pitch_handle_t *handle);
+	void pitch_deinit(pitch_handle_t *handle);
+	void pitch_reset(pitch_handle_t *handle);
+	uint8_t pitch_update(pitch_handle_t *handle, pitch_parameter pm, float32_t value);
+	void run_pitch(pitch_handle_t *handle, uint32_t block_size);
+	
+	// WAH (envelope or LFO controlled band pass)
+	// sweep range of the cutoff
+	#define WAH_MIN_HZ 350.0f
+	#define WAH_MAX_HZ 2500.0f
+	// LFO rate at rate = 1. rate = 0: the envelope of the input sweeps the filter (auto-wah)
+	#define WAH_MAX_RATE_HZ 5.0f
+	// samples per control step: the cutoff is computed once per step, the filter coefficients are interpolated in between
+	#define WAH_CONTROL_SIZE ((CONTROL_RATE_SIZE < MIN_BLOCK_SIZE) ? CONTROL_RATE_SIZE : MIN_BLOCK_SIZE)
+	typedef enum
+	{
+		WAH_SENSITIVITY = 0,
+		WAH_RESONANCE,
+		WAH_RATE,
+		WAH_MIX
+	} wah_parameter;
+	typedef struct
+	{
+		// envelope gain, damping (1 / Q) and LFO rate in Hz, converted by wah_update
+		volatile float32_t sensitivity;
+		volatile float32_t damping;
+		volatile float32_t rate;
+		volatile float32_t mix;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		smooth_param_t mix_smooth;
+		envelope_t detector;
+		// coefficients of the state variable filter at the end of the last control step and its two integrator states
+		float32_t a1;
+		float32_t a2;
+		float32_t a3;
+		float32_t ic1;
+		float32_t ic2;
+		// LFO phase in cycles, 0 to 1
+		float32_t phase;
+		
+	} wah_handle_t;
+	
+	uint8_t wah_init(wah_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t sensitivity, float32_t resonance, float32_t rate, float32_t mix);
+	void wah_reset(wah_handle_t *handle);
+	uint8_t wah_update(wah_handle_t *handle, wah_parameter pm, float32_t value);
+	void run_wah(wah_handle_t *handle, uint32_t block_size);
+	
+	// PHASER (cascade of swept first order allpass stages, mixed with the dry signal)
+	// sweep range of the allpass break frequency
+	#define PHASER_MIN_HZ 200.0f
+	#define PHASER_MAX_HZ 2000.0f
+	// LFO rate at rate = 1
+	#define PHASER_MAX_RATE_HZ 4.0f
+	// 4, 8 or 12 stages: 2, 4 or 6 notches
+	#define PHASER_STAGE_GROUP 4
+	#define PHASER_MAX_STAGES 12
+	// samples per control step. all stages run over one step before the next is loaded, the step stays in registers
+	#define PHASER_CONTROL_SIZE ((CONTROL_RATE_SIZE < MIN_BLOCK_SIZE) ? CONTROL_RATE_SIZE : MIN_BLOCK_SIZE)
+	typedef enum
+	{
+		PHASER_RATE = 0,
+		PHASER_DEPTH,
+		PHASER_STAGES,
+		PHASER_MIX
+	} phaser_parameter;
+	typedef struct
+	{
+		// LFO rate in Hz and number of stages, converted by phaser_update
+		volatile float32_t rate;
+		volatile float32_t depth;
+		volatile uint8_t stages;
+		volatile float32_t mix;
+		volatile bool is_running;
+		oscillator_t lfo;
+		float32_t *src;
+		float32_t *dst;
+		smooth_param_t mix_smooth;
+		// allpass coefficient at the end of the last control step, stages the states are valid for and the states
+		float32_t coefficient;
+		uint8_t active_stages;
+		float32_t state[PHASER_MAX_STAGES];
+		
+	} phaser_handle_t;
+	
+	uint8_t phaser_init(phaser_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t rate, float32_t depth, float32_t stages, float32_t mix);
+	void phaser_reset(phaser_handle_t *handle);
+	uint8_t phaser_update(phaser_handle_t *handle, phaser_parameter pm, float32_t value);
+	void run_phaser(phaser_handle_t *handle, uint32_t block_size);
+	
+	// AMP (captured amp model, see amp_model.h)
+	typedef enum
+	{
+		AMP_INPUT = 0,
+		AMP_LEVEL,
+		AMP_MIX
+	} amp_parameter;
+	typedef struct
+	{
+		// gains in front of and behind the model, converted by amp_update
+		volatile float32_t input;
+		volatile float32_t level;
+		volatile float32_t mix;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		smooth_param_t input_smooth;
+		smooth_param_t level_smooth;
+		smooth_param_t mix_smooth;
+		// model the channel runs (one for all channels), the model handed over by amp_load until it is copied,
+		// serial of the model the state belongs to
+		amp_model_t *model;
+		const amp_model_t * volatile pending;
+		uint32_t serial;
+		amp_state_t state;
+#if defined(AMP_POST_M4)
+		// chunks of the post-filter on the M4 (shorter blocks are collected) and chunks it didn't filter in time
+		float32_t fifo_in[BLOCK_QUEUE_BLOCK_SIZE];
+		float32_t fifo_out[BLOCK_QUEUE_BLOCK_SIZE];
+		uint32_t fifo_fill;
+		uint32_t overruns;
+#endif
+		
+	} amp_handle_t;
+	
+	uint8_t amp_init(amp_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, amp_model_t *model, float32_t input, float32_t level, float32_t mix);
+	void amp_reset(amp_handle_t *handle);
+	uint8_t amp_update(amp_handle_t *handle, amp_parameter pm, float32_t value);
+	uint8_t amp_load(amp_handle_t *handle, const amp_model_t *model);
+	void run_amp(amp_handle_t *handle, uint32_t block_size);
+	uint32_t amp_latency(const amp_handle_t *handle);
+	
+	// FX LOOP (send to and return from an external pedal, on the codec channel FXLOOP_SLOT)
+	// round trip beyond the DMA blocks (converters, cables, the pedal itself) at latency = 1, in samples
+	#define FXLOOP_MAX_LATENCY (256)
+	// dry signal delayed by the round trip: DMA_BLOCKS blocks of MAX_BLOCK_SIZE and FXLOOP_MAX_LATENCY, power of two
+	#if (DMA_BLOCKS > 2)
+	#define FXLOOP_DELAY_SIZE (2048)
+	#else
+	#define FXLOOP_DELAY_SIZE (1024)
+	#endif
+	// the DMA words are 24 bit codec samples, right aligned (CODEC_SHIFT in main.c)
+	#define FXLOOP_CODEC_SHIFT (8)
+	typedef enum
+	{
+		FXLOOP_MIX = 0,
+		FXLOOP_LATENCY
+	} fxloop_parameter;
+	typedef struct
+	{
+		// 0: dry, 1: return only (the pedal in series)
+		volatile float32_t mix;
+		// round trip beyond the DMA blocks in samples
+		volatile uint32_t latency;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		// codec words of the channel in the current DMA block, AUDIO_FRAME_WORDS apart (fxloop_set_block). NULL without
+		// a free codec channel
+		uint32_t *send;
+		const uint32_t *ret;
+		// the send was written since the last fxloop_take_sent
+		bool sent;
+		smooth_param_t mix_smooth;
+		float32_t dry[FXLOOP_DELAY_SIZE];
+		uint32_t write;
+		
+	} fxloop_handle_t;
+	
+	uint8_t fxloop_init(fxloop_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, float32_t mix, float32_t latency);
+	void fxloop_reset(fxloop_handle_t *handle);
+	uint8_t fxloop_update(fxloop_handle_t *handle, fxloop_parameter pm, float32_t value);
+	uint8_t fxloop_set_latency(fxloop_handle_t *handle, uint32_t samples);
+	uint32_t fxloop_latency(const fxloop_handle_t *handle, uint32_t block_size);
+	void fxloop_set_block(fxloop_handle_t *handle, uint32_t *send, const uint32_t *ret);
+	bool fxloop_take_sent(fxloop_handle_t *handle);
+	void run_fxloop(fxloop_handle_t *handle, uint32_t block_size);
+	
+	// NOISE REDUCTION (spectral subtraction on the STFT, see stft.h)
+	// the noise of a bin is the lowest smoothed power of the last one to two windows of this length
+	#define DENOISE_WINDOW_MS (750.0f)
+	// deepest attenuation of a bin at amount = 1
+	#define DENOISE_MAX_REDUCTION_DB (30.0f)
+	// power estimate smoothing per frame, and the fall of the gain per frame (it rises at once, transients stay)
+	#define DENOISE_SMOOTHING (0.3f)
+	#define DENOISE_RELEASE (0.5f)
+	typedef enum
+	{
+		DENOISE_AMOUNT = 0,
+		DENOISE_SENSITIVITY
+	} denoise_parameter;
+	typedef struct
+	{
+		// lowest gain of a bin and factor of the noise estimate subtracted, converted by denoise_update
+		volatile float32_t floor;
+		volatile float32_t over;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		stft_t stft;
+		// smoothed power, lowest power of the current and of the last window, gain of every bin. samples of the
+		// current window
+		float32_t power[STFT_BINS];
+		float32_t minimum[STFT_BINS];
+		float32_t previous[STFT_BINS];
+		float32_t gain[STFT_BINS];
+		uint32_t window_fill;
+		
+	} denoise_handle_t;
+	
+	uint8_t denoise_init(denoise_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, uint8_t slot, float32_t amount, float32_t sensitivity);
+	uint8_t denoise_activate(denoise_handle_t *handle);
+	void denoise_deinit(denoise_handle_t *handle);
+	void denoise_reset(denoise_handle_t *handle);
+	uint8_t denoise_update(denoise_handle_t *handle, denoise_parameter pm, float32_t value);
+	void run_denoise(denoise_handle_t *handle, uint32_t block_size);
+	uint32_t denoise_latency(const denoise_handle_t *handle);
+	
+	// FREEZE (held spectrum on the STFT, see stft.h)
+	// the held spectrum fades in and out over this many frames
+	#define FREEZE_FADE_FRAMES (8)
+	typedef enum
+	{
+		FREEZE_HOLD = 0,
+		FREEZE_BLEND
+	} freeze_parameter;
+	typedef struct
+	{
+		// the next frame is captured when hold is set and sustained while it stays set
+		volatile bool hold;
+		volatile float32_t blend;
+		volatile bool is_running;
+		float32_t *src;
+		float32_t *dst;
+		stft_t stft;
+		// magnitudes of the captured frame, level of the held spectrum in the output (fades with hold), the frame is
+		// captured, random phase state
+		float32_t magnitude[STFT_BINS];
+		float32_t level;
+		bool captured;
+		uint32_t seed;
+		
+	} freeze_handle_t;
+	
+	uint8_t freeze_init(freeze_handle_t *handle, float32_t *in_buffer, float32_t *out_buffer, uint8_t slot, float32_t hold, float32_t blend);
+	uint8_t freeze_activate(freeze_handle_t *handle);
+	void freeze_deinit(freeze_handle_t *handle);
+	void freeze_reset(freeze_handle_t *handle);
+	uint8_t freeze_update(freeze_handle_t *handle, freeze_parameter pm, float32_t value);
+	void run_freeze(freeze_handle_t *handle, uint32_t block_size);
+	uint32_t freeze_latency(const freeze_handle_t *handle);
+	
+	// PING-PONG DELAY (one handle for both channels, see run_pingpong)
+	// longest time per side in milliseconds, limited by the line (PINGPONG_LINE_FRAMES in fx_lib.c)
+	#define PINGPONG_MAX_TIME 340
+	// left and right line, their frames interleaved in one delay line
+	#define PINGPONG_LINES 2
+	typedef enum
+	{
+		PINGPONG_TIME = 0,
+		PINGPONG_FEEDBACK,
+		PINGPONG_CROSS,
+		PINGPONG_BLEND
+	} pingpong_parameter;
+	typedef struct
+	{
+		volatile float32_t delay_ms;
+		volatile float32_t feedback;
+		// share of each line fed into the other one: 0 = two separate echoes, 1 = every repeat changes sides
+		volatile float32_t cross;
+		volatile float32_t blend;
+		volatile bool is_running;
+		// buffers of the left and right channel. with AUDIO_CHANNELS 1 both inputs are the mono block and dst[1] is
+		// NULL: the lines are summed into dst[0]
+		float32_t *src[PINGPONG_LINES];
+		float32_t *dst[PINGPONG_LINES];
+		smooth_param_t feedback_smooth;
+		smooth_param_t cross_smooth;
+		smooth_param_t blend_smooth;
+		// time set by pingpong_update in frames. a new time is crossfaded in as with DELAY_TIME_JUMP: the tap faded
+		// out, the tap faded in and the fade between them (0 -> 1, 1 = idle)
+		volatile uint32_t delay_in_frames;
+		uint32_t tap_from;
+		uint32_t tap_to;
+		smooth_param_t tap_fade;
+		delay_line_t delay_line;
+	} pingpong_handle_t;
+	
+	uint8_t pingpong_init(pingpong_handle_t *handle, float32_t *const in_buffer[AUDIO_CHANNELS], float32_t *const out_buffer[AUDIO_CHANNELS], float32_t delay_ms, float32_t feedback, float32_t cross, float32_t blend);
+	uint8_t pingpong_activate(pingpong_handle_t *handle);
+	void pingpong_deinit(pingpong_handle_t *handle);
+	void pingpong_reset(pingpong_handle_t *handle);
+	uint8_t pingpong_update(pingpong_handle_t *handle, pingpong_parameter pm, float32_t value);
+	void run_pingpong(pingpong_handle_t *handle, uint32_t block_size);
 	
 	#ifdef __cplusplus
 	}
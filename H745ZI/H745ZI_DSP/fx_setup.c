@@ -0,0 +1,294 @@
+// fx_setup.c, Michael Haselberger
+// Description: The effect handles with their start-up parameters and the chain they run in, used by main.c and by
+// the desktop build in fx_host.c (see fx_setup.h)
+
+#include "fx_setup.h"
+
+// silence in samples at the running sample rate before an effect sleeps (fx_chain_set_tail), the longest gap in its
+// tail: the echoes of the delays are up to their longest time apart, the other effects decay without a gap
+#define SLEEP_HOLD_DELAY ((MAX_DELAY_TIME * sample_rate) / 1000 + MAX_BLOCK_SIZE)
+#define SLEEP_HOLD_PINGPONG ((2 * PINGPONG_MAX_TIME * sample_rate) / 1000 + MAX_BLOCK_SIZE)
+#define SLEEP_HOLD (sample_rate / 10)
+#define FX_BUFFER(b) ((float32_t *)(b))
+
+// effect handles, one per channel (cabinet and reverb are shared by both channels, see build_chain)
+delay_handle_t delay_handle[AUDIO_CHANNELS];
+tremolo_handle_t tremolo_handle[AUDIO_CHANNELS];
+overdrive_handle_t overdrive_handle[AUDIO_CHANNELS];
+fuzz_handle_t fuzz_handle[AUDIO_CHANNELS];
+ring_mod_handle_t ring_mod_handle[AUDIO_CHANNELS];
+chorus_handle_t chorus_handle[AUDIO_CHANNELS];
+flanger_handle_t flanger_handle[AUDIO_CHANNELS];
+eq_handle_t eq_handle[AUDIO_CHANNELS];
+gate_handle_t gate_handle[AUDIO_CHANNELS];
+comp_handle_t comp_handle[AUDIO_CHANNELS];
+pitch_handle_t pitch_handle[AUDIO_CHANNELS];
+wah_handle_t wah_handle[AUDIO_CHANNELS];
+phaser_handle_t phaser_handle[AUDIO_CHANNELS];
+amp_handle_t amp_handle[AUDIO_CHANNELS];
+// amp model the audio path runs, shared by the channels, in AXI SRAM (DTCM is full). models are loaded elsewhere and
+// handed over with amp_load
+amp_model_t amp_model;
+fxloop_handle_t fxloop_handle[AUDIO_CHANNELS];
+denoise_handle_t denoise_handle[AUDIO_CHANNELS];
+freeze_handle_t freeze_handle[AUDIO_CHANNELS];
+// one ping-pong delay for both channels: its lines feed into each other
+pingpong_handle_t pingpong_handle;
+cab_handle_t cab_handle;
+reverb_handle_t reverb_handle;
+// output stage behind the chain and the looper, on in every mode
+limiter_handle_t limiter_handle[AUDIO_CHANNELS];
+
+// Sample filter taps located in fx_lib.c
+extern float32_t filter_taps[NUM_TAPS];
+
+/******************************************************************************
+* Function Name: fx_setup_effects
+*******************************************************************************
+* Summary:
+*  Initialize every effect with its start-up parameters. The init functions keep the memory
+*  an effect already took, so this is also how the coefficients are recomputed for a new
+*  sample rate, the menu values are replayed afterwards.
+*
+* Parameters:
+*  1. sample_t *const in[]			- Input block of every channel, the mono nodes (cabinet,
+*									  reverb) run on the first one.
+*  2. sample_t *const out[]			- Output block of every channel.
+*  3. uint16_t block_size			- Samples per channel and block.
+*  4. const volatile float32_t *duck	- Envelope of the input the delay ducks with, 0 to 1.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_setup_effects(sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint16_t block_size,
+	const volatile float32_t *duck)
+{
+	float32_t *pingpong_in[AUDIO_CHANNELS];
+	float32_t *pingpong_out[AUDIO_CHANNELS];
+
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		delay_init(&delay_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 400, 0.4, 0.4);
+		// ducks with the envelope of the input, no detector of its own
+		delay_set_duck_source(&delay_handle[ch], duck);
+#if (DELAY_DECIMATION > 1)
+		delay_set_decimation(&delay_handle[ch], DELAY_DECIMATION);
+#endif
+		// the waveshaper tables are built once here, run_overdrive and run_fuzz only look them up
+		overdrive_init(&overdrive_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.3f);
+		fuzz_init(&fuzz_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 10.0f, 0.5f);
+		tremolo_init(&tremolo_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.7f, 0.8f);
+		ring_mod_init(&ring_mod_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.5f, 0.5f, SINE);
+		chorus_init(&chorus_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.3f, 0.5f, 0.5f);
+		flanger_init(&flanger_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.2f, 0.7f, 0.6f);
+		eq_init(&eq_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.0f, 0.0f, 0.0f);
+		gate_init(&gate_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), -60.0f, 100.0f);
+		comp_init(&comp_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), -20.0f, 4.0f, 6.0f);
+		// octave up
+		pitch_init(&pitch_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 12.0f, 0.5f);
+		// auto-wah: the envelope sweeps the filter
+		wah_init(&wah_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.5f, 0.5f, 0.0f, 1.0f);
+		// slow four stage sweep, equal mix for the deepest notches
+		phaser_init(&phaser_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 0.1f, 0.8f, 0.0f, 0.5f);
+	}
+	// no amp model is loaded yet -> the amp passes the input through
+	amp_model_clear(&amp_model);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		amp_init(&amp_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), &amp_model, 0.5f, 0.5f, 1.0f);
+		// the pedal in series, no converter latency assumed until it's set
+		fxloop_init(&fxloop_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), 1.0f, 0.0f);
+		// every channel and spectral effect transforms in its own slot: one frame per block at most
+		denoise_init(&denoise_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), ch % STFT_SLOTS, 0.7f, 0.5f);
+		freeze_init(&freeze_handle[ch], FX_BUFFER(in[ch]), FX_BUFFER(out[ch]), (STFT_SLOTS / 2 + ch) % STFT_SLOTS, 0.0f, 1.0f);
+	}
+	// dotted eighths at 120 bpm per side, half of every repeat changes sides
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		pingpong_in[ch] = FX_BUFFER(in[ch]);
+		pingpong_out[ch] = FX_BUFFER(out[ch]);
+	}
+	pingpong_init(&pingpong_handle, pingpong_in, pingpong_out, 187.5f, 0.4f, 0.5f, 0.4f);
+	// no impulse response header is exported yet -> generated impulse response
+	reverb_init(&reverb_handle, FX_BUFFER(in[0]), FX_BUFFER(out[0]), NULL, 0, 0, 0.3f);
+	// no cabinet response header is exported yet -> generated speaker band pass
+	cab_init(&cab_handle, FX_BUFFER(in[0]), FX_BUFFER(out[0]), NULL, 0, 1.0f, block_size);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		limiter_init(&limiter_handle[ch], -0.3f, 50.0f);
+	}
+}
+
+// silence all effects that keep a history of the signal, for a new block size or sample rate
+void fx_setup_reset(uint16_t block_size)
+{
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		delay_reset(&delay_handle[ch]);
+		chorus_reset(&chorus_handle[ch]);
+		flanger_reset(&flanger_handle[ch]);
+		pitch_reset(&pitch_handle[ch]);
+		wah_reset(&wah_handle[ch]);
+		phaser_reset(&phaser_handle[ch]);
+		amp_reset(&amp_handle[ch]);
+		fxloop_reset(&fxloop_handle[ch]);
+		denoise_reset(&denoise_handle[ch]);
+		freeze_reset(&freeze_handle[ch]);
+	}
+	pingpong_reset(&pingpong_handle);
+	init_fir_filter(filter_taps);
+	// the cheaper cabinet path depends on the block size
+	cab_set_block_size(&cab_handle, block_size);
+	reverb_reset(&reverb_handle);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		limiter_reset(&limiter_handle[ch]);
+	}
+}
+
+/******************************************************************************
+* Function Name: fx_setup_tails
+*******************************************************************************
+* Summary:
+*  Set the tails of the effects (fx_chain_set_tail) for the running sample rate: an idle pedal
+*  sleeps, an effect with silent input and a decayed tail is skipped until the input comes
+*  back. The delays and the reverb ring on when the switch moves on. The effects loop (the
+*  device in it may play on its own), the freeze and the noise estimate of the denoiser run
+*  always. Called by fx_setup_chain and after a new sample rate, while the audio is stopped.
+*
+* Parameters:
+*  1. fx_chain_t *chain				- The chain built by fx_setup_chain.
+* Return:
+*  None.
+*
+******************************************************************************/
+void fx_setup_tails(fx_chain_t *chain)
+{
+	static const uint8_t sleepers[] = { FXGATE, FXCOMP, FXPITCH, FXWAH, FXOVERDRIVE, FXFUZZ, FXAMP, FXFILTER, FXEQ, FXCAB,
+		FXRINGMOD, FXTREMOLO, FXPHASER, FXCHORUS, FXFLANGER };
+	for (uint8_t i = 0; i < sizeof(sleepers); ++i) fx_chain_set_tail(chain, sleepers[i], SLEEP_HOLD, false);
+	fx_chain_set_tail(chain, FXDELAY, SLEEP_HOLD_DELAY, true);
+	fx_chain_set_tail(chain, FXPINGPONG, SLEEP_HOLD_PINGPONG, true);
+	fx_chain_set_tail(chain, FXREVERB, 2 * SLEEP_HOLD, true);
+}
+
+/******************************************************************************
+* Function Name: fx_setup_chain
+*******************************************************************************
+* Summary:
+*  Put all effects into the chain in pedalboard order: dynamics and gain stages first, then filter and
+*  modulation, time based effects last. Every channel gets its own handles (dual mono),
+*  cabinet and reverb are shared mono nodes (their convolver memory exists once), the
+*  ping-pong delay processes both channels with one handle. The transition starts bypassed
+*  (FXNONE).
+*
+* Parameters:
+*  1. fx_chain_t *chain				- Chain to build.
+*  2. fx_transition_t *transition	- Switch between the effects of the chain.
+* Return:
+*  0:								- Success.
+*  255:								- The chain has no room for every effect (FX_CHAIN_MAX_NODES), the
+*									  nodes missing would never run and their effects would stay silent.
+*
+******************************************************************************/
+uint8_t fx_setup_chain(fx_chain_t *chain, fx_transition_t *transition)
+{
+	void *ctx[AUDIO_CHANNELS];
+	uint8_t dropped = 0;
+
+	fx_chain_init(chain);
+
+	// the hiss of the pickups is taken out before the gain stages raise it
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &denoise_handle[ch];
+	dropped |= (fx_chain_add(chain, FXDENOISE, fx_process_denoise, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &gate_handle[ch];
+	dropped |= (fx_chain_add(chain, FXGATE, fx_process_gate, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &comp_handle[ch];
+	dropped |= (fx_chain_add(chain, FXCOMP, fx_process_comp, ctx) == 255);
+	// in front of the distortion: the octave is shifted clean and distorted together with the dry signal
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &pitch_handle[ch];
+	dropped |= (fx_chain_add(chain, FXPITCH, fx_process_pitch, ctx) == 255);
+	// the envelope follows the pick attack of the clean signal, the distortion behind it would flatten it
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &wah_handle[ch];
+	dropped |= (fx_chain_add(chain, FXWAH, fx_process_wah, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &overdrive_handle[ch];
+	dropped |= (fx_chain_add(chain, FXOVERDRIVE, fx_process_overdrive, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &fuzz_handle[ch];
+	dropped |= (fx_chain_add(chain, FXFUZZ, fx_process_fuzz, ctx) == 255);
+	// in place of the distortion curves, in front of the filters and the cabinet as the amp in front of its speaker
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &amp_handle[ch];
+	dropped |= (fx_chain_add(chain, FXAMP, fx_process_amp, ctx) == 255);
+	// where the loop of an amp sits: behind the preamp, in front of the tone stack and the speaker
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &fxloop_handle[ch];
+	dropped |= (fx_chain_add(chain, FXLOOP, fx_process_fxloop, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = (void *)(uintptr_t)ch;
+	dropped |= (fx_chain_add(chain, FXFILTER, fx_process_filter, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &eq_handle[ch];
+	dropped |= (fx_chain_add(chain, FXEQ, fx_process_eq, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = (ch == 0) ? &cab_handle : NULL;
+	dropped |= (fx_chain_add(chain, FXCAB, fx_process_cab, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &ring_mod_handle[ch];
+	dropped |= (fx_chain_add(chain, FXRINGMOD, fx_process_ring_mod, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &tremolo_handle[ch];
+	dropped |= (fx_chain_add(chain, FXTREMOLO, fx_process_tremolo, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &phaser_handle[ch];
+	dropped |= (fx_chain_add(chain, FXPHASER, fx_process_phaser, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &chorus_handle[ch];
+	dropped |= (fx_chain_add(chain, FXCHORUS, fx_process_chorus, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &flanger_handle[ch];
+	dropped |= (fx_chain_add(chain, FXFLANGER, fx_process_flanger, ctx) == 255);
+	// the held sound goes through the delay and the reverb like a played note
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &freeze_handle[ch];
+	dropped |= (fx_chain_add(chain, FXFREEZE, fx_process_freeze, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &delay_handle[ch];
+	dropped |= (fx_chain_add(chain, FXDELAY, fx_process_delay, ctx) == 255);
+	// one handle for both channels, run once per block with both of them
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = &pingpong_handle;
+	dropped |= (fx_chain_add(chain, FXPINGPONG, fx_process_pingpong, ctx) == 255);
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch) ctx[ch] = (ch == 0) ? &reverb_handle : NULL;
+	dropped |= (fx_chain_add(chain, FXREVERB, fx_process_reverb, ctx) == 255);
+
+	// a node switched on again starts from silence instead of replaying its old delay lines
+	// the delay lines, the reverb spectra and the STFT frames are only held while the effect is selected (or fading)
+	fx_chain_set_lifecycle(chain, FXDELAY, fx_activate_delay, fx_deactivate_delay);
+	fx_chain_set_lifecycle(chain, FXCHORUS, fx_activate_chorus, fx_deactivate_chorus);
+	fx_chain_set_lifecycle(chain, FXFLANGER, fx_activate_flanger, fx_deactivate_flanger);
+	fx_chain_set_lifecycle(chain, FXPITCH, fx_activate_pitch, fx_deactivate_pitch);
+	fx_chain_set_lifecycle(chain, FXREVERB, fx_activate_reverb, fx_deactivate_reverb);
+	fx_chain_set_lifecycle(chain, FXDENOISE, fx_activate_denoise, fx_deactivate_denoise);
+	fx_chain_set_lifecycle(chain, FXFREEZE, fx_activate_freeze, fx_deactivate_freeze);
+	fx_chain_set_lifecycle(chain, FXPINGPONG, fx_activate_pingpong, fx_deactivate_pingpong);
+	// skipped first when the load governor runs out of other steps: ambience and the octave, the dry signal still sounds right
+	fx_chain_set_essential(chain, FXPITCH, false);
+	fx_chain_set_essential(chain, FXCHORUS, false);
+	fx_chain_set_essential(chain, FXFLANGER, false);
+	fx_chain_set_essential(chain, FXREVERB, false);
+	fx_chain_set_essential(chain, FXFREEZE, false);
+	// the nodes whose output lags: a crossfade between them lines the branches up (fx_transition_process). cabinet
+	// and amp declare the lag of their wet signal, the reverb tail doesn't need lining up
+	fx_chain_set_latency(chain, FXOVERDRIVE, fx_latency_overdrive);
+	fx_chain_set_latency(chain, FXFUZZ, fx_latency_fuzz);
+	fx_chain_set_latency(chain, FXAMP, fx_latency_amp);
+	fx_chain_set_latency(chain, FXCAB, fx_latency_cab);
+	fx_chain_set_latency(chain, FXLOOP, fx_latency_fxloop);
+	fx_chain_set_latency(chain, FXFILTER, fx_latency_filter);
+	fx_chain_set_latency(chain, FXDENOISE, fx_latency_denoise);
+	fx_chain_set_latency(chain, FXFREEZE, fx_latency_freeze);
+	// ring modulator and tremolo only scale the samples: side by side they share one pass over the signal
+	fx_chain_set_factor(chain, FXRINGMOD, fx_factor_ring_mod);
+	fx_chain_set_factor(chain, FXTREMOLO, fx_factor_tremolo);
+	// the lines of the ping-pong delay cross the channels
+	fx_chain_set_stereo(chain, FXPINGPONG, fx_stereo_pingpong);
+	fx_setup_tails(chain);
+	// the streaming kernels keep their chunk length whatever the block size
+	fx_chain_set_chunk(chain, FXFILTER, FX_CHUNK_FILTER);
+	fx_chain_set_chunk(chain, FXOVERDRIVE, FX_CHUNK_DISTORTION);
+	fx_chain_set_chunk(chain, FXFUZZ, FX_CHUNK_DISTORTION);
+	fx_chain_set_q15(chain, FX_CHAIN_Q15);
+#if defined(FX_CHAIN_PIPELINE)
+	// the stage boundary follows the measured node costs (fx_chain_balance in the control pass)
+	fx_chain_set_pipeline(chain, true, NULL, NULL);
+#endif
+	fx_transition_init(transition, chain, FXNONE);
+	return (dropped != 0) ? 255 : 0;
+}
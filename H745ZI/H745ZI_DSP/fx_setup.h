@@ -0,0 +1,58 @@
+// fx_setup.h, Michael Haselberger
+// Description: This file contains declarations for the effect handles and the chain set up in fx_setup.c
+
+#ifndef __FX_SETUP_H__
+#define __FX_SETUP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+#include "fx_lib.h"
+#include "fx_chain.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   The effects with their start-up parameters and the chain they run in, shared by the pedal (main.c) and the
+*   desktop build (fx_host.c): both initialize and chain the effects the same way. The caller owns the sample
+*   buffers, the chain and the transition, and adds what only exists on its side (the sidechain key, the looper).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+
+// effect handles, one per channel (cabinet and reverb are shared by both channels, the ping-pong delay processes
+// both channels with one handle)
+extern delay_handle_t delay_handle[AUDIO_CHANNELS];
+extern tremolo_handle_t tremolo_handle[AUDIO_CHANNELS];
+extern overdrive_handle_t overdrive_handle[AUDIO_CHANNELS];
+extern fuzz_handle_t fuzz_handle[AUDIO_CHANNELS];
+extern ring_mod_handle_t ring_mod_handle[AUDIO_CHANNELS];
+extern chorus_handle_t chorus_handle[AUDIO_CHANNELS];
+extern flanger_handle_t flanger_handle[AUDIO_CHANNELS];
+extern eq_handle_t eq_handle[AUDIO_CHANNELS];
+extern gate_handle_t gate_handle[AUDIO_CHANNELS];
+extern comp_handle_t comp_handle[AUDIO_CHANNELS];
+extern pitch_handle_t pitch_handle[AUDIO_CHANNELS];
+extern wah_handle_t wah_handle[AUDIO_CHANNELS];
+extern phaser_handle_t phaser_handle[AUDIO_CHANNELS];
+extern amp_handle_t amp_handle[AUDIO_CHANNELS];
+extern amp_model_t amp_model;
+extern fxloop_handle_t fxloop_handle[AUDIO_CHANNELS];
+extern denoise_handle_t denoise_handle[AUDIO_CHANNELS];
+extern freeze_handle_t freeze_handle[AUDIO_CHANNELS];
+extern pingpong_handle_t pingpong_handle;
+extern cab_handle_t cab_handle;
+extern reverb_handle_t reverb_handle;
+extern limiter_handle_t limiter_handle[AUDIO_CHANNELS];
+
+void fx_setup_effects(sample_t *const in[AUDIO_CHANNELS], sample_t *const out[AUDIO_CHANNELS], uint16_t block_size,
+	const volatile float32_t *duck);
+void fx_setup_reset(uint16_t block_size);
+void fx_setup_tails(fx_chain_t *chain);
+uint8_t fx_setup_chain(fx_chain_t *chain, fx_transition_t *transition);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __FX_SETUP_H__
@@ -0,0 +1,134 @@
+// governor.c, Michael Haselberger
+// Description: CPU load governor. Watches the longest block of the audio path (profiler) and the DMA overruns, lowers
+// the quality of the effects one level at a time while the block deadline is in danger (oversampling, reverb tail,
+// effects that aren't essential) and restores it when there's room again. Every level change is logged over SWO.
+
+#include <stdio.h>
+#include "stm32h7xx_hal.h"
+#include "profiler.h"
+#include "governor.h"
+
+#if defined(GOVERNOR)
+
+static const char *const level_names[GOVERNOR_LEVELS] =
+{
+	"full", "oversampling 2x", "no oversampling", "short reverb", "shed"
+};
+
+// write a string to ITM stimulus port 0 (SWO). returns immediately if no debugger enabled the ITM
+static void swo_write(const char *str)
+{
+	while (*str)
+	{
+		ITM_SendChar(*str++);
+	}
+}
+
+static void change_level(governor_t *g, governor_level level, uint32_t missed)
+{
+	char line[96];
+
+	snprintf(line, sizeof(line), "governor: %s -> %s, load %lu.%lu%%, %lu overrun(s)\r\n",
+		level_names[g->level], level_names[level],
+		(unsigned long)(g->load / 10), (unsigned long)(g->load % 10), (unsigned long)missed);
+	swo_write(line);
+
+	g->level = level;
+	g->steps++;
+}
+
+/******************************************************************************
+* Function Name: governor_init
+*******************************************************************************
+* Summary:
+*  Start at full quality. Call after profiler_init.
+*
+* Parameters:
+*  1. governor_t *g					- Address pointer of the governor struct.
+*  2. uint32_t overruns				- Current overrun count of the audio path.
+*  3. uint32_t now					- Current tick in ms (HAL_GetTick).
+* Return:
+*  None.
+*
+******************************************************************************/
+void governor_init(governor_t *g, uint32_t overruns, uint32_t now)
+{
+	g->level = GOVERNOR_FULL;
+	g->overruns = overruns;
+	g->last_update = now;
+	g->calm_since = now;
+	g->load = 0;
+	g->load_before = 0;
+	for (uint8_t l = 0; l < GOVERNOR_LEVELS; ++l)
+	{
+		g->saving[l] = 0;
+	}
+	g->steps = 0;
+	// the first interval starts now
+	profiler_take_peak(PROFILE_WINDOW_GOVERNOR);
+}
+
+/******************************************************************************
+* Function Name: governor_update
+*******************************************************************************
+* Summary:
+*  Evaluate the last interval, once every GOVERNOR_INTERVAL_MS. An overrun or a block above
+*  GOVERNOR_HIGH_LOAD degrades one level, so a sudden overload is answered within a few
+*  intervals. The interval after a step measures what the step saved. A level is restored when
+*  there was no overload for GOVERNOR_HOLD_MS and the current load plus the saving of that
+*  level stays GOVERNOR_MARGIN below GOVERNOR_HIGH_LOAD, so restoring doesn't cause the
+*  overload it was degraded for. Call from the main loop.
+*
+* Parameters:
+*  1. governor_t *g					- Address pointer of the governor struct.
+*  2. uint32_t overruns				- Overrun count of the audio path (DMA blocks that found
+*									  the queue full).
+*  3. uint32_t now					- Current tick in ms (HAL_GetTick).
+* Return:
+*  1:								- The level changed, apply g->level to the effects.
+*  0:								- No change.
+*
+******************************************************************************/
+uint8_t governor_update(governor_t *g, uint32_t overruns, uint32_t now)
+{
+	if ((now - g->last_update) < GOVERNOR_INTERVAL_MS)
+	{
+		return 0;
+	}
+	g->last_update = now;
+
+	const uint32_t missed = overruns - g->overruns;
+	g->overruns = overruns;
+	g->load = profiler_load(profiler_take_peak(PROFILE_WINDOW_GOVERNOR));
+
+	if (g->load_before)
+	{
+		// first interval on the level entered last
+		g->saving[g->level - 1] = (g->load_before > g->load) ? (g->load_before - g->load) : 0;
+		g->load_before = 0;
+	}
+
+	if (missed || (g->load > GOVERNOR_HIGH_LOAD))
+	{
+		g->calm_since = now;
+		if (g->level < (GOVERNOR_LEVELS - 1))
+		{
+			// an overrun can happen below the threshold (e.g. a long interrupt), the saving must not be 0 then
+			g->load_before = (g->load > GOVERNOR_HIGH_LOAD) ? g->load : GOVERNOR_HIGH_LOAD;
+			change_level(g, g->level + 1, missed);
+			return 1;
+		}
+		return 0;
+	}
+
+	if ((g->level > GOVERNOR_FULL) && ((now - g->calm_since) >= GOVERNOR_HOLD_MS)
+		&& ((g->load + g->saving[g->level - 1] + GOVERNOR_MARGIN) < GOVERNOR_HIGH_LOAD))
+	{
+		g->calm_since = now;
+		change_level(g, g->level - 1, 0);
+		return 1;
+	}
+	return 0;
+}
+
+#endif // GOVERNOR
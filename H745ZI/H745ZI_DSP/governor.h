@@ -0,0 +1,71 @@
+// governor.h, Michael Haselberger
+// Description: This file contains declarations for the CPU load governor implemented in governor.c
+
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "defines_and_constants.h"
+
+#if defined(GOVERNOR) && !defined(PROFILER)
+#error "GOVERNOR measures the load with the profiler, define PROFILER"
+#endif
+
+// load is evaluated every GOVERNOR_INTERVAL_MS: the longest block of the interval, in 0.1 % of the block budget
+#define GOVERNOR_INTERVAL_MS (100)
+// a longer block or an overrun degrades one level
+#define GOVERNOR_HIGH_LOAD (850)
+// a level is restored after GOVERNOR_HOLD_MS without overload, if the load it cost still stays this far below GOVERNOR_HIGH_LOAD
+#define GOVERNOR_MARGIN (100)
+#define GOVERNOR_HOLD_MS (3000)
+
+// degradation levels, every level includes the ones before
+typedef enum
+{
+	GOVERNOR_FULL = 0,			// everything as configured
+	GOVERNOR_OVERSAMPLING_2X,	// distortion oversampled twice at most
+	GOVERNOR_OVERSAMPLING_OFF,	// distortion without oversampling
+	GOVERNOR_SHORT_REVERB,		// reverb without the long tail (reverb_shorten)
+	GOVERNOR_SHED,				// nodes that aren't essential are skipped (fx_chain_shed)
+	GOVERNOR_LEVELS
+} governor_level;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Load governor. The audio path has a hard deadline: a block that isn't done when the DMA needs it plays the stale half
+*   again. Instead, the governor lowers the quality step by step while the load is too high, and raises it again when the
+*   step isn't needed anymore. It only decides, the caller applies the level to the effects. Main loop only.
+*
+*   Members:
+*   level:              Current degradation level.
+*   overruns:           Overrun count at the last evaluation.
+*   last_update:        Tick of the last evaluation.
+*   calm_since:         Tick since which there was no overload.
+*   load:               Peak load of the last interval in 0.1 %.
+*   load_before:        Peak load of the interval that led to the last degradation, 0 once its saving is measured.
+*   saving:             saving[l]: load saved by going from level l to level l + 1, measured after the step.
+*   steps:              Number of level changes.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	governor_level level;
+	uint32_t overruns;
+	uint32_t last_update;
+	uint32_t calm_since;
+	uint32_t load;
+	uint32_t load_before;
+	uint32_t saving[GOVERNOR_LEVELS];
+	uint32_t steps;
+} governor_t;
+
+void governor_init(governor_t *g, uint32_t overruns, uint32_t now);
+uint8_t governor_update(governor_t *g, uint32_t overruns, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __GOVERNOR_H__
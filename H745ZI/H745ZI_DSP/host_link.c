@@ -0,0 +1,754 @@
+// host_link.c, Michael Haselberger
+// Description: Binary host protocol on USART3, the virtual COM port of the ST-LINK: parameter get and set, any command of
+// the menu, preset and cabinet response upload, a status stream of the profiler and the level meter and the read-out of
+// the post-mortem capture, for tuning without the encoder and the LCD. The DMA receives into a circular buffer, the UART
+// interrupt only queues the bytes. Framing (COBS, CRC), the commands and the answers run in the control pass of the
+// main loop (the control task with RTOS), which the audio path preempts, and the answers leave by DMA: the audio path
+// never waits for the host.
+
+#include "main.h"
+
+#if defined(HOST_LINK)
+
+UART_HandleTypeDef huart_host;
+DMA_HandleTypeDef hdma_host_rx;
+DMA_HandleTypeDef hdma_host_tx;
+
+// in AXI SRAM (.bss): the DMA can't reach the DTCM. cacheable, invalidated before reading and cleaned before sending
+static uint8_t rx_buffer[HOST_RX_BUFFER_SIZE] __attribute__((aligned(32)));
+static uint8_t tx_buffer[2][HOST_TX_BUFFER_SIZE] __attribute__((aligned(32)));
+// next byte of rx_buffer that wasn't queued yet
+static uint16_t rx_position = 0;
+static host_rx_queue_t rx_queue;
+// encoded bytes of the frame being received. too_long: the frame didn't fit, it's skipped up to its delimiter
+static uint8_t frame[HOST_MAX_FRAME];
+static uint16_t frame_length = 0;
+static bool too_long = false;
+// transmit buffer being filled and its bytes. the other one is on the bus while tx_busy
+static uint8_t tx_fill = 0;
+static uint16_t tx_length[2] = { 0 };
+static volatile bool tx_busy = false;
+// cabinet response being uploaded (HOST_IR_DATA), handed to audio_load_cab by HOST_IR_LOAD
+static float32_t ir_upload[CAB_MAX_TAPS];
+// status stream: period in ms (0: off) and tick of the last HOST_STATUS
+static uint32_t stream_period = 0;
+static uint32_t stream_tick = 0;
+static host_link_stats_t stats;
+
+static uint8_t start_reception(void)
+{
+	rx_position = 0;
+	return (HAL_UARTEx_ReceiveToIdle_DMA(&huart_host, rx_buffer, HOST_RX_BUFFER_SIZE) == HAL_OK) ? 0 : 253;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+	return p + 4;
+}
+
+static uint8_t *put_f32(uint8_t *p, float32_t value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return put_u32(p, bits);
+}
+
+// the low level part of a HAL_UART_MspInit: MIDI has the HAL callback (midi.c), USART3 is set up here
+static uint8_t msp_init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	RCC_PeriphCLKInitTypeDef PeriphClkInitStruct = {0};
+
+	// the baud rate is derived from the HSI, as for USART2: the APB clock depends on the core clock profile (see rcc.c)
+	PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_USART3;
+	PeriphClkInitStruct.Usart234578ClockSelection = RCC_USART234578CLKSOURCE_HSI;
+	if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK)
+	{
+		return 253;
+	}
+	__HAL_RCC_USART3_CLK_ENABLE();
+	__HAL_RCC_GPIOD_CLK_ENABLE();
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	/* USART3 GPIO Configuration
+		PD8     ------> USART3_TX
+		PD9     ------> USART3_RX
+	*/
+	GPIO_InitStruct.Pin = GPIO_PIN_8 | GPIO_PIN_9;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = GPIO_AF7_USART3;
+	HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
+	hdma_host_rx.Instance = DMA1_Stream3;
+	hdma_host_rx.Init.Request = DMA_REQUEST_USART3_RX;
+	hdma_host_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_host_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_host_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_host_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_host_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_host_rx.Init.Mode = DMA_CIRCULAR;
+	hdma_host_rx.Init.Priority = DMA_PRIORITY_LOW;
+	hdma_host_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	hdma_host_tx.Instance = DMA1_Stream4;
+	hdma_host_tx.Init = hdma_host_rx.Init;
+	hdma_host_tx.Init.Request = DMA_REQUEST_USART3_TX;
+	hdma_host_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_host_tx.Init.Mode = DMA_NORMAL;
+	if ((HAL_DMA_Init(&hdma_host_rx) != HAL_OK) || (HAL_DMA_Init(&hdma_host_tx) != HAL_OK))
+	{
+		return 253;
+	}
+	__HAL_LINKDMA(&huart_host, hdmarx, hdma_host_rx);
+	__HAL_LINKDMA(&huart_host, hdmatx, hdma_host_tx);
+
+	// below the audio processing (PendSV) and above the controls: queuing the bytes and starting the next transfer is
+	// all these interrupts do, the frames are handled in the control pass
+	HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 2, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+	HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 2, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+	HAL_NVIC_SetPriority(USART3_IRQn, 2, 0);
+	HAL_NVIC_EnableIRQ(USART3_IRQn);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: host_link_init
+*******************************************************************************
+* Summary:
+*  Set up USART3 for the host (HOST_LINK_BAUD_RATE, 8N1) and start the circular DMA reception.
+*  Call from main after peripheral_init.
+*
+* Parameters:
+*  None.
+* Return:
+*  253:								- UART or DMA couldn't be started.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t host_link_init(void)
+{
+	host_rx_queue_clear(&rx_queue);
+	memset(&stats, 0, sizeof(stats));
+	frame_length = 0;
+	too_long = false;
+	tx_fill = 0;
+	tx_length[0] = 0;
+	tx_length[1] = 0;
+	tx_busy = false;
+	stream_period = 0;
+
+	if (msp_init() != 0)
+	{
+		return 253;
+	}
+	huart_host.Instance = HOST_LINK_UART;
+	huart_host.Init.BaudRate = HOST_LINK_BAUD_RATE;
+	huart_host.Init.WordLength = UART_WORDLENGTH_8B;
+	huart_host.Init.StopBits = UART_STOPBITS_1;
+	huart_host.Init.Parity = UART_PARITY_NONE;
+	huart_host.Init.Mode = UART_MODE_TX_RX;
+	huart_host.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+	huart_host.Init.OverSampling = UART_OVERSAMPLING_16;
+	huart_host.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+	huart_host.Init.ClockPrescaler = UART_PRESCALER_DIV1;
+	huart_host.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+	if (HAL_UART_Init(&huart_host) != HAL_OK)
+	{
+		return 253;
+	}
+	return start_reception();
+}
+
+/******************************************************************************
+* Function Name: host_crc16
+*******************************************************************************
+* Summary:
+*  CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, no reflection) of the payload
+*  of a frame. Bitwise: a frame is a few bytes, hundreds of them per second cost less than a
+*  table in the DTCM.
+*
+* Parameters:
+*  1. const uint8_t *data			- Bytes.
+*  2. uint32_t length				- Number of bytes.
+* Return:
+*  CRC of the bytes.
+*
+******************************************************************************/
+uint16_t host_crc16(const uint8_t *data, uint32_t length)
+{
+	uint16_t crc = 0xFFFF;
+	for (uint32_t i = 0; i < length; ++i)
+	{
+		crc ^= (uint16_t)data[i] << 8;
+		for (uint8_t bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+/******************************************************************************
+* Function Name: host_cobs_encode
+*******************************************************************************
+* Summary:
+*  Consistent overhead byte stuffing: every 0x00 of the bytes is replaced by the distance to the
+*  next one, so the encoded frame has no 0x00 and the delimiter behind it marks its end. Adds
+*  one byte, plus one per 254 bytes without a 0x00. The delimiter isn't written.
+*
+* Parameters:
+*  1. const uint8_t *src			- Bytes to encode.
+*  2. uint32_t length				- Number of bytes.
+*  3. uint8_t *dst					- Encoded bytes. Room for length + length / 254 + 1 bytes.
+* Return:
+*  Number of encoded bytes.
+*
+******************************************************************************/
+uint32_t host_cobs_encode(const uint8_t *src, uint32_t length, uint8_t *dst)
+{
+	uint32_t code_position = 0;
+	uint32_t out = 1;
+	uint8_t code = 1;
+	for (uint32_t i = 0; i < length; ++i)
+	{
+		if (src[i] == 0)
+		{
+			dst[code_position] = code;
+			code_position = out++;
+			code = 1;
+			continue;
+		}
+		dst[out++] = src[i];
+		if (++code == 0xFF)
+		{
+			// a full block of 254 bytes without a 0x00: the next code follows without one
+			dst[code_position] = code;
+			code_position = out++;
+			code = 1;
+		}
+	}
+	dst[code_position] = code;
+	return out;
+}
+
+/******************************************************************************
+* Function Name: host_cobs_decode
+*******************************************************************************
+* Summary:
+*  Undo host_cobs_encode on a received frame without its delimiter. src and dst may be the same
+*  buffer, the decoded bytes are never ahead of the encoded ones.
+*
+* Parameters:
+*  1. const uint8_t *src			- Encoded bytes, no 0x00 among them.
+*  2. uint32_t length				- Number of encoded bytes.
+*  3. uint8_t *dst					- Decoded bytes, at most length - 1.
+* Return:
+*  0:								- The frame is malformed (a code points behind its end or is 0x00).
+*  Number of decoded bytes otherwise.
+*
+******************************************************************************/
+uint32_t host_cobs_decode(const uint8_t *src, uint32_t length, uint8_t *dst)
+{
+	uint32_t in = 0;
+	uint32_t out = 0;
+	while (in < length)
+	{
+		const uint8_t code = src[in++];
+		if ((code == 0) || ((in + code - 1) > length))
+		{
+			return 0;
+		}
+		for (uint8_t k = 1; k < code; ++k)
+		{
+			dst[out++] = src[in++];
+		}
+		// the 0x00 the code stood for. none after a full block and none at the end of the frame
+		if ((code != 0xFF) && (in < length))
+		{
+			dst[out++] = 0;
+		}
+	}
+	return out;
+}
+
+// append a frame (CRC, COBS, delimiter) to the transmit buffer being filled. counted and dropped if it's full
+static void send(const uint8_t *payload, uint32_t length)
+{
+	uint8_t raw[HOST_MAX_PAYLOAD + 2];
+	uint8_t encoded[HOST_MAX_FRAME + 1];
+	memcpy(raw, payload, length);
+	put_u16(&raw[length], host_crc16(payload, length));
+	uint32_t size = host_cobs_encode(raw, length + 2, encoded);
+	encoded[size++] = 0;
+
+	if ((tx_length[tx_fill] + size) > HOST_TX_BUFFER_SIZE)
+	{
+		stats.tx_dropped++;
+		return;
+	}
+	memcpy(&tx_buffer[tx_fill][tx_length[tx_fill]], encoded, size);
+	tx_length[tx_fill] += size;
+}
+
+// answer of a request: its type and the result
+static void acknowledge(uint8_t type, uint8_t sequence, uint8_t result)
+{
+	const uint8_t payload[4] = { HOST_ACK, sequence, type, result };
+	send(payload, sizeof(payload));
+}
+
+// hand the filled transmit buffer to the DMA if the other one is sent already
+static void flush(void)
+{
+	if (tx_busy || (tx_length[tx_fill] == 0))
+	{
+		return;
+	}
+	uint8_t *buffer = tx_buffer[tx_fill];
+	SCB_CleanDCache_by_Addr((uint32_t *)buffer, HOST_TX_BUFFER_SIZE);
+	tx_busy = true;
+	if (HAL_UART_Transmit_DMA(&huart_host, buffer, tx_length[tx_fill]) != HAL_OK)
+	{
+		// the frames are lost, the host repeats what isn't answered
+		tx_busy = false;
+		stats.tx_dropped++;
+	}
+	tx_fill ^= 1;
+	tx_length[tx_fill] = 0;
+}
+
+/******************************************************************************
+* Function Name: send_status
+*******************************************************************************
+* Summary:
+*  One HOST_STATUS frame: uint32_t tick, uint8_t mode, uint8_t flags (bit 0: the load figures
+*  are valid, bit 1: the meter follows), uint16_t block size, uint32_t sample rate, uint16_t
+*  average and maximum load of the active effect in 0.1 % of the block budget, uint32_t
+*  deadline misses, clips, DMA overruns, DMA and I2S errors, the counters of the link (frames,
+*  errors, rx_dropped, tx_dropped), with TELEMETRY the meter: uint32_t sequence, float rms
+*  and peak in dBFS, int8_t level of every band in dB, and (bit 2) uint32_t used, high water
+*  mark and size of every effect memory arena in bytes, ARENA_TCM first, with STACK_MONITOR
+*  (bit 3) uint32_t high water mark and size of every stack_context in bytes, 0 for the ones
+*  the build doesn't have.
+*
+* Parameters:
+*  1. uint8_t mode					- Active effect mode.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void send_status(uint8_t mode)
+{
+	uint8_t payload[HOST_MAX_PAYLOAD];
+	uint8_t *p = payload;
+	const audio_stats_t *audio = audio_get_stats();
+	uint8_t flags = 0;
+	uint32_t load_avg = 0;
+	uint32_t load_max = 0;
+	uint32_t misses = 0;
+	uint32_t clips = 0;
+#if defined(PROFILER)
+	const profile_mode_t *profile = profiler_get(mode);
+	const profile_stats_t *total = (profile) ? &profile->section[PROFILE_TOTAL] : NULL;
+	if ((total != NULL) && (total->count > 0))
+	{
+		flags |= 0x01;
+		load_avg = profiler_load((uint32_t)(total->sum / total->count));
+		load_max = profiler_load(total->max);
+		misses = profile->deadline_misses;
+		clips = profile->clips;
+	}
+#endif
+#if defined(TELEMETRY)
+	flags |= 0x02;
+#endif
+	flags |= 0x04;
+#if defined(STACK_MONITOR)
+	flags |= 0x08;
+#endif
+
+	*p++ = HOST_STATUS;
+	*p++ = 0;
+	p = put_u32(p, HAL_GetTick());
+	*p++ = mode;
+	*p++ = flags;
+	p = put_u16(p, audio_get_block_size());
+	p = put_u32(p, audio_get_sample_rate());
+	p = put_u16(p, (uint16_t)((load_avg > UINT16_MAX) ? UINT16_MAX : load_avg));
+	p = put_u16(p, (uint16_t)((load_max > UINT16_MAX) ? UINT16_MAX : load_max));
+	p = put_u32(p, misses);
+	p = put_u32(p, clips);
+	p = put_u32(p, audio->overruns);
+	p = put_u32(p, audio->dma_errors + audio->i2s_errors);
+	p = put_u32(p, stats.frames);
+	p = put_u32(p, stats.errors);
+	p = put_u32(p, stats.rx_dropped);
+	p = put_u32(p, stats.tx_dropped);
+#if defined(TELEMETRY)
+	const telemetry_t *meter = telemetry_get();
+	p = put_u32(p, meter->sequence);
+	p = put_f32(p, meter->rms);
+	p = put_f32(p, meter->peak);
+	for (uint8_t b = 0; b < TELEMETRY_BANDS; ++b)
+	{
+		// whole dB from the floor to full scale
+		*p++ = (uint8_t)(int8_t)fmaxf(meter->band[b], TELEMETRY_FLOOR_DB);
+	}
+#endif
+	// the arenas are only touched by the main loop, the values are consistent
+	for (uint8_t c = 0; c < ARENA_CLASSES; ++c)
+	{
+		const arena_t *arena = arena_get((arena_class)c);
+		p = put_u32(p, (uint32_t)arena->used);
+		p = put_u32(p, (uint32_t)arena->high_water);
+		p = put_u32(p, (uint32_t)arena->size);
+	}
+#if defined(STACK_MONITOR)
+	stack_stats_t stack;
+	stack_monitor_get(&stack);
+	for (uint8_t c = 0; c < STACK_CONTEXTS; ++c)
+	{
+		p = put_u32(p, stack.used[c]);
+		p = put_u32(p, stack.size[c]);
+	}
+#endif
+	send(payload, (uint32_t)(p - payload));
+}
+
+#if defined(CAPTURE)
+// HOST_CAPTURE_INFO: the layout of the ring, for cutting the bytes of HOST_CAPTURE_DATA into records
+static void send_capture_info(uint8_t sequence)
+{
+	capture_info_t info;
+	capture_get_info(&info);
+	uint8_t payload[26];
+	uint8_t *p = payload;
+	*p++ = HOST_CAPTURE_INFO;
+	*p++ = sequence;
+	*p++ = info.state;
+	*p++ = info.reason;
+	p = put_u16(p, info.block_size);
+	p = put_u32(p, info.sample_rate);
+	p = put_u32(p, info.record_bytes);
+	p = put_u32(p, info.records);
+	p = put_u32(p, info.trigger);
+	p = put_u32(p, info.budget);
+	send(payload, (uint32_t)(p - payload));
+}
+#endif
+
+/******************************************************************************
+* Function Name: handle
+*******************************************************************************
+* Summary:
+*  Carry out a request of the host and answer it. Menu values and commands go the way of the
+*  menu (ui_execute), so the presets saved afterwards contain them.
+*
+* Parameters:
+*  1. const uint8_t *payload		- Type, sequence and body of the frame, CRC checked.
+*  2. uint32_t length				- Bytes of the payload.
+*  3. uint8_t *mode					- Pointer to the variable that's responsible for effect selection.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void handle(const uint8_t *payload, uint32_t length, uint8_t *mode)
+{
+	const uint8_t type = payload[0];
+	const uint8_t sequence = payload[1];
+	const uint8_t *body = &payload[2];
+	const uint32_t size = length - 2;
+	uint8_t result = 0;
+
+	switch (type)
+	{
+	case HOST_PING:
+		result = HOST_LINK_VERSION;
+		break;
+	case HOST_GET:
+		if ((size == 2) && (body[0] < PRESET_EFFECTS) && (body[1] >= 1) && (body[1] <= PRESET_PARAMETERS))
+		{
+			const uint8_t answer[5] = { HOST_VALUE, sequence, body[0], body[1], ui_value(body[0], body[1]) };
+			send(answer, sizeof(answer));
+			return;
+		}
+		result = 254;
+		break;
+	case HOST_SET:
+		if ((size == 3) && (body[0] < PRESET_EFFECTS) && (body[1] >= 1) && (body[1] <= PRESET_PARAMETERS) && (body[2] <= 100))
+		{
+			const control_command_t command = { .type = CONTROL_VALUE, .fx = body[0], .item = body[1], .value = body[2] };
+			ui_execute(&command, mode);
+		}
+		else
+		{
+			result = 254;
+		}
+		break;
+	case HOST_CONTROL:
+		if ((size == 7) && (body[0] <= CONTROL_PROFILER_RESET))
+		{
+			control_command_t command = { .type = body[0], .fx = body[1], .item = body[2], .value = get_u32(&body[3]) };
+			// a tap counts when it arrives, the clock of the host isn't the one of the tempo
+			if (command.type == CONTROL_TAP)
+				command.value = HAL_GetTick();
+			ui_execute(&command, mode);
+		}
+		else
+		{
+			result = 254;
+		}
+		break;
+	case HOST_PRESET:
+#if defined(CONTROL_M4)
+		// the presets are in the flash bank of the M4, which saves them
+		result = 255;
+#else
+		if ((size == (2 + PRESET_EFFECTS * PRESET_PARAMETERS)) && (body[0] < PRESET_SLOTS) && (body[1] < PRESET_EFFECTS))
+		{
+			preset_t preset;
+			preset_clear(&preset);
+			preset.mode = body[1];
+			memcpy(preset.value, &body[2], sizeof(preset.value));
+			// flash programming (and an erase now and then) blocks this pass, not the audio (see preset.h)
+			result = preset_save(body[0], &preset);
+		}
+		else
+		{
+			result = 254;
+		}
+#endif
+		break;
+	case HOST_IR_DATA:
+		{
+			const uint32_t samples = (size >= 2) ? (size - 2) / sizeof(float32_t) : 0;
+			const uint32_t offset = (size >= 2) ? get_u16(body) : 0;
+			if ((size >= 2) && (((size - 2) % sizeof(float32_t)) == 0) && ((offset + samples) <= CAB_MAX_TAPS))
+			{
+				memcpy(&ir_upload[offset], &body[2], samples * sizeof(float32_t));
+			}
+			else
+			{
+				result = 254;
+			}
+		}
+		break;
+	case HOST_IR_LOAD:
+		result = (size == 2) ? audio_load_cab(ir_upload, get_u16(body)) : 254;
+		break;
+	case HOST_STREAM:
+		if (size == 2)
+		{
+			const uint16_t period = get_u16(body);
+			stream_period = ((period == 0) || (period >= HOST_STREAM_MIN_PERIOD)) ? period : HOST_STREAM_MIN_PERIOD;
+			stream_tick = HAL_GetTick();
+		}
+		else
+		{
+			result = 254;
+		}
+		break;
+#if defined(CAPTURE)
+	case HOST_CAPTURE:
+		if ((size == 1) && (body[0] == HOST_CAPTURE_GET_INFO))
+		{
+			send_capture_info(sequence);
+			return;
+		}
+		if ((size == 1) && (body[0] == HOST_CAPTURE_ARM))
+			capture_arm();
+		else if ((size == 1) && (body[0] == HOST_CAPTURE_FREEZE))
+			capture_freeze();
+		else
+			result = 254;
+		break;
+	case HOST_CAPTURE_READ:
+		if (size == 4)
+		{
+			uint8_t answer[6 + HOST_CAPTURE_CHUNK] = { HOST_CAPTURE_DATA, sequence };
+			const uint32_t offset = get_u32(body);
+			put_u32(&answer[2], offset);
+			const uint32_t bytes = capture_read(offset, &answer[6], HOST_CAPTURE_CHUNK);
+			if (bytes)
+			{
+				send(answer, 6 + bytes);
+				return;
+			}
+			// not frozen, or behind the last record
+			result = 255;
+		}
+		else
+		{
+			result = 254;
+		}
+		break;
+#endif
+	default:
+		result = 255;
+		break;
+	}
+	acknowledge(type, sequence, result);
+}
+
+/******************************************************************************
+* Function Name: host_link_process
+*******************************************************************************
+* Summary:
+*  Control pass of the link: frame the received bytes, check and carry out up to
+*  HOST_FRAMES_PER_PASS requests, send the status when its period is over and hand the
+*  answers to the DMA. Call from the control pass (control task with RTOS) under the
+*  parameter lock, before the mode is switched over.
+*
+* Parameters:
+*  1. uint8_t *mode					- Pointer to the variable that's responsible for effect selection.
+* Return:
+*  None.
+*
+******************************************************************************/
+void host_link_process(uint8_t *mode)
+{
+	uint8_t byte;
+	uint8_t handled = 0;
+	while ((handled < HOST_FRAMES_PER_PASS) && host_rx_queue_get(&rx_queue, &byte))
+	{
+		if (byte != 0)
+		{
+			if (frame_length < HOST_MAX_FRAME)
+				frame[frame_length++] = byte;
+			else
+				too_long = true;
+			continue;
+		}
+		// delimiter: a frame is complete. decoded in place, type, sequence and the CRC at least
+		if (frame_length > 0)
+		{
+			const uint32_t length = too_long ? 0 : host_cobs_decode(frame, frame_length, frame);
+			if ((length >= 4) && (host_crc16(frame, length - 2) == get_u16(&frame[length - 2])))
+			{
+				handle(frame, length - 2, mode);
+				stats.frames++;
+				handled++;
+			}
+			else
+			{
+				stats.errors++;
+			}
+		}
+		frame_length = 0;
+		too_long = false;
+	}
+
+	if ((stream_period != 0) && ((HAL_GetTick() - stream_tick) >= stream_period))
+	{
+		stream_tick += stream_period;
+		// a pass that came late doesn't send the missed frames at once
+		if ((HAL_GetTick() - stream_tick) >= stream_period)
+			stream_tick = HAL_GetTick();
+		send_status(*mode);
+	}
+	flush();
+}
+
+/******************************************************************************
+* Function Name: host_link_receive
+*******************************************************************************
+* Summary:
+*  Producer side of the receive queue: queue received bytes for host_link_process. Called by the
+*  UART reception, bytes that find the queue full are counted and dropped.
+*
+* Parameters:
+*  1. const uint8_t *bytes			- Received bytes.
+*  2. uint32_t length				- Number of bytes.
+* Return:
+*  None.
+*
+******************************************************************************/
+void host_link_receive(const uint8_t *bytes, uint32_t length)
+{
+	const uint32_t queued = host_rx_queue_write(&rx_queue, bytes, length);
+	stats.rx_dropped += length - queued;
+}
+
+// half of the buffer, its end or an idle line: pos is where the DMA writes next (HAL_UARTEx_RxEventCallback)
+void host_link_rx_event(uint16_t pos)
+{
+	SCB_InvalidateDCache_by_Addr((uint32_t *)rx_buffer, HOST_RX_BUFFER_SIZE);
+	if (pos > rx_position)
+	{
+		host_link_receive(&rx_buffer[rx_position], pos - rx_position);
+	}
+	// the DMA wrapped around after the end of the buffer
+	rx_position = (pos >= HOST_RX_BUFFER_SIZE) ? 0 : pos;
+}
+
+// overrun or framing error, e.g. the host opened the port in the middle of a byte (HAL_UART_ErrorCallback). the frame
+// being received is lost with its CRC, the reception is started again if the HAL aborted it
+void host_link_error(void)
+{
+	if (huart_host.RxState == HAL_UART_STATE_READY)
+	{
+		start_reception();
+	}
+	if (huart_host.gState == HAL_UART_STATE_READY)
+	{
+		tx_busy = false;
+	}
+}
+
+const host_link_stats_t* host_link_stats(void)
+{
+	return &stats;
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	if (huart->Instance == HOST_LINK_UART)
+	{
+		tx_busy = false;
+	}
+}
+
+#if !defined(MIDI)
+// with MIDI, midi.c has these callbacks and passes USART3 on
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t pos)
+{
+	if (huart->Instance == HOST_LINK_UART)
+	{
+		host_link_rx_event(pos);
+	}
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	if (huart->Instance == HOST_LINK_UART)
+	{
+		host_link_error();
+	}
+}
+#endif
+
+#endif // HOST_LINK
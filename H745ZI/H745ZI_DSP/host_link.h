@@ -0,0 +1,118 @@
+// host_link.h, Michael Haselberger
+// Description: This file contains declarations for the binary host protocol implemented in host_link.c
+
+#ifndef __HOST_LINK_H__
+#define __HOST_LINK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+#include "ring_buffer_typed.h"
+
+// USART3 on PD8 (TX) and PD9 (RX): the virtual COM port of the ST-LINK, a USB CDC device on the host side
+#define HOST_LINK_UART (USART3)
+#define HOST_LINK_BAUD_RATE (921600)
+#define HOST_LINK_VERSION (5)
+// bytes of the circular receive DMA buffer. multiple of the cache line. 1 KB last 11 ms at the full rate
+#define HOST_RX_BUFFER_SIZE (1024)
+// received bytes waiting for the control pass. has to be a power of two (see RING_BUFFER_TYPED)
+#define HOST_RX_QUEUE_SIZE (2048)
+// frames handled per control pass, the rest waits in the queue for the next pass
+#define HOST_FRAMES_PER_PASS (32)
+// float samples of a cabinet response in one HOST_IR_DATA frame
+#define HOST_IR_CHUNK (64)
+// longest payload (type, sequence, body) without the CRC: a HOST_IR_DATA frame
+#define HOST_MAX_PAYLOAD (4 + HOST_IR_CHUNK * 4)
+// longest encoded frame without the delimiter: payload and CRC plus one COBS code byte per 254 bytes
+#define HOST_MAX_FRAME (HOST_MAX_PAYLOAD + 2 + (HOST_MAX_PAYLOAD + 2) / 254 + 1)
+// bytes of a transmit buffer. one is filled with frames while the DMA sends the other
+#define HOST_TX_BUFFER_SIZE (1024)
+// shortest period of the status stream in ms
+#define HOST_STREAM_MIN_PERIOD (10)
+// bytes of the capture ring in one HOST_CAPTURE_DATA frame
+#define HOST_CAPTURE_CHUNK (240)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Messages. A frame is the payload (type, sequence, body) followed by its CRC-16/CCITT-FALSE (little endian), COBS
+*   encoded and ended by a 0x00 byte. The sequence of a request is sent back with its answer. Values are little endian.
+*   fx and item are the menu index of the effect and its menu item (as with the presets), values the menu values 0 to 100.
+*   Python/host_link.py speaks the host side.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef enum
+{
+	// host to pedal
+	HOST_PING = 0x01,			// -> HOST_ACK with HOST_LINK_VERSION as result
+	HOST_GET = 0x02,			// fx, item -> HOST_VALUE
+	HOST_SET = 0x03,			// fx, item, value -> HOST_ACK. as if the value was confirmed in the menu
+	HOST_CONTROL = 0x04,		// control_type, fx, item, uint32_t value -> HOST_ACK. any command of the menu (control_link.h)
+	HOST_PRESET = 0x05,			// slot, mode, value[PRESET_EFFECTS][PRESET_PARAMETERS] -> HOST_ACK once it's in flash
+	HOST_IR_DATA = 0x06,		// uint16_t offset, up to HOST_IR_CHUNK float samples of a cabinet response -> HOST_ACK
+	HOST_IR_LOAD = 0x07,		// uint16_t length: the samples sent replace the cabinet response -> HOST_ACK
+	HOST_STREAM = 0x08,			// uint16_t period in ms, 0: off -> HOST_ACK, then HOST_STATUS every period
+	HOST_CAPTURE = 0x09,		// op (host_capture_op) -> HOST_CAPTURE_INFO or HOST_ACK
+	HOST_CAPTURE_READ = 0x0A,	// uint32_t offset -> HOST_CAPTURE_DATA, HOST_ACK 255 while the ring isn't frozen
+	// pedal to host
+	HOST_ACK = 0x80,			// type of the request, result: 0 or the error code of the function that carried it out
+	HOST_VALUE = 0x81,			// fx, item, value (PRESET_UNSET: never set, the effect has its init value)
+	HOST_STATUS = 0x82,			// see host_link_process
+	HOST_CAPTURE_INFO = 0x83,	// capture_info_t: state, reason, uint16_t block size, uint32_t sample rate, record bytes,
+								// records, trigger, budget (capture.h)
+	HOST_CAPTURE_DATA = 0x84	// uint32_t offset, up to HOST_CAPTURE_CHUNK bytes of the records from the offset on (capture_read)
+} host_message;
+
+// operations of HOST_CAPTURE
+typedef enum
+{
+	HOST_CAPTURE_GET_INFO = 0,	// -> HOST_CAPTURE_INFO
+	HOST_CAPTURE_ARM,			// empty the ring and record again -> HOST_ACK
+	HOST_CAPTURE_FREEZE			// freeze the ring now, as an event would -> HOST_ACK
+} host_capture_op;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Receive queue: a lock-free single-producer/single-consumer ring buffer (ring_buffer_typed.h) of the received bytes.
+*   The UART interrupt puts, the control pass (host_link_process) takes and frames them.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+RING_BUFFER_TYPED(host_rx_queue, uint8_t, HOST_RX_QUEUE_SIZE)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Counters of the link, for the host to tell a bad cable from a flooded link.
+*
+*   Members:
+*   frames:             Frames handled.
+*   errors:             Frames discarded: COBS error, wrong CRC, too long or too short.
+*   rx_dropped:         Received bytes lost to a full queue.
+*   tx_dropped:         Answers and status frames that didn't fit into the transmit buffer.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t frames;
+	uint32_t errors;
+	volatile uint32_t rx_dropped;
+	uint32_t tx_dropped;
+} host_link_stats_t;
+
+extern UART_HandleTypeDef huart_host;
+extern DMA_HandleTypeDef hdma_host_rx;
+extern DMA_HandleTypeDef hdma_host_tx;
+
+uint8_t host_link_init(void);
+void host_link_process(uint8_t *mode);
+void host_link_receive(const uint8_t *bytes, uint32_t length);
+void host_link_rx_event(uint16_t pos);
+void host_link_error(void);
+const host_link_stats_t* host_link_stats(void);
+uint32_t host_cobs_encode(const uint8_t *src, uint32_t length, uint8_t *dst);
+uint32_t host_cobs_decode(const uint8_t *src, uint32_t length, uint8_t *dst);
+uint16_t host_crc16(const uint8_t *data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __HOST_LINK_H__
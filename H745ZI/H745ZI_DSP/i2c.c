@@ -7,7 +7,8 @@ I2C_HandleTypeDef hi2c1;
 void MX_I2C1_Init(void)
 {
 	hi2c1.Instance = I2C1;
-	hi2c1.Init.Timing = 0x307075B1;
+	// 100 kHz from the 64 MHz HSI kernel clock, independent of the core clock profile (see rcc.c)
+	hi2c1.Init.Timing = 0x10707DBC;
 	hi2c1.Init.OwnAddress1 = 0;
 	hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
 	hi2c1.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
@@ -40,7 +41,7 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef *i2cHandle)
 	{
 		/** Initializes the peripherals clock */
 		PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_I2C1;
-		PeriphClkInitStruct.I2c123ClockSelection = RCC_I2C123CLKSOURCE_D2PCLK1;
+		PeriphClkInitStruct.I2c123ClockSelection = RCC_I2C123CLKSOURCE_HSI;
 		if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK)
 		{
 			Error_Handler();
@@ -58,6 +59,12 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef *i2cHandle)
 		HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
 		__HAL_RCC_I2C1_CLK_ENABLE();
+
+		// interrupt driven transfers of the LCD framebuffer. lowest priority, audio processing always comes first
+		HAL_NVIC_SetPriority(I2C1_EV_IRQn, 4, 0);
+		HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+		HAL_NVIC_SetPriority(I2C1_ER_IRQn, 4, 0);
+		HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
 	}
 }
 
@@ -68,6 +75,8 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef *i2cHandle)
 	{
 		/* Peripheral clock disable */
 		__HAL_RCC_I2C1_CLK_DISABLE();
+		HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+		HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
 		HAL_GPIO_DeInit(GPIOB, GPIO_PIN_6);
 		HAL_GPIO_DeInit(GPIOB, GPIO_PIN_7);
 	}
@@ -1,32 +1,85 @@
 #include "main.h"
+#include <string.h>
+
+// DISPLAY_TFT: the framebuffer functions are implemented by tft.c
+#if !defined(DISPLAY_TFT)
+
+// ---- Framebuffer ----
+// the menu only writes into frame. lcd_update compares it with shadow (what the display currently shows)
+// and transmits the changed characters in the background (interrupt driven I2C), so the CPU never waits for the bus
+static char frame[LCD_ROWS][LCD_COLS];
+static char shadow[LCD_ROWS][LCD_COLS];
+// PCF8574 output bytes of one update: per row one cursor command and up to LCD_COLS characters, 4 bytes each
+static uint8_t tx_queue[LCD_ROWS * (LCD_COLS + 1) * 4];
+static volatile uint8_t tx_busy = 0;
+// position of lcd_send_string in the framebuffer (lcd_put_cursor)
+static uint8_t cursor_row = 0;
+static uint8_t cursor_col = 0;
+
+// ---- Initialisation ----
+// HD44780 4 bit initialisation: every command with the time the controller needs before the next one. lcd_update
+// sends them one per call once the wait is over, the caller never waits (the audio starts before the display)
+#define LCD_POWER_UP_MS (50)
+static const struct
+{
+	char cmd;
+	uint8_t wait_ms;
+} init_sequence[] =
+{
+	{ 0x30, 5 },	// wait for >4.1ms
+	{ 0x30, 1 },	// wait for >100us
+	{ 0x30, 10 },
+	{ 0x20, 10 },	// 4bit mode
+	// dislay initialisation
+	{ 0x28, 1 },	// Function set --> DL=0 (4 bit mode), N = 1 (2 line display) F = 0 (5x8 characters)
+	{ 0x08, 1 },	// Display on/off control --> D=0,C=0, B=0  ---> display off
+	{ 0x01, 2 },	// clear display
+	{ 0x06, 1 },	// Entry mode set --> I/D = 1 (increment cursor) & S = 0 (no shift)
+	{ 0x0D, 0 },	// Display on/off control --> D = 1, C and B = 0. (Cursor and blink, last two bits)
+};
+#define LCD_INIT_STEPS (sizeof(init_sequence) / sizeof(init_sequence[0]))
+// next command of init_sequence, LCD_INIT_STEPS once the display is ready. 0xFF until lcd_init
+static uint8_t init_step = 0xFF;
+// tick of the last command (of lcd_init for the first) and the wait after it
+static uint32_t init_tick = 0;
+static uint32_t init_wait = 0;
 
 // PCF8574 LCD code taken and modified from
 // https://controllerstech.com/i2c-lcd-in-stm32/
 // (which in turn seems to be a port from arduino LiquidCrystal library)
+// starts the initialisation and returns, the commands follow with lcd_update. the framebuffer can be written
+// right away, it is transmitted once the display is ready
 void lcd_init(void)
 {
-	// 4 bit initialisation
-	HAL_Delay(50); // wait for >40ms
-	lcd_send_cmd(0x30);
-	HAL_Delay(5); // wait for >4.1ms
-	lcd_send_cmd(0x30);
-	HAL_Delay(1); // wait for >100us
-	lcd_send_cmd(0x30);
-	HAL_Delay(10);
-	lcd_send_cmd(0x20); // 4bit mode
-	HAL_Delay(10);
+	lcd_fb_clear();
+	init_step = 0;
+	init_tick = HAL_GetTick();
+	// wait for >40ms after power up
+	init_wait = LCD_POWER_UP_MS;
+}
 
-	// dislay initialisation
-	lcd_send_cmd(0x28); // Function set --> DL=0 (4 bit mode), N = 1 (2 line display) F = 0 (5x8 characters)
-	HAL_Delay(1);
-	lcd_send_cmd(0x08); //Display on/off control --> D=0,C=0, B=0  ---> display off
-	HAL_Delay(1);
-	lcd_send_cmd(0x01); // clear display
-	HAL_Delay(1);
-	HAL_Delay(1);
-	lcd_send_cmd(0x06); //Entry mode set --> I/D = 1 (increment cursor) & S = 0 (no shift)
-	HAL_Delay(1);
-	lcd_send_cmd(0x0D); //Display on/off control --> D = 1, C and B = 0. (Cursor and blink, last two bits)
+// send the next command of the initialisation if its wait is over. returns 1 once the display is ready
+uint8_t lcd_init_step(void)
+{
+	if (init_step >= LCD_INIT_STEPS)
+	{
+		return (init_step == LCD_INIT_STEPS) ? 1 : 0;
+	}
+	// more than the wait: the tick may advance right after the last command
+	const uint32_t now = HAL_GetTick();
+	if ((now - init_tick) > init_wait)
+	{
+		lcd_send_cmd(init_sequence[init_step].cmd);
+		init_wait = init_sequence[init_step].wait_ms;
+		init_tick = now;
+		if (++init_step == LCD_INIT_STEPS)
+		{
+			// display is cleared -> shadow is all spaces, the framebuffer goes out with the next update
+			memset(shadow, ' ', sizeof(shadow));
+			return 1;
+		}
+	}
+	return 0;
 }
 
 void lcd_send_cmd(char cmd)
@@ -55,32 +108,116 @@ void lcd_send_data(char data)
 	HAL_I2C_Master_Transmit(&hi2c1, DEVICE_ADDR, (uint8_t *)data_t, 4, 100);
 }
 
+// the cursor functions of the original blocking driver write into the framebuffer as well, so nothing that's shown
+// bypasses the shadow of lcd_update (which would send it again or overwrite it)
 void lcd_send_string(char *str)
 {
-	while (*str)
-		lcd_send_data(*str++);
+	lcd_fb_write(cursor_row, cursor_col, str);
+	const size_t length = strlen(str);
+	cursor_col = ((cursor_col + length) < LCD_COLS) ? (uint8_t)(cursor_col + length) : LCD_COLS;
 }
 
 void lcd_put_cursor(uint8_t row, uint8_t col)
 {
-	switch (row)
+	cursor_row = row;
+	cursor_col = col;
+}
+
+void lcd_clear(void)
+{
+	lcd_fb_clear();
+	lcd_put_cursor(0, 0);
+}
+
+// the PCF8574 output bytes of one command/character (two nibbles, each latched with a falling enable edge)
+static uint16_t queue_byte(uint16_t pos, char value, uint8_t rs)
+{
+	const uint8_t upper = value & 0xF0;
+	const uint8_t lower = (value << 4) & 0xF0;
+	tx_queue[pos++] = upper | 0x0C | rs; //en=1
+	tx_queue[pos++] = upper | 0x08 | rs; //en=0
+	tx_queue[pos++] = lower | 0x0C | rs; //en=1
+	tx_queue[pos++] = lower | 0x08 | rs; //en=0
+	return pos;
+}
+
+// fill framebuffer with spaces. nothing is transmitted, so this replaces lcd_clear (and the 1.5 ms clear command) in the menu
+void lcd_fb_clear(void)
+{
+	memset(frame, ' ', sizeof(frame));
+}
+
+// write a string into the framebuffer. stops at the end of the string or the end of the row
+void lcd_fb_write(uint8_t row, uint8_t col, const char *str)
+{
+	if (row >= LCD_ROWS)
+		return;
+
+	while (*str && (col < LCD_COLS))
 	{
-	case 0:
-		col |= 0x80;
-		break;
-	case 1:
-		col |= 0xC0;
-		break;
+		frame[row][col++] = *str++;
 	}
-	
-	lcd_send_cmd(col);
 }
 
-void lcd_clear(void)
+// transmit all characters that differ between framebuffer and display. every row with changes is sent as one
+// cursor command followed by the changed span. returns without doing anything while the previous update is
+// still on the bus, the next call picks up all changes made in the meantime. during the initialisation (lcd_init)
+// it sends the next init command instead
+void lcd_update(void)
 {
-	lcd_send_cmd(0x80);
-	for (int i = 0; i < 70; i++)
+	if (tx_busy || !lcd_init_step())
+		return;
+
+	uint16_t pos = 0;
+	for (uint8_t row = 0; row < LCD_ROWS; ++row)
+	{
+		uint8_t first = LCD_COLS;
+		uint8_t last = 0;
+		for (uint8_t col = 0; col < LCD_COLS; ++col)
+		{
+			if (frame[row][col] != shadow[row][col])
+			{
+				if (first == LCD_COLS)
+					first = col;
+				last = col;
+			}
+		}
+		if (first == LCD_COLS)
+			continue;
+
+		pos = queue_byte(pos, ((row == 0) ? LCD_SETDDRAMADDR : (LCD_SETDDRAMADDR | 0x40)) | first, 0);
+		for (uint8_t col = first; col <= last; ++col)
+		{
+			pos = queue_byte(pos, frame[row][col], 1);
+			shadow[row][col] = frame[row][col];
+		}
+	}
+
+	if (pos)
 	{
-		lcd_send_data(' ');
+		tx_busy = 1;
+		if (HAL_I2C_Master_Transmit_IT(&hi2c1, DEVICE_ADDR, tx_queue, pos) != HAL_OK)
+		{
+			tx_busy = 0;
+			// the display content is unknown now -> retransmit everything with the next update
+			memset(shadow, 0, sizeof(shadow));
+		}
 	}
-}
\ No newline at end of file
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == &hi2c1)
+		tx_busy = 0;
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == &hi2c1)
+	{
+		tx_busy = 0;
+		memset(shadow, 0, sizeof(shadow));
+	}
+}
+
+#endif // !DISPLAY_TFT
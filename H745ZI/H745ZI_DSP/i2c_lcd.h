@@ -59,18 +59,32 @@ extern "C" {
 /* Device I2C Address */
 #define DEVICE_ADDR (0x4E)
 
+/* Display size */
+#define LCD_ROWS 2
+#define LCD_COLS 16
+
 void lcd_init(void);
 
+uint8_t lcd_init_step(void);
+
 void lcd_send_cmd(char cmd);
 
 void lcd_send_data(char data);
 
+/* Write at the cursor into the framebuffer, as lcd_fb_write (nothing is transmitted) */
 void lcd_send_string(char *str);
 
 void lcd_put_cursor(uint8_t row, uint8_t col);
 
 void lcd_clear(void);
 
+/* Framebuffer (non-blocking). DISPLAY_TFT: lcd_init, lcd_init_step and these are implemented by tft.c */
+void lcd_fb_clear(void);
+
+void lcd_fb_write(uint8_t row, uint8_t col, const char *str);
+
+void lcd_update(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,338 @@
+// latency_probe.c, Michael Haselberger
+// Description: Round trip latency measurement through a loopback cable. While a measurement runs, the audio path sends
+// a probe signal instead of the chain output and captures the input (latency_probe_feed), the main loop finds the lag
+// of the signal in the capture (latency_probe_process): the time from a sample written into the transmit block to the
+// same sample read from the receive block, DMA ring and converters included.
+
+#include <stdio.h>
+#include <string.h>
+#include "stm32h7xx_hal.h"
+#include "latency_probe.h"
+
+#if defined(LATENCY_PROBE)
+
+typedef enum
+{
+	PROBE_IDLE = 0,
+	// the audio path sends the signal and fills the capture
+	PROBE_RUNNING,
+	// the capture is complete, the audio path sends silence until the main loop analyzed it
+	PROBE_CAPTURED
+} probe_state;
+
+// +-1 per sample, generated once by latency_probe_init
+static float32_t mls[LATENCY_MLS_LENGTH];
+static float32_t capture[LATENCY_CAPTURE];
+static latency_result_t results[LATENCY_SIZES][LATENCY_SIGNALS] = { 0 };
+static const latency_result_t *last = NULL;
+
+// measurement state. set up by the main loop while the audio path is idle, then owned by the audio path until captured
+static volatile uint8_t state = PROBE_IDLE;
+static uint8_t probe_signal = LATENCY_IMPULSE;
+static uint8_t size_index = 0;
+static uint16_t probe_size = 0;
+static uint32_t probe_rate = 0;
+static uint32_t position = 0;
+static uint32_t next_block = 0;
+static bool started = false;
+static bool lost = false;
+
+// results row of a block size, LATENCY_SIZES if it isn't one of the selectable sizes
+static uint8_t index_of(uint16_t block_size)
+{
+	for (uint8_t i = 0; i < LATENCY_SIZES; ++i)
+	{
+		if ((MIN_BLOCK_SIZE << i) == block_size)
+		{
+			return i;
+		}
+	}
+	return LATENCY_SIZES;
+}
+
+/******************************************************************************
+* Function Name: latency_probe_init
+*******************************************************************************
+* Summary:
+*  Generate the maximum length sequence: a 10 bit Fibonacci LFSR with the feedback polynomial
+*  x^10 + x^7 + 1 runs through all 1023 non-zero states, every output bit is a +-1 sample.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void latency_probe_init(void)
+{
+	uint32_t lfsr = 1;
+	for (uint32_t i = 0; i < LATENCY_MLS_LENGTH; ++i)
+	{
+		mls[i] = (lfsr & 1) ? 1.0f : -1.0f;
+		const uint32_t bit = (lfsr ^ (lfsr >> 3)) & 1;
+		lfsr = (lfsr >> 1) | (bit << (LATENCY_MLS_ORDER - 1));
+	}
+	state = PROBE_IDLE;
+}
+
+/******************************************************************************
+* Function Name: latency_probe_start
+*******************************************************************************
+* Summary:
+*  Start a measurement. From the next block on, the audio path sends LATENCY_PREROLL samples of
+*  silence, then the signal, and captures the input from the first sample of the signal on
+*  (see latency_probe_active). Call from the main loop.
+*
+* Parameters:
+*  1. latency_signal signal			- Impulse or maximum length sequence.
+*  2. uint16_t block_size			- Block size the audio path runs with.
+*  3. uint32_t rate					- Sample rate the audio path runs with.
+* Return:
+*  255:								- A measurement is running.
+*  254:								- Signal or block size is out of range.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t latency_probe_start(latency_signal signal, uint16_t block_size, uint32_t rate)
+{
+	if (state != PROBE_IDLE)
+	{
+		return 255;
+	}
+	if ((signal >= LATENCY_SIGNALS) || (index_of(block_size) == LATENCY_SIZES))
+	{
+		return 254;
+	}
+
+	// the audio path doesn't touch the state while idle
+	probe_signal = signal;
+	size_index = index_of(block_size);
+	probe_size = block_size;
+	probe_rate = rate;
+	position = 0;
+	started = false;
+	lost = false;
+	state = PROBE_RUNNING;
+	return 0;
+}
+
+// abandon a measurement, e.g. when the page is left. the audio path returns to the chain with its next block
+void latency_probe_stop(void)
+{
+	state = PROBE_IDLE;
+}
+
+// true while the audio path sends the probe instead of the chain output (latency_probe_feed)
+bool latency_probe_active(void)
+{
+	return (state != PROBE_IDLE) ? true : false;
+}
+
+/******************************************************************************
+* Function Name: latency_probe_feed
+*******************************************************************************
+* Summary:
+*  Write the next block of the probe into the output and capture the input, in place of the
+*  chain. A block number that doesn't follow the last one means a block was skipped: its
+*  transmit block still holds an older one, the capture is useless and ends at once. Once the
+*  capture is complete, silence is sent until the next measurement. Call from the audio path
+*  with the unprocessed input of the left channel.
+*
+* Parameters:
+*  1. const sample_t *src			- Input block.
+*  2. sample_t *dst					- Output block.
+*  3. uint32_t block				- Number of the block, incremented with every DMA block.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void latency_probe_feed(const sample_t *src, sample_t *dst, uint32_t block, uint32_t block_size)
+{
+	if ((state == PROBE_RUNNING) && started && (block != next_block))
+	{
+		lost = true;
+		state = PROBE_CAPTURED;
+	}
+	started = true;
+	next_block = block + 1;
+	if (state != PROBE_RUNNING)
+	{
+		memset(dst, 0, block_size * sizeof(sample_t));
+		return;
+	}
+
+#if defined(SAMPLE_Q31)
+	const float32_t in_scale = 1.0f / 2147483648.0f;
+	const float32_t out_scale = 2147483648.0f;
+#else
+	const float32_t in_scale = 1.0f;
+	const float32_t out_scale = 1.0f;
+#endif
+	const uint32_t length = (probe_signal == LATENCY_MLS) ? LATENCY_MLS_LENGTH : 1;
+
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		float32_t out = 0.0f;
+		if (position >= LATENCY_PREROLL)
+		{
+			const uint32_t k = position - LATENCY_PREROLL;
+			if (k < length)
+			{
+				out = (probe_signal == LATENCY_MLS) ? LATENCY_MLS_LEVEL * mls[k] : LATENCY_IMPULSE_LEVEL;
+			}
+			if (k < LATENCY_CAPTURE)
+			{
+				capture[k] = (float32_t)src[i] * in_scale;
+			}
+		}
+		dst[i] = (sample_t)(out * out_scale);
+		position++;
+	}
+	if (position >= (LATENCY_PREROLL + LATENCY_CAPTURE))
+	{
+		state = PROBE_CAPTURED;
+	}
+}
+
+/******************************************************************************
+* Function Name: latency_probe_process
+*******************************************************************************
+* Summary:
+*  Analyze a complete capture, if there is one. Call from the main loop. The correlation of
+*  the capture with the signal is computed for every lag up to LATENCY_MAX_LAG (one dot
+*  product of LATENCY_MLS_LENGTH per lag for the sequence, the capture itself for the impulse),
+*  the lag of its largest magnitude is the round trip. The result is stored for the block size
+*  and the signal of the measurement, the probe is idle again.
+*
+* Parameters:
+*  None.
+* Return:
+*  1:								- A new result is available (see latency_probe_last).
+*  0:								- No capture was complete.
+*
+******************************************************************************/
+uint8_t latency_probe_process(void)
+{
+	if (state != PROBE_CAPTURED)
+	{
+		return 0;
+	}
+
+	latency_result_t *r = &results[size_index][probe_signal];
+	r->signal = probe_signal;
+	r->block_size = probe_size;
+	r->sample_rate = probe_rate;
+	r->samples = 0;
+	r->microseconds = 0;
+	r->inverted = false;
+	r->ratio = 0.0f;
+	r->sequence = (last != NULL) ? last->sequence + 1 : 1;
+	last = r;
+
+	if (lost)
+	{
+		r->status = LATENCY_LOST;
+		state = PROBE_IDLE;
+		return 1;
+	}
+
+	const uint32_t length = (probe_signal == LATENCY_MLS) ? LATENCY_MLS_LENGTH : 1;
+	float32_t peak = 0.0f;
+	float32_t power = 0.0f;
+	uint32_t lag = 0;
+	for (uint32_t l = 0; l <= LATENCY_MAX_LAG; ++l)
+	{
+		float32_t c = capture[l];
+		if (probe_signal == LATENCY_MLS)
+		{
+			arm_dot_prod_f32(&capture[l], mls, length, &c);
+		}
+		power += c * c;
+		if (fabsf(c) > fabsf(peak))
+		{
+			peak = c;
+			lag = l;
+		}
+	}
+	// the audio path may start over with the capture now
+	state = PROBE_IDLE;
+
+	const float32_t rms = sqrtf(power / (LATENCY_MAX_LAG + 1));
+	r->ratio = (rms > 0.0f) ? fabsf(peak) / rms : 0.0f;
+	if (r->ratio < LATENCY_MIN_RATIO)
+	{
+		r->status = LATENCY_NO_SIGNAL;
+		return 1;
+	}
+	r->status = LATENCY_OK;
+	r->inverted = (peak < 0.0f) ? true : false;
+	r->samples = lag;
+	r->microseconds = (uint32_t)(((uint64_t)lag * 1000000 + probe_rate / 2) / probe_rate);
+	return 1;
+}
+
+// result of a block size and signal, NULL for a block size that isn't selectable
+const latency_result_t* latency_probe_result(uint16_t block_size, latency_signal signal)
+{
+	const uint8_t i = index_of(block_size);
+	if ((i == LATENCY_SIZES) || (signal >= LATENCY_SIGNALS))
+	{
+		return NULL;
+	}
+	return &results[i][signal];
+}
+
+// result of the measurement analyzed last, NULL before the first one
+const latency_result_t* latency_probe_last(void)
+{
+	return last;
+}
+
+/******************************************************************************
+* Function Name: latency_probe_report
+*******************************************************************************
+* Summary:
+*  Print the last result over SWO: block size, signal, round trip in samples and us, split
+*  into the DMA ring (DMA_BLOCKS blocks) and what the converters and the cable add.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void latency_probe_report(void)
+{
+	static const char *const names[LATENCY_SIGNALS] = { "impulse", "mls" };
+	char line[128];
+
+	if (last == NULL)
+	{
+		return;
+	}
+	int pos = snprintf(line, sizeof(line), "latency n=%u %lu Hz %s: ", (unsigned)last->block_size,
+		(unsigned long)last->sample_rate, names[last->signal]);
+	const uint32_t ring = DMA_BLOCKS * last->block_size;
+	const uint32_t ratio = (uint32_t)last->ratio;
+	if (last->status == LATENCY_OK)
+	{
+		snprintf(&line[pos], sizeof(line) - pos, "%lu samples %lu us, dma %lu + converters %ld, ratio %lu%s\r\n",
+			(unsigned long)last->samples, (unsigned long)last->microseconds, (unsigned long)ring,
+			(long)last->samples - (long)ring, (unsigned long)ratio, last->inverted ? ", inverted" : "");
+	}
+	else
+	{
+		snprintf(&line[pos], sizeof(line) - pos, "%s, ratio %lu\r\n",
+			(last->status == LATENCY_LOST) ? "block lost" : "no signal", (unsigned long)ratio);
+	}
+
+	// ITM stimulus port 0, returns immediately if no debugger enabled the ITM
+	for (const char *c = line; *c; ++c)
+	{
+		ITM_SendChar(*c);
+	}
+}
+
+#endif // LATENCY_PROBE
@@ -0,0 +1,98 @@
+// latency_probe.h, Michael Haselberger
+// Description: This file contains declarations for the round trip latency measurement implemented in latency_probe.c
+
+#ifndef __LATENCY_PROBE_H__
+#define __LATENCY_PROBE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// maximum length sequence of 2^10 - 1 samples (21 ms at 48 kHz): the correlation peak stands 30 dB above its sidelobes
+#define LATENCY_MLS_ORDER (10)
+#define LATENCY_MLS_LENGTH ((1 << LATENCY_MLS_ORDER) - 1)
+// longest round trip searched: the DMA ring at the biggest block plus the converters (the decimation and interpolation
+// filters of sigma-delta codecs are a few dozen samples)
+#define LATENCY_MAX_CONVERTER (256)
+#define LATENCY_MAX_LAG (DMA_BLOCKS * MAX_BLOCK_SIZE + LATENCY_MAX_CONVERTER)
+// samples captured from the first sample of the signal on: the sequence at the longest lag
+#define LATENCY_CAPTURE (LATENCY_MLS_LENGTH + LATENCY_MAX_LAG)
+// silence sent before the signal. whatever the DMA ring and the converters held before the measurement (the signal of
+// the one before, at another block size) has come back before the capture starts
+#define LATENCY_PREROLL (LATENCY_MAX_LAG)
+// levels of the signals: a full impulse would be clipped by some codec filters, the sequence carries its energy in length
+#define LATENCY_IMPULSE_LEVEL (0.5f)
+#define LATENCY_MLS_LEVEL (0.25f)
+// the correlation peak has to stand this far above the RMS of all lags, otherwise nothing came back (no cable)
+#define LATENCY_MIN_RATIO (8.0f)
+// block sizes from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE, every one has its results
+#define LATENCY_SIZES (5)
+
+_Static_assert((MIN_BLOCK_SIZE << (LATENCY_SIZES - 1)) == MAX_BLOCK_SIZE, "LATENCY_SIZES has to cover MIN_BLOCK_SIZE to MAX_BLOCK_SIZE");
+
+typedef enum
+{
+	// one sample: the peak is read from the capture directly
+	LATENCY_IMPULSE = 0,
+	// maximum length sequence: cross-correlated with the capture, robust against noise and hum on the cable
+	LATENCY_MLS,
+	LATENCY_SIGNALS
+} latency_signal;
+
+typedef enum
+{
+	LATENCY_NOT_MEASURED = 0,
+	LATENCY_OK,
+	// no correlation peak: no cable, or the level didn't make it back
+	LATENCY_NO_SIGNAL,
+	// a block was skipped (overrun) while the signal was running, the capture has a gap
+	LATENCY_LOST
+} latency_status;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Result of a measurement, written by latency_probe_process and read by the menu.
+*
+*   Members:
+*   status:             latency_status.
+*   signal:             latency_signal the measurement used.
+*   inverted:           The signal came back with inverted polarity.
+*   block_size:         Samples per channel and block the audio path ran with.
+*   sample_rate:        Sample rate in Hz.
+*   samples:            Round trip from the block written to the block read: DMA_BLOCKS * block_size plus the
+*                       converters and the cable.
+*   microseconds:       The same in us.
+*   ratio:              Correlation peak over the RMS of all lags.
+*   sequence:           Incremented with every result of every block size.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t status;
+	uint8_t signal;
+	bool inverted;
+	uint16_t block_size;
+	uint32_t sample_rate;
+	uint32_t samples;
+	uint32_t microseconds;
+	float32_t ratio;
+	uint32_t sequence;
+} latency_result_t;
+
+void latency_probe_init(void);
+uint8_t latency_probe_start(latency_signal signal, uint16_t block_size, uint32_t rate);
+void latency_probe_stop(void);
+bool latency_probe_active(void);
+void latency_probe_feed(const sample_t *src, sample_t *dst, uint32_t block, uint32_t block_size);
+uint8_t latency_probe_process(void);
+const latency_result_t* latency_probe_result(uint16_t block_size, latency_signal signal);
+const latency_result_t* latency_probe_last(void);
+void latency_probe_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __LATENCY_PROBE_H__
@@ -0,0 +1,397 @@
+// library.c, Michael Haselberger
+// Description: Impulse response and preset library with a streaming loader. The library file holds the reverb responses
+// already transformed (spectra in the layout of nu_convolver_image_t), the cabinet responses, presets and amp models.
+// Entries are read in chunks from the main loop straight into the convolver, a cabinet bank or a model, so loading
+// one never adds FFTs or long stalls, and the audio path (PendSV) keeps running in between.
+
+#include <string.h>
+#include "library.h"
+
+// header of the library file: magic, version, number of entries, reserved
+#define LIBRARY_HEADER_SIZE (4 * sizeof(uint32_t))
+// header of a LIBRARY_REVERB payload: partition size, length, body partitions, tail partitions
+#define LIBRARY_REVERB_HEADER (3 + NU_CONVOLVER_TAIL_STAGES)
+#define LIBRARY_PRESET_SIZE (1 + PRESET_EFFECTS * PRESET_PARAMETERS)
+
+// partition size of the tail stages, in the order of nu_convolver_t.tail. the library images are laid out for schedule 0
+static const uint32_t tail_sizes[NU_CONVOLVER_TAIL_STAGES] = { NU_CONVOLVER_TAIL0_SIZE, NU_CONVOLVER_TAIL1_SIZE };
+
+// library_read_t of library_open_memory
+static uint8_t memory_read(void *context, uint32_t offset, void *dst, uint32_t size)
+{
+	const library_t *lib = context;
+	if ((offset > lib->size) || (size > lib->size - offset))
+	{
+		return 253;
+	}
+	memcpy(dst, &lib->memory[offset], size);
+	return 0;
+}
+
+// directory entry at index, NULL if there is none or it is of another kind
+static const library_entry_t* entry_of(const library_t *lib, uint8_t index, library_kind kind)
+{
+	if ((index >= lib->count) || (lib->entries[index].kind != (uint32_t)kind))
+	{
+		return NULL;
+	}
+	return &lib->entries[index];
+}
+
+/******************************************************************************
+* Function Name: library_open
+*******************************************************************************
+* Summary:
+*  Open a library file on any storage: check the header and read the directory.
+*
+* Parameters:
+*  1. library_t *lib				- Address pointer of the library struct.
+*  2. library_read_t read			- Read function of the storage.
+*  3. void *context					- Passed to read.
+* Return:
+*  255:								- Library or read function point to NULL.
+*  254:								- Not a library file, another version or too many entries.
+*  253:								- Read error.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t library_open(library_t *lib, library_read_t read, void *context)
+{
+	if ((lib == NULL) || (read == NULL))
+	{
+		return 255;
+	}
+	lib->read = read;
+	lib->context = context;
+	lib->count = 0;
+
+	uint32_t header[LIBRARY_HEADER_SIZE / sizeof(uint32_t)];
+	if (read(context, 0, header, sizeof(header)))
+	{
+		return 253;
+	}
+	if ((header[0] != LIBRARY_MAGIC) || (header[1] != LIBRARY_VERSION) || (header[2] > LIBRARY_MAX_ENTRIES))
+	{
+		return 254;
+	}
+	if (read(context, LIBRARY_HEADER_SIZE, lib->entries, header[2] * sizeof(library_entry_t)))
+	{
+		return 253;
+	}
+	lib->count = header[2];
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: library_open_memory
+*******************************************************************************
+* Summary:
+*  Open a library image that is memory-mapped (internal flash, QSPI).
+*
+* Parameters:
+*  1. library_t *lib				- Address pointer of the library struct.
+*  2. const uint8_t *image			- Start of the library file.
+*  3. uint32_t size					- Bytes of the file.
+* Return:
+*  255:								- Image points to NULL.
+*  See library_open otherwise.
+*
+******************************************************************************/
+uint8_t library_open_memory(library_t *lib, const uint8_t *image, uint32_t size)
+{
+	if ((lib == NULL) || (image == NULL))
+	{
+		return 255;
+	}
+	lib->memory = image;
+	lib->size = size;
+	return library_open(lib, memory_read, lib);
+}
+
+/******************************************************************************
+* Function Name: library_find
+*******************************************************************************
+* Summary:
+*  Directory index of the n-th entry of a kind, e.g. to browse the cabinet responses.
+*
+* Parameters:
+*  1. const library_t *lib			- Address pointer of an opened library.
+*  2. library_kind kind				- Kind of entry.
+*  3. uint8_t n						- Number of the entry among the ones of this kind, from 0.
+* Return:
+*  Directory index, -1 if there are n or less entries of this kind.
+*
+******************************************************************************/
+int16_t library_find(const library_t *lib, library_kind kind, uint8_t n)
+{
+	for (uint32_t i = 0; i < lib->count; ++i)
+	{
+		if ((lib->entries[i].kind == (uint32_t)kind) && (n-- == 0))
+		{
+			return (int16_t)i;
+		}
+	}
+	return -1;
+}
+
+/******************************************************************************
+* Function Name: library_read_preset
+*******************************************************************************
+* Summary:
+*  Read a preset of the library. Short, read at once. Apply it like a stored preset.
+*
+* Parameters:
+*  1. library_t *lib				- Address pointer of an opened library.
+*  2. uint8_t index					- Directory index of a LIBRARY_PRESET entry.
+*  3. preset_t *preset				- Returns the preset.
+* Return:
+*  254:								- No preset entry, or written for another number of effects or parameters.
+*  253:								- Read error.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t library_read_preset(library_t *lib, uint8_t index, preset_t *preset)
+{
+	const library_entry_t *entry = entry_of(lib, index, LIBRARY_PRESET);
+	if ((entry == NULL) || (entry->size != LIBRARY_PRESET_SIZE))
+	{
+		return 254;
+	}
+	uint8_t data[LIBRARY_PRESET_SIZE];
+	if (lib->read(lib->context, entry->offset, data, sizeof(data)))
+	{
+		return 253;
+	}
+	preset_clear(preset);
+	preset->mode = data[0];
+	memcpy(preset->value, &data[1], sizeof(preset->value));
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: library_load_reverb
+*******************************************************************************
+* Summary:
+*  Start streaming a reverb response into a convolver (see nu_convolver_prepare_image). The
+*  spectra are read by library_loader_step, the convolver is reset after the last chunk. The
+*  convolver must not be processed until then: bypass the reverb node (fx_chain_set_bypass) and
+*  wait until its tail stopped ringing (fx_node_t.ringing), or load while the reverb isn't in
+*  the chain.
+*
+* Parameters:
+*  1. library_loader_t *loader		- Address pointer of the loader struct.
+*  2. library_t *lib				- Address pointer of an opened library.
+*  3. uint8_t index					- Directory index of a LIBRARY_REVERB entry.
+*  4. nu_convolver_t *conv			- Initialized convolver (memory of an activated reverb).
+* Return:
+*  254:								- No reverb entry, its rate isn't the running sample rate, the payload is
+*									  damaged, or see nu_convolver_prepare_image.
+*  253:								- Read error.
+*    0:								- Success, call library_loader_step until it returns 0.
+*
+******************************************************************************/
+uint8_t library_load_reverb(library_loader_t *loader, library_t *lib, uint8_t index, nu_convolver_t *conv)
+{
+	const library_entry_t *entry = entry_of(lib, index, LIBRARY_REVERB);
+	if ((entry == NULL) || (entry->rate != sample_rate) || (entry->size < LIBRARY_REVERB_HEADER * sizeof(uint32_t)))
+	{
+		return 254;
+	}
+	uint32_t header[LIBRARY_REVERB_HEADER];
+	if (lib->read(lib->context, entry->offset, header, sizeof(header)))
+	{
+		return 253;
+	}
+
+	nu_convolver_image_t shape = { 0 };
+	shape.partition_size = header[0];
+	shape.ir_length = header[1];
+	shape.body_partitions = header[2];
+	uint32_t floats = CONVOLVER_PARTITION_SIZE + shape.body_partitions * CONVOLVER_FFT_SIZE;
+	for (uint32_t i = 0; i < NU_CONVOLVER_TAIL_STAGES; ++i)
+	{
+		shape.tail_partitions[i] = header[3 + i];
+		floats += shape.tail_partitions[i] * (tail_sizes[i] << 1);
+	}
+	// checked before the convolver takes over the partition counts
+	if (entry->size != sizeof(header) + floats * sizeof(float32_t))
+	{
+		return 254;
+	}
+	const uint8_t status = nu_convolver_prepare_image(conv, &shape, loader->dst, loader->remaining);
+	if (status)
+	{
+		return status;
+	}
+
+	loader->library = lib;
+	loader->offset = entry->offset + sizeof(header);
+	loader->region = 0;
+	loader->regions = NU_CONVOLVER_IMAGE_REGIONS;
+	loader->conv = conv;
+	loader->model = NULL;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: library_load_cab
+*******************************************************************************
+* Summary:
+*  Start streaming a cabinet response into a bank. Use two banks: load into the one the
+*  cabinet doesn't use, then pass it to cab_init once library_loader_step returned 0, so the
+*  running response is never overwritten.
+*
+* Parameters:
+*  1. library_loader_t *loader		- Address pointer of the loader struct.
+*  2. library_t *lib				- Address pointer of an opened library.
+*  3. uint8_t index					- Directory index of a LIBRARY_CAB entry.
+*  4. float32_t *bank				- Memory for max_taps samples, outside the DTCM if the read function uses DMA.
+*  5. uint32_t max_taps				- Size of the bank (CAB_MAX_TAPS).
+*  6. uint32_t *taps				- Returns the number of samples of the response.
+* Return:
+*  254:								- No cabinet entry, its rate isn't the running sample rate, or it is empty
+*									  or longer than max_taps.
+*    0:								- Success, call library_loader_step until it returns 0.
+*
+******************************************************************************/
+uint8_t library_load_cab(library_loader_t *loader, library_t *lib, uint8_t index, float32_t *bank, uint32_t max_taps, uint32_t *taps)
+{
+	const library_entry_t *entry = entry_of(lib, index, LIBRARY_CAB);
+	if ((entry == NULL) || (bank == NULL) || (entry->rate != sample_rate))
+	{
+		return 254;
+	}
+	const uint32_t length = entry->size / sizeof(float32_t);
+	if ((length == 0) || (length > max_taps))
+	{
+		return 254;
+	}
+
+	loader->library = lib;
+	loader->offset = entry->offset;
+	loader->region = 0;
+	loader->regions = 1;
+	loader->dst[0] = bank;
+	loader->remaining[0] = length;
+	loader->conv = NULL;
+	loader->model = NULL;
+	*taps = length;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: library_load_amp
+*******************************************************************************
+* Summary:
+*  Start streaming an amp model into a model struct. It is prepared (amp_model_prepare) after
+*  the last chunk, then hand it to the amp with amp_load. Load into a model the audio path
+*  doesn't run, not into the one in DTCM (outside the DTCM anyway if the read function uses DMA).
+*
+* Parameters:
+*  1. library_loader_t *loader		- Address pointer of the loader struct.
+*  2. library_t *lib				- Address pointer of an opened library.
+*  3. uint8_t index					- Directory index of a LIBRARY_AMP entry.
+*  4. amp_model_t *model			- Model struct the weights are read into.
+* Return:
+*  254:								- No amp model entry, its rate isn't the running sample rate, the engine
+*									  doesn't run this size (amp_model_check) or the payload is damaged.
+*  253:								- Read error.
+*    0:								- Success, call library_loader_step until it returns 0.
+*
+******************************************************************************/
+uint8_t library_load_amp(library_loader_t *loader, library_t *lib, uint8_t index, amp_model_t *model)
+{
+	const library_entry_t *entry = entry_of(lib, index, LIBRARY_AMP);
+	if ((entry == NULL) || (model == NULL) || (entry->rate != sample_rate) || (entry->size < AMP_MODEL_HEADER * sizeof(uint32_t)))
+	{
+		return 254;
+	}
+	uint32_t header[AMP_MODEL_HEADER];
+	if (lib->read(lib->context, entry->offset, header, sizeof(header)))
+	{
+		return 253;
+	}
+	if (amp_model_check(header[0], header[1], header[2], header[3]))
+	{
+		return 254;
+	}
+	const uint32_t floats = amp_model_weights(header[0], header[1], header[3]);
+	if (entry->size != sizeof(header) + floats * sizeof(float32_t))
+	{
+		return 254;
+	}
+	model->cell = header[0];
+	model->hidden = header[1];
+	model->skip = header[2];
+	model->post_stages = header[3];
+	loader->library = lib;
+	loader->offset = entry->offset + sizeof(header);
+	loader->region = 0;
+	loader->regions = 1;
+	loader->dst[0] = model->weights;
+	loader->remaining[0] = floats;
+	loader->conv = NULL;
+	loader->model = model;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: library_loader_step
+*******************************************************************************
+* Summary:
+*  Read the next chunk (at most LIBRARY_CHUNK_SIZE bytes) of the entry being loaded. Call once
+*  per main loop pass, so the menu and the LCD stay responsive while a long response loads.
+*
+* Parameters:
+*  1. library_loader_t *loader		- Address pointer of a started loader struct.
+* Return:
+*  253:								- Read error, the load is aborted (the destination is incomplete, an amp
+*									  model is cleared).
+*    1:								- More chunks to read.
+*    0:								- Complete (or nothing to load).
+*
+******************************************************************************/
+uint8_t library_loader_step(library_loader_t *loader)
+{
+	while ((loader->region < loader->regions) && (loader->remaining[loader->region] == 0))
+	{
+		loader->region++;
+	}
+	if (loader->region >= loader->regions)
+	{
+		if (loader->conv != NULL)
+		{
+			nu_convolver_reset(loader->conv);
+			loader->conv = NULL;
+		}
+		if (loader->model != NULL)
+		{
+			amp_model_prepare(loader->model);
+			loader->model = NULL;
+		}
+		return 0;
+	}
+
+	const uint8_t r = loader->region;
+	uint32_t floats = LIBRARY_CHUNK_SIZE / sizeof(float32_t);
+	if (floats > loader->remaining[r])
+	{
+		floats = loader->remaining[r];
+	}
+	if (loader->library->read(loader->library->context, loader->offset, loader->dst[r], floats * sizeof(float32_t)))
+	{
+		loader->regions = 0;
+		loader->conv = NULL;
+		// no half loaded model: it runs as none
+		if (loader->model != NULL)
+		{
+			amp_model_clear(loader->model);
+			loader->model = NULL;
+		}
+		return 253;
+	}
+	loader->dst[r] += floats;
+	loader->remaining[r] -= floats;
+	loader->offset += floats * sizeof(float32_t);
+	return 1;
+}
@@ -0,0 +1,128 @@
+// library.h, Michael Haselberger
+// Description: This file contains declarations for the impulse response and preset library implemented in library.c
+
+#ifndef __LIBRARY_H__
+#define __LIBRARY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+#include "convolver.h"
+#include "preset.h"
+#include "amp_model.h"
+
+// library file (dsp_helpers.export_library): header, directory, payloads. all values little endian
+#define LIBRARY_MAGIC (0x424C5249UL)	// "IRLB"
+#define LIBRARY_VERSION (1)
+#define LIBRARY_MAX_ENTRIES (64)
+#define LIBRARY_NAME_SIZE (16)
+// library image of the pedal (library_open_memory): sectors 2 to 5 of flash bank 2, between the M4 image and the presets
+// (STM32H745ZITx_FLASH_CM4.ld). the file of dsp_helpers.export_library, programmed on its own at this address
+#define LIBRARY_IMAGE_BASE (0x08140000UL)
+#define LIBRARY_IMAGE_SIZE (0x80000UL)
+// bytes read per library_loader_step. bounds the time one main loop pass spends in the loader
+#define LIBRARY_CHUNK_SIZE (8 * 1024)
+
+typedef enum
+{
+	// reverb response transformed ahead of time: uint32_t partition_size, ir_length, body_partitions,
+	// tail_partitions[NU_CONVOLVER_TAIL_STAGES], then the floats of head, body and tail stages (nu_convolver_image_t)
+	LIBRARY_REVERB = 0,
+	// cabinet response: float samples
+	LIBRARY_CAB,
+	// preset: mode, then value[PRESET_EFFECTS][PRESET_PARAMETERS] (preset_t without the padding)
+	LIBRARY_PRESET,
+	// captured amp model: uint32_t cell, hidden, skip, post_stages, then the floats of amp_model_t.weights
+	LIBRARY_AMP
+} library_kind;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Directory entry of the library file, 32 bytes.
+*
+*   Members:
+*   name:               Name shown in the menu, zero terminated if shorter than LIBRARY_NAME_SIZE.
+*   kind:               library_kind.
+*   rate:               Sample rate of an impulse response or an amp model in Hz, 0 for presets.
+*   size:               Bytes of the payload.
+*   offset:             Position of the payload in the file.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	char name[LIBRARY_NAME_SIZE];
+	uint32_t kind;
+	uint32_t rate;
+	uint32_t size;
+	uint32_t offset;
+} library_entry_t;
+
+// reads size bytes at offset of the library file into dst. 0 on success
+typedef uint8_t (*library_read_t)(void *context, uint32_t offset, void *dst, uint32_t size);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Impulse response and preset library. Sixty spring and cabinet responses don't fit into the flash of the M7, so they
+*   are read from a library file: memory-mapped (library_open_memory, e.g. a second image in flash bank 2) or from any
+*   other storage through a read function (library_open). The directory is read once and kept. Everything runs in the main loop, which the audio path (PendSV)
+*   preempts, so reading never delays a block. Main loop only.
+*
+*   Members:
+*   read, context:      Read function of the storage and its context.
+*   count:              Number of directory entries.
+*   entries:            Directory.
+*   memory, size:       Library image of library_open_memory.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	library_read_t read;
+	void *context;
+	uint32_t count;
+	library_entry_t entries[LIBRARY_MAX_ENTRIES];
+	const uint8_t *memory;
+	uint32_t size;
+} library_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Streaming load of one entry. The payload is read in chunks of LIBRARY_CHUNK_SIZE, one chunk per library_loader_step,
+*   straight into its destination: the spectra memory of a convolver (no FFT, the spectra were computed ahead of time),
+*   the bank of a cabinet response or the weights of an amp model. A read function that reads by DMA needs destinations
+*   outside the DTCM.
+*
+*   Members:
+*   library:            Library the entry is read from.
+*   offset:             File position of the next chunk.
+*   region, regions:    Destination written now, number of destinations.
+*   dst, remaining:     Next float and floats left of every destination.
+*   conv:               Convolver reset when the load is complete. NULL for other destinations.
+*   model:              Amp model prepared when the load is complete. NULL for other destinations.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	library_t *library;
+	uint32_t offset;
+	uint8_t region;
+	uint8_t regions;
+	float32_t *dst[NU_CONVOLVER_IMAGE_REGIONS];
+	uint32_t remaining[NU_CONVOLVER_IMAGE_REGIONS];
+	nu_convolver_t *conv;
+	amp_model_t *model;
+} library_loader_t;
+
+uint8_t library_open(library_t *lib, library_read_t read, void *context);
+uint8_t library_open_memory(library_t *lib, const uint8_t *image, uint32_t size);
+int16_t library_find(const library_t *lib, library_kind kind, uint8_t n);
+uint8_t library_read_preset(library_t *lib, uint8_t index, preset_t *preset);
+uint8_t library_load_reverb(library_loader_t *loader, library_t *lib, uint8_t index, nu_convolver_t *conv);
+uint8_t library_load_cab(library_loader_t *loader, library_t *lib, uint8_t index, float32_t *bank, uint32_t max_taps, uint32_t *taps);
+uint8_t library_load_amp(library_loader_t *loader, library_t *lib, uint8_t index, amp_model_t *model);
+uint8_t library_loader_step(library_loader_t *loader);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __LIBRARY_H__
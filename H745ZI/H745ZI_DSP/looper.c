@@ -0,0 +1,689 @@
+// looper.c, Michael Haselberger
+// Description: Looper with its loop memory outside of the chip. 30 s per channel don't fit into any internal RAM
+// (2.9 MB as q15), so the loops live in external memory and the MDMA stages them block by block through DTCM.
+// The external memory has to be memory-mapped (FMC SDRAM bank or OctoSPI memory-mapped mode) before looper_init,
+// its controller setup is board specific and not part of this project (the NUCLEO-H745ZI has no external RAM).
+// LOOPER_ADPCM: the loops are stored as IMA-ADPCM in the free internal SRAM instead, which this board does have.
+
+#include <string.h>
+#include "looper.h"
+#include "arena.h"
+
+#if defined(LOOPER) && !defined(LOOPER_ADPCM)
+
+// loop memory of all channels. NOLOAD section in the external memory region (STM32H745ZITx_FLASH_CM7.ld)
+static q15_t __attribute__((aligned(32))) RAM_SECTION(".loop_buffer") loop_memory[AUDIO_CHANNELS][LOOPER_MAX_SAMPLES];
+
+// MDMA channels of every audio channel: fetch, store. channels 0 and 1 stage the codec data (MDMA_TRANSFER)
+static MDMA_Channel_TypeDef *const mdma_channels[2][2] = { { MDMA_Channel2, MDMA_Channel3 }, { MDMA_Channel4, MDMA_Channel5 } };
+
+#define NOT_FETCHED (0xFFFFFFFFu)
+// polls of the first fetch after the looper starts playing, then it counts as a miss
+#define FETCH_SPIN_LIMIT (10000)
+
+// memory to memory block transfer. 32 byte bursts on both sides, the external memory controller handles them best
+static uint8_t mdma_config(MDMA_HandleTypeDef *hmdma, MDMA_Channel_TypeDef *channel)
+{
+	hmdma->Instance = channel;
+	hmdma->Init.Request = MDMA_REQUEST_SW;
+	hmdma->Init.TransferTriggerMode = MDMA_BLOCK_TRANSFER;
+	// below the codec staging (very high), a late loop block costs less than a late audio block
+	hmdma->Init.Priority = MDMA_PRIORITY_MEDIUM;
+	hmdma->Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+	hmdma->Init.SourceInc = MDMA_SRC_INC_WORD;
+	hmdma->Init.DestinationInc = MDMA_DEST_INC_WORD;
+	hmdma->Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+	hmdma->Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+	hmdma->Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+	hmdma->Init.BufferTransferLength = 128;
+	hmdma->Init.SourceBurst = MDMA_SOURCE_BURST_8BEATS;
+	hmdma->Init.DestBurst = MDMA_DEST_BURST_8BEATS;
+	hmdma->Init.SourceBlockAddressOffset = 0;
+	hmdma->Init.DestBlockAddressOffset = 0;
+	return (HAL_MDMA_Init(hmdma) == HAL_OK) ? 0 : 1;
+}
+
+static inline bool transfer_done(MDMA_HandleTypeDef *hmdma)
+{
+	return (HAL_MDMA_GetState(hmdma) == HAL_MDMA_STATE_READY) ? true : false;
+}
+
+/******************************************************************************
+* Function Name: looper_init
+*******************************************************************************
+* Summary:
+*  Initialize a looper and its two MDMA channels. The looper starts stopped with an empty loop.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of the looper handle struct. Has to be in memory the
+*									  MDMA can reach (DTCM or AXI SRAM), the stages are part of it.
+*  2. uint8_t channel				- Audio channel (0 = left, 1 = right). Selects memory and MDMA channels.
+*  3. float32_t level				- Playback level of the loop. Range: 0 to 1.
+* Return:
+*  255:								- Handle points to NULL or channel out of range.
+*  254:								- Level out of range.
+*  253:								- MDMA configuration failed.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t looper_init(looper_handle_t *handle, uint8_t channel, float32_t level)
+{
+	if ((handle == NULL) || (channel >= AUDIO_CHANNELS))
+	{
+		return 255;
+	}
+	if ((level < 0.0f) || (level > 1.0f))
+	{
+		return 254;
+	}
+
+	__HAL_RCC_MDMA_CLK_ENABLE();
+	if (mdma_config(&handle->hmdma_fetch, mdma_channels[channel][0]) || mdma_config(&handle->hmdma_store, mdma_channels[channel][1]))
+	{
+		return 253;
+	}
+	HAL_NVIC_SetPriority(MDMA_IRQn, AUDIO_IRQ_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(MDMA_IRQn);
+
+	handle->memory = loop_memory[channel];
+	handle->level = level;
+	smooth_param_init(&handle->level_smooth, level, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	looper_reset(handle);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: looper_command
+*******************************************************************************
+* Summary:
+*  Request a state change, taken over with the next block:
+*  RECORD starts a new loop, PLAY ends the recording (the loop length is the recorded time)
+*  or plays the loop from the start, OVERDUB adds the input to the playing loop, STOP mutes
+*  the loop. PLAY and OVERDUB without a recorded loop are ignored.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of an initialized looper handle struct.
+*  2. looper_state request			- The requested state.
+* Return:
+*  None.
+*
+******************************************************************************/
+void looper_command(looper_handle_t *handle, looper_state request)
+{
+	handle->request = request;
+}
+
+/******************************************************************************
+* Function Name: looper_set_level
+*******************************************************************************
+* Summary:
+*  Set the playback level of the loop. Faded in within a few blocks.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of the looper handle struct.
+*  2. float32_t level				- Playback level. Range: 0 to 1.
+* Return:
+*  255:								- Level out of range.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t looper_set_level(looper_handle_t *handle, float32_t level)
+{
+	if ((level < 0.0f) || (level > 1.0f))
+	{
+		return 255;
+	}
+	handle->level = level;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: looper_reset
+*******************************************************************************
+* Summary:
+*  Stop the looper and forget the loop, e.g. after the block size changed (the loop length is a
+*  multiple of the block size it was recorded with). Aborts the running transfers.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of the looper handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void looper_reset(looper_handle_t *handle)
+{
+	HAL_MDMA_Abort(&handle->hmdma_fetch);
+	HAL_MDMA_Abort(&handle->hmdma_store);
+	handle->request = LOOPER_STOP;
+	handle->state = LOOPER_STOP;
+	handle->is_running = false;
+	handle->length = 0;
+	handle->position = 0;
+	handle->fetched = NOT_FETCHED;
+	handle->stage = 0;
+	smooth_param_reset(&handle->level_smooth, handle->level);
+}
+
+// start fetching the block at position into the free fetch stage
+#pragma optimize_for_speed
+ITCM_CODE static void prefetch(looper_handle_t *handle, uint32_t position, uint32_t block_size)
+{
+	if (!transfer_done(&handle->hmdma_fetch) ||
+		(HAL_MDMA_Start_IT(&handle->hmdma_fetch, (uint32_t)&handle->memory[position], (uint32_t)handle->fetch_stage[handle->stage], block_size * sizeof(q15_t), 1) != HAL_OK))
+	{
+		handle->fetched = NOT_FETCHED;
+		handle->misses++;
+		return;
+	}
+	handle->fetched = position;
+	handle->stage ^= 1;
+}
+
+// take over the requested state at a block boundary
+static void apply_request(looper_handle_t *handle, uint32_t block_size)
+{
+	const looper_state request = handle->request;
+	if (request == handle->state)
+		return;
+	const bool was_playing = ((handle->state == LOOPER_PLAY) || (handle->state == LOOPER_OVERDUB)) ? true : false;
+
+	switch (request)
+	{
+	case LOOPER_RECORD:
+		handle->length = 0;
+		handle->position = 0;
+		handle->state = LOOPER_RECORD;
+		break;
+	case LOOPER_PLAY:
+	case LOOPER_OVERDUB:
+		if (handle->state == LOOPER_RECORD)
+		{
+			handle->length = handle->position;
+			handle->position = 0;
+		}
+		else if (handle->state == LOOPER_STOP)
+		{
+			handle->position = 0;
+		}
+		handle->state = request;
+		break;
+	default:
+		handle->state = LOOPER_STOP;
+		break;
+	}
+	// a loop shorter than LOOPER_MIN_BLOCKS can't be staged
+	if (((handle->state == LOOPER_PLAY) || (handle->state == LOOPER_OVERDUB)) && (handle->length < LOOPER_MIN_BLOCKS * block_size))
+	{
+		handle->state = LOOPER_STOP;
+		handle->length = 0;
+	}
+	handle->request = handle->state;
+	handle->is_running = (handle->state != LOOPER_STOP) ? true : false;
+
+	// nothing was fetched for the first block of the loop yet. it is waited for once, a block
+	// from the external memory takes about a microsecond. the MDMA interrupt preempts the audio path
+	if (!was_playing && ((handle->state == LOOPER_PLAY) || (handle->state == LOOPER_OVERDUB)))
+	{
+		prefetch(handle, handle->position, block_size);
+		for (uint32_t spin = 0; (spin < FETCH_SPIN_LIMIT) && !transfer_done(&handle->hmdma_fetch); ++spin)
+			;
+	}
+}
+
+/******************************************************************************
+* Function Name: run_looper
+*******************************************************************************
+* Summary:
+*  Process one block: play the loop block fetched with the previous block, mix it with the
+*  input, write the recorded (or overdubbed) block back and fetch the next one. The loop is
+*  played as silence if its block wasn't fetched in time (counted in misses).
+*  Called from the audio interrupt only.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of an initialized looper handle struct.
+*  2. const sample_t *src			- Input block.
+*  3. sample_t *dst					- Output block. May be the same as src.
+*  4. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_looper(looper_handle_t *handle, const sample_t *src, sample_t *dst, uint32_t block_size)
+{
+	apply_request(handle, block_size);
+	smooth_param_next(&handle->level_smooth, handle->level, block_size);
+
+	const looper_state state = handle->state;
+	const uint32_t position = handle->position;
+	const bool playing = ((state == LOOPER_PLAY) || (state == LOOPER_OVERDUB)) ? true : false;
+	sample_t loop[MAX_BLOCK_SIZE];
+	// the stage that isn't being fetched into holds the block of this position, if it arrived
+	const bool ready = (playing && (handle->fetched == position) && transfer_done(&handle->hmdma_fetch)) ? true : false;
+
+	if (playing)
+	{
+		if (ready)
+		{
+#if defined(SAMPLE_Q31)
+			arm_q15_to_q31(handle->fetch_stage[handle->stage ^ 1], loop, block_size);
+#else
+			arm_q15_to_float(handle->fetch_stage[handle->stage ^ 1], loop, block_size);
+#endif
+		}
+		else
+		{
+			memset(loop, 0, block_size * sizeof(loop[0]));
+			if (handle->fetched != NOT_FETCHED)
+				handle->misses++;
+		}
+	}
+
+	// block written back: the input (record) or input plus loop (overdub). a missing loop block
+	// isn't overdubbed, the input alone would erase it
+	if ((state == LOOPER_RECORD) || ((state == LOOPER_OVERDUB) && ready))
+	{
+		if (transfer_done(&handle->hmdma_store))
+		{
+#if defined(SAMPLE_Q31)
+			if (state == LOOPER_OVERDUB)
+			{
+				sample_t sum[MAX_BLOCK_SIZE];
+				arm_add_q31(src, loop, sum, block_size);
+				arm_q31_to_q15(sum, handle->store_stage, block_size);
+			}
+			else
+			{
+				arm_q31_to_q15(src, handle->store_stage, block_size);
+			}
+#else
+			if (state == LOOPER_OVERDUB)
+			{
+				sample_t sum[MAX_BLOCK_SIZE];
+				arm_add_f32(src, loop, sum, block_size);
+				arm_float_to_q15(sum, handle->store_stage, block_size);
+			}
+			else
+			{
+				arm_float_to_q15(src, handle->store_stage, block_size);
+			}
+#endif
+			if (HAL_MDMA_Start_IT(&handle->hmdma_store, (uint32_t)handle->store_stage, (uint32_t)&handle->memory[position], block_size * sizeof(q15_t), 1) != HAL_OK)
+				handle->misses++;
+		}
+		else
+		{
+			handle->misses++;
+		}
+	}
+
+	// output: input plus the loop at its level
+	if (playing)
+	{
+#if defined(SAMPLE_Q31)
+		smooth_param_scale_q31(&handle->level_smooth, loop, loop, block_size);
+		arm_add_q31(src, loop, dst, block_size);
+#else
+		smooth_param_scale(&handle->level_smooth, loop, loop, block_size);
+		arm_add_f32(src, loop, dst, block_size);
+#endif
+	}
+	else if (dst != src)
+	{
+		memcpy(dst, src, block_size * sizeof(dst[0]));
+	}
+
+	// advance and fetch the next block. a recording ends by itself when the memory is full
+	uint32_t next = position + block_size;
+	if (state == LOOPER_RECORD)
+	{
+		handle->position = next;
+		if (next + block_size > LOOPER_MAX_SECONDS * sample_rate)
+			handle->request = LOOPER_PLAY;
+	}
+	else if (playing)
+	{
+		if (next >= handle->length)
+			next = 0;
+		handle->position = next;
+		prefetch(handle, next, block_size);
+	}
+}
+
+/******************************************************************************
+* Function Name: looper_irq_handler
+*******************************************************************************
+* Summary:
+*  MDMA interrupt handling of both looper channels. Called from MDMA_IRQHandler.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of an initialized looper handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void looper_irq_handler(looper_handle_t *handle)
+{
+	HAL_MDMA_IRQHandler(&handle->hmdma_fetch);
+	HAL_MDMA_IRQHandler(&handle->hmdma_store);
+}
+
+#endif // LOOPER && !LOOPER_ADPCM
+
+#if defined(LOOPER_ADPCM)
+
+// smallest segment worth claiming, it has to hold a few frames of the largest block size
+#define SEGMENT_MIN_BYTES (LOOPER_MIN_BLOCKS * ADPCM_FRAME_BYTES(MAX_BLOCK_SIZE))
+
+/******************************************************************************
+* Function Name: looper_init
+*******************************************************************************
+* Summary:
+*  Initialize a looper. It starts stopped with an empty loop and without memory, the memory is
+*  claimed by the first recording.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of the looper handle struct.
+*  2. uint8_t channel				- Audio channel (0 = left, 1 = right).
+*  3. float32_t level				- Playback level of the loop. Range: 0 to 1.
+* Return:
+*  255:								- Handle points to NULL or channel out of range.
+*  254:								- Level out of range.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t looper_init(looper_handle_t *handle, uint8_t channel, float32_t level)
+{
+	if ((handle == NULL) || (channel >= AUDIO_CHANNELS))
+	{
+		return 255;
+	}
+	if ((level < 0.0f) || (level > 1.0f))
+	{
+		return 254;
+	}
+
+	handle->channel = channel;
+	for (uint8_t s = 0; s < LOOPER_SEGMENTS; ++s)
+	{
+		handle->segment[s] = NULL;
+		handle->segment_bytes[s] = 0;
+	}
+	handle->level = level;
+	smooth_param_init(&handle->level_smooth, level, SMOOTH_LINEAR, SMOOTH_PARAM_DEFAULT_MS);
+	looper_reset(handle);
+	return 0;
+}
+
+// claim the loop memory from the free part of the RAM_D1 and RAM_D2 arenas. the channels split it: the left channel
+// takes its share first, the right one the rest
+static void claim_memory(looper_handle_t *handle)
+{
+	static const arena_class classes[LOOPER_SEGMENTS] = { ARENA_AXI, ARENA_AHB };
+	uint32_t remaining = LOOPER_MAX_BYTES(sample_rate);
+
+	for (uint8_t s = 0; s < LOOPER_SEGMENTS; ++s)
+	{
+		uint32_t bytes = (uint32_t)(arena_available(classes[s]) / (AUDIO_CHANNELS - handle->channel));
+		bytes = ((bytes < remaining) ? bytes : remaining) & ~(ARENA_ALIGN - 1u);
+		uint8_t *memory = (bytes >= SEGMENT_MIN_BYTES) ? arena_alloc(classes[s], bytes) : NULL;
+		if (memory == NULL)
+		{
+			continue;
+		}
+		handle->segment[s] = memory;
+		handle->segment_bytes[s] = bytes;
+		remaining -= bytes;
+	}
+}
+
+/******************************************************************************
+* Function Name: looper_command
+*******************************************************************************
+* Summary:
+*  Request a state change, taken over with the next block:
+*  RECORD starts a new loop, PLAY ends the recording (the loop length is the recorded time)
+*  or plays the loop from the start, OVERDUB adds the input to the playing loop, STOP mutes
+*  the loop. PLAY and OVERDUB without a recorded loop are ignored. The first RECORD claims the
+*  loop memory, without free arena memory it's ignored. Call from the main loop.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of an initialized looper handle struct.
+*  2. looper_state request			- The requested state.
+* Return:
+*  None.
+*
+******************************************************************************/
+void looper_command(looper_handle_t *handle, looper_state request)
+{
+	if ((request == LOOPER_RECORD) && (handle->segment[0] == NULL) && (handle->segment[1] == NULL))
+	{
+		claim_memory(handle);
+		if ((handle->segment[0] == NULL) && (handle->segment[1] == NULL))
+		{
+			return;
+		}
+		// the memory is in place before the audio processing starts recording into it
+		__DMB();
+	}
+	handle->request = request;
+}
+
+/******************************************************************************
+* Function Name: looper_set_level
+*******************************************************************************
+* Summary:
+*  Set the playback level of the loop. Faded in within a few blocks.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of the looper handle struct.
+*  2. float32_t level				- Playback level. Range: 0 to 1.
+* Return:
+*  255:								- Level out of range.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t looper_set_level(looper_handle_t *handle, float32_t level)
+{
+	if ((level < 0.0f) || (level > 1.0f))
+	{
+		return 255;
+	}
+	handle->level = level;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: looper_reset
+*******************************************************************************
+* Summary:
+*  Stop the looper, forget the loop and give its memory back to the arenas, e.g. after the
+*  block size changed (the frames are coded for the block size of the recording). Call while
+*  the audio processing is stopped.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of the looper handle struct.
+* Return:
+*  None.
+*
+******************************************************************************/
+void looper_reset(looper_handle_t *handle)
+{
+	handle->request = LOOPER_STOP;
+	handle->state = LOOPER_STOP;
+	handle->is_running = false;
+	for (uint8_t s = 0; s < LOOPER_SEGMENTS; ++s)
+	{
+		arena_free(handle->segment[s]);
+		handle->segment[s] = NULL;
+		handle->segment_bytes[s] = 0;
+		handle->segment_frames[s] = 0;
+	}
+	handle->frames = 0;
+	handle->frame_bytes = 0;
+	handle->length = 0;
+	handle->position = 0;
+	adpcm_reset(&handle->encoder);
+	handle->prime = false;
+	smooth_param_reset(&handle->level_smooth, handle->level);
+}
+
+// frame of a position in the loop memory
+static inline uint8_t *frame_at(const looper_handle_t *handle, uint32_t position)
+{
+	if (position < handle->segment_frames[0])
+	{
+		return &handle->segment[0][position * handle->frame_bytes];
+	}
+	return &handle->segment[1][(position - handle->segment_frames[0]) * handle->frame_bytes];
+}
+
+// take over the requested state at a block boundary
+static void apply_request(looper_handle_t *handle, uint32_t block_size)
+{
+	const looper_state request = handle->request;
+	if (request == handle->state)
+		return;
+
+	switch (request)
+	{
+	case LOOPER_RECORD:
+		// the frames of this block size that fit into the claimed memory
+		handle->frame_bytes = ADPCM_FRAME_BYTES(block_size);
+		handle->frames = 0;
+		for (uint8_t s = 0; s < LOOPER_SEGMENTS; ++s)
+		{
+			handle->segment_frames[s] = handle->segment_bytes[s] / handle->frame_bytes;
+			handle->frames += handle->segment_frames[s];
+		}
+		handle->length = 0;
+		handle->position = 0;
+		adpcm_reset(&handle->encoder);
+		handle->state = (handle->frames > 0) ? LOOPER_RECORD : LOOPER_STOP;
+		break;
+	case LOOPER_PLAY:
+	case LOOPER_OVERDUB:
+		if (handle->state == LOOPER_RECORD)
+		{
+			handle->length = handle->position;
+			handle->position = 0;
+		}
+		else if (handle->state == LOOPER_STOP)
+		{
+			handle->position = 0;
+		}
+		handle->state = (handle->length > 0) ? request : LOOPER_STOP;
+		break;
+	default:
+		handle->state = LOOPER_STOP;
+		break;
+	}
+	handle->request = handle->state;
+	handle->is_running = (handle->state != LOOPER_STOP) ? true : false;
+
+	// the encoder starts at the first block of the recording or overdub (run_looper). a stale predictor or the smallest
+	// step would take a few samples to catch up and click
+	handle->prime = ((handle->state == LOOPER_RECORD) || (handle->state == LOOPER_OVERDUB)) ? true : false;
+}
+
+/******************************************************************************
+* Function Name: run_looper
+*******************************************************************************
+* Summary:
+*  Process one block in one pass over its frame: decode the frame to play it, mix it with the
+*  input, and encode the input (record) or input plus loop (overdub) into the same frame.
+*  Called from the audio interrupt only.
+*
+* Parameters:
+*  1. looper_handle_t *handle		- Address pointer of an initialized looper handle struct.
+*  2. const sample_t *src			- Input block.
+*  3. sample_t *dst					- Output block. May be the same as src.
+*  4. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void run_looper(looper_handle_t *handle, const sample_t *src, sample_t *dst, uint32_t block_size)
+{
+	apply_request(handle, block_size);
+	smooth_param_next(&handle->level_smooth, handle->level, block_size);
+
+	const looper_state state = handle->state;
+	if (state == LOOPER_STOP)
+	{
+		if (dst != src)
+		{
+			memcpy(dst, src, block_size * sizeof(dst[0]));
+		}
+		return;
+	}
+
+	const uint32_t position = handle->position;
+	const bool playing = ((state == LOOPER_PLAY) || (state == LOOPER_OVERDUB)) ? true : false;
+	uint8_t *frame = frame_at(handle, position);
+	q15_t pcm[MAX_BLOCK_SIZE];
+	sample_t loop[MAX_BLOCK_SIZE];
+
+	if (playing)
+	{
+		adpcm_decode(frame, pcm, block_size);
+#if defined(SAMPLE_Q31)
+		arm_q15_to_q31(pcm, loop, block_size);
+#else
+		arm_q15_to_float(pcm, loop, block_size);
+#endif
+	}
+
+	// the frame recorded: the input, or the loop plus the input (saturated)
+	if (state != LOOPER_PLAY)
+	{
+		q15_t input[MAX_BLOCK_SIZE];
+#if defined(SAMPLE_Q31)
+		arm_q31_to_q15(src, input, block_size);
+#else
+		arm_float_to_q15(src, input, block_size);
+#endif
+		if (state == LOOPER_OVERDUB)
+		{
+			arm_add_q15(pcm, input, input, block_size);
+		}
+		if (handle->prime)
+		{
+			adpcm_prime(&handle->encoder, input);
+			handle->prime = false;
+		}
+		adpcm_encode(&handle->encoder, input, frame, block_size);
+	}
+
+	// output: input plus the loop at its level
+	if (playing)
+	{
+#if defined(SAMPLE_Q31)
+		smooth_param_scale_q31(&handle->level_smooth, loop, loop, block_size);
+		arm_add_q31(src, loop, dst, block_size);
+#else
+		smooth_param_scale(&handle->level_smooth, loop, loop, block_size);
+		arm_add_f32(src, loop, dst, block_size);
+#endif
+	}
+	else if (dst != src)
+	{
+		memcpy(dst, src, block_size * sizeof(dst[0]));
+	}
+
+	// advance. a recording ends by itself when the memory is full
+	uint32_t next = position + 1;
+	if (state == LOOPER_RECORD)
+	{
+		handle->position = next;
+		if (next >= handle->frames)
+			handle->request = LOOPER_PLAY;
+	}
+	else
+	{
+		handle->position = (next >= handle->length) ? 0 : next;
+	}
+}
+
+#endif // LOOPER_ADPCM
@@ -0,0 +1,153 @@
+// looper.h, Michael Haselberger
+// Description: This file contains declarations for the external memory looper and the internal memory ADPCM looper
+// implemented in looper.c
+
+#ifndef __LOOPER_H__
+#define __LOOPER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+#include "smooth_param.h"
+#if defined(LOOPER_ADPCM)
+#include "adpcm.h"
+#endif
+
+// longest loop per channel at any sample rate. the loop memory (.loop_buffer) holds it at AUDIO_MAX_SAMPLE_RATE:
+// LOOPER_MAX_SECONDS * 192 KB per channel, 20 s of both channels fit into EXTRAM. LOOPER_ADPCM: upper limit of the
+// arena memory claimed, the free arena memory usually ends the recording first
+#ifndef LOOPER_MAX_SECONDS
+#if (AUDIO_CHANNELS == 2) && !defined(LOOPER_ADPCM)
+#define LOOPER_MAX_SECONDS (20)
+#else
+#define LOOPER_MAX_SECONDS (30)
+#endif
+#endif
+#define LOOPER_MAX_SAMPLES (LOOPER_MAX_SECONDS * AUDIO_MAX_SAMPLE_RATE)
+// shortest loop in blocks. the block written back and the block fetched next must not be the same one
+#define LOOPER_MIN_BLOCKS (2)
+
+typedef enum
+{
+	LOOPER_STOP = 0,
+	LOOPER_RECORD,
+	LOOPER_PLAY,
+	LOOPER_OVERDUB
+} looper_state;
+
+#if defined(LOOPER_ADPCM)
+// the loop memory comes from up to two arenas, RAM_D1 and RAM_D2
+#define LOOPER_SEGMENTS (2)
+// loop memory claimed per channel at most: LOOPER_MAX_SECONDS at the sample rate as frames of the smallest block size
+#define LOOPER_MAX_BYTES(rate) (ADPCM_FRAME_BYTES(MIN_BLOCK_SIZE) * ((LOOPER_MAX_SECONDS * (rate)) / MIN_BLOCK_SIZE))
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Looper in internal memory. The loop is stored as IMA-ADPCM (adpcm.h), one frame per block: 4 bits per sample plus a
+*   4 byte header, a quarter of q15. The memory is the free part of the RAM_D1 and RAM_D2 arenas, claimed by
+*   looper_command when the first recording starts and given back by looper_reset: about 28 s mono at 48 kHz and blocks
+*   of 128 with no effect holding arena memory, 23 s with the delay selected, half of it per channel in stereo. Effects
+*   selected while a loop holds the memory may not get their buffers. Every block is one pass over its frame:
+*   decode to play, encode to record, decode, add and encode again to overdub. No staging, the frame is read and
+*   written in place by the CPU (cached SRAM).
+*
+*   Members:
+*   request:            State requested by the user interface (looper_command). Taken over with the next block.
+*   level:              Playback level of the loop. Range: 0 to 1.
+*   is_running:         The audio path records or plays the loop (state isn't LOOPER_STOP), for the user interface.
+*   state:              State the audio path is in.
+*   channel:            Audio channel, the channels share the free arena memory.
+*   segment:            Loop memory in the arenas, NULL if none is claimed.
+*   segment_bytes:      Bytes of the segments.
+*   segment_frames:     Frames of the block size of the recording that fit into the segments.
+*   frames:             Frames that fit into the loop memory.
+*   frame_bytes:        Bytes of a frame, ADPCM_FRAME_BYTES(block size) of the recording.
+*   length:             Loop length in frames (blocks). 0 until a loop was recorded.
+*   position:           Frame of the current block.
+*   encoder:            ADPCM state carried from frame to frame by recording and overdubbing.
+*   prime:              The next encoded block starts the encoder (adpcm_prime): recording or overdub started.
+*   level_smooth:       Smoothed level (see smooth_param.h).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile looper_state request;
+	volatile float32_t level;
+	volatile bool is_running;
+	looper_state state;
+	uint8_t channel;
+	uint8_t *segment[LOOPER_SEGMENTS];
+	uint32_t segment_bytes[LOOPER_SEGMENTS];
+	uint32_t segment_frames[LOOPER_SEGMENTS];
+	uint32_t frames;
+	uint32_t frame_bytes;
+	uint32_t length;
+	uint32_t position;
+	adpcm_state_t encoder;
+	bool prime;
+	smooth_param_t level_smooth;
+} looper_handle_t;
+#else
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Looper in external memory (FMC SDRAM or memory-mapped OctoSPI/QSPI PSRAM, .loop_buffer section).
+*   The audio path never reads or writes the external memory itself: every block of the loop is fetched into DTCM by the
+*   MDMA one block before it is played, and the recorded block is written back by the MDMA after it was processed.
+*   The external bus latency is hidden behind a whole block period. The samples are stored as q15, same as a packed
+*   delay line (delay_line.h). Timing is the same as in a delay line whose delay is the loop length.
+*
+*   Members:
+*   request:            State requested by the user interface (looper_command). Taken over with the next block.
+*   level:              Playback level of the loop. Range: 0 to 1.
+*   is_running:         The audio path records or plays the loop (state isn't LOOPER_STOP), for the user interface.
+*   state:              State the audio path is in.
+*   memory:             Loop memory of this channel, LOOPER_MAX_SAMPLES q15 samples in .loop_buffer. LOOPER_MAX_SECONDS
+*                       of it are used at the running sample rate.
+*   length:             Loop length in samples, a multiple of the block size. 0 until a loop was recorded.
+*   position:           Position of the current block in the loop.
+*   fetched:            Position of the block in the fetch stage that isn't being filled. ~0 if none.
+*   stage:              Index of the fetch stage the next block is fetched into.
+*   misses:             Blocks the MDMA didn't fetch or write back in time (played as silence / not recorded).
+*   level_smooth:       Smoothed level (see smooth_param.h).
+*   hmdma_fetch:        MDMA channel external memory -> fetch stage.
+*   hmdma_store:        MDMA channel store stage -> external memory.
+*   fetch_stage:        Two blocks of the loop in DTCM, one played while the other is fetched.
+*   store_stage:        The block written back to the loop memory.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile looper_state request;
+	volatile float32_t level;
+	volatile bool is_running;
+	looper_state state;
+	q15_t *memory;
+	uint32_t length;
+	uint32_t position;
+	uint32_t fetched;
+	uint8_t stage;
+	uint32_t misses;
+	smooth_param_t level_smooth;
+	MDMA_HandleTypeDef hmdma_fetch;
+	MDMA_HandleTypeDef hmdma_store;
+	q15_t fetch_stage[2][MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+	q15_t store_stage[MAX_BLOCK_SIZE] __attribute__((aligned(32)));
+} looper_handle_t;
+#endif
+
+uint8_t looper_init(looper_handle_t *handle, uint8_t channel, float32_t level);
+void looper_command(looper_handle_t *handle, looper_state request);
+uint8_t looper_set_level(looper_handle_t *handle, float32_t level);
+void looper_reset(looper_handle_t *handle);
+void run_looper(looper_handle_t *handle, const sample_t *src, sample_t *dst, uint32_t block_size);
+#if !defined(LOOPER_ADPCM)
+void looper_irq_handler(looper_handle_t *handle);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __LOOPER_H__
@@ -0,0 +1,342 @@
+// midi.c, Michael Haselberger
+// Description: MIDI input on USART2 (PD6, CN9): the DMA receives into a circular buffer, the bytes are parsed in the UART
+// interrupt whenever the DMA passes half of the buffer, its end, or the line goes idle after a message. Control and program
+// changes are pushed through a lock-free queue to the audio processing, which applies them at their sample in the block.
+// MIDI clock and start go straight to the tempo clock (tempo.h). DIN input needs the usual optocoupler in front of PD6.
+
+#include "main.h"
+
+#if defined(MIDI)
+
+UART_HandleTypeDef huart_midi;
+DMA_HandleTypeDef hdma_midi_rx;
+
+// in AXI SRAM (.bss): the DMA can't reach the DTCM. cacheable, so it's invalidated before the bytes are read
+static uint8_t rx_buffer[MIDI_RX_BUFFER_SIZE] __attribute__((aligned(32)));
+// next byte of rx_buffer that wasn't parsed yet
+static uint16_t rx_position = 0;
+static midi_parser_t parser;
+static midi_queue_t queue;
+
+static uint8_t start_reception(void)
+{
+	rx_position = 0;
+	parser.status = 0;
+	parser.count = 0;
+	return (HAL_UARTEx_ReceiveToIdle_DMA(&huart_midi, rx_buffer, MIDI_RX_BUFFER_SIZE) == HAL_OK) ? 0 : 253;
+}
+
+// producer side of the queue (UART interrupt)
+static void push(const midi_event_t *event)
+{
+	// the ring buffer publishes the event only once it's complete
+	if (!midi_event_queue_put(&queue.events, event))
+	{
+		queue.dropped++;
+	}
+}
+
+/******************************************************************************
+* Function Name: midi_init
+*******************************************************************************
+* Summary:
+*  Set up USART2 for MIDI (31250 baud, 8N1, receive only) and start the circular DMA reception.
+*  Call from main after peripheral_init, before the first event is expected.
+*
+* Parameters:
+*  None.
+* Return:
+*  253:								- UART or DMA couldn't be started.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t midi_init(void)
+{
+	midi_event_queue_clear(&queue.events);
+	queue.dropped = 0;
+	// the events are timestamped with the DWT cycle counter (see profiler_init, which may run later)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	huart_midi.Instance = USART2;
+	huart_midi.Init.BaudRate = MIDI_BAUD_RATE;
+	huart_midi.Init.WordLength = UART_WORDLENGTH_8B;
+	huart_midi.Init.StopBits = UART_STOPBITS_1;
+	huart_midi.Init.Parity = UART_PARITY_NONE;
+	huart_midi.Init.Mode = UART_MODE_RX;
+	huart_midi.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+	huart_midi.Init.OverSampling = UART_OVERSAMPLING_16;
+	huart_midi.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+	huart_midi.Init.ClockPrescaler = UART_PRESCALER_DIV1;
+	huart_midi.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+	if (HAL_UART_Init(&huart_midi) != HAL_OK)
+	{
+		return 253;
+	}
+	return start_reception();
+}
+
+/******************************************************************************
+* Function Name: midi_parse
+*******************************************************************************
+* Summary:
+*  Feed one byte of a MIDI stream to the parser. A channel message is complete after its last
+*  data byte; further data bytes without status continue it (running status). Real-time bytes
+*  don't interrupt the running message. Clock, start and continue are passed to the tempo clock
+*  here, so the parser has to run close to the reception (interrupt or USB callback).
+*
+* Parameters:
+*  1. midi_parser_t *parser			- Address pointer of the parser state.
+*  2. uint8_t byte					- Received byte.
+*  3. midi_event_t *event			- Written when a control or program change of the receive
+*									  channel (MIDI_CHANNEL) is complete.
+* Return:
+*  1:								- event holds a new control or program change.
+*  0:								- No event (yet).
+*
+******************************************************************************/
+uint8_t midi_parse(midi_parser_t *parser, uint8_t byte, midi_event_t *event)
+{
+	if (byte >= 0xF8)
+	{
+		// real-time: timing clock, start, continue. stop, active sensing and reset are ignored
+		if (byte == 0xF8)
+			tempo_midi_clock(HAL_GetTick());
+		else if ((byte == 0xFA) || (byte == 0xFB))
+			tempo_midi_start();
+		return 0;
+	}
+	if (byte >= 0xF0)
+	{
+		// system exclusive and system common: their data bytes belong to no channel message
+		parser->status = 0;
+		return 0;
+	}
+	if (byte & 0x80)
+	{
+		parser->status = byte;
+		parser->count = 0;
+		return 0;
+	}
+	if (parser->status == 0)
+	{
+		return 0;
+	}
+
+	parser->data[parser->count++] = byte;
+	const uint8_t kind = parser->status & 0xF0;
+	// program change and channel pressure have one data byte, the other channel messages two
+	const uint8_t length = ((kind == 0xC0) || (kind == 0xD0)) ? 1 : 2;
+	if (parser->count < length)
+	{
+		return 0;
+	}
+	parser->count = 0;
+
+	const uint8_t channel = parser->status & 0x0F;
+	if ((MIDI_CHANNEL != MIDI_OMNI) && (channel != MIDI_CHANNEL))
+	{
+		return 0;
+	}
+	if (kind == 0xB0)
+	{
+		event->type = MIDI_CONTROL_CHANGE;
+		event->value = parser->data[1];
+	}
+	else if (kind == 0xC0)
+	{
+		event->type = MIDI_PROGRAM_CHANGE;
+		event->value = 0;
+	}
+	else
+	{
+		return 0;
+	}
+	event->channel = channel;
+	event->number = parser->data[0];
+	event->time = DWT->CYCCNT;
+	return 1;
+}
+
+/******************************************************************************
+* Function Name: midi_receive
+*******************************************************************************
+* Summary:
+*  Parse received bytes and queue the control and program changes for the audio context. Called
+*  by the UART reception; another transport (e.g. the payload of USB MIDI packets) can feed its
+*  bytes here as well, as long as it runs in the same interrupt priority (single producer).
+*
+* Parameters:
+*  1. const uint8_t *bytes			- Received bytes.
+*  2. uint32_t length				- Number of bytes.
+* Return:
+*  None.
+*
+******************************************************************************/
+void midi_receive(const uint8_t *bytes, uint32_t length)
+{
+	midi_event_t event;
+	for (uint32_t i = 0; i < length; ++i)
+	{
+		if (midi_parse(&parser, bytes[i], &event))
+		{
+			push(&event);
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: midi_peek
+*******************************************************************************
+* Summary:
+*  Consumer side of the event queue: read the oldest event without taking it. It stays in the
+*  queue until midi_release. Call from the audio processing only.
+*
+* Parameters:
+*  1. midi_event_t *event			- Written with the oldest event.
+* Return:
+*  1:								- event holds an event.
+*  0:								- The queue is empty.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE uint8_t midi_peek(midi_event_t *event)
+{
+	const midi_event_t *oldest = midi_event_queue_peek(&queue.events);
+	if (oldest == NULL)
+	{
+		return 0;
+	}
+	*event = *oldest;
+	return 1;
+}
+
+// take the event returned by midi_peek out of the queue
+#pragma optimize_for_speed
+ITCM_CODE void midi_release(void)
+{
+	midi_event_queue_release(&queue.events);
+}
+
+uint32_t midi_dropped(void)
+{
+	return queue.dropped;
+}
+
+// half of the buffer, its end or an idle line: pos is where the DMA writes next
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t pos)
+{
+#if defined(HOST_LINK)
+	// the HAL has one callback for every UART: the host link gets its own events
+	if (huart->Instance == HOST_LINK_UART)
+	{
+		host_link_rx_event(pos);
+		return;
+	}
+#endif
+	if (huart->Instance != USART2)
+	{
+		return;
+	}
+	SCB_InvalidateDCache_by_Addr((uint32_t *)rx_buffer, MIDI_RX_BUFFER_SIZE);
+	if (pos > rx_position)
+	{
+		midi_receive(&rx_buffer[rx_position], pos - rx_position);
+	}
+	// the DMA wrapped around after the end of the buffer
+	rx_position = (pos >= MIDI_RX_BUFFER_SIZE) ? 0 : pos;
+}
+
+// overrun, framing error (e.g. a cable plugged in while a message was sent): start over with the next status byte
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+#if defined(HOST_LINK)
+	if (huart->Instance == HOST_LINK_UART)
+	{
+		host_link_error();
+		return;
+	}
+#endif
+	if (huart->Instance != USART2)
+	{
+		return;
+	}
+	if (huart->RxState == HAL_UART_STATE_READY)
+	{
+		// the HAL aborted the reception
+		start_reception();
+	}
+	else
+	{
+		parser.status = 0;
+		parser.count = 0;
+	}
+}
+
+void HAL_UART_MspInit(UART_HandleTypeDef *huart)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	RCC_PeriphCLKInitTypeDef PeriphClkInitStruct = {0};
+	if (huart->Instance == USART2)
+	{
+		// the baud rate is derived from the HSI, the APB clock depends on the core clock profile (see rcc.c)
+		PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_USART2;
+		PeriphClkInitStruct.Usart234578ClockSelection = RCC_USART234578CLKSOURCE_HSI;
+		if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK)
+		{
+			Error_Handler();
+		}
+		__HAL_RCC_USART2_CLK_ENABLE();
+		__HAL_RCC_GPIOD_CLK_ENABLE();
+		__HAL_RCC_DMA1_CLK_ENABLE();
+
+		/* USART2 GPIO Configuration
+			PD6     ------> USART2_RX
+		*/
+		// pulled up: an open input stays at the idle level instead of receiving noise
+		GPIO_InitStruct.Pin = GPIO_PIN_6;
+		GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+		GPIO_InitStruct.Pull = GPIO_PULLUP;
+		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+		GPIO_InitStruct.Alternate = GPIO_AF7_USART2;
+		HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
+		hdma_midi_rx.Instance = DMA1_Stream2;
+		hdma_midi_rx.Init.Request = DMA_REQUEST_USART2_RX;
+		hdma_midi_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+		hdma_midi_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+		hdma_midi_rx.Init.MemInc = DMA_MINC_ENABLE;
+		hdma_midi_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+		hdma_midi_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+		hdma_midi_rx.Init.Mode = DMA_CIRCULAR;
+		hdma_midi_rx.Init.Priority = DMA_PRIORITY_LOW;
+		hdma_midi_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+		if (HAL_DMA_Init(&hdma_midi_rx) != HAL_OK)
+		{
+			Error_Handler();
+		}
+		__HAL_LINKDMA(huart, hdmarx, hdma_midi_rx);
+
+		// above the audio processing (PendSV), like the I2S DMA: the timestamp of an event is taken when the
+		// message is complete, not when a block finishes. parsing a few bytes is short, the queue decouples both
+		HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, 0, 0);
+		HAL_NVIC_EnableIRQ(DMA1_Stream2_IRQn);
+		HAL_NVIC_SetPriority(USART2_IRQn, 0, 0);
+		HAL_NVIC_EnableIRQ(USART2_IRQn);
+	}
+}
+
+void HAL_UART_MspDeInit(UART_HandleTypeDef *huart)
+{
+	if (huart->Instance == USART2)
+	{
+		__HAL_RCC_USART2_CLK_DISABLE();
+		HAL_GPIO_DeInit(GPIOD, GPIO_PIN_6);
+		HAL_DMA_DeInit(huart->hdmarx);
+		HAL_NVIC_DisableIRQ(DMA1_Stream2_IRQn);
+		HAL_NVIC_DisableIRQ(USART2_IRQn);
+	}
+}
+
+#endif // MIDI
@@ -0,0 +1,123 @@
+// midi.h, Michael Haselberger
+// Description: This file contains declarations for the MIDI input implemented in midi.c
+
+#ifndef __MIDI_H__
+#define __MIDI_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+#include "ring_buffer_typed.h"
+
+#define MIDI_BAUD_RATE (31250)
+// bytes of the circular DMA buffer. multiple of the cache line. 64 bytes last 20 ms at the full MIDI rate
+#define MIDI_RX_BUFFER_SIZE (64)
+// events between two audio blocks. has to be a power of two (see RING_BUFFER_TYPED)
+#define MIDI_QUEUE_SIZE (32)
+// receive channel (0 = MIDI channel 1). MIDI_OMNI: every channel
+#define MIDI_OMNI (0xFF)
+#define MIDI_CHANNEL (MIDI_OMNI)
+
+// controller numbers of the parameters. only parameters that are a plain smoothed target (a float the *_update function
+// only stores) are assigned, they can be set from the audio context at any time. gains, filters and thresholds rebuild
+// tables or coefficient sets with a single writer (the menu) and stay in the menu
+#define MIDI_CC_DELAY_FEEDBACK (20)
+#define MIDI_CC_DELAY_BLEND (21)
+#define MIDI_CC_FUZZ_MIX (22)
+#define MIDI_CC_TREMOLO_DEPTH (23)
+#define MIDI_CC_RING_MOD_DEPTH (24)
+#define MIDI_CC_CHORUS_RATE (25)
+#define MIDI_CC_CHORUS_DEPTH (26)
+#define MIDI_CC_CHORUS_BLEND (27)
+#define MIDI_CC_FLANGER_RATE (28)
+#define MIDI_CC_FLANGER_DEPTH (29)
+#define MIDI_CC_FLANGER_FEEDBACK (30)
+#define MIDI_CC_CAB_MIX (31)
+#define MIDI_CC_PITCH_BLEND (102)
+// effects 1 depth, the usual reverb send
+#define MIDI_CC_REVERB_BLEND (91)
+// sources of the modulation matrix (mod_matrix.h): modulation wheel and expression controller
+#define MIDI_CC_MOD_WHEEL (1)
+#define MIDI_CC_EXPRESSION (11)
+
+typedef enum
+{
+	MIDI_CONTROL_CHANGE = 0,
+	MIDI_PROGRAM_CHANGE
+} midi_event_type;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Channel message for the audio context.
+*
+*   Members:
+*   type:               midi_event_type.
+*   channel:            MIDI channel, 0 to 15.
+*   number:             Controller number (control change) or program (program change).
+*   value:              Controller value, 0 to 127. 0 for program changes.
+*   time:               DWT cycle count when the message was complete. The audio processing turns it into the sample
+*                       of the block the message falls into.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t type;
+	uint8_t channel;
+	uint8_t number;
+	uint8_t value;
+	uint32_t time;
+} midi_event_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Event queue: a lock-free single-producer/single-consumer ring buffer (ring_buffer_typed.h) of events. The UART
+*   interrupt puts, the audio processing (PendSV) takes the events of every block at its start. An event received after
+*   the block was captured stays in the queue (peek without release) until the block it belongs to. Events that find the
+*   queue full are counted and dropped, the UART interrupt never waits.
+*
+*   Members:
+*   events:             Ring buffer of the events.
+*   dropped:            Events lost to a full queue.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+RING_BUFFER_TYPED(midi_event_queue, midi_event_t, MIDI_QUEUE_SIZE)
+
+typedef struct
+{
+	midi_event_queue_t events;
+	volatile uint32_t dropped;
+} midi_queue_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Byte stream parser with running status. Real-time messages (clock, start, continue) may appear between any two bytes
+*   and are handled at once (tempo.h), system exclusive and system common messages are skipped.
+*
+*   Members:
+*   status:             Status byte of the current channel message, 0 while none is running.
+*   data:               Data bytes received so far.
+*   count:              Number of data bytes in data.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t status;
+	uint8_t data[2];
+	uint8_t count;
+} midi_parser_t;
+
+extern UART_HandleTypeDef huart_midi;
+extern DMA_HandleTypeDef hdma_midi_rx;
+
+uint8_t midi_init(void);
+void midi_receive(const uint8_t *bytes, uint32_t length);
+uint8_t midi_parse(midi_parser_t *parser, uint8_t byte, midi_event_t *event);
+uint8_t midi_peek(midi_event_t *event);
+void midi_release(void);
+uint32_t midi_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __MIDI_H__
@@ -0,0 +1,260 @@
+// mod_matrix.c, Michael Haselberger
+// Description: Modulation matrix. LFOs, an envelope follower of the input, a MIDI controller and the expression pedal
+// modulate the parameters of the effects at control rate: one value per source and block, added to the parameter with
+// the depth of the route. The smoother of the parameter spreads the change over the block, so the modulation costs a
+// few scalar operations per route and block instead of a modulator per sample in every effect.
+
+#include "stm32h7xx_hal.h"
+#include "mod_matrix.h"
+
+/******************************************************************************
+* Function Name: mod_matrix_init
+*******************************************************************************
+* Summary:
+*  Initialize the matrix without routes. The LFOs are sine waves at 1 Hz, the external sources
+*  are 0.
+*
+* Parameters:
+*  1. mod_matrix_t *mm				- Address pointer of the matrix struct.
+* Return:
+*  255:								- Matrix points to NULL.
+*  253:								- Oscillator error.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t mod_matrix_init(mod_matrix_t *mm)
+{
+	if (mm == NULL)
+	{
+		return 255;
+	}
+	for (uint8_t i = 0; i < MOD_LFOS; ++i)
+	{
+		if (oscillator_init(&mm->lfo[i], OSC_SINE))
+		{
+			return 253;
+		}
+		mm->lfo_rate[i] = 1.0f;
+	}
+	for (uint8_t i = 0; i < (MOD_SOURCES - MOD_CC); ++i)
+	{
+		mm->external[i] = 0.0f;
+	}
+	for (uint8_t i = 0; i < MOD_SOURCES; ++i)
+	{
+		mm->value[i] = 0.0f;
+	}
+	mm->destinations = 0;
+	mm->routes = 0;
+	mm->clear = false;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: mod_matrix_set_lfo
+*******************************************************************************
+* Summary:
+*  Set waveform and rate of an LFO. The phase continues.
+*
+* Parameters:
+*  1. mod_matrix_t *mm				- Address pointer of an initialized matrix struct.
+*  2. uint8_t lfo					- Index of the LFO. Range: 0 <= lfo < MOD_LFOS.
+*  3. oscillator_waveform waveform	- Any waveform of oscillator.h (OSC_HANN from 0 to 1).
+*  4. float32_t rate				- Frequency in Hz. Range: 0 <= rate <= MOD_LFO_MAX_RATE_HZ.
+* Return:
+*  255:								- Unknown LFO.
+*  254:								- Unknown waveform or rate out of range.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t mod_matrix_set_lfo(mod_matrix_t *mm, uint8_t lfo, oscillator_waveform waveform, float32_t rate)
+{
+	if (lfo >= MOD_LFOS)
+	{
+		return 255;
+	}
+	if ((rate < 0.0f) || (rate > MOD_LFO_MAX_RATE_HZ) || oscillator_set_waveform(&mm->lfo[lfo], waveform))
+	{
+		return 254;
+	}
+	mm->lfo_rate[lfo] = rate;
+	return 0;
+}
+
+// value of an external source (MOD_CC, MOD_EXPRESSION, MOD_PEDAL) from 0 to 1, used from the next block on. any context
+void mod_matrix_set_source(mod_matrix_t *mm, mod_source source, float32_t value)
+{
+	if ((source < MOD_CC) || (source >= MOD_SOURCES))
+	{
+		return;
+	}
+	mm->external[source - MOD_CC] = fminf(fmaxf(value, 0.0f), 1.0f);
+}
+
+/******************************************************************************
+* Function Name: mod_matrix_connect
+*******************************************************************************
+* Summary:
+*  Route a source to a parameter. The parameter has to be a plain smoothed target of an effect
+*  handle (see mod_destination_t), its current value becomes the base the modulation is added
+*  to. Routes to the same parameter add up. The route is filled in before it's counted, the
+*  audio processing picks it up with its next block. Call from the menu.
+*
+* Parameters:
+*  1. mod_matrix_t *mm				- Address pointer of an initialized matrix struct.
+*  2. mod_source source				- Modulation source.
+*  3. volatile float32_t *target	- Parameter field of the effect handle.
+*  4. float32_t depth				- Change of the parameter per unit of the source.
+*  5. float32_t min					- Lower limit of the modulated parameter.
+*  6. float32_t max					- Upper limit of the modulated parameter.
+*  7. uint8_t *route				- Index of the new route, for mod_matrix_set_depth.
+* Return:
+*  255:								- No free route or destination.
+*  254:								- Unknown source, target points to NULL or min > max.
+*  253:								- mod_matrix_clear is still pending.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t mod_matrix_connect(mod_matrix_t *mm, mod_source source, volatile float32_t *target, float32_t depth, float32_t min, float32_t max, uint8_t *route)
+{
+	if (mm->clear)
+	{
+		return 253;
+	}
+	if ((source >= MOD_SOURCES) || (target == NULL) || (min > max))
+	{
+		return 254;
+	}
+
+	const uint8_t routes = mm->routes;
+	const uint8_t destinations = mm->destinations;
+	uint8_t d = 0;
+	while ((d < destinations) && (mm->destination[d].target != target))
+	{
+		d++;
+	}
+	if ((routes == MOD_ROUTES) || (d == MOD_DESTINATIONS))
+	{
+		return 255;
+	}
+
+	if (d == destinations)
+	{
+		mod_destination_t *dest = &mm->destination[d];
+		dest->target = target;
+		dest->base = *target;
+		dest->written = *target;
+		dest->min = min;
+		dest->max = max;
+		// the destination is complete before the audio processing counts it
+		__DMB();
+		mm->destinations = destinations + 1;
+	}
+
+	mod_route_t *r = &mm->route[routes];
+	r->source = source;
+	r->destination = d;
+	r->depth = depth;
+	__DMB();
+	mm->routes = routes + 1;
+	*route = routes;
+	return 0;
+}
+
+// depth of a route, used from the next block on
+uint8_t mod_matrix_set_depth(mod_matrix_t *mm, uint8_t route, float32_t depth)
+{
+	if (route >= mm->routes)
+	{
+		return 255;
+	}
+	mm->route[route].depth = depth;
+	return 0;
+}
+
+// remove all routes. the audio processing sets the parameters back to their bases with its next block, until then
+// mod_matrix_connect is refused
+void mod_matrix_clear(mod_matrix_t *mm)
+{
+	mm->clear = true;
+}
+
+/******************************************************************************
+* Function Name: mod_matrix_process
+*******************************************************************************
+* Summary:
+*  Evaluate the matrix for the next block: advance the LFOs by one block, take the input
+*  envelope, then add depth * source of every route to the base of its destination and store
+*  the limited sum into the parameter. A parameter that differs from the value stored last was
+*  changed by the menu meanwhile, it's the new base. Call from the audio processing before the
+*  effect chain.
+*
+* Parameters:
+*  1. mod_matrix_t *mm				- Address pointer of an initialized matrix struct.
+*  2. float32_t envelope			- Envelope of the unprocessed input after this block, 0 to 1
+*									  (the detector the ducking delay shares, main.c).
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void mod_matrix_process(mod_matrix_t *mm, float32_t envelope, uint32_t block_size)
+{
+	if (mm->clear)
+	{
+		for (uint8_t d = 0; d < mm->destinations; ++d)
+		{
+			*mm->destination[d].target = mm->destination[d].base;
+		}
+		mm->routes = 0;
+		mm->destinations = 0;
+		__DMB();
+		mm->clear = false;
+		return;
+	}
+
+	// routes and destinations are counted after they're complete
+	const uint8_t routes = mm->routes;
+	const uint8_t destinations = mm->destinations;
+	__DMB();
+	if (routes == 0)
+	{
+		return;
+	}
+
+	// one LFO sample per block: the phase advances by a whole block
+	for (uint8_t i = 0; i < MOD_LFOS; ++i)
+	{
+		oscillator_generate(&mm->lfo[i], &mm->value[MOD_LFO1 + i], mm->lfo_rate[i] * block_size, 1);
+	}
+	mm->value[MOD_ENVELOPE] = envelope;
+	for (uint8_t i = MOD_CC; i < MOD_SOURCES; ++i)
+	{
+		mm->value[i] = mm->external[i - MOD_CC];
+	}
+
+	float32_t sum[MOD_DESTINATIONS];
+	for (uint8_t d = 0; d < destinations; ++d)
+	{
+		mod_destination_t *dest = &mm->destination[d];
+		const float32_t current = *dest->target;
+		if (current != dest->written)
+		{
+			dest->base = current;
+		}
+		sum[d] = dest->base;
+	}
+	for (uint8_t r = 0; r < routes; ++r)
+	{
+		const mod_route_t *route = &mm->route[r];
+		sum[route->destination] += route->depth * mm->value[route->source];
+	}
+	for (uint8_t d = 0; d < destinations; ++d)
+	{
+		mod_destination_t *dest = &mm->destination[d];
+		const float32_t value = fminf(fmaxf(sum[d], dest->min), dest->max);
+		*dest->target = value;
+		dest->written = value;
+	}
+}
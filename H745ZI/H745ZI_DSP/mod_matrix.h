@@ -0,0 +1,113 @@
+// mod_matrix.h, Michael Haselberger
+// Description: This file contains declarations for the modulation matrix implemented in mod_matrix.c
+
+#ifndef __MOD_MATRIX_H__
+#define __MOD_MATRIX_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+#include "oscillator.h"
+
+// LFOs of the oscillator bank
+#define MOD_LFOS (2)
+#define MOD_LFO_MAX_RATE_HZ (20.0f)
+// routes and distinct destinations (a destination modulated by several sources adds them up)
+#define MOD_ROUTES (8)
+#define MOD_DESTINATIONS (8)
+
+// LFOs: -1 to 1. envelope: block peak envelope of the input (passed to mod_matrix_process), 0 to 1. CC, expression and pedal: 0 to 1, set with mod_matrix_set_source
+typedef enum
+{
+	MOD_LFO1 = 0,
+	MOD_LFO2,
+	MOD_ENVELOPE,
+	MOD_CC,
+	MOD_EXPRESSION,
+	MOD_PEDAL,
+	MOD_SOURCES
+} mod_source;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Destination of the modulation: a plain smoothed target of an effect handle (a float the *_update function only stores,
+*   the same parameters MIDI controls, see midi.h). The matrix writes it once per block, the smoother of the effect turns
+*   it into a ramp over the block.
+*
+*   Members:
+*   target:             The parameter field of the effect handle.
+*   base:               Value without modulation. Taken over from target whenever the menu changed it.
+*   written:            Value the matrix wrote last, tells a change by the menu apart.
+*   min, max:           Range the modulated value is limited to (the range of the *_update function).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile float32_t *target;
+	float32_t base;
+	float32_t written;
+	float32_t min;
+	float32_t max;
+} mod_destination_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Route of a source to a destination.
+*
+*   Members:
+*   source:             mod_source.
+*   destination:        Index into the destinations of the matrix.
+*   depth:              Change of the parameter per unit of the source. May be changed at any time.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t source;
+	uint8_t destination;
+	volatile float32_t depth;
+} mod_route_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Modulation matrix, evaluated once per block by the audio processing before the effect chain: every source is one value
+*   per block, every route a multiply-add, every destination one store. The cost grows with the routes, not with the
+*   block size. The routes are set up by the menu (one writer), the audio processing only sees a route once it's complete.
+*
+*   Members:
+*   lfo:                Oscillator bank, advanced by one block per evaluation.
+*   lfo_rate:           Frequency of each LFO in Hz. Range: 0 to MOD_LFO_MAX_RATE_HZ.
+*   external:           CC, expression and pedal values, written by mod_matrix_set_source.
+*   value:              Source values of the last block.
+*   destination:        Destinations, the first destinations are in use.
+*   destinations:       Number of destinations in use.
+*   route:              Routes, the first routes are in use.
+*   routes:             Number of routes in use. Incremented after the route is complete.
+*   clear:              Set by mod_matrix_clear, the audio processing restores the bases and removes all routes.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	oscillator_t lfo[MOD_LFOS];
+	volatile float32_t lfo_rate[MOD_LFOS];
+	volatile float32_t external[MOD_SOURCES - MOD_CC];
+	float32_t value[MOD_SOURCES];
+	mod_destination_t destination[MOD_DESTINATIONS];
+	volatile uint8_t destinations;
+	mod_route_t route[MOD_ROUTES];
+	volatile uint8_t routes;
+	volatile bool clear;
+} mod_matrix_t;
+
+uint8_t mod_matrix_init(mod_matrix_t *mm);
+uint8_t mod_matrix_set_lfo(mod_matrix_t *mm, uint8_t lfo, oscillator_waveform waveform, float32_t rate);
+void mod_matrix_set_source(mod_matrix_t *mm, mod_source source, float32_t value);
+uint8_t mod_matrix_connect(mod_matrix_t *mm, mod_source source, volatile float32_t *target, float32_t depth, float32_t min, float32_t max, uint8_t *route);
+uint8_t mod_matrix_set_depth(mod_matrix_t *mm, uint8_t route, float32_t depth);
+void mod_matrix_clear(mod_matrix_t *mm);
+void mod_matrix_process(mod_matrix_t *mm, float32_t envelope, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __MOD_MATRIX_H__
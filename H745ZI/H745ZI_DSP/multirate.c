@@ -0,0 +1,204 @@
+// multirate.c, Michael Haselberger
+// Description: Decimated processing for effects that don't need the whole audio band. A dark delay or a spring
+// style reverb loses nothing above 10 kHz, so its wet path can run at half or a quarter of the sample rate between a
+// CMSIS FIR decimator and a polyphase interpolator: the cycles per block and the memory per second of delay shrink by
+// the factor, the two filters cost about as much as two short FIRs at the full rate.
+
+#include "multirate.h"
+#include "scratch_pool.h"
+
+// prototype lowpass cutoff relative to the Nyquist frequency of the decimated rate. the rest is the transition band
+#define MULTIRATE_CUTOFF 0.9f
+
+// filter memory of one instance: decimator (numTaps + blockSize - 1), interpolator (numTaps / L + blockSize / L - 1)
+#define DECIMATOR_STATE_SIZE (MULTIRATE_MAX_TAPS + MAX_BLOCK_SIZE - 1)
+#define INTERPOLATOR_STATE_SIZE (MULTIRATE_TAPS_PER_PHASE + MAX_BLOCK_SIZE - 1)
+
+#if (MULTIRATE_MAX_INSTANCES > 0)
+static sample_t __attribute__((aligned(32))) DTCM_BSS state_pool[MULTIRATE_MAX_INSTANCES][DECIMATOR_STATE_SIZE + INTERPOLATOR_STATE_SIZE];
+static uint8_t pool_used = 0;
+#endif
+
+// lowpass of the factors 2 and 4. the interpolator coefficients are scaled by the factor to make up for the inserted
+// zeros. the cutoff is relative, so the filters don't depend on the sample rate
+static sample_t decimator_coeffs[2][MULTIRATE_MAX_TAPS];
+static sample_t interpolator_coeffs[2][MULTIRATE_MAX_TAPS];
+static bool designed = false;
+
+static inline bool valid_factor(uint8_t factor)
+{
+	return ((factor == 1) || (factor == 2) || (factor == 4)) ? true : false;
+}
+
+// row of the coefficient tables: 2 -> 0, 4 -> 1
+static inline uint8_t factor_index(uint8_t factor)
+{
+	return (factor == 2) ? 0 : 1;
+}
+
+/******************************************************************************
+* Function Name: design_filters
+*******************************************************************************
+* Summary:
+*  Design the Blackman windowed sinc lowpass of both factors, as the oversampler does it.
+*  Symmetric, so the time reversed coefficient order CMSIS expects doesn't matter. Normalized
+*  to unity DC gain. With SAMPLE_Q31 the taps are converted, the largest interpolator tap is
+*  about MULTIRATE_CUTOFF and stays below 1.
+*
+******************************************************************************/
+static void design_filters(void)
+{
+	float32_t h[MULTIRATE_MAX_TAPS];
+	for (uint8_t factor = 2; factor <= MULTIRATE_MAX_FACTOR; factor <<= 1)
+	{
+		const uint32_t taps = MULTIRATE_TAPS_PER_PHASE * factor;
+		// cutoff relative to the full rate
+		const float32_t fc = 0.5f * MULTIRATE_CUTOFF / factor;
+		float32_t sum = 0;
+
+		for (uint32_t k = 0; k < taps; ++k)
+		{
+			const float32_t t = (float32_t)k - 0.5f * (taps - 1);
+			const float32_t x = 2.0f * PI * fc * t;
+			const float32_t sinc = (t == 0) ? 2.0f * fc : 2.0f * fc * arm_sin_f32(x) / x;
+			const float32_t phase = 2.0f * PI * k / (taps - 1);
+			const float32_t window = 0.42f - 0.5f * arm_cos_f32(phase) + 0.08f * arm_cos_f32(2.0f * phase);
+			h[k] = sinc * window;
+			sum += h[k];
+		}
+		const uint8_t index = factor_index(factor);
+		for (uint32_t k = 0; k < taps; ++k)
+		{
+			h[k] /= sum;
+#if defined(SAMPLE_Q31)
+			decimator_coeffs[index][k] = (q31_t)(h[k] * 2147483647.0f);
+			interpolator_coeffs[index][k] = (q31_t)(h[k] * factor * 2147483647.0f);
+#else
+			decimator_coeffs[index][k] = h[k];
+			interpolator_coeffs[index][k] = h[k] * factor;
+#endif
+		}
+	}
+	designed = true;
+}
+
+// set up the CMSIS instances for the factor. clears the filter memory
+static void configure(multirate_t *mr)
+{
+	const uint8_t factor = mr->factor;
+	if (factor <= 1)
+		return;
+
+	const uint16_t taps = MULTIRATE_TAPS_PER_PHASE * factor;
+	const uint8_t index = factor_index(factor);
+	// the block size only determines how much state is cleared, the actual size is passed with every block
+#if defined(SAMPLE_Q31)
+	arm_fir_decimate_init_q31(&mr->decimator, taps, factor, decimator_coeffs[index], mr->decimator_state, MAX_BLOCK_SIZE);
+	arm_fir_interpolate_init_q31(&mr->interpolator, factor, taps, interpolator_coeffs[index], mr->interpolator_state, MAX_BLOCK_SIZE / factor);
+#else
+	arm_fir_decimate_init_f32(&mr->decimator, taps, factor, decimator_coeffs[index], mr->decimator_state, MAX_BLOCK_SIZE);
+	arm_fir_interpolate_init_f32(&mr->interpolator, factor, taps, interpolator_coeffs[index], mr->interpolator_state, MAX_BLOCK_SIZE / factor);
+#endif
+}
+
+/******************************************************************************
+* Function Name: multirate_init
+*******************************************************************************
+* Summary:
+*  Initialize a decimated stage. The filter memory is taken from a static pool in DTCM the
+*  first time, later calls reuse it. Call from the main loop while the stage isn't processed.
+*
+* Parameters:
+*  1. multirate_t *mr				- Address pointer of the stage struct.
+*  2. uint8_t factor				- Decimation factor: 1 (off), 2 or 4.
+* Return:
+*  255:								- Stage points to NULL.
+*  254:								- Factor not supported.
+*  253:								- Filter memory pool exhausted (see MULTIRATE_MAX_INSTANCES, none without DELAY_DECIMATION).
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t multirate_init(multirate_t *mr, uint8_t factor)
+{
+	if (mr == NULL)
+	{
+		return 255;
+	}
+	if (!valid_factor(factor))
+	{
+		return 254;
+	}
+	if ((factor > 1) && (mr->decimator_state == NULL))
+	{
+#if (MULTIRATE_MAX_INSTANCES > 0)
+		if (pool_used >= MULTIRATE_MAX_INSTANCES)
+		{
+			return 253;
+		}
+		mr->decimator_state = state_pool[pool_used];
+		mr->interpolator_state = &state_pool[pool_used][DECIMATOR_STATE_SIZE];
+		pool_used++;
+#else
+		return 253;
+#endif
+	}
+	if (!designed)
+	{
+		design_filters();
+	}
+
+	mr->factor = factor;
+	configure(mr);
+	return 0;
+}
+
+// clear the filter memory, e.g. when the node is switched on again. nothing to do on a stage never initialized
+void multirate_reset(multirate_t *mr)
+{
+	configure(mr);
+}
+
+/******************************************************************************
+* Function Name: multirate_process
+*******************************************************************************
+* Summary:
+*  Run a node at the decimated rate: decimate, process, interpolate. The decimated blocks are
+*  taken from the scratch pool. Without decimation the node runs on the block itself.
+*
+* Parameters:
+*  1. multirate_t *mr				- Address pointer of an initialized stage struct.
+*  2. const sample_t *src			- Input block.
+*  3. sample_t *dst					- Output block.
+*  4. uint32_t block_size			- Number of samples in src and dst. A multiple of the factor, at most
+*									  MAX_BLOCK_SIZE.
+*  5. multirate_node node			- Processing. Gets block_size / factor samples, in and out don't overlap.
+*  6. void *ctx						- Context passed to node.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void multirate_process(multirate_t *mr, const sample_t *src, sample_t *dst, uint32_t block_size, multirate_node node, void *ctx)
+{
+	const uint8_t factor = mr->factor;
+	if (factor == 1)
+	{
+		node(ctx, src, dst, block_size);
+		return;
+	}
+
+	const uint32_t n = block_size / factor;
+	const scratch_mark_t mark = scratch_pool_mark();
+	sample_t *low_in = scratch_pool_alloc(n * sizeof(sample_t));
+	sample_t *low_out = scratch_pool_alloc(n * sizeof(sample_t));
+#if defined(SAMPLE_Q31)
+	arm_fir_decimate_q31(&mr->decimator, src, low_in, block_size);
+	node(ctx, low_in, low_out, n);
+	arm_fir_interpolate_q31(&mr->interpolator, low_out, dst, n);
+#else
+	arm_fir_decimate_f32(&mr->decimator, src, low_in, block_size);
+	node(ctx, low_in, low_out, n);
+	arm_fir_interpolate_f32(&mr->interpolator, low_out, dst, n);
+#endif
+	scratch_pool_release(mark);
+}
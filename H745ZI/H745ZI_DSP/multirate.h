@@ -0,0 +1,76 @@
+// multirate.h, Michael Haselberger
+// Description: This file contains declarations for the decimated processing stage implemented in multirate.c
+
+#ifndef __MULTIRATE_H__
+#define __MULTIRATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// decimation factors: 1 (off), 2 or 4
+#define MULTIRATE_MAX_FACTOR 4
+// filter length per polyphase branch. the prototype lowpass has MULTIRATE_TAPS_PER_PHASE * factor taps
+#define MULTIRATE_TAPS_PER_PHASE 16
+#define MULTIRATE_MAX_TAPS (MULTIRATE_TAPS_PER_PHASE * MULTIRATE_MAX_FACTOR)
+// stages that can be initialized (the delay of every channel). none without DELAY_DECIMATION: the filter memory
+// stays out of DTCM
+#ifndef MULTIRATE_MAX_INSTANCES
+#if (DELAY_DECIMATION > 1)
+#define MULTIRATE_MAX_INSTANCES (AUDIO_CHANNELS)
+#else
+#define MULTIRATE_MAX_INSTANCES (0)
+#endif
+#endif
+
+// processing run at the decimated rate. same interface as a chain node (fx_process_t)
+typedef void (*multirate_node)(void *ctx, const sample_t *in, sample_t *out, uint32_t n);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Decimated processing of a node that doesn't need the whole audio band, e.g. the wet path of a dark delay.
+*   The block is low passed and decimated by factor, processed at the lower rate and interpolated back with a polyphase
+*   FIR. The node runs on a factor times shorter block and keeps its history in factor times fewer samples. Both
+*   filters are linear phase with the cutoff at 90 % of the lower Nyquist frequency (10.8 kHz at factor 2 and 48 kHz)
+*   and delay the signal by multirate_latency samples together. The state is in sample_t, q31 with SAMPLE_Q31.
+*
+*   Members:
+*   factor:             Decimation factor the filters are initialized for.
+*   decimator:          CMSIS decimator (lowpass + every factor-th sample).
+*   interpolator:       CMSIS polyphase interpolator (factor - 1 zeros between the samples + lowpass).
+*   decimator_state:    Memory of the filters, taken from a static pool in DTCM.
+*   interpolator_state:
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t factor;
+#if defined(SAMPLE_Q31)
+	arm_fir_decimate_instance_q31 decimator;
+	arm_fir_interpolate_instance_q31 interpolator;
+#else
+	arm_fir_decimate_instance_f32 decimator;
+	arm_fir_interpolate_instance_f32 interpolator;
+#endif
+	sample_t *decimator_state;
+	sample_t *interpolator_state;
+} multirate_t;
+
+// samples the output of multirate_process lags its input: each filter delays by (taps - 1) / 2 at the full rate.
+// 0 without decimation
+static inline uint32_t multirate_latency(const multirate_t *mr)
+{
+	return (mr->factor > 1) ? MULTIRATE_TAPS_PER_PHASE * mr->factor - 1 : 0;
+}
+
+uint8_t multirate_init(multirate_t *mr, uint8_t factor);
+void multirate_reset(multirate_t *mr);
+void multirate_process(multirate_t *mr, const sample_t *src, sample_t *dst, uint32_t block_size, multirate_node node, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __MULTIRATE_H__
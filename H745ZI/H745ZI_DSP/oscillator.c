@@ -0,0 +1,238 @@
+// oscillator.c, Michael Haselberger
+// Description: Phase accumulator oscillator with wavetable lookup. Replaces evaluating arm_sin_f32 (and asin in
+// double precision for the triangle) for every sample of the tremolo and ring modulator. The modulation signal is
+// generated for the whole block, the effect then applies it with CMSIS vector functions. The PolyBLEP waveforms replace
+// the naive sign of a sine and asin(cos) of the old ring modulator carriers.
+
+#include "oscillator.h"
+
+// fractional part of the phase below the table index
+#define FRACTION_BITS (32 - OSCILLATOR_TABLE_BITS)
+
+// one cycle of every waveform plus the first point repeated, so the interpolation never wraps. generated by
+// Python/generate_tables.py (dsp_helpers.oscillator_wavetables, in double precision) and copied into the DTCM at reset.
+// triangle and square are band-limited to OSCILLATOR_HARMONICS, so a fast modulator doesn't alias. the phase matches
+// the old waveform functions: sine and square start at 0 going up, the triangle starts at 1, the Hann window starts at
+// 0 and peaks at half the cycle
+#include "oscillator_tables.h"
+_Static_assert((WAVETABLE_BITS == OSCILLATOR_TABLE_BITS) && (WAVETABLE_HARMONICS == OSCILLATOR_HARMONICS),
+	"oscillator_tables.h has to be generated for OSCILLATOR_TABLE_BITS and OSCILLATOR_HARMONICS");
+
+// correction of a step of -2 at phase 0 (2-point PolyBLEP), t the phase in cycles and dt the increment. the square
+// steps +2 at 0 and -2 at half the cycle
+static inline float32_t poly_blep(float32_t t, float32_t dt, float32_t inv_dt)
+{
+	if (t < dt)
+	{
+		const float32_t x = t * inv_dt;
+		return x + x - x * x - 1.0f;
+	}
+	if (t > 1.0f - dt)
+	{
+		const float32_t x = (t - 1.0f) * inv_dt;
+		return x * x + x + x + 1.0f;
+	}
+	return 0.0f;
+}
+
+// correction of a slope change of 2 per cycle at phase 0 (PolyBLAMP, the integral of poly_blep), in units of dt
+static inline float32_t poly_blamp(float32_t t, float32_t dt, float32_t inv_dt)
+{
+	if (t < dt)
+	{
+		const float32_t x = t * inv_dt - 1.0f;
+		return (-1.0f / 3.0f) * x * x * x;
+	}
+	if (t > 1.0f - dt)
+	{
+		const float32_t x = (t - 1.0f) * inv_dt + 1.0f;
+		return (1.0f / 3.0f) * x * x * x;
+	}
+	return 0.0f;
+}
+
+/******************************************************************************
+* Function Name: blep_generate
+*******************************************************************************
+* Summary:
+*  Write one block of a PolyBLEP waveform from the phase: the naive waveform plus a polynomial
+*  correction within one sample of every edge (square, saw) or corner (triangle). A few compares
+*  per sample away from the edges.
+*
+* Parameters:
+*  1. oscillator_waveform waveform	- OSC_SAW_BLEP, OSC_SQUARE_BLEP or OSC_TRIANGLE_BLEP.
+*  2. uint32_t phase				- Phase of the first sample, 2^32 = one cycle.
+*  3. uint32_t increment			- Phase increment per sample.
+*  4. float32_t *dst				- Output block, values between -1 and 1.
+*  5. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void blep_generate(oscillator_waveform waveform, uint32_t phase, uint32_t increment, float32_t *dst, uint32_t block_size)
+{
+	const float32_t dt = (float32_t)increment * (1.0f / 4294967296.0f);
+	// a standing oscillator never reaches the corrections
+	const float32_t inv_dt = (increment != 0) ? (1.0f / dt) : 0.0f;
+
+	switch (waveform)
+	{
+	case OSC_SAW_BLEP:
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			const float32_t t = (float32_t)phase * (1.0f / 4294967296.0f);
+			dst[i] = 2.0f * t - 1.0f - poly_blep(t, dt, inv_dt);
+			phase += increment;
+		}
+		break;
+	case OSC_SQUARE_BLEP:
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			const float32_t t = (float32_t)phase * (1.0f / 4294967296.0f);
+			// the phase half a cycle on, the falling edge at its 0
+			const float32_t h = (float32_t)(phase + 0x80000000u) * (1.0f / 4294967296.0f);
+			const float32_t naive = (phase < 0x80000000u) ? 1.0f : -1.0f;
+			dst[i] = naive + poly_blep(t, dt, inv_dt) - poly_blep(h, dt, inv_dt);
+			phase += increment;
+		}
+		break;
+	default:
+		// |4t - 2| - 1: 1 at phase 0, -1 at half the cycle. the slope changes by -8 and +8 per cycle there, 4 * poly_blamp
+		for (uint32_t i = 0; i < block_size; ++i)
+		{
+			const float32_t t = (float32_t)phase * (1.0f / 4294967296.0f);
+			const float32_t h = (float32_t)(phase + 0x80000000u) * (1.0f / 4294967296.0f);
+			const float32_t naive = fabsf(4.0f * t - 2.0f) - 1.0f;
+			dst[i] = naive + 4.0f * dt * (poly_blamp(h, dt, inv_dt) - poly_blamp(t, dt, inv_dt));
+			phase += increment;
+		}
+		break;
+	}
+}
+
+/******************************************************************************
+* Function Name: oscillator_init
+*******************************************************************************
+* Summary:
+*  Initialize an oscillator at phase 0.
+*
+* Parameters:
+*  1. oscillator_t *osc				- Address pointer of the oscillator struct.
+*  2. oscillator_waveform waveform	- A table waveform (OSC_SINE to OSC_HANN) or a *_BLEP waveform.
+* Return:
+*  255:								- Oscillator points to NULL.
+*  254:								- Unknown waveform.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t oscillator_init(oscillator_t *osc, oscillator_waveform waveform)
+{
+	if (osc == NULL)
+	{
+		return 255;
+	}
+	if (waveform >= OSC_WAVEFORMS)
+	{
+		return 254;
+	}
+	osc->phase = 0;
+	osc->waveform = waveform;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: oscillator_set_waveform
+*******************************************************************************
+* Summary:
+*  Switch the waveform. The phase continues.
+*
+* Parameters:
+*  1. oscillator_t *osc				- Address pointer of the oscillator struct.
+*  2. oscillator_waveform waveform	- A table waveform (OSC_SINE to OSC_HANN) or a *_BLEP waveform.
+* Return:
+*  254:								- Unknown waveform.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t oscillator_set_waveform(oscillator_t *osc, oscillator_waveform waveform)
+{
+	if (waveform >= OSC_WAVEFORMS)
+	{
+		return 254;
+	}
+	osc->waveform = waveform;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: oscillator_generate
+*******************************************************************************
+* Summary:
+*  Write one block of the waveform and advance the phase. Per sample only an integer add,
+*  a table lookup and a linear interpolation, or the PolyBLEP waveform (blep_generate).
+*
+* Parameters:
+*  1. oscillator_t *osc				- Address pointer of an initialized oscillator struct.
+*  2. float32_t *dst				- Output block, values between -1 and 1.
+*  3. float32_t frequency			- Frequency in Hz. Range: 0 <= frequency < sample_rate / 2.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void oscillator_generate(oscillator_t *osc, float32_t *dst, float32_t frequency, uint32_t block_size)
+{
+	// phase increment per sample, 2^32 = one cycle
+	const uint32_t increment = (uint32_t)(frequency * (4294967296.0f / sample_rate));
+	uint32_t phase = osc->phase;
+
+	if (osc->waveform >= OSC_SAW_BLEP)
+	{
+		blep_generate(osc->waveform, phase, increment, dst, block_size);
+		osc->phase = phase + increment * block_size;
+		return;
+	}
+	const float32_t *table = wavetable[osc->waveform];
+
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		const uint32_t index = phase >> FRACTION_BITS;
+		const float32_t frac = (float32_t)(phase & ((1u << FRACTION_BITS) - 1)) * (1.0f / (1u << FRACTION_BITS));
+		const float32_t y0 = table[index];
+		dst[i] = y0 + frac * (table[index + 1] - y0);
+		phase += increment;
+	}
+	osc->phase = phase;
+}
+
+/******************************************************************************
+* Function Name: oscillator_ramp
+*******************************************************************************
+* Summary:
+*  Write the phase of the next block as a ramp from 0 to 1 (sawtooth), without advancing the
+*  oscillator. Followed by oscillator_generate with the same frequency, the ramp is exactly
+*  in step with the waveform, e.g. the read position of a grain and its window.
+*
+* Parameters:
+*  1. const oscillator_t *osc		- Address pointer of an initialized oscillator struct.
+*  2. float32_t *dst				- Output block, values between 0 and 1.
+*  3. float32_t frequency			- Frequency in Hz. Range: 0 <= frequency < sample_rate / 2.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void oscillator_ramp(const oscillator_t *osc, float32_t *dst, float32_t frequency, uint32_t block_size)
+{
+	const uint32_t increment = (uint32_t)(frequency * (4294967296.0f / sample_rate));
+	uint32_t phase = osc->phase;
+
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = (float32_t)phase * (1.0f / 4294967296.0f);
+		phase += increment;
+	}
+}
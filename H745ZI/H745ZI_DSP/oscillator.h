@@ -0,0 +1,63 @@
+// oscillator.h, Michael Haselberger
+// Description: This file contains declarations for the oscillator implemented in oscillator.c
+
+#ifndef __OSCILLATOR_H__
+#define __OSCILLATOR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// the wavetables have 2^OSCILLATOR_TABLE_BITS points per cycle. the upper bits of the phase are the table index
+#define OSCILLATOR_TABLE_BITS 10
+#define OSCILLATOR_TABLE_SIZE (1 << OSCILLATOR_TABLE_BITS)
+// harmonics of the band-limited triangle and square tables. enough for a ring modulator carrier of a few hundred Hz
+#define OSCILLATOR_HARMONICS 31
+
+// the table waveforms up to OSC_HANN: triangle and square band-limited to OSCILLATOR_HARMONICS, smooth LFOs. OSC_HANN
+// isn't a modulator: the grain window of the pitch shifter (0 to 1). the *_BLEP waveforms are computed per sample from
+// the phase with PolyBLEP (saw, square) and PolyBLAMP (triangle) corrections at the edges, band-limited up to half the
+// sample rate: audio rate carriers of the ring modulator. same phase as the tables, the saw rises from -1 to 1
+typedef enum
+{
+	OSC_SINE = 0,
+	OSC_TRIANGLE,
+	OSC_SQUARE,
+	OSC_HANN,
+	OSC_SAW_BLEP,
+	OSC_SQUARE_BLEP,
+	OSC_TRIANGLE_BLEP,
+	OSC_WAVEFORMS
+} oscillator_waveform;
+// waveforms with a table in oscillator_tables.h
+#define OSC_TABLES (OSC_HANN + 1)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Wavetable or PolyBLEP oscillator (LFO or modulator). Every effect has its own instance, they all share the tables in DTCM.
+*   The phase is a 32 bit accumulator, which wraps around by itself once per cycle: no float comparisons and no
+*   drift of the phase, no matter how long the oscillator runs.
+*
+*   Members:
+*   phase:              Position in the cycle, 2^32 = one cycle.
+*   waveform:           Table the oscillator reads, or the PolyBLEP waveform it computes.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t phase;
+	oscillator_waveform waveform;
+} oscillator_t;
+
+uint8_t oscillator_init(oscillator_t *osc, oscillator_waveform waveform);
+uint8_t oscillator_set_waveform(oscillator_t *osc, oscillator_waveform waveform);
+void oscillator_generate(oscillator_t *osc, float32_t *dst, float32_t frequency, uint32_t block_size);
+void oscillator_ramp(const oscillator_t *osc, float32_t *dst, float32_t frequency, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __OSCILLATOR_H__
@@ -0,0 +1,530 @@
+// generated by dsp_helpers.export_wavetable_header: 10 bits, 31 harmonics
+#define WAVETABLE_BITS (10)
+#define WAVETABLE_HARMONICS (31)
+static const float32_t __attribute__((aligned(32))) wavetable[OSC_TABLES][OSCILLATOR_TABLE_SIZE + 1] DTCM_INIT = 
+{
+	{
+		0.000000000e+00f, 6.135884649e-03f, 1.227153829e-02f, 1.840672991e-02f, 2.454122852e-02f, 3.067480318e-02f, 3.680722294e-02f, 4.293825693e-02f,
+		4.906767433e-02f, 5.519524435e-02f, 6.132073630e-02f, 6.744391956e-02f, 7.356456360e-02f, 7.968243797e-02f, 8.579731234e-02f, 9.190895650e-02f,
+		9.801714033e-02f, 1.041216339e-01f, 1.102222073e-01f, 1.163186309e-01f, 1.224106752e-01f, 1.284981108e-01f, 1.345807085e-01f, 1.406582393e-01f,
+		1.467304745e-01f, 1.527971853e-01f, 1.588581433e-01f, 1.649131205e-01f, 1.709618888e-01f, 1.770042204e-01f, 1.830398880e-01f, 1.890686641e-01f,
+		1.950903220e-01f, 2.011046348e-01f, 2.071113762e-01f, 2.131103199e-01f, 2.191012402e-01f, 2.250839114e-01f, 2.310581083e-01f, 2.370236060e-01f,
+		2.429801799e-01f, 2.489276057e-01f, 2.548656596e-01f, 2.607941179e-01f, 2.667127575e-01f, 2.726213554e-01f, 2.785196894e-01f, 2.844075372e-01f,
+		2.902846773e-01f, 2.961508882e-01f, 3.020059493e-01f, 3.078496400e-01f, 3.136817404e-01f, 3.195020308e-01f, 3.253102922e-01f, 3.311063058e-01f,
+		3.368898534e-01f, 3.426607173e-01f, 3.484186802e-01f, 3.541635254e-01f, 3.598950365e-01f, 3.656129978e-01f, 3.713171940e-01f, 3.770074102e-01f,
+		3.826834324e-01f, 3.883450467e-01f, 3.939920401e-01f, 3.996241998e-01f, 4.052413140e-01f, 4.108431711e-01f, 4.164295601e-01f, 4.220002708e-01f,
+		4.275550934e-01f, 4.330938189e-01f, 4.386162385e-01f, 4.441221446e-01f, 4.496113297e-01f, 4.550835871e-01f, 4.605387110e-01f, 4.659764958e-01f,
+		4.713967368e-01f, 4.767992301e-01f, 4.821837721e-01f, 4.875501601e-01f, 4.928981922e-01f, 4.982276670e-01f, 5.035383837e-01f, 5.088301425e-01f,
+		5.141027442e-01f, 5.193559902e-01f, 5.245896827e-01f, 5.298036247e-01f, 5.349976199e-01f, 5.401714727e-01f, 5.453249884e-01f, 5.504579729e-01f,
+		5.555702330e-01f, 5.606615762e-01f, 5.657318108e-01f, 5.707807459e-01f, 5.758081914e-01f, 5.808139581e-01f, 5.857978575e-01f, 5.907597019e-01f,
+		5.956993045e-01f, 6.006164794e-01f, 6.055110414e-01f, 6.103828063e-01f, 6.152315906e-01f, 6.200572118e-01f, 6.248594881e-01f, 6.296382389e-01f,
+		6.343932842e-01f, 6.391244449e-01f, 6.438315429e-01f, 6.485144010e-01f, 6.531728430e-01f, 6.578066933e-01f, 6.624157776e-01f, 6.669999223e-01f,
+		6.715589548e-01f, 6.760927036e-01f, 6.806009978e-01f, 6.850836678e-01f, 6.895405447e-01f, 6.939714609e-01f, 6.983762494e-01f, 7.027547445e-01f,
+		7.071067812e-01f, 7.114321957e-01f, 7.157308253e-01f, 7.200025080e-01f, 7.242470830e-01f, 7.284643904e-01f, 7.326542717e-01f, 7.368165689e-01f,
+		7.409511254e-01f, 7.450577854e-01f, 7.491363945e-01f, 7.531867990e-01f, 7.572088465e-01f, 7.612023855e-01f, 7.651672656e-01f, 7.691033376e-01f,
+		7.730104534e-01f, 7.768884657e-01f, 7.807372286e-01f, 7.845565972e-01f, 7.883464276e-01f, 7.921065773e-01f, 7.958369046e-01f, 7.995372691e-01f,
+		8.032075315e-01f, 8.068475535e-01f, 8.104571983e-01f, 8.140363297e-01f, 8.175848132e-01f, 8.211025150e-01f, 8.245893028e-01f, 8.280450453e-01f,
+		8.314696123e-01f, 8.348628750e-01f, 8.382247056e-01f, 8.415549774e-01f, 8.448535652e-01f, 8.481203448e-01f, 8.513551931e-01f, 8.545579884e-01f,
+		8.577286100e-01f, 8.608669386e-01f, 8.639728561e-01f, 8.670462455e-01f, 8.700869911e-01f, 8.730949784e-01f, 8.760700942e-01f, 8.790122264e-01f,
+		8.819212643e-01f, 8.847970984e-01f, 8.876396204e-01f, 8.904487232e-01f, 8.932243012e-01f, 8.959662498e-01f, 8.986744657e-01f, 9.013488470e-01f,
+		9.039892931e-01f, 9.065957045e-01f, 9.091679831e-01f, 9.117060320e-01f, 9.142097557e-01f, 9.166790599e-01f, 9.191138517e-01f, 9.215140393e-01f,
+		9.238795325e-01f, 9.262102421e-01f, 9.285060805e-01f, 9.307669611e-01f, 9.329927988e-01f, 9.351835099e-01f, 9.373390119e-01f, 9.394592236e-01f,
+		9.415440652e-01f, 9.435934582e-01f, 9.456073254e-01f, 9.475855910e-01f, 9.495281806e-01f, 9.514350210e-01f, 9.533060404e-01f, 9.551411683e-01f,
+		9.569403357e-01f, 9.587034749e-01f, 9.604305194e-01f, 9.621214043e-01f, 9.637760658e-01f, 9.653944417e-01f, 9.669764710e-01f, 9.685220943e-01f,
+		9.700312532e-01f, 9.715038910e-01f, 9.729399522e-01f, 9.743393828e-01f, 9.757021300e-01f, 9.770281427e-01f, 9.783173707e-01f, 9.795697657e-01f,
+		9.807852804e-01f, 9.819638691e-01f, 9.831054874e-01f, 9.842100924e-01f, 9.852776424e-01f, 9.863080972e-01f, 9.873014182e-01f, 9.882575677e-01f,
+		9.891765100e-01f, 9.900582103e-01f, 9.909026354e-01f, 9.917097537e-01f, 9.924795346e-01f, 9.932119492e-01f, 9.939069700e-01f, 9.945645707e-01f,
+		9.951847267e-01f, 9.957674145e-01f, 9.963126122e-01f, 9.968202993e-01f, 9.972904567e-01f, 9.977230666e-01f, 9.981181129e-01f, 9.984755806e-01f,
+		9.987954562e-01f, 9.990777278e-01f, 9.993223846e-01f, 9.995294175e-01f, 9.996988187e-01f, 9.998305818e-01f, 9.999247018e-01f, 9.999811753e-01f,
+		1.000000000e+00f, 9.999811753e-01f, 9.999247018e-01f, 9.998305818e-01f, 9.996988187e-01f, 9.995294175e-01f, 9.993223846e-01f, 9.990777278e-01f,
+		9.987954562e-01f, 9.984755806e-01f, 9.981181129e-01f, 9.977230666e-01f, 9.972904567e-01f, 9.968202993e-01f, 9.963126122e-01f, 9.957674145e-01f,
+		9.951847267e-01f, 9.945645707e-01f, 9.939069700e-01f, 9.932119492e-01f, 9.924795346e-01f, 9.917097537e-01f, 9.909026354e-01f, 9.900582103e-01f,
+		9.891765100e-01f, 9.882575677e-01f, 9.873014182e-01f, 9.863080972e-01f, 9.852776424e-01f, 9.842100924e-01f, 9.831054874e-01f, 9.819638691e-01f,
+		9.807852804e-01f, 9.795697657e-01f, 9.783173707e-01f, 9.770281427e-01f, 9.757021300e-01f, 9.743393828e-01f, 9.729399522e-01f, 9.715038910e-01f,
+		9.700312532e-01f, 9.685220943e-01f, 9.669764710e-01f, 9.653944417e-01f, 9.637760658e-01f, 9.621214043e-01f, 9.604305194e-01f, 9.587034749e-01f,
+		9.569403357e-01f, 9.551411683e-01f, 9.533060404e-01f, 9.514350210e-01f, 9.495281806e-01f, 9.475855910e-01f, 9.456073254e-01f, 9.435934582e-01f,
+		9.415440652e-01f, 9.394592236e-01f, 9.373390119e-01f, 9.351835099e-01f, 9.329927988e-01f, 9.307669611e-01f, 9.285060805e-01f, 9.262102421e-01f,
+		9.238795325e-01f, 9.215140393e-01f, 9.191138517e-01f, 9.166790599e-01f, 9.142097557e-01f, 9.117060320e-01f, 9.091679831e-01f, 9.065957045e-01f,
+		9.039892931e-01f, 9.013488470e-01f, 8.986744657e-01f, 8.959662498e-01f, 8.932243012e-01f, 8.904487232e-01f, 8.876396204e-01f, 8.847970984e-01f,
+		8.819212643e-01f, 8.790122264e-01f, 8.760700942e-01f, 8.730949784e-01f, 8.700869911e-01f, 8.670462455e-01f, 8.639728561e-01f, 8.608669386e-01f,
+		8.577286100e-01f, 8.545579884e-01f, 8.513551931e-01f, 8.481203448e-01f, 8.448535652e-01f, 8.415549774e-01f, 8.382247056e-01f, 8.348628750e-01f,
+		8.314696123e-01f, 8.280450453e-01f, 8.245893028e-01f, 8.211025150e-01f, 8.175848132e-01f, 8.140363297e-01f, 8.104571983e-01f, 8.068475535e-01f,
+		8.032075315e-01f, 7.995372691e-01f, 7.958369046e-01f, 7.921065773e-01f, 7.883464276e-01f, 7.845565972e-01f, 7.807372286e-01f, 7.768884657e-01f,
+		7.730104534e-01f, 7.691033376e-01f, 7.651672656e-01f, 7.612023855e-01f, 7.572088465e-01f, 7.531867990e-01f, 7.491363945e-01f, 7.450577854e-01f,
+		7.409511254e-01f, 7.368165689e-01f, 7.326542717e-01f, 7.284643904e-01f, 7.242470830e-01f, 7.200025080e-01f, 7.157308253e-01f, 7.114321957e-01f,
+		7.071067812e-01f, 7.027547445e-01f, 6.983762494e-01f, 6.939714609e-01f, 6.895405447e-01f, 6.850836678e-01f, 6.806009978e-01f, 6.760927036e-01f,
+		6.715589548e-01f, 6.669999223e-01f, 6.624157776e-01f, 6.578066933e-01f, 6.531728430e-01f, 6.485144010e-01f, 6.438315429e-01f, 6.391244449e-01f,
+		6.343932842e-01f, 6.296382389e-01f, 6.248594881e-01f, 6.200572118e-01f, 6.152315906e-01f, 6.103828063e-01f, 6.055110414e-01f, 6.006164794e-01f,
+		5.956993045e-01f, 5.907597019e-01f, 5.857978575e-01f, 5.808139581e-01f, 5.758081914e-01f, 5.707807459e-01f, 5.657318108e-01f, 5.606615762e-01f,
+		5.555702330e-01f, 5.504579729e-01f, 5.453249884e-01f, 5.401714727e-01f, 5.349976199e-01f, 5.298036247e-01f, 5.245896827e-01f, 5.193559902e-01f,
+		5.141027442e-01f, 5.088301425e-01f, 5.035383837e-01f, 4.982276670e-01f, 4.928981922e-01f, 4.875501601e-01f, 4.821837721e-01f, 4.767992301e-01f,
+		4.713967368e-01f, 4.659764958e-01f, 4.605387110e-01f, 4.550835871e-01f, 4.496113297e-01f, 4.441221446e-01f, 4.386162385e-01f, 4.330938189e-01f,
+		4.275550934e-01f, 4.220002708e-01f, 4.164295601e-01f, 4.108431711e-01f, 4.052413140e-01f, 3.996241998e-01f, 3.939920401e-01f, 3.883450467e-01f,
+		3.826834324e-01f, 3.770074102e-01f, 3.713171940e-01f, 3.656129978e-01f, 3.598950365e-01f, 3.541635254e-01f, 3.484186802e-01f, 3.426607173e-01f,
+		3.368898534e-01f, 3.311063058e-01f, 3.253102922e-01f, 3.195020308e-01f, 3.136817404e-01f, 3.078496400e-01f, 3.020059493e-01f, 2.961508882e-01f,
+		2.902846773e-01f, 2.844075372e-01f, 2.785196894e-01f, 2.726213554e-01f, 2.667127575e-01f, 2.607941179e-01f, 2.548656596e-01f, 2.489276057e-01f,
+		2.429801799e-01f, 2.370236060e-01f, 2.310581083e-01f, 2.250839114e-01f, 2.191012402e-01f, 2.131103199e-01f, 2.071113762e-01f, 2.011046348e-01f,
+		1.950903220e-01f, 1.890686641e-01f, 1.830398880e-01f, 1.770042204e-01f, 1.709618888e-01f, 1.649131205e-01f, 1.588581433e-01f, 1.527971853e-01f,
+		1.467304745e-01f, 1.406582393e-01f, 1.345807085e-01f, 1.284981108e-01f, 1.224106752e-01f, 1.163186309e-01f, 1.102222073e-01f, 1.041216339e-01f,
+		9.801714033e-02f, 9.190895650e-02f, 8.579731234e-02f, 7.968243797e-02f, 7.356456360e-02f, 6.744391956e-02f, 6.132073630e-02f, 5.519524435e-02f,
+		4.906767433e-02f, 4.293825693e-02f, 3.680722294e-02f, 3.067480318e-02f, 2.454122852e-02f, 1.840672991e-02f, 1.227153829e-02f, 6.135884649e-03f,
+		1.224646799e-16f, -6.135884649e-03f, -1.227153829e-02f, -1.840672991e-02f, -2.454122852e-02f, -3.067480318e-02f, -3.680722294e-02f, -4.293825693e-02f,
+		-4.906767433e-02f, -5.519524435e-02f, -6.132073630e-02f, -6.744391956e-02f, -7.356456360e-02f, -7.968243797e-02f, -8.579731234e-02f, -9.190895650e-02f,
+		-9.801714033e-02f, -1.041216339e-01f, -1.102222073e-01f, -1.163186309e-01f, -1.224106752e-01f, -1.284981108e-01f, -1.345807085e-01f, -1.406582393e-01f,
+		-1.467304745e-01f, -1.527971853e-01f, -1.588581433e-01f, -1.649131205e-01f, -1.709618888e-01f, -1.770042204e-01f, -1.830398880e-01f, -1.890686641e-01f,
+		-1.950903220e-01f, -2.011046348e-01f, -2.071113762e-01f, -2.131103199e-01f, -2.191012402e-01f, -2.250839114e-01f, -2.310581083e-01f, -2.370236060e-01f,
+		-2.429801799e-01f, -2.489276057e-01f, -2.548656596e-01f, -2.607941179e-01f, -2.667127575e-01f, -2.726213554e-01f, -2.785196894e-01f, -2.844075372e-01f,
+		-2.902846773e-01f, -2.961508882e-01f, -3.020059493e-01f, -3.078496400e-01f, -3.136817404e-01f, -3.195020308e-01f, -3.253102922e-01f, -3.311063058e-01f,
+		-3.368898534e-01f, -3.426607173e-01f, -3.484186802e-01f, -3.541635254e-01f, -3.598950365e-01f, -3.656129978e-01f, -3.713171940e-01f, -3.770074102e-01f,
+		-3.826834324e-01f, -3.883450467e-01f, -3.939920401e-01f, -3.996241998e-01f, -4.052413140e-01f, -4.108431711e-01f, -4.164295601e-01f, -4.220002708e-01f,
+		-4.275550934e-01f, -4.330938189e-01f, -4.386162385e-01f, -4.441221446e-01f, -4.496113297e-01f, -4.550835871e-01f, -4.605387110e-01f, -4.659764958e-01f,
+		-4.713967368e-01f, -4.767992301e-01f, -4.821837721e-01f, -4.875501601e-01f, -4.928981922e-01f, -4.982276670e-01f, -5.035383837e-01f, -5.088301425e-01f,
+		-5.141027442e-01f, -5.193559902e-01f, -5.245896827e-01f, -5.298036247e-01f, -5.349976199e-01f, -5.401714727e-01f, -5.453249884e-01f, -5.504579729e-01f,
+		-5.555702330e-01f, -5.606615762e-01f, -5.657318108e-01f, -5.707807459e-01f, -5.758081914e-01f, -5.808139581e-01f, -5.857978575e-01f, -5.907597019e-01f,
+		-5.956993045e-01f, -6.006164794e-01f, -6.055110414e-01f, -6.103828063e-01f, -6.152315906e-01f, -6.200572118e-01f, -6.248594881e-01f, -6.296382389e-01f,
+		-6.343932842e-01f, -6.391244449e-01f, -6.438315429e-01f, -6.485144010e-01f, -6.531728430e-01f, -6.578066933e-01f, -6.624157776e-01f, -6.669999223e-01f,
+		-6.715589548e-01f, -6.760927036e-01f, -6.806009978e-01f, -6.850836678e-01f, -6.895405447e-01f, -6.939714609e-01f, -6.983762494e-01f, -7.027547445e-01f,
+		-7.071067812e-01f, -7.114321957e-01f, -7.157308253e-01f, -7.200025080e-01f, -7.242470830e-01f, -7.284643904e-01f, -7.326542717e-01f, -7.368165689e-01f,
+		-7.409511254e-01f, -7.450577854e-01f, -7.491363945e-01f, -7.531867990e-01f, -7.572088465e-01f, -7.612023855e-01f, -7.651672656e-01f, -7.691033376e-01f,
+		-7.730104534e-01f, -7.768884657e-01f, -7.807372286e-01f, -7.845565972e-01f, -7.883464276e-01f, -7.921065773e-01f, -7.958369046e-01f, -7.995372691e-01f,
+		-8.032075315e-01f, -8.068475535e-01f, -8.104571983e-01f, -8.140363297e-01f, -8.175848132e-01f, -8.211025150e-01f, -8.245893028e-01f, -8.280450453e-01f,
+		-8.314696123e-01f, -8.348628750e-01f, -8.382247056e-01f, -8.415549774e-01f, -8.448535652e-01f, -8.481203448e-01f, -8.513551931e-01f, -8.545579884e-01f,
+		-8.577286100e-01f, -8.608669386e-01f, -8.639728561e-01f, -8.670462455e-01f, -8.700869911e-01f, -8.730949784e-01f, -8.760700942e-01f, -8.790122264e-01f,
+		-8.819212643e-01f, -8.847970984e-01f, -8.876396204e-01f, -8.904487232e-01f, -8.932243012e-01f, -8.959662498e-01f, -8.986744657e-01f, -9.013488470e-01f,
+		-9.039892931e-01f, -9.065957045e-01f, -9.091679831e-01f, -9.117060320e-01f, -9.142097557e-01f, -9.166790599e-01f, -9.191138517e-01f, -9.215140393e-01f,
+		-9.238795325e-01f, -9.262102421e-01f, -9.285060805e-01f, -9.307669611e-01f, -9.329927988e-01f, -9.351835099e-01f, -9.373390119e-01f, -9.394592236e-01f,
+		-9.415440652e-01f, -9.435934582e-01f, -9.456073254e-01f, -9.475855910e-01f, -9.495281806e-01f, -9.514350210e-01f, -9.533060404e-01f, -9.551411683e-01f,
+		-9.569403357e-01f, -9.587034749e-01f, -9.604305194e-01f, -9.621214043e-01f, -9.637760658e-01f, -9.653944417e-01f, -9.669764710e-01f, -9.685220943e-01f,
+		-9.700312532e-01f, -9.715038910e-01f, -9.729399522e-01f, -9.743393828e-01f, -9.757021300e-01f, -9.770281427e-01f, -9.783173707e-01f, -9.795697657e-01f,
+		-9.807852804e-01f, -9.819638691e-01f, -9.831054874e-01f, -9.842100924e-01f, -9.852776424e-01f, -9.863080972e-01f, -9.873014182e-01f, -9.882575677e-01f,
+		-9.891765100e-01f, -9.900582103e-01f, -9.909026354e-01f, -9.917097537e-01f, -9.924795346e-01f, -9.932119492e-01f, -9.939069700e-01f, -9.945645707e-01f,
+		-9.951847267e-01f, -9.957674145e-01f, -9.963126122e-01f, -9.968202993e-01f, -9.972904567e-01f, -9.977230666e-01f, -9.981181129e-01f, -9.984755806e-01f,
+		-9.987954562e-01f, -9.990777278e-01f, -9.993223846e-01f, -9.995294175e-01f, -9.996988187e-01f, -9.998305818e-01f, -9.999247018e-01f, -9.999811753e-01f,
+		-1.000000000e+00f, -9.999811753e-01f, -9.999247018e-01f, -9.998305818e-01f, -9.996988187e-01f, -9.995294175e-01f, -9.993223846e-01f, -9.990777278e-01f,
+		-9.987954562e-01f, -9.984755806e-01f, -9.981181129e-01f, -9.977230666e-01f, -9.972904567e-01f, -9.968202993e-01f, -9.963126122e-01f, -9.957674145e-01f,
+		-9.951847267e-01f, -9.945645707e-01f, -9.939069700e-01f, -9.932119492e-01f, -9.924795346e-01f, -9.917097537e-01f, -9.909026354e-01f, -9.900582103e-01f,
+		-9.891765100e-01f, -9.882575677e-01f, -9.873014182e-01f, -9.863080972e-01f, -9.852776424e-01f, -9.842100924e-01f, -9.831054874e-01f, -9.819638691e-01f,
+		-9.807852804e-01f, -9.795697657e-01f, -9.783173707e-01f, -9.770281427e-01f, -9.757021300e-01f, -9.743393828e-01f, -9.729399522e-01f, -9.715038910e-01f,
+		-9.700312532e-01f, -9.685220943e-01f, -9.669764710e-01f, -9.653944417e-01f, -9.637760658e-01f, -9.621214043e-01f, -9.604305194e-01f, -9.587034749e-01f,
+		-9.569403357e-01f, -9.551411683e-01f, -9.533060404e-01f, -9.514350210e-01f, -9.495281806e-01f, -9.475855910e-01f, -9.456073254e-01f, -9.435934582e-01f,
+		-9.415440652e-01f, -9.394592236e-01f, -9.373390119e-01f, -9.351835099e-01f, -9.329927988e-01f, -9.307669611e-01f, -9.285060805e-01f, -9.262102421e-01f,
+		-9.238795325e-01f, -9.215140393e-01f, -9.191138517e-01f, -9.166790599e-01f, -9.142097557e-01f, -9.117060320e-01f, -9.091679831e-01f, -9.065957045e-01f,
+		-9.039892931e-01f, -9.013488470e-01f, -8.986744657e-01f, -8.959662498e-01f, -8.932243012e-01f, -8.904487232e-01f, -8.876396204e-01f, -8.847970984e-01f,
+		-8.819212643e-01f, -8.790122264e-01f, -8.760700942e-01f, -8.730949784e-01f, -8.700869911e-01f, -8.670462455e-01f, -8.639728561e-01f, -8.608669386e-01f,
+		-8.577286100e-01f, -8.545579884e-01f, -8.513551931e-01f, -8.481203448e-01f, -8.448535652e-01f, -8.415549774e-01f, -8.382247056e-01f, -8.348628750e-01f,
+		-8.314696123e-01f, -8.280450453e-01f, -8.245893028e-01f, -8.211025150e-01f, -8.175848132e-01f, -8.140363297e-01f, -8.104571983e-01f, -8.068475535e-01f,
+		-8.032075315e-01f, -7.995372691e-01f, -7.958369046e-01f, -7.921065773e-01f, -7.883464276e-01f, -7.845565972e-01f, -7.807372286e-01f, -7.768884657e-01f,
+		-7.730104534e-01f, -7.691033376e-01f, -7.651672656e-01f, -7.612023855e-01f, -7.572088465e-01f, -7.531867990e-01f, -7.491363945e-01f, -7.450577854e-01f,
+		-7.409511254e-01f, -7.368165689e-01f, -7.326542717e-01f, -7.284643904e-01f, -7.242470830e-01f, -7.200025080e-01f, -7.157308253e-01f, -7.114321957e-01f,
+		-7.071067812e-01f, -7.027547445e-01f, -6.983762494e-01f, -6.939714609e-01f, -6.895405447e-01f, -6.850836678e-01f, -6.806009978e-01f, -6.760927036e-01f,
+		-6.715589548e-01f, -6.669999223e-01f, -6.624157776e-01f, -6.578066933e-01f, -6.531728430e-01f, -6.485144010e-01f, -6.438315429e-01f, -6.391244449e-01f,
+		-6.343932842e-01f, -6.296382389e-01f, -6.248594881e-01f, -6.200572118e-01f, -6.152315906e-01f, -6.103828063e-01f, -6.055110414e-01f, -6.006164794e-01f,
+		-5.956993045e-01f, -5.907597019e-01f, -5.857978575e-01f, -5.808139581e-01f, -5.758081914e-01f, -5.707807459e-01f, -5.657318108e-01f, -5.606615762e-01f,
+		-5.555702330e-01f, -5.504579729e-01f, -5.453249884e-01f, -5.401714727e-01f, -5.349976199e-01f, -5.298036247e-01f, -5.245896827e-01f, -5.193559902e-01f,
+		-5.141027442e-01f, -5.088301425e-01f, -5.035383837e-01f, -4.982276670e-01f, -4.928981922e-01f, -4.875501601e-01f, -4.821837721e-01f, -4.767992301e-01f,
+		-4.713967368e-01f, -4.659764958e-01f, -4.605387110e-01f, -4.550835871e-01f, -4.496113297e-01f, -4.441221446e-01f, -4.386162385e-01f, -4.330938189e-01f,
+		-4.275550934e-01f, -4.220002708e-01f, -4.164295601e-01f, -4.108431711e-01f, -4.052413140e-01f, -3.996241998e-01f, -3.939920401e-01f, -3.883450467e-01f,
+		-3.826834324e-01f, -3.770074102e-01f, -3.713171940e-01f, -3.656129978e-01f, -3.598950365e-01f, -3.541635254e-01f, -3.484186802e-01f, -3.426607173e-01f,
+		-3.368898534e-01f, -3.311063058e-01f, -3.253102922e-01f, -3.195020308e-01f, -3.136817404e-01f, -3.078496400e-01f, -3.020059493e-01f, -2.961508882e-01f,
+		-2.902846773e-01f, -2.844075372e-01f, -2.785196894e-01f, -2.726213554e-01f, -2.667127575e-01f, -2.607941179e-01f, -2.548656596e-01f, -2.489276057e-01f,
+		-2.429801799e-01f, -2.370236060e-01f, -2.310581083e-01f, -2.250839114e-01f, -2.191012402e-01f, -2.131103199e-01f, -2.071113762e-01f, -2.011046348e-01f,
+		-1.950903220e-01f, -1.890686641e-01f, -1.830398880e-01f, -1.770042204e-01f, -1.709618888e-01f, -1.649131205e-01f, -1.588581433e-01f, -1.527971853e-01f,
+		-1.467304745e-01f, -1.406582393e-01f, -1.345807085e-01f, -1.284981108e-01f, -1.224106752e-01f, -1.163186309e-01f, -1.102222073e-01f, -1.041216339e-01f,
+		-9.801714033e-02f, -9.190895650e-02f, -8.579731234e-02f, -7.968243797e-02f, -7.356456360e-02f, -6.744391956e-02f, -6.132073630e-02f, -5.519524435e-02f,
+		-4.906767433e-02f, -4.293825693e-02f, -3.680722294e-02f, -3.067480318e-02f, -2.454122852e-02f, -1.840672991e-02f, -1.227153829e-02f, -6.135884649e-03f,
+		0.000000000e+00f,
+	},
+	{
+		9.873389692e-01f, 9.870950896e-01f, 9.863665731e-01f, 9.851627149e-01f, 9.834987697e-01f, 9.813956019e-01f, 9.788792100e-01f, 9.759801373e-01f,
+		9.727327854e-01f, 9.691746487e-01f, 9.653454902e-01f, 9.612864820e-01f, 9.570393309e-01f, 9.526454140e-01f, 9.481449453e-01f, 9.435761955e-01f,
+		9.389747829e-01f, 9.343730532e-01f, 9.297995628e-01f, 9.252786756e-01f, 9.208302814e-01f, 9.164696400e-01f, 9.122073514e-01f, 9.080494481e-01f,
+		9.039976035e-01f, 9.000494470e-01f, 8.961989715e-01f, 8.924370200e-01f, 8.887518335e-01f, 8.851296416e-01f, 8.815552787e-01f, 8.780128038e-01f,
+		8.744861083e-01f, 8.709594915e-01f, 8.674181902e-01f, 8.638488458e-01f, 8.602398993e-01f, 8.565819038e-01f, 8.528677484e-01f, 8.490927913e-01f,
+		8.452549006e-01f, 8.413544066e-01f, 8.373939699e-01f, 8.333783756e-01f, 8.293142606e-01f, 8.252097886e-01f, 8.210742855e-01f, 8.169178476e-01f,
+		8.127509401e-01f, 8.085839980e-01f, 8.044270434e-01f, 8.002893335e-01f, 7.961790487e-01f, 7.921030313e-01f, 7.880665825e-01f, 7.840733214e-01f,
+		7.801251114e-01f, 7.762220515e-01f, 7.723625331e-01f, 7.685433566e-01f, 7.647599025e-01f, 7.610063490e-01f, 7.572759265e-01f, 7.535611990e-01f,
+		7.498543620e-01f, 7.461475443e-01f, 7.424331037e-01f, 7.387039061e-01f, 7.349535771e-01f, 7.311767195e-01f, 7.273690882e-01f, 7.235277178e-01f,
+		7.196509996e-01f, 7.157387064e-01f, 7.117919650e-01f, 7.078131800e-01f, 7.038059112e-01f, 6.997747116e-01f, 6.957249322e-01f, 6.916625022e-01f,
+		6.875936918e-01f, 6.835248693e-01f, 6.794622587e-01f, 6.754117090e-01f, 6.713784822e-01f, 6.673670680e-01f, 6.633810315e-01f, 6.594228981e-01f,
+		6.554940808e-01f, 6.515948493e-01f, 6.477243435e-01f, 6.438806286e-01f, 6.400607894e-01f, 6.362610598e-01f, 6.324769813e-01f, 6.287035844e-01f,
+		6.249355865e-01f, 6.211675969e-01f, 6.173943225e-01f, 6.136107668e-01f, 6.098124127e-01f, 6.059953855e-01f, 6.021565884e-01f, 5.982938058e-01f,
+		5.944057727e-01f, 5.904922064e-01f, 5.865538014e-01f, 5.825921866e-01f, 5.786098490e-01f, 5.746100254e-01f, 5.705965685e-01f, 5.665737908e-01f,
+		5.625462945e-01f, 5.585187924e-01f, 5.544959274e-01f, 5.504820977e-01f, 5.464812936e-01f, 5.424969516e-01f, 5.385318322e-01f, 5.345879243e-01f,
+		5.306663808e-01f, 5.267674861e-01f, 5.228906571e-01f, 5.190344766e-01f, 5.151967587e-01f, 5.113746416e-01f, 5.075647049e-01f, 5.037631068e-01f,
+		4.999657354e-01f, 4.961683684e-01f, 4.923668346e-01f, 4.885571723e-01f, 4.847357770e-01f, 4.808995346e-01f, 4.770459337e-01f, 4.731731544e-01f,
+		4.692801298e-01f, 4.653665776e-01f, 4.614330024e-01f, 4.574806680e-01f, 4.535115409e-01f, 4.495282077e-01f, 4.455337706e-01f, 4.415317235e-01f,
+		4.375258149e-01f, 4.335199031e-01f, 4.295178077e-01f, 4.255231646e-01f, 4.215392896e-01f, 4.175690550e-01f, 4.136147846e-01f, 4.096781701e-01f,
+		4.057602129e-01f, 4.018611922e-01f, 3.979806609e-01f, 3.941174691e-01f, 3.902698145e-01f, 3.864353164e-01f, 3.826111117e-01f, 3.787939682e-01f,
+		3.749804106e-01f, 3.711668555e-01f, 3.673497484e-01f, 3.635256997e-01f, 3.596916117e-01f, 3.558447953e-01f, 3.519830688e-01f, 3.481048376e-01f,
+		3.442091502e-01f, 3.402957300e-01f, 3.363649808e-01f, 3.324179663e-01f, 3.284563648e-01f, 3.244824011e-01f, 3.204987573e-01f, 3.165084678e-01f,
+		3.125148007e-01f, 3.085211317e-01f, 3.045308146e-01f, 3.005470533e-01f, 2.965727802e-01f, 2.926105467e-01f, 2.886624271e-01f, 2.847299435e-01f,
+		2.808140099e-01f, 2.769149016e-01f, 2.730322481e-01f, 2.691650513e-01f, 2.653117266e-01f, 2.614701673e-01f, 2.576378274e-01f, 2.538118216e-01f,
+		2.499890372e-01f, 2.461662542e-01f, 2.423402689e-01f, 2.385080159e-01f, 2.346666854e-01f, 2.308138283e-01f, 2.269474488e-01f, 2.230660783e-01f,
+		2.191688290e-01f, 2.152554256e-01f, 2.113262125e-01f, 2.073821386e-01f, 2.034247181e-01f, 1.994559701e-01f, 1.954783397e-01f, 1.914946027e-01f,
+		1.875077581e-01f, 1.835209125e-01f, 1.795371611e-01f, 1.755594693e-01f, 1.715905595e-01f, 1.676328083e-01f, 1.636881566e-01f, 1.597580365e-01f,
+		1.558433188e-01f, 1.519442808e-01f, 1.480605982e-01f, 1.441913588e-01f, 1.403350994e-01f, 1.364898633e-01f, 1.326532767e-01f, 1.288226402e-01f,
+		1.249950336e-01f, 1.211674275e-01f, 1.173368003e-01f, 1.135002530e-01f, 1.096551204e-01f, 1.057990725e-01f, 1.019302028e-01f, 9.804710042e-02f,
+		9.414890327e-02f, 9.023532982e-02f, 8.630668886e-02f, 8.236386664e-02f, 7.840829192e-02f, 7.444188043e-02f, 7.046696073e-02f, 6.648618447e-02f,
+		6.250242437e-02f, 5.851866398e-02f, 5.453788321e-02f, 5.056294432e-02f, 4.659648233e-02f, 4.264080440e-02f, 3.869780178e-02f, 3.476887767e-02f,
+		3.085489392e-02f, 2.695613840e-02f, 2.307231429e-02f, 1.920255186e-02f, 1.534544197e-02f, 1.149909039e-02f, 7.661190442e-03f, 3.829111534e-03f,
+		-1.105884922e-17f, -3.829111534e-03f, -7.661190442e-03f, -1.149909039e-02f, -1.534544197e-02f, -1.920255186e-02f, -2.307231429e-02f, -2.695613840e-02f,
+		-3.085489392e-02f, -3.476887767e-02f, -3.869780178e-02f, -4.264080440e-02f, -4.659648233e-02f, -5.056294432e-02f, -5.453788321e-02f, -5.851866398e-02f,
+		-6.250242437e-02f, -6.648618447e-02f, -7.046696073e-02f, -7.444188043e-02f, -7.840829192e-02f, -8.236386664e-02f, -8.630668886e-02f, -9.023532982e-02f,
+		-9.414890327e-02f, -9.804710042e-02f, -1.019302028e-01f, -1.057990725e-01f, -1.096551204e-01f, -1.135002530e-01f, -1.173368003e-01f, -1.211674275e-01f,
+		-1.249950336e-01f, -1.288226402e-01f, -1.326532767e-01f, -1.364898633e-01f, -1.403350994e-01f, -1.441913588e-01f, -1.480605982e-01f, -1.519442808e-01f,
+		-1.558433188e-01f, -1.597580365e-01f, -1.636881566e-01f, -1.676328083e-01f, -1.715905595e-01f, -1.755594693e-01f, -1.795371611e-01f, -1.835209125e-01f,
+		-1.875077581e-01f, -1.914946027e-01f, -1.954783397e-01f, -1.994559701e-01f, -2.034247181e-01f, -2.073821386e-01f, -2.113262125e-01f, -2.152554256e-01f,
+		-2.191688290e-01f, -2.230660783e-01f, -2.269474488e-01f, -2.308138283e-01f, -2.346666854e-01f, -2.385080159e-01f, -2.423402689e-01f, -2.461662542e-01f,
+		-2.499890372e-01f, -2.538118216e-01f, -2.576378274e-01f, -2.614701673e-01f, -2.653117266e-01f, -2.691650513e-01f, -2.730322481e-01f, -2.769149016e-01f,
+		-2.808140099e-01f, -2.847299435e-01f, -2.886624271e-01f, -2.926105467e-01f, -2.965727802e-01f, -3.005470533e-01f, -3.045308146e-01f, -3.085211317e-01f,
+		-3.125148007e-01f, -3.165084678e-01f, -3.204987573e-01f, -3.244824011e-01f, -3.284563648e-01f, -3.324179663e-01f, -3.363649808e-01f, -3.402957300e-01f,
+		-3.442091502e-01f, -3.481048376e-01f, -3.519830688e-01f, -3.558447953e-01f, -3.596916117e-01f, -3.635256997e-01f, -3.673497484e-01f, -3.711668555e-01f,
+		-3.749804106e-01f, -3.787939682e-01f, -3.826111117e-01f, -3.864353164e-01f, -3.902698145e-01f, -3.941174691e-01f, -3.979806609e-01f, -4.018611922e-01f,
+		-4.057602129e-01f, -4.096781701e-01f, -4.136147846e-01f, -4.175690550e-01f, -4.215392896e-01f, -4.255231646e-01f, -4.295178077e-01f, -4.335199031e-01f,
+		-4.375258149e-01f, -4.415317235e-01f, -4.455337706e-01f, -4.495282077e-01f, -4.535115409e-01f, -4.574806680e-01f, -4.614330024e-01f, -4.653665776e-01f,
+		-4.692801298e-01f, -4.731731544e-01f, -4.770459337e-01f, -4.808995346e-01f, -4.847357770e-01f, -4.885571723e-01f, -4.923668346e-01f, -4.961683684e-01f,
+		-4.999657354e-01f, -5.037631068e-01f, -5.075647049e-01f, -5.113746416e-01f, -5.151967587e-01f, -5.190344766e-01f, -5.228906571e-01f, -5.267674861e-01f,
+		-5.306663808e-01f, -5.345879243e-01f, -5.385318322e-01f, -5.424969516e-01f, -5.464812936e-01f, -5.504820977e-01f, -5.544959274e-01f, -5.585187924e-01f,
+		-5.625462945e-01f, -5.665737908e-01f, -5.705965685e-01f, -5.746100254e-01f, -5.786098490e-01f, -5.825921866e-01f, -5.865538014e-01f, -5.904922064e-01f,
+		-5.944057727e-01f, -5.982938058e-01f, -6.021565884e-01f, -6.059953855e-01f, -6.098124127e-01f, -6.136107668e-01f, -6.173943225e-01f, -6.211675969e-01f,
+		-6.249355865e-01f, -6.287035844e-01f, -6.324769813e-01f, -6.362610598e-01f, -6.400607894e-01f, -6.438806286e-01f, -6.477243435e-01f, -6.515948493e-01f,
+		-6.554940808e-01f, -6.594228981e-01f, -6.633810315e-01f, -6.673670680e-01f, -6.713784822e-01f, -6.754117090e-01f, -6.794622587e-01f, -6.835248693e-01f,
+		-6.875936918e-01f, -6.916625022e-01f, -6.957249322e-01f, -6.997747116e-01f, -7.038059112e-01f, -7.078131800e-01f, -7.117919650e-01f, -7.157387064e-01f,
+		-7.196509996e-01f, -7.235277178e-01f, -7.273690882e-01f, -7.311767195e-01f, -7.349535771e-01f, -7.387039061e-01f, -7.424331037e-01f, -7.461475443e-01f,
+		-7.498543620e-01f, -7.535611990e-01f, -7.572759265e-01f, -7.610063490e-01f, -7.647599025e-01f, -7.685433566e-01f, -7.723625331e-01f, -7.762220515e-01f,
+		-7.801251114e-01f, -7.840733214e-01f, -7.880665825e-01f, -7.921030313e-01f, -7.961790487e-01f, -8.002893335e-01f, -8.044270434e-01f, -8.085839980e-01f,
+		-8.127509401e-01f, -8.169178476e-01f, -8.210742855e-01f, -8.252097886e-01f, -8.293142606e-01f, -8.333783756e-01f, -8.373939699e-01f, -8.413544066e-01f,
+		-8.452549006e-01f, -8.490927913e-01f, -8.528677484e-01f, -8.565819038e-01f, -8.602398993e-01f, -8.638488458e-01f, -8.674181902e-01f, -8.709594915e-01f,
+		-8.744861083e-01f, -8.780128038e-01f, -8.815552787e-01f, -8.851296416e-01f, -8.887518335e-01f, -8.924370200e-01f, -8.961989715e-01f, -9.000494470e-01f,
+		-9.039976035e-01f, -9.080494481e-01f, -9.122073514e-01f, -9.164696400e-01f, -9.208302814e-01f, -9.252786756e-01f, -9.297995628e-01f, -9.343730532e-01f,
+		-9.389747829e-01f, -9.435761955e-01f, -9.481449453e-01f, -9.526454140e-01f, -9.570393309e-01f, -9.612864820e-01f, -9.653454902e-01f, -9.691746487e-01f,
+		-9.727327854e-01f, -9.759801373e-01f, -9.788792100e-01f, -9.813956019e-01f, -9.834987697e-01f, -9.851627149e-01f, -9.863665731e-01f, -9.870950896e-01f,
+		-9.873389692e-01f, -9.870950896e-01f, -9.863665731e-01f, -9.851627149e-01f, -9.834987697e-01f, -9.813956019e-01f, -9.788792100e-01f, -9.759801373e-01f,
+		-9.727327854e-01f, -9.691746487e-01f, -9.653454902e-01f, -9.612864820e-01f, -9.570393309e-01f, -9.526454140e-01f, -9.481449453e-01f, -9.435761955e-01f,
+		-9.389747829e-01f, -9.343730532e-01f, -9.297995628e-01f, -9.252786756e-01f, -9.208302814e-01f, -9.164696400e-01f, -9.122073514e-01f, -9.080494481e-01f,
+		-9.039976035e-01f, -9.000494470e-01f, -8.961989715e-01f, -8.924370200e-01f, -8.887518335e-01f, -8.851296416e-01f, -8.815552787e-01f, -8.780128038e-01f,
+		-8.744861083e-01f, -8.709594915e-01f, -8.674181902e-01f, -8.638488458e-01f, -8.602398993e-01f, -8.565819038e-01f, -8.528677484e-01f, -8.490927913e-01f,
+		-8.452549006e-01f, -8.413544066e-01f, -8.373939699e-01f, -8.333783756e-01f, -8.293142606e-01f, -8.252097886e-01f, -8.210742855e-01f, -8.169178476e-01f,
+		-8.127509401e-01f, -8.085839980e-01f, -8.044270434e-01f, -8.002893335e-01f, -7.961790487e-01f, -7.921030313e-01f, -7.880665825e-01f, -7.840733214e-01f,
+		-7.801251114e-01f, -7.762220515e-01f, -7.723625331e-01f, -7.685433566e-01f, -7.647599025e-01f, -7.610063490e-01f, -7.572759265e-01f, -7.535611990e-01f,
+		-7.498543620e-01f, -7.461475443e-01f, -7.424331037e-01f, -7.387039061e-01f, -7.349535771e-01f, -7.311767195e-01f, -7.273690882e-01f, -7.235277178e-01f,
+		-7.196509996e-01f, -7.157387064e-01f, -7.117919650e-01f, -7.078131800e-01f, -7.038059112e-01f, -6.997747116e-01f, -6.957249322e-01f, -6.916625022e-01f,
+		-6.875936918e-01f, -6.835248693e-01f, -6.794622587e-01f, -6.754117090e-01f, -6.713784822e-01f, -6.673670680e-01f, -6.633810315e-01f, -6.594228981e-01f,
+		-6.554940808e-01f, -6.515948493e-01f, -6.477243435e-01f, -6.438806286e-01f, -6.400607894e-01f, -6.362610598e-01f, -6.324769813e-01f, -6.287035844e-01f,
+		-6.249355865e-01f, -6.211675969e-01f, -6.173943225e-01f, -6.136107668e-01f, -6.098124127e-01f, -6.059953855e-01f, -6.021565884e-01f, -5.982938058e-01f,
+		-5.944057727e-01f, -5.904922064e-01f, -5.865538014e-01f, -5.825921866e-01f, -5.786098490e-01f, -5.746100254e-01f, -5.705965685e-01f, -5.665737908e-01f,
+		-5.625462945e-01f, -5.585187924e-01f, -5.544959274e-01f, -5.504820977e-01f, -5.464812936e-01f, -5.424969516e-01f, -5.385318322e-01f, -5.345879243e-01f,
+		-5.306663808e-01f, -5.267674861e-01f, -5.228906571e-01f, -5.190344766e-01f, -5.151967587e-01f, -5.113746416e-01f, -5.075647049e-01f, -5.037631068e-01f,
+		-4.999657354e-01f, -4.961683684e-01f, -4.923668346e-01f, -4.885571723e-01f, -4.847357770e-01f, -4.808995346e-01f, -4.770459337e-01f, -4.731731544e-01f,
+		-4.692801298e-01f, -4.653665776e-01f, -4.614330024e-01f, -4.574806680e-01f, -4.535115409e-01f, -4.495282077e-01f, -4.455337706e-01f, -4.415317235e-01f,
+		-4.375258149e-01f, -4.335199031e-01f, -4.295178077e-01f, -4.255231646e-01f, -4.215392896e-01f, -4.175690550e-01f, -4.136147846e-01f, -4.096781701e-01f,
+		-4.057602129e-01f, -4.018611922e-01f, -3.979806609e-01f, -3.941174691e-01f, -3.902698145e-01f, -3.864353164e-01f, -3.826111117e-01f, -3.787939682e-01f,
+		-3.749804106e-01f, -3.711668555e-01f, -3.673497484e-01f, -3.635256997e-01f, -3.596916117e-01f, -3.558447953e-01f, -3.519830688e-01f, -3.481048376e-01f,
+		-3.442091502e-01f, -3.402957300e-01f, -3.363649808e-01f, -3.324179663e-01f, -3.284563648e-01f, -3.244824011e-01f, -3.204987573e-01f, -3.165084678e-01f,
+		-3.125148007e-01f, -3.085211317e-01f, -3.045308146e-01f, -3.005470533e-01f, -2.965727802e-01f, -2.926105467e-01f, -2.886624271e-01f, -2.847299435e-01f,
+		-2.808140099e-01f, -2.769149016e-01f, -2.730322481e-01f, -2.691650513e-01f, -2.653117266e-01f, -2.614701673e-01f, -2.576378274e-01f, -2.538118216e-01f,
+		-2.499890372e-01f, -2.461662542e-01f, -2.423402689e-01f, -2.385080159e-01f, -2.346666854e-01f, -2.308138283e-01f, -2.269474488e-01f, -2.230660783e-01f,
+		-2.191688290e-01f, -2.152554256e-01f, -2.113262125e-01f, -2.073821386e-01f, -2.034247181e-01f, -1.994559701e-01f, -1.954783397e-01f, -1.914946027e-01f,
+		-1.875077581e-01f, -1.835209125e-01f, -1.795371611e-01f, -1.755594693e-01f, -1.715905595e-01f, -1.676328083e-01f, -1.636881566e-01f, -1.597580365e-01f,
+		-1.558433188e-01f, -1.519442808e-01f, -1.480605982e-01f, -1.441913588e-01f, -1.403350994e-01f, -1.364898633e-01f, -1.326532767e-01f, -1.288226402e-01f,
+		-1.249950336e-01f, -1.211674275e-01f, -1.173368003e-01f, -1.135002530e-01f, -1.096551204e-01f, -1.057990725e-01f, -1.019302028e-01f, -9.804710042e-02f,
+		-9.414890327e-02f, -9.023532982e-02f, -8.630668886e-02f, -8.236386664e-02f, -7.840829192e-02f, -7.444188043e-02f, -7.046696073e-02f, -6.648618447e-02f,
+		-6.250242437e-02f, -5.851866398e-02f, -5.453788321e-02f, -5.056294432e-02f, -4.659648233e-02f, -4.264080440e-02f, -3.869780178e-02f, -3.476887767e-02f,
+		-3.085489392e-02f, -2.695613840e-02f, -2.307231429e-02f, -1.920255186e-02f, -1.534544197e-02f, -1.149909039e-02f, -7.661190442e-03f, -3.829111534e-03f,
+		-2.265894724e-16f, 3.829111534e-03f, 7.661190442e-03f, 1.149909039e-02f, 1.534544197e-02f, 1.920255186e-02f, 2.307231429e-02f, 2.695613840e-02f,
+		3.085489392e-02f, 3.476887767e-02f, 3.869780178e-02f, 4.264080440e-02f, 4.659648233e-02f, 5.056294432e-02f, 5.453788321e-02f, 5.851866398e-02f,
+		6.250242437e-02f, 6.648618447e-02f, 7.046696073e-02f, 7.444188043e-02f, 7.840829192e-02f, 8.236386664e-02f, 8.630668886e-02f, 9.023532982e-02f,
+		9.414890327e-02f, 9.804710042e-02f, 1.019302028e-01f, 1.057990725e-01f, 1.096551204e-01f, 1.135002530e-01f, 1.173368003e-01f, 1.211674275e-01f,
+		1.249950336e-01f, 1.288226402e-01f, 1.326532767e-01f, 1.364898633e-01f, 1.403350994e-01f, 1.441913588e-01f, 1.480605982e-01f, 1.519442808e-01f,
+		1.558433188e-01f, 1.597580365e-01f, 1.636881566e-01f, 1.676328083e-01f, 1.715905595e-01f, 1.755594693e-01f, 1.795371611e-01f, 1.835209125e-01f,
+		1.875077581e-01f, 1.914946027e-01f, 1.954783397e-01f, 1.994559701e-01f, 2.034247181e-01f, 2.073821386e-01f, 2.113262125e-01f, 2.152554256e-01f,
+		2.191688290e-01f, 2.230660783e-01f, 2.269474488e-01f, 2.308138283e-01f, 2.346666854e-01f, 2.385080159e-01f, 2.423402689e-01f, 2.461662542e-01f,
+		2.499890372e-01f, 2.538118216e-01f, 2.576378274e-01f, 2.614701673e-01f, 2.653117266e-01f, 2.691650513e-01f, 2.730322481e-01f, 2.769149016e-01f,
+		2.808140099e-01f, 2.847299435e-01f, 2.886624271e-01f, 2.926105467e-01f, 2.965727802e-01f, 3.005470533e-01f, 3.045308146e-01f, 3.085211317e-01f,
+		3.125148007e-01f, 3.165084678e-01f, 3.204987573e-01f, 3.244824011e-01f, 3.284563648e-01f, 3.324179663e-01f, 3.363649808e-01f, 3.402957300e-01f,
+		3.442091502e-01f, 3.481048376e-01f, 3.519830688e-01f, 3.558447953e-01f, 3.596916117e-01f, 3.635256997e-01f, 3.673497484e-01f, 3.711668555e-01f,
+		3.749804106e-01f, 3.787939682e-01f, 3.826111117e-01f, 3.864353164e-01f, 3.902698145e-01f, 3.941174691e-01f, 3.979806609e-01f, 4.018611922e-01f,
+		4.057602129e-01f, 4.096781701e-01f, 4.136147846e-01f, 4.175690550e-01f, 4.215392896e-01f, 4.255231646e-01f, 4.295178077e-01f, 4.335199031e-01f,
+		4.375258149e-01f, 4.415317235e-01f, 4.455337706e-01f, 4.495282077e-01f, 4.535115409e-01f, 4.574806680e-01f, 4.614330024e-01f, 4.653665776e-01f,
+		4.692801298e-01f, 4.731731544e-01f, 4.770459337e-01f, 4.808995346e-01f, 4.847357770e-01f, 4.885571723e-01f, 4.923668346e-01f, 4.961683684e-01f,
+		4.999657354e-01f, 5.037631068e-01f, 5.075647049e-01f, 5.113746416e-01f, 5.151967587e-01f, 5.190344766e-01f, 5.228906571e-01f, 5.267674861e-01f,
+		5.306663808e-01f, 5.345879243e-01f, 5.385318322e-01f, 5.424969516e-01f, 5.464812936e-01f, 5.504820977e-01f, 5.544959274e-01f, 5.585187924e-01f,
+		5.625462945e-01f, 5.665737908e-01f, 5.705965685e-01f, 5.746100254e-01f, 5.786098490e-01f, 5.825921866e-01f, 5.865538014e-01f, 5.904922064e-01f,
+		5.944057727e-01f, 5.982938058e-01f, 6.021565884e-01f, 6.059953855e-01f, 6.098124127e-01f, 6.136107668e-01f, 6.173943225e-01f, 6.211675969e-01f,
+		6.249355865e-01f, 6.287035844e-01f, 6.324769813e-01f, 6.362610598e-01f, 6.400607894e-01f, 6.438806286e-01f, 6.477243435e-01f, 6.515948493e-01f,
+		6.554940808e-01f, 6.594228981e-01f, 6.633810315e-01f, 6.673670680e-01f, 6.713784822e-01f, 6.754117090e-01f, 6.794622587e-01f, 6.835248693e-01f,
+		6.875936918e-01f, 6.916625022e-01f, 6.957249322e-01f, 6.997747116e-01f, 7.038059112e-01f, 7.078131800e-01f, 7.117919650e-01f, 7.157387064e-01f,
+		7.196509996e-01f, 7.235277178e-01f, 7.273690882e-01f, 7.311767195e-01f, 7.349535771e-01f, 7.387039061e-01f, 7.424331037e-01f, 7.461475443e-01f,
+		7.498543620e-01f, 7.535611990e-01f, 7.572759265e-01f, 7.610063490e-01f, 7.647599025e-01f, 7.685433566e-01f, 7.723625331e-01f, 7.762220515e-01f,
+		7.801251114e-01f, 7.840733214e-01f, 7.880665825e-01f, 7.921030313e-01f, 7.961790487e-01f, 8.002893335e-01f, 8.044270434e-01f, 8.085839980e-01f,
+		8.127509401e-01f, 8.169178476e-01f, 8.210742855e-01f, 8.252097886e-01f, 8.293142606e-01f, 8.333783756e-01f, 8.373939699e-01f, 8.413544066e-01f,
+		8.452549006e-01f, 8.490927913e-01f, 8.528677484e-01f, 8.565819038e-01f, 8.602398993e-01f, 8.638488458e-01f, 8.674181902e-01f, 8.709594915e-01f,
+		8.744861083e-01f, 8.780128038e-01f, 8.815552787e-01f, 8.851296416e-01f, 8.887518335e-01f, 8.924370200e-01f, 8.961989715e-01f, 9.000494470e-01f,
+		9.039976035e-01f, 9.080494481e-01f, 9.122073514e-01f, 9.164696400e-01f, 9.208302814e-01f, 9.252786756e-01f, 9.297995628e-01f, 9.343730532e-01f,
+		9.389747829e-01f, 9.435761955e-01f, 9.481449453e-01f, 9.526454140e-01f, 9.570393309e-01f, 9.612864820e-01f, 9.653454902e-01f, 9.691746487e-01f,
+		9.727327854e-01f, 9.759801373e-01f, 9.788792100e-01f, 9.813956019e-01f, 9.834987697e-01f, 9.851627149e-01f, 9.863665731e-01f, 9.870950896e-01f,
+		9.873389692e-01f,
+	},
+	{
+		0.000000000e+00f, 1.057680553e-01f, 2.101831294e-01f, 3.119233614e-01f, 4.097282800e-01f, 5.024273960e-01f, 5.889663418e-01f, 6.684298544e-01f,
+		7.400609935e-01f, 8.032760946e-01f, 8.576750863e-01f, 9.030469329e-01f, 9.393701094e-01f, 9.668081578e-01f, 9.857005162e-01f, 9.965489449e-01f,
+		1.000000000e+00f, 9.968241123e-01f, 9.878919193e-01f, 9.741485700e-01f, 9.565867704e-01f, 9.362193592e-01f, 9.140522055e-01f, 8.910581959e-01f,
+		8.681530290e-01f, 8.461734701e-01f, 8.258586303e-01f, 8.078347313e-01f, 7.926037026e-01f, 7.805358341e-01f, 7.718665780e-01f, 7.666974668e-01f,
+		7.650009871e-01f, 7.666291330e-01f, 7.713252560e-01f, 7.787387351e-01f, 7.884419179e-01f, 7.999487250e-01f, 8.127342767e-01f, 8.262548838e-01f,
+		8.399677561e-01f, 8.533498042e-01f, 8.659149620e-01f, 8.772295193e-01f, 8.869250345e-01f, 8.947084884e-01f, 9.003694413e-01f, 9.037840605e-01f,
+		9.049159930e-01f, 9.038141648e-01f, 9.006076869e-01f, 8.954981408e-01f, 8.887495962e-01f, 8.806767809e-01f, 8.716318709e-01f, 8.619904067e-01f,
+		8.521368514e-01f, 8.424503097e-01f, 8.332909017e-01f, 8.249872525e-01f, 8.178255045e-01f, 8.120401977e-01f, 8.078072851e-01f, 8.052394727e-01f,
+		8.043839821e-01f, 8.052227511e-01f, 8.076749952e-01f, 8.116019776e-01f, 8.168137549e-01f, 8.230776063e-01f, 8.301277971e-01f, 8.376762921e-01f,
+		8.454240055e-01f, 8.530721694e-01f, 8.603334037e-01f, 8.669420932e-01f, 8.726637128e-01f, 8.773027839e-01f, 8.807092051e-01f, 8.827827628e-01f,
+		8.834756985e-01f, 8.827932818e-01f, 8.807924114e-01f, 8.775783390e-01f, 8.732996755e-01f, 8.681418994e-01f, 8.623196370e-01f, 8.560680233e-01f,
+		8.496334805e-01f, 8.432642652e-01f, 8.372011373e-01f, 8.316684922e-01f, 8.268662762e-01f, 8.229629662e-01f, 8.200898564e-01f, 8.183368366e-01f,
+		8.177497931e-01f, 8.183296970e-01f, 8.200333862e-01f, 8.227759800e-01f, 8.264348091e-01f, 8.308546900e-01f, 8.358543229e-01f, 8.412335586e-01f,
+		8.467812481e-01f, 8.522833747e-01f, 8.575311597e-01f, 8.623288415e-01f, 8.665008430e-01f, 8.698980693e-01f, 8.724031145e-01f, 8.739341998e-01f,
+		8.744477152e-01f, 8.739392904e-01f, 8.724433759e-01f, 8.700313732e-01f, 8.668084032e-01f, 8.629088530e-01f, 8.584908864e-01f, 8.537301360e-01f,
+		8.488128255e-01f, 8.439285864e-01f, 8.392632443e-01f, 8.349918428e-01f, 8.312721657e-01f, 8.282389930e-01f, 8.259992975e-01f, 8.246285490e-01f,
+		8.241682532e-01f, 8.246248009e-01f, 8.259696548e-01f, 8.281408527e-01f, 8.310457525e-01f, 8.345649030e-01f, 8.385568818e-01f, 8.428639063e-01f,
+		8.473179990e-01f, 8.517474691e-01f, 8.559834616e-01f, 8.598663285e-01f, 8.632515824e-01f, 8.660152147e-01f, 8.680581821e-01f, 8.693099040e-01f,
+		8.697306469e-01f, 8.693127178e-01f, 8.680804345e-01f, 8.660888848e-01f, 8.634215335e-01f, 8.601867789e-01f, 8.565135988e-01f, 8.525464583e-01f,
+		8.484396787e-01f, 8.443514858e-01f, 8.404379631e-01f, 8.368471419e-01f, 8.337134476e-01f, 8.311527113e-01f, 8.292579279e-01f, 8.280959162e-01f,
+		8.277049997e-01f, 8.280937864e-01f, 8.292410846e-01f, 8.310969504e-01f, 8.335848162e-01f, 8.366046124e-01f, 8.400367561e-01f, 8.437468496e-01f,
+		8.475909051e-01f, 8.514208945e-01f, 8.550904110e-01f, 8.584602288e-01f, 8.614035497e-01f, 8.638107415e-01f, 8.655933910e-01f, 8.666875240e-01f,
+		8.670558755e-01f, 8.666891302e-01f, 8.656060938e-01f, 8.638527945e-01f, 8.615005566e-01f, 8.586431258e-01f, 8.553929589e-01f, 8.518768270e-01f,
+		8.482309005e-01f, 8.445955054e-01f, 8.411097537e-01f, 8.379062495e-01f, 8.351060730e-01f, 8.328142306e-01f, 8.311157408e-01f, 8.300725014e-01f,
+		8.297210520e-01f, 8.300713132e-01f, 8.311063441e-01f, 8.327831229e-01f, 8.350343155e-01f, 8.377709609e-01f, 8.408859657e-01f, 8.442582726e-01f,
+		8.477575413e-01f, 8.512491604e-01f, 8.545994012e-01f, 8.576805136e-01f, 8.603755747e-01f, 8.625829028e-01f, 8.642198754e-01f, 8.652260045e-01f,
+		8.655651578e-01f, 8.652268446e-01f, 8.642265193e-01f, 8.626048970e-01f, 8.604263088e-01f, 8.577761642e-01f, 8.547576188e-01f, 8.514875781e-01f,
+		8.480921897e-01f, 8.447019993e-01f, 8.414469525e-01f, 8.384514368e-01f, 8.358295481e-01f, 8.336807646e-01f, 8.320861888e-01f, 8.311055004e-01f,
+		8.307747340e-01f, 8.311049629e-01f, 8.320819381e-01f, 8.336666932e-01f, 8.357970898e-01f, 8.383902428e-01f, 8.413457315e-01f, 8.445494719e-01f,
+		8.478781024e-01f, 8.512037142e-01f, 8.543987472e-01f, 8.573408621e-01f, 8.599176064e-01f, 8.620306951e-01f, 8.635997442e-01f, 8.645653165e-01f,
+		8.648911631e-01f, 8.645655787e-01f, 8.636018185e-01f, 8.620375617e-01f, 8.599334454e-01f, 8.573707233e-01f, 8.544481404e-01f, 8.512781430e-01f,
+		8.479825696e-01f, 8.446879863e-01f, 8.415208448e-01f, 8.386026485e-01f, 8.360453083e-01f, 8.339468689e-01f, 8.323877635e-01f, 8.314277433e-01f,
+		8.311035963e-01f, 8.314277433e-01f, 8.323877635e-01f, 8.339468689e-01f, 8.360453083e-01f, 8.386026485e-01f, 8.415208448e-01f, 8.446879863e-01f,
+		8.479825696e-01f, 8.512781430e-01f, 8.544481404e-01f, 8.573707233e-01f, 8.599334454e-01f, 8.620375617e-01f, 8.636018185e-01f, 8.645655787e-01f,
+		8.648911631e-01f, 8.645653165e-01f, 8.635997442e-01f, 8.620306951e-01f, 8.599176064e-01f, 8.573408621e-01f, 8.543987472e-01f, 8.512037142e-01f,
+		8.478781024e-01f, 8.445494719e-01f, 8.413457315e-01f, 8.383902428e-01f, 8.357970898e-01f, 8.336666932e-01f, 8.320819381e-01f, 8.311049629e-01f,
+		8.307747340e-01f, 8.311055004e-01f, 8.320861888e-01f, 8.336807646e-01f, 8.358295481e-01f, 8.384514368e-01f, 8.414469525e-01f, 8.447019993e-01f,
+		8.480921897e-01f, 8.514875781e-01f, 8.547576188e-01f, 8.577761642e-01f, 8.604263088e-01f, 8.626048970e-01f, 8.642265193e-01f, 8.652268446e-01f,
+		8.655651578e-01f, 8.652260045e-01f, 8.642198754e-01f, 8.625829028e-01f, 8.603755747e-01f, 8.576805136e-01f, 8.545994012e-01f, 8.512491604e-01f,
+		8.477575413e-01f, 8.442582726e-01f, 8.408859657e-01f, 8.377709609e-01f, 8.350343155e-01f, 8.327831229e-01f, 8.311063441e-01f, 8.300713132e-01f,
+		8.297210520e-01f, 8.300725014e-01f, 8.311157408e-01f, 8.328142306e-01f, 8.351060730e-01f, 8.379062495e-01f, 8.411097537e-01f, 8.445955054e-01f,
+		8.482309005e-01f, 8.518768270e-01f, 8.553929589e-01f, 8.586431258e-01f, 8.615005566e-01f, 8.638527945e-01f, 8.656060938e-01f, 8.666891302e-01f,
+		8.670558755e-01f, 8.666875240e-01f, 8.655933910e-01f, 8.638107415e-01f, 8.614035497e-01f, 8.584602288e-01f, 8.550904110e-01f, 8.514208945e-01f,
+		8.475909051e-01f, 8.437468496e-01f, 8.400367561e-01f, 8.366046124e-01f, 8.335848162e-01f, 8.310969504e-01f, 8.292410846e-01f, 8.280937864e-01f,
+		8.277049997e-01f, 8.280959162e-01f, 8.292579279e-01f, 8.311527113e-01f, 8.337134476e-01f, 8.368471419e-01f, 8.404379631e-01f, 8.443514858e-01f,
+		8.484396787e-01f, 8.525464583e-01f, 8.565135988e-01f, 8.601867789e-01f, 8.634215335e-01f, 8.660888848e-01f, 8.680804345e-01f, 8.693127178e-01f,
+		8.697306469e-01f, 8.693099040e-01f, 8.680581821e-01f, 8.660152147e-01f, 8.632515824e-01f, 8.598663285e-01f, 8.559834616e-01f, 8.517474691e-01f,
+		8.473179990e-01f, 8.428639063e-01f, 8.385568818e-01f, 8.345649030e-01f, 8.310457525e-01f, 8.281408527e-01f, 8.259696548e-01f, 8.246248009e-01f,
+		8.241682532e-01f, 8.246285490e-01f, 8.259992975e-01f, 8.282389930e-01f, 8.312721657e-01f, 8.349918428e-01f, 8.392632443e-01f, 8.439285864e-01f,
+		8.488128255e-01f, 8.537301360e-01f, 8.584908864e-01f, 8.629088530e-01f, 8.668084032e-01f, 8.700313732e-01f, 8.724433759e-01f, 8.739392904e-01f,
+		8.744477152e-01f, 8.739341998e-01f, 8.724031145e-01f, 8.698980693e-01f, 8.665008430e-01f, 8.623288415e-01f, 8.575311597e-01f, 8.522833747e-01f,
+		8.467812481e-01f, 8.412335586e-01f, 8.358543229e-01f, 8.308546900e-01f, 8.264348091e-01f, 8.227759800e-01f, 8.200333862e-01f, 8.183296970e-01f,
+		8.177497931e-01f, 8.183368366e-01f, 8.200898564e-01f, 8.229629662e-01f, 8.268662762e-01f, 8.316684922e-01f, 8.372011373e-01f, 8.432642652e-01f,
+		8.496334805e-01f, 8.560680233e-01f, 8.623196370e-01f, 8.681418994e-01f, 8.732996755e-01f, 8.775783390e-01f, 8.807924114e-01f, 8.827932818e-01f,
+		8.834756985e-01f, 8.827827628e-01f, 8.807092051e-01f, 8.773027839e-01f, 8.726637128e-01f, 8.669420932e-01f, 8.603334037e-01f, 8.530721694e-01f,
+		8.454240055e-01f, 8.376762921e-01f, 8.301277971e-01f, 8.230776063e-01f, 8.168137549e-01f, 8.116019776e-01f, 8.076749952e-01f, 8.052227511e-01f,
+		8.043839821e-01f, 8.052394727e-01f, 8.078072851e-01f, 8.120401977e-01f, 8.178255045e-01f, 8.249872525e-01f, 8.332909017e-01f, 8.424503097e-01f,
+		8.521368514e-01f, 8.619904067e-01f, 8.716318709e-01f, 8.806767809e-01f, 8.887495962e-01f, 8.954981408e-01f, 9.006076869e-01f, 9.038141648e-01f,
+		9.049159930e-01f, 9.037840605e-01f, 9.003694413e-01f, 8.947084884e-01f, 8.869250345e-01f, 8.772295193e-01f, 8.659149620e-01f, 8.533498042e-01f,
+		8.399677561e-01f, 8.262548838e-01f, 8.127342767e-01f, 7.999487250e-01f, 7.884419179e-01f, 7.787387351e-01f, 7.713252560e-01f, 7.666291330e-01f,
+		7.650009871e-01f, 7.666974668e-01f, 7.718665780e-01f, 7.805358341e-01f, 7.926037026e-01f, 8.078347313e-01f, 8.258586303e-01f, 8.461734701e-01f,
+		8.681530290e-01f, 8.910581959e-01f, 9.140522055e-01f, 9.362193592e-01f, 9.565867704e-01f, 9.741485700e-01f, 9.878919193e-01f, 9.968241123e-01f,
+		1.000000000e+00f, 9.965489449e-01f, 9.857005162e-01f, 9.668081578e-01f, 9.393701094e-01f, 9.030469329e-01f, 8.576750863e-01f, 8.032760946e-01f,
+		7.400609935e-01f, 6.684298544e-01f, 5.889663418e-01f, 5.024273960e-01f, 4.097282800e-01f, 3.119233614e-01f, 2.101831294e-01f, 1.057680553e-01f,
+		2.365335522e-15f, -1.057680553e-01f, -2.101831294e-01f, -3.119233614e-01f, -4.097282800e-01f, -5.024273960e-01f, -5.889663418e-01f, -6.684298544e-01f,
+		-7.400609935e-01f, -8.032760946e-01f, -8.576750863e-01f, -9.030469329e-01f, -9.393701094e-01f, -9.668081578e-01f, -9.857005162e-01f, -9.965489449e-01f,
+		-1.000000000e+00f, -9.968241123e-01f, -9.878919193e-01f, -9.741485700e-01f, -9.565867704e-01f, -9.362193592e-01f, -9.140522055e-01f, -8.910581959e-01f,
+		-8.681530290e-01f, -8.461734701e-01f, -8.258586303e-01f, -8.078347313e-01f, -7.926037026e-01f, -7.805358341e-01f, -7.718665780e-01f, -7.666974668e-01f,
+		-7.650009871e-01f, -7.666291330e-01f, -7.713252560e-01f, -7.787387351e-01f, -7.884419179e-01f, -7.999487250e-01f, -8.127342767e-01f, -8.262548838e-01f,
+		-8.399677561e-01f, -8.533498042e-01f, -8.659149620e-01f, -8.772295193e-01f, -8.869250345e-01f, -8.947084884e-01f, -9.003694413e-01f, -9.037840605e-01f,
+		-9.049159930e-01f, -9.038141648e-01f, -9.006076869e-01f, -8.954981408e-01f, -8.887495962e-01f, -8.806767809e-01f, -8.716318709e-01f, -8.619904067e-01f,
+		-8.521368514e-01f, -8.424503097e-01f, -8.332909017e-01f, -8.249872525e-01f, -8.178255045e-01f, -8.120401977e-01f, -8.078072851e-01f, -8.052394727e-01f,
+		-8.043839821e-01f, -8.052227511e-01f, -8.076749952e-01f, -8.116019776e-01f, -8.168137549e-01f, -8.230776063e-01f, -8.301277971e-01f, -8.376762921e-01f,
+		-8.454240055e-01f, -8.530721694e-01f, -8.603334037e-01f, -8.669420932e-01f, -8.726637128e-01f, -8.773027839e-01f, -8.807092051e-01f, -8.827827628e-01f,
+		-8.834756985e-01f, -8.827932818e-01f, -8.807924114e-01f, -8.775783390e-01f, -8.732996755e-01f, -8.681418994e-01f, -8.623196370e-01f, -8.560680233e-01f,
+		-8.496334805e-01f, -8.432642652e-01f, -8.372011373e-01f, -8.316684922e-01f, -8.268662762e-01f, -8.229629662e-01f, -8.200898564e-01f, -8.183368366e-01f,
+		-8.177497931e-01f, -8.183296970e-01f, -8.200333862e-01f, -8.227759800e-01f, -8.264348091e-01f, -8.308546900e-01f, -8.358543229e-01f, -8.412335586e-01f,
+		-8.467812481e-01f, -8.522833747e-01f, -8.575311597e-01f, -8.623288415e-01f, -8.665008430e-01f, -8.698980693e-01f, -8.724031145e-01f, -8.739341998e-01f,
+		-8.744477152e-01f, -8.739392904e-01f, -8.724433759e-01f, -8.700313732e-01f, -8.668084032e-01f, -8.629088530e-01f, -8.584908864e-01f, -8.537301360e-01f,
+		-8.488128255e-01f, -8.439285864e-01f, -8.392632443e-01f, -8.349918428e-01f, -8.312721657e-01f, -8.282389930e-01f, -8.259992975e-01f, -8.246285490e-01f,
+		-8.241682532e-01f, -8.246248009e-01f, -8.259696548e-01f, -8.281408527e-01f, -8.310457525e-01f, -8.345649030e-01f, -8.385568818e-01f, -8.428639063e-01f,
+		-8.473179990e-01f, -8.517474691e-01f, -8.559834616e-01f, -8.598663285e-01f, -8.632515824e-01f, -8.660152147e-01f, -8.680581821e-01f, -8.693099040e-01f,
+		-8.697306469e-01f, -8.693127178e-01f, -8.680804345e-01f, -8.660888848e-01f, -8.634215335e-01f, -8.601867789e-01f, -8.565135988e-01f, -8.525464583e-01f,
+		-8.484396787e-01f, -8.443514858e-01f, -8.404379631e-01f, -8.368471419e-01f, -8.337134476e-01f, -8.311527113e-01f, -8.292579279e-01f, -8.280959162e-01f,
+		-8.277049997e-01f, -8.280937864e-01f, -8.292410846e-01f, -8.310969504e-01f, -8.335848162e-01f, -8.366046124e-01f, -8.400367561e-01f, -8.437468496e-01f,
+		-8.475909051e-01f, -8.514208945e-01f, -8.550904110e-01f, -8.584602288e-01f, -8.614035497e-01f, -8.638107415e-01f, -8.655933910e-01f, -8.666875240e-01f,
+		-8.670558755e-01f, -8.666891302e-01f, -8.656060938e-01f, -8.638527945e-01f, -8.615005566e-01f, -8.586431258e-01f, -8.553929589e-01f, -8.518768270e-01f,
+		-8.482309005e-01f, -8.445955054e-01f, -8.411097537e-01f, -8.379062495e-01f, -8.351060730e-01f, -8.328142306e-01f, -8.311157408e-01f, -8.300725014e-01f,
+		-8.297210520e-01f, -8.300713132e-01f, -8.311063441e-01f, -8.327831229e-01f, -8.350343155e-01f, -8.377709609e-01f, -8.408859657e-01f, -8.442582726e-01f,
+		-8.477575413e-01f, -8.512491604e-01f, -8.545994012e-01f, -8.576805136e-01f, -8.603755747e-01f, -8.625829028e-01f, -8.642198754e-01f, -8.652260045e-01f,
+		-8.655651578e-01f, -8.652268446e-01f, -8.642265193e-01f, -8.626048970e-01f, -8.604263088e-01f, -8.577761642e-01f, -8.547576188e-01f, -8.514875781e-01f,
+		-8.480921897e-01f, -8.447019993e-01f, -8.414469525e-01f, -8.384514368e-01f, -8.358295481e-01f, -8.336807646e-01f, -8.320861888e-01f, -8.311055004e-01f,
+		-8.307747340e-01f, -8.311049629e-01f, -8.320819381e-01f, -8.336666932e-01f, -8.357970898e-01f, -8.383902428e-01f, -8.413457315e-01f, -8.445494719e-01f,
+		-8.478781024e-01f, -8.512037142e-01f, -8.543987472e-01f, -8.573408621e-01f, -8.599176064e-01f, -8.620306951e-01f, -8.635997442e-01f, -8.645653165e-01f,
+		-8.648911631e-01f, -8.645655787e-01f, -8.636018185e-01f, -8.620375617e-01f, -8.599334454e-01f, -8.573707233e-01f, -8.544481404e-01f, -8.512781430e-01f,
+		-8.479825696e-01f, -8.446879863e-01f, -8.415208448e-01f, -8.386026485e-01f, -8.360453083e-01f, -8.339468689e-01f, -8.323877635e-01f, -8.314277433e-01f,
+		-8.311035963e-01f, -8.314277433e-01f, -8.323877635e-01f, -8.339468689e-01f, -8.360453083e-01f, -8.386026485e-01f, -8.415208448e-01f, -8.446879863e-01f,
+		-8.479825696e-01f, -8.512781430e-01f, -8.544481404e-01f, -8.573707233e-01f, -8.599334454e-01f, -8.620375617e-01f, -8.636018185e-01f, -8.645655787e-01f,
+		-8.648911631e-01f, -8.645653165e-01f, -8.635997442e-01f, -8.620306951e-01f, -8.599176064e-01f, -8.573408621e-01f, -8.543987472e-01f, -8.512037142e-01f,
+		-8.478781024e-01f, -8.445494719e-01f, -8.413457315e-01f, -8.383902428e-01f, -8.357970898e-01f, -8.336666932e-01f, -8.320819381e-01f, -8.311049629e-01f,
+		-8.307747340e-01f, -8.311055004e-01f, -8.320861888e-01f, -8.336807646e-01f, -8.358295481e-01f, -8.384514368e-01f, -8.414469525e-01f, -8.447019993e-01f,
+		-8.480921897e-01f, -8.514875781e-01f, -8.547576188e-01f, -8.577761642e-01f, -8.604263088e-01f, -8.626048970e-01f, -8.642265193e-01f, -8.652268446e-01f,
+		-8.655651578e-01f, -8.652260045e-01f, -8.642198754e-01f, -8.625829028e-01f, -8.603755747e-01f, -8.576805136e-01f, -8.545994012e-01f, -8.512491604e-01f,
+		-8.477575413e-01f, -8.442582726e-01f, -8.408859657e-01f, -8.377709609e-01f, -8.350343155e-01f, -8.327831229e-01f, -8.311063441e-01f, -8.300713132e-01f,
+		-8.297210520e-01f, -8.300725014e-01f, -8.311157408e-01f, -8.328142306e-01f, -8.351060730e-01f, -8.379062495e-01f, -8.411097537e-01f, -8.445955054e-01f,
+		-8.482309005e-01f, -8.518768270e-01f, -8.553929589e-01f, -8.586431258e-01f, -8.615005566e-01f, -8.638527945e-01f, -8.656060938e-01f, -8.666891302e-01f,
+		-8.670558755e-01f, -8.666875240e-01f, -8.655933910e-01f, -8.638107415e-01f, -8.614035497e-01f, -8.584602288e-01f, -8.550904110e-01f, -8.514208945e-01f,
+		-8.475909051e-01f, -8.437468496e-01f, -8.400367561e-01f, -8.366046124e-01f, -8.335848162e-01f, -8.310969504e-01f, -8.292410846e-01f, -8.280937864e-01f,
+		-8.277049997e-01f, -8.280959162e-01f, -8.292579279e-01f, -8.311527113e-01f, -8.337134476e-01f, -8.368471419e-01f, -8.404379631e-01f, -8.443514858e-01f,
+		-8.484396787e-01f, -8.525464583e-01f, -8.565135988e-01f, -8.601867789e-01f, -8.634215335e-01f, -8.660888848e-01f, -8.680804345e-01f, -8.693127178e-01f,
+		-8.697306469e-01f, -8.693099040e-01f, -8.680581821e-01f, -8.660152147e-01f, -8.632515824e-01f, -8.598663285e-01f, -8.559834616e-01f, -8.517474691e-01f,
+		-8.473179990e-01f, -8.428639063e-01f, -8.385568818e-01f, -8.345649030e-01f, -8.310457525e-01f, -8.281408527e-01f, -8.259696548e-01f, -8.246248009e-01f,
+		-8.241682532e-01f, -8.246285490e-01f, -8.259992975e-01f, -8.282389930e-01f, -8.312721657e-01f, -8.349918428e-01f, -8.392632443e-01f, -8.439285864e-01f,
+		-8.488128255e-01f, -8.537301360e-01f, -8.584908864e-01f, -8.629088530e-01f, -8.668084032e-01f, -8.700313732e-01f, -8.724433759e-01f, -8.739392904e-01f,
+		-8.744477152e-01f, -8.739341998e-01f, -8.724031145e-01f, -8.698980693e-01f, -8.665008430e-01f, -8.623288415e-01f, -8.575311597e-01f, -8.522833747e-01f,
+		-8.467812481e-01f, -8.412335586e-01f, -8.358543229e-01f, -8.308546900e-01f, -8.264348091e-01f, -8.227759800e-01f, -8.200333862e-01f, -8.183296970e-01f,
+		-8.177497931e-01f, -8.183368366e-01f, -8.200898564e-01f, -8.229629662e-01f, -8.268662762e-01f, -8.316684922e-01f, -8.372011373e-01f, -8.432642652e-01f,
+		-8.496334805e-01f, -8.560680233e-01f, -8.623196370e-01f, -8.681418994e-01f, -8.732996755e-01f, -8.775783390e-01f, -8.807924114e-01f, -8.827932818e-01f,
+		-8.834756985e-01f, -8.827827628e-01f, -8.807092051e-01f, -8.773027839e-01f, -8.726637128e-01f, -8.669420932e-01f, -8.603334037e-01f, -8.530721694e-01f,
+		-8.454240055e-01f, -8.376762921e-01f, -8.301277971e-01f, -8.230776063e-01f, -8.168137549e-01f, -8.116019776e-01f, -8.076749952e-01f, -8.052227511e-01f,
+		-8.043839821e-01f, -8.052394727e-01f, -8.078072851e-01f, -8.120401977e-01f, -8.178255045e-01f, -8.249872525e-01f, -8.332909017e-01f, -8.424503097e-01f,
+		-8.521368514e-01f, -8.619904067e-01f, -8.716318709e-01f, -8.806767809e-01f, -8.887495962e-01f, -8.954981408e-01f, -9.006076869e-01f, -9.038141648e-01f,
+		-9.049159930e-01f, -9.037840605e-01f, -9.003694413e-01f, -8.947084884e-01f, -8.869250345e-01f, -8.772295193e-01f, -8.659149620e-01f, -8.533498042e-01f,
+		-8.399677561e-01f, -8.262548838e-01f, -8.127342767e-01f, -7.999487250e-01f, -7.884419179e-01f, -7.787387351e-01f, -7.713252560e-01f, -7.666291330e-01f,
+		-7.650009871e-01f, -7.666974668e-01f, -7.718665780e-01f, -7.805358341e-01f, -7.926037026e-01f, -8.078347313e-01f, -8.258586303e-01f, -8.461734701e-01f,
+		-8.681530290e-01f, -8.910581959e-01f, -9.140522055e-01f, -9.362193592e-01f, -9.565867704e-01f, -9.741485700e-01f, -9.878919193e-01f, -9.968241123e-01f,
+		-1.000000000e+00f, -9.965489449e-01f, -9.857005162e-01f, -9.668081578e-01f, -9.393701094e-01f, -9.030469329e-01f, -8.576750863e-01f, -8.032760946e-01f,
+		-7.400609935e-01f, -6.684298544e-01f, -5.889663418e-01f, -5.024273960e-01f, -4.097282800e-01f, -3.119233614e-01f, -2.101831294e-01f, -1.057680553e-01f,
+		0.000000000e+00f,
+	},
+	{
+		0.000000000e+00f, 9.412358699e-06f, 3.764908043e-05f, 8.470910209e-05f, 1.505906519e-04f, 2.352912495e-04f, 3.388077058e-04f, 4.611361237e-04f,
+		6.022718974e-04f, 7.622097134e-04f, 9.409435499e-04f, 1.138466678e-03f, 1.354771661e-03f, 1.589850354e-03f, 1.843693909e-03f, 2.116292766e-03f,
+		2.407636664e-03f, 2.717714633e-03f, 3.046514999e-03f, 3.394025383e-03f, 3.760232701e-03f, 4.145123165e-03f, 4.548682286e-03f, 4.970894869e-03f,
+		5.411745018e-03f, 5.871216135e-03f, 6.349290921e-03f, 6.845951378e-03f, 7.361178806e-03f, 7.894953807e-03f, 8.447256284e-03f, 9.018065445e-03f,
+		9.607359798e-03f, 1.021511716e-02f, 1.084131464e-02f, 1.148592867e-02f, 1.214893498e-02f, 1.283030861e-02f, 1.353002390e-02f, 1.424805451e-02f,
+		1.498437340e-02f, 1.573895286e-02f, 1.651176448e-02f, 1.730277915e-02f, 1.811196710e-02f, 1.893929787e-02f, 1.978474029e-02f, 2.064826255e-02f,
+		2.152983213e-02f, 2.242941585e-02f, 2.334697982e-02f, 2.428248952e-02f, 2.523590970e-02f, 2.620720449e-02f, 2.719633731e-02f, 2.820327092e-02f,
+		2.922796741e-02f, 3.027038820e-02f, 3.133049404e-02f, 3.240824503e-02f, 3.350360058e-02f, 3.461651946e-02f, 3.574695976e-02f, 3.689487893e-02f,
+		3.806023374e-02f, 3.924298033e-02f, 4.044307415e-02f, 4.166047004e-02f, 4.289512215e-02f, 4.414698400e-02f, 4.541600845e-02f, 4.670214774e-02f,
+		4.800535344e-02f, 4.932557648e-02f, 5.066276715e-02f, 5.201687512e-02f, 5.338784940e-02f, 5.477563838e-02f, 5.618018980e-02f, 5.760145078e-02f,
+		5.903936783e-02f, 6.049388679e-02f, 6.196495290e-02f, 6.345251079e-02f, 6.495650445e-02f, 6.647687724e-02f, 6.801357194e-02f, 6.956653068e-02f,
+		7.113569500e-02f, 7.272100582e-02f, 7.432240345e-02f, 7.593982760e-02f, 7.757321738e-02f, 7.922251128e-02f, 8.088764722e-02f, 8.256856251e-02f,
+		8.426519385e-02f, 8.597747737e-02f, 8.770534861e-02f, 8.944874250e-02f, 9.120759342e-02f, 9.298183515e-02f, 9.477140087e-02f, 9.657622323e-02f,
+		9.839623426e-02f, 1.002313654e-01f, 1.020815477e-01f, 1.039467113e-01f, 1.058267862e-01f, 1.077217014e-01f, 1.096313857e-01f, 1.115557672e-01f,
+		1.134947733e-01f, 1.154483312e-01f, 1.174163672e-01f, 1.193988073e-01f, 1.213955767e-01f, 1.234066005e-01f, 1.254318027e-01f, 1.274711073e-01f,
+		1.295244373e-01f, 1.315917156e-01f, 1.336728642e-01f, 1.357678048e-01f, 1.378764585e-01f, 1.399987460e-01f, 1.421345874e-01f, 1.442839021e-01f,
+		1.464466094e-01f, 1.486226278e-01f, 1.508118753e-01f, 1.530142696e-01f, 1.552297276e-01f, 1.574581661e-01f, 1.596995011e-01f, 1.619536482e-01f,
+		1.642205226e-01f, 1.665000388e-01f, 1.687921112e-01f, 1.710966534e-01f, 1.734135785e-01f, 1.757427995e-01f, 1.780842286e-01f, 1.804377776e-01f,
+		1.828033579e-01f, 1.851808805e-01f, 1.875702559e-01f, 1.899713941e-01f, 1.923842047e-01f, 1.948085969e-01f, 1.972444793e-01f, 1.996917603e-01f,
+		2.021503478e-01f, 2.046201491e-01f, 2.071010713e-01f, 2.095930210e-01f, 2.120959043e-01f, 2.146096271e-01f, 2.171340946e-01f, 2.196692119e-01f,
+		2.222148835e-01f, 2.247710135e-01f, 2.273375058e-01f, 2.299142636e-01f, 2.325011901e-01f, 2.350981877e-01f, 2.377051587e-01f, 2.403220049e-01f,
+		2.429486279e-01f, 2.455849287e-01f, 2.482308081e-01f, 2.508861665e-01f, 2.535509039e-01f, 2.562249199e-01f, 2.589081140e-01f, 2.616003850e-01f,
+		2.643016316e-01f, 2.670117521e-01f, 2.697306445e-01f, 2.724582064e-01f, 2.751943352e-01f, 2.779389277e-01f, 2.806918807e-01f, 2.834530906e-01f,
+		2.862224533e-01f, 2.889998646e-01f, 2.917852200e-01f, 2.945784145e-01f, 2.973793430e-01f, 3.001879001e-01f, 3.030039800e-01f, 3.058274767e-01f,
+		3.086582838e-01f, 3.114962949e-01f, 3.143414030e-01f, 3.171935011e-01f, 3.200524817e-01f, 3.229182373e-01f, 3.257906599e-01f, 3.286696413e-01f,
+		3.315550733e-01f, 3.344468471e-01f, 3.373448539e-01f, 3.402489846e-01f, 3.431591298e-01f, 3.460751800e-01f, 3.489970253e-01f, 3.519245559e-01f,
+		3.548576614e-01f, 3.577962314e-01f, 3.607401553e-01f, 3.636893223e-01f, 3.666436213e-01f, 3.696029410e-01f, 3.725671702e-01f, 3.755361971e-01f,
+		3.785099100e-01f, 3.814881970e-01f, 3.844709459e-01f, 3.874580443e-01f, 3.904493799e-01f, 3.934448400e-01f, 3.964443119e-01f, 3.994476826e-01f,
+		4.024548390e-01f, 4.054656679e-01f, 4.084800560e-01f, 4.114978898e-01f, 4.145190556e-01f, 4.175434398e-01f, 4.205709283e-01f, 4.236014074e-01f,
+		4.266347628e-01f, 4.296708803e-01f, 4.327096457e-01f, 4.357509446e-01f, 4.387946624e-01f, 4.418406845e-01f, 4.448888964e-01f, 4.479391831e-01f,
+		4.509914298e-01f, 4.540455218e-01f, 4.571013438e-01f, 4.601587810e-01f, 4.632177182e-01f, 4.662780402e-01f, 4.693396318e-01f, 4.724023778e-01f,
+		4.754661628e-01f, 4.785308715e-01f, 4.815963885e-01f, 4.846625984e-01f, 4.877293857e-01f, 4.907966350e-01f, 4.938642309e-01f, 4.969320577e-01f,
+		5.000000000e-01f, 5.030679423e-01f, 5.061357691e-01f, 5.092033650e-01f, 5.122706143e-01f, 5.153374016e-01f, 5.184036115e-01f, 5.214691285e-01f,
+		5.245338372e-01f, 5.275976222e-01f, 5.306603682e-01f, 5.337219598e-01f, 5.367822818e-01f, 5.398412190e-01f, 5.428986562e-01f, 5.459544782e-01f,
+		5.490085702e-01f, 5.520608169e-01f, 5.551111036e-01f, 5.581593155e-01f, 5.612053376e-01f, 5.642490554e-01f, 5.672903543e-01f, 5.703291197e-01f,
+		5.733652372e-01f, 5.763985926e-01f, 5.794290717e-01f, 5.824565602e-01f, 5.854809444e-01f, 5.885021102e-01f, 5.915199440e-01f, 5.945343321e-01f,
+		5.975451610e-01f, 6.005523174e-01f, 6.035556881e-01f, 6.065551600e-01f, 6.095506201e-01f, 6.125419557e-01f, 6.155290541e-01f, 6.185118030e-01f,
+		6.214900900e-01f, 6.244638029e-01f, 6.274328298e-01f, 6.303970590e-01f, 6.333563787e-01f, 6.363106777e-01f, 6.392598447e-01f, 6.422037686e-01f,
+		6.451423386e-01f, 6.480754441e-01f, 6.510029747e-01f, 6.539248200e-01f, 6.568408702e-01f, 6.597510154e-01f, 6.626551461e-01f, 6.655531529e-01f,
+		6.684449267e-01f, 6.713303587e-01f, 6.742093401e-01f, 6.770817627e-01f, 6.799475183e-01f, 6.828064989e-01f, 6.856585970e-01f, 6.885037051e-01f,
+		6.913417162e-01f, 6.941725233e-01f, 6.969960200e-01f, 6.998120999e-01f, 7.026206570e-01f, 7.054215855e-01f, 7.082147800e-01f, 7.110001354e-01f,
+		7.137775467e-01f, 7.165469094e-01f, 7.193081193e-01f, 7.220610723e-01f, 7.248056648e-01f, 7.275417936e-01f, 7.302693555e-01f, 7.329882479e-01f,
+		7.356983684e-01f, 7.383996150e-01f, 7.410918860e-01f, 7.437750801e-01f, 7.464490961e-01f, 7.491138335e-01f, 7.517691919e-01f, 7.544150713e-01f,
+		7.570513721e-01f, 7.596779951e-01f, 7.622948413e-01f, 7.649018123e-01f, 7.674988099e-01f, 7.700857364e-01f, 7.726624942e-01f, 7.752289865e-01f,
+		7.777851165e-01f, 7.803307881e-01f, 7.828659054e-01f, 7.853903729e-01f, 7.879040957e-01f, 7.904069790e-01f, 7.928989287e-01f, 7.953798509e-01f,
+		7.978496522e-01f, 8.003082397e-01f, 8.027555207e-01f, 8.051914031e-01f, 8.076157953e-01f, 8.100286059e-01f, 8.124297441e-01f, 8.148191195e-01f,
+		8.171966421e-01f, 8.195622224e-01f, 8.219157714e-01f, 8.242572005e-01f, 8.265864215e-01f, 8.289033466e-01f, 8.312078888e-01f, 8.334999612e-01f,
+		8.357794774e-01f, 8.380463518e-01f, 8.403004989e-01f, 8.425418339e-01f, 8.447702724e-01f, 8.469857304e-01f, 8.491881247e-01f, 8.513773722e-01f,
+		8.535533906e-01f, 8.557160979e-01f, 8.578654126e-01f, 8.600012540e-01f, 8.621235415e-01f, 8.642321952e-01f, 8.663271358e-01f, 8.684082844e-01f,
+		8.704755627e-01f, 8.725288927e-01f, 8.745681973e-01f, 8.765933995e-01f, 8.786044233e-01f, 8.806011927e-01f, 8.825836328e-01f, 8.845516688e-01f,
+		8.865052267e-01f, 8.884442328e-01f, 8.903686143e-01f, 8.922782986e-01f, 8.941732138e-01f, 8.960532887e-01f, 8.979184523e-01f, 8.997686346e-01f,
+		9.016037657e-01f, 9.034237768e-01f, 9.052285991e-01f, 9.070181649e-01f, 9.087924066e-01f, 9.105512575e-01f, 9.122946514e-01f, 9.140225226e-01f,
+		9.157348062e-01f, 9.174314375e-01f, 9.191123528e-01f, 9.207774887e-01f, 9.224267826e-01f, 9.240601724e-01f, 9.256775966e-01f, 9.272789942e-01f,
+		9.288643050e-01f, 9.304334693e-01f, 9.319864281e-01f, 9.335231228e-01f, 9.350434956e-01f, 9.365474892e-01f, 9.380350471e-01f, 9.395061132e-01f,
+		9.409606322e-01f, 9.423985492e-01f, 9.438198102e-01f, 9.452243616e-01f, 9.466121506e-01f, 9.479831249e-01f, 9.493372328e-01f, 9.506744235e-01f,
+		9.519946466e-01f, 9.532978523e-01f, 9.545839915e-01f, 9.558530160e-01f, 9.571048779e-01f, 9.583395300e-01f, 9.595569258e-01f, 9.607570197e-01f,
+		9.619397663e-01f, 9.631051211e-01f, 9.642530402e-01f, 9.653834805e-01f, 9.664963994e-01f, 9.675917550e-01f, 9.686695060e-01f, 9.697296118e-01f,
+		9.707720326e-01f, 9.717967291e-01f, 9.728036627e-01f, 9.737927955e-01f, 9.747640903e-01f, 9.757175105e-01f, 9.766530202e-01f, 9.775705842e-01f,
+		9.784701679e-01f, 9.793517374e-01f, 9.802152597e-01f, 9.810607021e-01f, 9.818880329e-01f, 9.826972208e-01f, 9.834882355e-01f, 9.842610471e-01f,
+		9.850156266e-01f, 9.857519455e-01f, 9.864699761e-01f, 9.871696914e-01f, 9.878510650e-01f, 9.885140713e-01f, 9.891586854e-01f, 9.897848828e-01f,
+		9.903926402e-01f, 9.909819346e-01f, 9.915527437e-01f, 9.921050462e-01f, 9.926388212e-01f, 9.931540486e-01f, 9.936507091e-01f, 9.941287839e-01f,
+		9.945882550e-01f, 9.950291051e-01f, 9.954513177e-01f, 9.958548768e-01f, 9.962397673e-01f, 9.966059746e-01f, 9.969534850e-01f, 9.972822854e-01f,
+		9.975923633e-01f, 9.978837072e-01f, 9.981563061e-01f, 9.984101496e-01f, 9.986452283e-01f, 9.988615333e-01f, 9.990590565e-01f, 9.992377903e-01f,
+		9.993977281e-01f, 9.995388639e-01f, 9.996611923e-01f, 9.997647088e-01f, 9.998494093e-01f, 9.999152909e-01f, 9.999623509e-01f, 9.999905876e-01f,
+		1.000000000e+00f, 9.999905876e-01f, 9.999623509e-01f, 9.999152909e-01f, 9.998494093e-01f, 9.997647088e-01f, 9.996611923e-01f, 9.995388639e-01f,
+		9.993977281e-01f, 9.992377903e-01f, 9.990590565e-01f, 9.988615333e-01f, 9.986452283e-01f, 9.984101496e-01f, 9.981563061e-01f, 9.978837072e-01f,
+		9.975923633e-01f, 9.972822854e-01f, 9.969534850e-01f, 9.966059746e-01f, 9.962397673e-01f, 9.958548768e-01f, 9.954513177e-01f, 9.950291051e-01f,
+		9.945882550e-01f, 9.941287839e-01f, 9.936507091e-01f, 9.931540486e-01f, 9.926388212e-01f, 9.921050462e-01f, 9.915527437e-01f, 9.909819346e-01f,
+		9.903926402e-01f, 9.897848828e-01f, 9.891586854e-01f, 9.885140713e-01f, 9.878510650e-01f, 9.871696914e-01f, 9.864699761e-01f, 9.857519455e-01f,
+		9.850156266e-01f, 9.842610471e-01f, 9.834882355e-01f, 9.826972208e-01f, 9.818880329e-01f, 9.810607021e-01f, 9.802152597e-01f, 9.793517374e-01f,
+		9.784701679e-01f, 9.775705842e-01f, 9.766530202e-01f, 9.757175105e-01f, 9.747640903e-01f, 9.737927955e-01f, 9.728036627e-01f, 9.717967291e-01f,
+		9.707720326e-01f, 9.697296118e-01f, 9.686695060e-01f, 9.675917550e-01f, 9.664963994e-01f, 9.653834805e-01f, 9.642530402e-01f, 9.631051211e-01f,
+		9.619397663e-01f, 9.607570197e-01f, 9.595569258e-01f, 9.583395300e-01f, 9.571048779e-01f, 9.558530160e-01f, 9.545839915e-01f, 9.532978523e-01f,
+		9.519946466e-01f, 9.506744235e-01f, 9.493372328e-01f, 9.479831249e-01f, 9.466121506e-01f, 9.452243616e-01f, 9.438198102e-01f, 9.423985492e-01f,
+		9.409606322e-01f, 9.395061132e-01f, 9.380350471e-01f, 9.365474892e-01f, 9.350434956e-01f, 9.335231228e-01f, 9.319864281e-01f, 9.304334693e-01f,
+		9.288643050e-01f, 9.272789942e-01f, 9.256775966e-01f, 9.240601724e-01f, 9.224267826e-01f, 9.207774887e-01f, 9.191123528e-01f, 9.174314375e-01f,
+		9.157348062e-01f, 9.140225226e-01f, 9.122946514e-01f, 9.105512575e-01f, 9.087924066e-01f, 9.070181649e-01f, 9.052285991e-01f, 9.034237768e-01f,
+		9.016037657e-01f, 8.997686346e-01f, 8.979184523e-01f, 8.960532887e-01f, 8.941732138e-01f, 8.922782986e-01f, 8.903686143e-01f, 8.884442328e-01f,
+		8.865052267e-01f, 8.845516688e-01f, 8.825836328e-01f, 8.806011927e-01f, 8.786044233e-01f, 8.765933995e-01f, 8.745681973e-01f, 8.725288927e-01f,
+		8.704755627e-01f, 8.684082844e-01f, 8.663271358e-01f, 8.642321952e-01f, 8.621235415e-01f, 8.600012540e-01f, 8.578654126e-01f, 8.557160979e-01f,
+		8.535533906e-01f, 8.513773722e-01f, 8.491881247e-01f, 8.469857304e-01f, 8.447702724e-01f, 8.425418339e-01f, 8.403004989e-01f, 8.380463518e-01f,
+		8.357794774e-01f, 8.334999612e-01f, 8.312078888e-01f, 8.289033466e-01f, 8.265864215e-01f, 8.242572005e-01f, 8.219157714e-01f, 8.195622224e-01f,
+		8.171966421e-01f, 8.148191195e-01f, 8.124297441e-01f, 8.100286059e-01f, 8.076157953e-01f, 8.051914031e-01f, 8.027555207e-01f, 8.003082397e-01f,
+		7.978496522e-01f, 7.953798509e-01f, 7.928989287e-01f, 7.904069790e-01f, 7.879040957e-01f, 7.853903729e-01f, 7.828659054e-01f, 7.803307881e-01f,
+		7.777851165e-01f, 7.752289865e-01f, 7.726624942e-01f, 7.700857364e-01f, 7.674988099e-01f, 7.649018123e-01f, 7.622948413e-01f, 7.596779951e-01f,
+		7.570513721e-01f, 7.544150713e-01f, 7.517691919e-01f, 7.491138335e-01f, 7.464490961e-01f, 7.437750801e-01f, 7.410918860e-01f, 7.383996150e-01f,
+		7.356983684e-01f, 7.329882479e-01f, 7.302693555e-01f, 7.275417936e-01f, 7.248056648e-01f, 7.220610723e-01f, 7.193081193e-01f, 7.165469094e-01f,
+		7.137775467e-01f, 7.110001354e-01f, 7.082147800e-01f, 7.054215855e-01f, 7.026206570e-01f, 6.998120999e-01f, 6.969960200e-01f, 6.941725233e-01f,
+		6.913417162e-01f, 6.885037051e-01f, 6.856585970e-01f, 6.828064989e-01f, 6.799475183e-01f, 6.770817627e-01f, 6.742093401e-01f, 6.713303587e-01f,
+		6.684449267e-01f, 6.655531529e-01f, 6.626551461e-01f, 6.597510154e-01f, 6.568408702e-01f, 6.539248200e-01f, 6.510029747e-01f, 6.480754441e-01f,
+		6.451423386e-01f, 6.422037686e-01f, 6.392598447e-01f, 6.363106777e-01f, 6.333563787e-01f, 6.303970590e-01f, 6.274328298e-01f, 6.244638029e-01f,
+		6.214900900e-01f, 6.185118030e-01f, 6.155290541e-01f, 6.125419557e-01f, 6.095506201e-01f, 6.065551600e-01f, 6.035556881e-01f, 6.005523174e-01f,
+		5.975451610e-01f, 5.945343321e-01f, 5.915199440e-01f, 5.885021102e-01f, 5.854809444e-01f, 5.824565602e-01f, 5.794290717e-01f, 5.763985926e-01f,
+		5.733652372e-01f, 5.703291197e-01f, 5.672903543e-01f, 5.642490554e-01f, 5.612053376e-01f, 5.581593155e-01f, 5.551111036e-01f, 5.520608169e-01f,
+		5.490085702e-01f, 5.459544782e-01f, 5.428986562e-01f, 5.398412190e-01f, 5.367822818e-01f, 5.337219598e-01f, 5.306603682e-01f, 5.275976222e-01f,
+		5.245338372e-01f, 5.214691285e-01f, 5.184036115e-01f, 5.153374016e-01f, 5.122706143e-01f, 5.092033650e-01f, 5.061357691e-01f, 5.030679423e-01f,
+		5.000000000e-01f, 4.969320577e-01f, 4.938642309e-01f, 4.907966350e-01f, 4.877293857e-01f, 4.846625984e-01f, 4.815963885e-01f, 4.785308715e-01f,
+		4.754661628e-01f, 4.724023778e-01f, 4.693396318e-01f, 4.662780402e-01f, 4.632177182e-01f, 4.601587810e-01f, 4.571013438e-01f, 4.540455218e-01f,
+		4.509914298e-01f, 4.479391831e-01f, 4.448888964e-01f, 4.418406845e-01f, 4.387946624e-01f, 4.357509446e-01f, 4.327096457e-01f, 4.296708803e-01f,
+		4.266347628e-01f, 4.236014074e-01f, 4.205709283e-01f, 4.175434398e-01f, 4.145190556e-01f, 4.114978898e-01f, 4.084800560e-01f, 4.054656679e-01f,
+		4.024548390e-01f, 3.994476826e-01f, 3.964443119e-01f, 3.934448400e-01f, 3.904493799e-01f, 3.874580443e-01f, 3.844709459e-01f, 3.814881970e-01f,
+		3.785099100e-01f, 3.755361971e-01f, 3.725671702e-01f, 3.696029410e-01f, 3.666436213e-01f, 3.636893223e-01f, 3.607401553e-01f, 3.577962314e-01f,
+		3.548576614e-01f, 3.519245559e-01f, 3.489970253e-01f, 3.460751800e-01f, 3.431591298e-01f, 3.402489846e-01f, 3.373448539e-01f, 3.344468471e-01f,
+		3.315550733e-01f, 3.286696413e-01f, 3.257906599e-01f, 3.229182373e-01f, 3.200524817e-01f, 3.171935011e-01f, 3.143414030e-01f, 3.114962949e-01f,
+		3.086582838e-01f, 3.058274767e-01f, 3.030039800e-01f, 3.001879001e-01f, 2.973793430e-01f, 2.945784145e-01f, 2.917852200e-01f, 2.889998646e-01f,
+		2.862224533e-01f, 2.834530906e-01f, 2.806918807e-01f, 2.779389277e-01f, 2.751943352e-01f, 2.724582064e-01f, 2.697306445e-01f, 2.670117521e-01f,
+		2.643016316e-01f, 2.616003850e-01f, 2.589081140e-01f, 2.562249199e-01f, 2.535509039e-01f, 2.508861665e-01f, 2.482308081e-01f, 2.455849287e-01f,
+		2.429486279e-01f, 2.403220049e-01f, 2.377051587e-01f, 2.350981877e-01f, 2.325011901e-01f, 2.299142636e-01f, 2.273375058e-01f, 2.247710135e-01f,
+		2.222148835e-01f, 2.196692119e-01f, 2.171340946e-01f, 2.146096271e-01f, 2.120959043e-01f, 2.095930210e-01f, 2.071010713e-01f, 2.046201491e-01f,
+		2.021503478e-01f, 1.996917603e-01f, 1.972444793e-01f, 1.948085969e-01f, 1.923842047e-01f, 1.899713941e-01f, 1.875702559e-01f, 1.851808805e-01f,
+		1.828033579e-01f, 1.804377776e-01f, 1.780842286e-01f, 1.757427995e-01f, 1.734135785e-01f, 1.710966534e-01f, 1.687921112e-01f, 1.665000388e-01f,
+		1.642205226e-01f, 1.619536482e-01f, 1.596995011e-01f, 1.574581661e-01f, 1.552297276e-01f, 1.530142696e-01f, 1.508118753e-01f, 1.486226278e-01f,
+		1.464466094e-01f, 1.442839021e-01f, 1.421345874e-01f, 1.399987460e-01f, 1.378764585e-01f, 1.357678048e-01f, 1.336728642e-01f, 1.315917156e-01f,
+		1.295244373e-01f, 1.274711073e-01f, 1.254318027e-01f, 1.234066005e-01f, 1.213955767e-01f, 1.193988073e-01f, 1.174163672e-01f, 1.154483312e-01f,
+		1.134947733e-01f, 1.115557672e-01f, 1.096313857e-01f, 1.077217014e-01f, 1.058267862e-01f, 1.039467113e-01f, 1.020815477e-01f, 1.002313654e-01f,
+		9.839623426e-02f, 9.657622323e-02f, 9.477140087e-02f, 9.298183515e-02f, 9.120759342e-02f, 8.944874250e-02f, 8.770534861e-02f, 8.597747737e-02f,
+		8.426519385e-02f, 8.256856251e-02f, 8.088764722e-02f, 7.922251128e-02f, 7.757321738e-02f, 7.593982760e-02f, 7.432240345e-02f, 7.272100582e-02f,
+		7.113569500e-02f, 6.956653068e-02f, 6.801357194e-02f, 6.647687724e-02f, 6.495650445e-02f, 6.345251079e-02f, 6.196495290e-02f, 6.049388679e-02f,
+		5.903936783e-02f, 5.760145078e-02f, 5.618018980e-02f, 5.477563838e-02f, 5.338784940e-02f, 5.201687512e-02f, 5.066276715e-02f, 4.932557648e-02f,
+		4.800535344e-02f, 4.670214774e-02f, 4.541600845e-02f, 4.414698400e-02f, 4.289512215e-02f, 4.166047004e-02f, 4.044307415e-02f, 3.924298033e-02f,
+		3.806023374e-02f, 3.689487893e-02f, 3.574695976e-02f, 3.461651946e-02f, 3.350360058e-02f, 3.240824503e-02f, 3.133049404e-02f, 3.027038820e-02f,
+		2.922796741e-02f, 2.820327092e-02f, 2.719633731e-02f, 2.620720449e-02f, 2.523590970e-02f, 2.428248952e-02f, 2.334697982e-02f, 2.242941585e-02f,
+		2.152983213e-02f, 2.064826255e-02f, 1.978474029e-02f, 1.893929787e-02f, 1.811196710e-02f, 1.730277915e-02f, 1.651176448e-02f, 1.573895286e-02f,
+		1.498437340e-02f, 1.424805451e-02f, 1.353002390e-02f, 1.283030861e-02f, 1.214893498e-02f, 1.148592867e-02f, 1.084131464e-02f, 1.021511716e-02f,
+		9.607359798e-03f, 9.018065445e-03f, 8.447256284e-03f, 7.894953807e-03f, 7.361178806e-03f, 6.845951378e-03f, 6.349290921e-03f, 5.871216135e-03f,
+		5.411745018e-03f, 4.970894869e-03f, 4.548682286e-03f, 4.145123165e-03f, 3.760232701e-03f, 3.394025383e-03f, 3.046514999e-03f, 2.717714633e-03f,
+		2.407636664e-03f, 2.116292766e-03f, 1.843693909e-03f, 1.589850354e-03f, 1.354771661e-03f, 1.138466678e-03f, 9.409435499e-04f, 7.622097134e-04f,
+		6.022718974e-04f, 4.611361237e-04f, 3.388077058e-04f, 2.352912495e-04f, 1.505906519e-04f, 8.470910209e-05f, 3.764908043e-05f, 9.412358699e-06f,
+		0.000000000e+00f,
+	},
+};
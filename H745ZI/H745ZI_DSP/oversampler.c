@@ -0,0 +1,264 @@
+// oversampler.c, Michael Haselberger
+// Description: Polyphase oversampling for nonlinear effects. Clipping creates harmonics far above Fs / 2, which
+// alias back into the audio band at 48 kHz. Running the nonlinearity at 2x to 8x the sample rate between a CMSIS
+// FIR interpolator and decimator removes them before the signal returns to 48 kHz.
+
+#include "oversampler.h"
+#if defined(PROFILER)
+#include "profiler.h"
+#endif
+
+// prototype lowpass cutoff. leaves the transition band above 20 kHz, where nothing audible is lost
+#define OVERSAMPLER_CUTOFF_HZ 20000.0f
+
+// filter memory of one instance: interpolator (numTaps / L + blockSize - 1), decimator (numTaps + L * blockSize - 1)
+// with blockSize = OVERSAMPLER_CHUNK_SIZE
+#define INTERPOLATOR_STATE_SIZE (OVERSAMPLER_TAPS_PER_PHASE + OVERSAMPLER_CHUNK_SIZE - 1)
+#define DECIMATOR_STATE_SIZE (OVERSAMPLER_MAX_TAPS + OVERSAMPLER_MAX_FACTOR * OVERSAMPLER_CHUNK_SIZE - 1)
+
+_Static_assert((OVERSAMPLER_CHUNK_SIZE >= 1) && (OVERSAMPLER_CHUNK_SIZE <= MAX_BLOCK_SIZE), "OVERSAMPLER_CHUNK_SIZE has to be 1 to MAX_BLOCK_SIZE");
+
+// the oversampled chunk. all oversamplers run in the audio interrupt, so they can share it
+static float32_t __attribute__((aligned(32))) DTCM_DATA upsampled[OVERSAMPLER_MAX_FACTOR * OVERSAMPLER_CHUNK_SIZE];
+static float32_t __attribute__((aligned(32))) DTCM_DATA state_pool[OVERSAMPLER_MAX_INSTANCES][INTERPOLATOR_STATE_SIZE + DECIMATOR_STATE_SIZE];
+static uint8_t pool_used = 0;
+
+// lowpass of the factors 2, 4 and 8. the interpolator coefficients are scaled by the factor to make up for the inserted zeros
+static float32_t interpolator_coeffs[3][OVERSAMPLER_MAX_TAPS];
+static float32_t decimator_coeffs[3][OVERSAMPLER_MAX_TAPS];
+// sample rate the filters are designed for, 0: not designed yet
+static uint32_t filters_rate = 0;
+
+static inline bool valid_factor(uint8_t factor)
+{
+	return ((factor == 1) || (factor == 2) || (factor == 4) || (factor == 8)) ? true : false;
+}
+
+// row of the coefficient tables: 2 -> 0, 4 -> 1, 8 -> 2
+static inline uint8_t factor_index(uint8_t factor)
+{
+	return (factor == 2) ? 0 : ((factor == 4) ? 1 : 2);
+}
+
+/******************************************************************************
+* Function Name: design_filters
+*******************************************************************************
+* Summary:
+*  Design the Blackman windowed sinc lowpass for every factor. The filters are symmetric, so the
+*  time reversed coefficient order CMSIS expects doesn't matter. Normalized to unity DC gain.
+*
+******************************************************************************/
+static void design_filters(void)
+{
+	for (uint8_t factor = 2; factor <= OVERSAMPLER_MAX_FACTOR; factor <<= 1)
+	{
+		const uint32_t taps = OVERSAMPLER_TAPS_PER_PHASE * factor;
+		// cutoff relative to the oversampled rate
+		const float32_t fc = OVERSAMPLER_CUTOFF_HZ / ((float32_t)sample_rate * factor);
+		float32_t *h = decimator_coeffs[factor_index(factor)];
+		float32_t sum = 0;
+
+		for (uint32_t k = 0; k < taps; ++k)
+		{
+			const float32_t t = (float32_t)k - 0.5f * (taps - 1);
+			const float32_t x = 2.0f * PI * fc * t;
+			const float32_t sinc = (t == 0) ? 2.0f * fc : 2.0f * fc * arm_sin_f32(x) / x;
+			const float32_t phase = 2.0f * PI * k / (taps - 1);
+			const float32_t window = 0.42f - 0.5f * arm_cos_f32(phase) + 0.08f * arm_cos_f32(2.0f * phase);
+			h[k] = sinc * window;
+			sum += h[k];
+		}
+		for (uint32_t k = 0; k < taps; ++k)
+		{
+			h[k] /= sum;
+			interpolator_coeffs[factor_index(factor)][k] = h[k] * factor;
+		}
+	}
+	filters_rate = sample_rate;
+}
+
+// set up the CMSIS instances for a factor. clears the filter memory
+static void configure(oversampler_t *os, uint8_t factor)
+{
+	os->current = factor;
+	if (factor == 1)
+		return;
+
+	const uint16_t taps = OVERSAMPLER_TAPS_PER_PHASE * factor;
+	const uint8_t index = factor_index(factor);
+	// the block size only determines how much state is cleared, the actual size is passed with every chunk
+	arm_fir_interpolate_init_f32(&os->interpolator, factor, taps, interpolator_coeffs[index], os->interpolator_state, OVERSAMPLER_CHUNK_SIZE);
+	arm_fir_decimate_init_f32(&os->decimator, taps, factor, decimator_coeffs[index], os->decimator_state, factor * OVERSAMPLER_CHUNK_SIZE);
+}
+
+/******************************************************************************
+* Function Name: oversampler_init
+*******************************************************************************
+* Summary:
+*  Initialize an oversampler. The filter memory is taken from a static pool in DTCM the first
+*  time, later calls reuse it.
+*
+* Parameters:
+*  1. oversampler_t *os				- Address pointer of the oversampler struct.
+*  2. uint8_t factor				- Oversampling factor: 1 (off), 2, 4 or 8.
+* Return:
+*  255:								- Oversampler points to NULL.
+*  254:								- Factor not supported.
+*  253:								- Filter memory pool exhausted (see OVERSAMPLER_MAX_INSTANCES).
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t oversampler_init(oversampler_t *os, uint8_t factor)
+{
+	if (os == NULL)
+	{
+		return 255;
+	}
+	if (!valid_factor(factor))
+	{
+		return 254;
+	}
+	if (os->interpolator_state == NULL)
+	{
+		if (pool_used >= OVERSAMPLER_MAX_INSTANCES)
+		{
+			return 253;
+		}
+		os->interpolator_state = state_pool[pool_used];
+		os->decimator_state = &state_pool[pool_used][INTERPOLATOR_STATE_SIZE];
+		pool_used++;
+	}
+	if (filters_rate != sample_rate)
+	{
+		design_filters();
+	}
+
+	os->factor = factor;
+	os->limit = OVERSAMPLER_MAX_FACTOR;
+	configure(os, factor);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: oversampler_set_factor
+*******************************************************************************
+* Summary:
+*  Select another oversampling factor. Takes effect with the next block, the filters start
+*  from silence then.
+*
+* Parameters:
+*  1. oversampler_t *os				- Address pointer of the oversampler struct.
+*  2. uint8_t factor				- Oversampling factor: 1 (off), 2, 4 or 8.
+* Return:
+*  255:								- Oversampler not initialized.
+*  254:								- Factor not supported.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t oversampler_set_factor(oversampler_t *os, uint8_t factor)
+{
+	if (os->interpolator_state == NULL)
+	{
+		return 255;
+	}
+	if (!valid_factor(factor))
+	{
+		return 254;
+	}
+	os->factor = factor;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: oversampler_set_limit
+*******************************************************************************
+* Summary:
+*  Cap the oversampling factor without changing the requested one, e.g. to save CPU time.
+*  Takes effect with the next block like oversampler_set_factor.
+*
+* Parameters:
+*  1. oversampler_t *os				- Address pointer of the oversampler struct.
+*  2. uint8_t limit					- Highest factor: 1 (off), 2, 4 or 8 (OVERSAMPLER_MAX_FACTOR = no limit).
+* Return:
+*  255:								- Oversampler not initialized.
+*  254:								- Factor not supported.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t oversampler_set_limit(oversampler_t *os, uint8_t limit)
+{
+	if (os->interpolator_state == NULL)
+	{
+		return 255;
+	}
+	if (!valid_factor(limit))
+	{
+		return 254;
+	}
+	os->limit = limit;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: oversampler_process
+*******************************************************************************
+* Summary:
+*  Run a node at the oversampled rate: interpolate, process, decimate. Blocks longer than
+*  OVERSAMPLER_CHUNK_SIZE go through in chunks of that size, the node is called once per chunk.
+*  The cycles of the two filters are added to the PROFILE_OVERSAMPLING section of the profiler.
+*
+* Parameters:
+*  1. oversampler_t *os				- Address pointer of an initialized oversampler struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block.
+*  4. uint32_t block_size			- Number of samples in src and dst. Must not exceed MAX_BLOCK_SIZE.
+*  5. oversampler_node node			- Nonlinear processing. Gets factor * chunk samples, in and out
+*									  point to the same buffer (processing in place).
+*  6. void *ctx						- Context passed to node.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void oversampler_process(oversampler_t *os, const float32_t *src, float32_t *dst, uint32_t block_size, oversampler_node node, void *ctx)
+{
+	const uint8_t factor = oversampler_factor(os);
+	if (factor != os->current)
+	{
+		configure(os, factor);
+	}
+	if (factor == 1)
+	{
+		node(ctx, src, dst, block_size);
+		return;
+	}
+
+#if defined(PROFILER)
+	uint32_t cycles = 0;
+#endif
+	for (uint32_t offset = 0; offset < block_size; offset += OVERSAMPLER_CHUNK_SIZE)
+	{
+		const uint32_t n = ((block_size - offset) < OVERSAMPLER_CHUNK_SIZE) ? (block_size - offset) : OVERSAMPLER_CHUNK_SIZE;
+#if defined(PROFILER)
+		uint32_t start = profiler_now();
+#endif
+		arm_fir_interpolate_f32(&os->interpolator, &src[offset], upsampled, n);
+#if defined(PROFILER)
+		cycles += profiler_now() - start;
+#endif
+
+		node(ctx, upsampled, upsampled, factor * n);
+
+#if defined(PROFILER)
+		start = profiler_now();
+#endif
+		arm_fir_decimate_f32(&os->decimator, upsampled, &dst[offset], factor * n);
+#if defined(PROFILER)
+		cycles += profiler_now() - start;
+#endif
+	}
+#if defined(PROFILER)
+	profiler_accumulate(PROFILE_OVERSAMPLING, cycles);
+#endif
+}
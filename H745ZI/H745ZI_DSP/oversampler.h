@@ -0,0 +1,88 @@
+// oversampler.h, Michael Haselberger
+// Description: This file contains declarations for the polyphase oversampling stage implemented in oversampler.c
+
+#ifndef __OVERSAMPLER_H__
+#define __OVERSAMPLER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// oversampling factors: 1 (off), 2, 4 or 8
+#define OVERSAMPLER_MAX_FACTOR 8
+// filter length per polyphase branch. the prototype lowpass has OVERSAMPLER_TAPS_PER_PHASE * factor taps
+#define OVERSAMPLER_TAPS_PER_PHASE 16
+#define OVERSAMPLER_MAX_TAPS (OVERSAMPLER_TAPS_PER_PHASE * OVERSAMPLER_MAX_FACTOR)
+// oversamplers that can be initialized (overdrive and fuzz of every channel)
+#ifndef OVERSAMPLER_MAX_INSTANCES
+#define OVERSAMPLER_MAX_INSTANCES (2 * AUDIO_CHANNELS)
+#endif
+// input samples upsampled at a time. the filter memory and the oversampled buffer (DTCM) are sized for it, longer
+// blocks go through in pieces. with two channels the pools would overflow DTCM at MAX_BLOCK_SIZE (arena.h)
+#ifndef OVERSAMPLER_CHUNK_SIZE
+#if (AUDIO_CHANNELS == 2)
+#define OVERSAMPLER_CHUNK_SIZE 32
+#else
+#define OVERSAMPLER_CHUNK_SIZE MAX_BLOCK_SIZE
+#endif
+#endif
+
+// nonlinear processing run at the oversampled rate. same interface as a chain node (fx_process_t)
+typedef void (*oversampler_node)(void *ctx, const float32_t *in, float32_t *out, uint32_t n);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Oversampling wrapper around a nonlinear node.
+*   The block is upsampled with a polyphase FIR interpolator, processed at factor times the sample rate and decimated
+*   with the same lowpass again. Harmonics the nonlinearity creates above Fs / 2 are removed before they can fold
+*   back into the audio band. Both filters are linear phase, together they delay the signal by about OVERSAMPLER_TAPS_PER_PHASE samples.
+*
+*   Members:
+*   factor:             Requested oversampling factor. May be changed at any time (oversampler_set_factor).
+*   limit:              Highest factor used, lower requested factors are kept (oversampler_set_limit). Lowered by the load
+*                       governor, so the configured factor comes back once there's CPU time again.
+*   current:            Factor the filters are initialized for. Changed with the next block.
+*   interpolator:       CMSIS polyphase interpolator (factor - 1 zeros between the samples + lowpass).
+*   decimator:          CMSIS decimator (lowpass + every factor-th sample).
+*   interpolator_state: Memory of the filters, taken from a static pool in DTCM.
+*   decimator_state:
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	volatile uint8_t factor;
+	volatile uint8_t limit;
+	uint8_t current;
+	arm_fir_interpolate_instance_f32 interpolator;
+	arm_fir_decimate_instance_f32 decimator;
+	float32_t *interpolator_state;
+	float32_t *decimator_state;
+} oversampler_t;
+
+// factor the next block is processed with: the requested one, at most the limit
+static inline uint8_t oversampler_factor(const oversampler_t *os)
+{
+	const uint8_t factor = os->factor;
+	const uint8_t limit = os->limit;
+	return (factor < limit) ? factor : limit;
+}
+
+// samples the output lags the input with the factor of the next block: both filters delay by (taps - 1) / 2 at the
+// oversampled rate, together OVERSAMPLER_TAPS_PER_PHASE - 1 / factor at the sample rate, rounded. 0 without oversampling
+static inline uint32_t oversampler_latency(const oversampler_t *os)
+{
+	return (oversampler_factor(os) > 1) ? OVERSAMPLER_TAPS_PER_PHASE : 0;
+}
+
+uint8_t oversampler_init(oversampler_t *os, uint8_t factor);
+uint8_t oversampler_set_factor(oversampler_t *os, uint8_t factor);
+uint8_t oversampler_set_limit(oversampler_t *os, uint8_t limit);
+void oversampler_process(oversampler_t *os, const float32_t *src, float32_t *dst, uint32_t block_size, oversampler_node node, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __OVERSAMPLER_H__
@@ -0,0 +1,93 @@
+// param_block.h, Michael Haselberger
+// Description: Double buffered parameter blocks with a sequence counter. The menu edits the inactive copy of the
+// parameters of an effect and publishes it as a whole, the audio processing takes one consistent snapshot per block
+// into plain memory of its own, so parameters that belong together (e.g. waveform and rate) never tear and the
+// kernels work from non-volatile values.
+
+#ifndef __PARAM_BLOCK_H__
+#define __PARAM_BLOCK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "platform.h"
+#include "defines_and_constants.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   PARAM_BLOCK(name, type) declares name_t: two copies of type, the index of the published one and a sequence counter,
+*   and the functions below. One writer (the menu, the parameter lock makes sure of it with RTOS), one reader (the audio
+*   processing). The writer only touches the copy that isn't published, so a reader that preempts it always finds a
+*   complete one. The sequence is incremented when an edit starts and when it's published: a reader that was preempted
+*   by a whole edit (audio task below an interrupt) sees the change and takes the snapshot again.
+*
+*   name_init(pb, initial)              Both copies set to initial. Neither side may use it meanwhile.
+*   name_edit(pb)                       Writer: the inactive copy, holding the published parameters, to change.
+*   name_publish(pb)                    Writer: make the edited copy the published one.
+*   name_snapshot(pb, dst, seen)        Reader: copy the published parameters into dst if the sequence differs from
+*                                       *seen, which is updated. true if dst changed.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+#define PARAM_BLOCK(name, type)                                                                                 \
+typedef struct                                                                                                  \
+{                                                                                                               \
+	type copy[2];                                                                                               \
+	volatile uint32_t published;                                                                                \
+	volatile uint32_t sequence;                                                                                 \
+} name##_t;                                                                                                     \
+                                                                                                                \
+static inline void name##_init(name##_t *pb, const type *initial)                                               \
+{                                                                                                               \
+	pb->copy[0] = *initial;                                                                                     \
+	pb->copy[1] = *initial;                                                                                     \
+	pb->published = 0;                                                                                          \
+	pb->sequence = 1;                                                                                           \
+}                                                                                                               \
+                                                                                                                \
+static inline type *name##_edit(name##_t *pb)                                                                   \
+{                                                                                                               \
+	const uint32_t active = pb->published;                                                                      \
+	pb->sequence = pb->sequence + 1;                                                                            \
+	/* a reader still on the copy about to be overwritten sees the sequence change */                          \
+	__DMB();                                                                                                    \
+	pb->copy[active ^ 1] = pb->copy[active];                                                                    \
+	return &pb->copy[active ^ 1];                                                                               \
+}                                                                                                               \
+                                                                                                                \
+static inline void name##_publish(name##_t *pb)                                                                 \
+{                                                                                                               \
+	/* the copy is complete before the reader switches to it */                                                 \
+	__DMB();                                                                                                    \
+	pb->published = pb->published ^ 1;                                                                          \
+	__DMB();                                                                                                    \
+	pb->sequence = pb->sequence + 1;                                                                            \
+}                                                                                                               \
+                                                                                                                \
+static inline bool name##_snapshot(const name##_t *pb, type *dst, uint32_t *seen)                              \
+{                                                                                                               \
+	uint32_t sequence = pb->sequence;                                                                           \
+	if (sequence == *seen)                                                                                      \
+	{                                                                                                           \
+		return false;                                                                                           \
+	}                                                                                                           \
+	for (;;)                                                                                                    \
+	{                                                                                                           \
+		__DMB();                                                                                                \
+		*dst = pb->copy[pb->published];                                                                         \
+		__DMB();                                                                                                \
+		const uint32_t after = pb->sequence;                                                                    \
+		if (after == sequence)                                                                                  \
+		{                                                                                                       \
+			break;                                                                                              \
+		}                                                                                                       \
+		sequence = after;                                                                                       \
+	}                                                                                                           \
+	*seen = sequence;                                                                                           \
+	return true;                                                                                                \
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __PARAM_BLOCK_H__
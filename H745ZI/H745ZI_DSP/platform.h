@@ -0,0 +1,78 @@
+// platform.h, Michael Haselberger
+// Description: This file maps the few Cortex-M7 primitives the DSP modules use (barriers, cache maintenance, cycle
+// counter) to the HAL on the target and to portable equivalents in the desktop build (HOST_BUILD, see fx_host.h)
+
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "defines_and_constants.h"
+
+#if defined(HOST_BUILD)
+
+#include <time.h>
+#include <arm_math.h>
+
+// the lock-free handovers between the main loop and the audio interrupt (waveshaper tables, parameter blocks, ring
+// buffers) become handovers between the UI thread and the audio thread of the host: a full fence keeps their order
+#define __DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DSB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __ISB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+// coherent caches, nothing to maintain
+#define SCB_CleanDCache() ((void)0)
+#define SCB_CleanDCache_by_Addr(addr, size) ((void)(addr), (void)(size))
+#define SCB_InvalidateDCache_by_Addr(addr, size) ((void)(addr), (void)(size))
+#define SCB_CleanInvalidateDCache_by_Addr(addr, size) ((void)(addr), (void)(size))
+// no interrupt masking: a section the target masks is shared by two threads on the host and needs atomics there (see
+// profiler_take_peak)
+
+// "cycles" of the host: nanoseconds of the monotonic clock, so the profiler and the cost model count in 1 GHz cycles.
+// wraps after 4.3 s, differences stay correct as on the target. a strict C11 build (-std=c11, no POSIX declarations)
+// takes the calendar clock of C11 instead, a clock adjustment spoils one measurement
+static inline uint32_t platform_cycles(void)
+{
+	struct timespec now;
+#if defined(CLOCK_MONOTONIC)
+	clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+	timespec_get(&now, TIME_UTC);
+#endif
+	return (uint32_t)((uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec);
+}
+// the clock always runs
+static inline void platform_cycles_init(void)
+{
+}
+#define PLATFORM_CORE_CLOCK (1000000000u)
+
+#else
+
+#include "stm32h7xx_hal.h"
+
+// DWT cycle counter
+static inline uint32_t platform_cycles(void)
+{
+	return DWT->CYCCNT;
+}
+// start the cycle counter: trace has to be enabled for the DWT to count, the M7 DWT is also locked after reset (the M4
+// DWT has no lock)
+static inline void platform_cycles_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(CORE_CM7)
+	DWT->LAR = 0xC5ACCE55;
+#endif
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+#define PLATFORM_CORE_CLOCK (SystemCoreClock)
+
+#endif // HOST_BUILD
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __PLATFORM_H__
@@ -0,0 +1,179 @@
+// power.c, Michael Haselberger
+// Description: Power saving. The clocks of the peripherals and memories nothing uses while the core sleeps are gated
+// in sleep mode, and the cores run on the slowest clock profile that fits the active effect chain (see power_t). The
+// core itself sleeps in the main loop between interrupts, the M4 is only started with DUAL_CORE.
+
+#include "stm32h7xx_hal.h"
+#include "profiler.h"
+#include "power.h"
+
+#if defined(POWER_SAVING)
+
+// sleep mode clocks: only the DMA streams, their memories and the peripherals that wake the core keep running
+static void gate_sleep_clocks(void)
+{
+	// the core fetches from the flash and the ITCM again once it's awake, no DMA reads them
+	__HAL_RCC_FLASH_CLK_SLEEP_DISABLE();
+	__HAL_RCC_ITCM_CLK_SLEEP_DISABLE();
+	// GPIO outputs and alternate functions keep their state without a clock, the button goes through the EXTI
+	__HAL_RCC_GPIOA_CLK_SLEEP_DISABLE();
+	__HAL_RCC_GPIOB_CLK_SLEEP_DISABLE();
+	__HAL_RCC_GPIOC_CLK_SLEEP_DISABLE();
+	__HAL_RCC_GPIOD_CLK_SLEEP_DISABLE();
+	__HAL_RCC_BKPRAM_CLK_SLEEP_DISABLE();
+	// stay on: the SRAMs (DMA buffers, arenas), DTCM (MDMA stages), MDMA, DMA1, SPI2 (I2S), I2C1 (LCD transfer),
+	// TIM2 (encoder), USART2 (MIDI), USART3 (HOST_LINK), FMC (LOOPER), USB OTG FS (USB_AUDIO), HSEM
+	// (DUAL_CORE)
+}
+
+// load of a block of the given cycles on another profile, in 0.1 % of its budget
+static uint32_t load_on(core_clock_profile profile, uint32_t cycles)
+{
+	const uint64_t budget = ((uint64_t)profiler_budget() * CoreClock_Frequency(profile)) / SystemCoreClock;
+	return (budget) ? (uint32_t)(((uint64_t)cycles * 1000) / budget) : UINT32_MAX;
+}
+
+// slowest profile on which the block stays at POWER_TARGET_LOAD, the fastest if none does
+static core_clock_profile fitting_profile(uint32_t cycles)
+{
+	for (int8_t profile = CORE_CLOCK_PROFILES - 1; profile > CORE_CLOCK_FASTEST; --profile)
+	{
+		if (load_on((core_clock_profile)profile, cycles) <= POWER_TARGET_LOAD)
+		{
+			return (core_clock_profile)profile;
+		}
+	}
+	return CORE_CLOCK_FASTEST;
+}
+
+static uint8_t change_profile(power_t *p, core_clock_profile profile, uint32_t now)
+{
+	p->since = now;
+	p->demand = 0;
+	if ((profile == p->profile) || (CoreClock_Config(profile) != 0))
+	{
+		return 0;
+	}
+	p->profile = profile;
+	p->switches++;
+	// peaks of the interval were measured at the old clock
+	profiler_take_peak(PROFILE_WINDOW_POWER);
+	return 1;
+}
+
+/******************************************************************************
+* Function Name: power_init
+*******************************************************************************
+* Summary:
+*  Gate the sleep mode clocks nothing needs and start on the profile of SystemClock_Config.
+*  Call after the peripherals and profiler_init.
+*
+* Parameters:
+*  1. power_t *p					- Address pointer of the power struct.
+*  2. uint32_t overruns				- Current overrun count of the audio path.
+*  3. uint32_t now					- Current tick in ms (HAL_GetTick).
+* Return:
+*  None.
+*
+******************************************************************************/
+void power_init(power_t *p, uint32_t overruns, uint32_t now)
+{
+	gate_sleep_clocks();
+
+	p->profile = CoreClock_Profile();
+	p->overruns = overruns;
+	p->last_update = now;
+	p->since = now;
+	p->demand = 0;
+	p->load = 0;
+	p->switches = 0;
+	// the first interval starts now
+	profiler_take_peak(PROFILE_WINDOW_POWER);
+}
+
+/******************************************************************************
+* Function Name: power_update
+*******************************************************************************
+* Summary:
+*  Evaluate the last interval, once every POWER_INTERVAL_MS. An overrun or a block over
+*  POWER_HIGH_LOAD selects a faster profile at once: the one that fits the block, at least the
+*  next faster. Every POWER_HOLD_MS the profile is set to the slowest one that fits the longest
+*  block of that time (fitting_profile). The clock is changed here, the caller scales the
+*  profiler budget to the new SystemCoreClock. Call from the main loop.
+*
+* Parameters:
+*  1. power_t *p					- Address pointer of the power struct.
+*  2. uint32_t overruns				- Overrun count of the audio path.
+*  3. uint32_t now					- Current tick in ms (HAL_GetTick).
+*  4. bool allow_slow				- false selects the fastest profile (e.g. while the load
+*									  governor has lowered the quality).
+* Return:
+*  1:								- The core clock changed.
+*  0:								- No change.
+*
+******************************************************************************/
+uint8_t power_update(power_t *p, uint32_t overruns, uint32_t now, bool allow_slow)
+{
+	if ((now - p->last_update) < POWER_INTERVAL_MS)
+	{
+		return 0;
+	}
+	p->last_update = now;
+
+	const uint32_t missed = overruns - p->overruns;
+	p->overruns = overruns;
+	const uint32_t peak = profiler_take_peak(PROFILE_WINDOW_POWER);
+	p->load = profiler_load(peak);
+	if (peak > p->demand)
+	{
+		p->demand = peak;
+	}
+	// the SWO clock is derived from the core clock
+	if (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk)
+	{
+		return 0;
+	}
+
+	if (!allow_slow)
+	{
+		return change_profile(p, CORE_CLOCK_FASTEST, now);
+	}
+	if (missed || (p->load > POWER_HIGH_LOAD))
+	{
+		core_clock_profile profile = fitting_profile(peak);
+		if ((profile >= p->profile) && (p->profile > CORE_CLOCK_FASTEST))
+		{
+			profile = p->profile - 1;
+		}
+		return change_profile(p, profile, now);
+	}
+	if ((now - p->since) >= POWER_HOLD_MS)
+	{
+		return change_profile(p, fitting_profile(p->demand), now);
+	}
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: power_boost
+*******************************************************************************
+* Summary:
+*  Select the fastest profile at once and stay on it for POWER_HOLD_MS, before a change that
+*  needs more time than the last intervals did (a crossfade between two effects, a new block
+*  size or sample rate). The next decision fits the profile to what the chain needs then.
+*  Call from the main loop.
+*
+* Parameters:
+*  1. power_t *p					- Address pointer of the power struct.
+*  2. uint32_t now					- Current tick in ms (HAL_GetTick).
+* Return:
+*  1:								- The core clock changed.
+*  0:								- Already on the fastest profile.
+*
+******************************************************************************/
+uint8_t power_boost(power_t *p, uint32_t now)
+{
+	return change_profile(p, CORE_CLOCK_FASTEST, now);
+}
+
+#endif // POWER_SAVING
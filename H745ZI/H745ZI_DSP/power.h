@@ -0,0 +1,65 @@
+// power.h, Michael Haselberger
+// Description: This file contains declarations for the power saving implemented in power.c
+
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "defines_and_constants.h"
+#include "rcc.h"
+
+#if defined(POWER_SAVING) && !defined(PROFILER)
+#error "POWER_SAVING measures the load with the profiler, define PROFILER"
+#endif
+
+// load is evaluated every POWER_INTERVAL_MS: the longest block of the interval, in 0.1 % of the block budget
+#define POWER_INTERVAL_MS (100)
+// every POWER_HOLD_MS the chain gets the slowest profile at which the longest block of that time stays at
+// POWER_TARGET_LOAD. the rest of the budget is the safety margin for blocks the measurement didn't see
+#define POWER_HOLD_MS (5000)
+#define POWER_TARGET_LOAD (600)
+// a longer block or an overrun selects a faster profile at once. below GOVERNOR_HIGH_LOAD: the clock goes up before
+// the governor lowers the quality
+#define POWER_HIGH_LOAD (750)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Core clock scaler. Most chains need far less than the block budget at 480 MHz, the rest of the time the core sleeps
+*   (__WFI in the main loop). The cycles a block needs hardly depend on the clock, so the longest block measured on one
+*   profile tells the load on every other: the scaler picks the slowest profile of rcc.c (CoreClock_Config) that fits
+*   the active chain, which also sets the lowest regulator voltage for it. A sudden load, an overrun or a change of the
+*   effects selects a faster profile at once. With a debugger attached the profile stays, the SWO baud rate depends on
+*   it. Main loop only.
+*
+*   Members:
+*   profile:            Current core clock profile.
+*   overruns:           Overrun count at the last evaluation.
+*   last_update:        Tick of the last evaluation.
+*   since:              Tick of the last profile decision.
+*   demand:             Longest block since then in CPU cycles.
+*   load:               Peak load of the last interval in 0.1 %.
+*   switches:           Number of profile changes.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	core_clock_profile profile;
+	uint32_t overruns;
+	uint32_t last_update;
+	uint32_t since;
+	uint32_t demand;
+	uint32_t load;
+	uint32_t switches;
+} power_t;
+
+void power_init(power_t *p, uint32_t overruns, uint32_t now);
+uint8_t power_update(power_t *p, uint32_t overruns, uint32_t now, bool allow_slow);
+uint8_t power_boost(power_t *p, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __POWER_H__
@@ -0,0 +1,409 @@
+// preset.c, Michael Haselberger
+// Description: Preset storage in two internal flash sectors. The presets are appended to a record log, a save never
+// rewrites flash. Only when the active sector is full, the other one is erased and the newest record of every slot is
+// copied over (erases are rare, both sectors wear evenly). An index in RAM holds the newest record of every slot, so a
+// recall doesn't search the flash.
+
+#include <string.h>
+#include "preset.h"
+
+#define PRESET_MAGIC (0x5E7Au)
+// flash words of a record: header + preset
+#define PRESET_WORDS (sizeof(preset_t) / PRESET_FLASH_WORD)
+#define RECORD_SIZE (PRESET_FLASH_WORD + sizeof(preset_t))
+
+_Static_assert((sizeof(preset_t) % PRESET_FLASH_WORD) == 0, "preset_t has to fill whole flash words");
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Record header, the first flash word of a record. The preset follows in the next flash words. The header is written
+*   first: a record cut off by a power loss has a wrong crc and is skipped, the log continues behind it.
+*
+*   Members:
+*   magic:              PRESET_MAGIC. An erased header (0xFFFF) ends the log of a sector.
+*   slot:               Preset slot of this record.
+*   words:              Flash words of the preset. Records of another preset size are skipped.
+*   sequence:           Increases with every record written. The highest one of a slot is its current preset.
+*   crc:                CRC-32 of the preset.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint16_t magic;
+	uint8_t slot;
+	uint8_t words;
+	uint32_t sequence;
+	uint32_t crc;
+	uint32_t erased[5];
+} record_header_t;
+
+_Static_assert(sizeof(record_header_t) == PRESET_FLASH_WORD, "the record header is one flash word");
+
+// newest record of every slot (NULL = empty), the sector written to and its first free address
+static struct
+{
+	const record_header_t *record[PRESET_SLOTS];
+	uint32_t sequence;
+	uint8_t sector;
+	uint32_t next;
+	bool ready;
+} log_index = { 0 };
+
+static inline uint32_t sector_base(uint8_t sector)
+{
+	return PRESET_SECTOR_BASE + sector * PRESET_SECTOR_SIZE;
+}
+
+static inline uint8_t sector_of(const record_header_t *record)
+{
+	return ((uint32_t)record - PRESET_SECTOR_BASE) / PRESET_SECTOR_SIZE;
+}
+
+// bitwise CRC-32 (IEEE 802.3). a preset has 64 bytes, a table isn't worth its flash
+static uint32_t crc32(const uint8_t *data, uint32_t size)
+{
+	uint32_t crc = 0xFFFFFFFFu;
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+		for (uint8_t b = 0; b < 8; ++b)
+		{
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+	return ~crc;
+}
+
+static bool is_erased(const record_header_t *header)
+{
+	const uint32_t *word = (const uint32_t *)header;
+	for (uint32_t i = 0; i < PRESET_FLASH_WORD / 4; ++i)
+	{
+		if (word[i] != 0xFFFFFFFFu)
+			return false;
+	}
+	return true;
+}
+
+/******************************************************************************
+* Function Name: scan_sector
+*******************************************************************************
+* Summary:
+*  Walk the log of a sector and enter every valid record into the index if it is newer than the
+*  one indexed for its slot. A header that is neither erased nor valid can't be skipped (unknown
+*  length), the rest of the sector is treated as full then.
+*
+* Parameters:
+*  1. uint8_t sector				- 0 or 1.
+*  2. uint32_t *highest				- Highest sequence found in this sector.
+* Return:
+*  First free address of the sector.
+*
+******************************************************************************/
+static uint32_t scan_sector(uint8_t sector, uint32_t *highest)
+{
+	const uint32_t end = sector_base(sector) + PRESET_SECTOR_SIZE;
+	uint32_t address = sector_base(sector);
+	*highest = 0;
+
+	while ((address + PRESET_FLASH_WORD) <= end)
+	{
+		const record_header_t *header = (const record_header_t *)address;
+		if (is_erased(header))
+			return address;
+
+		const uint32_t size = PRESET_FLASH_WORD * (1 + (uint32_t)header->words);
+		if ((header->magic != PRESET_MAGIC) || (header->words == 0) || ((address + size) > end))
+			return end;
+
+		if ((header->slot < PRESET_SLOTS) && (header->words == PRESET_WORDS) && (header->crc == crc32((const uint8_t *)(header + 1), sizeof(preset_t))))
+		{
+			const record_header_t *indexed = log_index.record[header->slot];
+			if ((indexed == NULL) || (header->sequence > indexed->sequence))
+				log_index.record[header->slot] = header;
+		}
+		if (header->sequence > *highest)
+			*highest = header->sequence;
+		address += size;
+	}
+	return end;
+}
+
+/******************************************************************************
+* Function Name: append
+*******************************************************************************
+* Summary:
+*  Program a record at the end of the active sector and index it. The caller makes sure it fits.
+*  Blocks the main loop for the programming time (header and PRESET_WORDS flash words, well below 1 ms).
+*
+* Parameters:
+*  1. uint8_t slot					- Preset slot.
+*  2. const preset_t *preset		- Preset to store. 4 byte aligned.
+* Return:
+*  253:								- Programming failed.
+*    0:								- Success.
+*
+******************************************************************************/
+static uint8_t append(uint8_t slot, const preset_t *preset)
+{
+	record_header_t header;
+	memset(&header, 0xFF, sizeof(header));
+	header.magic = PRESET_MAGIC;
+	header.slot = slot;
+	header.words = PRESET_WORDS;
+	header.sequence = log_index.sequence + 1;
+	header.crc = crc32((const uint8_t *)preset, sizeof(preset_t));
+
+	const uint32_t address = log_index.next;
+	// the space is used up even if programming fails, a flash word can't be programmed twice
+	log_index.next += RECORD_SIZE;
+	log_index.sequence++;
+
+	HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, address, (uint32_t)&header);
+	for (uint32_t w = 0; (w < PRESET_WORDS) && (status == HAL_OK); ++w)
+	{
+		status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, address + PRESET_FLASH_WORD * (w + 1), (uint32_t)preset + PRESET_FLASH_WORD * w);
+	}
+	// the flash is cacheable: drop stale lines, the record is read back through the index. the M4 has no data cache
+#if defined(CORE_CM7)
+	SCB_InvalidateDCache_by_Addr((uint32_t *)address, RECORD_SIZE);
+#endif
+	if (status != HAL_OK)
+	{
+		return 253;
+	}
+
+	log_index.record[slot] = (const record_header_t *)address;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: move_to_active
+*******************************************************************************
+* Summary:
+*  Copy the newest record of every slot that isn't in the active sector yet. After a compaction
+*  this copies all slots, after a compaction cut off by a power loss the rest of them.
+*  The source sector stays intact until the next compaction, a cut off copy loses nothing.
+*
+* Parameters:
+*  None.
+* Return:
+*  253:								- Programming failed.
+*    0:								- Success.
+*
+******************************************************************************/
+static uint8_t move_to_active(void)
+{
+	for (uint8_t slot = 0; slot < PRESET_SLOTS; ++slot)
+	{
+		const record_header_t *record = log_index.record[slot];
+		if ((record == NULL) || (sector_of(record) == log_index.sector))
+			continue;
+		if ((log_index.next + RECORD_SIZE) > (sector_base(log_index.sector) + PRESET_SECTOR_SIZE))
+			return 253;
+
+		preset_t copy;
+		memcpy(&copy, record + 1, sizeof(preset_t));
+		if (append(slot, &copy) != 0)
+			return 253;
+	}
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: compact
+*******************************************************************************
+* Summary:
+*  Erase the other sector, continue the log there and copy the current record of every slot.
+*  Blocks the main loop for the sector erase (typically 1 to 2 s, once every ~1300 saves).
+*
+* Parameters:
+*  None.
+* Return:
+*  253:								- Erasing or programming failed.
+*    0:								- Success.
+*
+******************************************************************************/
+static uint8_t compact(void)
+{
+	const uint8_t target = log_index.sector ^ 1;
+	FLASH_EraseInitTypeDef erase =
+	{
+		.TypeErase = FLASH_TYPEERASE_SECTORS,
+		.Banks = PRESET_FLASH_BANK,
+		.Sector = PRESET_FIRST_SECTOR + target,
+		.NbSectors = 1,
+		.VoltageRange = FLASH_VOLTAGE_RANGE_3
+	};
+	uint32_t error;
+
+	if (HAL_FLASHEx_Erase(&erase, &error) != HAL_OK)
+	{
+		return 253;
+	}
+#if defined(CORE_CM7)
+	SCB_InvalidateDCache_by_Addr((uint32_t *)sector_base(target), PRESET_SECTOR_SIZE);
+#endif
+
+	log_index.sector = target;
+	log_index.next = sector_base(target);
+	return move_to_active();
+}
+
+/******************************************************************************
+* Function Name: preset_init
+*******************************************************************************
+* Summary:
+*  Build the index from both sectors. The log continues in the sector with the newest record.
+*  Slots whose newest record is still in the other sector (compaction cut off) are copied over.
+*  Call once at start-up, before the first save or recall.
+*
+* Parameters:
+*  None.
+* Return:
+*  253:								- Completing a cut off compaction failed.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t preset_init(void)
+{
+	uint32_t highest[2];
+	uint32_t next[2];
+
+	memset(&log_index, 0, sizeof(log_index));
+	next[0] = scan_sector(0, &highest[0]);
+	next[1] = scan_sector(1, &highest[1]);
+
+	log_index.sector = (highest[1] > highest[0]) ? 1 : 0;
+	log_index.next = next[log_index.sector];
+	log_index.sequence = (highest[0] > highest[1]) ? highest[0] : highest[1];
+	log_index.ready = true;
+
+	HAL_FLASH_Unlock();
+	uint8_t result = move_to_active();
+	HAL_FLASH_Lock();
+	return result;
+}
+
+/******************************************************************************
+* Function Name: preset_save
+*******************************************************************************
+* Summary:
+*  Store a preset. Appends a record, erasing and compacting first if the active sector is full.
+*  Not real time safe, call from the main loop.
+*
+* Parameters:
+*  1. uint8_t slot					- Preset slot. Range: 0 <= slot < PRESET_SLOTS.
+*  2. const preset_t *preset		- Preset to store.
+* Return:
+*  255:								- Preset points to NULL or preset_init wasn't called.
+*  254:								- Slot out of range.
+*  253:								- Erasing or programming the flash failed.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t preset_save(uint8_t slot, const preset_t *preset)
+{
+	if ((preset == NULL) || !log_index.ready)
+	{
+		return 255;
+	}
+	if (slot >= PRESET_SLOTS)
+	{
+		return 254;
+	}
+
+	uint8_t result = 0;
+	HAL_FLASH_Unlock();
+	// the compacted sector holds at most one record per slot, there is always room for the new one
+	if ((log_index.next + RECORD_SIZE) > (sector_base(log_index.sector) + PRESET_SECTOR_SIZE))
+	{
+		result = compact();
+	}
+	if (result == 0)
+	{
+		result = append(slot, preset);
+	}
+	HAL_FLASH_Lock();
+
+	return result;
+}
+
+/******************************************************************************
+* Function Name: preset_recall
+*******************************************************************************
+* Summary:
+*  Copy the current preset of a slot. Only an index lookup and a 64 byte copy from flash.
+*
+* Parameters:
+*  1. uint8_t slot					- Preset slot. Range: 0 <= slot < PRESET_SLOTS.
+*  2. preset_t *preset				- Destination.
+* Return:
+*  255:								- Preset points to NULL or preset_init wasn't called.
+*  254:								- Slot out of range.
+*  253:								- Slot is empty.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t preset_recall(uint8_t slot, preset_t *preset)
+{
+	if ((preset == NULL) || !log_index.ready)
+	{
+		return 255;
+	}
+	if (slot >= PRESET_SLOTS)
+	{
+		return 254;
+	}
+	if (log_index.record[slot] == NULL)
+	{
+		return 253;
+	}
+
+	memcpy(preset, log_index.record[slot] + 1, sizeof(preset_t));
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: preset_latest
+*******************************************************************************
+* Summary:
+*  Find the slot saved last, e.g. to restore it at start-up.
+*
+* Parameters:
+*  1. uint8_t *slot					- Set to the slot saved last.
+* Return:
+*  253:								- No preset saved yet.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t preset_latest(uint8_t *slot)
+{
+	const record_header_t *latest = NULL;
+	for (uint8_t s = 0; s < PRESET_SLOTS; ++s)
+	{
+		if ((log_index.record[s] != NULL) && ((latest == NULL) || (log_index.record[s]->sequence > latest->sequence)))
+		{
+			latest = log_index.record[s];
+			*slot = s;
+		}
+	}
+	return (latest != NULL) ? 0 : 253;
+}
+
+/******************************************************************************
+* Function Name: preset_clear
+*******************************************************************************
+* Summary:
+*  Fill a preset with PRESET_UNSET (no parameter changed) and pass-through.
+*
+* Parameters:
+*  1. preset_t *preset				- Preset to clear.
+* Return:
+*  None.
+*
+******************************************************************************/
+void preset_clear(preset_t *preset)
+{
+	memset(preset, PRESET_UNSET, sizeof(preset_t));
+	preset->mode = 0;
+}
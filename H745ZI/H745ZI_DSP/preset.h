@@ -0,0 +1,64 @@
+// preset.h, Michael Haselberger
+// Description: This file contains declarations for the preset storage in internal flash implemented in preset.c
+
+#ifndef __PRESET_H__
+#define __PRESET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+
+// the last two sectors of bank 2, cut off the CM4 image (STM32H745ZITx_FLASH_CM4.ld). the CM7 runs from bank 1, so
+// programming and erasing never stalls the audio path. with DUAL_CORE, the M4 stalls while a sector is erased
+#define PRESET_SECTOR_BASE (0x081C0000UL)
+#define PRESET_SECTOR_SIZE (0x20000UL)
+#define PRESET_FIRST_SECTOR (FLASH_SECTOR_6)
+#define PRESET_FLASH_BANK (FLASH_BANK_2)
+// smallest unit that can be programmed (256 bits). every flash word is written once between two erases
+#define PRESET_FLASH_WORD (32)
+
+#define PRESET_SLOTS (8)
+// effects (menu entries FXNONE ... FXPINGPONG) and parameters per effect. a parameter is stored as its menu value (0 to 100)
+#define PRESET_EFFECTS (22)
+#define PRESET_PARAMETERS (5)
+// items of the Modulation page (source, target, depth, LFO rate), the route of the modulation matrix a preset recalls
+#define PRESET_MOD_ITEMS (4)
+// pads the preset to whole flash words (mode, modulation and padding at least 8 bytes, as before). a new effect can
+// change the size, records of the old size are skipped then
+#define PRESET_RESERVED (8 - 1 - PRESET_MOD_ITEMS + (PRESET_FLASH_WORD - (8 + PRESET_EFFECTS * PRESET_PARAMETERS) % PRESET_FLASH_WORD) % PRESET_FLASH_WORD)
+// value of a parameter that wasn't set from the menu yet: the effect keeps its init value
+#define PRESET_UNSET (0xFF)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Preset: every effect parameter as set in the menu plus the selected effect. Whole flash words, stored as they are.
+*
+*   Members:
+*   mode:               Effect selected (fx_designator).
+*   mod:                Menu value (0 to 100) of every item of the Modulation page. PRESET_UNSET for items never changed,
+*                       as in the records saved before the page existed (the padding was PRESET_UNSET).
+*   value:              Menu value (0 to 100) of every parameter, [effect (menu index)][parameter (menu item - 1)].
+*                       PRESET_UNSET for parameters never changed.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint8_t mode;
+	uint8_t mod[PRESET_MOD_ITEMS];
+	uint8_t reserved[PRESET_RESERVED];
+	uint8_t value[PRESET_EFFECTS][PRESET_PARAMETERS];
+} __attribute__((aligned(4))) preset_t;
+
+uint8_t preset_init(void);
+uint8_t preset_save(uint8_t slot, const preset_t *preset);
+uint8_t preset_recall(uint8_t slot, preset_t *preset);
+uint8_t preset_latest(uint8_t *slot);
+void preset_clear(preset_t *preset);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __PRESET_H__
@@ -0,0 +1,432 @@
+// profiler.c, Michael Haselberger
+// Description: Cycle accurate profiling of the audio path with the DWT cycle counter of the Cortex-M7.
+// Replaces measuring the CHECK_TIMELINESS pins with a logic analyzer: audio_process records the cycles of
+// rx_samples, run_fx and tx_samples per effect mode, the numbers can be read on the LCD (Load page) or over SWO.
+
+#include <stdio.h>
+#if defined(HOST_BUILD)
+#include <fenv.h>
+#endif
+#include "profiler.h"
+#include "arena.h"
+#include "defines_and_constants.h"
+
+static profile_mode_t profile[PROFILER_MODES];
+static uint32_t budget = 1;
+// set by profiler_reset (main loop), executed by profiler_record (audio interrupt) so both never write at the same time
+static volatile uint8_t reset_pending = 0;
+// cycles of sections measured in several parts during the current block (profiler_accumulate)
+static uint32_t accumulated[PROFILE_SECTIONS];
+// longest block since the last profiler_take_peak of each window, whatever the mode
+static volatile uint32_t window_peak[PROFILE_WINDOWS];
+
+// the audio interrupt raises the peaks, the main loop takes them: on the target the take masks the interrupt. the
+// desktop build has an audio thread instead (fx_host.h), a compare-and-swap and an exchange keep both sides whole there
+#if defined(HOST_BUILD)
+static inline void raise_peak(volatile uint32_t *peak, uint32_t cycles)
+{
+	uint32_t old = __atomic_load_n(peak, __ATOMIC_RELAXED);
+	while ((cycles > old) && !__atomic_compare_exchange_n(peak, &old, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+
+static inline uint32_t take_peak(volatile uint32_t *peak)
+{
+	return __atomic_exchange_n(peak, 0, __ATOMIC_RELAXED);
+}
+#else
+static inline void raise_peak(volatile uint32_t *peak, uint32_t cycles)
+{
+	if (cycles > *peak)
+		*peak = cycles;
+}
+
+static inline uint32_t take_peak(volatile uint32_t *peak)
+{
+	__disable_irq();
+	const uint32_t taken = *peak;
+	*peak = 0;
+	__enable_irq();
+	return taken;
+}
+#endif
+
+static void clear_stats(void)
+{
+	for (uint8_t m = 0; m < PROFILER_MODES; ++m)
+	{
+		for (uint8_t s = 0; s < PROFILE_SECTIONS; ++s)
+		{
+			profile[m].section[s].min = UINT32_MAX;
+			profile[m].section[s].max = 0;
+			profile[m].section[s].sum = 0;
+			profile[m].section[s].count = 0;
+		}
+		profile[m].deadline_misses = 0;
+		profile[m].clips = 0;
+		profile[m].subnormals = 0;
+	}
+	for (uint8_t s = 0; s < PROFILE_SECTIONS; ++s)
+	{
+		accumulated[s] = 0;
+	}
+}
+
+static void add_measurement(profile_stats_t *stats, uint32_t cycles)
+{
+	if (cycles < stats->min)
+		stats->min = cycles;
+	if (cycles > stats->max)
+		stats->max = cycles;
+	stats->sum += cycles;
+	stats->count++;
+}
+
+/******************************************************************************
+* Function Name: profiler_init
+*******************************************************************************
+* Summary:
+*  Enable the DWT cycle counter and clear all statistics.
+*
+* Parameters:
+*  1. uint32_t budget_cycles		- CPU cycles available per block (block length in seconds * core clock).
+*									  A block taking longer than this is counted as deadline miss.
+* Return:
+*  None.
+*
+******************************************************************************/
+void profiler_init(uint32_t budget_cycles)
+{
+	platform_cycles_init();
+
+	budget = (budget_cycles) ? budget_cycles : 1;
+	clear_stats();
+}
+
+/******************************************************************************
+* Function Name: profiler_reset
+*******************************************************************************
+* Summary:
+*  Request clearing all statistics. Done with the next block from inside the audio interrupt,
+*  so the statistics are never written by two contexts at the same time.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void profiler_reset(void)
+{
+	reset_pending = 1;
+}
+
+/******************************************************************************
+* Function Name: profiler_record
+*******************************************************************************
+* Summary:
+*  Add one measurement to the statistics of a mode. Recording PROFILE_TOTAL also checks the
+*  block against the budget and closes the block: the sections summed up with profiler_accumulate
+*  are added as one measurement each. Called from the audio interrupt only.
+*
+* Parameters:
+*  1. uint8_t mode					- Effect mode that was active (fx_designator).
+*  2. profile_section section		- Measured section.
+*  3. uint32_t cycles				- Duration in CPU cycles (difference of two profiler_now values).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void profiler_record(uint8_t mode, profile_section section, uint32_t cycles)
+{
+	if (reset_pending)
+	{
+		clear_stats();
+		reset_pending = 0;
+	}
+	if ((mode >= PROFILER_MODES) || (section >= PROFILE_SECTIONS))
+		return;
+
+	add_measurement(&profile[mode].section[section], cycles);
+
+	if (section == PROFILE_TOTAL)
+	{
+		if (cycles > budget)
+			profile[mode].deadline_misses++;
+		for (uint8_t w = 0; w < PROFILE_WINDOWS; ++w)
+		{
+			raise_peak(&window_peak[w], cycles);
+		}
+		// sections that didn't run in this block (e.g. no oversampled effect active) are not counted
+		for (uint8_t s = 0; s < PROFILE_SECTIONS; ++s)
+		{
+			if (accumulated[s])
+			{
+				add_measurement(&profile[mode].section[s], accumulated[s]);
+				accumulated[s] = 0;
+			}
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: profiler_accumulate
+*******************************************************************************
+* Summary:
+*  Add cycles to a section that is measured in several parts during one block, e.g. by every
+*  oversampled effect of the chain. The sum is recorded as one measurement together with
+*  PROFILE_TOTAL. Called from the audio interrupt only.
+*
+* Parameters:
+*  1. profile_section section		- Measured section.
+*  2. uint32_t cycles				- Duration in CPU cycles.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void profiler_accumulate(profile_section section, uint32_t cycles)
+{
+	if (section < PROFILE_SECTIONS)
+		accumulated[section] += cycles;
+}
+
+/******************************************************************************
+* Function Name: profiler_count_clips
+*******************************************************************************
+* Summary:
+*  Add clipped output segments to the statistics of a mode. Called from the audio interrupt only.
+*
+* Parameters:
+*  1. uint8_t mode					- Effect mode that was active (fx_designator).
+*  2. uint32_t clips				- Segments over full scale in this block.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void profiler_count_clips(uint8_t mode, uint32_t clips)
+{
+	if (mode < PROFILER_MODES)
+		profile[mode].clips += clips;
+}
+
+// cumulative exception flags of the FPSCR: underflow (a result was subnormal, or flushed with FZ) and input denormal
+#define FPSCR_UFC (1UL << 3)
+#define FPSCR_IDC (1UL << 7)
+
+/******************************************************************************
+* Function Name: profiler_count_subnormals
+*******************************************************************************
+* Summary:
+*  Count the block if the FPU met a subnormal value since the last call, and clear the flags.
+*  Every exception starts with clear flags, the audio task of RTOS keeps its own, so the count
+*  covers the processing of the block. Called from the audio interrupt only, after run_fx.
+*
+* Parameters:
+*  1. uint8_t mode					- Effect mode that was active (fx_designator).
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void profiler_count_subnormals(uint8_t mode)
+{
+#if defined(HOST_BUILD)
+	// the host FPU has no input denormal flag in C, underflow also covers the subnormal results
+	if (fetestexcept(FE_UNDERFLOW))
+	{
+		feclearexcept(FE_UNDERFLOW);
+		if (mode < PROFILER_MODES)
+			profile[mode].subnormals++;
+	}
+#else
+	const uint32_t fpscr = __get_FPSCR();
+	if (fpscr & (FPSCR_UFC | FPSCR_IDC))
+	{
+		__set_FPSCR(fpscr & ~(FPSCR_UFC | FPSCR_IDC));
+		if (mode < PROFILER_MODES)
+			profile[mode].subnormals++;
+	}
+#endif
+}
+
+/******************************************************************************
+* Function Name: profiler_get
+*******************************************************************************
+* Summary:
+*  Statistics of one mode. Values are written by the audio interrupt, so reading them from the
+*  main loop can mix two consecutive blocks. Good enough for diagnostics.
+*
+* Parameters:
+*  1. uint8_t mode					- Effect mode (fx_designator).
+* Return:
+*  Pointer to the statistics, NULL if mode is out of range.
+*
+******************************************************************************/
+const profile_mode_t* profiler_get(uint8_t mode)
+{
+	return (mode < PROFILER_MODES) ? &profile[mode] : NULL;
+}
+
+uint32_t profiler_budget(void)
+{
+	return budget;
+}
+
+/******************************************************************************
+* Function Name: profiler_set_budget
+*******************************************************************************
+* Summary:
+*  Change the block budget without clearing the statistics, e.g. when the core clock changes
+*  (power.h): the cycles a block needs stay about the same, the cycles available per block
+*  don't. Call from the main loop.
+*
+* Parameters:
+*  1. uint32_t budget_cycles		- CPU cycles available per block.
+* Return:
+*  None.
+*
+******************************************************************************/
+void profiler_set_budget(uint32_t budget_cycles)
+{
+	budget = (budget_cycles) ? budget_cycles : 1;
+}
+
+/******************************************************************************
+* Function Name: profiler_take_peak
+*******************************************************************************
+* Summary:
+*  Longest block (PROFILE_TOTAL) since the last call for the same window, and start a new
+*  window. Unlike the statistics, the peak follows the current load, e.g. for the load
+*  governor. Every reader has its own window, so they don't take the peaks of each other.
+*  Call from the main loop.
+*
+* Parameters:
+*  1. profile_window window			- Window of the reader.
+* Return:
+*  CPU cycles of the longest block, 0 if no block was processed.
+*
+******************************************************************************/
+uint32_t profiler_take_peak(profile_window window)
+{
+	if (window >= PROFILE_WINDOWS)
+		return 0;
+	return take_peak(&window_peak[window]);
+}
+
+/******************************************************************************
+* Function Name: profiler_load
+*******************************************************************************
+* Summary:
+*  Convert a cycle count to the used share of the block budget.
+*
+* Parameters:
+*  1. uint32_t cycles				- CPU cycles.
+* Return:
+*  Load in 0.1 % (1000 = whole budget). Integer, so printing doesn't need float support in printf.
+*
+******************************************************************************/
+uint32_t profiler_load(uint32_t cycles)
+{
+	return (uint32_t)(((uint64_t)cycles * 1000) / budget);
+}
+
+// write a string to ITM stimulus port 0 (SWO). returns immediately if no debugger enabled the ITM. the host prints it
+static void swo_write(const char *str)
+{
+#if defined(HOST_BUILD)
+	fputs(str, stdout);
+#else
+	while (*str)
+	{
+		ITM_SendChar(*str++);
+	}
+#endif
+}
+
+/******************************************************************************
+* Function Name: profiler_report
+*******************************************************************************
+* Summary:
+*  Print the load report over SWO. The header names the memory placement (TCM_PLACEMENT) and
+*  the DMA buffer layout (MDMA_TRANSFER, CACHED_DMA), so the reports of the builds can be compared. One line per mode that has been measured:
+*  mode, blocks, min/avg/max cycles of rx, fx, oversampling, tx and total, average and maximum load, deadline
+*  misses, clipped output segments and blocks with subnormal values. The last line is the high water mark and size of every effect
+*  memory arena in bytes. Call from the main loop, printing isn't real time safe.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void profiler_report(void)
+{
+	char line[240];
+
+#if defined(TCM_PLACEMENT)
+	// the placement changes all cycle counts, the report says which build it comes from
+	static const char placement[] = "tcm";
+#else
+	static const char placement[] = "flash";
+#endif
+	// access path of the DMA buffers (rx/tx cycles), see CACHED_DMA
+#if defined(MDMA_TRANSFER)
+	static const char dma_layout[] = "mdma";
+#elif defined(CACHED_DMA)
+	static const char dma_layout[] = "cached";
+#else
+	static const char dma_layout[] = "uncached";
+#endif
+	// sample format of the chain, for comparing the f32 and q31 kernels (SAMPLE_Q31)
+#if defined(SAMPLE_Q31)
+	static const char format[] = "q31";
+#else
+	static const char format[] = "f32";
+#endif
+	snprintf(line, sizeof(line), "profile: %u channel(s), %s, %s, %s, budget %lu cycles/block\r\n", AUDIO_CHANNELS, placement, dma_layout, format, (unsigned long)budget);
+	swo_write(line);
+
+	for (uint8_t m = 0; m < PROFILER_MODES; ++m)
+	{
+		const profile_stats_t *s = profile[m].section;
+		if (s[PROFILE_TOTAL].count == 0)
+			continue;
+
+		int pos = snprintf(line, sizeof(line), "mode %u n=%lu", m, (unsigned long)s[PROFILE_TOTAL].count);
+		for (uint8_t i = 0; (i < PROFILE_SECTIONS) && (pos < (int)sizeof(line)); ++i)
+		{
+			static const char *names[PROFILE_SECTIONS] = { "rx", "fx", "os", "tx", "total" };
+			const uint32_t avg = (s[i].count) ? (uint32_t)(s[i].sum / s[i].count) : 0;
+			pos += snprintf(&line[pos], sizeof(line) - pos, " %s %lu/%lu/%lu", names[i],
+				(unsigned long)((s[i].count) ? s[i].min : 0), (unsigned long)avg, (unsigned long)s[i].max);
+		}
+		if (pos < (int)sizeof(line))
+		{
+			const uint32_t avg_load = profiler_load((uint32_t)(s[PROFILE_TOTAL].sum / s[PROFILE_TOTAL].count));
+			const uint32_t max_load = profiler_load(s[PROFILE_TOTAL].max);
+			snprintf(&line[pos], sizeof(line) - pos, " load %lu.%lu%%/%lu.%lu%% miss %lu clip %lu subnormal %lu\r\n",
+				(unsigned long)(avg_load / 10), (unsigned long)(avg_load % 10),
+				(unsigned long)(max_load / 10), (unsigned long)(max_load % 10),
+				(unsigned long)profile[m].deadline_misses, (unsigned long)profile[m].clips,
+				(unsigned long)profile[m].subnormals);
+		}
+		swo_write(line);
+	}
+
+	int pos = snprintf(line, sizeof(line), "arena");
+	for (uint8_t c = 0; (c < ARENA_CLASSES) && (pos < (int)sizeof(line)); ++c)
+	{
+		static const char *names[ARENA_CLASSES] = { "tcm", "axi", "ahb", "shared" };
+		const arena_t *arena = arena_get((arena_class)c);
+		pos += snprintf(&line[pos], sizeof(line) - pos, " %s %lu/%lu", names[c], (unsigned long)arena->high_water, (unsigned long)arena->size);
+	}
+	if (pos < (int)sizeof(line))
+	{
+		snprintf(&line[pos], sizeof(line) - pos, "\r\n");
+	}
+	swo_write(line);
+}
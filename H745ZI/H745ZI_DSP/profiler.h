@@ -0,0 +1,95 @@
+// profiler.h, Michael Haselberger
+// Description: This file contains declarations for the DWT cycle counter profiler implemented in profiler.c
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "platform.h"
+
+// one set of statistics per effect mode (FXNONE ... FXPINGPONG, see fx_designator in fx_lib.h)
+#define PROFILER_MODES (22)
+
+// measured sections of one audio block (see audio_process in main.c)
+typedef enum
+{
+	PROFILE_RX = 0,
+	PROFILE_FX,
+	// part of PROFILE_FX: interpolation and decimation filters of the oversampled effects (see oversampler.c)
+	PROFILE_OVERSAMPLING,
+	PROFILE_TX,
+	PROFILE_TOTAL,
+	PROFILE_SECTIONS
+} profile_section;
+
+// independent windows of the peak load (profiler_take_peak), one per reader
+typedef enum
+{
+	PROFILE_WINDOW_GOVERNOR = 0,
+	PROFILE_WINDOW_POWER,
+	PROFILE_WINDOWS
+} profile_window;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Cycle statistics of one section.
+*
+*   Members:
+*   min, max:           Shortest and longest measurement in CPU cycles.
+*   sum:                Sum of all measurements, avg = sum / count. 64 bit, so it can't overflow in practice.
+*   count:              Number of measurements.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t count;
+} profile_stats_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Statistics of one effect mode.
+*
+*   Members:
+*   section:            Statistics of rx_samples, run_fx (and the oversampling filters in it), tx_samples and the whole block.
+*   deadline_misses:    Number of blocks that took longer than the block budget (PING_PONG_BUFFER_SIZE sample periods).
+*   clips:              Output segments over full scale, caught by the output limiter (see run_limiter in fx_lib.c).
+*   subnormals:         Blocks in which the FPU produced subnormal results (FPSCR UFC) or flushed subnormal inputs (IDC,
+*                       with DENORMAL_FLUSH).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	profile_stats_t section[PROFILE_SECTIONS];
+	uint32_t deadline_misses;
+	uint32_t clips;
+	uint32_t subnormals;
+} profile_mode_t;
+
+// current value of the cycle counter. wraps after 2^32 cycles (~9 s at 480 MHz), differences are still correct
+static inline uint32_t profiler_now(void)
+{
+	return platform_cycles();
+}
+
+void profiler_init(uint32_t budget_cycles);
+void profiler_reset(void);
+void profiler_record(uint8_t mode, profile_section section, uint32_t cycles);
+void profiler_accumulate(profile_section section, uint32_t cycles);
+void profiler_count_clips(uint8_t mode, uint32_t clips);
+void profiler_count_subnormals(uint8_t mode);
+const profile_mode_t* profiler_get(uint8_t mode);
+uint32_t profiler_budget(void);
+void profiler_set_budget(uint32_t budget_cycles);
+uint32_t profiler_take_peak(profile_window window);
+uint32_t profiler_load(uint32_t cycles);
+void profiler_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __PROFILER_H__
@@ -8,95 +8,233 @@
 
 /*
  *	System Clock is configured as follows : 
- *            System Clock source            = PLL (HSE BYPASS)
- *            SYSCLK(Hz)                     = 480 MHz (CPU Clock)
- *            HCLK(Hz)                       = 240 MHz (Cortex-M4 CPU, Bus matrix Clocks)
+ *            System Clock source            = PLL (HSE)
+ *            SYSCLK(Hz)                     = 240 MHz (CPU Clock, profile CORE_CLOCK_DEFAULT)
+ *            HCLK(Hz)                       = 120 MHz (Cortex-M4 CPU, Bus matrix Clocks)
  *            AHB Prescaler                  = 2
- *            D1 APB3 Prescaler              = 2 (APB3 Clock  120 MHz)
- *            D2 APB1 Prescaler              = 2 (APB1 Clock  120 MHz)
- *            D2 APB2 Prescaler              = 2 (APB2 Clock  120 MHz)
- *            D3 APB4 Prescaler              = 2 (APB4 Clock  120 MHz)
+ *            D1 APB3 Prescaler              = 2 (APB3 Clock  60 MHz)
+ *            D2 APB1 Prescaler              = 2 (APB1 Clock  60 MHz)
+ *            D2 APB2 Prescaler              = 2 (APB2 Clock  60 MHz)
+ *            D3 APB4 Prescaler              = 2 (APB4 Clock  60 MHz)
  *            HSE Frequency(Hz)              = 8 MHz
- *            PLL_M                          = 1
+ *            PLL_M                          = 2	// 4 MHz PLL1 reference
  *            PLL_N                          = 120
- *            PLL_P                          = 2	// 8 MHz (HSE) / 1 (PLL_M) * 120(PLL_N) / 2(PLL_P) = 480 MHz PLLCLK -> SYSCLK
+ *            PLL_P                          = 2	// 8 MHz (HSE) / 2 (PLL_M) * 120(PLL_N) / 2(PLL_P) = 240 MHz PLLCLK -> SYSCLK
  *            PLL_Q                          = 4	
  *            PLL_R                          = 2	 
  *            VDD(V)                         = 3.3
  *            Flash Latency(WS)              = 4
+ *	The HSI (64 MHz) stays on as kernel clock of I2C1, USART2 and USART3, so their timing doesn't depend on the bus clock
+ *	of the core clock profile.
 */
 
-void SystemClock_Config(void)
+/*
+ *	Core clock profiles (CoreClock_Config, see power.h):
+ *		PLL1 only clocks the cores and the buses, the I2S kernel clock comes from PLL2 and isn't touched. A profile sets
+ *		the PLL1 multiplier, the CPU prescaler (D1CPRE), the AHB prescaler (HPRE) and the voltage scale. The APB
+ *		prescalers stay at 2, on every profile the APB clocks stay above the I2S kernel clock.
+ *		Between profiles with the same PLL1 setting only the prescalers change (a few cycles). Otherwise the system clock
+ *		runs from the HSE while PLL1 relocks, about 100 us: the audio processing waits for the new clock meanwhile (the
+ *		DMA interrupts still queue blocks), so it never runs at 8 MHz.
+ *		The voltage is raised before the clock and lowered after it (datasheet, general operating conditions:
+ *		scale 0 up to 480/240 MHz CPU/bus, scale 1 400/200 MHz, scale 2 300/150 MHz). The flash keeps 4 wait states,
+ *		enough for every profile. Kernel clocks taken from the bus (FMC and QSPI for LOOPER memory) change with the
+ *		profile, their timing has to be set up for the fastest one.
+ */
+
+typedef struct
+{
+	uint32_t hz;
+	uint32_t n;
+	uint32_t d1cpre;
+	uint32_t hpre;
+	uint32_t scale;
+} core_clock_t;
+
+static const core_clock_t core_clocks[CORE_CLOCK_PROFILES] =
+{
+	{ 480000000, 240, RCC_SYSCLK_DIV1, RCC_HCLK_DIV2, PWR_REGULATOR_VOLTAGE_SCALE0 },
+	{ 400000000, 200, RCC_SYSCLK_DIV1, RCC_HCLK_DIV2, PWR_REGULATOR_VOLTAGE_SCALE1 },
+	{ 240000000, 120, RCC_SYSCLK_DIV1, RCC_HCLK_DIV2, PWR_REGULATOR_VOLTAGE_SCALE2 },
+	// the bus clock of the 240 MHz profile
+	{ 120000000, 120, RCC_SYSCLK_DIV2, RCC_HCLK_DIV1, PWR_REGULATOR_VOLTAGE_SCALE2 }
+};
+
+static core_clock_profile core_profile = CORE_CLOCK_DEFAULT;
+
+// PLL1 from the 8 MHz HSE: 4 MHz reference, P = 2
+static void pll1_init(RCC_OscInitTypeDef *osc, uint32_t n)
+{
+	osc->PLL.PLLState = RCC_PLL_ON;
+	osc->PLL.PLLSource = RCC_PLLSOURCE_HSE;
+	osc->PLL.PLLM = 2;
+	osc->PLL.PLLN = n;
+	osc->PLL.PLLP = 2;
+	osc->PLL.PLLQ = 4;
+	osc->PLL.PLLR = 2;
+	osc->PLL.PLLRGE = RCC_PLL1VCIRANGE_2;
+	osc->PLL.PLLVCOSEL = RCC_PLL1VCOWIDE;
+	osc->PLL.PLLFRACN = 0;
+}
+
+// system clock source and bus prescalers of a profile
+static HAL_StatusTypeDef bus_init(uint32_t source, const core_clock_t *clock)
 {
 	RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+	RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2 | RCC_CLOCKTYPE_D3PCLK1 | RCC_CLOCKTYPE_D1PCLK1;
+	RCC_ClkInitStruct.SYSCLKSource = source;
+	RCC_ClkInitStruct.SYSCLKDivider = clock->d1cpre;
+	RCC_ClkInitStruct.AHBCLKDivider = clock->hpre;
+	RCC_ClkInitStruct.APB3CLKDivider = RCC_APB3_DIV2;
+	RCC_ClkInitStruct.APB1CLKDivider = RCC_APB1_DIV2;
+	RCC_ClkInitStruct.APB2CLKDivider = RCC_APB2_DIV2;
+	RCC_ClkInitStruct.APB4CLKDivider = RCC_APB4_DIV2;
+	// the HAL orders the prescaler writes, so no clock exceeds its limit in between
+	return HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_4);
+}
+
+static void set_voltage_scale(uint32_t scale)
+{
+	// scale 0 (overdrive) is only entered from scale 1
+	if ((scale == PWR_REGULATOR_VOLTAGE_SCALE0) && ((PWR->D3CR & PWR_D3CR_VOS) != PWR_REGULATOR_VOLTAGE_SCALE1))
+	{
+		set_voltage_scale(PWR_REGULATOR_VOLTAGE_SCALE1);
+	}
+	__HAL_PWR_VOLTAGESCALING_CONFIG(scale);
+	// wait until ready
+	while (!__HAL_PWR_GET_FLAG(PWR_FLAG_VOSRDY))
+	{
+	}
+}
+
+void SystemClock_Config(void)
+{
 	RCC_OscInitTypeDef RCC_OscInitStruct = {0};
-	HAL_StatusTypeDef ret = HAL_OK;
+	const core_clock_t *clock = &core_clocks[CORE_CLOCK_DEFAULT];
 
-	// enable supply configuration update
-	HAL_PWREx_ConfigSupply(PWR_DIRECT_SMPS_SUPPLY);
+	// supply as the board is wired (POWER_SUPPLY, rcc.h). a mismatch leaves the supply locked, the board stops here
+	if (HAL_PWREx_ConfigSupply(POWER_SUPPLY) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	// the overdrive of voltage scale 0 (ODEN) and its removal are SYSCFG writes
+	__HAL_RCC_SYSCFG_CLK_ENABLE();
 
 	/* 
         The voltage scaling allows optimizing the power consumption when the device is
         clocked below the maximum system frequency, to update the voltage scaling value
         regarding system frequency refer to product datasheet.  
     */
-
-	// --------- 480 MHz/240 MHz core clocks and SPI/I2S Clock optimized for 48kHz
-	// set voltage scaling to 0, because the clock is running at maximum 480 MHz
-	// "Run Mode Range 0: enhanced performnance with high power consumption"
-	// might look into reconfiguring mcu to use voltage scale 1(max 400 MHz) once at the optimizing stage.
-	// for now, battery life (or even battery supplied usage) is not a pressing concern/priority.
-	__HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE0);
-	// wait until ready
-	while (!__HAL_PWR_GET_FLAG(PWR_FLAG_VOSRDY))
-	{
-	}
+	set_voltage_scale(clock->scale);
 
 	// Macro to configure the PLL clock source as high speed external
 	//__HAL_RCC_PLL_PLLSOURCE_CONFIG(RCC_PLLSOURCE_HSE);
 
-	// initialize RCC oscillator - turn on HSE only, HSI and CSI off
-	RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+	// initialize RCC oscillator - turn on HSE and HSI (kernel clock), CSI off
+	RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE | RCC_OSCILLATORTYPE_HSI;
 	RCC_OscInitStruct.HSEState = RCC_HSE_ON;
-	RCC_OscInitStruct.HSIState = RCC_HSI_OFF;
+	RCC_OscInitStruct.HSIState = RCC_HSI_DIV1;
+	RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
 	RCC_OscInitStruct.CSIState = RCC_CSI_OFF;
-	RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-	RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
-
-	RCC_OscInitStruct.PLL.PLLM = 2;
-	RCC_OscInitStruct.PLL.PLLN = 120;
-	RCC_OscInitStruct.PLL.PLLFRACN = 0;
-	RCC_OscInitStruct.PLL.PLLP = 2;
-	RCC_OscInitStruct.PLL.PLLQ = 4;
-	RCC_OscInitStruct.PLL.PLLR = 2;
-
-	RCC_OscInitStruct.PLL.PLLRGE = RCC_PLL1VCIRANGE_3;
-	RCC_OscInitStruct.PLL.PLLVCOSEL = RCC_PLL1VCOWIDE;
-	RCC_OscInitStruct.PLL.PLLFRACN = 0;
+	pll1_init(&RCC_OscInitStruct, clock->n);
 
 	// check oscillator setup for errors
-	ret = HAL_RCC_OscConfig(&RCC_OscInitStruct);
-	if (ret != HAL_OK)
+	if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
 	{
 		Error_Handler();
 	}
 
 	// Select PLL as system clock source and configure bus clock dividers
-	RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2 | RCC_CLOCKTYPE_D3PCLK1 | RCC_CLOCKTYPE_D1PCLK1;
+	if (bus_init(RCC_SYSCLKSOURCE_PLLCLK, clock) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	core_profile = CORE_CLOCK_DEFAULT;
+}
 
-	RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
-	RCC_ClkInitStruct.SYSCLKDivider = RCC_SYSCLK_DIV1;
-	RCC_ClkInitStruct.AHBCLKDivider = RCC_HCLK_DIV2;
-	RCC_ClkInitStruct.APB3CLKDivider = RCC_APB3_DIV2;
-	RCC_ClkInitStruct.APB1CLKDivider = RCC_APB1_DIV2;
-	RCC_ClkInitStruct.APB2CLKDivider = RCC_APB2_DIV2;
-	RCC_ClkInitStruct.APB4CLKDivider = RCC_APB4_DIV2;
+/******************************************************************************
+* Function Name: CoreClock_Config
+*******************************************************************************
+* Summary:
+*  Switch the cores to a clock profile (see core_clock_profile). SystemCoreClock and the
+*  SysTick follow the new clock, everything counting CPU cycles (profiler budget, DWT
+*  timestamps) has to be scaled by the caller. Main loop only.
+*
+* Parameters:
+*  1. core_clock_profile profile	- New profile.
+* Return:
+*  254:								- No such profile, or faster than the supply allows
+*									  (CORE_CLOCK_FASTEST).
+*  253:								- PLL1 didn't lock or the clock switch failed. The system
+*									  clock stays on the HSE then, it is safe but slow.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t CoreClock_Config(core_clock_profile profile)
+{
+	if ((profile >= CORE_CLOCK_PROFILES) || (profile < CORE_CLOCK_FASTEST))
+	{
+		return 254;
+	}
+	if (profile == core_profile)
+	{
+		return 0;
+	}
+
+	const core_clock_t *from = &core_clocks[core_profile];
+	const core_clock_t *to = &core_clocks[profile];
+	uint8_t ret = 0;
 
-	ret = HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_4);
-	if (ret != HAL_OK)
+	if (to->hz > from->hz)
 	{
-		Error_Handler();
+		set_voltage_scale(to->scale);
 	}
+	if (to->n == from->n)
+	{
+		if (bus_init(RCC_SYSCLKSOURCE_PLLCLK, to) != HAL_OK)
+		{
+			ret = 253;
+		}
+	}
+	else
+	{
+		RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+		RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+		pll1_init(&RCC_OscInitStruct, to->n);
+
+		// everything below the DMA interrupts waits until PLL1 is back: the audio processing (PendSV, with RTOS the audio
+		// task) and the SysTick as well. HAL_GetTick stands still meanwhile, the tick comes late once, and the lock
+		// timeouts of the HAL can't run out: PLL1 relocks from the HSE within about 100 us
+		const uint32_t basepri = __get_BASEPRI();
+		__set_BASEPRI((AUDIO_IRQ_PRIORITY + 1) << (8 - __NVIC_PRIO_BITS));
+		if ((bus_init(RCC_SYSCLKSOURCE_HSE, to) != HAL_OK) || (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+			|| (bus_init(RCC_SYSCLKSOURCE_PLLCLK, to) != HAL_OK))
+		{
+			ret = 253;
+		}
+		__set_BASEPRI(basepri);
+	}
+	if (ret)
+	{
+		return ret;
+	}
+	if (to->hz < from->hz)
+	{
+		set_voltage_scale(to->scale);
+	}
+	core_profile = profile;
+	return 0;
+}
+
+core_clock_profile CoreClock_Profile(void)
+{
+	return core_profile;
+}
+
+uint32_t CoreClock_Frequency(core_clock_profile profile)
+{
+	return (profile < CORE_CLOCK_PROFILES) ? core_clocks[profile].hz : 0;
 }
 
 /*
@@ -144,26 +282,127 @@ void SystemClock_Config(void)
  *			  => 8 MHz (HSE) / 7 (PLL_M) * 172(PLL_N) / 4(PLL_P) = 49.14286 MHz = approx 4 * F_MCK
 */
 
+/*
+ *	Other sample rates (audio_set_sample_rate in main.c), MCLK stays 256 * Fs, which is also a double-speed ratio of the
+ *	codec (Fs = 96 KHz):
+ *		96 KHz:		the same PLL2 output, the HAL halves I2SDIV (2 -> 1)
+ *		44.1 KHz:	4 * 256 * 44.1 KHz = 45.1584 MHz. no integer N fits, the fractional divider does:
+ *					8 MHz / 7 * (197 + 4653 / 8192) / 5 = 45.15840 MHz, I2SDIV = 2
+ */
+
+// PLL2 settings of a sample rate: M, N, P, FRACN
+typedef struct
+{
+	uint32_t rate;
+	uint32_t m;
+	uint32_t n;
+	uint32_t p;
+	uint32_t fracn;
+} audio_clock_t;
+
+static const audio_clock_t audio_clocks[] =
+{
+	{ 44100, 7, 197, 5, 4653 },
+	{ 48000, 7, 172, 4, 0 },
+	{ 96000, 7, 172, 4, 0 }
+};
+
 void PeriphCommonClock_Config(void)
 {
+	if (AudioClock_Config(AUDIO_SAMPLE_RATE) != 0)
+	{
+		Error_Handler();
+	}
+}
+
+/******************************************************************************
+* Function Name: AudioClock_Config
+*******************************************************************************
+* Summary:
+*  Program PLL2 (kernel clock of SPI1 to SPI3 and, with SAI_TDM, of SAI1) for a sample rate.
+*  PLL2 is stopped while it's reconfigured, so the I2S has to be stopped, and HAL_I2S_Init has to
+*  be called afterwards: it derives I2SDIV from the new kernel clock (HAL_SAI_Init MCKDIV, which
+*  divides PLL2P = 1024 * fs or 512 * fs down to the 256 * fs master clock without remainder).
+*
+* Parameters:
+*  1. uint32_t rate					- Sample rate in Hz: 44100, 48000 or 96000.
+* Return:
+*  254:								- No PLL2 setting for this rate.
+*  253:								- PLL2 didn't lock.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t AudioClock_Config(uint32_t rate)
+{
+	const audio_clock_t *clock = NULL;
+	for (uint32_t i = 0; i < (sizeof(audio_clocks) / sizeof(audio_clocks[0])); ++i)
+	{
+		if (audio_clocks[i].rate == rate)
+		{
+			clock = &audio_clocks[i];
+			break;
+		}
+	}
+	if (clock == NULL)
+	{
+		return 254;
+	}
+
 	RCC_PeriphCLKInitTypeDef PeriphClkInitStruct = {0};
 
 	// Enable peripheral clock for SPI1 and SPI2
-//	PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_SAI1 | RCC_PERIPHCLK_SPI2;
+#if defined(SAI_TDM)
+	PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_SAI1 | RCC_PERIPHCLK_SPI2;
+#else
 	PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_SPI2;
-	PeriphClkInitStruct.PLL2.PLL2M = 7;
-	PeriphClkInitStruct.PLL2.PLL2N = 172;
-	PeriphClkInitStruct.PLL2.PLL2P = 4;
+#endif
+	PeriphClkInitStruct.PLL2.PLL2M = clock->m;
+	PeriphClkInitStruct.PLL2.PLL2N = clock->n;
+	PeriphClkInitStruct.PLL2.PLL2P = clock->p;
 	PeriphClkInitStruct.PLL2.PLL2Q = 2;
 	PeriphClkInitStruct.PLL2.PLL2R = 2;
 	PeriphClkInitStruct.PLL2.PLL2RGE = RCC_PLL2VCIRANGE_0;
 	PeriphClkInitStruct.PLL2.PLL2VCOSEL = RCC_PLL2VCOWIDE;
-	PeriphClkInitStruct.PLL2.PLL2FRACN = 0;
-	//PeriphClkInitStruct.Sai1ClockSelection = RCC_SAI1CLKSOURCE_PLL2;
+	PeriphClkInitStruct.PLL2.PLL2FRACN = clock->fracn;
+#if defined(SAI_TDM)
+	PeriphClkInitStruct.Sai1ClockSelection = RCC_SAI1CLKSOURCE_PLL2;
+#endif
 	PeriphClkInitStruct.Spi123ClockSelection = RCC_SPI123CLKSOURCE_PLL2;
 
 	if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK)
+	{
+		return 253;
+	}
+	return 0;
+}
+
+/*
+ *	USB clock (USB audio, see usb_audio.h):
+ *		The OTG FS core needs 48 MHz. PLL1Q follows the core clock profile and PLL2 is tuned to the I2S clock, so the USB
+ *		kernel clock comes from the HSI48. The clock recovery system trims the HSI48 to the 1 kHz SOFs of the host, which the USB
+ *		specification requires without a crystal. The sample clock stays with PLL2: the streaming endpoint is
+ *		asynchronous and the packet sizes carry the I2S rate to the host.
+ */
+
+void USBClock_Config(void)
+{
+	RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+	RCC_CRSInitTypeDef RCC_CRSInitStruct = {0};
+
+	RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI48;
+	RCC_OscInitStruct.HSI48State = RCC_HSI48_ON;
+	RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+	if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
 	{
 		Error_Handler();
 	}
+
+	__HAL_RCC_CRS_CLK_ENABLE();
+	RCC_CRSInitStruct.Prescaler = RCC_CRS_SYNC_DIV1;
+	RCC_CRSInitStruct.Source = RCC_CRS_SYNC_SOURCE_USB2;
+	RCC_CRSInitStruct.Polarity = RCC_CRS_SYNC_POLARITY_RISING;
+	RCC_CRSInitStruct.ReloadValue = __HAL_RCC_CRS_RELOADVALUE_CALCULATE(48000000, 1000);
+	RCC_CRSInitStruct.ErrorLimitValue = RCC_CRS_ERRORLIMIT_DEFAULT;
+	RCC_CRSInitStruct.HSI48CalibrationValue = RCC_CRS_HSI48CALIBRATION_DEFAULT;
+	HAL_RCCEx_CRSConfig(&RCC_CRSInitStruct);
 }
\ No newline at end of file
@@ -9,12 +9,39 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+
+// CPU clock profiles of CoreClock_Config, fastest first. the I2S clock (PLL2) is the same on every profile.
+// ahead of main.h, which includes power.h
+typedef enum
+{
+	CORE_CLOCK_480 = 0,			// 480 MHz CPU, 240 MHz bus, voltage scale 0 (with the LDO only, see POWER_SUPPLY)
+	CORE_CLOCK_400,				// 400/200 MHz, scale 1
+	CORE_CLOCK_240,				// 240/120 MHz, scale 2
+	CORE_CLOCK_120,				// 120/120 MHz, scale 2
+	CORE_CLOCK_PROFILES
+} core_clock_profile;
+// profile of SystemClock_Config
+#define CORE_CLOCK_DEFAULT (CORE_CLOCK_240)
+// supply of the core domains (HAL_PWREx_ConfigSupply) as the board is wired, set once per power cycle. the NUCLEO-H745ZI-Q
+// comes with the direct SMPS supply, which reaches voltage scale 1 at most. scale 0 (CORE_CLOCK_480) needs the LDO:
+// PWR_LDO_SUPPLY or PWR_SMPS_1V8_SUPPLIES_LDO, after the solder bridge changes of the board manual (UM2408)
+#ifndef POWER_SUPPLY
+#define POWER_SUPPLY PWR_DIRECT_SMPS_SUPPLY
+#endif
+// fastest profile the supply allows
+#define CORE_CLOCK_FASTEST ((((POWER_SUPPLY) & PWR_CR3_LDOEN) != 0) ? CORE_CLOCK_480 : CORE_CLOCK_400)
+
 #include "main.h"
 
 extern RCC_ClkInitTypeDef RCC_ClkInitStruct;
 
 void SystemClock_Config(void);
+uint8_t CoreClock_Config(core_clock_profile profile);
+core_clock_profile CoreClock_Profile(void);
+uint32_t CoreClock_Frequency(core_clock_profile profile);
 void PeriphCommonClock_Config(void);
+uint8_t AudioClock_Config(uint32_t rate);
+void USBClock_Config(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,103 @@
+// resampler.c, Michael Haselberger
+// Description: Windowed sinc resampler that converts impulse responses to the running sample rate while they are loaded
+// into a convolver (see convolver_ir_source).
+
+#include "resampler.h"
+
+/******************************************************************************
+* Function Name: ir_resampler_init
+*******************************************************************************
+* Summary:
+*  Set up the conversion of an impulse response from ir_rate to rate. The converted samples are
+*  scaled by ir_rate / rate: a response sampled more densely has more samples summing up to the
+*  same gain, so the frequency response of the convolution stays the same. rs->length is the
+*  number of converted samples, to be passed to nu_convolver_load (or less, to truncate).
+*
+* Parameters:
+*  1. ir_resampler_t *rs			- Address pointer of the resampler struct.
+*  2. const float32_t *ir			- Impulse response samples. Has to stay valid while the response is loaded.
+*  3. uint32_t ir_length			- Number of samples in ir.
+*  4. uint32_t ir_rate				- Sample rate of ir in Hz.
+*  5. uint32_t rate					- Sample rate of the output in Hz.
+* Return:
+*  255:								- Impulse response points to NULL.
+*  254:								- Length or a rate is 0.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t ir_resampler_init(ir_resampler_t *rs, const float32_t *ir, uint32_t ir_length, uint32_t ir_rate, uint32_t rate)
+{
+	if (ir == NULL)
+	{
+		return 255;
+	}
+	if ((ir_length == 0) || (ir_rate == 0) || (rate == 0))
+	{
+		return 254;
+	}
+
+	rs->ir = ir;
+	rs->ir_length = ir_length;
+	rs->ir_rate = ir_rate;
+	rs->rate = rate;
+	rs->length = (uint32_t)(((uint64_t)ir_length * rate + ir_rate - 1) / ir_rate);
+	rs->cutoff = (rate < ir_rate) ? ((float32_t)rate / ir_rate) : 1.0f;
+	rs->half_width = (int32_t)ceilf(RESAMPLER_ZERO_CROSSINGS / rs->cutoff);
+	rs->sinc_cos = arm_cos_f32(PI * rs->cutoff);
+	rs->sinc_sin = arm_sin_f32(PI * rs->cutoff);
+	rs->window_cos = arm_cos_f32(PI / rs->half_width);
+	rs->window_sin = arm_sin_f32(PI / rs->half_width);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: ir_resampler_source
+*******************************************************************************
+* Summary:
+*  convolver_ir_source of the converted response (context: initialized ir_resampler_t). Every
+*  output sample is the sum of the input samples around its position, weighted with the
+*  Blackman windowed sinc at their distance d. Going from one tap to the next, d drops by one,
+*  so sine and cosine of the sinc and the window argument are rotated by a constant angle
+*  instead of being evaluated again. Samples outside the response count as 0.
+*
+******************************************************************************/
+void ir_resampler_source(float32_t *dst, uint32_t offset, uint32_t length, void *context)
+{
+	const ir_resampler_t *rs = context;
+	const float32_t gain = (float32_t)rs->ir_rate / rs->rate;
+
+	for (uint32_t i = 0; i < length; ++i)
+	{
+		// position of the output sample in input samples: center + frac
+		const uint64_t position = (uint64_t)(offset + i) * rs->ir_rate;
+		const int32_t center = (int32_t)(position / rs->rate);
+		const float32_t frac = (float32_t)(position % rs->rate) / rs->rate;
+
+		// first tap k = center - half_width + 1, at distance d = frac + half_width - 1
+		float32_t d = frac + (float32_t)(rs->half_width - 1);
+		float32_t sinc_sin = arm_sin_f32(PI * rs->cutoff * d);
+		float32_t sinc_cos = arm_cos_f32(PI * rs->cutoff * d);
+		float32_t window_sin = arm_sin_f32(PI * d / rs->half_width);
+		float32_t window_cos = arm_cos_f32(PI * d / rs->half_width);
+		float32_t sum = 0.0f;
+
+		for (int32_t k = center - rs->half_width + 1; k <= center + rs->half_width; ++k)
+		{
+			if ((k >= 0) && (k < (int32_t)rs->ir_length))
+			{
+				const float32_t sinc = (fabsf(d) < 1e-6f) ? rs->cutoff : (sinc_sin / (PI * d));
+				const float32_t window = 0.42f + 0.5f * window_cos + 0.08f * (2.0f * window_cos * window_cos - 1.0f);
+				sum += rs->ir[k] * sinc * window;
+			}
+			// d - 1: rotate both arguments back by one step
+			const float32_t s = sinc_sin * rs->sinc_cos - sinc_cos * rs->sinc_sin;
+			sinc_cos = sinc_cos * rs->sinc_cos + sinc_sin * rs->sinc_sin;
+			sinc_sin = s;
+			const float32_t w = window_sin * rs->window_cos - window_cos * rs->window_sin;
+			window_cos = window_cos * rs->window_cos + window_sin * rs->window_sin;
+			window_sin = w;
+			d -= 1.0f;
+		}
+		dst[i] = gain * sum;
+	}
+}
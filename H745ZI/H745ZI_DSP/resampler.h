@@ -0,0 +1,62 @@
+// resampler.h, Michael Haselberger
+// Description: This file contains declarations for the impulse response resampler implemented in resampler.c
+
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// zero crossings of the interpolation kernel on each side of its center (at the lower of both rates). with the Blackman
+// window, 16 give about -74 dB stopband and a transition band of about a sixth of the Nyquist frequency
+#define RESAMPLER_ZERO_CROSSINGS (16)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Windowed sinc resampler for impulse responses recorded at another rate than the running one (e.g. 44.1 kHz spring
+*   reverb responses at 48 kHz). Works as convolver_ir_source, so the response is converted segment by segment while the
+*   convolver transforms it, without a buffer for the converted response. Output sample n lies at n * ir_rate / rate
+*   input samples; the integer and fractional part of that position are exact (rational), so the phase doesn't drift
+*   along a long response. When the rate goes down, the kernel is widened by the rate ratio, which moves its cutoff to
+*   the new Nyquist frequency (anti-aliasing). Sine and window of the kernel taps are advanced by rotation, only the
+*   first tap of every output sample calls sin/cos. Load time only.
+*
+*   Members:
+*   ir:                 Impulse response at ir_rate.
+*   ir_length:          Number of samples in ir.
+*   ir_rate:            Rate of ir in Hz.
+*   rate:               Rate of the output in Hz.
+*   length:             Number of output samples covering the whole response.
+*   cutoff:             Cutoff of the kernel relative to the Nyquist frequency of ir_rate (1 when the rate goes up).
+*   half_width:         Kernel taps on each side of the center (RESAMPLER_ZERO_CROSSINGS / cutoff).
+*   sinc_cos, sinc_sin: Rotation of the sinc argument from one tap to the next (pi * cutoff).
+*   window_cos,
+*   window_sin:         Rotation of the window argument from one tap to the next (pi / half_width).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	const float32_t *ir;
+	uint32_t ir_length;
+	uint32_t ir_rate;
+	uint32_t rate;
+	uint32_t length;
+	float32_t cutoff;
+	int32_t half_width;
+	float32_t sinc_cos;
+	float32_t sinc_sin;
+	float32_t window_cos;
+	float32_t window_sin;
+} ir_resampler_t;
+
+uint8_t ir_resampler_init(ir_resampler_t *rs, const float32_t *ir, uint32_t ir_length, uint32_t ir_rate, uint32_t rate);
+void ir_resampler_source(float32_t *dst, uint32_t offset, uint32_t length, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __RESAMPLER_H__
@@ -8,35 +8,104 @@
 // https://www.embedded.com/ring-buffer-basics/
 
 #include <string.h>
+#include "platform.h"
 #include "ring_buffer.h"
+#include "arena.h"
 
-// Maximum amount of ring buffers available. Default value: 1
-#define RING_BUFFER_MAX (1)
+// Maximum amount of ring buffers available. Default value: 8
+#define RING_BUFFER_MAX (8)
 // Error codes
 #define SUCCESS (0)
 #define FAILURE (-1)
 
+// Data cache maintenance of shared ring buffers. Only the M7 has a data cache, the operations are empty on the M4.
+#if defined(CORE_CM7)
+#define RB_CLEAN(rb, addr, size) do { if ((rb)->shared) SCB_CleanDCache_by_Addr((uint32_t *)(addr), (int32_t)(size)); } while (0)
+#define RB_INVALIDATE(rb, addr, size) do { if ((rb)->shared) SCB_InvalidateDCache_by_Addr((uint32_t *)(addr), (int32_t)(size)); } while (0)
+#else
+#define RB_CLEAN(rb, addr, size)
+#define RB_INVALIDATE(rb, addr, size)
+#endif
+
 // Local buffer struct that keeps track of head and tail position internally. This information does not need to be exposed to the handle.
-// Head and tail are both declared as volatile. 
-// This is because they might be accessed from both the application context and the interrupt context.
+// Head and tail are volatile and in cache lines of their own (rb_indices_t), they are accessed from the application
+// context, the interrupt context or the other core. idx points to local, or to the indices of a shared ring buffer.
 struct ring_buffer
 {
     size_t element_size;
     size_t max_elements;
     uint8_t* buf;
-    volatile size_t head;
-    volatile size_t tail;
+    rb_indices_t* idx;
+    rb_indices_t local;
+    uint8_t in_use;
+    uint8_t owns_buffer;
+    uint8_t shared;
 };
 
 // This structure is allocated as an array private to this file. (static variables in C are "private" to the module they are defined in)
 // The maximum number of ring buffers available in the system is determined at compile time by the hash define RING_BUFFER MAX
 static struct ring_buffer _rb[RING_BUFFER_MAX];
 
+// Buffers that aren't provided by the caller are taken from the RAM_D2 effect arena (arena.h), shared with the delay lines.
+
+/******************************************************************************
+* Function Name: ring_buffer_pool_alloc
+*******************************************************************************
+* Summary:
+*  This function takes a buffer of the requested size from the RAM_D2 arena (see arena_alloc).
+*
+* Parameters:
+*  1. size_t size - The amount of bytes required.
+* Return:
+*  Address of the buffer, or NULL if the arena cannot satisfy the request.
+*
+******************************************************************************/
+void* ring_buffer_pool_alloc(size_t size)
+{
+    return arena_alloc(ARENA_AHB, size);
+}
+
+/******************************************************************************
+* Function Name: ring_buffer_pool_free
+*******************************************************************************
+* Summary:
+*  This function returns a buffer to the RAM_D2 arena.
+*
+* Parameters:
+*  1. void* buffer - Address previously returned by ring_buffer_pool_alloc. NULL is ignored.
+* Return:
+*  None.
+*
+******************************************************************************/
+void ring_buffer_pool_free(void* buffer)
+{
+    arena_free(buffer);
+}
+
+/******************************************************************************
+* Function Name: ring_buffer_pool_available
+*******************************************************************************
+* Summary:
+*  This function gets the size of the largest free block in the RAM_D2 arena.
+*
+* Parameters:
+*  None.
+* Return:
+*  The largest amount of bytes a single ring_buffer_pool_alloc call can currently return.
+*
+******************************************************************************/
+size_t ring_buffer_pool_available(void)
+{
+    return arena_available(ARENA_AHB);
+}
+
 /******************************************************************************
 * Function Name: ring_buffer_init
 *******************************************************************************
 * Summary:
-*  This function is used to initialize the ring buffer
+*  This function is used to initialize the ring buffer. A free ring buffer slot is searched for,
+*  so slots given back with ring_buffer_release can be reused. If attr->buffer is NULL, the buffer
+*  memory is taken from the ring buffer pool.
 *
 * Parameters:
 *  1. rb_designator_t* rbd - ring buffer designator, used to index and track the amount of ring buffers
@@ -48,41 +117,138 @@ static struct ring_buffer _rb[RING_BUFFER_MAX];
 ******************************************************************************/
 int ring_buffer_init(rb_designator_t* rbd, rb_handle_t* attr)
 {
-    // This static variable counts the number of used ring buffers
-    static int index = 0;
+    // Check that the rbd and attr pointers are not NULL and that the element size is valid.
+    if ((rbd == NULL) || (attr == NULL) || (attr->element_size == 0))
+    {
+        return FAILURE;
+    }
 
-    // Check that there is a free ring buffer, and that the rbd and attr pointers are not NULL.
-    if ((index < RING_BUFFER_MAX) && (rbd != NULL) && (attr != NULL))
+    /*
+     * Check that the size of the ring buffer is a power of 2.
+     * Any value which is a power of two will have only one '1' in it's binary representation
+     * Example: 10000(16) - 1 = 01111(15): 10000 & 01111 == 0
+     * This allows for more efficient masking instead of expensive modulo operations to maintain itself.
+    */
+    if ((attr->max_elements == 0) || (((attr->max_elements - 1) & attr->max_elements) != 0))
     {
-        // Verify that the element size and buffer pointer are both valid
-        if ((attr->buffer != NULL) && (attr->element_size > 0))
+        return FAILURE;
+    }
+
+    // Look for a free ring buffer slot. Released slots are reused.
+    for (int index = 0; index < RING_BUFFER_MAX; ++index)
+    {
+        if (_rb[index].in_use == 0)
         {
-            /*
-             * Check that the size of the ring buffer is a power of 2.
-             * Any value which is a power of two will have only one '1' in it's binary representation
-             * Example: 10000(16) - 1 = 01111(15): 10000 & 01111 == 0
-             * This allows for more efficient masking instead of expensive modulo operations to maintain itself.
-            */
-            if (((attr->max_elements - 1) & attr->max_elements) == 0)
+            uint8_t owns_buffer = 0;
+            // No memory was provided by the caller: take it from the pool
+            if (attr->buffer == NULL)
             {
-                // Initialize the ring buffer internal variables
-                _rb[index].head = 0;
-                _rb[index].tail = 0;
-                _rb[index].buf = attr->buffer;
-                _rb[index].element_size = attr->element_size;
-                _rb[index].max_elements = attr->max_elements;
-
-                // Index is passed back to the caller as the ring buffer descriptor.
-                // The variable index is also incremented to indicate the ring buffer is used.
-                *rbd = index++;
-                return SUCCESS;
+                attr->buffer = ring_buffer_pool_alloc(attr->element_size * attr->max_elements);
+                if (attr->buffer == NULL)
+                {
+                    return FAILURE;
+                }
+                owns_buffer = 1;
             }
+
+            // Initialize the ring buffer internal variables
+            _rb[index].local.head.value = 0;
+            _rb[index].local.tail.value = 0;
+            _rb[index].idx = &_rb[index].local;
+            _rb[index].buf = attr->buffer;
+            _rb[index].element_size = attr->element_size;
+            _rb[index].max_elements = attr->max_elements;
+            _rb[index].owns_buffer = owns_buffer;
+            _rb[index].shared = 0;
+            _rb[index].in_use = 1;
+
+            // Index is passed back to the caller as the ring buffer descriptor.
+            *rbd = index;
+            return SUCCESS;
         }
     }
 
     return FAILURE;
 }
 
+/******************************************************************************
+* Function Name: ring_buffer_init_shared
+*******************************************************************************
+* Summary:
+*  This function initializes a ring buffer between the cores. Both cores call it with the same storage and indices,
+*  in memory both of them reach, and then use their own designator: one core only as producer, the other only as
+*  consumer. The indices are not touched, they have to be cleared once (ring_buffer_clear on one core) before
+*  either side uses the ring buffer. The storage has to start and end on a cache line (RB_CACHE_LINE), so the
+*  cache maintenance of the M7 doesn't reach into other data.
+*
+* Parameters:
+*  1. rb_designator_t* rbd - ring buffer designator, used to index and track the amount of ring buffers
+*  2. const rb_handle_t* attr - size of the elements and of the buffer, and address of the storage (not NULL)
+*  3. rb_indices_t* indices - head and tail, shared by both cores
+* Return:
+*  SUCCESS - All the programming steps executed successfully
+*  FAILURE - Invalid attributes, storage not aligned to the cache line, or no free ring buffer slot
+*
+******************************************************************************/
+int ring_buffer_init_shared(rb_designator_t* rbd, const rb_handle_t* attr, rb_indices_t* indices)
+{
+    if ((rbd == NULL) || (attr == NULL) || (indices == NULL) || (attr->buffer == NULL) || (attr->element_size == 0))
+    {
+        return FAILURE;
+    }
+    if ((attr->max_elements == 0) || (((attr->max_elements - 1) & attr->max_elements) != 0))
+    {
+        return FAILURE;
+    }
+    if ((((uintptr_t)attr->buffer % RB_CACHE_LINE) != 0) || (((attr->element_size * attr->max_elements) % RB_CACHE_LINE) != 0))
+    {
+        return FAILURE;
+    }
+
+    for (int index = 0; index < RING_BUFFER_MAX; ++index)
+    {
+        if (_rb[index].in_use == 0)
+        {
+            _rb[index].idx = indices;
+            _rb[index].buf = attr->buffer;
+            _rb[index].element_size = attr->element_size;
+            _rb[index].max_elements = attr->max_elements;
+            _rb[index].owns_buffer = 0;
+            _rb[index].shared = 1;
+            _rb[index].in_use = 1;
+            *rbd = index;
+            return SUCCESS;
+        }
+    }
+
+    return FAILURE;
+}
+
+/******************************************************************************
+* Function Name: ring_buffer_release
+*******************************************************************************
+* Summary:
+*  This function frees a ring buffer slot, so the designator can be handed out by ring_buffer_init again.
+*  If the buffer memory was taken from the pool by ring_buffer_init, it is returned to the pool.
+*
+* Parameters:
+*  1. rb_designator_t rbd - ring buffer designator, used to index and track the amount of ring buffers
+* Return:
+*  None.
+*
+******************************************************************************/
+void ring_buffer_release(rb_designator_t rbd)
+{
+    if ((rbd < RING_BUFFER_MAX) && _rb[rbd].in_use)
+    {
+        if (_rb[rbd].owns_buffer)
+        {
+            ring_buffer_pool_free(_rb[rbd].buf);
+        }
+        memset(&_rb[rbd], 0, sizeof(_rb[rbd]));
+    }
+}
+
 // ------------------------Static helper functions---------------------------------------
 /*
     Both calculate the difference between the head and the tail and then compare the result against the number of elements or zero respectively.
@@ -105,7 +271,7 @@ int ring_buffer_init(rb_designator_t* rbd, rb_handle_t* attr)
 ******************************************************************************/
 static int _ring_buffer_full(struct ring_buffer* rb)
 {
-    return ((rb->head - rb->tail) == rb->max_elements) ? 1 : 0;
+    return ((rb->idx->head.value - rb->idx->tail.value) == rb->max_elements) ? 1 : 0;
 }
 
 /******************************************************************************
@@ -123,7 +289,48 @@ static int _ring_buffer_full(struct ring_buffer* rb)
 ******************************************************************************/
 static int _ring_buffer_empty(struct ring_buffer* rb)
 {
-    return ((rb->head - rb->tail) == 0U) ? 1 : 0;
+    return ((rb->idx->head.value - rb->idx->tail.value) == 0U) ? 1 : 0;
+}
+
+/*
+    Memory ordering, the same for single elements and spans:
+    - producer: read the tail (invalidated if shared), write the elements, clean them, __DMB, write the head, clean it.
+    - consumer: read the head (invalidated if shared), __DMB, invalidate and read the elements, __DMB, write the tail,
+      clean it.
+    The barrier between an element and the index that publishes or frees it keeps the other side from seeing the index
+    first, the DSB after the last clean makes it reach the memory before the other core is notified.
+*/
+
+static void _ring_buffer_span(struct ring_buffer* rb, size_t index, size_t count, rb_span_t* span);
+
+// producer: publish n elements written from head on
+static void _ring_buffer_publish(struct ring_buffer* rb, size_t n)
+{
+    const size_t head = rb->idx->head.value;
+#if defined(CORE_CM7)
+    if (rb->shared)
+    {
+        rb_span_t span;
+        _ring_buffer_span(rb, head, n, &span);
+        for (int r = 0; r < 2; ++r)
+        {
+            RB_CLEAN(rb, span.data[r], span.count[r] * rb->element_size);
+        }
+    }
+#endif
+    __DMB();
+    rb->idx->head.value = head + n;
+    RB_CLEAN(rb, &rb->idx->head, sizeof(rb_index_t));
+    __DSB();
+}
+
+// consumer: free n elements read from tail on
+ITCM_CODE static void _ring_buffer_free(struct ring_buffer* rb, size_t n)
+{
+    __DMB();
+    rb->idx->tail.value = rb->idx->tail.value + n;
+    RB_CLEAN(rb, &rb->idx->tail, sizeof(rb_index_t));
+    __DSB();
 }
 
 /******************************************************************************
@@ -140,7 +347,9 @@ static int _ring_buffer_empty(struct ring_buffer* rb)
 ******************************************************************************/
 int ring_buffer_count(rb_designator_t rbd)
 {
-    return (_rb[rbd].head - _rb[rbd].tail);
+    // either side may ask, neither index is ever dirty in the cache
+    RB_INVALIDATE(&_rb[rbd], _rb[rbd].idx, sizeof(rb_indices_t));
+    return (_rb[rbd].idx->head.value - _rb[rbd].idx->tail.value);
 }
 
 /******************************************************************************
@@ -158,8 +367,12 @@ int ring_buffer_count(rb_designator_t rbd)
 ******************************************************************************/
 int ring_buffer_put(rb_designator_t rbd, const void* data)
 {
-    // Validate argument and check if ring buffer is full
-    if ((rbd < RING_BUFFER_MAX) && (_ring_buffer_full(&_rb[rbd]) == 0))
+    // Validate argument and check if ring buffer is full. The tail is written by the consumer
+    if ((rbd < RING_BUFFER_MAX) && _rb[rbd].in_use)
+    {
+        RB_INVALIDATE(&_rb[rbd], &_rb[rbd].idx->tail, sizeof(rb_index_t));
+    }
+    if ((rbd < RING_BUFFER_MAX) && _rb[rbd].in_use && (_ring_buffer_full(&_rb[rbd]) == 0))
     {
         /*
          * Buffer is just an array of bytes, so in order to copy the data to the correct location, find out where free elements start in memory.
@@ -168,13 +381,13 @@ int ring_buffer_put(rb_designator_t rbd, const void* data)
          * Size of data is defined by the caller, so the actual byte offset into the memory array is calculated by taking the element and multiplying it
          * by the size of each element in bytes.
         */
-        const size_t offset = (_rb[rbd].head & (_rb[rbd].max_elements - 1)) * _rb[rbd].element_size;
+        const size_t offset = (_rb[rbd].idx->head.value & (_rb[rbd].max_elements - 1)) * _rb[rbd].element_size;
 
         // The memcpy function is used to copy a block of data from a source address to a destination address.
         // void * memcpy(void * destination, const void * source, size_t num)
         memcpy(&(_rb[rbd].buf[offset]), data, _rb[rbd].element_size);
-        // Update position of the head pointer.
-        _rb[rbd].head++;
+        // Update position of the head pointer, after the element is complete.
+        _ring_buffer_publish(&_rb[rbd], 1);
 
         return SUCCESS;
     }
@@ -198,13 +411,20 @@ int ring_buffer_put(rb_designator_t rbd, const void* data)
 int ring_buffer_get(rb_designator_t rbd, void* data)
 {
     // Essentially the same as ring_buffer_put, but instead of putting data into the buffer at the head, data is taken out at the tail.
-    if ((rbd < RING_BUFFER_MAX) && (_ring_buffer_empty(&_rb[rbd]) == 0))
+    if ((rbd < RING_BUFFER_MAX) && _rb[rbd].in_use)
+    {
+        RB_INVALIDATE(&_rb[rbd], &_rb[rbd].idx->head, sizeof(rb_index_t));
+    }
+    if ((rbd < RING_BUFFER_MAX) && _rb[rbd].in_use && (_ring_buffer_empty(&_rb[rbd]) == 0))
     {
-        const size_t offset = (_rb[rbd].tail & (_rb[rbd].max_elements - 1)) * _rb[rbd].element_size;
+        // the head was read before the element
+        __DMB();
+        const size_t offset = (_rb[rbd].idx->tail.value & (_rb[rbd].max_elements - 1)) * _rb[rbd].element_size;
+        RB_INVALIDATE(&_rb[rbd], &(_rb[rbd].buf[offset]), _rb[rbd].element_size);
         memcpy(data, &(_rb[rbd].buf[offset]), _rb[rbd].element_size);
 //		// set value taken from ring buffer to 0
 //		memset(&(_rb[rbd].buf[offset]), 0, _rb[rbd].element_size);
-        _rb[rbd].tail++;
+        _ring_buffer_free(&_rb[rbd], 1);
 
         return SUCCESS;
     }
@@ -212,6 +432,155 @@ int ring_buffer_get(rb_designator_t rbd, void* data)
     return FAILURE;
 }
 
+// ------------------------Span access---------------------------------------
+/*
+    The span functions give access to the storage itself instead of copying single elements through a void pointer.
+    acquire only looks at the free or used elements and describes them as at most two regions (up to the end of the
+    storage and from its start), commit then moves the head or the tail. Elements acquired but not committed are not
+    visible to the other side, so a producer can fill a region over several steps (or let a DMA fill it) and publish it
+    at once.
+*/
+
+/******************************************************************************
+* Function Name: _ring_buffer_span
+*******************************************************************************
+* Summary:
+*  This static function describes count elements from the free-running index as regions of the storage.
+*
+* Parameters:
+*  1. struct ring_buffer* rb - Pointer to the ring buffer.
+*  2. size_t index - Free-running index of the first element (head or tail).
+*  3. size_t count - Number of elements.
+*  4. rb_span_t* span - Regions of the elements.
+* Return:
+*  None.
+*
+******************************************************************************/
+ITCM_CODE static void _ring_buffer_span(struct ring_buffer* rb, size_t index, size_t count, rb_span_t* span)
+{
+    const size_t start = index & (rb->max_elements - 1);
+    const size_t first = ((rb->max_elements - start) < count) ? (rb->max_elements - start) : count;
+
+    span->data[0] = (first > 0) ? &rb->buf[start * rb->element_size] : NULL;
+    span->count[0] = first;
+    span->data[1] = (count > first) ? rb->buf : NULL;
+    span->count[1] = count - first;
+}
+
+/******************************************************************************
+* Function Name: ring_buffer_acquire_write
+*******************************************************************************
+* Summary:
+*  This function gets the free elements at the head of the ring buffer, up to n, as regions the caller can write
+*  in place. They are added to the buffer by ring_buffer_commit_write.
+*
+* Parameters:
+*  1. rb_designator_t rbd - ring buffer designator, used to index and track the amount of ring buffers
+*  2. size_t n - The maximum amount of elements wanted.
+*  3. rb_span_t* span - Regions of the free elements, written by this function.
+* Return:
+*  The amount of elements in span (0 if the buffer is full)
+*  FAILURE - Invalid designator or span.
+*
+******************************************************************************/
+int ring_buffer_acquire_write(rb_designator_t rbd, size_t n, rb_span_t* span)
+{
+    if ((rbd >= RING_BUFFER_MAX) || !_rb[rbd].in_use || (span == NULL))
+    {
+        return FAILURE;
+    }
+    RB_INVALIDATE(&_rb[rbd], &_rb[rbd].idx->tail, sizeof(rb_index_t));
+    const size_t space = _rb[rbd].max_elements - (_rb[rbd].idx->head.value - _rb[rbd].idx->tail.value);
+    const size_t count = (n < space) ? n : space;
+    _ring_buffer_span(&_rb[rbd], _rb[rbd].idx->head.value, count, span);
+    return (int)count;
+}
+
+/******************************************************************************
+* Function Name: ring_buffer_commit_write
+*******************************************************************************
+* Summary:
+*  This function adds n elements written in place (ring_buffer_acquire_write) to the ring buffer.
+*
+* Parameters:
+*  1. rb_designator_t rbd - ring buffer designator, used to index and track the amount of ring buffers
+*  2. size_t n - The amount of elements written, at most the amount acquired.
+* Return:
+*  SUCCESS - The elements were added.
+*  FAILURE - Invalid designator, or n exceeds the free elements.
+*
+******************************************************************************/
+int ring_buffer_commit_write(rb_designator_t rbd, size_t n)
+{
+    if ((rbd >= RING_BUFFER_MAX) || !_rb[rbd].in_use || (n > (_rb[rbd].max_elements - (_rb[rbd].idx->head.value - _rb[rbd].idx->tail.value))))
+    {
+        return FAILURE;
+    }
+    _ring_buffer_publish(&_rb[rbd], n);
+    return SUCCESS;
+}
+
+/******************************************************************************
+* Function Name: ring_buffer_acquire_read
+*******************************************************************************
+* Summary:
+*  This function gets the elements at the tail of the ring buffer, up to n, as regions the caller can read
+*  in place. They stay in the buffer until ring_buffer_commit_read removes them.
+*
+* Parameters:
+*  1. rb_designator_t rbd - ring buffer designator, used to index and track the amount of ring buffers
+*  2. size_t n - The maximum amount of elements wanted.
+*  3. rb_span_t* span - Regions of the elements, written by this function.
+* Return:
+*  The amount of elements in span (0 if the buffer is empty)
+*  FAILURE - Invalid designator or span.
+*
+******************************************************************************/
+ITCM_CODE int ring_buffer_acquire_read(rb_designator_t rbd, size_t n, rb_span_t* span)
+{
+    if ((rbd >= RING_BUFFER_MAX) || !_rb[rbd].in_use || (span == NULL))
+    {
+        return FAILURE;
+    }
+    RB_INVALIDATE(&_rb[rbd], &_rb[rbd].idx->head, sizeof(rb_index_t));
+    const size_t used = _rb[rbd].idx->head.value - _rb[rbd].idx->tail.value;
+    const size_t count = (n < used) ? n : used;
+    // the head was read before the elements
+    __DMB();
+    _ring_buffer_span(&_rb[rbd], _rb[rbd].idx->tail.value, count, span);
+#if defined(CORE_CM7)
+    for (int r = 0; r < 2; ++r)
+    {
+        RB_INVALIDATE(&_rb[rbd], span->data[r], span->count[r] * _rb[rbd].element_size);
+    }
+#endif
+    return (int)count;
+}
+
+/******************************************************************************
+* Function Name: ring_buffer_commit_read
+*******************************************************************************
+* Summary:
+*  This function removes n elements read in place (ring_buffer_acquire_read) from the ring buffer.
+*
+* Parameters:
+*  1. rb_designator_t rbd - ring buffer designator, used to index and track the amount of ring buffers
+*  2. size_t n - The amount of elements read, at most the amount acquired.
+* Return:
+*  SUCCESS - The elements were removed.
+*  FAILURE - Invalid designator, or n exceeds the elements in the buffer.
+*
+******************************************************************************/
+ITCM_CODE int ring_buffer_commit_read(rb_designator_t rbd, size_t n)
+{
+    if ((rbd >= RING_BUFFER_MAX) || !_rb[rbd].in_use || (n > (_rb[rbd].idx->head.value - _rb[rbd].idx->tail.value)))
+    {
+        return FAILURE;
+    }
+    _ring_buffer_free(&_rb[rbd], n);
+    return SUCCESS;
+}
+
 /******************************************************************************
 * Function Name: ring_buffer_clear
 *******************************************************************************
@@ -227,6 +596,9 @@ int ring_buffer_get(rb_designator_t rbd, void* data)
 void ring_buffer_clear(rb_designator_t rbd)
 {
     memset(_rb[rbd].buf, 0, (_rb[rbd].max_elements * _rb[rbd].element_size));
-    _rb[rbd].head = 0;
-    _rb[rbd].tail = 0;
+    _rb[rbd].idx->head.value = 0;
+    _rb[rbd].idx->tail.value = 0;
+    RB_CLEAN(&_rb[rbd], _rb[rbd].buf, _rb[rbd].max_elements * _rb[rbd].element_size);
+    RB_CLEAN(&_rb[rbd], _rb[rbd].idx, sizeof(rb_indices_t));
+    __DSB();
 }
\ No newline at end of file
@@ -18,9 +18,12 @@ extern "C" {
 #endif
 #include <stddef.h>
 #include <stdint.h>
+#include "defines_and_constants.h"
 
 // Macro to check size of array
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+// Cache line of the M7. Head and tail are kept in lines of their own, so the writer of one never touches the other.
+#define RB_CACHE_LINE (32)
 
 // Ring buffer descriptor
 // This descriptor will be used by the caller to access the ring buffer which it has initialized. 
@@ -35,7 +38,8 @@ typedef uint8_t rb_designator_t;
 *   Members:
 *   element_size:       The size of each element.
 *   max_elements:       The number of elements.
-*   buffer:             A pointer to the buffer which will hold the data.
+*   buffer:             A pointer to the buffer which will hold the data. If this is NULL, ring_buffer_init takes the memory
+*                       from the RAM_D2 arena (arena.h) and writes the address back into this member.
 *   -----------------------------------------------------------------------------------------------------------------------------
 */    
 typedef struct 
@@ -45,11 +49,63 @@ typedef struct
     void* buffer;
 } rb_handle_t;
 
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Head and tail of a ring buffer, each in its own cache line.
+*   Every ring buffer is a lock-free single-producer/single-consumer queue: the producer only writes the head, the consumer
+*   only writes the tail, and an element is complete before the head that publishes it (and read before the tail that
+*   frees it) is written (__DMB). That makes one producer and one consumer in different contexts safe without a lock:
+*   an interrupt and the main loop, two interrupts of different priority, or the M7 and the M4.
+*   Per core, the indices are part of the ring buffer slot. For a ring buffer between the cores (ring_buffer_init_shared),
+*   the caller places this struct and the storage in memory both cores reach (e.g. the RAM_D3 mailbox, see dual_core.h);
+*   the M7 then cleans what it wrote and invalidates what the other core wrote, as in block_queue.c.
+*
+*   Members:
+*   head:               Number of elements added. Written by the producer only.
+*   tail:               Number of elements removed. Written by the consumer only.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+    volatile size_t value;
+} __attribute__((aligned(RB_CACHE_LINE))) rb_index_t;
+
+typedef struct
+{
+    rb_index_t head;
+    rb_index_t tail;
+} rb_indices_t;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Contiguous regions of the ring buffer storage, handed out by ring_buffer_acquire_write and ring_buffer_acquire_read.
+*   A range of elements that wraps around the end of the storage is split into two regions, otherwise the second one is
+*   empty. The caller reads or writes the elements in place (or hands the regions to a DMA) and then commits them.
+*
+*   Members:
+*   data:               Address of the first element of each region. NULL for an empty region.
+*   count:              Number of elements in each region.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+    void* data[2];
+    size_t count[2];
+} rb_span_t;
+
 int ring_buffer_init(rb_designator_t* rbd, rb_handle_t* attr);
+int ring_buffer_init_shared(rb_designator_t* rbd, const rb_handle_t* attr, rb_indices_t* indices);
 int ring_buffer_put(rb_designator_t rbd, const void* data);
 int ring_buffer_get(rb_designator_t rbd, void* data);
 int ring_buffer_count(rb_designator_t rbd);
 void ring_buffer_clear(rb_designator_t rbd);
+void ring_buffer_release(rb_designator_t rbd);
+int ring_buffer_acquire_write(rb_designator_t rbd, size_t n, rb_span_t* span);
+int ring_buffer_commit_write(rb_designator_t rbd, size_t n);
+int ring_buffer_acquire_read(rb_designator_t rbd, size_t n, rb_span_t* span);
+int ring_buffer_commit_read(rb_designator_t rbd, size_t n);
+
+void* ring_buffer_pool_alloc(size_t size);
+void ring_buffer_pool_free(void* buffer);
+size_t ring_buffer_pool_available(void);
 	
 #ifdef __cplusplus
 }
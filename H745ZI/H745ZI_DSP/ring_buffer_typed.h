@@ -0,0 +1,133 @@
+// ring_buffer_typed.h, Michael Haselberger
+// Description: Typed ring buffers with a capacity fixed at compile time. RING_BUFFER_TYPED declares the struct and
+// static inline functions for one element type, so every access is a typed copy with a constant mask instead of the
+// memcpy of element_size bytes through the designator of ring_buffer.c.
+
+#ifndef __RING_BUFFER_TYPED_H__
+#define __RING_BUFFER_TYPED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+#include "ring_buffer.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   RING_BUFFER_TYPED(name, type, capacity) declares name_t: rb_indices_t idx (head and tail in cache lines of their own)
+*   followed by type items[capacity], and the functions below. capacity has to be a power of two (static assert).
+*   The same lock-free single-producer/single-consumer protocol as ring_buffer.c: the producer only writes the head, the
+*   consumer only writes the tail, __DMB between the elements and the index that publishes or frees them. Safe between
+*   an interrupt and the main loop or the audio processing of one core. There is no cache maintenance, between the cores
+*   use ring_buffer_init_shared or block_queue.h.
+*
+*   name_clear(rb)                  Empty the ring buffer. Neither side may use it meanwhile.
+*   name_count(rb)                  Elements in the ring buffer.
+*   name_put(rb, item)              Producer: add one element. false if it's full.
+*   name_write(rb, items, n)        Producer: add up to n elements, returns how many (at most two copies).
+*   name_peek(rb)                   Consumer: oldest element, stays in the ring buffer until name_release. NULL if empty.
+*   name_release(rb)                Consumer: remove the element returned by name_peek.
+*   name_get(rb, item)              Consumer: remove one element into item. false if it's empty.
+*   name_read(rb, items, n)         Consumer: remove up to n elements into items, returns how many.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+#define RING_BUFFER_TYPED(name, type, capacity)                                                                 \
+_Static_assert(((capacity) > 0) && (((capacity) & ((capacity) - 1)) == 0), #name ": capacity has to be a power of two"); \
+typedef struct                                                                                                  \
+{                                                                                                               \
+	rb_indices_t idx;                                                                                           \
+	type items[capacity];                                                                                       \
+} name##_t;                                                                                                     \
+                                                                                                                \
+static inline void name##_clear(name##_t *rb)                                                                   \
+{                                                                                                               \
+	rb->idx.head.value = 0;                                                                                     \
+	rb->idx.tail.value = 0;                                                                                     \
+}                                                                                                               \
+                                                                                                                \
+static inline uint32_t name##_count(const name##_t *rb)                                                         \
+{                                                                                                               \
+	return (uint32_t)(rb->idx.head.value - rb->idx.tail.value);                                                 \
+}                                                                                                               \
+                                                                                                                \
+static inline bool name##_put(name##_t *rb, const type *item)                                                   \
+{                                                                                                               \
+	const size_t head = rb->idx.head.value;                                                                     \
+	if ((head - rb->idx.tail.value) >= (capacity))                                                              \
+	{                                                                                                           \
+		return false;                                                                                           \
+	}                                                                                                           \
+	rb->items[head & ((capacity) - 1)] = *item;                                                                 \
+	/* the element is complete before the consumer sees the new head */                                         \
+	__DMB();                                                                                                    \
+	rb->idx.head.value = head + 1;                                                                              \
+	return true;                                                                                                \
+}                                                                                                               \
+                                                                                                                \
+static inline uint32_t name##_write(name##_t *rb, const type *items, uint32_t n)                                \
+{                                                                                                               \
+	const size_t head = rb->idx.head.value;                                                                     \
+	const size_t space = (capacity) - (head - rb->idx.tail.value);                                              \
+	const uint32_t count = (n < space) ? n : (uint32_t)space;                                                   \
+	const uint32_t offset = (uint32_t)(head & ((capacity) - 1));                                                \
+	const uint32_t first = ((capacity) - offset < count) ? (capacity) - offset : count;                         \
+	memcpy(&rb->items[offset], items, first * sizeof(type));                                                    \
+	memcpy(rb->items, &items[first], (count - first) * sizeof(type));                                           \
+	__DMB();                                                                                                    \
+	rb->idx.head.value = head + count;                                                                          \
+	return count;                                                                                               \
+}                                                                                                               \
+                                                                                                                \
+static inline type *name##_peek(name##_t *rb)                                                                   \
+{                                                                                                               \
+	const size_t tail = rb->idx.tail.value;                                                                     \
+	if (rb->idx.head.value == tail)                                                                             \
+	{                                                                                                           \
+		return NULL;                                                                                            \
+	}                                                                                                           \
+	/* the head was read before the element */                                                                  \
+	__DMB();                                                                                                    \
+	return &rb->items[tail & ((capacity) - 1)];                                                                 \
+}                                                                                                               \
+                                                                                                                \
+static inline void name##_release(name##_t *rb)                                                                 \
+{                                                                                                               \
+	/* the element was read before it's handed back to the producer */                                          \
+	__DMB();                                                                                                    \
+	rb->idx.tail.value = rb->idx.tail.value + 1;                                                                \
+}                                                                                                               \
+                                                                                                                \
+static inline bool name##_get(name##_t *rb, type *item)                                                         \
+{                                                                                                               \
+	const type *oldest = name##_peek(rb);                                                                       \
+	if (oldest == NULL)                                                                                         \
+	{                                                                                                           \
+		return false;                                                                                           \
+	}                                                                                                           \
+	*item = *oldest;                                                                                            \
+	name##_release(rb);                                                                                         \
+	return true;                                                                                                \
+}                                                                                                               \
+                                                                                                                \
+static inline uint32_t name##_read(name##_t *rb, type *items, uint32_t n)                                       \
+{                                                                                                               \
+	const size_t tail = rb->idx.tail.value;                                                                     \
+	const size_t used = rb->idx.head.value - tail;                                                              \
+	const uint32_t count = (n < used) ? n : (uint32_t)used;                                                     \
+	const uint32_t offset = (uint32_t)(tail & ((capacity) - 1));                                                \
+	const uint32_t first = ((capacity) - offset < count) ? (capacity) - offset : count;                         \
+	__DMB();                                                                                                    \
+	memcpy(items, &rb->items[offset], first * sizeof(type));                                                    \
+	memcpy(&items[first], rb->items, (count - first) * sizeof(type));                                           \
+	__DMB();                                                                                                    \
+	rb->idx.tail.value = tail + count;                                                                          \
+	return count;                                                                                               \
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __RING_BUFFER_TYPED_H__
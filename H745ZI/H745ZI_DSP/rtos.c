@@ -0,0 +1,319 @@
+// rtos.c, Michael Haselberger
+// Description: FreeRTOS task model. The audio task replaces PendSV: the I2S DMA interrupts wake it with a task
+// notification, it processes the queued blocks (audio_process) and waits again. Below it, the control task runs the
+// MIDI, preset and load decisions of the main loop every few milliseconds, the UI task the menu, the LCD and the
+// reports. Stack high water marks, CPU shares and pass times of every task are reported over SWO once per second.
+
+#include <stdio.h>
+#include "rtos.h"
+
+#if defined(RTOS)
+
+extern void Error_Handler(void);
+// SysTick part of the kernel port, see rtos_tick
+extern void xPortSysTickHandler(void);
+
+static rtos_task_t tasks[RTOS_TASKS];
+static const char *const task_names[RTOS_TASKS] = { "audio", "control", "ui" };
+
+// the effects work on the scratch arrays of the audio stack every block, DTCM like the rest of the hot data
+DTCM_BSS static StackType_t audio_stack[RTOS_AUDIO_STACK];
+static StackType_t control_stack[RTOS_CONTROL_STACK];
+static StackType_t ui_stack[RTOS_UI_STACK];
+static StaticTask_t idle_tcb;
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+
+static SemaphoreHandle_t param_lock;
+static StaticSemaphore_t param_lock_buffer;
+
+// cycle count of the last DMA interrupt that woke the audio task
+static volatile uint32_t audio_released;
+static uint32_t idle_run_time;
+
+// write a string to ITM stimulus port 0 (SWO). returns immediately if no debugger enabled the ITM
+static void swo_write(const char *str)
+{
+	while (*str)
+	{
+		ITM_SendChar(*str++);
+	}
+}
+
+// one pass of a task with its cycle count
+static void run_pass(rtos_task_t *t)
+{
+	const uint32_t start = DWT->CYCCNT;
+	t->pass();
+	const uint32_t cycles = DWT->CYCCNT - start;
+	if (cycles > t->longest)
+	{
+		t->longest = cycles;
+	}
+	t->runs++;
+}
+
+static void audio_task(void *argument)
+{
+	rtos_task_t *t = argument;
+
+	for (;;)
+	{
+		// every block of the DMA gives one notification, one pass processes all blocks queued until then
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		const uint32_t latency = DWT->CYCCNT - audio_released;
+		if (latency > t->latency)
+		{
+			t->latency = latency;
+		}
+		run_pass(t);
+	}
+}
+
+static void control_task(void *argument)
+{
+	rtos_task_t *t = argument;
+	TickType_t wake = xTaskGetTickCount();
+
+	for (;;)
+	{
+		vTaskDelayUntil(&wake, pdMS_TO_TICKS(RTOS_CONTROL_PERIOD_MS));
+		run_pass(t);
+	}
+}
+
+/******************************************************************************
+* Function Name: report
+*******************************************************************************
+* Summary:
+*  One SWO line per task: priority, smallest free stack so far, CPU share of the interval since
+*  the last report and, for the three passes, their number, the longest pass and (audio) the
+*  longest wake-up latency of the interval. The interval statistics start again.
+*
+******************************************************************************/
+static void report(void)
+{
+	static TaskStatus_t status[RTOS_TASKS + 1];
+	static uint32_t last_total;
+	char line[128];
+	uint32_t total;
+	const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+	const UBaseType_t count = uxTaskGetSystemState(status, RTOS_TASKS + 1, &total);
+	const uint32_t interval = total - last_total;
+	last_total = total;
+
+	for (UBaseType_t i = 0; i < count; ++i)
+	{
+		rtos_task_t *t = NULL;
+		for (uint8_t k = 0; k < RTOS_TASKS; ++k)
+		{
+			if (tasks[k].handle == status[i].xHandle)
+			{
+				t = &tasks[k];
+			}
+		}
+
+		uint32_t *previous = (t != NULL) ? &t->run_time : &idle_run_time;
+		const uint32_t run = status[i].ulRunTimeCounter - *previous;
+		*previous = status[i].ulRunTimeCounter;
+		// 0.1 %, integer like the profiler report
+		const uint32_t share = (interval > 0) ? (uint32_t)(((uint64_t)run * 1000) / interval) : 0;
+
+		int pos = snprintf(line, sizeof(line), "rtos: %s prio %lu stack %lu words free, cpu %lu.%lu%%", status[i].pcTaskName,
+			(unsigned long)status[i].uxCurrentPriority, (unsigned long)status[i].usStackHighWaterMark,
+			(unsigned long)(share / 10), (unsigned long)(share % 10));
+		if (t != NULL)
+		{
+			taskENTER_CRITICAL();
+			const uint32_t runs = t->runs;
+			const uint32_t longest = t->longest;
+			const uint32_t latency = t->latency;
+			t->runs = 0;
+			t->longest = 0;
+			t->latency = 0;
+			taskEXIT_CRITICAL();
+
+			pos += snprintf(&line[pos], sizeof(line) - pos, ", %lu passes, longest %lu us", (unsigned long)runs,
+				(unsigned long)(longest / cycles_per_us));
+			if (t == &tasks[RTOS_TASK_AUDIO])
+			{
+				pos += snprintf(&line[pos], sizeof(line) - pos, ", latency %lu us", (unsigned long)(latency / cycles_per_us));
+			}
+		}
+		snprintf(&line[pos], sizeof(line) - pos, "\r\n");
+		swo_write(line);
+	}
+}
+
+static void ui_task(void *argument)
+{
+	rtos_task_t *t = argument;
+	TickType_t last_report = xTaskGetTickCount();
+
+	for (;;)
+	{
+		// a control event (rtos_ui_from_isr) wakes the task at once, the LCD and the pages are refreshed anyway
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RTOS_UI_PERIOD_MS));
+		run_pass(t);
+
+		if ((xTaskGetTickCount() - last_report) >= pdMS_TO_TICKS(RTOS_REPORT_MS))
+		{
+			last_report = xTaskGetTickCount();
+			report();
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: rtos_start
+*******************************************************************************
+* Summary:
+*  Create the audio, control and UI tasks and start the scheduler. Everything is allocated
+*  statically. Until the scheduler runs, the DMA interrupts only queue their blocks (see
+*  rtos_audio_from_isr), the audio task processes them with its first pass. Doesn't return.
+*
+* Parameters:
+*  1. rtos_pass_t audio				- Processing of the queued audio blocks (audio_process).
+*  2. rtos_pass_t control			- Control pass: MIDI program changes, transitions, stream, load.
+*  3. rtos_pass_t ui				- UI pass: menu, LCD, tuner, telemetry and profiler reports.
+* Return:
+*  None.
+*
+******************************************************************************/
+void rtos_start(rtos_pass_t audio, rtos_pass_t control, rtos_pass_t ui)
+{
+	// cycle counter of the statistics, also without the profiler
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	param_lock = xSemaphoreCreateMutexStatic(&param_lock_buffer);
+
+	tasks[RTOS_TASK_AUDIO].pass = audio;
+	tasks[RTOS_TASK_CONTROL].pass = control;
+	tasks[RTOS_TASK_UI].pass = ui;
+	tasks[RTOS_TASK_AUDIO].handle = xTaskCreateStatic(audio_task, task_names[RTOS_TASK_AUDIO], RTOS_AUDIO_STACK,
+		&tasks[RTOS_TASK_AUDIO], RTOS_AUDIO_PRIORITY, audio_stack, &tasks[RTOS_TASK_AUDIO].tcb);
+	tasks[RTOS_TASK_CONTROL].handle = xTaskCreateStatic(control_task, task_names[RTOS_TASK_CONTROL], RTOS_CONTROL_STACK,
+		&tasks[RTOS_TASK_CONTROL], RTOS_CONTROL_PRIORITY, control_stack, &tasks[RTOS_TASK_CONTROL].tcb);
+	tasks[RTOS_TASK_UI].handle = xTaskCreateStatic(ui_task, task_names[RTOS_TASK_UI], RTOS_UI_STACK,
+		&tasks[RTOS_TASK_UI], RTOS_UI_PRIORITY, ui_stack, &tasks[RTOS_TASK_UI].tcb);
+
+	vTaskStartScheduler();
+	Error_Handler();
+}
+
+/******************************************************************************
+* Function Name: rtos_audio_from_isr
+*******************************************************************************
+* Summary:
+*  Wake the audio task from the I2S DMA (or MDMA) interrupt that queued a block. Switches to
+*  the task as soon as the interrupt returns. Before the task exists, the block stays queued.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void rtos_audio_from_isr(void)
+{
+	BaseType_t woken = pdFALSE;
+
+	if (tasks[RTOS_TASK_AUDIO].handle == NULL)
+	{
+		return;
+	}
+	audio_released = DWT->CYCCNT;
+	vTaskNotifyGiveFromISR(tasks[RTOS_TASK_AUDIO].handle, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+// wake the UI task from the interrupts of the controls (ui_post)
+void rtos_ui_from_isr(void)
+{
+	BaseType_t woken = pdFALSE;
+
+	if (tasks[RTOS_TASK_UI].handle == NULL)
+	{
+		return;
+	}
+	vTaskNotifyGiveFromISR(tasks[RTOS_TASK_UI].handle, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+// the menu (UI task) and the control task both set effect parameters, which have a single writer at a time.
+// priority inheritance: a menu pass holding the lock runs at the priority of the waiting control task
+void rtos_lock(void)
+{
+	xSemaphoreTake(param_lock, portMAX_DELAY);
+}
+
+void rtos_unlock(void)
+{
+	xSemaphoreGive(param_lock);
+}
+
+// most bytes a task took of its stack and the size of the stack, 0 before the task exists (stack_monitor.h)
+uint32_t rtos_stack_used(rtos_task task, uint32_t *size)
+{
+	static const uint32_t words[RTOS_TASKS] = { RTOS_AUDIO_STACK, RTOS_CONTROL_STACK, RTOS_UI_STACK };
+	*size = words[task] * sizeof(StackType_t);
+	if (tasks[task].handle == NULL)
+	{
+		return 0;
+	}
+	// the kernel counts the words never written from the end of the stack
+	return (words[task] - uxTaskGetStackHighWaterMark(tasks[task].handle)) * sizeof(StackType_t);
+}
+
+// kernel tick from SysTick_Handler, once the scheduler runs (HAL_Delay uses the SysTick before)
+void rtos_tick(void)
+{
+	if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+	{
+		xPortSysTickHandler();
+	}
+}
+
+/******************************************************************************
+* Function Name: rtos_run_time
+*******************************************************************************
+* Summary:
+*  Run time counter of the kernel statistics (portGET_RUN_TIME_COUNTER_VALUE) in microseconds.
+*  The cycle counter wraps within seconds, so its progress is added up at every call: the kernel
+*  calls it at every task switch, at least once per audio block. The core clock of the moment
+*  converts the cycles, a profile change (power.h) only blurs the interval it falls into.
+*  Called by the kernel with the scheduler locked, never concurrently.
+*
+******************************************************************************/
+uint32_t rtos_run_time(void)
+{
+	static uint32_t last_cycles, remainder, microseconds;
+	const uint32_t now = DWT->CYCCNT;
+	const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+	remainder += now - last_cycles;
+	last_cycles = now;
+	microseconds += remainder / cycles_per_us;
+	remainder %= cycles_per_us;
+	return microseconds;
+}
+
+// the idle task sleeps until the next interrupt, as the main loop does without RTOS
+void vApplicationIdleHook(void)
+{
+	__WFI();
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t task, char *name)
+{
+	(void)task;
+	(void)name;
+	Error_Handler();
+}
+
+// memory of the idle task (configSUPPORT_STATIC_ALLOCATION)
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *stack_size)
+{
+	*tcb = &idle_tcb;
+	*stack = idle_stack;
+	*stack_size = configMINIMAL_STACK_SIZE;
+}
+
+#endif
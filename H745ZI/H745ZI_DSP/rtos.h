@@ -0,0 +1,83 @@
+// rtos.h, Michael Haselberger
+// Description: This file contains declarations for the FreeRTOS task model implemented in rtos.c
+
+#ifndef __RTOS_H__
+#define __RTOS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+
+#if defined(RTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+// task priorities: audio above everything else, control (MIDI, presets, load) above the user interface
+#define RTOS_AUDIO_PRIORITY (3)
+#define RTOS_CONTROL_PRIORITY (2)
+#define RTOS_UI_PRIORITY (1)
+// stack sizes in words. the effects keep MAX_BLOCK_SIZE scratch arrays on the stack of the audio task (8 KB, as the main
+// stack for PendSV without RTOS), the reports of the UI task format with snprintf
+#define RTOS_AUDIO_STACK (2048)
+#define RTOS_CONTROL_STACK (768)
+#define RTOS_UI_STACK (1024)
+// the control task runs every RTOS_CONTROL_PERIOD_MS, the UI task on a control event or after RTOS_UI_PERIOD_MS
+#define RTOS_CONTROL_PERIOD_MS (5)
+#define RTOS_UI_PERIOD_MS (20)
+// task statistics over SWO
+#define RTOS_REPORT_MS (1000)
+
+typedef enum
+{
+	RTOS_TASK_AUDIO = 0,
+	RTOS_TASK_CONTROL,
+	RTOS_TASK_UI,
+	RTOS_TASKS
+} rtos_task;
+
+// one pass of a task: audio_process, the control or the UI pass of main.c
+typedef void (*rtos_pass_t)(void);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Task of the audio, control or UI pass with its statistics since the last report. The statistics are written by the
+*   task itself and taken by the report of the UI task in a critical section.
+*
+*   Members:
+*   handle, tcb:        Kernel handle and statically allocated task control block.
+*   pass:               Function of one pass.
+*   run_time:           Run time counter (microseconds) at the last report, for the CPU share of the interval.
+*   runs:               Passes since the last report.
+*   longest:            Longest pass in CPU cycles.
+*   latency:            Audio task: longest time in CPU cycles from the DMA interrupt to the start of the pass.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	TaskHandle_t handle;
+	StaticTask_t tcb;
+	rtos_pass_t pass;
+	uint32_t run_time;
+	uint32_t runs;
+	uint32_t longest;
+	uint32_t latency;
+} rtos_task_t;
+
+void rtos_start(rtos_pass_t audio, rtos_pass_t control, rtos_pass_t ui);
+void rtos_audio_from_isr(void);
+void rtos_ui_from_isr(void);
+void rtos_lock(void);
+void rtos_unlock(void);
+uint32_t rtos_stack_used(rtos_task task, uint32_t *size);
+void rtos_tick(void);
+uint32_t rtos_run_time(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __RTOS_H__
@@ -0,0 +1,73 @@
+// scratch_pool.c, Michael Haselberger
+// Description: Scratch pool of the audio path: the temporary blocks of the kernels, which were arrays on the main stack
+// (RAM_D1), come from a stack of their own in DTCM. A kernel takes a mark, allocates its blocks and releases the mark
+// before it returns; the chain scheduler does the same around every node, so a node that forgot to
+// release doesn't reach into the next one and the pool holds at most the deepest node, not the sum of them. A context
+// that preempts another allocates above it and has released again when it returns: the main loop may use the pool
+// as well, without a lock.
+
+#include "scratch_pool.h"
+
+static uint8_t __attribute__((aligned(SCRATCH_POOL_ALIGN))) DTCM_BSS pool[SCRATCH_POOL_SIZE];
+// first free byte, the most ever taken at once (requests that didn't fit included) and the requests that didn't fit
+static uint32_t top DTCM_BSS;
+static uint32_t high_water DTCM_BSS;
+static uint32_t overflows DTCM_BSS;
+
+/******************************************************************************
+* Function Name: scratch_pool_alloc
+*******************************************************************************
+* Summary:
+*  Take a buffer from the top of the pool. Only valid until the mark taken before is released.
+*  A request that doesn't fit is counted and gets the bottom of the pool, which the caller
+*  shares with the buffers below: the block is garbled, no other memory is written.
+*
+* Parameters:
+*  1. size_t size					- Bytes.
+* Return:
+*  SCRATCH_POOL_ALIGN aligned buffer.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void *scratch_pool_alloc(size_t size)
+{
+	const uint32_t start = top;
+	const uint32_t end = start + (((uint32_t)size + (SCRATCH_POOL_ALIGN - 1)) & ~(uint32_t)(SCRATCH_POOL_ALIGN - 1));
+	if (end > high_water)
+	{
+		high_water = end;
+	}
+	if (end > SCRATCH_POOL_SIZE)
+	{
+		overflows++;
+		return pool;
+	}
+	top = end;
+	return &pool[start];
+}
+
+// open a scope: scratch_pool_release gives back everything allocated from now on
+#pragma optimize_for_speed
+ITCM_CODE scratch_mark_t scratch_pool_mark(void)
+{
+	return top;
+}
+
+// close the scope of a mark. marks are released in the reverse order they were taken
+#pragma optimize_for_speed
+ITCM_CODE void scratch_pool_release(scratch_mark_t mark)
+{
+	top = mark;
+}
+
+// the most bytes taken at the same time since boot, above SCRATCH_POOL_SIZE if a request didn't fit
+uint32_t scratch_pool_high_water(void)
+{
+	return high_water;
+}
+
+// requests that didn't fit since boot
+uint32_t scratch_pool_overflows(void)
+{
+	return overflows;
+}
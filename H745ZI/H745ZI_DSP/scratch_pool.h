@@ -0,0 +1,36 @@
+// scratch_pool.h, Michael Haselberger
+// Description: This file contains declarations for the scratch pool of the audio path implemented in scratch_pool.c
+
+#ifndef __SCRATCH_POOL_H__
+#define __SCRATCH_POOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "defines_and_constants.h"
+
+// bytes of the pool (DTCM_BSS): 12 blocks of MAX_BLOCK_SIZE floats, sized against the DTCM budget (arena.h). the
+// deepest node takes 8: the smoothed mix of a kernel (3 blocks) on top of the wet block of the kernel and its
+// oversampler, the rest is the margin for the stereo paths. the high water mark is in the stack report (stack_monitor.h)
+#ifndef SCRATCH_POOL_SIZE
+#define SCRATCH_POOL_SIZE (12 * MAX_BLOCK_SIZE * 4)
+#endif
+// alignment of the buffers: doubleword, for the paired loads of the CMSIS-DSP kernels
+#define SCRATCH_POOL_ALIGN (8)
+
+// top of the pool at scratch_pool_mark, everything above it is given back by scratch_pool_release
+typedef uint32_t scratch_mark_t;
+
+void *scratch_pool_alloc(size_t size);
+scratch_mark_t scratch_pool_mark(void);
+void scratch_pool_release(scratch_mark_t mark);
+uint32_t scratch_pool_high_water(void);
+uint32_t scratch_pool_overflows(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __SCRATCH_POOL_H__
@@ -0,0 +1,403 @@
+// smooth_param.c, Michael Haselberger
+// Description: Block based parameter smoothing. Parameter changes from the user interface used to take effect
+// from one sample to the next, which results in audible steps (zipper noise). Here every change is spread over
+// a few blocks, the ramp inside a block is computed with CMSIS vector functions.
+
+#include "smooth_param.h"
+#include "scratch_pool.h"
+
+// 0, 1, 2, ... scaled and offset to get a ramp of any slope with two vector operations
+static float32_t ramp_index[MAX_BLOCK_SIZE];
+static bool ramp_index_ready = false;
+
+/******************************************************************************
+* Function Name: smooth_param_init
+*******************************************************************************
+* Summary:
+*  Initialize a smoothed parameter. The parameter starts at value without ramp.
+*
+* Parameters:
+*  1. smooth_param_t *sp			- Address pointer of the smoothed parameter struct.
+*  2. float32_t value				- Initial value.
+*  3. smooth_param_mode mode		- SMOOTH_LINEAR or SMOOTH_EXPONENTIAL.
+*  4. float32_t time_ms				- Ramp time (linear) or time constant (exponential) in ms.
+* Return:
+*  None.
+*
+******************************************************************************/
+void smooth_param_init(smooth_param_t *sp, float32_t value, smooth_param_mode mode, float32_t time_ms)
+{
+	if (!ramp_index_ready)
+	{
+		for (uint32_t i = 0; i < MAX_BLOCK_SIZE; ++i)
+		{
+			ramp_index[i] = (float32_t)i;
+		}
+		ramp_index_ready = true;
+	}
+
+	const float32_t time = time_ms * (sample_rate / 1000.0f);
+	sp->time = (time < 1.0f) ? 1.0f : time;
+	sp->mode = mode;
+	sp->coeff = 0;
+	sp->coeff_size = 0;
+	smooth_param_reset(sp, value);
+}
+
+/******************************************************************************
+* Function Name: smooth_param_reset
+*******************************************************************************
+* Summary:
+*  Jump to a value without ramp, e.g. when the effect is reset.
+*
+* Parameters:
+*  1. smooth_param_t *sp			- Address pointer of the smoothed parameter struct.
+*  2. float32_t value				- New value.
+* Return:
+*  None.
+*
+******************************************************************************/
+void smooth_param_reset(smooth_param_t *sp, float32_t value)
+{
+	sp->start = value;
+	sp->end = value;
+	sp->target = value;
+	sp->step = 0;
+	sp->events = 0;
+	sp->knots = 0;
+}
+
+/******************************************************************************
+* Function Name: smooth_param_schedule
+*******************************************************************************
+* Summary:
+*  Change the target at a sample of the next block instead of at its start. Up to
+*  offset, the parameter keeps heading for its previous target, from offset on for the new one.
+*  The target passed to smooth_param_next has to end up at the target of the last event (e.g.
+*  by the *_update function of the parameter), it takes over after the last event. Offsets
+*  beyond the next call to smooth_param_next (chunked effects) are carried into the following
+*  calls. Call from the context that calls smooth_param_next (the audio processing).
+*
+* Parameters:
+*  1. smooth_param_t *sp			- Address pointer of the smoothed parameter struct.
+*  2. float32_t target				- New target.
+*  3. uint32_t offset				- Sample of the next block the target applies from.
+* Return:
+*  None.
+*
+******************************************************************************/
+void smooth_param_schedule(smooth_param_t *sp, float32_t target, uint32_t offset)
+{
+	if (sp->events == SMOOTH_PARAM_MAX_EVENTS)
+	{
+		sp->event_target[SMOOTH_PARAM_MAX_EVENTS - 1] = target;
+		return;
+	}
+	// insertion into the sorted list, an event at the same offset comes after the earlier ones
+	uint8_t i = sp->events;
+	while ((i > 0) && (sp->event_offset[i - 1] > offset))
+	{
+		sp->event_offset[i] = sp->event_offset[i - 1];
+		sp->event_target[i] = sp->event_target[i - 1];
+		--i;
+	}
+	sp->event_offset[i] = (offset > MAX_BLOCK_SIZE) ? MAX_BLOCK_SIZE : (uint16_t)offset;
+	sp->event_target[i] = target;
+	sp->events++;
+}
+
+// move end towards target over length samples
+#pragma optimize_for_speed
+ITCM_CODE static void advance(smooth_param_t *sp, float32_t target, uint32_t length)
+{
+	const float32_t current = sp->end;
+	if (target == current)
+	{
+		sp->target = target;
+		return;
+	}
+
+	float32_t end;
+	if (sp->mode == SMOOTH_LINEAR)
+	{
+		// new target: plan a slope that gets there within the ramp time
+		if (target != sp->target)
+		{
+			sp->target = target;
+			sp->step = (target - current) / sp->time;
+		}
+		end = current + sp->step * length;
+		if ((sp->step == 0) || ((sp->step > 0) && (end >= target)) || ((sp->step < 0) && (end <= target)))
+			end = target;
+	}
+	else
+	{
+		// one-pole lowpass evaluated once per segment: 1 - e^(-length / time) of the distance is covered
+		if (sp->coeff_size != length)
+		{
+			sp->coeff = 1.0f - expf(-(float32_t)length / sp->time);
+			sp->coeff_size = length;
+		}
+		sp->target = target;
+		end = current + (target - current) * sp->coeff;
+		// the exponential never arrives, snap to the target once the rest is inaudible
+		if (fabsf(target - end) <= 1e-5f * (1.0f + fabsf(target)))
+			end = target;
+	}
+	sp->end = end;
+}
+
+/******************************************************************************
+* Function Name: smooth_param_next
+*******************************************************************************
+* Summary:
+*  Advance the parameter by one block. Call once per block before using the ramp.
+*  Only a few scalar operations (one expf when the block size changed), nothing per sample.
+*  Scheduled events of the block add a segment each (see smooth_param_schedule).
+*
+* Parameters:
+*  1. smooth_param_t *sp			- Address pointer of the smoothed parameter struct.
+*  2. float32_t target				- Current target value. May change at any time.
+*  3. uint32_t block_size			- Number of samples in the block.
+* Return:
+*  true:							- The value changes during this block (ramp).
+*  false:							- The value is constant (target reached).
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE bool smooth_param_next(smooth_param_t *sp, float32_t target, uint32_t block_size)
+{
+	sp->start = sp->end;
+	sp->knots = 0;
+	if (sp->events == 0)
+	{
+		advance(sp, target, block_size);
+		return smooth_param_is_ramping(sp);
+	}
+
+	// segments up to every event of this block, heading for the target before the event
+	float32_t heading = sp->target;
+	uint32_t position = 0;
+	uint8_t e = 0;
+	for (; (e < sp->events) && (sp->event_offset[e] < block_size); ++e)
+	{
+		const uint32_t offset = sp->event_offset[e];
+		if (offset > position)
+		{
+			advance(sp, heading, offset - position);
+			sp->knot_offset[sp->knots] = (uint16_t)offset;
+			sp->knot_value[sp->knots] = sp->end;
+			sp->knots++;
+			position = offset;
+		}
+		heading = sp->event_target[e];
+	}
+
+	// events of the next calls move to the front. without any left, the current target takes over
+	const uint8_t left = sp->events - e;
+	for (uint8_t i = 0; i < left; ++i)
+	{
+		sp->event_offset[i] = sp->event_offset[e + i] - block_size;
+		sp->event_target[i] = sp->event_target[e + i];
+	}
+	sp->events = left;
+	advance(sp, left ? heading : target, block_size - position);
+	return smooth_param_is_ramping(sp);
+}
+
+/******************************************************************************
+* Function Name: smooth_param_ramp
+*******************************************************************************
+* Summary:
+*  Fill a block with the values of the parameter during the last block (linear from start towards end,
+*  or from knot to knot when events split the block).
+*
+* Parameters:
+*  1. const smooth_param_t *sp		- Address pointer of the smoothed parameter struct.
+*  2. float32_t *dst				- Output block.
+*  3. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void smooth_param_ramp(const smooth_param_t *sp, float32_t *dst, uint32_t block_size)
+{
+	if (!smooth_param_is_ramping(sp))
+	{
+		arm_fill_f32(sp->end, dst, block_size);
+		return;
+	}
+	uint32_t position = 0;
+	float32_t value = sp->start;
+	for (uint8_t k = 0; k < sp->knots; ++k)
+	{
+		const uint32_t length = sp->knot_offset[k] - position;
+		arm_scale_f32(ramp_index, (sp->knot_value[k] - value) / length, &dst[position], length);
+		arm_offset_f32(&dst[position], value, &dst[position], length);
+		position = sp->knot_offset[k];
+		value = sp->knot_value[k];
+	}
+	const uint32_t length = block_size - position;
+	arm_scale_f32(ramp_index, (sp->end - value) / length, &dst[position], length);
+	arm_offset_f32(&dst[position], value, &dst[position], length);
+}
+
+/******************************************************************************
+* Function Name: smooth_param_scale
+*******************************************************************************
+* Summary:
+*  Multiply a block with the parameter (gain). While ramping, the block is multiplied with
+*  the ramp, otherwise with the constant value.
+*
+* Parameters:
+*  1. const smooth_param_t *sp		- Address pointer of the smoothed parameter struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block. May be the same as src.
+*  4. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void smooth_param_scale(const smooth_param_t *sp, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	if (!smooth_param_is_ramping(sp))
+	{
+		arm_scale_f32(src, sp->end, dst, block_size);
+		return;
+	}
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *ramp = scratch_pool_alloc(block_size * sizeof(float32_t));
+	smooth_param_ramp(sp, ramp, block_size);
+	arm_mult_f32(src, ramp, dst, block_size);
+	scratch_pool_release(mark);
+}
+
+/******************************************************************************
+* Function Name: smooth_param_mix
+*******************************************************************************
+* Summary:
+*  Blend a dry and a wet block with the parameter as wet ratio: dst = dry + p * (wet - dry),
+*  which is the same as (1 - p) * dry + p * wet. A settled p of 1 or 0 only copies the wet or
+*  the dry block: an effect in a parallel branch (fx_chain_add_split) runs at full wet and
+*  leaves the dry signal to the mixer.
+*
+* Parameters:
+*  1. const smooth_param_t *sp		- Address pointer of the smoothed parameter struct.
+*  2. const float32_t *dry			- Dry block (p = 0).
+*  3. const float32_t *wet			- Wet block (p = 1).
+*  4. float32_t *dst				- Output block. May be the same as dry or wet.
+*  5. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void smooth_param_mix(const smooth_param_t *sp, const float32_t *dry, const float32_t *wet, float32_t *dst, uint32_t block_size)
+{
+	if (!smooth_param_is_ramping(sp) && ((sp->end == 1.0f) || (sp->end == 0.0f)))
+	{
+		const float32_t *src = (sp->end == 1.0f) ? wet : dry;
+		if (src != dst)
+			arm_copy_f32(src, dst, block_size);
+		return;
+	}
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *diff = scratch_pool_alloc(block_size * sizeof(float32_t));
+	arm_sub_f32(wet, dry, diff, block_size);
+	smooth_param_scale(sp, diff, diff, block_size);
+	arm_add_f32(dry, diff, dst, block_size);
+	scratch_pool_release(mark);
+}
+
+// ---- q31 (SAMPLE_Q31 chain) ----
+
+// parameter in [0, 1] as q31 factor, 1 saturates to the largest q31 value
+static inline q31_t factor_q31(float32_t p)
+{
+	return (p >= 1.0f) ? 0x7FFFFFFF : (q31_t)(p * 2147483648.0f);
+}
+
+/******************************************************************************
+* Function Name: smooth_param_scale_q31
+*******************************************************************************
+* Summary:
+*  q31 version of smooth_param_scale. The parameter has to be in [0, 1].
+*
+* Parameters:
+*  1. const smooth_param_t *sp		- Address pointer of the smoothed parameter struct.
+*  2. const q31_t *src				- Input block.
+*  3. q31_t *dst					- Output block. May be the same as src.
+*  4. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void smooth_param_scale_q31(const smooth_param_t *sp, const q31_t *src, q31_t *dst, uint32_t block_size)
+{
+	if (!smooth_param_is_ramping(sp))
+	{
+		arm_scale_q31(src, factor_q31(sp->end), 0, dst, block_size);
+		return;
+	}
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *ramp = scratch_pool_alloc(block_size * sizeof(float32_t));
+	q31_t *gain = scratch_pool_alloc(block_size * sizeof(q31_t));
+	smooth_param_ramp(sp, ramp, block_size);
+	arm_float_to_q31(ramp, gain, block_size);
+	arm_mult_q31(src, gain, dst, block_size);
+	scratch_pool_release(mark);
+}
+
+/******************************************************************************
+* Function Name: smooth_param_mix_q31
+*******************************************************************************
+* Summary:
+*  q31 version of smooth_param_mix. Computed as (1 - p) * dry + p * wet: wet - dry could
+*  overflow in q31, a weighted sum of two q31 blocks can't. The parameter has to be in [0, 1].
+*
+* Parameters:
+*  1. const smooth_param_t *sp		- Address pointer of the smoothed parameter struct.
+*  2. const q31_t *dry				- Dry block (p = 0).
+*  3. const q31_t *wet				- Wet block (p = 1).
+*  4. q31_t *dst					- Output block. May be the same as dry or wet.
+*  5. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void smooth_param_mix_q31(const smooth_param_t *sp, const q31_t *dry, const q31_t *wet, q31_t *dst, uint32_t block_size)
+{
+	if (!smooth_param_is_ramping(sp) && ((sp->end == 1.0f) || (sp->end == 0.0f)))
+	{
+		const q31_t *src = (sp->end == 1.0f) ? wet : dry;
+		if (src != dst)
+			arm_copy_q31(src, dst, block_size);
+		return;
+	}
+	const scratch_mark_t mark = scratch_pool_mark();
+	q31_t *dry_part = scratch_pool_alloc(block_size * sizeof(q31_t));
+	if (!smooth_param_is_ramping(sp))
+	{
+		arm_scale_q31(dry, factor_q31(1.0f - sp->end), 0, dry_part, block_size);
+		arm_scale_q31(wet, factor_q31(sp->end), 0, dst, block_size);
+	}
+	else
+	{
+		float32_t *ramp = scratch_pool_alloc(block_size * sizeof(float32_t));
+		q31_t *gain = scratch_pool_alloc(block_size * sizeof(q31_t));
+		smooth_param_ramp(sp, ramp, block_size);
+		arm_float_to_q31(ramp, gain, block_size);
+		// 1 - p
+		arm_negate_q31(gain, dry_part, block_size);
+		arm_offset_q31(dry_part, 0x7FFFFFFF, dry_part, block_size);
+		// dry before dst is written, dst may be the same as dry
+		arm_mult_q31(dry, dry_part, dry_part, block_size);
+		arm_mult_q31(wet, gain, dst, block_size);
+	}
+	arm_add_q31(dry_part, dst, dst, block_size);
+	scratch_pool_release(mark);
+}
@@ -0,0 +1,101 @@
+// smooth_param.h, Michael Haselberger
+// Description: This file contains declarations for the block based parameter smoothing implemented in smooth_param.c
+
+#ifndef __SMOOTH_PARAM_H__
+#define __SMOOTH_PARAM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// ramp time of the effect parameters (see the *_init functions in fx_lib.c)
+#define SMOOTH_PARAM_DEFAULT_MS 20.0f
+// timed target changes per parameter and block (smooth_param_schedule). a further event replaces the target of the last
+#define SMOOTH_PARAM_MAX_EVENTS (4)
+
+// LINEAR: constant slope, reaches the target after the ramp time.
+// EXPONENTIAL: one-pole lowpass, the remaining distance shrinks by 1/e per ramp time
+typedef enum
+{
+	SMOOTH_LINEAR = 0,
+	SMOOTH_EXPONENTIAL
+} smooth_param_mode;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Smoothed effect parameter.
+*   The target is read once per block (e.g. from the volatile field of an effect handle, which the user interface or the
+*   other core may overwrite at any time). The parameter then moves from its current value towards the target, and the
+*   block gets a linear ramp from start to end, which is generated with CMSIS vector functions instead of per sample.
+*   Once the target is reached, start == end and the helpers fall back to the cheaper constant versions.
+*   Target changes with a sample position (automation, MIDI) are scheduled as events: the block is split at every event
+*   into linear segments, so a change lands at its sample instead of the block start. Each event adds one segment, the
+*   cost grows with the number of events, not with the block size.
+*
+*   Members:
+*   start, end:         Value at the first sample of the last block and one sample after it.
+*   target:             Target the linear slope was computed for.
+*   step:               Linear slope per sample.
+*   time:               Ramp time (linear) or time constant (exponential) in samples.
+*   coeff:              Exponential: per block share of the remaining distance, cached for coeff_size samples.
+*   mode:               SMOOTH_LINEAR or SMOOTH_EXPONENTIAL.
+*   events:             Number of scheduled events, sorted by offset.
+*   event_offset,
+*   event_target:       Sample of the event, counted from the first sample of the next smooth_param_next, and its target.
+*   knots:              Segment boundaries inside the last block, 0 = one linear ramp from start to end.
+*   knot_offset,
+*   knot_value:         Sample of a boundary in the last block and the value there.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t start;
+	float32_t end;
+	float32_t target;
+	float32_t step;
+	float32_t time;
+	float32_t coeff;
+	uint32_t coeff_size;
+	smooth_param_mode mode;
+	uint8_t events;
+	uint8_t knots;
+	uint16_t event_offset[SMOOTH_PARAM_MAX_EVENTS];
+	float32_t event_target[SMOOTH_PARAM_MAX_EVENTS];
+	uint16_t knot_offset[SMOOTH_PARAM_MAX_EVENTS];
+	float32_t knot_value[SMOOTH_PARAM_MAX_EVENTS];
+} smooth_param_t;
+
+void smooth_param_init(smooth_param_t *sp, float32_t value, smooth_param_mode mode, float32_t time_ms);
+void smooth_param_reset(smooth_param_t *sp, float32_t value);
+void smooth_param_schedule(smooth_param_t *sp, float32_t target, uint32_t offset);
+bool smooth_param_next(smooth_param_t *sp, float32_t target, uint32_t block_size);
+void smooth_param_ramp(const smooth_param_t *sp, float32_t *dst, uint32_t block_size);
+void smooth_param_scale(const smooth_param_t *sp, const float32_t *src, float32_t *dst, uint32_t block_size);
+void smooth_param_mix(const smooth_param_t *sp, const float32_t *dry, const float32_t *wet, float32_t *dst, uint32_t block_size);
+void smooth_param_scale_q31(const smooth_param_t *sp, const q31_t *src, q31_t *dst, uint32_t block_size);
+void smooth_param_mix_q31(const smooth_param_t *sp, const q31_t *dry, const q31_t *wet, q31_t *dst, uint32_t block_size);
+
+// value at the end of the last block. for parameters which are only needed once per block (e.g. LFO rates)
+static inline float32_t smooth_param_value(const smooth_param_t *sp)
+{
+	return sp->end;
+}
+
+// the same as q31 factor, for parameters in [0, 1] (SAMPLE_Q31 chain). 1 saturates to the largest q31 value
+static inline q31_t smooth_param_value_q31(const smooth_param_t *sp)
+{
+	return (sp->end >= 1.0f) ? 0x7FFFFFFF : (q31_t)(sp->end * 2147483648.0f);
+}
+
+static inline bool smooth_param_is_ramping(const smooth_param_t *sp)
+{
+	return ((sp->start != sp->end) || sp->knots) ? true : false;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __SMOOTH_PARAM_H__
@@ -0,0 +1,262 @@
+// stack_monitor.c, Michael Haselberger
+// Description: High water marks of the stacks. The main stack (_Min_Stack_Size below _estack, see
+// STM32H745ZITx_FLASH_CM7.ld) is painted at boot and scanned from its end once per second for the deepest word ever
+// written. The audio interrupt measures its own part as well: every STACK_PROBE_BLOCKS blocks it paints the stack
+// below itself again and scans it when the block is done. With RTOS the kernel keeps the marks of the task stacks, the
+// main stack only carries the interrupts. The temporary blocks of the effects come from the scratch pool
+// (scratch_pool.h), its high water mark is reported with the stacks. SWO line and host link status.
+
+#include <stdio.h>
+#include "stack_monitor.h"
+#include "scratch_pool.h"
+#if defined(RTOS)
+#include "rtos.h"
+#endif
+
+#if defined(STACK_MONITOR)
+
+// linker script symbols (STM32H745ZITx_FLASH_CM7.ld): the top of the main stack, the size is the address of the symbol
+extern uint32_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+// painted words of the main stack
+static uint32_t *bottom DTCM_BSS;
+static uint32_t *top DTCM_BSS;
+// lowest word of the main stack found written so far. written with the interrupts disabled, the audio interrupt too
+static uint32_t *lowest DTCM_BSS;
+#if !defined(RTOS)
+// deepest stack pointer the audio interrupt came in at and its own use on the probe blocks, in bytes
+static uint32_t preempted DTCM_BSS;
+static uint32_t audio DTCM_BSS;
+// blocks since the last probe, the stack pointer of the probe running (0: none)
+static uint32_t blocks DTCM_BSS;
+static uint32_t probe_sp DTCM_BSS;
+#endif
+static uint32_t last_report;
+
+// first word from the end of the stack that isn't the paint anymore
+#pragma optimize_for_speed
+ITCM_CODE static uint32_t *scan(void)
+{
+	uint32_t *p = bottom;
+	while ((p < top) && (*p == STACK_PAINT))
+	{
+		p++;
+	}
+	return p;
+}
+
+// paint the words from the end of the stack up to a stack pointer. everything below it is free, as long as no
+// interrupt comes in
+#pragma optimize_for_speed
+ITCM_CODE static void paint(uint32_t *end)
+{
+	for (uint32_t *p = bottom; p < end; ++p)
+	{
+		*p = STACK_PAINT;
+	}
+}
+
+/******************************************************************************
+* Function Name: stack_monitor_init
+*******************************************************************************
+* Summary:
+*  Paint the main stack below the current stack pointer. Call first in main, before any
+*  interrupt is enabled.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void stack_monitor_init(void)
+{
+	top = &_estack;
+	bottom = (uint32_t *)((uintptr_t)&_estack - (uintptr_t)&_Min_Stack_Size);
+	uint32_t *sp = (uint32_t *)__get_MSP();
+	paint((sp < top) ? sp : top);
+	lowest = sp;
+	last_report = 0;
+}
+
+#if !defined(RTOS)
+/******************************************************************************
+* Function Name: stack_monitor_enter
+*******************************************************************************
+* Summary:
+*  Sample the depth of the main stack the audio interrupt came in at. On a probe block fold the
+*  marks of the stack into the high water mark and paint the stack below the interrupt again,
+*  with the interrupts disabled. Called at the start of audio_process.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void stack_monitor_enter(void)
+{
+	const uint32_t sp = __get_MSP();
+	const uint32_t depth = (uint32_t)((uintptr_t)top - sp);
+	if (depth > preempted)
+	{
+		preempted = depth;
+	}
+	if (++blocks < STACK_PROBE_BLOCKS)
+	{
+		return;
+	}
+	blocks = 0;
+
+	__disable_irq();
+	uint32_t *written = scan();
+	if (written < lowest)
+	{
+		lowest = written;
+	}
+	paint((uint32_t *)sp);
+	__enable_irq();
+	probe_sp = sp;
+}
+
+// end of audio_process: on a probe block, the deepest word written since stack_monitor_enter painted the stack
+#pragma optimize_for_speed
+ITCM_CODE void stack_monitor_leave(void)
+{
+	if (probe_sp == 0)
+	{
+		return;
+	}
+	uint32_t *written = scan();
+	const uint32_t depth = (uint32_t)(probe_sp - (uintptr_t)written);
+	if (depth > audio)
+	{
+		audio = depth;
+	}
+	if (written < lowest)
+	{
+		lowest = written;
+	}
+	probe_sp = 0;
+}
+#endif
+
+/******************************************************************************
+* Function Name: stack_monitor_process
+*******************************************************************************
+* Summary:
+*  Scan the main stack for its high water mark every STACK_REPORT_MS. Call from the main loop,
+*  the scan reads up to _Min_Stack_Size bytes.
+*
+* Parameters:
+*  1. uint32_t now					- HAL_GetTick.
+* Return:
+*  1 if the marks were updated and a report is due, 0 otherwise.
+*
+******************************************************************************/
+bool stack_monitor_process(uint32_t now)
+{
+	if ((now - last_report) < STACK_REPORT_MS)
+	{
+		return 0;
+	}
+	last_report = now;
+
+	// a probe of the audio interrupt can paint in between, it folds the marks before
+	uint32_t *written = scan();
+	__disable_irq();
+	if (written < lowest)
+	{
+		lowest = written;
+	}
+	__enable_irq();
+	return 1;
+}
+
+/******************************************************************************
+* Function Name: stack_monitor_get
+*******************************************************************************
+* Summary:
+*  High water marks of every stack as of the last stack_monitor_process. Call from the main
+*  loop.
+*
+* Parameters:
+*  1. stack_stats_t *stats			- Filled with the marks and the sizes.
+* Return:
+*  None.
+*
+******************************************************************************/
+void stack_monitor_get(stack_stats_t *stats)
+{
+	for (uint8_t c = 0; c < STACK_CONTEXTS; ++c)
+	{
+		stats->used[c] = 0;
+		stats->size[c] = 0;
+	}
+	const uint32_t size = (uint32_t)((uintptr_t)top - (uintptr_t)bottom);
+	__disable_irq();
+	stats->used[STACK_MSP] = (uint32_t)((uintptr_t)top - (uintptr_t)lowest);
+	// the last painted word was written: the stack went deeper than it was painted
+	stats->overflowed = (lowest == bottom);
+#if !defined(RTOS)
+	stats->used[STACK_AUDIO] = audio;
+	stats->used[STACK_PREEMPTED] = preempted;
+#endif
+	__enable_irq();
+	stats->size[STACK_MSP] = size;
+#if defined(RTOS)
+	stats->used[STACK_AUDIO] = rtos_stack_used(RTOS_TASK_AUDIO, &stats->size[STACK_AUDIO]);
+	stats->used[STACK_CONTROL] = rtos_stack_used(RTOS_TASK_CONTROL, &stats->size[STACK_CONTROL]);
+	stats->used[STACK_UI] = rtos_stack_used(RTOS_TASK_UI, &stats->size[STACK_UI]);
+#else
+	stats->size[STACK_AUDIO] = size;
+	stats->size[STACK_PREEMPTED] = size;
+#endif
+	stats->used[STACK_SCRATCH] = scratch_pool_high_water();
+	stats->size[STACK_SCRATCH] = SCRATCH_POOL_SIZE;
+}
+
+/******************************************************************************
+* Function Name: stack_monitor_report
+*******************************************************************************
+* Summary:
+*  Print the high water marks over SWO in one line: used/size in bytes of every stack the build
+*  has, "overflow" once the main stack went deeper than _Min_Stack_Size. Call from the main
+*  loop after stack_monitor_process returned 1, printing isn't real time safe.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void stack_monitor_report(void)
+{
+	static const char *names[STACK_CONTEXTS] = { "msp", "audio", "preempted", "control", "ui", "scratch" };
+	char line[128];
+	stack_stats_t stats;
+	stack_monitor_get(&stats);
+
+	int pos = snprintf(line, sizeof(line), "stack");
+	for (uint8_t c = 0; (c < STACK_CONTEXTS) && (pos < (int)sizeof(line)); ++c)
+	{
+		if (stats.size[c] == 0)
+			continue;
+		pos += snprintf(&line[pos], sizeof(line) - pos, " %s %lu/%lu", names[c], (unsigned long)stats.used[c],
+			(unsigned long)stats.size[c]);
+	}
+	if (pos < (int)sizeof(line))
+	{
+		snprintf(&line[pos], sizeof(line) - pos, "%s\r\n", (stats.overflowed) ? " overflow" : "");
+	}
+
+	// ITM stimulus port 0, returns immediately if no debugger enabled the ITM
+	for (const char *c = line; *c; ++c)
+	{
+		ITM_SendChar(*c);
+	}
+}
+
+#endif // STACK_MONITOR
@@ -0,0 +1,70 @@
+// stack_monitor.h, Michael Haselberger
+// Description: This file contains declarations for the stack high water marks implemented in stack_monitor.c
+
+#ifndef __STACK_MONITOR_H__
+#define __STACK_MONITOR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+
+// fill word of the painted stack, the one FreeRTOS fills the task stacks with (tskSTACK_FILL_BYTE)
+#define STACK_PAINT (0xA5A5A5A5UL)
+// the audio interrupt measures its own use of the stack once every STACK_PROBE_BLOCKS blocks: the part of the stack
+// below it is scanned and painted again with the interrupts disabled, a few us
+#define STACK_PROBE_BLOCKS (1024)
+// SWO report of the high water marks
+#define STACK_REPORT_MS (1000)
+
+// stacks and the contexts on them
+typedef enum
+{
+	STACK_MSP = 0,		// main stack as a whole: the main loop and every interrupt (with RTOS: the interrupts only)
+	STACK_AUDIO,		// audio_process with the DMA interrupts nested in it (with RTOS: the audio task)
+	STACK_PREEMPTED,	// what was on the main stack when the audio interrupt came: the main loop, the interrupts below
+						// PendSV and the exception frame. sampled every block, no RTOS only
+	STACK_CONTROL,		// RTOS only: the control task
+	STACK_UI,			// RTOS only: the UI task
+	STACK_SCRATCH,		// scratch pool of the kernels (scratch_pool.h), in DTCM. a mark above the size counts the
+						// blocks that didn't fit
+	STACK_CONTEXTS
+} stack_context;
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   High water marks of the stacks since boot.
+*
+*   Members:
+*   used:               Most bytes a context took, 0 if the build doesn't have it.
+*   size:               Bytes of its stack: _Min_Stack_Size of the linker script for the contexts on the main stack,
+*                       the task stack with RTOS.
+*   overflowed:         The main stack went below _Min_Stack_Size (the last painted word was overwritten).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	uint32_t used[STACK_CONTEXTS];
+	uint32_t size[STACK_CONTEXTS];
+	bool overflowed;
+} stack_stats_t;
+
+void stack_monitor_init(void);
+#if defined(RTOS)
+// the audio task has a stack of its own, the kernel keeps its high water mark
+#define stack_monitor_enter() ((void)0)
+#define stack_monitor_leave() ((void)0)
+#else
+void stack_monitor_enter(void);
+void stack_monitor_leave(void);
+#endif
+bool stack_monitor_process(uint32_t now);
+void stack_monitor_get(stack_stats_t *stats);
+void stack_monitor_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __STACK_MONITOR_H__
@@ -0,0 +1,209 @@
+// stft.c, Michael Haselberger
+// Description: Short-time Fourier transform engine of the spectral effects. Windowed frames are transformed with
+// arm_rfft_fast_f32, changed in the frequency domain by a callback and added back together (weighted overlap-add).
+
+#include <string.h>
+#include "stft.h"
+
+// one FFT instance for all frames. its twiddle and bit reversal tables stay in flash (read in order, the cache and the
+// flash prefetch keep up), DTCM has no room left for them
+static arm_rfft_fast_instance_f32 fft;
+// periodic Hann window and its square root, in AXI SRAM: read once per frame, in order
+static float32_t hann[STFT_FFT_SIZE];
+static float32_t sqrt_hann[STFT_FFT_SIZE];
+// the frame being transformed and its spectrum. frames are computed one after the other, the instances share them
+static float32_t __attribute__((aligned(32))) frame[STFT_FFT_SIZE] DTCM_BSS;
+static float32_t __attribute__((aligned(32))) spectrum[STFT_FFT_SIZE] DTCM_BSS;
+static bool tables_ready = false;
+
+// FFT instance and the windows, once for all instances
+static uint8_t init_tables(void)
+{
+	if (tables_ready)
+	{
+		return 0;
+	}
+	if (arm_rfft_fast_init_f32(&fft, STFT_FFT_SIZE) != ARM_MATH_SUCCESS)
+	{
+		return 254;
+	}
+
+	for (uint32_t i = 0; i < STFT_FFT_SIZE; ++i)
+	{
+		hann[i] = 0.5f - 0.5f * cosf(2.0f * PI * (float32_t)i / STFT_FFT_SIZE);
+		sqrt_hann[i] = sqrtf(hann[i]);
+	}
+	tables_ready = true;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: stft_init
+*******************************************************************************
+* Summary:
+*  Initialize an STFT instance without memory, stft_process passes silence until stft_attach
+*  gave it its buffers. The first call sets up the shared FFT tables and windows.
+*
+* Parameters:
+*  1. stft_t *stft					- Address pointer of the STFT struct.
+*  2. stft_window window			- Window pair.
+*  3. uint32_t hop					- Samples between two frames: STFT_HOP_HALF or STFT_HOP_QUARTER.
+*  4. uint8_t slot					- Frame slot. Range: 0 <= slot < STFT_SLOTS.
+*  5. stft_callback process			- Called with the spectrum of every frame.
+*  6. void *ctx						- Passed to process.
+* Return:
+*  255:								- STFT or callback point to NULL.
+*  254:								- Unknown window, hop or slot, or the FFT size is not supported by CMSIS.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t stft_init(stft_t *stft, stft_window window, uint32_t hop, uint8_t slot, stft_callback process, void *ctx)
+{
+	if ((stft == NULL) || (process == NULL))
+	{
+		return 255;
+	}
+	if (((window != STFT_WINDOW_SQRT_HANN) && (window != STFT_WINDOW_HANN)) ||
+		((hop != STFT_HOP_HALF) && (hop != STFT_HOP_QUARTER)) || (slot >= STFT_SLOTS) || init_tables())
+	{
+		return 254;
+	}
+
+	stft->process = process;
+	stft->ctx = ctx;
+	stft->input = NULL;
+	stft->overlap = NULL;
+	stft->output = NULL;
+	stft->window = window;
+	stft->hop_min = hop;
+	stft->hop = hop;
+	stft->slot = slot;
+	stft_reset(stft);
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: stft_attach
+*******************************************************************************
+* Summary:
+*  Give the instance its buffers and clear them. Call while the instance isn't processed.
+*
+* Parameters:
+*  1. stft_t *stft					- Address pointer of an initialized STFT struct.
+*  2. float32_t *memory				- STFT_MEMORY_SIZE bytes.
+* Return:
+*  255:								- Memory points to NULL.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t stft_attach(stft_t *stft, float32_t *memory)
+{
+	if (memory == NULL)
+	{
+		return 255;
+	}
+	stft->input = memory;
+	stft->overlap = memory + STFT_FFT_SIZE;
+	stft->output = memory + 2 * STFT_FFT_SIZE;
+	stft_reset(stft);
+	return 0;
+}
+
+// take the buffers away again, returns them for arena_free. the instance passes silence afterwards
+float32_t *stft_detach(stft_t *stft)
+{
+	float32_t *memory = stft->input;
+	stft->input = NULL;
+	stft->overlap = NULL;
+	stft->output = NULL;
+	return memory;
+}
+
+// clear the frames and start the framing over with the next block
+void stft_reset(stft_t *stft)
+{
+	if (stft->input != NULL)
+	{
+		memset(stft->input, 0, STFT_MEMORY_SIZE);
+	}
+	stft->fill = 0;
+	stft->block_size = 0;
+}
+
+// samples the output lags the input, the same for every hop and block size
+uint32_t stft_latency(const stft_t *stft)
+{
+	(void)stft;
+	return STFT_FFT_SIZE;
+}
+
+// window, transform, callback, inverse transform, window and overlap-add of the frame in the input buffer
+#pragma optimize_for_speed
+ITCM_CODE static void stft_frame(stft_t *stft)
+{
+	const uint32_t hop = stft->hop;
+	// the windows overlap N / (2 * hop) times: the sum of the products is constant
+	const float32_t scale = (2.0f * hop) / STFT_FFT_SIZE;
+
+	arm_mult_f32(stft->input, (stft->window == STFT_WINDOW_SQRT_HANN) ? sqrt_hann : hann, frame, STFT_FFT_SIZE);
+	arm_rfft_fast_f32(&fft, frame, spectrum, 0);
+	stft->process(stft->ctx, spectrum);
+	arm_rfft_fast_f32(&fft, spectrum, frame, 1);
+	if (stft->window == STFT_WINDOW_SQRT_HANN)
+	{
+		arm_mult_f32(frame, sqrt_hann, frame, STFT_FFT_SIZE);
+	}
+	arm_scale_f32(frame, scale, frame, STFT_FFT_SIZE);
+	arm_add_f32(stft->overlap, frame, stft->overlap, STFT_FFT_SIZE);
+
+	// the oldest hop is complete, the frames move on by one hop
+	memcpy(stft->output, stft->overlap, hop * sizeof(float32_t));
+	memmove(stft->overlap, &stft->overlap[hop], (STFT_FFT_SIZE - hop) * sizeof(float32_t));
+	memset(&stft->overlap[STFT_FFT_SIZE - hop], 0, hop * sizeof(float32_t));
+	memmove(stft->input, &stft->input[hop], (STFT_FFT_SIZE - hop) * sizeof(float32_t));
+}
+
+/******************************************************************************
+* Function Name: stft_process
+*******************************************************************************
+* Summary:
+*  Run one block through the STFT: the block is appended to the current hop and the same
+*  span of the output hop is read. A block that completes the hop computes one frame. A new
+*  block size restarts the framing (silence for one frame length). src and dst may be the same.
+*
+* Parameters:
+*  1. stft_t *stft					- Address pointer of an initialized STFT struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block.
+*  4. uint32_t block_size			- Number of samples, a power of two up to MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void stft_process(stft_t *stft, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	if (stft->input == NULL)
+	{
+		arm_fill_f32(0.0f, dst, block_size);
+		return;
+	}
+	if (block_size != stft->block_size)
+	{
+		stft_reset(stft);
+		stft->block_size = block_size;
+		stft->hop = (stft->hop_min > block_size) ? stft->hop_min : block_size;
+		// the first frame of the slot is due after (hop / block size - slot) blocks
+		stft->fill = ((uint32_t)stft->slot * block_size) % stft->hop;
+	}
+
+	const uint32_t fill = stft->fill;
+	memcpy(&stft->input[STFT_FFT_SIZE - stft->hop + fill], src, block_size * sizeof(float32_t));
+	memcpy(dst, &stft->output[fill], block_size * sizeof(float32_t));
+	stft->fill = fill + block_size;
+	if (stft->fill == stft->hop)
+	{
+		stft_frame(stft);
+		stft->fill = 0;
+	}
+}
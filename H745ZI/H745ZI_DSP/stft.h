@@ -0,0 +1,89 @@
+// stft.h, Michael Haselberger
+// Description: This file contains declarations for the short-time Fourier transform engine implemented in stft.c
+
+#ifndef __STFT_H__
+#define __STFT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// frame length of the analysis. 512 samples = 10.7 ms at 48 kHz, 94 Hz per bin
+#define STFT_FFT_SIZE (512)
+// complex bins of a spectrum, bin 0 holds DC and Nyquist (packed format of arm_rfft_fast_f32)
+#define STFT_BINS (STFT_FFT_SIZE / 2)
+// hops between two frames: half or a quarter of the frame
+#define STFT_HOP_HALF (STFT_FFT_SIZE / 2)
+#define STFT_HOP_QUARTER (STFT_FFT_SIZE / 4)
+// frames of instances with different slots are computed in different blocks, as long as the hop spans enough blocks
+#define STFT_SLOTS (4)
+// memory of one instance (taken from the caller, e.g. an arena): input frame, overlap-add sums and the output hop
+#define STFT_MEMORY_SIZE ((2 * STFT_FFT_SIZE + STFT_HOP_HALF) * sizeof(float32_t))
+
+_Static_assert(MAX_BLOCK_SIZE <= STFT_HOP_HALF, "a block has to fit into one hop of the STFT");
+
+typedef enum
+{
+	STFT_WINDOW_SQRT_HANN = 0,	// square root of Hann for analysis and synthesis: the spectrum can be changed freely
+	STFT_WINDOW_HANN			// Hann analysis, rectangular synthesis: sharper analysis, for gains close to 1
+} stft_window;
+
+// called once per frame with the spectrum of the windowed frame (STFT_BINS complex bins), changed in place. ctx is the
+// effect handle
+typedef void (*stft_callback)(void *ctx, float32_t *spectrum);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Short-time Fourier transform with weighted overlap-add, the frame work of the spectral effects.
+*   The input is collected into a frame of STFT_FFT_SIZE samples. After every hop the frame is windowed and transformed,
+*   the callback changes the spectrum, and the inverse transform is windowed again and added to the output of the
+*   frames before. The windows add up to 1 over the overlapping frames, so an unchanged spectrum gives the input back,
+*   delayed by STFT_FFT_SIZE samples. FFT instance, windows and the frame scratch are shared by all instances. The
+*   frame and its spectrum live in DTCM, the windows in AXI SRAM and the FFT tables in flash.
+*   A hop is a whole number of blocks (a shorter hop is raised to the block size), so a block never completes more than
+*   one frame. The slot shifts the frame boundaries by whole blocks: the instances of the channels and effects don't
+*   all transform in the same block.
+*
+*   Members:
+*   process:            Spectrum callback.
+*   ctx:                Passed to process.
+*   input:              The last STFT_FFT_SIZE input samples, the newest hop at the end. Caller provided.
+*   overlap:            Overlap-add sums of the frames, the next hop to be output at the start. Caller provided.
+*   output:             Hop being output. Caller provided.
+*   window:             Window pair.
+*   hop_min:            Hop asked for at init.
+*   hop:                Hop in use: hop_min or the block size, whichever is longer.
+*   fill:               Samples of the current hop already collected.
+*   block_size:         Block size the hop was set for, 0 = the framing starts with the next block.
+*   slot:               Frame slot (0 to STFT_SLOTS - 1).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	stft_callback process;
+	void *ctx;
+	float32_t *input;
+	float32_t *overlap;
+	float32_t *output;
+	stft_window window;
+	uint32_t hop_min;
+	uint32_t hop;
+	uint32_t fill;
+	uint32_t block_size;
+	uint8_t slot;
+} stft_t;
+
+uint8_t stft_init(stft_t *stft, stft_window window, uint32_t hop, uint8_t slot, stft_callback process, void *ctx);
+uint8_t stft_attach(stft_t *stft, float32_t *memory);
+float32_t *stft_detach(stft_t *stft);
+void stft_reset(stft_t *stft);
+void stft_process(stft_t *stft, const float32_t *src, float32_t *dst, uint32_t block_size);
+uint32_t stft_latency(const stft_t *stft);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __STFT_H__
@@ -0,0 +1,221 @@
+// telemetry.c, Michael Haselberger
+// Description: Level meter and spectrum of the chain output for diagnosis without a debugger. The audio path only copies
+// one block now and then into a side buffer (telemetry_tap). RMS, peak and a 32 band spectrum are computed in the main
+// loop (telemetry_process) and shown on the "Meter" page or streamed over SWO (telemetry_report).
+
+#include <stdio.h>
+#include "stm32h7xx_hal.h"
+#include "telemetry.h"
+
+#if defined(TELEMETRY)
+
+// copy of the tapped block. written by the audio path while pending is clear, read by the main loop while it is set
+static sample_t tap[MAX_BLOCK_SIZE];
+static volatile uint32_t tap_length = 0;
+static volatile uint8_t pending = 0;
+// samples since the last copy, audio path only
+static uint32_t elapsed = 0;
+
+static float32_t __attribute__((aligned(32))) scratch[TELEMETRY_FFT_SIZE];
+static float32_t __attribute__((aligned(32))) spectrum[TELEMETRY_FFT_SIZE];
+static arm_rfft_fast_instance_f32 fft;
+// first bin of every band, edges[TELEMETRY_BANDS] is the end of the last band. up to TELEMETRY_FFT_SIZE / 2, which
+// outgrows a byte from a MAX_BLOCK_SIZE of 512 on
+static uint16_t edges[TELEMETRY_BANDS + 1];
+
+static telemetry_t levels;
+
+static float32_t to_db(float32_t value)
+{
+	return (value > 0.0f) ? fmaxf(20.0f * log10f(value), TELEMETRY_FLOOR_DB) : TELEMETRY_FLOOR_DB;
+}
+
+/******************************************************************************
+* Function Name: telemetry_init
+*******************************************************************************
+* Summary:
+*  Initialize the FFT and the band edges. The bands are spaced logarithmically, the lowest
+*  ones get one bin each.
+*
+* Parameters:
+*  None.
+* Return:
+*  255:								- The FFT size is not supported by CMSIS-DSP.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t telemetry_init(void)
+{
+	if (arm_rfft_fast_init_f32(&fft, TELEMETRY_FFT_SIZE) != ARM_MATH_SUCCESS)
+	{
+		return 255;
+	}
+
+	// bins 1 to TELEMETRY_FFT_SIZE / 2 - 1 (the DC and Nyquist bins are left out)
+	const float32_t bins = (float32_t)(TELEMETRY_FFT_SIZE / 2);
+	edges[0] = 1;
+	for (uint8_t b = 1; b <= TELEMETRY_BANDS; ++b)
+	{
+		uint32_t edge = (uint32_t)roundf(powf(bins, (float32_t)b / TELEMETRY_BANDS));
+		if (edge <= edges[b - 1])
+			edge = edges[b - 1] + 1;
+		edges[b] = (edge > TELEMETRY_FFT_SIZE / 2) ? (TELEMETRY_FFT_SIZE / 2) : edge;
+	}
+	edges[TELEMETRY_BANDS] = TELEMETRY_FFT_SIZE / 2;
+
+	levels.rms = TELEMETRY_FLOOR_DB;
+	levels.peak = TELEMETRY_FLOOR_DB;
+	for (uint8_t b = 0; b < TELEMETRY_BANDS; ++b)
+	{
+		levels.band[b] = TELEMETRY_FLOOR_DB;
+	}
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: telemetry_tap
+*******************************************************************************
+* Summary:
+*  Copy one block every TELEMETRY_INTERVAL_MS into the side buffer. In between, and while
+*  the main loop hasn't analyzed the last copy yet, only the sample counter is updated. Call
+*  from the audio path.
+*
+* Parameters:
+*  1. const sample_t *src			- Block to observe, e.g. the output of the chain.
+*  2. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void telemetry_tap(const sample_t *src, uint32_t block_size)
+{
+	elapsed += block_size;
+	if ((elapsed < (sample_rate * TELEMETRY_INTERVAL_MS) / 1000) || pending)
+	{
+		return;
+	}
+	elapsed = 0;
+#if defined(SAMPLE_Q31)
+	arm_copy_q31(src, tap, block_size);
+#else
+	arm_copy_f32(src, tap, block_size);
+#endif
+	tap_length = block_size;
+	pending = 1;
+}
+
+/******************************************************************************
+* Function Name: telemetry_process
+*******************************************************************************
+* Summary:
+*  Analyze the last copied block, if there is one: RMS and peak level, then the magnitude
+*  spectrum of the Hann windowed block (zero padded to TELEMETRY_FFT_SIZE). A band shows its
+*  strongest bin. Call from the main loop.
+*
+* Parameters:
+*  None.
+* Return:
+*  1:								- New levels are available (see telemetry_get).
+*  0:								- No block was copied.
+*
+******************************************************************************/
+uint8_t telemetry_process(void)
+{
+	if (!pending)
+	{
+		return 0;
+	}
+
+	const uint32_t n = tap_length;
+#if defined(SAMPLE_Q31)
+	arm_q31_to_float(tap, scratch, n);
+#else
+	arm_copy_f32(tap, scratch, n);
+#endif
+	pending = 0;
+
+	float32_t rms, max, min;
+	uint32_t index;
+	arm_rms_f32(scratch, n, &rms);
+	arm_max_f32(scratch, n, &max, &index);
+	arm_min_f32(scratch, n, &min, &index);
+	levels.rms = to_db(rms);
+	levels.peak = to_db(fmaxf(max, -min));
+
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		scratch[i] *= 0.5f - 0.5f * arm_cos_f32(2.0f * PI * i / (n - 1));
+	}
+	for (uint32_t i = n; i < TELEMETRY_FFT_SIZE; ++i)
+	{
+		scratch[i] = 0.0f;
+	}
+	arm_rfft_fast_f32(&fft, scratch, spectrum, 0);
+	// magnitudes of bins 0 to FFT_SIZE / 2 - 1 into scratch. bin 0 is the packed DC/Nyquist pair and isn't used
+	arm_cmplx_mag_f32(spectrum, scratch, TELEMETRY_FFT_SIZE / 2);
+
+	// the Hann window halves the amplitude of a sine: a full scale sine has a magnitude of n / 4
+	const float32_t scale = 4.0f / n;
+	for (uint8_t b = 0; b < TELEMETRY_BANDS; ++b)
+	{
+		float32_t peak = 0.0f;
+		for (uint32_t k = edges[b]; k < edges[b + 1]; ++k)
+		{
+			peak = fmaxf(peak, scratch[k]);
+		}
+		levels.band[b] = to_db(peak * scale);
+	}
+	levels.sequence++;
+
+	return 1;
+}
+
+const telemetry_t* telemetry_get(void)
+{
+	return &levels;
+}
+
+// latency of the chain the levels are reported with. main loop
+void telemetry_set_latency(uint32_t samples)
+{
+	levels.latency = samples;
+}
+
+/******************************************************************************
+* Function Name: telemetry_report
+*******************************************************************************
+* Summary:
+*  Print the last levels over SWO in one line: latency in samples, RMS, peak and every band in
+*  whole dB, lowest band first. Call from the main loop after telemetry_process returned 1, printing isn't real
+*  time safe.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void telemetry_report(void)
+{
+	char line[48 + 5 * TELEMETRY_BANDS];
+
+	int pos = snprintf(line, sizeof(line), "meter latency %lu rms %d peak %d bands", (unsigned long)levels.latency,
+		(int)levels.rms, (int)levels.peak);
+	for (uint8_t b = 0; (b < TELEMETRY_BANDS) && (pos < (int)sizeof(line)); ++b)
+	{
+		pos += snprintf(&line[pos], sizeof(line) - pos, " %d", (int)levels.band[b]);
+	}
+	if (pos < (int)sizeof(line))
+	{
+		snprintf(&line[pos], sizeof(line) - pos, "\r\n");
+	}
+
+	// ITM stimulus port 0, returns immediately if no debugger enabled the ITM
+	for (const char *c = line; *c; ++c)
+	{
+		ITM_SendChar(*c);
+	}
+}
+
+#endif // TELEMETRY
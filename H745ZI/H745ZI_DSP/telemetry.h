@@ -0,0 +1,54 @@
+// telemetry.h, Michael Haselberger
+// Description: This file contains declarations for the level meter and spectrum telemetry implemented in telemetry.c
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// one block is copied every TELEMETRY_INTERVAL_MS at the running sample rate, whatever the block size
+#define TELEMETRY_INTERVAL_MS (100)
+// FFT of the copied block, zero padded for blocks below MAX_BLOCK_SIZE. 187.5 Hz per bin
+#define TELEMETRY_FFT_SIZE (MAX_BLOCK_SIZE)
+// bands of the spectrum, spaced logarithmically from the first bin to Fs / 2 (at least one bin each)
+#define TELEMETRY_BANDS (32)
+// floor of all levels in dB (silence)
+#define TELEMETRY_FLOOR_DB (-90.0f)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Levels of the last copied block, written by telemetry_process.
+*
+*   Members:
+*   rms:                RMS level in dBFS.
+*   peak:               Peak level in dBFS.
+*   band:               Level of every band in dBFS (a full scale sine in a band reads 0 dB).
+*   latency:            Input to output latency in samples without the converters (telemetry_set_latency).
+*   sequence:           Incremented with every analysis.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t rms;
+	float32_t peak;
+	float32_t band[TELEMETRY_BANDS];
+	uint32_t latency;
+	uint32_t sequence;
+} telemetry_t;
+
+uint8_t telemetry_init(void);
+void telemetry_tap(const sample_t *src, uint32_t block_size);
+uint8_t telemetry_process(void);
+const telemetry_t* telemetry_get(void);
+void telemetry_set_latency(uint32_t samples);
+void telemetry_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __TELEMETRY_H__
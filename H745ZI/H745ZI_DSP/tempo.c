@@ -0,0 +1,216 @@
+// tempo.c, Michael Haselberger
+// Description: Global tempo clock for the tempo synced effects. The tempo is set by tapping the encoder button (tap
+// tempo) or by an incoming MIDI clock. Delay times and LFO rates are derived from it as note values, instead of free
+// running values set from the menu.
+
+#include "tempo.h"
+
+// beats of a quarter note per note value (quarter = 1)
+static const float32_t division_beats[TEMPO_DIVISIONS] = { 0.0f, 4.0f, 2.0f, 1.5f, 1.0f, 0.75f, 0.5f, 1.0f / 3.0f, 0.25f };
+static const char *const division_names[TEMPO_DIVISIONS] = { "Off", "1/1", "1/2", "1/4.", "1/4", "1/8.", "1/8", "1/8T", "1/16" };
+
+// written by the main loop (taps) and the MIDI receive interrupt (clock), the last one wins
+static volatile float32_t bpm = TEMPO_DEFAULT_BPM;
+// incremented with every change, so the user of the tempo only updates the effects when needed
+static volatile uint32_t version = 0;
+
+// tap tempo
+static bool tapping = false;
+static uint32_t last_tap;
+static uint32_t intervals[TEMPO_TAP_INTERVALS];
+static uint8_t interval_count = 0;
+static uint8_t interval_index = 0;
+
+// MIDI clock
+static uint32_t pulses = 0;
+static uint32_t beat_start;
+static uint32_t last_pulse;
+
+// take over a new tempo. changes below 0.1 BPM are measurement jitter and keep the effects as they are
+static void set_bpm(float32_t value)
+{
+	if (value < TEMPO_MIN_BPM)
+		value = TEMPO_MIN_BPM;
+	else if (value > TEMPO_MAX_BPM)
+		value = TEMPO_MAX_BPM;
+
+	if (fabsf(value - bpm) >= 0.1f)
+	{
+		bpm = value;
+		version++;
+	}
+}
+
+/******************************************************************************
+* Function Name: tempo_init
+*******************************************************************************
+* Summary:
+*  Set the tempo and forget all taps and MIDI clock pulses.
+*
+* Parameters:
+*  1. float32_t value				- Tempo in BPM. Clamped to TEMPO_MIN_BPM ... TEMPO_MAX_BPM.
+* Return:
+*  None.
+*
+******************************************************************************/
+void tempo_init(float32_t value)
+{
+	tapping = false;
+	pulses = 0;
+	set_bpm(value);
+	version++;
+}
+
+/******************************************************************************
+* Function Name: tempo_tap
+*******************************************************************************
+* Summary:
+*  Register a tap. The tempo is the average of the last TEMPO_TAP_INTERVALS intervals, so it
+*  follows from the second tap on and steadies with every further tap. A pause longer than
+*  TEMPO_TAP_TIMEOUT_MS starts over, taps closer than TEMPO_TAP_MIN_MS are bounce and ignored.
+*
+* Parameters:
+*  1. uint32_t tick_ms				- Time of the tap (HAL_GetTick, taken when the button was pressed).
+* Return:
+*  None.
+*
+******************************************************************************/
+void tempo_tap(uint32_t tick_ms)
+{
+	const uint32_t interval = tick_ms - last_tap;
+	if (tapping && (interval < TEMPO_TAP_MIN_MS))
+	{
+		return;
+	}
+	last_tap = tick_ms;
+
+	// the first tap (or the first after a pause) only starts the measurement
+	if (!tapping || (interval > TEMPO_TAP_TIMEOUT_MS))
+	{
+		tapping = true;
+		interval_count = 0;
+		interval_index = 0;
+		return;
+	}
+
+	intervals[interval_index] = interval;
+	interval_index = (interval_index + 1) % TEMPO_TAP_INTERVALS;
+	if (interval_count < TEMPO_TAP_INTERVALS)
+		interval_count++;
+
+	uint32_t sum = 0;
+	for (uint8_t i = 0; i < interval_count; ++i)
+	{
+		sum += intervals[i];
+	}
+	set_bpm(60000.0f * interval_count / sum);
+}
+
+/******************************************************************************
+* Function Name: tempo_midi_clock
+*******************************************************************************
+* Summary:
+*  Register a MIDI timing clock message (0xF8), e.g. from the MIDI receive interrupt. The tempo
+*  is measured over a whole quarter note (TEMPO_MIDI_PPQN pulses), which averages the jitter of
+*  the millisecond tick over 24 pulses. A gap longer than TEMPO_TAP_TIMEOUT_MS restarts the
+*  measurement (clock stopped).
+*
+* Parameters:
+*  1. uint32_t tick_ms				- Time the message was received (HAL_GetTick).
+* Return:
+*  None.
+*
+******************************************************************************/
+void tempo_midi_clock(uint32_t tick_ms)
+{
+	if ((pulses != 0) && ((tick_ms - last_pulse) > TEMPO_TAP_TIMEOUT_MS))
+	{
+		pulses = 0;
+	}
+	last_pulse = tick_ms;
+
+	if (pulses == 0)
+	{
+		beat_start = tick_ms;
+	}
+	else if (pulses == TEMPO_MIDI_PPQN)
+	{
+		if (tick_ms != beat_start)
+			set_bpm(60000.0f / (tick_ms - beat_start));
+		beat_start = tick_ms;
+		pulses = 0;
+	}
+	pulses++;
+}
+
+/******************************************************************************
+* Function Name: tempo_midi_start
+*******************************************************************************
+* Summary:
+*  Register a MIDI start or continue message (0xFA, 0xFB): the next clock pulse starts a beat.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void tempo_midi_start(void)
+{
+	pulses = 0;
+}
+
+float32_t tempo_bpm(void)
+{
+	return bpm;
+}
+
+uint32_t tempo_version(void)
+{
+	return version;
+}
+
+/******************************************************************************
+* Function Name: tempo_division_ms
+*******************************************************************************
+* Summary:
+*  Get the length of a note value at the current tempo.
+*
+* Parameters:
+*  1. tempo_division division		- Note value.
+* Return:
+*  Length in ms, 0 for TEMPO_FREE.
+*
+******************************************************************************/
+float32_t tempo_division_ms(tempo_division division)
+{
+	return (division < TEMPO_DIVISIONS) ? division_beats[division] * 60000.0f / bpm : 0.0f;
+}
+
+/******************************************************************************
+* Function Name: tempo_division_hz
+*******************************************************************************
+* Summary:
+*  Get the rate of an LFO with one period per note value at the current tempo.
+*
+* Parameters:
+*  1. tempo_division division		- Note value.
+* Return:
+*  Rate in Hz, 0 for TEMPO_FREE.
+*
+******************************************************************************/
+float32_t tempo_division_hz(tempo_division division)
+{
+	return ((division > TEMPO_FREE) && (division < TEMPO_DIVISIONS)) ? bpm / (60.0f * division_beats[division]) : 0.0f;
+}
+
+// menu value (0 to 100) to note value, in equal windows like the ring modulator type
+tempo_division tempo_division_from_value(uint8_t value)
+{
+	return (value > 100) ? TEMPO_FREE : (tempo_division)(((uint32_t)value * TEMPO_DIVISIONS) / 101);
+}
+
+const char *tempo_division_name(tempo_division division)
+{
+	return (division < TEMPO_DIVISIONS) ? division_names[division] : "";
+}
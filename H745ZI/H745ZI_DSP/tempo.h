@@ -0,0 +1,56 @@
+// tempo.h, Michael Haselberger
+// Description: This file contains declarations for the global tempo clock implemented in tempo.c
+
+#ifndef __TEMPO_H__
+#define __TEMPO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+#define TEMPO_DEFAULT_BPM (120.0f)
+#define TEMPO_MIN_BPM (30.0f)
+#define TEMPO_MAX_BPM (300.0f)
+// a tap later than this starts a new measurement
+#define TEMPO_TAP_TIMEOUT_MS (2000)
+// taps closer than this are contact bounce of the button (faster than TEMPO_MAX_BPM)
+#define TEMPO_TAP_MIN_MS (150)
+// intervals averaged for the tap tempo
+#define TEMPO_TAP_INTERVALS (4)
+// MIDI clock: 24 pulses per quarter note
+#define TEMPO_MIDI_PPQN (24)
+
+// note values the delay time and the LFO rates snap to. FREE: not synced, the rate set in the menu is used
+typedef enum
+{
+	TEMPO_FREE = 0,
+	TEMPO_WHOLE,
+	TEMPO_HALF,
+	TEMPO_DOTTED_QUARTER,
+	TEMPO_QUARTER,
+	TEMPO_DOTTED_EIGHTH,
+	TEMPO_EIGHTH,
+	TEMPO_EIGHTH_TRIPLET,
+	TEMPO_SIXTEENTH,
+	TEMPO_DIVISIONS
+} tempo_division;
+
+void tempo_init(float32_t bpm);
+void tempo_tap(uint32_t tick_ms);
+void tempo_midi_clock(uint32_t tick_ms);
+void tempo_midi_start(void);
+float32_t tempo_bpm(void);
+uint32_t tempo_version(void);
+float32_t tempo_division_ms(tempo_division division);
+float32_t tempo_division_hz(tempo_division division);
+tempo_division tempo_division_from_value(uint8_t value);
+const char *tempo_division_name(tempo_division division);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __TEMPO_H__
@@ -0,0 +1,565 @@
+// tft.c, Michael Haselberger
+// Description: Graphical display backend (DISPLAY_TFT) for the menu core. Implements the framebuffer functions of
+// i2c_lcd.h on an SPI TFT: the characters are blended into an RGB565 frame in external RAM by the DMA2D, the regions
+// drawn since the last transfer go out through the SPI DMA while the menu carries on (see tft.h).
+
+#include "main.h"
+#include <string.h>
+
+#if defined(DISPLAY_TFT) && defined(UI_MENU_CORE)
+#include "fonts.h"
+
+SPI_HandleTypeDef hspi_tft;
+DMA_HandleTypeDef hdma_tft_tx;
+static DMA2D_HandleTypeDef hdma2d_tft;
+
+// the window in external RAM (tft.h). the M4 has no data cache, nothing to clean before the DMA2D or the SPI DMA reads
+static uint16_t *const pixels = (uint16_t *)TFT_MEMORY_BASE;
+static uint8_t *const glyphs = (uint8_t *)(TFT_MEMORY_BASE + TFT_FRAME_BYTES);
+static uint8_t *const strip = (uint8_t *)(TFT_MEMORY_BASE + ((TFT_FRAME_BYTES + TFT_GLYPH_BYTES + 31) & ~31UL));
+
+// ---- Text ----
+// the menu only writes into frame. lcd_update renders the characters that differ from shadow (what the panel shows)
+static char frame[LCD_ROWS][LCD_COLS];
+static char shadow[LCD_ROWS][LCD_COLS];
+
+// ---- Regions waiting for the transfer ----
+typedef struct
+{
+	uint16_t x;
+	uint16_t y;
+	uint16_t w;
+	uint16_t h;
+} region_t;
+static region_t regions[TFT_MAX_REGIONS];
+static uint8_t region_count = 0;
+static volatile uint8_t tx_busy = 0;
+
+// ---- Page graphics ----
+typedef enum
+{
+	TFT_WIDGET_NONE = 0,
+	TFT_WIDGET_METER,
+	TFT_WIDGET_TUNER
+} tft_widget;
+// what the page asked for with its last redraw (lcd_fb_clear resets it) and what the graphics area shows
+static tft_widget widget_requested = TFT_WIDGET_NONE;
+static tft_widget widget_shown = TFT_WIDGET_NONE;
+// spectrum bar heights in pixels
+static uint8_t bar_target[TFT_METER_BARS];
+static uint8_t bar_shown[TFT_METER_BARS];
+// left edge of the tuner needle, -1: no pitch
+static int16_t needle_target = -1;
+static int16_t needle_shown = -1;
+static uint32_t needle_color_target = TFT_COLOR_IN_TUNE;
+static uint32_t needle_color_shown = TFT_COLOR_IN_TUNE;
+#define TFT_NEEDLE_WIDTH (6)
+#define TFT_TICK_HEIGHT (8)
+// needle area of the tuner: the graphics area above the scale
+#define TFT_NEEDLE_HEIGHT (TFT_GRAPHICS_HEIGHT - TFT_TICK_HEIGHT - 4)
+
+// ---- Initialisation ----
+// ILI9341 commands with the time the panel needs before the next one. lcd_update sends them one per call once the wait
+// is over, as the HD44780 backend does, so the M4 keeps serving the reverb tail in between. the NOP (0x00) entry
+// releases the reset line instead of being sent
+#define TFT_RESET_MS (1)
+#define TFT_CMD_NOP (0x00)
+#define TFT_CMD_COLUMN (0x2A)
+#define TFT_CMD_PAGE (0x2B)
+#define TFT_CMD_MEMORY_WRITE (0x2C)
+static const struct
+{
+	uint8_t cmd;
+	uint8_t length;
+	uint8_t data[2];
+	uint8_t wait_ms;
+} init_sequence[] =
+{
+	{ TFT_CMD_NOP, 0, { 0 }, 120 },		// reset released, >120 ms until the panel takes commands
+	{ 0x11, 0, { 0 }, 120 },			// sleep out
+	{ 0x3A, 1, { 0x55 }, 0 },			// pixel format: 16 bit (RGB565)
+	{ 0x36, 1, { 0x28 }, 0 },			// memory access: row/column exchange (landscape), BGR panel
+	{ 0x29, 0, { 0 }, 0 },				// display on
+};
+#define TFT_INIT_STEPS (sizeof(init_sequence) / sizeof(init_sequence[0]))
+// next command of init_sequence, TFT_INIT_STEPS once the panel is ready. 0xFF until lcd_init
+static uint8_t init_step = 0xFF;
+static uint32_t init_tick = 0;
+static uint32_t init_wait = 0;
+
+static inline uint32_t pixel_address(uint16_t x, uint16_t y)
+{
+	return (uint32_t)&pixels[(uint32_t)y * TFT_WIDTH + x];
+}
+
+// a command with its parameters, blocking (a few bytes). chip select stays low for the pixels that may follow
+static void send_command(uint8_t cmd, const uint8_t *data, uint16_t length)
+{
+	HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_CS, GPIO_PIN_RESET);
+	HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_DC, GPIO_PIN_RESET);
+	HAL_SPI_Transmit(&hspi_tft, &cmd, 1, TFT_TIMEOUT);
+	HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_DC, GPIO_PIN_SET);
+	if (length)
+		HAL_SPI_Transmit(&hspi_tft, (uint8_t *)data, length, TFT_TIMEOUT);
+}
+
+// remember a drawn region for the transfer. merged into a region it touches, the last one grows once the list is full
+static void mark(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+	region_t *r = NULL;
+	for (uint8_t i = 0; i < region_count; ++i)
+	{
+		if ((x <= regions[i].x + regions[i].w + TFT_MERGE_GAP) && (regions[i].x <= x + w + TFT_MERGE_GAP)
+			&& (y <= regions[i].y + regions[i].h + TFT_MERGE_GAP) && (regions[i].y <= y + h + TFT_MERGE_GAP))
+		{
+			r = &regions[i];
+			break;
+		}
+	}
+	if ((r == NULL) && (region_count < TFT_MAX_REGIONS))
+	{
+		regions[region_count++] = (region_t){ x, y, w, h };
+		return;
+	}
+	if (r == NULL)
+		r = &regions[region_count - 1];
+
+	const uint16_t right = ((r->x + r->w) > (x + w)) ? (r->x + r->w) : (x + w);
+	const uint16_t bottom = ((r->y + r->h) > (y + h)) ? (r->y + r->h) : (y + h);
+	r->x = (r->x < x) ? r->x : x;
+	r->y = (r->y < y) ? r->y : y;
+	r->w = right - r->x;
+	r->h = bottom - r->y;
+}
+
+// start a DMA2D operation configured in hdma2d_tft.Init and wait for it. a few us for a character
+static void dma2d_run(uint32_t src, uint32_t dst, uint16_t w, uint16_t h)
+{
+	if ((HAL_DMA2D_Init(&hdma2d_tft) == HAL_OK) && (HAL_DMA2D_Start(&hdma2d_tft, src, dst, w, h) == HAL_OK))
+	{
+		HAL_DMA2D_PollForTransfer(&hdma2d_tft, TFT_TIMEOUT);
+	}
+}
+
+// fill a rectangle of the frame with a color (register to memory)
+static void fill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t color)
+{
+	if ((w == 0) || (h == 0))
+		return;
+
+	hdma2d_tft.Init.Mode = DMA2D_R2M;
+	hdma2d_tft.Init.OutputOffset = TFT_WIDTH - w;
+	hdma2d_tft.Init.BytesSwap = DMA2D_BYTES_REGULAR;
+	dma2d_run(color, pixel_address(x, y), w, h);
+	mark(x, y, w, h);
+}
+
+// draw one character cell: background, then the A8 glyph blended in the text color over it
+static void draw_char(uint8_t row, uint8_t col, char c)
+{
+	const uint16_t x = TFT_TEXT_X + col * TFT_GLYPH_WIDTH;
+	const uint16_t y = TFT_TEXT_Y + row * TFT_ROW_PITCH;
+	fill(x, y, TFT_GLYPH_WIDTH, TFT_GLYPH_HEIGHT, TFT_COLOR_BACKGROUND);
+	if (c == ' ')
+		return;
+	if ((c < ' ') || (c > '~'))
+		c = '?';
+
+	hdma2d_tft.Init.Mode = DMA2D_M2M_BLEND;
+	hdma2d_tft.Init.OutputOffset = TFT_WIDTH - TFT_GLYPH_WIDTH;
+	hdma2d_tft.Init.BytesSwap = DMA2D_BYTES_REGULAR;
+	// foreground: the glyph coverage with the fixed text color. background: the cell just filled
+	hdma2d_tft.LayerCfg[1].InputColorMode = DMA2D_INPUT_A8;
+	hdma2d_tft.LayerCfg[1].InputOffset = 0;
+	hdma2d_tft.LayerCfg[1].InputAlpha = TFT_COLOR_TEXT;
+	hdma2d_tft.LayerCfg[0].InputColorMode = DMA2D_INPUT_RGB565;
+	hdma2d_tft.LayerCfg[0].InputOffset = TFT_WIDTH - TFT_GLYPH_WIDTH;
+	const uint32_t cell = pixel_address(x, y);
+	if ((HAL_DMA2D_Init(&hdma2d_tft) == HAL_OK) && (HAL_DMA2D_ConfigLayer(&hdma2d_tft, 1) == HAL_OK)
+		&& (HAL_DMA2D_ConfigLayer(&hdma2d_tft, 0) == HAL_OK)
+		&& (HAL_DMA2D_BlendingStart(&hdma2d_tft, (uint32_t)&glyphs[(c - ' ') * TFT_GLYPH_WIDTH * TFT_GLYPH_HEIGHT], cell, cell,
+			TFT_GLYPH_WIDTH, TFT_GLYPH_HEIGHT) == HAL_OK))
+	{
+		HAL_DMA2D_PollForTransfer(&hdma2d_tft, TFT_TIMEOUT);
+	}
+}
+
+// expand the 1 bit font of the BSP (MSB = leftmost pixel, rows padded to bytes) into A8 cells for the DMA2D
+static void render_glyphs(void)
+{
+	const uint32_t row_bytes = (TFT_FONT.Width + 7) / 8;
+	for (uint32_t g = 0; g < TFT_GLYPHS; ++g)
+	{
+		const uint8_t *bits = &TFT_FONT.table[g * TFT_FONT.Height * row_bytes];
+		uint8_t *cell = &glyphs[g * TFT_GLYPH_WIDTH * TFT_GLYPH_HEIGHT];
+		for (uint32_t y = 0; y < TFT_GLYPH_HEIGHT; ++y)
+		{
+			for (uint32_t x = 0; x < TFT_GLYPH_WIDTH; ++x)
+			{
+				const uint8_t set = bits[y * row_bytes + x / 8] & (0x80 >> (x % 8));
+				cell[y * TFT_GLYPH_WIDTH + x] = set ? 0xFF : 0x00;
+			}
+		}
+	}
+}
+
+// the tuner scale: a tick every 10 cents below the needle area, the middle one twice as wide
+static void draw_scale(void)
+{
+	const uint16_t y = TFT_GRAPHICS_Y + TFT_GRAPHICS_HEIGHT - TFT_TICK_HEIGHT;
+	for (int8_t step = -5; step <= 5; ++step)
+	{
+		const uint16_t x = TFT_WIDTH / 2 + step * ((TFT_WIDTH / 2 - TFT_NEEDLE_WIDTH) / 5);
+		const uint16_t w = (step == 0) ? 4 : 2;
+		fill(x - w / 2, y, w, TFT_TICK_HEIGHT, TFT_COLOR_SCALE);
+	}
+}
+
+// bring the graphics area to what the page recorded (tft_meter, tft_tuner): a new page clears it, then only bars and
+// needle positions that changed are drawn
+static void render_widget(void)
+{
+	if (widget_requested != widget_shown)
+	{
+		fill(0, TFT_GRAPHICS_Y, TFT_WIDTH, TFT_GRAPHICS_HEIGHT, TFT_COLOR_BACKGROUND);
+		memset(bar_shown, 0, sizeof(bar_shown));
+		needle_shown = -1;
+		widget_shown = widget_requested;
+		if (widget_shown == TFT_WIDGET_TUNER)
+			draw_scale();
+	}
+
+	if (widget_shown == TFT_WIDGET_METER)
+	{
+		const uint16_t bottom = TFT_GRAPHICS_Y + TFT_GRAPHICS_HEIGHT;
+		for (uint8_t i = 0; i < TFT_METER_BARS; ++i)
+		{
+			const uint16_t x = i * (TFT_WIDTH / TFT_METER_BARS) + (TFT_WIDTH / TFT_METER_BARS - TFT_BAR_WIDTH) / 2;
+			const uint8_t target = bar_target[i];
+			const uint8_t shown = bar_shown[i];
+			// only the part between the old and the new height
+			if (target > shown)
+				fill(x, bottom - target, TFT_BAR_WIDTH, target - shown, TFT_COLOR_BAR);
+			else if (target < shown)
+				fill(x, bottom - shown, TFT_BAR_WIDTH, shown - target, TFT_COLOR_BACKGROUND);
+			bar_shown[i] = target;
+		}
+	}
+	else if (widget_shown == TFT_WIDGET_TUNER)
+	{
+		if ((needle_target != needle_shown) || (needle_color_target != needle_color_shown))
+		{
+			if (needle_shown >= 0)
+				fill(needle_shown, TFT_GRAPHICS_Y, TFT_NEEDLE_WIDTH, TFT_NEEDLE_HEIGHT, TFT_COLOR_BACKGROUND);
+			if (needle_target >= 0)
+				fill(needle_target, TFT_GRAPHICS_Y, TFT_NEEDLE_WIDTH, TFT_NEEDLE_HEIGHT, needle_color_target);
+			needle_shown = needle_target;
+			needle_color_shown = needle_color_target;
+		}
+	}
+}
+
+// copy the next strip of the first region into the transfer buffer in panel byte order and start its transfer
+static void send_strip(void)
+{
+	region_t *r = &regions[0];
+	const uint16_t lines = (r->h < TFT_STRIP_LINES) ? r->h : TFT_STRIP_LINES;
+
+	hdma2d_tft.Init.Mode = DMA2D_M2M_PFC;
+	hdma2d_tft.Init.OutputOffset = 0;
+	// the panel expects the high byte of a pixel first
+	hdma2d_tft.Init.BytesSwap = DMA2D_BYTES_SWAP;
+	hdma2d_tft.LayerCfg[1].InputColorMode = DMA2D_INPUT_RGB565;
+	hdma2d_tft.LayerCfg[1].InputOffset = TFT_WIDTH - r->w;
+	hdma2d_tft.LayerCfg[1].InputAlpha = 0xFF;
+	if ((HAL_DMA2D_Init(&hdma2d_tft) != HAL_OK) || (HAL_DMA2D_ConfigLayer(&hdma2d_tft, 1) != HAL_OK)
+		|| (HAL_DMA2D_Start(&hdma2d_tft, pixel_address(r->x, r->y), (uint32_t)strip, r->w, lines) != HAL_OK)
+		|| (HAL_DMA2D_PollForTransfer(&hdma2d_tft, TFT_TIMEOUT) != HAL_OK))
+	{
+		return;
+	}
+
+	const uint16_t x1 = r->x + r->w - 1;
+	const uint16_t y1 = r->y + lines - 1;
+	const uint8_t column[4] = { r->x >> 8, r->x & 0xFF, x1 >> 8, x1 & 0xFF };
+	const uint8_t page[4] = { r->y >> 8, r->y & 0xFF, y1 >> 8, y1 & 0xFF };
+	send_command(TFT_CMD_COLUMN, column, sizeof(column));
+	send_command(TFT_CMD_PAGE, page, sizeof(page));
+	send_command(TFT_CMD_MEMORY_WRITE, NULL, 0);
+
+	tx_busy = 1;
+	if (HAL_SPI_Transmit_DMA(&hspi_tft, strip, r->w * lines * 2) != HAL_OK)
+	{
+		tx_busy = 0;
+		HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_CS, GPIO_PIN_SET);
+		// the region stays, the next update tries again
+		return;
+	}
+
+	r->y += lines;
+	r->h -= lines;
+	if (r->h == 0)
+	{
+		--region_count;
+		memmove(&regions[0], &regions[1], region_count * sizeof(region_t));
+	}
+}
+
+/******************************************************************************
+* Function Name: lcd_init
+*******************************************************************************
+* Summary:
+*  Set up SPI5 with its DMA and the DMA2D, pull the reset line of the panel and render the
+*  glyphs of the font. Returns at once, the init commands follow with lcd_update. The
+*  framebuffer can be written right away, it is shown once the panel is ready.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void lcd_init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	__HAL_RCC_GPIOF_CLK_ENABLE();
+	HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_CS | TFT_PIN_DC, GPIO_PIN_SET);
+	HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_RESET, GPIO_PIN_RESET);
+	GPIO_InitStruct.Pin = TFT_PIN_CS | TFT_PIN_DC | TFT_PIN_RESET;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+	HAL_GPIO_Init(TFT_PORT, &GPIO_InitStruct);
+
+	hspi_tft.Instance = TFT_SPI;
+	hspi_tft.Init.Mode = SPI_MODE_MASTER;
+	hspi_tft.Init.Direction = SPI_DIRECTION_2LINES_TXONLY;
+	hspi_tft.Init.DataSize = SPI_DATASIZE_8BIT;
+	hspi_tft.Init.CLKPolarity = SPI_POLARITY_LOW;
+	hspi_tft.Init.CLKPhase = SPI_PHASE_1EDGE;
+	hspi_tft.Init.NSS = SPI_NSS_SOFT;
+	hspi_tft.Init.BaudRatePrescaler = TFT_SPI_PRESCALER;
+	hspi_tft.Init.FirstBit = SPI_FIRSTBIT_MSB;
+	hspi_tft.Init.TIMode = SPI_TIMODE_DISABLE;
+	hspi_tft.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+	hspi_tft.Init.NSSPMode = SPI_NSS_PULSE_DISABLE;
+	hspi_tft.Init.FifoThreshold = SPI_FIFO_THRESHOLD_01DATA;
+	// SCK and MOSI stay driven between the transfers
+	hspi_tft.Init.MasterKeepIOState = SPI_MASTER_KEEP_IO_STATE_ENABLE;
+	if (HAL_SPI_Init(&hspi_tft) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	hdma2d_tft.Instance = DMA2D;
+	hdma2d_tft.Init.ColorMode = DMA2D_OUTPUT_RGB565;
+	hdma2d_tft.Init.AlphaInverted = DMA2D_REGULAR_ALPHA;
+	hdma2d_tft.Init.RedBlueSwap = DMA2D_RB_REGULAR;
+	hdma2d_tft.Init.LineOffsetMode = DMA2D_LOM_PIXELS;
+	for (uint8_t layer = 0; layer < 2; ++layer)
+	{
+		hdma2d_tft.LayerCfg[layer].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+		hdma2d_tft.LayerCfg[layer].InputAlpha = 0xFF;
+		hdma2d_tft.LayerCfg[layer].AlphaInverted = DMA2D_REGULAR_ALPHA;
+		hdma2d_tft.LayerCfg[layer].RedBlueSwap = DMA2D_RB_REGULAR;
+		hdma2d_tft.LayerCfg[layer].ChromaSubSampling = DMA2D_NO_CSS;
+	}
+
+	render_glyphs();
+	lcd_fb_clear();
+	region_count = 0;
+	widget_shown = TFT_WIDGET_NONE;
+	init_step = 0;
+	init_tick = HAL_GetTick();
+	init_wait = TFT_RESET_MS;
+}
+
+// send the next command of the initialisation if its wait is over. returns 1 once the panel is ready
+uint8_t lcd_init_step(void)
+{
+	if (init_step >= TFT_INIT_STEPS)
+	{
+		return (init_step == TFT_INIT_STEPS) ? 1 : 0;
+	}
+	const uint32_t now = HAL_GetTick();
+	if ((now - init_tick) > init_wait)
+	{
+		if (init_sequence[init_step].cmd == TFT_CMD_NOP)
+		{
+			HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_RESET, GPIO_PIN_SET);
+		}
+		else
+		{
+			send_command(init_sequence[init_step].cmd, init_sequence[init_step].data, init_sequence[init_step].length);
+			HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_CS, GPIO_PIN_SET);
+		}
+		init_wait = init_sequence[init_step].wait_ms;
+		init_tick = now;
+		if (++init_step == TFT_INIT_STEPS)
+		{
+			// the panel RAM holds noise: the whole frame goes out once, the text is rendered into it
+			fill(0, 0, TFT_WIDTH, TFT_HEIGHT, TFT_COLOR_BACKGROUND);
+			memset(shadow, ' ', sizeof(shadow));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// fill framebuffer with spaces. the page graphics are dropped unless the page records them again
+void lcd_fb_clear(void)
+{
+	memset(frame, ' ', sizeof(frame));
+	widget_requested = TFT_WIDGET_NONE;
+}
+
+// write a string into the framebuffer. stops at the end of the string or the end of the row
+void lcd_fb_write(uint8_t row, uint8_t col, const char *str)
+{
+	if (row >= LCD_ROWS)
+		return;
+
+	while (*str && (col < LCD_COLS))
+	{
+		frame[row][col++] = *str++;
+	}
+}
+
+/******************************************************************************
+* Function Name: lcd_update
+*******************************************************************************
+* Summary:
+*  Render the characters and page graphics that changed into the frame and start the
+*  transfer of the next strip of the drawn regions. Returns without a transfer while the
+*  previous strip is still on the bus, the next call continues. During the initialisation
+*  (lcd_init) it sends the next init command instead.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void lcd_update(void)
+{
+	if (!lcd_init_step())
+		return;
+
+	for (uint8_t row = 0; row < LCD_ROWS; ++row)
+	{
+		for (uint8_t col = 0; col < LCD_COLS; ++col)
+		{
+			if (frame[row][col] != shadow[row][col])
+			{
+				draw_char(row, col, frame[row][col]);
+				shadow[row][col] = frame[row][col];
+			}
+		}
+	}
+	render_widget();
+
+	if (!tx_busy && region_count)
+		send_strip();
+}
+
+// spectrum of the meter page, in dBFS per band. drawn with the next lcd_update, call after lcd_fb_clear
+void tft_meter(const float32_t *band, uint8_t bands)
+{
+	widget_requested = TFT_WIDGET_METER;
+	for (uint8_t i = 0; i < TFT_METER_BARS; ++i)
+	{
+		const float32_t level = (i < bands) ? band[i] : -TFT_METER_RANGE_DB;
+		const float32_t share = fminf(fmaxf((level + TFT_METER_RANGE_DB) / TFT_METER_RANGE_DB, 0.0f), 1.0f);
+		bar_target[i] = (uint8_t)(share * TFT_GRAPHICS_HEIGHT);
+	}
+}
+
+// needle of the tuner page: deviation from the note in cents (-50 to 50), hidden without a pitch. drawn with the next
+// lcd_update, call after lcd_fb_clear
+void tft_tuner(int8_t cents, bool valid)
+{
+	widget_requested = TFT_WIDGET_TUNER;
+	if (!valid)
+	{
+		needle_target = -1;
+		return;
+	}
+	const int32_t c = (cents < -50) ? -50 : ((cents > 50) ? 50 : cents);
+	needle_target = TFT_WIDTH / 2 + c * (TFT_WIDTH / 2 - TFT_NEEDLE_WIDTH) / 50 - TFT_NEEDLE_WIDTH / 2;
+	needle_color_target = ((c >= -TFT_TUNER_IN_TUNE) && (c <= TFT_TUNER_IN_TUNE)) ? TFT_COLOR_IN_TUNE : TFT_COLOR_OFF_TUNE;
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	if (hspi == &hspi_tft)
+	{
+		HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_CS, GPIO_PIN_SET);
+		tx_busy = 0;
+	}
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+	if (hspi == &hspi_tft)
+	{
+		HAL_GPIO_WritePin(TFT_PORT, TFT_PIN_CS, GPIO_PIN_SET);
+		tx_busy = 0;
+		// what the panel shows is unknown now -> send the whole frame again
+		mark(0, 0, TFT_WIDTH, TFT_HEIGHT);
+	}
+}
+
+void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	if (hspi->Instance == TFT_SPI)
+	{
+		__HAL_RCC_SPI5_CLK_ENABLE();
+		__HAL_RCC_GPIOF_CLK_ENABLE();
+		__HAL_RCC_DMA2_CLK_ENABLE();
+
+		/* SPI5 GPIO Configuration
+			PF7     ------> SPI5_SCK
+			PF9     ------> SPI5_MOSI
+		*/
+		GPIO_InitStruct.Pin = TFT_PIN_SCK | TFT_PIN_MOSI;
+		GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+		GPIO_InitStruct.Alternate = GPIO_AF5_SPI5;
+		HAL_GPIO_Init(TFT_PORT, &GPIO_InitStruct);
+
+		hdma_tft_tx.Instance = TFT_DMA_STREAM;
+		hdma_tft_tx.Init.Request = DMA_REQUEST_SPI5_TX;
+		hdma_tft_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+		hdma_tft_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+		hdma_tft_tx.Init.MemInc = DMA_MINC_ENABLE;
+		hdma_tft_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+		hdma_tft_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+		hdma_tft_tx.Init.Mode = DMA_NORMAL;
+		hdma_tft_tx.Init.Priority = DMA_PRIORITY_LOW;
+		hdma_tft_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+		if (HAL_DMA_Init(&hdma_tft_tx) != HAL_OK)
+		{
+			Error_Handler();
+		}
+		__HAL_LINKDMA(hspi, hdmatx, hdma_tft_tx);
+
+		// the end of a strip, at the priority of the controls (see ui_post)
+		HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 3, 0);
+		HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+		HAL_NVIC_SetPriority(SPI5_IRQn, 3, 0);
+		HAL_NVIC_EnableIRQ(SPI5_IRQn);
+	}
+}
+
+void HAL_DMA2D_MspInit(DMA2D_HandleTypeDef *hdma2d)
+{
+	if (hdma2d->Instance == DMA2D)
+	{
+		__HAL_RCC_DMA2D_CLK_ENABLE();
+	}
+}
+
+#endif // DISPLAY_TFT
@@ -0,0 +1,105 @@
+// tft.h, Michael Haselberger
+// Description: This file contains declarations for the graphical SPI TFT display backend implemented in tft.c
+
+#ifndef __TFT_H__
+#define __TFT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+#include "i2c_lcd.h"
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Graphical display (DISPLAY_TFT), run by the menu core (the M4, CONTROL_M4).
+*   An ILI9341 compatible 320 x 240 panel on SPI5. Its frame is kept in RGB565 in external RAM and drawn by the DMA2D: the
+*   backgrounds and bars as register to memory fills, the characters as blends of a pre-rendered A8 glyph in the text
+*   color. Only the regions drawn since the last transfer are sent: every region is copied strip by strip into a
+*   contiguous transfer buffer (DMA2D, with the byte swap of the SPI) and written into the panel window by the SPI DMA.
+*
+*   tft.c implements the framebuffer functions of i2c_lcd.h, so the menu writes its two rows as before and lcd_update
+*   renders the characters that changed. Below the text, the meter and tuner pages add their graphics (tft_meter,
+*   tft_tuner). They only record the values, lcd_update renders the difference to what the panel shows. A pass without a
+*   change costs the comparison of the 32 characters.
+*
+*   External RAM window (TFT_MEMORY_BASE, not part of the EXTRAM region of STM32H745ZITx_FLASH_CM7.ld). The FMC SDRAM
+*   has to be mapped before the M4 starts, as for the looper:
+*   +0       150 KB   frame, RGB565, TFT_WIDTH pixels per row
+*   +150 KB   38 KB   glyphs of the font, A8, one TFT_GLYPH_WIDTH x TFT_GLYPH_HEIGHT cell per character from ' ' to '~'
+*   +188 KB   15 KB   transfer strip, TFT_STRIP_LINES full rows in panel byte order
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+#ifndef TFT_MEMORY_BASE
+#define TFT_MEMORY_BASE (0xC07C0000UL)
+#endif
+#define TFT_MEMORY_SIZE (256 * 1024)
+
+// panel in landscape orientation
+#define TFT_WIDTH (320)
+#define TFT_HEIGHT (240)
+#define TFT_SPI (SPI5)
+// APB2 (the default kernel clock of SPI4/5) / 4: 30 MHz at the full clock profile, a frame takes 41 ms, a character 0.2 ms
+#define TFT_SPI_PRESCALER (SPI_BAUDRATEPRESCALER_4)
+// blocking parts: the commands of a window and the DMA2D operations, in ms
+#define TFT_TIMEOUT (10)
+// SPI5 on AF5: PF7 SCK, PF9 MOSI. chip select, data/command and reset are plain outputs
+#define TFT_PORT (GPIOF)
+#define TFT_PIN_SCK (GPIO_PIN_7)
+#define TFT_PIN_MOSI (GPIO_PIN_9)
+#define TFT_PIN_CS (GPIO_PIN_6)
+#define TFT_PIN_DC (GPIO_PIN_8)
+#define TFT_PIN_RESET (GPIO_PIN_10)
+#define TFT_DMA_STREAM (DMA2_Stream0)
+
+// font of the text rows (Font24 of the BSP utilities, fonts.h): 16 columns take 272 of the 320 pixels
+#define TFT_FONT (Font24)
+#define TFT_GLYPH_WIDTH (17)
+#define TFT_GLYPH_HEIGHT (24)
+#define TFT_GLYPHS ('~' - ' ' + 1)
+// position of the text rows and the area of the page graphics below them
+#define TFT_TEXT_X ((TFT_WIDTH - LCD_COLS * TFT_GLYPH_WIDTH) / 2)
+#define TFT_TEXT_Y (8)
+#define TFT_ROW_PITCH (TFT_GLYPH_HEIGHT + 4)
+#define TFT_GRAPHICS_Y (TFT_TEXT_Y + LCD_ROWS * TFT_ROW_PITCH + 8)
+#define TFT_GRAPHICS_HEIGHT (TFT_HEIGHT - TFT_GRAPHICS_Y - 8)
+// rows of one SPI transfer. one text row
+#define TFT_STRIP_LINES (TFT_GLYPH_HEIGHT)
+// regions waiting for the transfer. regions closer than TFT_MERGE_GAP pixels are merged, beyond that the last one grows
+#define TFT_MAX_REGIONS (16)
+#define TFT_MERGE_GAP (4)
+
+#define TFT_FRAME_BYTES (TFT_WIDTH * TFT_HEIGHT * 2)
+#define TFT_GLYPH_BYTES (TFT_GLYPHS * TFT_GLYPH_WIDTH * TFT_GLYPH_HEIGHT)
+#define TFT_STRIP_BYTES (TFT_WIDTH * TFT_STRIP_LINES * 2)
+#if (TFT_FRAME_BYTES + TFT_GLYPH_BYTES + TFT_STRIP_BYTES) > TFT_MEMORY_SIZE
+#error "frame, glyphs and transfer strip don't fit into TFT_MEMORY_SIZE"
+#endif
+
+// colors (ARGB8888, converted by the DMA2D)
+#define TFT_COLOR_BACKGROUND (0xFF000000UL)
+#define TFT_COLOR_TEXT (0xFFFFFFFFUL)
+#define TFT_COLOR_BAR (0xFF20C040UL)
+#define TFT_COLOR_SCALE (0xFF606060UL)
+#define TFT_COLOR_IN_TUNE (0xFF20E040UL)
+#define TFT_COLOR_OFF_TUNE (0xFFE08020UL)
+// spectrum bars, one per band of the telemetry: -60 dB and below is empty, 0 dB fills the graphics area
+#define TFT_METER_BARS (32)
+#define TFT_BAR_WIDTH (8)
+#define TFT_METER_RANGE_DB (60.0f)
+// the needle counts as in tune within this many cents
+#define TFT_TUNER_IN_TUNE (3)
+
+extern SPI_HandleTypeDef hspi_tft;
+extern DMA_HandleTypeDef hdma_tft_tx;
+
+void tft_meter(const float32_t *band, uint8_t bands);
+void tft_tuner(int8_t cents, bool valid);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __TFT_H__
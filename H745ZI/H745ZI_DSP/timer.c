@@ -1,5 +1,6 @@
 // timer.c, Michael Haselberger
-// Description: Initialization code for the timer peripheral. Runs in encoder mode with internal debouncing.
+// Description: Initialization code for the timer peripheral. Runs in encoder mode with internal debouncing, every counted
+// edge raises an interrupt for the menu.
 
 #include "main.h"
 
@@ -35,6 +36,11 @@ void MX_TIM2_Init(void)
 	{
 		Error_Handler();
 	}
+	// every counted edge raises a capture interrupt (HAL_TIM_IC_CaptureCallback), the menu doesn't poll the counter
+	if (HAL_TIM_Encoder_Start_IT(&htim2, TIM_CHANNEL_1) != HAL_OK)
+	{
+		Error_Handler();
+	}
 }
 
 void HAL_TIM_Encoder_MspInit(TIM_HandleTypeDef *tim_encoderHandle)
@@ -61,6 +67,10 @@ void HAL_TIM_Encoder_MspInit(TIM_HandleTypeDef *tim_encoderHandle)
 		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
 		GPIO_InitStruct.Alternate = GPIO_AF1_TIM2;
 		HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+		// same priority as the button EXTI (see ui_post)
+		HAL_NVIC_SetPriority(TIM2_IRQn, 3, 0);
+		HAL_NVIC_EnableIRQ(TIM2_IRQn);
 	}
 }
 
@@ -70,6 +80,7 @@ void HAL_TIM_Encoder_MspDeInit(TIM_HandleTypeDef *tim_encoderHandle)
 	if (tim_encoderHandle->Instance == TIM2)
 	{
 		__HAL_RCC_TIM2_CLK_DISABLE();
+		HAL_NVIC_DisableIRQ(TIM2_IRQn);
 		HAL_GPIO_DeInit(GPIOA, GPIO_PIN_0);
 		HAL_GPIO_DeInit(GPIOB, GPIO_PIN_3);
 	}
@@ -0,0 +1,63 @@
+// trace.c, Michael Haselberger
+// Description: ITM event trace of the block lifecycle: DMA interrupts, start and end of every block and of every stage
+// of the chain, the control pass, the inputs of the controls and the messages between the cores, each stamped with
+// the cycle counter (trace.h). Replaces the two edges per block of CHECK_TIMELINESS: Python/itm_trace.py decodes the
+// SWO stream into a timeline, the jitter of every node and the interrupts in between become visible.
+
+#include "trace.h"
+
+#if defined(TRACE) && defined(CORE_CM7)
+
+// write a word to the trace port, waiting for the FIFO. main loop only
+static void write_word(uint32_t word)
+{
+	while (ITM->PORT[TRACE_PORT].u32 == 0)
+	{
+		__NOP();
+	}
+	ITM->PORT[TRACE_PORT].u32 = word;
+}
+
+/******************************************************************************
+* Function Name: trace_init
+*******************************************************************************
+* Summary:
+*  Enable the trace port and start the cycle counter, if a debugger enabled the ITM (and the
+*  SWO output). Without one the events cost a register read. The first event is the clock.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+void trace_init(void)
+{
+	if (!(ITM->TCR & ITM_TCR_ITMENA_Msk))
+	{
+		return;
+	}
+	// the M7 ITM and DWT are locked after reset
+	ITM->LAR = 0xC5ACCE55;
+	ITM->TER |= 1UL << TRACE_PORT;
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	trace_clock();
+}
+
+// TRACE_CLOCK and the core clock, for the decoder to convert the cycles. call after every change of the clock
+void trace_clock(void)
+{
+	if (!(ITM->TCR & ITM_TCR_ITMENA_Msk) || !(ITM->TER & (1UL << TRACE_PORT)))
+	{
+		return;
+	}
+	// both words in a row, the audio interrupt isn't allowed to come in between
+	__disable_irq();
+	write_word((DWT->CYCCNT << 8) | TRACE_CLOCK);
+	write_word(SystemCoreClock);
+	__enable_irq();
+}
+
+#endif // TRACE && CORE_CM7
@@ -0,0 +1,66 @@
+// trace.h, Michael Haselberger
+// Description: This file contains declarations for the ITM event trace implemented in trace.c
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "platform.h"
+#include "defines_and_constants.h"
+
+// ITM stimulus port of the events. port 0 keeps the text of the reports
+#define TRACE_PORT (1)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Events. Every event is one 32 bit write to TRACE_PORT: the low 24 bits of the cycle counter (DWT CYCCNT) in the upper
+*   three bytes, the event in the low byte. The counter wraps every 35 ms at 480 MHz, the DMA events come more often, so
+*   the decoder (Python/itm_trace.py) unwraps it. TRACE_CLOCK is followed by a word with the core clock in Hz.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef enum
+{
+	TRACE_CLOCK = 0x00,				// the next word is SystemCoreClock (trace_init, clock profile changes)
+	TRACE_BLOCK_START = 0x01,		// audio_process starts a block
+	TRACE_BLOCK_END = 0x02,			// the block is sent
+	TRACE_BLOCK_SKIP = 0x03,		// the DMA overwrote waiting blocks, processing resumes with the oldest intact one
+	TRACE_BLOCK_READY = 0x04,		// a block is queued for processing (after the MDMA staging with MDMA_TRANSFER)
+	TRACE_CONTROL_START = 0x05,		// control pass of the main loop
+	TRACE_CONTROL_END = 0x06,
+	TRACE_DMA = 0x08,				// + block of the DMA buffers: the DMA completed it (half / complete interrupt)
+	TRACE_UI_INPUT = 0x10,			// + UI_EVENT_* flags: encoder or button interrupt
+	TRACE_COMMAND = 0x18,			// + control_type: a menu or host command is carried out
+	TRACE_IPC_BLOCK = 0x20,			// input block passed to the M4 (dual_core_exchange)
+	TRACE_IPC_TAIL = 0x21,			// tail block of the M4 collected in time
+	TRACE_IPC_TAIL_MISSED = 0x22,	// the M4 missed the block
+	TRACE_IPC_STATUS = 0x23,		// status snapshot published to the M4 menu (CONTROL_M4)
+	TRACE_IPC_COMMAND = 0x28,		// + control_type: command of the M4 menu received
+	TRACE_NODE_START = 0x40,		// + node id (fx_designator): a stage of the chain starts with this node
+	TRACE_NODE_END = 0x80			// + node id: the stage is done
+} trace_event;
+
+#if defined(TRACE) && defined(CORE_CM7)
+// trace an event. takes a few cycles, nothing but a register read while no debugger enabled the port. the event is
+// dropped, not waited for, if the ITM FIFO is full
+static inline void trace_event_write(uint32_t event)
+{
+	if ((ITM->TCR & ITM_TCR_ITMENA_Msk) && (ITM->TER & (1UL << TRACE_PORT)) && ITM->PORT[TRACE_PORT].u32)
+	{
+		ITM->PORT[TRACE_PORT].u32 = (DWT->CYCCNT << 8) | (event & 0xFF);
+	}
+}
+#define TRACE_EVENT(event) trace_event_write(event)
+
+void trace_init(void);
+void trace_clock(void);
+#else
+#define TRACE_EVENT(event) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __TRACE_H__
@@ -0,0 +1,277 @@
+// tuner.c, Michael Haselberger
+// Description: Pitch detection for the tuner page. The audio path only decimates the input into a frame buffer
+// (tuner_feed), the analysis runs in the main loop (tuner_process) and never delays a block: YIN difference function,
+// with the autocorrelation computed by FFT. The signal passes through the effects unchanged while the tuner is shown.
+
+#include <string.h>
+#include "tuner.h"
+
+#if defined(TUNER)
+
+// lags searched for the period
+#define MIN_LAG ((uint32_t)(TUNER_RATE / TUNER_MAX_HZ))
+#define MAX_LAG ((uint32_t)(TUNER_RATE / TUNER_MIN_HZ))
+
+_Static_assert(TUNER_WINDOW + MAX_LAG < TUNER_FRAME, "TUNER_WINDOW plus the longest lag has to fit into TUNER_FRAME");
+
+static const char *const note_names[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+// two frames: the audio path fills one while the main loop analyzes the other
+static float32_t __attribute__((aligned(32))) frames[2][TUNER_FRAME];
+static float32_t __attribute__((aligned(32))) scratch[TUNER_FRAME];
+// spectra of the whole frame and of the difference window
+static float32_t __attribute__((aligned(32))) spectrum_frame[TUNER_FRAME];
+static float32_t __attribute__((aligned(32))) spectrum_window[TUNER_FRAME];
+static arm_rfft_fast_instance_f32 fft;
+
+// decimation state, audio path only
+static float32_t sum = 0.0f;
+static uint8_t phase = 0;
+static uint32_t count = 0;
+static uint8_t fill = 0;
+// set by the audio path when a frame is complete, cleared by the main loop when it took it over
+static volatile bool enabled = false;
+static volatile bool pending = false;
+static volatile uint8_t ready = 0;
+
+static tuner_result_t result = { 0 };
+
+/******************************************************************************
+* Function Name: tuner_init
+*******************************************************************************
+* Summary:
+*  Initialize the FFT of the analysis. The tuner starts disabled.
+*
+* Parameters:
+*  None.
+* Return:
+*  255:								- The FFT size is not supported by CMSIS-DSP.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t tuner_init(void)
+{
+	enabled = false;
+	if (arm_rfft_fast_init_f32(&fft, TUNER_FRAME) != ARM_MATH_SUCCESS)
+	{
+		return 255;
+	}
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: tuner_enable
+*******************************************************************************
+* Summary:
+*  Start or stop collecting frames, e.g. while the tuner page is shown. A disabled tuner costs
+*  the audio path one comparison per block. Call from the main loop.
+*
+* Parameters:
+*  1. bool on						- true to start collecting.
+* Return:
+*  None.
+*
+******************************************************************************/
+void tuner_enable(bool on)
+{
+	if (on && !enabled)
+	{
+		// the audio path isn't collecting, its state can be reset from here
+		sum = 0.0f;
+		phase = 0;
+		count = 0;
+		pending = false;
+		result.frequency = 0.0f;
+	}
+	enabled = on;
+}
+
+// true while frames are collected (tuner page shown). the audio path skips the tuner's input otherwise
+bool tuner_enabled(void)
+{
+	return enabled;
+}
+
+/******************************************************************************
+* Function Name: tuner_feed
+*******************************************************************************
+* Summary:
+*  Decimate an input block into the frame buffer (mean of every sample_rate / TUNER_RATE samples, a
+*  boxcar anti-aliasing filter is enough for the fundamentals). A complete frame is handed to
+*  the main loop. If the previous frame wasn't taken yet, the new one is discarded and
+*  collected again. Call from the audio path with the unprocessed input.
+*
+* Parameters:
+*  1. const sample_t *src			- Input block.
+*  2. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void tuner_feed(const sample_t *src, uint32_t block_size)
+{
+	if (!enabled)
+	{
+		return;
+	}
+	const uint32_t decimation = (sample_rate + TUNER_RATE / 2) / TUNER_RATE;
+#if defined(SAMPLE_Q31)
+	const float32_t scale = 1.0f / (decimation * 2147483648.0f);
+#else
+	const float32_t scale = 1.0f / decimation;
+#endif
+	float32_t *frame = frames[fill];
+
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		sum += (float32_t)src[i];
+		if (++phase < decimation)
+			continue;
+		frame[count++] = sum * scale;
+		sum = 0.0f;
+		phase = 0;
+		if (count == TUNER_FRAME)
+		{
+			count = 0;
+			if (!pending)
+			{
+				ready = fill;
+				fill ^= 1;
+				frame = frames[fill];
+				pending = true;
+			}
+		}
+	}
+}
+
+/******************************************************************************
+* Function Name: tuner_process
+*******************************************************************************
+* Summary:
+*  Analyze the last complete frame, if there is one. Call from the main loop. YIN: the
+*  difference function d(lag) = e(0) + e(lag) - 2 r(lag) comes from the energies of the
+*  window and of the shifted window and the cross correlation r, which is computed as
+*  IFFT(conj(FFT(window)) * FFT(frame)) instead of one dot product per lag. The period is the
+*  first dip of the cumulative mean normalized difference below TUNER_THRESHOLD, refined by a
+*  parabola through its neighbours.
+*
+* Parameters:
+*  None.
+* Return:
+*  1:								- A new result is available (see tuner_result).
+*  0:								- No frame was complete.
+*
+******************************************************************************/
+uint8_t tuner_process(void)
+{
+	if (!pending)
+	{
+		return 0;
+	}
+
+	// take the frame over, the audio path can fill the next one while it is analyzed
+	float32_t mean;
+	arm_copy_f32(frames[ready], scratch, TUNER_FRAME);
+	pending = false;
+	arm_mean_f32(scratch, TUNER_FRAME, &mean);
+	arm_offset_f32(scratch, -mean, scratch, TUNER_FRAME);
+
+	float32_t power;
+	arm_power_f32(scratch, TUNER_FRAME, &power);
+	result.sequence++;
+	result.frequency = 0.0f;
+	if (power < TUNER_MIN_POWER * TUNER_FRAME)
+	{
+		return 1;
+	}
+
+	// energies of the window and of the window shifted by every lag
+	float32_t energies[MAX_LAG + 1];
+	float32_t energy = 0.0f;
+	for (uint32_t j = 0; j < TUNER_WINDOW; ++j)
+	{
+		energy += scratch[j] * scratch[j];
+	}
+	for (uint32_t lag = 0; lag <= MAX_LAG; ++lag)
+	{
+		energies[lag] = energy;
+		energy += scratch[lag + TUNER_WINDOW] * scratch[lag + TUNER_WINDOW] - scratch[lag] * scratch[lag];
+	}
+
+	// the transform overwrites its input: the window is zero padded from a copy of the frame in spectrum_window
+	arm_copy_f32(scratch, spectrum_window, TUNER_WINDOW);
+	arm_rfft_fast_f32(&fft, scratch, spectrum_frame, 0);
+	arm_copy_f32(spectrum_window, scratch, TUNER_WINDOW);
+	memset(&scratch[TUNER_WINDOW], 0, (TUNER_FRAME - TUNER_WINDOW) * sizeof(float32_t));
+	arm_rfft_fast_f32(&fft, scratch, spectrum_window, 0);
+
+	// cross spectrum. the first pair of the CMSIS format holds the two real bins (DC and Nyquist)
+	const float32_t dc = spectrum_window[0] * spectrum_frame[0];
+	const float32_t nyquist = spectrum_window[1] * spectrum_frame[1];
+	arm_cmplx_conj_f32(spectrum_window, spectrum_window, TUNER_FRAME / 2);
+	arm_cmplx_mult_cmplx_f32(spectrum_window, spectrum_frame, spectrum_window, TUNER_FRAME / 2);
+	spectrum_window[0] = dc;
+	spectrum_window[1] = nyquist;
+	arm_rfft_fast_f32(&fft, spectrum_window, scratch, 1);
+
+	// difference function in place of the energies, its cumulative mean normalized form in place of the correlation
+	float32_t *const difference = energies;
+	float32_t *const cmnd = scratch;
+	const float32_t energy_0 = energies[0];
+	float32_t running = 0.0f;
+	difference[0] = 0.0f;
+	cmnd[0] = 1.0f;
+	for (uint32_t lag = 1; lag <= MAX_LAG; ++lag)
+	{
+		difference[lag] = energy_0 + energies[lag] - 2.0f * scratch[lag];
+		running += difference[lag];
+		cmnd[lag] = (running > 0.0f) ? (difference[lag] * lag / running) : 1.0f;
+	}
+
+	uint32_t period = 0;
+	for (uint32_t lag = MIN_LAG; lag < MAX_LAG; ++lag)
+	{
+		if (cmnd[lag] < TUNER_THRESHOLD)
+		{
+			while ((lag + 1 < MAX_LAG) && (cmnd[lag + 1] < cmnd[lag]))
+				lag++;
+			period = lag;
+			break;
+		}
+	}
+	if (period == 0)
+	{
+		return 1;
+	}
+
+	// the parabola through the raw difference is closer to the true period than through the normalized one
+	const float32_t a = difference[period - 1];
+	const float32_t b = difference[period];
+	const float32_t c = difference[period + 1];
+	const float32_t curvature = a - 2.0f * b + c;
+	const float32_t shift = (curvature > 0.0f) ? (0.5f * (a - c) / curvature) : 0.0f;
+
+	const uint32_t decimation = (sample_rate + TUNER_RATE / 2) / TUNER_RATE;
+	const float32_t frequency = ((float32_t)sample_rate / decimation) / (period + shift);
+	const float32_t midi = 69.0f + 12.0f * log2f(frequency / 440.0f);
+	const float32_t note = roundf(midi);
+	result.frequency = frequency;
+	result.note = (uint8_t)note;
+	result.cents = (int8_t)roundf(100.0f * (midi - note));
+	result.clarity = 1.0f - cmnd[period];
+
+	return 1;
+}
+
+const tuner_result_t* tuner_result(void)
+{
+	return &result;
+}
+
+const char* tuner_note_name(uint8_t note)
+{
+	return note_names[note % 12];
+}
+
+#endif // TUNER
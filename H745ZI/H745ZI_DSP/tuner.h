@@ -0,0 +1,63 @@
+// tuner.h, Michael Haselberger
+// Description: This file contains declarations for the pitch detection of the tuner implemented in tuner.c
+
+#ifndef __TUNER_H__
+#define __TUNER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// the analysis runs at about 12 kHz: the fundamentals of a guitar (82 Hz to ~1.2 kHz) stay far below the new Nyquist
+// frequency, and a lag step is still short enough for a few cents at the high notes. the decimation factor follows the
+// sample rate (4 at 44.1 and 48 kHz, 8 at 96 kHz), TUNER_RATE is the nominal rate the lag range is sized for
+#define TUNER_RATE (12000)
+// decimated samples per analysis (43 ms, ~23 results per second), also the FFT size. holds the difference window plus
+// the longest lag, so the circular correlation of the FFT never wraps around for the lags searched
+#define TUNER_FRAME (512)
+// range of detected fundamentals (lags TUNER_RATE / TUNER_MAX_HZ to TUNER_RATE / TUNER_MIN_HZ)
+#define TUNER_MIN_HZ (60.0f)
+#define TUNER_MAX_HZ (1200.0f)
+// samples compared per lag: the frame minus the longest lag
+#define TUNER_WINDOW (TUNER_FRAME - (uint32_t)(TUNER_RATE / TUNER_MIN_HZ) - 1)
+// absolute threshold of the normalized difference function (YIN): the first dip below it is the period
+#define TUNER_THRESHOLD (0.15f)
+// frames quieter than this (mean square, about -50 dBFS) show no note
+#define TUNER_MIN_POWER (1e-5f)
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Result of the last analysis, written by tuner_process and read by the menu.
+*
+*   Members:
+*   frequency:          Detected fundamental in Hz, 0 if the frame was too quiet or had no clear period.
+*   note:               Nearest note of the equal temperament as MIDI note number (A4 = 69).
+*   cents:              Deviation from that note, -50 to 50.
+*   clarity:            1 - the normalized difference at the period: near 1 for a clean tone.
+*   sequence:           Incremented with every analysis (the menu only redraws on a new result).
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t frequency;
+	uint8_t note;
+	int8_t cents;
+	float32_t clarity;
+	uint32_t sequence;
+} tuner_result_t;
+
+uint8_t tuner_init(void);
+void tuner_enable(bool on);
+bool tuner_enabled(void);
+void tuner_feed(const sample_t *src, uint32_t block_size);
+uint8_t tuner_process(void);
+const tuner_result_t* tuner_result(void);
+const char* tuner_note_name(uint8_t note);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __TUNER_H__
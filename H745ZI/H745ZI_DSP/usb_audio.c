@@ -0,0 +1,667 @@
+// usb_audio.c, Michael Haselberger
+// Description: USB audio class 2.0 device on the OTG FS port (CN13): streams the chain output, and the dry input for
+// re-amping, to a host at 48 kHz / 24 bit. The audio path packs every block into a ring (usb_audio_tap), the isochronous
+// IN packets are sent straight out of that ring. The sample clock (I2S, PLL2) and the USB clock (HSI48, trimmed to the
+// SOFs of the host) are independent: the endpoint is asynchronous and the packet sizes follow the measured I2S rate.
+// Only the HAL PCD driver is used, the few standard and audio class requests are answered here.
+
+#include <string.h>
+#include "main.h"
+
+#if defined(USB_AUDIO)
+
+#define EP0_SIZE (64)
+#define EP_AUDIO_IN (0x81)
+// ST development IDs
+#define USB_VID (0x0483)
+#define USB_PID (0x5730)
+
+// entities of the audio function and the streaming interface
+#define CLOCK_ID (1)
+#define INPUT_TERMINAL_ID (2)
+#define OUTPUT_TERMINAL_ID (3)
+#define AS_INTERFACE (1)
+
+// standard requests
+#define GET_STATUS (0)
+#define CLEAR_FEATURE (1)
+#define SET_FEATURE (3)
+#define SET_ADDRESS (5)
+#define GET_DESCRIPTOR (6)
+#define GET_CONFIGURATION (8)
+#define SET_CONFIGURATION (9)
+#define GET_INTERFACE (10)
+#define SET_INTERFACE (11)
+// audio class requests and clock source controls
+#define REQUEST_CUR (0x01)
+#define REQUEST_RANGE (0x02)
+#define CS_SAM_FREQ (0x01)
+#define CS_CLOCK_VALID (0x02)
+
+#define LO(x) ((uint8_t)((x) & 0xFF))
+#define HI(x) ((uint8_t)(((x) >> 8) & 0xFF))
+#define B4(x) LO(x), HI(x), LO((x) >> 16), LO((x) >> 24)
+
+// class specific AudioControl descriptors: header, clock source, input terminal, output terminal
+#define AC_LENGTH (9 + 8 + 17 + 12)
+#define CONFIG_LENGTH (9 + 8 + 9 + AC_LENGTH + 9 + 9 + 16 + 6 + 7 + 8)
+
+PCD_HandleTypeDef hpcd_usb;
+
+static const uint8_t device_descriptor[18] =
+{
+	18, 0x01, LO(0x0200), HI(0x0200),
+	0xEF, 0x02, 0x01,												// miscellaneous class with interface association
+	EP0_SIZE, LO(USB_VID), HI(USB_VID), LO(USB_PID), HI(USB_PID),
+	LO(0x0100), HI(0x0100), 1, 2, 0, 1
+};
+
+static const uint8_t config_descriptor[CONFIG_LENGTH] =
+{
+	// configuration: 2 interfaces, self powered
+	9, 0x02, LO(CONFIG_LENGTH), HI(CONFIG_LENGTH), 2, 1, 0, 0xC0, 50,
+	// interface association of the audio function
+	8, 0x0B, 0, 2, 0x01, 0x00, 0x20, 0,
+	// AudioControl interface
+	9, 0x04, 0, 0, 0, 0x01, 0x01, 0x20, 0,
+	// class specific AC header, category I/O box
+	9, 0x24, 0x01, LO(0x0200), HI(0x0200), 0x08, LO(AC_LENGTH), HI(AC_LENGTH), 0x00,
+	// clock source: internal fixed clock, frequency can be read
+	8, 0x24, 0x0A, CLOCK_ID, 0x01, 0x01, 0, 0,
+	// input terminal: line connector (the jacks of the codec)
+	17, 0x24, 0x02, INPUT_TERMINAL_ID, LO(0x0603), HI(0x0603), 0, CLOCK_ID, USB_AUDIO_CHANNELS, B4(0), 0, 0x00, 0x00, 0,
+	// output terminal: USB streaming
+	12, 0x24, 0x03, OUTPUT_TERMINAL_ID, LO(0x0101), HI(0x0101), 0, INPUT_TERMINAL_ID, CLOCK_ID, 0x00, 0x00, 0,
+	// AudioStreaming interface, alternate setting 0: no bandwidth
+	9, 0x04, AS_INTERFACE, 0, 0, 0x01, 0x02, 0x20, 0,
+	// alternate setting 1: streaming
+	9, 0x04, AS_INTERFACE, 1, 1, 0x01, 0x02, 0x20, 0,
+	// class specific AS interface: PCM
+	16, 0x24, 0x01, OUTPUT_TERMINAL_ID, 0x00, 0x01, B4(0x00000001), USB_AUDIO_CHANNELS, B4(0), 0,
+	// format type I: 24 bits in 3 byte subslots
+	6, 0x24, 0x02, 0x01, USB_AUDIO_SUBSLOT, 24,
+	// isochronous asynchronous IN endpoint, every frame
+	7, 0x05, EP_AUDIO_IN, 0x05, LO(USB_AUDIO_MAX_PACKET), HI(USB_AUDIO_MAX_PACKET), 1,
+	// class specific endpoint
+	8, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const char *const strings[] = { "Michael Haselberger", "H745ZI DSP" };
+
+// packed sample frames. the first USB_AUDIO_MAX_PACKET_FRAMES frames are mirrored behind the end, so every packet is
+// one contiguous piece of the ring and goes to the FIFO without being copied first
+static uint8_t ring[(USB_AUDIO_RING_FRAMES + USB_AUDIO_MAX_PACKET_FRAMES) * USB_AUDIO_FRAME_BYTES];
+// sample frames written by the audio path and sent by the USB interrupt, free running
+static volatile uint32_t written = 0;
+static volatile uint32_t sent = 0;
+static volatile uint8_t streaming = 0;
+// streaming waits for USB_AUDIO_TARGET_FRAMES after the start and after an underrun
+static uint8_t priming = 1;
+static uint8_t busy = 0;
+
+// I2S rate in sample frames per USB frame (Q16.16), measured against the SOFs. fractions are carried over packets
+static uint32_t rate = (uint32_t)USB_AUDIO_PACKET_FRAMES << 16;
+static uint32_t fraction = 0;
+static uint32_t window_start = 0;
+static uint16_t window_sofs = 0;
+
+// control transfers
+enum ep0_state { EP0_IDLE, EP0_DATA_IN, EP0_DATA_OUT, EP0_STATUS_IN };
+static enum ep0_state ep0 = EP0_IDLE;
+static uint8_t ep0_buffer[EP0_SIZE];
+static const uint8_t *ep0_data = NULL;
+static uint32_t ep0_remaining = 0;
+static uint8_t ep0_zlp = 0;
+static uint8_t configuration = 0;
+static uint8_t alternate = 0;
+
+/******************************************************************************
+* Function Name: usb_audio_init
+*******************************************************************************
+* Summary:
+*  Initialize the OTG FS core as full speed device with the internal PHY and connect to the
+*  host. The USB kernel clock (HSI48) has to run, see USBClock_Config. FIFOs in words: RX 128,
+*  EP0 64, audio IN 128 (one packet of USB_AUDIO_MAX_PACKET bytes).
+*
+* Parameters:
+*  None.
+* Return:
+*  255:								- The HAL failed to initialize or start the core.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t usb_audio_init(void)
+{
+	hpcd_usb.Instance = USB_OTG_FS;
+	hpcd_usb.Init.dev_endpoints = 9;
+	hpcd_usb.Init.speed = PCD_SPEED_FULL;
+	hpcd_usb.Init.dma_enable = DISABLE;
+	hpcd_usb.Init.phy_itface = PCD_PHY_EMBEDDED;
+	// SOF interrupt: packet timing and rate measurement
+	hpcd_usb.Init.Sof_enable = ENABLE;
+	hpcd_usb.Init.low_power_enable = DISABLE;
+	hpcd_usb.Init.lpm_enable = DISABLE;
+	hpcd_usb.Init.battery_charging_enable = DISABLE;
+	hpcd_usb.Init.vbus_sensing_enable = DISABLE;
+	hpcd_usb.Init.use_dedicated_ep1 = DISABLE;
+	if (HAL_PCD_Init(&hpcd_usb) != HAL_OK)
+	{
+		return 255;
+	}
+
+	HAL_PCDEx_SetRxFiFo(&hpcd_usb, 0x80);
+	HAL_PCDEx_SetTxFiFo(&hpcd_usb, 0, 0x40);
+	HAL_PCDEx_SetTxFiFo(&hpcd_usb, 1, 0x80);
+
+	if (HAL_PCD_Start(&hpcd_usb) != HAL_OK)
+	{
+		return 255;
+	}
+	return 0;
+}
+
+static void put_sample(uint8_t *dst, sample_t x)
+{
+#if defined(SAMPLE_Q31)
+	const int32_t s = x >> 8;
+#else
+	const int32_t s = __SSAT((int32_t)(x * 8388608.0f), 24);
+#endif
+	dst[0] = (uint8_t)s;
+	dst[1] = (uint8_t)(s >> 8);
+	dst[2] = (uint8_t)(s >> 16);
+}
+
+/******************************************************************************
+* Function Name: usb_audio_tap
+*******************************************************************************
+* Summary:
+*  Pack a block into the ring as 24 bit little endian sample frames, while the host streams.
+*  The ring isn't locked: the audio path has the higher interrupt priority, so a block is
+*  always complete when the USB interrupt reads the frame counter. Call from the audio path.
+*
+* Parameters:
+*  1. const sample_t *wet			- Chain output.
+*  2. const sample_t *dry			- Unprocessed input (second channel, ignored with one channel).
+*  3. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void usb_audio_tap(const sample_t *wet, const sample_t *dry, uint32_t block_size)
+{
+	if (!streaming)
+	{
+		return;
+	}
+
+	uint32_t index = written & (USB_AUDIO_RING_FRAMES - 1);
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		uint8_t *frame = &ring[index * USB_AUDIO_FRAME_BYTES];
+		put_sample(frame, wet[i]);
+#if (USB_AUDIO_CHANNELS == 2)
+		put_sample(&frame[USB_AUDIO_SUBSLOT], dry[i]);
+#endif
+		if (index < USB_AUDIO_MAX_PACKET_FRAMES)
+		{
+			memcpy(&frame[USB_AUDIO_RING_FRAMES * USB_AUDIO_FRAME_BYTES], frame, USB_AUDIO_FRAME_BYTES);
+		}
+		index = (index + 1) & (USB_AUDIO_RING_FRAMES - 1);
+	}
+	written += block_size;
+}
+
+static void ep0_send_next(PCD_HandleTypeDef *hpcd)
+{
+	const uint32_t n = (ep0_remaining > EP0_SIZE) ? EP0_SIZE : ep0_remaining;
+	HAL_PCD_EP_Transmit(hpcd, 0x80, (uint8_t *)ep0_data, n);
+	ep0_data += n;
+	ep0_remaining -= n;
+}
+
+// data stage IN. a reply shorter than requested ends with a short packet, a zero length one after a full packet
+static void ep0_send(PCD_HandleTypeDef *hpcd, const uint8_t *data, uint32_t length, uint16_t requested)
+{
+	if (length > requested)
+		length = requested;
+	ep0 = EP0_DATA_IN;
+	ep0_data = data;
+	ep0_remaining = length;
+	ep0_zlp = (length > 0) && (length < requested) && ((length % EP0_SIZE) == 0);
+	ep0_send_next(hpcd);
+}
+
+// status stage IN of a request without or after an OUT data stage
+static void ep0_status(PCD_HandleTypeDef *hpcd)
+{
+	ep0 = EP0_STATUS_IN;
+	HAL_PCD_EP_Transmit(hpcd, 0x80, NULL, 0);
+}
+
+static void ep0_stall(PCD_HandleTypeDef *hpcd)
+{
+	ep0 = EP0_IDLE;
+	HAL_PCD_EP_SetStall(hpcd, 0x80);
+	HAL_PCD_EP_SetStall(hpcd, 0x00);
+}
+
+// UTF-16LE copy of a string, index 0 is the list of languages (US English)
+static uint8_t string_descriptor(uint8_t index, uint8_t *dst)
+{
+	if (index == 0)
+	{
+		dst[0] = 4;
+		dst[1] = 0x03;
+		dst[2] = LO(0x0409);
+		dst[3] = HI(0x0409);
+		return 4;
+	}
+	if (index > sizeof(strings) / sizeof(strings[0]))
+	{
+		return 0;
+	}
+
+	const char *text = strings[index - 1];
+	uint8_t length = 2;
+	while (*text && (length + 2 <= EP0_SIZE))
+	{
+		dst[length++] = (uint8_t)*text++;
+		dst[length++] = 0;
+	}
+	dst[0] = length;
+	dst[1] = 0x03;
+	return length;
+}
+
+static void set_streaming(PCD_HandleTypeDef *hpcd, uint8_t on)
+{
+	alternate = on;
+	if (on)
+	{
+		// the audio path can't be in the middle of a block here (higher priority)
+		sent = written;
+		window_start = written;
+		window_sofs = 0;
+		priming = 1;
+		busy = 0;
+		streaming = 1;
+	}
+	else
+	{
+		streaming = 0;
+		HAL_PCD_EP_Flush(hpcd, EP_AUDIO_IN);
+		busy = 0;
+	}
+}
+
+static void set_configuration(PCD_HandleTypeDef *hpcd, uint8_t value)
+{
+	if (value == configuration)
+	{
+		return;
+	}
+	if (value)
+	{
+		HAL_PCD_EP_Open(hpcd, EP_AUDIO_IN, USB_AUDIO_MAX_PACKET, EP_TYPE_ISOC);
+	}
+	else
+	{
+		set_streaming(hpcd, 0);
+		HAL_PCD_EP_Close(hpcd, EP_AUDIO_IN);
+	}
+	configuration = value;
+}
+
+static void standard_request(PCD_HandleTypeDef *hpcd, uint8_t type, uint8_t request, uint16_t value, uint16_t index, uint16_t length)
+{
+	const uint8_t recipient = type & 0x1F;
+
+	switch (request)
+	{
+	case GET_DESCRIPTOR:
+		switch (HI(value))
+		{
+		case 0x01:
+			ep0_send(hpcd, device_descriptor, sizeof(device_descriptor), length);
+			break;
+		case 0x02:
+			ep0_send(hpcd, config_descriptor, sizeof(config_descriptor), length);
+			break;
+		case 0x03:
+		{
+			const uint8_t n = string_descriptor(LO(value), ep0_buffer);
+			if (n)
+				ep0_send(hpcd, ep0_buffer, n, length);
+			else
+				ep0_stall(hpcd);
+			break;
+		}
+		default:
+			// full speed only: no device qualifier
+			ep0_stall(hpcd);
+			break;
+		}
+		break;
+	case SET_ADDRESS:
+		// the core answers with the new address after the status stage
+		HAL_PCD_SetAddress(hpcd, (uint8_t)(value & 0x7F));
+		ep0_status(hpcd);
+		break;
+	case GET_CONFIGURATION:
+		ep0_buffer[0] = configuration;
+		ep0_send(hpcd, ep0_buffer, 1, length);
+		break;
+	case SET_CONFIGURATION:
+		if (value > 1)
+		{
+			ep0_stall(hpcd);
+			break;
+		}
+		set_configuration(hpcd, (uint8_t)value);
+		ep0_status(hpcd);
+		break;
+	case GET_STATUS:
+		// device: self powered. interfaces and endpoints: nothing to report
+		ep0_buffer[0] = (recipient == 0) ? 0x01 : 0x00;
+		ep0_buffer[1] = 0;
+		ep0_send(hpcd, ep0_buffer, 2, length);
+		break;
+	case CLEAR_FEATURE:
+	case SET_FEATURE:
+		// no remote wakeup, an isochronous endpoint can't halt
+		ep0_status(hpcd);
+		break;
+	case GET_INTERFACE:
+		ep0_buffer[0] = (index == AS_INTERFACE) ? alternate : 0;
+		ep0_send(hpcd, ep0_buffer, 1, length);
+		break;
+	case SET_INTERFACE:
+		if ((index == AS_INTERFACE) && (value <= 1) && configuration)
+		{
+			set_streaming(hpcd, (uint8_t)value);
+			ep0_status(hpcd);
+		}
+		else if ((index == 0) && (value == 0))
+		{
+			ep0_status(hpcd);
+		}
+		else
+		{
+			ep0_stall(hpcd);
+		}
+		break;
+	default:
+		ep0_stall(hpcd);
+		break;
+	}
+}
+
+// only the clock source has controls: the sample rate (fixed 48 kHz) and its validity
+static void class_request(PCD_HandleTypeDef *hpcd, uint8_t type, uint8_t request, uint16_t value, uint16_t index, uint16_t length)
+{
+	const uint8_t selector = HI(value);
+	if ((HI(index) != CLOCK_ID) || ((type & 0x1F) != 0x01))
+	{
+		ep0_stall(hpcd);
+		return;
+	}
+
+	if (type & 0x80)
+	{
+		if ((request == REQUEST_CUR) && (selector == CS_SAM_FREQ))
+		{
+			const uint8_t cur[4] = { B4(AUDIO_SAMPLE_RATE) };
+			memcpy(ep0_buffer, cur, sizeof(cur));
+			ep0_send(hpcd, ep0_buffer, sizeof(cur), length);
+		}
+		else if ((request == REQUEST_RANGE) && (selector == CS_SAM_FREQ))
+		{
+			// one subrange: minimum, maximum, resolution
+			const uint8_t range[14] = { 1, 0, B4(AUDIO_SAMPLE_RATE), B4(AUDIO_SAMPLE_RATE), B4(0) };
+			memcpy(ep0_buffer, range, sizeof(range));
+			ep0_send(hpcd, ep0_buffer, sizeof(range), length);
+		}
+		else if ((request == REQUEST_CUR) && (selector == CS_CLOCK_VALID))
+		{
+			ep0_buffer[0] = 1;
+			ep0_send(hpcd, ep0_buffer, 1, length);
+		}
+		else
+		{
+			ep0_stall(hpcd);
+		}
+	}
+	else if ((request == REQUEST_CUR) && (selector == CS_SAM_FREQ) && (length == 4))
+	{
+		// some hosts set the only rate there is. the value is received and ignored
+		ep0 = EP0_DATA_OUT;
+		HAL_PCD_EP_Receive(hpcd, 0x00, ep0_buffer, length);
+	}
+	else
+	{
+		ep0_stall(hpcd);
+	}
+}
+
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
+{
+	const uint8_t *setup = (const uint8_t *)hpcd->Setup;
+	const uint8_t type = setup[0];
+	const uint8_t request = setup[1];
+	const uint16_t value = setup[2] | (setup[3] << 8);
+	const uint16_t index = setup[4] | (setup[5] << 8);
+	const uint16_t length = setup[6] | (setup[7] << 8);
+
+	switch (type & 0x60)
+	{
+	case 0x00:
+		standard_request(hpcd, type, request, value, index, length);
+		break;
+	case 0x20:
+		class_request(hpcd, type, request, value, index, length);
+		break;
+	default:
+		ep0_stall(hpcd);
+		break;
+	}
+}
+
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+	if (epnum == (EP_AUDIO_IN & 0x7F))
+	{
+		busy = 0;
+		return;
+	}
+	if (epnum != 0)
+	{
+		return;
+	}
+
+	if (ep0 == EP0_DATA_IN)
+	{
+		if (ep0_remaining)
+		{
+			ep0_send_next(hpcd);
+		}
+		else if (ep0_zlp)
+		{
+			ep0_zlp = 0;
+			HAL_PCD_EP_Transmit(hpcd, 0x80, NULL, 0);
+		}
+		else
+		{
+			// status stage OUT
+			ep0 = EP0_IDLE;
+			HAL_PCD_EP_Receive(hpcd, 0x00, NULL, 0);
+		}
+	}
+	else
+	{
+		ep0 = EP0_IDLE;
+	}
+}
+
+void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+	if ((epnum == 0) && (ep0 == EP0_DATA_OUT))
+	{
+		ep0_status(hpcd);
+	}
+}
+
+/******************************************************************************
+* Function Name: HAL_PCD_SOFCallback
+*******************************************************************************
+* Summary:
+*  Once per USB frame: measure the I2S rate and queue the packet of the next frame, as soon as
+*  the last one is out. A packet takes the measured rate (47, 48 or 49 sample frames, the
+*  fractions add up), one frame more or less if the fill level of the ring leaves the band
+*  around USB_AUDIO_TARGET_FRAMES. The host sees the I2S clock in the packet sizes: an
+*  asynchronous source needs no feedback endpoint.
+*
+******************************************************************************/
+void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
+{
+	const uint32_t now = written;
+
+	if (++window_sofs == USB_AUDIO_RATE_WINDOW)
+	{
+		// a window without streaming has no blocks counted. blocks make the count jump, the estimate is smoothed
+		if (streaming && (now != window_start))
+		{
+			const uint32_t measured = (uint32_t)(((uint64_t)(now - window_start) << 16) / USB_AUDIO_RATE_WINDOW);
+			rate = (uint32_t)((int32_t)rate + ((int32_t)(measured - rate) >> 3));
+		}
+		window_start = now;
+		window_sofs = 0;
+	}
+
+	if (!streaming || busy)
+	{
+		return;
+	}
+
+	uint32_t fill = now - sent;
+	if (fill > USB_AUDIO_RING_FRAMES - MAX_BLOCK_SIZE)
+	{
+		// the host stopped fetching (suspend) and the ring was overwritten: start over
+		sent = now - USB_AUDIO_TARGET_FRAMES;
+		fill = USB_AUDIO_TARGET_FRAMES;
+	}
+
+	fraction += rate;
+	uint32_t frames = fraction >> 16;
+	fraction &= 0xFFFF;
+	if (priming)
+	{
+		if (fill < USB_AUDIO_TARGET_FRAMES)
+		{
+			frames = 0;
+		}
+		else
+		{
+			priming = 0;
+			sent = now - USB_AUDIO_TARGET_FRAMES;
+			fill = USB_AUDIO_TARGET_FRAMES;
+		}
+	}
+	else if (fill > USB_AUDIO_TARGET_FRAMES + USB_AUDIO_SLACK_FRAMES)
+	{
+		frames++;
+	}
+	else if (fill + USB_AUDIO_SLACK_FRAMES < USB_AUDIO_TARGET_FRAMES)
+	{
+		frames--;
+	}
+	if (frames > USB_AUDIO_MAX_PACKET_FRAMES)
+	{
+		frames = USB_AUDIO_MAX_PACKET_FRAMES;
+	}
+	if (frames > fill)
+	{
+		// underrun, e.g. while the block size changes: wait for the target fill again
+		frames = fill;
+		priming = 1;
+	}
+
+	// the mirrored frames behind the ring end keep the packet contiguous. empty packets are valid isochronous packets
+	const uint32_t index = sent & (USB_AUDIO_RING_FRAMES - 1);
+	busy = 1;
+	HAL_PCD_EP_Transmit(hpcd, EP_AUDIO_IN, &ring[index * USB_AUDIO_FRAME_BYTES], frames * USB_AUDIO_FRAME_BYTES);
+	sent += frames;
+}
+
+void HAL_PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+	// the audio stream is the only isochronous endpoint
+	(void)epnum;
+	// the host didn't fetch the packet in its frame. these samples are lost, the next SOF queues the following ones
+	if (busy)
+	{
+		HAL_PCD_EP_Flush(hpcd, EP_AUDIO_IN);
+		busy = 0;
+	}
+}
+
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
+{
+	HAL_PCD_EP_Open(hpcd, 0x00, EP0_SIZE, EP_TYPE_CTRL);
+	HAL_PCD_EP_Open(hpcd, 0x80, EP0_SIZE, EP_TYPE_CTRL);
+	streaming = 0;
+	busy = 0;
+	configuration = 0;
+	alternate = 0;
+	ep0 = EP0_IDLE;
+	window_start = written;
+	window_sofs = 0;
+}
+
+void HAL_PCD_MspInit(PCD_HandleTypeDef *hpcd)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	RCC_PeriphCLKInitTypeDef PeriphClkInitStruct = {0};
+	if (hpcd->Instance == USB_OTG_FS)
+	{
+		/** Initializes the peripherals clock */
+		PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_USB;
+		PeriphClkInitStruct.UsbClockSelection = RCC_USBCLKSOURCE_HSI48;
+		if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct) != HAL_OK)
+		{
+			Error_Handler();
+		}
+		HAL_PWREx_EnableUSBVoltageDetector();
+
+		/**USB_OTG_FS GPIO Configuration
+			PA11     ------> USB_OTG_FS_DM
+			PA12     ------> USB_OTG_FS_DP
+		*/
+		__HAL_RCC_GPIOA_CLK_ENABLE();
+		GPIO_InitStruct.Pin = GPIO_PIN_11 | GPIO_PIN_12;
+		GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+		GPIO_InitStruct.Alternate = GPIO_AF10_OTG2_FS;
+		HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+		__HAL_RCC_USB2_OTG_FS_CLK_ENABLE();
+
+		// below the audio processing (PendSV): a block is never interrupted by the ring reader
+		HAL_NVIC_SetPriority(OTG_FS_IRQn, 2, 0);
+		HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+	}
+}
+
+void HAL_PCD_MspDeInit(PCD_HandleTypeDef *hpcd)
+{
+	if (hpcd->Instance == USB_OTG_FS)
+	{
+		__HAL_RCC_USB2_OTG_FS_CLK_DISABLE();
+		HAL_NVIC_DisableIRQ(OTG_FS_IRQn);
+		HAL_GPIO_DeInit(GPIOA, GPIO_PIN_11 | GPIO_PIN_12);
+	}
+}
+
+#endif // USB_AUDIO
@@ -0,0 +1,42 @@
+// usb_audio.h, Michael Haselberger
+// Description: This file contains declarations for the USB audio class 2.0 device implemented in usb_audio.c
+
+#ifndef __USB_AUDIO_H__
+#define __USB_AUDIO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "stm32h7xx_hal.h"
+#include "defines_and_constants.h"
+
+// streamed channels: 2 = chain output and dry input (re-amping), 1 = chain output only
+#define USB_AUDIO_CHANNELS (2)
+// 24 bit samples in 3 byte subslots, channels interleaved
+#define USB_AUDIO_SUBSLOT (3)
+#define USB_AUDIO_FRAME_BYTES (USB_AUDIO_CHANNELS * USB_AUDIO_SUBSLOT)
+// full speed: one packet per 1 ms frame, 48 sample frames nominally, one more to catch up with a faster I2S clock
+#define USB_AUDIO_PACKET_FRAMES (AUDIO_SAMPLE_RATE / 1000)
+#define USB_AUDIO_MAX_PACKET_FRAMES (USB_AUDIO_PACKET_FRAMES + 1)
+#define USB_AUDIO_MAX_PACKET (USB_AUDIO_MAX_PACKET_FRAMES * USB_AUDIO_FRAME_BYTES)
+// sample frames of the ring between the audio path and the IN endpoint (power of 2, 21 ms)
+#define USB_AUDIO_RING_FRAMES (1024)
+// fill level the packet sizes steer towards: the largest block plus two packets, so a packet never waits for a block
+#define USB_AUDIO_TARGET_FRAMES (MAX_BLOCK_SIZE + 2 * USB_AUDIO_PACKET_FRAMES)
+// the fill level swings by up to a block between two SOFs, packet sizes are only corrected outside of this band
+#define USB_AUDIO_SLACK_FRAMES (MAX_BLOCK_SIZE / 2 + USB_AUDIO_PACKET_FRAMES)
+// SOFs (ms) per measurement of the I2S sample rate
+#define USB_AUDIO_RATE_WINDOW (1024)
+
+extern PCD_HandleTypeDef hpcd_usb;
+
+uint8_t usb_audio_init(void);
+void usb_audio_tap(const sample_t *wet, const sample_t *dry, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __USB_AUDIO_H__
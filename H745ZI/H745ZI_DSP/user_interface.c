@@ -1,7 +1,13 @@
 // user_interface.c, Michael Haselberger
 // Description: This file contains all functions relevant to the user menu state machine. 
 
+#include <stdio.h>
+#include <string.h>
 #include "user_interface.h"
+#include "rtos.h"
+#include "dual_core.h"
+#include "trace.h"
+#include "mod_matrix.h"
 static enum menu_levels
 {
 	MENU_PT = 0,
@@ -9,15 +15,302 @@ static enum menu_levels
 	MENU_OD,
 	MENU_FUZZ,
 	MENU_TREM,
-	MENU_RM
+	MENU_RM,
+	MENU_FILTER,
+	MENU_CHORUS,
+	MENU_FLANGER,
+	MENU_REVERB,
+	MENU_EQ,
+	MENU_CAB,
+	MENU_GATE,
+	MENU_COMP,
+	MENU_PITCH,
+	MENU_WAH,
+	MENU_PHASER,
+	MENU_AMP,
+	MENU_FXLOOP,
+	MENU_DENOISE,
+	MENU_FREEZE,
+	MENU_PINGPONG
 } menu_levels;
+
+// items of the preset page
+#define PRESET_ITEM_RECALL (0)
+#define PRESET_ITEM_SAVE (1)
+// pitch shifter items
+#define PITCH_ITEM_SHIFT (1)
+// the Rate (Delay) item of the tempo synced effects and their Sync item
+#define ITEM_RATE (1)
+#define DELAY_ITEM_SYNC (4)
+#define DELAY_ITEM_DUCK (5)
+#define TREM_ITEM_SYNC (3)
+#define RM_ITEM_SYNC (4)
+// items of the Modulation page: Clear switches the route off, the others are stored in preset_t.mod
+#define MOD_ITEM_CLEAR (0)
+#define MOD_ITEM_SOURCE (1)
+#define MOD_ITEM_TARGET (2)
+#define MOD_ITEM_DEPTH (3)
+#define MOD_ITEM_RATE (4)
+// items of the Looper page: the entries in front of Level are the looper_state they request, carried out on a press
+#define LOOPER_ITEM_LEVEL (4)
+// item of the Amp model page that selects the model of the library (audio_select_amp)
+#define AMP_ITEM_MODEL (4)
+// sources of the Modulation page: off, then every mod_source
+#define MOD_MENU_SOURCES (MOD_SOURCES + 1)
+// targets of the Modulation page: plain smoothed parameters of the effect handles (see mod_destination_t), the ones
+// MIDI controls
+typedef enum
+{
+	MOD_TARGET_DELAY_FEEDBACK = 0,
+	MOD_TARGET_DELAY_BLEND,
+	MOD_TARGET_TREMOLO_DEPTH,
+	MOD_TARGET_CHORUS_RATE,
+	MOD_TARGET_CHORUS_DEPTH,
+	MOD_TARGET_CHORUS_BLEND,
+	MOD_TARGET_FLANGER_RATE,
+	MOD_TARGET_FLANGER_DEPTH,
+	MOD_TARGET_PITCH_BLEND,
+	MOD_TARGET_REVERB_BLEND,
+	MOD_TARGET_CAB_MIX,
+	MOD_TARGETS
+} mod_target;
 	
-// allows use of fx handles from main.c
-extern delay_handle_t delay_handle;
-extern fuzz_handle_t fuzz_handle;
-extern overdrive_handle_t overdrive_handle;
-extern tremolo_handle_t tremolo_handle;
-extern ring_mod_handle_t ring_mod_handle;
+#if defined(CORE_CM7)
+// allows use of the fx handles of fx_setup.c
+#include "fx_setup.h"
+#endif
+
+#if defined(UI_MENU_CORE)
+// time of the last button press (main.c of the core)
+extern volatile uint32_t btn_tick;
+
+// control events not handled yet (UI_EVENT_*), set by the interrupts of the controls
+static volatile uint32_t ui_events = 0;
+#endif
+
+// every parameter as last confirmed in the menu, plus the effect started last. this is what a save stores. with
+// CONTROL_M4 both cores keep it: the M4 for the saves, the M7 for the tempo and a new sample rate
+static preset_t live;
+static bool live_ready = false;
+
+static preset_t *live_preset(void)
+{
+	if (!live_ready)
+	{
+		preset_clear(&live);
+		live_ready = true;
+	}
+	return &live;
+}
+
+// where the confirmed value of a menu item is kept: the parameters of the effects and the items of the Modulation page.
+// NULL for items without a value
+static uint8_t *remembered(uint8_t fx, uint8_t item)
+{
+	if ((fx < PRESET_EFFECTS) && (item >= 1) && (item <= PRESET_PARAMETERS))
+		return &live_preset()->value[fx][item - 1];
+	if ((fx == MENU_MODULATION) && (item >= 1) && (item <= PRESET_MOD_ITEMS))
+		return &live_preset()->mod[item - 1];
+	return NULL;
+}
+
+// remember a confirmed value for the next preset save
+static void remember(uint8_t fx, uint8_t item, uint8_t value)
+{
+	uint8_t *slot = remembered(fx, item);
+	if (slot != NULL)
+		*slot = value;
+}
+
+// window of a menu value (0 to 100) among count choices, as the distortion quality and the modulator type
+static inline uint8_t window_of(uint8_t value, uint8_t count)
+{
+	return (uint8_t)(((uint16_t)value * count) / 101);
+}
+
+// Sync item of an effect, 0 if the effect isn't tempo synced
+static uint8_t sync_item(uint8_t fx)
+{
+	switch (fx)
+	{
+	case MENU_DELAY:
+		return DELAY_ITEM_SYNC;
+	case MENU_TREM:
+		return TREM_ITEM_SYNC;
+	case MENU_RM:
+		return RM_ITEM_SYNC;
+	default:
+		return 0;
+	}
+}
+
+#if defined(CORE_CM7)
+#if defined(LOOPER)
+// loopers of main.c, one per channel
+extern looper_handle_t looper_handle[AUDIO_CHANNELS];
+#endif
+#if defined(MOD_MATRIX)
+// modulation matrix of main.c, evaluated before the chain
+extern mod_matrix_t mod_matrix;
+// the route of the Modulation page changed: rebuilt by follow_modulation once the matrix is cleared
+static bool modulation_changed = false;
+
+// parameter of the target of the Modulation page (mod_target) on a channel. reverb and cabinet have one handle for
+// both channels, they are only routed on the first
+static volatile float32_t *modulated(uint8_t target, uint8_t ch)
+{
+	switch (target)
+	{
+	case MOD_TARGET_DELAY_FEEDBACK:
+		return &delay_handle[ch].feedback;
+	case MOD_TARGET_DELAY_BLEND:
+		return &delay_handle[ch].blend;
+	case MOD_TARGET_TREMOLO_DEPTH:
+		return &tremolo_handle[ch].depth;
+	case MOD_TARGET_CHORUS_RATE:
+		return &chorus_handle[ch].rate;
+	case MOD_TARGET_CHORUS_DEPTH:
+		return &chorus_handle[ch].depth;
+	case MOD_TARGET_CHORUS_BLEND:
+		return &chorus_handle[ch].blend;
+	case MOD_TARGET_FLANGER_RATE:
+		return &flanger_handle[ch].rate;
+	case MOD_TARGET_FLANGER_DEPTH:
+		return &flanger_handle[ch].depth;
+	case MOD_TARGET_PITCH_BLEND:
+		return &pitch_handle[ch].blend;
+	case MOD_TARGET_REVERB_BLEND:
+		return (ch == 0) ? &reverb_handle.blend : NULL;
+	case MOD_TARGET_CAB_MIX:
+		return (ch == 0) ? &cab_handle.mix : NULL;
+	default:
+		return NULL;
+	}
+}
+
+// remove the route of the Modulation page, the audio processing restores the parameters. the new one follows
+static void apply_modulation(void)
+{
+	mod_matrix_clear(&mod_matrix);
+	modulation_changed = true;
+}
+
+/******************************************************************************
+* Function Name: follow_modulation
+*******************************************************************************
+* Summary:
+*  Route the source of the Modulation page to its target on every channel, once the audio
+*  processing has removed the previous route (mod_matrix_clear). Depth -1 to 1 of the range
+*  of the parameter (50 -> none), the rate is the one of both LFOs. Items never changed
+*  leave the source off, the depth at none and the rate at half of MOD_LFO_MAX_RATE_HZ.
+*  Called from the main loop, next to follow_tempo.
+*
+* Parameters:
+*  None.
+* Return:
+*  None.
+*
+******************************************************************************/
+static void follow_modulation(void)
+{
+	if (!modulation_changed || mod_matrix.clear)
+	{
+		return;
+	}
+	modulation_changed = false;
+
+	const preset_t *p = live_preset();
+	const uint8_t source = p->mod[MOD_ITEM_SOURCE - 1];
+	if ((source == PRESET_UNSET) || (window_of(source, MOD_MENU_SOURCES) == 0))
+	{
+		return;
+	}
+	const uint8_t target = (p->mod[MOD_ITEM_TARGET - 1] == PRESET_UNSET) ? 0 : p->mod[MOD_ITEM_TARGET - 1];
+	const uint8_t depth = (p->mod[MOD_ITEM_DEPTH - 1] == PRESET_UNSET) ? 50 : p->mod[MOD_ITEM_DEPTH - 1];
+	const uint8_t rate = (p->mod[MOD_ITEM_RATE - 1] == PRESET_UNSET) ? 50 : p->mod[MOD_ITEM_RATE - 1];
+
+	mod_matrix_set_lfo(&mod_matrix, MOD_LFO1, OSC_SINE, MOD_LFO_MAX_RATE_HZ * ((float32_t)rate / 100.0f));
+	mod_matrix_set_lfo(&mod_matrix, MOD_LFO2, OSC_TRIANGLE, MOD_LFO_MAX_RATE_HZ * ((float32_t)rate / 100.0f));
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		volatile float32_t *parameter = modulated(window_of(target, MOD_TARGETS), ch);
+		uint8_t route;
+		if (parameter != NULL)
+			mod_matrix_connect(&mod_matrix, window_of(source, MOD_MENU_SOURCES) - 1, parameter,
+				((float32_t)depth - 50.0f) / 50.0f, 0.0f, 1.0f, &route);
+	}
+}
+#endif
+
+/******************************************************************************
+* Function Name: apply_tempo
+*******************************************************************************
+* Summary:
+*  Set the delay time or LFO rate of a tempo synced effect: the note value selected with its
+*  Sync item at the current tempo, or the Rate item as set in the menu, if Sync is off. Note
+*  values longer than the delay line holds are halved until they fit (same rhythm, faster
+*  repeats). Called when either item is confirmed and whenever the tempo changes.
+*
+* Parameters:
+*  1. uint8_t fx					- Effect (menu_levels). Effects without Sync item are ignored.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+static void apply_tempo(uint8_t fx)
+{
+	const uint8_t item = sync_item(fx);
+	if (item == 0)
+	{
+		return;
+	}
+	const preset_t *p = live_preset();
+	const tempo_division division = tempo_division_from_value(p->value[fx][item - 1]);
+	const uint8_t rate = p->value[fx][ITEM_RATE - 1];
+	// never set in the menu and not synced: the init value stays
+	if ((division == TEMPO_FREE) && (rate == PRESET_UNSET))
+	{
+		return;
+	}
+
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		switch (fx)
+		{
+		case MENU_DELAY:
+			{
+				float32_t ms = MAX_DELAY_TIME * ((float32_t)rate / 100.0f);
+				if (division != TEMPO_FREE)
+				{
+					ms = tempo_division_ms(division);
+					while (ms > MAX_DELAY_TIME)
+						ms *= 0.5f;
+				}
+				delay_update(&delay_handle[ch], DELAY, ms);
+			}
+			break;
+		case MENU_TREM:
+			tremolo_update(&tremolo_handle[ch], RATE, (division == TEMPO_FREE)
+				? ((float32_t)rate / 100.0f) : fminf(tempo_division_hz(division) / TREMOLO_MAX_RATE_HZ, 1.0f));
+			break;
+		case MENU_RM:
+			ring_mod_update(&ring_mod_handle[ch], RATE, NO_CHANGE, (division == TEMPO_FREE)
+				? ((float32_t)rate / 100.0f) : fminf(tempo_division_hz(division) / RING_MOD_MAX_RATE_HZ, 1.0f));
+			break;
+		}
+	}
+}
+
+// shaping of the distortion effects as value windows, like the modulation type of the ring modulator
+static distortion_quality quality_of(uint16_t cnt)
+{
+	if (cnt < 33)
+		return DISTORTION_LUT;
+	else if (cnt < 66)
+		return DISTORTION_ADAA;
+	return DISTORTION_OVERSAMPLED;
+}
 
 /******************************************************************************
 * Function Name: confirm_value
@@ -40,57 +333,825 @@ extern ring_mod_handle_t ring_mod_handle;
 #pragma optimize_for_speed
 void confirm_value(menu_t* menu)
 {
-	switch (menu->sub_menu_selected)
+	// remembered for the next preset save
+	remember(menu->sub_menu_selected, menu->item_selected, (uint8_t)menu->cnt);
+#if defined(MOD_MATRIX)
+	if (menu->sub_menu_selected == MENU_MODULATION)
 	{
-	case MENU_DELAY:
-		if (menu->item_selected == 1)
-			delay_update(&delay_handle, DELAY, MAX_DELAY_TIME * ((float32_t)menu->cnt / 100.0f));
-		// feedback and blend both have same value range. delay fx enums integer values are 1 below item_selected equivalent
-		else
-			delay_update(&delay_handle, menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+		apply_modulation();
+		return;
+	}
+#endif
+
+	// every channel has its own effect handles (dual mono), they always share the same parameters
+	for (uint8_t ch = 0; ch < AUDIO_CHANNELS; ++ch)
+	{
+		switch (menu->sub_menu_selected)
+		{
+		case MENU_DELAY:
+			// feedback and blend both have same value range. delay fx enums integer values are 1 below item_selected equivalent.
+			// delay time and sync are set by apply_tempo. duck: how far the repeats go down while the guitar plays
+			if (menu->item_selected == DELAY_ITEM_DUCK)
+				delay_update(&delay_handle[ch], DUCK, ((float32_t)menu->cnt / 100.0f));
+			else if ((menu->item_selected != ITEM_RATE) && (menu->item_selected != DELAY_ITEM_SYNC))
+				delay_update(&delay_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_OD:
+			if (menu->item_selected == 1)
+				overdrive_update(&overdrive_handle[ch], 0.4f * ((float32_t)menu->cnt / 100.0f));
+			else
+				overdrive_set_quality(&overdrive_handle[ch], quality_of(menu->cnt));
+			break;
+		case MENU_FUZZ:
+			if (menu->item_selected == 1)
+				fuzz_update(&fuzz_handle[ch], GAIN, 18.0f * ((float32_t)menu->cnt / 100.0f));
+			else if (menu->item_selected == 2)
+				fuzz_update(&fuzz_handle[ch], MIX, ((float32_t)menu->cnt / 100.0f));
+			else
+				fuzz_set_quality(&fuzz_handle[ch], quality_of(menu->cnt));
+			break;
+		case MENU_TREM:
+			// rate and sync are set by apply_tempo
+			if (menu->item_selected == 2)
+				tremolo_update(&tremolo_handle[ch], DEPTH, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_RM:
+			if (menu->item_selected == 2)
+				// update blend. modulation type stays the same, rate and sync are set by apply_tempo
+				ring_mod_update(&ring_mod_handle[ch], DEPTH, NO_CHANGE, ((float32_t)menu->cnt / 100.0f));
+			else if (menu->item_selected == 3)
+			{	
+				// updating the modulation type needs some differentiation. due to the simplified UI and only displaying values
+				// as 0 to 100, modulation type is going to be defined as certain value windows.
+				// the parameter value is passed as 255 to trigger the default case in the update function -> stays as it is
+				if (menu->cnt < 25)
+					ring_mod_update(&ring_mod_handle[ch], menu->item_selected - 1, SINE, 255);
+				else if (menu->cnt < 50)
+					ring_mod_update(&ring_mod_handle[ch], menu->item_selected - 1, TRIANGLE, 255);
+				else if (menu->cnt < 75)
+					ring_mod_update(&ring_mod_handle[ch], menu->item_selected - 1, SQUARE, 255);
+				else
+					ring_mod_update(&ring_mod_handle[ch], menu->item_selected - 1, SAW, 255);
+			}
+			break;
+		case MENU_CHORUS:
+			chorus_update(&chorus_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_FLANGER:
+			// feedback has to stay below 1, otherwise the comb filter becomes unstable
+			if (menu->item_selected == 3)
+				flanger_update(&flanger_handle[ch], FLANGER_FEEDBACK, 0.95f * ((float32_t)menu->cnt / 100.0f));
+			else
+				flanger_update(&flanger_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_REVERB:
+			// blend and shimmer (REVERB_FDN only) in the item order
+			reverb_update(&reverb_handle, menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_EQ:
+			// band gains from -12 dB to +12 dB (50 -> flat), the mid frequency from 200 Hz to 5 kHz on a logarithmic scale
+			if (menu->item_selected == 4)
+				eq_update(&eq_handle[ch], EQ_MID_FREQUENCY, 200.0f * powf(25.0f, (float32_t)menu->cnt / 100.0f));
+			else
+				eq_update(&eq_handle[ch], menu->item_selected - 1, 24.0f * ((float32_t)menu->cnt / 100.0f) - 12.0f);
+			break;
+		case MENU_CAB:
+			cab_update(&cab_handle, CAB_MIX, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_GATE:
+			// threshold from -80 dBFS to -20 dBFS, release from 10 ms to 500 ms, key: the sidechain from 50 on
+			if (menu->item_selected == 1)
+				gate_update(&gate_handle[ch], GATE_THRESHOLD, 60.0f * ((float32_t)menu->cnt / 100.0f) - 80.0f);
+			else if (menu->item_selected == 2)
+				gate_update(&gate_handle[ch], GATE_RELEASE, 10.0f + 490.0f * ((float32_t)menu->cnt / 100.0f));
+			else
+				gate_update(&gate_handle[ch], GATE_KEY, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_COMP:
+			// threshold from -60 dBFS to 0 dBFS, ratio from 1 to 20, makeup gain from 0 dB to 24 dB, key as the gate's
+			if (menu->item_selected == 1)
+				comp_update(&comp_handle[ch], COMP_THRESHOLD, 60.0f * ((float32_t)menu->cnt / 100.0f) - 60.0f);
+			else if (menu->item_selected == 2)
+				comp_update(&comp_handle[ch], COMP_RATIO, 1.0f + 19.0f * ((float32_t)menu->cnt / 100.0f));
+			else if (menu->item_selected == 3)
+				comp_update(&comp_handle[ch], COMP_MAKEUP, 24.0f * ((float32_t)menu->cnt / 100.0f));
+			else
+				comp_update(&comp_handle[ch], COMP_KEY, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_PITCH:
+			// shift in whole semitones from -12 to +12 (50 -> unison)
+			if (menu->item_selected == PITCH_ITEM_SHIFT)
+				pitch_update(&pitch_handle[ch], PITCH_SHIFT, roundf(2.0f * PITCH_MAX_SEMITONES * ((float32_t)menu->cnt / 100.0f)) - PITCH_MAX_SEMITONES);
+			else
+				pitch_update(&pitch_handle[ch], PITCH_BLEND, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_WAH:
+			// sensitivity, resonance, rate (0: envelope) and mix in the item order
+			wah_update(&wah_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_PHASER:
+			// rate, depth, stages (4, 8, 12) and mix in the item order
+			phaser_update(&phaser_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_AMP:
+			// input, level and mix in the item order. the model by its number (0: none), shared by the channels
+			if (menu->item_selected == AMP_ITEM_MODEL)
+			{
+				if (ch == 0)
+					audio_select_amp((uint8_t)menu->cnt);
+			}
+			else
+				amp_update(&amp_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_FXLOOP:
+			// mix and latency in the item order
+			fxloop_update(&fxloop_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_DENOISE:
+			// amount and sensitivity in the item order
+			denoise_update(&denoise_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_FREEZE:
+			// hold (from 50 on) and blend in the item order
+			freeze_update(&freeze_handle[ch], menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		case MENU_LOOPER:
+			// stop, record, play and overdub on a press (the item is the state), the level as a value
+#if defined(LOOPER)
+			if (menu->item_selected < LOOPER_ITEM_LEVEL)
+				looper_command(&looper_handle[ch], (looper_state)menu->item_selected);
+			else
+				looper_set_level(&looper_handle[ch], ((float32_t)menu->cnt / 100.0f));
+#endif
+			break;
+		case MENU_PINGPONG:
+			// time up to PINGPONG_MAX_TIME per side, feedback has to stay below 1 as with the flanger
+			if (menu->item_selected == 1)
+				pingpong_update(&pingpong_handle, PINGPONG_TIME, PINGPONG_MAX_TIME * ((float32_t)menu->cnt / 100.0f));
+			else if (menu->item_selected == 2)
+				pingpong_update(&pingpong_handle, PINGPONG_FEEDBACK, 0.95f * ((float32_t)menu->cnt / 100.0f));
+			else
+				pingpong_update(&pingpong_handle, menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+			break;
+		}
+	}
+
+	if ((menu->item_selected == ITEM_RATE) || (menu->item_selected == sync_item(menu->sub_menu_selected)))
+		apply_tempo(menu->sub_menu_selected);
+}
+
+// replay every parameter stored in a preset through confirm_value, as if it was set in the menu
+static void replay_values(const preset_t *preset)
+{
+	menu_t replay = { 0 };
+	for (uint8_t fx = 1; fx < PRESET_EFFECTS; ++fx)
+	{
+		for (uint8_t p = 0; p < PRESET_PARAMETERS; ++p)
+		{
+			if (preset->value[fx][p] == PRESET_UNSET)
+				continue;
+			replay.sub_menu_selected = fx;
+			replay.item_selected = p + 1;
+			replay.cnt = preset->value[fx][p];
+			confirm_value(&replay);
+		}
+	}
+	// the Modulation page as a whole: a record without it leaves the route off
+	replay.sub_menu_selected = MENU_MODULATION;
+	for (uint8_t item = 0; item < PRESET_MOD_ITEMS; ++item)
+	{
+		replay.item_selected = item + 1;
+		replay.cnt = preset->mod[item];
+		confirm_value(&replay);
+	}
+}
+
+// a new tempo (tap or MIDI clock) moves the synced effects along
+static void follow_tempo(void)
+{
+	static uint32_t tempo_applied = 0;
+	if (tempo_version() != tempo_applied)
+	{
+		tempo_applied = tempo_version();
+		apply_tempo(MENU_DELAY);
+		apply_tempo(MENU_TREM);
+		apply_tempo(MENU_RM);
+	}
+}
+
+/******************************************************************************
+* Function Name: fill_status
+*******************************************************************************
+* Summary:
+*  Collect what the pages of the menu show: block size, latency, sample rate and tempo, the
+*  profiler statistics of the active effect and the results of the tuner, the meter and the
+*  latency measurement.
+*
+* Parameters:
+*  1. control_status_t *status		- Filled in. The MIDI program fields are left as they are.
+*  2. uint8_t mode					- Active effect mode.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+static void fill_status(control_status_t *status, uint8_t mode)
+{
+	const audio_stats_t *stats = audio_get_stats();
+
+	status->block_size = audio_get_block_size();
+	status->sample_rate = audio_get_sample_rate();
+	status->latency = audio_get_latency();
+	status->bpm = tempo_bpm();
+	status->tempo_version = tempo_version();
+	status->overruns = stats->overruns;
+	status->errors = stats->dma_errors + stats->i2s_errors;
+	const audio_admission_t *admission = audio_get_admission();
+	status->admission_count = admission->count;
+	status->admission_fx = admission->fx;
+	status->admission_quality = admission->quality;
+	status->admission_mode = admission->mode;
+	status->load_valid = false;
+#if defined(PROFILER)
+	const profile_mode_t *p = profiler_get(mode);
+	const profile_stats_t *total = (p) ? &p->section[PROFILE_TOTAL] : NULL;
+	if ((total != NULL) && (total->count > 0))
+	{
+		status->load_valid = true;
+		status->load_avg = profiler_load((uint32_t)(total->sum / total->count));
+		status->load_max = profiler_load(total->max);
+		status->deadline_misses = p->deadline_misses;
+		status->clips = p->clips;
+	}
+#else
+	(void)mode;
+#endif
+#if defined(TUNER)
+	status->tuner = *tuner_result();
+	strncpy(status->note_name, tuner_note_name(status->tuner.note), sizeof(status->note_name) - 1);
+	status->note_name[sizeof(status->note_name) - 1] = '\0';
+#endif
+#if defined(TELEMETRY)
+	status->meter = *telemetry_get();
+#endif
+#if defined(LATENCY_PROBE)
+	status->latency_running = audio_latency_running();
+	const latency_result_t *r = latency_probe_result(status->block_size, LATENCY_MLS);
+	if (r != NULL)
+		status->round_trip = *r;
+	else
+		status->round_trip.status = LATENCY_NOT_MEASURED;
+#endif
+}
+
+/******************************************************************************
+* Function Name: execute
+*******************************************************************************
+* Summary:
+*  Carry out a change of the menu on the audio side: a confirmed value, the effect to start, the
+*  block size or sample rate, a tap of the tempo and the page functions (tuner, latency sweep,
+*  profiler reset).
+*
+* Parameters:
+*  1. const control_command_t *command - The change (control_link.h).
+*  2. uint8_t* mode					- Pointer to the variable that's responsible for effect selection.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+static void execute(const control_command_t *command, uint8_t *mode)
+{
+	TRACE_EVENT(TRACE_COMMAND + command->type);
+	switch (command->type)
+	{
+	case CONTROL_VALUE:
+		{
+			menu_t value = { 0 };
+			value.sub_menu_selected = command->fx;
+			value.item_selected = command->item;
+			value.cnt = (uint16_t)command->value;
+			confirm_value(&value);
+		}
 		break;
-	case MENU_OD:
-		overdrive_update(&overdrive_handle, 0.4f * ((float32_t)menu->cnt / 100.0f));
+	case CONTROL_MODE:
+		if (command->value < PRESET_EFFECTS)
+		{
+			*mode = (uint8_t)command->value;
+			live_preset()->mode = (uint8_t)command->value;
+		}
 		break;
-	case MENU_FUZZ:
-		if (menu->item_selected == 1)
-			fuzz_update(&fuzz_handle, GAIN, 18.0f * ((float32_t)menu->cnt / 100.0f));
-		else
-			fuzz_update(&fuzz_handle, MIX, ((float32_t)menu->cnt / 100.0f));
+	case CONTROL_BLOCK_SIZE:
+		audio_set_block_size((uint16_t)command->value);
 		break;
-	case MENU_TREM:
-		tremolo_update(&tremolo_handle, menu->item_selected - 1, ((float32_t)menu->cnt / 100.0f));
+	case CONTROL_SAMPLE_RATE:
+		// the effects start over with their init values, the values set in the menu follow
+		if (audio_set_sample_rate(command->value) == 0)
+			replay_values(live_preset());
 		break;
-	case MENU_RM:
-		if (menu->item_selected != 3)
-			// update selected parameter. modulation type stays the same
-			ring_mod_update(&ring_mod_handle, menu->item_selected - 1, NO_CHANGE, ((float32_t)menu->cnt / 100.0f));
+	case CONTROL_TAP:
+		tempo_tap(command->value);
+		break;
+	case CONTROL_TUNER:
+#if defined(TUNER)
+		tuner_enable(command->value ? true : false);
+#endif
+		break;
+	case CONTROL_LATENCY:
+#if defined(LATENCY_PROBE)
+		if (command->value)
+			audio_latency_start();
 		else
-		{	
-			// updating the modulation type needs some differentiation. due to the simplified UI and only displaying values
-			// as 0 to 100, modulation type is going to be defined as certain value windows.
-			// the parameter value is passed as 255 to trigger the default case in the update function -> stays as it is
-			if (menu->cnt < 33)
-				ring_mod_update(&ring_mod_handle, menu->item_selected - 1, SINE, 255);
-			else if (menu->cnt < 66)
-				ring_mod_update(&ring_mod_handle, menu->item_selected - 1, TRIANGLE, 255);
-			else				
-				ring_mod_update(&ring_mod_handle, menu->item_selected - 1, SQUARE, 255);				
-		}
+			audio_latency_stop();
+#endif
+		break;
+	case CONTROL_PROFILER_RESET:
+#if defined(PROFILER)
+		profiler_reset();
+#endif
 		break;
 	}
 }
 
+/******************************************************************************
+* Function Name: ui_execute
+*******************************************************************************
+* Summary:
+*  A change from another control surface than the menu (HOST_LINK): a value is remembered for
+*  the next preset save as a confirmed menu value, then carried out like a change of the menu.
+*
+* Parameters:
+*  1. const control_command_t *command - The change (control_link.h).
+*  2. uint8_t* mode					- Pointer to the variable that's responsible for effect selection.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+void ui_execute(const control_command_t *command, uint8_t *mode)
+{
+	if (command->type == CONTROL_VALUE)
+	{
+		remember(command->fx, command->item, (uint8_t)command->value);
+	}
+	execute(command, mode);
+}
+
+// last confirmed value of a menu item, PRESET_UNSET if it has its init value
+uint8_t ui_value(uint8_t fx, uint8_t item)
+{
+	const uint8_t *slot = remembered(fx, item);
+	return (slot != NULL) ? *slot : PRESET_UNSET;
+}
+
+#if defined(CONTROL_M4)
+// MIDI program changes for the M4, which owns the presets
+static uint8_t program = 0;
+static uint32_t program_count = 0;
+
+/******************************************************************************
+* Function Name: apply_preset
+*******************************************************************************
+* Summary:
+*  The presets belong to the M4 with CONTROL_M4: the slot is passed on with the next status, the
+*  M4 recalls it and sends the values and the mode back as commands (see ui_serve).
+*
+* Parameters:
+*  1. uint8_t slot					- Preset slot. Range: 0 <= slot < PRESET_SLOTS.
+*  2. uint8_t* mode					- Unused, the mode follows as a command.
+* 
+* Return:
+*  255:								- Unknown slot.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t apply_preset(uint8_t slot, uint8_t* mode)
+{
+	(void)mode;
+	if (slot >= PRESET_SLOTS)
+	{
+		return 255;
+	}
+	program = slot;
+	program_count++;
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: ui_serve
+*******************************************************************************
+* Summary:
+*  The M7 side of the menu on the M4: apply the commands sent since the last pass, follow a new
+*  tempo and publish the status for the pages after commands and every CONTROL_STATUS_PERIOD ms.
+*  Call from the main loop (or the UI task) instead of display_menu.
+*
+* Parameters:
+*  1. uint8_t* mode					- Pointer to the variable that's responsible for effect selection.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+void ui_serve(uint8_t* mode)
+{
+	static control_status_t status;
+	static uint32_t published = 0;
+	control_link_t *link = &DUAL_CORE_MAILBOX->control;
+
+	control_command_t command;
+	bool changed = false;
+	while (control_link_receive(link, &command))
+	{
+		execute(&command, mode);
+		changed = true;
+	}
+	follow_tempo();
+#if defined(MOD_MATRIX)
+	follow_modulation();
+#endif
+
+	if (changed || (program_count != status.program_count) || ((HAL_GetTick() - published) >= CONTROL_STATUS_PERIOD))
+	{
+		published = HAL_GetTick();
+		fill_status(&status, *mode);
+		status.program = program;
+		status.program_count = program_count;
+		control_link_publish(link, &status);
+	}
+}
+#endif // CONTROL_M4
+#endif // CORE_CM7
+
+#if defined(UI_MENU_CORE)
+// what the Source and Target items of the Modulation page show, in the order of their value windows
+static const char *const mod_source_names[MOD_MENU_SOURCES] = { "Off", "LFO sine", "LFO triangle", "Envelope", "MIDI CC",
+	"Expression", "Pedal" };
+static const char *const mod_target_names[MOD_TARGETS] = { "Delay feedback", "Delay blend", "Trem depth", "Chorus rate",
+	"Chorus depth", "Chorus blend", "Flanger rate", "Flanger depth", "Pitch blend", "Reverb blend", "Cabinet mix" };
+
+// row of the menu entries shown: the top level, or the page of the effect (one row below its menu_levels index)
+static inline uint8_t row_of(const menu_t *menu)
+{
+	return (menu->menu_depth == 0) ? 0 : (uint8_t)(menu->sub_menu_selected + 1);
+}
+
+// what the pages show: the snapshot the M7 published with CONTROL_M4, otherwise collected here, once per ms or after an
+// input (refresh)
+static const control_status_t *current_status(uint8_t mode, bool refresh)
+{
+#if defined(CONTROL_M4)
+	(void)mode;
+	(void)refresh;
+	return control_link_status(&DUAL_CORE_MAILBOX->control);
+#else
+	static control_status_t status;
+	static uint32_t filled = 0;
+	if (refresh || (HAL_GetTick() != filled))
+	{
+		filled = HAL_GetTick();
+		fill_status(&status, mode);
+	}
+	return &status;
+#endif
+}
+
+// hand a change of the menu to the audio side: carried out right away, or queued for the M7 with CONTROL_M4
+static void request(control_type type, uint8_t fx, uint8_t item, uint32_t value, uint8_t *mode)
+{
+	if (type == CONTROL_VALUE)
+	{
+		remember(fx, item, (uint8_t)value);
+	}
+	else if ((type == CONTROL_MODE) && (value < PRESET_EFFECTS))
+	{
+		*mode = (uint8_t)value;
+		live_preset()->mode = (uint8_t)value;
+	}
+#if defined(CONTROL_M4)
+	control_link_send(&DUAL_CORE_MAILBOX->control, type, fx, item, value);
+#else
+	const control_command_t command = { .type = (uint8_t)type, .fx = fx, .item = item, .value = value };
+	execute(&command, mode);
+#endif
+}
+
+/******************************************************************************
+* Function Name: apply_preset
+*******************************************************************************
+* Summary:
+*  Recall a preset from flash and pass every stored parameter on, as if it was set in the menu,
+*  then start the stored effect. Parameters the preset doesn't contain keep their current value.
+*  Call from the main loop (e.g. at start-up after preset_init).
+*
+* Parameters:
+*  1. uint8_t slot					- Preset slot. Range: 0 <= slot < PRESET_SLOTS.
+*  2. uint8_t* mode					- Pointer to the variable that's responsible for effect selection.
+* 
+* Return:
+*  See preset_recall.
+*
+******************************************************************************/
+uint8_t apply_preset(uint8_t slot, uint8_t* mode)
+{
+	preset_t preset;
+	const uint8_t result = preset_recall(slot, &preset);
+	if (result != 0)
+	{
+		return result;
+	}
+
+	for (uint8_t fx = 1; fx < PRESET_EFFECTS; ++fx)
+	{
+		for (uint8_t p = 0; p < PRESET_PARAMETERS; ++p)
+		{
+			if (preset.value[fx][p] != PRESET_UNSET)
+				request(CONTROL_VALUE, fx, p + 1, preset.value[fx][p], mode);
+		}
+	}
+	// the Modulation page as a whole, see replay_values
+	for (uint8_t item = 0; item < PRESET_MOD_ITEMS; ++item)
+		request(CONTROL_VALUE, MENU_MODULATION, item + 1, preset.mod[item], mode);
+	live_preset()->mode = preset.mode;
+	if (preset.mode < PRESET_EFFECTS)
+		request(CONTROL_MODE, 0, 0, preset.mode, mode);
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: draw_load_page
+*******************************************************************************
+* Summary:
+*  Write the profiler statistics of the active effect into the LCD framebuffer:
+*  average and maximum share of the block budget on the first row, blocks over budget
+*  (deadline misses), DMA overruns, DMA/I2S errors and output segments caught by the limiter
+*  on the second row.
+*
+* Parameters:
+*  1. const control_status_t *s		- Status of the audio side.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+static void draw_load_page(const control_status_t *s)
+{
+	char row[LCD_COLS + 1];
+
+	lcd_fb_clear();
+#if defined(PROFILER)
+	if (!s->load_valid)
+	{
+		lcd_fb_write(0, 0, "Load: no data");
+		return;
+	}
+
+	snprintf(row, sizeof(row), "%lu.%lu/%lu.%lu%%", (unsigned long)(s->load_avg / 10), (unsigned long)(s->load_avg % 10),
+		(unsigned long)(s->load_max / 10), (unsigned long)(s->load_max % 10));
+	lcd_fb_write(0, 0, row);
+	snprintf(row, sizeof(row), "M%lu O%lu E%lu C%lu", (unsigned long)s->deadline_misses, (unsigned long)s->overruns,
+		(unsigned long)s->errors, (unsigned long)s->clips);
+	lcd_fb_write(1, 0, row);
+#else
+	lcd_fb_write(0, 0, "Load: disabled");
+	snprintf(row, sizeof(row), "Ovr%lu Err%lu", (unsigned long)s->overruns, (unsigned long)s->errors);
+	lcd_fb_write(1, 0, row);
+#endif
+}
+
+/******************************************************************************
+* Function Name: draw_tuner_page
+*******************************************************************************
+* Summary:
+*  Write the last tuner result into the LCD framebuffer: note and frequency on the first row,
+*  the deviation in cents and a needle (one step per 10 cents) on the second row. The TFT
+*  (DISPLAY_TFT) draws the needle below with one pixel step per cent or less.
+*
+* Parameters:
+*  1. const control_status_t *s		- Status of the audio side.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+static void draw_tuner_page(const control_status_t *s)
+{
+	lcd_fb_clear();
+#if defined(TUNER)
+	char row[LCD_COLS + 1];
+	const tuner_result_t *r = &s->tuner;
+	if (r->frequency <= 0.0f)
+	{
+		lcd_fb_write(0, 0, "Tuner: --");
+#if defined(DISPLAY_TFT)
+		tft_tuner(0, false);
+#endif
+		return;
+	}
+
+	const uint32_t hz = (uint32_t)(r->frequency * 10.0f + 0.5f);
+	snprintf(row, sizeof(row), "%s%d %lu.%luHz", s->note_name, (int)(r->note / 12) - 1,
+		(unsigned long)(hz / 10), (unsigned long)(hz % 10));
+	lcd_fb_write(0, 0, row);
+	// -50 ... +50 cents on 11 positions, the middle one is in tune
+	char needle[12] = "-----|-----";
+	const int8_t position = 5 + (r->cents + ((r->cents < 0) ? -5 : 5)) / 10;
+	needle[(position < 0) ? 0 : ((position > 10) ? 10 : position)] = (r->cents == 0) ? '|' : '*';
+	snprintf(row, sizeof(row), "%+3dc %s", (int)r->cents, needle);
+	lcd_fb_write(1, 0, row);
+#if defined(DISPLAY_TFT)
+	// the needle below the rows, with the resolution of the panel
+	tft_tuner(r->cents, true);
+#endif
+#else
+	(void)s;
+	lcd_fb_write(0, 0, "Tuner: disabled");
+#endif
+}
+
+/******************************************************************************
+* Function Name: draw_meter_page
+*******************************************************************************
+* Summary:
+*  Write the last output levels into the LCD framebuffer: RMS and peak on the first row, the
+*  spectrum on the second row, one column per two bands (the louder one) in 12 dB steps. The
+*  TFT (DISPLAY_TFT) shows every band as a bar below.
+*
+* Parameters:
+*  1. const control_status_t *s		- Status of the audio side.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+static void draw_meter_page(const control_status_t *s)
+{
+	lcd_fb_clear();
+#if defined(TELEMETRY)
+	static const char bars[] = " .:+#";
+	char row[LCD_COLS + 1];
+	const telemetry_t *t = &s->meter;
+
+	snprintf(row, sizeof(row), "R%d P%d dB", (int)t->rms, (int)t->peak);
+	lcd_fb_write(0, 0, row);
+	for (uint8_t c = 0; c < LCD_COLS; ++c)
+	{
+		// -60 dB and below: empty. every 12 dB above one step more
+		const float32_t level = fmaxf(t->band[2 * c], t->band[2 * c + 1]);
+		const int32_t step = (int32_t)((level + 60.0f) / 12.0f) + ((level > -60.0f) ? 1 : 0);
+		row[c] = bars[(step < 0) ? 0 : ((step > 4) ? 4 : step)];
+	}
+	row[LCD_COLS] = '\0';
+	lcd_fb_write(1, 0, row);
+#if defined(DISPLAY_TFT)
+	// every band as a bar below the rows
+	tft_meter(t->band, TELEMETRY_BANDS);
+#endif
+#else
+	(void)s;
+	lcd_fb_write(0, 0, "Meter: disabled");
+#endif
+}
+
+/******************************************************************************
+* Function Name: draw_latency_page
+*******************************************************************************
+* Summary:
+*  Write the latency measurement into the LCD framebuffer: the block size on the first row
+*  (measured right now while the sweep runs), the round trip of the sequence measured for it
+*  in samples and ms on the second row. The whole table goes out over SWO.
+*
+* Parameters:
+*  1. const control_status_t *s		- Status of the audio side.
+* 
+* Return:
+*  None.
+*
+******************************************************************************/
+static void draw_latency_page(const control_status_t *s)
+{
+	lcd_fb_clear();
+#if defined(LATENCY_PROBE)
+	char row[LCD_COLS + 1];
+	snprintf(row, sizeof(row), "%s n=%u", s->latency_running ? "Measure" : "Latency", (unsigned)s->block_size);
+	lcd_fb_write(0, 0, row);
+
+	const latency_result_t *r = &s->round_trip;
+	if (r->status == LATENCY_NOT_MEASURED)
+	{
+		lcd_fb_write(1, 0, "--");
+	}
+	else if (r->status == LATENCY_OK)
+	{
+		// 0.01 ms
+		const uint32_t ms = (r->microseconds + 5) / 10;
+		snprintf(row, sizeof(row), "%lu smp %lu.%02lums", (unsigned long)r->samples, (unsigned long)(ms / 100), (unsigned long)(ms % 100));
+		lcd_fb_write(1, 0, row);
+	}
+	else
+	{
+		lcd_fb_write(1, 0, (r->status == LATENCY_LOST) ? "block lost" : "no loopback");
+	}
+#else
+	(void)s;
+	lcd_fb_write(0, 0, "Latency disabled");
+#endif
+}
+
+/******************************************************************************
+* Function Name: draw_admission_notice
+*******************************************************************************
+* Summary:
+*  Write the last report of the admission check into the LCD framebuffer: the effect on the
+*  first row, on the second that it wasn't started or the quality the distortion runs at.
+*
+* Parameters:
+*  1. const control_status_t *s		- Status of the audio side.
+*  2. const char *name				- Menu entry of the effect.
+*
+* Return:
+*  None.
+*
+******************************************************************************/
+static void draw_admission_notice(const control_status_t *s, const char *name)
+{
+	static const char *const qualities[] = { "LUT", "ADAA", "oversampled" };
+	lcd_fb_clear();
+	lcd_fb_write(0, 0, name);
+	if (s->admission_quality < (sizeof(qualities) / sizeof(qualities[0])))
+	{
+		char row[LCD_COLS + 1];
+		snprintf(row, sizeof(row), "Quality: %s", qualities[s->admission_quality]);
+		lcd_fb_write(1, 0, row);
+	}
+	else
+	{
+		lcd_fb_write(1, 0, "Not started");
+	}
+}
+
+/******************************************************************************
+* Function Name: ui_post
+*******************************************************************************
+* Summary:
+*  Report an input of the controls, from their interrupts (encoder capture, button EXTI). All
+*  of them run at the same priority, so they never interrupt each other here.
+*
+* Parameters:
+*  1. uint32_t events				- UI_EVENT_* flags.
+* Return:
+*  None.
+*
+******************************************************************************/
+void ui_post(uint32_t events)
+{
+	TRACE_EVENT(TRACE_UI_INPUT + (events & 0x07));
+	ui_events |= events;
+#if defined(RTOS) && defined(CORE_CM7)
+	// the UI task handles them at once instead of with its next periodic pass
+	rtos_ui_from_isr();
+#endif
+}
+
+// take the pending events in one step, so an event is neither lost nor handled twice. main loop only
+uint32_t ui_take_events(void)
+{
+	__disable_irq();
+	const uint32_t events = ui_events;
+	ui_events = 0;
+	__enable_irq();
+	return events;
+}
+
+// number of entries of a (sub) menu. the rows of the menu table are padded with empty strings
+static uint8_t item_count(const char items[MAX_ITEM_COUNT][MAX_ITEM_SIZE])
+{
+	uint8_t n = 0;
+	while ((n < MAX_ITEM_COUNT) && (items[n][0] != '\0'))
+		++n;
+	return n;
+}
+
+// move the encoder counter, e.g. to the value a parameter had. no event: it isn't a rotation
+static void set_counter(menu_t *menu, uint16_t value)
+{
+	TIM2->CNT = value;
+	menu->cnt = value;
+	menu->past_cnt = value;
+}
+
 /******************************************************************************
 * Function Name: display_menu
 *******************************************************************************
 * Summary:
 *  This function handles the user menu state machine. It is responsible for displaying the correct
 *  strings on the LCD and parsing user input button presses to navigate the menu and update 
-*  effect modes/parameters.
+*  effect modes/parameters. Event driven: the encoder counter is only read after it moved, and
+*  the screen is only redrawn after an input or a change of what it shows (tempo, statistics,
+*  tuner and meter results). A pass without any of them costs a few comparisons.
 *
 * Parameters:
-*  1. uint8_t btn_pressed			  - Push button interrupt flag. Will be 1 if an interrupt has occured, 0 otherwise.
+*  1. uint32_t events				  - Control events since the last pass (ui_take_events).
 *  2. uint8_t* mode					  - Pointer to the variable that's responsible for effect selection.
 * 
 * Return:
@@ -98,7 +1159,7 @@ void confirm_value(menu_t* menu)
 *
 ******************************************************************************/
 #pragma optimize_for_speed
-void display_menu(uint8_t btn_pressed, uint8_t* mode)
+void display_menu(uint32_t events, uint8_t* mode)
 {    
 	// group initializer for all menu_t members. will only be initialized once upon first function call.
 	static menu_t menu = { 0 };
@@ -106,28 +1167,106 @@ void display_menu(uint8_t btn_pressed, uint8_t* mode)
 	static char menus[SUBMENU_COUNT][MAX_ITEM_COUNT][MAX_ITEM_SIZE] = 
 	{ 
 		// top level
-		{"Pass-through", "Delay", "Overdrive", "Fuzz", "Tremolo", "Ring Modulator" },
+		{"Pass-through", "Delay", "Overdrive", "Fuzz", "Tremolo", "Ring Modulator", "Filter", "Chorus", "Flanger", "Reverb", "EQ", "Cabinet", "Noise gate", "Compressor", "Pitch", "Wah", "Phaser", "Amp model", "Fx loop", "Denoise", "Freeze", "Ping-pong", "Modulation", "Looper", "Presets", "Load", "Block size", "Tempo", "Tuner", "Meter", "Sample rate", "Latency" },
 		// pass through
 		{ "Start", "BACK" },
 		// delay
-		{ "Start", "Delay", "Feedback", "Blend", "BACK" },
-		// overdrive
-		{ "Start", "Threshold", "BACK" },
+		{ "Start", "Delay", "Feedback", "Blend", "Sync", "Duck", "BACK" },
+		// overdrive. quality: LUT, ADAA, oversampled (see quality_of)
+		{ "Start", "Threshold", "Quality", "BACK" },
 		// fuzz
-		{ "Start", "Gain", "Mix", "BACK" },
+		{ "Start", "Gain", "Mix", "Quality", "BACK" },
 		// tremolo
-		{ "Start", "Rate", "Depth", "BACK" },
+		{ "Start", "Rate", "Depth", "Sync", "BACK" },
 		// ring mod
-		{ "Start", "Rate", "Blend", "Type", "BACK" }		
+		{ "Start", "Rate", "Blend", "Type", "Sync", "BACK" },
+		// filter
+		{ "Start", "BACK" },
+		// chorus
+		{ "Start", "Rate", "Depth", "Blend", "BACK" },
+		// flanger
+		{ "Start", "Rate", "Depth", "Feedback", "BACK" },
+		// reverb. shimmer: octave up in the feedback, REVERB_FDN only
+		{ "Start", "Blend", "Shimmer", "BACK" },
+		// equalizer
+		{ "Start", "Bass", "Mid", "Treble", "Mid freq", "BACK" },
+		// cabinet
+		{ "Start", "Mix", "BACK" },
+		// noise gate. key: the detector follows the right input from 50 on, SIDECHAIN only
+		{ "Start", "Threshold", "Release", "Key", "BACK" },
+		// compressor. key as the gate's
+		{ "Start", "Threshold", "Ratio", "Makeup", "Key", "BACK" },
+		// pitch shifter
+		{ "Start", "Shift", "Blend", "BACK" },
+		// wah. rate 0: the envelope sweeps the filter
+		{ "Start", "Sensitivity", "Resonance", "Rate", "Mix", "BACK" },
+		// phaser. stages: 4, 8 or 12 in thirds of the range
+		{ "Start", "Rate", "Depth", "Stages", "Mix", "BACK" },
+		// amp model. input and level: -12 to +12 dB, model: number in the library (0: none)
+		{ "Start", "Input", "Level", "Mix", "Model", "BACK" },
+		// effects loop. latency: 0 to FXLOOP_MAX_LATENCY samples beyond the DMA blocks
+		{ "Start", "Mix", "Latency", "BACK" },
+		// noise reduction. amount: down to -30 dB per bin, sensitivity: the noise estimate subtracted 1 to 3 times
+		{ "Start", "Amount", "Sensitivity", "BACK" },
+		// freeze. hold from 50 on captures the next frame and sustains it
+		{ "Start", "Hold", "Blend", "BACK" },
+		// ping-pong delay. cross: share of the repeats that change sides
+		{ "Start", "Time", "Feedback", "Cross", "Blend", "BACK" },
+		// modulation. one route of the modulation matrix: source, target, depth and the rate of the LFOs
+		{ "Clear", "Source", "Target", "Depth", "LFO rate", "BACK" },
+		// looper. the first entries are carried out on a press, in the order of looper_state
+		{ "Stop", "Record", "Play", "Overdub", "Level", "BACK" },
+		// presets. the counter selects the slot
+		{ "Recall", "Save", "BACK" }
 	};
 	
-	// clear screen
-	lcd_clear();	
-	
-	char c[16];
-    
-	// read counter value from timer in encoder mode
-	menu.cnt = TIM2->CNT;
+#if !defined(CONTROL_M4)
+	follow_tempo();
+#if defined(MOD_MATRIX)
+	follow_modulation();
+#endif
+#endif
+	const control_status_t *s = current_status(*mode, events ? true : false);
+#if defined(CONTROL_M4)
+	// a MIDI program change on the M7: the presets are on this core
+	static uint32_t program_seen = 0;
+	if (s->program_count != program_seen)
+	{
+		program_seen = s->program_count;
+		apply_preset(s->program, mode);
+	}
+#endif
+
+	// an effect the audio side didn't switch on leaves the mode and the next preset save with the one that runs. the
+	// report (also a distortion started below its quality) is shown until the next input
+	const uint8_t admitted = (s->admission_count != menu.admission_shown) ? 1 : 0;
+	if (admitted)
+	{
+		menu.admission_shown = s->admission_count;
+		if (s->admission_quality == ADMISSION_REFUSED)
+		{
+			*mode = s->admission_mode;
+			live_preset()->mode = s->admission_mode;
+		}
+	}
+
+	// counter value of the timer in encoder mode, after it moved
+	if (events & UI_EVENT_ENCODER)
+		menu.cnt = TIM2->CNT;
+	const uint8_t btn_pressed = (events & UI_EVENT_BUTTON) ? 1 : 0;
+
+	// the figures of the top level entries follow the audio side: BPM (taps and MIDI clock), block size, sample rate
+	const uint8_t figures_changed = (s->tempo_version != menu.tempo_shown) || (s->block_size != menu.block_shown)
+		|| (s->sample_rate != menu.rate_shown);
+	menu.tempo_shown = s->tempo_version;
+	menu.block_shown = s->block_size;
+	menu.rate_shown = s->sample_rate;
+
+	// the screen is only redrawn (into the framebuffer) when something changed, and once at boot
+	const uint8_t redraw = !menu.drawn || btn_pressed || (menu.cnt != menu.past_cnt)
+		|| (figures_changed && (menu.menu_depth == 0) && ((menu.item_selected == MENU_TEMPO)
+		|| (menu.item_selected == MENU_BLOCK_SIZE) || (menu.item_selected == MENU_SAMPLE_RATE)));
+	menu.drawn = 1;
 	
 	// if the button was pressed, go to deeper menu level
 	if (btn_pressed)
@@ -138,26 +1277,97 @@ void display_menu(uint8_t btn_pressed, uint8_t* mode)
 		{
 		// top level
 		case 0:			
-			menu.sub_menu_selected = menu.item_selected;
-			menu.menu_depth++;
+			// the load page has no sub menu. any button press leaves it again
+			if (menu.show_load)
+			{
+				menu.show_load = 0;
+			}
+			else if (menu.show_tuner)
+			{
+				menu.show_tuner = 0;
+				request(CONTROL_TUNER, 0, 0, 0, mode);
+			}
+			else if (menu.show_meter)
+			{
+				menu.show_meter = 0;
+			}
+			else if (menu.show_latency)
+			{
+				menu.show_latency = 0;
+				// a sweep that hasn't finished ends with the block size it started with
+				request(CONTROL_LATENCY, 0, 0, 0, mode);
+			}
+			else if (menu.item_selected == MENU_LATENCY)
+			{
+				menu.show_latency = 1;
+				// every entry measures again, e.g. after changing the sample rate or the cable
+				request(CONTROL_LATENCY, 0, 0, 1, mode);
+			}
+			else if (menu.item_selected == MENU_METER)
+			{
+				menu.show_meter = 1;
+			}
+			else if (menu.item_selected == MENU_TUNER)
+			{
+				menu.show_tuner = 1;
+				request(CONTROL_TUNER, 0, 0, 1, mode);
+			}
+			else if (menu.item_selected == MENU_DIAGNOSTICS)
+			{
+				menu.show_load = 1;
+				// start with fresh min/max values, e.g. after changing effect parameters
+				request(CONTROL_PROFILER_RESET, 0, 0, 0, mode);
+			}
+			else if (menu.item_selected == MENU_BLOCK_SIZE)
+			{
+				// every press selects the next bigger block, after the biggest block the smallest follows
+				const uint16_t size = s->block_size;
+				request(CONTROL_BLOCK_SIZE, 0, 0, (size >= MAX_BLOCK_SIZE) ? MIN_BLOCK_SIZE : (size << 1), mode);
+			}
+			else if (menu.item_selected == MENU_SAMPLE_RATE)
+			{
+				// 44.1 -> 48 -> 96 -> 44.1 kHz. the effects start over with their init values, the values set in the menu follow
+				const uint32_t rate = s->sample_rate;
+				request(CONTROL_SAMPLE_RATE, 0, 0, (rate == 44100) ? 48000 : ((rate == 48000) ? 96000 : 44100), mode);
+			}
+			else if (menu.item_selected == MENU_TEMPO)
+			{
+				// tap tempo, with the time of the press
+				request(CONTROL_TAP, 0, 0, btn_tick, mode);
+			}
+			else
+			{
+				menu.sub_menu_selected = menu.item_selected;
+				menu.menu_depth++;
+			}
 			break;
 		// sub items
 		case 1: 
-			size = ARRAY_SIZE(menus[menu.sub_menu_selected][menu.item_selected]);
+			size = item_count(menus[row_of(&menu)]);
 			// check if last entry is selected -> go back
 			if (menu.item_selected == size - 1)
 			{
 				menu.menu_depth--;		
 				// reset item selection and timer-counter
 				menu.item_selected = 0;
-				TIM2->CNT = 0;
+				set_counter(&menu, 0);
 			}
-			// check if first entry is selected -> start
-			else if (menu.item_selected == 0)
+			// the first entry of the modulation page switches the route off
+			else if ((menu.item_selected == MOD_ITEM_CLEAR) && (menu.sub_menu_selected == MENU_MODULATION))
+			{
+				request(CONTROL_VALUE, MENU_MODULATION, MOD_ITEM_SOURCE, 0, mode);
+			}
+			// the transport entries of the looper page
+			else if ((menu.item_selected < LOOPER_ITEM_LEVEL) && (menu.sub_menu_selected == MENU_LOOPER))
+			{
+				request(CONTROL_VALUE, MENU_LOOPER, menu.item_selected, 0, mode);
+			}
+			// check if first entry is selected -> start. the preset page has no start entry
+			else if ((menu.item_selected == 0) && (menu.sub_menu_selected != MENU_PRESETS))
 			{
 				// write sub menu selected index to mode pointer from main.c
 				// these values are the same as the FXMODE enums from fx_lib.h
-				*mode = menu.sub_menu_selected;				
+				request(CONTROL_MODE, 0, 0, menu.sub_menu_selected, mode);
 			}
 			// the item selected is a parameter setting: show counter value on second line
 			else
@@ -166,15 +1376,25 @@ void display_menu(uint8_t btn_pressed, uint8_t* mode)
 				// the counter value having an impact on menu item selection or value selection
 				menu.show_values = 1;	
 				menu.menu_depth++;
-				// set value to 50. this could be improved by reading out the current
-				// value of the selected parameter from the fx lib in the future. for now, defaults to 50
-				TIM2->CNT = 50;
+				// start at the value confirmed last (also restored by a preset), 50 if the parameter was never set
+				const uint8_t *slot = remembered(menu.sub_menu_selected, menu.item_selected);
+				const uint8_t past = (slot != NULL) ? *slot : PRESET_UNSET;
+				set_counter(&menu, (menu.sub_menu_selected == MENU_PRESETS) ? 0 : ((past != PRESET_UNSET) ? past : 50));
 			}
 			break;
 		// confirm selected value, no longer display value.
 		case 2:
 			{
-				confirm_value(&menu);
+				if (menu.sub_menu_selected == MENU_PRESETS)
+				{
+					const uint8_t slot = menu.cnt % PRESET_SLOTS;
+					if (menu.item_selected == PRESET_ITEM_SAVE)
+						preset_save(slot, live_preset());
+					else
+						apply_preset(slot, mode);
+				}
+				else
+					request(CONTROL_VALUE, menu.sub_menu_selected, menu.item_selected, menu.cnt, mode);
 				menu.show_values = 0;					
 			}
 			break;
@@ -182,28 +1402,125 @@ void display_menu(uint8_t btn_pressed, uint8_t* mode)
 			menu.menu_depth--;
 			break;
 		}
-
-		btn_pressed = 0;
 	}
 	
 	// check if/how much the encoder has been rotated
 	if (menu.cnt != menu.past_cnt)
 	{
 		// if this flag is set, encoder rotation controls value, not item
-		if (!menu.show_values)
+		if (!menu.show_values && !menu.show_load && !menu.show_tuner && !menu.show_meter && !menu.show_latency)
 		{			
-			int16_t change = menu.cnt - menu.past_cnt;	
-			menu.item_selected = (change > 0)
-					? menu.item_selected++
-					: menu.item_selected--;
-			
-			// modulo the item selected variable by the item count of the current sub-menu to avoid overflow
-			menu.item_selected %= ARRAY_SIZE(menus[menu.sub_menu_selected]);			
+			int16_t change = (int16_t)menu.cnt - (int16_t)menu.past_cnt;
+			// the counter wraps around between 0 and its period (timer.c)
+			if (change > 50)
+				change -= 101;
+			else if (change < -50)
+				change += 101;
+
+			// one entry per step, wrapping around within the entries of the current sub-menu
+			const uint8_t count = item_count(menus[row_of(&menu)]);
+			if (change > 0)
+				menu.item_selected = (menu.item_selected + 1) % count;
+			else if (change < 0)
+				menu.item_selected = (menu.item_selected + count - 1) % count;
 		}
-		else
-		{			
+	}
+
+	if (menu.show_load)
+	{
+		// statistics change all the time -> periodic refresh instead of redrawing on input only
+		if (redraw || ((HAL_GetTick() - menu.last_refresh) >= DIAGNOSTICS_REFRESH))
+		{
+			menu.last_refresh = HAL_GetTick();
+			draw_load_page(s);
+		}
+	}
+	else if (menu.show_latency)
+	{
+		// the sweep changes the block size and the results as it goes
+		if (redraw || ((HAL_GetTick() - menu.last_refresh) >= DIAGNOSTICS_REFRESH))
+		{
+			menu.last_refresh = HAL_GetTick();
+			draw_latency_page(s);
+		}
+	}
+	else if (menu.show_tuner)
+	{
+		// redrawn with every new analysis
+#if defined(TUNER)
+		if (redraw || (s->tuner.sequence != menu.tuner_shown))
+		{
+			menu.tuner_shown = s->tuner.sequence;
+			draw_tuner_page(s);
+		}
+#else
+		if (redraw)
+			draw_tuner_page(s);
+#endif
+	}
+	else if (menu.show_meter)
+	{
+#if defined(TELEMETRY)
+		if (redraw || (s->meter.sequence != menu.meter_shown))
+		{
+			menu.meter_shown = s->meter.sequence;
+			draw_meter_page(s);
+		}
+#else
+		if (redraw)
+			draw_meter_page(s);
+#endif
+	}
+	else if (admitted && (s->admission_fx < PRESET_EFFECTS))
+	{
+		draw_admission_notice(s, menus[0][s->admission_fx]);
+	}
+	else if (redraw)
+	{
+		lcd_fb_clear();
+		lcd_fb_write(0, 0, menus[row_of(&menu)][menu.item_selected]);
+
+		if (menu.show_values && (menu.sub_menu_selected == MENU_PRESETS))
+		{
+			char row[LCD_COLS + 1];
+			snprintf(row, sizeof(row), "Slot %u", (unsigned)(menu.cnt % PRESET_SLOTS));
+			lcd_fb_write(1, 0, row);
+		}
+		else if (menu.show_values && (menu.item_selected == sync_item(menu.sub_menu_selected)))
+		{
+			lcd_fb_write(1, 0, tempo_division_name(tempo_division_from_value(menu.cnt)));
+		}
+		else if (menu.show_values && (menu.sub_menu_selected == MENU_MODULATION) && (menu.item_selected == MOD_ITEM_SOURCE))
+		{
+			lcd_fb_write(1, 0, mod_source_names[window_of(menu.cnt, MOD_MENU_SOURCES)]);
+		}
+		else if (menu.show_values && (menu.sub_menu_selected == MENU_MODULATION) && (menu.item_selected == MOD_ITEM_TARGET))
+		{
+			lcd_fb_write(1, 0, mod_target_names[window_of(menu.cnt, MOD_TARGETS)]);
+		}
+		else if (menu.show_values && (menu.sub_menu_selected == MENU_MODULATION) && (menu.item_selected == MOD_ITEM_DEPTH))
+		{
+			char row[LCD_COLS + 1];
+			snprintf(row, sizeof(row), "%+d%%", 2 * (int)menu.cnt - 100);
+			lcd_fb_write(1, 0, row);
+		}
+		else if (menu.show_values && (menu.sub_menu_selected == MENU_MODULATION) && (menu.item_selected == MOD_ITEM_RATE))
+		{
+			char row[LCD_COLS + 1];
+			const uint32_t rate = (uint32_t)(MOD_LFO_MAX_RATE_HZ * (float32_t)menu.cnt / 10.0f + 0.5f);
+			snprintf(row, sizeof(row), "%lu.%lu Hz", (unsigned long)(rate / 10), (unsigned long)(rate % 10));
+			lcd_fb_write(1, 0, row);
+		}
+		else if (menu.show_values && (menu.sub_menu_selected == MENU_PITCH) && (menu.item_selected == PITCH_ITEM_SHIFT))
+		{
+			char row[LCD_COLS + 1];
+			snprintf(row, sizeof(row), "%+d st", (int)roundf(2.0f * PITCH_MAX_SEMITONES * ((float32_t)menu.cnt / 100.0f)) - PITCH_MAX_SEMITONES);
+			lcd_fb_write(1, 0, row);
+		}
+		else if (menu.show_values)
+		{
 			// convert counter value to char
-			char val[3];
+			char val[4];
 			uint8_t temp = menu.cnt;
 			for (int i = 2; i >= 0; i--)
 			{
@@ -213,23 +1530,39 @@ void display_menu(uint8_t btn_pressed, uint8_t* mode)
 				// divide number by 10 to drop last digit
 				temp /= 10;
 			}
-			
-			// put cursor on second row
-			lcd_put_cursor(1, 0);
-			// write count value to display
-			lcd_send_string(val);
-			// return cursor to first row
-			lcd_put_cursor(0, 0);
+			val[3] = '\0';
+
+			// write count value to second row
+			lcd_fb_write(1, 0, val);
+		}
+		else if ((menu.menu_depth == 0) && (menu.item_selected == MENU_BLOCK_SIZE))
+		{
+			// block size and resulting latency (DMA_BLOCKS blocks, the nodes processed and the limiter) in 0.1 ms
+			char row[LCD_COLS + 1];
+			// no sample rate before the first status of the M7 (CONTROL_M4)
+			const uint32_t latency = (s->sample_rate > 0) ? (uint32_t)(((uint64_t)s->latency * 10000) / s->sample_rate) : 0;
+			snprintf(row, sizeof(row), "%u %lu.%lums", s->block_size, (unsigned long)(latency / 10), (unsigned long)(latency % 10));
+			lcd_fb_write(1, 0, row);
 		}
-		
-		// iterate over innermost char array
-		for (int i = 0; i < ARRAY_SIZE(menus[menu.sub_menu_selected][menu.item_selected]); i++) 
+		else if ((menu.menu_depth == 0) && (menu.item_selected == MENU_TEMPO))
 		{
-			c[i] = menus[menu.sub_menu_selected][menu.item_selected][i];
+			char row[LCD_COLS + 1];
+			const uint32_t bpm = (uint32_t)(s->bpm * 10.0f + 0.5f);
+			snprintf(row, sizeof(row), "%lu.%lu BPM", (unsigned long)(bpm / 10), (unsigned long)(bpm % 10));
+			lcd_fb_write(1, 0, row);
+		}
+		else if ((menu.menu_depth == 0) && (menu.item_selected == MENU_SAMPLE_RATE))
+		{
+			char row[LCD_COLS + 1];
+			const uint32_t rate = s->sample_rate;
+			snprintf(row, sizeof(row), "%lu.%lu kHz", (unsigned long)(rate / 1000), (unsigned long)((rate % 1000) / 100));
+			lcd_fb_write(1, 0, row);
 		}
-		
-		lcd_send_string(c);
 	}
+
+	// transmit changed characters in the background. also retries an update that couldn't start because the bus was busy
+	lcd_update();
 	
 	menu.past_cnt = menu.cnt; 
 }
+#endif // UI_MENU_CORE
@@ -11,11 +11,45 @@ extern "C" {
 #endif
 	
 #include "main.h"
+#include "preset.h"
+#include "tempo.h"
+#include "control_link.h"
 
 
 #define MAX_ITEM_SIZE (16)
-#define MAX_ITEM_COUNT (7)
-#define SUBMENU_COUNT (7)
+#define MAX_ITEM_COUNT (32)
+#define SUBMENU_COUNT (26)
+// top level entry of the modulation page: the route of the modulation matrix (MOD_MATRIX), stored with the presets
+#define MENU_MODULATION (22)
+// top level entry of the looper page (LOOPER): the transport commands of both channels and the playback level
+#define MENU_LOOPER (23)
+// top level entry of the preset save/recall page
+#define MENU_PRESETS (24)
+// top level entry of the load page (profiler statistics of the active effect)
+#define MENU_DIAGNOSTICS (25)
+// top level entry of the block size selection (latency mode)
+#define MENU_BLOCK_SIZE (26)
+// top level entry of the tap tempo: every button press is a tap
+#define MENU_TEMPO (27)
+// top level entry of the tuner page (pitch of the input, the effects keep running)
+#define MENU_TUNER (28)
+// top level entry of the level meter page (RMS, peak and spectrum of the output)
+#define MENU_METER (29)
+// top level entry of the sample rate selection (44.1, 48 or 96 kHz)
+#define MENU_SAMPLE_RATE (30)
+// top level entry of the round trip latency page (loopback measurement of every block size)
+#define MENU_LATENCY (31)
+// refresh period of the load page in ms
+#define DIAGNOSTICS_REFRESH (250)
+// control events (ui_post): push button pressed, encoder moved
+#define UI_EVENT_BUTTON (0x01)
+#define UI_EVENT_ENCODER (0x02)
+// button edges closer than this after a press are contact bounce
+#define UI_DEBOUNCE_MS (30)
+// the core that runs the menu (display_menu) and owns the controls and the LCD: the M7, with CONTROL_M4 the M4
+#if (defined(CORE_CM7) && !defined(CONTROL_M4)) || (defined(CORE_CM4) && defined(CONTROL_M4))
+#define UI_MENU_CORE
+#endif
 typedef struct menu
 {
 	// state variables
@@ -25,9 +59,34 @@ typedef struct menu
 	volatile uint8_t item_selected;
 	volatile uint8_t sub_menu_selected;
 	volatile uint8_t show_values;
+	volatile uint8_t show_load;
+	volatile uint8_t show_tuner;
+	volatile uint8_t show_meter;
+	volatile uint8_t show_latency;
+	uint32_t last_refresh;
+	uint32_t tuner_shown;
+	uint32_t meter_shown;
+	// figures of the top level entries as last shown
+	uint32_t tempo_shown;
+	uint16_t block_shown;
+	uint32_t rate_shown;
+	// report of the admission check as last shown
+	uint32_t admission_shown;
+	// the first pass draws the page without an input (at boot, right after lcd_init)
+	uint8_t drawn;
 } menu_t;
 
-void display_menu(uint8_t btn_pressed, uint8_t* mode);
+void ui_post(uint32_t events);
+uint32_t ui_take_events(void);
+void display_menu(uint32_t events, uint8_t* mode);
+uint8_t apply_preset(uint8_t slot, uint8_t* mode);
+#if defined(CORE_CM7)
+void ui_execute(const control_command_t *command, uint8_t *mode);
+uint8_t ui_value(uint8_t fx, uint8_t item);
+#endif
+#if defined(CORE_CM7) && defined(CONTROL_M4)
+void ui_serve(uint8_t* mode);
+#endif
 	
 #ifdef __cplusplus
 }
@@ -0,0 +1,400 @@
+// waveshaper.c, Michael Haselberger
+// Description: Lookup table waveshaper. Replaces evaluating distortion curves (branches, expf) for every sample
+// with one table lookup and a linear interpolation. Overdrive and fuzz only differ in the table they use.
+// The ADAA variant shapes with the difference quotient of the curve's antiderivative instead, which suppresses most of
+// the aliasing at the sample rate, for about twice the cycles of the plain lookup instead of the 4 to 8 times of
+// oversampling.
+
+#include <string.h>
+#include "waveshaper.h"
+#include "smooth_param.h"
+#include "scratch_pool.h"
+#include "platform.h"
+
+// the tables are read at random positions for every sample, DTCM has no wait states and no cache misses
+static float32_t __attribute__((aligned(32))) DTCM_DATA table_pool[WAVESHAPER_MAX_SHAPERS][WAVESHAPER_TABLES][WAVESHAPER_TABLE_SIZE + 2];
+// the antiderivatives, read twice per sample by the ADAA shaper only, stay in AXI SRAM: DTCM has no room left for
+// their 12 KB (24 KB stereo)
+static float32_t __attribute__((aligned(32))) integral_pool[WAVESHAPER_MAX_SHAPERS][WAVESHAPER_TABLES][WAVESHAPER_TABLE_SIZE + 2];
+static uint8_t pool_used = 0;
+
+// sample the curve at WAVESHAPER_TABLE_SIZE + 1 points from -1 to 1, plus the guard point. the antiderivative of the
+// interpolated curve is exact at the points with the trapezoid rule, summed in double so the 512 steps don't add up
+// float rounding. it is shifted to 0 at x = 0: the ADAA shaper subtracts two of its values, small ones lose less
+static void fill_table(float32_t *table, float32_t *integral, waveshaper_curve curve, float32_t param)
+{
+	const double step = 2.0 / WAVESHAPER_TABLE_SIZE;
+	double sum = 0.0;
+
+	for (uint32_t i = 0; i <= WAVESHAPER_TABLE_SIZE; ++i)
+	{
+		table[i] = curve(-1.0f + 2.0f * (float32_t)i / WAVESHAPER_TABLE_SIZE, param);
+	}
+	table[WAVESHAPER_TABLE_SIZE + 1] = table[WAVESHAPER_TABLE_SIZE];
+
+	integral[0] = 0.0f;
+	for (uint32_t i = 1; i <= WAVESHAPER_TABLE_SIZE; ++i)
+	{
+		sum += 0.5 * step * ((double)table[i - 1] + (double)table[i]);
+		integral[i] = (float32_t)sum;
+	}
+	const float32_t zero = integral[WAVESHAPER_TABLE_SIZE / 2];
+	for (uint32_t i = 0; i <= WAVESHAPER_TABLE_SIZE; ++i)
+	{
+		integral[i] -= zero;
+	}
+	integral[WAVESHAPER_TABLE_SIZE + 1] = integral[WAVESHAPER_TABLE_SIZE];
+}
+
+// the audio interrupt reads at most active and used, the third table is free
+static uint8_t free_table(const waveshaper_t *ws)
+{
+	const uint8_t active = ws->active;
+	const uint8_t used = ws->used;
+	uint8_t next = 0;
+	while ((next == active) || (next == used))
+		++next;
+	return next;
+}
+
+/******************************************************************************
+* Function Name: waveshaper_init
+*******************************************************************************
+* Summary:
+*  Initialize a waveshaper and build its first table. The table memory is taken from a static
+*  pool in DTCM the first time, later calls reuse it.
+*
+* Parameters:
+*  1. waveshaper_t *ws				- Address pointer of the waveshaper struct.
+*  2. waveshaper_curve curve		- Transfer curve.
+*  3. float32_t param				- Parameter passed to the curve (e.g. threshold, gain).
+* Return:
+*  255:								- Waveshaper or curve point to NULL.
+*  253:								- Table pool exhausted (see WAVESHAPER_MAX_SHAPERS).
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t waveshaper_init(waveshaper_t *ws, waveshaper_curve curve, float32_t param)
+{
+	if ((ws == NULL) || (curve == NULL))
+	{
+		return 255;
+	}
+	if (ws->table == NULL)
+	{
+		if (pool_used >= WAVESHAPER_MAX_SHAPERS)
+		{
+			return 253;
+		}
+		ws->table = table_pool[pool_used];
+		ws->integral = integral_pool[pool_used];
+		++pool_used;
+	}
+
+	fill_table(ws->table[0], ws->integral[0], curve, param);
+	ws->active = 0;
+	ws->used = 0;
+	ws->last = 0.0f;
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: waveshaper_build
+*******************************************************************************
+* Summary:
+*  Rebuild the table after a parameter changed. The new curve is written into a table the audio
+*  interrupt doesn't read and then published, so this can be called from the main loop at any time.
+*  Takes a few ten thousand cycles (one curve evaluation per table point), not real time safe.
+*  The antiderivative table is rebuilt with it.
+*
+* Parameters:
+*  1. waveshaper_t *ws				- Address pointer of the waveshaper struct.
+*  2. waveshaper_curve curve		- Transfer curve.
+*  3. float32_t param				- Parameter passed to the curve.
+* Return:
+*  255:								- Waveshaper not initialized or curve points to NULL.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t waveshaper_build(waveshaper_t *ws, waveshaper_curve curve, float32_t param)
+{
+	if ((ws->table == NULL) || (curve == NULL))
+	{
+		return 255;
+	}
+
+	const uint8_t next = free_table(ws);
+	fill_table(ws->table[next], ws->integral[next], curve, param);
+	// the table has to be complete before the interrupt can see the new index
+	__DMB();
+	ws->active = next;
+
+	return 0;
+}
+
+/******************************************************************************
+* Function Name: waveshaper_load
+*******************************************************************************
+* Summary:
+*  Replace the curve with a table generated ahead of time (dsp_helpers.export_waveshaper_header,
+*  e.g. a curve designed in distortion.ipynb), published like after waveshaper_build. Only
+*  copies the points, no curve is evaluated: the firmware shapes with exactly the table of the
+*  prototype.
+*
+* Parameters:
+*  1. waveshaper_t *ws				- Address pointer of the waveshaper struct.
+*  2. const float32_t *table		- WAVESHAPER_TABLE_SIZE + 2 points of the curve.
+*  3. const float32_t *integral		- WAVESHAPER_TABLE_SIZE + 2 points of its antiderivative.
+* Return:
+*  255:								- Waveshaper not initialized or a table points to NULL.
+*    0:								- Success.
+*
+******************************************************************************/
+uint8_t waveshaper_load(waveshaper_t *ws, const float32_t *table, const float32_t *integral)
+{
+	if ((ws->table == NULL) || (table == NULL) || (integral == NULL))
+	{
+		return 255;
+	}
+
+	const uint8_t next = free_table(ws);
+	memcpy(ws->table[next], table, sizeof(ws->table[next]));
+	memcpy(ws->integral[next], integral, sizeof(ws->integral[next]));
+	__DMB();
+	ws->active = next;
+
+	return 0;
+}
+
+// shape one sample with a table: clamp, split the position into index and fraction, interpolate
+static inline float32_t interpolate(const float32_t *table, float32_t x)
+{
+	// fminf/fmaxf compile to vminnm/vmaxnm, so clamping doesn't branch either
+	const float32_t pos = fminf(fmaxf((x + 1.0f) * (WAVESHAPER_TABLE_SIZE * 0.5f), 0.0f), (float32_t)WAVESHAPER_TABLE_SIZE);
+	const uint32_t index = (uint32_t)pos;
+	const float32_t frac = pos - (float32_t)index;
+	const float32_t y0 = table[index];
+	return y0 + frac * (table[index + 1] - y0);
+}
+
+// antiderivative of the interpolated curve: the tabulated value at the point below plus the integral of the line up to
+// x. outside [-1, 1] the curve stays at its end value, the antiderivative continues as a straight line
+static inline float32_t antiderivative(const float32_t *table, const float32_t *integral, float32_t x)
+{
+	const float32_t scale = WAVESHAPER_TABLE_SIZE * 0.5f;
+	const float32_t clamped = fminf(fmaxf(x, -1.0f), 1.0f);
+	const float32_t pos = (clamped + 1.0f) * scale;
+	const uint32_t index = (uint32_t)pos;
+	const float32_t frac = pos - (float32_t)index;
+	const float32_t y0 = table[index];
+	const float32_t slope = table[index + 1] - y0;
+	return integral[index] + (frac / scale) * (y0 + 0.5f * frac * slope) + (x - clamped) * (y0 + frac * slope);
+}
+
+// shape one block with a single table
+#pragma optimize_for_speed
+ITCM_CODE static void lookup(const float32_t *table, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		dst[i] = interpolate(table, src[i]);
+	}
+}
+
+/******************************************************************************
+* Function Name: lookup_adaa
+*******************************************************************************
+* Summary:
+*  First-order ADAA with a single table: y[n] = (F(x[n]) - F(x[n-1])) / (x[n] - x[n-1]), the
+*  mean of the curve between two samples, with F the antiderivative. Steps below
+*  WAVESHAPER_ADAA_MIN_STEP take the curve at the midpoint. Both are computed and one is
+*  selected, so there's no branch in the loop, only the division.
+*
+* Parameters:
+*  1. const float32_t *table		- Curve.
+*  2. const float32_t *integral		- Its antiderivative at the table points.
+*  3. float32_t last				- Input sample before src[0].
+*  4. const float32_t *src			- Input block.
+*  5. float32_t *dst				- Output block. May be the same as src.
+*  6. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE static void lookup_adaa(const float32_t *table, const float32_t *integral, float32_t last, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	float32_t x0 = last;
+	float32_t f0 = antiderivative(table, integral, x0);
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		const float32_t x1 = src[i];
+		const float32_t f1 = antiderivative(table, integral, x1);
+		const float32_t step = x1 - x0;
+		const bool wide = (fabsf(step) >= WAVESHAPER_ADAA_MIN_STEP) ? true : false;
+		const float32_t quotient = (f1 - f0) / (wide ? step : 1.0f);
+		const float32_t midpoint = interpolate(table, 0.5f * (x0 + x1));
+		dst[i] = wide ? quotient : midpoint;
+		x0 = x1;
+		f0 = f1;
+	}
+}
+
+/******************************************************************************
+* Function Name: waveshaper_process
+*******************************************************************************
+* Summary:
+*  Shape a block. If the table was rebuilt since the last block, the block is shaped with both
+*  curves and faded linearly from the old to the new one, so changing a parameter doesn't click.
+*  Called from the audio interrupt only.
+*  Oversampled blocks can be longer than MAX_BLOCK_SIZE, the fade is then done in parts.
+*
+* Parameters:
+*  1. waveshaper_t *ws				- Address pointer of an initialized waveshaper struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block. May be the same as src.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void waveshaper_process(waveshaper_t *ws, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	const uint8_t active = ws->active;
+	const uint8_t used = ws->used;
+
+	if (active == used)
+	{
+		// kept for a switch to the ADAA shaper. dst may be src, so it is taken before
+		ws->last = src[block_size - 1];
+		lookup(ws->table[active], src, dst, block_size);
+		return;
+	}
+
+	ws->last = src[block_size - 1];
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *old = scratch_pool_alloc(MAX_BLOCK_SIZE * sizeof(float32_t));
+	for (uint32_t offset = 0; offset < block_size; offset += MAX_BLOCK_SIZE)
+	{
+		const uint32_t n = ((block_size - offset) < MAX_BLOCK_SIZE) ? (block_size - offset) : MAX_BLOCK_SIZE;
+		// this part of the fade from the old (0) to the new curve (1)
+		const smooth_param_t fade = { .start = (float32_t)offset / block_size, .end = (float32_t)(offset + n) / block_size };
+		lookup(ws->table[used], &src[offset], old, n);
+		lookup(ws->table[active], &src[offset], &dst[offset], n);
+		smooth_param_mix(&fade, old, &dst[offset], &dst[offset], n);
+	}
+	scratch_pool_release(mark);
+	ws->used = active;
+}
+
+/******************************************************************************
+* Function Name: waveshaper_process_adaa
+*******************************************************************************
+* Summary:
+*  Shape a block with first-order antiderivative anti-aliasing (see lookup_adaa). The mean
+*  over a sample step acts like a short boxcar: the harmonics that would fold back are damped,
+*  the signal is delayed by half a sample and the top octave drops by up to 3.9 dB at Fs / 2.
+*  A rebuilt table is faded in as in waveshaper_process, both curves start from the same
+*  last sample. Called from the audio interrupt only, blocks may be longer than MAX_BLOCK_SIZE.
+*
+* Parameters:
+*  1. waveshaper_t *ws				- Address pointer of an initialized waveshaper struct.
+*  2. const float32_t *src			- Input block.
+*  3. float32_t *dst				- Output block. May be the same as src.
+*  4. uint32_t block_size			- Number of samples.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void waveshaper_process_adaa(waveshaper_t *ws, const float32_t *src, float32_t *dst, uint32_t block_size)
+{
+	const uint8_t active = ws->active;
+	const uint8_t used = ws->used;
+	const float32_t next = src[block_size - 1];
+
+	if (active == used)
+	{
+		lookup_adaa(ws->table[active], ws->integral[active], ws->last, src, dst, block_size);
+		ws->last = next;
+		return;
+	}
+
+	const scratch_mark_t mark = scratch_pool_mark();
+	float32_t *old = scratch_pool_alloc(MAX_BLOCK_SIZE * sizeof(float32_t));
+	float32_t last = ws->last;
+	for (uint32_t offset = 0; offset < block_size; offset += MAX_BLOCK_SIZE)
+	{
+		const uint32_t n = ((block_size - offset) < MAX_BLOCK_SIZE) ? (block_size - offset) : MAX_BLOCK_SIZE;
+		const smooth_param_t fade = { .start = (float32_t)offset / block_size, .end = (float32_t)(offset + n) / block_size };
+		// the last input of this part, before dst overwrites it
+		const float32_t part_last = src[offset + n - 1];
+		lookup_adaa(ws->table[used], ws->integral[used], last, &src[offset], old, n);
+		lookup_adaa(ws->table[active], ws->integral[active], last, &src[offset], &dst[offset], n);
+		smooth_param_mix(&fade, old, &dst[offset], &dst[offset], n);
+		last = part_last;
+	}
+	scratch_pool_release(mark);
+	ws->last = next;
+	ws->used = active;
+}
+
+// ---- q31 (SAMPLE_Q31 chain) ----
+
+// q31 version of lookup. the sample as offset binary (0 .. 2^32 - 1 for -1 .. 1) is the table position: the top
+// bits are the index, the next 16 bits the fraction. no clamping needed, a q31 sample can't leave the table
+#pragma optimize_for_speed
+ITCM_CODE static void lookup_q31(const float32_t *table, const q31_t *src, q31_t *dst, uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; ++i)
+	{
+		const uint32_t pos = (uint32_t)src[i] ^ 0x80000000u;
+		const uint32_t index = pos >> WAVESHAPER_INDEX_SHIFT;
+		const float32_t frac = (float32_t)((pos >> (WAVESHAPER_INDEX_SHIFT - 16)) & 0xFFFF) * (1.0f / 65536.0f);
+		const float32_t y0 = table[index];
+		const float32_t y = y0 + frac * (table[index + 1] - y0);
+		// the curves are normalized to +-1, 1 itself doesn't fit into q31
+		dst[i] = (q31_t)(fminf(y, 0.99999994f) * 2147483648.0f);
+	}
+}
+
+/******************************************************************************
+* Function Name: waveshaper_process_q31
+*******************************************************************************
+* Summary:
+*  q31 version of waveshaper_process, same tables and crossfade. The curve is interpolated in
+*  float, the block stays q31 (no conversion passes).
+*
+* Parameters:
+*  1. waveshaper_t *ws				- Address pointer of an initialized waveshaper struct.
+*  2. const q31_t *src				- Input block.
+*  3. q31_t *dst					- Output block. May be the same as src.
+*  4. uint32_t block_size			- Number of samples. Must not exceed MAX_BLOCK_SIZE.
+* Return:
+*  None.
+*
+******************************************************************************/
+#pragma optimize_for_speed
+ITCM_CODE void waveshaper_process_q31(waveshaper_t *ws, const q31_t *src, q31_t *dst, uint32_t block_size)
+{
+	const uint8_t active = ws->active;
+	const uint8_t used = ws->used;
+
+	ws->last = (float32_t)src[block_size - 1] * (1.0f / 2147483648.0f);
+	if (active == used)
+	{
+		lookup_q31(ws->table[active], src, dst, block_size);
+		return;
+	}
+
+	const scratch_mark_t mark = scratch_pool_mark();
+	q31_t *old = scratch_pool_alloc(block_size * sizeof(q31_t));
+	const smooth_param_t fade = { .start = 0.0f, .end = 1.0f };
+	lookup_q31(ws->table[used], src, old, block_size);
+	lookup_q31(ws->table[active], src, dst, block_size);
+	smooth_param_mix_q31(&fade, old, dst, dst, block_size);
+	scratch_pool_release(mark);
+	ws->used = active;
+}
@@ -0,0 +1,67 @@
+// waveshaper.h, Michael Haselberger
+// Description: This file contains declarations for the lookup table waveshaper implemented in waveshaper.c
+
+#ifndef __WAVESHAPER_H__
+#define __WAVESHAPER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <arm_math.h>
+#include "defines_and_constants.h"
+
+// intervals of the transfer curve over the input range [-1, 1]
+#define WAVESHAPER_TABLE_SIZE 512
+// the q31 lookup takes the table index from the top bits of the sample: 32 - log2(WAVESHAPER_TABLE_SIZE)
+#define WAVESHAPER_INDEX_SHIFT 23
+// tables per shaper: the one in use, the one faded out after a change and the one being rebuilt
+#define WAVESHAPER_TABLES 3
+// smallest step between two input samples the ADAA shaper divides by. below, the antiderivative difference would be
+// mostly float rounding, the curve is taken at the midpoint instead (its error grows with the square of the step)
+#define WAVESHAPER_ADAA_MIN_STEP (1e-3f)
+// shapers that can be initialized (overdrive and fuzz of every channel)
+#ifndef WAVESHAPER_MAX_SHAPERS
+#define WAVESHAPER_MAX_SHAPERS (2 * AUDIO_CHANNELS)
+#endif
+
+// transfer curve y = curve(x, param) for -1 <= x <= 1
+typedef float32_t (*waveshaper_curve)(float32_t x, float32_t param);
+
+/*  -----------------------------------------------------------------------------------------------------------------------------
+*   Static waveshaper with a precomputed transfer curve.
+*   The curve is sampled into a table in DTCM once, the block is then shaped with linear interpolation between the table
+*   points and without any branch per sample. Rebuilding the table (waveshaper_build) is done from the main loop while the
+*   audio interrupt keeps using the old one, the next block fades from the old to the new curve.
+*   Every table comes with the antiderivative of its interpolated curve for first-order antiderivative anti-aliasing
+*   (waveshaper_process_adaa): piecewise quadratic in closed form, its values at the table points are tabulated.
+*
+*   Members:
+*   table:              WAVESHAPER_TABLES tables of WAVESHAPER_TABLE_SIZE + 2 points (last point repeated as guard).
+*   integral:           Antiderivative of each table at its points, 0 at x = 0.
+*   active:             Table the next block is shaped with. Written by waveshaper_build only.
+*   used:               Table the last block was shaped with. Written by waveshaper_process only.
+*   last:               Last input sample of the previous block, the ADAA shaper starts from it.
+*   -----------------------------------------------------------------------------------------------------------------------------
+*/
+typedef struct
+{
+	float32_t (*table)[WAVESHAPER_TABLE_SIZE + 2];
+	float32_t (*integral)[WAVESHAPER_TABLE_SIZE + 2];
+	volatile uint8_t active;
+	volatile uint8_t used;
+	float32_t last;
+} waveshaper_t;
+
+uint8_t waveshaper_init(waveshaper_t *ws, waveshaper_curve curve, float32_t param);
+uint8_t waveshaper_build(waveshaper_t *ws, waveshaper_curve curve, float32_t param);
+uint8_t waveshaper_load(waveshaper_t *ws, const float32_t *table, const float32_t *integral);
+void waveshaper_process(waveshaper_t *ws, const float32_t *src, float32_t *dst, uint32_t block_size);
+void waveshaper_process_adaa(waveshaper_t *ws, const float32_t *src, float32_t *dst, uint32_t block_size);
+void waveshaper_process_q31(waveshaper_t *ws, const q31_t *src, q31_t *dst, uint32_t block_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __WAVESHAPER_H__
@@ -70,4 +70,556 @@ def ResultsPath():
         makedirs(results_dir)
     return results_dir
 
-    
\ No newline at end of file
+    
+
+def CompareRecording(path, effect, maxLag = 4800, **effect_kwargs):
+    '''
+    Summary:
+      Compare the effects of the pedal with the reference implementations in dsp_helpers
+      without any analog path: a recording of the USB audio device (USB_AUDIO in
+      defines_and_constants.h) holds the chain output in channel 0 and the unprocessed
+      input in channel 1. The runner of the desktop build (fx_host_run.c) writes the same
+      layout, with the kernels on the PC. The reference effect is applied to channel 1 and
+      compared to channel 0, after aligning both by cross correlation.
+    Parameters:
+      path:           - WAV file recorded from the USB audio device or written by fx_host_run (stereo)
+      effect:         - reference function, e.g. dsp_helpers.overdrive
+      maxLag:         - longest latency of the chain searched for, in samples
+      effect_kwargs:  - parameters of the effect, the same as set on the pedal
+    Returns:
+      dictionary with the latency in samples, the largest sample error and the
+      error energy relative to the reference in dB
+    '''
+    from numpy import float64, iinfo, issubdtype, integer, argmax, abs, sum, log10, inf
+    from scipy.io import wavfile
+    from scipy.signal import correlate
+
+    samplingRate, data = wavfile.read(path)
+    assert (data.ndim == 2) and (data.shape[1] == 2), "recording has to be the stereo stream of the USB audio device"
+    if issubdtype(data.dtype, integer):
+        data = data / float64(-iinfo(data.dtype).min)
+
+    wet = data[:, 0]
+    reference = effect(data[:, 1], **effect_kwargs)
+
+    # the output lags the reference by the latency of the chain (0 for most effects, one block for the FFT ones)
+    correlation = correlate(wet[:len(reference)], reference, mode = 'full', method = 'fft')
+    zero = len(reference) - 1
+    lag = int(argmax(abs(correlation[zero:zero + maxLag + 1])))
+
+    n = len(reference) - lag
+    error = wet[lag:lag + n] - reference[:n]
+    energy = sum(reference[:n] ** 2)
+    return {
+        'samplingRate': samplingRate,
+        'latency': lag,
+        'maxError': float(abs(error).max()),
+        'errorDb': float(10 * log10(sum(error ** 2) / energy)) if energy > 0 else inf
+    }
+
+
+
+def ReadBenchmark(path):
+    '''
+    Summary:
+      Read the table of the benchmark firmware (Benchmark configuration, benchmark.c) from
+      a log of the SWO console. Only the lines starting with "bench," are used, so the log
+      may hold other output and several repetitions of the table (the last one is kept).
+    Parameters:
+      path:           - text file with the SWO output
+    Returns:
+      pandas DataFrame with the columns kernel, memory, block, cycles_per_block and
+      cycles_per_sample
+    '''
+    import pandas as pd
+
+    columns = ['kernel', 'memory', 'block', 'cycles_per_block', 'cycles_per_sample']
+    rows = []
+    with open(path, 'r', errors = 'ignore') as log:
+        for line in log:
+            fields = line.strip().split(',')
+            if (fields[0] != 'bench') or (len(fields) != len(columns) + 1) or (fields[1] == 'kernel'):
+                continue
+            rows.append(fields[1:])
+
+    table = pd.DataFrame(rows, columns = columns)
+    table = table.astype({'block': int, 'cycles_per_block': int, 'cycles_per_sample': float})
+    return table.drop_duplicates(subset = ['kernel', 'memory', 'block'], keep = 'last').reset_index(drop = True)
+
+
+def StoreBenchmark(path, commit = None, history = 'benchmark_history.csv'):
+    '''
+    Summary:
+      Add the benchmark results of one firmware build to the history in the Results
+      directory. Results of the same commit are replaced, so a benchmark can be repeated.
+    Parameters:
+      path:           - SWO log of the benchmark firmware (see ReadBenchmark)
+      commit:         - commit the firmware was built from, the current HEAD if None
+      history:        - file name of the history in the Results directory
+    Returns:
+      pandas DataFrame with the whole history, oldest commit first
+    '''
+    import pandas as pd
+    from datetime import datetime
+    from os.path import isfile
+    from subprocess import check_output
+
+    if commit is None:
+        commit = check_output(['git', 'rev-parse', '--short', 'HEAD'], text = True).strip()
+
+    table = ReadBenchmark(path)
+    table.insert(0, 'commit', commit)
+    table.insert(1, 'date', datetime.now().strftime('%Y-%m-%d %H:%M'))
+
+    destination = ResultsPath() + history
+    if isfile(destination):
+        previous = pd.read_csv(destination, dtype = {'commit': str})
+        table = pd.concat([previous[previous['commit'] != commit], table], ignore_index = True)
+    table.to_csv(destination, index = False)
+    return table
+
+
+def CheckBenchmark(history = 'benchmark_history.csv', tolerance = 0.05):
+    '''
+    Summary:
+      Compare the latest commit of the benchmark history with the one before and list the
+      kernels that got slower, to be checked before firmware is flashed.
+    Parameters:
+      history:        - file name of the history in the Results directory
+      tolerance:      - relative increase of the cycles per sample that is still accepted
+    Returns:
+      pandas DataFrame with kernel, memory, block, the cycles per sample of both commits
+      and the relative change, empty if nothing got slower
+    '''
+    import pandas as pd
+
+    table = pd.read_csv(ResultsPath() + history, dtype = {'commit': str})
+    commits = list(dict.fromkeys(table['commit']))
+    if len(commits) < 2:
+        return pd.DataFrame()
+
+    keys = ['kernel', 'memory', 'block']
+    before = table[table['commit'] == commits[-2]][keys + ['cycles_per_sample']]
+    after = table[table['commit'] == commits[-1]][keys + ['cycles_per_sample']]
+    merged = before.merge(after, on = keys, suffixes = ('_' + commits[-2], '_' + commits[-1]))
+    merged['change'] = merged.iloc[:, -1] / merged.iloc[:, -2] - 1
+    return merged[merged['change'] > tolerance].sort_values('change', ascending = False).reset_index(drop = True)
+
+
+def PlotBenchmark(history = 'benchmark_history.csv', block = 64, destination = 'benchmark_trend',
+    figsize = (9, 12), dpi = 100):
+    '''
+    Summary:
+      Plot the cycles per sample of every kernel over the commits of the benchmark history,
+      one subplot per memory placement of the buffers.
+    Parameters:
+      history:        - file name of the history in the Results directory
+      block:          - block size shown (16 to 256)
+      destination:    - file name of the figure in the Results directory, None to only show it
+    Returns:
+      None
+    '''
+    import pandas as pd
+    import matplotlib.pyplot as plt
+
+    table = pd.read_csv(ResultsPath() + history, dtype = {'commit': str})
+    table = table[table['block'] == block]
+    commits = list(dict.fromkeys(table['commit']))
+    memories = list(dict.fromkeys(table['memory']))
+
+    plt.rcParams["figure.figsize"] = figsize
+    plt.rcParams["figure.dpi"] = dpi
+    fig, axes = plt.subplots(len(memories), sharex = True, squeeze = False)
+    fig.tight_layout(pad = 3.0)
+    for ax, memory in zip(axes[:, 0], memories):
+        placement = table[table['memory'] == memory]
+        for kernel, rows in placement.groupby('kernel', sort = False):
+            trend = rows.set_index('commit')['cycles_per_sample'].reindex(commits)
+            ax.plot(commits, trend.values, marker = 'o', label = kernel)
+        ax.set_title('Buffers in ' + memory + ', ' + str(block) + ' samples per block')
+        ax.set_ylabel('cycles per sample')
+        ax.grid()
+    axes[0, 0].legend(loc = 'upper left', ncol = 4, fontsize = 'small')
+    plt.xlabel('commit')
+    plt.xticks(rotation = 45)
+    if destination is not None:
+        plt.savefig(ResultsPath() + destination)
+    plt.show()
+
+
+# kernels of the benchmark that model a node of the chain: fx_designator, variant and whether the kernel processes both
+# channels or is a shared mono node (cost_model.h). the other kernels compare implementations and aren't nodes
+COST_NODES = {
+    'delay': ('FXDELAY', 'COST_ANY', False),
+    'overdrive': ('FXOVERDRIVE', 'DISTORTION_OVERSAMPLED', False),
+    'overdrive_lut': ('FXOVERDRIVE', 'DISTORTION_LUT', False),
+    'overdrive_adaa': ('FXOVERDRIVE', 'DISTORTION_ADAA', False),
+    'fuzz': ('FXFUZZ', 'DISTORTION_OVERSAMPLED', False),
+    'fuzz_lut': ('FXFUZZ', 'DISTORTION_LUT', False),
+    'fuzz_adaa': ('FXFUZZ', 'DISTORTION_ADAA', False),
+    'tremolo': ('FXTREMOLO', 'COST_ANY', False),
+    'ring_mod': ('FXRINGMOD', 'COST_ANY', False),
+    'phaser': ('FXPHASER', 'COST_ANY', False),
+    'fir_filter': ('FXFILTER', 'COST_ANY', False),
+    'eq': ('FXEQ', 'COST_ANY', False),
+    'chorus': ('FXCHORUS', 'COST_ANY', False),
+    'flanger': ('FXFLANGER', 'COST_ANY', False),
+    'gate': ('FXGATE', 'COST_ANY', False),
+    'comp': ('FXCOMP', 'COST_ANY', False),
+    'pitch': ('FXPITCH', 'COST_ANY', False),
+    'wah': ('FXWAH', 'COST_ANY', False),
+    'amp_lstm16': ('FXAMP', 'COST_AMP(AMP_LSTM, 16)', False),
+    'amp_lstm32': ('FXAMP', 'COST_AMP(AMP_LSTM, 32)', False),
+    'amp_gru16': ('FXAMP', 'COST_AMP(AMP_GRU, 16)', False),
+    'amp_gru32': ('FXAMP', 'COST_AMP(AMP_GRU, 32)', False),
+    'fxloop': ('FXLOOP', 'COST_ANY', False),
+    'denoise': ('FXDENOISE', 'COST_ANY', False),
+    'freeze': ('FXFREEZE', 'COST_ANY', False),
+    'pingpong': ('FXPINGPONG', 'COST_ANY', True),
+    'reverb': ('FXREVERB', 'COST_REVERB(NU_CONVOLVER_TAIL_STAGES)', True),
+    'reverb_short': ('FXREVERB', 'COST_REVERB(1)', True),
+    'reverb_fdn': ('FXREVERB', 'COST_REVERB_FDN', True),
+    'cab_64': ('FXCAB', 'COST_CAB(6)', True),
+    'cab_128': ('FXCAB', 'COST_CAB(7)', True),
+    'cab_256': ('FXCAB', 'COST_CAB(8)', True),
+    'cab_512': ('FXCAB', 'COST_CAB(9)', True),
+    'cab_1024': ('FXCAB', 'COST_CAB(10)', True),
+    'cab_2048': ('FXCAB', 'COST_CAB(11)', True)
+}
+# arenas of the memory columns (arena_class) and the kernels whose activation tries a second arena when the first has
+# no room: the first and the fallback arena. the table charges the bytes to the first one (cost_entry_t)
+COST_ARENAS = ['ARENA_TCM', 'ARENA_AXI', 'ARENA_AHB', 'ARENA_SHARED']
+COST_FALLBACKS = {
+    'denoise': (0, 2),
+    'freeze': (0, 2),
+    'pingpong': (2, 1)
+}
+
+
+def CostFallback(kernel):
+    '''
+    Summary:
+      Fallback arena of a kernel for the cost table, ARENA_CLASSES if its activation doesn't try
+      a second arena
+    Parameters:
+      kernel:         - kernel name of COST_NODES
+    Returns:
+      the arena_class as a C expression
+    '''
+    return COST_ARENAS[COST_FALLBACKS[kernel][1]] if kernel in COST_FALLBACKS else 'ARENA_CLASSES'
+
+
+def ReadFootprints(path):
+    '''
+    Summary:
+      Read the memory table of the benchmark firmware (lines starting with "bench_memory,"):
+      the bytes the activation of an effect took from every arena. The last repetition is kept.
+    Parameters:
+      path:           - text file with the SWO output
+    Returns:
+      dict of kernel name to the bytes taken from DTCM, AXI, D2 and D3 SRAM
+    '''
+    footprints = {}
+    with open(path, 'r', errors = 'ignore') as log:
+        for line in log:
+            fields = line.strip().split(',')
+            if (fields[0] != 'bench_memory') or (len(fields) != 6) or (fields[1] == 'kernel'):
+                continue
+            footprints[fields[1]] = [int(field) for field in fields[2:]]
+    return footprints
+
+
+def ReadContention(path):
+    '''
+    Summary:
+      Read the contention table of the benchmark firmware (lines starting with "bench_contention,"):
+      the cycles of every kernel at the largest block while the audio DMA and/or the MDMA use
+      the bus, and the slowdown against the quiet bus. The layout of the build (DMA buffer
+      placement and FIFO mode, from the "# contention" line) is added as a column, so the logs
+      of several builds can be concatenated and compared. The last repetition is kept.
+    Parameters:
+      path:           - text file with the SWO output
+    Returns:
+      pandas DataFrame with the columns layout, kernel, memory, traffic, cycles_per_block and
+      slowdown_percent
+    '''
+    import pandas as pd
+
+    columns = ['kernel', 'memory', 'traffic', 'cycles_per_block', 'slowdown_percent']
+    rows = []
+    layout = ''
+    with open(path, 'r', errors = 'ignore') as log:
+        for line in log:
+            if line.startswith('# contention'):
+                # "# contention, dma buffers d2, fifo, block 256" -> "d2 fifo"
+                layout = ' '.join(field.strip().replace('dma buffers ', '') for field in line.split(',')[1:3])
+                continue
+            fields = line.strip().split(',')
+            if (fields[0] != 'bench_contention') or (len(fields) != len(columns) + 1) or (fields[1] == 'kernel'):
+                continue
+            rows.append([layout] + fields[1:])
+
+    table = pd.DataFrame(rows, columns = ['layout'] + columns)
+    table = table.astype({'cycles_per_block': int, 'slowdown_percent': float})
+    return table.drop_duplicates(subset = ['layout', 'kernel', 'memory', 'traffic'], keep = 'last').reset_index(drop = True)
+
+
+def ExportCostTable(path, destination):
+    '''
+    Summary:
+      Write the cost table of the firmware (cost_table.h, see cost_model.h) from the SWO log of
+      the benchmark firmware: per node type and variant the cycles per block of every buffer
+      placement and block size, and the memory its activation takes. The build line of the log
+      (code placement, sample format, clock) goes into the header, the table is only valid for it.
+      A placement the benchmark had no room for (the reverb in AXI SRAM) is scaled from the DTCM
+      one by COST_PLACEMENT_FACTORS. Variants without a footprint of their own take the one of
+      the first kernel of the node, and memory the activation found in the fallback arena of the
+      kernel (COST_FALLBACKS) is charged to the first arena.
+    Parameters:
+      path:           - SWO log of the benchmark firmware (see ReadBenchmark)
+      destination:    - file path of the generated header
+    Returns:
+      None
+    '''
+    table = ReadBenchmark(path)
+    footprints = ReadFootprints(path)
+    build = ''
+    with open(path, 'r', errors = 'ignore') as log:
+        for line in log:
+            if line.startswith('# benchmark'):
+                build = line[2:].strip()
+
+    memories = ['dtcm', 'axi', 'd2']
+    blocks = [16 << b for b in range(5)]
+    with open(destination, 'w') as f:
+        f.write('// generated by analysis_helpers.ExportCostTable: %s\n' % build)
+        f.write('static const cost_entry_t cost_table[] =\n{\n')
+        for kernel, (fx, variant, stereo) in COST_NODES.items():
+            rows = table[table['kernel'] == kernel]
+            if rows.empty:
+                continue
+            dtcm = rows[rows['memory'] == 'dtcm'].set_index('block')['cycles_per_block']
+            cycles = []
+            for memory, factor in zip(memories, COST_PLACEMENT_FACTORS):
+                measured = rows[rows['memory'] == memory].set_index('block')['cycles_per_block']
+                cycles.append('{ ' + ', '.join(str(int(measured.get(block, factor * dtcm.get(block, 0)))) for block in blocks) + ' }')
+            memory = footprints.get(kernel)
+            if memory is None:
+                memory = next((footprints[name] for name, node in COST_NODES.items() if (node[0] == fx) and (name in footprints)), [0, 0, 0, 0])
+            memory = list(memory)
+            if kernel in COST_FALLBACKS:
+                primary, fallback = COST_FALLBACKS[kernel]
+                memory[primary] += memory[fallback]
+                memory[fallback] = 0
+            f.write('\t{ %s, %s, %s, { %s }, { %s }, %s },\n' % (fx, variant, 'true' if stereo else 'false', ', '.join(cycles),
+                ', '.join(str(m) for m in memory), CostFallback(kernel)))
+        f.write('\t{ FXNONE, COST_ANY, false, { { 0 } }, { 0 }, ARENA_CLASSES },\n};\n')
+
+
+# cost of the kernels of COST_NODES on the M7 until a benchmark log exists: cycles per sample and per block with the
+# buffers in DTCM (rough operation counts of the kernels at 480 MHz), and the bytes the activation of one channel takes
+# from the DTCM, AXI, D2 and D3 arenas, in the arena it tries first (COST_FALLBACKS). the reverb: the 24000 samples of
+# REVERB_MAX_IR_LENGTH, the spectra in AXI SRAM. the cabinet on the cheaper path (cab_choose_path), its filter memory
+# counts 0 (taken once by cab_init)
+COST_ESTIMATES = {
+    'delay': (10, 400, [0, 0, 131072, 0]),
+    'overdrive': (70, 600, [0, 0, 0, 0]),
+    'overdrive_lut': (8, 300, [0, 0, 0, 0]),
+    'overdrive_adaa': (22, 300, [0, 0, 0, 0]),
+    'fuzz': (75, 600, [0, 0, 0, 0]),
+    'fuzz_lut': (10, 300, [0, 0, 0, 0]),
+    'fuzz_adaa': (26, 300, [0, 0, 0, 0]),
+    'tremolo': (8, 300, [0, 0, 0, 0]),
+    'ring_mod': (8, 300, [0, 0, 0, 0]),
+    'phaser': (45, 400, [0, 0, 0, 0]),
+    'fir_filter': (48, 300, [0, 0, 0, 0]),
+    'eq': (20, 300, [0, 0, 0, 0]),
+    'chorus': (28, 400, [0, 0, 16384, 0]),
+    'flanger': (26, 400, [0, 0, 4096, 0]),
+    'gate': (12, 300, [0, 0, 0, 0]),
+    'comp': (18, 300, [0, 0, 0, 0]),
+    'pitch': (40, 400, [0, 0, 8192, 0]),
+    'wah': (24, 300, [0, 0, 0, 0]),
+    'amp_lstm16': (1400, 600, [0, 0, 0, 0]),
+    'amp_lstm32': (5000, 600, [0, 0, 0, 0]),
+    'amp_gru16': (1100, 600, [0, 0, 0, 0]),
+    'amp_gru32': (3900, 600, [0, 0, 0, 0]),
+    'fxloop': (6, 300, [0, 0, 0, 0]),
+    'denoise': (90, 1500, [5120, 0, 0, 0]),
+    'freeze': (60, 1500, [5120, 0, 0, 0]),
+    'pingpong': (30, 600, [0, 0, 262144, 0]),
+    'reverb': (480, 2000, [0, 459776, 0, 0]),
+    'reverb_short': (370, 2000, [0, 459776, 0, 0]),
+    'reverb_fdn': (60, 800, [2048, 131072, 0, 0]),
+    'cab_64': (80, 150, [0, 0, 0, 0]),
+    'cab_128': (108, 150, [0, 0, 0, 0]),
+    'cab_256': (122, 150, [0, 0, 0, 0]),
+    'cab_512': (150, 150, [0, 0, 0, 0]),
+    'cab_1024': (206, 150, [0, 0, 0, 0]),
+    'cab_2048': (319, 150, [0, 0, 0, 0])
+}
+# slowdown of the cycles per sample with the buffers in AXI SRAM and D2 SRAM instead of DTCM (cache misses, bus)
+COST_PLACEMENT_FACTORS = [1.0, 1.15, 1.25]
+
+
+def ExportCostEstimates(destination):
+    '''
+    Summary:
+      Write the cost table of the firmware (cost_table.h, see cost_model.h) from COST_ESTIMATES, the
+      starting point until the benchmark firmware ran on a board (ExportCostTable replaces it). The
+      memory is per channel, the table multiplies it by AUDIO_CHANNELS except for stereo kernels.
+    Parameters:
+      destination:    - file path of the generated header
+    Returns:
+      None
+    '''
+    blocks = [16 << b for b in range(5)]
+    with open(destination, 'w') as f:
+        f.write('// generated by analysis_helpers.ExportCostEstimates: estimates, no benchmark log yet\n')
+        f.write('// replace with the measured table of the benchmark firmware (generate_tables.py --costs)\n')
+        f.write('static const cost_entry_t cost_table[] =\n{\n')
+        for kernel, (fx, variant, stereo) in COST_NODES.items():
+            per_sample, per_block, memory = COST_ESTIMATES[kernel]
+            cycles = ['{ ' + ', '.join(str(int(per_block + factor * per_sample * block)) for block in blocks) + ' }'
+                for factor in COST_PLACEMENT_FACTORS]
+            memory = [str(m) if (m == 0) or stereo else '%d * AUDIO_CHANNELS' % m for m in memory]
+            f.write('\t{ %s, %s, %s, { %s }, { %s }, %s },\n' % (fx, variant, 'true' if stereo else 'false', ', '.join(cycles),
+                ', '.join(memory), CostFallback(kernel)))
+        f.write('\t{ FXNONE, COST_ANY, false, { { 0 } }, { 0 }, ARENA_CLASSES },\n};\n')
+
+# IMA-ADPCM tables of adpcm.c, for the frames of the post-mortem capture
+ADPCM_STEPS = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+    1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767]
+ADPCM_INDEX_CHANGE = [-1, -1, -1, -1, 2, 4, 6, 8]
+# capture_record_t of capture.h and the events of a block (capture_event)
+CAPTURE_RECORD = '<IIIIIHBB'
+CAPTURE_EVENTS = {0x01: 'dropout', 0x02: 'clip', 0x04: 'deadline', 0x08: 'manual'}
+
+
+def DecodeAdpcm(frame, n):
+    '''
+    Summary:
+      Decode one frame of adpcm_encode (adpcm.c): predictor and step index in the header, then
+      two codes per byte, the earlier sample in the low nibble
+    Parameters:
+      frame:          - bytes of the frame
+      n:              - samples of the frame
+    Returns:
+      list of n samples as q15 integers
+    '''
+    predictor = int.from_bytes(frame[0:2], 'little', signed = True)
+    index = min(frame[2], len(ADPCM_STEPS) - 1)
+    samples = []
+    for i in range(n):
+        code = (frame[4 + i // 2] >> (4 * (i & 1))) & 0x0F
+        step = ADPCM_STEPS[index]
+        delta = step >> 3
+        if code & 4:
+            delta += step
+        if code & 2:
+            delta += step >> 1
+        if code & 1:
+            delta += step >> 2
+        predictor = max(-32768, min(32767, predictor - delta if code & 8 else predictor + delta))
+        index = max(0, min(len(ADPCM_STEPS) - 1, index + ADPCM_INDEX_CHANGE[code & 7]))
+        samples.append(predictor)
+    return samples
+
+
+def ReadCapture(path):
+    '''
+    Summary:
+      Read a post-mortem capture of the pedal (capture.h), written by host_link.HostLink.save_capture:
+      the left input and output of the last blocks before and after the event that froze the ring,
+      with the profiler timestamps of every block.
+    Parameters:
+      path:           - file written by save_capture
+    Returns:
+      dictionary with the info of the ring (see host_link.parse_capture_info), 'input' and 'output'
+      (numpy arrays, full scale 1), 'blocks' (one dict per record: sequence, start, rx, fx, tx
+      cycles, clips, mode, events) and 'triggerSample', the first sample of the block that triggered
+    '''
+    import struct
+    from numpy import array, float64
+    import host_link
+
+    with open(path, 'rb') as file:
+        data = file.read()
+    head = struct.calcsize(host_link.CAPTURE_INFO_FORMAT)
+    info = host_link.parse_capture_info(data[:head])
+    n = info['block_size']
+    frame = 4 + n // 2
+    size = struct.calcsize(CAPTURE_RECORD)
+    assert info['record_bytes'] == size + 2 * frame, "record layout doesn't match capture_record_t"
+
+    signals = ([], [])
+    blocks = []
+    trigger = None
+    for r in range(info['records']):
+        record = data[head + r * info['record_bytes']:head + (r + 1) * info['record_bytes']]
+        fields = struct.unpack_from(CAPTURE_RECORD, record)
+        blocks.append(dict(zip(('sequence', 'start', 'rx', 'fx', 'tx', 'clips', 'mode', 'events'), fields)))
+        if (trigger is None) and (fields[0] == info['trigger']) and info['reason']:
+            trigger = r * n
+        for s in range(2):
+            signals[s].extend(DecodeAdpcm(record[size + s * frame:size + (s + 1) * frame], n))
+    return dict(info, input = array(signals[0], dtype = float64) / 32768, output = array(signals[1], dtype = float64) / 32768,
+        blocks = blocks, triggerSample = trigger)
+
+
+def PlotCapture(capture, destination = 'capture', figsize = (9, 9), dpi = 100):
+    '''
+    Summary:
+      Plot a post-mortem capture (ReadCapture): input and output over time, the load of every
+      block in % of the budget split into rx, fx and tx, and the blocks with events. Blocks lost
+      to overruns show as gaps in the sequence, marked like the events.
+    Parameters:
+      capture:        - dictionary of ReadCapture
+      destination:    - file name of the figure in the Results directory, None to only show it
+    Returns:
+      None
+    '''
+    from numpy import arange, array
+    import matplotlib.pyplot as plt
+
+    n = capture['block_size']
+    rate = float(capture['sample_rate'])
+    blocks = capture['blocks']
+    t = arange(len(capture['input'])) / rate
+    starts = arange(len(blocks)) * n / rate
+    budget = float(capture['budget'])
+    load = {key: array([b[key] for b in blocks]) / budget * 100 for key in ('rx', 'fx', 'tx')}
+
+    plt.rcParams["figure.figsize"] = figsize
+    plt.rcParams["figure.dpi"] = dpi
+    fig, axes = plt.subplots(3, sharex = True)
+    fig.tight_layout(pad = 3.0)
+    axes[0].plot(t, capture['input'])
+    axes[0].set_title('Input (left)')
+    axes[1].plot(t, capture['output'])
+    axes[1].set_title('Output (left)')
+    axes[2].bar(starts, load['rx'], width = n / rate, align = 'edge', label = 'rx')
+    axes[2].bar(starts, load['fx'], width = n / rate, align = 'edge', bottom = load['rx'], label = 'fx')
+    axes[2].bar(starts, load['tx'], width = n / rate, align = 'edge', bottom = load['rx'] + load['fx'], label = 'tx')
+    axes[2].axhline(100, color = 'k', linestyle = '--')
+    axes[2].set_title('Load [% of the block budget]')
+    axes[2].legend(loc = 'upper left')
+    for b, block in enumerate(blocks):
+        names = [name for bit, name in CAPTURE_EVENTS.items() if block['events'] & bit]
+        if (b > 0) and (block['sequence'] != blocks[b - 1]['sequence'] + 1):
+            names.append('gap')
+        for ax in axes:
+            for name in names:
+                ax.axvline(starts[b], color = 'r' if name in ('dropout', 'gap') else 'orange', alpha = 0.5)
+    if capture['triggerSample'] is not None:
+        for ax in axes:
+            ax.axvline(capture['triggerSample'] / rate, color = 'k')
+    reason = ', '.join(name for bit, name in CAPTURE_EVENTS.items() if capture['reason'] & bit)
+    fig.suptitle('Capture of %d blocks of %d samples, triggered by %s' % (len(blocks), n, reason or 'nothing'))
+    plt.xlabel('time [s]')
+    if destination is not None:
+        plt.savefig(ResultsPath() + destination)
+    plt.show()
@@ -204,36 +204,70 @@ def cos_wave(A, f, Fs, s):
     x = A * cos(w * t)
     return x
 
-def overdrive(signal, threshold = 1/3):
+def render_blocks(signal, process, blockSize = 64, state = None):
     '''
     Summary:
-      Creates a soft-clipped version of the passed wave array.
+      Stream a signal through a block kernel the way the firmware does: blocks of blockSize
+      samples (PING_PONG_BUFFER_SIZE, one half of the DMA buffer) one after the other, the state
+      of the effect (e.g. the LFO phase) carried from one block to the next. The last block may
+      be shorter.
+    Parameters:
+      signal:       - mono wave array
+      process:      - kernel, process(block, state) returns the output block and the state
+                      for the next block
+      blockSize:    - samples per block
+      state:        - state before the first block
+    Returns:
+      the output wave array
+    '''
+    from numpy import zeros
+    out = zeros(len(signal))
+    for start in range(0, len(signal), blockSize):
+        out[start:start + blockSize], state = process(signal[start:start + blockSize], state)
+    return out
+
+def lfo_phase(N, increment, phase = 0.0):
+    '''
+    Summary:
+      Phase of the low-frequency oscillator of the modulation effects for a block of N samples:
+      sample i is at phase + i * increment, wrapped into 0 to 2 pi, as the per-sample
+      accumulation (t += increment, minus 2 pi after a period) advances it.
+    Parameters:
+      N:            - number of samples
+      increment:    - phase step per sample in radians
+      phase:        - phase of the first sample
+    Returns:
+      array with the phase of every sample, phase of the sample after the block
+    '''
+    from numpy import arange, pi
+    phases = (phase + increment * arange(N)) % (2 * pi)
+    return phases, (phase + increment * N) % (2 * pi)
+
+def overdrive(signal, threshold = 1/3, blockSize = None):
+    '''
+    Summary:
+      Creates a soft-clipped version of the passed wave array. Vectorized: the clipping curve is
+      evaluated for all samples at once, in blocks with blockSize. The first sample of the
+      signal stays 0, as in the former per-sample loop (it started at 1), so renders are identical.
     Parameters:
       signal:           - the wave array to process
       threshold:        - determines how steep the clipped wave form is. 
                           values exceeding 0.4 will no longer sound ok.
+      blockSize:        - None: the whole signal in one go. 64: blocks as the firmware processes
+                          them (the curve has no state, the output is the same)
     Returns:
       the modified wave array
     '''
-    from numpy import zeros
-    N = len(signal)
-    y = zeros(N)
-    signal = toMono(signal)
+    from numpy import abs, sign, where
+
+    def process(block, state):
+        a = abs(block)
+        knee = sign(block) * (3 - (2 - a * 3) ** 2) / 3
+        return where(a < threshold, 2 * block, where(a > 2 * threshold, sign(block), knee)), state
 
-    for i in range(1, N):
-        if abs(signal[i]) < threshold:
-            y[i] = 2 * signal[i]
-        if abs(signal[i]) > 2 * threshold:
-            if signal[i] > 0:
-                y[i] = 1
-            if signal[i] < 0:
-                y[i] = -1
-        elif abs(signal[i]) >= threshold:
-            if signal[i] > 0:
-                y[i] = (3 - (2 - signal[i] * 3) **2) / 3
-            if signal[i] < 0:
-                y[i] = - (3 - (2 - abs(signal[i]) * 3) ** 2) / 3
-        
+    signal = toMono(signal)
+    y = render_blocks(signal, process, blockSize or max(len(signal), 1))
+    y[:1] = 0
     return y
 
 def fuzz(signal, gain = 11, mix = 0.2):
@@ -252,87 +286,83 @@ def fuzz(signal, gain = 11, mix = 0.2):
     '''
     
     signal = toMono(signal)
+    peak = max(abs(signal))
+    # gain 0 or a silent signal: no wet part to scale (the divisions below would give NaN)
+    if (gain == 0) or (peak == 0):
+        return (1-mix)*signal
     # downscale samples and multiply with gain value
-    q = signal * gain / max(abs(signal))    
+    q = signal * gain / peak
 	# invert sign and multiply with e-function
     z = sign(-q) * (1 - exp(sign(-q)*q))
 	#  blend dry and upscaled wet signal
-    return mix * z * max(abs(signal))/max(abs(z))+(1-mix)*signal
+    return mix * z * peak/max(abs(z))+(1-mix)*signal
 
-def tremolo(signal, rate = 0.5, depth = 0.5):
+def tremolo(signal, rate = 0.5, depth = 0.5, blockSize = None):
     '''
     Algorithm translated to python from:
     https://wiki.analog.com/resources/tools-software/sharc-audio-module/baremetal/tremelo-effect-tutorial
     
     Summary:
-      Amplitude modulation with low-frequency carrier wave. Results in iconic, wobbly sounding audio
+      Amplitude modulation with low-frequency carrier wave. Results in iconic, wobbly sounding audio.
+      Vectorized: the LFO phase of a whole block comes from lfo_phase, the result matches the
+      former per-sample loop to floating point rounding.
     Parameters:
       signal:       - the wave array to apply the effect to
       rate:         - rate of change. this factors into the modulating signal's frequency
       depth:        - modulation depth. 
+      blockSize:    - None: the whole signal in one go. 64: blocks as the firmware processes
+                      them, the LFO phase carried from block to block
     Returns:
       the modified wave array
     '''
 
-    from numpy import zeros, pi, sin
+    from numpy import sin
     assert (rate >= 0) and (rate <= 1) and (depth >= 0) and (depth <= 1) 
     
-    signal = toMono(signal)
-
-    t = 0.0
-    N = len(signal)
-    out = zeros(N)
-    for i in range(N):
-        # calculate modulation factor for this sample
+    def process(block, phase):
+        t, phase = lfo_phase(len(block), rate * 0.002, phase)
+        # modulation factor of every sample
         factor = 1 - (depth * 0.5 * sin(t) + 0.5)
-        t += rate * 0.002
-        if (t > 2 * pi):
-            t -= 2 * pi
-        out[i] = factor * signal[i]
-    return out
+        return factor * block, phase
 
-def ring_modulator(signal, modulator, rate = 0.5, blend = 0.5):
+    signal = toMono(signal)
+    return render_blocks(signal, process, blockSize or max(len(signal), 1), 0.0)
+
+def ring_modulator(signal, modulator, rate = 0.5, blend = 0.5, blockSize = None):
     '''
     Algorithm translated to python from:
     https://wiki.analog.com/resources/tools-software/sharc-audio-module/baremetal/ring-modulator-effect-tutorial
     
     Summary:
       DSB-SC modulation with low-frequency carrier wave. Can be hard to find settings that sound well.
+      Vectorized as the tremolo: the carrier of a whole block is computed from lfo_phase.
     Parameters:
       signal:       - the wave array to apply the effect to.
-      modulator:    - the type of modulating wave form.
+      modulator:    - the type of modulating wave form: 0 sine, 1 triangle, 2 square.
       rate:         - rate of change. this factors into the modulating signal's frequency.
       blend:        - the ratio of modulated signal to unmodulated signal. 
+      blockSize:    - None: the whole signal in one go. 64: blocks as the firmware processes
+                      them, the carrier phase carried from block to block
     Returns:
       the modified wave array
     '''
 
-    from numpy import zeros, pi, sin
+    from numpy import sin, where
     assert (rate >= 0) and (rate <= 1) and (blend >= 0) and (blend <= 1) and (modulator >= 0) and (modulator < 3)
-  
-    t = 0.0
-    N = len(signal)
-    out = zeros(N)    
-
-    signal = toMono(signal)
 
-    for i in range(N):       
-        
+    def process(block, phase):
+        t, phase = lfo_phase(len(block), rate * 0.02, phase)
         if (modulator == 0):
             factor = sin(t)
         elif (modulator == 1):
             factor = triangle_alt(t)
-        elif (modulator == 2):
-            factor = square_wave(t)
-
-        t += rate * 0.02        
+        else:
+            # square_wave for every sample
+            factor = where(sin(t) >= 0.0, 1.0, -1.0)
+        return (1 - blend) * block + blend * factor * block, phase
 
-        if (t > 2 * pi):
-            t -= 2 * pi
-        
-        out[i] = (1 - blend) * signal[i] + blend * factor * signal[i]
-    
-    return out
+    signal = toMono(signal)
+    return render_blocks(signal, process, blockSize or max(len(signal), 1), 0.0)
 
 def FIR_delay(signal, delayMilliseconds, delayAmplitude, Fs = 48000):
     '''
@@ -408,4 +438,625 @@ def Reverb(ir_samplingRate, impulseResponse, signal, Fs):
     # combine dry signal with the wet signal. lower the magnitude of the wet signal by 6dB (approx. half the volume)
     outSignal = drySignal + dB_to_magnitude(-3) * wetSignal
     # normalize again to avoid clipping
-    return normalize(outSignal)
\ No newline at end of file
+    return normalize(outSignal)
+def prepare_reverb_ir(ir_samplingRate, impulseResponse, Fs, maxLength):
+    '''
+    Summary:
+      Convert an impulse response to mono, resample it to Fs, truncate it to maxLength samples and normalize it
+      to unit energy (shared by export_ir_header and export_ir_spectra).
+    Parameters:
+      ir_samplingRate:             - sampling rate of the impulse response
+      impulseResponse:             - impulse response wave array
+      Fs:                          - sampling frequency/rate of the result
+      maxLength:                   - maximum number of samples
+    Returns:
+      the prepared impulse response, at exactly Fs
+    Raises:
+      ValueError if a rate isn't a whole number of Hz: the ratio of resample_poly and name_RATE of the header
+      would be off
+    '''
+    from numpy import sqrt, sum
+    from scipy.signal import resample_poly
+    from math import gcd
+
+    if (Fs != int(Fs)) or (ir_samplingRate != int(ir_samplingRate)):
+        raise ValueError("sampling rates have to be whole numbers of Hz: %s, %s" % (ir_samplingRate, Fs))
+    impulseResponse = toMono(impulseResponse).astype(float)
+    assert impulseResponse.ndim == 1
+
+    if int(Fs) != int(ir_samplingRate):
+        # e.g. 44.1 kHz -> 48 kHz: up 160, down 147
+        common = gcd(int(Fs), int(ir_samplingRate))
+        impulseResponse = resample_poly(impulseResponse, int(Fs) // common, int(ir_samplingRate) // common)
+    impulseResponse = impulseResponse[:maxLength]
+    # unit energy: wet and dry signal have about the same loudness at blend = 0.5
+    return impulseResponse / sqrt(sum(impulseResponse ** 2))
+
+def export_ir_header(ir_samplingRate, impulseResponse, path, name = "reverb_ir", Fs = 48000, maxLength = 24000):
+    '''
+    Summary:
+      Export an impulse response as C header for the convolution reverb (reverb_init in fx_lib.c).
+      The impulse response is converted to mono, resampled to the sampling rate of the pedal,
+      truncated to the maximum length the firmware can hold (REVERB_MAX_IR_LENGTH) and normalized to unit energy.
+      With Fs = None the recorded rate is kept, the firmware converts the response when it is loaded.
+      name_RATE is defined as the rate of the exported samples (ir_rate of reverb_init), the rate prepare_reverb_ir
+      resampled to: a rate it can't resample to exactly raises ValueError instead of being written.
+    Parameters:
+      ir_samplingRate:             - sampling rate of the impulse response
+      impulseResponse:             - impulse response wave array
+      path:                        - file path of the generated header
+      name:                        - name of the C array. name_LENGTH is defined as its length
+      Fs:                          - sampling frequency/rate of the pedal, None to keep ir_samplingRate
+      maxLength:                   - maximum number of samples
+    Returns:
+      the exported impulse response
+    '''
+    if Fs is None:
+        Fs = ir_samplingRate
+    impulseResponse = prepare_reverb_ir(ir_samplingRate, impulseResponse, Fs, maxLength)
+
+    with open(path, "w") as f:
+        f.write("// generated by dsp_helpers.export_ir_header\n")
+        f.write("#define %s_LENGTH (%d)\n" % (name.upper(), len(impulseResponse)))
+        f.write("#define %s_RATE (%d)\n" % (name.upper(), int(Fs)))
+        f.write("const float32_t %s[%s_LENGTH] = \n{\n" % (name, name.upper()))
+        for i in range(0, len(impulseResponse), 8):
+            f.write("\t" + ", ".join("%.9ef" % v for v in impulseResponse[i:i + 8]) + ",\n")
+        f.write("};\n")
+
+    return impulseResponse
+
+def ir_spectra(impulseResponse, partitionSize = 64):
+    '''
+    Summary:
+      Transform an impulse response like nu_convolver_load (convolver.c): the time reversed head coefficients, the
+      body spectra (partitions of P) and the spectra of the two tail stages (partitions of 8P from 16P on, partitions
+      of 32P from 64P on), zero padded to twice the partition size and in the packed format of arm_rfft_fast_f32
+      (DC and Nyquist real values first, then real/imaginary pairs, unscaled).
+    Parameters:
+      impulseResponse:             - prepared impulse response (prepare_reverb_ir)
+      partitionSize:               - CONVOLVER_PARTITION_SIZE of the firmware (PING_PONG_BUFFER_SIZE)
+    Returns:
+      list of (name, values, partitions) for head, body, tail0 and tail1. partitions is None for the head
+    '''
+    from numpy import zeros
+    from numpy.fft import rfft
+
+    # stage layout of convolver.h: NU_CONVOLVER_BODY_PARTITIONS, NU_CONVOLVER_TAIL0_* and NU_CONVOLVER_TAIL1_*
+    bodyPartitions = 15
+    tails = [(8 * partitionSize, 16 * partitionSize, 6), (32 * partitionSize, 64 * partitionSize, None)]
+    length = len(impulseResponse)
+
+    def spectra(offset, size, count):
+        # packed real FFT of every partition in [offset, offset + count * size), same as arm_rfft_fast_f32
+        result = []
+        while (offset < length) and ((count is None) or (len(result) < count)):
+            segment = zeros(2 * size)
+            part = impulseResponse[offset:offset + size]
+            segment[:len(part)] = part
+            X = rfft(segment)
+            packed = zeros(2 * size)
+            packed[0] = X[0].real
+            packed[1] = X[size].real
+            packed[2::2] = X[1:size].real
+            packed[3::2] = X[1:size].imag
+            result.append(packed)
+            offset += size
+        return [v for p in result for v in p], len(result)
+
+    head = zeros(partitionSize)
+    head[:min(length, partitionSize)] = impulseResponse[:partitionSize]
+    arrays = [("head", list(head[::-1]), None)]
+    body, count = spectra(partitionSize, partitionSize, bodyPartitions)
+    arrays.append(("body", body, count))
+    for i, (size, offset, count) in enumerate(tails):
+        values, count = spectra(offset, size, count)
+        arrays.append(("tail%d" % i, values, count))
+    return arrays
+
+def export_ir_spectra(ir_samplingRate, impulseResponse, path, name = "reverb_image", Fs = 48000, maxLength = 24000, partitionSize = 64):
+    '''
+    Summary:
+      Export an impulse response as C header with its partitions already transformed (ir_spectra), in the layout
+      of the non-uniformly partitioned convolver (nu_convolver_load_image in convolver.c, reverb_set_image in
+      fx_lib.c). The arrays are const, so they stay in flash. The impulse response is prepared like in export_ir_header.
+    Parameters:
+      ir_samplingRate:             - sampling rate of the impulse response
+      impulseResponse:             - impulse response wave array
+      path:                        - file path of the generated header
+      name:                        - name of the nu_convolver_image_t. name_LENGTH and name_RATE are defined
+      Fs:                          - sampling frequency/rate of the pedal (the image is only used at this rate)
+      maxLength:                   - maximum number of samples (REVERB_MAX_IR_LENGTH)
+      partitionSize:               - CONVOLVER_PARTITION_SIZE of the firmware (PING_PONG_BUFFER_SIZE)
+    Returns:
+      the exported impulse response
+    '''
+    impulseResponse = prepare_reverb_ir(ir_samplingRate, impulseResponse, Fs, maxLength)
+    length = len(impulseResponse)
+    arrays = ir_spectra(impulseResponse, partitionSize)
+
+    with open(path, "w") as f:
+        f.write("// generated by dsp_helpers.export_ir_spectra\n")
+        f.write("#define %s_LENGTH (%d)\n" % (name.upper(), length))
+        f.write("#define %s_RATE (%d)\n" % (name.upper(), int(Fs)))
+        for suffix, values, count in arrays:
+            if len(values):
+                write_c_array(f, "%s_%s" % (name, suffix), values, storage = "static const")
+        pointer = lambda suffix, values: ("%s_%s" % (name, suffix)) if len(values) else "NULL"
+        f.write("const nu_convolver_image_t %s = \n{\n" % name)
+        f.write("\t%d, %s_RATE, %s_LENGTH, %d, { %d, %d },\n" % (partitionSize, name.upper(), name.upper(),
+            arrays[1][2], arrays[2][2], arrays[3][2]))
+        f.write("\t%s, %s, { %s, %s }\n" % (pointer(*arrays[0][:2]), pointer(*arrays[1][:2]),
+            pointer(*arrays[2][:2]), pointer(*arrays[3][:2])))
+        f.write("};\n")
+
+    return impulseResponse
+
+def minimum_phase(impulseResponse):
+    '''
+    Summary:
+      Convert an impulse response to minimum phase with the same magnitude response (real cepstrum method).
+      The energy moves to the start of the response, so it can be truncated with less loss, and a cabinet
+      response gets no pre-delay before its first peak.
+    Parameters:
+      impulseResponse:             - impulse response wave array
+    Returns:
+      the minimum phase impulse response, same length as the input
+    '''
+    from numpy import abs, exp, log, maximum, real, zeros
+    from numpy.fft import fft, ifft
+
+    length = len(impulseResponse)
+    # long FFT: the cepstrum of the log spectrum is not time limited, a short FFT would alias it
+    n = 1
+    while n < 8 * length:
+        n <<= 1
+
+    cepstrum = real(ifft(log(maximum(abs(fft(impulseResponse, n)), 1e-10))))
+    # fold the anti-causal part of the cepstrum onto the causal part
+    fold = zeros(n)
+    fold[0] = 1
+    fold[1:n // 2] = 2
+    fold[n // 2] = 1
+    return real(ifft(exp(fft(cepstrum * fold))))[:length]
+
+def prepare_cab_ir(ir_samplingRate, impulseResponse, Fs, maxLength, minimumPhase = True):
+    '''
+    Summary:
+      Convert a cabinet impulse response to mono, resample it to Fs, optionally convert it to minimum phase, truncate
+      it to maxLength samples with a short fade out and normalize it to a peak magnitude response of 1 (shared by
+      export_cab_header and export_library).
+    Parameters:
+      ir_samplingRate:             - sampling rate of the impulse response
+      impulseResponse:             - impulse response wave array
+      Fs:                          - sampling frequency/rate of the result
+      maxLength:                   - maximum number of samples
+      minimumPhase:                - convert to minimum phase before truncating
+    Returns:
+      the prepared impulse response
+    '''
+    from numpy import abs, hanning, max
+    from numpy.fft import rfft
+    from scipy.signal import resample_poly
+    from math import gcd
+
+    impulseResponse = toMono(impulseResponse).astype(float)
+    assert impulseResponse.ndim == 1
+
+    common = gcd(int(Fs), int(ir_samplingRate))
+    impulseResponse = resample_poly(impulseResponse, int(Fs) // common, int(ir_samplingRate) // common)
+    if minimumPhase:
+        impulseResponse = minimum_phase(impulseResponse)
+    impulseResponse = impulseResponse[:maxLength].copy()
+    # fade out the last 1/8, a hard cut would ripple the magnitude response
+    fade = len(impulseResponse) // 8
+    if fade > 1:
+        impulseResponse[-fade:] *= hanning(2 * fade)[fade:]
+    return impulseResponse / max(abs(rfft(impulseResponse, 8 * len(impulseResponse))))
+
+def export_cab_header(ir_samplingRate, impulseResponse, path, name = "cab_ir", Fs = 48000, maxLength = 2048, minimumPhase = True):
+    '''
+    Summary:
+      Export a speaker cabinet impulse response as C header for the cabinet simulation (cab_init in fx_lib.c).
+      The impulse response is converted to mono, resampled to the sampling rate of the pedal, optionally converted to
+      minimum phase, truncated to the maximum length the firmware can hold (CAB_MAX_TAPS) with a short fade out and
+      normalized to a peak magnitude response of 1 (0 dB).
+    Parameters:
+      ir_samplingRate:             - sampling rate of the impulse response
+      impulseResponse:             - impulse response wave array
+      path:                        - file path of the generated header
+      name:                        - name of the C array. name_LENGTH is defined as its length
+      Fs:                          - sampling frequency/rate of the pedal
+      maxLength:                   - maximum number of samples (256 to 2048)
+      minimumPhase:                - convert to minimum phase before truncating
+    Returns:
+      the exported impulse response
+    '''
+    impulseResponse = prepare_cab_ir(ir_samplingRate, impulseResponse, Fs, maxLength, minimumPhase)
+
+    with open(path, "w") as f:
+        f.write("// generated by dsp_helpers.export_cab_header\n")
+        f.write("#define %s_LENGTH (%d)\n" % (name.upper(), len(impulseResponse)))
+        f.write("const float32_t %s[%s_LENGTH] = \n{\n" % (name, name.upper()))
+        for i in range(0, len(impulseResponse), 8):
+            f.write("\t" + ", ".join("%.9ef" % v for v in impulseResponse[i:i + 8]) + ",\n")
+        f.write("};\n")
+
+    return impulseResponse
+
+def amp_model_payload(model, maxHidden = 32, maxPost = 4):
+    '''
+    Summary:
+      Pack a captured amp model for the inference engine of the firmware (amp_model.h): one LSTM or GRU layer with
+      input size 1 and the dense output layer, as trained with PyTorch (nn.LSTM / nn.GRU and nn.Linear, gates in the
+      PyTorch order), optionally the skip connection (the input is added to the output) and a post-filter as second
+      order sections. Layout: cell, hidden, skip, post stages (uint32), then weight_ih, weight_hh, bias_ih, bias_hh,
+      the dense weights and bias, and b0, b1, b2, -a1, -a2 per section (floats). Little endian.
+    Parameters:
+      model:                       - dict: "cell" ("lstm" or "gru"), "weight_ih" (gates x 1), "weight_hh" (gates x
+                                     hidden), "bias_ih", "bias_hh" (gates), "lin_weight" (1 x hidden), "lin_bias" (1),
+                                     optional "skip" (bool) and "sos" (scipy second order sections, n x 6)
+      maxHidden:                   - AMP_MODEL_MAX_HIDDEN of the firmware, hidden units have to be a multiple of 4
+      maxPost:                     - AMP_MODEL_MAX_POST of the firmware
+    Returns:
+      the payload bytes
+    '''
+    import struct
+    from numpy import asarray, concatenate, float32, zeros
+
+    cell = {"lstm": 0, "gru": 1}[model["cell"]]
+    weightHH = asarray(model["weight_hh"], dtype = float32)
+    gates, hidden = weightHH.shape
+    assert gates == (4 if cell == 0 else 3) * hidden
+    assert 0 < hidden <= maxHidden and hidden % 4 == 0
+    sos = asarray(model.get("sos", zeros((0, 6))), dtype = float32).reshape(-1, 6)
+    assert len(sos) <= maxPost
+    # arm_biquad_cascade_df2T_f32 adds the feedback terms: a1 and a2 negated, a0 normalized to 1
+    post = concatenate([concatenate((s[:3] / s[3], -s[4:] / s[3])) for s in sos]) if len(sos) else zeros(0, dtype = float32)
+
+    weights = concatenate([asarray(model[k], dtype = float32).ravel() for k in ("weight_ih", "weight_hh", "bias_ih", "bias_hh", "lin_weight", "lin_bias")] + [post.astype(float32)])
+    assert len(weights) == gates * (hidden + 3) + hidden + 1 + 5 * len(sos)
+    return struct.pack("<4I", cell, hidden, int(bool(model.get("skip", False))), len(sos)) + struct.pack("<%df" % len(weights), *weights)
+
+def export_library(entries, path, Fs = 48000, reverbLength = 24000, cabLength = 2048, partitionSize = 64):
+    '''
+    Summary:
+      Write an impulse response and preset library file (library.h in the firmware, programmed at
+      LIBRARY_IMAGE_BASE). Reverb responses are prepared like in export_ir_header and stored transformed
+      (ir_spectra), so the firmware streams them into the convolver without FFTs. Cabinet responses are prepared
+      like in export_cab_header. The amp models are selected by their number on the Amp model page. A preset is a
+      dict with the effect "mode" and "values" {menu index of the effect: [menu values 0 to 100 of its parameters]}.
+      File layout: header (magic "IRLB", version 1, entry count, 0), 32 byte directory entries (name, kind, rate,
+      size, offset), payloads. Little endian.
+    Parameters:
+      entries:                     - list of (kind, name, data): ("reverb", name, (ir_samplingRate, impulseResponse)),
+                                     ("cab", name, (ir_samplingRate, impulseResponse)), ("preset", name, dict) or
+                                     ("amp", name, (model_samplingRate, model)), see amp_model_payload. A model
+                                     runs at the rate it was trained at only, it can't be resampled
+      path:                        - file path of the library
+      Fs:                          - sampling frequency/rate of the pedal, the responses are resampled to it
+      reverbLength:                - maximum number of reverb samples (REVERB_MAX_IR_LENGTH)
+      cabLength:                   - maximum number of cabinet samples (CAB_MAX_TAPS)
+      partitionSize:               - CONVOLVER_PARTITION_SIZE of the firmware (PING_PONG_BUFFER_SIZE)
+    Returns:
+      None
+    '''
+    import struct
+
+    # firmware constants: LIBRARY_MAX_ENTRIES, LIBRARY_NAME_SIZE, PRESET_EFFECTS, PRESET_PARAMETERS, PRESET_UNSET
+    maxEntries, nameSize, effects, parameters, unset = 64, 16, 22, 5, 0xFF
+    kinds = {"reverb": 0, "cab": 1, "preset": 2, "amp": 3}
+    assert len(entries) <= maxEntries
+
+    payloads = []
+    for kind, name, data in entries:
+        if kind == "reverb":
+            impulseResponse = prepare_reverb_ir(data[0], data[1], Fs, reverbLength)
+            arrays = ir_spectra(impulseResponse, partitionSize)
+            payload = struct.pack("<%dI" % 5, partitionSize, len(impulseResponse), arrays[1][2], arrays[2][2], arrays[3][2])
+            for _, values, _ in arrays:
+                payload += struct.pack("<%df" % len(values), *values)
+            rate = Fs
+        elif kind == "cab":
+            impulseResponse = prepare_cab_ir(data[0], data[1], Fs, cabLength)
+            payload = struct.pack("<%df" % len(impulseResponse), *impulseResponse)
+            rate = Fs
+        elif kind == "amp":
+            payload = amp_model_payload(data[1])
+            rate = int(data[0])
+        else:
+            values = bytearray([unset] * (effects * parameters))
+            for fx, parameterValues in data.get("values", {}).items():
+                for p, v in enumerate(parameterValues):
+                    values[fx * parameters + p] = int(v)
+            payload = bytes([int(data["mode"])]) + bytes(values)
+            rate = 0
+        payloads.append((kinds[kind], name.encode("ascii")[:nameSize], rate, payload))
+
+    offset = 16 + 32 * len(payloads)
+    with open(path, "wb") as f:
+        f.write(struct.pack("<4I", 0x424C5249, 1, len(payloads), 0))
+        for kind, name, rate, payload in payloads:
+            f.write(name.ljust(nameSize, b"\0") + struct.pack("<4I", kind, rate, len(payload), offset))
+            offset += len(payload)
+        for _, _, _, payload in payloads:
+            f.write(payload)
+
+def write_c_array(f, name, values, placement = "", align = 32, storage = "const", size = None, rows = None, columns = None):
+    '''
+    Summary:
+      Write a float32_t array definition, 8 values per line in full float precision. Aligned to align bytes (the cache
+      line, and the CMSIS kernels load the coefficients in pairs), placed with an attribute of defines_and_constants.h.
+      With rows, the array is two-dimensional: len(values) // rows values per row.
+    Parameters:
+      f:                           - open header file
+      name:                        - name of the array
+      values:                      - flat list of the values
+      placement:                   - DTCM_INIT (copied into the DTCM at reset), "" for flash
+      align:                       - alignment in bytes, 0 for none
+      storage:                     - storage class and qualifiers
+      size:                        - text of the (first) dimension, the number of values (rows) if None
+      rows:                        - number of rows of a two-dimensional array
+      columns:                     - text of the second dimension, the number of values per row if None
+    Returns:
+      None
+    '''
+    perRow = len(values) // rows if rows else len(values)
+    assert not rows or perRow * rows == len(values)
+    dims = "[%s]" % (size if size else (rows if rows else len(values)))
+    if rows:
+        dims += "[%s]" % (columns if columns else perRow)
+    attributes = (" __attribute__((aligned(%d)))" % align) if align else ""
+    f.write("%s float32_t%s %s%s%s = \n{\n" % (storage, attributes, name, dims, (" " + placement) if placement else ""))
+    for r in range(rows if rows else 1):
+        row = values[r * perRow:(r + 1) * perRow]
+        if rows:
+            f.write("\t{\n")
+        for i in range(0, len(row), 8):
+            f.write(("\t\t" if rows else "\t") + ", ".join("%.9ef" % v for v in row[i:i + 8]) + ",\n")
+        if rows:
+            f.write("\t},\n")
+    f.write("};\n")
+
+def windowed_sinc(numTaps, cutoff, Fs = 48000, window = "hamming", highpass = False):
+    '''
+    Summary:
+      Design a linear phase FIR lowpass or highpass with the window method: the ideal (sinc) impulse response of the
+      cutoff, multiplied with the window and normalized to unity gain at DC (lowpass) or Fs/2 (highpass, by spectral
+      inversion of the lowpass). Pure Python, runs without numpy.
+    Parameters:
+      numTaps:                     - number of taps, odd for a highpass (the inversion needs a center tap)
+      cutoff:                      - -6 dB frequency in Hz
+      Fs:                          - sampling frequency/rate the filter runs at
+      window:                      - "hamming", "hann" or "blackman"
+      highpass:                    - design a highpass instead of the lowpass
+    Returns:
+      list of the taps
+    '''
+    from math import cos, sin, pi
+
+    assert 0 < cutoff < Fs / 2
+    assert not highpass or numTaps % 2 == 1
+    windows = {
+        "hamming": lambda p: 0.54 - 0.46 * cos(p),
+        "hann": lambda p: 0.5 - 0.5 * cos(p),
+        "blackman": lambda p: 0.42 - 0.5 * cos(p) + 0.08 * cos(2 * p),
+    }
+    fc = cutoff / Fs
+    taps = []
+    for k in range(numTaps):
+        t = k - 0.5 * (numTaps - 1)
+        x = 2 * pi * fc * t
+        sinc = 2 * fc if t == 0 else 2 * fc * sin(x) / x
+        taps.append(sinc * windows[window](2 * pi * k / (numTaps - 1)))
+    gain = sum(taps)
+    taps = [v / gain for v in taps]
+    if highpass:
+        taps = [-v for v in taps]
+        taps[numTaps // 2] += 1.0
+    return taps
+
+def rbj_biquad(kind, frequency, Fs = 48000, q = 0.7071067811865476, gainDb = 0.0):
+    '''
+    Summary:
+      Biquad coefficients of the Audio EQ Cookbook (R. Bristow-Johnson), the same formulas as band_coeffs in fx_lib.c.
+      Written in the CMSIS order b0, b1, b2, -a1, -a2 (arm_biquad_cascade_df2T_f32 adds the feedback terms),
+      normalized to a0 = 1. Shelves with slope 1.
+    Parameters:
+      kind:                        - "lowpass", "highpass", "bandpass", "notch", "peaking", "lowshelf" or "highshelf"
+      frequency:                   - corner, center or shelf frequency in Hz
+      Fs:                          - sampling frequency/rate the filter runs at
+      q:                           - quality factor (not used by the shelves)
+      gainDb:                      - gain of peaking and shelving filters in dB
+    Returns:
+      list of the 5 coefficients
+    '''
+    from math import cos, sin, pi, sqrt
+
+    A = 10 ** (gainDb / 40)
+    w0 = 2 * pi * frequency / Fs
+    cs, sn = cos(w0), sin(w0)
+    alpha = sn / (2 * q)
+    if kind == "lowpass":
+        b, a = ((1 - cs) / 2, 1 - cs, (1 - cs) / 2), (1 + alpha, -2 * cs, 1 - alpha)
+    elif kind == "highpass":
+        b, a = ((1 + cs) / 2, -(1 + cs), (1 + cs) / 2), (1 + alpha, -2 * cs, 1 - alpha)
+    elif kind == "bandpass":
+        b, a = (alpha, 0.0, -alpha), (1 + alpha, -2 * cs, 1 - alpha)
+    elif kind == "notch":
+        b, a = (1.0, -2 * cs, 1.0), (1 + alpha, -2 * cs, 1 - alpha)
+    elif kind == "peaking":
+        b, a = (1 + alpha * A, -2 * cs, 1 - alpha * A), (1 + alpha / A, -2 * cs, 1 - alpha / A)
+    elif kind in ("lowshelf", "highshelf"):
+        beta = 2 * sqrt(A) * (sn / 2 * sqrt(2))
+        sign = 1 if kind == "lowshelf" else -1
+        b = (A * ((A + 1) - sign * (A - 1) * cs + beta),
+             sign * 2 * A * ((A - 1) - sign * (A + 1) * cs),
+             A * ((A + 1) - sign * (A - 1) * cs - beta))
+        a = ((A + 1) + sign * (A - 1) * cs + beta,
+             -sign * 2 * ((A - 1) + sign * (A + 1) * cs),
+             (A + 1) + sign * (A - 1) * cs - beta)
+    else:
+        raise ValueError(kind)
+    return [b[0] / a[0], b[1] / a[0], b[2] / a[0], -a[1] / a[0], -a[2] / a[0]]
+
+def butterworth_sections(order, cutoff, Fs = 48000, kind = "lowpass"):
+    '''
+    Summary:
+      Butterworth lowpass or highpass as a cascade of biquads (CMSIS order, see rbj_biquad): one RBJ section per pole
+      pair with the Q of the pair, and for an odd order a first order section (bilinear transform, b2 = a2 = 0).
+      The cutoff is the -3 dB frequency of the whole cascade.
+    Parameters:
+      order:                       - order of the filter, (order + 1) // 2 sections
+      cutoff:                      - -3 dB frequency in Hz
+      Fs:                          - sampling frequency/rate the filter runs at
+      kind:                        - "lowpass" or "highpass"
+    Returns:
+      list of sections, 5 coefficients each
+    '''
+    from math import cos, tan, pi
+
+    assert order >= 1 and kind in ("lowpass", "highpass")
+    sections = []
+    for k in range(order // 2):
+        # angle of the pole pair from the negative real axis. an odd order has its real pole at 0
+        angle = (2 * k + 1) * pi / (2 * order) if order % 2 == 0 else (k + 1) * pi / order
+        q = 1 / (2 * cos(angle))
+        sections.append(rbj_biquad(kind, cutoff, Fs, q))
+    if order % 2:
+        K = tan(pi * cutoff / Fs)
+        b0 = (K if kind == "lowpass" else 1.0) / (1 + K)
+        b1 = b0 if kind == "lowpass" else -b0
+        sections.append([b0, b1, 0.0, -(K - 1) / (K + 1), 0.0])
+    return sections
+
+def export_fir_header(taps, path, name = "filter_taps", placement = "DTCM_INIT", design = None):
+    '''
+    Summary:
+      Export FIR taps (e.g. of windowed_sinc) as C header. The array is defined with the placement attribute of
+      defines_and_constants.h, so the taps are in the DTCM from reset on (DTCM_INIT) or stay in flash (""), without
+      computing them at startup. The direct form FIR of CMSIS takes them in this order for any symmetric filter.
+    Parameters:
+      taps:                        - list of the taps
+      path:                        - file path of the generated header
+      name:                        - name of the C array. name_LENGTH is defined as its length
+      placement:                   - DTCM_INIT, DTCM_BSS is not initialized. "" for flash
+      design:                      - text of the call that designed the taps, written into the header to regenerate it
+    Returns:
+      None
+    '''
+    with open(path, "w") as f:
+        f.write("// generated by dsp_helpers.export_fir_header%s\n" % ((": " + design) if design else ""))
+        f.write("#define %s_LENGTH (%d)\n" % (name.upper(), len(taps)))
+        write_c_array(f, name, taps, placement = placement, size = "%s_LENGTH" % name.upper())
+
+def export_biquad_header(sections, path, name = "biquad_coeffs", placement = "", design = None):
+    '''
+    Summary:
+      Export biquad sections (rbj_biquad, butterworth_sections) as C header for arm_biquad_cascade_df2T_init_f32:
+      5 coefficients per section, name_STAGES is defined as the number of sections.
+    Parameters:
+      sections:                    - list of sections, 5 coefficients each (b0, b1, b2, -a1, -a2)
+      path:                        - file path of the generated header
+      name:                        - name of the C array
+      placement:                   - DTCM_INIT for the DTCM, "" for flash
+      design:                      - text of the call that designed the sections, written into the header
+    Returns:
+      None
+    '''
+    assert all(len(s) == 5 for s in sections)
+    with open(path, "w") as f:
+        f.write("// generated by dsp_helpers.export_biquad_header%s\n" % ((": " + design) if design else ""))
+        f.write("#define %s_STAGES (%d)\n" % (name.upper(), len(sections)))
+        write_c_array(f, name, [v for s in sections for v in s], placement = placement, size = "5 * %s_STAGES" % name.upper())
+
+def oscillator_wavetables(bits = 10, harmonics = 31):
+    '''
+    Summary:
+      Wavetables of oscillator.c: sine, triangle, square and Hann window (oscillator_waveform order), 2^bits points per
+      cycle plus the first point repeated. Triangle and square are summed from their odd harmonics up to harmonics
+      (band-limited), the square is scaled back to +-1 from its Gibbs overshoot. Computed in double precision.
+    Parameters:
+      bits:                        - OSCILLATOR_TABLE_BITS of the firmware
+      harmonics:                   - OSCILLATOR_HARMONICS of the firmware
+    Returns:
+      list of the 4 tables
+    '''
+    from math import cos, sin, pi
+
+    size = 1 << bits
+    sine, triangle, square, hann = [], [], [], []
+    for i in range(size):
+        t = 2 * pi * i / size
+        sine.append(sin(t))
+        triangle.append(8 / (pi * pi) * sum(cos(k * t) / (k * k) for k in range(1, harmonics + 1, 2)))
+        square.append(4 / pi * sum(sin(k * t) / k for k in range(1, harmonics + 1, 2)))
+        hann.append(0.5 - 0.5 * cos(t))
+    peak = max(abs(v) for v in square)
+    square = [v / peak for v in square]
+    return [table + table[:1] for table in (sine, triangle, square, hann)]
+
+def waveshaper_tables(curve, size = 512):
+    '''
+    Summary:
+      Table and antiderivative of a transfer curve in the layout of waveshaper.c (fill_table): the curve at size + 1
+      points from -1 to 1 plus the last point repeated, the antiderivative of the interpolated curve at the points
+      (trapezoid rule) shifted to 0 at x = 0.
+    Parameters:
+      curve:                       - transfer curve y = curve(x), -1 <= x <= 1 (e.g. from distortion.ipynb)
+      size:                        - WAVESHAPER_TABLE_SIZE of the firmware
+    Returns:
+      (table, integral), size + 2 values each
+    '''
+    table = [float(curve(-1 + 2 * i / size)) for i in range(size + 1)]
+    integral = [0.0]
+    for i in range(1, size + 1):
+        integral.append(integral[-1] + 0.5 * (2 / size) * (table[i - 1] + table[i]))
+    zero = integral[size // 2]
+    integral = [v - zero for v in integral]
+    return table + table[-1:], integral + integral[-1:]
+
+def export_waveshaper_header(curve, path, name = "shaper", size = 512, placement = "", design = None):
+    '''
+    Summary:
+      Export a transfer curve as C header for waveshaper_load: name_table and name_integral (waveshaper_tables),
+      in flash by default, the waveshaper copies them into its DTCM tables.
+    Parameters:
+      curve:                       - transfer curve y = curve(x), -1 <= x <= 1
+      path:                        - file path of the generated header
+      name:                        - prefix of the C arrays
+      size:                        - WAVESHAPER_TABLE_SIZE of the firmware
+      placement:                   - DTCM_INIT for the DTCM, "" for flash
+      design:                      - text describing the curve, written into the header
+    Returns:
+      (table, integral)
+    '''
+    table, integral = waveshaper_tables(curve, size)
+    with open(path, "w") as f:
+        f.write("// generated by dsp_helpers.export_waveshaper_header%s\n" % ((": " + design) if design else ""))
+        write_c_array(f, name + "_table", table, placement = placement, size = "WAVESHAPER_TABLE_SIZE + 2")
+        write_c_array(f, name + "_integral", integral, placement = placement, size = "WAVESHAPER_TABLE_SIZE + 2")
+    return table, integral
+
+def export_wavetable_header(path, name = "wavetable", bits = 10, harmonics = 31, placement = "DTCM_INIT"):
+    '''
+    Summary:
+      Export the wavetables of oscillator.c (oscillator_wavetables) as C header, copied into the DTCM at reset.
+      The array is static, only oscillator.c includes the header.
+    Parameters:
+      path:                        - file path of the generated header
+      name:                        - name of the C array
+      bits:                        - OSCILLATOR_TABLE_BITS of the firmware
+      harmonics:                   - OSCILLATOR_HARMONICS of the firmware
+      placement:                   - DTCM_INIT for the DTCM, "" for flash
+    Returns:
+      None
+    '''
+    tables = oscillator_wavetables(bits, harmonics)
+    with open(path, "w") as f:
+        f.write("// generated by dsp_helpers.export_wavetable_header: %d bits, %d harmonics\n" % (bits, harmonics))
+        f.write("#define %s_BITS (%d)\n" % (name.upper(), bits))
+        f.write("#define %s_HARMONICS (%d)\n" % (name.upper(), harmonics))
+        write_c_array(f, name, [v for t in tables for v in t], placement = placement, storage = "static const",
+            size = "OSC_TABLES", rows = len(tables),
+            columns = "OSCILLATOR_TABLE_SIZE + 1")
@@ -0,0 +1,80 @@
+# fast math check: evaluates the approximations of fast_math.h in float32, the same operations in the same order as the
+# firmware, and prints their largest error against the double precision numpy functions. run from this folder after
+# changing a coefficient, the results have to stay within the bounds listed in fast_math.h:
+#   python fast_math_check.py
+
+import numpy as np
+
+# fast_math.h
+LOG2E = np.float32(1.44269504)
+DB_PER_OCTAVE = np.float32(6.02059991)
+EXP2 = [np.float32(c) for c in (0.99999990, 0.69315449, 0.24014182, 0.05586034, 0.00894959, 0.00189375)]
+LOG2 = [np.float32(c) for c in (2.88539008, 0.96179669, 0.57707801, 0.41219858)]
+FLT_MIN = np.float32(1.17549435e-38)
+
+def fast_exp2(x):
+    x = np.clip(np.float32(x), np.float32(-126), np.float32(127))
+    whole = np.floor(x)
+    f = x - whole
+    p = EXP2[5]
+    for c in reversed(EXP2[:5]):
+        p = c + f * p
+    bits = p.astype(np.float32).view(np.int32) + (whole.astype(np.int32) << 23)
+    return bits.view(np.float32)
+
+def fast_log2(x):
+    bits = np.maximum(np.float32(x), FLT_MIN).view(np.int32)
+    e = ((bits >> 23) & 0xFF) - 127
+    m = ((bits & 0x007FFFFF) | 0x3F800000).view(np.float32)
+    fold = m > np.float32(1.41421356)
+    m = np.where(fold, m * np.float32(0.5), m)
+    e = e + fold
+    t = (m - np.float32(1)) / (m + np.float32(1))
+    t2 = t * t
+    return e.astype(np.float32) + t * (LOG2[0] + t2 * (LOG2[1] + t2 * (LOG2[2] + t2 * LOG2[3])))
+
+def fast_exp(x):
+    return fast_exp2(np.float32(x) * LOG2E)
+
+def fast_tanh(x):
+    x = np.float32(x)
+    a = np.abs(x)
+    a2 = a * a
+    series = a * (np.float32(1) + a2 * (np.float32(-0.333333333) + a2 * np.float32(0.133333333)))
+    exact = np.float32(1) - np.float32(2) / (fast_exp2(np.float32(2) * LOG2E * a) + np.float32(1))
+    y = np.where(a < np.float32(0.0625), series, exact)
+    return np.where(x < 0, -y, y)
+
+def fast_db_to_gain(db):
+    return fast_exp2(np.float32(db) * (np.float32(1) / DB_PER_OCTAVE))
+
+def fast_gain_to_db(gain):
+    return DB_PER_OCTAVE * fast_log2(gain)
+
+def main():
+    x = np.linspace(-126, 127, 2000001).astype(np.float32)
+    ref = np.exp2(x.astype(np.float64))
+    print("fast_exp2f        relative error %.3g" % np.max(np.abs(fast_exp2(x) / ref - 1)))
+
+    x = np.linspace(-80, 80, 2000001).astype(np.float32)
+    ref = np.exp(x.astype(np.float64))
+    print("fast_expf         relative error / (1 + |x|) %.3g" % np.max(np.abs(fast_exp(x) / ref - 1) / (1 + np.abs(x))))
+
+    x = np.geomspace(1e-30, 1e30, 2000001).astype(np.float32)
+    ref = np.log2(x.astype(np.float64))
+    print("fast_log2f        absolute error / (1 + |log2(x)|) %.3g" % np.max(np.abs(fast_log2(x) - ref) / (1 + np.abs(ref))))
+
+    x = np.linspace(-20, 20, 2000001).astype(np.float32)
+    ref = np.tanh(x.astype(np.float64))
+    print("fast_tanhf        absolute error %.3g" % np.max(np.abs(fast_tanh(x) - ref)))
+
+    db = np.linspace(-120, 40, 2000001).astype(np.float32)
+    ref = 10 ** (db.astype(np.float64) / 20)
+    print("fast_db_to_gain   relative error / (1 + |dB|) %.3g" % np.max(np.abs(fast_db_to_gain(db) / ref - 1) / (1 + np.abs(db))))
+
+    gain = np.geomspace(1e-6, 1e3, 2000001).astype(np.float32)
+    ref = 20 * np.log10(gain.astype(np.float64))
+    print("fast_gain_to_db   absolute error / (1 + |log2(gain)|) %.3g dB" % np.max(np.abs(fast_gain_to_db(gain) - ref) / (1 + np.abs(np.log2(gain.astype(np.float64))))))
+
+if __name__ == "__main__":
+    main()
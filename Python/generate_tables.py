@@ -0,0 +1,83 @@
+# firmware table generator: writes the coefficient and lookup table headers of the firmware from their design
+# parameters, with the functions of dsp_helpers the notebooks use. run from this folder after changing a design:
+#   python generate_tables.py                       filter taps and wavetables
+#   python generate_tables.py --reverb ir.wav       also the transformed reverb impulse response (numpy and scipy)
+#   python generate_tables.py --shaper tanh 3.0     also a waveshaper curve for waveshaper_load
+#   python generate_tables.py --costs swo.log       also the cost model of the chain from a benchmark log (pandas)
+#   python generate_tables.py --cost-estimates      also the cost model from the estimates, until there is a log
+# the parameters below have to match the firmware (defines_and_constants.h, oscillator.h, waveshaper.h, convolver.h)
+
+import argparse
+import math
+import os
+import dsp_helpers
+
+FIRMWARE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "H745ZI", "H745ZI_DSP")
+
+# pedal sample rate the fixed designs are made for (AUDIO_SAMPLE_RATE)
+FS = 48000
+# lowpass of the filter effect (filter_taps.h, NUM_TAPS)
+FIR_TAPS = 37
+FIR_CUTOFF = 2725
+FIR_WINDOW = "hamming"
+# wavetables of oscillator.c (OSCILLATOR_TABLE_BITS, OSCILLATOR_HARMONICS)
+WAVETABLE_BITS = 10
+WAVETABLE_HARMONICS = 31
+# waveshaper layout (WAVESHAPER_TABLE_SIZE)
+WAVESHAPER_TABLE_SIZE = 512
+# reverb image (REVERB_MAX_IR_LENGTH, CONVOLVER_PARTITION_SIZE)
+REVERB_MAX_LENGTH = 24000
+PARTITION_SIZE = 64
+
+# transfer curves that can be exported with --shaper: curve(x, param), the piecewise overdrive of dsp_helpers.overdrive
+def overdrive_curve(x, threshold):
+    if abs(x) < threshold:
+        return 2 * x
+    if abs(x) > 2 * threshold:
+        return 1.0 if x > 0 else -1.0
+    y = (3 - (2 - abs(x) * 3) ** 2) / 3
+    return y if x > 0 else -y
+
+def tanh_curve(x, gain):
+    return math.tanh(gain * x) / math.tanh(gain)
+
+def cubic_curve(x, unused):
+    return 1.5 * x - 0.5 * x ** 3
+
+CURVES = {"overdrive": overdrive_curve, "tanh": tanh_curve, "cubic": cubic_curve}
+
+def main():
+    parser = argparse.ArgumentParser(description = "generate the firmware coefficient and lookup table headers")
+    parser.add_argument("--out", default = FIRMWARE, help = "folder of the headers")
+    parser.add_argument("--reverb", metavar = "WAV", help = "impulse response to export as reverb_image.h")
+    parser.add_argument("--costs", metavar = "LOG", help = "SWO log of the benchmark firmware to export as cost_table.h")
+    parser.add_argument("--cost-estimates", action = "store_true", help = "export the estimated costs as cost_table.h")
+    parser.add_argument("--shaper", nargs = 2, metavar = ("CURVE", "PARAM"), help = "curve (%s) to export as shaper_table.h" % ", ".join(CURVES))
+    args = parser.parse_args()
+
+    design = "windowed_sinc(%d, %d, %d, '%s')" % (FIR_TAPS, FIR_CUTOFF, FS, FIR_WINDOW)
+    dsp_helpers.export_fir_header(dsp_helpers.windowed_sinc(FIR_TAPS, FIR_CUTOFF, FS, FIR_WINDOW),
+        os.path.join(args.out, "filter_taps.h"), design = design)
+    dsp_helpers.export_wavetable_header(os.path.join(args.out, "oscillator_tables.h"), bits = WAVETABLE_BITS,
+        harmonics = WAVETABLE_HARMONICS)
+
+    if args.shaper:
+        curve, param = args.shaper[0], float(args.shaper[1])
+        dsp_helpers.export_waveshaper_header(lambda x: CURVES[curve](x, param), os.path.join(args.out, "shaper_table.h"),
+            size = WAVESHAPER_TABLE_SIZE, design = "%s %g" % (curve, param))
+
+    if args.costs:
+        import analysis_helpers
+        analysis_helpers.ExportCostTable(args.costs, os.path.join(args.out, "cost_table.h"))
+    elif args.cost_estimates:
+        import analysis_helpers
+        analysis_helpers.ExportCostEstimates(os.path.join(args.out, "cost_table.h"))
+
+    if args.reverb:
+        from scipy.io import wavfile
+        rate, ir = wavfile.read(args.reverb)
+        dsp_helpers.export_ir_spectra(rate, ir, os.path.join(args.out, "reverb_image.h"), Fs = FS,
+            maxLength = REVERB_MAX_LENGTH, partitionSize = PARTITION_SIZE)
+
+if __name__ == "__main__":
+    main()
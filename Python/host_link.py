@@ -0,0 +1,333 @@
+'''
+Host side of the binary host protocol of the pedal (host_link.h in the firmware): frames over the virtual COM port of
+the ST-LINK. A frame is type, sequence and body, followed by the CRC-16/CCITT-FALSE of these bytes (little endian),
+COBS encoded and ended by a 0x00 byte. Needs pyserial.
+'''
+import struct
+
+# message types (host_message)
+PING, GET, SET, CONTROL, PRESET, IR_DATA, IR_LOAD, STREAM = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08
+CAPTURE, CAPTURE_READ = 0x09, 0x0A
+ACK, VALUE, STATUS, CAPTURE_INFO, CAPTURE_DATA = 0x80, 0x81, 0x82, 0x83, 0x84
+# operations of CAPTURE (host_capture_op) and the states of the ring (capture_state)
+CAPTURE_GET_INFO, CAPTURE_ARM, CAPTURE_FREEZE = 0, 1, 2
+CAPTURE_RECORDING, CAPTURE_STOPPING, CAPTURE_FROZEN = 0, 1, 2
+# control_type of control_link.h, for HostLink.control
+CONTROL_VALUE, CONTROL_MODE, CONTROL_BLOCK_SIZE, CONTROL_SAMPLE_RATE = 0, 1, 2, 3
+CONTROL_TAP, CONTROL_TUNER, CONTROL_LATENCY, CONTROL_PROFILER_RESET = 4, 5, 6, 7
+# arena_class of arena.h, in the order of the STATUS frame
+ARENAS = ("tcm", "axi", "ahb", "shared")
+# stack_context of stack_monitor.h
+STACKS = ("msp", "audio", "preempted", "control", "ui", "scratch")
+# firmware constants: HOST_LINK_BAUD_RATE, HOST_IR_CHUNK, PRESET_EFFECTS, PRESET_PARAMETERS, PRESET_UNSET, TELEMETRY_BANDS
+BAUD_RATE, IR_CHUNK, EFFECTS, PARAMETERS, UNSET, BANDS = 921600, 64, 22, 5, 0xFF, 32
+
+
+def crc16(data):
+    '''
+    Summary:
+      CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF), as host_crc16
+    Parameters:
+      data:                        - bytes
+    Returns:
+      CRC as int
+    '''
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    '''
+    Summary:
+      Consistent overhead byte stuffing without the delimiter, as host_cobs_encode
+    Parameters:
+      data:                        - bytes
+    Returns:
+      encoded bytes, no 0x00 among them
+    '''
+    out = bytearray([0])
+    code_position, code = 0, 1
+    for byte in data:
+        if byte == 0:
+            out[code_position] = code
+            code_position, code = len(out), 1
+            out.append(0)
+            continue
+        out.append(byte)
+        code += 1
+        if code == 0xFF:
+            out[code_position] = code
+            code_position, code = len(out), 1
+            out.append(0)
+    out[code_position] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    '''
+    Summary:
+      Undo cobs_encode on a frame without its delimiter
+    Parameters:
+      data:                        - encoded bytes
+    Returns:
+      decoded bytes, None if the frame is malformed
+    '''
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if (code == 0) or (i + code - 1 > len(data)):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if (code != 0xFF) and (i < len(data)):
+            out.append(0)
+    return bytes(out)
+
+
+def frame(payload):
+    '''
+    Summary:
+      Encoded frame of a payload (type, sequence, body) with its CRC and the delimiter
+    Parameters:
+      payload:                     - bytes
+    Returns:
+      bytes to send
+    '''
+    return cobs_encode(payload + struct.pack("<H", crc16(payload))) + b"\0"
+
+
+# layout of a CAPTURE_INFO body (capture_info_t), also the header of a file written by HostLink.save_capture
+CAPTURE_INFO_FORMAT = "<BBHIIIII"
+CAPTURE_INFO_KEYS = ("state", "reason", "block_size", "sample_rate", "record_bytes", "records", "trigger", "budget")
+
+
+def parse_capture_info(body):
+    # fields of a CAPTURE_INFO frame as a dict
+    return dict(zip(CAPTURE_INFO_KEYS, struct.unpack_from(CAPTURE_INFO_FORMAT, body)))
+
+
+def parse_status(body):
+    '''
+    Summary:
+      Fields of a STATUS frame (see send_status in host_link.c)
+    Parameters:
+      body:                        - bytes behind type and sequence
+    Returns:
+      dict of the fields. load in % of the block budget, "meter" with TELEMETRY only, "arenas":
+      arena name to (used, high water mark, size) in bytes, "stacks" with STACK_MONITOR: stack to
+      (high water mark, size) in bytes, only the ones the build has
+    '''
+    fields = struct.unpack_from("<IBBHIHHIIIIIIII", body)
+    keys = ("tick", "mode", "flags", "block_size", "sample_rate", "load_avg", "load_max", "deadline_misses", "clips",
+            "overruns", "errors", "frames", "link_errors", "rx_dropped", "tx_dropped")
+    status = dict(zip(keys, fields))
+    status["load_avg"] /= 10.0
+    status["load_max"] /= 10.0
+    offset = struct.calcsize("<IBBHIHHIIIIIIII")
+    if status["flags"] & 0x02:
+        sequence, rms, peak = struct.unpack_from("<Iff", body, offset)
+        bands = struct.unpack_from("<%db" % BANDS, body, offset + 12)
+        status["meter"] = {"sequence": sequence, "rms": rms, "peak": peak, "bands": list(bands)}
+        offset += 12 + BANDS
+    if status["flags"] & 0x04:
+        arenas = struct.unpack_from("<%dI" % (3 * len(ARENAS)), body, offset)
+        status["arenas"] = {name: arenas[3 * a:3 * a + 3] for a, name in enumerate(ARENAS)}
+        offset += 12 * len(ARENAS)
+    if status["flags"] & 0x08:
+        stacks = struct.unpack_from("<%dI" % (2 * len(STACKS)), body, offset)
+        status["stacks"] = {name: stacks[2 * s:2 * s + 2] for s, name in enumerate(STACKS) if stacks[2 * s + 1]}
+    return status
+
+
+class HostLink:
+    '''
+    Requests to the pedal and their answers. Every request waits for the answer with its sequence; STATUS frames
+    received meanwhile are kept for read_status.
+    '''
+
+    def __init__(self, port: str, baudrate = BAUD_RATE, timeout = 1.0) -> None:
+        """
+        Class constructor:
+        Opens the virtual COM port of the ST-LINK (e.g. "COM5" or "/dev/ttyACM0").
+        """
+        import serial
+        self.port = serial.Serial(port, baudrate, timeout = timeout)
+        self.sequence = 0
+        self.pending = bytearray()
+        self.statuses = []
+
+    def close(self):
+        self.port.close()
+
+    def receive(self):
+        '''
+        Summary:
+          Next valid frame, frames with a wrong CRC are skipped like the firmware does
+        Returns:
+          (type, sequence, body), None after the timeout of the port
+        '''
+        while True:
+            end = self.pending.find(0)
+            if end < 0:
+                chunk = self.port.read_until(b"\0")
+                if not chunk:
+                    return None
+                self.pending += chunk
+                continue
+            encoded, self.pending = bytes(self.pending[:end]), self.pending[end + 1:]
+            payload = cobs_decode(encoded) if encoded else None
+            if (payload is None) or (len(payload) < 4):
+                continue
+            if crc16(payload[:-2]) != struct.unpack("<H", payload[-2:])[0]:
+                continue
+            return payload[0], payload[1], payload[2:-2]
+
+    def request(self, kind, body = b""):
+        '''
+        Summary:
+          Send a request and wait for its answer
+        Parameters:
+          kind:                        - message type
+          body:                        - bytes of the request
+        Returns:
+          (type, body) of the answer. raises TimeoutError without one
+        '''
+        self.sequence = (self.sequence + 1) & 0xFF
+        self.port.write(frame(bytes([kind, self.sequence]) + bytes(body)))
+        while True:
+            answer = self.receive()
+            if answer is None:
+                raise TimeoutError("no answer to request 0x%02X" % kind)
+            if answer[0] == STATUS:
+                self.statuses.append(parse_status(answer[2]))
+            elif answer[1] == self.sequence:
+                return answer[0], answer[2]
+
+    def acknowledged(self, kind, body = b""):
+        # result of an ACK: 0 or the error code of the firmware function
+        answer, body = self.request(kind, body)
+        assert (answer == ACK) and (body[0] == kind)
+        return body[1]
+
+    def ping(self):
+        # protocol version (HOST_LINK_VERSION)
+        return self.acknowledged(PING)
+
+    def get(self, fx, item):
+        # menu value 0 to 100 of an item, None while it has its init value
+        answer, body = self.request(GET, bytes([fx, item]))
+        if answer != VALUE:
+            raise ValueError("no such item: %d, %d" % (fx, item))
+        return None if body[2] == UNSET else body[2]
+
+    def set(self, fx, item, value):
+        # as if the value was confirmed in the menu. 0 on success
+        return self.acknowledged(SET, bytes([fx, item, int(value)]))
+
+    def control(self, kind, value = 0, fx = 0, item = 0):
+        # any command of the menu (CONTROL_*), e.g. control(CONTROL_MODE, 2) starts the overdrive
+        return self.acknowledged(CONTROL, struct.pack("<BBBI", kind, fx, item, int(value)))
+
+    def preset(self, slot, preset):
+        '''
+        Summary:
+          Store a preset in flash, as export_library does: a dict with the effect "mode" and "values" {menu index of
+          the effect: [menu values 0 to 100 of its parameters]}
+        Returns:
+          0 on success, otherwise the error code of preset_save
+        '''
+        values = bytearray([UNSET] * (EFFECTS * PARAMETERS))
+        for fx, parameterValues in preset.get("values", {}).items():
+            for p, v in enumerate(parameterValues):
+                values[fx * PARAMETERS + p] = int(v)
+        return self.acknowledged(PRESET, bytes([slot, int(preset["mode"])]) + bytes(values))
+
+    def upload_cab(self, ir_samplingRate, impulseResponse, Fs = 48000, maxLength = 2048):
+        '''
+        Summary:
+          Replace the cabinet response of the pedal, prepared like in dsp_helpers.export_cab_header. The cabinet must
+          not be selected meanwhile
+        Parameters:
+          ir_samplingRate:             - sampling rate of the impulse response
+          impulseResponse:             - samples
+          Fs:                          - sample rate the pedal runs at
+          maxLength:                   - CAB_MAX_TAPS
+        Returns:
+          0 on success, otherwise the error code of audio_load_cab (255: the cabinet is in use)
+        '''
+        import dsp_helpers
+        impulseResponse = dsp_helpers.prepare_cab_ir(ir_samplingRate, impulseResponse, Fs, maxLength)
+        for offset in range(0, len(impulseResponse), IR_CHUNK):
+            chunk = impulseResponse[offset:offset + IR_CHUNK]
+            result = self.acknowledged(IR_DATA, struct.pack("<H%df" % len(chunk), offset, *chunk))
+            if result != 0:
+                return result
+        return self.acknowledged(IR_LOAD, struct.pack("<H", len(impulseResponse)))
+
+    def stream(self, period):
+        # STATUS every period ms, 0: off
+        return self.acknowledged(STREAM, struct.pack("<H", int(period)))
+
+    def read_status(self):
+        '''
+        Summary:
+          Next STATUS frame of the stream
+        Returns:
+          dict, see parse_status. None after the timeout of the port
+        '''
+        while not self.statuses:
+            answer = self.receive()
+            if answer is None:
+                return None
+            if answer[0] == STATUS:
+                self.statuses.append(parse_status(answer[2]))
+        return self.statuses.pop(0)
+
+    def capture_info(self):
+        # state and layout of the post-mortem ring, see parse_capture_info
+        answer, body = self.request(CAPTURE, bytes([CAPTURE_GET_INFO]))
+        assert answer == CAPTURE_INFO
+        return parse_capture_info(body)
+
+    def capture_arm(self):
+        # empty the ring and record again, 0 on success
+        return self.acknowledged(CAPTURE, bytes([CAPTURE_ARM]))
+
+    def capture_freeze(self):
+        # freeze the ring now, as a dropout would, 0 on success
+        return self.acknowledged(CAPTURE, bytes([CAPTURE_FREEZE]))
+
+    def save_capture(self, path, arm = True):
+        '''
+        Summary:
+          Read the frozen post-mortem ring into a file for analysis_helpers.ReadCapture: the CAPTURE_INFO body, then
+          the records from the oldest one
+        Parameters:
+          path:                        - file to write
+          arm:                         - record again once the ring is read
+        Returns:
+          the info as dict, None if the ring isn't frozen (yet)
+        '''
+        info = self.capture_info()
+        if info["state"] != CAPTURE_FROZEN:
+            return None
+        data = bytearray()
+        total = info["records"] * info["record_bytes"]
+        while len(data) < total:
+            answer, body = self.request(CAPTURE_READ, struct.pack("<I", len(data)))
+            if (answer != CAPTURE_DATA) or (struct.unpack_from("<I", body)[0] != len(data)):
+                raise IOError("capture read failed at offset %d" % len(data))
+            data += body[4:]
+        with open(path, "wb") as file:
+            file.write(struct.pack(CAPTURE_INFO_FORMAT, *[info[key] for key in CAPTURE_INFO_KEYS]))
+            file.write(data)
+        if arm:
+            self.capture_arm()
+        return info
@@ -0,0 +1,249 @@
+'''
+Decoder of the ITM event trace of the pedal (TRACE in defines_and_constants.h, trace.h in the firmware): the SWO stream
+(raw ITM packets as written by the debug probe, e.g. the SWO capture of VisualGDB or "monitor tpiu config internal
+swo.bin uart off 480000000" of OpenOCD) into events with their time, the durations of the blocks and the nodes and a
+timeline plot. Run "python itm_trace.py swo.bin" for the statistics.
+'''
+import sys
+
+# stimulus port of the events (TRACE_PORT) and the text of the reports
+TRACE_PORT, TEXT_PORT = 1, 0
+# trace_event of trace.h
+CLOCK, BLOCK_START, BLOCK_END, BLOCK_SKIP, BLOCK_READY, CONTROL_START, CONTROL_END = 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+DMA, UI_INPUT, COMMAND = 0x08, 0x10, 0x18
+IPC_BLOCK, IPC_TAIL, IPC_TAIL_MISSED, IPC_STATUS, IPC_COMMAND = 0x20, 0x21, 0x22, 0x23, 0x28
+NODE_START, NODE_END = 0x40, 0x80
+# fx_designator of fx_lib.h, the ids of the nodes
+NODES = ['none', 'delay', 'overdrive', 'fuzz', 'tremolo', 'ring_mod', 'filter', 'chorus', 'flanger', 'reverb', 'eq', 'cab',
+         'gate', 'comp', 'pitch', 'wah', 'phaser', 'amp', 'fxloop', 'denoise', 'freeze', 'pingpong']
+# control_type of control_link.h
+COMMANDS = ['value', 'mode', 'block_size', 'sample_rate', 'tap', 'tuner', 'latency', 'profiler_reset']
+# events without an argument
+NAMES = {CLOCK: 'clock', BLOCK_START: 'block_start', BLOCK_END: 'block_end', BLOCK_SKIP: 'block_skip',
+         BLOCK_READY: 'block_ready', CONTROL_START: 'control_start', CONTROL_END: 'control_end', IPC_BLOCK: 'ipc_block',
+         IPC_TAIL: 'ipc_tail', IPC_TAIL_MISSED: 'ipc_tail_missed', IPC_STATUS: 'ipc_status'}
+# the core clock until the first CLOCK event
+DEFAULT_CLOCK = 480000000
+
+
+def itm_packets(data):
+    '''
+    Summary:
+      Software source packets of an ITM stream. Synchronization, overflow, timestamp, extension
+      and hardware source packets (DWT) are skipped
+    Parameters:
+      data:                        - bytes of the SWO stream
+    Returns:
+      list of (port, value, size in bytes), None as port for an overflow packet (events were lost)
+    '''
+    packets = []
+    i = 0
+    while i < len(data):
+        header = data[i]
+        i += 1
+        if header == 0x00:
+            # synchronization
+            continue
+        if header == 0x70:
+            packets.append((None, 0, 0))
+            continue
+        size = header & 0x03
+        if size == 0:
+            # timestamp or extension: continuation bit 7 in the header and in every byte but the last
+            more = header & 0x80
+            while more and (i < len(data)):
+                more = data[i] & 0x80
+                i += 1
+            continue
+        length = (1, 2, 4)[size - 1]
+        if i + length > len(data):
+            break
+        value = int.from_bytes(data[i:i + length], 'little')
+        i += length
+        if not (header & 0x04):
+            packets.append((header >> 3, value, length))
+    return packets
+
+
+def event_name(code):
+    # name of a trace_event with its argument
+    if code >= NODE_END:
+        return 'node_end:' + node_name(code - NODE_END)
+    if code >= NODE_START:
+        return 'node_start:' + node_name(code - NODE_START)
+    if IPC_COMMAND <= code < IPC_COMMAND + 8:
+        return 'ipc_command:' + COMMANDS[code - IPC_COMMAND]
+    if COMMAND <= code < COMMAND + 8:
+        return 'command:' + COMMANDS[code - COMMAND]
+    if UI_INPUT <= code < UI_INPUT + 8:
+        return 'ui_input:' + ('button' if code & 1 else '') + ('encoder' if code & 2 else '')
+    if DMA <= code < DMA + 8:
+        return 'dma:%d' % (code - DMA)
+    return NAMES.get(code, 'unknown:0x%02X' % code)
+
+
+def node_name(id):
+    return NODES[id] if id < len(NODES) else 'node%d' % id
+
+
+def decode(data):
+    '''
+    Summary:
+      Events of the trace port with their time. The 24 bit cycle stamps are unwrapped as signed
+      differences: an event of an interrupt can be written before the one it preempted, which
+      read its stamp earlier. This needs an event at least every 2^23 cycles (17 ms at 480 MHz),
+      the DMA interrupt of every block is one
+    Parameters:
+      data:                        - bytes of the SWO stream
+    Returns:
+      dict with 'events': list of (time in s, event code, name), 'text': what the reports wrote
+      to port 0, 'overflows': overflow packets (lost events)
+    '''
+    events = []
+    text = []
+    overflows = 0
+    clock = DEFAULT_CLOCK
+    seconds = 0.0
+    last = None
+    expect_clock = False
+    for port, value, size in itm_packets(data):
+        if port is None:
+            overflows += 1
+            continue
+        if port == TEXT_PORT:
+            text.append(chr(value & 0xFF))
+            continue
+        if (port != TRACE_PORT) or (size != 4):
+            continue
+        if expect_clock:
+            clock = value
+            expect_clock = False
+            continue
+        stamp, code = value >> 8, value & 0xFF
+        # cycles since the last event, modulo 2^24 and sign extended (slightly out of order), at the clock of the time
+        if last is not None:
+            delta = (stamp - last) & 0xFFFFFF
+            if delta & 0x800000:
+                delta -= 0x1000000
+            seconds += delta / float(clock)
+        last = stamp
+        if code == CLOCK:
+            expect_clock = True
+        events.append((seconds, code, event_name(code)))
+    return {'events': events, 'text': ''.join(text), 'overflows': overflows}
+
+
+def durations(events, start, end):
+    '''
+    Summary:
+      Intervals between matching start and end events, e.g. BLOCK_START and BLOCK_END
+    Parameters:
+      events:                      - list of decode
+      start, end:                  - event codes
+    Returns:
+      list of (start time, duration) in s
+    '''
+    spans = []
+    opened = None
+    for time, code, _ in events:
+        if code == start:
+            opened = time
+        elif (code == end) and (opened is not None):
+            spans.append((opened, time - opened))
+            opened = None
+    return spans
+
+
+def statistics(events):
+    '''
+    Summary:
+      Duration of the blocks, of every node and of the control pass, the period of the DMA
+      interrupts and the delay from the DMA interrupt to the start of the block (what the other
+      interrupts and the MDMA staging add)
+    Parameters:
+      events:                      - list of decode
+    Returns:
+      dict of name to (count, mean, min, max, standard deviation) in us
+    '''
+    series = {'block': [d for _, d in durations(events, BLOCK_START, BLOCK_END)],
+              'control_pass': [d for _, d in durations(events, CONTROL_START, CONTROL_END)]}
+    ids = sorted({code - NODE_START for _, code, _ in events if NODE_START <= code < NODE_END})
+    for id in ids:
+        series['node:' + node_name(id)] = [d for _, d in durations(events, NODE_START + id, NODE_END + id)]
+    dma = [time for time, code, _ in events if DMA <= code < DMA + 8]
+    series['dma_period'] = [b - a for a, b in zip(dma, dma[1:])]
+    wake = []
+    pending = None
+    for time, code, _ in events:
+        if DMA <= code < DMA + 8:
+            pending = time if pending is None else pending
+        elif (code == BLOCK_START) and (pending is not None):
+            wake.append(time - pending)
+            pending = None
+    series['dma_to_start'] = wake
+
+    result = {}
+    for name, values in series.items():
+        if not values:
+            continue
+        mean = sum(values) / len(values)
+        deviation = (sum((v - mean) ** 2 for v in values) / len(values)) ** 0.5
+        result[name] = tuple([len(values)] + [v * 1e6 for v in (mean, min(values), max(values), deviation)])
+    return result
+
+
+def plot_timeline(events, begin = 0.0, length = 0.01, destination = 'trace_timeline', figsize = (12, 6), dpi = 100):
+    '''
+    Summary:
+      Timeline of a window of the trace: one row for the blocks, one per node, one for the
+      control pass, the DMA interrupts, control inputs, commands and inter-core messages as marks
+    Parameters:
+      events:                      - list of decode
+      begin, length:               - window in s from the first event
+      destination:                 - file name of the figure in the Results directory, None to only show it
+    Returns:
+      None
+    '''
+    import matplotlib.pyplot as plt
+
+    end = begin + length
+    rows = [('block', BLOCK_START, BLOCK_END)]
+    ids = sorted({code - NODE_START for _, code, _ in events if NODE_START <= code < NODE_END})
+    rows += [(node_name(id), NODE_START + id, NODE_END + id) for id in ids]
+    rows.append(('control pass', CONTROL_START, CONTROL_END))
+    marks = [('dma', lambda c: DMA <= c < DMA + 8, 'k'), ('ready', lambda c: c == BLOCK_READY, 'g'),
+             ('skip', lambda c: c == BLOCK_SKIP, 'r'), ('ui', lambda c: UI_INPUT <= c < COMMAND + 8, 'm'),
+             ('ipc', lambda c: IPC_BLOCK <= c < IPC_COMMAND + 8, 'c')]
+
+    plt.rcParams["figure.figsize"] = figsize
+    plt.rcParams["figure.dpi"] = dpi
+    fig, ax = plt.subplots()
+    labels = []
+    for y, (name, start, stop) in enumerate(rows):
+        spans = [((s - begin) * 1e3, d * 1e3) for s, d in durations(events, start, stop) if (s + d >= begin) and (s <= end)]
+        ax.broken_barh(spans, (y - 0.4, 0.8))
+        labels.append(name)
+    for k, (name, match, color) in enumerate(marks):
+        y = len(rows) + k
+        times = [(t - begin) * 1e3 for t, c, _ in events if match(c) and (begin <= t <= end)]
+        ax.vlines(times, y - 0.4, y + 0.4, color = color)
+        labels.append(name)
+    ax.set_yticks(range(len(labels)))
+    ax.set_yticklabels(labels)
+    ax.set_xlim(0, length * 1e3)
+    ax.set_xlabel('time [ms]')
+    ax.grid(axis = 'x')
+    ax.set_title('ITM trace, %.1f ms from %.3f s' % (length * 1e3, begin))
+    if destination is not None:
+        import analysis_helpers
+        plt.savefig(analysis_helpers.ResultsPath() + destination)
+    plt.show()
+
+
+if __name__ == '__main__':
+    with open(sys.argv[1], 'rb') as swo:
+        trace = decode(swo.read())
+    print('%d events, %d overflows' % (len(trace['events']), trace['overflows']))
+    print('%-20s %8s %10s %10s %10s %10s' % ('us', 'count', 'mean', 'min', 'max', 'std'))
+    for name, (count, mean, low, high, deviation) in statistics(trace['events']).items():
+        print('%-20s %8d %10.2f %10.2f %10.2f %10.2f' % (name, count, mean, low, high, deviation))
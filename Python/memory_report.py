@@ -0,0 +1,362 @@
+'''
+Memory budget of the pedal: the static footprint of every module in every memory region, read from the map file of the
+linker (VisualGDB writes it next to the elf, e.g. VisualGDB/Release/H745ZI_DSP.map), and the high water marks of the
+effect memory arenas (arena.h) and of the stacks (stack_monitor.h) at run time, from the SWO reports or the STATUS
+stream of the host link.
+The history in the Results directory catches the commits that take more memory. Run after a build:
+  python memory_report.py H745ZI_DSP.map                     regions, sections and modules
+  python memory_report.py H745ZI_DSP.map --store --check     add the build to the history, exit 1 if it grew
+  python memory_report.py H745ZI_DSP.map --swo swo.log       also the arena and stack high water marks of a SWO log
+  python memory_report.py H745ZI_DSP.map --port COM5         also the arenas and stacks of the running pedal (pyserial)
+'''
+import argparse
+import csv
+import os
+import sys
+
+# memory regions of the linker scripts (STM32H745ZITx_FLASH_CM7.ld, _CM4.ld) by the names of the report
+REGIONS = {'ITCMRAM': 'ITCM', 'DTCMRAM': 'DTCM', 'RAM_D1': 'D1', 'RAM_D2': 'D2', 'RAM_D3': 'D3', 'FLASH': 'FLASH',
+           'EXTRAM': 'SDRAM'}
+# order of the columns
+COLUMNS = ['ITCM', 'DTCM', 'D1', 'D2', 'D3', 'FLASH', 'SDRAM']
+# arena_class of arena.h: the arena names of the profiler report and the region of their memory
+ARENAS = {'tcm': 'DTCM', 'axi': 'D1', 'ahb': 'D2', 'shared': 'D3'}
+# bytes of an output section the input sections don't cover: heap, stack and alignment of the linker script
+SCRIPT = '(linker script)'
+# a region filled beyond this share is reported, the next effect may not fit anymore
+FILL_WARNING = 0.9
+
+
+def module_name(path):
+    # object file of an input section without folder and extension, the library for an archive member
+    if '(' in path and path.endswith(')'):
+        path = path[:path.index('(')]
+    name = os.path.basename(path.replace('\\', '/'))
+    return name[:-2] if name.endswith('.o') else name
+
+
+def is_number(token):
+    return token.startswith('0x')
+
+
+def read_map(path):
+    '''
+    Summary:
+      Output and input sections of a map file of the GNU linker. The discarded input sections
+      are skipped, names wrapped onto their own line (long section names) are joined with the
+      address line
+    Parameters:
+      path:                        - map file
+    Returns:
+      dict with 'regions': name to (origin, length) of the memory configuration, 'sections':
+      list of dicts with name, address, size, load (load address or None) and 'inputs': list of
+      (name, address, size, module)
+    '''
+    regions = {}
+    sections = []
+    part = None
+    pending = None
+    with open(path, 'r', errors = 'ignore') as map_file:
+        for line in map_file:
+            line = line.rstrip('\r\n')
+            if line.startswith('Memory Configuration'):
+                part = 'memory'
+                continue
+            if line.startswith('Linker script and memory map'):
+                part = 'script'
+                continue
+            tokens = line.split()
+            if not tokens:
+                continue
+            if part == 'memory':
+                if (len(tokens) >= 3) and is_number(tokens[1]) and (tokens[0] != '*default*'):
+                    regions[tokens[0]] = (int(tokens[1], 16), int(tokens[2], 16))
+                continue
+            if part != 'script':
+                continue
+
+            if pending is not None:
+                # the address line of a wrapped name
+                kind, name = pending
+                pending = None
+                if is_number(tokens[0]):
+                    tokens = [name] + tokens
+                    line = (' ' if kind == 'input' else '') + ' '.join(tokens)
+                else:
+                    continue
+
+            if not line.startswith(' '):
+                # output section: name, address, size and maybe a load address
+                if tokens[0].startswith('.') or tokens[0] == 'COMMON':
+                    if len(tokens) == 1:
+                        pending = ('output', tokens[0])
+                    elif (len(tokens) >= 3) and is_number(tokens[1]) and is_number(tokens[2]):
+                        load = int(tokens[-1], 16) if 'load' in tokens[3:] else None
+                        sections.append({'name': tokens[0], 'address': int(tokens[1], 16), 'size': int(tokens[2], 16),
+                                         'load': load, 'inputs': []})
+                continue
+
+            if not sections or not line.startswith(' ') or line.startswith('  '):
+                # symbols and assignments of the script are indented further
+                continue
+            name = tokens[0]
+            if name.startswith('*') and name != '*fill*':
+                # input section patterns of the script, e.g. *(.text*)
+                continue
+            if len(tokens) == 1:
+                pending = ('input', name)
+                continue
+            if (len(tokens) >= 3) and is_number(tokens[1]) and is_number(tokens[2]):
+                module = module_name(' '.join(tokens[3:])) if len(tokens) > 3 else SCRIPT
+                sections[-1]['inputs'].append((name, int(tokens[1], 16), int(tokens[2], 16), module))
+    return {'regions': regions, 'sections': sections}
+
+
+def region_of(regions, address):
+    # report name of the region an address is in, None outside of all (debug sections)
+    for name, (origin, length) in regions.items():
+        if origin <= address < origin + length:
+            return REGIONS.get(name, name)
+    return None
+
+
+def footprint(memory_map):
+    '''
+    Summary:
+      Bytes of every module in every region. Sections with a load address (.data, .dtcm_init,
+      the ITCM code) count in their region and in the one they're copied from (FLASH). What the
+      input sections of an output section don't cover (stack, heap, alignment) counts for
+      SCRIPT, so the modules add up to the use of the region
+    Parameters:
+      memory_map:                  - dict of read_map
+    Returns:
+      dict with 'modules': module to dict of region to bytes, 'sections': list of (region, name,
+      size, load region), 'regions': region to (used, length)
+    '''
+    regions = memory_map['regions']
+    modules = {}
+    named = []
+    used = {}
+
+    def add(module, region, size):
+        if (region is None) or (size == 0):
+            return
+        modules.setdefault(module, {})
+        modules[module][region] = modules[module].get(region, 0) + size
+        used[region] = used.get(region, 0) + size
+
+    for section in memory_map['sections']:
+        region = region_of(regions, section['address'])
+        if (region is None) or (section['size'] == 0):
+            continue
+        load = region_of(regions, section['load']) if section['load'] is not None else None
+        if load == region:
+            load = None
+        named.append((region, section['name'], section['size'], load))
+        covered = 0
+        for _, address, size, module in section['inputs']:
+            # the input sections outside of the output section are stubs of the linker (e.g. veneers at address 0)
+            if not (section['address'] <= address < section['address'] + section['size']):
+                continue
+            covered += size
+            add(module, region, size)
+            add(module, load, size)
+        add(SCRIPT, region, section['size'] - covered)
+        add(SCRIPT, load, section['size'] - covered)
+
+    lengths = {REGIONS.get(name, name): length for name, (_, length) in regions.items()}
+    return {'modules': modules, 'sections': named,
+            'regions': {region: (used.get(region, 0), lengths[region]) for region in lengths}}
+
+
+def columns(report):
+    # regions in the order of COLUMNS, the unknown ones behind
+    present = set(report['regions'])
+    return [c for c in COLUMNS if c in present] + sorted(present - set(COLUMNS))
+
+
+def print_report(report, sections = 2048, out = sys.stdout):
+    '''
+    Summary:
+      Print the use of every region, the output sections of at least the given size and the
+      modules, largest RAM user first
+    Parameters:
+      report:                      - dict of footprint
+      sections:                    - smallest output section listed in bytes
+    Returns:
+      None
+    '''
+    regions = columns(report)
+    out.write('%-8s %10s %10s %7s\n' % ('region', 'used', 'size', 'fill'))
+    for region in regions:
+        used, length = report['regions'][region]
+        warning = '  over %d%%' % (FILL_WARNING * 100) if used > FILL_WARNING * length else ''
+        out.write('%-8s %10d %10d %6.1f%%%s\n' % (region, used, length, 100.0 * used / length, warning))
+
+    out.write('\n%-8s %-24s %10s %s\n' % ('region', 'section', 'bytes', 'loaded from'))
+    for region, name, size, load in sorted(report['sections'], key = lambda s: (regions.index(s[0]), -s[2])):
+        if size >= sections:
+            out.write('%-8s %-24s %10d %s\n' % (region, name, size, load or ''))
+
+    def ram(module):
+        return sum(b for r, b in report['modules'][module].items() if r not in ('FLASH', 'SDRAM'))
+
+    out.write('\n%-32s' % 'module' + ''.join('%9s' % r for r in regions) + '\n')
+    for module in sorted(report['modules'], key = lambda m: (-ram(m), -sum(report['modules'][m].values()))):
+        sizes = report['modules'][module]
+        out.write('%-32s' % module[:32] + ''.join('%9d' % sizes.get(r, 0) for r in regions) + '\n')
+
+
+def read_marks(path, kind):
+    '''
+    Summary:
+      High water marks and sizes from the last line of a kind in a log of the SWO console:
+      "arena" of the profiler report (profiler_report) or "stack" (stack_monitor_report)
+    Parameters:
+      path:                        - text file with the SWO output
+      kind:                        - 'arena' or 'stack'
+    Returns:
+      dict of arena or stack name to (high water mark, size) in bytes, empty without a report
+    '''
+    marks = {}
+    with open(path, 'r', errors = 'ignore') as log:
+        for line in log:
+            tokens = [t for t in line.split() if t != 'overflow']
+            if not tokens or (tokens[0] != kind):
+                continue
+            marks = {}
+            for name, value in zip(tokens[1::2], tokens[2::2]):
+                high_water, size = value.split('/')
+                marks[name] = (int(high_water), int(size))
+    return marks
+
+
+def live_marks(port):
+    # high water marks and sizes of the arenas and the stacks of the running pedal, from one STATUS frame of the host link
+    import host_link
+
+    link = host_link.HostLink(port)
+    try:
+        link.stream(100)
+        status = link.read_status()
+        link.stream(0)
+    finally:
+        link.close()
+    arenas = {name: (high_water, size) for name, (used, high_water, size) in status.get('arenas', {}).items()}
+    return arenas, status.get('stacks', {})
+
+
+def print_marks(marks, kind, out = sys.stdout):
+    # the arenas or stacks with the share of their size taken at most
+    out.write('\n%-10s %-6s %10s %10s %7s\n' % (kind, 'region', 'high', 'size', 'fill'))
+    for name, (high_water, size) in marks.items():
+        warning = '  over %d%%' % (FILL_WARNING * 100) if high_water > FILL_WARNING * size else ''
+        out.write('%-10s %-6s %10d %10d %6.1f%%%s\n' % (name, ARENAS.get(name, ''), high_water, size,
+                                                       100.0 * high_water / size if size else 0.0, warning))
+
+
+def store(report, arenas = None, stacks = None, commit = None, history = 'memory_history.csv'):
+    '''
+    Summary:
+      Add the footprint of one build and the arena and stack high water marks to the history in the
+      Results directory. Rows of the same commit are replaced, so a build can be repeated
+    Parameters:
+      report:                      - dict of footprint
+      arenas, stacks:              - dicts of read_marks or live_marks, None if not measured
+      commit:                      - commit the firmware was built from, the current HEAD if None
+      history:                     - file name of the history in the Results directory
+    Returns:
+      list of the rows of the whole history: commit, date, region, module, bytes
+    '''
+    import analysis_helpers
+    from datetime import datetime
+    from subprocess import check_output
+
+    if commit is None:
+        commit = check_output(['git', 'rev-parse', '--short', 'HEAD'], text = True).strip()
+    date = datetime.now().strftime('%Y-%m-%d %H:%M')
+    rows = [(commit, date, region, '(total)', used) for region, (used, _) in report['regions'].items()]
+    for module, sizes in report['modules'].items():
+        rows += [(commit, date, region, module, size) for region, size in sizes.items()]
+    for name, (high_water, _) in (arenas or {}).items():
+        rows.append((commit, date, ARENAS.get(name, name), 'arena:' + name, high_water))
+    for name, (high_water, _) in (stacks or {}).items():
+        rows.append((commit, date, 'stack', 'stack:' + name, high_water))
+
+    destination = analysis_helpers.ResultsPath() + history
+    previous = []
+    if os.path.isfile(destination):
+        with open(destination, 'r', newline = '') as table:
+            previous = [tuple(row) for row in csv.reader(table)][1:]
+    table_rows = [row for row in previous if row[0] != commit] + [tuple(str(v) for v in row) for row in rows]
+    with open(destination, 'w', newline = '') as table:
+        writer = csv.writer(table)
+        writer.writerow(('commit', 'date', 'region', 'module', 'bytes'))
+        writer.writerows(table_rows)
+    return table_rows
+
+
+def check(history = 'memory_history.csv', tolerance = 256):
+    '''
+    Summary:
+      Compare the latest commit of the history with the one before: the region totals, the
+      modules and the arena and stack high water marks that grew by more than the tolerance
+    Parameters:
+      history:                     - file name of the history in the Results directory
+      tolerance:                   - growth in bytes that is still accepted
+    Returns:
+      list of (region, module, bytes before, bytes after), largest growth first, empty if
+      nothing grew
+    '''
+    import analysis_helpers
+
+    with open(analysis_helpers.ResultsPath() + history, 'r', newline = '') as table:
+        rows = list(csv.DictReader(table))
+    commits = list(dict.fromkeys(row['commit'] for row in rows))
+    if len(commits) < 2:
+        return []
+
+    def sizes(commit):
+        return {(row['region'], row['module']): int(row['bytes']) for row in rows if row['commit'] == commit}
+
+    before, after = sizes(commits[-2]), sizes(commits[-1])
+    grown = [(key[0], key[1], before.get(key, 0), size) for key, size in after.items()
+             if size - before.get(key, 0) > tolerance]
+    return sorted(grown, key = lambda g: g[2] - g[3])
+
+
+def main():
+    parser = argparse.ArgumentParser(description = 'memory budget of a firmware build')
+    parser.add_argument('map', help = 'map file of the linker')
+    parser.add_argument('--sections', type = int, default = 2048, help = 'smallest output section listed in bytes')
+    parser.add_argument('--swo', metavar = 'LOG', help = 'SWO log with the reports, for the arena and stack high water marks')
+    parser.add_argument('--port', help = 'serial port of the host link, for the arenas and stacks of the running pedal')
+    parser.add_argument('--store', action = 'store_true', help = 'add the build to the history in the Results directory')
+    parser.add_argument('--commit', help = 'commit of the build for --store, the current HEAD by default')
+    parser.add_argument('--check', action = 'store_true', help = 'exit 1 if the build takes more than the one before')
+    parser.add_argument('--tolerance', type = int, default = 256, help = 'growth in bytes --check accepts')
+    args = parser.parse_args()
+
+    report = footprint(read_map(args.map))
+    print_report(report, args.sections)
+    arenas, stacks = None, None
+    if args.swo:
+        arenas, stacks = read_marks(args.swo, 'arena'), read_marks(args.swo, 'stack')
+    elif args.port:
+        arenas, stacks = live_marks(args.port)
+    if arenas:
+        print_marks(arenas, 'arena')
+    if stacks:
+        print_marks(stacks, 'stack')
+    if args.store:
+        store(report, arenas, stacks, args.commit)
+    if args.check:
+        grown = check(tolerance = args.tolerance)
+        for region, module, before, after in grown:
+            print('grown: %-6s %-32s %9d -> %9d (%+d)' % (region, module, before, after, after - before))
+        if grown:
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,380 @@
+'''
+Numeric format simulator: runs the effects the way the firmware computes them - q31 and q15 conversions of CMSIS-DSP
+(truncating, the project doesn't define ARM_MATH_ROUNDING), q15 / fp16 / float32 delay storage, the interpolated
+waveshaper tables (float and q31 lookup), the oscillator wavetables and the fast_math.h approximations - and reports
+SNR, peak error and THD of every variant against a float64 reference. The variants of an effect are listed from the
+cheapest (memory, then cycles) to the most expensive, so the first one above the quality bar is the one to build.
+Written to Results/numeric_formats.csv:
+  python numeric_formats.py                                    every effect on the sine probe, 90 dB bar
+  python numeric_formats.py overdrive fuzz --table-size 256    would a table of half the DTCM do?
+  python numeric_formats.py delay --input guitar.wav --set feedback=0.8 --min-snr 80
+Not modelled: parameter smoothing, the control rate decimation of the LFOs and the oversampler of the distortions.
+'''
+import argparse
+import csv
+import os
+
+import numpy as np
+
+# CMSIS-DSP scales of the fixed point converters
+Q31_SCALE = np.float32(2147483648.0)
+Q15_SCALE = np.float32(32768.0)
+# fx_lib.h
+TREMOLO_MAX_RATE_HZ = 15.28
+RING_MOD_MAX_RATE_HZ = 152.8
+# firmware table sizes (WAVESHAPER_TABLE_SIZE, OSCILLATOR_TABLE_BITS)
+TABLE_SIZE = 512
+WAVETABLE_BITS = 10
+# default quality bar: SNR of every variant against the float64 reference in dB
+MIN_SNR = 90.0
+
+
+# ---- number formats ----
+
+def float_to_q31(x):
+    # arm_float_to_q31 without ARM_MATH_ROUNDING: float32 product, truncated towards zero, saturated
+    return np.clip(np.trunc(np.asarray(x, np.float32) * Q31_SCALE).astype(np.int64), -2 ** 31, 2 ** 31 - 1)
+
+
+def q31_to_float(q):
+    # arm_q31_to_float: the integer is rounded to float32 first, then divided
+    return np.asarray(q).astype(np.float32) / Q31_SCALE
+
+
+def float_to_q15(x):
+    # arm_float_to_q15 without ARM_MATH_ROUNDING: truncated towards zero, __SSAT to 16 bit
+    return np.clip(np.trunc(np.asarray(x, np.float32) * Q15_SCALE).astype(np.int64), -2 ** 15, 2 ** 15 - 1)
+
+
+def q15_to_float(q):
+    # arm_q15_to_float
+    return np.asarray(q).astype(np.float32) / Q15_SCALE
+
+
+def q31_to_q15(q):
+    # arm_q31_to_q15: the upper half word, the arithmetic shift rounds towards minus infinity
+    return np.asarray(q) >> 16
+
+
+def q15_to_q31(q):
+    # arm_q15_to_q31
+    return np.asarray(q).astype(np.int64) << 16
+
+
+def mult_q15(a, b):
+    # arm_mult_q15: 32 bit product shifted back by 15, __SSAT to 16 bit
+    return np.clip((np.asarray(a, np.int64) * np.asarray(b, np.int64)) >> 15, -2 ** 15, 2 ** 15 - 1)
+
+
+def store(x, fmt):
+    '''
+    Summary:
+      Round trip of a float signal through the storage format of a buffer (delay line, block).
+    Parameters:
+      x:                           - signal, -1 to 1
+      fmt:                         - 'f64' (reference), 'f32', 'f16' (VCVTB/VCVTT of the M7), 'q31' or 'q15'
+    Returns:
+      the signal as it is read back, float64
+    '''
+    if fmt == 'f64':
+        return np.asarray(x, np.float64)
+    if fmt == 'f32':
+        return np.asarray(x, np.float32).astype(np.float64)
+    if fmt == 'f16':
+        return np.asarray(x, np.float32).astype(np.float16).astype(np.float64)
+    if fmt == 'q31':
+        return q31_to_float(float_to_q31(x)).astype(np.float64)
+    if fmt == 'q15':
+        return q15_to_float(float_to_q15(x)).astype(np.float64)
+    raise ValueError('unknown format ' + fmt)
+
+
+# ---- table approximations ----
+
+def shaper_table(curve, param, size = TABLE_SIZE):
+    # float32 table of waveshaper.c (fill_table): size + 1 points from -1 to 1 and the guard point
+    import dsp_helpers
+    table, _ = dsp_helpers.waveshaper_tables(lambda x: curve(np.float64(x), param), size)
+    return np.array(table, np.float32)
+
+
+def shaper_lookup(table, x):
+    '''
+    Summary:
+      interpolate() of waveshaper.c in float32: clamp, split the position into index and
+      fraction, interpolate linearly.
+    Parameters:
+      table:                       - table of shaper_table
+      x:                           - input signal
+    Returns:
+      shaped signal, float32
+    '''
+    size = len(table) - 2
+    half = np.float32(size * 0.5)
+    pos = np.clip((np.asarray(x, np.float32) + np.float32(1)) * half, np.float32(0), np.float32(size))
+    index = pos.astype(np.uint32)
+    frac = pos - index.astype(np.float32)
+    y0 = table[index]
+    return y0 + frac * (table[index + 1] - y0)
+
+
+def shaper_lookup_q31(table, q):
+    '''
+    Summary:
+      lookup_q31() of waveshaper.c: the table index from the top bits of the offset binary
+      sample, 16 bits of fraction, float32 interpolation and the truncating conversion back.
+    Parameters:
+      table:                       - table of shaper_table (power of 2 intervals)
+      q:                           - q31 input signal (int64 array)
+    Returns:
+      q31 output signal (int64 array)
+    '''
+    size = len(table) - 2
+    shift = 32 - (size.bit_length() - 1)
+    pos = (np.asarray(q, np.int64) & 0xFFFFFFFF) ^ 0x80000000
+    index = pos >> shift
+    frac = ((pos >> (shift - 16)) & 0xFFFF).astype(np.float32) * np.float32(1 / 65536)
+    y0 = table[index]
+    y = y0 + frac * (table[index + 1] - y0)
+    return np.trunc(np.minimum(y, np.float32(0.99999994)) * Q31_SCALE).astype(np.int64)
+
+
+def table_sine(frequency, N, Fs = 48000, bits = WAVETABLE_BITS):
+    '''
+    Summary:
+      Sine of oscillator_generate: a 32 bit phase accumulator, the increment truncated from the
+      float32 product, the top bits index the wavetable and the rest interpolates.
+    Parameters:
+      frequency:                   - frequency in Hz
+      N:                           - number of samples
+      Fs:                          - sampling rate
+      bits:                        - OSCILLATOR_TABLE_BITS
+    Returns:
+      the oscillator output, float32
+    '''
+    import dsp_helpers
+    table = np.array(dsp_helpers.oscillator_wavetables(bits, 1)[0], np.float32)
+    fraction_bits = 32 - bits
+    increment = int(np.float32(frequency) * (np.float32(4294967296.0) / np.float32(Fs)))
+    phase = (increment * np.arange(N, dtype = np.uint64)) & 0xFFFFFFFF
+    index = phase >> fraction_bits
+    frac = (phase & ((1 << fraction_bits) - 1)).astype(np.float32) * np.float32(1 / (1 << fraction_bits))
+    y0 = table[index]
+    return y0 + frac * (table[index + 1] - y0)
+
+
+# ---- effects: float64 reference and the firmware variants, cheapest first ----
+
+def overdrive_curve(x, threshold):
+    # overdrive_curve of fx_lib.c: Schetzen soft clipping stretched with the threshold, in the precision of x
+    u = np.abs(x) / (3 * threshold)
+    y = np.where(u < 1 / 3, 2 * u, np.where(u < 2 / 3, (3 - (2 - 3 * u) ** 2) / 3, 1))
+    return np.where(x < 0, -y, y).astype(np.asarray(x).dtype)
+
+
+def fuzz_curve(x, gain, exp = np.exp):
+    # fuzz_curve of fx_lib.c: -sign(q) * (1 - e^-|q|), q = x * gain
+    q = x * gain
+    return (-np.sign(q) * (1 - exp(-np.abs(q)))).astype(np.asarray(x).dtype)
+
+
+def overdrive_variants(x, Fs, table_size = TABLE_SIZE, bits = WAVETABLE_BITS, threshold = 1 / 3):
+    reference = overdrive_curve(x, threshold)
+    table = shaper_table(overdrive_curve, threshold, table_size)
+    return reference, [
+        ('q31 chain, %d point table' % table_size, q31_to_float(shaper_lookup_q31(table, float_to_q31(x)))),
+        ('float32, %d point table' % table_size, shaper_lookup(table, x.astype(np.float32))),
+        ('float32 curve per sample', overdrive_curve(x.astype(np.float32), np.float32(threshold))),
+    ]
+
+
+def fuzz_variants(x, Fs, table_size = TABLE_SIZE, bits = WAVETABLE_BITS, gain = 11.0, mix = 1.0):
+    # the shaped signal made up to full scale and mixed as run_fuzz does it, the input stays in the dry path
+    import fast_math_check
+    makeup = 1 / (1 - np.exp(-gain))
+    wet = lambda shaped: mix * makeup * shaped.astype(np.float64) + (1 - mix) * x
+    table = shaper_table(fuzz_curve, gain, table_size)
+    x32 = x.astype(np.float32)
+    return wet(fuzz_curve(x, gain)), [
+        ('q31 chain, %d point table' % table_size, wet(q31_to_float(shaper_lookup_q31(table, float_to_q31(x))))),
+        ('float32, %d point table' % table_size, wet(shaper_lookup(table, x32))),
+        ('float32 curve, fast_expf', wet(fuzz_curve(x32, np.float32(gain), fast_math_check.fast_exp))),
+        ('float32 curve, expf', wet(fuzz_curve(x32, np.float32(gain)))),
+    ]
+
+
+def factor_variants(x, Fs, bits, frequency, factor):
+    '''
+    Summary:
+      Variants of an element-wise effect: the signal times a gain computed from a sine LFO or
+      carrier. q15: the fused stage of fx_chain_set_q15 (gain and signal converted to q15,
+      arm_mult_q15, converted back), otherwise float32.
+    Parameters:
+      x:                           - input signal
+      Fs:                          - sampling rate
+      bits:                        - OSCILLATOR_TABLE_BITS of the table oscillator
+      frequency:                   - frequency of the sine in Hz
+      factor:                      - gain from the sine, in the precision of its argument
+    Returns:
+      reference output, list of (variant, output)
+    '''
+    N = len(x)
+    exact = np.sin(2 * np.pi * frequency * np.arange(N) / Fs)
+    lfo = table_sine(frequency, N, Fs, bits)
+    x32 = x.astype(np.float32)
+    q15 = q15_to_float(mult_q15(float_to_q15(x32), float_to_q15(factor(lfo))))
+    return factor(exact) * x, [
+        ('q15 stage, %d bit table' % bits, q15),
+        ('float32, %d bit table' % bits, factor(lfo) * x32),
+        ('float32, sinf', factor(exact.astype(np.float32)) * x32),
+    ]
+
+
+def tremolo_variants(x, Fs, table_size = TABLE_SIZE, bits = WAVETABLE_BITS, rate = 0.5, depth = 0.5):
+    # tremolo_factor: 0.5 - 0.5 * depth * sine
+    factor = lambda s: (s * s.dtype.type(depth) * s.dtype.type(-0.5) + s.dtype.type(0.5))
+    return factor_variants(x, Fs, bits, rate * TREMOLO_MAX_RATE_HZ, factor)
+
+
+def ring_modulator_variants(x, Fs, table_size = TABLE_SIZE, bits = WAVETABLE_BITS, rate = 0.5, blend = 0.5):
+    # ring_mod_factor with the sine carrier: 1 + blend * (carrier - 1)
+    factor = lambda s: ((s - s.dtype.type(1)) * s.dtype.type(blend) + s.dtype.type(1))
+    return factor_variants(x, Fs, bits, rate * RING_MOD_MAX_RATE_HZ, factor)
+
+
+def echo(x, delay, feedback, mix, fmt):
+    # feedback echo with the line stored in fmt: line[n] = x[n] + feedback * line[n - delay], y = x + mix * line[n - delay].
+    # vectorized one delay length at a time, a chunk only depends on the one before
+    line = np.zeros(len(x) + delay)
+    for start in range(0, len(x), delay):
+        chunk = x[start:start + delay]
+        delayed = line[start:start + len(chunk)]
+        line[start + delay:start + delay + len(chunk)] = store(chunk + feedback * delayed, fmt)
+    return x + mix * line[:len(x)]
+
+
+def delay_variants(x, Fs, table_size = TABLE_SIZE, bits = WAVETABLE_BITS, delay_ms = 250.0, feedback = 0.5, mix = 0.5):
+    # q31: the SAMPLE_Q31 chain, the block is q31 as well. the float lines get the block in float32
+    delay = max(int(delay_ms * Fs / 1000), 1)
+    x32 = store(x, 'f32')
+    return echo(x, delay, feedback, mix, 'f64'), [
+        ('q15 line (DELAY_LINE_Q15)', echo(x32, delay, feedback, mix, 'q15')),
+        ('fp16 line', echo(x32, delay, feedback, mix, 'f16')),
+        ('q31 chain and line', store(echo(store(x, 'q31'), delay, feedback, mix, 'q31'), 'q31')),
+        ('float32 line', echo(x32, delay, feedback, mix, 'f32')),
+    ]
+
+
+EFFECTS = {
+    'overdrive': overdrive_variants,
+    'fuzz': fuzz_variants,
+    'tremolo': tremolo_variants,
+    'ring_modulator': ring_modulator_variants,
+    'delay': delay_variants,
+}
+
+
+# ---- metrics ----
+
+def snr_db(reference, test):
+    # energy of the reference over the energy of the difference, inf if bit exact
+    reference = np.asarray(reference, np.float64)
+    error = np.sum((np.asarray(test, np.float64) - reference) ** 2)
+    return float(10 * np.log10(np.sum(reference ** 2) / error)) if error > 0 else float('inf')
+
+
+def peak_error_db(reference, test):
+    # largest difference in dBFS
+    peak = np.max(np.abs(np.asarray(test, np.float64) - reference))
+    return float(20 * np.log10(peak)) if peak > 0 else float('-inf')
+
+
+def evaluate(effect, signal = None, Fs = 48000, table_size = TABLE_SIZE, bits = WAVETABLE_BITS, min_snr = MIN_SNR, **params):
+    '''
+    Summary:
+      Run the variants of an effect against its float64 reference. SNR and peak error are
+      measured on the signal, THD on the sine probe of parameter_sweep (THD of the reference for
+      comparison), so a variant can be judged by its noise and by what it adds to the harmonics.
+    Parameters:
+      effect:                      - name in EFFECTS
+      signal:                      - input material from -1 to 1, None: the sine probe
+      Fs:                          - sampling rate
+      table_size:                  - intervals of the waveshaper tables
+      bits:                        - OSCILLATOR_TABLE_BITS of the table oscillators
+      min_snr:                     - quality bar in dB
+      params:                      - parameters of the effect (see the *_variants functions)
+    Returns:
+      list of rows (dicts), in the order of the variants
+    '''
+    import parameter_sweep
+
+    variants = EFFECTS[effect]
+    tone, frequency = parameter_sweep.probe_tone(Fs = Fs)
+    tone_reference, tone_tests = variants(tone, Fs, table_size, bits, **params)
+    reference_thd, _ = parameter_sweep.tone_metrics(tone_reference, frequency, Fs)
+    if signal is not None:
+        reference, tests = variants(np.asarray(signal, np.float64), Fs, table_size, bits, **params)
+    else:
+        reference, tests = tone_reference, tone_tests
+
+    rows = []
+    for (variant, output), (_, tone_output) in zip(tests, tone_tests):
+        snr = snr_db(reference, output)
+        thd, _ = parameter_sweep.tone_metrics(np.asarray(tone_output, np.float64), frequency, Fs)
+        rows.append(dict(effect = effect, variant = variant, snr_db = snr, peak_error_db = peak_error_db(reference, output),
+                         thd_percent = thd, reference_thd_percent = reference_thd, passes = snr >= min_snr))
+    return rows
+
+
+def parse_setting(text):
+    # name=value of --set
+    name, _, value = text.partition('=')
+    if not name or not value:
+        raise argparse.ArgumentTypeError('setting has to be name=value: ' + text)
+    return name, float(value)
+
+
+def main():
+    import inspect
+    import analysis_helpers
+    import parameter_sweep
+
+    parser = argparse.ArgumentParser(description = 'error budget of the fixed point, storage and approximation variants of the effects')
+    parser.add_argument('effects', nargs = '*', help = 'effects to simulate (%s), all by default' % ', '.join(EFFECTS))
+    parser.add_argument('--input', help = 'audio file the SNR is measured on (WAV, or any format librosa reads), the sine probe by default')
+    parser.add_argument('--table-size', type = int, default = TABLE_SIZE, help = 'intervals of the waveshaper tables, a power of 2')
+    parser.add_argument('--wavetable-bits', type = int, default = WAVETABLE_BITS, help = 'OSCILLATOR_TABLE_BITS of the table oscillators')
+    parser.add_argument('--min-snr', type = float, default = MIN_SNR, help = 'quality bar in dB')
+    parser.add_argument('--set', type = parse_setting, action = 'append', default = [], help = 'parameter of the effects that have it, e.g. threshold=0.2')
+    args = parser.parse_args()
+    for effect in args.effects:
+        if effect not in EFFECTS:
+            parser.error('no simulation of ' + effect)
+
+    signal, Fs = parameter_sweep.read_input(args.input) if args.input else (None, 48000)
+    if signal is not None:
+        signal = np.clip(signal, -1, 1)
+    rows = []
+    for effect in args.effects or list(EFFECTS):
+        accepted = inspect.signature(EFFECTS[effect]).parameters
+        params = {name: value for name, value in args.set if name in accepted}
+        result = evaluate(effect, signal, Fs, args.table_size, args.wavetable_bits, args.min_snr, **params)
+        rows += result
+
+        print(effect + ''.join(' %s=%g' % p for p in params.items()))
+        for row in result:
+            print('  %-30s SNR %7.1f dB  peak error %7.1f dBFS  THD %8.4f %% (reference %.4f %%)  %s' % (row['variant'],
+                  row['snr_db'], row['peak_error_db'], row['thd_percent'], row['reference_thd_percent'], 'ok' if row['passes'] else '-'))
+        passing = [row['variant'] for row in result if row['passes']]
+        print('  cheapest above %g dB: %s' % (args.min_snr, passing[0] if passing else 'none'))
+
+    path = os.path.join(analysis_helpers.ResultsPath(), 'numeric_formats.csv')
+    with open(path, 'w', newline = '') as table:
+        writer = csv.DictWriter(table, fieldnames = list(rows[0]))
+        writer.writeheader()
+        writer.writerows(rows)
+    print('written to ' + path)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,236 @@
+'''
+Parameter sweeps of the reference effects (dsp_helpers): every point of a parameter grid is rendered on all CPU cores,
+the renders are saved as WAV files and the metrics of every point (THD and aliasing energy of a sine probe, RMS and
+peak of the render) go into one table, so the defaults of the firmware can be chosen from data.
+Everything is written to Results/<effect>_sweep/. An axis is name=start:stop:step (stop included), a list name=a,b,c
+or a single value name=a:
+  python parameter_sweep.py fuzz gain=1:18:1 mix=0.2                      the probe tone through every gain
+  python parameter_sweep.py overdrive threshold=0:0.4:0.025 --input guitar.wav
+  python parameter_sweep.py tremolo rate=0.1,0.5,1 depth=0.25:1:0.25 --jobs 4 --no-wav
+From a notebook: parameter_sweep.sweep('fuzz', {'gain': numpy.arange(1, 19)}) returns the rows of the table.
+'''
+import argparse
+import csv
+import itertools
+import os
+
+# default sine probe: a prime frequency, so the harmonics folding back at 48 kHz don't land on harmonic bins
+PROBE_FREQUENCY = 1009
+PROBE_LEVEL = 0.5
+PROBE_SECONDS = 1
+# columns of the metrics table after the parameters
+METRICS = ['thd_percent', 'aliasing_db', 'rms_db', 'peak_db']
+
+# set in every worker by init_worker, so the input is sent to each process once instead of with every point
+worker = {}
+
+
+def parse_axis(text):
+    '''
+    Summary:
+      Read one axis of the grid from the command line.
+    Parameters:
+      text:                        - name=start:stop:step (stop included), name=a,b,c or name=a
+    Returns:
+      name of the parameter, list of its values
+    '''
+    name, _, values = text.partition('=')
+    if not name or not values:
+        raise argparse.ArgumentTypeError('axis has to be name=values: ' + text)
+    if ':' in values:
+        start, stop, step = (float(v) for v in values.split(':'))
+        count = int(round((stop - start) / step)) + 1
+        return name, [start + i * step for i in range(count)]
+    return name, [float(v) for v in values.split(',')]
+
+
+def grid(axes):
+    '''
+    Summary:
+      All combinations of the axes (cartesian product), the first axis changing slowest.
+    Parameters:
+      axes:                        - dict of parameter name to a sequence of values
+    Returns:
+      list of dicts, one keyword argument set of the effect per point
+    '''
+    names = list(axes)
+    return [dict(zip(names, (float(v) for v in values))) for values in itertools.product(*(axes[n] for n in names))]
+
+
+def probe_tone(frequency = PROBE_FREQUENCY, level = PROBE_LEVEL, Fs = 48000, seconds = PROBE_SECONDS):
+    '''
+    Summary:
+      Sine probe of the distortion metrics. The frequency is rounded to a whole number of
+      periods in the probe, so every harmonic falls exactly on an FFT bin (no window needed).
+    Parameters:
+      frequency:                   - frequency in Hz
+      level:                       - amplitude, 0 to 1
+      Fs:                          - sampling rate
+      seconds:                     - length of the probe
+    Returns:
+      wave array, the frequency actually used
+    '''
+    from numpy import arange, sin, pi
+    N = int(Fs * seconds)
+    frequency = round(frequency * seconds) / seconds
+    return level * sin(2 * pi * frequency * arange(N) / Fs), frequency
+
+
+def tone_metrics(output, frequency, Fs = 48000):
+    '''
+    Summary:
+      Distortion of a rendered probe tone. THD: the harmonics below Fs / 2 relative to the
+      fundamental. Aliasing energy: everything that is neither DC nor a harmonic (the harmonics
+      above Fs / 2 fold back in between, plus noise and modulation sidebands) relative to
+      the whole signal.
+    Parameters:
+      output:                      - effect output for the probe of probe_tone
+      frequency:                   - frequency of the probe in Hz (as returned by probe_tone)
+      Fs:                          - sampling rate
+    Returns:
+      THD in percent, aliasing energy in dB
+    '''
+    from numpy import abs, log10, sqrt, ones
+    from numpy.fft import rfft
+
+    power = abs(rfft(output)) ** 2
+    fundamental = int(round(frequency * len(output) / Fs))
+    harmonic = ones(len(power), dtype = bool)
+    harmonic[fundamental::fundamental] = False
+    harmonic[0] = False
+    total = power[1:].sum()
+    if power[fundamental] <= 0 or total <= 0:
+        return float('nan'), float('nan')
+    harmonics = power[2 * fundamental::fundamental].sum()
+    thd = 100 * sqrt(harmonics / power[fundamental])
+    aliasing = power[harmonic].sum()
+    return float(thd), float(10 * log10(aliasing / total)) if aliasing > 0 else float('-inf')
+
+
+def level_db(signal):
+    # RMS and peak in dBFS, -inf for silence
+    from numpy import abs, log10, mean, sqrt
+    rms = sqrt(mean(signal ** 2)) if len(signal) else 0
+    peak = abs(signal).max() if len(signal) else 0
+    return (float(20 * log10(rms)) if rms > 0 else float('-inf'), float(20 * log10(peak)) if peak > 0 else float('-inf'))
+
+
+def point_name(effect, params):
+    # file name of a render: the effect and every parameter, e.g. fuzz_gain=3_mix=0.2
+    return '_'.join([effect] + ['%s=%g' % (name, value) for name, value in params.items()])
+
+
+def init_worker(effect, tone, frequency, material, Fs, directory):
+    worker.update(effect = effect, tone = tone, frequency = frequency, material = material, Fs = Fs, directory = directory)
+
+
+def render_point(params):
+    '''
+    Summary:
+      Render one point of the grid in a worker process: the probe for the distortion metrics,
+      then the input material (the probe without an input file) for the WAV and the levels.
+    Parameters:
+      params:                      - keyword arguments of the effect
+    Returns:
+      row of the metrics table (dict)
+    '''
+    import dsp_helpers
+    from numpy import float32
+    from scipy.io import wavfile
+
+    effect = getattr(dsp_helpers, worker['effect'])
+    thd, aliasing = tone_metrics(effect(worker['tone'], **params), worker['frequency'], worker['Fs'])
+    material = worker['material']
+    render = effect(material, **params) if material is not None else effect(worker['tone'], **params)
+    rms, peak = level_db(render)
+
+    row = dict(params, thd_percent = thd, aliasing_db = aliasing, rms_db = rms, peak_db = peak, wav = '')
+    if worker['directory'] is not None:
+        row['wav'] = point_name(worker['effect'], params) + '.wav'
+        wavfile.write(os.path.join(worker['directory'], row['wav']), worker['Fs'], render.astype(float32))
+    return row
+
+
+def read_input(path):
+    '''
+    Summary:
+      Read the input material: WAV with scipy, other formats (e.g. synth_mix.mp3) with
+      librosa. Stereo is mixed to mono as the effects do it (dsp_helpers.toMono).
+    Parameters:
+      path:                        - audio file
+    Returns:
+      wave array from -1 to 1, sampling rate
+    '''
+    import dsp_helpers
+    from numpy import float64, iinfo, issubdtype, integer
+
+    if path.lower().endswith('.wav'):
+        from scipy.io import wavfile
+        Fs, data = wavfile.read(path)
+        if issubdtype(data.dtype, integer):
+            data = data / float64(-iinfo(data.dtype).min)
+        return dsp_helpers.toMono(data.astype(float64)), Fs
+    import librosa
+    data, Fs = librosa.load(path, sr = None, mono = True)
+    return data.astype(float64), Fs
+
+
+def sweep(effect, axes, input = None, jobs = None, wav = True, frequency = PROBE_FREQUENCY, level = PROBE_LEVEL,
+          destination = None):
+    '''
+    Summary:
+      Render every point of the grid on jobs processes and write the metrics table (and the
+      renders) into Results/<effect>_sweep/.
+    Parameters:
+      effect:                      - name of the reference function in dsp_helpers, e.g. 'fuzz'
+      axes:                        - dict of parameter name to a sequence of values (see grid)
+      input:                       - audio file rendered for the WAVs, None: the probe tone
+      jobs:                        - worker processes, None: one per CPU core
+      wav:                         - write the renders
+      frequency, level:            - sine probe of the THD and aliasing metrics
+      destination:                 - directory of the results, None: Results/<effect>_sweep
+    Returns:
+      list of the rows of the table (dicts), in grid order
+    '''
+    import analysis_helpers
+    import dsp_helpers
+    from multiprocessing import Pool
+
+    if not hasattr(dsp_helpers, effect):
+        raise ValueError('no reference effect ' + effect + ' in dsp_helpers')
+    material, Fs = read_input(input) if input else (None, 48000)
+    tone, frequency = probe_tone(frequency, level, Fs)
+    directory = destination or os.path.join(analysis_helpers.ResultsPath(), effect + '_sweep')
+    os.makedirs(directory, exist_ok = True)
+
+    points = grid(axes)
+    with Pool(jobs, init_worker, (effect, tone, frequency, material, Fs, directory if wav else None)) as pool:
+        rows = pool.map(render_point, points, chunksize = 1)
+
+    with open(os.path.join(directory, 'metrics.csv'), 'w', newline = '') as table:
+        writer = csv.DictWriter(table, fieldnames = list(axes) + METRICS + ['wav'])
+        writer.writeheader()
+        writer.writerows(rows)
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description = 'render a parameter grid of a reference effect on all cores')
+    parser.add_argument('effect', help = 'reference function of dsp_helpers, e.g. fuzz, overdrive, tremolo')
+    parser.add_argument('axes', nargs = '+', type = parse_axis, help = 'name=start:stop:step, name=a,b,c or name=a')
+    parser.add_argument('--input', help = 'audio file rendered for the WAVs (WAV, or any format librosa reads), the probe tone by default')
+    parser.add_argument('--jobs', type = int, help = 'worker processes, one per CPU core by default')
+    parser.add_argument('--no-wav', action = 'store_true', help = 'only the metrics table')
+    parser.add_argument('--frequency', type = float, default = PROBE_FREQUENCY, help = 'frequency of the sine probe in Hz')
+    parser.add_argument('--level', type = float, default = PROBE_LEVEL, help = 'amplitude of the sine probe')
+    args = parser.parse_args()
+
+    rows = sweep(args.effect, dict(args.axes), args.input, args.jobs, not args.no_wav, args.frequency, args.level)
+    names = [name for name, _ in args.axes]
+    print('  '.join('%10s' % n for n in names + METRICS))
+    for row in rows:
+        print('  '.join('%10.4g' % row[n] for n in names + METRICS))
+
+
+if __name__ == '__main__':
+    main()